@@ -362,6 +362,22 @@ cfs_mem_cache_cpt_alloc(struct kmem_cache *cachep, struct cfs_cpt_table *cptab,
 				     cfs_cpt_spread_node(cptab, cpt));
 }
 
+/*
+ * per-CPU-partition magazines of free objects in front of a kmem_cache,
+ * for objects which are allocated and freed at high rate
+ */
+struct cfs_mag_cache;
+struct seq_file;
+
+struct cfs_mag_cache *
+cfs_mag_cache_create(const char *name, struct kmem_cache *slab,
+		     struct cfs_cpt_table *cptab, unsigned int objsize);
+void cfs_mag_cache_destroy(struct cfs_mag_cache *mc);
+void *cfs_mag_cache_alloc(struct cfs_mag_cache *mc, gfp_t flags);
+void cfs_mag_cache_free(struct cfs_mag_cache *mc, void *obj);
+/* print statistics of all magazine caches */
+int cfs_mag_cache_seq_show(struct seq_file *m);
+
 /**
  * iterate over all CPU partitions in \a cptab
  */
@@ -39,6 +39,7 @@
 #define __LIBCFS_HASH_H__
 
 #include <linux/hash.h>
+#include <linux/seqlock.h>
 
 /*
  * Knuth recommends primes in approximately golden ratio to the maximum
@@ -91,6 +92,8 @@ struct cfs_hash_bucket {
 	__u32			hsb_version;	/**< change version */
 	unsigned int		hsb_index;	/**< index of bucket */
 	int			hsb_depmax;	/**< max depth on bucket */
+	/** bumped while items are moved out of the bucket, CFS_HASH_RCU */
+	seqcount_t		hsb_seq;
 	long			hsb_head[0];	/**< hash-head array */
 };
 
@@ -153,6 +156,15 @@ enum cfs_hash_tag {
          * change on hash table is non-blocking
          */
         CFS_HASH_NBLK_CHANGE    = 1 << 13,
+	/**
+	 * cfs_hash_lookup() runs under rcu_read_lock() without taking any
+	 * lock, and rehash moves items one bucket at a time without
+	 * blocking other operations. Requires bucket locks and
+	 * ops->hs_get_rcu, and items must not be freed before an RCU grace
+	 * period has passed since they were removed from the hash. Implies
+	 * CFS_HASH_NBLK_CHANGE.
+	 */
+	CFS_HASH_RCU		= 1 << 14,
         /** NB, we typed hs_flags as  __u16, please change it
          * if you need to extend >=16 flags */
 };
@@ -198,6 +210,13 @@ enum cfs_hash_tag {
  * depending on whether the worker task has yet to transfer the object
  * to its new location in the table. Lookups and deletions need to search both
  * locations; additions must take care to only insert into the new bucket.
+ *
+ * With CFS_HASH_RCU, lookups take neither hs_lock nor bucket locks. The
+ * rehash worker only holds the locks of the buckets it is moving items
+ * between, and bumps hsb_seq of the source bucket while doing so; the
+ * bucket tables are switched under hs_seq. A lookup that misses retries
+ * if either changed, because a concurrent move may have made it skip
+ * part of a chain. Old bucket tables are freed after a grace period.
  */
 
 struct cfs_hash {
@@ -246,6 +265,8 @@ struct cfs_hash {
 	atomic_t			hs_refcount;
 	/** rehash buckets-table */
 	struct cfs_hash_bucket		**hs_rehash_buckets;
+	/** bumped when bucket tables change, CFS_HASH_RCU lookups */
+	seqcount_t			hs_seq;
 #if CFS_HASH_DEBUG_LEVEL >= CFS_HASH_DEBUG_1
         /** serialize debug members */
 	spinlock_t		    hs_dep_lock;
@@ -310,6 +331,11 @@ struct cfs_hash_ops {
 	void     (*hs_put_locked)(struct cfs_hash *hs, struct hlist_node *hnode);
 	/** it's called before removing of @hnode */
 	void     (*hs_exit)(struct cfs_hash *hs, struct hlist_node *hnode);
+	/**
+	 * get refcount of item found under rcu_read_lock(), fails if the
+	 * item is being freed. Only used by CFS_HASH_RCU
+	 */
+	bool     (*hs_get_rcu)(struct cfs_hash *hs, struct hlist_node *hnode);
 };
 
 /** total number of buckets in @hs */
@@ -420,6 +446,12 @@ cfs_hash_with_nblk_change(struct cfs_hash *hs)
         return (hs->hs_flags & CFS_HASH_NBLK_CHANGE) != 0;
 }
 
+static inline int
+cfs_hash_with_rcu(struct cfs_hash *hs)
+{
+	return (hs->hs_flags & CFS_HASH_RCU) != 0;
+}
+
 static inline int
 cfs_hash_is_exiting(struct cfs_hash *hs)
 {       /* cfs_hash_destroy is called */
@@ -614,8 +646,21 @@ static inline int
 cfs_hash_bd_dec_and_lock(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 			 atomic_t *condition)
 {
-	LASSERT(cfs_hash_with_spin_bktlock(hs));
-	return atomic_dec_and_lock(condition, &bd->bd_bucket->hsb_lock.spin);
+	if (cfs_hash_with_spin_bktlock(hs))
+		return atomic_dec_and_lock(condition,
+					   &bd->bd_bucket->hsb_lock.spin);
+
+	LASSERT(cfs_hash_with_rw_bktlock(hs));
+	/* same as atomic_dec_and_lock(), with the write lock of the bucket */
+	if (atomic_add_unless(condition, -1, 1))
+		return 0;
+
+	write_lock(&bd->bd_bucket->hsb_lock.rw);
+	if (atomic_dec_and_test(condition))
+		return 1;
+	write_unlock(&bd->bd_bucket->hsb_lock.rw);
+
+	return 0;
 }
 
 static inline struct hlist_head *
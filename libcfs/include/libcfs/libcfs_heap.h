@@ -54,6 +54,11 @@
  * operations. Since the only consumer for the data structure at this point
  * are NRS policies, and these operate on a per-CPT basis, binary heap instances
  * are tied to a specific CPT.
+ *
+ * With CBH_FLAG_DARY the tree is 4-ary instead of binary: it is half as deep,
+ * and the children of a node are stored next to each other in the same cache
+ * line, so sorting a large heap takes fewer cache misses for a few more
+ * comparisons.
  * @{
  */
 
@@ -80,6 +85,8 @@ struct cfs_binheap_node {
  */
 enum {
 	CBH_FLAG_ATOMIC_GROW	= 1,
+	/** 4-ary instead of binary tree */
+	CBH_FLAG_DARY		= 2,
 };
 
 struct cfs_binheap;
@@ -149,6 +156,10 @@ struct cfs_binheap {
 	unsigned int		cbh_hwm;
 	/** user flags */
 	unsigned int		cbh_flags;
+	/** log2 of # children per node */
+	unsigned int		cbh_dshift;
+	/** # unused pointers before the root, aligns children of a node */
+	unsigned int		cbh_doff;
 	/** operations table */
 	struct cfs_binheap_ops *cbh_ops;
 	/** private data */
@@ -47,6 +47,7 @@
 
 #ifdef HAVE_HLIST_ADD_AFTER
 #define hlist_add_behind(hnode, tail)	hlist_add_after(tail, hnode)
+#define hlist_add_behind_rcu(hnode, tail)	hlist_add_after_rcu(tail, hnode)
 #endif /* HAVE_HLIST_ADD_AFTER */
 
 #endif /* __LIBCFS_LINUX_LIST_H__ */
@@ -243,6 +243,10 @@ MODULE_PARM_DESC(libcfs_console_backoff, "Lustre kernel debug console backoff fa
 
 unsigned int libcfs_debug_binary = 1;
 
+unsigned int libcfs_debug_deferred;
+module_param(libcfs_debug_deferred, uint, 0644);
+MODULE_PARM_DESC(libcfs_debug_deferred, "Store raw arguments of debug messages and format them when the log is dumped");
+
 unsigned int libcfs_stack = 3 * THREAD_SIZE / 4;
 EXPORT_SYMBOL(libcfs_stack);
 
@@ -104,6 +104,7 @@
  */
 #include <linux/seq_file.h>
 #include <linux/log2.h>
+#include <linux/rculist.h>
 
 #include <libcfs/linux/linux-list.h>
 #include <libcfs/libcfs.h>
@@ -233,6 +234,12 @@ cfs_hash_lock_setup(struct cfs_hash *hs)
         }
 }
 
+/*
+ * All hash heads link items with the _rcu list primitives, so that
+ * CFS_HASH_RCU lookups can walk the chains without any lock. They cost
+ * nothing more than write barriers for the other hashes.
+ */
+
 /**
  * Simple hash head without depth tracking
  * new element is always added to head of hlist
@@ -260,7 +267,7 @@ static int
 cfs_hash_hh_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_add_head(hnode, cfs_hash_hh_hhead(hs, bd));
+	hlist_add_head_rcu(hnode, cfs_hash_hh_hhead(hs, bd));
 	return -1; /* unknown depth */
 }
 
@@ -268,7 +275,7 @@ static int
 cfs_hash_hh_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_del_init(hnode);
+	hlist_del_init_rcu(hnode);
 	return -1; /* unknown depth */
 }
 
@@ -304,7 +311,7 @@ cfs_hash_hd_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_add_head(hnode, &hh->hd_head);
+	hlist_add_head_rcu(hnode, &hh->hd_head);
 	return ++hh->hd_depth;
 }
 
@@ -316,7 +323,7 @@ cfs_hash_hd_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_del_init(hnode);
+	hlist_del_init_rcu(hnode);
 	return --hh->hd_depth;
 }
 
@@ -353,9 +360,9 @@ cfs_hash_dh_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	dh = container_of(cfs_hash_dh_hhead(hs, bd),
 			  struct cfs_hash_dhead, dh_head);
 	if (dh->dh_tail != NULL) /* not empty */
-		hlist_add_behind(hnode, dh->dh_tail);
+		hlist_add_behind_rcu(hnode, dh->dh_tail);
 	else /* empty list */
-		hlist_add_head(hnode, &dh->dh_head);
+		hlist_add_head_rcu(hnode, &dh->dh_head);
 	dh->dh_tail = hnode;
 	return -1; /* unknown depth */
 }
@@ -372,7 +379,7 @@ cfs_hash_dh_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		dh->dh_tail = (hnd->pprev == &dh->dh_head.first) ? NULL :
 			      container_of(hnd->pprev, struct hlist_node, next);
 	}
-	hlist_del_init(hnd);
+	hlist_del_init_rcu(hnd);
 	return -1; /* unknown depth */
 }
 
@@ -410,9 +417,9 @@ cfs_hash_dd_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 	dh = container_of(cfs_hash_dd_hhead(hs, bd),
 			  struct cfs_hash_dhead_dep, dd_head);
 	if (dh->dd_tail != NULL) /* not empty */
-		hlist_add_behind(hnode, dh->dd_tail);
+		hlist_add_behind_rcu(hnode, dh->dd_tail);
 	else /* empty list */
-		hlist_add_head(hnode, &dh->dd_head);
+		hlist_add_head_rcu(hnode, &dh->dd_head);
 	dh->dd_tail = hnode;
 	return ++dh->dd_depth;
 }
@@ -429,7 +436,7 @@ cfs_hash_dd_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		dh->dd_tail = (hnd->pprev == &dh->dd_head.first) ? NULL :
 			      container_of(hnd->pprev, struct hlist_node, next);
 	}
-	hlist_del_init(hnd);
+	hlist_del_init_rcu(hnd);
 	return --dh->dd_depth;
 }
 
@@ -913,6 +920,7 @@ cfs_hash_buckets_realloc(struct cfs_hash *hs, struct cfs_hash_bucket **old_bkts,
 		new_bkts[i]->hsb_index   = i;
 		new_bkts[i]->hsb_version = 1;  /* shouldn't be zero */
 		new_bkts[i]->hsb_depmax  = -1; /* unknown */
+		seqcount_init(&new_bkts[i]->hsb_seq);
 		bd.bd_bucket = new_bkts[i];
 		cfs_hash_bd_for_each_hlist(hs, &bd, hhead)
 			INIT_HLIST_HEAD(hhead);
@@ -1017,6 +1025,9 @@ cfs_hash_create(char *name, unsigned cur_bits, unsigned max_bits,
 
         if ((flags & CFS_HASH_REHASH) != 0)
                 flags |= CFS_HASH_COUNTER; /* must have counter */
+	/* lookups wait for no lock, neither should changes */
+	if ((flags & CFS_HASH_RCU) != 0)
+		flags |= CFS_HASH_NBLK_CHANGE;
 
         LASSERT(cur_bits > 0);
         LASSERT(cur_bits >= bkt_bits);
@@ -1026,6 +1037,9 @@ cfs_hash_create(char *name, unsigned cur_bits, unsigned max_bits,
                      (flags & CFS_HASH_NO_LOCK) == 0));
         LASSERT(ergo((flags & CFS_HASH_REHASH_KEY) != 0,
                       ops->hs_keycpy != NULL));
+	LASSERT(ergo((flags & CFS_HASH_RCU) != 0,
+		     (flags & (CFS_HASH_NO_LOCK | CFS_HASH_NO_BKTLOCK)) == 0 &&
+		     ops->hs_get_rcu != NULL));
 
         len = (flags & CFS_HASH_BIGNAME) == 0 ?
               CFS_HASH_NAME_LEN : CFS_HASH_BIGNAME_LEN;
@@ -1038,6 +1052,7 @@ cfs_hash_create(char *name, unsigned cur_bits, unsigned max_bits,
 
 	atomic_set(&hs->hs_refcount, 1);
 	atomic_set(&hs->hs_count, 0);
+	seqcount_init(&hs->hs_seq);
 
 	cfs_hash_lock_setup(hs);
 	cfs_hash_hlist_setup(hs);
@@ -1328,13 +1343,76 @@ cfs_hash_del_key(struct cfs_hash *hs, const void *key)
 }
 EXPORT_SYMBOL(cfs_hash_del_key);
 
+/*
+ * Lockless lookup for CFS_HASH_RCU.  The key is searched in the current
+ * bucket table and then in the one being rehashed to, which is the order
+ * items are moved in.  A miss is only trusted if neither the geometry
+ * (hs_seq) nor any searched bucket (hsb_seq) changed meanwhile, because a
+ * moved item drags a concurrent walker from its old chain into another.
+ */
+static struct hlist_node *
+cfs_hash_rcu_lookup(struct cfs_hash *hs, const void *key)
+{
+	struct cfs_hash_bucket **bkts[2];
+	struct cfs_hash_bd	 bds[2];
+	struct hlist_node	*hnode;
+	unsigned int		 bits[2];
+	unsigned int		 bseq[2];
+	unsigned int		 seq;
+	unsigned int		 index;
+	int			 n;
+	int			 i;
+
+	rcu_read_lock();
+again:
+	seq = read_seqcount_begin(&hs->hs_seq);
+	bkts[0] = rcu_dereference(hs->hs_buckets);
+	bits[0] = hs->hs_cur_bits;
+	bkts[1] = rcu_dereference(hs->hs_rehash_buckets);
+	bits[1] = hs->hs_rehash_bits;
+	/* don't index a table with the bits of another one */
+	if (read_seqcount_retry(&hs->hs_seq, seq))
+		goto again;
+
+	n = bkts[1] != NULL ? 2 : 1;
+	for (i = 0; i < n; i++) {
+		index = cfs_hash_id(hs, key, (1U << bits[i]) - 1);
+		bds[i].bd_bucket = bkts[i][index &
+				   ((1U << (bits[i] - hs->hs_bkt_bits)) - 1)];
+		bds[i].bd_offset = index >> (bits[i] - hs->hs_bkt_bits);
+		bseq[i] = read_seqcount_begin(&bds[i].bd_bucket->hsb_seq);
+
+		for (hnode = rcu_dereference(
+				hlist_first_rcu(cfs_hash_bd_hhead(hs, &bds[i])));
+		     hnode != NULL;
+		     hnode = rcu_dereference(hlist_next_rcu(hnode))) {
+			/* hs_get_rcu fails on an item which is going away */
+			if (cfs_hash_keycmp(hs, key, hnode) &&
+			    hs->hs_ops->hs_get_rcu(hs, hnode))
+				goto out;
+		}
+	}
+
+	if (read_seqcount_retry(&hs->hs_seq, seq))
+		goto again;
+	for (i = 0; i < n; i++) {
+		if (read_seqcount_retry(&bds[i].bd_bucket->hsb_seq, bseq[i]))
+			goto again;
+	}
+out:
+	rcu_read_unlock();
+	return hnode;
+}
+
 /**
  * Lookup an item using @key in the libcfs hash @hs and return it.
  * If the @key is found in the hash hs->hs_get() is called and the
  * matching objects is returned.  It is the callers responsibility
  * to call the counterpart ops->hs_put using the cfs_hash_put() macro
  * when when finished with the object.  If the @key was not found
- * in the hash @hs NULL is returned.
+ * in the hash @hs NULL is returned.  For CFS_HASH_RCU neither the hash
+ * lock nor any bucket lock is taken, and ops->hs_get_rcu() is called
+ * instead of ops->hs_get().
  */
 void *
 cfs_hash_lookup(struct cfs_hash *hs, const void *key)
@@ -1343,6 +1421,11 @@ cfs_hash_lookup(struct cfs_hash *hs, const void *key)
 	struct hlist_node     *hnode;
 	struct cfs_hash_bd         bds[2];
 
+	if (cfs_hash_with_rcu(hs)) {
+		hnode = cfs_hash_rcu_lookup(hs, key);
+		return hnode != NULL ? cfs_hash_object(hs, hnode) : NULL;
+	}
+
         cfs_hash_lock(hs, 0);
         cfs_hash_dual_bd_get_and_lock(hs, key, bds, 0);
 
@@ -1884,6 +1967,104 @@ cfs_hash_rehash_bd(struct cfs_hash *hs, struct cfs_hash_bd *old)
 	return c;
 }
 
+static int
+cfs_hash_bd_trylock_excl(struct cfs_hash *hs, struct cfs_hash_bd *bd)
+{
+	if (cfs_hash_with_rw_bktlock(hs))
+		return write_trylock(&bd->bd_bucket->hsb_lock.rw);
+	return spin_trylock(&bd->bd_bucket->hsb_lock.spin);
+}
+
+/*
+ * CFS_HASH_RCU version of cfs_hash_rehash_bd(): only the bucket locks are
+ * held, so adders and deleters keep going while items are moved.  Bucket
+ * locks are taken in order of hsb_index, an item going to a bucket with a
+ * lower index is only moved if that lock can be taken without waiting,
+ * otherwise the bucket is scanned again.
+ */
+static int
+cfs_hash_rehash_bd_rcu(struct cfs_hash *hs, struct cfs_hash_bd *old)
+{
+	struct cfs_hash_bucket *obkt = old->bd_bucket;
+	struct cfs_hash_bd	new;
+	struct hlist_head	*hhead;
+	struct hlist_node	*hnode;
+	struct hlist_node	*pos;
+	bool			busy;
+	int			c = 0;
+
+	do {
+		busy = false;
+		cfs_hash_bd_lock(hs, old, 1);
+		write_seqcount_begin(&obkt->hsb_seq);
+		cfs_hash_bd_for_each_hlist(hs, old, hhead) {
+			hlist_for_each_safe(hnode, pos, hhead) {
+				cfs_hash_bucket_validate(hs, old, hnode);
+				cfs_hash_bd_from_key(hs, hs->hs_rehash_buckets,
+						     hs->hs_rehash_bits,
+						     cfs_hash_key(hs, hnode),
+						     &new);
+				c++;
+				if (new.bd_bucket == obkt) {
+					cfs_hash_bd_move_locked(hs, old, &new,
+								hnode);
+					continue;
+				}
+
+				if (new.bd_bucket->hsb_index >
+				    obkt->hsb_index) {
+					cfs_hash_bd_lock(hs, &new, 1);
+				} else if (!cfs_hash_bd_trylock_excl(hs,
+								     &new)) {
+					busy = true;
+					continue;
+				}
+				cfs_hash_bd_move_locked(hs, old, &new, hnode);
+				cfs_hash_bd_unlock(hs, &new, 1);
+			}
+		}
+		write_seqcount_end(&obkt->hsb_seq);
+		cfs_hash_bd_unlock(hs, old, 1);
+		if (busy)
+			cond_resched();
+	} while (busy);
+
+	return c;
+}
+
+/*
+ * Move all items to the new bucket table for CFS_HASH_RCU.  Called and
+ * returns with cfs_hash_lock(hs, 1) held, but drops it while moving since
+ * nobody else can change the bucket tables.
+ */
+static int
+cfs_hash_rehash_rcu(struct cfs_hash *hs)
+{
+	struct cfs_hash_bd	bd;
+	int			count = 0;
+	int			rc = 0;
+	int			i;
+
+	cfs_hash_unlock(hs, 1);
+	cfs_hash_for_each_bucket(hs, &bd, i) {
+		if (cfs_hash_is_exiting(hs)) {
+			rc = -ESRCH;
+			break;
+		}
+
+		count += cfs_hash_rehash_bd_rcu(hs, &bd);
+		if (count < CFS_HASH_LOOP_HOG ||
+		    cfs_hash_is_iterating(hs)) /* need to finish ASAP */
+			continue;
+
+		count = 0;
+		cond_resched();
+	}
+	cfs_hash_lock(hs, 1);
+
+	return rc;
+}
+
 static int
 cfs_hash_rehash_worker(struct cfs_workitem *wi)
 {
@@ -1897,6 +2078,7 @@ cfs_hash_rehash_worker(struct cfs_workitem *wi)
 	int			count = 0;
 	int			rc = 0;
 	int			i;
+	bool			rcu;
 
 	LASSERT(hs != NULL && cfs_hash_with_rehash(hs));
 
@@ -1935,50 +2117,66 @@ cfs_hash_rehash_worker(struct cfs_workitem *wi)
         }
 
         LASSERT(hs->hs_rehash_buckets == NULL);
-        hs->hs_rehash_buckets = bkts;
+	write_seqcount_begin(&hs->hs_seq);
+	rcu_assign_pointer(hs->hs_rehash_buckets, bkts);
+	write_seqcount_end(&hs->hs_seq);
 
         rc = 0;
-        cfs_hash_for_each_bucket(hs, &bd, i) {
-                if (cfs_hash_is_exiting(hs)) {
-                        rc = -ESRCH;
-                        /* someone wants to destroy the hash, abort now */
-                        if (old_size < new_size) /* OK to free old bkt-table */
-                                break;
-                        /* it's shrinking, need free new bkt-table */
-                        hs->hs_rehash_buckets = NULL;
-                        old_size = new_size;
-                        new_size = CFS_HASH_NBKT(hs);
-                        goto out;
-                }
+	if (cfs_hash_with_rcu(hs)) {
+		rc = cfs_hash_rehash_rcu(hs);
+	} else {
+		cfs_hash_for_each_bucket(hs, &bd, i) {
+			if (cfs_hash_is_exiting(hs)) {
+				rc = -ESRCH;
+				break;
+			}
 
-                count += cfs_hash_rehash_bd(hs, &bd);
-                if (count < CFS_HASH_LOOP_HOG ||
-                    cfs_hash_is_iterating(hs)) { /* need to finish ASAP */
-                        continue;
-                }
+			count += cfs_hash_rehash_bd(hs, &bd);
+			if (count < CFS_HASH_LOOP_HOG ||
+			    cfs_hash_is_iterating(hs)) /* need to finish ASAP */
+				continue;
 
-		count = 0;
-		cfs_hash_unlock(hs, 1);
-		cond_resched();
-		cfs_hash_lock(hs, 1);
+			count = 0;
+			cfs_hash_unlock(hs, 1);
+			cond_resched();
+			cfs_hash_lock(hs, 1);
+		}
 	}
 
+	/* someone wants to destroy the hash, abort now */
+	if (rc == -ESRCH && old_size > new_size) {
+		/* it's shrinking, need free new bkt-table */
+		write_seqcount_begin(&hs->hs_seq);
+		hs->hs_rehash_buckets = NULL;
+		write_seqcount_end(&hs->hs_seq);
+		old_size = new_size;
+		new_size = CFS_HASH_NBKT(hs);
+		goto out;
+	}
+	/* growing or done, OK to free old bkt-table */
+
         hs->hs_rehash_count++;
 
         bkts = hs->hs_buckets;
-        hs->hs_buckets = hs->hs_rehash_buckets;
-        hs->hs_rehash_buckets = NULL;
-
-        hs->hs_cur_bits = hs->hs_rehash_bits;
+	write_seqcount_begin(&hs->hs_seq);
+	rcu_assign_pointer(hs->hs_buckets, hs->hs_rehash_buckets);
+	hs->hs_rehash_buckets = NULL;
+	hs->hs_cur_bits = hs->hs_rehash_bits;
+	write_seqcount_end(&hs->hs_seq);
  out:
         hs->hs_rehash_bits = 0;
 	if (rc == -ESRCH) /* never be scheduled again */
 		cfs_wi_exit(cfs_sched_rehash, wi);
         bsize = cfs_hash_bkt_size(hs);
+	rcu = cfs_hash_with_rcu(hs);
         cfs_hash_unlock(hs, 1);
         /* can't refer to @hs anymore because it could be destroyed */
-        if (bkts != NULL)
+	if (bkts != NULL) {
+		/* lockless lookups may still be walking the old table */
+		if (rcu)
+			synchronize_rcu();
                 cfs_hash_buckets_free(bkts, bsize, new_size, old_size);
+	}
         if (rc != 0)
 		CDEBUG(D_INFO, "early quit of rehashing: %d\n", rc);
 	/* return 1 only if cfs_wi_exit is called */
@@ -2001,6 +2199,7 @@ void cfs_hash_rehash_key(struct cfs_hash *hs, const void *old_key,
 	struct cfs_hash_bd        bds[3];
 	struct cfs_hash_bd        old_bds[2];
 	struct cfs_hash_bd        new_bd;
+	unsigned int		  i;
 
 	LASSERT(!hlist_unhashed(hnode));
 
@@ -2018,6 +2217,15 @@ void cfs_hash_rehash_key(struct cfs_hash *hs, const void *old_key,
         cfs_hash_bd_order(&bds[0], &bds[1]);
 
         cfs_hash_multi_bd_lock(hs, bds, 3, 1);
+	/* make lockless lookups walking the old chain retry */
+	if (cfs_hash_with_rcu(hs)) {
+		cfs_hash_for_each_bd(old_bds, 2, i) {
+			/* both old bds can be in one bucket */
+			if (i == 0 ||
+			    old_bds[i].bd_bucket != old_bds[0].bd_bucket)
+				write_seqcount_begin(&old_bds[i].bd_bucket->hsb_seq);
+		}
+	}
         if (likely(old_bds[1].bd_bucket == NULL)) {
                 cfs_hash_bd_move_locked(hs, &old_bds[0], &new_bd, hnode);
         } else {
@@ -2027,6 +2235,13 @@ void cfs_hash_rehash_key(struct cfs_hash *hs, const void *old_key,
         /* overwrite key inside locks, otherwise may screw up with
          * other operations, i.e: rehash */
         cfs_hash_keycpy(hs, hnode, new_key);
+	if (cfs_hash_with_rcu(hs)) {
+		cfs_hash_for_each_bd(old_bds, 2, i) {
+			if (i == 0 ||
+			    old_bds[i].bd_bucket != old_bds[0].bd_bucket)
+				write_seqcount_end(&old_bds[i].bd_bucket->hsb_seq);
+		}
+	}
 
         cfs_hash_multi_bd_unlock(hs, bds, 3, 1);
         cfs_hash_unlock(hs, 0);
@@ -187,10 +187,12 @@ cfs_binheap_create(struct cfs_binheap_ops *ops, unsigned int flags,
 	h->cbh_hwm	  = 0;
 	h->cbh_private	  = arg;
 	h->cbh_flags	  = flags & (~CBH_FLAG_ATOMIC_GROW);
+	h->cbh_dshift	  = (flags & CBH_FLAG_DARY) ? 2 : 1;
+	h->cbh_doff	  = (1 << h->cbh_dshift) - 1;
 	h->cbh_cptab	  = cptab;
 	h->cbh_cptid	  = cptid;
 
-	while (h->cbh_hwm < count) { /* preallocate */
+	while (h->cbh_hwm < count + h->cbh_doff) { /* preallocate */
 		if (cfs_binheap_grow(h) != 0) {
 			cfs_binheap_destroy(h);
 			return NULL;
@@ -258,6 +260,10 @@ EXPORT_SYMBOL(cfs_binheap_destroy);
  * Obtains a double pointer to a heap element, given its index into the binary
  * tree.
  *
+ * Element \a idx is stored cbh_doff pointers further, so that the children of
+ * a node always start on a multiple of the number of children and never
+ * straddle two chunks of pointers.
+ *
  * \param[in] h	  The binary heap instance
  * \param[in] idx The requested node's index
  *
@@ -266,6 +272,7 @@ EXPORT_SYMBOL(cfs_binheap_destroy);
 static struct cfs_binheap_node **
 cfs_binheap_pointer(struct cfs_binheap *h, unsigned int idx)
 {
+	idx += h->cbh_doff;
 	if (idx < CBH_SIZE)
 		return &(h->cbh_elements1[idx]);
 
@@ -320,7 +327,7 @@ cfs_binheap_bubble(struct cfs_binheap *h, struct cfs_binheap_node *e)
 	LASSERT(*cur_ptr == e);
 
 	while (cur_idx > 0) {
-		parent_idx = (cur_idx - 1) >> 1;
+		parent_idx = (cur_idx - 1) >> h->cbh_dshift;
 
 		parent_ptr = cfs_binheap_pointer(h, parent_idx);
 		LASSERT((*parent_ptr)->chn_index == parent_idx);
@@ -354,12 +361,13 @@ static int
 cfs_binheap_sink(struct cfs_binheap *h, struct cfs_binheap_node *e)
 {
 	unsigned int	     n = h->cbh_nelements;
+	unsigned int	     nchildren = 1 << h->cbh_dshift;
 	unsigned int	     child_idx;
 	struct cfs_binheap_node **child_ptr;
 	struct cfs_binheap_node  *child;
-	unsigned int	     child2_idx;
-	struct cfs_binheap_node **child2_ptr;
-	struct cfs_binheap_node  *child2;
+	struct cfs_binheap_node **first_ptr;
+	unsigned int	     count;
+	unsigned int	     i;
 	unsigned int	     cur_idx;
 	struct cfs_binheap_node **cur_ptr;
 	int		     did_sth = 0;
@@ -369,24 +377,23 @@ cfs_binheap_sink(struct cfs_binheap *h, struct cfs_binheap_node *e)
 	LASSERT(*cur_ptr == e);
 
 	while (cur_idx < n) {
-		child_idx = (cur_idx << 1) + 1;
+		child_idx = (cur_idx << h->cbh_dshift) + 1;
 		if (child_idx >= n)
 			break;
 
-		child_ptr = cfs_binheap_pointer(h, child_idx);
+		/* siblings are adjacent in the same chunk of pointers */
+		first_ptr = cfs_binheap_pointer(h, child_idx);
+		child_ptr = first_ptr;
 		child = *child_ptr;
 
-		child2_idx = child_idx + 1;
-		if (child2_idx < n) {
-			child2_ptr = cfs_binheap_pointer(h, child2_idx);
-			child2 = *child2_ptr;
-
-			if (h->cbh_ops->hop_compare(child2, child)) {
-				child_idx = child2_idx;
-				child_ptr = child2_ptr;
-				child = child2;
+		count = min(n - child_idx, nchildren);
+		for (i = 1; i < count; i++) {
+			if (h->cbh_ops->hop_compare(first_ptr[i], child)) {
+				child_ptr = &first_ptr[i];
+				child = *child_ptr;
 			}
 		}
+		child_idx += child_ptr - first_ptr;
 
 		LASSERT(child->chn_index == child_idx);
 
@@ -422,7 +429,7 @@ cfs_binheap_insert(struct cfs_binheap *h, struct cfs_binheap_node *e)
 	unsigned int	     new_idx = h->cbh_nelements;
 	int		     rc;
 
-	if (new_idx == h->cbh_hwm) {
+	if (new_idx + h->cbh_doff == h->cbh_hwm) {
 		rc = cfs_binheap_grow(h);
 		if (rc != 0)
 			return rc;
@@ -31,6 +31,7 @@
 #define DEBUG_SUBSYSTEM S_LNET
 
 #include <linux/cpu.h>
+#include <linux/pci.h>
 #include <linux/sched.h>
 #include <libcfs/libcfs_cpu.h>
 #include <libcfs/libcfs.h>
@@ -61,6 +62,10 @@ MODULE_PARM_DESC(cpu_npartitions, "# of CPU partitions");
  *
  * i.e: "N", shortcut expression to create CPT from NUMA & CPU topology
  *
+ * i.e: "auto-io", one CPT for each NUMA node with network or storage PCI
+ *       devices, other NUMA nodes join the CPT of the nearest one, so that
+ *       every CPT has local devices to drive
+ *
  * NB: If user specified cpu_pattern, cpu_npartitions will be ignored
  */
 static char *cpu_pattern = "N";
@@ -935,6 +940,126 @@ failed:
 	return ERR_PTR(rc);
 }
 
+static struct cfs_cpt_table *
+cfs_cpt_table_create_pattern(const char *pattern);
+
+#ifdef CONFIG_PCI
+/* NIC, HCA and NVMe/storage controllers which LNet and OSTs use */
+static bool cfs_cpt_io_device(struct pci_dev *pdev)
+{
+	return (pdev->class >> 16) == PCI_BASE_CLASS_NETWORK ||
+	       (pdev->class >> 16) == PCI_BASE_CLASS_STORAGE ||
+	       (pdev->class >> 8) == PCI_CLASS_SERIAL_INFINIBAND;
+}
+
+/* NUMA nodes with CPUs and with I/O devices attached to their root ports */
+static int cfs_cpt_io_nodes(nodemask_t *io_nodes)
+{
+	struct pci_dev *pdev = NULL;
+	int ndev = 0;
+	int node;
+
+	nodes_clear(*io_nodes);
+	for_each_pci_dev(pdev) {
+		if (!cfs_cpt_io_device(pdev))
+			continue;
+
+		node = dev_to_node(&pdev->dev);
+		if (node == NUMA_NO_NODE || !node_online(node) ||
+		    cpumask_empty(cpumask_of_node(node)))
+			continue;
+
+		node_set(node, *io_nodes);
+		ndev++;
+	}
+	return ndev;
+}
+#else /* !CONFIG_PCI */
+static int cfs_cpt_io_nodes(nodemask_t *io_nodes)
+{
+	nodes_clear(*io_nodes);
+	return 0;
+}
+#endif /* CONFIG_PCI */
+
+/*
+ * "auto-io" pattern: one CPT per NUMA node which has I/O devices, CPU-only
+ * nodes are merged into the CPT of the closest such node. Threads bound to
+ * a CPT then always have a local NIC or drive, and the device CPT of LNet
+ * NIs (ni_dev_cpt) and per-CPT service threads line up with the hardware
+ * without a hand written cpu_pattern.
+ */
+static struct cfs_cpt_table *cfs_cpt_table_create_io(void)
+{
+	struct cfs_cpt_table *cptab;
+	nodemask_t *io_nodes;
+	int ndev;
+	int ncpt;
+	int cpt = 0;
+	int node;
+	int best;
+	int rc;
+
+	LIBCFS_ALLOC(io_nodes, sizeof(*io_nodes));
+	if (!io_nodes)
+		return ERR_PTR(-ENOMEM);
+
+	ndev = cfs_cpt_io_nodes(io_nodes);
+	ncpt = nodes_weight(*io_nodes);
+	if (ncpt <= 1) {
+		CDEBUG(D_INFO, "%d I/O devices on %d NUMA nodes, use 'N'\n",
+		       ndev, ncpt);
+		LIBCFS_FREE(io_nodes, sizeof(*io_nodes));
+		return cfs_cpt_table_create_pattern("N");
+	}
+
+	cptab = cfs_cpt_table_alloc(ncpt);
+	if (!cptab) {
+		CERROR("Failed to allocate CPU partition table\n");
+		rc = -ENOMEM;
+		goto failed;
+	}
+
+	for_each_node_mask(node, *io_nodes) {
+		if (!cfs_cpt_set_node(cptab, cpt++, node)) {
+			rc = -EINVAL;
+			goto failed;
+		}
+	}
+
+	for_each_online_node(node) {
+		int io;
+
+		if (node_isset(node, *io_nodes) ||
+		    cpumask_empty(cpumask_of_node(node)))
+			continue;
+
+		best = -1;
+		for_each_node_mask(io, *io_nodes) {
+			if (best < 0 ||
+			    node_distance(node, io) < node_distance(node, best))
+				best = io;
+		}
+
+		if (!cfs_cpt_set_node(cptab, cfs_cpt_of_node(cptab, best),
+				      node)) {
+			rc = -EINVAL;
+			goto failed;
+		}
+	}
+
+	LCONSOLE_INFO("auto-io: %d CPU partitions for %d I/O devices\n",
+		      ncpt, ndev);
+	LIBCFS_FREE(io_nodes, sizeof(*io_nodes));
+	return cptab;
+
+failed:
+	if (cptab)
+		cfs_cpt_table_free(cptab);
+	LIBCFS_FREE(io_nodes, sizeof(*io_nodes));
+	return ERR_PTR(rc);
+}
+
 static struct cfs_cpt_table *cfs_cpt_table_create_pattern(const char *pattern)
 {
 	struct cfs_cpt_table *cptab;
@@ -956,6 +1081,11 @@ static struct cfs_cpt_table *cfs_cpt_table_create_pattern(const char *pattern)
 	}
 
 	str = cfs_trimwhite(pattern_dup);
+	if (strcasecmp(str, "auto-io") == 0) {
+		kfree(pattern_dup);
+		return cfs_cpt_table_create_io();
+	}
+
 	if (*str == 'n' || *str == 'N') {
 		str++; /* skip 'N' char */
 		node = 1; /* NUMA pattern */
@@ -33,6 +33,9 @@
 
 #define DEBUG_SUBSYSTEM S_LNET
 
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
 #include <libcfs/libcfs.h>
 
 struct cfs_var_array {
@@ -233,3 +236,229 @@ void __exit exit_libcfs_vfree_atomic(void)
 	flush_scheduled_work();
 }
 #endif /* HAVE_LIBCFS_VFREE_ATOMIC */
+
+/*
+ * Per-CPU-partition magazines in front of a kmem_cache.
+ *
+ * Hot objects (RPC requests, DLM locks, LNet messages...) are allocated and
+ * freed at very high rates, often on a different CPU than the one which
+ * allocated them.  Each CPU partition keeps a small stack of free objects
+ * which live on its own NUMA node: a freed object goes back to the magazine
+ * of the partition it belongs to and is handed out again to a thread running
+ * there, so the slab allocator (and its cross-node free path) is only used
+ * when a magazine runs empty or full.
+ */
+static unsigned int mag_cache_size = 64;
+module_param(mag_cache_size, uint, 0444);
+MODULE_PARM_DESC(mag_cache_size,
+		 "# of free objects cached per CPU partition, 0 to disable");
+
+struct cfs_mag_depot {
+	spinlock_t		md_lock;
+	unsigned int		md_count;	/* # cached objects */
+	__u64			md_hits;	/* allocs from the magazine */
+	__u64			md_misses;	/* allocs from the slab */
+	__u64			md_frees;	/* frees kept in the magazine */
+	__u64			md_spills;	/* frees back to the slab */
+	__u64			md_remote;	/* frees from another partition */
+	void			*md_objs[0];
+};
+
+struct cfs_mag_cache {
+	struct list_head	mc_list;	/* on cfs_mag_caches */
+	struct kmem_cache	*mc_slab;	/* backing slab */
+	struct cfs_cpt_table	*mc_cptab;	/* cpu partition table */
+	struct cfs_mag_depot	**mc_depots;	/* per-CPT magazines */
+	unsigned int		mc_objsize;	/* object size */
+	unsigned int		mc_size;	/* magazine capacity */
+	char			mc_name[32];
+};
+
+static LIST_HEAD(cfs_mag_caches);
+static DEFINE_MUTEX(cfs_mag_caches_mutex);
+
+/*
+ * create magazines for objects of @objsize bytes from @slab, the caller
+ * still owns @slab and has to destroy it after cfs_mag_cache_destroy()
+ */
+struct cfs_mag_cache *
+cfs_mag_cache_create(const char *name, struct kmem_cache *slab,
+		     struct cfs_cpt_table *cptab, unsigned int objsize)
+{
+	struct cfs_mag_cache	*mc;
+	struct cfs_mag_depot	*md;
+	int			i;
+
+	LIBCFS_ALLOC(mc, sizeof(*mc));
+	if (mc == NULL)
+		return NULL;
+
+	mc->mc_slab	= slab;
+	mc->mc_cptab	= cptab;
+	mc->mc_objsize	= objsize;
+	mc->mc_size	= mag_cache_size;
+	strlcpy(mc->mc_name, name, sizeof(mc->mc_name));
+
+	mc->mc_depots = cfs_percpt_alloc(cptab,
+					 offsetof(struct cfs_mag_depot,
+						  md_objs[mc->mc_size]));
+	if (mc->mc_depots == NULL) {
+		LIBCFS_FREE(mc, sizeof(*mc));
+		return NULL;
+	}
+
+	cfs_percpt_for_each(md, i, mc->mc_depots)
+		spin_lock_init(&md->md_lock);
+
+	mutex_lock(&cfs_mag_caches_mutex);
+	list_add_tail(&mc->mc_list, &cfs_mag_caches);
+	mutex_unlock(&cfs_mag_caches_mutex);
+
+	return mc;
+}
+EXPORT_SYMBOL(cfs_mag_cache_create);
+
+/*
+ * return all cached objects to the slab and free @mc, all objects must
+ * have been freed with cfs_mag_cache_free() already
+ */
+void
+cfs_mag_cache_destroy(struct cfs_mag_cache *mc)
+{
+	struct cfs_mag_depot	*md;
+	int			i;
+
+	if (mc == NULL)
+		return;
+
+	mutex_lock(&cfs_mag_caches_mutex);
+	list_del(&mc->mc_list);
+	mutex_unlock(&cfs_mag_caches_mutex);
+
+	cfs_percpt_for_each(md, i, mc->mc_depots) {
+		while (md->md_count > 0)
+			kmem_cache_free(mc->mc_slab,
+					md->md_objs[--md->md_count]);
+	}
+
+	cfs_percpt_free(mc->mc_depots);
+	LIBCFS_FREE(mc, sizeof(*mc));
+}
+EXPORT_SYMBOL(cfs_mag_cache_destroy);
+
+/*
+ * allocate an object from the magazine of the current CPU partition, or
+ * from the slab on the partition's node if the magazine is empty.
+ * __GFP_ZERO in @flags is honoured in both cases.
+ */
+void *
+cfs_mag_cache_alloc(struct cfs_mag_cache *mc, gfp_t flags)
+{
+	struct cfs_mag_depot	*md;
+	unsigned long		irqflags;
+	void			*obj = NULL;
+	int			cpt;
+
+	cpt = cfs_cpt_current(mc->mc_cptab, 1);
+	if (mc->mc_size == 0)
+		goto slab;
+
+	md = mc->mc_depots[cpt];
+	spin_lock_irqsave(&md->md_lock, irqflags);
+	if (md->md_count > 0) {
+		obj = md->md_objs[--md->md_count];
+		md->md_hits++;
+	} else {
+		md->md_misses++;
+	}
+	spin_unlock_irqrestore(&md->md_lock, irqflags);
+
+	if (obj != NULL) {
+		if (flags & __GFP_ZERO)
+			memset(obj, 0, mc->mc_objsize);
+		return obj;
+	}
+slab:
+	return cfs_mem_cache_cpt_alloc(mc->mc_slab, mc->mc_cptab, cpt, flags);
+}
+EXPORT_SYMBOL(cfs_mag_cache_alloc);
+
+/*
+ * free @obj into the magazine of the CPU partition its memory belongs to,
+ * so it is reused on that node, or to the slab if that magazine is full
+ */
+void
+cfs_mag_cache_free(struct cfs_mag_cache *mc, void *obj)
+{
+	struct cfs_mag_depot	*md;
+	unsigned long		irqflags;
+	int			local;
+	int			cpt;
+
+	if (mc->mc_size == 0) {
+		kmem_cache_free(mc->mc_slab, obj);
+		return;
+	}
+
+	local = cfs_cpt_current(mc->mc_cptab, 1);
+	cpt = cfs_cpt_of_node(mc->mc_cptab, page_to_nid(virt_to_page(obj)));
+	if (cpt < 0 || cpt >= cfs_cpt_number(mc->mc_cptab))
+		cpt = local;
+
+	md = mc->mc_depots[cpt];
+	spin_lock_irqsave(&md->md_lock, irqflags);
+	if (md->md_count < mc->mc_size) {
+		md->md_objs[md->md_count++] = obj;
+		md->md_frees++;
+		if (cpt != local)
+			md->md_remote++;
+		obj = NULL;
+	} else {
+		md->md_spills++;
+	}
+	spin_unlock_irqrestore(&md->md_lock, irqflags);
+
+	if (obj != NULL)
+		kmem_cache_free(mc->mc_slab, obj);
+}
+EXPORT_SYMBOL(cfs_mag_cache_free);
+
+/*
+ * print counters of all magazine caches, one line per CPU partition
+ */
+int
+cfs_mag_cache_seq_show(struct seq_file *m)
+{
+	struct cfs_mag_cache	*mc;
+	struct cfs_mag_depot	*md;
+	unsigned long		irqflags;
+	__u64			cnt[5];
+	unsigned int		count;
+	int			i;
+
+	seq_printf(m, "%-20s %4s %6s %12s %12s %12s %12s %12s\n",
+		   "name", "cpt", "cached", "hits", "misses", "frees",
+		   "spills", "remote");
+
+	mutex_lock(&cfs_mag_caches_mutex);
+	list_for_each_entry(mc, &cfs_mag_caches, mc_list) {
+		cfs_percpt_for_each(md, i, mc->mc_depots) {
+			spin_lock_irqsave(&md->md_lock, irqflags);
+			count  = md->md_count;
+			cnt[0] = md->md_hits;
+			cnt[1] = md->md_misses;
+			cnt[2] = md->md_frees;
+			cnt[3] = md->md_spills;
+			cnt[4] = md->md_remote;
+			spin_unlock_irqrestore(&md->md_lock, irqflags);
+
+			seq_printf(m, "%-20s %4d %6u %12llu %12llu %12llu "
+				   "%12llu %12llu\n", mc->mc_name, i, count,
+				   cnt[0], cnt[1], cnt[2], cnt[3], cnt[4]);
+		}
+	}
+	mutex_unlock(&cfs_mag_caches_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(cfs_mag_cache_seq_show);
@@ -43,7 +43,9 @@
 #include <linux/ctype.h>
 #include <linux/fs.h>
 #include <linux/kthread.h>
+#include <linux/module.h>
 #include <linux/pagemap.h>
+#include <linux/string.h>
 #include <linux/uaccess.h>
 #include <libcfs/linux/linux-fs.h>
 #include <libcfs/libcfs.h>
@@ -93,6 +95,7 @@ static struct cfs_trace_page *cfs_tage_alloc(gfp_t gfp)
 	}
 
 	tage->page = page;
+	tage->deferred = 0;
 	atomic_inc(&cfs_tage_allocated);
 	return tage;
 }
@@ -168,6 +171,7 @@ cfs_trace_get_tage_try(struct cfs_trace_cpu_data *tcd, unsigned long len)
 		}
 
 		tage->used = 0;
+		tage->deferred = 0;
 		tage->cpu = smp_processor_id();
 		tage->type = tcd->tcd_type;
 		list_add_tail(&tage->linkage, &tcd->tcd_pages);
@@ -239,11 +243,268 @@ static struct cfs_trace_page *cfs_trace_get_tage(struct cfs_trace_cpu_data *tcd,
         if (tcd->tcd_cur_pages > 0) {
                 tage = cfs_tage_from_list(tcd->tcd_pages.next);
                 tage->used = 0;
+		tage->deferred = 0;
                 cfs_tage_to_tail(tage, &tcd->tcd_pages);
         }
         return tage;
 }
 
+#ifdef CONFIG_BINARY_PRINTF
+/*
+ * A deferred record is the header, the file and function names, the
+ * format pointer, then the arguments packed by vbin_printf() at the next
+ * 4 byte boundary. Only the copying of arguments is paid when the message
+ * is logged, vsnprintf() is only run for the records which are dumped.
+ */
+static int cfs_trace_store_deferred(struct cfs_trace_cpu_data *tcd,
+				    struct ptldebug_header *header,
+				    const char *file, const char *fn,
+				    const char *format, va_list args)
+{
+	struct cfs_trace_page *tage;
+	unsigned int prefix;
+	unsigned int pad;
+	unsigned int room;
+	unsigned int words = 16; /* enough for most messages */
+	char *debug_buf;
+	va_list ap;
+	int i;
+
+	prefix = sizeof(*header) + strlen(file) + 1 + strlen(fn) + 1 +
+		 sizeof(format);
+
+	for (i = 0; i < 2; i++) {
+		if (prefix + sizeof(u32) - 1 + words * sizeof(u32) > PAGE_SIZE)
+			return -E2BIG;
+
+		tage = cfs_trace_get_tage(tcd, prefix + sizeof(u32) - 1 +
+					  words * sizeof(u32));
+		if (tage == NULL)
+			return -ENOMEM;
+
+		/* page_address() is page aligned */
+		pad = -(tage->used + prefix) & (sizeof(u32) - 1);
+		room = (PAGE_SIZE - tage->used - prefix - pad) / sizeof(u32);
+		debug_buf = (char *)page_address(tage->page) + tage->used;
+
+		va_copy(ap, args);
+		words = vbin_printf((u32 *)(debug_buf + prefix + pad), room,
+				    format, ap);
+		va_end(ap);
+		if (words <= room)
+			break;
+	}
+	if (i == 2)
+		return -E2BIG;
+
+	header->ph_flags |= PH_FLAG_DEFERRED;
+	header->ph_len = prefix + pad + words * sizeof(u32);
+
+	memcpy(debug_buf, header, sizeof(*header));
+	debug_buf += sizeof(*header);
+	strcpy(debug_buf, file);
+	debug_buf += strlen(file) + 1;
+	strcpy(debug_buf, fn);
+	debug_buf += strlen(fn) + 1;
+	memcpy(debug_buf, &format, sizeof(format));
+
+	tage->used += header->ph_len;
+	tage->deferred = 1;
+	__LASSERT(tage->used <= PAGE_SIZE);
+
+	return 0;
+}
+
+/* @p points right after the function name of a deferred record */
+static void cfs_trace_deferred_args(char *p, const char **format, u32 **args)
+{
+	memcpy(format, p, sizeof(*format));
+	*args = (u32 *)PTR_ALIGN(p + sizeof(*format), sizeof(u32));
+}
+
+static int cfs_trace_format_deferred(const char *format, const u32 *args,
+				     char *buf, int size)
+{
+	/* strings of a module which is gone, see cfs_trace_module_notify() */
+	if (!is_module_address((unsigned long)format))
+		return snprintf(buf, size, "<format %p is gone>\n", format);
+
+	return bstr_printf(buf, size, format, args);
+}
+
+static struct cfs_trace_page *
+cfs_trace_format_tage(struct cfs_trace_page *src, gfp_t gfp)
+{
+	struct cfs_trace_page *tage;
+
+	tage = cfs_tage_alloc(gfp);
+	if (tage == NULL)
+		return NULL;
+
+	tage->used = 0;
+	tage->cpu = src->cpu;
+	tage->type = src->type;
+	list_add_tail(&tage->linkage, &src->linkage);
+	return tage;
+}
+
+/*
+ * Replace the pages of @pages holding deferred records with pages of text
+ * records, preserving the order of the records and the owner of the pages.
+ * Returns the number of pages on @pages.
+ */
+static int cfs_trace_format_pages(struct list_head *pages, gfp_t gfp)
+{
+	struct cfs_trace_page *tage;
+	struct cfs_trace_page *tmp;
+	struct cfs_trace_page *out;
+	struct ptldebug_header *hdr;
+	const char *format;
+	u32 *args;
+	char *p;
+	char *end;
+	char *buf;
+	int prefix;
+	int room;
+	int len = 0;
+	int count = 0;
+	int i;
+
+	list_for_each_entry_safe(tage, tmp, pages, linkage) {
+		__LASSERT_TAGE_INVARIANT(tage);
+
+		if (!tage->deferred) {
+			count++;
+			continue;
+		}
+
+		out = NULL;
+		p = page_address(tage->page);
+		end = p + tage->used;
+		while (p < end) {
+			hdr = (void *)p;
+			buf = p + sizeof(*hdr);
+			buf += strlen(buf) + 1;
+			buf += strlen(buf) + 1;
+			prefix = buf - p;
+			p += hdr->ph_len;
+
+			for (i = 0; i < 2; i++) {
+				if (out == NULL || i == 1) {
+					out = cfs_trace_format_tage(tage, gfp);
+					if (out == NULL)
+						goto lost;
+					count++;
+				}
+
+				room = PAGE_SIZE - out->used - prefix;
+				if (room <= 0)
+					continue;
+
+				if (hdr->ph_flags & PH_FLAG_DEFERRED) {
+					cfs_trace_deferred_args(buf, &format,
+								&args);
+					len = cfs_trace_format_deferred(format,
+						args, (char *)page_address(
+						out->page) + out->used + prefix,
+						room);
+					/* no room for the trailing NUL */
+					if (len < room)
+						break;
+					len = room - 1;
+				} else {
+					len = hdr->ph_len - prefix;
+					if (len <= room) {
+						memcpy((char *)page_address(
+						       out->page) + out->used +
+						       prefix, buf, len);
+						break;
+					}
+				}
+			}
+			/* the text of one record doesn't fit in a page */
+			if (i == 2 && !(hdr->ph_flags & PH_FLAG_DEFERRED))
+				continue;
+
+			memcpy((char *)page_address(out->page) + out->used,
+			       hdr, prefix);
+			hdr = (void *)((char *)page_address(out->page) +
+				       out->used);
+			hdr->ph_len = prefix + len;
+			hdr->ph_flags &= ~PH_FLAG_DEFERRED;
+			out->used += hdr->ph_len;
+		}
+		goto free;
+lost:
+		if (printk_ratelimit())
+			printk(KERN_WARNING "cannot allocate a tage to format "
+			       "debug records, dropping them\n");
+free:
+		list_del(&tage->linkage);
+		cfs_tage_free(tage);
+	}
+	return count;
+}
+
+/*
+ * Format the deferred records of all CPUs before a module, which owns the
+ * format strings of some of them, is unloaded.
+ */
+static void cfs_trace_format_all(void)
+{
+	struct cfs_trace_cpu_data *tcd;
+	struct list_head pages;
+	struct list_head daemon_pages;
+	int cpu;
+	int i;
+	int n;
+	int nd;
+
+	for_each_possible_cpu(cpu) {
+		for (i = 0; cfs_trace_data[i] != NULL; i++) {
+			tcd = &(*cfs_trace_data[i])[cpu].tcd;
+			INIT_LIST_HEAD(&pages);
+			INIT_LIST_HEAD(&daemon_pages);
+
+			cfs_trace_lock_tcd(tcd, 1);
+			list_splice_init(&tcd->tcd_pages, &pages);
+			tcd->tcd_cur_pages = 0;
+			list_splice_init(&tcd->tcd_daemon_pages, &daemon_pages);
+			tcd->tcd_cur_daemon_pages = 0;
+			cfs_trace_unlock_tcd(tcd, 1);
+
+			n = cfs_trace_format_pages(&pages, GFP_KERNEL);
+			nd = cfs_trace_format_pages(&daemon_pages, GFP_KERNEL);
+
+			/* they are older than what was logged meanwhile */
+			cfs_trace_lock_tcd(tcd, 1);
+			list_splice(&pages, &tcd->tcd_pages);
+			tcd->tcd_cur_pages += n;
+			list_splice(&daemon_pages, &tcd->tcd_daemon_pages);
+			tcd->tcd_cur_daemon_pages += nd;
+			cfs_trace_unlock_tcd(tcd, 1);
+		}
+	}
+}
+
+static int cfs_trace_module_notify(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	if (action == MODULE_STATE_GOING)
+		cfs_trace_format_all();
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block cfs_trace_module_nb = {
+	.notifier_call	= cfs_trace_module_notify,
+};
+#else /* !CONFIG_BINARY_PRINTF */
+static inline int cfs_trace_format_pages(struct list_head *pages, gfp_t gfp)
+{
+	return 0;
+}
+#endif /* CONFIG_BINARY_PRINTF */
+
 int libcfs_debug_msg(struct libcfs_debug_msg_data *msgdata,
                      const char *format, ...)
 {
@@ -300,6 +561,22 @@ int libcfs_debug_vmsg2(struct libcfs_debug_msg_data *msgdata,
                 goto console;
         }
 
+#ifdef CONFIG_BINARY_PRINTF
+	/*
+	 * Nothing goes to the console, so formatting can wait until the log
+	 * is dumped. Not for %p, its extensions dereference the argument.
+	 */
+	if (libcfs_debug_deferred && libcfs_debug_binary &&
+	    (mask & libcfs_printk) == 0 && format1 != NULL &&
+	    format2 == NULL && msgdata->msg_fn != NULL &&
+	    strstr(format1, "%p") == NULL &&
+	    cfs_trace_store_deferred(tcd, &header, file, msgdata->msg_fn,
+				     format1, args) == 0) {
+		cfs_trace_put_tcd(tcd);
+		return 1;
+	}
+#endif
+
 	known_size = strlen(file) + 1;
         if (msgdata->msg_fn)
                 known_size += strlen(msgdata->msg_fn) + 1;
@@ -649,6 +926,25 @@ void cfs_trace_debug_print(void)
                         p += strlen(fn) + 1;
                         len = hdr->ph_len - (int)(p - (char *)hdr);
 
+#ifdef CONFIG_BINARY_PRINTF
+			if (hdr->ph_flags & PH_FLAG_DEFERRED) {
+				const char *format;
+				char *buf;
+				u32 *args;
+				int n;
+
+				cfs_trace_deferred_args(p, &format, &args);
+				buf = cfs_trace_get_console_buffer();
+				n = cfs_trace_format_deferred(format, args, buf,
+						CFS_TRACE_CONSOLE_BUFFER_SIZE);
+				cfs_print_to_console(hdr, D_EMERG, buf,
+					min(n, CFS_TRACE_CONSOLE_BUFFER_SIZE - 1),
+					file, fn);
+				put_cpu();
+				p += len;
+				continue;
+			}
+#endif
                         cfs_print_to_console(hdr, D_EMERG, p, len, file, fn);
 
                         p += len;
@@ -681,6 +977,8 @@ int cfs_tracefile_dump_all_pages(char *filename)
 
         pc.pc_want_daemon_pages = 1;
         collect_pages(&pc);
+	cfs_trace_format_pages(&pc.pc_pages, libcfs_panic_in_progress ?
+			       GFP_ATOMIC : GFP_NOFS);
 	if (list_empty(&pc.pc_pages)) {
                 rc = 0;
                 goto close;
@@ -953,6 +1251,8 @@ static int tracefiled(void *arg)
 
                 pc.pc_want_daemon_pages = 0;
                 collect_pages(&pc);
+		/* the daemon list is kept formatted too */
+		cfs_trace_format_pages(&pc.pc_pages, GFP_NOFS);
 		if (list_empty(&pc.pc_pages))
                         goto end_loop;
 
@@ -1109,6 +1409,9 @@ int cfs_tracefile_init(int max_pages)
 		LASSERT(tcd->tcd_max_pages > 0);
 		tcd->tcd_shutting_down = 0;
 	}
+#ifdef CONFIG_BINARY_PRINTF
+	register_module_notifier(&cfs_trace_module_nb);
+#endif
 	return 0;
 }
 
@@ -1147,6 +1450,9 @@ static void cfs_trace_cleanup(void)
 
 void cfs_tracefile_exit(void)
 {
+#ifdef CONFIG_BINARY_PRINTF
+	unregister_module_notifier(&cfs_trace_module_nb);
+#endif
         cfs_trace_stop_thread();
         cfs_trace_cleanup();
 }
@@ -247,8 +247,19 @@ struct cfs_trace_page {
 	 * type(context) of this page
 	 */
 	unsigned short		type;
+	/*
+	 * page holds records with PH_FLAG_DEFERRED
+	 */
+	unsigned short		deferred;
 };
 
+/*
+ * Record holds the format pointer and the vbin_printf() arguments of the
+ * message instead of its text. Such records only live in trace pages and
+ * are formatted before the pages leave the kernel.
+ */
+#define PH_FLAG_DEFERRED	0x80000000
+
 extern void cfs_set_ptldebug_header(struct ptldebug_header *header,
                                     struct libcfs_debug_msg_data *m,
                                     unsigned long stack);
@@ -1220,7 +1220,7 @@ static int cfs_num_min_max(struct list_head *nidlist, __u32 *min_nid,
 	struct addrrange *ar;
 	unsigned int tmp_min_addr = 0;
 	unsigned int tmp_max_addr = 0;
-	unsigned int min_addr = 0;
+	unsigned int min_addr = 0xffffffff;
 	unsigned int max_addr = 0;
 	int nidlist_count = 0;
 	int rc;
@@ -1229,17 +1229,25 @@ static int cfs_num_min_max(struct list_head *nidlist, __u32 *min_nid,
 		if (nidlist_count > 0)
 			return -EINVAL;
 
+		if (nr->nr_all) {
+			min_addr = 0;
+			max_addr = 0xffffffff;
+			break;
+		}
+
 		list_for_each_entry(ar, &nr->nr_addrranges, ar_link) {
 			rc = cfs_num_ar_min_max(ar, &tmp_min_addr,
 						&tmp_max_addr);
 			if (rc < 0)
 				return rc;
 
-			if (tmp_min_addr < min_addr || min_addr == 0)
+			if (tmp_min_addr < min_addr)
 				min_addr = tmp_min_addr;
 			if (tmp_max_addr > max_addr)
-				max_addr = tmp_min_addr;
+				max_addr = tmp_max_addr;
 		}
+
+		nidlist_count++;
 	}
 	if (max_nid != NULL)
 		*max_nid = max_addr;
@@ -1266,7 +1274,7 @@ static int cfs_ip_min_max(struct list_head *nidlist, __u32 *min_nid,
 	struct addrrange *ar;
 	__u32 tmp_min_ip_addr = 0;
 	__u32 tmp_max_ip_addr = 0;
-	__u32 min_ip_addr = 0;
+	__u32 min_ip_addr = 0xffffffff;
 	__u32 max_ip_addr = 0;
 	int nidlist_count = 0;
 	int rc;
@@ -1287,7 +1295,7 @@ static int cfs_ip_min_max(struct list_head *nidlist, __u32 *min_nid,
 			if (rc < 0)
 				return rc;
 
-			if (tmp_min_ip_addr < min_ip_addr || min_ip_addr == 0)
+			if (tmp_min_ip_addr < min_ip_addr)
 				min_ip_addr = tmp_min_ip_addr;
 			if (tmp_max_ip_addr > max_ip_addr)
 				max_ip_addr = tmp_max_ip_addr;
@@ -49,6 +49,9 @@ struct lc_watchdog {
 	int			lcw_refcount;	/* must hold lcw_pending_timers_lock */
 	struct timer_list	lcw_timer;	/* kernel timer */
 	struct list_head	lcw_list;	/* chain on pending list */
+	struct list_head	lcw_scan_list;	/* chain on lcw_scan_watchdogs */
+	unsigned long		lcw_deadline;	/* expiry in jiffies if lcw_scan */
+	bool			lcw_scan;	/* checked by lc_watchdogd */
 	ktime_t			lcw_last_touched;/* last touched stamp */
 	struct task_struct     *lcw_task;	/* owner task */
 	void			(*lcw_callback)(pid_t, void *);
@@ -64,6 +67,22 @@ struct lc_watchdog {
 };
 
 #ifdef WITH_WATCHDOG
+/*
+ * Instead of rearming a timer each time a watchdog is touched, only record
+ * its deadline and let the dispatcher check the deadlines of all watchdogs
+ * once per second.  This is cheaper for service threads which touch and
+ * disable their watchdog around each request.  The setting applies to
+ * watchdogs added afterwards.
+ */
+static unsigned int watchdog_scan = 1;
+module_param(watchdog_scan, uint, 0644);
+MODULE_PARM_DESC(watchdog_scan,
+		 "check watchdog deadlines from a periodic scan, not timers");
+
+/* Watchdogs with lcw_scan set, checked by the dispatcher */
+static DEFINE_SPINLOCK(lcw_scan_lock);
+static LIST_HEAD(lcw_scan_watchdogs);
+
 /*
  * The dispatcher will complete lcw_start_completion when it starts,
  * and lcw_stop_completion when it exits.
@@ -118,17 +137,16 @@ lcw_dump(struct lc_watchdog *lcw)
         EXIT;
 }
 
-static void lcw_cb(cfs_timer_cb_arg_t data)
+static void lcw_expire(struct lc_watchdog *lcw)
 {
-	struct lc_watchdog *lcw = cfs_from_timer(lcw, data, lcw_timer);
-        ENTRY;
+	ENTRY;
 
-        if (lcw->lcw_state != LC_WATCHDOG_ENABLED) {
-                EXIT;
-                return;
-        }
+	if (lcw->lcw_state != LC_WATCHDOG_ENABLED) {
+		EXIT;
+		return;
+	}
 
-        lcw->lcw_state = LC_WATCHDOG_EXPIRED;
+	lcw->lcw_state = LC_WATCHDOG_EXPIRED;
 
 	spin_lock_bh(&lcw->lcw_lock);
 	LASSERT(list_empty(&lcw->lcw_list));
@@ -143,6 +161,28 @@ static void lcw_cb(cfs_timer_cb_arg_t data)
 	EXIT;
 }
 
+static void lcw_cb(cfs_timer_cb_arg_t data)
+{
+	struct lc_watchdog *lcw = cfs_from_timer(lcw, data, lcw_timer);
+
+	lcw_expire(lcw);
+}
+
+/* Expire all enabled watchdogs which have not been touched in time. */
+static void lcw_scan(void)
+{
+	struct lc_watchdog *lcw;
+	unsigned long now = jiffies;
+
+	spin_lock(&lcw_scan_lock);
+	list_for_each_entry(lcw, &lcw_scan_watchdogs, lcw_scan_list) {
+		if (lcw->lcw_state == LC_WATCHDOG_ENABLED &&
+		    time_after_eq(now, READ_ONCE(lcw->lcw_deadline)))
+			lcw_expire(lcw);
+	}
+	spin_unlock(&lcw_scan_lock);
+}
+
 static int is_watchdog_fired(void)
 {
 	int rc;
@@ -220,8 +260,9 @@ static int lcw_dispatch_main(void *data)
         while (1) {
                 int dumplog = 1;
 
-		rc = wait_event_interruptible(lcw_event_waitq,
-					      is_watchdog_fired());
+		wait_event_interruptible_timeout(lcw_event_waitq,
+						 is_watchdog_fired(),
+						 cfs_time_seconds(1));
                 CDEBUG(D_INFO, "Watchdog got woken up...\n");
 		if (test_bit(LCW_FLAG_STOP, &lcw_flags)) {
 			CDEBUG(D_INFO, "LCW_FLAG_STOP set, shutting down...\n");
@@ -236,6 +277,8 @@ static int lcw_dispatch_main(void *data)
 			break;
 		}
 
+		lcw_scan();
+
 		spin_lock_bh(&lcw_pending_timers_lock);
 		while (!list_empty(&lcw_pending_timers)) {
 			int is_dumplog;
@@ -363,7 +406,10 @@ struct lc_watchdog *lc_watchdog_add(int timeout,
 	lcw->lcw_data     = data;
 	lcw->lcw_state    = LC_WATCHDOG_DISABLED;
 
+	lcw->lcw_scan     = watchdog_scan != 0;
+
 	INIT_LIST_HEAD(&lcw->lcw_list);
+	INIT_LIST_HEAD(&lcw->lcw_scan_list);
 	cfs_timer_setup(&lcw->lcw_timer, lcw_cb, (unsigned long)lcw, 0);
 
 	mutex_lock(&lcw_refcount_mutex);
@@ -371,11 +417,21 @@ struct lc_watchdog *lc_watchdog_add(int timeout,
 		lcw_dispatch_start();
 	mutex_unlock(&lcw_refcount_mutex);
 
+	if (lcw->lcw_scan) {
+		spin_lock(&lcw_scan_lock);
+		list_add_tail(&lcw->lcw_scan_list, &lcw_scan_watchdogs);
+		spin_unlock(&lcw_scan_lock);
+	}
+
 	/* Keep this working in case we enable them by default */
 	if (lcw->lcw_state == LC_WATCHDOG_ENABLED) {
 		lcw->lcw_last_touched = ktime_get();
-		mod_timer(&lcw->lcw_timer, cfs_time_seconds(timeout) +
-			  jiffies);
+		if (lcw->lcw_scan)
+			lcw->lcw_deadline = jiffies +
+					    cfs_time_seconds(timeout);
+		else
+			mod_timer(&lcw->lcw_timer, cfs_time_seconds(timeout) +
+				  jiffies);
 	}
 
         RETURN(lcw);
@@ -417,6 +473,22 @@ void lc_watchdog_touch(struct lc_watchdog *lcw, int timeout)
 	ENTRY;
 	LASSERT(lcw != NULL);
 
+	if (lcw->lcw_scan) {
+		/* nothing is pending unless the scan expired us */
+		if (lcw->lcw_state == LC_WATCHDOG_EXPIRED)
+			lc_watchdog_del_pending(lcw);
+
+		lcw_update_time(lcw, "resumed");
+
+		WRITE_ONCE(lcw->lcw_deadline,
+			   jiffies + cfs_time_seconds(timeout));
+		/* new deadline must be seen before the state by lcw_scan() */
+		smp_wmb();
+		lcw->lcw_state = LC_WATCHDOG_ENABLED;
+		EXIT;
+		return;
+	}
+
 	lc_watchdog_del_pending(lcw);
 
 	lcw_update_time(lcw, "resumed");
@@ -433,7 +505,8 @@ void lc_watchdog_disable(struct lc_watchdog *lcw)
         ENTRY;
         LASSERT(lcw != NULL);
 
-        lc_watchdog_del_pending(lcw);
+	if (!lcw->lcw_scan || lcw->lcw_state == LC_WATCHDOG_EXPIRED)
+		lc_watchdog_del_pending(lcw);
 
         lcw_update_time(lcw, "completed");
         lcw->lcw_state = LC_WATCHDOG_DISABLED;
@@ -449,7 +522,13 @@ void lc_watchdog_delete(struct lc_watchdog *lcw)
         ENTRY;
         LASSERT(lcw != NULL);
 
-	del_timer(&lcw->lcw_timer);
+	if (lcw->lcw_scan) {
+		spin_lock(&lcw_scan_lock);
+		list_del_init(&lcw->lcw_scan_list);
+		spin_unlock(&lcw_scan_lock);
+	} else {
+		del_timer(&lcw->lcw_timer);
+	}
 
         lcw_update_time(lcw, "stopped");
 
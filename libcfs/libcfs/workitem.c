@@ -37,31 +37,49 @@
 
 #define DEBUG_SUBSYSTEM S_LNET
 
+#include <linux/hash.h>
 #include <linux/kthread.h>
 #include <libcfs/libcfs.h>
 
 #define CFS_WS_NAME_LEN         16
 
-struct cfs_wi_sched {
-	struct list_head		ws_list;	/* chain on global list */
-	/** serialised workitems */
-	spinlock_t			ws_lock;
-	/** where schedulers sleep */
-	wait_queue_head_t		ws_waitq;
+/**
+ * Per-thread queue of a scheduler. A workitem always hashes to the same
+ * queue, whose lock serialises all state changes of the workitem, but it
+ * can be run by any thread of the scheduler: a thread runs its own queue
+ * and steals from the others when it's empty, so a burst hashed to one
+ * queue doesn't wait behind a single thread. Both take the oldest
+ * workitem first to keep the latency bounded.
+ */
+struct cfs_wi_queue {
+	/** serialised workitems of this queue */
+	spinlock_t			wq_lock;
 	/** concurrent workitems */
-	struct list_head		ws_runq;
+	struct list_head		wq_runq;
 	/** rescheduled running-workitems, a workitem can be rescheduled
 	 * while running in wi_action(), but we don't to execute it again
-	 * unless it returns from wi_action(), so we put it on ws_rerunq
+	 * unless it returns from wi_action(), so we put it on wq_rerunq
 	 * while rescheduling, and move it to runq after it returns
 	 * from wi_action() */
-	struct list_head		ws_rerunq;
+	struct list_head		wq_rerunq;
+	/** number of scheduled workitems */
+	int				wq_nscheduled;
+	/** scheduler of this queue */
+	struct cfs_wi_sched		*wq_sched;
+} ____cacheline_aligned;
+
+struct cfs_wi_sched {
+	struct list_head		ws_list;	/* chain on global list */
+	/** where schedulers sleep */
+	wait_queue_head_t		ws_waitq;
+	/** one queue per thread */
+	struct cfs_wi_queue		*ws_queues;
+	/** number of ws_queues */
+	int				ws_nqueues;
 	/** CPT-table for this scheduler */
 	struct cfs_cpt_table	*ws_cptab;
 	/** CPT id for affinity */
 	int			ws_cpt;
-	/** number of scheduled workitems */
-	int			ws_nscheduled;
 	/** started scheduler thread, protected by cfs_wi_data::wi_glock */
 	unsigned int		ws_nthreads:30;
 	/** shutting down, protected by cfs_wi_data::wi_glock */
@@ -83,20 +101,25 @@ static struct cfs_workitem_data {
 	int			wi_stopping;
 } cfs_wi_data;
 
+static inline struct cfs_wi_queue *
+cfs_wi_queue(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
+{
+	return &sched->ws_queues[hash_ptr(wi, 32) % sched->ws_nqueues];
+}
+
 static inline int
 cfs_wi_sched_cansleep(struct cfs_wi_sched *sched)
 {
-	spin_lock(&sched->ws_lock);
-	if (sched->ws_stopping) {
-		spin_unlock(&sched->ws_lock);
-		return 0;
-	}
+	int	i;
 
-	if (!list_empty(&sched->ws_runq)) {
-		spin_unlock(&sched->ws_lock);
+	if (sched->ws_stopping)
 		return 0;
+
+	/* racy, but wait_event checks it again after queueing on ws_waitq */
+	for (i = 0; i < sched->ws_nqueues; i++) {
+		if (!list_empty(&sched->ws_queues[i].wq_runq))
+			return 0;
 	}
-	spin_unlock(&sched->ws_lock);
 	return 1;
 }
 
@@ -107,10 +130,12 @@ cfs_wi_sched_cansleep(struct cfs_wi_sched *sched)
 void
 cfs_wi_exit(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 {
+	struct cfs_wi_queue *wq = cfs_wi_queue(sched, wi);
+
 	LASSERT(!in_interrupt()); /* because we use plain spinlock */
 	LASSERT(!sched->ws_stopping);
 
-	spin_lock(&sched->ws_lock);
+	spin_lock(&wq->wq_lock);
 
 	LASSERT(wi->wi_running);
 
@@ -118,14 +143,14 @@ cfs_wi_exit(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 		LASSERT(!list_empty(&wi->wi_list));
 		list_del_init(&wi->wi_list);
 
-		LASSERT(sched->ws_nscheduled > 0);
-		sched->ws_nscheduled--;
+		LASSERT(wq->wq_nscheduled > 0);
+		wq->wq_nscheduled--;
 	}
 
 	LASSERT(list_empty(&wi->wi_list));
 
 	wi->wi_scheduled = 1; /* LBUG future schedule attempts */
-	spin_unlock(&sched->ws_lock);
+	spin_unlock(&wq->wq_lock);
 
 	return;
 }
@@ -137,6 +162,7 @@ EXPORT_SYMBOL(cfs_wi_exit);
 int
 cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 {
+	struct cfs_wi_queue *wq = cfs_wi_queue(sched, wi);
 	int	rc;
 
 	LASSERT(!in_interrupt()); /* because we use plain spinlock */
@@ -147,7 +173,7 @@ cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
          * means the workitem will not be scheduled and will not have
          * any race with wi_action.
          */
-	spin_lock(&sched->ws_lock);
+	spin_lock(&wq->wq_lock);
 
 	rc = !(wi->wi_running);
 
@@ -155,15 +181,15 @@ cfs_wi_deschedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 		LASSERT(!list_empty(&wi->wi_list));
 		list_del_init(&wi->wi_list);
 
-		LASSERT(sched->ws_nscheduled > 0);
-		sched->ws_nscheduled--;
+		LASSERT(wq->wq_nscheduled > 0);
+		wq->wq_nscheduled--;
 
 		wi->wi_scheduled = 0;
 	}
 
 	LASSERT (list_empty(&wi->wi_list));
 
-	spin_unlock(&sched->ws_lock);
+	spin_unlock(&wq->wq_lock);
 	return rc;
 }
 EXPORT_SYMBOL(cfs_wi_deschedule);
@@ -178,34 +204,90 @@ EXPORT_SYMBOL(cfs_wi_deschedule);
 void
 cfs_wi_schedule(struct cfs_wi_sched *sched, struct cfs_workitem *wi)
 {
+	struct cfs_wi_queue *wq = cfs_wi_queue(sched, wi);
+
 	LASSERT(!in_interrupt()); /* because we use plain spinlock */
 	LASSERT(!sched->ws_stopping);
 
-	spin_lock(&sched->ws_lock);
+	spin_lock(&wq->wq_lock);
 
 	if (!wi->wi_scheduled) {
 		LASSERT (list_empty(&wi->wi_list));
 
 		wi->wi_scheduled = 1;
-		sched->ws_nscheduled++;
+		wq->wq_nscheduled++;
 		if (!wi->wi_running) {
-			list_add_tail(&wi->wi_list, &sched->ws_runq);
+			list_add_tail(&wi->wi_list, &wq->wq_runq);
+			/* any idle thread can take it */
 			wake_up(&sched->ws_waitq);
 		} else {
-			list_add(&wi->wi_list, &sched->ws_rerunq);
+			list_add(&wi->wi_list, &wq->wq_rerunq);
 		}
 	}
 
 	LASSERT (!list_empty(&wi->wi_list));
-	spin_unlock(&sched->ws_lock);
+	spin_unlock(&wq->wq_lock);
 	return;
 }
 EXPORT_SYMBOL(cfs_wi_schedule);
 
+/* take the oldest workitem off @wq to run it */
+static struct cfs_workitem *
+cfs_wi_queue_pop(struct cfs_wi_queue *wq)
+{
+	struct cfs_workitem *wi;
+
+	spin_lock(&wq->wq_lock);
+	if (list_empty(&wq->wq_runq)) {
+		spin_unlock(&wq->wq_lock);
+		return NULL;
+	}
+
+	wi = list_entry(wq->wq_runq.next, struct cfs_workitem, wi_list);
+	LASSERT(wi->wi_scheduled && !wi->wi_running);
+
+	list_del_init(&wi->wi_list);
+
+	LASSERT(wq->wq_nscheduled > 0);
+	wq->wq_nscheduled--;
+
+	wi->wi_running   = 1;
+	wi->wi_scheduled = 0;
+	spin_unlock(&wq->wq_lock);
+
+	return wi;
+}
+
+/* next workitem for the thread of @own, stealing if @own is empty */
+static struct cfs_workitem *
+cfs_wi_sched_next(struct cfs_wi_sched *sched, struct cfs_wi_queue *own)
+{
+	struct cfs_wi_queue *wq;
+	struct cfs_workitem *wi;
+	int	i;
+
+	wi = cfs_wi_queue_pop(own);
+	if (wi != NULL)
+		return wi;
+
+	for (i = 1; i < sched->ws_nqueues; i++) {
+		wq = &sched->ws_queues[(own - sched->ws_queues + i) %
+				       sched->ws_nqueues];
+		if (list_empty(&wq->wq_runq)) /* don't bounce idle locks */
+			continue;
+
+		wi = cfs_wi_queue_pop(wq);
+		if (wi != NULL)
+			return wi;
+	}
+	return NULL;
+}
+
 static int
 cfs_wi_scheduler(void *arg)
 {
-	struct cfs_wi_sched *sched = (struct cfs_wi_sched *)arg;
+	struct cfs_wi_queue *own = arg;
+	struct cfs_wi_sched *sched = own->wq_sched;
 
 	cfs_block_allsigs();
 
@@ -223,62 +305,43 @@ cfs_wi_scheduler(void *arg)
 
 	spin_unlock(&cfs_wi_data.wi_glock);
 
-	spin_lock(&sched->ws_lock);
-
 	while (!sched->ws_stopping) {
 		int		nloops = 0;
 		int		rc;
+		struct cfs_wi_queue *wq;
 		struct cfs_workitem *wi;
 
-		while (!list_empty(&sched->ws_runq) &&
-		       nloops < CFS_WI_RESCHED) {
-			wi = list_entry(sched->ws_runq.next,
-					struct cfs_workitem, wi_list);
-			LASSERT(wi->wi_scheduled && !wi->wi_running);
-
-			list_del_init(&wi->wi_list);
-
-			LASSERT(sched->ws_nscheduled > 0);
-			sched->ws_nscheduled--;
+		while (nloops < CFS_WI_RESCHED &&
+		       (wi = cfs_wi_sched_next(sched, own)) != NULL) {
+			nloops++;
 
-                        wi->wi_running   = 1;
-                        wi->wi_scheduled = 0;
-
-			spin_unlock(&sched->ws_lock);
-                        nloops++;
-
-                        rc = (*wi->wi_action) (wi);
-
-			spin_lock(&sched->ws_lock);
-                        if (rc != 0) /* WI should be dead, even be freed! */
-                                continue;
+			rc = (*wi->wi_action) (wi);
+			if (rc != 0) /* WI should be dead, even be freed! */
+				continue;
 
+			wq = cfs_wi_queue(sched, wi);
+			spin_lock(&wq->wq_lock);
 			wi->wi_running = 0;
-			if (list_empty(&wi->wi_list))
-                                continue;
-
-			LASSERT(wi->wi_scheduled);
-			/* wi is rescheduled, should be on rerunq now, we
-			 * move it to runq so it can run action now */
-			list_move_tail(&wi->wi_list, &sched->ws_runq);
-                }
+			if (!list_empty(&wi->wi_list)) {
+				LASSERT(wi->wi_scheduled);
+				/* wi is rescheduled, should be on rerunq now,
+				 * we move it to runq so it can run action
+				 * now */
+				list_move_tail(&wi->wi_list, &wq->wq_runq);
+			}
+			spin_unlock(&wq->wq_lock);
+		}
 
-		if (!list_empty(&sched->ws_runq)) {
-			spin_unlock(&sched->ws_lock);
+		if (!cfs_wi_sched_cansleep(sched)) {
 			/* don't sleep because some workitems still
 			 * expect me to come back soon */
 			cond_resched();
-			spin_lock(&sched->ws_lock);
 			continue;
 		}
 
-		spin_unlock(&sched->ws_lock);
 		rc = wait_event_interruptible_exclusive(sched->ws_waitq,
 				!cfs_wi_sched_cansleep(sched));
-		spin_lock(&sched->ws_lock);
-        }
-
-	spin_unlock(&sched->ws_lock);
+	}
 
 	spin_lock(&cfs_wi_data.wi_glock);
 	sched->ws_nthreads--;
@@ -287,6 +350,19 @@ cfs_wi_scheduler(void *arg)
 	return 0;
 }
 
+static void
+cfs_wi_sched_free(struct cfs_wi_sched *sched)
+{
+	int	i;
+
+	for (i = 0; i < sched->ws_nqueues; i++)
+		LASSERT(sched->ws_queues[i].wq_nscheduled == 0);
+
+	LIBCFS_FREE(sched->ws_queues,
+		    sched->ws_nqueues * sizeof(sched->ws_queues[0]));
+	LIBCFS_FREE(sched, sizeof(*sched));
+}
+
 void
 cfs_wi_sched_destroy(struct cfs_wi_sched *sched)
 {
@@ -328,9 +404,7 @@ cfs_wi_sched_destroy(struct cfs_wi_sched *sched)
 
 	spin_unlock(&cfs_wi_data.wi_glock);
 
-	LASSERT(sched->ws_nscheduled == 0);
-
-	LIBCFS_FREE(sched, sizeof(*sched));
+	cfs_wi_sched_free(sched);
 }
 EXPORT_SYMBOL(cfs_wi_sched_destroy);
 
@@ -339,6 +413,7 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 		    int cpt, int nthrs, struct cfs_wi_sched **sched_pp)
 {
 	struct cfs_wi_sched	*sched;
+	int			i;
 
 	LASSERT(cfs_wi_data.wi_init);
 	LASSERT(!cfs_wi_data.wi_stopping);
@@ -358,14 +433,27 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 	sched->ws_cptab = cptab;
 	sched->ws_cpt = cpt;
 
-	spin_lock_init(&sched->ws_lock);
-	init_waitqueue_head(&sched->ws_waitq);
+	sched->ws_nqueues = max(nthrs, 1);
+	LIBCFS_ALLOC(sched->ws_queues,
+		     sched->ws_nqueues * sizeof(sched->ws_queues[0]));
+	if (sched->ws_queues == NULL) {
+		LIBCFS_FREE(sched, sizeof(*sched));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < sched->ws_nqueues; i++) {
+		struct cfs_wi_queue *wq = &sched->ws_queues[i];
 
-	INIT_LIST_HEAD(&sched->ws_runq);
-	INIT_LIST_HEAD(&sched->ws_rerunq);
+		spin_lock_init(&wq->wq_lock);
+		INIT_LIST_HEAD(&wq->wq_runq);
+		INIT_LIST_HEAD(&wq->wq_rerunq);
+		wq->wq_sched = sched;
+	}
+
+	init_waitqueue_head(&sched->ws_waitq);
 	INIT_LIST_HEAD(&sched->ws_list);
 
-	for (; nthrs > 0; nthrs--)  {
+	for (i = 0; i < nthrs; i++) {
 		char			name[16];
 		struct task_struct	*task;
 
@@ -388,7 +476,8 @@ cfs_wi_sched_create(char *name, struct cfs_cpt_table *cptab,
 				 sched->ws_name, sched->ws_nthreads);
 		}
 
-		task = kthread_run(cfs_wi_scheduler, sched, name);
+		task = kthread_run(cfs_wi_scheduler, &sched->ws_queues[i],
+				   name);
 		if (IS_ERR(task)) {
 			int rc = PTR_ERR(task);
 
@@ -460,7 +549,7 @@ cfs_wi_shutdown (void)
 		sched = list_entry(cfs_wi_data.wi_scheds.next,
 				       struct cfs_wi_sched, ws_list);
 		list_del(&sched->ws_list);
-		LIBCFS_FREE(sched, sizeof(*sched));
+		cfs_wi_sched_free(sched);
 	}
 
 	cfs_wi_data.wi_stopping = 0;
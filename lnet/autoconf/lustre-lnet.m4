@@ -795,6 +795,32 @@ kern_sock_flag, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LN_CONFIG_SOCK_ACCEPT
 
+#
+# LN_CONFIG_SOCK_RECVMSG_ITER
+#
+# 4.7 commit 2da62906b1e298695e1bb725927041cd59942c98 dropped the size
+# argument of sock_recvmsg(); the receive length comes from msg_iter.
+#
+AC_DEFUN([LN_CONFIG_SOCK_RECVMSG_ITER], [
+tmp_flags="$EXTRA_KCFLAGS"
+EXTRA_KCFLAGS="-Werror"
+LB_CHECK_COMPILE([if 'sock_recvmsg' takes its length from msg_iter],
+sock_recvmsg_iter, [
+	#include <linux/net.h>
+	#include <linux/socket.h>
+	#include <linux/uio.h>
+],[
+	struct msghdr msg = { 0 };
+
+	sock_recvmsg((struct socket *)0, &msg, 0);
+	(void)iov_iter_count(&msg.msg_iter);
+],[
+	AC_DEFINE(HAVE_SOCK_RECVMSG_ITER, 1,
+		['sock_recvmsg' takes its length from msg_iter])
+])
+EXTRA_KCFLAGS="$tmp_flags"
+]) # LN_CONFIG_SOCK_RECVMSG_ITER
+
 #
 # LN_CONFIG_SOCK_GETNAME
 #
@@ -915,6 +941,8 @@ LN_EXPORT_KMAP_TO_PAGE
 LN_CONFIG_SK_DATA_READY
 # 4.x
 LN_CONFIG_SOCK_CREATE_KERN
+# 4.7
+LN_CONFIG_SOCK_RECVMSG_ITER
 # 4.11
 LN_CONFIG_SOCK_ACCEPT
 # 4.17
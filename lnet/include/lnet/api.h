@@ -200,6 +200,25 @@ int LNetGet(lnet_nid_t	      self,
 	    __u64	      match_bits_in,
 	    unsigned int      offset_in,
 	    bool	      recovery);
+
+int LNetPutVia(lnet_nid_t	 self,
+	       lnet_nid_t	 rtr,
+	       struct lnet_handle_md md_in,
+	       enum lnet_ack_req ack_req_in,
+	       struct lnet_process_id target_in,
+	       unsigned int	 portal_in,
+	       __u64		 match_bits_in,
+	       unsigned int	 offset_in,
+	       __u64		 hdr_data_in);
+
+int LNetGetVia(lnet_nid_t	 self,
+	       lnet_nid_t	 rtr,
+	       struct lnet_handle_md md_in,
+	       struct lnet_process_id target_in,
+	       unsigned int	 portal_in,
+	       __u64		 match_bits_in,
+	       unsigned int	 offset_in,
+	       bool		 recovery);
 /** @} lnet_data */
 
 
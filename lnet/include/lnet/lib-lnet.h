@@ -199,6 +199,8 @@ lnet_net_lock_current(void)
 extern struct kmem_cache *lnet_mes_cachep;	 /* MEs kmem_cache */
 extern struct kmem_cache *lnet_small_mds_cachep; /* <= LNET_SMALL_MD_SIZE bytes
 						  * MDs kmem_cache */
+extern struct kmem_cache *lnet_msgs_cachep;	 /* messages kmem_cache */
+extern struct cfs_mag_cache *lnet_msgs_mag;	 /* per-CPT free messages */
 
 static inline struct lnet_eq *
 lnet_eq_alloc (void)
@@ -215,16 +217,63 @@ lnet_eq_free(struct lnet_eq *eq)
 	LIBCFS_FREE(eq, sizeof(*eq));
 }
 
+/* whether page fragment \a next follows the memory of \a prev */
+static inline bool
+lnet_kiov_contiguous(lnet_kiov_t *prev, lnet_kiov_t *next)
+{
+	unsigned int end = prev->kiov_offset + prev->kiov_len;
+
+	return next->kiov_offset == 0 && (end & ~PAGE_MASK) == 0 &&
+	       page_to_pfn(prev->kiov_page) + (end >> PAGE_SHIFT) ==
+	       page_to_pfn(next->kiov_page);
+}
+
+/* # fragments left of \a kiov once physically contiguous pages merge */
+static inline unsigned int
+lnet_kiov_nmerged(unsigned int niov, lnet_kiov_t *kiov)
+{
+	unsigned int nmerged = niov;
+	unsigned int i;
+
+	for (i = 1; i < niov; i++)
+		if (lnet_kiov_contiguous(&kiov[i - 1], &kiov[i]))
+			nmerged--;
+
+	return nmerged;
+}
+
+/* the page holding byte \a offset of fragment \a kiov */
+static inline struct page *
+lnet_kiov_page(lnet_kiov_t *kiov, unsigned int offset)
+{
+	return nth_page(kiov->kiov_page,
+			(kiov->kiov_offset + offset) >> PAGE_SHIFT);
+}
+
+/* # bytes from byte \a offset of fragment \a kiov to the end of its page */
+static inline unsigned int
+lnet_kiov_page_nob(lnet_kiov_t *kiov, unsigned int offset)
+{
+	return PAGE_SIZE - ((kiov->kiov_offset + offset) & ~PAGE_MASK);
+}
+
 static inline struct lnet_libmd *
 lnet_md_alloc(struct lnet_md *umd)
 {
 	struct lnet_libmd *md;
 	unsigned int  size;
 	unsigned int  niov;
+	unsigned int  nmerged = 0;
 
 	if ((umd->options & LNET_MD_KIOV) != 0) {
 		niov = umd->length;
-		size = offsetof(struct lnet_libmd, md_iov.kiov[niov]);
+		if (niov > 1) {
+			nmerged = lnet_kiov_nmerged(niov, umd->start);
+			if (nmerged == niov)
+				nmerged = 0;
+		}
+		size = offsetof(struct lnet_libmd,
+				md_iov.kiov[niov + nmerged]);
 	} else {
 		niov = ((umd->options & LNET_MD_IOVEC) != 0) ?
 		       umd->length : 1;
@@ -250,6 +299,7 @@ lnet_md_alloc(struct lnet_md *umd)
 		/* Set here in case of early free */
 		md->md_options = umd->options;
 		md->md_niov = niov;
+		md->md_nmerged = nmerged;
 		INIT_LIST_HEAD(&md->md_list);
 	}
 
@@ -262,7 +312,8 @@ lnet_md_free(struct lnet_libmd *md)
 	unsigned int  size;
 
 	if ((md->md_options & LNET_MD_KIOV) != 0)
-		size = offsetof(struct lnet_libmd, md_iov.kiov[md->md_niov]);
+		size = offsetof(struct lnet_libmd,
+				md_iov.kiov[md->md_niov + md->md_nmerged]);
 	else
 		size = offsetof(struct lnet_libmd, md_iov.iov[md->md_niov]);
 
@@ -487,9 +538,8 @@ lnet_msg_alloc(void)
 {
 	struct lnet_msg *msg;
 
-	LIBCFS_ALLOC(msg, sizeof(*msg));
+	msg = cfs_mag_cache_alloc(lnet_msgs_mag, GFP_NOFS | __GFP_ZERO);
 
-	/* no need to zero, LIBCFS_ALLOC does for us */
 	return (msg);
 }
 
@@ -497,7 +547,7 @@ static inline void
 lnet_msg_free(struct lnet_msg *msg)
 {
 	LASSERT(!msg->msg_onactivelist);
-	LIBCFS_FREE(msg, sizeof(*msg));
+	cfs_mag_cache_free(lnet_msgs_mag, msg);
 }
 
 static inline struct lnet_rsp_tracker *
@@ -549,6 +599,7 @@ lnet_net2rnethash(__u32 net)
 
 extern struct lnet_lnd the_lolnd;
 extern int avoid_asym_router_failure;
+extern int weighted_routes;
 
 extern unsigned int lnet_nid_cpt_hash(lnet_nid_t nid, unsigned int number);
 extern int lnet_cpt_of_nid_locked(lnet_nid_t nid, struct lnet_ni *ni);
@@ -567,8 +618,13 @@ extern unsigned lnet_retry_count;
 extern unsigned int lnet_numa_range;
 extern unsigned int lnet_health_sensitivity;
 extern unsigned int lnet_recovery_interval;
+extern unsigned int lnet_max_recovery_ping_interval;
+extern unsigned int lnet_recovery_batch;
 extern unsigned int lnet_peer_discovery_disabled;
 extern unsigned int lnet_drop_asym_route;
+extern unsigned int lnet_adaptive_credits;
+extern unsigned int lnet_peer_discovery_nonblocking;
+extern unsigned int lnet_peer_discovery_max_inflight;
 extern int portal_rotor;
 
 void lnet_mt_event_handler(struct lnet_event *event);
@@ -584,7 +640,8 @@ int lnet_del_route(__u32 net, lnet_nid_t gw_nid);
 void lnet_destroy_routes(void);
 int lnet_get_route(int idx, __u32 *net, __u32 *hops,
 		   lnet_nid_t *gateway, __u32 *alive, __u32 *priority);
-int lnet_get_rtr_pool_cfg(int idx, struct lnet_ioctl_pool_cfg *pool_cfg);
+int lnet_get_rtr_pool_cfg(int idx, struct lnet_ioctl_pool_cfg *pool_cfg,
+			  bool with_waits);
 struct lnet_ni *lnet_get_next_ni_locked(struct lnet_net *mynet,
 					struct lnet_ni *prev);
 struct lnet_ni *lnet_get_ni_idx_locked(int idx);
@@ -604,6 +661,9 @@ int  lnet_rtrpools_adjust(int tiny, int small, int large);
 int lnet_rtrpools_enable(void);
 void lnet_rtrpools_disable(void);
 void lnet_rtrpools_free(int keep_pools);
+/* seconds between two lnet_rtrpools_autosize() checks */
+#define LNET_RTRPOOL_AUTOSIZE_INTERVAL	10
+void lnet_rtrpools_autosize(void);
 struct lnet_remotenet *lnet_find_rnet_locked(__u32 net);
 int lnet_dyn_add_net(struct lnet_ioctl_config_data *conf);
 int lnet_dyn_del_net(__u32 net);
@@ -669,8 +729,15 @@ lnet_ptl_unsetopt(struct lnet_portal *ptl, int opt)
 }
 
 /* match-table functions */
+static inline struct list_head *
+lnet_mt_ignore_head(struct lnet_match_table *mtable)
+{
+	return &mtable->mt_mhash[1U << mtable->mt_mhash_bits];
+}
+
 struct list_head *lnet_mt_match_head(struct lnet_match_table *mtable,
 			       struct lnet_process_id id, __u64 mbits);
+void lnet_mt_grow(struct lnet_match_table *mtable);
 struct lnet_match_table *lnet_mt_of_attach(unsigned int index,
 					   struct lnet_process_id id,
 					   __u64 mbits, __u64 ignore_bits,
@@ -710,6 +777,17 @@ void lnet_detach_rsp_tracker(struct lnet_libmd *md, int cpt);
 void lnet_clean_zombie_rstqs(void);
 
 void lnet_finalize(struct lnet_msg *msg, int rc);
+void lnet_finalize_batch(struct list_head *msgs);
+
+/* queue \a msg on \a batch for a later lnet_finalize_batch() */
+static inline void
+lnet_finalize_batch_add(struct list_head *batch, struct lnet_msg *msg,
+			int status)
+{
+	msg->msg_ev.status = status;
+	list_add_tail(&msg->msg_list, batch);
+}
+
 bool lnet_send_error_simulation(struct lnet_msg *msg,
 				enum lnet_msg_hstatus *hstatus);
 void lnet_handle_remote_failure_locked(struct lnet_peer_ni *lpni);
@@ -748,6 +826,8 @@ bool lnet_delay_rule_match_locked(struct lnet_hdr *hdr, struct lnet_msg *msg);
 /** @} lnet_fault_simulation */
 
 void lnet_counters_get_common(struct lnet_counters_common *common);
+int lnet_nid_counters_get(lnet_nid_t nid,
+			  struct lnet_counters_common *common);
 void lnet_counters_get(struct lnet_counters *counters);
 void lnet_counters_reset(void);
 
@@ -915,6 +995,8 @@ bool lnet_net_unique(__u32 net_id, struct list_head *nilist,
 bool lnet_ni_unique_net(struct list_head *nilist, char *iface);
 void lnet_incr_dlc_seq(void);
 __u32 lnet_get_dlc_seq_locked(void);
+void lnet_incr_path_gen(void);
+__u32 lnet_get_path_gen_locked(void);
 
 struct lnet_peer_ni *lnet_get_next_peer_ni_locked(struct lnet_peer *peer,
 						  struct lnet_peer_net *peer_net,
@@ -995,6 +1077,12 @@ lnet_peer_ni_is_primary(struct lnet_peer_ni *lpni)
 
 bool lnet_peer_is_uptodate(struct lnet_peer *lp);
 
+static inline bool
+lnet_peer_is_discovering(struct lnet_peer *lp)
+{
+	return (READ_ONCE(lp->lp_state) & LNET_PEER_DISCOVERING) != 0;
+}
+
 static inline bool
 lnet_peer_needs_push(struct lnet_peer *lp)
 {
@@ -1025,4 +1113,7 @@ __u32 lnet_sum_stats(struct lnet_element_stats *stats,
 void lnet_usr_translate_stats(struct lnet_ioctl_element_msg_stats *msg_stats,
 			      struct lnet_element_stats *stats);
 
+void lnet_usr_translate_lat_stats(struct lnet_ioctl_lat_stats *lat_stats,
+				  struct lnet_lat_stats *stats);
+
 #endif
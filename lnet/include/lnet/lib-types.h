@@ -117,6 +117,12 @@ struct lnet_msg {
 	 */
 	ktime_t			msg_deadline;
 
+	/* when the message was first posted for sending */
+	ktime_t			msg_post_time;
+
+	/* when the message was handed to the LND for sending */
+	ktime_t			msg_send_time;
+
 	/* The message health status. */
 	enum lnet_msg_hstatus	msg_health_status;
 	/* This is a recovery message */
@@ -218,6 +224,9 @@ struct lnet_libmd {
 	unsigned int		 md_options;
 	unsigned int		 md_flags;
 	unsigned int		 md_niov;	/* # frags at end of struct */
+	/* # frags of the copy of md_iov.kiov merging physically contiguous
+	 * pages, stored after the md_niov frags, or 0 if none merge */
+	unsigned int		 md_nmerged;
 	void		        *md_user_ptr;
 	struct lnet_rsp_tracker *md_rspt_ptr;
 	struct lnet_eq	        *md_eq;
@@ -255,6 +264,9 @@ struct lnet_lnd {
 
 	/* fields initialized by the LND */
 	__u32			lnd_type;
+	/* the LND takes kiov fragments spanning several physically
+	 * contiguous pages (kiov_offset + kiov_len > PAGE_SIZE) */
+	bool			lnd_multipage_kiov;
 
 	int  (*lnd_startup)(struct lnet_ni *ni);
 	void (*lnd_shutdown)(struct lnet_ni *ni);
@@ -356,6 +368,14 @@ struct lnet_element_stats {
 	struct lnet_comm_count el_send_stats;
 	struct lnet_comm_count el_recv_stats;
 	struct lnet_comm_count el_drop_stats;
+	/* payload bytes, so per-rail throughput can be derived */
+	atomic64_t el_send_length;
+	atomic64_t el_recv_length;
+};
+
+struct lnet_lat_stats {
+	atomic_t ls_send[LNET_LAT_HIST_NBUCKETS];
+	atomic_t ls_wait[LNET_LAT_HIST_NBUCKETS];
 };
 
 struct lnet_health_local_stats {
@@ -445,6 +465,9 @@ struct lnet_ni {
 	/* per ni credits */
 	atomic_t		ni_tx_credits;
 
+	/* average send completion time (usec); updated without locking */
+	__u32			ni_tx_lat_avg;
+
 	/* percpt TX queues */
 	struct lnet_tx_queue	**ni_tx_queues;
 
@@ -466,6 +489,11 @@ struct lnet_ni {
 	/* Recovery state. Protected by lnet_ni_lock() */
 	__u32			ni_recovery_state;
 
+	/* recovery pings sent since the last successful one, and when
+	 * the next one is due. Protected by lnet_ni_lock() */
+	__u32			ni_ping_count;
+	time64_t		ni_next_ping;
+
 	/* per NI LND tunables */
 	struct lnet_lnd_tunables ni_lnd_tunables;
 
@@ -475,6 +503,7 @@ struct lnet_ni {
 	/* NI statistics */
 	struct lnet_element_stats ni_stats;
 	struct lnet_health_local_stats ni_hstats;
+	struct lnet_lat_stats ni_lat_stats;
 
 	/* physical device CPT */
 	int			ni_dev_cpt;
@@ -538,6 +567,19 @@ struct lnet_rc_data {
 	int			rcd_nnis;	/* desired size of buffer */
 };
 
+/*
+ * Cached result of the pathway selection for a non-MR peer_ni. There is
+ * one entry per CPT, and each entry is only read or written while holding
+ * lnet_net_lock() on that CPT. The entry is valid as long as lpc_gen
+ * matches the value returned by lnet_get_path_gen_locked().
+ */
+struct lnet_path_cache {
+	/* local NI to send from */
+	struct lnet_ni		*lpc_ni;
+	/* path generation when lpc_ni was resolved */
+	__u32			lpc_gen;
+};
+
 struct lnet_peer_ni {
 	/* chain on lpn_peer_nis */
 	struct list_head	lpni_peer_nis;
@@ -558,6 +600,7 @@ struct lnet_peer_ni {
 	/* statistics kept on each peer NI */
 	struct lnet_element_stats lpni_stats;
 	struct lnet_health_remote_stats lpni_hstats;
+	struct lnet_lat_stats lpni_lat_stats;
 	/* spin lock protecting credits and lpni_txq / lpni_rtrq */
 	spinlock_t		lpni_lock;
 	/* # tx credits available */
@@ -570,6 +613,10 @@ struct lnet_peer_ni {
 	int			lpni_minrtrcredits;
 	/* bytes queued for sending */
 	long			lpni_txqnob;
+	/* average send completion time (usec) */
+	__u32			lpni_tx_lat_avg;
+	/* tx credits withheld by adaptive credit management */
+	int			lpni_txcredits_held;
 	/* alive/dead? */
 	bool			lpni_alive;
 	/* notification outstanding? */
@@ -586,6 +633,10 @@ struct lnet_peer_ni {
 	time64_t		lpni_timestamp;
 	/* time of last ping attempt */
 	time64_t		lpni_ping_timestamp;
+	/* when the last router ping was sent, to measure its RTT */
+	ktime_t			lpni_ping_sent;
+	/* smoothed RTT of router pings in usecs, 0 if not measured yet */
+	unsigned int		lpni_ping_rtt;
 	/* != 0 if ping reply expected */
 	time64_t		lpni_ping_deadline;
 	/* when I was last alive */
@@ -602,6 +653,10 @@ struct lnet_peer_ni {
 	atomic_t		lpni_healthv;
 	/* recovery ping mdh */
 	struct lnet_handle_md	lpni_recovery_ping_mdh;
+	/* recovery pings sent since the last successful one, and when
+	 * the next one is due. Protected by lpni_lock */
+	__u32			lpni_ping_count;
+	time64_t		lpni_next_ping;
 	/* CPT this peer attached on */
 	int			lpni_cpt;
 	/* state flags -- protected by lpni_lock */
@@ -625,6 +680,8 @@ struct lnet_peer_ni {
 	} lpni_pref;
 	/* number of preferred NIDs in lnpi_pref_nids */
 	__u32			lpni_pref_nnids;
+	/* percpt cached pathway, LNET_CPT_NUMBER entries */
+	struct lnet_path_cache	*lpni_path_cache;
 	/* router checker state */
 	struct lnet_rc_data	*lpni_rcd;
 };
@@ -820,6 +877,8 @@ struct lnet_route {
 	unsigned int		lr_downis;	/* number of down NIs */
 	__u32			lr_hops;	/* how far I am */
 	unsigned int		lr_priority;	/* route priority */
+	unsigned int		lr_load;	/* % busy reported by gateway */
+	int			lr_cur_weight;	/* weighted round-robin state */
 };
 
 #define LNET_REMOTE_NETS_HASH_DEFAULT	(1U << 7)
@@ -857,6 +916,14 @@ struct lnet_rtrbufpool {
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* # messages which had to wait for a buffer */
+	__u64			rbp_nwaits;
+	/* # buffers asked for by the configuration */
+	int			rbp_cfg_nbuffers;
+	/* low water mark since the last lnet_rtrpools_autosize() check */
+	int			rbp_autosize_mincredits;
+	/* rbp_nwaits at the last lnet_rtrpools_autosize() check */
+	__u64			rbp_autosize_nwaits;
 };
 
 struct lnet_rtrbuf {
@@ -909,6 +976,12 @@ struct lnet_match_info {
 #define LNET_MT_BITS_U64		6	/* 2^6 bits */
 #define LNET_MT_EXHAUSTED_BITS		(LNET_MT_HASH_BITS - LNET_MT_BITS_U64)
 #define LNET_MT_EXHAUSTED_BMAP		((1 << LNET_MT_EXHAUSTED_BITS) + 1)
+/* the ME hash of a unique portal grows by LNET_MT_HASH_GROW_BITS each time
+ * it holds more than LNET_MT_HASH_DEPTH MEs per bucket on average, up to
+ * 2^LNET_MT_HASH_BITS_MAX buckets */
+#define LNET_MT_HASH_BITS_MAX		16
+#define LNET_MT_HASH_GROW_BITS		2
+#define LNET_MT_HASH_DEPTH		4
 
 /* portal match table */
 struct lnet_match_table {
@@ -921,6 +994,11 @@ struct lnet_match_table {
 	/* bitmap to flag whether MEs on mt_hash are exhausted or not */
 	__u64			mt_exhausted[LNET_MT_EXHAUSTED_BMAP];
 	struct list_head	*mt_mhash;	/* matching hash */
+	/* mt_mhash has (1 << mt_mhash_bits) + 1 entries, the last one is
+	 * for MEs with ignore-bits; only a unique portal's hash grows */
+	unsigned int		mt_mhash_bits;
+	/* # MEs on a unique portal's mt_mhash */
+	unsigned int		mt_nme;
 };
 
 /* these are only useful for wildcard portal */
@@ -1081,8 +1159,8 @@ struct lnet {
 
 	/* discovery event queue handle */
 	struct lnet_handle_eq		ln_dc_eqh;
-	/* discovery requests */
-	struct list_head		ln_dc_request;
+	/* percpt discovery requests, by lp_cpt of the peer */
+	struct list_head		**ln_dc_request;
 	/* discovery working list */
 	struct list_head		ln_dc_working;
 	/* discovery expired list */
@@ -1091,6 +1169,10 @@ struct lnet {
 	wait_queue_head_t		ln_dc_waitq;
 	/* discovery startup/shutdown state */
 	int				ln_dc_state;
+	/* # running discovery threads */
+	atomic_t			ln_dc_nthreads;
+	/* # pings and pushes sent by discovery and not yet completed */
+	atomic_t			ln_dc_inflight;
 
 	/* monitor thread startup/shutdown state */
 	int				ln_mt_state;
@@ -113,6 +113,10 @@ struct lnet_ioctl_pool_cfg {
 		__u32 pl_mincredits;
 	} pl_pools[LNET_NRBPOOLS];
 	__u32 pl_routing;
+	__u32 pl_padding;
+	/* # messages which waited for a buffer, only filled in if the
+	 * caller passed a buffer big enough for it */
+	__u64 pl_nwaits[LNET_NRBPOOLS];
 };
 
 struct lnet_ioctl_ping_data {
@@ -199,6 +203,26 @@ struct lnet_ioctl_peer_ni_hstats {
 	__s32 hlpni_health_value;
 };
 
+/*
+ * Latency histograms are kept in log2 microsecond buckets: bucket 0
+ * counts completions under 1us, bucket i (i > 0) those in
+ * [2^(i-1), 2^i) us, and the last bucket everything slower.
+ */
+#define LNET_LAT_HIST_NBUCKETS	24
+
+struct lnet_ioctl_lat_stats {
+	struct libcfs_ioctl_hdr ls_hdr;
+	lnet_nid_t ls_nid;
+	/* 1 - ls_nid is a peer NI, 0 - a local NI */
+	__u32 ls_peer;
+	/* clear the histograms after reading them */
+	__u32 ls_reset;
+	/* time from hand-off to the LND until send completion */
+	__u32 ls_send[LNET_LAT_HIST_NBUCKETS];
+	/* time spent waiting for credits before hand-off to the LND */
+	__u32 ls_wait[LNET_LAT_HIST_NBUCKETS];
+};
+
 struct lnet_ioctl_element_msg_stats {
 	struct libcfs_ioctl_hdr im_hdr;
 	__u32 im_idx;
@@ -242,6 +266,8 @@ struct lnet_peer_ni_credit_info {
 	__s32 cr_peer_rtr_credits;
 	__s32 cr_peer_min_rtr_credits;
 	__u32 cr_ncpt;
+	__s32 cr_peer_tx_credits_held;
+	__u32 cr_peer_tx_lat_avg;
 };
 
 struct lnet_ioctl_peer {
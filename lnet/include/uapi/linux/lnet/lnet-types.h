@@ -268,7 +268,7 @@ struct lnet_counters {
 struct lnet_ni_status {
 	lnet_nid_t ns_nid;
 	__u32      ns_status;
-	__u32      ns_unused;
+	__u32      ns_load;	/* % busy if LNET_PING_FEAT_RTR_LOAD */
 } WIRE_ATTR;
 
 /*
@@ -281,6 +281,7 @@ struct lnet_ni_status {
 #define LNET_PING_FEAT_RTE_DISABLED	(1 << 2)        /* Routing enabled */
 #define LNET_PING_FEAT_MULTI_RAIL	(1 << 3)        /* Multi-Rail aware */
 #define LNET_PING_FEAT_DISCOVERY	(1 << 4)	/* Supports Discovery */
+#define LNET_PING_FEAT_RTR_LOAD		(1 << 5)	/* NI status has load */
 
 /*
  * All ping feature bits fit to hit the wire.
@@ -294,7 +295,8 @@ struct lnet_ni_status {
 					 LNET_PING_FEAT_NI_STATUS | \
 					 LNET_PING_FEAT_RTE_DISABLED | \
 					 LNET_PING_FEAT_MULTI_RAIL | \
-					 LNET_PING_FEAT_DISCOVERY)
+					 LNET_PING_FEAT_DISCOVERY | \
+					 LNET_PING_FEAT_RTR_LOAD)
 
 struct lnet_ping_info {
 	__u32			pi_magic;
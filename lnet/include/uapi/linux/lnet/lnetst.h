@@ -39,9 +39,12 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_RPC_LAT	(1 << 1)	/* RPC latency and paced tests */
+#define LST_FEAT_PATH		(1 << 2)	/* pinned NI pairs and routers */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_RPC_LAT | LST_FEAT_PATH)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -64,6 +67,7 @@
 #define LSTIO_TEST_ADD		0xC26		/* add test (to batch) */
 #define LSTIO_BATCH_QUERY	0xC27		/* query batch status */
 #define LSTIO_STAT_QUERY	0xC30		/* get stats */
+#define LSTIO_LAT_QUERY		0xC31		/* get RPC latency histograms */
 
 struct lst_sid {
 	lnet_nid_t	ses_nid;	/* nid of console node */
@@ -427,6 +431,20 @@ struct lstio_stat_args {
 	struct lnet_process_id __user *lstio_sta_idsp;
 	/* OUT: list head of result buffer */
 	struct list_head __user *lstio_sta_resultp;
+	/* IN: which counters to report, see lst_stat_path */
+	int			lstio_sta_path;
+	/* IN: peer (router) NID for LST_PATH_PEER */
+	lnet_nid_t		lstio_sta_nid;
+};
+
+/* counters returned by a stat query */
+enum lst_stat_path {
+	/* all traffic of the node */
+	LST_PATH_NODE	= 0,
+	/* traffic through the NI the node is known by in the group */
+	LST_PATH_RAIL	= 1,
+	/* traffic exchanged with one peer NI, e.g. a router */
+	LST_PATH_PEER	= 2
 };
 
 enum lst_test_type {
@@ -464,6 +482,12 @@ struct lstio_test_args {
 	int __user		*lstio_tes_retp;
 	/* OUT: list head of result buffer */
 	struct list_head __user *lstio_tes_resultp;
+	/* IN: RPCs per second of each client, 0 is unpaced */
+	int			 lstio_tes_rate;
+	/* IN: send from the NID each client has in the source group */
+	int			 lstio_tes_pin;
+	/* IN: router to reach the destinations through, or LNET_NID_ANY */
+	lnet_nid_t		 lstio_tes_rtr;
 };
 
 enum lst_brw_type {
@@ -512,4 +536,17 @@ struct sfw_counters {
 	__u32 ping_errors;
 } WIRE_ATTR;
 
+#define LST_LAT_NBUCKETS	24
+
+/** round-trip latency of test RPCs sent by a node, bucket 0 counts RPCs
+ * under 1 usec and bucket i counts RPCs in [2^(i-1), 2^i) usec, the last
+ * bucket also takes everything slower. All counters wrap, consumers are
+ * expected to diff two samples. */
+struct sfw_lat_counters {
+	__u32 lat_count;
+	__u64 lat_sum_us;
+	__u64 lat_sumsq_us;
+	__u32 lat_buckets[LST_LAT_NBUCKETS];
+} WIRE_ATTR;
+
 #endif
@@ -90,6 +90,9 @@ kiblnd_msgtype2str(int type)
         case IBLND_MSG_GET_DONE:
                 return "GET_DONE";
 
+	case IBLND_MSG_PACKED:
+		return "PACKED";
+
         default:
                 return "???";
         }
@@ -124,6 +127,9 @@ kiblnd_msgtype2size(int type)
         case IBLND_MSG_PUT_DONE:
         case IBLND_MSG_GET_DONE:
 		return hdr_size + sizeof(struct kib_completion_msg);
+
+	case IBLND_MSG_PACKED:
+		return hdr_size + sizeof(struct kib_packed_msg);
         default:
                 return -1;
         }
@@ -176,6 +182,46 @@ static int kiblnd_unpack_rd(struct kib_msg *msg, int flip)
         return 0;
 }
 
+static int kiblnd_unpack_packed(struct kib_msg *msg, int flip)
+{
+	struct kib_packed_msg *pm = &msg->ibm_u.packed;
+	struct kib_packed_item *item;
+	int offset = offsetof(struct kib_msg, ibm_u.packed.ibpm_items[0]);
+	int size;
+	int i;
+
+	if (flip)
+		__swab32s(&pm->ibpm_nmsgs);
+
+	if (pm->ibpm_nmsgs == 0 || pm->ibpm_nmsgs > IBLND_PACKED_MSGS_MAX) {
+		CERROR("Bad # packed messages: %d\n", pm->ibpm_nmsgs);
+		return 1;
+	}
+
+	for (i = 0; i < pm->ibpm_nmsgs; i++) {
+		if (offset + (int)sizeof(*item) > msg->ibm_nob) {
+			CERROR("Short packed message %d: %d(%d)\n",
+			       i, msg->ibm_nob, offset);
+			return 1;
+		}
+
+		item = (struct kib_packed_item *)((char *)msg + offset);
+		if (flip)
+			__swab32s(&item->ibpi_nob);
+
+		size = kiblnd_packed_item_size(item->ibpi_nob);
+		if (item->ibpi_nob > IBLND_MSG_SIZE ||
+		    offset + size > msg->ibm_nob) {
+			CERROR("Bad packed message %d: %d bytes at %d(%d)\n",
+			       i, item->ibpi_nob, offset, msg->ibm_nob);
+			return 1;
+		}
+		offset += size;
+	}
+
+	return 0;
+}
+
 void kiblnd_pack_msg(struct lnet_ni *ni, struct kib_msg *msg, int version,
 		     int credits, lnet_nid_t dstnid, __u64 dststamp)
 {
@@ -225,6 +271,7 @@ int kiblnd_unpack_msg(struct kib_msg *msg, int nob)
 
         version = flip ? __swab16(msg->ibm_version) : msg->ibm_version;
         if (version != IBLND_MSG_VERSION &&
+            version != IBLND_MSG_VERSION_2 &&
             version != IBLND_MSG_VERSION_1) {
                 CERROR("Bad version: %x\n", version);
                 return -EPROTO;
@@ -292,6 +339,11 @@ int kiblnd_unpack_msg(struct kib_msg *msg, int nob)
                         return -EPROTO;
                 break;
 
+	case IBLND_MSG_PACKED:
+		if (kiblnd_unpack_packed(msg, flip))
+			return -EPROTO;
+		break;
+
         case IBLND_MSG_PUT_NAK:
         case IBLND_MSG_PUT_DONE:
         case IBLND_MSG_GET_DONE:
@@ -629,7 +681,7 @@ kiblnd_debug_conn(struct kib_conn *conn)
 		kiblnd_debug_tx(list_entry(tmp, struct kib_tx, tx_list));
 
 	CDEBUG(D_CONSOLE, "   rxs:\n");
-	for (i = 0; i < IBLND_RX_MSGS(conn); i++)
+	for (i = 0; conn->ibc_rxs != NULL && i < IBLND_RX_MSGS(conn); i++)
 		kiblnd_debug_rx(&conn->ibc_rxs[i]);
 
 	spin_unlock(&conn->ibc_lock);
@@ -870,19 +922,24 @@ kiblnd_create_conn(struct kib_peer_ni *peer_ni, struct rdma_cm_id *cmid,
 
 	write_unlock_irqrestore(glock, flags);
 
-	LIBCFS_CPT_ALLOC(conn->ibc_rxs, lnet_cpt_table(), cpt,
-			 IBLND_RX_MSGS(conn) * sizeof(struct kib_rx));
-	if (conn->ibc_rxs == NULL) {
-		CERROR("Cannot allocate RX buffers\n");
-		goto failed_2;
-	}
+	if (conn->ibc_hdev->ibh_srqs != NULL)
+		conn->ibc_srq = conn->ibc_hdev->ibh_srqs[cpt];
 
-	rc = kiblnd_alloc_pages(&conn->ibc_rx_pages, cpt,
-				IBLND_RX_MSG_PAGES(conn));
-	if (rc != 0)
-		goto failed_2;
+	if (conn->ibc_srq == NULL) {
+		LIBCFS_CPT_ALLOC(conn->ibc_rxs, lnet_cpt_table(), cpt,
+				 IBLND_RX_MSGS(conn) * sizeof(struct kib_rx));
+		if (conn->ibc_rxs == NULL) {
+			CERROR("Cannot allocate RX buffers\n");
+			goto failed_2;
+		}
 
-	kiblnd_map_rx_descs(conn);
+		rc = kiblnd_alloc_pages(&conn->ibc_rx_pages, cpt,
+					IBLND_RX_MSG_PAGES(conn));
+		if (rc != 0)
+			goto failed_2;
+
+		kiblnd_map_rx_descs(conn);
+	}
 
 #ifdef HAVE_IB_CQ_INIT_ATTR
 	cq_attr.cqe = IBLND_CQ_ENTRIES(conn);
@@ -929,7 +986,13 @@ kiblnd_create_conn(struct kib_peer_ni *peer_ni, struct rdma_cm_id *cmid,
 	 * the maximum work requests for the device is maxed out
 	 */
 	init_qp_attr->cap.max_send_wr = kiblnd_send_wrs(conn);
-	init_qp_attr->cap.max_recv_wr = IBLND_RECV_WRS(conn);
+	if (conn->ibc_srq != NULL) {
+		init_qp_attr->srq = conn->ibc_srq->srq_ibsrq;
+		init_qp_attr->cap.max_recv_wr = 0;
+		init_qp_attr->cap.max_recv_sge = 0;
+	} else {
+		init_qp_attr->cap.max_recv_wr = IBLND_RECV_WRS(conn);
+	}
 
 	rc = rdma_create_qp(cmid, conn->ibc_hdev->ibh_pd, init_qp_attr);
 	if (rc) {
@@ -953,6 +1016,14 @@ kiblnd_create_conn(struct kib_peer_ni *peer_ni, struct rdma_cm_id *cmid,
 
 	LIBCFS_FREE(init_qp_attr, sizeof(*init_qp_attr));
 
+	if (conn->ibc_srq != NULL) {
+		/* receives come from the SRQ; an rx only takes a ref on
+		 * the conn while its completion is being handled */
+		atomic_set(&conn->ibc_refcount, 1);
+		conn->ibc_nrx = 0;
+		goto init_done;
+	}
+
 	/* 1 ref for caller and each rxmsg */
 	atomic_set(&conn->ibc_refcount, 1 + IBLND_RX_MSGS(conn));
 	conn->ibc_nrx = IBLND_RX_MSGS(conn);
@@ -986,6 +1057,7 @@ kiblnd_create_conn(struct kib_peer_ni *peer_ni, struct rdma_cm_id *cmid,
                 }
         }
 
+init_done:
         /* Init successful! */
         LASSERT (state == IBLND_CONN_ACTIVE_CONNECT ||
                  state == IBLND_CONN_PASSIVE_WAIT);
@@ -1039,8 +1111,11 @@ kiblnd_destroy_conn(struct kib_conn *conn)
 	if (cmid != NULL && cmid->qp != NULL)
 		rdma_destroy_qp(cmid);
 
-	if (conn->ibc_cq)
+	if (conn->ibc_cq) {
+		if (conn->ibc_srq != NULL)
+			kiblnd_srq_drain_cq(conn);
 		ib_destroy_cq(conn->ibc_cq);
+	}
 
 	kiblnd_txlist_done(&conn->ibc_zombie_txs, -ECONNABORTED,
 			   LNET_MSG_STATUS_OK);
@@ -1296,53 +1371,46 @@ kiblnd_alloc_pages(struct kib_pages **pp, int cpt, int npages)
         return 0;
 }
 
-void
-kiblnd_unmap_rx_descs(struct kib_conn *conn)
+static void
+kiblnd_unmap_rx_array(struct ib_device *ibdev, struct kib_rx *rxs, int nrx)
 {
 	struct kib_rx *rx;
-        int       i;
-
-        LASSERT (conn->ibc_rxs != NULL);
-        LASSERT (conn->ibc_hdev != NULL);
-
-	for (i = 0; i < IBLND_RX_MSGS(conn); i++) {
-		rx = &conn->ibc_rxs[i];
+	int i;
 
-		LASSERT(rx->rx_nob >= 0); /* not posted */
+	for (i = 0; i < nrx; i++) {
+		rx = &rxs[i];
 
-		kiblnd_dma_unmap_single(conn->ibc_hdev->ibh_ibdev,
+		kiblnd_dma_unmap_single(ibdev,
 					KIBLND_UNMAP_ADDR(rx, rx_msgunmap,
 							  rx->rx_msgaddr),
 					IBLND_MSG_SIZE, DMA_FROM_DEVICE);
 	}
-
-        kiblnd_free_pages(conn->ibc_rx_pages);
-
-        conn->ibc_rx_pages = NULL;
 }
 
-void
-kiblnd_map_rx_descs(struct kib_conn *conn)
+static void
+kiblnd_map_rx_array(struct ib_device *ibdev, struct kib_rx *rxs, int nrx,
+		    struct kib_pages *pages)
 {
 	struct kib_rx *rx;
-        struct page    *pg;
-        int             pg_off;
-        int             ipg;
-        int             i;
+	struct page *pg;
+	int pg_off;
+	int ipg;
+	int i;
+	int j;
 
-	for (pg_off = ipg = i = 0; i < IBLND_RX_MSGS(conn); i++) {
-		pg = conn->ibc_rx_pages->ibp_pages[ipg];
-		rx = &conn->ibc_rxs[i];
+	for (pg_off = ipg = i = 0; i < nrx; i++) {
+		pg = pages->ibp_pages[ipg];
+		rx = &rxs[i];
 
-		rx->rx_conn = conn;
 		rx->rx_msg = (struct kib_msg *)(((char *)page_address(pg)) + pg_off);
+		for (j = 0; j < IBLND_PACKED_MSGS_MAX; j++)
+			rx->rx_items[j].ri_rx = rx;
 
 		rx->rx_msgaddr =
-			kiblnd_dma_map_single(conn->ibc_hdev->ibh_ibdev,
+			kiblnd_dma_map_single(ibdev,
 					      rx->rx_msg, IBLND_MSG_SIZE,
 					      DMA_FROM_DEVICE);
-		LASSERT(!kiblnd_dma_mapping_error(conn->ibc_hdev->ibh_ibdev,
-						  rx->rx_msgaddr));
+		LASSERT(!kiblnd_dma_mapping_error(ibdev, rx->rx_msgaddr));
 		KIBLND_UNMAP_ADDR_SET(rx, rx_msgunmap, rx->rx_msgaddr);
 
 		CDEBUG(D_NET, "rx %d: %p %#llx(%#llx)\n",
@@ -1355,11 +1423,192 @@ kiblnd_map_rx_descs(struct kib_conn *conn)
 		if (pg_off == PAGE_SIZE) {
 			pg_off = 0;
 			ipg++;
-			LASSERT(ipg <= IBLND_RX_MSG_PAGES(conn));
+			LASSERT(ipg <= pages->ibp_npages);
 		}
 	}
 }
 
+void
+kiblnd_unmap_rx_descs(struct kib_conn *conn)
+{
+	int i;
+
+	LASSERT(conn->ibc_rxs != NULL);
+	LASSERT(conn->ibc_hdev != NULL);
+
+	for (i = 0; i < IBLND_RX_MSGS(conn); i++)
+		LASSERT(conn->ibc_rxs[i].rx_nob >= 0); /* not posted */
+
+	kiblnd_unmap_rx_array(conn->ibc_hdev->ibh_ibdev, conn->ibc_rxs,
+			      IBLND_RX_MSGS(conn));
+
+	kiblnd_free_pages(conn->ibc_rx_pages);
+
+	conn->ibc_rx_pages = NULL;
+}
+
+void
+kiblnd_map_rx_descs(struct kib_conn *conn)
+{
+	int i;
+
+	kiblnd_map_rx_array(conn->ibc_hdev->ibh_ibdev, conn->ibc_rxs,
+			    IBLND_RX_MSGS(conn), conn->ibc_rx_pages);
+
+	for (i = 0; i < IBLND_RX_MSGS(conn); i++)
+		conn->ibc_rxs[i].rx_conn = conn;
+}
+
+/* Hand back to the SRQ any receive that completed on this conn's CQ but
+ * was never handled, so the buffer isn't lost along with the CQ. */
+void
+kiblnd_srq_drain_cq(struct kib_conn *conn)
+{
+	struct kib_rx *rx;
+	struct ib_wc wc;
+
+	while (ib_poll_cq(conn->ibc_cq, 1, &wc) > 0) {
+		if (kiblnd_wreqid2type(wc.wr_id) != IBLND_WID_RX)
+			continue;
+
+		rx = kiblnd_wreqid2ptr(wc.wr_id);
+		LASSERT(rx->rx_srq == conn->ibc_srq);
+		LASSERT(rx->rx_nob < 0);
+
+		atomic_dec(&rx->rx_srq->srq_nposted);
+		rx->rx_nob = 0;
+		rx->rx_conn = NULL;
+		kiblnd_post_srq_rx(rx, IBLND_POSTRX_NO_CREDIT);
+	}
+}
+
+static void
+kiblnd_srq_event(struct ib_event *event, void *arg)
+{
+	struct kib_srq *srq = arg;
+
+	CERROR("%s: async SRQ event type %d, %d rx posted\n",
+	       srq->srq_hdev->ibh_ibdev->name, event->event,
+	       atomic_read(&srq->srq_nposted));
+}
+
+static void
+kiblnd_srq_destroy(struct kib_srq *srq)
+{
+	if (srq->srq_ibsrq != NULL && !IS_ERR(srq->srq_ibsrq))
+		ib_destroy_srq(srq->srq_ibsrq);
+
+	/* nothing can complete once the SRQ is gone */
+	if (srq->srq_rx_pages != NULL) {
+		kiblnd_unmap_rx_array(srq->srq_hdev->ibh_ibdev, srq->srq_rxs,
+				      srq->srq_nrx);
+		kiblnd_free_pages(srq->srq_rx_pages);
+	}
+
+	if (srq->srq_rxs != NULL)
+		LIBCFS_FREE(srq->srq_rxs, srq->srq_nrx * sizeof(struct kib_rx));
+}
+
+static int
+kiblnd_srq_create(struct kib_hca_dev *hdev, int cpt, struct kib_srq *srq)
+{
+	struct ib_srq_init_attr attr = {
+		.event_handler	= kiblnd_srq_event,
+	};
+	int nrx;
+	int rc;
+	int i;
+
+	nrx = min(*kiblnd_tunables.kib_srq_size, hdev->ibh_max_srq_wr);
+
+	srq->srq_hdev = hdev;
+	srq->srq_nrx = nrx;
+	atomic_set(&srq->srq_nposted, 0);
+
+	LIBCFS_CPT_ALLOC(srq->srq_rxs, lnet_cpt_table(), cpt,
+			 nrx * sizeof(struct kib_rx));
+	if (srq->srq_rxs == NULL)
+		return -ENOMEM;
+
+	rc = kiblnd_alloc_pages(&srq->srq_rx_pages, cpt, IBLND_SRQ_PAGES(nrx));
+	if (rc != 0)
+		return rc;
+
+	kiblnd_map_rx_array(hdev->ibh_ibdev, srq->srq_rxs, nrx,
+			    srq->srq_rx_pages);
+
+	attr.srq_context = srq;
+	attr.attr.max_wr = nrx;
+	attr.attr.max_sge = 1;
+
+	srq->srq_ibsrq = ib_create_srq(hdev->ibh_pd, &attr);
+	if (IS_ERR(srq->srq_ibsrq)) {
+		rc = PTR_ERR(srq->srq_ibsrq);
+		CERROR("Can't create SRQ with %d entries: %d\n", nrx, rc);
+		return rc;
+	}
+
+	for (i = 0; i < nrx; i++) {
+		srq->srq_rxs[i].rx_srq = srq;
+		rc = kiblnd_post_srq_rx(&srq->srq_rxs[i],
+					IBLND_POSTRX_NO_CREDIT);
+		if (rc != 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+static void
+kiblnd_hdev_cleanup_srqs(struct kib_hca_dev *hdev)
+{
+	struct kib_srq *srq;
+	int i;
+
+	if (hdev->ibh_srqs == NULL)
+		return;
+
+	cfs_percpt_for_each(srq, i, hdev->ibh_srqs)
+		kiblnd_srq_destroy(srq);
+
+	cfs_percpt_free(hdev->ibh_srqs);
+	hdev->ibh_srqs = NULL;
+}
+
+static int
+kiblnd_hdev_setup_srqs(struct kib_hca_dev *hdev)
+{
+	int rc;
+	int i;
+
+	if (!*kiblnd_tunables.kib_use_srq)
+		return 0;
+
+	if (hdev->ibh_max_srq_wr == 0) {
+		CWARN("%s: HCA has no SRQ support, using per-connection receive buffers\n",
+		      hdev->ibh_ibdev->name);
+		return 0;
+	}
+
+	hdev->ibh_srqs = cfs_percpt_alloc(lnet_cpt_table(),
+					  sizeof(struct kib_srq));
+	if (hdev->ibh_srqs == NULL)
+		return -ENOMEM;
+
+	cfs_cpt_for_each(i, lnet_cpt_table()) {
+		rc = kiblnd_srq_create(hdev, i, hdev->ibh_srqs[i]);
+		if (rc != 0) {
+			kiblnd_hdev_cleanup_srqs(hdev);
+			return rc;
+		}
+	}
+
+	CDEBUG(D_NET, "%s: %d rx buffers in each of %d SRQs\n",
+	       hdev->ibh_ibdev->name, hdev->ibh_srqs[0]->srq_nrx,
+	       cfs_cpt_number(lnet_cpt_table()));
+	return 0;
+}
+
 static void
 kiblnd_unmap_tx_pool(struct kib_tx_pool *tpo)
 {
@@ -1442,6 +1691,7 @@ kiblnd_map_tx_pool(struct kib_tx_pool *tpo)
 
 		tx->tx_msg = (struct kib_msg *)(((char *)page_address(page)) +
 						page_offset);
+		INIT_LIST_HEAD(&tx->tx_packed);
 
 		tx->tx_msgaddr = kiblnd_dma_map_single(tpo->tpo_hdev->ibh_ibdev,
 						       tx->tx_msg,
@@ -1780,7 +2030,11 @@ kiblnd_map_tx_pages(struct kib_tx *tx, struct kib_rdma_desc *rd)
 	hdev = tx->tx_pool->tpo_hdev;
 
 	for (i = 0, npages = 0; i < rd->rd_nfrags; i++) {
-		for (size = 0; size <  rd->rd_frags[i].rf_nob;
+		/* a fragment may start inside its first page and span
+		 * several pages */
+		for (size = 0; size < (rd->rd_frags[i].rf_addr &
+				       ~hdev->ibh_page_mask) +
+				      rd->rd_frags[i].rf_nob;
 			size += hdev->ibh_page_size) {
 			pages[npages++] = (rd->rd_frags[i].rf_addr &
 					   hdev->ibh_page_mask) + size;
@@ -2586,6 +2840,7 @@ kiblnd_hdev_get_attr(struct kib_hca_dev *hdev)
 
 	hdev->ibh_mr_size = dev_attr->max_mr_size;
 	hdev->ibh_max_qp_wr = dev_attr->max_qp_wr;
+	hdev->ibh_max_srq_wr = dev_attr->max_srq > 0 ? dev_attr->max_srq_wr : 0;
 
 	/* Setup device Memory Registration capabilities */
 #ifdef HAVE_FMR_POOL_API
@@ -2651,6 +2906,8 @@ kiblnd_hdev_cleanup_mrs(struct kib_hca_dev *hdev)
 void
 kiblnd_hdev_destroy(struct kib_hca_dev *hdev)
 {
+	kiblnd_hdev_cleanup_srqs(hdev);
+
 #ifdef HAVE_IB_GET_DMA_MR
         kiblnd_hdev_cleanup_mrs(hdev);
 #endif
@@ -2821,7 +3078,8 @@ kiblnd_dev_failover(struct kib_dev *dev, struct net *ns)
         hdev->ibh_ibdev = cmid->device;
 
 #ifdef HAVE_IB_ALLOC_PD_2ARGS
-	pd = ib_alloc_pd(cmid->device, 0);
+	pd = ib_alloc_pd(cmid->device, *kiblnd_tunables.kib_global_rkey ?
+			 IB_PD_UNSAFE_GLOBAL_RKEY : 0);
 #else
 	pd = ib_alloc_pd(cmid->device);
 #endif
@@ -2832,6 +3090,17 @@ kiblnd_dev_failover(struct kib_dev *dev, struct net *ns)
 	}
 
         hdev->ibh_pd = pd;
+#ifdef HAVE_IB_ALLOC_PD_2ARGS
+	if (pd->flags & IB_PD_UNSAFE_GLOBAL_RKEY) {
+		LCONSOLE_INFO("%s: Using global rkey for RDMA\n",
+			      dev->ibd_ifname);
+		hdev->ibh_global_rkey = 1;
+	}
+#else
+	if (*kiblnd_tunables.kib_global_rkey)
+		CWARN("%s: global_rkey is not supported by this kernel\n",
+		      dev->ibd_ifname);
+#endif
 
         rc = rdma_listen(cmid, 0);
         if (rc != 0) {
@@ -2853,6 +3122,12 @@ kiblnd_dev_failover(struct kib_dev *dev, struct net *ns)
 	}
 #endif
 
+	rc = kiblnd_hdev_setup_srqs(hdev);
+	if (rc != 0) {
+		CERROR("Can't setup shared receive queues: %d\n", rc);
+		goto out;
+	}
+
 	write_lock_irqsave(&kiblnd_data.kib_global_lock, flags);
 
 	old = dev->ibd_hdev;
@@ -3381,6 +3656,7 @@ failed:
 
 static struct lnet_lnd the_o2iblnd = {
 	.lnd_type	= O2IBLND,
+	.lnd_multipage_kiov = true,
 	.lnd_startup	= kiblnd_startup,
 	.lnd_shutdown	= kiblnd_shutdown,
 	.lnd_ctl	= kiblnd_ctl,
@@ -106,6 +106,10 @@ struct kib_tunables {
 	int		 *kib_nscheds;
 	int		 *kib_wrq_sge;		/* # sg elements per wrq */
 	int		 *kib_use_fastreg_gaps; /* enable discontiguous fastreg fragment support */
+	int		 *kib_use_srq;		/* share receive queues between conns */
+	int		 *kib_srq_size;		/* # rx buffers in each CPT's SRQ */
+	int		 *kib_global_rkey;	/* RDMA through the PD's global rkey */
+	int		 *kib_immediate_pack;	/* pack queued immediate messages */
 };
 
 extern struct kib_tunables  kiblnd_tunables;
@@ -134,6 +138,9 @@ extern struct kib_tunables  kiblnd_tunables;
 # endif
 #endif
 
+/* the peer_ni receives IBLND_MSG_PACKED */
+#define IBLND_PACK_CAPABLE(v)      ((v) >= IBLND_MSG_VERSION_3)
+
 /* 2 OOB shall suffice for 1 keepalive and 1 returning credits */
 #define IBLND_OOB_CAPABLE(v)       ((v) != IBLND_MSG_VERSION_1)
 #define IBLND_OOB_MSGS(v)           (IBLND_OOB_CAPABLE(v) ? 2 : 0)
@@ -156,6 +163,11 @@ extern struct kib_tunables  kiblnd_tunables;
 #define IBLND_RX_MSG_PAGES(c)	\
 	((IBLND_RX_MSG_BYTES(c) + PAGE_SIZE - 1) / PAGE_SIZE)
 
+/* RX messages (per CPT shared receive queue) */
+#define IBLND_SRQ_SIZE_DEFAULT		4096
+#define IBLND_SRQ_PAGES(n)		\
+	(((n) * IBLND_MSG_SIZE + PAGE_SIZE - 1) / PAGE_SIZE)
+
 /* WRs and CQEs (per connection) */
 #define IBLND_RECV_WRS(c)            IBLND_RX_MSGS(c)
 
@@ -163,6 +175,7 @@ extern struct kib_tunables  kiblnd_tunables;
 #define IBLND_CQ_ENTRIES(c) (IBLND_RECV_WRS(c) + kiblnd_send_wrs(c))
 
 struct kib_hca_dev;
+struct kib_srq;
 
 /* o2iblnd can run over aliased interface */
 #ifdef IFALIASZ
@@ -212,6 +225,9 @@ struct kib_hca_dev {
 	struct ib_mr        *ibh_mrs;           /* global MR */
 #endif
 	struct ib_pd        *ibh_pd;            /* PD */
+	int		     ibh_max_srq_wr;	/* max SRQ size, 0 if no SRQ */
+	int		     ibh_global_rkey;	/* PD has an unsafe global rkey */
+	struct kib_srq	   **ibh_srqs;		/* per-CPT shared receive queues */
 	struct kib_dev           *ibh_dev;           /* owner */
 	atomic_t             ibh_ref;           /* refcount */
 };
@@ -226,6 +242,22 @@ struct kib_pages {
         struct page            *ibp_pages[0];           /* page array */
 };
 
+/* receive buffers shared by all the connections of a CPT on one HCA */
+struct kib_srq {
+	/* the verbs SRQ */
+	struct ib_srq		*srq_ibsrq;
+	/* owning HCA */
+	struct kib_hca_dev	*srq_hdev;
+	/* the rx descs */
+	struct kib_rx		*srq_rxs;
+	/* premapped rx msg pages */
+	struct kib_pages	*srq_rx_pages;
+	/* # rx descs */
+	int			 srq_nrx;
+	/* # rx descs currently posted */
+	atomic_t		 srq_nposted;
+};
+
 struct kib_pool;
 struct kib_poolset;
 
@@ -459,6 +491,23 @@ struct kib_immediate_msg {
 	char			ibim_payload[0];/* piggy-backed payload */
 } WIRE_ATTR;
 
+struct kib_packed_item {
+	__u32			ibpi_nob;	/* # bytes of payload */
+	__u32			ibpi_padding;
+	struct lnet_hdr		ibpi_hdr;	/* portals header */
+	char			ibpi_payload[0];/* piggy-backed payload */
+} WIRE_ATTR;
+
+/* immediate messages queued together, each starting 8-byte aligned */
+struct kib_packed_msg {
+	__u32			ibpm_nmsgs;	/* # packed messages */
+	__u32			ibpm_padding;
+	struct kib_packed_item	ibpm_items[0];	/* packed messages */
+} WIRE_ATTR;
+
+/* max # messages in an IBLND_MSG_PACKED */
+#define IBLND_PACKED_MSGS_MAX	16
+
 struct kib_rdma_frag {
         __u32             rf_nob;               /* # bytes this frag */
         __u64             rf_addr;              /* CAVEAT EMPTOR: misaligned!! */
@@ -513,6 +562,7 @@ struct kib_msg {
 		struct kib_putack_msg		putack;
 		struct kib_get_msg		get;
 		struct kib_completion_msg	completion;
+		struct kib_packed_msg		packed;
         } WIRE_ATTR ibm_u;
 } WIRE_ATTR;
 
@@ -520,7 +570,8 @@ struct kib_msg {
 
 #define IBLND_MSG_VERSION_1         0x11
 #define IBLND_MSG_VERSION_2         0x12
-#define IBLND_MSG_VERSION           IBLND_MSG_VERSION_2
+#define IBLND_MSG_VERSION_3         0x13        /* V2 + IBLND_MSG_PACKED */
+#define IBLND_MSG_VERSION           IBLND_MSG_VERSION_3
 
 #define IBLND_MSG_CONNREQ           0xc0        /* connection request */
 #define IBLND_MSG_CONNACK           0xc1        /* connection acknowledge */
@@ -532,6 +583,7 @@ struct kib_msg {
 #define IBLND_MSG_PUT_DONE          0xd5        /* completion (src->sink) */
 #define IBLND_MSG_GET_REQ           0xd6        /* getreq (sink->src) */
 #define IBLND_MSG_GET_DONE          0xd7        /* completion (src->sink: all OK) */
+#define IBLND_MSG_PACKED            0xd8        /* several immediates (V3) */
 
 struct kib_rej {
         __u32            ibr_magic;             /* sender's magic */
@@ -558,11 +610,21 @@ struct kib_rej {
 
 /***********************************************************************/
 
+/* an LNet message of an rx, the 'private' given to lnet_parse() */
+struct kib_rx_item {
+	/* rx holding the message */
+	struct kib_rx		*ri_rx;
+	/* the message in an IBLND_MSG_PACKED, NULL for other messages */
+	struct kib_packed_item	*ri_msg;
+};
+
 struct kib_rx {					/* receive message */
 	/* queue for attention */
 	struct list_head	rx_list;
-	/* owning conn */
+	/* owning conn (while an SRQ rx is being handled) */
 	struct kib_conn	       *rx_conn;
+	/* owning SRQ, NULL for a per-connection rx */
+	struct kib_srq	       *rx_srq;
 	/* # bytes received (-1 while posted) */
 	int			rx_nob;
 	/* completion status */
@@ -577,6 +639,10 @@ struct kib_rx {					/* receive message */
 	struct ib_recv_wr	rx_wrq;
 	/* ...and its memory */
 	struct ib_sge		rx_sge;
+	/* # messages of an IBLND_MSG_PACKED LNet hasn't received yet */
+	atomic_t		rx_npacked;
+	/* the LNet messages of the rx */
+	struct kib_rx_item	rx_items[IBLND_PACKED_MSGS_MAX];
 };
 
 #define IBLND_POSTRX_DONT_POST    0             /* don't post */
@@ -635,6 +701,8 @@ struct kib_tx {					/* transmit message */
 	bool			tx_gaps;
 	/* FMR */
 	struct kib_fmr		tx_fmr;
+	/* txs whose messages are packed in my IBLND_MSG_PACKED */
+	struct list_head	tx_packed;
 				/* dma direction */
 	int			tx_dmadir;
 };
@@ -711,6 +779,8 @@ struct kib_conn {
 	struct kib_rx		*ibc_rxs;
 	/* premapped rx msg pages */
 	struct kib_pages	*ibc_rx_pages;
+	/* shared receive queue (no ibc_rxs), if any */
+	struct kib_srq		*ibc_srq;
 
 	/* CM id */
 	struct rdma_cm_id	*ibc_cmid;
@@ -1045,6 +1115,13 @@ kiblnd_init_msg(struct kib_msg *msg, int type, int body_nob)
 	msg->ibm_nob = offsetof(struct kib_msg, ibm_u) + body_nob;
 }
 
+/* # bytes taken by a packed message of \a nob bytes of payload */
+static inline int
+kiblnd_packed_item_size(int nob)
+{
+	return ALIGN(offsetof(struct kib_packed_item, ibpi_payload[nob]), 8);
+}
+
 static inline int
 kiblnd_rd_size(struct kib_rdma_desc *rd)
 {
@@ -1168,6 +1245,7 @@ static inline unsigned int kiblnd_sg_dma_len(struct ib_device *dev,
 void kiblnd_abort_txs(struct kib_conn *conn, struct list_head *txs);
 void kiblnd_map_rx_descs(struct kib_conn *conn);
 void kiblnd_unmap_rx_descs(struct kib_conn *conn);
+void kiblnd_srq_drain_cq(struct kib_conn *conn);
 void kiblnd_pool_free_node(struct kib_pool *pool, struct list_head *node);
 struct list_head *kiblnd_pool_alloc_node(struct kib_poolset *ps);
 
@@ -1221,6 +1299,7 @@ void kiblnd_pack_msg(struct lnet_ni *ni, struct kib_msg *msg, int version,
 		     int credits, lnet_nid_t dstnid, __u64 dststamp);
 int kiblnd_unpack_msg(struct kib_msg *msg, int nob);
 int kiblnd_post_rx(struct kib_rx *rx, int credit);
+int kiblnd_post_srq_rx(struct kib_rx *rx, int credit);
 
 int kiblnd_send(struct lnet_ni *ni, void *private, struct lnet_msg *lntmsg);
 int kiblnd_recv(struct lnet_ni *ni, void *private, struct lnet_msg *lntmsg,
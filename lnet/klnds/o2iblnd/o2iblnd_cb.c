@@ -51,8 +51,12 @@ static void kiblnd_queue_tx(struct kib_tx *tx, struct kib_conn *conn);
 static void kiblnd_unmap_tx(struct kib_tx *tx);
 static void kiblnd_check_sends_locked(struct kib_conn *conn);
 
-void
-kiblnd_tx_done(struct kib_tx *tx)
+/*
+ * Release \a tx and queue its lnet messages on \a batch; the caller must
+ * lnet_finalize_batch() them once it is done with its descriptors.
+ */
+static void
+kiblnd_tx_done_batch(struct kib_tx *tx, struct list_head *batch)
 {
 	struct lnet_msg *lntmsg[2];
 	int         rc;
@@ -64,6 +68,17 @@ kiblnd_tx_done(struct kib_tx *tx)
 	LASSERT (!tx->tx_waiting);              /* mustn't be awaiting peer_ni response */
 	LASSERT (tx->tx_pool != NULL);
 
+	/* the messages packed in tx share its fate */
+	while (!list_empty(&tx->tx_packed)) {
+		struct kib_tx *ptx = list_entry(tx->tx_packed.next,
+						struct kib_tx, tx_list);
+
+		list_del(&ptx->tx_list);
+		ptx->tx_status = tx->tx_status;
+		ptx->tx_hstatus = tx->tx_hstatus;
+		kiblnd_tx_done_batch(ptx, batch);
+	}
+
 	kiblnd_unmap_tx(tx);
 
 	/* tx may have up to 2 lnet msgs to finalise */
@@ -71,6 +86,10 @@ kiblnd_tx_done(struct kib_tx *tx)
 	lntmsg[1] = tx->tx_lntmsg[1]; tx->tx_lntmsg[1] = NULL;
 	rc = tx->tx_status;
 
+	/* propagate health status to LNet for requests */
+	if (lntmsg[0] != NULL)
+		lntmsg[0]->msg_health_status = tx->tx_hstatus;
+
 	if (tx->tx_conn != NULL) {
 		kiblnd_conn_decref(tx->tx_conn);
 		tx->tx_conn = NULL;
@@ -81,23 +100,28 @@ kiblnd_tx_done(struct kib_tx *tx)
 
 	kiblnd_pool_free_node(&tx->tx_pool->tpo_pool, &tx->tx_list);
 
-	/* delay finalize until my descs have been freed */
 	for (i = 0; i < 2; i++) {
-		if (lntmsg[i] == NULL)
-			continue;
+		if (lntmsg[i] != NULL)
+			lnet_finalize_batch_add(batch, lntmsg[i], rc);
+	}
+}
+
+void
+kiblnd_tx_done(struct kib_tx *tx)
+{
+	struct list_head batch = LIST_HEAD_INIT(batch);
 
-		/* propagate health status to LNet for requests */
-		if (i == 0 && lntmsg[i])
-			lntmsg[i]->msg_health_status = tx->tx_hstatus;
+	kiblnd_tx_done_batch(tx, &batch);
 
-		lnet_finalize(lntmsg[i], rc);
-	}
+	/* delay finalize until my descs have been freed */
+	lnet_finalize_batch(&batch);
 }
 
 void
 kiblnd_txlist_done(struct list_head *txlist, int status,
 		   enum lnet_msg_hstatus hstatus)
 {
+	struct list_head batch = LIST_HEAD_INIT(batch);
 	struct kib_tx *tx;
 
 	while (!list_empty(txlist)) {
@@ -109,8 +133,11 @@ kiblnd_txlist_done(struct list_head *txlist, int status,
 		tx->tx_status = status;
 		if (hstatus != LNET_MSG_STATUS_OK)
 			tx->tx_hstatus = hstatus;
-		kiblnd_tx_done(tx);
+		kiblnd_tx_done_batch(tx, &batch);
 	}
+
+	/* finalize the whole list at once, see lnet_finalize_batch() */
+	lnet_finalize_batch(&batch);
 }
 
 static struct kib_tx *
@@ -144,9 +171,8 @@ kiblnd_get_idle_tx(struct lnet_ni *ni, lnet_nid_t target)
 }
 
 static void
-kiblnd_drop_rx(struct kib_rx *rx)
+kiblnd_conn_put_rx(struct kib_conn *conn)
 {
-	struct kib_conn *conn = rx->rx_conn;
 	struct kib_sched_info *sched = conn->ibc_sched;
 	unsigned long flags;
 
@@ -158,28 +184,27 @@ kiblnd_drop_rx(struct kib_rx *rx)
 	kiblnd_conn_decref(conn);
 }
 
-int
-kiblnd_post_rx(struct kib_rx *rx, int credit)
+static void
+kiblnd_drop_rx(struct kib_rx *rx)
 {
-	struct kib_conn *conn = rx->rx_conn;
-	struct kib_net *net = conn->ibc_peer->ibp_ni->ni_data;
-	struct ib_recv_wr *bad_wrq = NULL;
-#ifdef HAVE_IB_GET_DMA_MR
-	struct ib_mr *mr = conn->ibc_hdev->ibh_mrs;
-#endif
-	int rc;
+	/* an SRQ buffer outlives the conn: give it back to the SRQ */
+	if (rx->rx_srq != NULL)
+		kiblnd_post_srq_rx(rx, IBLND_POSTRX_NO_CREDIT);
+	else
+		kiblnd_conn_put_rx(rx->rx_conn);
+}
 
-	LASSERT (net != NULL);
-	LASSERT (!in_interrupt());
-	LASSERT (credit == IBLND_POSTRX_NO_CREDIT ||
-		 credit == IBLND_POSTRX_PEER_CREDIT ||
-		 credit == IBLND_POSTRX_RSRVD_CREDIT);
+static void
+kiblnd_init_rx_wrq(struct kib_rx *rx, struct kib_hca_dev *hdev)
+{
 #ifdef HAVE_IB_GET_DMA_MR
+	struct ib_mr *mr = hdev->ibh_mrs;
+
 	LASSERT(mr != NULL);
 
 	rx->rx_sge.lkey   = mr->lkey;
 #else
-	rx->rx_sge.lkey   = conn->ibc_hdev->ibh_pd->local_dma_lkey;
+	rx->rx_sge.lkey   = hdev->ibh_pd->local_dma_lkey;
 #endif
         rx->rx_sge.addr   = rx->rx_msgaddr;
         rx->rx_sge.length = IBLND_MSG_SIZE;
@@ -188,6 +213,92 @@ kiblnd_post_rx(struct kib_rx *rx, int credit)
         rx->rx_wrq.sg_list = &rx->rx_sge;
         rx->rx_wrq.num_sge = 1;
         rx->rx_wrq.wr_id = kiblnd_ptr2wreqid(rx, IBLND_WID_RX);
+}
+
+/* Called by the scheduler when a conn's CQ returns an SRQ buffer: the rx
+ * belongs to this conn (and holds a ref on it) until it is reposted. */
+static void
+kiblnd_srq_attach_rx(struct kib_conn *conn, struct kib_rx *rx)
+{
+	struct kib_sched_info *sched = conn->ibc_sched;
+	unsigned long flags;
+
+	LASSERT(rx->rx_srq == conn->ibc_srq);
+	LASSERT(rx->rx_conn == NULL);
+
+	atomic_dec(&rx->rx_srq->srq_nposted);
+	rx->rx_conn = conn;
+	kiblnd_conn_addref(conn);
+
+	spin_lock_irqsave(&sched->ibs_lock, flags);
+	conn->ibc_nrx++;
+	spin_unlock_irqrestore(&sched->ibs_lock, flags);
+}
+
+int
+kiblnd_post_srq_rx(struct kib_rx *rx, int credit)
+{
+	struct kib_srq *srq = rx->rx_srq;
+	struct kib_conn *conn = rx->rx_conn;
+	struct ib_recv_wr *bad_wrq = NULL;
+	int rc;
+
+	LASSERT(!in_interrupt());
+	LASSERT(rx->rx_nob >= 0);		/* not posted */
+
+	kiblnd_init_rx_wrq(rx, srq->srq_hdev);
+
+	rx->rx_conn = NULL;
+	rx->rx_nob = -1;			/* flag posted */
+	atomic_inc(&srq->srq_nposted);
+#ifdef HAVE_IB_POST_SEND_RECV_CONST
+	rc = ib_post_srq_recv(srq->srq_ibsrq, &rx->rx_wrq,
+			      (const struct ib_recv_wr **)&bad_wrq);
+#else
+	rc = ib_post_srq_recv(srq->srq_ibsrq, &rx->rx_wrq, &bad_wrq);
+#endif
+	if (unlikely(rc != 0)) {
+		CERROR("Can't post SRQ rx: %d, bad_wrq: %p\n", rc, bad_wrq);
+		atomic_dec(&srq->srq_nposted);
+		rx->rx_nob = 0;
+	}
+
+	if (conn == NULL)			/* initial post / drain */
+		return rc;
+
+	if (rc == 0 && credit != IBLND_POSTRX_NO_CREDIT &&
+	    conn->ibc_state == IBLND_CONN_ESTABLISHED) {
+		spin_lock(&conn->ibc_lock);
+		if (credit == IBLND_POSTRX_PEER_CREDIT)
+			conn->ibc_outstanding_credits++;
+		else
+			conn->ibc_reserved_credits++;
+		kiblnd_check_sends_locked(conn);
+		spin_unlock(&conn->ibc_lock);
+	}
+
+	kiblnd_conn_put_rx(conn);
+	return rc;
+}
+
+int
+kiblnd_post_rx(struct kib_rx *rx, int credit)
+{
+	struct kib_conn *conn = rx->rx_conn;
+	struct kib_net *net = conn->ibc_peer->ibp_ni->ni_data;
+	struct ib_recv_wr *bad_wrq = NULL;
+	int rc;
+
+	LASSERT (net != NULL);
+	LASSERT (!in_interrupt());
+	LASSERT (credit == IBLND_POSTRX_NO_CREDIT ||
+		 credit == IBLND_POSTRX_PEER_CREDIT ||
+		 credit == IBLND_POSTRX_RSRVD_CREDIT);
+
+	if (rx->rx_srq != NULL)
+		return kiblnd_post_srq_rx(rx, credit);
+
+	kiblnd_init_rx_wrq(rx, conn->ibc_hdev);
 
         LASSERT (conn->ibc_state >= IBLND_CONN_INIT);
         LASSERT (rx->rx_nob >= 0);              /* not posted */
@@ -324,6 +435,41 @@ kiblnd_send_completion(struct kib_conn *conn, int type, int status, u64 cookie)
         kiblnd_queue_tx(tx, conn);
 }
 
+/*
+ * Hand each message of the IBLND_MSG_PACKED in \a rx to LNet.  The rx is
+ * reposted by whichever of them is received last, see kiblnd_recv().
+ */
+static int
+kiblnd_parse_packed(struct lnet_ni *ni, struct kib_rx *rx, int *post_credit)
+{
+	struct kib_msg *msg = rx->rx_msg;
+	struct kib_packed_item *item;
+	int nmsgs = msg->ibm_u.packed.ibpm_nmsgs;
+	int offset = offsetof(struct kib_msg, ibm_u.packed.ibpm_items[0]);
+	int rc = 0;
+	int i;
+
+	*post_credit = IBLND_POSTRX_DONT_POST;
+	atomic_set(&rx->rx_npacked, nmsgs);
+
+	for (i = 0; i < nmsgs; i++) {
+		item = (struct kib_packed_item *)((char *)msg + offset);
+		offset += kiblnd_packed_item_size(item->ibpi_nob);
+
+		rx->rx_items[i].ri_msg = item;
+		rc = lnet_parse(ni, &item->ibpi_hdr, msg->ibm_srcnid,
+				&rx->rx_items[i], 0);
+		if (rc < 0)
+			break;
+	}
+
+	/* LNet won't receive the failed and unparsed messages */
+	if (rc < 0 && atomic_sub_and_test(nmsgs - i, &rx->rx_npacked))
+		*post_credit = IBLND_POSTRX_PEER_CREDIT;
+
+	return rc;
+}
+
 static void
 kiblnd_handle_rx(struct kib_rx *rx)
 {
@@ -338,7 +484,10 @@ kiblnd_handle_rx(struct kib_rx *rx)
 
         LASSERT (conn->ibc_state >= IBLND_CONN_ESTABLISHED);
 
-        CDEBUG (D_NET, "Received %x[%d] from %s\n",
+	/* not a packed message unless kiblnd_parse_packed() says so */
+	rx->rx_items[0].ri_msg = NULL;
+
+        CDEBUG (D_NET, "Received %x[%d] from %s\n
                 msg->ibm_type, credits,
                 libcfs_nid2str(conn->ibc_peer->ibp_nid));
 
@@ -395,7 +544,7 @@ kiblnd_handle_rx(struct kib_rx *rx)
         case IBLND_MSG_IMMEDIATE:
                 post_credit = IBLND_POSTRX_DONT_POST;
                 rc = lnet_parse(ni, &msg->ibm_u.immediate.ibim_hdr,
-                                msg->ibm_srcnid, rx, 0);
+				msg->ibm_srcnid, &rx->rx_items[0], 0);
                 if (rc < 0)                     /* repost on error */
                         post_credit = IBLND_POSTRX_PEER_CREDIT;
                 break;
@@ -403,11 +552,23 @@ kiblnd_handle_rx(struct kib_rx *rx)
         case IBLND_MSG_PUT_REQ:
                 post_credit = IBLND_POSTRX_DONT_POST;
                 rc = lnet_parse(ni, &msg->ibm_u.putreq.ibprm_hdr,
-                                msg->ibm_srcnid, rx, 1);
+				msg->ibm_srcnid, &rx->rx_items[0], 1);
                 if (rc < 0)                     /* repost on error */
                         post_credit = IBLND_POSTRX_PEER_CREDIT;
                 break;
 
+	case IBLND_MSG_PACKED:
+		if (!IBLND_PACK_CAPABLE(conn->ibc_version)) {
+			CERROR("Packed message from %s of version %x\n",
+			       libcfs_nid2str(conn->ibc_peer->ibp_nid),
+			       conn->ibc_version);
+			post_credit = IBLND_POSTRX_NO_CREDIT;
+			rc = -EPROTO;
+			break;
+		}
+		rc = kiblnd_parse_packed(ni, rx, &post_credit);
+		break;
+
         case IBLND_MSG_PUT_NAK:
                 CWARN ("PUT_NACK from %s\n",
                        libcfs_nid2str(conn->ibc_peer->ibp_nid));
@@ -465,7 +626,7 @@ kiblnd_handle_rx(struct kib_rx *rx)
         case IBLND_MSG_GET_REQ:
                 post_credit = IBLND_POSTRX_DONT_POST;
                 rc = lnet_parse(ni, &msg->ibm_u.get.ibgm_hdr,
-                                msg->ibm_srcnid, rx, 1);
+				msg->ibm_srcnid, &rx->rx_items[0], 1);
                 if (rc < 0)                     /* repost on error */
                         post_credit = IBLND_POSTRX_PEER_CREDIT;
                 break;
@@ -739,6 +900,16 @@ static int kiblnd_map_tx(struct lnet_ni *ni, struct kib_tx *tx,
 		return 0;
 	}
 #endif
+#ifdef HAVE_IB_ALLOC_PD_2ARGS
+	if (hdev->ibh_global_rkey) {
+		/* no per-I/O registration or invalidation: the frags are
+		 * plain DMA addresses covered by the PD's global keys */
+		rd->rd_key = (rd != tx->tx_rd) ?
+			     hdev->ibh_pd->unsafe_global_rkey :
+			     hdev->ibh_pd->local_dma_lkey;
+		return 0;
+	}
+#endif
 
 	if (net->ibn_fmr_ps != NULL)
 		return kiblnd_fmr_map_tx(net, tx, rd, nob);
@@ -820,12 +991,30 @@ static int kiblnd_setup_rd_iov(struct lnet_ni *ni, struct kib_tx *tx,
         return kiblnd_map_tx(ni, tx, rd, sg - tx->tx_frags);
 }
 
+/*
+ * Whether a fragment starting at offset \a offset of page \a page follows
+ * the memory of scatterlist entry \a sg, as the pages of a compound page or
+ * of a physically contiguous buffer do.
+ */
+static inline bool kiblnd_sg_contiguous(struct scatterlist *sg,
+					struct page *page, unsigned int offset)
+{
+	unsigned int end = sg->offset + sg->length;
+
+	return offset == 0 && (end & ~PAGE_MASK) == 0 &&
+	       page_to_pfn(sg_page(sg)) + (end >> PAGE_SHIFT) ==
+	       page_to_pfn(page);
+}
+
 static int kiblnd_setup_rd_kiov(struct lnet_ni *ni, struct kib_tx *tx,
 				struct kib_rdma_desc *rd, int nkiov,
 				lnet_kiov_t *kiov, int offset, int nob)
 {
 	struct kib_net *net = ni->ni_data;
 	struct scatterlist *sg;
+	struct scatterlist *prev = NULL;
+	struct page	   *page;
+	unsigned int	    page_offset;
 	int                 fragnob;
 	int		    max_nkiov;
 
@@ -864,12 +1053,21 @@ static int kiblnd_setup_rd_kiov(struct lnet_ni *ni, struct kib_tx *tx,
 			tx->tx_gaps = true;
 		}
 
-		sg_set_page(sg, kiov->kiov_page, fragnob,
-			    kiov->kiov_offset + offset);
-		sg = sg_next(sg);
-		if (!sg) {
-			CERROR("lacking enough sg entries to map tx\n");
-			return -EFAULT;
+		/* extend the previous entry over contiguous pages, so that a
+		 * bulk of huge pages is mapped with a few large fragments */
+		page = lnet_kiov_page(kiov, offset);
+		page_offset = (kiov->kiov_offset + offset) & ~PAGE_MASK;
+		if (prev != NULL &&
+		    kiblnd_sg_contiguous(prev, page, page_offset)) {
+			prev->length += fragnob;
+		} else {
+			sg_set_page(sg, page, fragnob, page_offset);
+			prev = sg;
+			sg = sg_next(sg);
+			if (!sg) {
+				CERROR("lacking enough sg entries to map tx\n");
+				return -EFAULT;
+			}
 		}
 
 		offset = 0;
@@ -881,6 +1079,80 @@ static int kiblnd_setup_rd_kiov(struct lnet_ni *ni, struct kib_tx *tx,
 	return kiblnd_map_tx(ni, tx, rd, sg - tx->tx_frags);
 }
 
+/*
+ * Turn the IMMEDIATE \a tx into an IBLND_MSG_PACKED carrying the immediate
+ * messages queued right behind it as well, as many as fit in a message.
+ * The absorbed txs are completed with \a tx.
+ */
+static void
+kiblnd_pack_txs_locked(struct kib_conn *conn, struct kib_tx *tx)
+__must_hold(&conn->ibc_lock)
+{
+	const int hdr_nob = offsetof(struct kib_msg, ibm_u.immediate.ibim_payload);
+	struct kib_msg *msg = tx->tx_msg;
+	struct kib_packed_item *item;
+	struct kib_msg *nmsg;
+	struct kib_tx *next;
+	int payload_nob = msg->ibm_nob - hdr_nob;
+	int nob;
+	int size;
+	int n;
+
+	LASSERT(msg->ibm_type == IBLND_MSG_IMMEDIATE);
+	LASSERT(list_empty(&tx->tx_packed));
+
+	if (list_empty(&conn->ibc_tx_queue))
+		return;
+
+	nob = offsetof(struct kib_msg, ibm_u.packed.ibpm_items[0]) +
+	      kiblnd_packed_item_size(payload_nob);
+	next = list_entry(conn->ibc_tx_queue.next, struct kib_tx, tx_list);
+	if (nob + kiblnd_packed_item_size(next->tx_msg->ibm_nob - hdr_nob) >
+	    IBLND_MSG_SIZE)
+		return;
+
+	/* move my own message into the first slot */
+	item = &msg->ibm_u.packed.ibpm_items[0];
+	memmove(&item->ibpi_hdr, &msg->ibm_u.immediate.ibim_hdr,
+		sizeof(item->ibpi_hdr) + payload_nob);
+	item->ibpi_nob = payload_nob;
+	item->ibpi_padding = 0;
+
+	for (n = 1; n < IBLND_PACKED_MSGS_MAX; n++) {
+		if (list_empty(&conn->ibc_tx_queue))
+			break;
+
+		next = list_entry(conn->ibc_tx_queue.next,
+				  struct kib_tx, tx_list);
+		nmsg = next->tx_msg;
+		LASSERT(nmsg->ibm_type == IBLND_MSG_IMMEDIATE);
+
+		payload_nob = nmsg->ibm_nob - hdr_nob;
+		size = kiblnd_packed_item_size(payload_nob);
+		if (nob + size > IBLND_MSG_SIZE)
+			break;
+
+		item = (struct kib_packed_item *)((char *)msg + nob);
+		item->ibpi_nob = payload_nob;
+		item->ibpi_padding = 0;
+		memcpy(&item->ibpi_hdr, &nmsg->ibm_u.immediate.ibim_hdr,
+		       sizeof(item->ibpi_hdr) + payload_nob);
+		nob += size;
+
+		list_move_tail(&next->tx_list, &tx->tx_packed);
+		next->tx_queued = 0;
+	}
+
+	msg->ibm_type = IBLND_MSG_PACKED;
+	msg->ibm_nob = nob;
+	msg->ibm_u.packed.ibpm_nmsgs = n;
+	msg->ibm_u.packed.ibpm_padding = 0;
+	tx->tx_msgsge.length = nob;
+
+	CDEBUG(D_NET, "%s: packed %d immediate messages in %d bytes\n",
+	       libcfs_nid2str(conn->ibc_peer->ibp_nid), n, nob);
+}
+
 static int
 kiblnd_post_tx_locked(struct kib_conn *conn, struct kib_tx *tx, int credit)
 __must_hold(&conn->ibc_lock)
@@ -947,6 +1219,11 @@ __must_hold(&conn->ibc_lock)
                 return 0;
         }
 
+	if (msg->ibm_type == IBLND_MSG_IMMEDIATE &&
+	    IBLND_PACK_CAPABLE(ver) &&
+	    *kiblnd_tunables.kib_immediate_pack)
+		kiblnd_pack_txs_locked(conn, tx);
+
         kiblnd_pack_msg(peer_ni->ibp_ni, msg, ver, conn->ibc_outstanding_credits,
                         peer_ni->ibp_nid, conn->ibc_incarnation);
 
@@ -1896,12 +2173,46 @@ failed_0:
 	lnet_finalize(lntmsg, -EIO);
 }
 
+static int
+kiblnd_recv_packed(struct kib_rx_item *ri, struct lnet_msg *lntmsg,
+		   unsigned int niov, struct kvec *iov, lnet_kiov_t *kiov,
+		   unsigned int offset, unsigned int mlen, unsigned int rlen)
+{
+	struct kib_packed_item *item = ri->ri_msg;
+	struct kib_rx *rx = ri->ri_rx;
+	int rc = 0;
+
+	if (rlen > item->ibpi_nob) {
+		CERROR("Packed message from %s too big: %d(%d)\n",
+		       libcfs_nid2str(item->ibpi_hdr.src_nid),
+		       rlen, item->ibpi_nob);
+		rc = -EPROTO;
+	} else {
+		if (kiov != NULL)
+			lnet_copy_flat2kiov(niov, kiov, offset,
+					    item->ibpi_nob, item->ibpi_payload,
+					    0, mlen);
+		else
+			lnet_copy_flat2iov(niov, iov, offset,
+					   item->ibpi_nob, item->ibpi_payload,
+					   0, mlen);
+		lnet_finalize(lntmsg, 0);
+	}
+
+	/* the last message LNet receives reposts the rx */
+	if (atomic_dec_and_test(&rx->rx_npacked))
+		kiblnd_post_rx(rx, IBLND_POSTRX_PEER_CREDIT);
+
+	return rc;
+}
+
 int
 kiblnd_recv(struct lnet_ni *ni, void *private, struct lnet_msg *lntmsg,
 	    int delayed, unsigned int niov, struct kvec *iov, lnet_kiov_t *kiov,
 	    unsigned int offset, unsigned int mlen, unsigned int rlen)
 {
-	struct kib_rx *rx = private;
+	struct kib_rx_item *ri = private;
+	struct kib_rx *rx = ri->ri_rx;
 	struct kib_msg *rxmsg = rx->rx_msg;
 	struct kib_conn *conn = rx->rx_conn;
 	struct kib_tx *tx;
@@ -1915,6 +2226,10 @@ kiblnd_recv(struct lnet_ni *ni, void *private, struct lnet_msg *lntmsg,
 	/* Either all pages or all vaddrs */
 	LASSERT (!(kiov != NULL && iov != NULL));
 
+	if (ri->ri_msg != NULL)
+		return kiblnd_recv_packed(ri, lntmsg, niov, iov, kiov,
+					  offset, mlen, rlen);
+
 	switch (rxmsg->ibm_type) {
 	default:
 		LBUG();
@@ -2494,10 +2809,12 @@ kiblnd_passive_connect(struct rdma_cm_id *cmid, void *priv, int priv_nob)
 		goto failed;
 	if (reqmsg->ibm_magic == IBLND_MSG_MAGIC &&
 	    reqmsg->ibm_version != IBLND_MSG_VERSION &&
+	    reqmsg->ibm_version != IBLND_MSG_VERSION_2 &&
 	    reqmsg->ibm_version != IBLND_MSG_VERSION_1)
 		goto failed;
 	if (reqmsg->ibm_magic == __swab32(IBLND_MSG_MAGIC) &&
 	    reqmsg->ibm_version != __swab16(IBLND_MSG_VERSION) &&
+	    reqmsg->ibm_version != __swab16(IBLND_MSG_VERSION_2) &&
 	    reqmsg->ibm_version != __swab16(IBLND_MSG_VERSION_1))
 		goto failed;
 
@@ -2553,7 +2870,7 @@ kiblnd_passive_connect(struct rdma_cm_id *cmid, void *priv, int priv_nob)
 		       reqmsg->ibm_u.connparams.ibcp_queue_depth,
 		       kiblnd_msg_queue_size(version, ni));
 
-		if (version == IBLND_MSG_VERSION)
+		if (version != IBLND_MSG_VERSION_1)
 			rej.ibr_why = IBLND_REJECT_MSG_QUEUE_SIZE;
 
 		goto failed;
@@ -2567,7 +2884,7 @@ kiblnd_passive_connect(struct rdma_cm_id *cmid, void *priv, int priv_nob)
 		      reqmsg->ibm_u.connparams.ibcp_max_frags,
 		      IBLND_MAX_RDMA_FRAGS);
 
-		if (version >= IBLND_MSG_VERSION)
+		if (version != IBLND_MSG_VERSION_1)
 			rej.ibr_why = IBLND_REJECT_RDMA_FRAGS;
 
 		goto failed;
@@ -2581,7 +2898,7 @@ kiblnd_passive_connect(struct rdma_cm_id *cmid, void *priv, int priv_nob)
 		      reqmsg->ibm_u.connparams.ibcp_max_frags,
 		      IBLND_MAX_RDMA_FRAGS);
 
-		if (version == IBLND_MSG_VERSION)
+		if (version != IBLND_MSG_VERSION_1)
 			rej.ibr_why = IBLND_REJECT_RDMA_FRAGS;
 
 		goto failed;
@@ -2962,6 +3279,7 @@ kiblnd_rejected(struct kib_conn *conn, int reason, void *priv, int priv_nob)
                         }
 
                         if (rej->ibr_version != IBLND_MSG_VERSION &&
+                            rej->ibr_version != IBLND_MSG_VERSION_2 &&
                             rej->ibr_version != IBLND_MSG_VERSION_1) {
                                 CERROR("%s rejected: o2iblnd version %x error\n",
                                        libcfs_nid2str(peer_ni->ibp_nid),
@@ -2969,14 +3287,15 @@ kiblnd_rejected(struct kib_conn *conn, int reason, void *priv, int priv_nob)
                                 break;
                         }
 
-                        if (rej->ibr_why     == IBLND_REJECT_FATAL &&
-                            rej->ibr_version == IBLND_MSG_VERSION_1) {
-                                CDEBUG(D_NET, "rejected by old version peer_ni %s: %x\n",
-                                       libcfs_nid2str(peer_ni->ibp_nid), rej->ibr_version);
+			/* an older peer_ni can't parse my connreq at all, so
+			 * retry with the version it speaks */
+			if (rej->ibr_why     == IBLND_REJECT_FATAL &&
+			    rej->ibr_version <  conn->ibc_version) {
+				CDEBUG(D_NET, "rejected by old version peer_ni %s: %x\n",
+				       libcfs_nid2str(peer_ni->ibp_nid), rej->ibr_version);
 
-                                if (conn->ibc_version != IBLND_MSG_VERSION_1)
-                                        rej->ibr_why = IBLND_REJECT_CONN_UNCOMPAT;
-                        }
+				rej->ibr_why = IBLND_REJECT_CONN_UNCOMPAT;
+			}
 
                         switch (rej->ibr_why) {
                         case IBLND_REJECT_CONN_RACE:
@@ -3700,6 +4019,12 @@ kiblnd_qp_event(struct ib_event *event, void *arg)
 		atomic_set(&conn->ibc_peer->ibp_ni->ni_fatal_error_on, 1);
 		return;
 
+	case IB_EVENT_QP_LAST_WQE_REACHED:
+		/* an SRQ conn's QP has gone to error */
+		CDEBUG(D_NET, "%s: last WQE reached\n",
+		       libcfs_nid2str(conn->ibc_peer->ibp_nid));
+		return;
+
 	case IB_EVENT_PORT_ACTIVE:
 		CERROR("Port reactivated for NI %s\n",
 		       libcfs_nid2str(conn->ibc_peer->ibp_ni->ni_nid));
@@ -3714,7 +4039,7 @@ kiblnd_qp_event(struct ib_event *event, void *arg)
 }
 
 static void
-kiblnd_complete (struct ib_wc *wc)
+kiblnd_complete(struct kib_conn *conn, struct ib_wc *wc)
 {
 	switch (kiblnd_wreqid2type(wc->wr_id)) {
 	default:
@@ -3741,10 +4066,14 @@ kiblnd_complete (struct ib_wc *wc)
                 kiblnd_tx_complete(kiblnd_wreqid2ptr(wc->wr_id), wc->status);
                 return;
 
-        case IBLND_WID_RX:
-                kiblnd_rx_complete(kiblnd_wreqid2ptr(wc->wr_id), wc->status,
-                                   wc->byte_len);
-                return;
+	case IBLND_WID_RX: {
+		struct kib_rx *rx = kiblnd_wreqid2ptr(wc->wr_id);
+
+		if (rx->rx_srq != NULL)
+			kiblnd_srq_attach_rx(conn, rx);
+		kiblnd_rx_complete(rx, wc->status, wc->byte_len);
+		return;
+	}
         }
 }
 
@@ -3766,9 +4095,13 @@ kiblnd_cq_completion(struct ib_cq *cq, void *arg)
 
 	conn->ibc_ready = 1;
 
+	/* a conn on an SRQ can have a receive complete at any time until
+	 * it is disconnected; leftovers are drained when it's destroyed */
 	if (!conn->ibc_scheduled &&
 	    (conn->ibc_nrx > 0 ||
-	     conn->ibc_nsends_posted > 0)) {
+	     conn->ibc_nsends_posted > 0 ||
+	     (conn->ibc_srq != NULL &&
+	      conn->ibc_state < IBLND_CONN_DISCONNECTED))) {
 		kiblnd_conn_addref(conn); /* +1 ref for sched_conns */
 		conn->ibc_scheduled = 1;
 		list_add_tail(&conn->ibc_sched_list, &sched->ibs_conns);
@@ -3902,7 +4235,7 @@ kiblnd_scheduler(void *arg)
 
 			if (rc != 0) {
 				spin_unlock_irqrestore(&sched->ibs_lock, flags);
-				kiblnd_complete(&wc);
+				kiblnd_complete(conn, &wc);
 
 				spin_lock_irqsave(&sched->ibs_lock, flags);
                         }
@@ -186,6 +186,35 @@ static unsigned int wrq_sge = 2;
 module_param(wrq_sge, uint, 0444);
 MODULE_PARM_DESC(wrq_sge, "# scatter/gather element per work request");
 
+static int use_srq;
+module_param(use_srq, int, 0444);
+MODULE_PARM_DESC(use_srq, "share per-CPT receive queues between connections");
+
+static int srq_size = IBLND_SRQ_SIZE_DEFAULT;
+module_param(srq_size, int, 0444);
+MODULE_PARM_DESC(srq_size, "# receive buffers in each per-CPT shared receive queue");
+
+/*
+ * global_rkey lets RDMA use the PD's global rkey instead of registering
+ * (FMR/FastReg) every bulk buffer and invalidating it afterwards.  This
+ * exposes all of this node's memory to remote RDMA from any connected
+ * peer, so only enable it on a trusted fabric.
+ */
+static int global_rkey;
+module_param(global_rkey, int, 0444);
+MODULE_PARM_DESC(global_rkey, "use the unsafe global rkey instead of per-I/O memory registration (trusted fabrics only)");
+
+/*
+ * immediate_pack packs the small immediate messages queued together on a
+ * connection into a single IB message, so a burst of small PUTs takes one
+ * credit and one work request instead of one each.  Only connections to
+ * peers running a protocol version that understands packed messages are
+ * affected.
+ */
+static int immediate_pack;
+module_param(immediate_pack, int, 0644);
+MODULE_PARM_DESC(immediate_pack, "pack small immediate messages queued on a connection (0=off, 1=on)");
+
 struct kib_tunables kiblnd_tunables = {
         .kib_dev_failover           = &dev_failover,
         .kib_service                = &service,
@@ -201,6 +230,10 @@ struct kib_tunables kiblnd_tunables = {
 	.kib_nscheds		    = &nscheds,
 	.kib_wrq_sge		    = &wrq_sge,
 	.kib_use_fastreg_gaps       = &use_fastreg_gaps,
+	.kib_use_srq		    = &use_srq,
+	.kib_srq_size		    = &srq_size,
+	.kib_global_rkey	    = &global_rkey,
+	.kib_immediate_pack	    = &immediate_pack,
 };
 
 static struct lnet_ioctl_config_o2iblnd_tunables default_tunables;
@@ -329,5 +362,8 @@ kiblnd_tunables_init(void)
 	default_tunables.lnd_fmr_cache = fmr_cache;
 	default_tunables.lnd_ntx = ntx;
 	default_tunables.lnd_conns_per_peer = conns_per_peer;
+
+	if (srq_size <= 0)
+		srq_size = IBLND_SRQ_SIZE_DEFAULT;
 	return 0;
 }
@@ -81,6 +81,7 @@ ksocknal_create_route(__u32 ipaddr, int port)
         route->ksnr_deleted = 0;
         route->ksnr_conn_count = 0;
         route->ksnr_share_count = 0;
+	memset(route->ksnr_ctype_conns, 0, sizeof(route->ksnr_ctype_conns));
 
         return (route);
 }
@@ -354,7 +355,10 @@ ksocknal_associate_route_conn_locked(struct ksock_route *route, struct ksock_con
                         iface->ksni_nroutes++;
         }
 
-        route->ksnr_connected |= (1<<type);
+	/* the route only counts as connected for this type once all the
+	 * parallel conns it wants are up; until then connd keeps adding */
+	if (++route->ksnr_ctype_conns[type] >= ksocknal_conns_wanted(type))
+		route->ksnr_connected |= (1 << type);
         route->ksnr_conn_count++;
 
         /* Successful connection => further attempts can
@@ -1207,8 +1211,20 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
         }
 
 	/* Refuse to duplicate an existing connection, unless this is a
-	 * loopback connection */
+	 * loopback connection.  Bulk types may have up to conns_per_peer
+	 * parallel conns; passively accept as many as the peer_ni asks for
+	 * (capped), so both ends need not agree on the tunable. */
 	if (conn->ksnc_ipaddr != conn->ksnc_myipaddr) {
+		int nmatch = 0;
+		int nmax;
+
+		if (active)
+			nmax = ksocknal_conns_wanted(conn->ksnc_type);
+		else if (conn->ksnc_type == SOCKLND_CONN_CONTROL)
+			nmax = 1;
+		else
+			nmax = SOCKNAL_CONNS_PER_PEER_MAX;
+
 		list_for_each(tmp, &peer_ni->ksnp_conns) {
 			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
 
@@ -1217,6 +1233,9 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
                             conn2->ksnc_type != conn->ksnc_type)
                                 continue;
 
+			if (++nmatch < nmax)
+				continue;
+
                         /* Reply on a passive connection attempt so the peer_ni
                          * realises we're connected. */
                         LASSERT (rc == 0);
@@ -1423,8 +1442,6 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
          * Caller holds ksnd_global_lock exclusively in irq context */
 	struct ksock_peer_ni *peer_ni = conn->ksnc_peer;
 	struct ksock_route *route;
-	struct ksock_conn *conn2;
-	struct list_head *tmp;
 
 	LASSERT(peer_ni->ksnp_error == 0);
 	LASSERT(!conn->ksnc_closing);
@@ -1437,19 +1454,10 @@ ksocknal_close_conn_locked(struct ksock_conn *conn, int error)
 	if (route != NULL) {
 		/* dissociate conn from route... */
 		LASSERT(!route->ksnr_deleted);
-		LASSERT((route->ksnr_connected & (1 << conn->ksnc_type)) != 0);
+		LASSERT(route->ksnr_ctype_conns[conn->ksnc_type] > 0);
 
-		conn2 = NULL;
-		list_for_each(tmp, &peer_ni->ksnp_conns) {
-			conn2 = list_entry(tmp, struct ksock_conn, ksnc_list);
-
-			if (conn2->ksnc_route == route &&
-			    conn2->ksnc_type == conn->ksnc_type)
-				break;
-
-			conn2 = NULL;
-		}
-		if (conn2 == NULL)
+		if (--route->ksnr_ctype_conns[conn->ksnc_type] <
+		    ksocknal_conns_wanted(conn->ksnc_type))
 			route->ksnr_connected &= ~(1 << conn->ksnc_type);
 
 		conn->ksnc_route = NULL;
@@ -31,6 +31,7 @@
 #define DEBUG_PORTAL_ALLOC
 #define DEBUG_SUBSYSTEM S_LND
 
+#include <linux/blk_types.h>
 #include <linux/crc32.h>
 #include <linux/errno.h>
 #include <linux/if.h>
@@ -75,6 +76,8 @@
 #define SOCKNAL_INSANITY_RECONN 5000            /* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY    1		/* seconds between retries */
 
+#define SOCKNAL_CONNS_PER_PEER_MAX  16		/* max parallel conns of one type */
+
 #define SOCKNAL_SINGLE_FRAG_TX      0           /* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0           /* disable multi-fragment receives */
 
@@ -133,6 +136,7 @@ struct ksock_tunables {
         int              *ksnd_max_reconnectms; /* ...exponentially increasing to this */
         int              *ksnd_eager_ack;       /* make TCP ack eagerly? */
         int              *ksnd_typed_conns;     /* drive sockets by type? */
+	int		 *ksnd_conns_per_peer;	/* # bulk conns of each type per route */
         int              *ksnd_min_bulk;        /* smallest "large" message */
         int              *ksnd_tx_buffer_size;  /* socket tx buffer size */
         int              *ksnd_rx_buffer_size;  /* socket rx buffer size */
@@ -387,6 +391,8 @@ struct ksock_route {
         unsigned int          ksnr_deleted:1;   /* been removed from peer_ni? */
         unsigned int          ksnr_share_count; /* created explicitly? */
         int                   ksnr_conn_count;  /* # conns established by this route */
+	/* # conns of each type currently established by this route */
+	unsigned int	   ksnr_ctype_conns[SOCKLND_CONN_NTYPES];
 };
 
 #define SOCKNAL_KEEPALIVE_PING          1       /* cookie for keepalive ping */
@@ -483,6 +489,20 @@ ksocknal_route_mask(void)
                 (1 << SOCKLND_CONN_BULK_OUT));
 }
 
+/* # conns of this type a route should establish before it counts as
+ * connected.  Only bulk (and untyped) traffic is spread over parallel
+ * connections; a single CONTROL conn keeps small messages ordered. */
+static inline int
+ksocknal_conns_wanted(int type)
+{
+	int n = *ksocknal_tunables.ksnd_conns_per_peer;
+
+	if (type == SOCKLND_CONN_CONTROL || n <= 1)
+		return 1;
+
+	return min(n, SOCKNAL_CONNS_PER_PEER_MAX);
+}
+
 static inline struct list_head *
 ksocknal_nid2peerlist (lnet_nid_t nid)
 {
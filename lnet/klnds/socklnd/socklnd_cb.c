@@ -395,12 +395,16 @@ ksocknal_receive(struct ksock_conn *conn, struct page **rx_scratch_pgs,
 	RETURN(rc);
 }
 
-void
-ksocknal_tx_done(struct lnet_ni *ni, struct ksock_tx *tx, int rc)
+/*
+ * Release \a tx and queue its lnet message, if any, on \a batch for
+ * lnet_finalize_batch().
+ */
+static void
+ksocknal_tx_done_batch(struct lnet_ni *ni, struct ksock_tx *tx, int rc,
+		       struct list_head *batch)
 {
 	struct lnet_msg *lnetmsg = tx->tx_lnetmsg;
 	enum lnet_msg_hstatus hstatus = tx->tx_hstatus;
-        ENTRY;
 
 	LASSERT(ni != NULL || tx->tx_conn != NULL);
 
@@ -416,8 +420,18 @@ ksocknal_tx_done(struct lnet_ni *ni, struct ksock_tx *tx, int rc)
 	ksocknal_free_tx(tx);
 	if (lnetmsg != NULL) { /* KSOCK_MSG_NOOP go without lnetmsg */
 		lnetmsg->msg_health_status = hstatus;
-		lnet_finalize(lnetmsg, rc);
+		lnet_finalize_batch_add(batch, lnetmsg, rc);
 	}
+}
+
+void
+ksocknal_tx_done(struct lnet_ni *ni, struct ksock_tx *tx, int rc)
+{
+	struct list_head batch = LIST_HEAD_INIT(batch);
+        ENTRY;
+
+	ksocknal_tx_done_batch(ni, tx, rc, &batch);
+	lnet_finalize_batch(&batch);
 
 	EXIT;
 }
@@ -425,6 +439,7 @@ ksocknal_tx_done(struct lnet_ni *ni, struct ksock_tx *tx, int rc)
 void
 ksocknal_txlist_done(struct lnet_ni *ni, struct list_head *txlist, int error)
 {
+	struct list_head batch = LIST_HEAD_INIT(batch);
 	struct ksock_tx *tx;
 
 	while (!list_empty(txlist)) {
@@ -461,8 +476,10 @@ ksocknal_txlist_done(struct lnet_ni *ni, struct list_head *txlist, int error)
 		}
 
 		LASSERT(atomic_read(&tx->tx_refcount) == 1);
-		ksocknal_tx_done(ni, tx, error);
+		ksocknal_tx_done_batch(ni, tx, error, &batch);
 	}
+
+	lnet_finalize_batch(&batch);
 }
 
 static void
@@ -2017,6 +2034,18 @@ ksocknal_connect(struct ksock_route *route)
                                libcfs_nid2str(peer_ni->ksnp_id.nid));
 
 		write_lock_bh(&ksocknal_data.ksnd_global_lock);
+
+		/* The peer_ni refused another parallel conn of a type I
+		 * already have (e.g. it runs with fewer conns_per_peer):
+		 * make do with what is established rather than retrying
+		 * forever. */
+		if (rc == EALREADY && route->ksnr_ctype_conns[type] > 0) {
+			CDEBUG(D_NET, "peer_ni %s: %u conns of type %d\n",
+			       libcfs_nid2str(peer_ni->ksnp_id.nid),
+			       route->ksnr_ctype_conns[type], type);
+			route->ksnr_connected |= (1 << type);
+			retry_later = 0;
+		}
         }
 
         route->ksnr_scheduled = 0;
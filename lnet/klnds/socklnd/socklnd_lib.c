@@ -299,6 +299,63 @@ ksocknal_lib_kiov_vmap(lnet_kiov_t *kiov, int niov,
         return addr;
 }
 
+#ifdef HAVE_SOCK_RECVMSG_ITER
+static int
+ksocknal_lib_recv_bvec(struct ksock_conn *conn, lnet_kiov_t *kiov,
+		       unsigned int niov)
+{
+	struct msghdr msg = {
+		.msg_flags	= 0
+	};
+	unsigned int i;
+	int nob;
+	int sum;
+	int fragnob;
+	int rc;
+	void *base;
+
+	/* lnet_kiov_t is laid out exactly like struct bio_vec */
+	BUILD_BUG_ON(sizeof(lnet_kiov_t) != sizeof(struct bio_vec));
+	BUILD_BUG_ON(offsetof(lnet_kiov_t, kiov_page) !=
+		     offsetof(struct bio_vec, bv_page));
+	BUILD_BUG_ON(offsetof(lnet_kiov_t, kiov_len) !=
+		     offsetof(struct bio_vec, bv_len));
+	BUILD_BUG_ON(offsetof(lnet_kiov_t, kiov_offset) !=
+		     offsetof(struct bio_vec, bv_offset));
+
+	for (nob = i = 0; i < niov; i++)
+		nob += kiov[i].kiov_len;
+
+	LASSERT(nob <= conn->ksnc_rx_nob_wanted);
+
+#ifdef HAVE_IOV_ITER_TYPE
+	iov_iter_bvec(&msg.msg_iter, READ, (struct bio_vec *)kiov, niov, nob);
+#else
+	iov_iter_bvec(&msg.msg_iter, ITER_BVEC | READ, (struct bio_vec *)kiov,
+		      niov, nob);
+#endif
+	rc = sock_recvmsg(conn->ksnc_sock, &msg, MSG_DONTWAIT);
+
+	if (conn->ksnc_msg.ksm_csum != 0) {
+		for (i = 0, sum = rc; sum > 0; i++, sum -= fragnob) {
+			LASSERT(i < niov);
+
+			base = kmap(kiov[i].kiov_page) + kiov[i].kiov_offset;
+			fragnob = kiov[i].kiov_len;
+			if (fragnob > sum)
+				fragnob = sum;
+
+			conn->ksnc_rx_csum = ksocknal_csum(conn->ksnc_rx_csum,
+							   base, fragnob);
+
+			kunmap(kiov[i].kiov_page);
+		}
+	}
+
+	return rc;
+}
+#endif /* HAVE_SOCK_RECVMSG_ITER */
+
 int
 ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
 		       struct kvec *scratchiov)
@@ -333,6 +390,14 @@ ksocknal_lib_recv_kiov(struct ksock_conn *conn, struct page **pages,
 		nob = scratchiov[0].iov_len;
 		n = 1;
 
+#ifdef HAVE_SOCK_RECVMSG_ITER
+	} else if (niov > 1) {
+		/* Let the socket copy straight into the payload pages
+		 * through a bvec iterator: no kmap()/kunmap() of every
+		 * fragment on each pass, and the iterator never modifies
+		 * the kiov array it walks. */
+		return ksocknal_lib_recv_bvec(conn, kiov, niov);
+#endif
 	} else {
 		for (nob = i = 0; i < niov; i++) {
 			nob += scratchiov[i].iov_len = kiov[i].kiov_len;
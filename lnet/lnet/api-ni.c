@@ -121,6 +121,20 @@ module_param_call(lnet_recovery_interval, recovery_interval_set, param_get_int,
 MODULE_PARM_DESC(lnet_recovery_interval,
 		"Interval to recover unhealthy interfaces in seconds");
 
+/*
+ * Recovery pings of an interface which keeps failing them back off
+ * exponentially, up to lnet_max_recovery_ping_interval seconds.
+ */
+unsigned int lnet_max_recovery_ping_interval = 64;
+module_param(lnet_max_recovery_ping_interval, uint, 0644);
+MODULE_PARM_DESC(lnet_max_recovery_ping_interval,
+		 "Maximum interval between recovery pings of an interface in seconds");
+
+unsigned int lnet_recovery_batch = 64;
+module_param(lnet_recovery_batch, uint, 0644);
+MODULE_PARM_DESC(lnet_recovery_batch,
+		 "Maximum number of local and of peer interfaces pinged per recovery pass");
+
 static int lnet_interfaces_max = LNET_INTERFACES_MAX_DEFAULT;
 static int intf_max_set(const char *val, cfs_kernel_param_arg_t *kp);
 
@@ -179,6 +193,21 @@ module_param_call(lnet_drop_asym_route, drop_asym_route_set, param_get_int,
 MODULE_PARM_DESC(lnet_drop_asym_route,
 		 "Set to 1 to drop asymmetrical route messages.");
 
+unsigned int lnet_adaptive_credits;
+module_param(lnet_adaptive_credits, uint, 0644);
+MODULE_PARM_DESC(lnet_adaptive_credits,
+		 "Set to 1 to withhold peer tx credits from slow peers while the NI is congested.");
+
+unsigned int lnet_peer_discovery_nonblocking = 1;
+module_param(lnet_peer_discovery_nonblocking, uint, 0644);
+MODULE_PARM_DESC(lnet_peer_discovery_nonblocking,
+		 "Set to 0 to hold messages to a peer until its discovery completes.");
+
+unsigned int lnet_peer_discovery_max_inflight;
+module_param(lnet_peer_discovery_max_inflight, uint, 0644);
+MODULE_PARM_DESC(lnet_peer_discovery_max_inflight,
+		 "Maximum number of discovery pings and pushes in flight (0 for no limit).");
+
 #define LNET_TRANSACTION_TIMEOUT_NO_HEALTH_DEFAULT 50
 #define LNET_TRANSACTION_TIMEOUT_HEALTH_DEFAULT 50
 
@@ -230,6 +259,7 @@ unsigned lnet_lnd_timeout = LNET_LND_DEFAULT_TIMEOUT;
  * for more details on its usage.
  */
 static atomic_t lnet_dlc_seq_no = ATOMIC_INIT(0);
+static atomic_t lnet_path_gen_no = ATOMIC_INIT(0);
 
 static int lnet_ping(struct lnet_process_id id, signed long timeout,
 		     struct lnet_process_id __user *ids, int n_ids);
@@ -557,6 +587,8 @@ lnet_fini_locks(void)
 struct kmem_cache *lnet_mes_cachep;	   /* MEs kmem_cache */
 struct kmem_cache *lnet_small_mds_cachep;  /* <= LNET_SMALL_MD_SIZE bytes
 					    *  MDs kmem_cache */
+struct kmem_cache *lnet_msgs_cachep;	   /* messages kmem_cache */
+struct cfs_mag_cache *lnet_msgs_mag;	   /* per-CPT free messages */
 
 static int
 lnet_descriptor_setup(void)
@@ -575,6 +607,18 @@ lnet_descriptor_setup(void)
 	if (!lnet_small_mds_cachep)
 		return -ENOMEM;
 
+	lnet_msgs_cachep = kmem_cache_create("lnet_msgs",
+					     sizeof(struct lnet_msg), 0,
+					     SLAB_HWCACHE_ALIGN, NULL);
+	if (!lnet_msgs_cachep)
+		return -ENOMEM;
+
+	lnet_msgs_mag = cfs_mag_cache_create("lnet_msgs", lnet_msgs_cachep,
+					     lnet_cpt_table(),
+					     sizeof(struct lnet_msg));
+	if (!lnet_msgs_mag)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -582,6 +626,16 @@ static void
 lnet_descriptor_cleanup(void)
 {
 
+	if (lnet_msgs_mag) {
+		cfs_mag_cache_destroy(lnet_msgs_mag);
+		lnet_msgs_mag = NULL;
+	}
+
+	if (lnet_msgs_cachep) {
+		kmem_cache_destroy(lnet_msgs_cachep);
+		lnet_msgs_cachep = NULL;
+	}
+
 	if (lnet_small_mds_cachep) {
 		kmem_cache_destroy(lnet_small_mds_cachep);
 		lnet_small_mds_cachep = NULL;
@@ -769,8 +823,8 @@ static void lnet_assert_wire_constants(void)
 	CLASSERT((int)sizeof(((struct lnet_ni_status *)0)->ns_nid) == 8);
 	CLASSERT((int)offsetof(struct lnet_ni_status, ns_status) == 8);
 	CLASSERT((int)sizeof(((struct lnet_ni_status *)0)->ns_status) == 4);
-	CLASSERT((int)offsetof(struct lnet_ni_status, ns_unused) == 12);
-	CLASSERT((int)sizeof(((struct lnet_ni_status *)0)->ns_unused) == 4);
+	CLASSERT((int)offsetof(struct lnet_ni_status, ns_load) == 12);
+	CLASSERT((int)sizeof(((struct lnet_ni_status *)0)->ns_load) == 4);
 
 	/* Checks for struct lnet_ping_info and related constants */
 	CLASSERT(LNET_PROTO_PING_MAGIC == 0x70696E67);
@@ -780,7 +834,8 @@ static void lnet_assert_wire_constants(void)
 	CLASSERT(LNET_PING_FEAT_RTE_DISABLED == 4);
 	CLASSERT(LNET_PING_FEAT_MULTI_RAIL == 8);
 	CLASSERT(LNET_PING_FEAT_DISCOVERY == 16);
-	CLASSERT(LNET_PING_FEAT_BITS == 31);
+	CLASSERT(LNET_PING_FEAT_RTR_LOAD == 32);
+	CLASSERT(LNET_PING_FEAT_BITS == 63);
 
 	/* Checks for struct lnet_ping_info */
 	CLASSERT((int)sizeof(struct lnet_ping_info) == 16);
@@ -877,6 +932,50 @@ lnet_counters_get_common(struct lnet_counters_common *common)
 }
 EXPORT_SYMBOL(lnet_counters_get_common);
 
+/*
+ * Fill \a common with the traffic seen through a single rail: the local
+ * NI \a nid if there is one, otherwise the peer NI \a nid (which may be
+ * a router).  Only the message and byte counts are meaningful.
+ */
+int
+lnet_nid_counters_get(lnet_nid_t nid, struct lnet_counters_common *common)
+{
+	struct lnet_element_stats *stats = NULL;
+	struct lnet_peer_ni *lpni = NULL;
+	struct lnet_ni *ni;
+	int cpt;
+
+	memset(common, 0, sizeof(*common));
+
+	cpt = lnet_net_lock_current();
+	ni = lnet_nid2ni_locked(nid, cpt);
+	if (ni) {
+		stats = &ni->ni_stats;
+	} else {
+		lpni = lnet_find_peer_ni_locked(nid);
+		if (lpni)
+			stats = &lpni->lpni_stats;
+	}
+
+	if (stats) {
+		common->lcc_send_count = lnet_sum_stats(stats,
+							LNET_STATS_TYPE_SEND);
+		common->lcc_recv_count = lnet_sum_stats(stats,
+							LNET_STATS_TYPE_RECV);
+		common->lcc_drop_count = lnet_sum_stats(stats,
+							LNET_STATS_TYPE_DROP);
+		common->lcc_send_length = atomic64_read(&stats->el_send_length);
+		common->lcc_recv_length = atomic64_read(&stats->el_recv_length);
+	}
+
+	if (lpni)
+		lnet_peer_ni_decref_locked(lpni);
+	lnet_net_unlock(cpt);
+
+	return stats ? 0 : -ENOENT;
+}
+EXPORT_SYMBOL(lnet_nid_counters_get);
+
 void
 lnet_counters_get(struct lnet_counters *counters)
 {
@@ -1126,7 +1225,9 @@ lnet_prepare(lnet_pid_t requested_pid)
 {
 	/* Prepare to bring up the network */
 	struct lnet_res_container **recs;
+	struct list_head	 *dc_request;
 	int			  rc = 0;
+	int			  i;
 
 	if (requested_pid == LNET_PID_ANY) {
 		/* Don't instantiate LNET just for me */
@@ -1146,7 +1247,6 @@ lnet_prepare(lnet_pid_t requested_pid)
 	INIT_LIST_HEAD(&the_lnet.ln_routers);
 	INIT_LIST_HEAD(&the_lnet.ln_drop_rules);
 	INIT_LIST_HEAD(&the_lnet.ln_delay_rules);
-	INIT_LIST_HEAD(&the_lnet.ln_dc_request);
 	INIT_LIST_HEAD(&the_lnet.ln_dc_working);
 	INIT_LIST_HEAD(&the_lnet.ln_dc_expired);
 	INIT_LIST_HEAD(&the_lnet.ln_mt_localNIRecovq);
@@ -1176,6 +1276,16 @@ lnet_prepare(lnet_pid_t requested_pid)
 		goto failed;
 	}
 
+	the_lnet.ln_dc_request = cfs_percpt_alloc(lnet_cpt_table(),
+						  sizeof(struct list_head));
+	if (the_lnet.ln_dc_request == NULL) {
+		CERROR("Failed to allocate discovery queues for LNet\n");
+		rc = -ENOMEM;
+		goto failed;
+	}
+	cfs_percpt_for_each(dc_request, i, the_lnet.ln_dc_request)
+		INIT_LIST_HEAD(dc_request);
+
 	rc = lnet_peer_tables_create();
 	if (rc != 0)
 		goto failed;
@@ -1273,6 +1383,10 @@ lnet_unprepare (void)
 		cfs_percpt_free(the_lnet.ln_counters);
 		the_lnet.ln_counters = NULL;
 	}
+	if (the_lnet.ln_dc_request != NULL) {
+		cfs_percpt_free(the_lnet.ln_dc_request);
+		the_lnet.ln_dc_request = NULL;
+	}
 	lnet_destroy_remote_nets_table();
 	lnet_descriptor_cleanup();
 
@@ -1519,7 +1633,8 @@ lnet_ping_target_create(int nnis)
 	pbuf->pb_info.pi_pid = the_lnet.ln_pid;
 	pbuf->pb_info.pi_magic = LNET_PROTO_PING_MAGIC;
 	pbuf->pb_info.pi_features =
-		LNET_PING_FEAT_NI_STATUS | LNET_PING_FEAT_MULTI_RAIL;
+		LNET_PING_FEAT_NI_STATUS | LNET_PING_FEAT_MULTI_RAIL |
+		LNET_PING_FEAT_RTR_LOAD;
 
 	return pbuf;
 }
@@ -1728,6 +1843,8 @@ lnet_ping_target_install_locked(struct lnet_ping_buffer *pbuf)
 			ns->ns_status = (ni->ni_status != NULL) ?
 					 ni->ni_status->ns_status :
 						LNET_NI_STATUS_UP;
+			ns->ns_load = (ni->ni_status != NULL) ?
+				       ni->ni_status->ns_load : 0;
 			ni->ni_status = ns;
 			lnet_ni_unlock(ni);
 
@@ -3429,6 +3546,8 @@ out:
 void lnet_incr_dlc_seq(void)
 {
 	atomic_inc(&lnet_dlc_seq_no);
+	/* a change of the local NIs invalidates every cached pathway */
+	lnet_incr_path_gen();
 }
 
 __u32 lnet_get_dlc_seq_locked(void)
@@ -3436,6 +3555,22 @@ __u32 lnet_get_dlc_seq_locked(void)
 	return atomic_read(&lnet_dlc_seq_no);
 }
 
+/*
+ * The path generation is bumped whenever something that
+ * lnet_select_pathway() depends on for non-MR peers changes: local NIs,
+ * preferred NIDs or the peer/peer_net/peer_ni topology. Cached pathways
+ * stamped with an older generation are ignored.
+ */
+void lnet_incr_path_gen(void)
+{
+	atomic_inc(&lnet_path_gen_no);
+}
+
+__u32 lnet_get_path_gen_locked(void)
+{
+	return atomic_read(&lnet_path_gen_no);
+}
+
 static void
 lnet_ni_set_healthv(lnet_nid_t nid, int value, bool all)
 {
@@ -3494,6 +3629,37 @@ unlock:
 	return rc;
 }
 
+static int
+lnet_get_lat_stats(struct lnet_ioctl_lat_stats *stats)
+{
+	struct lnet_peer_ni *lpni;
+	struct lnet_ni *ni;
+	int cpt, rc = 0;
+
+	cpt = lnet_net_lock_current();
+	if (stats->ls_peer) {
+		lpni = lnet_find_peer_ni_locked(stats->ls_nid);
+		if (!lpni) {
+			rc = -ENOENT;
+			goto unlock;
+		}
+		lnet_usr_translate_lat_stats(stats, &lpni->lpni_lat_stats);
+		lnet_peer_ni_decref_locked(lpni);
+	} else {
+		ni = lnet_nid2ni_locked(stats->ls_nid, cpt);
+		if (!ni) {
+			rc = -ENOENT;
+			goto unlock;
+		}
+		lnet_usr_translate_lat_stats(stats, &ni->ni_lat_stats);
+	}
+
+unlock:
+	lnet_net_unlock(cpt);
+
+	return rc;
+}
+
 static int
 lnet_get_local_ni_recovery_list(struct lnet_ioctl_recovery_list *list)
 {
@@ -3728,16 +3894,20 @@ LNetCtl(unsigned int cmd, void *arg)
 	case IOC_LIBCFS_GET_BUF: {
 		struct lnet_ioctl_pool_cfg *pool_cfg;
 		size_t total = sizeof(*config) + sizeof(*pool_cfg);
+		size_t min = sizeof(*config) +
+			     offsetof(struct lnet_ioctl_pool_cfg, pl_padding);
 
 		config = arg;
 
-		if (config->cfg_hdr.ioc_len < total)
+		/* older tools don't know about pl_nwaits */
+		if (config->cfg_hdr.ioc_len < min)
 			return -EINVAL;
 
 		pool_cfg = (struct lnet_ioctl_pool_cfg *)config->cfg_bulk;
 
 		mutex_lock(&the_lnet.ln_api_mutex);
-		rc = lnet_get_rtr_pool_cfg(config->cfg_count, pool_cfg);
+		rc = lnet_get_rtr_pool_cfg(config->cfg_count, pool_cfg,
+					   config->cfg_hdr.ioc_len >= total);
 		mutex_unlock(&the_lnet.ln_api_mutex);
 		return rc;
 	}
@@ -3755,6 +3925,19 @@ LNetCtl(unsigned int cmd, void *arg)
 		return rc;
 	}
 
+	case IOC_LIBCFS_GET_LAT_STATS: {
+		struct lnet_ioctl_lat_stats *stats = arg;
+
+		if (stats->ls_hdr.ioc_len < sizeof(*stats))
+			return -EINVAL;
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		rc = lnet_get_lat_stats(stats);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+
+		return rc;
+	}
+
 	case IOC_LIBCFS_GET_RECOVERY_QUEUE: {
 		struct lnet_ioctl_recovery_list *list = arg;
 		if (list->rlst_hdr.ioc_len < sizeof(*list))
@@ -189,6 +189,30 @@ out:
 	return cpt;
 }
 
+/*
+ * Fill the copy of the page fragments of \a lmd where the fragments of
+ * physically contiguous pages are merged, for the LNDs which take
+ * multi-page fragments.  The MD keeps its original fragments for the
+ * others.
+ */
+static void
+lnet_md_merge_kiov(struct lnet_libmd *lmd)
+{
+	lnet_kiov_t *kiov = lmd->md_iov.kiov;
+	lnet_kiov_t *merged = &kiov[lmd->md_niov];
+	unsigned int i;
+
+	*merged = kiov[0];
+	for (i = 1; i < lmd->md_niov; i++) {
+		if (lnet_kiov_contiguous(&kiov[i - 1], &kiov[i]))
+			merged->kiov_len += kiov[i].kiov_len;
+		else
+			*++merged = kiov[i];
+	}
+
+	LASSERT(merged - &kiov[lmd->md_niov] + 1 == lmd->md_nmerged);
+}
+
 static int
 lnet_md_build(struct lnet_libmd *lmd, struct lnet_md *umd, int unlink)
 {
@@ -248,6 +272,9 @@ lnet_md_build(struct lnet_libmd *lmd, struct lnet_md *umd, int unlink)
 
 		lmd->md_length = total_length;
 
+		if (lmd->md_nmerged != 0)
+			lnet_md_merge_kiov(lmd);
+
 		if ((umd->options & LNET_MD_MAX_SIZE) != 0 && /* max size used */
 		    (umd->max_size < 0 ||
 		     umd->max_size > total_length)) // illegal max_size
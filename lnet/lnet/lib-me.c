@@ -105,7 +105,7 @@ LNetMEAttach(unsigned int portal,
 	lnet_res_lh_initialize(the_lnet.ln_me_containers[mtable->mt_cpt],
 			       &me->me_lh);
 	if (ignore_bits != 0)
-		head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
+		head = lnet_mt_ignore_head(mtable);
 	else
 		head = lnet_mt_match_head(mtable, match_id, match_bits);
 
@@ -117,7 +117,12 @@ LNetMEAttach(unsigned int portal,
 
 	lnet_me2handle(handle, me);
 
+	if (lnet_ptl_is_unique(the_lnet.ln_portals[portal]))
+		mtable->mt_nme++;
+
 	lnet_res_unlock(mtable->mt_cpt);
+
+	lnet_mt_grow(mtable);
 	return 0;
 }
 EXPORT_SYMBOL(LNetMEAttach);
@@ -258,8 +263,16 @@ EXPORT_SYMBOL(LNetMEUnlink);
 void
 lnet_me_unlink(struct lnet_me *me)
 {
+	struct lnet_portal *ptl = the_lnet.ln_portals[me->me_portal];
+
 	list_del(&me->me_list);
 
+	if (lnet_ptl_is_unique(ptl)) {
+		int cpt = lnet_cpt_of_cookie(me->me_lh.lh_cookie);
+
+		ptl->ptl_mtables[cpt]->mt_nme--;
+	}
+
 	if (me->me_md != NULL) {
 		struct lnet_libmd *md = me->me_md;
 
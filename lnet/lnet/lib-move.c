@@ -159,6 +159,44 @@ void lnet_usr_translate_stats(struct lnet_ioctl_element_msg_stats *msg_stats,
 	assign_stats(&msg_stats->im_drop_stats, counts);
 }
 
+static inline int
+lnet_lat_bucket(s64 usec)
+{
+	if (usec <= 0)
+		return 0;
+
+	return min_t(int, fls64(usec), LNET_LAT_HIST_NBUCKETS - 1);
+}
+
+static void
+lnet_incr_lat_stats(struct lnet_lat_stats *stats, s64 wait, s64 send)
+{
+	atomic_inc(&stats->ls_wait[lnet_lat_bucket(wait)]);
+	atomic_inc(&stats->ls_send[lnet_lat_bucket(send)]);
+}
+
+/*
+ * Copy the latency histograms out to \a lat_stats, clearing them on the
+ * way if the caller asked for a reset.
+ */
+void lnet_usr_translate_lat_stats(struct lnet_ioctl_lat_stats *lat_stats,
+				  struct lnet_lat_stats *stats)
+{
+	int i;
+
+	for (i = 0; i < LNET_LAT_HIST_NBUCKETS; i++) {
+		if (lat_stats->ls_reset) {
+			lat_stats->ls_send[i] =
+				atomic_xchg(&stats->ls_send[i], 0);
+			lat_stats->ls_wait[i] =
+				atomic_xchg(&stats->ls_wait[i], 0);
+		} else {
+			lat_stats->ls_send[i] = atomic_read(&stats->ls_send[i]);
+			lat_stats->ls_wait[i] = atomic_read(&stats->ls_wait[i]);
+		}
+	}
+}
+
 int
 lnet_fail_nid(lnet_nid_t nid, unsigned int threshold)
 {
@@ -408,6 +446,8 @@ lnet_copy_kiov2kiov(unsigned int ndiov, lnet_kiov_t *diov, unsigned int doffset,
 {
 	/* NB diov, siov are READ-ONLY */
 	unsigned int	this_nob;
+	struct page    *dpage = NULL;
+	struct page    *spage = NULL;
 	char	       *daddr = NULL;
 	char	       *saddr = NULL;
 
@@ -438,13 +478,19 @@ lnet_copy_kiov2kiov(unsigned int ndiov, lnet_kiov_t *diov, unsigned int doffset,
 		this_nob = MIN(diov->kiov_len - doffset,
 			       siov->kiov_len - soffset);
 		this_nob = MIN(this_nob, nob);
+		this_nob = MIN(this_nob, lnet_kiov_page_nob(diov, doffset));
+		this_nob = MIN(this_nob, lnet_kiov_page_nob(siov, soffset));
 
-		if (daddr == NULL)
-			daddr = ((char *)kmap(diov->kiov_page)) +
-				diov->kiov_offset + doffset;
-		if (saddr == NULL)
-			saddr = ((char *)kmap(siov->kiov_page)) +
-				siov->kiov_offset + soffset;
+		if (daddr == NULL) {
+			dpage = lnet_kiov_page(diov, doffset);
+			daddr = ((char *)kmap(dpage)) +
+				((diov->kiov_offset + doffset) & ~PAGE_MASK);
+		}
+		if (saddr == NULL) {
+			spage = lnet_kiov_page(siov, soffset);
+			saddr = ((char *)kmap(spage)) +
+				((siov->kiov_offset + soffset) & ~PAGE_MASK);
+		}
 
 		/* Vanishing risk of kmap deadlock when mapping 2 pages.
 		 * However in practice at least one of the kiovs will be mapped
@@ -456,8 +502,12 @@ lnet_copy_kiov2kiov(unsigned int ndiov, lnet_kiov_t *diov, unsigned int doffset,
 		if (diov->kiov_len > doffset + this_nob) {
 			daddr += this_nob;
 			doffset += this_nob;
+			if (lnet_kiov_page_nob(diov, doffset) == PAGE_SIZE) {
+				kunmap(dpage);
+				daddr = NULL;
+			}
 		} else {
-			kunmap(diov->kiov_page);
+			kunmap(dpage);
 			daddr = NULL;
 			diov++;
 			ndiov--;
@@ -467,8 +517,12 @@ lnet_copy_kiov2kiov(unsigned int ndiov, lnet_kiov_t *diov, unsigned int doffset,
 		if (siov->kiov_len > soffset + this_nob) {
 			saddr += this_nob;
 			soffset += this_nob;
+			if (lnet_kiov_page_nob(siov, soffset) == PAGE_SIZE) {
+				kunmap(spage);
+				saddr = NULL;
+			}
 		} else {
-			kunmap(siov->kiov_page);
+			kunmap(spage);
 			saddr = NULL;
 			siov++;
 			nsiov--;
@@ -477,9 +531,9 @@ lnet_copy_kiov2kiov(unsigned int ndiov, lnet_kiov_t *diov, unsigned int doffset,
 	} while (nob > 0);
 
 	if (daddr != NULL)
-		kunmap(diov->kiov_page);
+		kunmap(dpage);
 	if (saddr != NULL)
-		kunmap(siov->kiov_page);
+		kunmap(spage);
 }
 EXPORT_SYMBOL(lnet_copy_kiov2kiov);
 
@@ -490,6 +544,7 @@ lnet_copy_kiov2iov (unsigned int niov, struct kvec *iov, unsigned int iovoffset,
 {
 	/* NB iov, kiov are READ-ONLY */
 	unsigned int	this_nob;
+	struct page    *page = NULL;
 	char	       *addr = NULL;
 
 	if (nob == 0)
@@ -519,10 +574,13 @@ lnet_copy_kiov2iov (unsigned int niov, struct kvec *iov, unsigned int iovoffset,
 		this_nob = MIN(iov->iov_len - iovoffset,
 			       kiov->kiov_len - kiovoffset);
 		this_nob = MIN(this_nob, nob);
+		this_nob = MIN(this_nob, lnet_kiov_page_nob(kiov, kiovoffset));
 
-		if (addr == NULL)
-			addr = ((char *)kmap(kiov->kiov_page)) +
-				kiov->kiov_offset + kiovoffset;
+		if (addr == NULL) {
+			page = lnet_kiov_page(kiov, kiovoffset);
+			addr = ((char *)kmap(page)) +
+			       ((kiov->kiov_offset + kiovoffset) & ~PAGE_MASK);
+		}
 
 		memcpy((char *)iov->iov_base + iovoffset, addr, this_nob);
 		nob -= this_nob;
@@ -538,8 +596,12 @@ lnet_copy_kiov2iov (unsigned int niov, struct kvec *iov, unsigned int iovoffset,
 		if (kiov->kiov_len > kiovoffset + this_nob) {
 			addr += this_nob;
 			kiovoffset += this_nob;
+			if (lnet_kiov_page_nob(kiov, kiovoffset) == PAGE_SIZE) {
+				kunmap(page);
+				addr = NULL;
+			}
 		} else {
-			kunmap(kiov->kiov_page);
+			kunmap(page);
 			addr = NULL;
 			kiov++;
 			nkiov--;
@@ -549,7 +611,7 @@ lnet_copy_kiov2iov (unsigned int niov, struct kvec *iov, unsigned int iovoffset,
 	} while (nob > 0);
 
 	if (addr != NULL)
-		kunmap(kiov->kiov_page);
+		kunmap(page);
 }
 EXPORT_SYMBOL(lnet_copy_kiov2iov);
 
@@ -560,6 +622,7 @@ lnet_copy_iov2kiov(unsigned int nkiov, lnet_kiov_t *kiov, unsigned int kiovoffse
 {
 	/* NB kiov, iov are READ-ONLY */
 	unsigned int	this_nob;
+	struct page    *page = NULL;
 	char	       *addr = NULL;
 
 	if (nob == 0)
@@ -589,10 +652,13 @@ lnet_copy_iov2kiov(unsigned int nkiov, lnet_kiov_t *kiov, unsigned int kiovoffse
 		this_nob = MIN(kiov->kiov_len - kiovoffset,
 			       iov->iov_len - iovoffset);
 		this_nob = MIN(this_nob, nob);
+		this_nob = MIN(this_nob, lnet_kiov_page_nob(kiov, kiovoffset));
 
-		if (addr == NULL)
-			addr = ((char *)kmap(kiov->kiov_page)) +
-				kiov->kiov_offset + kiovoffset;
+		if (addr == NULL) {
+			page = lnet_kiov_page(kiov, kiovoffset);
+			addr = ((char *)kmap(page)) +
+			       ((kiov->kiov_offset + kiovoffset) & ~PAGE_MASK);
+		}
 
 		memcpy (addr, (char *)iov->iov_base + iovoffset, this_nob);
 		nob -= this_nob;
@@ -600,8 +666,12 @@ lnet_copy_iov2kiov(unsigned int nkiov, lnet_kiov_t *kiov, unsigned int kiovoffse
 		if (kiov->kiov_len > kiovoffset + this_nob) {
 			addr += this_nob;
 			kiovoffset += this_nob;
+			if (lnet_kiov_page_nob(kiov, kiovoffset) == PAGE_SIZE) {
+				kunmap(page);
+				addr = NULL;
+			}
 		} else {
-			kunmap(kiov->kiov_page);
+			kunmap(page);
 			addr = NULL;
 			kiov++;
 			nkiov--;
@@ -618,7 +688,7 @@ lnet_copy_iov2kiov(unsigned int nkiov, lnet_kiov_t *kiov, unsigned int kiovoffse
 	} while (nob > 0);
 
 	if (addr != NULL)
-		kunmap(kiov->kiov_page);
+		kunmap(page);
 }
 EXPORT_SYMBOL(lnet_copy_iov2kiov);
 
@@ -650,17 +720,15 @@ lnet_extract_kiov(int dst_niov, lnet_kiov_t *dst,
 		LASSERT((int)niov <= dst_niov);
 
 		frag_len = src->kiov_len - offset;
-		dst->kiov_page = src->kiov_page;
-		dst->kiov_offset = src->kiov_offset + offset;
+		dst->kiov_page = lnet_kiov_page(src, offset);
+		dst->kiov_offset = (src->kiov_offset + offset) & ~PAGE_MASK;
 
 		if (len <= frag_len) {
 			dst->kiov_len = len;
-			LASSERT(dst->kiov_offset + dst->kiov_len <= PAGE_SIZE);
 			return niov;
 		}
 
 		dst->kiov_len = frag_len;
-		LASSERT(dst->kiov_offset + dst->kiov_len <= PAGE_SIZE);
 
 		len -= frag_len;
 		dst++;
@@ -672,6 +740,29 @@ lnet_extract_kiov(int dst_niov, lnet_kiov_t *dst,
 }
 EXPORT_SYMBOL(lnet_extract_kiov);
 
+/*
+ * Give the merged page fragments of the MD of \a msg to an LND taking
+ * fragments of several contiguous pages, so that it describes the payload
+ * with fewer fragments.
+ */
+static inline void
+lnet_msg_fit_kiov(struct lnet_ni *ni, struct lnet_msg *msg)
+{
+	struct lnet_libmd *md = msg->msg_md;
+
+	if (msg->msg_kiov == NULL || md == NULL || md->md_nmerged == 0)
+		return;
+
+	/* a resent message may go over an NI of another LND */
+	if (ni->ni_net->net_lnd->lnd_multipage_kiov) {
+		msg->msg_kiov = &md->md_iov.kiov[md->md_niov];
+		msg->msg_niov = md->md_nmerged;
+	} else {
+		msg->msg_kiov = md->md_iov.kiov;
+		msg->msg_niov = md->md_niov;
+	}
+}
+
 void
 lnet_ni_recv(struct lnet_ni *ni, void *private, struct lnet_msg *msg,
 	     int delayed, unsigned int offset, unsigned int mlen,
@@ -696,6 +787,7 @@ lnet_ni_recv(struct lnet_ni *ni, void *private, struct lnet_msg *msg,
 		msg->msg_receiving = 0;
 
 		if (mlen != 0) {
+			lnet_msg_fit_kiov(ni, msg);
 			niov = msg->msg_niov;
 			iov  = msg->msg_iov;
 			kiov = msg->msg_kiov;
@@ -763,6 +855,7 @@ lnet_ni_send(struct lnet_ni *ni, struct lnet_msg *msg)
 	LASSERT(ni->ni_nid == LNET_NID_LO_0 ||
 		(msg->msg_txcredit && msg->msg_peertxcredit));
 
+	lnet_msg_fit_kiov(ni, msg);
 	rc = (ni->ni_net->net_lnd->lnd_send)(ni, priv, msg);
 	if (rc < 0) {
 		msg->msg_no_resend = true;
@@ -941,6 +1034,10 @@ lnet_post_send_locked(struct lnet_msg *msg, int do_send)
 	/* can't get here if we're sending to the loopback interface */
 	LASSERT(lp->lpni_nid != the_lnet.ln_loni->ni_nid);
 
+	/* start of the credit wait, for the latency histograms */
+	if (ktime_to_ns(msg->msg_post_time) == 0)
+		msg->msg_post_time = ktime_get();
+
 	/* NB 'lp' is always the next hop */
 	if ((msg->msg_target.pid & LNET_PID_USERFLAG) == 0 &&
 	    lnet_peer_alive_locked(ni, lp, msg) == 0) {
@@ -1032,6 +1129,7 @@ lnet_post_send_locked(struct lnet_msg *msg, int do_send)
 
 	/* unset the tx_delay flag as we're going to send it now */
 	msg->msg_tx_delayed = 0;
+	msg->msg_send_time = ktime_get();
 
 	if (do_send) {
 		lnet_net_unlock(cpt);
@@ -1111,11 +1209,14 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_autosize_mincredits)
+			rbp->rbp_autosize_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
 			LASSERT(msg->msg_rx_ready_delay);
 			msg->msg_rx_delayed = 1;
+			rbp->rbp_nwaits++;
 			list_add_tail(&msg->msg_list, &rbp->rbp_msgs);
 			return LNET_CREDIT_WAIT;
 		}
@@ -1142,6 +1243,58 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 	return LNET_CREDIT_OK;
 }
 
+static inline __u32
+lnet_lat_avg(__u32 avg, __u32 lat)
+{
+	return avg == 0 ? lat : avg - (avg >> 3) + (lat >> 3);
+}
+
+/*
+ * Account for a completed send to \a lpni and decide how many peer tx
+ * credits to give back (0, 1 or 2).  With lnet_adaptive_credits set and
+ * sends waiting for NI credits, a peer NI whose sends take more than
+ * twice the NI average to complete keeps a credit back (down to a
+ * quarter of peer_credits), so the NI credits go to peers that complete
+ * quickly.  Withheld credits are returned once the peer NI catches up
+ * or the NI is no longer congested.
+ */
+static int
+lnet_peer_tx_credits_adapt_locked(struct lnet_peer_ni *lpni,
+				  struct lnet_ni *ni, struct lnet_msg *msg)
+{
+	struct lnet_tx_queue *tq = ni->ni_tx_queues[msg->msg_tx_cpt];
+	bool congested = tq->tq_credits < 0;
+	__u32 ni_lat;
+	s64 lat;
+	int maxcr;
+
+	if (ktime_to_ns(msg->msg_send_time) != 0) {
+		lat = ktime_us_delta(ktime_get(), msg->msg_send_time);
+		lat = clamp_t(s64, lat, 0, UINT_MAX);
+		lpni->lpni_tx_lat_avg = lnet_lat_avg(lpni->lpni_tx_lat_avg, lat);
+		ni->ni_tx_lat_avg = lnet_lat_avg(ni->ni_tx_lat_avg, lat);
+	}
+	ni_lat = READ_ONCE(ni->ni_tx_lat_avg);
+
+	if (lnet_adaptive_credits && lpni->lpni_net != NULL && congested &&
+	    lpni->lpni_tx_lat_avg / 2 > ni_lat) {
+		maxcr = lpni->lpni_net->net_tunables.lct_peer_tx_credits;
+		if (maxcr - lpni->lpni_txcredits_held > max(1, maxcr / 4)) {
+			lpni->lpni_txcredits_held++;
+			return 0;
+		}
+	}
+
+	if (lpni->lpni_txcredits_held > 0 &&
+	    (!lnet_adaptive_credits || !congested ||
+	     lpni->lpni_tx_lat_avg <= ni_lat)) {
+		lpni->lpni_txcredits_held--;
+		return 2;
+	}
+
+	return 1;
+}
+
 void
 lnet_return_tx_credits_locked(struct lnet_msg *msg)
 {
@@ -1175,6 +1328,8 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 	}
 
 	if (msg->msg_peertxcredit) {
+		int ncredits;
+
 		/* give back peer txcredits */
 		msg->msg_peertxcredit = 0;
 
@@ -1185,10 +1340,14 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 		txpeer->lpni_txqnob -= msg->msg_len + sizeof(struct lnet_hdr);
 		LASSERT(txpeer->lpni_txqnob >= 0);
 
-		txpeer->lpni_txcredits++;
-		if (txpeer->lpni_txcredits <= 0) {
+		ncredits = lnet_peer_tx_credits_adapt_locked(txpeer, txni, msg);
+		while (ncredits-- > 0) {
 			int msg2_cpt;
 
+			txpeer->lpni_txcredits++;
+			if (txpeer->lpni_txcredits > 0)
+				continue;
+
 			msg2 = list_entry(txpeer->lpni_txq.next,
 					      struct lnet_msg, msg_list);
 			list_del(&msg2->msg_list);
@@ -1219,11 +1378,27 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 				lnet_net_unlock(msg2_cpt);
 				lnet_net_lock(msg->msg_tx_cpt);
 			}
-                } else {
-			spin_unlock(&txpeer->lpni_lock);
+			spin_lock(&txpeer->lpni_lock);
 		}
+		spin_unlock(&txpeer->lpni_lock);
         }
 
+	if (ktime_to_ns(msg->msg_send_time) != 0) {
+		s64 wait = ktime_us_delta(msg->msg_send_time,
+					  msg->msg_post_time);
+		s64 send = ktime_us_delta(ktime_get(), msg->msg_send_time);
+
+		if (txni != NULL)
+			lnet_incr_lat_stats(&txni->ni_lat_stats, wait, send);
+		if (txpeer != NULL)
+			lnet_incr_lat_stats(&txpeer->lpni_lat_stats,
+					    wait, send);
+
+		/* a resend is measured from scratch */
+		msg->msg_send_time = ktime_set(0, 0);
+		msg->msg_post_time = ktime_set(0, 0);
+	}
+
 	if (txni != NULL) {
 		msg->msg_txni = NULL;
 		lnet_ni_decref_locked(txni, msg->msg_tx_cpt);
@@ -1377,14 +1552,12 @@ lnet_compare_peers(struct lnet_peer_ni *p1, struct lnet_peer_ni *p2)
 	return 0;
 }
 
+/* compare routes by priority and hops only, 0 if they are equivalent */
 static int
-lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2)
+lnet_compare_route_tiers(struct lnet_route *r1, struct lnet_route *r2)
 {
-	struct lnet_peer_ni *p1 = r1->lr_gateway;
-	struct lnet_peer_ni *p2 = r2->lr_gateway;
 	int r1_hops = (r1->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r1->lr_hops;
 	int r2_hops = (r2->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r2->lr_hops;
-	int rc;
 
 	if (r1->lr_priority < r2->lr_priority)
 		return 1;
@@ -1398,6 +1571,20 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2)
 	if (r1_hops > r2_hops)
 		return -1;
 
+	return 0;
+}
+
+static int
+lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2)
+{
+	struct lnet_peer_ni *p1 = r1->lr_gateway;
+	struct lnet_peer_ni *p2 = r2->lr_gateway;
+	int rc;
+
+	rc = lnet_compare_route_tiers(r1, r2);
+	if (rc)
+		return rc;
+
 	rc = lnet_compare_peers(p1, p2);
 	if (rc)
 		return rc;
@@ -1408,6 +1595,73 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2)
 	return -1;
 }
 
+/* RTT under which routers are considered equally close, in usecs */
+#define LNET_ROUTE_RTT_MIN	64
+/* weighted round-robin state is reset beyond this, see below */
+#define LNET_ROUTE_CUR_WEIGHT_MAX	(1 << 24)
+
+/*
+ * The share of traffic \a route should get: the idle fraction of its
+ * gateway, as reported in router pings, divided by the RTT of those pings
+ * and by the messages already queued to the gateway here.
+ */
+static int
+lnet_route_weight(struct lnet_route *route)
+{
+	struct lnet_peer_ni *gw = route->lr_gateway;
+	unsigned int rtt = max_t(unsigned int, gw->lpni_ping_rtt,
+				 LNET_ROUTE_RTT_MIN);
+	int weight;
+
+	weight = (101 - min(route->lr_load, 100U)) * 256 *
+		 LNET_ROUTE_RTT_MIN / rtt;
+	if (gw->lpni_txcredits < 0)
+		weight /= 1 - gw->lpni_txcredits;
+
+	return max(weight, 1);
+}
+
+/*
+ * Smooth weighted round-robin over the routes as good as \a best by
+ * priority and hops: every pick adds each candidate's weight to its
+ * current weight and takes the total off the winner's, so each route is
+ * picked in proportion to its weight and the picks are interleaved.
+ */
+static struct lnet_route *
+lnet_pick_weighted_route_locked(struct lnet_remotenet *rnet,
+				struct lnet_net *net, struct lnet_route *best)
+{
+	struct lnet_route *route;
+	struct lnet_route *pick = best;
+	int total = 0;
+	int weight;
+
+	/* no protection on lr_cur_weight either, it's racy but harmless */
+	list_for_each_entry(route, &rnet->lrn_routes, lr_list) {
+		if (!lnet_is_route_alive(route))
+			continue;
+
+		if (net != NULL && route->lr_gateway->lpni_net != net)
+			continue;
+
+		if (lnet_compare_route_tiers(route, best) != 0)
+			continue;
+
+		/* lost updates can make it drift, start over if so */
+		if (abs(route->lr_cur_weight) > LNET_ROUTE_CUR_WEIGHT_MAX)
+			route->lr_cur_weight = 0;
+
+		weight = lnet_route_weight(route);
+		route->lr_cur_weight += weight;
+		total += weight;
+		if (route->lr_cur_weight > pick->lr_cur_weight)
+			pick = route;
+	}
+
+	pick->lr_cur_weight -= total;
+	return pick;
+}
+
 static struct lnet_peer_ni *
 lnet_find_route_locked(struct lnet_net *net, __u32 remote_net,
 		       lnet_nid_t rtr_nid)
@@ -1459,6 +1713,12 @@ lnet_find_route_locked(struct lnet_net *net, __u32 remote_net,
 		lpni_best = lp;
 	}
 
+	if (best_route != NULL && weighted_routes) {
+		best_route = lnet_pick_weighted_route_locked(rnet, net,
+							     best_route);
+		return best_route->lr_gateway;
+	}
+
 	/* set sequence number on the best router to the latest sequence + 1
 	 * so we can round-robin all routers, it's race and inaccurate but
 	 * harmless and functional  */
@@ -2174,9 +2434,46 @@ lnet_find_existing_preferred_best_ni(struct lnet_send_data *sd)
 	return best_ni;
 }
 
-/* Prerequisite: sd->sd_peer and sd->sd_best_lpni should be set */
+/*
+ * Look up the local NI cached for this peer_ni on the current CPT.
+ * Returns NULL if nothing was cached or the cached entry is stale.
+ */
+static inline struct lnet_ni *
+lnet_path_cache_lookup(struct lnet_send_data *sd)
+{
+	struct lnet_path_cache *lpc;
+
+	lpc = &sd->sd_best_lpni->lpni_path_cache[sd->sd_cpt];
+	if (!lpc->lpc_ni || lpc->lpc_gen != lnet_get_path_gen_locked())
+		return NULL;
+
+	return lpc->lpc_ni;
+}
+
+/*
+ * Remember the local NI selected for this peer_ni. gen must have been
+ * sampled before the selection was made, so that a concurrent change
+ * leaves the entry stale rather than wrongly valid.
+ */
+static inline void
+lnet_path_cache_store(struct lnet_send_data *sd, __u32 gen)
+{
+	struct lnet_path_cache *lpc;
+
+	lpc = &sd->sd_best_lpni->lpni_path_cache[sd->sd_cpt];
+	lpc->lpc_ni = sd->sd_best_ni;
+	lpc->lpc_gen = gen;
+}
+
+/*
+ * Prerequisite: sd->sd_peer and sd->sd_best_lpni should be set
+ *
+ * If cacheable is not NULL it is set to true when the NI was found from
+ * an existing preference, meaning that the same NI will be picked again
+ * until the path generation changes.
+ */
 static int
-lnet_select_preferred_best_ni(struct lnet_send_data *sd)
+lnet_select_preferred_best_ni(struct lnet_send_data *sd, bool *cacheable)
 {
 	struct lnet_ni *best_ni = NULL;
 	struct lnet_peer_ni *best_lpni = sd->sd_best_lpni;
@@ -2193,6 +2490,8 @@ lnet_select_preferred_best_ni(struct lnet_send_data *sd)
 	 */
 
 	best_ni = lnet_find_existing_preferred_best_ni(sd);
+	if (cacheable)
+		*cacheable = best_ni != NULL;
 
 	/* if best_ni is still not set just pick one */
 	if (!best_ni) {
@@ -2231,6 +2530,8 @@ lnet_select_preferred_best_ni(struct lnet_send_data *sd)
 static int
 lnet_handle_any_local_nmr_dst(struct lnet_send_data *sd)
 {
+	bool cacheable = false;
+	__u32 gen;
 	int rc;
 
 	/* sd->sd_best_lpni is already set to the final destination */
@@ -2248,11 +2549,25 @@ lnet_handle_any_local_nmr_dst(struct lnet_send_data *sd)
 		return -EFAULT;
 	}
 
-	rc = lnet_select_preferred_best_ni(sd);
-	if (!rc)
-		rc = lnet_handle_send(sd);
+	/*
+	 * The local NI used for a non-MR peer only depends on the
+	 * preferred NIDs of the peer_nis on its net, so in the steady
+	 * state it can be taken from the per-CPT cache without walking
+	 * the peer and the local nets again.
+	 */
+	sd->sd_best_ni = lnet_path_cache_lookup(sd);
+	if (sd->sd_best_ni)
+		return lnet_handle_send(sd);
 
-	return rc;
+	gen = lnet_get_path_gen_locked();
+	rc = lnet_select_preferred_best_ni(sd, &cacheable);
+	if (rc)
+		return rc;
+
+	if (cacheable)
+		lnet_path_cache_store(sd, gen);
+
+	return lnet_handle_send(sd);
 }
 
 static int
@@ -2572,6 +2887,7 @@ again:
 	 * continuing the same sequence of messages.
 	 */
 	msg->msg_src_nid_param = src_nid;
+	msg->msg_rtr_nid_param = rtr_nid;
 
 	/*
 	 * Now that we have a peer_ni, check if we want to discover
@@ -2579,7 +2895,26 @@ again:
 	 * trigger discovery.
 	 */
 	peer = lpni->lpni_peer_net->lpn_peer;
-	if (lnet_msg_discovery(msg) && !lnet_peer_is_uptodate(peer)) {
+	if (lnet_msg_discovery(msg) && !lnet_peer_is_uptodate(peer) &&
+	    lnet_peer_discovery_nonblocking) {
+		/*
+		 * Send on the NID we already know about while discovery
+		 * runs in the background. Only kick discovery if it isn't
+		 * already underway, to keep the exclusive lock (taken by
+		 * lnet_discover_peer_locked()) off the send path. A
+		 * discovery failure is no reason to fail this send.
+		 */
+		if (!lnet_peer_is_discovering(peer)) {
+			rc = lnet_discover_peer_locked(lpni, cpt, false);
+			if (rc == -ESHUTDOWN) {
+				lnet_peer_ni_decref_locked(lpni);
+				lnet_net_unlock(cpt);
+				return rc;
+			}
+			/* The peer may have changed. */
+			peer = lpni->lpni_peer_net->lpn_peer;
+		}
+	} else if (lnet_msg_discovery(msg) && !lnet_peer_is_uptodate(peer)) {
 		lnet_nid_t primary_nid;
 		rc = lnet_discover_peer_locked(lpni, cpt, false);
 		if (rc) {
@@ -2590,7 +2925,6 @@ again:
 		/* The peer may have changed. */
 		peer = lpni->lpni_peer_net->lpn_peer;
 		/* queue message and return */
-		msg->msg_rtr_nid_param = rtr_nid;
 		msg->msg_sending = 0;
 		spin_lock(&peer->lp_lock);
 		list_add_tail(&msg->msg_list, &peer->lp_dc_pendq);
@@ -2942,6 +3276,7 @@ lnet_resend_pending_msgs_locked(struct list_head *resendq, int cpt)
 			/*
 			 * If we originally specified a src NID, then we
 			 * must attempt to reuse it in the resend as well.
+			 * The same goes for a pre-determined router.
 			 */
 			if (msg->msg_src_nid_param != LNET_NID_ANY)
 				src_nid = msg->msg_src_nid_param;
@@ -2954,7 +3289,7 @@ lnet_resend_pending_msgs_locked(struct list_head *resendq, int cpt)
 			       lnet_msgtyp2str(msg->msg_type),
 			       msg->msg_recovery,
 			       msg->msg_retry_count);
-			rc = lnet_send(src_nid, msg, LNET_NID_ANY);
+			rc = lnet_send(src_nid, msg, msg->msg_rtr_nid_param);
 			if (rc) {
 				CERROR("Error sending %s to %s: %d\n",
 				       lnet_msgtyp2str(msg->msg_type),
@@ -3002,18 +3337,79 @@ lnet_unlink_ni_recovery_mdh_locked(struct lnet_ni *ni, int cpt, bool force)
 	lnet_ni_lock(ni);
 }
 
+/* a recovery ping picked for the current batch */
+struct lnet_recovery_ping {
+	lnet_nid_t		rp_nid;
+	struct lnet_handle_md	rp_mdh;
+	int			rp_rc;
+};
+
+/*
+ * Interfaces which keep failing recovery back off exponentially, so a
+ * fabric full of dead peers isn't flooded with pings. The jitter of up
+ * to 25% either way keeps interfaces which failed together, i.e. after
+ * a switch reboot, from being pinged in lock-step forever.
+ */
+static time64_t
+lnet_next_recovery_ping(__u32 ping_count, time64_t now)
+{
+	unsigned int interval = max(lnet_max_recovery_ping_interval, 1U);
+
+	if (ping_count < 31 && (1U << ping_count) < interval)
+		interval = 1U << ping_count;
+
+	return now + interval - interval / 4 + cfs_rand() % (interval / 2 + 1);
+}
+
+static struct lnet_recovery_ping *
+lnet_recovery_pings_alloc(unsigned int *npings)
+{
+	struct lnet_recovery_ping *pings;
+
+	*npings = max(lnet_recovery_batch, 1U);
+	LIBCFS_ALLOC(pings, *npings * sizeof(*pings));
+
+	return pings;
+}
+
+static int
+lnet_send_recovery_ping(struct lnet_recovery_ping *rp, int type)
+{
+	struct lnet_mt_event_info *ev_info;
+	int rc;
+
+	LIBCFS_ALLOC(ev_info, sizeof(*ev_info));
+	if (!ev_info) {
+		CERROR("out of memory. Can't recover %s\n",
+		       libcfs_nid2str(rp->rp_nid));
+		return -ENOMEM;
+	}
+
+	ev_info->mt_type = type;
+	ev_info->mt_nid = rp->rp_nid;
+	rc = lnet_send_ping(rp->rp_nid, &rp->rp_mdh, LNET_INTERFACES_MIN,
+			    ev_info, the_lnet.ln_mt_eqh, true);
+	/* no MD was bound, so no event will free ev_info */
+	if (rc > 0)
+		LIBCFS_FREE(ev_info, sizeof(*ev_info));
+
+	return rc;
+}
+
 static void
 lnet_recover_local_nis(void)
 {
-	struct lnet_mt_event_info *ev_info;
+	struct lnet_recovery_ping *pings;
+	struct lnet_recovery_ping *rp;
 	struct list_head processed_list;
 	struct list_head local_queue;
-	struct lnet_handle_md mdh;
 	struct lnet_ni *tmp;
 	struct lnet_ni *ni;
-	lnet_nid_t nid;
+	unsigned int max_pings;
+	unsigned int npings = 0;
+	unsigned int i;
+	time64_t now = ktime_get_seconds();
 	int healthv;
-	int rc;
 
 	INIT_LIST_HEAD(&local_queue);
 	INIT_LIST_HEAD(&processed_list);
@@ -3030,6 +3426,20 @@ lnet_recover_local_nis(void)
 			 &local_queue);
 	lnet_net_unlock(0);
 
+	if (list_empty(&local_queue))
+		return;
+
+	pings = lnet_recovery_pings_alloc(&max_pings);
+	if (!pings) {
+		CERROR("out of memory. Can't recover local NIs\n");
+		goto out;
+	}
+
+	/*
+	 * Pick the NIs due for a ping in one walk under the lock. The
+	 * pings themselves are sent without it, see below.
+	 */
+	lnet_net_lock(0);
 	list_for_each_entry_safe(ni, tmp, &local_queue, ni_recovery) {
 		/*
 		 * if an NI is being deleted or it is now healthy, there
@@ -3041,15 +3451,15 @@ lnet_recover_local_nis(void)
 		 */
 		healthv = atomic_read(&ni->ni_healthv);
 
-		lnet_net_lock(0);
 		lnet_ni_lock(ni);
 		if (ni->ni_state != LNET_NI_STATE_ACTIVE ||
 		    healthv == LNET_MAX_HEALTH_VALUE) {
 			list_del_init(&ni->ni_recovery);
+			ni->ni_ping_count = 0;
+			ni->ni_next_ping = 0;
 			lnet_unlink_ni_recovery_mdh_locked(ni, 0, false);
 			lnet_ni_unlock(ni);
 			lnet_ni_decref_locked(ni, 0);
-			lnet_net_unlock(0);
 			continue;
 		}
 
@@ -3063,106 +3473,110 @@ lnet_recover_local_nis(void)
 			ni->ni_recovery_state &= ~LNET_NI_RECOVERY_FAILED;
 		}
 
-		lnet_ni_unlock(ni);
-		lnet_net_unlock(0);
-
+		/* the rest of the queue waits for the next pass */
+		if (npings == max_pings ||
+		    (ni->ni_recovery_state & LNET_NI_RECOVERY_PENDING) ||
+		    now < ni->ni_next_ping) {
+			lnet_ni_unlock(ni);
+			continue;
+		}
 
 		CDEBUG(D_NET, "attempting to recover local ni: %s\n",
 		       libcfs_nid2str(ni->ni_nid));
 
-		lnet_ni_lock(ni);
-		if (!(ni->ni_recovery_state & LNET_NI_RECOVERY_PENDING)) {
-			ni->ni_recovery_state |= LNET_NI_RECOVERY_PENDING;
-			lnet_ni_unlock(ni);
+		ni->ni_recovery_state |= LNET_NI_RECOVERY_PENDING;
+		ni->ni_next_ping = lnet_next_recovery_ping(ni->ni_ping_count,
+							   now);
+		if (ni->ni_ping_count < 31)
+			ni->ni_ping_count++;
 
-			LIBCFS_ALLOC(ev_info, sizeof(*ev_info));
-			if (!ev_info) {
-				CERROR("out of memory. Can't recover %s\n",
-				       libcfs_nid2str(ni->ni_nid));
-				lnet_ni_lock(ni);
-				ni->ni_recovery_state &=
-				  ~LNET_NI_RECOVERY_PENDING;
-				lnet_ni_unlock(ni);
-				continue;
-			}
+		rp = &pings[npings++];
+		rp->rp_nid = ni->ni_nid;
+		rp->rp_mdh = ni->ni_ping_mdh;
+		/*
+		 * Invalidate the ni mdh in case it's deleted.
+		 * We'll unlink the mdh in this case below.
+		 */
+		LNetInvalidateMDHandle(&ni->ni_ping_mdh);
+		lnet_ni_unlock(ni);
 
-			mdh = ni->ni_ping_mdh;
-			/*
-			 * Invalidate the ni mdh in case it's deleted.
-			 * We'll unlink the mdh in this case below.
-			 */
-			LNetInvalidateMDHandle(&ni->ni_ping_mdh);
-			nid = ni->ni_nid;
+		/*
+		 * remove the NI from the local queue and drop the
+		 * reference count to it while we're recovering
+		 * it. The reason for that, is that the NI could
+		 * be deleted, and the way the code is structured
+		 * is if we don't drop the NI, then the deletion
+		 * code will enter a loop waiting for the
+		 * reference count to be removed while holding the
+		 * ln_mutex_lock(). When we look up the peer to
+		 * send to in lnet_select_pathway() we will try to
+		 * lock the ln_mutex_lock() as well, leading to
+		 * a deadlock. By dropping the refcount and
+		 * removing it from the list, we allow for the NI
+		 * to be removed, then we use the cached NID to
+		 * look it up again. If it's gone, then we just
+		 * continue examining the rest of the batch.
+		 */
+		list_del_init(&ni->ni_recovery);
+		lnet_ni_decref_locked(ni, 0);
+	}
+	lnet_net_unlock(0);
 
-			/*
-			 * remove the NI from the local queue and drop the
-			 * reference count to it while we're recovering
-			 * it. The reason for that, is that the NI could
-			 * be deleted, and the way the code is structured
-			 * is if we don't drop the NI, then the deletion
-			 * code will enter a loop waiting for the
-			 * reference count to be removed while holding the
-			 * ln_mutex_lock(). When we look up the peer to
-			 * send to in lnet_select_pathway() we will try to
-			 * lock the ln_mutex_lock() as well, leading to
-			 * a deadlock. By dropping the refcount and
-			 * removing it from the list, we allow for the NI
-			 * to be removed, then we use the cached NID to
-			 * look it up again. If it's gone, then we just
-			 * continue examining the rest of the queue.
-			 */
-			lnet_net_lock(0);
-			list_del_init(&ni->ni_recovery);
-			lnet_ni_decref_locked(ni, 0);
-			lnet_net_unlock(0);
+	for (i = 0; i < npings; i++)
+		pings[i].rp_rc = lnet_send_recovery_ping(&pings[i],
+							 MT_TYPE_LOCAL_NI);
 
-			ev_info->mt_type = MT_TYPE_LOCAL_NI;
-			ev_info->mt_nid = nid;
-			rc = lnet_send_ping(nid, &mdh, LNET_INTERFACES_MIN,
-					    ev_info, the_lnet.ln_mt_eqh, true);
-			/* lookup the nid again */
-			lnet_net_lock(0);
-			ni = lnet_nid2ni_locked(nid, 0);
-			if (!ni) {
-				/*
-				 * the NI has been deleted when we dropped
-				 * the ref count
-				 */
-				lnet_net_unlock(0);
-				LNetMDUnlink(mdh);
-				continue;
-			}
+	lnet_net_lock(0);
+	for (i = 0; i < npings; i++) {
+		rp = &pings[i];
+		/* lookup the nid again */
+		ni = lnet_nid2ni_locked(rp->rp_nid, 0);
+		if (!ni) {
 			/*
-			 * Same note as in lnet_recover_peer_nis(). When
-			 * we're sending the ping, the NI is free to be
-			 * deleted or manipulated. By this point it
-			 * could've been added back on the recovery queue,
-			 * and a refcount taken on it.
-			 * So we can't just add it blindly again or we'll
-			 * corrupt the queue. We must check under lock if
-			 * it's not on any list and if not then add it
-			 * to the processed list, which will eventually be
-			 * spliced back on to the recovery queue.
+			 * the NI has been deleted when we dropped the
+			 * ref count, its MD is unlinked below
 			 */
-			ni->ni_ping_mdh = mdh;
-			if (list_empty(&ni->ni_recovery)) {
-				list_add_tail(&ni->ni_recovery, &processed_list);
-				lnet_ni_addref_locked(ni, 0);
-			}
-			lnet_net_unlock(0);
-
-			lnet_ni_lock(ni);
-			if (rc)
-				ni->ni_recovery_state &= ~LNET_NI_RECOVERY_PENDING;
+			continue;
 		}
+		/*
+		 * Same note as in lnet_recover_peer_nis(). When
+		 * we're sending the ping, the NI is free to be
+		 * deleted or manipulated. By this point it
+		 * could've been added back on the recovery queue,
+		 * and a refcount taken on it.
+		 * So we can't just add it blindly again or we'll
+		 * corrupt the queue. We must check under lock if
+		 * it's not on any list and if not then add it
+		 * to the processed list, which will eventually be
+		 * spliced back on to the recovery queue.
+		 */
+		lnet_ni_lock(ni);
+		ni->ni_ping_mdh = rp->rp_mdh;
+		if (rp->rp_rc)
+			ni->ni_recovery_state &= ~LNET_NI_RECOVERY_PENDING;
 		lnet_ni_unlock(ni);
+		LNetInvalidateMDHandle(&rp->rp_mdh);
+
+		if (list_empty(&ni->ni_recovery)) {
+			list_add_tail(&ni->ni_recovery, &processed_list);
+			lnet_ni_addref_locked(ni, 0);
+		}
 	}
+	lnet_net_unlock(0);
 
+	for (i = 0; i < npings; i++) {
+		if (!LNetMDHandleIsInvalid(pings[i].rp_mdh))
+			LNetMDUnlink(pings[i].rp_mdh);
+	}
+
+	LIBCFS_FREE(pings, max_pings * sizeof(*pings));
+out:
 	/*
 	 * put back the remaining NIs on the ln_mt_localNIRecovq to be
-	 * reexamined in the next iteration.
+	 * reexamined in the next iteration. The ones just pinged go
+	 * last, so a full batch doesn't starve the rest of the queue.
 	 */
-	list_splice_init(&processed_list, &local_queue);
+	list_splice_tail_init(&processed_list, &local_queue);
 	lnet_net_lock(0);
 	list_splice(&local_queue, &the_lnet.ln_mt_localNIRecovq);
 	lnet_net_unlock(0);
@@ -3270,15 +3684,17 @@ lnet_clean_resendqs(void)
 static void
 lnet_recover_peer_nis(void)
 {
-	struct lnet_mt_event_info *ev_info;
+	struct lnet_recovery_ping *pings;
+	struct lnet_recovery_ping *rp;
 	struct list_head processed_list;
 	struct list_head local_queue;
-	struct lnet_handle_md mdh;
 	struct lnet_peer_ni *lpni;
 	struct lnet_peer_ni *tmp;
-	lnet_nid_t nid;
+	unsigned int max_pings;
+	unsigned int npings = 0;
+	unsigned int i;
+	time64_t now = ktime_get_seconds();
 	int healthv;
-	int rc;
 
 	INIT_LIST_HEAD(&local_queue);
 	INIT_LIST_HEAD(&processed_list);
@@ -3292,22 +3708,32 @@ lnet_recover_peer_nis(void)
 			 &local_queue);
 	lnet_net_unlock(0);
 
+	if (list_empty(&local_queue))
+		return;
+
+	pings = lnet_recovery_pings_alloc(&max_pings);
+	if (!pings) {
+		CERROR("out of memory. Can't recover peer NIs\n");
+		goto out;
+	}
+
+	lnet_net_lock(0);
 	list_for_each_entry_safe(lpni, tmp, &local_queue,
 				 lpni_recovery) {
 		/*
 		 * The same protection strategy is used here as is in the
 		 * local recovery case.
 		 */
-		lnet_net_lock(0);
 		healthv = atomic_read(&lpni->lpni_healthv);
 		spin_lock(&lpni->lpni_lock);
 		if (lpni->lpni_state & LNET_PEER_NI_DELETING ||
 		    healthv == LNET_MAX_HEALTH_VALUE) {
 			list_del_init(&lpni->lpni_recovery);
+			lpni->lpni_ping_count = 0;
+			lpni->lpni_next_ping = 0;
 			lnet_unlink_lpni_recovery_mdh_locked(lpni, 0, false);
 			spin_unlock(&lpni->lpni_lock);
 			lnet_peer_ni_decref_locked(lpni);
-			lnet_net_unlock(0);
 			continue;
 		}
 
@@ -3321,82 +3747,86 @@ lnet_recover_peer_nis(void)
 			lpni->lpni_state &= ~LNET_PEER_NI_RECOVERY_FAILED;
 		}
 
-		spin_unlock(&lpni->lpni_lock);
-		lnet_net_unlock(0);
-
 		/*
 		 * NOTE: we're racing with peer deletion from user space.
 		 * It's possible that a peer is deleted after we check its
 		 * state. In this case the recovery can create a new peer
 		 */
-		spin_lock(&lpni->lpni_lock);
-		if (!(lpni->lpni_state & LNET_PEER_NI_RECOVERY_PENDING) &&
-		    !(lpni->lpni_state & LNET_PEER_NI_DELETING)) {
-			lpni->lpni_state |= LNET_PEER_NI_RECOVERY_PENDING;
+		if (npings == max_pings ||
+		    (lpni->lpni_state & LNET_PEER_NI_RECOVERY_PENDING) ||
+		    (lpni->lpni_state & LNET_PEER_NI_DELETING) ||
+		    now < lpni->lpni_next_ping) {
 			spin_unlock(&lpni->lpni_lock);
+			continue;
+		}
 
-			LIBCFS_ALLOC(ev_info, sizeof(*ev_info));
-			if (!ev_info) {
-				CERROR("out of memory. Can't recover %s\n",
-				       libcfs_nid2str(lpni->lpni_nid));
-				spin_lock(&lpni->lpni_lock);
-				lpni->lpni_state &= ~LNET_PEER_NI_RECOVERY_PENDING;
-				spin_unlock(&lpni->lpni_lock);
-				continue;
-			}
+		lpni->lpni_state |= LNET_PEER_NI_RECOVERY_PENDING;
+		lpni->lpni_next_ping =
+			lnet_next_recovery_ping(lpni->lpni_ping_count, now);
+		if (lpni->lpni_ping_count < 31)
+			lpni->lpni_ping_count++;
 
-			/* look at the comments in lnet_recover_local_nis() */
-			mdh = lpni->lpni_recovery_ping_mdh;
-			LNetInvalidateMDHandle(&lpni->lpni_recovery_ping_mdh);
-			nid = lpni->lpni_nid;
-			lnet_net_lock(0);
-			list_del_init(&lpni->lpni_recovery);
-			lnet_peer_ni_decref_locked(lpni);
-			lnet_net_unlock(0);
+		/* look at the comments in lnet_recover_local_nis() */
+		rp = &pings[npings++];
+		rp->rp_nid = lpni->lpni_nid;
+		rp->rp_mdh = lpni->lpni_recovery_ping_mdh;
+		LNetInvalidateMDHandle(&lpni->lpni_recovery_ping_mdh);
+		spin_unlock(&lpni->lpni_lock);
 
-			ev_info->mt_type = MT_TYPE_PEER_NI;
-			ev_info->mt_nid = nid;
-			rc = lnet_send_ping(nid, &mdh, LNET_INTERFACES_MIN,
-					    ev_info, the_lnet.ln_mt_eqh, true);
-			lnet_net_lock(0);
-			/*
-			 * lnet_find_peer_ni_locked() grabs a refcount for
-			 * us. No need to take it explicitly.
-			 */
-			lpni = lnet_find_peer_ni_locked(nid);
-			if (!lpni) {
-				lnet_net_unlock(0);
-				LNetMDUnlink(mdh);
-				continue;
-			}
+		list_del_init(&lpni->lpni_recovery);
+		lnet_peer_ni_decref_locked(lpni);
+	}
+	lnet_net_unlock(0);
 
-			lpni->lpni_recovery_ping_mdh = mdh;
-			/*
-			 * While we're unlocked the lpni could've been
-			 * readded on the recovery queue. In this case we
-			 * don't need to add it to the local queue, since
-			 * it's already on there and the thread that added
-			 * it would've incremented the refcount on the
-			 * peer, which means we need to decref the refcount
-			 * that was implicitly grabbed by find_peer_ni_locked.
-			 * Otherwise, if the lpni is still not on
-			 * the recovery queue, then we'll add it to the
-			 * processed list.
-			 */
-			if (list_empty(&lpni->lpni_recovery))
-				list_add_tail(&lpni->lpni_recovery, &processed_list);
-			else
-				lnet_peer_ni_decref_locked(lpni);
-			lnet_net_unlock(0);
+	for (i = 0; i < npings; i++)
+		pings[i].rp_rc = lnet_send_recovery_ping(&pings[i],
+							 MT_TYPE_PEER_NI);
 
-			spin_lock(&lpni->lpni_lock);
-			if (rc)
-				lpni->lpni_state &= ~LNET_PEER_NI_RECOVERY_PENDING;
-		}
+	lnet_net_lock(0);
+	for (i = 0; i < npings; i++) {
+		rp = &pings[i];
+		/*
+		 * lnet_find_peer_ni_locked() grabs a refcount for
+		 * us. No need to take it explicitly.
+		 */
+		lpni = lnet_find_peer_ni_locked(rp->rp_nid);
+		if (!lpni)
+			continue;
+
+		spin_lock(&lpni->lpni_lock);
+		lpni->lpni_recovery_ping_mdh = rp->rp_mdh;
+		if (rp->rp_rc)
+			lpni->lpni_state &= ~LNET_PEER_NI_RECOVERY_PENDING;
 		spin_unlock(&lpni->lpni_lock);
+		LNetInvalidateMDHandle(&rp->rp_mdh);
+
+		/*
+		 * While we're unlocked the lpni could've been
+		 * readded on the recovery queue. In this case we
+		 * don't need to add it to the local queue, since
+		 * it's already on there and the thread that added
+		 * it would've incremented the refcount on the
+		 * peer, which means we need to decref the refcount
+		 * that was implicitly grabbed by find_peer_ni_locked.
+		 * Otherwise, if the lpni is still not on
+		 * the recovery queue, then we'll add it to the
+		 * processed list.
+		 */
+		if (list_empty(&lpni->lpni_recovery))
+			list_add_tail(&lpni->lpni_recovery, &processed_list);
+		else
+			lnet_peer_ni_decref_locked(lpni);
+	}
+	lnet_net_unlock(0);
+
+	for (i = 0; i < npings; i++) {
+		if (!LNetMDHandleIsInvalid(pings[i].rp_mdh))
+			LNetMDUnlink(pings[i].rp_mdh);
 	}
 
-	list_splice_init(&processed_list, &local_queue);
+	LIBCFS_FREE(pings, max_pings * sizeof(*pings));
+out:
+	list_splice_tail_init(&processed_list, &local_queue);
 	lnet_net_lock(0);
 	list_splice(&local_queue, &the_lnet.ln_mt_peerNIRecovq);
 	lnet_net_unlock(0);
@@ -3407,6 +3837,7 @@ lnet_monitor_thread(void *arg)
 {
 	time64_t recovery_timeout = 0;
 	time64_t rsp_timeout = 0;
+	time64_t rtrpool_timeout = 0;
 	int interval;
 	time64_t now;
 
@@ -3441,6 +3872,11 @@ lnet_monitor_thread(void *arg)
 			recovery_timeout = now + lnet_recovery_interval;
 		}
 
+		if (now >= rtrpool_timeout) {
+			lnet_rtrpools_autosize();
+			rtrpool_timeout = now + LNET_RTRPOOL_AUTOSIZE_INTERVAL;
+		}
+
 		/*
 		 * TODO do we need to check if we should sleep without
 		 * timeout?  Technically, an active system will always
@@ -3551,8 +3987,13 @@ lnet_handle_recovery_reply(struct lnet_mt_event_info *ev_info,
 		}
 		lnet_ni_lock(ni);
 		ni->ni_recovery_state &= ~LNET_NI_RECOVERY_PENDING;
-		if (status)
+		if (status) {
 			ni->ni_recovery_state |= LNET_NI_RECOVERY_FAILED;
+		} else {
+			/* it answers again, ping it at full speed */
+			ni->ni_ping_count = 0;
+			ni->ni_next_ping = 0;
+		}
 		lnet_ni_unlock(ni);
 		lnet_net_unlock(0);
 
@@ -3582,8 +4023,12 @@ lnet_handle_recovery_reply(struct lnet_mt_event_info *ev_info,
 		}
 		spin_lock(&lpni->lpni_lock);
 		lpni->lpni_state &= ~LNET_PEER_NI_RECOVERY_PENDING;
-		if (status)
+		if (status) {
 			lpni->lpni_state |= LNET_PEER_NI_RECOVERY_FAILED;
+		} else {
+			lpni->lpni_ping_count = 0;
+			lpni->lpni_next_ping = 0;
+		}
 		spin_unlock(&lpni->lpni_lock);
 		lnet_peer_ni_decref_locked(lpni);
 		lnet_net_unlock(cpt);
@@ -4606,6 +5051,9 @@ lnet_attach_rsp_tracker(struct lnet_rsp_tracker *rspt, int cpt,
  *
  * \param self Indicates the NID of a local interface through which to send
  * the PUT request. Use LNET_NID_ANY to let LNet choose one by itself.
+ * \param rtr The NID of the router to use if \a target is on a remote
+ * network, LNET_NID_ANY to let LNet choose one. LNet still falls back to
+ * another router if this one is dead. Only LNetPutVia() takes it.
  * \param mdh A handle for the MD that describes the memory to be sent. The MD
  * must be "free floating" (See LNetMDBind()).
  * \param ack Controls whether an acknowledgment is requested.
@@ -4630,10 +5078,10 @@ lnet_attach_rsp_tracker(struct lnet_rsp_tracker *rspt, int cpt,
  * \see struct lnet_event::hdr_data and lnet_event_kind_t.
  */
 int
-LNetPut(lnet_nid_t self, struct lnet_handle_md mdh, enum lnet_ack_req ack,
-	struct lnet_process_id target, unsigned int portal,
-	__u64 match_bits, unsigned int offset,
-	__u64 hdr_data)
+LNetPutVia(lnet_nid_t self, lnet_nid_t rtr, struct lnet_handle_md mdh,
+	   enum lnet_ack_req ack, struct lnet_process_id target,
+	   unsigned int portal, __u64 match_bits, unsigned int offset,
+	   __u64 hdr_data)
 {
 	struct lnet_msg *msg;
 	struct lnet_libmd *md;
@@ -4718,7 +5166,7 @@ LNetPut(lnet_nid_t self, struct lnet_handle_md mdh, enum lnet_ack_req ack,
 	if (ack == LNET_ACK_REQ)
 		lnet_attach_rsp_tracker(rspt, cpt, md, mdh);
 
-	rc = lnet_send(self, msg, LNET_NID_ANY);
+	rc = lnet_send(self, msg, rtr);
 	if (rc != 0) {
 		CNETERR("Error sending PUT to %s: %d\n",
 			libcfs_id2str(target), rc);
@@ -4729,6 +5177,17 @@ LNetPut(lnet_nid_t self, struct lnet_handle_md mdh, enum lnet_ack_req ack,
 	/* completion will be signalled by an event */
 	return 0;
 }
+EXPORT_SYMBOL(LNetPutVia);
+
+int
+LNetPut(lnet_nid_t self, struct lnet_handle_md mdh, enum lnet_ack_req ack,
+	struct lnet_process_id target, unsigned int portal,
+	__u64 match_bits, unsigned int offset,
+	__u64 hdr_data)
+{
+	return LNetPutVia(self, LNET_NID_ANY, mdh, ack, target, portal,
+			  match_bits, offset, hdr_data);
+}
 EXPORT_SYMBOL(LNetPut);
 
 /*
@@ -4840,7 +5299,8 @@ EXPORT_SYMBOL(lnet_set_reply_msg_len);
  * On the target node, an LNET_EVENT_GET is logged when the GET request
  * arrives and is accepted into a MD.
  *
- * \param self,target,portal,match_bits,offset See the discussion in LNetPut().
+ * \param self,rtr,target,portal,match_bits,offset See the discussion in
+ * LNetPut(), only LNetGetVia() takes \a rtr.
  * \param mdh A handle for the MD that describes the memory into which the
  * requested data will be received. The MD must be "free floating" (See LNetMDBind()).
  *
@@ -4851,9 +5311,9 @@ EXPORT_SYMBOL(lnet_set_reply_msg_len);
  * \retval -ENOENT Invalid MD object.
  */
 int
-LNetGet(lnet_nid_t self, struct lnet_handle_md mdh,
-	struct lnet_process_id target, unsigned int portal,
-	__u64 match_bits, unsigned int offset, bool recovery)
+LNetGetVia(lnet_nid_t self, lnet_nid_t rtr, struct lnet_handle_md mdh,
+	   struct lnet_process_id target, unsigned int portal,
+	   __u64 match_bits, unsigned int offset, bool recovery)
 {
 	struct lnet_msg *msg;
 	struct lnet_libmd *md;
@@ -4931,7 +5391,7 @@ LNetGet(lnet_nid_t self, struct lnet_handle_md mdh,
 
 	lnet_attach_rsp_tracker(rspt, cpt, md, mdh);
 
-	rc = lnet_send(self, msg, LNET_NID_ANY);
+	rc = lnet_send(self, msg, rtr);
 	if (rc < 0) {
 		CNETERR("Error sending GET to %s: %d\n",
 			libcfs_id2str(target), rc);
@@ -4942,6 +5402,16 @@ LNetGet(lnet_nid_t self, struct lnet_handle_md mdh,
 	/* completion will be signalled by an event */
 	return 0;
 }
+EXPORT_SYMBOL(LNetGetVia);
+
+int
+LNetGet(lnet_nid_t self, struct lnet_handle_md mdh,
+	struct lnet_process_id target, unsigned int portal,
+	__u64 match_bits, unsigned int offset, bool recovery)
+{
+	return LNetGetVia(self, LNET_NID_ANY, mdh, target, portal,
+			  match_bits, offset, recovery);
+}
 EXPORT_SYMBOL(LNetGet);
 
 /**
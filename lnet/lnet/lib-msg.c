@@ -224,14 +224,20 @@ lnet_msg_decommit_tx(struct lnet_msg *msg, int status)
 	common->lcc_send_count++;
 
 incr_stats:
-	if (msg->msg_txpeer)
+	if (msg->msg_txpeer) {
 		lnet_incr_stats(&msg->msg_txpeer->lpni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_SEND);
-	if (msg->msg_txni)
+		atomic64_add(msg->msg_len,
+			     &msg->msg_txpeer->lpni_stats.el_send_length);
+	}
+	if (msg->msg_txni) {
 		lnet_incr_stats(&msg->msg_txni->ni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_SEND);
+		atomic64_add(msg->msg_len,
+			     &msg->msg_txni->ni_stats.el_send_length);
+	}
  out:
 	lnet_return_tx_credits_locked(msg);
 	msg->msg_tx_committed = 0;
@@ -285,14 +291,20 @@ lnet_msg_decommit_rx(struct lnet_msg *msg, int status)
 	common->lcc_recv_count++;
 
 incr_stats:
-	if (msg->msg_rxpeer)
+	if (msg->msg_rxpeer) {
 		lnet_incr_stats(&msg->msg_rxpeer->lpni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_RECV);
-	if (msg->msg_rxni)
+		atomic64_add(msg->msg_wanted,
+			     &msg->msg_rxpeer->lpni_stats.el_recv_length);
+	}
+	if (msg->msg_rxni) {
 		lnet_incr_stats(&msg->msg_rxni->ni_stats,
 				msg->msg_type,
 				LNET_STATS_TYPE_RECV);
+		atomic64_add(msg->msg_wanted,
+			     &msg->msg_rxni->ni_stats.el_recv_length);
+	}
 	if (ev->type == LNET_EVENT_PUT || ev->type == LNET_EVENT_REPLY)
 		common->lcc_recv_length += msg->msg_wanted;
 
@@ -975,13 +987,106 @@ lnet_send_error_simulation(struct lnet_msg *msg,
 }
 EXPORT_SYMBOL(lnet_send_error_simulation);
 
-void
-lnet_finalize(struct lnet_msg *msg, int status)
+/*
+ * Complete the messages queued on the msc_finalizing list of \a container.
+ * Called with lnet_net_lock(cpt) held after taking a finalizer slot, which
+ * is released before returning. Returns the message that has to be
+ * finalized again, possibly on another partition, or NULL.
+ */
+static struct lnet_msg *
+lnet_finalize_drain_locked(struct lnet_msg_container *container, int cpt,
+			   int my_slot)
+{
+	struct lnet_msg *msg = NULL;
+	int rc = 0;
+
+	while (!list_empty(&container->msc_finalizing)) {
+		msg = list_entry(container->msc_finalizing.next,
+				 struct lnet_msg, msg_list);
+
+		list_del_init(&msg->msg_list);
+
+		/* NB drops and regains the lnet lock if it actually does
+		 * anything, so my finalizing friends can chomp along too */
+		rc = lnet_complete_msg_locked(msg, cpt);
+		if (rc != 0)
+			break;
+	}
+
+	if (unlikely(!list_empty(&the_lnet.ln_delay_rules))) {
+		lnet_net_unlock(cpt);
+		lnet_delay_rule_check();
+		lnet_net_lock(cpt);
+	}
+
+	container->msc_finalizers[my_slot] = NULL;
+
+	return rc != 0 ? msg : NULL;
+}
+
+static inline int
+lnet_msg_commit_cpt(struct lnet_msg *msg)
+{
+	/*
+	 * NB: routed message can be committed for both receiving and sending,
+	 * we should finalize in LIFO order and keep counters correct.
+	 * (finalize sending first then finalize receiving)
+	 */
+	if (msg->msg_tx_committed)
+		return msg->msg_tx_cpt;
+	if (msg->msg_rx_committed)
+		return msg->msg_rx_cpt;
+	return CFS_CPT_ANY;
+}
+
+/*
+ * Called once the MD of \a msg has been detached: decommit the message
+ * and release it, or send the ACK/forward it as required.
+ */
+static void
+lnet_finalize_committed(struct lnet_msg *msg)
 {
 	struct lnet_msg_container *container;
 	int my_slot;
 	int cpt;
-	int rc;
+
+again:
+	cpt = lnet_msg_commit_cpt(msg);
+	if (cpt == CFS_CPT_ANY) {
+		/* not committed to network yet */
+		LASSERT(!msg->msg_onactivelist);
+		lnet_msg_free(msg);
+		return;
+	}
+
+	lnet_net_lock(cpt);
+
+	container = the_lnet.ln_msg_containers[cpt];
+
+	/* Recursion breaker.  Don't complete the message here if I am (or
+	 * enough other threads are) already completing messages */
+	my_slot = lnet_check_finalize_recursion_locked(msg,
+						&container->msc_finalizing,
+						container->msc_nfinalizers,
+						container->msc_finalizers);
+
+	/* enough threads are resending */
+	if (my_slot == -1) {
+		lnet_net_unlock(cpt);
+		return;
+	}
+
+	msg = lnet_finalize_drain_locked(container, cpt, my_slot);
+	lnet_net_unlock(cpt);
+
+	if (msg != NULL)
+		goto again;
+}
+
+void
+lnet_finalize(struct lnet_msg *msg, int status)
+{
+	int cpt;
 
 	LASSERT(!in_interrupt());
 
@@ -1018,64 +1123,105 @@ lnet_finalize(struct lnet_msg *msg, int status)
 		lnet_res_unlock(cpt);
 	}
 
-again:
-	if (!msg->msg_tx_committed && !msg->msg_rx_committed) {
-		/* not committed to network yet */
-		LASSERT(!msg->msg_onactivelist);
-		lnet_msg_free(msg);
-		return;
-	}
+	lnet_finalize_committed(msg);
+}
+EXPORT_SYMBOL(lnet_finalize);
 
-	/*
-	 * NB: routed message can be committed for both receiving and sending,
-	 * we should finalize in LIFO order and keep counters correct.
-	 * (finalize sending first then finalize receiving)
-	 */
-	cpt = msg->msg_tx_committed ? msg->msg_tx_cpt : msg->msg_rx_cpt;
-	lnet_net_lock(cpt);
+/**
+ * Finalize a batch of messages completed together by an LND.
+ *
+ * \a msgs is a list of messages chained on msg_list, normally built with
+ * lnet_finalize_batch_add(), each with its completion status stored in
+ * msg_ev.status. This is equivalent to calling lnet_finalize() on each
+ * message in turn, but MDs on the same resource partition are detached
+ * (and their event callbacks run) under one lnet_res_lock(), and messages
+ * committed on the same partition are completed under one
+ * lnet_net_lock(). The list is empty on return.
+ */
+void
+lnet_finalize_batch(struct list_head *msgs)
+{
+	struct lnet_msg_container *container;
+	struct lnet_msg *msg;
+	struct lnet_msg *next;
+	struct lnet_msg *tmp;
+	struct list_head todo;
+	int my_slot;
+	int cpt;
 
-	container = the_lnet.ln_msg_containers[cpt];
+	LASSERT(!in_interrupt());
 
-	/* Recursion breaker.  Don't complete the message here if I am (or
-	 * enough other threads are) already completing messages */
-	my_slot = lnet_check_finalize_recursion_locked(msg,
-						&container->msc_finalizing,
-						container->msc_nfinalizers,
-						container->msc_finalizers);
+	INIT_LIST_HEAD(&todo);
 
-	/* enough threads are resending */
-	if (my_slot == -1) {
-		lnet_net_unlock(cpt);
-		return;
+	/* messages queued for resend by the health check leave the batch */
+	list_for_each_entry_safe(msg, tmp, msgs, msg_list) {
+		list_del_init(&msg->msg_list);
+		if (lnet_is_health_check(msg) && !lnet_health_check(msg))
+			continue;
+		list_add_tail(&msg->msg_list, &todo);
 	}
 
-	rc = 0;
-	while (!list_empty(&container->msc_finalizing)) {
-		msg = list_entry(container->msc_finalizing.next,
-				 struct lnet_msg, msg_list);
+	cpt = CFS_CPT_ANY;
+	list_for_each_entry(msg, &todo, msg_list) {
+		int md_cpt;
 
-		list_del_init(&msg->msg_list);
+		if (msg->msg_md == NULL)
+			continue;
 
-		/* NB drops and regains the lnet lock if it actually does
-		 * anything, so my finalizing friends can chomp along too */
-		rc = lnet_complete_msg_locked(msg, cpt);
-		if (rc != 0)
-			break;
+		md_cpt = lnet_cpt_of_cookie(msg->msg_md->md_lh.lh_cookie);
+		if (md_cpt != cpt) {
+			if (cpt != CFS_CPT_ANY)
+				lnet_res_unlock(cpt);
+			cpt = md_cpt;
+			lnet_res_lock(cpt);
+		}
+		lnet_msg_detach_md(msg, cpt, msg->msg_ev.status);
 	}
+	if (cpt != CFS_CPT_ANY)
+		lnet_res_unlock(cpt);
+
+	while (!list_empty(&todo)) {
+		msg = list_entry(todo.next, struct lnet_msg, msg_list);
+		list_del_init(&msg->msg_list);
+
+		cpt = lnet_msg_commit_cpt(msg);
+		if (cpt == CFS_CPT_ANY) {
+			lnet_finalize_committed(msg);
+			continue;
+		}
 
-	if (unlikely(!list_empty(&the_lnet.ln_delay_rules))) {
-		lnet_net_unlock(cpt);
-		lnet_delay_rule_check();
 		lnet_net_lock(cpt);
-	}
+		container = the_lnet.ln_msg_containers[cpt];
+		my_slot = lnet_check_finalize_recursion_locked(msg,
+						&container->msc_finalizing,
+						container->msc_nfinalizers,
+						container->msc_finalizers);
 
-	container->msc_finalizers[my_slot] = NULL;
-	lnet_net_unlock(cpt);
+		/*
+		 * Queue the following messages committed on the same
+		 * partition too, they are completed by whoever owns a
+		 * finalizer slot on this container.
+		 */
+		list_for_each_entry_safe(next, tmp, &todo, msg_list) {
+			if (lnet_msg_commit_cpt(next) != cpt)
+				break;
+			list_move_tail(&next->msg_list,
+				       &container->msc_finalizing);
+		}
 
-	if (rc != 0)
-		goto again;
+		if (my_slot == -1) {
+			lnet_net_unlock(cpt);
+			continue;
+		}
+
+		msg = lnet_finalize_drain_locked(container, cpt, my_slot);
+		lnet_net_unlock(cpt);
+
+		if (msg != NULL)
+			lnet_finalize_committed(msg);
+	}
 }
-EXPORT_SYMBOL(lnet_finalize);
+EXPORT_SYMBOL(lnet_finalize_batch);
 
 void
 lnet_msg_container_cleanup(struct lnet_msg_container *container)
@@ -354,6 +354,14 @@ lnet_mt_set_exhausted(struct lnet_match_table *mtable, int pos, int exhausted)
 		*bmap |= 1ULL << pos;
 }
 
+static inline unsigned int
+lnet_mt_unique_hash(struct lnet_process_id id, __u64 mbits, unsigned int bits)
+{
+	unsigned long hash = mbits + id.nid + id.pid;
+
+	return hash_long(hash, bits) & ((1U << bits) - 1);
+}
+
 struct list_head *
 lnet_mt_match_head(struct lnet_match_table *mtable,
 		   struct lnet_process_id id, __u64 mbits)
@@ -363,12 +371,76 @@ lnet_mt_match_head(struct lnet_match_table *mtable,
 	if (lnet_ptl_is_wildcard(ptl)) {
 		return &mtable->mt_mhash[mbits & LNET_MT_HASH_MASK];
 	} else {
-		unsigned long hash = mbits + id.nid + id.pid;
-
 		LASSERT(lnet_ptl_is_unique(ptl));
-		hash = hash_long(hash, LNET_MT_HASH_BITS);
-		return &mtable->mt_mhash[hash & LNET_MT_HASH_MASK];
+		return &mtable->mt_mhash[lnet_mt_unique_hash(id, mbits,
+						mtable->mt_mhash_bits)];
+	}
+}
+
+/*
+ * Reply and bulk portals are unique portals with one ME per RPC in
+ * flight, so a fixed size hash turns into long lists on a busy client.
+ * Grow the hash of a unique portal once it holds more than
+ * LNET_MT_HASH_DEPTH MEs per bucket. Called without lnet_res_lock, as
+ * the new hash may have to be allocated with a sleeping allocation.
+ */
+void
+lnet_mt_grow(struct lnet_match_table *mtable)
+{
+	struct list_head *mhash;
+	struct list_head *old;
+	struct lnet_me	 *me;
+	struct lnet_me	 *tmp;
+	unsigned int	  bits = READ_ONCE(mtable->mt_mhash_bits);
+	unsigned int	  new_bits = bits + LNET_MT_HASH_GROW_BITS;
+	int		  i;
+
+	if (!lnet_ptl_is_unique(the_lnet.ln_portals[mtable->mt_portal]) ||
+	    new_bits > LNET_MT_HASH_BITS_MAX ||
+	    READ_ONCE(mtable->mt_nme) <= LNET_MT_HASH_DEPTH << bits)
+		return;
+
+	/* the extra entry is for MEs with ignore bits */
+	LIBCFS_CPT_ALLOC(mhash, lnet_cpt_table(), mtable->mt_cpt,
+			 sizeof(*mhash) * ((1 << new_bits) + 1));
+	if (mhash == NULL) /* keep using the smaller hash */
+		return;
+
+	for (i = 0; i < (1 << new_bits) + 1; i++)
+		INIT_LIST_HEAD(&mhash[i]);
+
+	lnet_res_lock(mtable->mt_cpt);
+	if (mtable->mt_mhash_bits != bits) { /* raced with another grow */
+		lnet_res_unlock(mtable->mt_cpt);
+		LIBCFS_FREE(mhash, sizeof(*mhash) * ((1 << new_bits) + 1));
+		return;
+	}
+
+	/* MEs of a unique portal with the same match id and bits always
+	 * share a list, so moving each list in order keeps their order */
+	old = mtable->mt_mhash;
+	for (i = 0; i < (1 << bits); i++) {
+		list_for_each_entry_safe(me, tmp, &old[i], me_list) {
+			me->me_pos = lnet_mt_unique_hash(me->me_match_id,
+							 me->me_match_bits,
+							 new_bits);
+			list_move_tail(&me->me_list, &mhash[me->me_pos]);
+		}
 	}
+	list_for_each_entry_safe(me, tmp, &old[1 << bits], me_list) {
+		me->me_pos = 1 << new_bits;
+		list_move_tail(&me->me_list, &mhash[me->me_pos]);
+	}
+
+	mtable->mt_mhash = mhash;
+	mtable->mt_mhash_bits = new_bits;
+	lnet_res_unlock(mtable->mt_cpt);
+
+	CDEBUG(D_NET, "portal %d cpt %d: ME hash grown to %d buckets for %d MEs\n",
+	       mtable->mt_portal, mtable->mt_cpt, 1 << new_bits,
+	       mtable->mt_nme);
+
+	LIBCFS_FREE(old, sizeof(*old) * ((1 << bits) + 1));
 }
 
 int
@@ -382,8 +454,8 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 	int			rc;
 
 	/* any ME with ignore bits? */
-	if (!list_empty(&mtable->mt_mhash[LNET_MT_HASH_IGNORE]))
-		head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
+	if (!list_empty(lnet_mt_ignore_head(mtable)))
+		head = lnet_mt_ignore_head(mtable);
 	else
 		head = lnet_mt_match_head(mtable, info->mi_id, info->mi_mbits);
  again:
@@ -415,7 +487,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 			exhausted = 0;
 	}
 
-	if (exhausted == 0 && head == &mtable->mt_mhash[LNET_MT_HASH_IGNORE]) {
+	if (exhausted == 0 && head == lnet_mt_ignore_head(mtable)) {
 		head = lnet_mt_match_head(mtable, info->mi_id, info->mi_mbits);
 		goto again; /* re-check MEs w/o ignore-bits */
 	}
@@ -762,7 +834,7 @@ lnet_ptl_cleanup(struct lnet_portal *ptl)
 
 		mhash = mtable->mt_mhash;
 		/* cleanup ME */
-		for (j = 0; j < LNET_MT_HASH_SIZE + 1; j++) {
+		for (j = 0; j < (1 << mtable->mt_mhash_bits) + 1; j++) {
 			while (!list_empty(&mhash[j])) {
 				me = list_entry(mhash[j].next,
 						struct lnet_me, me_list);
@@ -772,7 +844,8 @@ lnet_ptl_cleanup(struct lnet_portal *ptl)
 			}
 		}
 		/* the extra entry is for MEs with ignore bits */
-		LIBCFS_FREE(mhash, sizeof(*mhash) * (LNET_MT_HASH_SIZE + 1));
+		LIBCFS_FREE(mhash, sizeof(*mhash) *
+			    ((1 << mtable->mt_mhash_bits) + 1));
 	}
 
 	cfs_percpt_free(ptl->ptl_mtables);
@@ -812,6 +885,7 @@ lnet_ptl_setup(struct lnet_portal *ptl, int index)
 		       sizeof(mtable->mt_exhausted[0]) *
 		       LNET_MT_EXHAUSTED_BMAP);
 		mtable->mt_mhash = mhash;
+		mtable->mt_mhash_bits = LNET_MT_HASH_BITS;
 		for (j = 0; j < LNET_MT_HASH_SIZE + 1; j++)
 			INIT_LIST_HEAD(&mhash[j]);
 
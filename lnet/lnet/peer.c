@@ -161,6 +161,13 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 	if (!lpni)
 		return NULL;
 
+	LIBCFS_CPT_ALLOC(lpni->lpni_path_cache, lnet_cpt_table(), cpt,
+			 LNET_CPT_NUMBER * sizeof(*lpni->lpni_path_cache));
+	if (!lpni->lpni_path_cache) {
+		LIBCFS_FREE(lpni, sizeof(*lpni));
+		return NULL;
+	}
+
 	INIT_LIST_HEAD(&lpni->lpni_txq);
 	INIT_LIST_HEAD(&lpni->lpni_rtrq);
 	INIT_LIST_HEAD(&lpni->lpni_routes);
@@ -328,6 +335,7 @@ lnet_peer_detach_peer_ni_locked(struct lnet_peer_ni *lpni)
 	lpn = lpni->lpni_peer_net;
 
 	list_del_init(&lpni->lpni_peer_nis);
+	lnet_incr_path_gen();
 	/*
 	 * If there are no lpni's left, we detach lpn from
 	 * lp_peer_nets, so it cannot be found anymore.
@@ -870,6 +878,7 @@ lnet_peer_ni_set_non_mr_pref_nid(struct lnet_peer_ni *lpni, lnet_nid_t nid)
 		lpni->lpni_pref.nid = nid;
 		lpni->lpni_pref_nnids = 1;
 		lpni->lpni_state |= LNET_PEER_NI_NON_MR_PREF;
+		lnet_incr_path_gen();
 	}
 	spin_unlock(&lpni->lpni_lock);
 
@@ -891,6 +900,7 @@ lnet_peer_ni_clr_non_mr_pref_nid(struct lnet_peer_ni *lpni)
 	if (lpni->lpni_state & LNET_PEER_NI_NON_MR_PREF) {
 		lpni->lpni_pref_nnids = 0;
 		lpni->lpni_state &= ~LNET_PEER_NI_NON_MR_PREF;
+		lnet_incr_path_gen();
 	} else if (lpni->lpni_pref_nnids == 0) {
 		rc = -ENOENT;
 	} else {
@@ -971,6 +981,7 @@ lnet_peer_add_pref_nid(struct lnet_peer_ni *lpni, lnet_nid_t nid)
 	}
 	lpni->lpni_pref_nnids++;
 	lpni->lpni_state &= ~LNET_PEER_NI_NON_MR_PREF;
+	lnet_incr_path_gen();
 	spin_unlock(&lpni->lpni_lock);
 	lnet_net_unlock(LNET_LOCK_EX);
 
@@ -1051,6 +1062,7 @@ lnet_peer_del_pref_nid(struct lnet_peer_ni *lpni, lnet_nid_t nid)
 	}
 	lpni->lpni_pref_nnids--;
 	lpni->lpni_state &= ~LNET_PEER_NI_NON_MR_PREF;
+	lnet_incr_path_gen();
 	spin_unlock(&lpni->lpni_lock);
 	lnet_net_unlock(LNET_LOCK_EX);
 
@@ -1211,6 +1223,7 @@ lnet_peer_attach_peer_ni(struct lnet_peer *lp,
 	lpni->lpni_peer_net = lpn;
 	list_add_tail(&lpni->lpni_peer_nis, &lpn->lpn_peer_nis);
 	lnet_peer_net_addref_locked(lpn);
+	lnet_incr_path_gen();
 
 	/* Add peer_net to peer */
 	if (!lpn->lpn_peer) {
@@ -1638,6 +1651,8 @@ lnet_destroy_peer_ni_locked(struct lnet_peer_ni *lpni)
 		LIBCFS_FREE(lpni->lpni_pref.nids,
 			sizeof(*lpni->lpni_pref.nids) * lpni->lpni_pref_nnids);
 	}
+	LIBCFS_FREE(lpni->lpni_path_cache,
+		    LNET_CPT_NUMBER * sizeof(*lpni->lpni_path_cache));
 	LIBCFS_FREE(lpni, sizeof(*lpni));
 
 	lnet_peer_net_decref_locked(lpn);
@@ -1784,6 +1799,42 @@ lnet_peer_is_uptodate(struct lnet_peer *lp)
 	return rc;
 }
 
+/*
+ * Each CPT has its own discovery request queue and thread, and a peer
+ * is always queued on the queue of its lp_cpt. This keeps a peer from
+ * being worked on by two discovery threads at the same time.
+ */
+static inline struct list_head *
+lnet_peer_dc_request(struct lnet_peer *lp)
+{
+	return the_lnet.ln_dc_request[lp->lp_cpt];
+}
+
+/*
+ * Account for the pings and pushes discovery has in flight, so the
+ * discovery threads can hold off when lnet_peer_discovery_max_inflight
+ * is reached. Call with lp_lock held.
+ */
+static inline void
+lnet_peer_set_sent(struct lnet_peer *lp, unsigned int flag)
+{
+	if (!(lp->lp_state & flag)) {
+		lp->lp_state |= flag;
+		atomic_inc(&the_lnet.ln_dc_inflight);
+	}
+}
+
+static inline void
+lnet_peer_clear_sent(struct lnet_peer *lp, unsigned int flag)
+{
+	if (lp->lp_state & flag) {
+		lp->lp_state &= ~flag;
+		atomic_dec(&the_lnet.ln_dc_inflight);
+		if (lnet_peer_discovery_max_inflight)
+			wake_up(&the_lnet.ln_dc_waitq);
+	}
+}
+
 /*
  * Queue a peer for the attention of the discovery thread.  Call with
  * lnet_net_lock/EX held. Returns 0 if the peer was queued, and
@@ -1799,7 +1850,7 @@ static int lnet_peer_queue_for_discovery(struct lnet_peer *lp)
 	spin_unlock(&lp->lp_lock);
 	if (list_empty(&lp->lp_dc_list)) {
 		lnet_peer_addref_locked(lp);
-		list_add_tail(&lp->lp_dc_list, &the_lnet.ln_dc_request);
+		list_add_tail(&lp->lp_dc_list, lnet_peer_dc_request(lp));
 		wake_up(&the_lnet.ln_dc_waitq);
 		rc = 0;
 	} else {
@@ -2034,7 +2085,7 @@ out:
 	spin_unlock(&lp->lp_lock);
 	lnet_net_lock(LNET_LOCK_EX);
 	if (!lnet_peer_is_uptodate(lp) && lnet_peer_queue_for_discovery(lp)) {
-		list_move(&lp->lp_dc_list, &the_lnet.ln_dc_request);
+		list_move(&lp->lp_dc_list, lnet_peer_dc_request(lp));
 		wake_up(&the_lnet.ln_dc_waitq);
 	}
 	/* Drop refcount from lookup */
@@ -2160,7 +2211,7 @@ lnet_discovery_event_ack(struct lnet_peer *lp, struct lnet_event *ev)
 
 	pbuf = LNET_PING_INFO_TO_BUFFER(ev->md.start);
 	spin_lock(&lp->lp_lock);
-	lp->lp_state &= ~LNET_PEER_PUSH_SENT;
+	lnet_peer_clear_sent(lp, LNET_PEER_PUSH_SENT);
 	lp->lp_push_error = ev->status;
 	if (ev->status)
 		lp->lp_state |= LNET_PEER_PUSH_FAILED;
@@ -2302,7 +2353,7 @@ lnet_discovery_event_reply(struct lnet_peer *lp, struct lnet_event *ev)
 	lnet_ping_buffer_addref(pbuf);
 	lp->lp_data = pbuf;
 out:
-	lp->lp_state &= ~LNET_PEER_PING_SENT;
+	lnet_peer_clear_sent(lp, LNET_PEER_PING_SENT);
 	spin_unlock(&lp->lp_lock);
 }
 
@@ -2322,11 +2373,11 @@ lnet_discovery_event_send(struct lnet_peer *lp, struct lnet_event *ev)
 
 	spin_lock(&lp->lp_lock);
 	if (ev->msg_type == LNET_MSG_GET) {
-		lp->lp_state &= ~LNET_PEER_PING_SENT;
+		lnet_peer_clear_sent(lp, LNET_PEER_PING_SENT);
 		lp->lp_state |= LNET_PEER_PING_FAILED;
 		lp->lp_ping_error = ev->status;
 	} else { /* ev->msg_type == LNET_MSG_PUT */
-		lp->lp_state &= ~LNET_PEER_PUSH_SENT;
+		lnet_peer_clear_sent(lp, LNET_PEER_PUSH_SENT);
 		lp->lp_state |= LNET_PEER_PUSH_FAILED;
 		lp->lp_push_error = ev->status;
 	}
@@ -2351,7 +2402,7 @@ lnet_discovery_event_unlink(struct lnet_peer *lp, struct lnet_event *ev)
 	spin_lock(&lp->lp_lock);
 	/* We've passed through LNetGet() */
 	if (lp->lp_state & LNET_PEER_PING_SENT) {
-		lp->lp_state &= ~LNET_PEER_PING_SENT;
+		lnet_peer_clear_sent(lp, LNET_PEER_PING_SENT);
 		lp->lp_state |= LNET_PEER_PING_FAILED;
 		lp->lp_ping_error = -ETIMEDOUT;
 		CDEBUG(D_NET, "Ping Unlink for message to peer %s\n",
@@ -2359,7 +2410,7 @@ lnet_discovery_event_unlink(struct lnet_peer *lp, struct lnet_event *ev)
 	}
 	/* We've passed through LNetPut() */
 	if (lp->lp_state & LNET_PEER_PUSH_SENT) {
-		lp->lp_state &= ~LNET_PEER_PUSH_SENT;
+		lnet_peer_clear_sent(lp, LNET_PEER_PUSH_SENT);
 		lp->lp_state |= LNET_PEER_PUSH_FAILED;
 		lp->lp_push_error = -ETIMEDOUT;
 		CDEBUG(D_NET, "Push Unlink for message to peer %s\n",
@@ -2415,7 +2466,7 @@ static void lnet_discovery_event_handler(struct lnet_event *event)
 	 * done */
 	if (rc == LNET_REDISCOVER_PEER && !lnet_peer_is_uptodate(lp) &&
 	    lnet_peer_queue_for_discovery(lp)) {
-		list_move_tail(&lp->lp_dc_list, &the_lnet.ln_dc_request);
+		list_move_tail(&lp->lp_dc_list, lnet_peer_dc_request(lp));
 		wake_up(&the_lnet.ln_dc_waitq);
 	}
 	lnet_net_unlock(LNET_LOCK_EX);
@@ -2562,7 +2613,7 @@ lnet_peer_set_primary_data(struct lnet_peer *lp, struct lnet_ping_buffer *pbuf)
 	/* Queue lp for discovery, and force it on the request queue. */
 	lnet_net_lock(LNET_LOCK_EX);
 	if (lnet_peer_queue_for_discovery(lp))
-		list_move(&lp->lp_dc_list, &the_lnet.ln_dc_request);
+		list_move(&lp->lp_dc_list, lnet_peer_dc_request(lp));
 	lnet_net_unlock(LNET_LOCK_EX);
 
 	LNetInvalidateMDHandle(&mdh);
@@ -2791,7 +2842,7 @@ __must_hold(&lp->lp_lock)
 	int rc;
 	int cpt;
 
-	lp->lp_state |= LNET_PEER_PING_SENT;
+	lnet_peer_set_sent(lp, LNET_PEER_PING_SENT);
 	lp->lp_state &= ~LNET_PEER_FORCE_PING;
 	spin_unlock(&lp->lp_lock);
 
@@ -2836,7 +2887,8 @@ fail_error:
 	 * have set it if we called LNetMDUnlink() above.
 	 */
 	spin_lock(&lp->lp_lock);
-	lp->lp_state &= ~(LNET_PEER_PING_SENT | LNET_PEER_PING_FAILED);
+	lnet_peer_clear_sent(lp, LNET_PEER_PING_SENT);
+	lp->lp_state &= ~LNET_PEER_PING_FAILED;
 	return rc;
 }
 
@@ -2902,7 +2954,7 @@ __must_hold(&lp->lp_lock)
 		return 0;
 	}
 
-	lp->lp_state |= LNET_PEER_PUSH_SENT;
+	lnet_peer_set_sent(lp, LNET_PEER_PUSH_SENT);
 	lp->lp_state &= ~LNET_PEER_FORCE_PUSH;
 	spin_unlock(&lp->lp_lock);
 
@@ -2971,7 +3023,8 @@ fail_error:
 	 * called LNetMDUnlink() above.
 	 */
 	spin_lock(&lp->lp_lock);
-	lp->lp_state &= ~(LNET_PEER_PUSH_SENT | LNET_PEER_PUSH_FAILED);
+	lnet_peer_clear_sent(lp, LNET_PEER_PUSH_SENT);
+	lp->lp_state &= ~LNET_PEER_PUSH_FAILED;
 	return rc;
 }
 
@@ -3036,31 +3089,44 @@ static void lnet_peer_cancel_discovery(struct lnet_peer *lp)
 		LNetMDUnlink(push_mdh);
 }
 
+/*
+ * Discovery may start work on another peer when the number of pings
+ * and pushes in flight is below lnet_peer_discovery_max_inflight.
+ */
+static inline bool lnet_peer_discovery_window_open(void)
+{
+	unsigned int limit = lnet_peer_discovery_max_inflight;
+
+	return limit == 0 || atomic_read(&the_lnet.ln_dc_inflight) < limit;
+}
+
 /*
  * Wait for work to be queued or some other change that must be
  * attended to. Returns non-zero if the discovery thread should shut
- * down.
+ * down. The thread for CPT 0 also resends messages and resizes the
+ * push target.
  */
-static int lnet_peer_discovery_wait_for_work(void)
+static int lnet_peer_discovery_wait_for_work(int cpt)
 {
-	int cpt;
+	int lock_cpt;
 	int rc = 0;
 
 	DEFINE_WAIT(wait);
 
-	cpt = lnet_net_lock_current();
+	lock_cpt = lnet_net_lock_current();
 	for (;;) {
 		prepare_to_wait(&the_lnet.ln_dc_waitq, &wait,
 				TASK_INTERRUPTIBLE);
 		if (the_lnet.ln_dc_state == LNET_DC_STATE_STOPPING)
 			break;
-		if (lnet_push_target_resize_needed())
+		if (cpt == 0 && lnet_push_target_resize_needed())
 			break;
-		if (!list_empty(&the_lnet.ln_dc_request))
+		if (!list_empty(the_lnet.ln_dc_request[cpt]) &&
+		    lnet_peer_discovery_window_open())
 			break;
-		if (!list_empty(&the_lnet.ln_msg_resend))
+		if (cpt == 0 && !list_empty(&the_lnet.ln_msg_resend))
 			break;
-		lnet_net_unlock(cpt);
+		lnet_net_unlock(lock_cpt);
 
 		/*
 		 * wakeup max every second to check if there are peers that
@@ -3069,14 +3135,14 @@ static int lnet_peer_discovery_wait_for_work(void)
 		 */
 		schedule_timeout(cfs_time_seconds(1));
 		finish_wait(&the_lnet.ln_dc_waitq, &wait);
-		cpt = lnet_net_lock_current();
+		lock_cpt = lnet_net_lock_current();
 	}
 	finish_wait(&the_lnet.ln_dc_waitq, &wait);
 
 	if (the_lnet.ln_dc_state == LNET_DC_STATE_STOPPING)
 		rc = -ESHUTDOWN;
 
-	lnet_net_unlock(cpt);
+	lnet_net_unlock(lock_cpt);
 
 	CDEBUG(D_NET, "woken: %d\n", rc);
 
@@ -3125,38 +3191,103 @@ static void lnet_resend_msgs(void)
 	}
 }
 
-/* The discovery thread. */
+/*
+ * Clean up before telling lnet_peer_discovery_stop() that we're done.
+ * This is done by the last discovery thread to stop. Use wake_up()
+ * below to somewhat reduce the size of the thundering herd if there
+ * are multiple threads waiting on discovery of a single peer.
+ */
+static void lnet_peer_discovery_cleanup(void)
+{
+	struct list_head *dc_request;
+	struct lnet_peer *lp;
+	int cpt;
+
+	/* Queue cleanup 1: stop all pending pings and pushes. */
+	lnet_net_lock(LNET_LOCK_EX);
+	while (!list_empty(&the_lnet.ln_dc_working)) {
+		lp = list_first_entry(&the_lnet.ln_dc_working,
+				      struct lnet_peer, lp_dc_list);
+		list_move(&lp->lp_dc_list, &the_lnet.ln_dc_expired);
+		lnet_net_unlock(LNET_LOCK_EX);
+		lnet_peer_cancel_discovery(lp);
+		lnet_net_lock(LNET_LOCK_EX);
+	}
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	/* Queue cleanup 2: wait for the expired queue to clear. */
+	while (!list_empty(&the_lnet.ln_dc_expired))
+		schedule_timeout(cfs_time_seconds(1));
+
+	/* Queue cleanup 3: clear the request queues. */
+	lnet_net_lock(LNET_LOCK_EX);
+	cfs_percpt_for_each(dc_request, cpt, the_lnet.ln_dc_request) {
+		while (!list_empty(dc_request)) {
+			lp = list_first_entry(dc_request,
+					      struct lnet_peer, lp_dc_list);
+			lnet_peer_discovery_error(lp, -ESHUTDOWN);
+			lnet_peer_discovery_complete(lp);
+		}
+	}
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	LNetEQFree(the_lnet.ln_dc_eqh);
+	LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
+
+	the_lnet.ln_dc_state = LNET_DC_STATE_SHUTDOWN;
+	wake_up(&the_lnet.ln_dc_waitq);
+
+	CDEBUG(D_NET, "stopped\n");
+}
+
+/*
+ * The discovery thread. There is one per CPT, each working on the
+ * peers queued on the request queue of its CPT.
+ */
 static int lnet_peer_discovery(void *arg)
 {
+	int cpt = (int)(long)arg;
+	struct list_head *dc_request = the_lnet.ln_dc_request[cpt];
 	struct lnet_peer *lp;
 	int rc;
 
 	CDEBUG(D_NET, "started\n");
 	cfs_block_allsigs();
 
+	rc = cfs_cpt_bind(lnet_cpt_table(), cpt);
+	if (rc != 0)
+		CWARN("Can't set CPU partition affinity to %d: %d\n", cpt, rc);
+
 	for (;;) {
-		if (lnet_peer_discovery_wait_for_work())
+		if (lnet_peer_discovery_wait_for_work(cpt))
 			break;
 
-		lnet_resend_msgs();
+		if (cpt == 0) {
+			lnet_resend_msgs();
 
-		if (lnet_push_target_resize_needed())
-			lnet_push_target_resize();
+			if (lnet_push_target_resize_needed())
+				lnet_push_target_resize();
+		}
 
 		lnet_net_lock(LNET_LOCK_EX);
-		if (the_lnet.ln_dc_state == LNET_DC_STATE_STOPPING)
+		if (the_lnet.ln_dc_state == LNET_DC_STATE_STOPPING) {
+			lnet_net_unlock(LNET_LOCK_EX);
 			break;
+		}
 
 		/*
-		 * Process all incoming discovery work requests.  When
+		 * Process all incoming discovery work requests, as long
+		 * as the number of pings and pushes in flight stays
+		 * below lnet_peer_discovery_max_inflight.  When
 		 * discovery must wait on a peer to change state, it
 		 * is added to the tail of the ln_dc_working queue. A
 		 * timestamp keeps track of when the peer was added,
 		 * so we can time out discovery requests that take too
 		 * long.
 		 */
-		while (!list_empty(&the_lnet.ln_dc_request)) {
-			lp = list_first_entry(&the_lnet.ln_dc_request,
+		while (!list_empty(dc_request) &&
+		       lnet_peer_discovery_window_open()) {
+			lp = list_first_entry(dc_request,
 					      struct lnet_peer, lp_dc_list);
 			list_move(&lp->lp_dc_list, &the_lnet.ln_dc_working);
 			/*
@@ -3206,8 +3337,7 @@ static int lnet_peer_discovery(void *arg)
 
 			lnet_net_lock(LNET_LOCK_EX);
 			if (rc == LNET_REDISCOVER_PEER) {
-				list_move(&lp->lp_dc_list,
-					  &the_lnet.ln_dc_request);
+				list_move(&lp->lp_dc_list, dc_request);
 			} else if (rc) {
 				lnet_peer_discovery_error(lp, rc);
 			}
@@ -3221,46 +3351,9 @@ static int lnet_peer_discovery(void *arg)
 	}
 
 	CDEBUG(D_NET, "stopping\n");
-	/*
-	 * Clean up before telling lnet_peer_discovery_stop() that
-	 * we're done. Use wake_up() below to somewhat reduce the
-	 * size of the thundering herd if there are multiple threads
-	 * waiting on discovery of a single peer.
-	 */
 
-	/* Queue cleanup 1: stop all pending pings and pushes. */
-	lnet_net_lock(LNET_LOCK_EX);
-	while (!list_empty(&the_lnet.ln_dc_working)) {
-		lp = list_first_entry(&the_lnet.ln_dc_working,
-				      struct lnet_peer, lp_dc_list);
-		list_move(&lp->lp_dc_list, &the_lnet.ln_dc_expired);
-		lnet_net_unlock(LNET_LOCK_EX);
-		lnet_peer_cancel_discovery(lp);
-		lnet_net_lock(LNET_LOCK_EX);
-	}
-	lnet_net_unlock(LNET_LOCK_EX);
-
-	/* Queue cleanup 2: wait for the expired queue to clear. */
-	while (!list_empty(&the_lnet.ln_dc_expired))
-		schedule_timeout(cfs_time_seconds(1));
-
-	/* Queue cleanup 3: clear the request queue. */
-	lnet_net_lock(LNET_LOCK_EX);
-	while (!list_empty(&the_lnet.ln_dc_request)) {
-		lp = list_first_entry(&the_lnet.ln_dc_request,
-				      struct lnet_peer, lp_dc_list);
-		lnet_peer_discovery_error(lp, -ESHUTDOWN);
-		lnet_peer_discovery_complete(lp);
-	}
-	lnet_net_unlock(LNET_LOCK_EX);
-
-	LNetEQFree(the_lnet.ln_dc_eqh);
-	LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
-
-	the_lnet.ln_dc_state = LNET_DC_STATE_SHUTDOWN;
-	wake_up(&the_lnet.ln_dc_waitq);
-
-	CDEBUG(D_NET, "stopped\n");
+	if (atomic_dec_and_test(&the_lnet.ln_dc_nthreads))
+		lnet_peer_discovery_cleanup();
 
 	return 0;
 }
@@ -3270,6 +3363,7 @@ int lnet_peer_discovery_start(void)
 {
 	struct task_struct *task;
 	int rc;
+	int cpt;
 
 	if (the_lnet.ln_dc_state != LNET_DC_STATE_SHUTDOWN)
 		return -EALREADY;
@@ -3280,16 +3374,35 @@ int lnet_peer_discovery_start(void)
 		return rc;
 	}
 
+	atomic_set(&the_lnet.ln_dc_inflight, 0);
+	atomic_set(&the_lnet.ln_dc_nthreads, 0);
 	the_lnet.ln_dc_state = LNET_DC_STATE_RUNNING;
-	task = kthread_run(lnet_peer_discovery, NULL, "lnet_discovery");
-	if (IS_ERR(task)) {
+
+	for (cpt = 0; cpt < LNET_CPT_NUMBER; cpt++) {
+		atomic_inc(&the_lnet.ln_dc_nthreads);
+		if (cpt == 0)
+			task = kthread_run(lnet_peer_discovery, (void *)0L,
+					   "lnet_discovery");
+		else
+			task = kthread_run(lnet_peer_discovery,
+					   (void *)(long)cpt,
+					   "lnet_disc_%02d", cpt);
+		if (!IS_ERR(task))
+			continue;
+
 		rc = PTR_ERR(task);
-		CERROR("Can't start peer discovery thread: %d\n", rc);
+		CERROR("Can't start peer discovery thread %d: %d\n", cpt, rc);
 
-		LNetEQFree(the_lnet.ln_dc_eqh);
-		LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
+		if (atomic_dec_and_test(&the_lnet.ln_dc_nthreads)) {
+			LNetEQFree(the_lnet.ln_dc_eqh);
+			LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
 
-		the_lnet.ln_dc_state = LNET_DC_STATE_SHUTDOWN;
+			the_lnet.ln_dc_state = LNET_DC_STATE_SHUTDOWN;
+		} else {
+			/* the last thread to stop cleans up */
+			lnet_peer_discovery_stop();
+		}
+		break;
 	}
 
 	CDEBUG(D_NET, "discovery start: %d\n", rc);
@@ -3300,6 +3413,9 @@ int lnet_peer_discovery_start(void)
 /* ln_api_mutex is held on entry. */
 void lnet_peer_discovery_stop(void)
 {
+	struct list_head *dc_request;
+	int cpt;
+
 	if (the_lnet.ln_dc_state == LNET_DC_STATE_SHUTDOWN)
 		return;
 
@@ -3310,7 +3426,8 @@ void lnet_peer_discovery_stop(void)
 	wait_event(the_lnet.ln_dc_waitq,
 		   the_lnet.ln_dc_state == LNET_DC_STATE_SHUTDOWN);
 
-	LASSERT(list_empty(&the_lnet.ln_dc_request));
+	cfs_percpt_for_each(dc_request, cpt, the_lnet.ln_dc_request)
+		LASSERT(list_empty(dc_request));
 	LASSERT(list_empty(&the_lnet.ln_dc_working));
 	LASSERT(list_empty(&the_lnet.ln_dc_expired));
 
@@ -3490,6 +3607,8 @@ int lnet_get_peer_info(struct lnet_ioctl_peer_cfg *cfg, void __user *bulk)
 		lpni_info->cr_peer_min_rtr_credits = lpni->lpni_minrtrcredits;
 		lpni_info->cr_peer_min_tx_credits = lpni->lpni_mintxcredits;
 		lpni_info->cr_peer_tx_qnob = lpni->lpni_txqnob;
+		lpni_info->cr_peer_tx_credits_held = lpni->lpni_txcredits_held;
+		lpni_info->cr_peer_tx_lat_avg = lpni->lpni_tx_lat_avg;
 		if (copy_to_user(bulk, lpni_info, sizeof(*lpni_info)))
 			goto out_free_hstats;
 		bulk += sizeof(*lpni_info);
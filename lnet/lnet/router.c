@@ -46,6 +46,9 @@ MODULE_PARM_DESC(small_router_buffers, "# of small (1 page) messages to buffer i
 static int large_router_buffers;
 module_param(large_router_buffers, int, 0444);
 MODULE_PARM_DESC(large_router_buffers, "# of large messages to buffer in the router");
+static int router_buffers_autosize;
+module_param(router_buffers_autosize, int, 0644);
+MODULE_PARM_DESC(router_buffers_autosize, "Let router buffer pools grow up to this many times their configured size while messages wait for buffers (0 to disable)");
 static int peer_buffer_credits;
 module_param(peer_buffer_credits, int, 0444);
 MODULE_PARM_DESC(peer_buffer_credits, "# router buffer credits per peer");
@@ -88,6 +91,10 @@ static int router_ping_timeout = 50;
 module_param(router_ping_timeout, int, 0644);
 MODULE_PARM_DESC(router_ping_timeout, "Seconds to wait for the reply to a router health query");
 
+int weighted_routes = 1;
+module_param(weighted_routes, int, 0644);
+MODULE_PARM_DESC(weighted_routes, "Spread traffic over equivalent routes by router load and ping RTT (0 for plain round-robin)");
+
 int
 lnet_peers_start_down(void)
 {
@@ -581,7 +588,8 @@ lnet_destroy_routes (void)
 	lnet_del_route(LNET_NIDNET(LNET_NID_ANY), LNET_NID_ANY);
 }
 
-int lnet_get_rtr_pool_cfg(int cpt, struct lnet_ioctl_pool_cfg *pool_cfg)
+int lnet_get_rtr_pool_cfg(int cpt, struct lnet_ioctl_pool_cfg *pool_cfg,
+			  bool with_waits)
 {
 	struct lnet_rtrbufpool *rbp;
 	int i, rc = -ENOENT, j;
@@ -600,6 +608,8 @@ int lnet_get_rtr_pool_cfg(int cpt, struct lnet_ioctl_pool_cfg *pool_cfg)
 			pool_cfg->pl_pools[j].pl_nbuffers = rbp[j].rbp_nbuffers;
 			pool_cfg->pl_pools[j].pl_credits = rbp[j].rbp_credits;
 			pool_cfg->pl_pools[j].pl_mincredits = rbp[j].rbp_mincredits;
+			if (with_waits)
+				pool_cfg->pl_nwaits[j] = rbp[j].rbp_nwaits;
 		}
 		lnet_net_unlock(i);
 		rc = 0;
@@ -671,10 +681,41 @@ lnet_swap_pinginfo(struct lnet_ping_buffer *pbuf)
 		stat = &pbuf->pb_info.pi_ni[i];
 		__swab64s(&stat->ns_nid);
 		__swab32s(&stat->ns_status);
+		__swab32s(&stat->ns_load);
 	}
 	return;
 }
 
+/*
+ * Return how busy the router says it is for forwarding to \a net: the load
+ * of its NI on \a net, or of its busiest NI if it isn't on \a net itself.
+ */
+static unsigned int
+lnet_parse_rc_load(struct lnet_peer_ni *gw, struct lnet_ping_buffer *pbuf,
+		   int nnis, __u32 net)
+{
+	struct lnet_ni_status *stat;
+	unsigned int load = 0;
+	int i;
+
+	if ((gw->lpni_ping_feats & LNET_PING_FEAT_RTR_LOAD) == 0)
+		return 0;
+
+	for (i = 0; i < nnis; i++) {
+		stat = &pbuf->pb_info.pi_ni[i];
+		if (stat->ns_nid == LNET_NID_LO_0 ||
+		    stat->ns_status != LNET_NI_STATUS_UP)
+			continue;
+
+		if (LNET_NIDNET(stat->ns_nid) == net)
+			return min_t(unsigned int, stat->ns_load, 100);
+
+		load = max(load, stat->ns_load);
+	}
+
+	return min_t(unsigned int, load, 100);
+}
+
 /**
  * parse router-checker pinginfo, record number of down NIs for remote
  * networks on that router.
@@ -726,6 +767,8 @@ lnet_parse_rc_info(struct lnet_rc_data *rcd)
 		int	up = 0;
 		int	i;
 
+		rte->lr_load = lnet_parse_rc_load(gw, pbuf, nnis, rte->lr_net);
+
 		/* If routing disabled then the route is down. */
 		if ((gw->lpni_ping_feats & LNET_PING_FEAT_RTE_DISABLED) != 0) {
 			rte->lr_downis = 1;
@@ -780,6 +823,24 @@ out:
 	spin_unlock(&gw->lpni_lock);
 }
 
+/* fold the RTT of the ping just replied into the gateway's smoothed RTT */
+static void
+lnet_update_ping_rtt(struct lnet_peer_ni *gw)
+{
+	s64 rtt = ktime_us_delta(ktime_get(), gw->lpni_ping_sent);
+
+	if (rtt <= 0)
+		rtt = 1;
+	else if (rtt > UINT_MAX / 8)
+		rtt = UINT_MAX / 8;
+
+	/* same 1/8 gain as TCP's srtt */
+	if (gw->lpni_ping_rtt == 0)
+		gw->lpni_ping_rtt = rtt;
+	else
+		gw->lpni_ping_rtt += ((int)rtt - (int)gw->lpni_ping_rtt) / 8;
+}
+
 static void
 lnet_router_checker_event(struct lnet_event *event)
 {
@@ -814,6 +875,9 @@ lnet_router_checker_event(struct lnet_event *event)
 			goto out;
 	}
 
+	if (event->status == 0)
+		lnet_update_ping_rtt(lp);
+
 	/* LNET_EVENT_REPLY */
 	/* A successful REPLY means the router is up.  If _any_ comms
 	 * to the router fail I assume it's down (this will happen if
@@ -888,10 +952,60 @@ lnet_router_ni_update_locked(struct lnet_peer_ni *gw, __u32 net)
 	}
 }
 
+/* % of the router buffers in use, in the busiest pool of any CPT */
+static unsigned int
+lnet_rtrpools_load(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	unsigned int load = 0;
+	int busy;
+	int i;
+	int j;
+
+	if (the_lnet.ln_rtrpools == NULL)
+		return 0;
+
+	/* NB racing with forwarding on other CPTs, a sample will do */
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (j = 0; j < LNET_NRBPOOLS; j++) {
+			if (rtrp[j].rbp_nbuffers <= 0)
+				continue;
+
+			busy = rtrp[j].rbp_nbuffers - rtrp[j].rbp_credits;
+			load = max(load, (unsigned int)
+				   min(busy * 100 / rtrp[j].rbp_nbuffers, 100));
+		}
+	}
+
+	return load;
+}
+
+/* % of the tx credits of \a ni in use, on its busiest CPT */
+static unsigned int
+lnet_ni_tx_load(struct lnet_ni *ni)
+{
+	struct lnet_tx_queue *tq;
+	unsigned int load = 0;
+	int busy;
+	int i;
+
+	cfs_percpt_for_each(tq, i, ni->ni_tx_queues) {
+		if (tq->tq_credits_max <= 0)
+			continue;
+
+		busy = tq->tq_credits_max - tq->tq_credits;
+		load = max(load, (unsigned int)
+			   min(busy * 100 / tq->tq_credits_max, 100));
+	}
+
+	return load;
+}
+
 static void
 lnet_update_ni_status_locked(void)
 {
 	struct lnet_ni *ni = NULL;
+	unsigned int rtr_load;
 	time64_t now;
 	time64_t timeout;
 
@@ -900,11 +1014,16 @@ lnet_update_ni_status_locked(void)
 	timeout = router_ping_timeout +
 		  MAX(live_router_check_interval, dead_router_check_interval);
 
+	rtr_load = lnet_rtrpools_load();
 	now = ktime_get_real_seconds();
 	while ((ni = lnet_get_next_ni_locked(NULL, ni))) {
 		if (ni->ni_net->net_lnd->lnd_type == LOLND)
 			continue;
 
+		/* advertised to the peers pinging me as a router */
+		LASSERT(ni->ni_status != NULL);
+		ni->ni_status->ns_load = max(rtr_load, lnet_ni_tx_load(ni));
+
 		if (now < ni->ni_last_alive + timeout)
 			continue;
 
@@ -1113,6 +1232,7 @@ lnet_ping_router_locked(struct lnet_peer_ni *rtr)
 
 		rtr->lpni_ping_notsent   = 1;
 		rtr->lpni_ping_timestamp = now;
+		rtr->lpni_ping_sent      = ktime_get();
 
 		mdh = rcd->rcd_mdh;
 
@@ -1488,6 +1608,83 @@ lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 	rbp->rbp_npages = npages;
 	rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_autosize_mincredits = 0;
+}
+
+/* set the configured size of a pool, which autosizing never goes below */
+static int
+lnet_rtrpool_cfg_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
+{
+	rbp->rbp_cfg_nbuffers = nbufs;
+
+	return lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt);
+}
+
+/*
+ * Grow a pool by a quarter if messages had to wait for a buffer since the
+ * last check, up to router_buffers_autosize times its configured size.
+ * Shrink it back towards its configured size if at least half of the
+ * buffers stayed idle.
+ */
+static void
+lnet_rtrpool_autosize(struct lnet_rtrbufpool *rbp, int cpt)
+{
+	__u64 nwaits;
+	int idle;
+	int nbufs;
+	int max_nbufs;
+
+	lnet_net_lock(cpt);
+	nwaits = rbp->rbp_nwaits - rbp->rbp_autosize_nwaits;
+	idle = rbp->rbp_autosize_mincredits;
+	nbufs = rbp->rbp_req_nbuffers;
+	rbp->rbp_autosize_nwaits = rbp->rbp_nwaits;
+	rbp->rbp_autosize_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	if (rbp->rbp_cfg_nbuffers == 0)
+		return;
+
+	max_nbufs = rbp->rbp_cfg_nbuffers * router_buffers_autosize;
+	if (nwaits > 0 && nbufs < max_nbufs) {
+		nbufs = min(nbufs + max(nbufs / 4, 1), max_nbufs);
+	} else if (nwaits == 0 && idle > nbufs / 2 &&
+		   nbufs > rbp->rbp_cfg_nbuffers) {
+		nbufs = max(nbufs - idle / 2, rbp->rbp_cfg_nbuffers);
+	} else {
+		return;
+	}
+
+	CDEBUG(D_NET, "cpt %d: resize %d page pool from %d to %d buffers\n",
+	       cpt, rbp->rbp_npages, rbp->rbp_req_nbuffers, nbufs);
+	lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt);
+}
+
+/*
+ * Called periodically by the monitor thread. Configuration changes hold
+ * ln_api_mutex, so skip this round rather than wait for them.
+ */
+void
+lnet_rtrpools_autosize(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	int i;
+	int j;
+
+	if (router_buffers_autosize <= 1)
+		return;
+
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	if (the_lnet.ln_routing && the_lnet.ln_rtrpools != NULL) {
+		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+			for (j = 0; j < LNET_NRBPOOLS; j++)
+				lnet_rtrpool_autosize(&rtrp[j], i);
+		}
+	}
+
+	mutex_unlock(&the_lnet.ln_api_mutex);
 }
 
 void
@@ -1616,22 +1813,22 @@ lnet_rtrpools_alloc(int im_a_router)
 
 	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
 		lnet_rtrpool_init(&rtrp[LNET_TINY_BUF_IDX], 0);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_TINY_BUF_IDX],
-					      nrb_tiny, i);
+		rc = lnet_rtrpool_cfg_bufs(&rtrp[LNET_TINY_BUF_IDX],
+					   nrb_tiny, i);
 		if (rc != 0)
 			goto failed;
 
 		lnet_rtrpool_init(&rtrp[LNET_SMALL_BUF_IDX],
 				  LNET_NRB_SMALL_PAGES);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_SMALL_BUF_IDX],
-					      nrb_small, i);
+		rc = lnet_rtrpool_cfg_bufs(&rtrp[LNET_SMALL_BUF_IDX],
+					   nrb_small, i);
 		if (rc != 0)
 			goto failed;
 
 		lnet_rtrpool_init(&rtrp[LNET_LARGE_BUF_IDX],
 				  LNET_NRB_LARGE_PAGES);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_LARGE_BUF_IDX],
-					      nrb_large, i);
+		rc = lnet_rtrpool_cfg_bufs(&rtrp[LNET_LARGE_BUF_IDX],
+					   nrb_large, i);
 		if (rc != 0)
 			goto failed;
 	}
@@ -1660,8 +1857,8 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		tiny_router_buffers = tiny;
 		nrb = lnet_nrb_tiny_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_TINY_BUF_IDX],
-						      nrb, i);
+			rc = lnet_rtrpool_cfg_bufs(&rtrp[LNET_TINY_BUF_IDX],
+						   nrb, i);
 			if (rc != 0)
 				return rc;
 		}
@@ -1670,8 +1867,8 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		small_router_buffers = small;
 		nrb = lnet_nrb_small_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_SMALL_BUF_IDX],
-						      nrb, i);
+			rc = lnet_rtrpool_cfg_bufs(&rtrp[LNET_SMALL_BUF_IDX],
+						   nrb, i);
 			if (rc != 0)
 				return rc;
 		}
@@ -1680,8 +1877,8 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		large_router_buffers = large;
 		nrb = lnet_nrb_large_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_LARGE_BUF_IDX],
-						      nrb, i);
+			rc = lnet_rtrpool_cfg_bufs(&rtrp[LNET_LARGE_BUF_IDX],
+						   nrb, i);
 			if (rc != 0)
 				return rc;
 		}
@@ -663,10 +663,11 @@ lst_batch_info_ioctl(struct lstio_batch_info_args *args)
 }
 
 static int
-lst_stat_query_ioctl(struct lstio_stat_args *args)
+lst_stat_query_ioctl(struct lstio_stat_args *args, bool lat)
 {
         int             rc;
 	char           *name = NULL;
+	struct lstcon_stat_path path;
 
         /* TODO: not finished */
         if (args->lstio_sta_key != console_session.ses_key)
@@ -675,13 +676,22 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 	if (args->lstio_sta_resultp == NULL)
 		return -EINVAL;
 
+	if (args->lstio_sta_path < LST_PATH_NODE ||
+	    args->lstio_sta_path > LST_PATH_PEER ||
+	    (args->lstio_sta_path == LST_PATH_PEER &&
+	     args->lstio_sta_nid == LNET_NID_ANY))
+		return -EINVAL;
+
+	path.sp_path = args->lstio_sta_path;
+	path.sp_nid = args->lstio_sta_nid;
+
 	if (args->lstio_sta_idsp != NULL) {
 		if (args->lstio_sta_count <= 0)
 			return -EINVAL;
 
 		rc = lstcon_nodes_stat(args->lstio_sta_count,
                                        args->lstio_sta_idsp,
-                                       args->lstio_sta_timeout,
+				       args->lstio_sta_timeout, lat, &path,
                                        args->lstio_sta_resultp);
 	} else if (args->lstio_sta_namep != NULL) {
 		if (args->lstio_sta_nmlen <= 0 ||
@@ -696,6 +706,7 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 				    args->lstio_sta_nmlen);
 		if (rc == 0)
 			rc = lstcon_group_stat(name, args->lstio_sta_timeout,
+					       lat, &path,
 					       args->lstio_sta_resultp);
 		else
 			rc = -EFAULT;
@@ -734,9 +745,18 @@ static int lst_test_add_ioctl(struct lstio_test_args *args)
 	if (args->lstio_tes_loop == 0 || /* negative is infinite */
 	    args->lstio_tes_concur <= 0 ||
 	    args->lstio_tes_dist <= 0 ||
-	    args->lstio_tes_span <= 0)
+	    args->lstio_tes_span <= 0 ||
+	    args->lstio_tes_rate < 0)
 		return -EINVAL;
 
+	if (args->lstio_tes_rate != 0 &&
+	    (console_session.ses_features & LST_FEAT_RPC_LAT) == 0)
+		return -EOPNOTSUPP;
+
+	if ((args->lstio_tes_pin || args->lstio_tes_rtr != LNET_NID_ANY) &&
+	    (console_session.ses_features & LST_FEAT_PATH) == 0)
+		return -EOPNOTSUPP;
+
         /* have parameter, check if parameter length is valid */
         if (args->lstio_tes_param != NULL &&
             (args->lstio_tes_param_len <= 0 ||
@@ -781,6 +801,8 @@ static int lst_test_add_ioctl(struct lstio_test_args *args)
 			    args->lstio_tes_loop,
 			    args->lstio_tes_concur,
 			    args->lstio_tes_dist, args->lstio_tes_span,
+			    args->lstio_tes_rate,
+			    args->lstio_tes_pin, args->lstio_tes_rtr,
 			    src_name, dst_name, param,
 			    args->lstio_tes_param_len,
 			    &ret, args->lstio_tes_resultp);
@@ -910,7 +932,10 @@ lstcon_ioctl_entry(struct notifier_block *nb,
 		rc = lst_test_add_ioctl((struct lstio_test_args *)buf);
 		break;
 	case LSTIO_STAT_QUERY:
-		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf);
+		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf, false);
+		break;
+	case LSTIO_LAT_QUERY:
+		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf, true);
 		break;
 	default:
 		rc = -EINVAL;
@@ -224,6 +224,9 @@ lstcon_rpc_trans_name(int transop)
         if (transop == LST_TRANS_STATQRY)
                 return "STATQRY";
 
+	if (transop == LST_TRANS_LATQRY)
+		return "LATQRY";
+
         return "Unknown";
 }
 
@@ -682,7 +685,7 @@ lstcon_batrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
 
 int
 lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
-		    struct lstcon_rpc **crpc)
+		    struct lstcon_stat_path *path, struct lstcon_rpc **crpc)
 {
 	struct srpc_stat_reqst *srq;
 	int rc;
@@ -696,9 +699,42 @@ lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
         srq->str_sid  = console_session.ses_id;
         srq->str_type = 0; /* XXX remove it */
 
+	if ((feats & LST_FEAT_PATH) == 0)
+		return 0;
+
+	switch (path != NULL ? path->sp_path : LST_PATH_NODE) {
+	case LST_PATH_RAIL:
+		/* the NI this node is known by in the group */
+		srq->str_nid = nd->nd_id.nid;
+		break;
+	case LST_PATH_PEER:
+		srq->str_nid = path->sp_nid;
+		break;
+	default:
+		srq->str_nid = LNET_NID_ANY;
+		break;
+	}
+
         return 0;
 }
 
+int
+lstcon_latrpc_prep(struct lstcon_node *nd, unsigned int feats,
+		   struct lstcon_rpc **crpc)
+{
+	struct srpc_lat_reqst *lrq;
+	int rc;
+
+	rc = lstcon_rpc_prep(nd, SRPC_SERVICE_QUERY_LAT, feats, 0, 0, crpc);
+	if (rc != 0)
+		return rc;
+
+	lrq = &(*crpc)->crp_rpc->crpc_reqstmsg.msg_body.lat_reqst;
+	lrq->lat_sid = console_session.ses_id;
+
+	return 0;
+}
+
 static struct lnet_process_id_packed *
 lstcon_next_id(int idx, int nkiov, lnet_kiov_t *kiov)
 {
@@ -888,6 +924,18 @@ lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned int feats,
         trq->tsr_concur     = test->tes_concur;
         trq->tsr_is_client  = (transop == LST_TRANS_TSBCLIADD) ? 1 : 0;
         trq->tsr_stop_onerr = !!test->tes_stop_onerr;
+	if ((feats & LST_FEAT_RPC_LAT) != 0)
+		trq->tsr_rate = test->tes_rate;
+	if ((feats & LST_FEAT_PATH) != 0) {
+		/* only clients initiate test RPCs */
+		trq->tsr_src_nid = LNET_NID_ANY;
+		trq->tsr_rtr_nid = LNET_NID_ANY;
+		if (transop == LST_TRANS_TSBCLIADD) {
+			if (test->tes_pin)
+				trq->tsr_src_nid = nd->nd_id.nid;
+			trq->tsr_rtr_nid = test->tes_rtr;
+		}
+	}
 
         switch (test->tes_type) {
         case LST_TEST_PING:
@@ -972,6 +1020,7 @@ lstcon_rpc_stat_reply(struct lstcon_rpc_trans *trans, struct srpc_msg *msg,
 	struct srpc_batch_reply *bat_rep;
 	struct srpc_test_reply *test_rep;
 	struct srpc_stat_reply *stat_rep;
+	struct srpc_lat_reply *lat_rep;
 	int rc = 0;
 
 	switch (trans->tas_opc) {
@@ -1073,6 +1122,18 @@ lstcon_rpc_stat_reply(struct lstcon_rpc_trans *trans, struct srpc_msg *msg,
                 rc = stat_rep->str_status;
                 break;
 
+	case LST_TRANS_LATQRY:
+		lat_rep = &msg->msg_body.lat_reply;
+
+		if (lat_rep->lat_status == 0) {
+			lstcon_statqry_stat_success(stat, 1);
+			return;
+		}
+
+		lstcon_statqry_stat_failure(stat, 1);
+		rc = lat_rep->lat_status;
+		break;
+
         default:
                 LBUG();
         }
@@ -1144,8 +1205,13 @@ lstcon_rpc_trans_ndlist(struct list_head *ndlist,
 						&rpc);
 			break;
 		case LST_TRANS_STATQRY:
-			rc = lstcon_statrpc_prep(nd, feats, &rpc);
+			rc = lstcon_statrpc_prep(nd, feats,
+						 (struct lstcon_stat_path *)arg,
+						 &rpc);
                         break;
+		case LST_TRANS_LATQRY:
+			rc = lstcon_latrpc_prep(nd, feats, &rpc);
+			break;
                 default:
                         rc = -EINVAL;
                         break;
@@ -104,8 +104,15 @@ struct lstcon_rpc_trans {
 #define LST_TRANS_TSBSRVQRY     0x16
 
 #define LST_TRANS_STATQRY       0x21
+#define LST_TRANS_LATQRY	0x22
 
 typedef int (*lstcon_rpc_cond_func_t)(int, struct lstcon_node *, void *);
+/* which counters a stat query returns, LST_TRANS_STATQRY argument */
+struct lstcon_stat_path {
+	int			sp_path;	/* enum lst_stat_path */
+	lnet_nid_t		sp_nid;		/* peer NID of LST_PATH_PEER */
+};
+
 typedef int (*lstcon_rpc_readent_func_t)(int, struct srpc_msg *,
 					 struct lstcon_rpc_ent __user *);
 
@@ -118,7 +125,10 @@ int  lstcon_batrpc_prep(struct lstcon_node *nd, int transop, unsigned version,
 int  lstcon_testrpc_prep(struct lstcon_node *nd, int transop, unsigned version,
 			 struct lstcon_test *test, struct lstcon_rpc **crpc);
 int  lstcon_statrpc_prep(struct lstcon_node *nd, unsigned version,
+			 struct lstcon_stat_path *path,
 			 struct lstcon_rpc **crpc);
+int  lstcon_latrpc_prep(struct lstcon_node *nd, unsigned int version,
+			struct lstcon_rpc **crpc);
 void lstcon_rpc_put(struct lstcon_rpc *crpc);
 int  lstcon_rpc_trans_prep(struct list_head *translist,
 			   int transop, struct lstcon_rpc_trans **transpp);
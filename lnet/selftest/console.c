@@ -1280,8 +1280,8 @@ lstcon_verify_group(const char *name, struct lstcon_group **grp)
 
 int
 lstcon_test_add(char *batch_name, int type, int loop,
-		int concur, int dist, int span,
-		char *src_name, char *dst_name,
+		int concur, int dist, int span, int rate,
+		int pin, lnet_nid_t rtr, char *src_name, char *dst_name,
 		void *param, int paramlen, int *retp,
 		struct list_head __user *result_up)
 {
@@ -1329,6 +1329,9 @@ lstcon_test_add(char *batch_name, int type, int loop,
 	test->tes_span		= span;
 	test->tes_dist		= dist;
 	test->tes_cliidx	= 0; /* just used for creating RPC */
+	test->tes_rate		= rate;
+	test->tes_pin		= pin;
+	test->tes_rtr		= rtr;
 	test->tes_src_grp	= src_grp;
 	test->tes_dst_grp	= dst_grp;
 	INIT_LIST_HEAD(&test->tes_trans_list);
@@ -1492,8 +1495,25 @@ lstcon_statrpc_readent(int transop, struct srpc_msg *msg,
 }
 
 static int
-lstcon_ndlist_stat(struct list_head *ndlist,
-		   int timeout, struct list_head __user *result_up)
+lstcon_latrpc_readent(int transop, struct srpc_msg *msg,
+		      struct lstcon_rpc_ent __user *ent_up)
+{
+	struct srpc_lat_reply *rep = &msg->msg_body.lat_reply;
+
+	if (rep->lat_status != 0)
+		return 0;
+
+	if (copy_to_user(&ent_up->rpe_payload[0], &rep->lat_cnt,
+			 sizeof(rep->lat_cnt)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int
+lstcon_ndlist_stat(struct list_head *ndlist, int timeout, bool lat,
+		   struct lstcon_stat_path *path,
+		   struct list_head __user *result_up)
 {
 	struct list_head    head;
 	struct lstcon_rpc_trans *trans;
@@ -1501,8 +1521,20 @@ lstcon_ndlist_stat(struct list_head *ndlist,
 
 	INIT_LIST_HEAD(&head);
 
-        rc = lstcon_rpc_trans_ndlist(ndlist, &head,
-                                     LST_TRANS_STATQRY, NULL, NULL, &trans);
+	/* latency histograms need every node in the session to know them */
+	if (lat && (console_session.ses_features & LST_FEAT_RPC_LAT) == 0)
+		return -EOPNOTSUPP;
+
+	if (path != NULL && path->sp_path != LST_PATH_NODE) {
+		if (lat)
+			return -EINVAL;
+		if ((console_session.ses_features & LST_FEAT_PATH) == 0)
+			return -EOPNOTSUPP;
+	}
+
+	rc = lstcon_rpc_trans_ndlist(ndlist, &head,
+				     lat ? LST_TRANS_LATQRY : LST_TRANS_STATQRY,
+				     path, NULL, &trans);
         if (rc != 0) {
                 CERROR("Can't create transaction: %d\n", rc);
                 return rc;
@@ -1510,15 +1542,17 @@ lstcon_ndlist_stat(struct list_head *ndlist,
 
         lstcon_rpc_trans_postwait(trans, LST_VALIDATE_TIMEOUT(timeout));
 
-        rc = lstcon_rpc_trans_interpreter(trans, result_up,
-                                          lstcon_statrpc_readent);
+	rc = lstcon_rpc_trans_interpreter(trans, result_up,
+					  lat ? lstcon_latrpc_readent :
+						lstcon_statrpc_readent);
         lstcon_rpc_trans_destroy(trans);
 
         return rc;
 }
 
 int
-lstcon_group_stat(char *grp_name, int timeout,
+lstcon_group_stat(char *grp_name, int timeout, bool lat,
+		  struct lstcon_stat_path *path,
 		  struct list_head __user *result_up)
 {
 	struct lstcon_group *grp;
@@ -1530,7 +1564,8 @@ lstcon_group_stat(char *grp_name, int timeout,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&grp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&grp->grp_ndl_list, timeout, lat, path,
+				result_up);
 
 	lstcon_group_decref(grp);
 
@@ -1539,7 +1574,8 @@ lstcon_group_stat(char *grp_name, int timeout,
 
 int
 lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
-		  int timeout, struct list_head __user *result_up)
+		  int timeout, bool lat, struct lstcon_stat_path *path,
+		  struct list_head __user *result_up)
 {
 	struct lstcon_ndlink *ndl;
 	struct lstcon_group *tmp;
@@ -1574,7 +1610,8 @@ lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, timeout, lat, path,
+				result_up);
 
 	lstcon_group_decref(tmp);
 
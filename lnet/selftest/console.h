@@ -131,6 +131,9 @@ struct lstcon_test {
         int                   tes_dist;       /* nodes distribution of target group */
         int                   tes_span;       /* nodes span of target group */
         int                   tes_cliidx;     /* client index, used for RPC creating */
+	int			tes_rate;	/* RPCs/s of each client, 0 is unpaced */
+	int			tes_pin;	/* send from the NID in source group */
+	lnet_nid_t		tes_rtr;	/* pre-determined router or ANY */
 
 	struct list_head	tes_trans_list;	/* transaction list */
 	struct lstcon_group	*tes_src_grp;	/* group run the test */
@@ -246,12 +249,16 @@ extern int lstcon_batch_info(char *name,
 			     int server, int testidx, int *index_p,
 			     int *ndent_p,
 			     struct lstcon_node_ent __user *dents_up);
-extern int lstcon_group_stat(char *grp_name, int timeout,
+extern int lstcon_group_stat(char *grp_name, int timeout, bool lat,
+			     struct lstcon_stat_path *path,
 			     struct list_head __user *result_up);
 extern int lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
-			     int timeout, struct list_head __user *result_up);
+			     int timeout, bool lat,
+			     struct lstcon_stat_path *path,
+			     struct list_head __user *result_up);
 extern int lstcon_test_add(char *batch_name, int type, int loop,
-			   int concur, int dist, int span,
+			   int concur, int dist, int span, int rate,
+			   int pin, lnet_nid_t rtr,
 			   char *src_name, char *dst_name,
 			   void *param, int paramlen, int *retp,
 			   struct list_head __user *result_up);
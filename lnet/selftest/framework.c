@@ -275,6 +275,7 @@ sfw_init_session(struct sfw_session *sn, struct lst_sid sid,
 	atomic_set(&sn->sn_refcount, 1);        /* +1 for caller */
 	atomic_set(&sn->sn_brw_errors, 0);
 	atomic_set(&sn->sn_ping_errors, 0);
+	spin_lock_init(&sn->sn_lat_lock);
 	strlcpy(&sn->sn_name[0], name, sizeof(sn->sn_name));
 
 	sn->sn_timer_active = 0;
@@ -390,7 +391,17 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
                 return 0;
         }
 
-	lnet_counters_get_common(&reply->str_lnet);
+	if ((sn->sn_features & LST_FEAT_PATH) != 0 &&
+	    request->str_nid != LNET_NID_ANY) {
+		/* counters of a single rail or router */
+		if (lnet_nid_counters_get(request->str_nid,
+					  &reply->str_lnet) != 0) {
+			reply->str_status = ENOENT;
+			return 0;
+		}
+	} else {
+		lnet_counters_get_common(&reply->str_lnet);
+	}
 	srpc_get_counters(&reply->str_rpc);
 
         /* send over the msecs since the session was started
@@ -410,6 +421,47 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 	return 0;
 }
 
+static int
+sfw_get_lat(struct srpc_lat_reqst *request, struct srpc_lat_reply *reply)
+{
+	struct sfw_session *sn = sfw_data.fw_session;
+
+	reply->lat_sid = (sn == NULL) ? LST_INVALID_SID : sn->sn_id;
+
+	if (request->lat_sid.ses_nid == LNET_NID_ANY) {
+		reply->lat_status = EINVAL;
+		return 0;
+	}
+
+	if (sn == NULL || !sfw_sid_equal(request->lat_sid, sn->sn_id)) {
+		reply->lat_status = ESRCH;
+		return 0;
+	}
+
+	spin_lock(&sn->sn_lat_lock);
+	reply->lat_cnt = sn->sn_lat;
+	spin_unlock(&sn->sn_lat_lock);
+
+	reply->lat_status = 0;
+	return 0;
+}
+
+/* account a completed test RPC in the log2 usec histogram of the session */
+static void
+sfw_account_rpc_lat(struct sfw_session *sn, struct srpc_client_rpc *rpc)
+{
+	struct sfw_lat_counters *lat = &sn->sn_lat;
+	u64 usec = ktime_us_delta(ktime_get(), rpc->crpc_start);
+	int idx = min_t(int, fls64(usec), LST_LAT_NBUCKETS - 1);
+
+	spin_lock(&sn->sn_lat_lock);
+	lat->lat_count++;
+	lat->lat_sum_us += usec;
+	lat->lat_sumsq_us += usec * usec;
+	lat->lat_buckets[idx]++;
+	spin_unlock(&sn->sn_lat_lock);
+}
+
 int
 sfw_make_session(struct srpc_mksn_reqst *request, struct srpc_mksn_reply *reply)
 {
@@ -637,6 +689,7 @@ sfw_destroy_test_instance(struct sfw_test_instance *tsi)
 		tsu = list_entry(tsi->tsi_units.next,
 				 struct sfw_test_unit, tsu_list);
 		list_del(&tsu->tsu_list);
+		cancel_delayed_work_sync(&tsu->tsu_pace);
 		LIBCFS_FREE(tsu, sizeof(*tsu));
 	}
 
@@ -737,6 +790,16 @@ sfw_unpack_addtest_req(struct srpc_msg *msg)
 	return;
 }
 
+/* a paced test unit is due for its next RPC */
+static void
+sfw_test_unit_pace(struct work_struct *work)
+{
+	struct sfw_test_unit *tsu = container_of(work, struct sfw_test_unit,
+						 tsu_pace.work);
+
+	swi_schedule_workitem(&tsu->tsu_worker);
+}
+
 static int
 sfw_add_test_instance(struct sfw_batch *tsb, struct srpc_server_rpc *rpc)
 {
@@ -816,10 +879,26 @@ sfw_add_test_instance(struct sfw_batch *tsb, struct srpc_server_rpc *rpc)
 			tsu->tsu_dest.pid = id.pid;
 			tsu->tsu_instance = tsi;
 			tsu->tsu_private  = NULL;
+			INIT_DELAYED_WORK(&tsu->tsu_pace, sfw_test_unit_pace);
 			list_add_tail(&tsu->tsu_list, &tsi->tsi_units);
 		}
 	}
 
+	/* the rate is for the whole client, spread it over all units */
+	if ((msg->msg_ses_feats & LST_FEAT_RPC_LAT) != 0 &&
+	    req->tsr_rate != 0) {
+		tsi->tsi_rate = req->tsr_rate;
+		tsi->tsi_interval_ns = div_u64((u64)ndest * tsi->tsi_concur *
+					       NSEC_PER_SEC, tsi->tsi_rate);
+	}
+
+	tsi->tsi_src_nid = LNET_NID_ANY;
+	tsi->tsi_rtr_nid = LNET_NID_ANY;
+	if ((msg->msg_ses_feats & LST_FEAT_PATH) != 0) {
+		tsi->tsi_src_nid = req->tsr_src_nid;
+		tsi->tsi_rtr_nid = req->tsr_rtr_nid;
+	}
+
 	rc = tsi->tsi_ops->tso_init(tsi);
 	if (rc == 0) {
 		list_add_tail(&tsi->tsi_list, &tsb->bat_tests);
@@ -884,6 +963,9 @@ sfw_test_rpc_done(struct srpc_client_rpc *rpc)
 
         tsi->tsi_ops->tso_done_rpc(tsu, rpc);
 
+	if (rpc->crpc_status == 0)
+		sfw_account_rpc_lat(tsi->tsi_batch->bat_session, rpc);
+
 	spin_lock(&tsi->tsi_lock);
 
 	LASSERT(sfw_test_active(tsi));
@@ -949,11 +1031,44 @@ sfw_create_test_rpc(struct sfw_test_unit *tsu, struct lnet_process_id peer,
 	}
 
 	rpc->crpc_reqstmsg.msg_ses_feats = features;
+	rpc->crpc_self = tsi->tsi_src_nid;
+	rpc->crpc_rtr = tsi->tsi_rtr_nid;
 	*rpcpp = rpc;
 
 	return 0;
 }
 
+/* Return true if a paced unit has to wait for its next slot, the pacing
+ * work will reschedule it then. Units never bank more than a second of
+ * missed slots, so a stalled peer doesn't cause a burst afterwards. */
+static bool
+sfw_test_unit_throttled(struct sfw_test_unit *tsu)
+{
+	struct sfw_test_instance *tsi = tsu->tsu_instance;
+	ktime_t now = ktime_get();
+	bool throttled = false;
+	u64 wait;
+
+	spin_lock(&tsi->tsi_lock);
+
+	if (tsi->tsi_stopping) {
+		/* let sfw_run_test() finish the unit */
+	} else if (ktime_before(now, tsu->tsu_next)) {
+		wait = ktime_to_ns(ktime_sub(tsu->tsu_next, now));
+		schedule_delayed_work(&tsu->tsu_pace,
+				      nsecs_to_jiffies(wait) + 1);
+		throttled = true;
+	} else {
+		if (ktime_to_ns(ktime_sub(now, tsu->tsu_next)) > NSEC_PER_SEC)
+			tsu->tsu_next = now;
+		tsu->tsu_next = ktime_add_ns(tsu->tsu_next,
+					     tsi->tsi_interval_ns);
+	}
+
+	spin_unlock(&tsi->tsi_lock);
+	return throttled;
+}
+
 static int
 sfw_run_test(struct swi_workitem *wi)
 {
@@ -963,6 +1078,9 @@ sfw_run_test(struct swi_workitem *wi)
 
         LASSERT (wi == &tsu->tsu_worker);
 
+	if (tsi->tsi_interval_ns != 0 && sfw_test_unit_throttled(tsu))
+		return 0;
+
         if (tsi->tsi_ops->tso_prep_rpc(tsu, tsu->tsu_dest, &rpc) != 0) {
                 LASSERT (rpc == NULL);
                 goto test_done;
@@ -986,6 +1104,7 @@ sfw_run_test(struct swi_workitem *wi)
 
 	spin_lock(&rpc->crpc_lock);
 	rpc->crpc_timeout = rpc_timeout;
+	rpc->crpc_start = ktime_get();
 	srpc_post_rpc(rpc);
 	spin_unlock(&rpc->crpc_lock);
 	return 0;
@@ -1009,6 +1128,8 @@ sfw_run_batch(struct sfw_batch *tsb)
 	struct swi_workitem *wi;
 	struct sfw_test_unit *tsu;
 	struct sfw_test_instance *tsi;
+	ktime_t now = ktime_get();
+	u64 offset;
 
         if (sfw_batch_active(tsb)) {
 		CDEBUG(D_NET, "Batch already active: %llu (%d)\n",
@@ -1025,9 +1146,14 @@ sfw_run_batch(struct sfw_batch *tsb)
 
 		atomic_inc(&tsb->bat_nactive);
 
+		/* stagger paced units so the client sends at a steady rate */
+		offset = 0;
 		list_for_each_entry(tsu, &tsi->tsi_units, tsu_list) {
 			atomic_inc(&tsi->tsi_nactive);
 			tsu->tsu_loop = tsi->tsi_loop;
+			tsu->tsu_next = ktime_add_ns(now, offset);
+			if (tsi->tsi_rate != 0)
+				offset += NSEC_PER_SEC / tsi->tsi_rate;
 			wi = &tsu->tsu_worker;
 			swi_init_workitem(wi, tsu, sfw_run_test,
 					  lst_sched_test[\
@@ -1045,6 +1171,7 @@ sfw_stop_batch(struct sfw_batch *tsb, int force)
 {
 	struct sfw_test_instance *tsi;
 	struct srpc_client_rpc *rpc;
+	struct sfw_test_unit *tsu;
 
         if (!sfw_batch_active(tsb)) {
 		CDEBUG(D_NET, "Batch %llu inactive\n", tsb->bat_id.bat_id);
@@ -1062,6 +1189,14 @@ sfw_stop_batch(struct sfw_batch *tsb, int force)
 
 		tsi->tsi_stopping = 1;
 
+		/* wake up paced units waiting for their next slot */
+		if (tsi->tsi_interval_ns != 0) {
+			list_for_each_entry(tsu, &tsi->tsi_units, tsu_list) {
+				if (cancel_delayed_work(&tsu->tsu_pace))
+					swi_schedule_workitem(&tsu->tsu_worker);
+			}
+		}
+
 		if (!force) {
 			spin_unlock(&tsi->tsi_lock);
 			continue;
@@ -1315,6 +1450,11 @@ sfw_handle_server_rpc(struct srpc_server_rpc *rpc)
                                    &reply->msg_body.stat_reply);
                 break;
 
+	case SRPC_SERVICE_QUERY_LAT:
+		rc = sfw_get_lat(&request->msg_body.lat_reqst,
+				 &reply->msg_body.lat_reply);
+		break;
+
         case SRPC_SERVICE_DEBUG:
                 rc = sfw_debug_session(&request->msg_body.dbg_reqst,
                                        &reply->msg_body.dbg_reply);
@@ -1446,6 +1586,7 @@ sfw_unpack_message(struct srpc_msg *msg)
                 __swab32s(&req->str_type);
                 __swab64s(&req->str_rpyid);
                 sfw_unpack_sid(req->str_sid);
+		__swab64s(&req->str_nid);
                 return;
         }
 
@@ -1460,6 +1601,28 @@ sfw_unpack_message(struct srpc_msg *msg)
                 return;
         }
 
+	if (msg->msg_type == SRPC_MSG_LAT_REQST) {
+		struct srpc_lat_reqst *req = &msg->msg_body.lat_reqst;
+
+		__swab64s(&req->lat_rpyid);
+		sfw_unpack_sid(req->lat_sid);
+		return;
+	}
+
+	if (msg->msg_type == SRPC_MSG_LAT_REPLY) {
+		struct srpc_lat_reply *rep = &msg->msg_body.lat_reply;
+		int i;
+
+		__swab32s(&rep->lat_status);
+		sfw_unpack_sid(rep->lat_sid);
+		__swab32s(&rep->lat_cnt.lat_count);
+		__swab64s(&rep->lat_cnt.lat_sum_us);
+		__swab64s(&rep->lat_cnt.lat_sumsq_us);
+		for (i = 0; i < LST_LAT_NBUCKETS; i++)
+			__swab32s(&rep->lat_cnt.lat_buckets[i]);
+		return;
+	}
+
         if (msg->msg_type == SRPC_MSG_MKSN_REQST) {
 		struct srpc_mksn_reqst *req = &msg->msg_body.mksn_reqst;
 
@@ -1543,6 +1706,9 @@ sfw_unpack_message(struct srpc_msg *msg)
                 __swab32s(&req->tsr_service);
                 sfw_unpack_sid(req->tsr_sid);
                 __swab64s(&req->tsr_bid.bat_id);
+		__swab32s(&req->tsr_rate);
+		__swab64s(&req->tsr_src_nid);
+		__swab64s(&req->tsr_rtr_nid);
                 return;
         }
 
@@ -1607,6 +1773,7 @@ sfw_post_rpc(struct srpc_client_rpc *rpc)
 static struct srpc_service sfw_services[] = {
 	{ .sv_id = SRPC_SERVICE_DEBUG,		.sv_name = "debug", },
 	{ .sv_id = SRPC_SERVICE_QUERY_STAT,	.sv_name = "query stats", },
+	{ .sv_id = SRPC_SERVICE_QUERY_LAT,	.sv_name = "query latency", },
 	{ .sv_id = SRPC_SERVICE_MAKE_SESSION,	.sv_name = "make session", },
 	{ .sv_id = SRPC_SERVICE_REMOVE_SESSION,	.sv_name = "remove session", },
 	{ .sv_id = SRPC_SERVICE_BATCH,		.sv_name = "batch service", },
@@ -393,8 +393,8 @@ srpc_post_passive_rdma(int portal, int local, __u64 matchbits, void *buf,
 static int
 srpc_post_active_rdma(int portal, __u64 matchbits, void *buf, int len,
 		      int options, struct lnet_process_id peer,
-		      lnet_nid_t self, struct lnet_handle_md *mdh,
-		      struct srpc_event *ev)
+		      lnet_nid_t self, lnet_nid_t rtr,
+		      struct lnet_handle_md *mdh, struct srpc_event *ev)
 {
 	int rc;
 	struct lnet_md md;
@@ -417,12 +417,13 @@ srpc_post_active_rdma(int portal, __u64 matchbits, void *buf, int len,
          * they're only meaningful for MDs attached to an ME (i.e. passive
          * buffers... */
         if ((options & LNET_MD_OP_PUT) != 0) {
-                rc = LNetPut(self, *mdh, LNET_NOACK_REQ, peer,
-                             portal, matchbits, 0, 0);
+		rc = LNetPutVia(self, rtr, *mdh, LNET_NOACK_REQ, peer,
+				portal, matchbits, 0, 0);
         } else {
                 LASSERT ((options & LNET_MD_OP_GET) != 0);
 
-                rc = LNetGet(self, *mdh, peer, portal, matchbits, 0, false);
+		rc = LNetGetVia(self, rtr, *mdh, peer, portal, matchbits, 0,
+				false);
         }
 
         if (rc != 0) {
@@ -794,8 +795,8 @@ srpc_send_request(struct srpc_client_rpc *rpc)
 	rc = srpc_post_active_rdma(srpc_serv_portal(rpc->crpc_service),
 				   rpc->crpc_service, &rpc->crpc_reqstmsg,
 				   sizeof(struct srpc_msg), LNET_MD_OP_PUT,
-				   rpc->crpc_dest, LNET_NID_ANY,
-				   &rpc->crpc_reqstmdh, ev);
+				   rpc->crpc_dest, rpc->crpc_self,
+				   rpc->crpc_rtr, &rpc->crpc_reqstmdh, ev);
         if (rc != 0) {
                 LASSERT (rc == -ENOMEM);
                 ev->ev_fired = 1;  /* no more event expected */
@@ -880,8 +881,8 @@ srpc_do_bulk(struct srpc_server_rpc *rpc)
 
         rc = srpc_post_active_rdma(SRPC_RDMA_PORTAL, id,
                                    &bk->bk_iovs[0], bk->bk_niov, opt,
-                                   rpc->srpc_peer, rpc->srpc_self,
-                                   &bk->bk_mdh, ev);
+				   rpc->srpc_peer, rpc->srpc_self,
+				   LNET_NID_ANY, &bk->bk_mdh, ev);
         if (rc != 0)
                 ev->ev_fired = 1;  /* no more event expected */
         return rc;
@@ -1383,8 +1384,8 @@ srpc_send_reply(struct srpc_server_rpc *rpc)
 
         rc = srpc_post_active_rdma(SRPC_RDMA_PORTAL, rpyid, msg,
                                    sizeof(*msg), LNET_MD_OP_PUT,
-                                   rpc->srpc_peer, rpc->srpc_self,
-                                   &rpc->srpc_replymdh, ev);
+				   rpc->srpc_peer, rpc->srpc_self,
+				   LNET_NID_ANY, &rpc->srpc_replymdh, ev);
         if (rc != 0)
                 ev->ev_fired = 1;  /* no more event expected */
         return rc;
@@ -77,6 +77,7 @@ struct sfw_test_instance;
 #define SRPC_SERVICE_TEST               4
 #define SRPC_SERVICE_QUERY_STAT         5
 #define SRPC_SERVICE_JOIN               6
+#define SRPC_SERVICE_QUERY_LAT		7
 #define SRPC_FRAMEWORK_SERVICE_MAX_ID   10
 /* other services start from SRPC_FRAMEWORK_SERVICE_MAX_ID+1 */
 #define SRPC_SERVICE_BRW                11
@@ -121,6 +122,9 @@ srpc_service2request (int service)
 
         case SRPC_SERVICE_JOIN:
                 return SRPC_MSG_JOIN_REQST;
+
+	case SRPC_SERVICE_QUERY_LAT:
+		return SRPC_MSG_LAT_REQST;
         }
 }
 
@@ -227,6 +231,11 @@ struct srpc_client_rpc {
 	struct srpc_msg		crpc_replymsg;
 	struct lnet_handle_md	crpc_reqstmdh;
 	struct lnet_handle_md	crpc_replymdh;
+	/* when a test RPC was posted, for latency stats */
+	ktime_t			crpc_start;
+	/* local NID and router the request is sent with, or LNET_NID_ANY */
+	lnet_nid_t		crpc_self;
+	lnet_nid_t		crpc_rtr;
 	struct srpc_bulk	crpc_bulk;
 };
 
@@ -334,6 +343,8 @@ struct sfw_session {
 	atomic_t		sn_brw_errors;
 	atomic_t		sn_ping_errors;
 	ktime_t			sn_started;
+	spinlock_t		sn_lat_lock;	/* serialize sn_lat */
+	struct sfw_lat_counters	sn_lat;		/* test RPC latency */
 };
 
 #define sfw_sid_equal(sid0, sid1)     ((sid0).ses_nid == (sid1).ses_nid && \
@@ -369,6 +380,13 @@ struct sfw_test_instance {
 	unsigned int		tsi_stoptsu_onerr:1; /* stop tsu on error */
         int                     tsi_concur;          /* concurrency */
         int                     tsi_loop;            /* loop count */
+	/* RPCs per second of all units, 0 is unpaced */
+	unsigned int		tsi_rate;
+	/* interval between RPCs of a test unit when paced */
+	u64			tsi_interval_ns;
+	/* pinned source NID and router of test RPCs, or LNET_NID_ANY */
+	lnet_nid_t		tsi_src_nid;
+	lnet_nid_t		tsi_rtr_nid;
 
 	/* status of test instance */
 	spinlock_t		tsi_lock;	/* serialize */
@@ -399,6 +417,8 @@ struct sfw_test_unit {
 	struct sfw_test_instance *tsu_instance;	/* pointer to test instance */
 	void			*tsu_private;	/* private data */
 	struct swi_workitem	 tsu_worker;	/* workitem of the test unit */
+	ktime_t			 tsu_next;	/* paced: time of next RPC */
+	struct delayed_work	 tsu_pace;	/* paced: wakes tsu_worker */
 };
 
 struct sfw_test_case {
@@ -533,6 +553,8 @@ srpc_init_client_rpc(struct srpc_client_rpc *rpc, struct lnet_process_id peer,
 	atomic_set(&rpc->crpc_refcount, 1); /* 1 ref for caller */
 
 	rpc->crpc_dest         = peer;
+	rpc->crpc_self         = LNET_NID_ANY;
+	rpc->crpc_rtr          = LNET_NID_ANY;
 	rpc->crpc_priv         = priv;
         rpc->crpc_service      = service;
         rpc->crpc_bulk.bk_len  = bulklen;
@@ -2826,6 +2826,10 @@ calculate_buffers:
 						pool_cfg->pl_pools[j].
 						   pl_mincredits) == NULL)
 				goto out;
+			if (!backup &&
+			    cYAML_create_number(type_node, "waits",
+						pool_cfg->pl_nwaits[j]) == NULL)
+				goto out;
 			/* keep track of the total count for each of the
 			 * tiny, small and large buffers */
 			buf_count[j] += pool_cfg->pl_pools[j].pl_nbuffers;
@@ -3111,6 +3115,16 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 			    == NULL)
 				goto out;
 
+			if (cYAML_create_number(peer_ni, "held_tx_credits",
+						lpni_cri->cr_peer_tx_credits_held)
+			    == NULL)
+				goto out;
+
+			if (cYAML_create_number(peer_ni, "avg_tx_latency_us",
+						lpni_cri->cr_peer_tx_lat_avg)
+			    == NULL)
+				goto out;
+
 			if (cYAML_create_number(peer_ni, "available_rtr_credits",
 						lpni_cri->cr_peer_rtr_credits)
 			    == NULL)
@@ -3856,6 +3870,115 @@ out:
 	return rc;
 }
 
+static int add_lat_hist(struct cYAML *parent, char *name, __u32 *buckets)
+{
+	struct cYAML *hist;
+	char key[32];
+	int i;
+
+	hist = cYAML_create_object(parent, name);
+	if (!hist)
+		return -1;
+
+	/* each bucket is keyed by its upper bound in microseconds */
+	for (i = 0; i < LNET_LAT_HIST_NBUCKETS; i++) {
+		if (i == LNET_LAT_HIST_NBUCKETS - 1)
+			snprintf(key, sizeof(key), "inf");
+		else
+			snprintf(key, sizeof(key), "%lu", 1UL << i);
+		if (!cYAML_create_number(hist, key, buckets[i]))
+			return -1;
+	}
+
+	return 0;
+}
+
+int lustre_lnet_show_lat_stats(char *nid, bool peer, bool reset, int seq_no,
+			       struct cYAML **show_rc, struct cYAML **err_rc)
+{
+	struct lnet_ioctl_lat_stats data;
+	int rc;
+	int l_errno;
+	char err_str[LNET_MAX_STR_LEN];
+	struct cYAML *root = NULL, *lat = NULL, *item = NULL;
+
+	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
+
+	if (nid == NULL) {
+		snprintf(err_str, sizeof(err_str), "\"missing nid\"");
+		rc = LUSTRE_CFG_RC_MISSING_PARAM;
+		goto out;
+	}
+
+	LIBCFS_IOC_INIT_V2(data, ls_hdr);
+	data.ls_nid = libcfs_str2nid(nid);
+	if (data.ls_nid == LNET_NID_ANY) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"bad nid: %s\"", nid);
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+	data.ls_peer = peer;
+	data.ls_reset = reset;
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_LAT_STATS, &data);
+	if (rc) {
+		l_errno = errno;
+		snprintf(err_str,
+			 sizeof(err_str),
+			 "\"cannot get latency statistics for %s: %s\"",
+			 nid, strerror(l_errno));
+		rc = -l_errno;
+		goto out;
+	}
+
+	rc = LUSTRE_CFG_RC_OUT_OF_MEM;
+
+	root = cYAML_create_object(NULL, NULL);
+	if (!root)
+		goto out;
+
+	lat = cYAML_create_seq(root, "latency");
+	if (!lat)
+		goto out;
+
+	item = cYAML_create_seq_item(lat);
+	if (!item)
+		goto out;
+
+	if (!cYAML_create_string(item, "nid", libcfs_nid2str(data.ls_nid)))
+		goto out;
+
+	if (!cYAML_create_string(item, "type", peer ? "peer_ni" : "local_ni"))
+		goto out;
+
+	if (add_lat_hist(item, "send_usec", data.ls_send) != 0)
+		goto out;
+
+	if (add_lat_hist(item, "wait_usec", data.ls_wait) != 0)
+		goto out;
+
+	if (!show_rc)
+		cYAML_print_tree(root);
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+	rc = LUSTRE_CFG_RC_NO_ERR;
+out:
+	if (show_rc == NULL || rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_free_tree(root);
+	} else if (show_rc != NULL && *show_rc != NULL) {
+		cYAML_insert_sibling((*show_rc)->cy_child,
+					root->cy_child);
+		free(root);
+	} else {
+		*show_rc = root;
+	}
+
+	cYAML_build_error(rc, seq_no, SHOW_CMD, "latency", err_str, err_rc);
+
+	return rc;
+}
+
 typedef int (*cmd_handler_t)(struct cYAML *tree,
 			     struct cYAML **show_rc,
 			     struct cYAML **err_rc);
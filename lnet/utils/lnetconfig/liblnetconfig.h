@@ -467,6 +467,21 @@ int lustre_lnet_show_routing(int seq_no, struct cYAML **show_rc,
 int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_show_lat_stats
+ *   Shows the send completion and credit wait latency histograms of a
+ *   local NI or a peer NI.
+ *
+ *     nid - NID of the local NI or peer NI
+ *     peer - true if nid is a peer NI
+ *     reset - clear the histograms after reading them
+ *     seq_no - sequence number of the command
+ *     show_rc - YAML structure of the resultant show
+ *     err_rc - YAML strucutre of the resultant return code.
+ */
+int lustre_lnet_show_lat_stats(char *nid, bool peer, bool reset, int seq_no,
+			       struct cYAML **show_rc, struct cYAML **err_rc);
+
 /*
  * lustre_lnet_config_peer_nid
  *   Add a peer nid to a peer with primary nid pnid. If no pnid is given
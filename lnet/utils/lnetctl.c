@@ -47,6 +47,7 @@ static int jt_show_route(int argc, char **argv);
 static int jt_show_net(int argc, char **argv);
 static int jt_show_routing(int argc, char **argv);
 static int jt_show_stats(int argc, char **argv);
+static int jt_show_lat_stats(int argc, char **argv);
 static int jt_show_peer(int argc, char **argv);
 static int jt_show_recovery(int argc, char **argv);
 static int jt_show_global(int argc, char **argv);
@@ -92,7 +93,7 @@ command_t cmd_list[] = {
 			   " | discovery}"},
 	{"import", jt_import, 0, "import FILE.yaml"},
 	{"export", jt_export, 0, "export FILE.yaml"},
-	{"stats", jt_stats, 0, "stats {show | help}"},
+	{"stats", jt_stats, 0, "stats {show | latency | help}"},
 	{"debug", jt_debug, 0, "debug recovery {local | peer}"},
 	{"global", jt_global, 0, "global {show | help}"},
 	{"peer", jt_peers, 0, "peer {add | del | show | help}"},
@@ -161,6 +162,10 @@ command_t routing_cmds[] = {
 
 command_t stats_cmds[] = {
 	{"show", jt_show_stats, 0, "show LNET statistics\n"},
+	{"latency", jt_show_lat_stats, 0, "show latency histograms\n"
+	 "\t--nid: NID of the local NI or peer NI\n"
+	 "\t--peer: the NID is a peer NI\n"
+	 "\t--reset: clear the histograms after showing them\n"},
 	{ 0, 0, 0, NULL }
 };
 
@@ -1242,6 +1247,56 @@ static int jt_show_stats(int argc, char **argv)
 	return rc;
 }
 
+static int jt_show_lat_stats(int argc, char **argv)
+{
+	char *nid = NULL;
+	bool peer = false, reset = false;
+	int rc, opt;
+	struct cYAML *show_rc = NULL, *err_rc = NULL;
+
+	const char *const short_options = "n:pr";
+	static const struct option long_options[] = {
+		{ .name = "nid",   .has_arg = required_argument, .val = 'n' },
+		{ .name = "peer",  .has_arg = no_argument,	 .val = 'p' },
+		{ .name = "reset", .has_arg = no_argument,	 .val = 'r' },
+		{ .name = NULL } };
+
+	rc = check_cmd(stats_cmds, "stats", "latency", 0, argc, argv);
+	if (rc)
+		return rc;
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			nid = optarg;
+			break;
+		case 'p':
+			peer = true;
+			break;
+		case 'r':
+			reset = true;
+			break;
+		case '?':
+			print_help(stats_cmds, "stats", "latency");
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_show_lat_stats(nid, peer, reset, -1, &show_rc, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+	else if (show_rc)
+		cYAML_print_tree(show_rc);
+
+	cYAML_free_tree(err_rc);
+	cYAML_free_tree(show_rc);
+
+	return rc;
+}
+
 static int jt_show_global(int argc, char **argv)
 {
 	int rc;
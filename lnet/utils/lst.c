@@ -58,7 +58,9 @@ static struct lst_sid session_id;
 static int                 session_key;
 static int lst_list_commands(int argc, char **argv);
 
-/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN */
+/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN,
+ * older releases don't know LST_FEAT_RPC_LAT or LST_FEAT_PATH, set
+ * LST_FEATURES=1 to test with them */
 static unsigned		session_features = LST_FEATS_MASK;
 static struct lstcon_trans_stat	trans_stat;
 
@@ -1486,7 +1488,8 @@ jt_lst_list_group(int argc, char **argv)
 
 int
 lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
-	       int timeout, struct list_head *resultp)
+	       int timeout, int lat, int path, lnet_nid_t nid,
+	       struct list_head *resultp)
 {
 	struct lstio_stat_args args = { 0 };
 
@@ -1497,8 +1500,11 @@ lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
 	args.lstio_sta_count   = count;
 	args.lstio_sta_idsp    = idsp;
 	args.lstio_sta_resultp = resultp;
+	args.lstio_sta_path    = path;
+	args.lstio_sta_nid     = nid;
 
-	return lst_ioctl(LSTIO_STAT_QUERY, &args, sizeof(args));
+	return lst_ioctl(lat ? LSTIO_LAT_QUERY : LSTIO_STAT_QUERY,
+			 &args, sizeof(args));
 }
 
 typedef struct {
@@ -1524,7 +1530,8 @@ lst_stat_req_param_free(lst_stat_req_param_t *srp)
 }
 
 static int
-lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
+lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old,
+			 int lat)
 {
         lst_stat_req_param_t *srp = NULL;
         int                   count = save_old ? 2 : 1;
@@ -1559,6 +1566,7 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
 
 	for (i = 0; i < count; i++) {
 		rc = lst_alloc_rpcent(&srp->srp_result[i], srp->srp_count,
+				      lat ? sizeof(struct sfw_lat_counters) :
 				      sizeof(struct sfw_counters)  +
 				      sizeof(struct srpc_counters) +
 				      sizeof(struct lnet_counters_common));
@@ -1874,6 +1882,123 @@ lst_print_stat(char *name, struct list_head *resultp,
 	lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
 }
 
+static uint64_t
+lst_isqrt(uint64_t n)
+{
+	uint64_t x = n;
+	uint64_t y = (x + 1) / 2;
+
+	while (y < x) {
+		x = y;
+		y = (x + n / x) / 2;
+	}
+
+	return x;
+}
+
+/* estimate the latency at permille @pm of histogram @lat, interpolating
+ * linearly inside the log2 bucket it lands in */
+static float
+lst_lat_percentile(struct sfw_lat_counters *lat, int pm)
+{
+	uint64_t target = ((uint64_t)lat->lat_count * pm + 999) / 1000;
+	uint64_t seen = 0;
+	float lo;
+	float hi;
+	int i;
+
+	for (i = 0; i < LST_LAT_NBUCKETS; i++) {
+		if (seen + lat->lat_buckets[i] >= target)
+			break;
+		seen += lat->lat_buckets[i];
+	}
+
+	if (i == LST_LAT_NBUCKETS) /* counters changed under us */
+		i = LST_LAT_NBUCKETS - 1;
+
+	lo = i == 0 ? 0 : (float)(1ULL << (i - 1));
+	hi = (float)(1ULL << i);
+	/* the last bucket is open ended, report its lower bound */
+	if (i == LST_LAT_NBUCKETS - 1 || lat->lat_buckets[i] == 0)
+		return lo;
+
+	return lo + (hi - lo) * (target - seen) / lat->lat_buckets[i];
+}
+
+static void
+lst_print_lat(char *name, struct list_head *resultp, int idx)
+{
+	struct sfw_lat_counters sum;
+	struct sfw_lat_counters *new;
+	struct sfw_lat_counters *old;
+	struct lstcon_rpc_ent *ent_new;
+	struct lstcon_rpc_ent *ent_old;
+	struct list_head *pos_new;
+	struct list_head *pos_old;
+	uint64_t mean;
+	uint64_t var;
+	int errcount = 0;
+	int i;
+
+	memset(&sum, 0, sizeof(sum));
+
+	pos_old = resultp[1 - idx].next;
+	list_for_each(pos_new, &resultp[idx]) {
+		if (pos_old == &resultp[1 - idx]) {
+			fprintf(stderr, "Group is changed, re-run stat\n");
+			return;
+		}
+
+		ent_new = list_entry(pos_new, struct lstcon_rpc_ent, rpe_link);
+		ent_old = list_entry(pos_old, struct lstcon_rpc_ent, rpe_link);
+		pos_old = pos_old->next;
+
+		/* first time get stats result, can't calculate diff */
+		if (ent_new->rpe_peer.nid == LNET_NID_ANY)
+			return;
+
+		if (ent_new->rpe_peer.nid != ent_old->rpe_peer.nid ||
+		    ent_new->rpe_peer.pid != ent_old->rpe_peer.pid)
+			return;
+
+		if (ent_new->rpe_rpc_errno != 0 || ent_new->rpe_fwk_errno != 0 ||
+		    ent_old->rpe_rpc_errno != 0 || ent_old->rpe_fwk_errno != 0) {
+			errcount++;
+			continue;
+		}
+
+		new = (struct sfw_lat_counters *)&ent_new->rpe_payload[0];
+		old = (struct sfw_lat_counters *)&ent_old->rpe_payload[0];
+
+		/* unsigned arithmetic also copes with wrapped counters */
+		sum.lat_count += new->lat_count - old->lat_count;
+		sum.lat_sum_us += new->lat_sum_us - old->lat_sum_us;
+		sum.lat_sumsq_us += new->lat_sumsq_us - old->lat_sumsq_us;
+		for (i = 0; i < LST_LAT_NBUCKETS; i++)
+			sum.lat_buckets[i] += new->lat_buckets[i] -
+					      old->lat_buckets[i];
+	}
+
+	if (errcount > 0)
+		fprintf(stdout, "Failed to stat on %d nodes\n", errcount);
+
+	fprintf(stdout, "[RPC latency of %s]\n", name);
+	if (sum.lat_count == 0) {
+		fprintf(stdout, "No RPC completed\n");
+		return;
+	}
+
+	mean = sum.lat_sum_us / sum.lat_count;
+	var = sum.lat_sumsq_us / sum.lat_count;
+	var = var > mean * mean ? var - mean * mean : 0;
+
+	fprintf(stdout, "RPCs: %-8u Avg: %-8"PRIu64" usec Jitter: %-8"PRIu64
+		" usec\n", sum.lat_count, mean, lst_isqrt(var));
+	fprintf(stdout, "p50: %-8.0f usec p99: %-8.0f usec p99.9: %-8.0f usec\n",
+		lst_lat_percentile(&sum, 500), lst_lat_percentile(&sum, 990),
+		lst_lat_percentile(&sum, 999));
+}
+
 int
 jt_lst_stat(int argc, char **argv)
 {
@@ -1892,6 +2017,9 @@ jt_lst_stat(int argc, char **argv)
 	int		      rc;
 	int		      c;
 	int		      mbs     = 0; /* report as MB/s */
+	int		      lat     = 0; /* RPC latency instead */
+	int		      path    = LST_PATH_NODE;
+	lnet_nid_t	      nid     = LNET_NID_ANY;
 
 	static const struct option stat_opts[] = {
 		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
@@ -1907,6 +2035,9 @@ jt_lst_stat(int argc, char **argv)
 		{ .name = "min",     .has_arg = no_argument,       .val = 'n' },
 		{ .name = "max",     .has_arg = no_argument,       .val = 'x' },
 		{ .name = "mbs",     .has_arg = no_argument,       .val = 'm' },
+		{ .name = "lat",     .has_arg = no_argument,       .val = 'L' },
+		{ .name = "rail",    .has_arg = no_argument,       .val = 'R' },
+		{ .name = "router",  .has_arg = required_argument, .val = 'G' },
 		{ .name = NULL } };
 
         if (session_key == 0) {
@@ -1916,7 +2047,7 @@ jt_lst_stat(int argc, char **argv)
         }
 
         while (1) {
-		c = getopt_long(argc, argv, "t:d:lcbarwgnxm", stat_opts,
+		c = getopt_long(argc, argv, "t:d:lcbarwgnxmLRG:", stat_opts,
 				&optidx);
 
                 if (c == -1)
@@ -1974,6 +2105,21 @@ jt_lst_stat(int argc, char **argv)
 		case 'm':
 			mbs = 1;
 			break;
+		case 'L':
+			lat = 1;
+			break;
+		case 'R':
+			path = LST_PATH_RAIL;
+			break;
+		case 'G':
+			path = LST_PATH_PEER;
+			nid = libcfs_str2nid(optarg);
+			if (nid == LNET_NID_ANY) {
+				fprintf(stderr, "Invalid router NID: %s\n",
+					optarg);
+				return -1;
+			}
+			break;
 
 		default:
 			lst_print_usage(argv[0]);
@@ -1996,6 +2142,16 @@ jt_lst_stat(int argc, char **argv)
             return -1;
         }
 
+	if (lat && path != LST_PATH_NODE) {
+		fprintf(stderr,
+			"--lat can't be used with --rail or --router\n");
+		return -1;
+	}
+
+	/* only LNet counters are kept per rail and per router */
+	if (path != LST_PATH_NODE)
+		lnet = 1;
+
         /* extra count to get first data point */
         if (count != -1)
             count++;
@@ -2003,7 +2159,7 @@ jt_lst_stat(int argc, char **argv)
 	INIT_LIST_HEAD(&head);
 
         while (optind < argc) {
-                rc = lst_stat_req_param_alloc(argv[optind++], &srp, 1);
+		rc = lst_stat_req_param_alloc(argv[optind++], &srp, 1, lat);
                 if (rc != 0)
                         goto out;
 
@@ -2020,17 +2176,23 @@ jt_lst_stat(int argc, char **argv)
 		last = now;
 
 		list_for_each_entry(srp, &head, srp_link) {
-                        rc = lst_stat_ioctl(srp->srp_name,
-                                            srp->srp_count, srp->srp_ids,
-                                            timeout, &srp->srp_result[idx]);
+			rc = lst_stat_ioctl(srp->srp_name,
+					    srp->srp_count, srp->srp_ids,
+					    timeout, lat, path, nid,
+					    &srp->srp_result[idx]);
                         if (rc == -1) {
                                 lst_print_error("stat", "Failed to stat %s: %s\n",
                                                 srp->srp_name, strerror(errno));
                                 goto out;
                         }
 
-			lst_print_stat(srp->srp_name, srp->srp_result,
-				       idx, lnet, bwrt, rdwr, type, mbs);
+			if (lat)
+				lst_print_lat(srp->srp_name, srp->srp_result,
+					      idx);
+			else
+				lst_print_stat(srp->srp_name, srp->srp_result,
+					       idx, lnet, bwrt, rdwr, type,
+					       mbs);
 
 			lst_reset_rpcent(&srp->srp_result[1 - idx]);
 		}
@@ -2101,7 +2263,7 @@ jt_lst_show_error(int argc, char **argv)
 	INIT_LIST_HEAD(&head);
 
         while (optind < argc) {
-                rc = lst_stat_req_param_alloc(argv[optind++], &srp, 0);
+		rc = lst_stat_req_param_alloc(argv[optind++], &srp, 0, 0);
                 if (rc != 0)
                         goto out;
 
@@ -2109,8 +2271,9 @@ jt_lst_show_error(int argc, char **argv)
         }
 
 	list_for_each_entry(srp, &head, srp_link) {
-                rc = lst_stat_ioctl(srp->srp_name, srp->srp_count,
-                                    srp->srp_ids, 10, &srp->srp_result[0]);
+		rc = lst_stat_ioctl(srp->srp_name, srp->srp_count,
+				    srp->srp_ids, 10, 0, LST_PATH_NODE,
+				    LNET_NID_ANY, &srp->srp_result[0]);
 
                 if (rc == -1) {
                         lst_print_error(srp->srp_name, "Failed to show errors of %s: %s\n",
@@ -3063,7 +3226,8 @@ lst_get_test_param(char *test, int argc, char **argv, void **param, int *plen)
 
 int
 lst_add_test_ioctl(char *batch, int type, int loop, int concur,
-                   int dist, int span, char *sgrp, char *dgrp,
+		   int dist, int span, int rate, int pin, lnet_nid_t rtr,
+		   char *sgrp, char *dgrp,
 		   void *param, int plen, int *retp, struct list_head *resultp)
 {
 	struct lstio_test_args args = { 0 };
@@ -3085,6 +3249,9 @@ lst_add_test_ioctl(char *batch, int type, int loop, int concur,
         args.lstio_tes_param      = param;
         args.lstio_tes_retp       = retp;
         args.lstio_tes_resultp    = resultp;
+	args.lstio_tes_rate	  = rate;
+	args.lstio_tes_pin	  = pin;
+	args.lstio_tes_rtr	  = rtr;
 
         return lst_ioctl(LSTIO_TEST_ADD, &args, sizeof(args));
 }
@@ -3104,6 +3271,9 @@ jt_lst_add_test(int argc, char **argv)
 	int   loop   = -1;
 	int   dist   = 1;
 	int   span   = 1;
+	int   rate   = 0;
+	int   pin    = 0;
+	lnet_nid_t rtr = LNET_NID_ANY;
 	int   plen   = 0;
 	int   fcount = 0;
 	int   tcount = 0;
@@ -3119,6 +3289,9 @@ jt_lst_add_test(int argc, char **argv)
 	{ .name = "from",	 .has_arg = required_argument, .val = 'f' },
 	{ .name = "to",		 .has_arg = required_argument, .val = 't' },
 	{ .name = "loop",	 .has_arg = required_argument, .val = 'l' },
+	{ .name = "rate",	 .has_arg = required_argument, .val = 'r' },
+	{ .name = "pin",	 .has_arg = no_argument,       .val = 'p' },
+	{ .name = "via",	 .has_arg = required_argument, .val = 'v' },
 	{ .name = NULL } };
 
         if (session_key == 0) {
@@ -3128,7 +3301,7 @@ jt_lst_add_test(int argc, char **argv)
         }
 
         while (1) {
-                c = getopt_long(argc, argv, "b:c:d:f:l:t:",
+		c = getopt_long(argc, argv, "b:c:d:f:l:r:t:pv:",
                                 add_test_opts, &optidx);
 
                 /* Detect the end of the options. */
@@ -3151,6 +3324,20 @@ jt_lst_add_test(int argc, char **argv)
                 case 'l':
                         loop = atoi(optarg);
                         break;
+		case 'r':
+			rate = atoi(optarg);
+			break;
+		case 'p':
+			pin = 1;
+			break;
+		case 'v':
+			rtr = libcfs_str2nid(optarg);
+			if (rtr == LNET_NID_ANY) {
+				fprintf(stderr, "Invalid router NID: %s\n",
+					optarg);
+				return -1;
+			}
+			break;
                 case 't':
                         to = optarg;
                         break;
@@ -3170,6 +3357,11 @@ jt_lst_add_test(int argc, char **argv)
                 return -1;
         }
 
+	if (rate < 0) {
+		fprintf(stderr, "Invalid rate of test: %d\n", rate);
+		return -1;
+	}
+
         if (batch == NULL)
                 batch = LST_DEFAULT_BATCH;
 
@@ -3214,8 +3406,8 @@ jt_lst_add_test(int argc, char **argv)
                 goto out;
         }
 
-        rc = lst_add_test_ioctl(batch, type, loop, concur,
-                                dist, span, from, to, param, plen, &ret, &head);
+	rc = lst_add_test_ioctl(batch, type, loop, concur, dist, span, rate,
+				pin, rtr, from, to, param, plen, &ret, &head);
 
         if (rc == 0) {
                 fprintf(stdout, "Test was added successfully\n");
@@ -3263,7 +3455,8 @@ static command_t lst_cmdlist[] = {
           "Usage: lst list_group [--active] [--busy] [--down] [--unknown] GROUP ..."    },
 	{"stat",                jt_lst_stat,            NULL,
 	 "Usage: lst stat [--bw] [--rate] [--read] [--write] [--max] [--min] [--avg] "
-	 " [--mbs] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"                 },
+	 " [--mbs] [--lat] [--rail] [--router NID] [--timeout #] [--delay #]"
+	 " [--count #] GROUP [GROUP]"                                                   },
         {"show_error",          jt_lst_show_error,      NULL,
          "Usage: lst show_error NAME | IDS ..."                                         },
         {"add_batch",           jt_lst_add_batch,       NULL,
@@ -3278,7 +3471,8 @@ static command_t lst_cmdlist[] = {
          "Usage: lst query [--test ID] [--server] [--timeout TIME] NAME"                },
         {"add_test",            jt_lst_add_test,        NULL,
          "Usage: lst add_test [--batch BATCH] [--loop #] [--concurrency #] "
-         " [--distribute #:#] [--from GROUP] [--to GROUP] TEST..."                      },
+         " [--distribute #:#] [--rate #] [--pin] [--via NID] [--from GROUP]"
+         " [--to GROUP] TEST..."                                                        },
         {"help",                Parser_help,            0,     "help"                   },
 	{"--list-commands",     lst_list_commands,      0,     "list commands"          },
         {0,                     0,                      0,      NULL                    }
@@ -166,7 +166,7 @@ check_lnet_ni_status(void)
 	CHECK_STRUCT(struct lnet_ni_status);
 	CHECK_MEMBER(struct lnet_ni_status, ns_nid);
 	CHECK_MEMBER(struct lnet_ni_status, ns_status);
-	CHECK_MEMBER(struct lnet_ni_status, ns_unused);
+	CHECK_MEMBER(struct lnet_ni_status, ns_load);
 }
 
 void
@@ -182,6 +182,7 @@ check_lnet_ping_info(void)
 	CHECK_VALUE(LNET_PING_FEAT_RTE_DISABLED);
 	CHECK_VALUE(LNET_PING_FEAT_MULTI_RAIL);
 	CHECK_VALUE(LNET_PING_FEAT_DISCOVERY);
+	CHECK_VALUE(LNET_PING_FEAT_RTR_LOAD);
 	CHECK_VALUE(LNET_PING_FEAT_BITS);
 
 	CHECK_STRUCT(struct lnet_ping_info);
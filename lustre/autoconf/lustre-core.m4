@@ -1937,6 +1937,26 @@ vfs_rename_6args, [
 ])
 ]) # LC_VFS_RENAME_6ARGS
 
+#
+# LC_HAVE_VM_OPS_MAP_PAGES
+#
+# 3.15 kernel commit 8c6e50b0290c4c708db3a3e0b9c7d3da1f4b8fc6
+# added vm_operations_struct::map_pages for fault-around
+#
+AC_DEFUN([LC_HAVE_VM_OPS_MAP_PAGES], [
+LB_CHECK_COMPILE([if 'struct vm_operations_struct' has '.map_pages'],
+vm_ops_map_pages, [
+	#include <linux/mm.h>
+],[
+	struct vm_operations_struct ops = { .map_pages = filemap_map_pages };
+
+	(void)ops;
+],[
+	AC_DEFINE(HAVE_VM_OPS_MAP_PAGES, 1,
+		['struct vm_operations_struct' has '.map_pages'])
+])
+]) # LC_HAVE_VM_OPS_MAP_PAGES
+
 #
 # LC_DIRECTIO_USE_ITER
 #
@@ -2240,6 +2260,26 @@ LB_CHECK_EXPORT([new_sync_read], [fs/read_write.c],
 			[new_sync_[read|write] is exported by the kernel])])
 ]) # LC_HAVE_SYNC_READ_WRITE
 
+#
+# LC_KIOCB_KI_COMPLETE
+#
+# 4.1 kernel commit 04b2fa9f8f36ec6fb6fd1c9dc9df6fff0cd27323
+# fs: split generic and aio kiocb, aio_complete() replaced by ki_complete
+#
+AC_DEFUN([LC_KIOCB_KI_COMPLETE], [
+LB_CHECK_COMPILE([if 'struct kiocb' has 'ki_complete'],
+kiocb_ki_complete, [
+	#include <linux/fs.h>
+],[
+	struct kiocb iocb = { };
+
+	iocb.ki_complete(&iocb, 0, 0);
+],[
+	AC_DEFINE(HAVE_KIOCB_KI_COMPLETE, 1,
+		[kiocb has ki_complete])
+])
+]) # LC_KIOCB_KI_COMPLETE
+
 #
 # LC_NEW_CANCEL_DIRTY_PAGE
 #
@@ -2887,6 +2927,27 @@ vm_fault_address, [
 ])
 ]) # LC_HAVE_VM_FAULT_ADDRESS
 
+#
+# LC_MAP_PAGES_PGOFF_ARGS
+#
+# Kernel version 4.10 commit bae473a423f65e480db83c85b5e92254f6dfcb28
+# passes the range of page offsets to vm_operations_struct::map_pages
+# instead of struct vm_area_struct
+#
+AC_DEFUN([LC_MAP_PAGES_PGOFF_ARGS], [
+LB_CHECK_COMPILE([if 'map_pages' takes the range of page offsets],
+map_pages_pgoff_args, [
+	#include <linux/mm.h>
+],[
+	struct vm_fault vmf;
+
+	filemap_map_pages(&vmf, 0, 0);
+],[
+	AC_DEFINE(HAVE_MAP_PAGES_PGOFF_ARGS, 1,
+		['map_pages' takes the range of page offsets])
+])
+]) # LC_MAP_PAGES_PGOFF_ARGS
+
 #
 # LC_INODEOPS_ENHANCED_GETATTR
 #
@@ -3344,6 +3405,7 @@ AC_DEFUN([LC_PROG_LINUX], [
 
 	# 3.15
 	LC_VFS_RENAME_6ARGS
+	LC_HAVE_VM_OPS_MAP_PAGES
 
 	# 3.16
 	LC_DIRECTIO_USE_ITER
@@ -3373,6 +3435,7 @@ AC_DEFUN([LC_PROG_LINUX], [
 	# 4.1.0
 	LC_IOV_ITER_RW
 	LC_HAVE_SYNC_READ_WRITE
+	LC_KIOCB_KI_COMPLETE
 
 	# 4.2
 	LC_NEW_CANCEL_DIRTY_PAGE
@@ -3425,6 +3488,7 @@ AC_DEFUN([LC_PROG_LINUX], [
 	# 4.10
 	LC_IOP_GENERIC_READLINK
 	LC_HAVE_VM_FAULT_ADDRESS
+	LC_MAP_PAGES_PGOFF_ARGS
 
 	# 4.11
 	LC_INODEOPS_ENHANCED_GETATTR
@@ -50,23 +50,19 @@
 
 struct dentry *seq_debugfs_dir;
 
-static int seq_client_rpc(struct lu_client_seq *seq,
-                          struct lu_seq_range *output, __u32 opc,
-                          const char *opcname)
+static struct ptlrpc_request *seq_client_req_pack(struct lu_client_seq *seq,
+						  __u32 opc)
 {
 	struct obd_export     *exp = seq->lcs_exp;
 	struct ptlrpc_request *req;
-	struct lu_seq_range   *out, *in;
+	struct lu_seq_range   *in;
 	__u32                 *op;
-	unsigned int           debug_mask;
-	int                    rc;
-	ENTRY;
 
 	LASSERT(exp != NULL && !IS_ERR(exp));
 	req = ptlrpc_request_alloc_pack(class_exp2cliimp(exp), &RQF_SEQ_QUERY,
 					LUSTRE_MDS_VERSION, SEQ_QUERY);
 	if (req == NULL)
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 
 	/* Init operation code */
 	op = req_capsule_client_get(&req->rq_pill, &RMF_SEQ_OPC);
@@ -95,7 +91,6 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 		 * it can not release the export of MDT0 */
 		if (seq->lcs_type == LUSTRE_SEQ_DATA)
 			req->rq_no_delay = req->rq_no_resend = 1;
-		debug_mask = D_CONSOLE;
 	} else {
 		if (seq->lcs_type == LUSTRE_SEQ_METADATA) {
 			req->rq_reply_portal = MDC_REPLY_PORTAL;
@@ -104,8 +99,6 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 			req->rq_reply_portal = OSC_REPLY_PORTAL;
 			req->rq_request_portal = SEQ_DATA_PORTAL;
 		}
-
-		debug_mask = D_INFO;
 	}
 
 	/* Allow seq client RPC during recovery time. */
@@ -113,6 +106,42 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 
 	ptlrpc_at_set_req_timeout(req);
 
+	return req;
+}
+
+static int seq_client_range_check(struct lu_client_seq *seq,
+				  const struct lu_seq_range *range)
+{
+	if (!lu_seq_range_is_sane(range)) {
+		CERROR("%s: Invalid range received from server: "
+		       DRANGE"\n", seq->lcs_name, PRANGE(range));
+		return -EINVAL;
+	}
+
+	if (lu_seq_range_is_exhausted(range)) {
+		CERROR("%s: Range received from server is exhausted: "
+		       DRANGE"]\n", seq->lcs_name, PRANGE(range));
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int seq_client_rpc(struct lu_client_seq *seq,
+                          struct lu_seq_range *output, __u32 opc,
+                          const char *opcname)
+{
+	struct ptlrpc_request *req;
+	struct lu_seq_range   *out;
+	unsigned int           debug_mask;
+	int                    rc;
+	ENTRY;
+
+	req = seq_client_req_pack(seq, opc);
+	if (IS_ERR(req))
+		RETURN(PTR_ERR(req));
+
+	debug_mask = opc == SEQ_ALLOC_SUPER ? D_CONSOLE : D_INFO;
 	rc = ptlrpc_queue_wait(req);
 
 	if (rc)
@@ -121,17 +150,9 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 	out = req_capsule_server_get(&req->rq_pill, &RMF_SEQ_RANGE);
 	*output = *out;
 
-	if (!lu_seq_range_is_sane(output)) {
-		CERROR("%s: Invalid range received from server: "
-		       DRANGE"\n", seq->lcs_name, PRANGE(output));
-		GOTO(out_req, rc = -EINVAL);
-	}
-
-	if (lu_seq_range_is_exhausted(output)) {
-		CERROR("%s: Range received from server is exhausted: "
-		       DRANGE"]\n", seq->lcs_name, PRANGE(output));
-		GOTO(out_req, rc = -EINVAL);
-	}
+	rc = seq_client_range_check(seq, output);
+	if (rc)
+		GOTO(out_req, rc);
 
 	CDEBUG_LIMIT(debug_mask, "%s: Allocated %s-sequence "DRANGE"]\n",
 		     seq->lcs_name, opcname, PRANGE(output));
@@ -213,6 +234,108 @@ static int seq_client_alloc_meta(const struct lu_env *env,
         RETURN(rc);
 }
 
+struct seq_prefetch_args {
+	struct lu_client_seq	*spa_seq;
+	__u32			 spa_gen;
+};
+
+static int seq_client_prefetch_interpret(const struct lu_env *env,
+					 struct ptlrpc_request *req,
+					 void *args, int rc)
+{
+	struct seq_prefetch_args *spa = args;
+	struct lu_client_seq *seq = spa->spa_seq;
+	struct lu_seq_range *out = NULL;
+
+	if (rc == 0) {
+		out = req_capsule_server_get(&req->rq_pill, &RMF_SEQ_RANGE);
+		if (out == NULL)
+			rc = -EPROTO;
+		else
+			rc = seq_client_range_check(seq, out);
+	}
+
+	CDEBUG(D_INFO, "%s: Prefetched meta-sequence: rc = %d\n",
+	       seq->lcs_name, rc);
+
+	spin_lock(&seq->lcs_lock);
+	/* Drop the range if the sequence has been flushed meanwhile. */
+	if (rc == 0 && spa->spa_gen == seq->lcs_gen)
+		seq->lcs_space_next = *out;
+	seq->lcs_prefetching = 0;
+	wake_up_all(&seq->lcs_waitq);
+	spin_unlock(&seq->lcs_lock);
+
+	return 0;
+}
+
+/**
+ * Request the next meta-sequence asynchronously once the current one has been
+ * taken into use, so that seq_client_alloc_seq() does not wait for the RPC to
+ * the sequence server when the current sequence is used up, which is what
+ * stalls the creates. It is only done by the clients of a remote sequence
+ * server, and a failure is only handled by the synchronous allocation later.
+ */
+static void seq_client_prefetch(struct lu_client_seq *seq)
+{
+	struct seq_prefetch_args *spa;
+	struct ptlrpc_request *req;
+	__u32 gen;
+
+	if (seq->lcs_srv != NULL || seq->lcs_exp == NULL)
+		return;
+
+	spin_lock(&seq->lcs_lock);
+	if (seq->lcs_prefetching ||
+	    !lu_seq_range_is_exhausted(&seq->lcs_space_next)) {
+		spin_unlock(&seq->lcs_lock);
+		return;
+	}
+	seq->lcs_prefetching = 1;
+	gen = seq->lcs_gen;
+	spin_unlock(&seq->lcs_lock);
+
+	req = seq_client_req_pack(seq, SEQ_ALLOC_META);
+	if (IS_ERR(req)) {
+		spin_lock(&seq->lcs_lock);
+		seq->lcs_prefetching = 0;
+		wake_up_all(&seq->lcs_waitq);
+		spin_unlock(&seq->lcs_lock);
+		return;
+	}
+
+	/* Do not wait for the recovery, the synchronous path will do. */
+	req->rq_no_delay = req->rq_no_resend = 1;
+
+	CLASSERT(sizeof(*spa) <= sizeof(req->rq_async_args));
+	spa = ptlrpc_req_async_args(req);
+	spa->spa_seq = seq;
+	spa->spa_gen = gen;
+	req->rq_interpret_reply = seq_client_prefetch_interpret;
+	ptlrpcd_add_req(req);
+}
+
+/* Switch to the prefetched meta-sequence, waiting for the prefetch RPC. */
+static bool seq_client_prefetch_get(struct lu_client_seq *seq)
+{
+	bool got = false;
+
+	if (seq->lcs_srv != NULL)
+		return false;
+
+	wait_event(seq->lcs_waitq, !seq->lcs_prefetching);
+
+	spin_lock(&seq->lcs_lock);
+	if (!lu_seq_range_is_exhausted(&seq->lcs_space_next)) {
+		seq->lcs_space = seq->lcs_space_next;
+		lu_seq_range_init(&seq->lcs_space_next);
+		got = true;
+	}
+	spin_unlock(&seq->lcs_lock);
+
+	return got;
+}
+
 /* Allocate new sequence for client. */
 static int seq_client_alloc_seq(const struct lu_env *env,
 				struct lu_client_seq *seq, u64 *seqnr)
@@ -222,7 +345,12 @@ static int seq_client_alloc_seq(const struct lu_env *env,
 
 	LASSERT(lu_seq_range_is_sane(&seq->lcs_space));
 
-	if (lu_seq_range_is_exhausted(&seq->lcs_space)) {
+	if (lu_seq_range_is_exhausted(&seq->lcs_space) &&
+	    seq_client_prefetch_get(seq)) {
+		CDEBUG(D_INFO, "%s: Prefetched range - "DRANGE"\n",
+		       seq->lcs_name, PRANGE(&seq->lcs_space));
+		rc = 0;
+	} else if (lu_seq_range_is_exhausted(&seq->lcs_space)) {
                 rc = seq_client_alloc_meta(env, seq);
                 if (rc) {
 			if (rc != -EINPROGRESS)
@@ -241,6 +369,9 @@ static int seq_client_alloc_seq(const struct lu_env *env,
 	*seqnr = seq->lcs_space.lsr_start;
 	seq->lcs_space.lsr_start += 1;
 
+	if (lu_seq_range_is_exhausted(&seq->lcs_space))
+		seq_client_prefetch(seq);
+
 	CDEBUG(D_INFO, "%s: Allocated sequence [%#llx]\n", seq->lcs_name,
                *seqnr);
 
@@ -436,6 +567,12 @@ void seq_client_flush(struct lu_client_seq *seq)
         seq->lcs_space.lsr_index = -1;
 
 	lu_seq_range_init(&seq->lcs_space);
+
+	/* The in-flight prefetch RPC drops its range by the generation. */
+	spin_lock(&seq->lcs_lock);
+	lu_seq_range_init(&seq->lcs_space_next);
+	seq->lcs_gen++;
+	spin_unlock(&seq->lcs_lock);
 	mutex_unlock(&seq->lcs_mutex);
 }
 EXPORT_SYMBOL(seq_client_flush);
@@ -482,6 +619,11 @@ void seq_client_fini(struct lu_client_seq *seq)
 
 	seq_client_debugfs_fini(seq);
 
+	/* Wait for the prefetch RPC to release the sequence manager. */
+	wait_event(seq->lcs_waitq, !seq->lcs_prefetching);
+	spin_lock(&seq->lcs_lock);
+	spin_unlock(&seq->lcs_lock);
+
 	if (seq->lcs_exp != NULL) {
 		class_export_put(seq->lcs_exp);
 		seq->lcs_exp = NULL;
@@ -514,6 +656,9 @@ int seq_client_init(struct lu_client_seq *seq,
 		seq->lcs_width = LUSTRE_DATA_SEQ_MAX_WIDTH;
 
 	init_waitqueue_head(&seq->lcs_waitq);
+	spin_lock_init(&seq->lcs_lock);
+	seq->lcs_prefetching = 0;
+	seq->lcs_gen = 0;
 	/* Make sure that things are clear before work is started. */
 	seq_client_flush(seq);
 
@@ -64,6 +64,7 @@ struct fld_cache *fld_cache_init(const char *name,
 
 	INIT_LIST_HEAD(&cache->fci_entries_head);
 	INIT_LIST_HEAD(&cache->fci_lru);
+	RCU_INIT_POINTER(cache->fci_snap, NULL);
 
         cache->fci_cache_count = 0;
 	rwlock_init(&cache->fci_lock);
@@ -90,6 +91,8 @@ void fld_cache_fini(struct fld_cache *cache)
 {
 	LASSERT(cache != NULL);
 	fld_cache_flush(cache);
+	/* wait for the snapshot dropped by the flush to be freed */
+	rcu_barrier();
 
 	CDEBUG(D_INFO, "FLD cache statistics (%s):\n", cache->fci_name);
 	CDEBUG(D_INFO, "  Cache reqs: %llu\n", cache->fci_stat.fst_cache);
@@ -98,6 +101,70 @@ void fld_cache_fini(struct fld_cache *cache)
 	OBD_FREE_PTR(cache);
 }
 
+static void fld_cache_snap_free(struct rcu_head *head)
+{
+	struct fld_cache_snap *snap;
+
+	snap = container_of(head, struct fld_cache_snap, fcs_rcu);
+	OBD_FREE_LARGE(snap, snap->fcs_size);
+}
+
+/**
+ * unpublish the snapshot before changing the cache, under the write lock.
+ */
+static void fld_cache_snap_drop(struct fld_cache *cache)
+{
+	struct fld_cache_snap *snap;
+
+	snap = rcu_dereference_protected(cache->fci_snap, 1);
+	if (snap != NULL) {
+		RCU_INIT_POINTER(cache->fci_snap, NULL);
+		call_rcu(&snap->fcs_rcu, fld_cache_snap_free);
+	}
+}
+
+/**
+ * publish a snapshot of the cache entries for the lockless lookup, called
+ * without the lock after changing the cache. The lookup walks the list under
+ * the read lock as long as there is no snapshot.
+ */
+void fld_cache_snap_build(struct fld_cache *cache)
+{
+	struct fld_cache_snap *snap;
+	struct fld_cache_entry *flde;
+	int count;
+	int size;
+	int i = 0;
+
+	read_lock(&cache->fci_lock);
+	count = cache->fci_cache_count;
+	read_unlock(&cache->fci_lock);
+	if (count == 0)
+		return;
+
+	size = offsetof(struct fld_cache_snap, fcs_ranges[count]);
+	OBD_ALLOC_LARGE(snap, size);
+	if (snap == NULL)
+		return;
+
+	snap->fcs_size = size;
+	write_lock(&cache->fci_lock);
+	/* the cache grew or another snapshot has been published meanwhile,
+	 * leave it to the caller changing the cache then */
+	if (cache->fci_cache_count > count ||
+	    rcu_access_pointer(cache->fci_snap) != NULL) {
+		write_unlock(&cache->fci_lock);
+		OBD_FREE_LARGE(snap, size);
+		return;
+	}
+
+	list_for_each_entry(flde, &cache->fci_entries_head, fce_list)
+		snap->fcs_ranges[i++] = flde->fce_range;
+	snap->fcs_count = i;
+	rcu_assign_pointer(cache->fci_snap, snap);
+	write_unlock(&cache->fci_lock);
+}
+
 /**
  * delete given node from list.
  */
@@ -232,6 +299,7 @@ void fld_cache_flush(struct fld_cache *cache)
 	ENTRY;
 
 	write_lock(&cache->fci_lock);
+	fld_cache_snap_drop(cache);
 	cache->fci_cache_size = 0;
 	fld_cache_shrink(cache);
 	write_unlock(&cache->fci_lock);
@@ -386,6 +454,7 @@ int fld_cache_insert_nolock(struct fld_cache *cache,
 	 * insertion loop.
 	 */
 
+	fld_cache_snap_drop(cache);
 	if (!cache->fci_no_shrink)
 		fld_cache_shrink(cache);
 
@@ -432,6 +501,8 @@ int fld_cache_insert(struct fld_cache *cache,
 	write_unlock(&cache->fci_lock);
 	if (rc)
 		OBD_FREE_PTR(flde);
+	else
+		fld_cache_snap_build(cache);
 
 	RETURN(rc);
 }
@@ -443,6 +514,7 @@ void fld_cache_delete_nolock(struct fld_cache *cache,
 	struct fld_cache_entry *tmp;
 	struct list_head *head;
 
+	fld_cache_snap_drop(cache);
 	head = &cache->fci_entries_head;
 	list_for_each_entry_safe(flde, tmp, head, fce_list) {
 		/* add list if next is end of list */
@@ -465,6 +537,7 @@ void fld_cache_delete(struct fld_cache *cache,
 	write_lock(&cache->fci_lock);
 	fld_cache_delete_nolock(cache, range);
 	write_unlock(&cache->fci_lock);
+	fld_cache_snap_build(cache);
 }
 
 struct fld_cache_entry *
@@ -505,6 +578,44 @@ fld_cache_entry_lookup(struct fld_cache *cache,
 	RETURN(got);
 }
 
+/**
+ * binary search of \a seq in the snapshot, with the same result as the list
+ * walk in fld_cache_lookup().
+ */
+static int fld_cache_snap_lookup(const struct fld_cache_snap *snap,
+				 const u64 seq, struct lu_seq_range *range)
+{
+	int lo = 0;
+	int hi = snap->fcs_count - 1;
+	int i = -1;
+
+	/* find the last range starting at or before \a seq */
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (snap->fcs_ranges[mid].lsr_start <= seq) {
+			i = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	if (i < 0)
+		return -ENOENT;
+
+	if (lu_seq_range_within(&snap->fcs_ranges[i], seq)) {
+		*range = snap->fcs_ranges[i];
+		return 0;
+	}
+
+	/* return the left-side range as the list walk does */
+	if (i + 1 < snap->fcs_count)
+		*range = snap->fcs_ranges[i];
+
+	return -ENOENT;
+}
+
 /**
  * lookup \a seq sequence for range in fld cache.
  */
@@ -513,9 +624,24 @@ int fld_cache_lookup(struct fld_cache *cache,
 {
 	struct fld_cache_entry *flde;
 	struct fld_cache_entry *prev = NULL;
+	struct fld_cache_snap *snap;
 	struct list_head *head;
+	int rc;
 	ENTRY;
 
+	rcu_read_lock();
+	snap = rcu_dereference(cache->fci_snap);
+	if (snap != NULL) {
+		rc = fld_cache_snap_lookup(snap, seq, range);
+		rcu_read_unlock();
+
+		cache->fci_stat.fst_count++;
+		if (rc == 0)
+			cache->fci_stat.fst_cache++;
+		RETURN(rc);
+	}
+	rcu_read_unlock();
+
 	read_lock(&cache->fci_lock);
 	head = &cache->fci_entries_head;
 
@@ -83,6 +83,19 @@ struct fld_cache_entry {
 	struct lu_seq_range	fce_range;
 };
 
+/**
+ * Copy of the sorted fld cache entries, looked up without the cache lock.
+ */
+struct fld_cache_snap {
+	struct rcu_head		fcs_rcu;
+	/* allocated size in bytes */
+	int			fcs_size;
+	/* number of ranges in \a fcs_ranges */
+	int			fcs_count;
+	/* ranges sorted on lsr_start as the fld cache entries */
+	struct lu_seq_range	fcs_ranges[0];
+};
+
 struct fld_cache {
 	/**
 	 * Cache guard, protects fci_hash mostly because others immutable after
@@ -110,6 +123,11 @@ struct fld_cache {
          * sorted fld entries. */
 	struct list_head	fci_entries_head;
 
+	/**
+	 * Snapshot of \a fci_entries_head for the lockless lookup, NULL if
+	 * it is out of date. Changed under \a fci_lock, freed after RCU. */
+	struct fld_cache_snap __rcu *fci_snap;
+
         /**
          * Cache statistics. */
         struct fld_stats         fci_stat;
@@ -124,8 +142,9 @@ enum {
         /* 4M of FLD cache will not hurt client a lot. */
         FLD_SERVER_CACHE_SIZE      = (4 * 0x100000),
 
-        /* 1M of FLD cache will not hurt client a lot. */
-        FLD_CLIENT_CACHE_SIZE      = (1 * 0x100000)
+	/* 4M of FLD cache will not hurt client a lot, and it avoids
+	 * the FLD RPCs for the sequences of a long-running system. */
+	FLD_CLIENT_CACHE_SIZE      = (4 * 0x100000)
 };
 
 enum {
@@ -198,6 +217,7 @@ struct fld_cache_entry
 
 int fld_cache_insert_nolock(struct fld_cache *cache,
 			    struct fld_cache_entry *f_new);
+void fld_cache_snap_build(struct fld_cache *cache);
 void fld_cache_delete(struct fld_cache *cache,
                       const struct lu_seq_range *range);
 void fld_cache_delete_nolock(struct fld_cache *cache,
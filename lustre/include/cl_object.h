@@ -294,6 +294,8 @@ struct cl_layout {
 	u32		cl_layout_gen;
 	/** whether layout is a composite one */
 	bool		cl_is_composite;
+	/** whether the file is released by HSM */
+	bool		cl_is_released;
 };
 
 /**
@@ -715,6 +717,9 @@ enum cl_page_type {
         CPT_TRANSIENT,
 };
 
+/** Maximal number of slices of a page: vvp (or echo), lov and osc. */
+#define CP_MAX_LAYER	3
+
 /**
  * Fields are protected by the lock on struct page, except for atomics and
  * immutables.
@@ -733,8 +738,6 @@ struct cl_page {
 	struct page		*cp_vmpage;
 	/** Linkage of pages within group. Pages must be owned */
 	struct list_head	 cp_batch;
-	/** List of slices. Immutable after creation. */
-	struct list_head	 cp_layers;
 	/**
 	 * Page state. This field is const to avoid accidental update, it is
 	 * modified only internally within cl_page.c. Protected by a VM lock.
@@ -745,6 +748,15 @@ struct cl_page {
          * creation.
          */
         enum cl_page_type        cp_type;
+	/** Number of slices. Immutable after creation. */
+	unsigned char		 cp_layer_count;
+	/** Slab cache the page comes from, -1 if it was kmalloc'ed. */
+	signed char		 cp_kmem_index;
+	/**
+	 * Offsets of the slices from the start of the page, from the top of
+	 * the stack to the bottom. Immutable after creation.
+	 */
+	unsigned short		 cp_layer_offset[CP_MAX_LAYER];
 
         /**
          * Owning IO in cl_page_state::CPS_OWNED state. Sub-page can be owned
@@ -775,8 +787,6 @@ struct cl_page_slice {
          */
         struct cl_object                *cpl_obj;
         const struct cl_page_operations *cpl_ops;
-        /** Linkage into cl_page::cp_layers. Immutable after creation. */
-	struct list_head		 cpl_linkage;
 };
 
 /**
@@ -1465,8 +1475,14 @@ struct cl_io_slice {
 	struct list_head		cis_linkage;
 };
 
+/**
+ * Called by cl_io_operations::cio_commit_async() for each batch of pages
+ * committed into the cache. The pages are handed over in \a plist, which the
+ * callback must leave empty. They cannot be touched afterwards, since they
+ * can be in transfer and complete at any time.
+ */
 typedef void (*cl_commit_cbt)(const struct lu_env *, struct cl_io *,
-			      struct cl_page *);
+			      struct cl_page_list *plist);
 
 struct cl_read_ahead {
 	/* Maximum page index the readahead window will end.
@@ -1909,7 +1925,12 @@ struct cl_io {
 	 * the read IO will check to-be-read OSCs' status, and make fast-switch
 	 * another mirror if some of the OSTs are not healthy.
 	 */
-			     ci_tried_all_mirrors:1;
+			     ci_tried_all_mirrors:1,
+	/**
+	 * Direct IO. Its pages are not cached, so an iteration can cover
+	 * several stripes to have them transferred in parallel.
+	 */
+			     ci_dio:1;
 	/**
 	 * Bypass quota check
 	 */
@@ -1924,9 +1945,10 @@ struct cl_io {
 	 */
 	unsigned	     ci_designated_mirror;
 	/**
-	 * Number of pages owned by this IO. For invariant checking.
+	 * Number of pages owned by this IO. For invariant checking. Atomic
+	 * because the sub-ios of lov can submit pages in parallel.
 	 */
-	unsigned	     ci_owned_nr;
+	atomic_t	     ci_owned_nr;
 	/**
 	 * Range of write intent. Valid if ci_need_write_intent is set.
 	 */
@@ -2255,6 +2277,16 @@ void cl_lock_descr_print(const struct lu_env *env, void *cookie,
 			 const struct cl_lock_descr *descr);
 /* @} helper */
 
+/**
+ * LRU slots kept by a CPT. They are taken from cl_client_cache::ccc_lru_left
+ * and given back to it in batches, so that most allocations and releases of
+ * slots only touch memory of the CPT.
+ */
+struct cl_cache_lru_pool {
+	spinlock_t		ccp_lock;
+	long			ccp_left;
+};
+
 /**
  * Data structure managing a client's cached pages. A count of
  * "unstable" pages is maintained, and an LRU of clean pages is
@@ -2272,9 +2304,14 @@ struct cl_client_cache {
 	 */
 	unsigned int		ccc_lru_shrinkers;
 	/**
-	 * # of LRU entries available
+	 * # of LRU entries available, not counting those kept by
+	 * ccc_lru_pools, see cl_cache_lru_left()
 	 */
 	atomic_long_t		ccc_lru_left;
+	/**
+	 * LRU entries available kept by each CPT
+	 */
+	struct cl_cache_lru_pool **ccc_lru_pools;
 	/**
 	 * List of entities(OSCs) for this LRU cache
 	 */
@@ -2307,6 +2344,10 @@ struct cl_client_cache {
 struct cl_client_cache *cl_cache_init(unsigned long lru_page_max);
 void cl_cache_incref(struct cl_client_cache *cache);
 void cl_cache_decref(struct cl_client_cache *cache);
+bool cl_cache_lru_get(struct cl_client_cache *cache, long npages);
+void cl_cache_lru_put(struct cl_client_cache *cache, long npages);
+long cl_cache_lru_left(struct cl_client_cache *cache);
+void cl_cache_lru_drain(struct cl_client_cache *cache);
 
 /** @} cl_page */
 
@@ -820,6 +820,35 @@ struct dt_object_operations {
                            struct dt_object_format *dof,
                            struct thandle *th);
 
+	/**
+	 * Create a batch of new objects.
+	 *
+	 * The method creates the objects passed, all of the same device, with
+	 * the same attributes and object format, as if do_create() was called
+	 * for each of them in turn. It lets the device allocate the objects
+	 * together and update its indices once in an order of its choice.
+	 * Each object must have been declared with do_declare_create() in
+	 * the transaction. The method is optional, see dt_create_batch().
+	 *
+	 * \param[in] env	execution environment for this thread
+	 * \param[in] dt	array of the objects to create
+	 * \param[in] nr	number of objects in \a dt
+	 * \param[in] attr	attributes of the new objects
+	 * \param[in] hint	allocation hint
+	 * \param[in] dof	object format
+	 * \param[in] th	transaction handle
+	 *
+	 * \retval positive	number of objects created, the ones after it in
+	 *			\a dt were not created
+	 * \retval negative	negated errno if the first object failed
+	 */
+	int   (*do_create_batch)(const struct lu_env *env,
+				 struct dt_object **dt, int nr,
+				 struct lu_attr *attr,
+				 struct dt_allocation_hint *hint,
+				 struct dt_object_format *dof,
+				 struct thandle *th);
+
 	/**
 	 * Declare intention to destroy an object.
 	 *
@@ -1868,6 +1897,16 @@ static inline int dt_object_remote(const struct dt_object *dt)
 	return lu_object_remote(&dt->do_lu);
 }
 
+/**
+ * Note a modification of \a dt, called after each modifying method so the
+ * copies of the attributes kept by the upper layers can be checked against
+ * lu_object_header::loh_attr_gen.
+ */
+static inline void dt_object_changed(struct dt_object *dt)
+{
+	atomic_inc(&dt->do_lu.lo_header->loh_attr_gen);
+}
+
 static inline struct dt_object *lu2dt_obj(struct lu_object *o)
 {
 	LASSERT(ergo(o != NULL, lu_device_is_dt(o->lo_dev)));
@@ -2208,6 +2247,8 @@ static inline int dt_create(const struct lu_env *env,
                                     struct dt_object_format *dof,
                                     struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_create);
@@ -2215,7 +2256,38 @@ static inline int dt_create(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_CREATE))
 		return cfs_fail_err;
 
-        return dt->do_ops->do_create(env, dt, attr, hint, dof, th);
+	rc = dt->do_ops->do_create(env, dt, attr, hint, dof, th);
+	dt_object_changed(dt);
+	return rc;
+}
+
+static inline int dt_create_batch(const struct lu_env *env,
+				  struct dt_object **dt, int nr,
+				  struct lu_attr *attr,
+				  struct dt_allocation_hint *hint,
+				  struct dt_object_format *dof,
+				  struct thandle *th)
+{
+	int rc;
+	int i;
+
+	LASSERT(nr > 0);
+	LASSERT(dt[0]->do_ops);
+
+	if (dt[0]->do_ops->do_create_batch == NULL ||
+	    CFS_FAIL_PRECHECK(OBD_FAIL_DT_CREATE)) {
+		for (i = 0; i < nr; i++) {
+			rc = dt_create(env, dt[i], attr, hint, dof, th);
+			if (rc < 0)
+				return i > 0 ? i : rc;
+		}
+		return nr;
+	}
+
+	rc = dt[0]->do_ops->do_create_batch(env, dt, nr, attr, hint, dof, th);
+	for (i = 0; i < (rc > 0 ? rc : 0); i++)
+		dt_object_changed(dt[i]);
+	return rc;
 }
 
 static inline int dt_declare_destroy(const struct lu_env *env,
@@ -2236,6 +2308,8 @@ static inline int dt_destroy(const struct lu_env *env,
                              struct dt_object *dt,
                              struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_destroy);
@@ -2243,7 +2317,9 @@ static inline int dt_destroy(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_DESTROY))
 		return cfs_fail_err;
 
-        return dt->do_ops->do_destroy(env, dt, th);
+	rc = dt->do_ops->do_destroy(env, dt, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline void dt_read_lock(const struct lu_env *env,
@@ -2337,6 +2413,8 @@ static inline int dt_declare_attr_set(const struct lu_env *env,
 static inline int dt_attr_set(const struct lu_env *env, struct dt_object *dt,
 			      const struct lu_attr *la, struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_attr_set);
@@ -2344,7 +2422,9 @@ static inline int dt_attr_set(const struct lu_env *env, struct dt_object *dt,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_ATTR_SET))
 		return cfs_fail_err;
 
-	return dt->do_ops->do_attr_set(env, dt, la, th);
+	rc = dt->do_ops->do_attr_set(env, dt, la, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_declare_ref_add(const struct lu_env *env,
@@ -2363,6 +2443,8 @@ static inline int dt_declare_ref_add(const struct lu_env *env,
 static inline int dt_ref_add(const struct lu_env *env,
                              struct dt_object *dt, struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_ref_add);
@@ -2370,7 +2452,9 @@ static inline int dt_ref_add(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_REF_ADD))
 		return cfs_fail_err;
 
-        return dt->do_ops->do_ref_add(env, dt, th);
+	rc = dt->do_ops->do_ref_add(env, dt, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_declare_ref_del(const struct lu_env *env,
@@ -2389,6 +2473,8 @@ static inline int dt_declare_ref_del(const struct lu_env *env,
 static inline int dt_ref_del(const struct lu_env *env,
                              struct dt_object *dt, struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_ref_del);
@@ -2396,7 +2482,9 @@ static inline int dt_ref_del(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_REF_DEL))
 		return cfs_fail_err;
 
-        return dt->do_ops->do_ref_del(env, dt, th);
+	rc = dt->do_ops->do_ref_del(env, dt, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_bufs_get(const struct lu_env *env, struct dt_object *d,
@@ -2444,10 +2532,14 @@ static inline int dt_write_commit(const struct lu_env *env,
                                   struct dt_object *d, struct niobuf_local *lnb,
                                   int n, struct thandle *th)
 {
+	int rc;
+
         LASSERT(d);
         LASSERT(d->do_body_ops);
         LASSERT(d->do_body_ops->dbo_write_commit);
-        return d->do_body_ops->dbo_write_commit(env, d, lnb, n, th);
+	rc = d->do_body_ops->dbo_write_commit(env, d, lnb, n, th);
+	dt_object_changed(d);
+	return rc;
 }
 
 static inline int dt_read_prep(const struct lu_env *env, struct dt_object *d,
@@ -2474,10 +2566,14 @@ static inline ssize_t dt_write(const struct lu_env *env, struct dt_object *dt,
 			       const struct lu_buf *buf, loff_t *pos,
 			       struct thandle *th)
 {
+	ssize_t rc;
+
 	LASSERT(dt);
 	LASSERT(dt->do_body_ops);
 	LASSERT(dt->do_body_ops->dbo_write);
-	return dt->do_body_ops->dbo_write(env, dt, buf, pos, th);
+	rc = dt->do_body_ops->dbo_write(env, dt, buf, pos, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_declare_punch(const struct lu_env *env,
@@ -2493,10 +2589,14 @@ static inline int dt_declare_punch(const struct lu_env *env,
 static inline int dt_punch(const struct lu_env *env, struct dt_object *dt,
 			   __u64 start, __u64 end, struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_body_ops);
         LASSERT(dt->do_body_ops->dbo_punch);
-	return dt->do_body_ops->dbo_punch(env, dt, start, end, th);
+	rc = dt->do_body_ops->dbo_punch(env, dt, start, end, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_ladvise(const struct lu_env *env, struct dt_object *dt,
@@ -2595,6 +2695,8 @@ static inline int dt_insert(const struct lu_env *env,
 			    const struct dt_key *key,
 			    struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_index_ops);
         LASSERT(dt->do_index_ops->dio_insert);
@@ -2602,7 +2704,9 @@ static inline int dt_insert(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_INSERT))
 		return cfs_fail_err;
 
-	return dt->do_index_ops->dio_insert(env, dt, rec, key, th);
+	rc = dt->do_index_ops->dio_insert(env, dt, rec, key, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_declare_xattr_del(const struct lu_env *env,
@@ -2624,6 +2728,8 @@ static inline int dt_xattr_del(const struct lu_env *env,
 			       struct dt_object *dt, const char *name,
 			       struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_xattr_del);
@@ -2631,7 +2737,9 @@ static inline int dt_xattr_del(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_XATTR_DEL))
 		return cfs_fail_err;
 
-	return dt->do_ops->do_xattr_del(env, dt, name, th);
+	rc = dt->do_ops->do_xattr_del(env, dt, name, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_declare_xattr_set(const struct lu_env *env,
@@ -2654,6 +2762,8 @@ static inline int dt_xattr_set(const struct lu_env *env,
 			       struct dt_object *dt, const struct lu_buf *buf,
 			       const char *name, int fl, struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_ops);
         LASSERT(dt->do_ops->do_xattr_set);
@@ -2661,7 +2771,9 @@ static inline int dt_xattr_set(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_XATTR_SET))
 		return cfs_fail_err;
 
-	return dt->do_ops->do_xattr_set(env, dt, buf, name, fl, th);
+	rc = dt->do_ops->do_xattr_set(env, dt, buf, name, fl, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_declare_xattr_get(const struct lu_env *env,
@@ -2735,6 +2847,8 @@ static inline int dt_delete(const struct lu_env *env,
 			    const struct dt_key *key,
 			    struct thandle *th)
 {
+	int rc;
+
         LASSERT(dt);
         LASSERT(dt->do_index_ops);
         LASSERT(dt->do_index_ops->dio_delete);
@@ -2742,7 +2856,9 @@ static inline int dt_delete(const struct lu_env *env,
 	if (CFS_FAULT_CHECK(OBD_FAIL_DT_DELETE))
 		return cfs_fail_err;
 
-	return dt->do_index_ops->dio_delete(env, dt, key, th);
+	rc = dt->do_index_ops->dio_delete(env, dt, key, th);
+	dt_object_changed(dt);
+	return rc;
 }
 
 static inline int dt_commit_async(const struct lu_env *env,
@@ -37,22 +37,25 @@
 #define _INTERVAL_H__
 
 #include <linux/errno.h>
+#include <linux/rbtree.h>
 #include <linux/string.h>
 #include <linux/types.h>
 
+/*
+ * Node of an augmented rbtree of intervals, ordered by start then end, where
+ * every node caches the highest end of its subtree. The fields used by the
+ * searches come first, in the same cache line.
+ */
 struct interval_node {
-        struct interval_node   *in_left;
-        struct interval_node   *in_right;
-        struct interval_node   *in_parent;
-        unsigned                in_color:1,
-                                in_intree:1, /** set if the node is in tree */
-                                in_res1:30;
-        __u8                    in_res2[4];  /** tags, 8-bytes aligned */
-        __u64                   in_max_high;
-        struct interval_node_extent {
-                __u64 start;
-                __u64 end;
-        } in_extent;
+	struct rb_node		in_rb;
+	__u64			in_max_high;
+	struct interval_node_extent {
+		__u64 start;
+		__u64 end;
+	} in_extent;
+	unsigned int		in_intree:1, /** set if the node is in tree */
+				in_res1:31;
+	__u8			in_res2[4];  /** tags, 8-bytes aligned */
 };
 
 enum interval_iter {
@@ -107,6 +110,8 @@ typedef enum interval_iter (*interval_callback_t)(struct interval_node *node,
 
 struct interval_node *interval_insert(struct interval_node *node,
                                       struct interval_node **root);
+void interval_insert_dup(struct interval_node *node,
+			 struct interval_node **root);
 void interval_erase(struct interval_node *node, struct interval_node **root);
 
 /* Search the extents in the tree and call @func for each overlapped
@@ -124,8 +129,12 @@ enum interval_iter interval_iterate_reverse(struct interval_node *root,
 void interval_expand(struct interval_node *root, 
                      struct interval_node_extent *ext,
                      struct interval_node_extent *limiter);
-int interval_is_overlapped(struct interval_node *root, 
-                           struct interval_node_extent *ex);
+int interval_is_overlapped(struct interval_node *root,
+			   struct interval_node_extent *ex);
+/* Count the extents in the tree overlapping @ex, stopping at @limit. */
+unsigned long interval_count(struct interval_node *root,
+			     struct interval_node_extent *ex,
+			     unsigned long limit);
 struct interval_node *interval_find(struct interval_node *root,
                                     struct interval_node_extent *ex);
 #endif
@@ -44,6 +44,7 @@
 #include <linux/rwsem.h>
 #include <linux/spinlock.h>
 #include <linux/seq_file.h>
+#include <linux/workqueue.h>
 
 #include <libcfs/libcfs.h>
 #include <uapi/linux/lustre/lustre_idl.h>
@@ -404,6 +405,7 @@ struct obd_job_stats {
 	cntr_init_callback	ojs_cntr_init_fn;/* lprocfs_stats initializer */
 	unsigned short		ojs_cntr_num;	/* number of stats in struct */
 	bool			ojs_cleaning;	/* currently expiring stats */
+	struct work_struct	ojs_cleanup_work; /* expiry out of I/O path */
 };
 
 #ifdef CONFIG_PROC_FS
@@ -626,6 +628,8 @@ unsigned long lprocfs_oh_sum(struct obd_histogram *oh);
 
 void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                            struct lprocfs_counter *cnt);
+void lprocfs_stats_collect_all(struct lprocfs_stats *stats,
+			       struct lprocfs_counter *cnt);
 
 #ifdef HAVE_SERVER_SUPPORT
 /* lprocfs_status.c: recovery status */
@@ -639,6 +643,16 @@ int lprocfs_ir_factor_seq_show(struct seq_file *m, void *data);
 ssize_t
 lprocfs_ir_factor_seq_write(struct file *file, const char __user *buffer,
 				size_t count, loff_t *off);
+
+/* lprocfs_status.c: connect admission */
+int lprocfs_conn_limit_seq_show(struct seq_file *m, void *data);
+ssize_t
+lprocfs_conn_limit_seq_write(struct file *file, const char __user *buffer,
+			     size_t count, loff_t *off);
+int lprocfs_conn_window_seq_show(struct seq_file *m, void *data);
+ssize_t
+lprocfs_conn_window_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off);
 #endif
 
 /* lprocfs_status.c: dump pages on cksum error */
@@ -1041,6 +1055,10 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
                            struct lprocfs_counter *cnt)
 { return; }
 static inline
+void lprocfs_stats_collect_all(struct lprocfs_stats *stats,
+			       struct lprocfs_counter *cnt)
+{ return; }
+static inline
 u64 lprocfs_stats_collector(struct lprocfs_stats *stats, int idx,
 			    enum lprocfs_fields_flags field)
 { return (__u64)0; }
@@ -38,6 +38,7 @@
 #include <uapi/linux/lustre/lustre_idl.h>
 #include <lu_ref.h>
 #include <linux/percpu_counter.h>
+#include <linux/workqueue.h>
 
 struct seq_file;
 struct proc_dir_entry;
@@ -515,6 +516,12 @@ struct lu_object_header {
 	 * lu_object_header_attr.
 	 */
 	__u32			loh_attr;
+	/**
+	 * Generation of the attributes and of the content of the object,
+	 * incremented after each modification by the dt layers, see
+	 * dt_object_changed().
+	 */
+	atomic_t		loh_attr_gen;
 	/**
 	 * Linkage into per-site hash table. Protected by lu_site::ls_guard.
 	 */
@@ -604,6 +611,10 @@ struct lu_site {
 	 * Number of objects in lsb_lru_lists - used for shrinking
 	 */
 	struct percpu_counter   ls_lru_len_counter;
+	/**
+	 * Purge of the objects above lu_cache_nr, out of the lookups.
+	 */
+	struct work_struct	ls_purge_work;
 };
 
 wait_queue_head_t *
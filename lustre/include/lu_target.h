@@ -151,6 +151,9 @@ struct tg_grants_data {
 	struct obd_statfs	 tgd_osfs;
 };
 
+/* number of CPTs with their own hint to find a free reply slot */
+#define LUT_REPLY_SLOT_HINTS	16
+
 struct lu_target {
 	struct obd_device	*lut_obd;
 	struct dt_device	*lut_bottom;
@@ -195,6 +198,10 @@ struct lu_target {
 	struct dt_object	*lut_reply_data;
 	/** Bitmap of used slots in the reply data file */
 	unsigned long		**lut_reply_bitmap;
+	/** 1 + highest slot ever used in the reply data file */
+	atomic_t		 lut_reply_slot_high;
+	/** where each CPT looks for the next free reply slot first */
+	int			 lut_reply_slot_hint[LUT_REPLY_SLOT_HINTS];
 	/** target sync count, used for debug & test */
 	atomic_t		 lut_sync_count;
 
@@ -418,6 +425,7 @@ int tgt_connect(struct tgt_session_info *tsi);
 int tgt_disconnect(struct tgt_session_info *uti);
 int tgt_obd_ping(struct tgt_session_info *tsi);
 int tgt_enqueue(struct tgt_session_info *tsi);
+int tgt_batch(struct tgt_session_info *tsi);
 int tgt_convert(struct tgt_session_info *tsi);
 int tgt_bl_callback(struct tgt_session_info *tsi);
 int tgt_cp_callback(struct tgt_session_info *tsi);
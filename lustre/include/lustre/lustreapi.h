@@ -325,6 +325,11 @@ struct find_param {
 				 fp_obds_printed:1;
 	unsigned int		 fp_depth;
 	unsigned int		 fp_hash_type;
+
+	/* number of processes searching the tree at the same time */
+	unsigned int		 fp_threads;
+	/* print the entries in the order of a serial search, with fp_threads */
+	unsigned int		 fp_ordered:1;
 };
 
 int llapi_ostlist(char *path, struct find_param *param);
@@ -421,6 +426,8 @@ int llapi_hsm_state_set_fd(int fd, __u64 setmask, __u64 clearmask,
 			   __u32 archive_id);
 int llapi_hsm_state_set(const char *path, __u64 setmask, __u64 clearmask,
 			__u32 archive_id);
+int llapi_pcc_attach(const char *path, __u32 id);
+int llapi_pcc_detach(const char *path);
 int llapi_hsm_register_event_fifo(const char *path);
 int llapi_hsm_unregister_event_fifo(const char *path);
 void llapi_hsm_log_error(enum llapi_message_level level, int _rc,
@@ -465,6 +472,8 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
 			  long long endrec);
 extern int llapi_changelog_set_xflags(void *priv,
 				    enum changelog_send_extra_flag extra_flags);
+int llapi_changelog_set_filter(void *priv,
+			       const struct changelog_filter *filter);
 
 /* HSM copytool interface.
  * priv is private state, managed internally by these functions
@@ -525,6 +534,9 @@ int llapi_group_unlock(int fd, int gid);
 /* Ladvise */
 int llapi_ladvise(int fd, unsigned long long flags, int num_advise,
 		  struct llapi_lu_ladvise *ladvise);
+int llapi_lockahead_strided(int fd, enum lock_mode_user mode,
+			    unsigned long long start, unsigned long long length,
+			    unsigned long long stride, int count);
 /** @} llapi */
 
 /* llapi_layout user interface */
@@ -719,6 +731,26 @@ int llapi_layout_stripe_size_get(const struct llapi_layout *layout,
  */
 int llapi_layout_stripe_size_set(struct llapi_layout *layout, uint64_t size);
 
+/**
+ * Get the extension size of the current component of \a layout, 0 if it is
+ * not an extension component.
+ *
+ * \retval  0 Success.
+ * \retval -1 Invalid argument, errno set to EINVAL.
+ */
+int llapi_layout_extension_size_get(const struct llapi_layout *layout,
+				    uint64_t *size);
+
+/**
+ * Make the current component of \a layout an extension component that grows
+ * the layout by \a size when a write reaches it, or a plain one if 0.
+ *
+ * \retval  0 Success.
+ * \retval -1 Invalid argument, errno set to EINVAL.
+ */
+int llapi_layout_extension_size_set(struct llapi_layout *layout,
+				    uint64_t size);
+
 /******************** Stripe Pattern ********************/
 
 /**
@@ -920,6 +952,7 @@ static const struct comp_flag_name {
 	{ LCME_FL_PREF_RW,	"prefer" },
 	{ LCME_FL_OFFLINE,	"offline" },
 	{ LCME_FL_NOSYNC,	"nosync" },
+	{ LCME_FL_EXTENSION,	"extension" },
 };
 
 /**
@@ -1029,6 +1062,14 @@ int llapi_param_get_paths(const char *pattern, glob_t *paths);
 int llapi_param_get_value(const char *path, char **buf, size_t *buflen);
 void llapi_param_paths_free(glob_t *paths);
 
+struct llapi_param_set;
+typedef int (*llapi_param_cb_t)(const char *path, const char *value,
+				size_t len, void *data);
+int llapi_param_set_add(struct llapi_param_set **set, const char *pattern);
+int llapi_param_set_read(struct llapi_param_set *set, llapi_param_cb_t cb,
+			 void *data);
+void llapi_param_set_free(struct llapi_param_set *set);
+
 /** @} llapi */
 
 #if defined(__cplusplus)
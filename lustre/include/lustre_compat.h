@@ -669,6 +669,15 @@ __generic_file_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 }
 #endif /* HAVE_FILE_OPERATIONS_READ_WRITE_ITER */
 
+static inline void ll_aio_complete(struct kiocb *iocb, ssize_t res)
+{
+#ifdef HAVE_KIOCB_KI_COMPLETE
+	iocb->ki_complete(iocb, res, 0);
+#else
+	aio_complete(iocb, res, 0);
+#endif
+}
+
 static inline void __user *get_vmf_address(struct vm_fault *vmf)
 {
 #ifdef HAVE_VM_FAULT_ADDRESS
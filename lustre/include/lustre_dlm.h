@@ -234,6 +234,18 @@ struct ldlm_pool_ops {
  * For purposes of determining when to release locks on e.g. memory pressure.
  * This feature is commonly referred to as lru_resize.
  */
+/**
+ * Policies computing the SLV of server pools, and how client pools react
+ * to it, selected with the "policy" file of the pool.
+ */
+enum ldlm_pool_policy {
+	/** SLV from the planned number of granted locks only */
+	LDLM_POOL_POLICY_GRANT_PLAN	= 0,
+	/** SLV also lowered by memory pressure on the server */
+	LDLM_POOL_POLICY_MEMORY		= 1,
+	LDLM_POOL_POLICY_MAX
+};
+
 struct ldlm_pool {
 	/** Pool debugfs directory. */
 	struct dentry		*pl_debugfs_entry;
@@ -264,6 +276,10 @@ struct ldlm_pool {
 	struct ldlm_pool_ops	*pl_ops;
 	/** Number of planned locks for next period. */
 	int			pl_grant_plan;
+	/** Pool policy, see enum ldlm_pool_policy. */
+	enum ldlm_pool_policy	pl_policy;
+	/** Number of locks the shrinker asked to free since last recalc. */
+	atomic_t		pl_shrink_nr;
 	/** Pool statistics. */
 	struct lprocfs_stats	*pl_stats;
 
@@ -351,6 +367,24 @@ enum ldlm_ns_type {
 	LDLM_NS_TYPE_MGT,		/**< MGT namespace */
 };
 
+/**
+ * LRU list of unused locks of a namespace.
+ *
+ * Each lock is linked to the list of the CPT it was created on, via l_lru
+ * field in \see struct ldlm_lock, so that the threads of different CPTs do
+ * not contend on a single list lock when they use and release locks.
+ */
+struct ldlm_lru {
+	/** protects the fields below and l_lru of the locks */
+	spinlock_t		 ll_lock;
+	/** unused locks, the least recently used first */
+	struct list_head	 ll_list;
+	/** number of locks in ll_list */
+	int			 ll_nr;
+	/** where LDLM_LRU_FLAG_NO_WAIT scans of ll_list resume */
+	struct list_head	*ll_last_pos;
+} ____cacheline_aligned;
+
 /**
  * LDLM Namespace.
  *
@@ -410,19 +444,16 @@ struct ldlm_namespace {
 	struct list_head	ns_list_chain;
 
 	/**
-	 * List of unused locks for this namespace. This list is also called
-	 * LRU lock list.
+	 * Lists of unused locks for this namespace, one per CPT, also called
+	 * LRU lock lists, see \see struct ldlm_lru.
 	 * Unused locks are locks with zero reader/writer reference counts.
-	 * This list is only used on clients for lock caching purposes.
+	 * These lists are only used on clients for lock caching purposes.
 	 * When we want to release some locks voluntarily or if server wants
 	 * us to release some locks due to e.g. memory pressure, we take locks
-	 * to release from the head of this list.
-	 * Locks are linked via l_lru field in \see struct ldlm_lock.
+	 * to release from the heads of these lists, the least recently used
+	 * first.
 	 */
-	struct list_head	ns_unused_list;
-	/** Number of locks in the LRU list above */
-	int			ns_nr_unused;
-	struct list_head	*ns_last_pos;
+	struct ldlm_lru		**ns_lru;
 
 	/**
 	 * Maximum number of locks permitted in the LRU. If 0, means locks
@@ -608,9 +639,18 @@ struct ldlm_glimpse_work {
 
 struct ldlm_bl_desc {
 	unsigned int bl_same_client:1,
-		     bl_cos_incompat:1;
+		     bl_cos_incompat:1,
+		     bl_cos_enabled:1;
 };
 
+/**
+ * Maximum number of locks a batched blocking AST revokes, i.e. a
+ * LDLM_BL_CALLBACK request with a non-zero lock_count sent to clients with
+ * OBD_CONNECT2_BL_AST_BATCH.
+ */
+#define LDLM_BL_BATCH_MAX	64
+#define LDLM_BL_BATCH_HASH_BITS	6
+
 struct ldlm_cb_set_arg {
 	struct ptlrpc_request_set	*set;
 	int				 type; /* LDLM_{CP,BL,GL}_CALLBACK */
@@ -620,6 +660,9 @@ struct ldlm_cb_set_arg {
 	ptlrpc_interpterer_t		 gl_interpret_reply;
 	void				*gl_interpret_data;
 	struct ldlm_bl_desc		*bl_desc;
+	/* blocking ASTs being batched, per export and blocking lock */
+	struct list_head		 bl_batches;
+	struct hlist_head		 bl_batch_hash[1 << LDLM_BL_BATCH_HASH_BITS];
 };
 
 struct ldlm_cb_async_args {
@@ -749,9 +792,11 @@ struct ldlm_lock {
 	struct ldlm_resource	*l_resource;
 	/**
 	 * List item for client side LRU list.
-	 * Protected by ns_lock in struct ldlm_namespace.
+	 * Protected by ll_lock of the LRU of CPT l_lru_cpt of the namespace.
 	 */
 	struct list_head	l_lru;
+	/** CPT of the LRU list the lock gets linked to */
+	int			l_lru_cpt;
 	/**
 	 * Linkage to resource's lock queues according to current lock state.
 	 * (could be granted or waiting)
@@ -1108,6 +1153,23 @@ ldlm_lock_to_ns(struct ldlm_lock *lock)
         return ldlm_res_to_ns(lock->l_resource);
 }
 
+static inline struct ldlm_lru *ldlm_lock_lru(struct ldlm_lock *lock)
+{
+	return ldlm_lock_to_ns(lock)->ns_lru[lock->l_lru_cpt];
+}
+
+/** Number of locks in the LRU lists of \a ns, read without locking */
+static inline int ldlm_ns_nr_unused(struct ldlm_namespace *ns)
+{
+	struct ldlm_lru *lru;
+	int nr = 0;
+	int i;
+
+	cfs_percpt_for_each(lru, i, ns->ns_lru)
+		nr += READ_ONCE(lru->ll_nr);
+	return nr;
+}
+
 static inline char *
 ldlm_lock_to_ns_name(struct ldlm_lock *lock)
 {
@@ -53,6 +53,9 @@ struct mdt_client_data;
 struct mds_idmap_table;
 struct mdt_idmap_table;
 
+/* buckets of tg_export_data::ted_fmd_hash, as lut_fmd_max_num is 128 */
+#define TED_FMD_HASH_BITS	5
+
 /**
  * Target-specific export data
  */
@@ -101,6 +104,11 @@ struct tg_export_data {
 	long			ted_grant;    /* in bytes */
 	long			ted_pending;  /* bytes just being written */
 	__u8			ted_pagebits; /* log2 of client page size */
+	/* write rate of the client, in bytes per second, and bytes written
+	 * since ted_write_stamp, see tgt_grant_rate_update() */
+	__u64			ted_write_rate;
+	__u64			ted_write_bytes;
+	time64_t		ted_write_stamp;
 
 	/**
 	 * File Modification Data (FMD) tracking
@@ -108,6 +116,8 @@ struct tg_export_data {
 	spinlock_t		ted_fmd_lock; /* protects ted_fmd_list */
 	struct list_head	ted_fmd_list; /* FIDs being modified */
 	int			ted_fmd_count;/* items in ted_fmd_list */
+	/* FMDs of ted_fmd_list indexed by FID */
+	struct hlist_head	ted_fmd_hash[1 << TED_FMD_HASH_BITS];
 };
 
 /**
@@ -426,6 +436,22 @@ static inline bool imp_connect_shortio(struct obd_import *imp)
 	return ocd->ocd_connect_flags & OBD_CONNECT_SHORTIO;
 }
 
+static inline bool imp_connect_t10_guards(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_T10_GUARDS);
+}
+
+static inline bool imp_connect_compress(struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+
+	return (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) &&
+	       (ocd->ocd_connect_flags2 & OBD_CONNECT2_COMPRESS);
+}
+
 static inline __u64 exp_connect_ibits(struct obd_export *exp)
 {
 	struct obd_connect_data *ocd;
@@ -466,6 +492,11 @@ static inline int exp_connect_archive_id_array(struct obd_export *exp)
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_ARCHIVE_ID_ARRAY);
 }
 
+static inline int exp_connect_dom_read_head(struct obd_export *exp)
+{
+	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_DOM_READ_HEAD);
+}
+
 static inline int exp_connect_sepol(struct obd_export *exp)
 {
 	return !!(exp_connect_flags2(exp) & OBD_CONNECT2_SELINUX_POLICY);
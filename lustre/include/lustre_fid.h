@@ -443,6 +443,18 @@ struct lu_client_seq {
 	/* wait queue for fid allocation and update indicator */
 	wait_queue_head_t       lcs_waitq;
 	int                     lcs_update;
+
+	/* protects the prefetch fields below */
+	spinlock_t		lcs_lock;
+
+	/* Next meta-sequence range, prefetched before lcs_space is used up */
+	struct lu_seq_range	lcs_space_next;
+
+	/* Generation of lcs_space, changed by seq_client_flush() */
+	__u32			lcs_gen;
+
+	/* The RPC to prefetch lcs_space_next is in flight */
+	int			lcs_prefetching;
 };
 
 /* server sequence manager interface */
@@ -45,6 +45,7 @@
 #include <linux/atomic.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
+#include <linux/rbtree.h>
 #include <linux/spinlock.h>
 #include <linux/time.h>
 #include <linux/types.h>
@@ -185,6 +186,12 @@ struct obd_import {
 	struct list_head	imp_sending_list;
 	struct list_head	imp_delayed_list;
         /** @} */
+	/**
+	 * Requests of imp_replay_list indexed by transno and xid, to retain
+	 * requests and to find the next one to replay without walking the
+	 * list.
+	 */
+	struct rb_root		imp_replay_tree;
 
 	/**
 	 * List of requests that are retained for committed open replay. Once
@@ -271,6 +278,10 @@ struct obd_import {
 	time64_t		imp_next_ping;
 	/** When we last successfully connected. time in 64bit jiffies */
 	time64_t		imp_last_success_conn;
+	/** Do not try to connect before this time, in seconds */
+	time64_t		imp_conn_next;
+	/** Window given by the server to spread reconnects over, seconds */
+	__u32			imp_conn_window;
 
         /** List of all possible connection for import. */
 	struct list_head	imp_conn_list;
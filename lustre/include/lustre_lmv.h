@@ -51,6 +51,9 @@ struct lmv_stripe_md {
 	__u32	lsm_md_default_count;
 	__u32	lsm_md_default_index;
 	char	lsm_md_pool_name[LOV_MAXPOOLNAME + 1];
+	/* stripe of each placement group of a LMV_HASH_TYPE_CRUSH directory,
+	 * filled in on lookups, see lsm_name_to_stripe_info() */
+	__u16	*lsm_md_crush_table;
 	struct lmv_oinfo lsm_md_oinfo[0];
 };
 
@@ -156,6 +159,55 @@ lmv_hash_fnv1a(unsigned int count, const char *name, int namelen)
 	return do_div(hash, count);
 }
 
+/*
+ * With LMV_HASH_TYPE_CRUSH, names are hashed into a fixed number of placement
+ * groups, and each group goes to the stripe which draws the highest weight
+ * for it (rendezvous hashing). When stripes are added or removed, only the
+ * groups which get or lose their highest weight move, that is about delta /
+ * total of the names, instead of nearly all of them with a modulo.
+ */
+#define LMV_CRUSH_PG_COUNT	4096
+
+static inline __u64 lmv_crush_weight(unsigned int pg_id, unsigned int idx)
+{
+	__u64 x = ((__u64)pg_id << 32 | idx) + 0x9e3779b97f4a7c15ULL;
+
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+	return x ^ (x >> 31);
+}
+
+static inline unsigned int lmv_crush_pg_id(const char *name, int namelen)
+{
+	return lmv_hash_fnv1a(LMV_CRUSH_PG_COUNT, name, namelen);
+}
+
+static inline unsigned int lmv_crush_pg_stripe(unsigned int count,
+					       unsigned int pg_id)
+{
+	__u64 highest = 0;
+	__u64 weight;
+	unsigned int idx = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		weight = lmv_crush_weight(pg_id, i);
+		if (weight > highest) {
+			highest = weight;
+			idx = i;
+		}
+	}
+
+	return idx;
+}
+
+static inline unsigned int
+lmv_hash_crush(unsigned int count, const char *name, int namelen)
+{
+	return lmv_crush_pg_stripe(count, lmv_crush_pg_id(name, namelen));
+}
+
 static inline int lmv_name_to_stripe_index(__u32 lmv_hash_type,
 					   unsigned int stripe_count,
 					   const char *name, int namelen)
@@ -174,6 +226,9 @@ static inline int lmv_name_to_stripe_index(__u32 lmv_hash_type,
 	case LMV_HASH_TYPE_FNV_1A_64:
 		idx = lmv_hash_fnv1a(stripe_count, name, namelen);
 		break;
+	case LMV_HASH_TYPE_CRUSH:
+		idx = lmv_hash_crush(stripe_count, name, namelen);
+		break;
 	default:
 		idx = -EBADFD;
 		break;
@@ -188,7 +243,8 @@ static inline int lmv_name_to_stripe_index(__u32 lmv_hash_type,
 static inline bool lmv_is_known_hash_type(__u32 type)
 {
 	return (type & LMV_HASH_TYPE_MASK) == LMV_HASH_TYPE_FNV_1A_64 ||
-	       (type & LMV_HASH_TYPE_MASK) == LMV_HASH_TYPE_ALL_CHARS;
+	       (type & LMV_HASH_TYPE_MASK) == LMV_HASH_TYPE_ALL_CHARS ||
+	       (type & LMV_HASH_TYPE_MASK) == LMV_HASH_TYPE_CRUSH;
 }
 
 #endif
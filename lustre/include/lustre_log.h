@@ -60,6 +60,11 @@
         snprintf(logname, sizeof(logname), "LOGS/%s", name)
 #define LLOG_EEMPTY 4711
 
+/* The most data returned by a LLOG_ORIGIN_HANDLE_NEXT_BLOCK RPC, the complete
+ * chunks of a plain llog after the requested one are returned with it if the
+ * client asks for more than one chunk by llogd_body::lgd_len. */
+#define LLOG_BULK_SIZE		(8 * LLOG_MIN_CHUNK_SIZE)
+
 enum llog_open_param {
 	LLOG_OPEN_EXISTS	= 0x0000,
 	LLOG_OPEN_NEW		= 0x0001,
@@ -112,6 +117,8 @@ __u64 llog_size(const struct lu_env *env, struct llog_handle *llh);
 #define LLOG_FLAG_NODEAMON 0x0001
 
 /* llog_cat.c - catalog api */
+struct llog_cat_parallel;
+
 struct llog_process_data {
         /**
          * Any useful data needed while processing catalog. This is
@@ -128,6 +135,11 @@ struct llog_process_data {
          */
         int                  lpd_startcat;
         int                  lpd_startidx;
+	/**
+	 * Threads the plain logs are handed to, NULL if they are
+	 * processed by the catalog processing thread
+	 */
+	struct llog_cat_parallel *lpd_parallel;
 };
 
 struct llog_process_cat_data {
@@ -159,6 +171,9 @@ int llog_cat_process_or_fork(const struct lu_env *env,
 			     int startidx, bool fork);
 int llog_cat_process(const struct lu_env *env, struct llog_handle *cat_llh,
 		     llog_cb_t cb, void *data, int startcat, int startidx);
+int llog_cat_process_parallel(const struct lu_env *env,
+			      struct llog_handle *cat_llh, llog_cb_t cb,
+			      void *data, int startcat, int nthreads);
 __u64 llog_cat_size(const struct lu_env *env, struct llog_handle *cat_llh);
 __u32 llog_cat_free_space(struct llog_handle *cat_llh);
 int llog_cat_reverse_process(const struct lu_env *env,
@@ -282,6 +297,12 @@ struct llog_handle {
 
 	int			lgh_max_size;
 	bool			lgh_destroyed;
+
+	/* complete chunks of a remote plain llog read ahead by the bulk
+	 * LLOG_ORIGIN_HANDLE_NEXT_BLOCK RPC, of LLOG_BULK_SIZE */
+	char			*lgh_bulk_buf;
+	__u64			 lgh_bulk_offset;
+	int			 lgh_bulk_len;
 };
 
 /* llog_osd.c */
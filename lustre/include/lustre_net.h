@@ -52,6 +52,7 @@
  */
 #include <linux/kobject.h>
 #include <linux/uio.h>
+#include <linux/llist.h>
 #include <libcfs/libcfs.h>
 #include <lnet/api.h>
 #include <lnet/lib-types.h>
@@ -124,6 +125,11 @@
 #endif
 
 #define PTLRPC_NTHRS_INIT	2
+/**
+ * Seconds a service thread has to be idle before it exits, when the thread
+ * autoscaler is enabled, see ptlrpc_service::srv_wait_target_us
+ */
+#define PTLRPC_THR_IDLE_TIME	10
 
 /**
  * Buffer Constants
@@ -365,6 +371,15 @@
 				       MDS_LOV_MAXREQSIZE) + 1023) >> 10) << 10)
 #define MDS_REG_MAXREPSIZE	MDS_REG_MAXREQSIZE
 
+/**
+ * Maximum size of the sub-requests, and of the replies to them, packed into
+ * one MDS_BATCH RPC, which leaves room in the regular portal buffers for the
+ * batch headers.
+ */
+#define MDS_BATCH_MAXBUFSIZE	(MDS_REG_MAXREQSIZE - 1024)
+/** Maximum number of sub-requests in one MDS_BATCH RPC */
+#define MDS_BATCH_MAXCOUNT	256
+
 /**
  * The update request includes all of updates from the create, which might
  * include linkea (4K maxim), together with other updates, we set it to 1000K:
@@ -502,6 +517,13 @@
 #define OST_MAXREPSIZE		(9 * 1024)
 #define OST_IO_MAXREPSIZE	OST_MAXREPSIZE
 
+/**
+ * Maximum size of the sub-requests, and of the replies to them, packed into
+ * one MDS_BATCH RPC to an OST, which leaves room in OST_MAXREQSIZE for the
+ * batch headers.
+ */
+#define OST_BATCH_MAXBUFSIZE	(OST_MAXREQSIZE - 1024)
+
 #define OST_NBUFS		64
 /** OST_BUFSIZE = max_reqsize + max sptlrpc payload size */
 #define OST_BUFSIZE		max_t(int, OST_MAXREQSIZE + 1024, 16 * 1024)
@@ -534,6 +556,13 @@ struct ptlrpc_connection {
 	struct obd_uuid         c_remote_uuid;
 	/** reference counter for this connection */
 	atomic_t            c_refcount;
+	/**
+	 * Last time, in real seconds, a request was received from the peer
+	 * on servers, or a reply was received from it on clients.
+	 */
+	time64_t		c_last_alive;
+	/** Last time, in real seconds, a shared ping was sent to the peer */
+	time64_t		c_last_ping;
 };
 
 /** Client definition for PortalRPC */
@@ -568,6 +597,22 @@ union ptlrpc_async_args {
 struct ptlrpc_request_set;
 typedef int (*set_producer_func)(struct ptlrpc_request_set *, void *);
 
+struct ptlrpc_twheel;
+
+/**
+ * Timer run by the per-CPT ptlrpc timer wheels, see ptlrpc/twheel.c.
+ */
+struct ptlrpc_timer {
+	/** link in a slot of the wheel, empty if the timer is not armed */
+	struct list_head	 pt_link;
+	/** expiry time in jiffies */
+	unsigned long		 pt_expires;
+	/** wheel running the timer */
+	struct ptlrpc_twheel	*pt_wheel;
+	/** called in softirq context when the timer expires */
+	void			(*pt_func)(struct ptlrpc_timer *);
+};
+
 /**
  * Definition of request set structure.
  * Request set is a list of requests (not necessary to the same target) that
@@ -587,8 +632,17 @@ struct ptlrpc_request_set {
 	atomic_t		set_remaining;
 	/** wait queue to wait on for request events */
 	wait_queue_head_t	set_waitq;
+	/** # of events needing a full scan of the set, e.g. expired timeouts */
+	atomic_t		set_events;
 	/** List of requests in the set */
 	struct list_head	set_requests;
+	/** Lock for \a set_ready_requests manipulations */
+	spinlock_t		set_ready_lock;
+	/**
+	 * Requests of the set woken up since they were last checked, linked
+	 * via cr_ready_chain, so ptlrpcd only has to check these ones.
+	 */
+	struct list_head	set_ready_requests;
 	/**
 	 * Lock for \a set_new_requests manipulations
 	 * locked so that any old caller can communicate requests to
@@ -656,6 +710,7 @@ struct ptlrpc_reply_state {
         unsigned long          rs_handled:1;  /* been handled yet? */
         unsigned long          rs_on_net:1;   /* reply_out_callback pending? */
         unsigned long          rs_prealloc:1; /* rs from prealloc list */
+	unsigned long		rs_pooled:1;	/* rs from scp_rs_pools */
         unsigned long          rs_committed:1;/* the transaction was committed
                                                  and the rs was dispatched
                                                  by ptlrpc_commit_replies */
@@ -800,6 +855,10 @@ struct ptlrpc_cli_req {
 	wait_queue_head_t		 cr_set_waitq;
 	/** Link item for request set lists */
 	struct list_head		 cr_set_chain;
+	/** Link item for ptlrpc_request_set::set_ready_requests */
+	struct list_head		 cr_ready_chain;
+	/** Wakes up the set for the next deadline of the request */
+	struct ptlrpc_timer		 cr_timer;
 	/** link to waited ctx */
 	struct list_head		 cr_ctx_chain;
 
@@ -826,6 +885,8 @@ struct ptlrpc_cli_req {
 	void				*cr_cb_data;
 	/** Link to the imp->imp_unreplied_list */
 	struct list_head		 cr_unreplied_list;
+	/** Link to the imp->imp_replay_tree */
+	struct rb_node			 cr_replay_node;
 	/**
 	 * Commit callback, called when request is committed and about to be
 	 * freed.
@@ -866,6 +927,7 @@ struct ptlrpc_cli_req {
 #define rq_async_args		rq_cli.cr_async_args
 #define rq_cb_data		rq_cli.cr_cb_data
 #define rq_unreplied_list	rq_cli.cr_unreplied_list
+#define rq_replay_node		rq_cli.cr_replay_node
 #define rq_commit_cb		rq_cli.cr_commit_cb
 #define rq_replay_cb		rq_cli.cr_replay_cb
 
@@ -884,6 +946,8 @@ struct ptlrpc_srv_req {
 	struct list_head		 sr_exp_list;
 	/** server-side history, used for debuging purposes. */
 	struct list_head		 sr_hist_list;
+	/** linkage on ptlrpc_service_part::scp_req_arrived */
+	struct llist_node		 sr_arrived;
 	/** history sequence # */
 	__u64				 sr_hist_seq;
 	/** the index of service's srv_at_array into which request is linked */
@@ -904,6 +968,12 @@ struct ptlrpc_srv_req {
 	/** @} nrs */
 	/** request arrival time */
 	struct timespec64		 sr_arrival_time;
+	/** time a service thread started to handle the request */
+	ktime_t				 sr_handle_start;
+	/** time the reply was handed to LNet, 0 if none was sent */
+	ktime_t				 sr_reply_sent;
+	/** time spent waiting for bulk transfers */
+	ktime_t				 sr_bulk_time;
 	/** server's half ctx */
 	struct ptlrpc_svc_ctx		*sr_svc_ctx;
 	/** (server side), pointed directly into req buffer */
@@ -931,6 +1001,9 @@ struct ptlrpc_srv_req {
 #define rq_session		rq_srv.sr_ses
 #define rq_nrq			rq_srv.sr_nrq
 #define rq_arrival_time		rq_srv.sr_arrival_time
+#define rq_handle_start		rq_srv.sr_handle_start
+#define rq_reply_sent		rq_srv.sr_reply_sent
+#define rq_bulk_time		rq_srv.sr_bulk_time
 #define rq_reply_state		rq_srv.sr_reply_state
 #define rq_svc_ctx		rq_srv.sr_svc_ctx
 #define rq_user_desc		rq_srv.sr_user_desc
@@ -1470,6 +1543,7 @@ struct ptlrpc_bulk_desc {
 	lnet_nid_t             bd_sender;       /* stash event::sender */
 	int			bd_md_count;	/* # valid entries in bd_mds */
 	int			bd_md_max_brw;	/* max entries in bd_mds */
+	int			bd_enc_cpt;	/* CPT of bd_enc_vec pool */
 	/** array of offsets for each MD */
 	unsigned int		bd_mds_off[PTLRPC_BULK_OPS_COUNT];
 	/** array of associated MDs */
@@ -1696,6 +1770,12 @@ struct ptlrpc_service {
 	int				srv_nthrs_cpt_init;
 	/** limit of threads number for each partition */
 	int				srv_nthrs_cpt_limit;
+	/**
+	 * queue wait time targeted by the thread autoscaler, in usec: more
+	 * threads are started above it, idle threads exit below it, down to
+	 * srv_nthrs_cpt_init. 0 disables the autoscaler.
+	 */
+	int				srv_wait_target_us;
 	/** Root of debugfs dir tree for this service */
 	struct dentry		       *srv_debugfs_entry;
         /** Pointer to statistic data for this service */
@@ -1748,6 +1828,28 @@ struct ptlrpc_service {
 	struct ptlrpc_service_part	*srv_parts[0];
 };
 
+/**
+ * Reply states are recycled per CPT in pools of power of two sizes, from
+ * 4K (PTLRPC_RS_POOL_MIN_SHIFT) up to 1M, so that large replies do not
+ * go through vmalloc and vfree for every request. The buffers idle for
+ * more than PTLRPC_RS_POOL_TRIM_TIME seconds are released.
+ */
+#define PTLRPC_RS_POOL_MIN_SHIFT	12
+#define PTLRPC_RS_POOL_CLASSES		9
+#define PTLRPC_RS_POOL_TRIM_TIME	10
+
+struct ptlrpc_rs_pool {
+	spinlock_t			rsp_lock;
+	/** idle reply states, the most recently used first */
+	struct list_head		rsp_idle;
+	/** # of idle reply states */
+	int				rsp_nidle;
+	/** lowest rsp_nidle since rsp_trim_time */
+	int				rsp_nidle_min;
+	/** last time the pool was trimmed */
+	time64_t			rsp_trim_time;
+};
+
 /**
  * Definition of PortalRPC service partition data.
  * Although a service only has one instance of it right now, but we
@@ -1781,6 +1883,17 @@ struct ptlrpc_service_part {
 	int				scp_nthrs_running;
 	/** service threads list */
 	struct list_head		scp_threads;
+	/** queue wait time of the requests, in usec */
+	struct obd_histogram		scp_req_wait_hist;
+	/** moving average of the queue wait time, in usec, updated racily */
+	long				scp_req_wait_avg;
+
+	/**
+	 * requests just received, pushed by the LNet callbacks without
+	 * taking scp_lock, and moved to scp_req_incoming in batches under
+	 * scp_lock by ptlrpc_server_drain_arrived()
+	 */
+	struct llist_head		scp_req_arrived __cfs_cacheline_aligned;
 
 	/**
 	 * serialize the following fields, used for protecting
@@ -1854,7 +1967,7 @@ struct ptlrpc_service_part {
 	/** reqs waiting for replies */
 	struct ptlrpc_at_array		scp_at_array;
 	/** early reply timer */
-	struct timer_list		scp_at_timer;
+	struct ptlrpc_timer		scp_at_timer;
 	/** debug */
 	ktime_t				scp_at_checktime;
 	/** check early replies */
@@ -1874,6 +1987,8 @@ struct ptlrpc_service_part {
 	wait_queue_head_t		scp_rep_waitq;
 	/** # 'difficult' replies */
 	atomic_t			scp_nreps_difficult;
+	/** pools of reply states, see lustre_get_pooled_rs() */
+	struct ptlrpc_rs_pool		scp_rs_pools[PTLRPC_RS_POOL_CLASSES];
 };
 
 #define ptlrpc_service_for_each_part(part, i, svc)			\
@@ -1930,6 +2045,23 @@ struct ptlrpcd_ctl {
 	 * Record the partner index to be processed next.
 	 */
 	int				pc_cursor;
+	/**
+	 * All ptlrpcd threads of the CPT, including this one, which can
+	 * steal queued requests from each other.
+	 */
+	struct ptlrpcd_ctl		*pc_peers;
+	/**
+	 * Number of threads in pc_peers.
+	 */
+	int				pc_npeers;
+	/**
+	 * Value of pc_set::set_events at the last full ptlrpc_check_set().
+	 */
+	int				pc_events;
+	/**
+	 * Time of the last full ptlrpc_check_set() in jiffies.
+	 */
+	unsigned long			pc_scan_time;
 	/**
 	 * Error code if the thread failed to fully start.
 	 */
@@ -2222,6 +2354,16 @@ void *ptlrpcd_alloc_work(struct obd_import *imp,
 void ptlrpcd_destroy_work(void *handler);
 int ptlrpcd_queue_work(void *handler);
 
+/* ptlrpc/batch.c */
+struct ptlrpc_request *ptlrpc_batch_prep(struct obd_import *imp,
+					 struct list_head *reqs,
+					 void (*done)(void *), void *data);
+struct ptlrpc_request *ptlrpc_batch_sub_init(struct ptlrpc_request *batch,
+					     struct lustre_msg *msg, int len);
+int ptlrpc_batch_sub_reply(struct ptlrpc_request *req, int rc);
+void ptlrpc_batch_sub_fini(struct ptlrpc_request *req);
+void ptlrpc_batch_add(struct obd_export *exp, struct ptlrpc_request *req);
+
 /** @} */
 struct ptlrpc_service_buf_conf {
 	/* nbufs is buffers # to allocate when growing the pool */
@@ -2370,6 +2512,9 @@ int lustre_pack_reply_flags(struct ptlrpc_request *, int count, __u32 *lens,
 int lustre_shrink_msg(struct lustre_msg *msg, int segment,
                       unsigned int newlen, int move_data);
 void lustre_free_reply_state(struct ptlrpc_reply_state *rs);
+struct ptlrpc_reply_state *
+lustre_get_pooled_rs(struct ptlrpc_service_part *svcpt, int size);
+void lustre_put_pooled_rs(struct ptlrpc_reply_state *rs);
 int __lustre_unpack_msg(struct lustre_msg *m, int len);
 __u32 lustre_msg_hdr_size(__u32 magic, __u32 count);
 __u32 lustre_msg_size(__u32 magic, int count, __u32 *lengths);
@@ -2558,11 +2703,20 @@ ptlrpc_client_recv_or_unlink(struct ptlrpc_request *req)
 static inline void
 ptlrpc_client_wake_req(struct ptlrpc_request *req)
 {
+	struct ptlrpc_request_set *set;
+
 	smp_mb();
-	if (req->rq_set == NULL)
+	set = req->rq_set;
+	if (set == NULL) {
 		wake_up(&req->rq_reply_waitq);
-	else
-		wake_up(&req->rq_set->set_waitq);
+	} else {
+		spin_lock_bh(&set->set_ready_lock);
+		if (list_empty(&req->rq_cli.cr_ready_chain))
+			list_add_tail(&req->rq_cli.cr_ready_chain,
+				      &set->set_ready_requests);
+		spin_unlock_bh(&set->set_ready_lock);
+		wake_up(&set->set_waitq);
+	}
 }
 
 static inline void
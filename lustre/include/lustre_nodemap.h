@@ -57,6 +57,8 @@ enum nodemap_mapping_modes {
 	NODEMAP_MAP_GID_ONLY,
 };
 
+struct lu_idmap_snap;
+
 struct nodemap_pde {
 	char			 npe_name[LUSTRE_NODEMAP_NAME_LENGTH + 1];
 	struct proc_dir_entry	*npe_proc_entry;
@@ -98,6 +100,8 @@ struct lu_nodemap {
 	struct rb_root		 nm_fs_to_client_gidmap;
 	/* GID map keyed by remote UID */
 	struct rb_root		 nm_client_to_fs_gidmap;
+	/* copy of the maps above looked up under RCU, NULL if not built */
+	struct lu_idmap_snap __rcu *nm_idmap_snap;
 	/* attached client members of this nodemap */
 	struct mutex		 nm_member_list_lock;
 	struct list_head	 nm_member_list;
@@ -0,0 +1,75 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_EDF_H
+#define _LUSTRE_NRS_EDF_H
+
+/* \name edf
+ *
+ * EDF policy
+ *
+ * This policy dispatches RPCs in the order of the deadlines the clients
+ * expect them to be replied by.
+ * @{
+ */
+
+/**
+ * Private data structure for the EDF policy
+ */
+struct nrs_edf_head {
+	/**
+	 * Resource object for policy instance.
+	 */
+	struct ptlrpc_nrs_resource	eh_res;
+	/**
+	 * Queued requests, sorted by deadline.
+	 */
+	struct cfs_binheap		*eh_binheap;
+	/**
+	 * Orders the requests with the same deadline by arrival.
+	 */
+	__u64				 eh_sequence;
+	/**
+	 * # of requests handled after their deadline.
+	 */
+	__u64				 eh_expired;
+};
+
+struct nrs_edf_req {
+	/**
+	 * Deadline of the request when it was queued, the one later early
+	 * replies start from.
+	 */
+	time64_t		er_deadline;
+	__u64			er_sequence;
+};
+
+enum nrs_ctl_edf {
+	NRS_CTL_EDF_RD_EXPIRED = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+};
+
+/** @} edf */
+#endif
@@ -32,6 +32,8 @@
 #ifndef _LUSTRE_NRS_TBF_H
 #define _LUSTRE_NRS_TBF_H
 
+#include <interval_tree.h>
+
 /* \name tbf
  *
  * TBF policy
@@ -65,6 +67,15 @@ enum nrs_tbf_flag {
 	NRS_TBF_FLAG_GID        = 0x0000020,
 };
 
+enum nrs_tbf_field {
+	NRS_TBF_FIELD_NID,
+	NRS_TBF_FIELD_JOBID,
+	NRS_TBF_FIELD_OPCODE,
+	NRS_TBF_FIELD_UID,
+	NRS_TBF_FIELD_GID,
+	NRS_TBF_FIELD_MAX
+};
+
 struct tbf_id {
 	enum nrs_tbf_flag	ti_type;
 	u32			ti_uid;
@@ -134,6 +145,8 @@ struct nrs_tbf_client {
 };
 
 #define MAX_TBF_NAME (16)
+/** Maximum depth of the hierarchy of rules, e.g. job within user within NID */
+#define NRS_TBF_MAX_LEVELS	3
 
 enum nrs_rule_flags {
 	NTRS_STOPPING	= 0x00000001,
@@ -184,6 +197,52 @@ struct nrs_tbf_rule {
 	atomic_t			 tr_ref;
 	/** Generation of the rule. */
 	__u64				 tr_generation;
+	/**
+	 * Parent rule. Its rate caps the total rate of the classes of all
+	 * its child rules, which can use the tokens left by each other.
+	 */
+	struct nrs_tbf_rule		*tr_parent;
+	/** Level of the rule in the hierarchy, 0 for rules without parent. */
+	int				 tr_level;
+	/** # of child rules. Protected by nrs_tbf_head::th_rule_lock. */
+	int				 tr_nchildren;
+	/** Tokens shared by the classes of the child rules. */
+	__u64				 tr_ntoken;
+	/** Time check-point of tr_ntoken. */
+	__u64				 tr_check_time;
+	/**
+	 * Position of the rule in nrs_tbf_head::th_list, the first rule
+	 * matching a client in that list is the one used for it.
+	 */
+	int				 tr_rank;
+	/** Entries of the rule in the index of nrs_tbf_head. */
+	struct list_head		 tr_index;
+};
+
+/**
+ * Entry of a rule in the index of the rules of a TBF head, keyed on a value
+ * or a range of values of a field. A client can only match a rule with an
+ * entry keyed on the value of that field for the client, so only these rules
+ * have to be checked. The rules with conditions which cannot be indexed have
+ * an entry on nrs_tbf_head::th_index_all, and are checked for every client.
+ */
+struct nrs_tbf_index_node {
+	/** Rule of the entry. */
+	struct nrs_tbf_rule		*tin_rule;
+	/** Linkage to nrs_tbf_rule::tr_index. */
+	struct list_head		 tin_rule_linkage;
+	/** Field the entry is keyed on, NRS_TBF_FIELD_MAX if none. */
+	enum nrs_tbf_field		 tin_field;
+	/** uid, gid or opcode the entry is keyed on. */
+	__u32				 tin_value;
+	/** Jobid the entry is keyed on. */
+	const char			*tin_jobid;
+	/** Linkage to a bucket of nrs_tbf_head::th_index or th_index_all. */
+	struct list_head		 tin_linkage;
+	/** NID range the entry is keyed on, in nrs_tbf_head::th_nid_tree. */
+	struct interval_node		 tin_interval;
+	/** Ring of the entries keyed on the same NID range. */
+	struct list_head		 tin_same;
 };
 
 struct nrs_tbf_ops {
@@ -202,6 +261,7 @@ struct nrs_tbf_ops {
 	int (*o_rule_match)(struct nrs_tbf_rule *,
 			    struct nrs_tbf_client *);
 	void (*o_rule_fini)(struct nrs_tbf_rule *);
+	int (*o_rule_index)(struct nrs_tbf_rule *);
 };
 
 #define NRS_TBF_TYPE_JOBID	"jobid"
@@ -218,6 +278,11 @@ struct nrs_tbf_type {
 	struct nrs_tbf_ops	*ntt_ops;
 };
 
+#define NRS_TBF_INDEX_BITS	6
+#define NRS_TBF_INDEX_SIZE	(1 << NRS_TBF_INDEX_BITS)
+/** Rules on more opcodes than that are not indexed on the opcode */
+#define NRS_TBF_INDEX_MAX_OPCODES	16
+
 struct nrs_tbf_bucket {
 	/**
 	 * LRU list, updated on each access to client. Protected by
@@ -250,6 +315,19 @@ struct nrs_tbf_head {
 	 * Default rule.
 	 */
 	struct nrs_tbf_rule		*th_rule;
+	/**
+	 * Index of the rules keyed on jobid, uid, gid and opcode values.
+	 * Protected by th_rule_lock, as the following two fields.
+	 */
+	struct list_head		 th_index[NRS_TBF_INDEX_SIZE];
+	/**
+	 * Index of the rules keyed on NID ranges.
+	 */
+	struct interval_node		*th_nid_tree;
+	/**
+	 * Rules which cannot be indexed.
+	 */
+	struct list_head		 th_index_all;
 	/**
 	 * Timer for next token.
 	 */
@@ -313,6 +391,7 @@ struct nrs_tbf_cmd {
 			__u32			 ts_valid_type;
 			enum nrs_rule_flags	 ts_rule_flags;
 			char			*ts_next_name;
+			char			*ts_parent_name;
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
@@ -321,15 +400,6 @@ struct nrs_tbf_cmd {
 	} u;
 };
 
-enum nrs_tbf_field {
-	NRS_TBF_FIELD_NID,
-	NRS_TBF_FIELD_JOBID,
-	NRS_TBF_FIELD_OPCODE,
-	NRS_TBF_FIELD_UID,
-	NRS_TBF_FIELD_GID,
-	NRS_TBF_FIELD_MAX
-};
-
 struct nrs_tbf_expression {
 	enum nrs_tbf_field	 te_field;
 	struct list_head	 te_cond;
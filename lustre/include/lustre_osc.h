@@ -136,6 +136,13 @@ struct osc_io {
 	/** active extents, we know how many bytes is going to be written,
 	 * so having an active extent will prevent it from being fragmented */
 	struct osc_extent *oi_active;
+	/** pages committed by osc_io_commit_async() but still locked, which
+	 * are handed back to the upper layer by oi_commit_cb in batches */
+	struct cl_page_list	 oi_commit_batch;
+	cl_commit_cbt		 oi_commit_cb;
+	/** the last page of the commit, and the end of its data */
+	struct cl_page		*oi_commit_last;
+	int			 oi_commit_to;
 	/** partially truncated extent, we need to hold this extent to prevent
 	 * page writeback from happening. */
 	struct osc_extent *oi_trunc;
@@ -268,6 +275,8 @@ struct osc_object {
 	struct list_head	oo_hp_ready_item;
 	struct list_head	oo_write_item;
 	struct list_head	oo_read_item;
+	/** time oo_write_item was queued, see osc_write_expired() */
+	time64_t		oo_write_queued;
 
 	/**
 	 * extent is a red black tree to manage (async) dirty pages.
@@ -533,6 +542,10 @@ struct osc_page {
 	 * If the page is in osc_object::oo_tree.
 	 */
 				ops_intree:1;
+	/**
+	 * CPT of the LRU shard the page was last added to.
+	 */
+	unsigned short		ops_lru_cpt;
 	/**
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
@@ -549,6 +562,13 @@ struct osc_brw_async_args {
 	int			 aa_nio_count;
 	u32			 aa_page_count;
 	int			 aa_resends;
+	/* index of aa_ppga[0] in the pages of the RPC first sent, and their
+	 * number, a resend after a checksum error covering only some of them */
+	u32			 aa_ppga_start;
+	u32			 aa_ppga_total;
+	/* pages of aa_ppga whose guards the OST found to be wrong */
+	u32			 aa_redo_start;
+	u32			 aa_redo_count;
 	struct brw_page		**aa_ppga;
 	struct client_obd	*aa_cli;
 	struct list_head	 aa_oaps;
@@ -560,6 +580,7 @@ extern struct kmem_cache *osc_object_kmem;
 extern struct kmem_cache *osc_thread_kmem;
 extern struct kmem_cache *osc_session_kmem;
 extern struct kmem_cache *osc_extent_kmem;
+extern struct cfs_mag_cache *osc_extent_mag;
 extern struct kmem_cache *osc_quota_kmem;
 extern struct kmem_cache *osc_obdo_kmem;
 
@@ -606,10 +627,8 @@ int osc_cache_wait_range(const struct lu_env *env, struct osc_object *obj,
 			 pgoff_t start, pgoff_t end);
 int osc_io_unplug0(const struct lu_env *env, struct client_obd *cli,
 		   struct osc_object *osc, int async);
-static inline void osc_wake_cache_waiters(struct client_obd *cli)
-{
-	wake_up(&cli->cl_cache_waiters);
-}
+void osc_wake_cache_waiters(struct client_obd *cli);
+void osc_cache_jobs_fini(struct client_obd *cli);
 
 static inline int osc_io_unplug_async(const struct lu_env *env,
 				      struct client_obd *cli,
@@ -685,6 +704,7 @@ int osc_io_commit_async(const struct lu_env *env,
 			const struct cl_io_slice *ios,
 			struct cl_page_list *qin, int from, int to,
 			cl_commit_cbt cb);
+void osc_io_commit_flush(const struct lu_env *env, struct osc_io *oio);
 int osc_io_iter_init(const struct lu_env *env, const struct cl_io_slice *ios);
 void osc_io_iter_fini(const struct lu_env *env,
 		      const struct cl_io_slice *ios);
@@ -51,6 +51,7 @@ struct req_format;
 struct req_capsule;
 
 struct ptlrpc_request;
+struct lustre_msg;
 
 enum req_location {
         RCL_CLIENT,
@@ -66,8 +67,22 @@ struct req_capsule {
         const struct req_format *rc_fmt;
         enum req_location        rc_loc;
         __u32                    rc_area[RCL_NR][REQ_MAX_FIELD_NR];
+	/* message the \a rc_checked bits of each location refer to */
+	struct lustre_msg	*rc_checked_msg[RCL_NR];
+	/* buffers already size checked and swabbed, by offset */
+	__u32			 rc_checked[RCL_NR];
 };
 
+/*
+ * Forget which buffers of the request or reply (\a loc) were checked, so that
+ * the next access of each field checks and swabs it again.
+ */
+static inline void req_capsule_uncheck(struct req_capsule *pill,
+				       enum req_location loc)
+{
+	pill->rc_checked[loc] = 0;
+}
+
 void req_capsule_init(struct req_capsule *pill, struct ptlrpc_request *req,
                       enum req_location location);
 void req_capsule_fini(struct req_capsule *pill);
@@ -180,6 +195,7 @@ extern struct req_format RQF_MDS_SWAP_LAYOUTS;
 extern struct req_format RQF_MDS_REINT_MIGRATE;
 extern struct req_format RQF_MDS_REINT_RESYNC;
 extern struct req_format RQF_MDS_RMFID;
+extern struct req_format RQF_MDS_BATCH;
 /* MDS hsm formats */
 extern struct req_format RQF_MDS_HSM_STATE_GET;
 extern struct req_format RQF_MDS_HSM_STATE_SET;
@@ -225,6 +241,7 @@ extern struct req_format RQF_LDLM_CANCEL;
 extern struct req_format RQF_LDLM_CALLBACK;
 extern struct req_format RQF_LDLM_CP_CALLBACK;
 extern struct req_format RQF_LDLM_BL_CALLBACK;
+extern struct req_format RQF_LDLM_BL_CALLBACK_BATCH;
 extern struct req_format RQF_LDLM_GL_CALLBACK;
 extern struct req_format RQF_LDLM_GL_CALLBACK_DESC;
 /* LOG req_format */
@@ -258,6 +275,8 @@ extern struct req_msg_field RMF_CLOSE_DATA;
 extern struct req_msg_field RMF_FILE_SECCTX_NAME;
 extern struct req_msg_field RMF_FILE_SECCTX;
 extern struct req_msg_field RMF_FID_ARRAY;
+extern struct req_msg_field RMF_BATCH_BODY;
+extern struct req_msg_field RMF_BATCH_BUF;
 
 /*
  * connection handle received in MDS_CONNECT request.
@@ -321,6 +340,8 @@ extern struct req_msg_field RMF_FIEMAP_KEY;
 extern struct req_msg_field RMF_FIEMAP_VAL;
 extern struct req_msg_field RMF_OST_ID;
 extern struct req_msg_field RMF_SHORT_IO;
+extern struct req_msg_field RMF_OST_GUARDS;
+extern struct req_msg_field RMF_OST_COMPR;
 
 /* MGS config read message format */
 extern struct req_msg_field RMF_MGS_CONFIG_BODY;
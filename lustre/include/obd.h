@@ -135,6 +135,7 @@ struct timeout_item {
 #define OSC_MAX_DIRTY_DEFAULT	2000	 /* Arbitrary large value */
 #define OSC_MAX_DIRTY_MB_MAX	2048     /* arbitrary, but < MAX_LONG bytes */
 #define OSC_DEFAULT_RESENDS	10
+#define OSC_DEFAULT_WRITEBACK_DEADLINE	10	/* seconds */
 
 /* possible values for lut_sync_lock_cancel */
 enum tgt_sync_lock_cancel {
@@ -158,6 +159,13 @@ enum obd_cl_sem_lock_class {
 	OBD_CLI_SEM_MDCOSC,
 };
 
+/* LRU pages of a client_obd added on a CPT, see osc_lru_add_batch() */
+struct cl_lru_shard {
+	spinlock_t		cls_lock;
+	struct list_head	cls_list;
+	long			cls_count;
+};
+
 struct mdc_rpc_lock;
 struct obd_import;
 struct client_obd {
@@ -214,7 +222,9 @@ struct client_obd {
 	 * grant before trying to dirty a page and unreserve the rest.
 	 * See osc_{reserve|unreserve}_grant for details. */
 	long			cl_reserved_grant;
-	wait_queue_head_t	cl_cache_waiters; /* waiting for cache/grant */
+	struct list_head	cl_cache_waiters; /* waiting for cache/grant */
+	/* jobs that waited for cache/grant lately, see osc_enter_cache() */
+	struct list_head	cl_cache_jobs;
 	time64_t		cl_next_shrink_grant;	/* seconds */
 	struct list_head	cl_grant_chain;
 	time64_t		cl_grant_shrink_interval; /* seconds */
@@ -258,12 +268,20 @@ struct client_obd {
 	u32			cl_max_pages_per_rpc;
 	u32			cl_max_rpcs_in_flight;
 	u32			cl_max_short_io_bytes;
+	/* seconds an object with dirty pages waits at most for a write RPC,
+	 * 0 to wait until its extents are full or urgent */
+	u32			cl_writeback_deadline;
+	/* write RPCs sent for objects past their writeback deadline */
+	__u64			cl_w_expired;
 	struct obd_histogram	cl_read_rpc_hist;
 	struct obd_histogram	cl_write_rpc_hist;
 	struct obd_histogram	cl_read_page_hist;
 	struct obd_histogram	cl_write_page_hist;
 	struct obd_histogram	cl_read_offset_hist;
 	struct obd_histogram	cl_write_offset_hist;
+	/* RPC size in tenths of cl_max_pages_per_rpc */
+	struct obd_histogram	cl_read_fullness_hist;
+	struct obd_histogram	cl_write_fullness_hist;
 
 	/** LRU for osc caching pages */
 	struct cl_client_cache  *cl_cache;
@@ -289,14 +307,20 @@ struct client_obd {
 	 * reclaim is sync, initiated by IO thread when the LRU slots are
 	 * in shortage. */
 	__u64                    cl_lru_reclaim;
-	/** List of LRU pages for this client_obd */
-	struct list_head         cl_lru_list;
-	/** Lock for LRU page list */
-	spinlock_t		 cl_lru_list_lock;
+	/** LRU pages for this client_obd, one list per CPT */
+	struct cl_lru_shard	**cl_lru_shards;
+	/** shard osc_lru_shrink() starts from */
+	unsigned int		 cl_lru_shard_next;
 	/** # of unstable pages in this client_obd.
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
 	atomic_long_t            cl_unstable_count;
+	/** average time the OST takes to commit writes, in ms */
+	unsigned int		 cl_unstable_commit_ms;
+	/** a soft sync RPC was sent and no write committed since */
+	atomic_t		 cl_soft_sync_pending;
+	/** stats: how many soft sync RPCs were sent */
+	__u64			 cl_soft_sync_count;
 	/** Link to osc_shrinker_list */
 	struct list_head	 cl_shrink_list;
 
@@ -331,6 +355,9 @@ struct client_obd {
         __u32                    cl_supp_cksum_types;
         /* checksum algorithm to be used */
 	enum cksum_types	 cl_cksum_type;
+	/* algorithm to compress the bulk data of BRWs with, if the OST
+	 * supports it */
+	enum obd_compr_type	 cl_compr_type;
 
         /* also protected by the poorly named _loi_list_lock lock above */
         struct osc_async_rc      cl_ar;
@@ -344,6 +371,19 @@ struct client_obd {
 	/* ptlrpc work for writeback in ptlrpcd context */
 	void			*cl_writeback_work;
 	void			*cl_lru_work;
+	/* requests waiting to be sent in a MDS_BATCH RPC, see
+	 * ptlrpc_batch_add() */
+	spinlock_t		 cl_batch_lock;
+	struct list_head	 cl_batch_list;
+	__u32			 cl_batch_count;
+	__u32			 cl_batch_reqlen;
+	__u32			 cl_batch_replen;
+	/* # of batches in flight */
+	__u32			 cl_batch_inflight;
+	/* max # of requests per batch, 1 disables batching */
+	__u32			 cl_batch_max;
+	/* max size of the requests, and of their replies, per batch */
+	__u32			 cl_batch_maxbuf;
 	struct mutex		  cl_quota_mutex;
 	/* hash tables for osc_quota_info */
 	struct cfs_hash		*cl_quota_hash[LL_MAXQUOTAS];
@@ -424,6 +464,12 @@ struct lov_obd {
 	struct lov_md_tgt_desc	*lov_mdc_tgts;
 
 	struct kobject		*lov_tgts_kobj;
+
+	/* minimum pages of a stripe for a worker to submit them */
+	unsigned int		lov_submit_async_pages;
+	/* FLR: bytes of a file read from one mirror before moving to the
+	 * next one, 0 to always read the preferred mirror */
+	unsigned int		lov_mirror_read_stride;
 };
 
 struct lmv_tgt_desc {
@@ -590,13 +636,41 @@ struct obd_notify_upcall {
         void *onu_owner;
 };
 
+#define TRD_MAX_HELPERS		15
+#define TRD_MAX_WINDOW		32
+
 struct target_recovery_data {
 	svc_handler_t		trd_recovery_handler;
 	pid_t			trd_processing_task;
 	struct completion	trd_starting;
 	struct completion	trd_finishing;
+	/* threads helping to replay the requests of a window in parallel */
+	pid_t			trd_helper_tasks[TRD_MAX_HELPERS];
+	int			trd_nhelpers;
+	int			trd_helpers_running;
+	bool			trd_helpers_stop;
+	/* requests of the window to replay, and number not replayed yet */
+	spinlock_t		trd_window_lock;
+	struct list_head	trd_window;
+	int			trd_window_busy;
+	wait_queue_head_t	trd_window_waitq;
 };
 
+/* Whether current is the recovery thread of \a trd, or one of its helpers */
+static inline bool trd_is_recovery_task(struct target_recovery_data *trd)
+{
+	int i;
+
+	if (trd->trd_processing_task == current_pid())
+		return true;
+
+	for (i = 0; i < trd->trd_nhelpers; i++) {
+		if (trd->trd_helper_tasks[i] == current_pid())
+			return true;
+	}
+	return false;
+}
+
 struct obd_llog_group {
 	struct llog_ctxt   *olg_ctxts[LLOG_MAX_CTXTS];
 	wait_queue_head_t  olg_waitq;
@@ -745,6 +819,10 @@ struct obd_device {
 	int				obd_pool_limit;
 
 	int				obd_conn_inprogress;
+	/* connects handled at once, 0 for no limit */
+	int				obd_conn_limit;
+	/* seconds clients spread their reconnects over, 0 for auto */
+	int				obd_conn_window;
 
 	/**
 	 * List of outstanding class_incref()'s fo this OBD. For debugging. */
@@ -884,6 +962,8 @@ struct md_op_data {
 	/* File object data version for HSM release, on client */
 	__u64			op_data_version;
 	struct lustre_handle	op_lease_handle;
+	/* HSM archive ID of the client cache, for PCC attach */
+	__u32			op_archive_id;
 
 	/* File security context, for creates/metadata ops */
 	const char	       *op_file_secctx_name;
@@ -1153,7 +1233,7 @@ struct md_ops {
 			       enum ldlm_cancel_flags flags, void *opaque);
 
 	int (*m_get_fid_from_lsm)(struct obd_export *,
-				  const struct lmv_stripe_md *,
+				  struct lmv_stripe_md *,
 				  const char *name, int namelen,
 				  struct lu_fid *fid);
 	int (*m_unpackmd)(struct obd_export *exp, struct lmv_stripe_md **plsm,
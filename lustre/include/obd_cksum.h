@@ -57,6 +57,16 @@ static inline unsigned char cksum_obd2cfs(enum cksum_types cksum_type)
 
 u32 obd_cksum_type_pack(const char *obd_name, enum cksum_types cksum_type);
 
+/* checksum pages \a start to \a end, returns the bytes checksummed */
+typedef int (*obd_cksum_pages_fn)(void *data, int start, int end, u32 *cksum);
+
+u32 obd_cksum_combine(enum cksum_types cksum_type, u32 cksum1, u32 cksum2,
+		      unsigned int len2);
+int obd_cksum_pages(enum cksum_types cksum_type, int npages,
+		    obd_cksum_pages_fn fn, void *data, u32 *cksum);
+int obd_cksum_init(void);
+void obd_cksum_fini(void);
+
 static inline enum cksum_types obd_cksum_type_unpack(u32 o_flags)
 {
 	switch (o_flags & OBD_FL_CKSUM_ALL) {
@@ -168,6 +178,20 @@ static inline void obd_t10_cksum2dif(enum cksum_types cksum_type,
 #endif /* CONFIG_CRC_T10DIF */
 }
 
+/*
+ * Number of guards obd_page_dif_generate_buffer() computes for \a length
+ * bytes at \a offset in a page, one for each sector they touch.
+ */
+static inline int obd_dif_guard_count(__u32 offset, __u32 length,
+				      int sector_size)
+{
+	if (length == 0)
+		return 0;
+
+	return (round_up(offset + length, sector_size) -
+		round_down(offset, sector_size)) / sector_size;
+}
+
 enum obd_t10_cksum_type {
 	OBD_T10_CKSUM_UNKNOWN = 0,
 	OBD_T10_CKSUM_IP512,
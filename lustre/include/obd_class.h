@@ -1760,7 +1760,7 @@ static inline int md_revalidate_lock(struct obd_export *exp,
 }
 
 static inline int md_get_fid_from_lsm(struct obd_export *exp,
-				      const struct lmv_stripe_md *lsm,
+				      struct lmv_stripe_md *lsm,
 				      const char *name, int namelen,
 				      struct lu_fid *fid)
 {
@@ -0,0 +1,55 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Compression of the bulk data of BRW RPCs.
+ */
+
+#ifndef __OBD_COMPR_H
+#define __OBD_COMPR_H
+
+#include <libcfs/libcfs.h>
+#include <uapi/linux/lnet/lnet-types.h>
+#include <uapi/linux/lustre/lustre_idl.h>
+
+/* size of the description of the compression of \a raw bytes of data */
+static inline int obd_compr_size(unsigned int raw)
+{
+	return sizeof(struct ost_compr) +
+	       DIV_ROUND_UP(raw, OBD_COMPR_CHUNK_SIZE) * sizeof(__u32);
+}
+
+const char *obd_compr_name(enum obd_compr_type type);
+int obd_compr_parse(const char *name);
+int obd_compr_prepare(enum obd_compr_type type);
+void obd_compr_swab(struct ost_compr *oc, int size);
+int obd_compr_check(const struct ost_compr *oc, int size);
+int obd_compress(enum obd_compr_type type, lnet_kiov_t *src, int nsrc,
+		 lnet_kiov_t *dst, int ndst, struct ost_compr *oc);
+int obd_decompress(const struct ost_compr *oc, lnet_kiov_t *src, int nsrc,
+		   lnet_kiov_t *dst, int ndst);
+void obd_compr_release(lnet_kiov_t *kiov, int nr);
+int obd_compr_init(void);
+void obd_compr_fini(void);
+
+#endif /* __OBD_COMPR_H */
@@ -139,6 +139,10 @@ extern char obd_jobid_var[];
 #define OBD_IR_FACTOR_MIN         1
 #define OBD_IR_FACTOR_MAX         10
 #define OBD_IR_FACTOR_DEFAULT    (OBD_IR_FACTOR_MAX/2)
+/* connects handled by a target at once before clients are told to back off */
+#define OBD_CONN_LIMIT_DEFAULT    32
+/* exports per second of the default reconnect window */
+#define OBD_CONN_WINDOW_EXPORTS   1024
 /* default timeout for the MGS to become IR_FULL */
 #define OBD_IR_MGS_TIMEOUT       (4*obd_timeout)
 #define LONG_UNLINK 300          /* Unlink should happen before now */
@@ -254,6 +258,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_MDS_RMFID_NET		 0x166
 #define OBD_FAIL_MDS_REINT_OPEN		 0x169
 #define OBD_FAIL_MDS_REINT_OPEN2	 0x16a
+#define OBD_FAIL_MDS_BATCH_NET		 0x16b
 
 /* layout lock */
 #define OBD_FAIL_MDS_NO_LL_GETATTR	 0x170
@@ -946,6 +951,34 @@ do {                                                                          \
 #define OBD_SLAB_FREE_PTR(ptr, slab)					      \
 	OBD_SLAB_FREE((ptr), (slab), sizeof *(ptr))
 
+/* objects cached in per-CPT magazines, see cfs_mag_cache_create() */
+#define OBD_MAG_ALLOC_GFP(ptr, mag, size, flags)			      \
+do {									      \
+	LASSERT(ergo((flags) != GFP_ATOMIC, !in_interrupt()));		      \
+	(ptr) = cfs_mag_cache_alloc(mag, (flags) | __GFP_ZERO);		      \
+	if (likely((ptr)))						      \
+		OBD_ALLOC_POST(ptr, size, "mag-alloced");		      \
+} while (0)
+
+#define OBD_MAG_ALLOC(ptr, mag, size)					      \
+	OBD_MAG_ALLOC_GFP(ptr, mag, size, GFP_NOFS)
+
+#define OBD_MAG_FREE(ptr, mag, size)					      \
+do {									      \
+	OBD_FREE_PRE(ptr, size, "mag-freed");				      \
+	cfs_mag_cache_free(mag, ptr);					      \
+	POISON_PTR(ptr);						      \
+} while (0)
+
+#define OBD_MAG_ALLOC_PTR_GFP(ptr, mag, flags)				      \
+	OBD_MAG_ALLOC_GFP(ptr, mag, sizeof(*(ptr)), flags)
+
+#define OBD_MAG_ALLOC_PTR(ptr, mag)					      \
+	OBD_MAG_ALLOC_PTR_GFP(ptr, mag, GFP_NOFS)
+
+#define OBD_MAG_FREE_PTR(ptr, mag)					      \
+	OBD_MAG_FREE(ptr, mag, sizeof(*(ptr)))
+
 #define KEY_IS(str) \
         (keylen >= (sizeof(str)-1) && memcmp(key, str, (sizeof(str)-1)) == 0)
 
@@ -837,6 +837,15 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_ENCRYPT		0x8000ULL /* client-to-disk encrypt */
 #define OBD_CONNECT2_FIDMAP	       0x10000ULL /* FID map */
 #define OBD_CONNECT2_GETATTR_PFID      0x20000ULL /* pack parent FID in getattr */
+#define OBD_CONNECT2_BATCH_RPC	      0x400000ULL /* Multi-op batched RPCs */
+#define OBD_CONNECT2_SHARED_PING      0x800000ULL /* pings shared per node */
+#define OBD_CONNECT2_BL_AST_BATCH    0x1000000ULL /* batched blocking ASTs */
+#define OBD_CONNECT2_T10_GUARDS      0x2000000ULL /* per-sector BRW guards */
+#define OBD_CONNECT2_COMPRESS	     0x4000000ULL /* compressed BRW bulks */
+#define OBD_CONNECT2_STRICT_SOM	     0x8000000ULL /* strict SOM of closed files */
+#define OBD_CONNECT2_DOM_READ_HEAD  0x10000000ULL /* DoM file head on open */
+#define OBD_CONNECT2_BATCH_SYNC     0x20000000ULL /* OSP sync changes batched */
+#define OBD_CONNECT2_CONN_WINDOW    0x40000000ULL /* reconnect window/backoff */
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -894,7 +903,13 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_SELINUX_POLICY | \
 				OBD_CONNECT2_LSOM | \
 				OBD_CONNECT2_ASYNC_DISCARD | \
-				OBD_CONNECT2_GETATTR_PFID)
+				OBD_CONNECT2_GETATTR_PFID | \
+				OBD_CONNECT2_BATCH_RPC | \
+				OBD_CONNECT2_SHARED_PING | \
+				OBD_CONNECT2_BL_AST_BATCH | \
+				OBD_CONNECT2_STRICT_SOM | \
+				OBD_CONNECT2_DOM_READ_HEAD | \
+				OBD_CONNECT2_CONN_WINDOW)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -915,7 +930,14 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_GRANT_PARAM | \
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
-#define OST_CONNECT_SUPPORTED2 OBD_CONNECT2_LOCKAHEAD
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | \
+				OBD_CONNECT2_SHARED_PING | \
+				OBD_CONNECT2_BL_AST_BATCH | \
+				OBD_CONNECT2_T10_GUARDS | \
+				OBD_CONNECT2_COMPRESS | \
+				OBD_CONNECT2_BATCH_RPC | \
+				OBD_CONNECT2_BATCH_SYNC | \
+				OBD_CONNECT2_CONN_WINDOW)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -959,7 +981,7 @@ struct obd_connect_data {
          * may result in out-of-bound memory access and kernel oops. */
 	__u16 ocd_maxmodrpcs;    /* Maximum modify RPCs in parallel */
 	__u16 padding0;          /* added 2.1.0. also fix lustre_swab_connect */
-	__u32 padding1;          /* added 2.1.0. also fix lustre_swab_connect */
+	__u32 ocd_conn_window;	 /* seconds to spread reconnects/retry over */
 	__u64 ocd_connect_flags2;
         __u64 padding3;          /* added 2.1.0. also fix lustre_swab_connect */
         __u64 padding4;          /* added 2.1.0. also fix lustre_swab_connect */
@@ -1079,6 +1101,8 @@ enum obdo_flags {
         OBD_FL_NOSPC_BLK    = 0x00100000, /* no more block space on OST */
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
+	OBD_FL_GRANT_RECALL = 0x00800000, /* server asks to shrink grant */
+	OBD_FL_SOFT_SYNC    = 0x01000000, /* start commit, do not wait */
 	/* OBD_FL_LOCAL_MASK = 0xF0000000, was local-only flags until 2.10 */
 
 	/*
@@ -1641,6 +1665,7 @@ enum mds_cmd {
 	MDS_HSM_CT_UNREGISTER	= 60,
 	MDS_SWAP_LAYOUTS	= 61,
 	MDS_RMFID		= 62,
+	MDS_BATCH		= 63,
 	MDS_LAST_OPC
 };
 
@@ -1873,6 +1898,18 @@ struct mdt_ioepoch {
 	__u32 mio_padding;
 };
 
+#define BATCH_MAGIC	0xBADC0001
+/*
+ * Header of MDS_BATCH requests and replies. It is followed in RMF_BATCH_BUF
+ * by bb_count complete lustre_msg, each one padded to 8 bytes, which are the
+ * sub-requests to handle or the replies to them, in the same order.
+ */
+struct batch_body {
+	__u32	bb_magic;
+	__u32	bb_count;
+	__u64	bb_padding;
+};
+
 /* permissions for md_perm.mp_perm */
 enum {
         CFS_SETUID_PERM = 0x01,
@@ -1962,7 +1999,11 @@ enum mds_op_bias {
 	MDS_CLOSE_RESYNC_DONE	= 1 << 16,
 	MDS_CLOSE_LAYOUT_SPLIT	= 1 << 17,
 	MDS_TRUNC_KEEP_LEASE	= 1 << 18,
+	/* last close of a writer, with the size of the flushed file */
+	MDS_CLOSE_STRICT_SOM	= 1 << 19,
 	MDS_CLOSE_UPDATE_TIMES	= 1 << 20,
+	/* HSM release, the client cache keeping the archive of the file */
+	MDS_PCC_ATTACH		= 1 << 21,
 };
 
 #define MDS_CLOSE_INTENT (MDS_HSM_RELEASE | MDS_CLOSE_LAYOUT_SWAP |         \
@@ -3148,6 +3189,28 @@ struct ost_body {
 	struct obdo oa;
 };
 
+/* algorithms the bulk data of OST_READ and OST_WRITE can be compressed with */
+enum obd_compr_type {
+	OBD_COMPR_NONE		= 0,
+	OBD_COMPR_LZ4		= 1,
+	OBD_COMPR_ZSTD		= 2,
+	OBD_COMPR_DEFLATE	= 3,
+	OBD_COMPR_LZO		= 4,
+};
+
+/* the data is compressed in chunks of this size, each one on its own */
+#define OBD_COMPR_CHUNK_SIZE	65536
+
+/* description of the compressed bulk data of a BRW, see RMF_OST_COMPR */
+struct ost_compr {
+	__u32	oc_type;	/* enum obd_compr_type */
+	__u32	oc_raw;		/* bytes of data before compression */
+	__u32	oc_count;	/* # of chunks */
+	__u32	oc_padding;
+	__u32	oc_lens[0];	/* compressed size of each chunk, its raw size
+				 * if the chunk is sent uncompressed */
+};
+
 /* Key for FIEMAP to be used in get_info calls */
 struct ll_fiemap_info_key {
 	char		lfik_name[8];
@@ -3545,6 +3608,8 @@ struct close_data {
 		struct close_data_resync_done	cd_resync;
 		/* split close */
 		__u16				cd_mirror_id;
+		/* PCC attach */
+		__u32				cd_archive_id;
 	};
 };
 
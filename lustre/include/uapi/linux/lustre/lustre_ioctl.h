@@ -53,6 +53,33 @@ enum md_echo_cmd {
 	ECHO_MD_GETATTR		= 6, /* Getattr on MDT */
 	ECHO_MD_SETATTR		= 7, /* Setattr on MDT */
 	ECHO_MD_ALLOC_FID	= 8, /* Get FIDs from MDT */
+	ECHO_MD_RENAME		= 9, /* Rename on MDT */
+};
+
+#define ECHO_LOAD_LAT_BUCKETS	32
+
+/*
+ * Parameters and results of an echo client load run (OBD_IOC_ECHO_LOAD),
+ * passed through ioc_pbuf1. The objects used are elp_objects consecutive
+ * ids starting at the one in ioc_obdo1. Latencies are counted in log2
+ * buckets: bucket N holds I/Os that took [2^(N-1), 2^N) microseconds.
+ */
+struct echo_load_param {
+	__u64	elp_offset;		/* starting offset in each object */
+	__u64	elp_count;		/* bytes to transfer per object */
+	__u32	elp_objects;		/* number of objects */
+	__u32	elp_depth;		/* I/Os kept in flight */
+	__u32	elp_io_min;		/* smallest I/O size, bytes */
+	__u32	elp_io_max;		/* largest I/O size, bytes */
+	__u32	elp_read_pct;		/* percentage of I/Os that are reads */
+	__u32	elp_padding;
+	/* filled in by the echo client */
+	__u64	elp_ios;		/* I/Os completed */
+	__u64	elp_bytes_read;
+	__u64	elp_bytes_written;
+	__u64	elp_usec;		/* elapsed time of the whole run */
+	__u64	elp_lat_max;		/* slowest I/O, usec */
+	__u32	elp_lat[ECHO_LOAD_LAT_BUCKETS];
 };
 
 #define OBD_DEV_ID 1
@@ -228,10 +255,12 @@ static inline __u32 obd_ioctl_packlen(struct obd_ioctl_data *data)
 /* was #define OBD_IOC_GET_MNTOPT	_IOW('f', 220, mntopt_t) until 2.11 */
 #define OBD_IOC_ECHO_MD		_IOR('f', 221, struct obd_ioctl_data)
 #define OBD_IOC_ECHO_ALLOC_SEQ	_IOWR('f', 222, struct obd_ioctl_data)
+#define OBD_IOC_ECHO_LOAD	_IOWR('f', 223, struct obd_ioctl_data)
 #define OBD_IOC_START_LFSCK	_IOWR('f', 230, OBD_IOC_DATA_TYPE)
 #define OBD_IOC_STOP_LFSCK	_IOW('f', 231, OBD_IOC_DATA_TYPE)
 #define OBD_IOC_QUERY_LFSCK	_IOR('f', 232, struct obd_ioctl_data)
 #define OBD_IOC_CHLG_POLL	_IOR('f', 233, long)
+#define OBD_IOC_CHLG_FILTER	_IOW('f', 234, struct changelog_filter)
 /*	lustre/lustre_user.h	240-249 */
 /*	LIBCFS_IOC_DEBUG_MASK	250 */
 
@@ -163,6 +163,9 @@ enum lfsck_param_flags {
 
 	/* Delay to create OST-object for dangling LOV EA. */
 	LPF_DELAY_CREATE_OSTOBJ	= 0x0200,
+
+	/* Only check the objects changed since the last complete LFSCK. */
+	LPF_INCREMENTAL		= 0x0400,
 };
 
 enum lfsck_type {
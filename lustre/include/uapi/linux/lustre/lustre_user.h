@@ -290,9 +290,10 @@ struct obd_statfs {
 					/* used in QoS code to find preferred
 					 * OSTs */
 	__u32           os_granted;	/* space granted for MDS */
-	__u32           os_spare3;	/* Unused padding fields.  Remember */
-	__u32           os_spare4;	/* to fix lustre_swab_obd_statfs() */
-	__u32           os_spare5;
+	__u32		os_load;	/* bulk I/O in progress on the OST,
+					 * used in QoS code */
+	__u32           os_spare4;	/* Unused padding fields.  Remember */
+	__u32           os_spare5;	/* to fix lustre_swab_obd_statfs() */
 	__u32           os_spare6;
 	__u32           os_spare7;
 	__u32           os_spare8;
@@ -618,6 +619,8 @@ struct ll_ioc_lease_id {
 #define LL_IOC_FID2MDTIDX		_IOWR('f', 248, struct lu_fid)
 #define LL_IOC_GETPARENT		_IOWR('f', 249, struct getparent)
 #define LL_IOC_LADVISE			_IOR('f', 250, struct llapi_lu_ladvise)
+#define LL_IOC_PCC_ATTACH		_IOW('f', 251, struct lu_pcc_attach)
+#define LL_IOC_PCC_DETACH		_IO('f', 252)
 
 #ifndef	FS_IOC_FSGETXATTR
 /*
@@ -799,22 +802,29 @@ enum lov_comp_md_entry_flags {
 	LCME_FL_OFFLINE	= 0x00000008,	/* Not used */
 	LCME_FL_INIT	= 0x00000010,	/* instantiated */
 	LCME_FL_NOSYNC	= 0x00000020,	/* FLR: no sync for the mirror */
+	LCME_FL_EXTENSION = 0x00000040,	/* grown by lcme_extension_size on
+					 * write, never instantiated */
 	LCME_FL_NEG	= 0x80000000	/* used to indicate a negative flag,
 					   won't be stored on disk */
 };
 
 #define LCME_KNOWN_FLAGS	(LCME_FL_NEG | LCME_FL_INIT | LCME_FL_STALE | \
-				 LCME_FL_PREF_RW | LCME_FL_NOSYNC)
+				 LCME_FL_PREF_RW | LCME_FL_NOSYNC | \
+				 LCME_FL_EXTENSION)
 /* The flags can be set by users at mirror creation time. */
 #define LCME_USER_FLAGS		(LCME_FL_PREF_RW)
 
+/* The flags can be set by users at file creation time. */
+#define LCME_CREATE_FLAGS	(LCME_USER_FLAGS | LCME_FL_EXTENSION)
+
 /* The flags are for mirrors */
 #define LCME_MIRROR_FLAGS	(LCME_FL_NOSYNC)
 
 /* These flags have meaning when set in a default layout and will be inherited
  * from the default/template layout set on a directory.
  */
-#define LCME_TEMPLATE_FLAGS	(LCME_FL_PREF_RW | LCME_FL_NOSYNC)
+#define LCME_TEMPLATE_FLAGS	(LCME_FL_PREF_RW | LCME_FL_NOSYNC | \
+				 LCME_FL_EXTENSION)
 
 /* the highest bit in obdo::o_layout_version is used to mark if the file is
  * being resynced. */
@@ -842,9 +852,13 @@ struct lov_comp_md_entry_v1 {
 	__u32			lcme_size;      /* size of component blob */
 	__u32			lcme_layout_gen;
 	__u64			lcme_timestamp;	/* snapshot time if applicable*/
-	__u32			lcme_padding_1;
+	__u32			lcme_extension_size; /* in SEL_UNIT_SIZE, with
+						      * LCME_FL_EXTENSION */
 } __attribute__((packed));
 
+/* unit of lcme_extension_size */
+#define SEL_UNIT_SIZE		(64 * 1024)
+
 #define SEQ_ID_MAX		0x0000FFFF
 #define SEQ_ID_MASK		SEQ_ID_MAX
 /* bit 30:16 of lcme_id is used to store mirror id */
@@ -930,11 +944,13 @@ enum lmv_hash_type {
 	LMV_HASH_TYPE_UNKNOWN	= 0,	/* 0 is reserved for testing purpose */
 	LMV_HASH_TYPE_ALL_CHARS = 1,
 	LMV_HASH_TYPE_FNV_1A_64 = 2,
+	LMV_HASH_TYPE_CRUSH	= 3,	/* consistent hash over stripes */
 	LMV_HASH_TYPE_MAX,
 };
 
 #define LMV_HASH_NAME_ALL_CHARS	"all_char"
 #define LMV_HASH_NAME_FNV_1A_64	"fnv_1a_64"
+#define LMV_HASH_NAME_CRUSH	"crush"
 
 extern char *mdt_hash_name[LMV_HASH_TYPE_MAX];
 
@@ -1511,6 +1527,74 @@ struct changelog_rec {
 	struct lu_fid		cr_pfid;        /**< parent fid */
 };
 
+/*
+ * Filter applied by the changelog device to the records of one reader, see
+ * llapi_changelog_set_filter(). Each condition left to zero matches all the
+ * records.
+ */
+struct changelog_filter {
+	/* bitmask of the changelog_rec_type to return, by 1 << cr_type */
+	__u64			cf_type_mask;
+	/* return only the records whose target FID hashes into partition
+	 * cf_part_index of cf_part_count, for parallel readers of one user */
+	__u32			cf_part_count;
+	__u32			cf_part_index;
+	/* return only the records with this target or parent FID */
+	struct lu_fid		cf_fid;
+	/* return only the records of this job */
+	char			cf_jobid[LUSTRE_JOBID_SIZE];
+};
+
+/* Shared ring to receive changelog records in bulk, set up by mapping the
+ * changelog device read-write at offset 0.  The mapping is one page of
+ * struct changelog_ring then clr_size bytes of data, a power of two from
+ * CHANGELOG_RING_MIN to CHANGELOG_RING_MAX.
+ *
+ * The kernel appends struct changelog_ring_ent entries, 8 bytes aligned,
+ * and then moves clr_head forward; the reader consumes them from clr_tail
+ * and moves clr_tail forward.  Both only grow, the offset of an entry in
+ * the data is its position modulo clr_size.  An entry never wraps, a
+ * CRE_WRAP entry fills the end of the data instead.
+ *
+ * The kernel only checks for space freed by the reader when it polls the
+ * device, which it does when the ring is empty, and should do after
+ * consuming part of the ring.  CLR_EOF is set once all the records were
+ * put in the ring, clr_error when they cannot be read any further. */
+#define CHANGELOG_RING_MAGIC	0xCA8E1C60
+#define CHANGELOG_RING_MIN	(64 << 10)
+#define CHANGELOG_RING_MAX	(64 << 20)
+
+enum changelog_ring_flags {
+	CLR_EOF		= 0x0001,
+};
+
+struct changelog_ring {
+	__u32	clr_magic;
+	__u32	clr_flags;
+	__s32	clr_error;
+	__u32	clr_size;
+	/* offset of the data from the start of the mapping */
+	__u32	clr_data;
+	__u32	clr_padding1;
+	__u64	clr_padding2[5];
+	/* on their own cache lines, only written by the kernel */
+	__u64	clr_head;
+	__u64	clr_padding3[7];
+	/* and only written by the reader */
+	__u64	clr_tail;
+};
+
+enum changelog_ring_ent_flags {
+	CRE_WRAP	= 0x0001,
+};
+
+struct changelog_ring_ent {
+	/* length of the entry, with this header and the padding */
+	__u32			cre_len;
+	__u32			cre_flags;
+	struct changelog_rec	cre_rec[0];
+};
+
 /* Changelog extension for RENAME. */
 struct changelog_ext_rename {
 	struct lu_fid		cr_sfid;     /**< source fid, or zero */
@@ -2199,6 +2283,15 @@ struct hsm_user_import {
 	__u32		hui_archive_id;
 };
 
+/*
+ * Attach a file to the persistent client cache of the client, the cache copy
+ * being the HSM archive \a pcca_id of the file
+ */
+struct lu_pcc_attach {
+	__u32		pcca_id;
+	__u32		pcca_padding;
+};
+
 /* Copytool progress reporting */
 #define HP_FLAG_COMPLETED 0x01
 #define HP_FLAG_RETRY     0x02
@@ -45,23 +45,27 @@
 #define UC_CACHE_ACQUIRING      0x02
 #define UC_CACHE_INVALID        0x04
 #define UC_CACHE_EXPIRED        0x08
+#define UC_CACHE_PENDING        0x10	/* acquiring, upcall not issued yet */
 
 #define UC_CACHE_IS_NEW(i)          ((i)->ue_flags & UC_CACHE_NEW)
 #define UC_CACHE_IS_INVALID(i)      ((i)->ue_flags & UC_CACHE_INVALID)
 #define UC_CACHE_IS_ACQUIRING(i)    ((i)->ue_flags & UC_CACHE_ACQUIRING)
 #define UC_CACHE_IS_EXPIRED(i)      ((i)->ue_flags & UC_CACHE_EXPIRED)
+#define UC_CACHE_IS_PENDING(i)      ((i)->ue_flags & UC_CACHE_PENDING)
 #define UC_CACHE_IS_VALID(i)        ((i)->ue_flags == 0)
 
 #define UC_CACHE_SET_NEW(i)         ((i)->ue_flags |= UC_CACHE_NEW)
 #define UC_CACHE_SET_INVALID(i)     ((i)->ue_flags |= UC_CACHE_INVALID)
 #define UC_CACHE_SET_ACQUIRING(i)   ((i)->ue_flags |= UC_CACHE_ACQUIRING)
 #define UC_CACHE_SET_EXPIRED(i)     ((i)->ue_flags |= UC_CACHE_EXPIRED)
+#define UC_CACHE_SET_PENDING(i)     ((i)->ue_flags |= UC_CACHE_PENDING)
 #define UC_CACHE_SET_VALID(i)       ((i)->ue_flags = 0)
 
 #define UC_CACHE_CLEAR_NEW(i)       ((i)->ue_flags &= ~UC_CACHE_NEW)
 #define UC_CACHE_CLEAR_ACQUIRING(i) ((i)->ue_flags &= ~UC_CACHE_ACQUIRING)
 #define UC_CACHE_CLEAR_INVALID(i)   ((i)->ue_flags &= ~UC_CACHE_INVALID)
 #define UC_CACHE_CLEAR_EXPIRED(i)   ((i)->ue_flags &= ~UC_CACHE_EXPIRED)
+#define UC_CACHE_CLEAR_PENDING(i)   ((i)->ue_flags &= ~UC_CACHE_PENDING)
 
 struct upcall_cache_entry;
 
@@ -95,6 +99,10 @@ struct upcall_cache_entry {
 #define UC_CACHE_HASH_SIZE        (128)
 #define UC_CACHE_HASH_INDEX(id)   ((id) & (UC_CACHE_HASH_SIZE - 1))
 #define UC_CACHE_UPCALL_MAXPATH   (1024UL)
+/* most entries acquired by a single upcall, see uc_upcall_batch */
+#define UC_CACHE_UPCALL_BATCH     (32)
+/* a valid entry is refreshed ahead once in the last 1/N of its life */
+#define UC_CACHE_REFRESH_AHEAD    (4)
 
 struct upcall_cache;
 
@@ -110,6 +118,10 @@ struct upcall_cache_ops {
 					    __u64 key, void *args);
 	int             (*do_upcall)(struct upcall_cache *,
 				     struct upcall_cache_entry *);
+	/* optional, acquire several entries with a single upcall */
+	int             (*do_upcall_batch)(struct upcall_cache *,
+					   struct upcall_cache_entry **,
+					   int nr);
 	int             (*parse_downcall)(struct upcall_cache *,
 					  struct upcall_cache_entry *, void *);
 };
@@ -123,6 +135,10 @@ struct upcall_cache {
 	char			uc_upcall[UC_CACHE_UPCALL_MAXPATH];
 	time64_t		uc_acquire_expire;	/* seconds */
 	time64_t		uc_entry_expire;	/* seconds */
+	/* seconds a failed downcall is cached for, 0 not to cache it */
+	time64_t		uc_negative_expire;
+	/* most entries acquired by one do_upcall_batch() */
+	int			uc_upcall_batch;
 	struct upcall_cache_ops	*uc_ops;
 };
 
@@ -37,35 +37,17 @@
  * Author: Jay Xiong <jinshan.xiong@sun.com>
  */
 
+#include <linux/rbtree_augmented.h>
 #include <lustre_dlm.h>
 #include <interval_tree.h>
 
-enum {
-        INTERVAL_RED = 0,
-        INTERVAL_BLACK = 1
-};
-
-static inline int node_is_left_child(struct interval_node *node)
-{
-        LASSERT(node->in_parent != NULL);
-        return node == node->in_parent->in_left;
-}
-
-static inline int node_is_right_child(struct interval_node *node)
-{
-        LASSERT(node->in_parent != NULL);
-        return node == node->in_parent->in_right;
-}
-
-static inline int node_is_red(struct interval_node *node)
-{
-        return node->in_color == INTERVAL_RED;
-}
-
-static inline int node_is_black(struct interval_node *node)
-{
-        return node->in_color == INTERVAL_BLACK;
-}
+/*
+ * The tree is a Linux augmented rbtree: every node caches in in_max_high the
+ * highest end of the intervals of its subtree, which lets searches skip the
+ * subtrees ending before the extent they look for. The users keep the root
+ * node of their tree only, so an rb_root is built around it for the rbtree
+ * operations that may change it.
+ */
 
 static inline int extent_compare(struct interval_node_extent *e1,
                                  struct interval_node_extent *e2)
@@ -115,68 +97,108 @@ static inline __u64 max_u64(__u64 x, __u64 y)
         return x > y ? x : y;
 }
 
-static inline __u64 min_u64(__u64 x, __u64 y)
+static inline struct interval_node *rb2node(struct rb_node *rb)
 {
-        return x < y ? x : y;
+	return rb ? rb_entry(rb, struct interval_node, in_rb) : NULL;
 }
 
-#define interval_for_each(node, root)                   \
-for (node = interval_first(root); node != NULL;         \
-     node = interval_next(node))
+static inline struct interval_node *node_left(struct interval_node *node)
+{
+	return rb2node(node->in_rb.rb_left);
+}
 
-#define interval_for_each_reverse(node, root)           \
-for (node = interval_last(root); node != NULL;          \
-     node = interval_prev(node))
+static inline struct interval_node *node_right(struct interval_node *node)
+{
+	return rb2node(node->in_rb.rb_right);
+}
 
-static struct interval_node *interval_first(struct interval_node *node)
+static inline struct interval_node *node_parent(struct interval_node *node)
 {
-        ENTRY;
+	return rb2node(rb_parent(&node->in_rb));
+}
+
+static inline int node_is_left_child(struct interval_node *node)
+{
+	struct interval_node *parent = node_parent(node);
 
-        if (!node)
-                RETURN(NULL);
-        while (node->in_left)
-                node = node->in_left;
-        RETURN(node);
+	LASSERT(parent != NULL);
+	return node == node_left(parent);
 }
 
-static struct interval_node *interval_last(struct interval_node *node)
+static inline struct rb_root node2root(struct interval_node *root)
 {
-        ENTRY;
+	struct rb_root rbroot = { .rb_node = root ? &root->in_rb : NULL };
 
-        if (!node)
-                RETURN(NULL);
-        while (node->in_right)
-                node = node->in_right;
-        RETURN(node);
+	return rbroot;
 }
 
-static struct interval_node *interval_next(struct interval_node *node)
+static __u64 node_compute_max_high(struct interval_node *node)
 {
-        ENTRY;
+	__u64 max_high = interval_high(node);
 
-        if (!node)
-                RETURN(NULL);
-        if (node->in_right)
-                RETURN(interval_first(node->in_right));
-        while (node->in_parent && node_is_right_child(node))
-                node = node->in_parent;
-        RETURN(node->in_parent);
+	if (node->in_rb.rb_left)
+		max_high = max_u64(max_high, node_left(node)->in_max_high);
+	if (node->in_rb.rb_right)
+		max_high = max_u64(max_high, node_right(node)->in_max_high);
+
+	return max_high;
 }
 
-static struct interval_node *interval_prev(struct interval_node *node)
+static void interval_augment_propagate(struct rb_node *rb,
+				       struct rb_node *stop)
 {
-        ENTRY;
+	while (rb != stop) {
+		struct interval_node *node = rb2node(rb);
+		__u64 max_high = node_compute_max_high(node);
 
-        if (!node)
-                RETURN(NULL);
+		if (node->in_max_high == max_high)
+			break;
+		node->in_max_high = max_high;
+		rb = rb_parent(rb);
+	}
+}
+
+static void interval_augment_copy(struct rb_node *rb_old,
+				  struct rb_node *rb_new)
+{
+	rb2node(rb_new)->in_max_high = rb2node(rb_old)->in_max_high;
+}
+
+static void interval_augment_rotate(struct rb_node *rb_old,
+				    struct rb_node *rb_new)
+{
+	struct interval_node *old = rb2node(rb_old);
+
+	rb2node(rb_new)->in_max_high = old->in_max_high;
+	old->in_max_high = node_compute_max_high(old);
+}
+
+static const struct rb_augment_callbacks interval_augment = {
+	.propagate	= interval_augment_propagate,
+	.copy		= interval_augment_copy,
+	.rotate		= interval_augment_rotate,
+};
+
+#define interval_for_each(node, root)                   \
+for (node = interval_first(root); node != NULL;         \
+     node = rb2node(rb_next(&node->in_rb)))
+
+#define interval_for_each_reverse(node, root)           \
+for (node = interval_last(root); node != NULL;          \
+     node = rb2node(rb_prev(&node->in_rb)))
+
+static struct interval_node *interval_first(struct interval_node *node)
+{
+	struct rb_root rbroot = node2root(node);
 
-        if (node->in_left)
-                RETURN(interval_last(node->in_left));
+	return rb2node(rb_first(&rbroot));
+}
 
-        while (node->in_parent && node_is_left_child(node))
-                node = node->in_parent;
+static struct interval_node *interval_last(struct interval_node *node)
+{
+	struct rb_root rbroot = node2root(node);
 
-        RETURN(node->in_parent);
+	return rb2node(rb_last(&rbroot));
 }
 
 enum interval_iter interval_iterate(struct interval_node *root,
@@ -186,7 +208,7 @@ enum interval_iter interval_iterate(struct interval_node *root,
         struct interval_node *node;
         enum interval_iter rc = INTERVAL_ITER_CONT;
         ENTRY;
-        
+
         interval_for_each(node, root) {
                 rc = func(node, data);
                 if (rc == INTERVAL_ITER_STOP)
@@ -204,7 +226,7 @@ enum interval_iter interval_iterate_reverse(struct interval_node *root,
         struct interval_node *node;
         enum interval_iter rc = INTERVAL_ITER_CONT;
         ENTRY;
-        
+
         interval_for_each_reverse(node, root) {
                 rc = func(node, data);
                 if (rc == INTERVAL_ITER_STOP)
@@ -229,361 +251,77 @@ struct interval_node *interval_find(struct interval_node *root,
                 if (rc == 0)
                         break;
                 else if (rc < 0)
-                        walk = walk->in_left;
+                        walk = node_left(walk);
                 else
-                        walk = walk->in_right;
+                        walk = node_right(walk);
         }
 
         RETURN(walk);
 }
 EXPORT_SYMBOL(interval_find);
 
-static void __rotate_change_maxhigh(struct interval_node *node,
-                                    struct interval_node *rotate)
-{
-        __u64 left_max, right_max;
-
-        rotate->in_max_high = node->in_max_high;
-        left_max = node->in_left ? node->in_left->in_max_high : 0;
-        right_max = node->in_right ? node->in_right->in_max_high : 0;
-        node->in_max_high  = max_u64(interval_high(node),
-                                     max_u64(left_max,right_max));
-}
-
-/* The left rotation "pivots" around the link from node to node->right, and
- * - node will be linked to node->right's left child, and
- * - node->right's left child will be linked to node's right child.  */
-static void __rotate_left(struct interval_node *node,
-                          struct interval_node **root)
+static struct interval_node *__interval_insert(struct interval_node *node,
+					       struct interval_node **root,
+					       bool dup)
 {
-        struct interval_node *right = node->in_right;
-        struct interval_node *parent = node->in_parent;
-
-        node->in_right = right->in_left;
-        if (node->in_right)
-                right->in_left->in_parent = node;
-
-        right->in_left = node;
-        right->in_parent = parent;
-        if (parent) {
-                if (node_is_left_child(node))
-                        parent->in_left = right;
-                else
-                        parent->in_right = right;
-        } else {
-                *root = right;
-        }
-        node->in_parent = right;
-
-        /* update max_high for node and right */
-        __rotate_change_maxhigh(node, right);
-}
-
-/* The right rotation "pivots" around the link from node to node->left, and
- * - node will be linked to node->left's right child, and
- * - node->left's right child will be linked to node's left child.  */
-static void __rotate_right(struct interval_node *node,
-                           struct interval_node **root)
-{
-        struct interval_node *left = node->in_left;
-        struct interval_node *parent = node->in_parent;
-
-        node->in_left = left->in_right;
-        if (node->in_left)
-                left->in_right->in_parent = node;
-        left->in_right = node;
-
-        left->in_parent = parent;
-        if (parent) {
-                if (node_is_right_child(node))
-                        parent->in_right = left;
-                else
-                        parent->in_left = left;
-        } else {
-                *root = left;
-        }
-        node->in_parent = left;
-
-        /* update max_high for node and left */
-        __rotate_change_maxhigh(node, left);
-}
-
-#define interval_swap(a, b) do {                        \
-        struct interval_node *c = a; a = b; b = c;      \
-} while (0)
+	struct rb_root rbroot = node2root(*root);
+	struct rb_node **p = &rbroot.rb_node;
+	struct rb_node *rb_parent = NULL;
+	struct interval_node *parent;
+	ENTRY;
 
-/*
- * Operations INSERT and DELETE, when run on a tree with n keys, 
- * take O(logN) time.Because they modify the tree, the result 
- * may violate the red-black properties.To restore these properties, 
- * we must change the colors of some of the nodes in the tree 
- * and also change the pointer structure.
- */
-static void interval_insert_color(struct interval_node *node,
-                                  struct interval_node **root)
-{
-        struct interval_node *parent, *gparent;
-        ENTRY;
+	LASSERT(!interval_is_intree(node));
+	while (*p) {
+		rb_parent = *p;
+		parent = rb2node(rb_parent);
+		if (!dup && node_equal(parent, node))
+			RETURN(parent);
+
+		/* max_high field must be updated after each iteration */
+		if (parent->in_max_high < interval_high(node))
+			parent->in_max_high = interval_high(node);
+
+		if (node_compare(node, parent) < 0)
+			p = &rb_parent->rb_left;
+		else
+			p = &rb_parent->rb_right;
+	}
 
-        while ((parent = node->in_parent) && node_is_red(parent)) {
-                gparent = parent->in_parent;
-                /* Parent is RED, so gparent must not be NULL */
-                if (node_is_left_child(parent)) {
-                        struct interval_node *uncle;
-                        uncle = gparent->in_right;
-                        if (uncle && node_is_red(uncle)) {
-                                uncle->in_color = INTERVAL_BLACK;
-                                parent->in_color = INTERVAL_BLACK;
-                                gparent->in_color = INTERVAL_RED;
-                                node = gparent;
-                                continue;
-                        }
-
-                        if (parent->in_right == node) {
-                                __rotate_left(parent, root);
-                                interval_swap(node, parent);
-                        }
-
-                        parent->in_color = INTERVAL_BLACK;
-                        gparent->in_color = INTERVAL_RED;
-                        __rotate_right(gparent, root);
-                } else {
-                        struct interval_node *uncle;
-                        uncle = gparent->in_left;
-                        if (uncle && node_is_red(uncle)) {
-                                uncle->in_color = INTERVAL_BLACK;
-                                parent->in_color = INTERVAL_BLACK;
-                                gparent->in_color = INTERVAL_RED;
-                                node = gparent;
-                                continue;
-                        }
-
-                        if (node_is_left_child(node)) {
-                                __rotate_right(parent, root);
-                                interval_swap(node, parent);
-                        }
-
-                        parent->in_color = INTERVAL_BLACK;
-                        gparent->in_color = INTERVAL_RED;
-                        __rotate_left(gparent, root);
-                }
-        }
+	node->in_max_high = interval_high(node);
+	rb_link_node(&node->in_rb, rb_parent, p);
+	rb_insert_augmented(&node->in_rb, &rbroot, &interval_augment);
+	*root = rb2node(rbroot.rb_node);
+	node->in_intree = 1;
 
-        (*root)->in_color = INTERVAL_BLACK;
-        EXIT;
+	RETURN(NULL);
 }
 
 struct interval_node *interval_insert(struct interval_node *node,
-                                      struct interval_node **root)
-                     
+				      struct interval_node **root)
 {
-        struct interval_node **p, *parent = NULL;
-        ENTRY;
-
-        LASSERT(!interval_is_intree(node));
-        p = root;
-        while (*p) {
-                parent = *p;
-                if (node_equal(parent, node))
-                        RETURN(parent);
-
-                /* max_high field must be updated after each iteration */
-                if (parent->in_max_high < interval_high(node))
-                        parent->in_max_high = interval_high(node);
-
-                if (node_compare(node, parent) < 0)
-                        p = &parent->in_left;
-                else 
-                        p = &parent->in_right;
-        }
-
-        /* link node into the tree */
-        node->in_parent = parent;
-        node->in_color = INTERVAL_RED;
-        node->in_left = node->in_right = NULL;
-        *p = node;
-
-        interval_insert_color(node, root);
-        node->in_intree = 1;
-
-        RETURN(NULL);
+	return __interval_insert(node, root, false);
 }
 EXPORT_SYMBOL(interval_insert);
 
-static inline int node_is_black_or_0(struct interval_node *node)
-{
-        return !node || node_is_black(node);
-}
-
-static void interval_erase_color(struct interval_node *node,
-                                 struct interval_node *parent,
-                                 struct interval_node **root)
-{
-        struct interval_node *tmp;
-        ENTRY;
-
-        while (node_is_black_or_0(node) && node != *root) {
-                if (parent->in_left == node) {
-                        tmp = parent->in_right;
-                        if (node_is_red(tmp)) {
-                                tmp->in_color = INTERVAL_BLACK;
-                                parent->in_color = INTERVAL_RED;
-                                __rotate_left(parent, root);
-                                tmp = parent->in_right;
-                        }
-                        if (node_is_black_or_0(tmp->in_left) &&
-                            node_is_black_or_0(tmp->in_right)) {
-                                tmp->in_color = INTERVAL_RED;
-                                node = parent;
-                                parent = node->in_parent;
-                        } else {
-                                if (node_is_black_or_0(tmp->in_right)) {
-                                        struct interval_node *o_left;
-                                        if ((o_left = tmp->in_left))
-                                             o_left->in_color = INTERVAL_BLACK;
-                                        tmp->in_color = INTERVAL_RED;
-                                        __rotate_right(tmp, root);
-                                        tmp = parent->in_right;
-                                }
-                                tmp->in_color = parent->in_color;
-                                parent->in_color = INTERVAL_BLACK;
-                                if (tmp->in_right)
-                                    tmp->in_right->in_color = INTERVAL_BLACK;
-                                __rotate_left(parent, root);
-                                node = *root;
-                                break;
-                        }
-                } else {
-                        tmp = parent->in_left;
-                        if (node_is_red(tmp)) {
-                                tmp->in_color = INTERVAL_BLACK;
-                                parent->in_color = INTERVAL_RED;
-                                __rotate_right(parent, root);
-                                tmp = parent->in_left;
-                        }
-                        if (node_is_black_or_0(tmp->in_left) &&
-                            node_is_black_or_0(tmp->in_right)) {
-                                tmp->in_color = INTERVAL_RED;
-                                node = parent;
-                                parent = node->in_parent;
-                        } else {
-                                if (node_is_black_or_0(tmp->in_left)) {
-                                        struct interval_node *o_right;
-                                        if ((o_right = tmp->in_right))
-                                            o_right->in_color = INTERVAL_BLACK;
-                                        tmp->in_color = INTERVAL_RED;
-                                        __rotate_left(tmp, root);
-                                        tmp = parent->in_left;
-                                }
-                                tmp->in_color = parent->in_color;
-                                parent->in_color = INTERVAL_BLACK;
-                                if (tmp->in_left)
-                                        tmp->in_left->in_color = INTERVAL_BLACK;
-                                __rotate_right(parent, root);
-                                node = *root;
-                                break;
-                        }
-                }
-        }
-        if (node)
-                node->in_color = INTERVAL_BLACK;
-        EXIT;
-}
-
-/* 
- * if the @max_high value of @node is changed, this function traverse  a path 
- * from node  up to the root to update max_high for the whole tree.
- */
-static void update_maxhigh(struct interval_node *node,
-                           __u64  old_maxhigh)
+/* Insert @node even if the tree already has a node of the same extent. */
+void interval_insert_dup(struct interval_node *node,
+			 struct interval_node **root)
 {
-        __u64 left_max, right_max;
-        ENTRY;
-
-        while (node) {
-                left_max = node->in_left ? node->in_left->in_max_high : 0;
-                right_max = node->in_right ? node->in_right->in_max_high : 0;
-                node->in_max_high = max_u64(interval_high(node),
-                                            max_u64(left_max, right_max));
-
-                if (node->in_max_high >= old_maxhigh)
-                        break;
-                node = node->in_parent;
-        }
-        EXIT;
+	__interval_insert(node, root, true);
 }
+EXPORT_SYMBOL(interval_insert_dup);
 
 void interval_erase(struct interval_node *node,
-                    struct interval_node **root)
+		    struct interval_node **root)
 {
-        struct interval_node *child, *parent;
-        int color;
-        ENTRY;
-
-        LASSERT(interval_is_intree(node));
-        node->in_intree = 0;
-        if (!node->in_left) {
-                child = node->in_right;
-        } else if (!node->in_right) {
-                child = node->in_left;
-        } else { /* Both left and right child are not NULL */
-                struct interval_node *old = node;
-
-                node = interval_next(node);
-                child = node->in_right;
-                parent = node->in_parent;
-                color = node->in_color;
-
-                if (child)
-                        child->in_parent = parent;
-                if (parent == old)
-                        parent->in_right = child;
-                else
-                        parent->in_left = child;
-
-                node->in_color = old->in_color;
-                node->in_right = old->in_right;
-                node->in_left = old->in_left;
-                node->in_parent = old->in_parent;
-
-                if (old->in_parent) {
-                        if (node_is_left_child(old))
-                                old->in_parent->in_left = node;
-                        else
-                                old->in_parent->in_right = node;
-                } else {
-                        *root = node;
-                }
-
-                old->in_left->in_parent = node;
-                if (old->in_right)
-                        old->in_right->in_parent = node;
-                update_maxhigh(child ? : parent, node->in_max_high);
-                update_maxhigh(node, old->in_max_high);
-                if (parent == old)
-                         parent = node;
-                goto color;
-        }
-        parent = node->in_parent;
-        color = node->in_color;
-
-        if (child)
-                child->in_parent = parent;
-        if (parent) {
-                if (node_is_left_child(node))
-                        parent->in_left = child;
-                else
-                        parent->in_right = child;
-        } else {
-                *root = child;
-        }
-
-        update_maxhigh(child ? : parent, node->in_max_high);
+	struct rb_root rbroot = node2root(*root);
+	ENTRY;
 
-color:
-        if (color == INTERVAL_BLACK)
-                interval_erase_color(child, parent, root);
-        EXIT;
+	LASSERT(interval_is_intree(node));
+	node->in_intree = 0;
+	rb_erase_augmented(&node->in_rb, &rbroot, &interval_augment);
+	*root = rb2node(rbroot.rb_node);
+	EXIT;
 }
 EXPORT_SYMBOL(interval_erase);
 
@@ -604,12 +342,12 @@ static inline int interval_may_overlap(struct interval_node *node,
  *       if (node == NULL)
  *               return 0;
  *       if (ext->end < interval_low(node)) {
- *               interval_search(node->in_left, ext, func, data);
+ *               interval_search(node_left(node), ext, func, data);
  *       } else if (interval_may_overlap(node, ext)) {
  *               if (extent_overlapped(ext, &node->in_extent))
  *                       func(node, data);
- *               interval_search(node->in_left, ext, func, data);
- *               interval_search(node->in_right, ext, func, data);
+ *               interval_search(node_left(node), ext, func, data);
+ *               interval_search(node_right(node), ext, func, data);
  *       }
  *       return 0;
  * }
@@ -630,8 +368,8 @@ enum interval_iter interval_search(struct interval_node *node,
 
 	while (node) {
 		if (ext->end < interval_low(node)) {
-			if (node->in_left) {
-				node = node->in_left;
+			if (node_left(node)) {
+				node = node_left(node);
 				continue;
 			}
 		} else if (interval_may_overlap(node, ext)) {
@@ -641,30 +379,30 @@ enum interval_iter interval_search(struct interval_node *node,
 					break;
 			}
 
-			if (node->in_left) {
-				node = node->in_left;
+			if (node_left(node)) {
+				node = node_left(node);
 				continue;
 			}
-			if (node->in_right) {
-				node = node->in_right;
+			if (node_right(node)) {
+				node = node_right(node);
 				continue;
 			}
 		}
 
-		parent = node->in_parent;
+		parent = node_parent(node);
 		while (parent) {
 			if (node_is_left_child(node) &&
-			    parent->in_right) {
+			    node_right(parent)) {
 				/* If we ever got the left, it means that the
 				 * parent met ext->end<interval_low(parent), or
 				 * may_overlap(parent). If the former is true,
 				 * we needn't go back. So stop early and check
 				 * may_overlap(parent) after this loop.  */
-				node = parent->in_right;
+				node = node_right(parent);
 				break;
 			}
 			node = parent;
-			parent = parent->in_parent;
+			parent = node_parent(parent);
 		}
 		if (parent == NULL || !interval_may_overlap(parent, ext))
 			break;
@@ -674,21 +412,64 @@ enum interval_iter interval_search(struct interval_node *node,
 }
 EXPORT_SYMBOL(interval_search);
 
-static enum interval_iter interval_overlap_cb(struct interval_node *n,
-                                              void *args)
+/*
+ * Whether any interval of the tree overlaps @ext, found going down a single
+ * path: if the left subtree has an interval ending at or after ext->start and
+ * none of them overlaps @ext, neither does any interval of the right subtree,
+ * which all start after those.
+ */
+int interval_is_overlapped(struct interval_node *root,
+			   struct interval_node_extent *ext)
 {
-        *(int *)args = 1;
-        return INTERVAL_ITER_STOP;
+	struct interval_node *node = root;
+	struct interval_node *left;
+
+	while (node) {
+		if (extent_overlapped(ext, &node->in_extent))
+			return 1;
+
+		left = node_left(node);
+		if (left && left->in_max_high >= ext->start) {
+			node = left;
+		} else {
+			if (ext->end < interval_low(node))
+				return 0;
+			node = node_right(node);
+		}
+	}
+	return 0;
 }
+EXPORT_SYMBOL(interval_is_overlapped);
 
-int interval_is_overlapped(struct interval_node *root,
-                           struct interval_node_extent *ext)
+struct interval_count_args {
+	unsigned long	ica_count;
+	unsigned long	ica_limit;
+};
+
+static enum interval_iter interval_count_cb(struct interval_node *n,
+					    void *args)
 {
-        int has = 0;
-        (void)interval_search(root, ext, interval_overlap_cb, &has);
-        return has;
+	struct interval_count_args *ica = args;
+
+	if (++ica->ica_count >= ica->ica_limit)
+		return INTERVAL_ITER_STOP;
+	return INTERVAL_ITER_CONT;
 }
-EXPORT_SYMBOL(interval_is_overlapped);
+
+unsigned long interval_count(struct interval_node *root,
+			     struct interval_node_extent *ext,
+			     unsigned long limit)
+{
+	struct interval_count_args ica = { .ica_count = 0,
+					   .ica_limit = limit };
+
+	if (root == NULL || limit == 0)
+		return 0;
+
+	(void)interval_search(root, ext, interval_count_cb, &ica);
+	return ica.ica_count;
+}
+EXPORT_SYMBOL(interval_count);
 
 /* Don't expand to low. Expanding downwards is expensive, and meaningless to
  * some extents, because programs seldom do IO backward.
@@ -704,14 +485,14 @@ EXPORT_SYMBOL(interval_is_overlapped);
  *                res = max_u64(root->in_max_high + 1, res);
  *                return res;
  *        } else if (low < interval_low(root)) {
- *                interval_expand_low(root->in_left, low);
+ *                interval_expand_low(node_left(root), low);
  *                return res;
  *        }
  *
  *        if (interval_high(root) < low)
  *                res = max_u64(interval_high(root) + 1, res);
- *        interval_expand_low(root->in_left, low);
- *        interval_expand_low(root->in_right, low);
+ *        interval_expand_low(node_left(root), low);
+ *        interval_expand_low(node_right(root), low);
  *
  *        return res;
  * }
@@ -737,9 +518,9 @@ static inline __u64 interval_expand_high(struct interval_node *node, __u64 high)
                         
                 if (interval_low(node) > high) {
                         result = interval_low(node) - 1;
-                        node = node->in_left;
+                        node = node_left(node);
                 } else {
-                        node = node->in_right;
+                        node = node_right(node);
                 }
         }
 
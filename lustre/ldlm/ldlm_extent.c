@@ -989,12 +989,13 @@ void ldlm_interval_free(struct ldlm_interval *node)
         }
 }
 
-/* interval tree, for LDLM_EXTENT. */
+/* interval tree, for LDLM_EXTENT and LDLM_FLOCK. */
 void ldlm_interval_attach(struct ldlm_interval *n,
                           struct ldlm_lock *l)
 {
         LASSERT(l->l_tree_node == NULL);
-        LASSERT(l->l_resource->lr_type == LDLM_EXTENT);
+        LASSERT(l->l_resource->lr_type == LDLM_EXTENT ||
+		l->l_resource->lr_type == LDLM_FLOCK);
 
 	list_add_tail(&l->l_sl_policy, &n->li_group);
         l->l_tree_node = n;
@@ -1014,18 +1015,6 @@ struct ldlm_interval *ldlm_interval_detach(struct ldlm_lock *l)
 	return list_empty(&n->li_group) ? n : NULL;
 }
 
-static inline int ldlm_mode_to_index(enum ldlm_mode mode)
-{
-	int index;
-
-	LASSERT(mode != 0);
-	LASSERT(is_power_of_2(mode));
-	for (index = -1; mode != 0; index++, mode >>= 1)
-		/* do nothing */;
-	LASSERT(index < LCK_MODE_NUM);
-	return index;
-}
-
 int ldlm_extent_alloc_lock(struct ldlm_lock *lock)
 {
 	lock->l_tree_node = NULL;
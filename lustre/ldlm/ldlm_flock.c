@@ -63,17 +63,6 @@
 int ldlm_flock_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
                             void *data, int flag);
 
-/**
- * list_for_remaining_safe - iterate over the remaining entries in a list
- *              and safeguard against removal of a list entry.
- * \param pos   the &struct list_head to use as a loop counter. pos MUST
- *              have been initialized prior to using it in this macro.
- * \param n     another &struct list_head to use as temporary storage
- * \param head  the head for your list.
- */
-#define list_for_remaining_safe(pos, n, head) \
-        for (n = pos->next; pos != (head); pos = n, n = pos->next)
-
 static inline int
 ldlm_same_flock_owner(struct ldlm_lock *lock, struct ldlm_lock *new)
 {
@@ -91,6 +80,78 @@ ldlm_flocks_overlap(struct ldlm_lock *lock, struct ldlm_lock *new)
                 lock->l_policy_data.l_flock.start));
 }
 
+/*
+ * The granted flock locks are indexed by the interval trees of their resource,
+ * one per mode, so that the locks conflicting with a request and the locks of
+ * its owner it may have to be merged with are found without walking all the
+ * granted locks. As the extents of granted flock locks change when locks get
+ * merged or split, every lock has a tree node of its own, allocated with it.
+ */
+static inline struct ldlm_lock *ldlm_flock_node2lock(struct interval_node *n)
+{
+	struct ldlm_interval *node = to_ldlm_interval(n);
+
+	return list_entry(node->li_group.next, struct ldlm_lock, l_sl_policy);
+}
+
+int ldlm_flock_alloc_lock(struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node;
+
+	lock->l_tree_node = NULL;
+	OBD_SLAB_ALLOC_PTR_GFP(node, ldlm_interval_slab, GFP_NOFS);
+	if (node == NULL)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&node->li_group);
+	ldlm_interval_attach(node, lock);
+	return 0;
+}
+
+/* Must be called with the resource lock held */
+static void ldlm_flock_index_lock(struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval_tree *tree;
+	int rc;
+
+	LASSERT(node != NULL);
+	LASSERT(!interval_is_intree(&node->li_node));
+
+	tree = &lock->l_resource->lr_itree[ldlm_mode_to_index(
+						lock->l_granted_mode)];
+	rc = interval_set(&node->li_node, lock->l_policy_data.l_flock.start,
+			  lock->l_policy_data.l_flock.end);
+	LASSERT(!rc);
+
+	interval_insert_dup(&node->li_node, &tree->lit_root);
+	tree->lit_size++;
+}
+
+/** Remove flock lock \a lock from the interval tree it is in, if any. */
+void ldlm_flock_unlink_lock(struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval_tree *tree;
+
+	if (node == NULL || !interval_is_intree(&node->li_node))
+		return;
+
+	tree = &lock->l_resource->lr_itree[ldlm_mode_to_index(
+						lock->l_granted_mode)];
+	interval_erase(&node->li_node, &tree->lit_root);
+	tree->lit_size--;
+}
+
+/** Add granted flock lock \a lock to resource \a res. */
+void ldlm_flock_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock)
+{
+	/* the order of the granted list does not matter, the lookups go
+	 * through the interval trees */
+	ldlm_resource_add_lock(res, &res->lr_granted, lock);
+	ldlm_flock_index_lock(lock);
+}
+
 static inline void ldlm_flock_blocking_link(struct ldlm_lock *req,
 					    struct ldlm_lock *lock)
 {
@@ -136,7 +197,7 @@ ldlm_flock_destroy(struct ldlm_lock *lock, enum ldlm_mode mode, __u64 flags)
 	/* Safe to not lock here, since it should be empty anyway */
 	LASSERT(hlist_unhashed(&lock->l_exp_flock_hash));
 
-	list_del_init(&lock->l_res_link);
+	ldlm_resource_unlink_lock(lock);
 	if (flags == LDLM_FL_WAIT_NOREPROC) {
 		/* client side - set a flag to prevent sending a CANCEL */
 		lock->l_flags |= LDLM_FL_LOCAL_ONLY | LDLM_FL_CBPENDING;
@@ -263,6 +324,135 @@ static void ldlm_flock_cancel_on_deadlock(struct ldlm_lock *lock,
 	}
 }
 
+/* Whether \a req is recorded as blocked by the owner of \a lock */
+static inline bool
+ldlm_flock_blocked_by(struct ldlm_lock *req, struct ldlm_lock *lock)
+{
+	return !hlist_unhashed(&req->l_exp_flock_hash) &&
+	       req->l_policy_data.l_flock.blocking_owner ==
+	       lock->l_policy_data.l_flock.owner &&
+	       req->l_policy_data.l_flock.blocking_export == lock->l_export;
+}
+
+struct ldlm_flock_search_data {
+	struct ldlm_lock	*fsd_req;
+	/** first lock found conflicting with fsd_req */
+	struct ldlm_lock	*fsd_lock;
+	/** check all the conflicting locks for deadlocks */
+	bool			 fsd_check_all;
+	bool			 fsd_deadlock;
+	/** locks of the owner of fsd_req, linked through l_sl_mode */
+	struct list_head	*fsd_owner_locks;
+};
+
+static enum interval_iter ldlm_flock_conflict_cb(struct interval_node *n,
+						 void *args)
+{
+	struct ldlm_flock_search_data *data = args;
+	struct ldlm_lock *req = data->fsd_req;
+	struct ldlm_lock *lock = ldlm_flock_node2lock(n);
+
+	if (ldlm_same_flock_owner(lock, req))
+		return INTERVAL_ITER_CONT;
+
+	if (data->fsd_lock == NULL)
+		data->fsd_lock = lock;
+	if (!data->fsd_check_all)
+		return INTERVAL_ITER_STOP;
+
+	/* The deadlocks through the owner \a req was blocked by were checked
+	 * when it got blocked, only a lock granted since then can make one
+	 * that was not detected yet. */
+	if (!ldlm_flock_blocked_by(req, lock) && ldlm_flock_deadlock(req, lock)) {
+		data->fsd_deadlock = true;
+		return INTERVAL_ITER_STOP;
+	}
+	return INTERVAL_ITER_CONT;
+}
+
+/* Look for the granted locks conflicting with data->fsd_req */
+static void ldlm_flock_search_conflicts(struct ldlm_resource *res,
+					struct ldlm_flock_search_data *data)
+{
+	struct ldlm_lock *req = data->fsd_req;
+	struct interval_node_extent ext = {
+		.start	= req->l_policy_data.l_flock.start,
+		.end	= req->l_policy_data.l_flock.end,
+	};
+	int idx;
+
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		struct ldlm_interval_tree *tree = &res->lr_itree[idx];
+
+		/* locks are compatible, overlap doesn't matter */
+		if (tree->lit_root == NULL ||
+		    lockmode_compat(tree->lit_mode, req->l_req_mode))
+			continue;
+
+		if (interval_search(tree->lit_root, &ext,
+				    ldlm_flock_conflict_cb, data) ==
+		    INTERVAL_ITER_STOP)
+			break;
+	}
+}
+
+static enum interval_iter ldlm_flock_owner_cb(struct interval_node *n,
+					      void *args)
+{
+	struct ldlm_flock_search_data *data = args;
+	struct ldlm_lock *lock = ldlm_flock_node2lock(n);
+
+	if (ldlm_same_flock_owner(lock, data->fsd_req))
+		list_add_tail(&lock->l_sl_mode, data->fsd_owner_locks);
+	return INTERVAL_ITER_CONT;
+}
+
+/*
+ * Move the granted locks of the owner of \a req that overlap or adjoin it
+ * from the interval trees to \a owner_locks, since their extents may change
+ * while \a req gets granted.
+ */
+static void ldlm_flock_owner_locks_get(struct ldlm_resource *res,
+				       struct ldlm_lock *req,
+				       struct list_head *owner_locks)
+{
+	struct ldlm_flock *flock = &req->l_policy_data.l_flock;
+	struct ldlm_flock_search_data data = {
+		.fsd_req	 = req,
+		.fsd_owner_locks = owner_locks,
+	};
+	struct interval_node_extent ext = {
+		.start	= flock->start > 0 ? flock->start - 1 : 0,
+		.end	= flock->end < OBD_OBJECT_EOF ? flock->end + 1 :
+							OBD_OBJECT_EOF,
+	};
+	struct ldlm_lock *lock;
+	int idx;
+
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		struct ldlm_interval_tree *tree = &res->lr_itree[idx];
+
+		if (tree->lit_root != NULL)
+			interval_search(tree->lit_root, &ext,
+					ldlm_flock_owner_cb, &data);
+	}
+
+	list_for_each_entry(lock, owner_locks, l_sl_mode)
+		ldlm_flock_unlink_lock(lock);
+}
+
+/* Put the locks left on \a owner_locks back into the interval trees */
+static void ldlm_flock_owner_locks_put(struct list_head *owner_locks)
+{
+	struct ldlm_lock *lock;
+	struct ldlm_lock *next;
+
+	list_for_each_entry_safe(lock, next, owner_locks, l_sl_mode) {
+		list_del_init(&lock->l_sl_mode);
+		ldlm_flock_index_lock(lock);
+	}
+}
+
 /**
  * Process a granting attempt for flock lock.
  * Must be called under ns lock held.
@@ -278,9 +468,9 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 {
 	struct ldlm_resource *res = req->l_resource;
 	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
-	struct list_head *tmp;
-	struct list_head *ownlocks = NULL;
+	struct list_head ownlocks;
 	struct ldlm_lock *lock = NULL;
+	struct ldlm_lock *next;
 	struct ldlm_lock *new = req;
 	struct ldlm_lock *new2 = NULL;
 	enum ldlm_mode mode = req->l_req_mode;
@@ -293,6 +483,7 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
 							NULL : work_list;
 	ENTRY;
 
+	INIT_LIST_HEAD(&ownlocks);
 	CDEBUG(D_DLMTRACE, "flags %#llx owner %llu pid %u mode %u start "
 	       "%llu end %llu\n", *flags,
 	       new->l_policy_data.l_flock.owner,
@@ -312,68 +503,44 @@ ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
         }
 
 reprocess:
-        if ((*flags == LDLM_FL_WAIT_NOREPROC) || (mode == LCK_NL)) {
-                /* This loop determines where this processes locks start
-                 * in the resource lr_granted list. */
-		list_for_each(tmp, &res->lr_granted) {
-			lock = list_entry(tmp, struct ldlm_lock,
-                                              l_res_link);
-                        if (ldlm_same_flock_owner(lock, req)) {
-                                ownlocks = tmp;
-                                break;
-                        }
-                }
-        } else {
-		int reprocess_failed = 0;
-                lockmode_verify(mode);
-
-                /* This loop determines if there are existing locks
-                 * that conflict with the new lock request. */
-		list_for_each(tmp, &res->lr_granted) {
-			lock = list_entry(tmp, struct ldlm_lock,
-                                              l_res_link);
-
-                        if (ldlm_same_flock_owner(lock, req)) {
-                                if (!ownlocks)
-                                        ownlocks = tmp;
-                                continue;
-                        }
-
-                        /* locks are compatible, overlap doesn't matter */
-                        if (lockmode_compat(lock->l_granted_mode, mode))
-                                continue;
-
-                        if (!ldlm_flocks_overlap(lock, req))
-                                continue;
-
+	if ((*flags != LDLM_FL_WAIT_NOREPROC) && (mode != LCK_NL)) {
+		struct ldlm_flock_search_data data = {
+			.fsd_req = req,
+			.fsd_check_all = intention != LDLM_PROCESS_ENQUEUE,
+		};
+
+		lockmode_verify(mode);
+
+		/* This determines if there are existing locks
+		 * that conflict with the new lock request. */
+		ldlm_flock_search_conflicts(res, &data);
+		lock = data.fsd_lock;
+		if (lock != NULL) {
 			if (intention != LDLM_PROCESS_ENQUEUE) {
-				reprocess_failed = 1;
-				if (ldlm_flock_deadlock(req, lock)) {
+				if (data.fsd_deadlock)
 					ldlm_flock_cancel_on_deadlock(req,
 							grant_work);
-					RETURN(LDLM_ITER_CONTINUE);
-				}
-				continue;
+				RETURN(LDLM_ITER_CONTINUE);
 			}
 
-                        if (*flags & LDLM_FL_BLOCK_NOWAIT) {
-                                ldlm_flock_destroy(req, mode, *flags);
-                                *err = -EAGAIN;
-                                RETURN(LDLM_ITER_STOP);
-                        }
+			if (*flags & LDLM_FL_BLOCK_NOWAIT) {
+				ldlm_flock_destroy(req, mode, *flags);
+				*err = -EAGAIN;
+				RETURN(LDLM_ITER_STOP);
+			}
 
-                        if (*flags & LDLM_FL_TEST_LOCK) {
-                                ldlm_flock_destroy(req, mode, *flags);
-                                req->l_req_mode = lock->l_granted_mode;
-                                req->l_policy_data.l_flock.pid =
-                                        lock->l_policy_data.l_flock.pid;
-                                req->l_policy_data.l_flock.start =
-                                        lock->l_policy_data.l_flock.start;
-                                req->l_policy_data.l_flock.end =
-                                        lock->l_policy_data.l_flock.end;
-                                *flags |= LDLM_FL_LOCK_CHANGED;
-                                RETURN(LDLM_ITER_STOP);
-                        }
+			if (*flags & LDLM_FL_TEST_LOCK) {
+				ldlm_flock_destroy(req, mode, *flags);
+				req->l_req_mode = lock->l_granted_mode;
+				req->l_policy_data.l_flock.pid =
+					lock->l_policy_data.l_flock.pid;
+				req->l_policy_data.l_flock.start =
+					lock->l_policy_data.l_flock.start;
+				req->l_policy_data.l_flock.end =
+					lock->l_policy_data.l_flock.end;
+				*flags |= LDLM_FL_LOCK_CHANGED;
+				RETURN(LDLM_ITER_STOP);
+			}
 
 			/* add lock to blocking list before deadlock
 			 * check to prevent race */
@@ -386,13 +553,11 @@ reprocess:
 				RETURN(LDLM_ITER_STOP);
 			}
 
-                        ldlm_resource_add_lock(res, &res->lr_waiting, req);
-                        *flags |= LDLM_FL_BLOCK_GRANTED;
-                        RETURN(LDLM_ITER_STOP);
-                }
-		if (reprocess_failed)
-			RETURN(LDLM_ITER_CONTINUE);
-        }
+			ldlm_resource_add_lock(res, &res->lr_waiting, req);
+			*flags |= LDLM_FL_BLOCK_GRANTED;
+			RETURN(LDLM_ITER_STOP);
+		}
+	}
 
         if (*flags & LDLM_FL_TEST_LOCK) {
                 ldlm_flock_destroy(req, mode, *flags);
@@ -405,18 +570,12 @@ reprocess:
 	 * deadlock detection hash list. */
         ldlm_flock_blocking_unlink(req);
 
-        /* Scan the locks owned by this process that overlap this request.
-         * We may have to merge or split existing locks. */
-
-        if (!ownlocks)
-                ownlocks = &res->lr_granted;
-
-        list_for_remaining_safe(ownlocks, tmp, &res->lr_granted) {
-		lock = list_entry(ownlocks, struct ldlm_lock, l_res_link);
-
-                if (!ldlm_same_flock_owner(lock, new))
-                        break;
-
+	/* Scan the locks owned by this process that overlap or adjoin this
+	 * request. We may have to merge or split existing locks. They do not
+	 * overlap each other and the locks of the same mode do not adjoin, so
+	 * the order they are processed in does not matter. */
+	ldlm_flock_owner_locks_get(res, req, &ownlocks);
+	list_for_each_entry_safe(lock, next, &ownlocks, l_sl_mode) {
                 if (lock->l_granted_mode == mode) {
                         /* If the modes are the same then we need to process
                          * locks that overlap OR adjoin the new lock. The extra
@@ -431,7 +590,7 @@ reprocess:
                         if ((new->l_policy_data.l_flock.end <
                              (lock->l_policy_data.l_flock.start - 1))
                             && (lock->l_policy_data.l_flock.start != 0))
-                                break;
+				continue;
 
                         if (new->l_policy_data.l_flock.start <
                             lock->l_policy_data.l_flock.start) {
@@ -452,6 +611,7 @@ reprocess:
                         }
 
                         if (added) {
+				list_del_init(&lock->l_sl_mode);
                                 ldlm_flock_destroy(lock, mode, *flags);
                         } else {
                                 new = lock;
@@ -466,7 +626,7 @@ reprocess:
 
                 if (new->l_policy_data.l_flock.end <
                     lock->l_policy_data.l_flock.start)
-                        break;
+			continue;
 
                 ++overlaps;
 
@@ -476,8 +636,9 @@ reprocess:
                             lock->l_policy_data.l_flock.end) {
                                 lock->l_policy_data.l_flock.start =
                                         new->l_policy_data.l_flock.end + 1;
-                                break;
+				continue;
                         }
+			list_del_init(&lock->l_sl_mode);
                         ldlm_flock_destroy(lock, lock->l_req_mode, *flags);
                         continue;
                 }
@@ -501,6 +662,7 @@ reprocess:
                  * release the lr_lock, allocate the new lock,
                  * and restart processing this lock. */
 		if (new2 == NULL) {
+			ldlm_flock_owner_locks_put(&ownlocks);
 			unlock_res_and_lock(req);
 			new2 = ldlm_lock_create(ns, &res->lr_name, LDLM_FLOCK,
 						lock->l_granted_mode, &null_cbs,
@@ -541,11 +703,11 @@ reprocess:
                         ldlm_lock_addref_internal_nolock(new2,
                                                          lock->l_granted_mode);
 
-                /* insert new2 at lock */
-                ldlm_resource_add_lock(res, ownlocks, new2);
+		ldlm_flock_add_lock(res, new2);
                 LDLM_LOCK_RELEASE(new2);
                 break;
         }
+	ldlm_flock_owner_locks_put(&ownlocks);
 
         /* if new2 is created but never used, destroy it*/
         if (splitted == 0 && new2 != NULL)
@@ -556,9 +718,8 @@ reprocess:
 
         /* Add req to the granted queue before calling ldlm_reprocess_all(). */
         if (!added) {
-		list_del_init(&req->l_res_link);
-                /* insert new lock before ownlocks in list. */
-                ldlm_resource_add_lock(res, ownlocks, req);
+		ldlm_resource_unlink_lock(req);
+		ldlm_flock_add_lock(res, req);
         }
 
         if (*flags != LDLM_FL_WAIT_NOREPROC) {
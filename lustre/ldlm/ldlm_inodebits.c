@@ -430,8 +430,8 @@ EXPORT_SYMBOL(ldlm_inodebits_drop);
 int ldlm_cli_inodebits_convert(struct ldlm_lock *lock,
 			       enum ldlm_cancel_flags cancel_flags)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
 	struct ldlm_lock_desc ld = { { 0 } };
+	struct ldlm_lru *lru;
 	__u64 drop_bits, new_bits;
 	__u32 flags = 0;
 	int rc;
@@ -510,10 +510,11 @@ int ldlm_cli_inodebits_convert(struct ldlm_lock *lock,
 	 */
 	ldlm_clear_cbpending(lock);
 	ldlm_clear_bl_ast(lock);
-	spin_lock(&ns->ns_lock);
+	lru = ldlm_lock_lru(lock);
+	spin_lock(&lru->ll_lock);
 	if (list_empty(&lock->l_lru))
 		ldlm_lock_add_to_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 
 	/* the job is done, zero the cancel_bits. If more conflicts appear,
 	 * it will result in another cycle of ldlm_cli_inodebits_convert().
@@ -366,12 +366,15 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	/* cl_dirty_max_pages may be changed at connect time in
 	 * ptlrpc_connect_interpret(). */
 	client_adjust_max_dirty(cli);
-	init_waitqueue_head(&cli->cl_cache_waiters);
+	INIT_LIST_HEAD(&cli->cl_cache_waiters);
+	INIT_LIST_HEAD(&cli->cl_cache_jobs);
 	INIT_LIST_HEAD(&cli->cl_loi_ready_list);
 	INIT_LIST_HEAD(&cli->cl_loi_hp_ready_list);
 	INIT_LIST_HEAD(&cli->cl_loi_write_list);
 	INIT_LIST_HEAD(&cli->cl_loi_read_list);
 	spin_lock_init(&cli->cl_loi_list_lock);
+	spin_lock_init(&cli->cl_batch_lock);
+	INIT_LIST_HEAD(&cli->cl_batch_list);
 	atomic_set(&cli->cl_pending_w_pages, 0);
 	atomic_set(&cli->cl_pending_r_pages, 0);
 	cli->cl_r_in_flight = 0;
@@ -383,15 +386,16 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	spin_lock_init(&cli->cl_write_page_hist.oh_lock);
 	spin_lock_init(&cli->cl_read_offset_hist.oh_lock);
 	spin_lock_init(&cli->cl_write_offset_hist.oh_lock);
+	spin_lock_init(&cli->cl_read_fullness_hist.oh_lock);
+	spin_lock_init(&cli->cl_write_fullness_hist.oh_lock);
 
 	/* lru for osc. */
 	INIT_LIST_HEAD(&cli->cl_lru_osc);
 	atomic_set(&cli->cl_lru_shrinkers, 0);
 	atomic_long_set(&cli->cl_lru_busy, 0);
 	atomic_long_set(&cli->cl_lru_in_list, 0);
-	INIT_LIST_HEAD(&cli->cl_lru_list);
-	spin_lock_init(&cli->cl_lru_list_lock);
 	atomic_long_set(&cli->cl_unstable_count, 0);
+	atomic_set(&cli->cl_soft_sync_pending, 0);
 	INIT_LIST_HEAD(&cli->cl_shrink_list);
 	INIT_LIST_HEAD(&cli->cl_grant_chain);
 
@@ -419,6 +423,7 @@ int client_obd_setup(struct obd_device *obddev, struct lustre_cfg *lcfg)
 	cli->cl_max_pages_per_rpc = PTLRPC_MAX_BRW_PAGES;
 
 	cli->cl_max_short_io_bytes = OBD_MAX_SHORT_IO_BYTES;
+	cli->cl_writeback_deadline = OSC_DEFAULT_WRITEBACK_DEADLINE;
 
 	/* set cl_chunkbits default value to PAGE_SHIFT,
 	 * it will be updated at OSC connection time. */
@@ -978,6 +983,61 @@ static int rev_import_reconnect(struct obd_export *exp,
 	return ptlrpc_import_recovery_state_machine(revimp);
 }
 
+/**
+ * Window in seconds over which the clients of \a target spread their
+ * reconnects, or wait before retrying a connect refused for load.  Unless
+ * set with connect_window, this is one second per OBD_CONN_WINDOW_EXPORTS
+ * exports, and it is kept within a quarter of the recovery window so that
+ * the clients still all get into recovery in time.
+ */
+static __u32 target_conn_window(struct obd_device *target)
+{
+	__u32 window = target->obd_conn_window;
+
+	if (window == 0)
+		window = target->obd_num_exports / OBD_CONN_WINDOW_EXPORTS;
+
+	return min_t(__u32, window, target->obd_recovery_timeout / 4);
+}
+
+/**
+ * Refuse a connect with -EBUSY when connect_limit connects are already
+ * being handled, and tell the client how long to back off in the reply.
+ * Only clients that understand the hint are refused.
+ */
+static int target_conn_admit(struct obd_device *target,
+			     struct ptlrpc_request *req,
+			     struct obd_connect_data *data)
+{
+	struct obd_connect_data *reply;
+	int inprogress;
+
+	if (!(data->ocd_connect_flags & OBD_CONNECT_FLAGS2) ||
+	    !(data->ocd_connect_flags2 & OBD_CONNECT2_CONN_WINDOW) ||
+	    target->obd_conn_limit == 0)
+		return 0;
+
+	spin_lock(&target->obd_dev_lock);
+	inprogress = target->obd_conn_inprogress;
+	spin_unlock(&target->obd_dev_lock);
+	if (inprogress <= target->obd_conn_limit)
+		return 0;
+
+	reply = req_capsule_server_get(&req->rq_pill, &RMF_CONNECT_DATA);
+	if (reply != NULL) {
+		reply->ocd_connect_flags = OBD_CONNECT_FLAGS2;
+		reply->ocd_connect_flags2 = OBD_CONNECT2_CONN_WINDOW;
+		reply->ocd_conn_window = max_t(__u32, 1,
+					       target_conn_window(target));
+	}
+
+	CDEBUG(D_HA, "%s: %d connects in progress, client %s asked to retry in %us\n",
+	       target->obd_name, inprogress, libcfs_nid2str(req->rq_peer.nid),
+	       reply != NULL ? reply->ocd_conn_window : 0);
+
+	return -EBUSY;
+}
+
 int target_handle_connect(struct ptlrpc_request *req)
 {
 	struct obd_device *target = NULL;
@@ -994,6 +1054,7 @@ int target_handle_connect(struct ptlrpc_request *req)
 	bool	 mds_conn = false, lw_client = false, initial_conn = false;
 	bool	 mds_mds_conn = false;
 	bool	 new_mds_mds_conn = false;
+	bool	 fast_reconnect = false;
         struct obd_connect_data *data, *tmpdata;
         int size, tmpsize;
         lnet_nid_t *client_nid = NULL;
@@ -1248,6 +1309,16 @@ no_export:
                 GOTO(out, rc);
         }
 
+	/* A client reconnecting to its export while the target is not in
+	 * recovery, e.g. after a network error, has no state to rebuild and
+	 * is let through, as are lightweight and MDT-MDT connections.  The
+	 * others are subject to the connect_limit of the target. */
+	fast_reconnect = export != NULL && rc == EALREADY &&
+			 !target->obd_recovering;
+	if (!fast_reconnect && !lw_client && !mds_mds_conn &&
+	    target_conn_admit(target, req, data) < 0)
+		GOTO(out, rc = -EBUSY);
+
 	CDEBUG(D_HA, "%s: connection from %s@%s %st%llu exp %p cur %lld last %lld\n",
 	       target->obd_name, cluuid.uuid, libcfs_nid2str(req->rq_peer.nid),
 	       target->obd_recovering ? "recovering/" : "", data->ocd_transno,
@@ -1335,6 +1406,9 @@ dont_check_exports:
 
 	LASSERT(target->u.obt.obt_magic == OBT_MAGIC);
 	data->ocd_instance = target->u.obt.obt_instance;
+	if (data->ocd_connect_flags & OBD_CONNECT_FLAGS2 &&
+	    data->ocd_connect_flags2 & OBD_CONNECT2_CONN_WINDOW)
+		data->ocd_conn_window = target_conn_window(target);
 
         /* Return only the parts of obd_connect_data that we understand, so the
          * client knows that we don't understand the rest. */
@@ -1373,6 +1447,15 @@ dont_check_exports:
 	export->exp_conn_cnt = lustre_msg_get_conn_cnt(req->rq_reqmsg);
 	spin_unlock(&export->exp_lock);
 
+	/* The connection of a fast reconnect from the same peer is kept as
+	 * it is, with its NID hash entry. */
+	if (fast_reconnect && export->exp_connection != NULL &&
+	    export->exp_connection->c_peer.nid == req->rq_peer.nid &&
+	    export->exp_connection->c_peer.pid == req->rq_peer.pid &&
+	    export->exp_connection->c_self == req->rq_self &&
+	    !hlist_unhashed(&export->exp_nid_hash))
+		goto set_handle;
+
 	if (export->exp_connection != NULL) {
 		/* Check to see if connection came from another NID. */
 		if ((export->exp_connection->c_peer.nid != req->rq_peer.nid) &&
@@ -1392,6 +1475,7 @@ dont_check_exports:
 			     &export->exp_connection->c_peer.nid,
 			     &export->exp_nid_hash);
 
+set_handle:
 	lustre_msg_set_handle(req->rq_repmsg, &conn);
 
 	rc = rev_import_reconnect(export, req);
@@ -2395,6 +2479,209 @@ static void drop_duplicate_replay_req(struct lu_env *env,
 
 #define WATCHDOG_TIMEOUT (obd_timeout * 10)
 
+static unsigned int recovery_replay_threads = 4;
+module_param(recovery_replay_threads, uint, 0644);
+MODULE_PARM_DESC(recovery_replay_threads,
+		 "threads replaying independent requests in parallel during recovery, 1 to disable");
+
+/*
+ * Add the FIDs of the objects replay \a req modifies to the \a nfids ones
+ * in \a fids, unless some of them is already there or they cannot be known
+ * from the request. Only the MDT reintegrations naming all the objects they
+ * modify in their record are considered: renames and migrations change
+ * objects looked up by name.
+ */
+static bool target_replay_req_fids(struct ptlrpc_request *req,
+				   struct lu_fid *fids, int *nfids)
+{
+	struct lustre_msg *msg = req->rq_reqmsg;
+	struct mdt_rec_reint *rec;
+	const struct lu_fid *fid[2];
+	int count = 0;
+	int i;
+	int j;
+
+	/* type-dependent buffers are not swabbed yet */
+	if (lustre_msg_get_opc(msg) != MDS_REINT || ptlrpc_req_need_swab(req) ||
+	    lustre_msg_bufcount(msg) <= REQ_REC_OFF ||
+	    lustre_msg_buflen(msg, REQ_REC_OFF) < sizeof(*rec))
+		return false;
+
+	rec = lustre_msg_buf(msg, REQ_REC_OFF, sizeof(*rec));
+	switch (rec->rr_opcode) {
+	case REINT_SETATTR:
+	case REINT_SETXATTR:
+		fid[count++] = &rec->rr_fid1;
+		break;
+	case REINT_CREATE:
+	case REINT_LINK:
+	case REINT_UNLINK:
+	case REINT_OPEN:
+		fid[count++] = &rec->rr_fid1;
+		fid[count++] = &rec->rr_fid2;
+		break;
+	default:
+		return false;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!fid_is_sane(fid[i]))
+			return false;
+		for (j = 0; j < *nfids; j++) {
+			if (lu_fid_eq(fid[i], &fids[j]))
+				return false;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		fids[(*nfids)++] = *fid[i];
+	return true;
+}
+
+/*
+ * Fill \a window with \a req, then with the requests following it in the
+ * replay queue as long as their transnos are consecutive and they come from
+ * other clients and modify other objects, so that they can all be replayed
+ * in any order. Returns the number of requests in \a window.
+ */
+static int target_replay_window_fill(struct lu_target *lut,
+				     struct ptlrpc_request *req,
+				     struct ptlrpc_request **window)
+{
+	struct obd_device *obd = lut->lut_obd;
+	struct lu_fid fids[2 * TRD_MAX_WINDOW];
+	__u64 transno = lustre_msg_get_transno(req->rq_reqmsg);
+	__u64 update_transno = 0;
+	int max = min_t(unsigned int, TRD_MAX_WINDOW,
+			2 * recovery_replay_threads);
+	int nfids = 0;
+	int count = 1;
+	int i;
+
+	window[0] = req;
+	if (!target_replay_req_fids(req, fids, &nfids))
+		return count;
+
+	spin_lock(&obd->obd_recovery_task_lock);
+	if (lut->lut_tdtd != NULL)
+		update_transno = distribute_txn_get_next_transno(lut->lut_tdtd);
+
+	while (count < max && !list_empty(&obd->obd_req_replay_queue)) {
+		struct ptlrpc_request *next;
+
+		next = list_entry(obd->obd_req_replay_queue.next,
+				  struct ptlrpc_request, rq_list);
+		if (lustre_msg_get_transno(next->rq_reqmsg) != transno + count)
+			break;
+		/* update replay of distributed transactions comes first */
+		if (update_transno != 0 && transno + count >= update_transno)
+			break;
+		if (is_req_replayed_by_update(next))
+			break;
+		for (i = 0; i < count; i++) {
+			if (window[i]->rq_export == next->rq_export)
+				break;
+		}
+		if (i < count)
+			break;
+		if (!target_replay_req_fids(next, fids, &nfids))
+			break;
+
+		list_del_init(&next->rq_list);
+		obd->obd_requests_queued_for_recovery--;
+		window[count++] = next;
+	}
+	spin_unlock(&obd->obd_recovery_task_lock);
+
+	return count;
+}
+
+/* Replay the requests of the current window until there are none left */
+static void target_replay_window_run(struct target_recovery_data *trd,
+				     struct ptlrpc_thread *thread)
+{
+	struct ptlrpc_request *req;
+
+	spin_lock(&trd->trd_window_lock);
+	while (!list_empty(&trd->trd_window)) {
+		req = list_entry(trd->trd_window.next, struct ptlrpc_request,
+				 rq_list);
+		list_del_init(&req->rq_list);
+		spin_unlock(&trd->trd_window_lock);
+
+		DEBUG_REQ(D_HA, req, "processing t%lld from %s",
+			  lustre_msg_get_transno(req->rq_reqmsg),
+			  libcfs_nid2str(req->rq_peer.nid));
+
+		thread->t_watchdog = lc_watchdog_add(WATCHDOG_TIMEOUT,
+						     NULL, NULL);
+		handle_recovery_req(thread, req, trd->trd_recovery_handler);
+		lc_watchdog_delete(thread->t_watchdog);
+		thread->t_watchdog = NULL;
+
+		spin_lock(&trd->trd_window_lock);
+		if (--trd->trd_window_busy == 0)
+			wake_up_all(&trd->trd_window_waitq);
+	}
+	spin_unlock(&trd->trd_window_lock);
+}
+
+static bool target_replay_window_done(struct target_recovery_data *trd)
+{
+	bool done;
+
+	spin_lock(&trd->trd_window_lock);
+	done = trd->trd_window_busy == 0;
+	spin_unlock(&trd->trd_window_lock);
+
+	return done;
+}
+
+/*
+ * Replay \a req, with the requests that can be replayed along with it by
+ * the helper threads, see target_replay_window_fill().
+ */
+static void target_replay_window(struct lu_target *lut,
+				 struct ptlrpc_thread *thread,
+				 struct ptlrpc_request *req)
+{
+	struct obd_device *obd = lut->lut_obd;
+	struct target_recovery_data *trd = &obd->obd_recovery_data;
+	struct ptlrpc_request *window[TRD_MAX_WINDOW];
+	int count;
+	int i;
+
+	count = target_replay_window_fill(lut, req, window);
+	if (count > 1)
+		CDEBUG(D_HA, "%s: replaying t%llu to t%llu in parallel\n",
+		       obd->obd_name, lustre_msg_get_transno(req->rq_reqmsg),
+		       lustre_msg_get_transno(window[count - 1]->rq_reqmsg));
+
+	spin_lock(&trd->trd_window_lock);
+	for (i = 0; i < count; i++)
+		list_add_tail(&window[i]->rq_list, &trd->trd_window);
+	trd->trd_window_busy = count;
+	spin_unlock(&trd->trd_window_lock);
+	if (count > 1)
+		wake_up_all(&trd->trd_window_waitq);
+
+	target_replay_window_run(trd, thread);
+	wait_event_idle(trd->trd_window_waitq, target_replay_window_done(trd));
+
+	for (i = 0; i < count; i++) {
+		/**
+		 * bz18031: increase next_recovery_transno before
+		 * target_request_copy_put() will drop exp_rpc reference
+		 */
+		spin_lock(&obd->obd_recovery_task_lock);
+		obd->obd_next_recovery_transno++;
+		spin_unlock(&obd->obd_recovery_task_lock);
+		target_exp_dequeue_req_replay(window[i]);
+		target_request_copy_put(window[i]);
+		obd->obd_replayed_requests++;
+	}
+}
+
 static void replay_request_or_update(struct lu_env *env,
 				     struct lu_target *lut,
 				     struct target_recovery_data *trd,
@@ -2461,6 +2748,11 @@ static void replay_request_or_update(struct lu_env *env,
 			}
 
 			LASSERT(trd->trd_processing_task == current_pid());
+			if (trd->trd_nhelpers > 0) {
+				target_replay_window(lut, thread, req);
+				continue;
+			}
+
 			DEBUG_REQ(D_HA, req, "processing t%lld from %s",
 				  lustre_msg_get_transno(req->rq_reqmsg),
 				  libcfs_nid2str(req->rq_peer.nid));
@@ -2533,22 +2825,16 @@ abort:
 	} while (1);
 }
 
-static int target_recovery_thread(void *arg)
+/* Set up a thread and its environment to handle recovery requests */
+static struct ptlrpc_thread *target_recovery_thread_alloc(void)
 {
-        struct lu_target *lut = arg;
-        struct obd_device *obd = lut->lut_obd;
-        struct ptlrpc_request *req;
-        struct target_recovery_data *trd = &obd->obd_recovery_data;
-        unsigned long delta;
-        struct lu_env *env;
-        struct ptlrpc_thread *thread = NULL;
-        int rc = 0;
-        ENTRY;
+	struct ptlrpc_thread *thread;
+	struct lu_env *env;
+	int rc;
 
-	unshare_fs_struct();
-        OBD_ALLOC_PTR(thread);
-        if (thread == NULL)
-                RETURN(-ENOMEM);
+	OBD_ALLOC_PTR(thread);
+	if (thread == NULL)
+		return ERR_PTR(-ENOMEM);
 
 	OBD_ALLOC_PTR(env);
 	if (env == NULL)
@@ -2557,16 +2843,143 @@ static int target_recovery_thread(void *arg)
 	if (rc)
 		GOTO(out_env, rc);
 
-        rc = lu_context_init(&env->le_ctx, LCT_MD_THREAD | LCT_DT_THREAD);
+	rc = lu_context_init(&env->le_ctx, LCT_MD_THREAD | LCT_DT_THREAD);
 	if (rc)
 		GOTO(out_env_remove, rc);
 
-        thread->t_env = env;
-        thread->t_id = -1; /* force filter_iobuf_get/put to use local buffers */
-        env->le_ctx.lc_thread = thread;
+	thread->t_env = env;
+	thread->t_id = -1; /* force filter_iobuf_get/put to use local buffers */
+	env->le_ctx.lc_thread = thread;
 	tgt_io_thread_init(thread); /* init thread_big_cache for IO requests */
 	thread->t_watchdog = NULL;
 
+	return thread;
+
+out_env_remove:
+	lu_env_remove(env);
+out_env:
+	OBD_FREE_PTR(env);
+out_thread:
+	OBD_FREE_PTR(thread);
+	return ERR_PTR(rc);
+}
+
+static void target_recovery_thread_free(struct ptlrpc_thread *thread)
+{
+	struct lu_env *env = thread->t_env;
+
+	tgt_io_thread_done(thread);
+	lu_env_remove(env);
+	OBD_FREE_PTR(env);
+	OBD_FREE_PTR(thread);
+}
+
+static bool target_replay_helper_check(struct target_recovery_data *trd)
+{
+	bool wake;
+
+	spin_lock(&trd->trd_window_lock);
+	wake = !list_empty(&trd->trd_window) || trd->trd_helpers_stop;
+	spin_unlock(&trd->trd_window_lock);
+
+	return wake;
+}
+
+static int target_replay_helper(void *arg)
+{
+	struct lu_target *lut = arg;
+	struct target_recovery_data *trd = &lut->lut_obd->obd_recovery_data;
+	struct ptlrpc_thread *thread;
+
+	unshare_fs_struct();
+	thread = target_recovery_thread_alloc();
+	if (!IS_ERR(thread)) {
+		while (1) {
+			wait_event_idle(trd->trd_window_waitq,
+					target_replay_helper_check(trd));
+			target_replay_window_run(trd, thread);
+			if (trd->trd_helpers_stop)
+				break;
+		}
+		lu_context_fini(&thread->t_env->le_ctx);
+		target_recovery_thread_free(thread);
+	}
+
+	spin_lock(&trd->trd_window_lock);
+	trd->trd_helpers_running--;
+	spin_unlock(&trd->trd_window_lock);
+	wake_up_all(&trd->trd_window_waitq);
+
+	return 0;
+}
+
+/*
+ * Start the threads replaying requests along with the recovery thread, see
+ * target_replay_window(). Recovery goes on with less of them if they fail to
+ * start.
+ */
+static void target_replay_helpers_start(struct lu_target *lut)
+{
+	struct obd_device *obd = lut->lut_obd;
+	struct target_recovery_data *trd = &obd->obd_recovery_data;
+	struct task_struct *task;
+	int count;
+	int i;
+
+	count = min_t(unsigned int, TRD_MAX_HELPERS,
+		      max_t(unsigned int, recovery_replay_threads, 1) - 1);
+	for (i = 0; i < count; i++) {
+		spin_lock(&trd->trd_window_lock);
+		trd->trd_helpers_running++;
+		spin_unlock(&trd->trd_window_lock);
+
+		task = kthread_run(target_replay_helper, lut, "tgt_replay_%d",
+				   i);
+		if (IS_ERR(task)) {
+			CWARN("%s: cannot start replay helper: rc = %ld\n",
+			      obd->obd_name, PTR_ERR(task));
+			spin_lock(&trd->trd_window_lock);
+			trd->trd_helpers_running--;
+			spin_unlock(&trd->trd_window_lock);
+			break;
+		}
+		trd->trd_helper_tasks[i] = task->pid;
+		trd->trd_nhelpers = i + 1;
+	}
+}
+
+static void target_replay_helpers_stop(struct lu_target *lut)
+{
+	struct target_recovery_data *trd = &lut->lut_obd->obd_recovery_data;
+
+	spin_lock(&trd->trd_window_lock);
+	trd->trd_helpers_stop = true;
+	spin_unlock(&trd->trd_window_lock);
+	wake_up_all(&trd->trd_window_waitq);
+
+	wait_event_idle(trd->trd_window_waitq,
+			trd->trd_helpers_running == 0);
+	trd->trd_nhelpers = 0;
+}
+
+static int target_recovery_thread(void *arg)
+{
+        struct lu_target *lut = arg;
+        struct obd_device *obd = lut->lut_obd;
+        struct ptlrpc_request *req;
+        struct target_recovery_data *trd = &obd->obd_recovery_data;
+        unsigned long delta;
+        struct lu_env *env;
+        struct ptlrpc_thread *thread = NULL;
+        int rc = 0;
+        ENTRY;
+
+	unshare_fs_struct();
+	thread = target_recovery_thread_alloc();
+	if (IS_ERR(thread))
+		RETURN(PTR_ERR(thread));
+	env = thread->t_env;
+
 	CDEBUG(D_HA, "%s: started recovery thread pid %d\n", obd->obd_name,
 	       current_pid());
 	trd->trd_processing_task = current_pid();
@@ -2590,7 +3003,9 @@ static int target_recovery_thread(void *arg)
 	CDEBUG(D_INFO, "1: request replay stage - %d clients from t%llu\n",
 	       atomic_read(&obd->obd_req_replay_clients),
 	       obd->obd_next_recovery_transno);
+	target_replay_helpers_start(lut);
 	replay_request_or_update(env, lut, trd, thread);
+	target_replay_helpers_stop(lut);
 
 	/**
 	 * The second stage: replay locks
@@ -2655,13 +3070,7 @@ static int target_recovery_thread(void *arg)
         trd->trd_processing_task = 0;
 	complete(&trd->trd_finishing);
 
-	tgt_io_thread_done(thread);
-out_env_remove:
-	lu_env_remove(env);
-out_env:
-	OBD_FREE_PTR(env);
-out_thread:
-	OBD_FREE_PTR(thread);
+	target_recovery_thread_free(thread);
 	RETURN(rc);
 }
 
@@ -2676,6 +3085,9 @@ static int target_start_recovery_thread(struct lu_target *lut,
 	memset(trd, 0, sizeof(*trd));
 	init_completion(&trd->trd_starting);
 	init_completion(&trd->trd_finishing);
+	spin_lock_init(&trd->trd_window_lock);
+	INIT_LIST_HEAD(&trd->trd_window);
+	init_waitqueue_head(&trd->trd_window_waitq);
 	trd->trd_recovery_handler = handler;
 
 	rc = server_name2index(obd->obd_name, &index, NULL);
@@ -2806,7 +3218,7 @@ int target_queue_recovery_request(struct ptlrpc_request *req,
 	int inserted = 0;
 	ENTRY;
 
-	if (obd->obd_recovery_data.trd_processing_task == current_pid()) {
+	if (trd_is_recovery_task(&obd->obd_recovery_data)) {
 		/* Processing the queue right now, don't re-add. */
 		RETURN(1);
 	}
@@ -3268,6 +3680,7 @@ int target_bulk_io(struct obd_export *exp, struct ptlrpc_bulk_desc *desc,
 {
 	struct ptlrpc_request *req = desc->bd_req;
 	time64_t start = ktime_get_seconds();
+	ktime_t bulk_start = ktime_get_real();
 	time64_t deadline;
 	int rc = 0;
 
@@ -3372,6 +3785,8 @@ int target_bulk_io(struct obd_export *exp, struct ptlrpc_bulk_desc *desc,
 			rc = -ETIMEDOUT;
 		}
 	}
+	req->rq_bulk_time = ktime_add(req->rq_bulk_time,
+				      ktime_sub(ktime_get_real(), bulk_start));
 
 	RETURN(rc);
 }
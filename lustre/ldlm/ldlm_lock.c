@@ -136,8 +136,6 @@ const char *ldlm_it2str(enum ldlm_intent_flags it)
 }
 EXPORT_SYMBOL(ldlm_it2str);
 
-extern struct kmem_cache *ldlm_lock_slab;
-
 #ifdef HAVE_SERVER_SUPPORT
 static ldlm_processing_policy ldlm_processing_policy_table[] = {
 	[LDLM_PLAIN]	= ldlm_process_plain_lock,
@@ -226,7 +224,8 @@ void ldlm_lock_put(struct ldlm_lock *lock)
                 if (lock->l_lvb_data != NULL)
                         OBD_FREE_LARGE(lock->l_lvb_data, lock->l_lvb_len);
 
-		if (res->lr_type == LDLM_EXTENT) {
+		if (res->lr_type == LDLM_EXTENT ||
+		    res->lr_type == LDLM_FLOCK) {
 			ldlm_interval_free(ldlm_interval_detach(lock));
 		} else if (res->lr_type == LDLM_IBITS) {
 			if (lock->l_ibits_node != NULL)
@@ -250,14 +249,14 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
 {
 	int rc = 0;
 	if (!list_empty(&lock->l_lru)) {
-		struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+		struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 		LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-		if (ns->ns_last_pos == &lock->l_lru)
-			ns->ns_last_pos = lock->l_lru.prev;
+		if (lru->ll_last_pos == &lock->l_lru)
+			lru->ll_last_pos = lock->l_lru.prev;
 		list_del_init(&lock->l_lru);
-		LASSERT(ns->ns_nr_unused > 0);
-		ns->ns_nr_unused--;
+		LASSERT(lru->ll_nr > 0);
+		lru->ll_nr--;
 		rc = 1;
 	}
 	return rc;
@@ -276,7 +275,7 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
  */
 int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru;
 	int rc = 0;
 
 	ENTRY;
@@ -285,11 +284,12 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 		RETURN(0);
 	}
 
-	spin_lock(&ns->ns_lock);
+	lru = ldlm_lock_lru(lock);
+	spin_lock(&lru->ll_lock);
 	if (!ktime_compare(last_use, ktime_set(0, 0)) ||
 	    !ktime_compare(last_use, lock->l_last_used))
 		rc = ldlm_lock_remove_from_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 
 	RETURN(rc);
 }
@@ -299,14 +299,14 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
  */
 void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 	lock->l_last_used = ktime_get();
 	LASSERT(list_empty(&lock->l_lru));
 	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-	list_add_tail(&lock->l_lru, &ns->ns_unused_list);
-	LASSERT(ns->ns_nr_unused >= 0);
-	ns->ns_nr_unused++;
+	list_add_tail(&lock->l_lru, &lru->ll_list);
+	LASSERT(lru->ll_nr >= 0);
+	lru->ll_nr++;
 }
 
 /**
@@ -315,12 +315,12 @@ void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
  */
 void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru = ldlm_lock_lru(lock);
 
 	ENTRY;
-	spin_lock(&ns->ns_lock);
+	spin_lock(&lru->ll_lock);
 	ldlm_lock_add_to_lru_nolock(lock);
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 	EXIT;
 }
 
@@ -330,7 +330,7 @@ void ldlm_lock_add_to_lru(struct ldlm_lock *lock)
  */
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 {
-	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lru *lru;
 
 	ENTRY;
 	if (ldlm_is_ns_srv(lock)) {
@@ -339,12 +339,13 @@ void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 		return;
 	}
 
-	spin_lock(&ns->ns_lock);
+	lru = ldlm_lock_lru(lock);
+	spin_lock(&lru->ll_lock);
 	if (!list_empty(&lock->l_lru)) {
 		ldlm_lock_remove_from_lru_nolock(lock);
 		ldlm_lock_add_to_lru_nolock(lock);
 	}
-	spin_unlock(&ns->ns_lock);
+	spin_unlock(&lru->ll_lock);
 	EXIT;
 }
 
@@ -446,10 +447,12 @@ static void lock_handle_addref(void *lock)
         LDLM_LOCK_GET((struct ldlm_lock *)lock);
 }
 
-static void lock_handle_free(void *lock, int size)
+static void lock_handle_free(void *ptr, int size)
 {
+	struct ldlm_lock *lock = ptr;
+
 	LASSERT(size == sizeof(struct ldlm_lock));
-	OBD_SLAB_FREE(lock, ldlm_lock_slab, size);
+	OBD_MAG_FREE_PTR(lock, ldlm_lock_mag);
 }
 
 static struct portals_handle_ops lock_handle_ops = {
@@ -473,7 +476,7 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 	if (resource == NULL)
 		LBUG();
 
-	OBD_SLAB_ALLOC_PTR_GFP(lock, ldlm_lock_slab, GFP_NOFS);
+	OBD_MAG_ALLOC_PTR(lock, ldlm_lock_mag);
 	if (lock == NULL)
 		RETURN(NULL);
 
@@ -484,6 +487,7 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 	atomic_set(&lock->l_refc, 2);
 	INIT_LIST_HEAD(&lock->l_res_link);
 	INIT_LIST_HEAD(&lock->l_lru);
+	lock->l_lru_cpt = cfs_cpt_current(cfs_cpt_table, 0);
 	INIT_LIST_HEAD(&lock->l_pending_chain);
 	INIT_LIST_HEAD(&lock->l_bl_ast);
 	INIT_LIST_HEAD(&lock->l_cp_ast);
@@ -1147,7 +1151,7 @@ void ldlm_grant_lock(struct ldlm_lock *lock, struct list_head *work_list)
 		    ldlm_is_test_lock(lock) ||
 		    ldlm_is_flock_deadlock(lock))
 			RETURN_EXIT;
-		ldlm_resource_add_lock(res, &res->lr_granted, lock);
+		ldlm_flock_add_lock(res, lock);
 	} else {
 		LBUG();
 	}
@@ -1695,6 +1699,9 @@ struct ldlm_lock *ldlm_lock_create(struct ldlm_namespace *ns,
 	case LDLM_IBITS:
 		rc = ldlm_inodebits_alloc_lock(lock);
 		break;
+	case LDLM_FLOCK:
+		rc = ldlm_flock_alloc_lock(lock);
+		break;
 	default:
 		rc = 0;
 	}
@@ -2076,7 +2083,7 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	ENTRY;
 
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_send_next(arg));
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_bl_ast);
 
@@ -2097,6 +2104,8 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	}
 
 	LASSERT(lock->l_blocking_lock);
+	/* batched ASTs are grouped by their whole descriptor */
+	memset(&d, 0, sizeof(d));
 	ldlm_lock2desc(lock->l_blocking_lock, &d);
 	/* copy blocking lock ibits in cancel_bits as well,
 	 * new client may use them for lock convert and it is
@@ -2113,6 +2122,7 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	bld.bl_same_client = lock->l_client_cookie ==
 			     lock->l_blocking_lock->l_client_cookie;
 	bld.bl_cos_incompat = ldlm_is_cos_incompat(lock->l_blocking_lock);
+	bld.bl_cos_enabled = ldlm_is_cos_enabled(lock->l_blocking_lock);
 	arg->bl_desc = &bld;
 
 	LASSERT(ldlm_is_ast_sent(lock));
@@ -2141,12 +2151,13 @@ ldlm_work_revoke_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	ENTRY;
 
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_send_next(arg));
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_rk_ast);
 	list_del_init(&lock->l_rk_ast);
 
 	/* the desc just pretend to exclusive */
+	memset(&desc, 0, sizeof(desc));
 	ldlm_lock2desc(lock, &desc);
 	desc.l_req_mode = LCK_EX;
 	desc.l_granted_mode = 0;
@@ -2264,6 +2275,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	atomic_set(&arg->restart, 0);
 	arg->list = rpc_list;
+	INIT_LIST_HEAD(&arg->bl_batches);
 
 	switch (ast_type) {
 	case LDLM_WORK_CP_AST:
@@ -58,6 +58,13 @@ static char *ldlm_cpts;
 module_param(ldlm_cpts, charp, 0444);
 MODULE_PARM_DESC(ldlm_cpts, "CPU partitions ldlm threads should run on");
 
+#ifdef HAVE_SERVER_SUPPORT
+static unsigned int ldlm_bl_ast_batch = 1;
+module_param(ldlm_bl_ast_batch, uint, 0644);
+MODULE_PARM_DESC(ldlm_bl_ast_batch,
+		 "send the blocking ASTs of a client in batches (0 to disable)");
+#endif
+
 static DEFINE_MUTEX(ldlm_ref_mutex);
 static int ldlm_refcount;
 
@@ -81,30 +88,53 @@ static inline time_t ldlm_get_rq_timeout(void)
 	return timeout < 1 ? 1 : timeout;
 }
 
-struct ldlm_bl_pool {
-	spinlock_t		blp_lock;
+/*
+ * Blocking callbacks are queued to the partition of the CPT the caller runs
+ * on and handled by threads bound to that CPT, so that mass cancels arriving
+ * on many CPUs do not all serialize on a single queue lock.
+ */
+struct ldlm_bl_pool_part {
+	spinlock_t		blpp_lock;
 
 	/*
-	 * blp_prio_list is used for callbacks that should be handled
+	 * blpp_prio_list is used for callbacks that should be handled
 	 * as a priority. It is used for LDLM_FL_DISCARD_DATA requests.
 	 * see bug 13843
 	 */
-	struct list_head              blp_prio_list;
+	struct list_head	blpp_prio_list;
 
 	/*
-	 * blp_list is used for all other callbacks which are likely
+	 * blpp_list is used for all other callbacks which are likely
 	 * to take longer to process.
 	 */
-	struct list_head              blp_list;
-
-	wait_queue_head_t       blp_waitq;
-	struct completion       blp_comp;
-	atomic_t            blp_num_threads;
-	atomic_t            blp_busy_threads;
-	int                     blp_min_threads;
-	int                     blp_max_threads;
+	struct list_head	blpp_list;
+	/* number of items on both lists */
+	unsigned int		blpp_nr;
+	/* namespace served last from blpp_list, never dereferenced */
+	struct ldlm_namespace	*blpp_last_ns;
+	unsigned int		blpp_num_bl;
+	unsigned int		blpp_num_stale;
+
+	wait_queue_head_t	blpp_waitq;
+	atomic_t		blpp_num_threads;
+	atomic_t		blpp_busy_threads;
+	int			blpp_cpt;
+	struct ldlm_bl_pool	*blpp_pool;
 };
 
+struct ldlm_bl_pool {
+	struct ldlm_bl_pool_part **blp_parts;
+	struct completion	blp_comp;
+	/* thread limits of each partition */
+	int			blp_min_threads;
+	int			blp_max_threads;
+};
+
+/* at most this many work items are dequeued by a thread at once */
+#define LDLM_BL_BATCH		16
+/* entries of blpp_list looked at to find another namespace to serve */
+#define LDLM_BL_FAIR_SCAN	8
+
 struct ldlm_bl_work_item {
 	struct list_head	blwi_entry;
 	struct ldlm_namespace	*blwi_ns;
@@ -824,6 +854,282 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+/*
+ * Blocking ASTs for the locks of a client revoked by the same blocking lock,
+ * sent in a single LDLM_BL_CALLBACK request. The request is allocated with
+ * room for LDLM_BL_BATCH_MAX handles when the batch is created, so that a
+ * lock which is added to the batch, and is waiting for its cancel from then
+ * on, always gets its AST sent.
+ */
+struct ldlm_bl_batch {
+	/* in ldlm_cb_set_arg::bl_batches, in creation order */
+	struct list_head	 bb_link;
+	/* in ldlm_cb_set_arg::bl_batch_hash, by export */
+	struct hlist_node	 bb_hash;
+	struct obd_export	*bb_exp;
+	struct ldlm_lock_desc	 bb_desc;
+	__u64			 bb_flags;
+	struct ptlrpc_request	*bb_req;
+	int			 bb_count;
+	struct ldlm_lock	*bb_locks[LDLM_BL_BATCH_MAX];
+};
+
+struct ldlm_bl_batch_args {
+	struct ldlm_cb_set_arg	*ba_set_arg;
+	struct ldlm_bl_batch	*ba_batch;
+};
+
+static bool ldlm_bl_batch_allowed(struct ldlm_lock *lock,
+				  struct ldlm_cb_set_arg *arg)
+{
+	/* ldlm_run_ast_work() flushes the batches of blocking ASTs only */
+	if (arg->type != LDLM_BL_CALLBACK || ldlm_bl_ast_batch == 0)
+		return false;
+
+	/* the lock is cancelled with the AST sent, no reply is awaited */
+	if (ldlm_is_cancel_on_block(lock))
+		return false;
+
+	return exp_connect_flags2(lock->l_export) & OBD_CONNECT2_BL_AST_BATCH;
+}
+
+/* Find the batch of \a arg the AST of a lock of \a exp goes to, or add one */
+static struct ldlm_bl_batch *ldlm_bl_batch_get(struct ldlm_cb_set_arg *arg,
+					       struct obd_export *exp,
+					       struct ldlm_lock_desc *desc,
+					       __u64 flags)
+{
+	struct hlist_head *head;
+	struct hlist_node __maybe_unused *pos;
+	struct ldlm_bl_batch *bb;
+	int rc;
+
+	head = &arg->bl_batch_hash[hash_ptr(exp, LDLM_BL_BATCH_HASH_BITS)];
+	cfs_hlist_for_each_entry(bb, pos, head, bb_hash) {
+		if (bb->bb_exp == exp && bb->bb_flags == flags &&
+		    memcmp(&bb->bb_desc, desc, sizeof(*desc)) == 0)
+			return bb;
+	}
+
+	OBD_ALLOC_PTR(bb);
+	if (bb == NULL)
+		return NULL;
+
+	bb->bb_req = ptlrpc_request_alloc(exp->exp_imp_reverse,
+					  &RQF_LDLM_BL_CALLBACK_BATCH);
+	if (bb->bb_req == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	req_capsule_set_size(&bb->bb_req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(LDLM_BL_BATCH_MAX,
+						  LDLM_BL_CALLBACK));
+	rc = ptlrpc_request_pack(bb->bb_req, LUSTRE_DLM_VERSION,
+				 LDLM_BL_CALLBACK);
+	if (rc != 0) {
+		ptlrpc_request_free(bb->bb_req);
+		GOTO(out_free, rc);
+	}
+
+	bb->bb_exp = exp;
+	bb->bb_desc = *desc;
+	bb->bb_flags = flags;
+	list_add_tail(&bb->bb_link, &arg->bl_batches);
+	hlist_add_head(&bb->bb_hash, head);
+	return bb;
+
+out_free:
+	OBD_FREE_PTR(bb);
+	return NULL;
+}
+
+static void ldlm_bl_batch_resend(struct ptlrpc_request *req, void *data)
+{
+	struct ldlm_bl_batch_args *ba = data;
+	struct ldlm_bl_batch *bb = ba->ba_batch;
+	int i;
+
+	for (i = 0; i < bb->bb_count; i++)
+		ldlm_refresh_waiting_lock(bb->bb_locks[i],
+					  ldlm_bl_timeout(bb->bb_locks[i]));
+}
+
+/* Whether the client listed the lock in the reply as one it does not have */
+static bool ldlm_bl_batch_stale(struct ldlm_request *stale, int size,
+				struct ldlm_lock *lock)
+{
+	int i;
+
+	if (stale == NULL || size < ldlm_request_bufsize(stale->lock_count,
+							 LDLM_BL_CALLBACK))
+		return false;
+
+	for (i = 0; i < stale->lock_count; i++) {
+		if (stale->lock_handle[i].cookie ==
+		    lock->l_remote_handle.cookie)
+			return true;
+	}
+	return false;
+}
+
+static int ldlm_bl_batch_interpret(const struct lu_env *env,
+				   struct ptlrpc_request *req, void *args,
+				   int rc)
+{
+	struct ldlm_bl_batch_args *ba = args;
+	struct ldlm_bl_batch *bb = ba->ba_batch;
+	struct ldlm_cb_set_arg *arg = ba->ba_set_arg;
+	struct ldlm_request *stale = NULL;
+	struct ldlm_lock *lock;
+	int size = 0;
+	int lrc;
+	int i;
+	ENTRY;
+
+	if (rc == 0) {
+		stale = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REQ);
+		size = req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ,
+					    RCL_SERVER);
+	}
+
+	for (i = 0; i < bb->bb_count; i++) {
+		lock = bb->bb_locks[i];
+		lrc = rc;
+		/* handled as a single AST the client replied -EINVAL to */
+		if (lrc == 0 && ldlm_bl_batch_stale(stale, size, lock))
+			lrc = -EINVAL;
+		if (lrc != 0)
+			lrc = ldlm_handle_ast_error(lock, req, lrc, "blocking");
+		if (lrc == -ERESTART)
+			atomic_inc(&arg->restart);
+		/* release extra reference taken in ldlm_bl_batch_add() */
+		LDLM_LOCK_RELEASE(lock);
+	}
+
+	OBD_FREE_PTR(bb);
+	RETURN(0);
+}
+
+/* Send batch \a bb, or drop it if it revokes no lock */
+static void ldlm_bl_batch_send(struct ldlm_cb_set_arg *arg,
+			       struct ldlm_bl_batch *bb)
+{
+	struct ptlrpc_request *req = bb->bb_req;
+	struct ldlm_bl_batch_args *ba;
+	struct ldlm_request *body;
+	int size;
+	int i;
+	ENTRY;
+
+	list_del_init(&bb->bb_link);
+	hlist_del_init(&bb->bb_hash);
+	if (bb->bb_count == 0) {
+		ptlrpc_req_finished(req);
+		OBD_FREE_PTR(bb);
+		RETURN_EXIT;
+	}
+
+	size = ldlm_request_bufsize(bb->bb_count, LDLM_BL_CALLBACK);
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_desc = bb->bb_desc;
+	body->lock_flags = bb->bb_flags;
+	body->lock_count = bb->bb_count;
+	for (i = 0; i < bb->bb_count; i++)
+		body->lock_handle[i] = bb->bb_locks[i]->l_remote_handle;
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_REQ, size, RCL_CLIENT);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_SERVER, size);
+	ptlrpc_request_set_replen(req);
+
+	CLASSERT(sizeof(*ba) <= sizeof(req->rq_async_args));
+	ba = ptlrpc_req_async_args(req);
+	ba->ba_set_arg = arg;
+	ba->ba_batch = bb;
+	req->rq_interpret_reply = ldlm_bl_batch_interpret;
+
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit = ldlm_bl_timeout(bb->bb_locks[0]);
+	req->rq_resend_cb = ldlm_bl_batch_resend;
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* ptlrpc_request_alloc_pack already set timeout */
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	CDEBUG(D_DLMTRACE, "%s: blocking AST for %d locks to %s\n",
+	       bb->bb_exp->exp_obd->obd_name, bb->bb_count,
+	       obd_export_nid2str(bb->bb_exp));
+	ptlrpc_set_add_req(arg->set, req);
+	EXIT;
+}
+
+/**
+ * Send the next batch of blocking ASTs of \a arg, one per call so that the
+ * flow control of the set of \a arg applies to batches too.
+ *
+ * \retval -ENOENT if there are no more batches to send
+ */
+int ldlm_bl_batch_send_next(struct ldlm_cb_set_arg *arg)
+{
+	if (list_empty(&arg->bl_batches))
+		return -ENOENT;
+
+	ldlm_bl_batch_send(arg, list_entry(arg->bl_batches.next,
+					   struct ldlm_bl_batch, bb_link));
+	return 0;
+}
+
+/*
+ * Add the blocking AST of \a lock to the batch for its export and \a desc,
+ * and send the batch once it is full.
+ */
+static int ldlm_bl_batch_add(struct ldlm_lock *lock,
+			     struct ldlm_lock_desc *desc,
+			     struct ldlm_cb_set_arg *arg)
+{
+	struct ldlm_bl_batch *bb;
+	__u64 flags;
+	ENTRY;
+
+	/* the AST flags of the lock are set before it is put on the AST list */
+	flags = ldlm_flags_to_wire(lock->l_flags & LDLM_FL_AST_MASK);
+	bb = ldlm_bl_batch_get(arg, lock->l_export, desc, flags);
+	if (bb == NULL)
+		RETURN(-ENOMEM);
+
+	lock_res_and_lock(lock);
+	if (ldlm_is_destroyed(lock)) {
+		unlock_res_and_lock(lock);
+		RETURN(0);
+	}
+
+	if (!ldlm_is_granted(lock)) {
+		/* this blocking AST will be communicated as part of the
+		 * completion AST instead */
+		ldlm_add_blocked_lock(lock);
+		ldlm_set_waited(lock);
+		unlock_res_and_lock(lock);
+		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
+		RETURN(0);
+	}
+
+	LDLM_DEBUG(lock, "server batching blocking AST");
+	ldlm_set_cbpending(lock);
+	ldlm_add_waiting_lock(lock, ldlm_bl_timeout(lock));
+	unlock_res_and_lock(lock);
+
+	LDLM_LOCK_GET(lock);
+	bb->bb_locks[bb->bb_count++] = lock;
+
+	if (lock->l_export->exp_nid_stats &&
+	    lock->l_export->exp_nid_stats->nid_ldlm_stats)
+		lprocfs_counter_incr(lock->l_export->exp_nid_stats->nid_ldlm_stats,
+				     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+
+	if (bb->bb_count == LDLM_BL_BATCH_MAX)
+		ldlm_bl_batch_send(arg, bb);
+
+	RETURN(0);
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
@@ -859,6 +1165,13 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 
         ldlm_lock_reorder_req(lock);
 
+	if (ldlm_bl_batch_allowed(lock, arg)) {
+		rc = ldlm_bl_batch_add(lock, desc, arg);
+		/* send it alone */
+		if (rc != -ENOMEM)
+			RETURN(rc);
+	}
+
 	req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
 					&RQF_LDLM_BL_CALLBACK,
 					LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
@@ -2009,20 +2322,24 @@ static int __ldlm_bl_to_thread(struct ldlm_bl_work_item *blwi,
 			       enum ldlm_cancel_flags cancel_flags)
 {
 	struct ldlm_bl_pool *blp = ldlm_state->ldlm_bl_pool;
+	struct ldlm_bl_pool_part *blpp;
 	ENTRY;
 
-	spin_lock(&blp->blp_lock);
+	blpp = blp->blp_parts[cfs_cpt_current(cfs_cpt_table, 1)];
+
+	spin_lock(&blpp->blpp_lock);
 	if (blwi->blwi_lock &&
 	    ldlm_is_discard_data(blwi->blwi_lock)) {
 		/* add LDLM_FL_DISCARD_DATA requests to the priority list */
-		list_add_tail(&blwi->blwi_entry, &blp->blp_prio_list);
+		list_add_tail(&blwi->blwi_entry, &blpp->blpp_prio_list);
 	} else {
 		/* other blocking callbacks are added to the regular list */
-		list_add_tail(&blwi->blwi_entry, &blp->blp_list);
+		list_add_tail(&blwi->blwi_entry, &blpp->blpp_list);
 	}
-	spin_unlock(&blp->blp_lock);
+	blpp->blpp_nr++;
+	spin_unlock(&blpp->blpp_lock);
 
-	wake_up(&blp->blp_waitq);
+	wake_up(&blpp->blpp_waitq);
 
 	/* can not check blwi->blwi_flags as blwi could be already freed in
 	   LCF_ASYNC mode */
@@ -2115,7 +2432,11 @@ int ldlm_bl_to_thread_list(struct ldlm_namespace *ns, struct ldlm_lock_desc *ld,
 
 int ldlm_bl_thread_wakeup(void)
 {
-	wake_up(&ldlm_state->ldlm_bl_pool->blp_waitq);
+	struct ldlm_bl_pool_part *blpp;
+	int i;
+
+	cfs_percpt_for_each(blpp, i, ldlm_state->ldlm_bl_pool->blp_parts)
+		wake_up(&blpp->blpp_waitq);
 	return 0;
 }
 
@@ -2177,6 +2498,89 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
                 CWARN("Send reply failed, maybe cause bug 21636.\n");
 }
 
+/*
+ * Handle a blocking AST revoking the \a dlm_req->lock_count locks listed in
+ * \a dlm_req. The reply lists the handles of the locks the client does not
+ * have anymore, for which the server does not need to wait for a cancel.
+ */
+static void ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					  struct ldlm_namespace *ns,
+					  struct ldlm_request *dlm_req)
+{
+	struct ldlm_lock *locks[LDLM_BL_BATCH_MAX];
+	struct ldlm_request *stale;
+	struct ldlm_lock *lock;
+	int count = dlm_req->lock_count;
+	int size;
+	int rc;
+	int i;
+	ENTRY;
+
+	size = req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT);
+	if (count > LDLM_BL_BATCH_MAX ||
+	    size < ldlm_request_bufsize(count, LDLM_BL_CALLBACK)) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate with bad batch", rc, NULL);
+		RETURN_EXIT;
+	}
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_SERVER,
+			     ldlm_request_bufsize(count, LDLM_BL_CALLBACK));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc != 0) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Operate without reply buffer", rc,
+				     NULL);
+		RETURN_EXIT;
+	}
+	stale = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REQ);
+	stale->lock_count = 0;
+
+	for (i = 0; i < count; i++) {
+		lock = ldlm_handle2lock_long(&dlm_req->lock_handle[i], 0);
+		if (lock != NULL) {
+			/* same checks as for a single blocking AST */
+			lock_res_and_lock(lock);
+			lock->l_flags |= ldlm_flags_from_wire(dlm_req->lock_flags &
+							      LDLM_FL_AST_MASK);
+			if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+			    ldlm_is_failed(lock)) {
+				unlock_res_and_lock(lock);
+				LDLM_LOCK_RELEASE(lock);
+				lock = NULL;
+			} else {
+				ldlm_lock_remove_from_lru(lock);
+				ldlm_set_bl_ast(lock);
+				unlock_res_and_lock(lock);
+			}
+		}
+
+		if (lock == NULL) {
+			CDEBUG(D_DLMTRACE, "batched callback on lock %#llx - "
+			       "lock disappeared\n",
+			       dlm_req->lock_handle[i].cookie);
+			stale->lock_handle[stale->lock_count++] =
+				dlm_req->lock_handle[i];
+		}
+		locks[i] = lock;
+	}
+
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Batch process", rc,
+				     &dlm_req->lock_handle[0]);
+
+	for (i = 0; i < count; i++) {
+		if (locks[i] == NULL)
+			continue;
+		if (ldlm_bl_to_thread_lock(ns, &dlm_req->lock_desc, locks[i]))
+			ldlm_handle_bl_callback(ns, &dlm_req->lock_desc,
+						locks[i]);
+	}
+	EXIT;
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2247,6 +2651,13 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
                 RETURN(0);
         }
 
+	/* only servers batching the blocking ASTs set lock_count */
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    dlm_req->lock_count > 0) {
+		ldlm_handle_bl_callback_batch(req, ns, dlm_req);
+		RETURN(0);
+	}
+
         /* Force a known safe race, send a cancel to the server for a lock
          * which the server has already started a blocking callback on. */
         if (OBD_FAIL_CHECK(OBD_FAIL_LDLM_CANCEL_BL_CB_RACE) &&
@@ -2573,89 +2984,171 @@ void ldlm_revoke_export_locks(struct obd_export *exp)
 EXPORT_SYMBOL(ldlm_revoke_export_locks);
 #endif /* HAVE_SERVER_SUPPORT */
 
-static int ldlm_bl_get_work(struct ldlm_bl_pool *blp,
-			    struct ldlm_bl_work_item **p_blwi,
-			    struct obd_export **p_exp)
+/*
+ * Take the next work item off \a blpp, called with blpp_lock held.
+ *
+ * A request from blpp_list is processed at least every blpp_num_threads
+ * items even if priority work is queued.  From blpp_list the first item of
+ * a namespace other than the one served last is preferred, looking at no
+ * more than LDLM_BL_FAIR_SCAN entries, so that one namespace flooded with
+ * cancels does not delay the callbacks of all others.  The order of the
+ * items of each namespace is kept.
+ */
+static struct ldlm_bl_work_item *
+ldlm_bl_pick_work(struct ldlm_bl_pool_part *blpp, int num_th)
 {
 	struct ldlm_bl_work_item *blwi = NULL;
-	static unsigned int num_bl = 0;
-	static unsigned int num_stale;
-	int num_th = atomic_read(&blp->blp_num_threads);
+	struct ldlm_bl_work_item *tmp;
+	int scan = 0;
+
+	if (!list_empty(&blpp->blpp_list) &&
+	    (list_empty(&blpp->blpp_prio_list) || blpp->blpp_num_bl == 0)) {
+		list_for_each_entry(tmp, &blpp->blpp_list, blwi_entry) {
+			if (blwi == NULL)
+				blwi = tmp;
+			if (tmp->blwi_ns != blpp->blpp_last_ns) {
+				blwi = tmp;
+				break;
+			}
+			if (++scan >= LDLM_BL_FAIR_SCAN)
+				break;
+		}
+		blpp->blpp_last_ns = blwi->blwi_ns;
+	} else if (!list_empty(&blpp->blpp_prio_list)) {
+		blwi = list_entry(blpp->blpp_prio_list.next,
+				  struct ldlm_bl_work_item, blwi_entry);
+	}
+
+	if (blwi) {
+		if (++blpp->blpp_num_bl >= num_th)
+			blpp->blpp_num_bl = 0;
+		list_del(&blwi->blwi_entry);
+		blpp->blpp_nr--;
+	}
+
+	return blwi;
+}
+
+/*
+ * Take one item from the partition of another CPT whose threads are all
+ * busy, so that a burst of callbacks queued on one CPT, e.g. by the pools
+ * thread cancelling LRU locks, is not limited to the threads of that CPT.
+ */
+static void ldlm_bl_steal_work(struct ldlm_bl_pool_part *blpp,
+			       struct list_head *batch)
+{
+	struct ldlm_bl_pool_part *victim;
+	struct ldlm_bl_work_item *blwi;
+	int i;
+
+	cfs_percpt_for_each(victim, i, blpp->blpp_pool->blp_parts) {
+		if (victim == blpp || READ_ONCE(victim->blpp_nr) == 0 ||
+		    atomic_read(&victim->blpp_busy_threads) <
+		    atomic_read(&victim->blpp_num_threads))
+			continue;
+
+		spin_lock(&victim->blpp_lock);
+		blwi = ldlm_bl_pick_work(victim,
+				atomic_read(&victim->blpp_num_threads));
+		if (blwi != NULL && blwi->blwi_ns == NULL) {
+			/* stop request of ldlm_cleanup() for that CPT */
+			list_add(&blwi->blwi_entry, &victim->blpp_list);
+			victim->blpp_nr++;
+			blwi = NULL;
+		}
+		spin_unlock(&victim->blpp_lock);
+
+		if (blwi != NULL) {
+			list_add_tail(&blwi->blwi_entry, batch);
+			return;
+		}
+	}
+}
+
+/*
+ * Get either a stale export to cancel the locks of, or a batch of work items
+ * put on \a batch.  The batch size is limited so that the queued work is
+ * spread over all the threads of the partition.
+ */
+static int ldlm_bl_get_work(struct ldlm_bl_pool_part *blpp,
+			    struct list_head *batch,
+			    struct obd_export **p_exp)
+{
+	struct ldlm_bl_work_item *blwi;
+	int num_th = atomic_read(&blpp->blpp_num_threads);
+	int count;
 
 	*p_exp = obd_stale_export_get();
 
-	spin_lock(&blp->blp_lock);
+	spin_lock(&blpp->blpp_lock);
 	if (*p_exp != NULL) {
-		if (num_th == 1 || ++num_stale < num_th) {
-			spin_unlock(&blp->blp_lock);
+		if (num_th == 1 || ++blpp->blpp_num_stale < num_th) {
+			spin_unlock(&blpp->blpp_lock);
 			return 1;
 		} else {
-			num_stale = 0;
+			blpp->blpp_num_stale = 0;
 		}
 	}
 
-	/* process a request from the blp_list at least every blp_num_threads */
-	if (!list_empty(&blp->blp_list) &&
-	    (list_empty(&blp->blp_prio_list) || num_bl == 0))
-		blwi = list_entry(blp->blp_list.next,
-				  struct ldlm_bl_work_item, blwi_entry);
-	else
-		if (!list_empty(&blp->blp_prio_list))
-			blwi = list_entry(blp->blp_prio_list.next,
-					  struct ldlm_bl_work_item,
-					  blwi_entry);
-
-	if (blwi) {
-		if (++num_bl >= num_th)
-			num_bl = 0;
-		list_del(&blwi->blwi_entry);
+	count = clamp_t(int, blpp->blpp_nr / max(num_th, 1), 1, LDLM_BL_BATCH);
+	while (count-- > 0) {
+		blwi = ldlm_bl_pick_work(blpp, num_th);
+		if (blwi == NULL)
+			break;
+		list_add_tail(&blwi->blwi_entry, batch);
+		/* the thread exits on the stop request of ldlm_cleanup() */
+		if (blwi->blwi_ns == NULL)
+			break;
 	}
-	spin_unlock(&blp->blp_lock);
-	*p_blwi = blwi;
+	spin_unlock(&blpp->blpp_lock);
 
-	if (*p_exp != NULL && *p_blwi != NULL) {
+	if (list_empty(batch) && *p_exp == NULL)
+		ldlm_bl_steal_work(blpp, batch);
+
+	if (*p_exp != NULL && !list_empty(batch)) {
 		obd_stale_export_put(*p_exp);
 		*p_exp = NULL;
 	}
 
-	return (*p_blwi != NULL || *p_exp != NULL) ? 1 : 0;
+	return (!list_empty(batch) || *p_exp != NULL) ? 1 : 0;
 }
 
 /* This only contains temporary data until the thread starts */
 struct ldlm_bl_thread_data {
-	struct ldlm_bl_pool	*bltd_blp;
+	struct ldlm_bl_pool_part *bltd_blpp;
 	struct completion	bltd_comp;
 	int			bltd_num;
 };
 
 static int ldlm_bl_thread_main(void *arg);
 
-static int ldlm_bl_thread_start(struct ldlm_bl_pool *blp, bool check_busy)
+static int ldlm_bl_thread_start(struct ldlm_bl_pool_part *blpp,
+				bool check_busy)
 {
-	struct ldlm_bl_thread_data bltd = { .bltd_blp = blp };
+	struct ldlm_bl_thread_data bltd = { .bltd_blpp = blpp };
 	struct task_struct *task;
 
 	init_completion(&bltd.bltd_comp);
 
-	bltd.bltd_num = atomic_inc_return(&blp->blp_num_threads);
-	if (bltd.bltd_num >= blp->blp_max_threads) {
-		atomic_dec(&blp->blp_num_threads);
+	bltd.bltd_num = atomic_inc_return(&blpp->blpp_num_threads);
+	if (bltd.bltd_num > blpp->blpp_pool->blp_max_threads) {
+		atomic_dec(&blpp->blpp_num_threads);
 		return 0;
 	}
 
 	LASSERTF(bltd.bltd_num > 0, "thread num:%d\n", bltd.bltd_num);
 	if (check_busy &&
-	    atomic_read(&blp->blp_busy_threads) < (bltd.bltd_num - 1)) {
-		atomic_dec(&blp->blp_num_threads);
+	    atomic_read(&blpp->blpp_busy_threads) < (bltd.bltd_num - 1)) {
+		atomic_dec(&blpp->blpp_num_threads);
 		return 0;
 	}
 
-	task = kthread_run(ldlm_bl_thread_main, &bltd, "ldlm_bl_%02d",
-			   bltd.bltd_num);
+	task = kthread_run(ldlm_bl_thread_main, &bltd, "ldlm_bl_%02d_%02d",
+			   blpp->blpp_cpt, bltd.bltd_num);
 	if (IS_ERR(task)) {
-		CERROR("cannot start LDLM thread ldlm_bl_%02d: rc %ld\n",
-		       bltd.bltd_num, PTR_ERR(task));
-		atomic_dec(&blp->blp_num_threads);
+		CERROR("cannot start LDLM thread ldlm_bl_%02d_%02d: rc %ld\n",
+		       blpp->blpp_cpt, bltd.bltd_num, PTR_ERR(task));
+		atomic_dec(&blpp->blpp_num_threads);
 		return PTR_ERR(task);
 	}
 	wait_for_completion(&bltd.bltd_comp);
@@ -2664,14 +3157,15 @@ static int ldlm_bl_thread_start(struct ldlm_bl_pool *blp, bool check_busy)
 }
 
 /* Not fatal if racy and have a few too many threads */
-static int ldlm_bl_thread_need_create(struct ldlm_bl_pool *blp,
+static int ldlm_bl_thread_need_create(struct ldlm_bl_pool_part *blpp,
 				      struct ldlm_bl_work_item *blwi)
 {
-	if (atomic_read(&blp->blp_num_threads) >= blp->blp_max_threads)
+	if (atomic_read(&blpp->blpp_num_threads) >=
+	    blpp->blpp_pool->blp_max_threads)
 		return 0;
 
-	if (atomic_read(&blp->blp_busy_threads) <
-	    atomic_read(&blp->blp_num_threads))
+	if (atomic_read(&blpp->blpp_busy_threads) <
+	    atomic_read(&blpp->blpp_num_threads))
 		return 0;
 
 	if (blwi != NULL && (blwi->blwi_ns == NULL ||
@@ -2681,7 +3175,7 @@ static int ldlm_bl_thread_need_create(struct ldlm_bl_pool *blp,
 	return 1;
 }
 
-static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
+static int ldlm_bl_thread_blwi(struct ldlm_bl_pool_part *blpp,
 			       struct ldlm_bl_work_item *blwi)
 {
 	ENTRY;
@@ -2727,7 +3221,7 @@ static int ldlm_bl_thread_blwi(struct ldlm_bl_pool *blp,
  * them too, thus cancel not blocked locks only if the current export has
  * no blocked locks.
  **/
-static int ldlm_bl_thread_exports(struct ldlm_bl_pool *blp,
+static int ldlm_bl_thread_exports(struct ldlm_bl_pool_part *blpp,
 				  struct obd_export *exp)
 {
 	int num;
@@ -2755,7 +3249,7 @@ static int ldlm_bl_thread_exports(struct ldlm_bl_pool *blp,
 static int ldlm_bl_thread_main(void *arg)
 {
 	struct lu_env *env;
-	struct ldlm_bl_pool *blp;
+	struct ldlm_bl_pool_part *blpp;
 	struct ldlm_bl_thread_data *bltd = arg;
 	int rc;
 
@@ -2771,36 +3265,50 @@ static int ldlm_bl_thread_main(void *arg)
 	if (rc)
 		GOTO(out_env_fini, rc);
 
-	blp = bltd->bltd_blp;
+	blpp = bltd->bltd_blpp;
 
 	complete(&bltd->bltd_comp);
 	/* cannot use bltd after this, it is only on caller's stack */
 
+	rc = cfs_cpt_bind(cfs_cpt_table, blpp->blpp_cpt);
+	if (rc != 0)
+		CWARN("Failed to bind ldlm_bl thread on CPT %d: rc = %d\n",
+		      blpp->blpp_cpt, rc);
+
 	while (1) {
 		struct l_wait_info lwi = { 0 };
-		struct ldlm_bl_work_item *blwi = NULL;
+		struct ldlm_bl_work_item *blwi;
+		struct ldlm_bl_work_item *tmp;
 		struct obd_export *exp = NULL;
+		LIST_HEAD(batch);
 		int rc;
 
-		rc = ldlm_bl_get_work(blp, &blwi, &exp);
+		rc = ldlm_bl_get_work(blpp, &batch, &exp);
 
 		if (rc == 0)
-			l_wait_event_exclusive(blp->blp_waitq,
-					       ldlm_bl_get_work(blp, &blwi,
+			l_wait_event_exclusive(blpp->blpp_waitq,
+					       ldlm_bl_get_work(blpp, &batch,
 								&exp),
 					       &lwi);
-		atomic_inc(&blp->blp_busy_threads);
+		atomic_inc(&blpp->blpp_busy_threads);
 
-		if (ldlm_bl_thread_need_create(blp, blwi))
+		blwi = list_first_entry_or_null(&batch,
+						struct ldlm_bl_work_item,
+						blwi_entry);
+		if (ldlm_bl_thread_need_create(blpp, blwi))
 			/* discard the return value, we tried */
-			ldlm_bl_thread_start(blp, true);
+			ldlm_bl_thread_start(blpp, true);
 
+		rc = 0;
 		if (exp)
-			rc = ldlm_bl_thread_exports(blp, exp);
-		else if (blwi)
-			rc = ldlm_bl_thread_blwi(blp, blwi);
+			rc = ldlm_bl_thread_exports(blpp, exp);
+		/* blwi is freed or completed by ldlm_bl_thread_blwi() */
+		list_for_each_entry_safe(blwi, tmp, &batch, blwi_entry) {
+			list_del_init(&blwi->blwi_entry);
+			rc = ldlm_bl_thread_blwi(blpp, blwi);
+		}
 
-		atomic_dec(&blp->blp_busy_threads);
+		atomic_dec(&blpp->blpp_busy_threads);
 
 		if (rc == LDLM_ITER_STOP)
 			break;
@@ -2811,8 +3319,8 @@ static int ldlm_bl_thread_main(void *arg)
 		cond_resched();
 	}
 
-	atomic_dec(&blp->blp_num_threads);
-	complete(&blp->blp_comp);
+	atomic_dec(&blpp->blpp_num_threads);
+	complete(&blpp->blpp_pool->blp_comp);
 
 	lu_env_remove(env);
 out_env_fini:
@@ -3005,9 +3513,13 @@ static int ldlm_setup(void)
 {
 	static struct ptlrpc_service_conf	conf;
 	struct ldlm_bl_pool		       *blp = NULL;
+	struct ldlm_bl_pool_part	       *blpp;
 #ifdef HAVE_SERVER_SUPPORT
 	struct task_struct *task;
 #endif /* HAVE_SERVER_SUPPORT */
+	int ncpts;
+	int nthrs;
+	int cpt;
 	int i;
 	int rc = 0;
 
@@ -3131,26 +3643,40 @@ static int ldlm_setup(void)
 		GOTO(out, rc = -ENOMEM);
 	ldlm_state->ldlm_bl_pool = blp;
 
-	spin_lock_init(&blp->blp_lock);
-	INIT_LIST_HEAD(&blp->blp_list);
-	INIT_LIST_HEAD(&blp->blp_prio_list);
-	init_waitqueue_head(&blp->blp_waitq);
-	atomic_set(&blp->blp_num_threads, 0);
-	atomic_set(&blp->blp_busy_threads, 0);
+	blp->blp_parts = cfs_percpt_alloc(cfs_cpt_table, sizeof(*blpp));
+	if (blp->blp_parts == NULL)
+		GOTO(out, rc = -ENOMEM);
 
+	/* the thread limits are shared between the CPTs */
+	ncpts = cfs_cpt_number(cfs_cpt_table);
 	if (ldlm_num_threads == 0) {
-		blp->blp_min_threads = LDLM_NTHRS_INIT;
-		blp->blp_max_threads = LDLM_NTHRS_MAX;
+		blp->blp_min_threads = max(LDLM_NTHRS_INIT / ncpts, 1);
+		blp->blp_max_threads = max(LDLM_NTHRS_MAX / ncpts,
+					   blp->blp_min_threads);
 	} else {
-		blp->blp_min_threads = blp->blp_max_threads = \
-			min_t(int, LDLM_NTHRS_MAX, max_t(int, LDLM_NTHRS_INIT,
+		nthrs = min_t(int, LDLM_NTHRS_MAX, max_t(int, LDLM_NTHRS_INIT,
 							 ldlm_num_threads));
-	}
-
-	for (i = 0; i < blp->blp_min_threads; i++) {
-		rc = ldlm_bl_thread_start(blp, false);
-		if (rc < 0)
-			GOTO(out, rc);
+		blp->blp_min_threads = blp->blp_max_threads =
+			max(nthrs / ncpts, 1);
+	}
+
+	cfs_percpt_for_each(blpp, cpt, blp->blp_parts) {
+		spin_lock_init(&blpp->blpp_lock);
+		INIT_LIST_HEAD(&blpp->blpp_list);
+		INIT_LIST_HEAD(&blpp->blpp_prio_list);
+		init_waitqueue_head(&blpp->blpp_waitq);
+		atomic_set(&blpp->blpp_num_threads, 0);
+		atomic_set(&blpp->blpp_busy_threads, 0);
+		blpp->blpp_cpt = cpt;
+		blpp->blpp_pool = blp;
+	}
+
+	cfs_percpt_for_each(blpp, cpt, blp->blp_parts) {
+		for (i = 0; i < blp->blp_min_threads; i++) {
+			rc = ldlm_bl_thread_start(blpp, false);
+			if (rc < 0)
+				GOTO(out, rc);
+		}
 	}
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -3183,6 +3709,26 @@ static int ldlm_setup(void)
 	RETURN(rc);
 }
 
+/* stop all the threads of \a blpp, one at a time */
+static void ldlm_bl_thread_stop_all(struct ldlm_bl_pool_part *blpp)
+{
+	struct ldlm_bl_pool *blp = blpp->blpp_pool;
+
+	while (atomic_read(&blpp->blpp_num_threads) > 0) {
+		struct ldlm_bl_work_item blwi = { .blwi_ns = NULL };
+
+		init_completion(&blp->blp_comp);
+
+		spin_lock(&blpp->blpp_lock);
+		list_add_tail(&blwi.blwi_entry, &blpp->blpp_list);
+		blpp->blpp_nr++;
+		wake_up(&blpp->blpp_waitq);
+		spin_unlock(&blpp->blpp_lock);
+
+		wait_for_completion(&blp->blp_comp);
+	}
+}
+
 static int ldlm_cleanup(void)
 {
         ENTRY;
@@ -3200,20 +3746,14 @@ static int ldlm_cleanup(void)
 
 	if (ldlm_state->ldlm_bl_pool != NULL) {
 		struct ldlm_bl_pool *blp = ldlm_state->ldlm_bl_pool;
+		struct ldlm_bl_pool_part *blpp;
+		int i;
 
-		while (atomic_read(&blp->blp_num_threads) > 0) {
-			struct ldlm_bl_work_item blwi = { .blwi_ns = NULL };
-
-			init_completion(&blp->blp_comp);
-
-			spin_lock(&blp->blp_lock);
-			list_add_tail(&blwi.blwi_entry, &blp->blp_list);
-			wake_up(&blp->blp_waitq);
-			spin_unlock(&blp->blp_lock);
-
-			wait_for_completion(&blp->blp_comp);
+		if (blp->blp_parts != NULL) {
+			cfs_percpt_for_each(blpp, i, blp->blp_parts)
+				ldlm_bl_thread_stop_all(blpp);
+			cfs_percpt_free(blp->blp_parts);
 		}
-
 		OBD_FREE(blp, sizeof(*blp));
 	}
 
@@ -3258,17 +3798,30 @@ int ldlm_init(void)
 	if (ldlm_resource_slab == NULL)
 		return -ENOMEM;
 
+	ldlm_resource_mag = cfs_mag_cache_create("ldlm_resources",
+						 ldlm_resource_slab,
+						 cfs_cpt_table,
+						 sizeof(struct ldlm_resource));
+	if (ldlm_resource_mag == NULL)
+		goto out_resource;
+
 	ldlm_lock_slab = kmem_cache_create("ldlm_locks",
 			      sizeof(struct ldlm_lock), 0,
 			      SLAB_HWCACHE_ALIGN, NULL);
 	if (ldlm_lock_slab == NULL)
-		goto out_resource;
+		goto out_resource_mag;
+
+	ldlm_lock_mag = cfs_mag_cache_create("ldlm_locks", ldlm_lock_slab,
+					     cfs_cpt_table,
+					     sizeof(struct ldlm_lock));
+	if (ldlm_lock_mag == NULL)
+		goto out_lock;
 
 	ldlm_interval_slab = kmem_cache_create("interval_node",
                                         sizeof(struct ldlm_interval),
 					0, SLAB_HWCACHE_ALIGN, NULL);
 	if (ldlm_interval_slab == NULL)
-		goto out_lock;
+		goto out_lock_mag;
 
 	ldlm_interval_tree_slab = kmem_cache_create("interval_tree",
 			sizeof(struct ldlm_interval_tree) * LCK_MODE_NUM,
@@ -3276,12 +3829,18 @@ int ldlm_init(void)
 	if (ldlm_interval_tree_slab == NULL)
 		goto out_interval;
 
+	ldlm_interval_tree_mag = cfs_mag_cache_create("interval_tree",
+			ldlm_interval_tree_slab, cfs_cpt_table,
+			sizeof(struct ldlm_interval_tree) * LCK_MODE_NUM);
+	if (ldlm_interval_tree_mag == NULL)
+		goto out_interval_tree;
+
 #ifdef HAVE_SERVER_SUPPORT
 	ldlm_inodebits_slab = kmem_cache_create("ldlm_ibits_node",
 						sizeof(struct ldlm_ibits_node),
 						0, SLAB_HWCACHE_ALIGN, NULL);
 	if (ldlm_inodebits_slab == NULL)
-		goto out_interval_tree;
+		goto out_interval_tree_mag;
 
 	ldlm_glimpse_work_kmem = kmem_cache_create("ldlm_glimpse_work_kmem",
 					sizeof(struct ldlm_glimpse_work),
@@ -3297,13 +3856,19 @@ int ldlm_init(void)
 #ifdef HAVE_SERVER_SUPPORT
 out_inodebits:
 	kmem_cache_destroy(ldlm_inodebits_slab);
+out_interval_tree_mag:
+	cfs_mag_cache_destroy(ldlm_interval_tree_mag);
+#endif
 out_interval_tree:
 	kmem_cache_destroy(ldlm_interval_tree_slab);
-#endif
 out_interval:
 	kmem_cache_destroy(ldlm_interval_slab);
+out_lock_mag:
+	cfs_mag_cache_destroy(ldlm_lock_mag);
 out_lock:
 	kmem_cache_destroy(ldlm_lock_slab);
+out_resource_mag:
+	cfs_mag_cache_destroy(ldlm_resource_mag);
 out_resource:
 	kmem_cache_destroy(ldlm_resource_slab);
 
@@ -3314,6 +3879,7 @@ void ldlm_exit(void)
 {
 	if (ldlm_refcount)
 		CERROR("ldlm_refcount is %d in ldlm_exit!\n", ldlm_refcount);
+	cfs_mag_cache_destroy(ldlm_resource_mag);
 	kmem_cache_destroy(ldlm_resource_slab);
 	/*
 	 * ldlm_lock_put() use RCU to call ldlm_lock_free, so need call
@@ -3321,8 +3887,10 @@ void ldlm_exit(void)
 	 * so that ldlm_lock_free() get a chance to be called.
 	 */
 	rcu_barrier();
+	cfs_mag_cache_destroy(ldlm_lock_mag);
 	kmem_cache_destroy(ldlm_lock_slab);
 	kmem_cache_destroy(ldlm_interval_slab);
+	cfs_mag_cache_destroy(ldlm_interval_tree_mag);
 	kmem_cache_destroy(ldlm_interval_tree_slab);
 #ifdef HAVE_SERVER_SUPPORT
 	kmem_cache_destroy(ldlm_inodebits_slab);
@@ -89,10 +89,19 @@
  * give a possibility for constructing few pre-defined behavior policies. If
  * none of predefines is suitable for a working pattern being used, new one may
  * be "constructed" via sysfs tunables.
+ *
+ * With the "memory" pool policy, the SLV of a server pool is also lowered
+ * according to the memory pressure on the server each recalc period: the share
+ * of the granted locks the shrinker asked to free since the last period, or how
+ * far free memory is below 1/16 of RAM. The grant plan is lowered as much, so
+ * that the SLV keeps dropping until the pressure goes away. Client pools with
+ * that policy check for a lower SLV every second instead of every recalc
+ * period, and cancel locks without cached data first.
  */
 
 #define DEBUG_SUBSYSTEM S_LDLM
 
+#include <linux/swap.h>
 #include <linux/workqueue.h>
 #include <libcfs/linux/linux-mem.h>
 #include <lustre_dlm.h>
@@ -139,6 +148,32 @@
  */
 #define LDLM_POOL_SLV_SHIFT (10)
 
+/*
+ * Free memory below 1/16 of RAM is memory pressure for the "memory" policy.
+ */
+#define LDLM_POOL_MEM_LOW_SHIFT (4)
+
+static char *ldlm_pool_policy = "grant_plan";
+module_param(ldlm_pool_policy, charp, 0444);
+MODULE_PARM_DESC(ldlm_pool_policy,
+		 "default lock pool policy: grant_plan or memory");
+
+static const char *const ldlm_pool_policy_names[] = {
+	[LDLM_POOL_POLICY_GRANT_PLAN]	= "grant_plan",
+	[LDLM_POOL_POLICY_MEMORY]	= "memory",
+};
+
+static int ldlm_pool_policy_lookup(const char *name)
+{
+	int i;
+
+	for (i = 0; i < LDLM_POOL_POLICY_MAX; i++) {
+		if (sysfs_streq(name, ldlm_pool_policy_names[i]))
+			return i;
+	}
+	return -EINVAL;
+}
+
 extern struct proc_dir_entry *ldlm_ns_proc_dir;
 
 static inline __u64 dru(__u64 val, __u32 shift, int round_up)
@@ -283,6 +318,52 @@ static void ldlm_pool_recalc_slv(struct ldlm_pool *pl)
         pl->pl_server_lock_volume = slv;
 }
 
+/**
+ * Returns the memory pressure on the server for the "memory" policy, from 0
+ * to 1 << LDLM_POOL_SLV_SHIFT, and resets the shrinker requests of \a pl.
+ */
+static __u64 ldlm_pool_pressure(struct ldlm_pool *pl)
+{
+	__u64 low = NUM_CACHEPAGES >> LDLM_POOL_MEM_LOW_SHIFT;
+	__u64 free = nr_free_pages();
+	__u64 shrink = atomic_xchg(&pl->pl_shrink_nr, 0);
+	__u64 pressure = 0;
+	__u64 mem;
+
+	if (shrink > 0) {
+		pressure = shrink << LDLM_POOL_SLV_SHIFT;
+		do_div(pressure, max_t(int, ldlm_pool_granted(pl), 1));
+	}
+
+	if (free < low) {
+		mem = (low - free) << LDLM_POOL_SLV_SHIFT;
+		do_div(mem, low);
+		pressure = max(pressure, mem);
+	}
+
+	return min_t(__u64, pressure, 1 << LDLM_POOL_SLV_SHIFT);
+}
+
+/**
+ * Lowers the SLV and the grant plan of \a pl by \a pressure.
+ *
+ * \pre ->pl_lock is locked.
+ */
+static void ldlm_pool_apply_pressure(struct ldlm_pool *pl, __u64 pressure)
+{
+	__u64 keep = (1 << LDLM_POOL_SLV_SHIFT) - pressure;
+	__u32 limit = ldlm_pool_get_limit(pl);
+	int granted = ldlm_pool_granted(pl);
+	__u64 slv;
+
+	slv = dru(pl->pl_server_lock_volume * keep, LDLM_POOL_SLV_SHIFT, 0);
+	pl->pl_server_lock_volume = max(slv, ldlm_pool_slv_min(limit));
+
+	granted = dru((__u64)granted * keep, LDLM_POOL_SLV_SHIFT, 0);
+	if (pl->pl_grant_plan > granted)
+		pl->pl_grant_plan = granted;
+}
+
 /**
  * Recalculates next stats on passed \a pl.
  *
@@ -337,6 +418,7 @@ static void ldlm_srv_pool_push_slv(struct ldlm_pool *pl)
 static int ldlm_srv_pool_recalc(struct ldlm_pool *pl)
 {
 	time64_t recalc_interval_sec;
+	__u64 pressure = 0;
         ENTRY;
 
 	recalc_interval_sec = ktime_get_real_seconds() - pl->pl_recalc_time;
@@ -349,6 +431,10 @@ static int ldlm_srv_pool_recalc(struct ldlm_pool *pl)
 		spin_unlock(&pl->pl_lock);
 		RETURN(0);
 	}
+
+	if (pl->pl_policy == LDLM_POOL_POLICY_MEMORY)
+		pressure = ldlm_pool_pressure(pl);
+
         /*
          * Recalc SLV after last period. This should be done
          * _before_ recalculating new grant plan.
@@ -356,14 +442,20 @@ static int ldlm_srv_pool_recalc(struct ldlm_pool *pl)
         ldlm_pool_recalc_slv(pl);
 
         /*
-         * Make sure that pool informed obd of last SLV changes.
+         * Update grant_plan for new period.
          */
-        ldlm_srv_pool_push_slv(pl);
+        ldlm_pool_recalc_grant_plan(pl);
+
+	if (pressure > 0) {
+		CDEBUG(D_DLMTRACE, "%s: memory pressure %llu/%u\n",
+		       pl->pl_name, pressure, 1 << LDLM_POOL_SLV_SHIFT);
+		ldlm_pool_apply_pressure(pl, pressure);
+	}
 
         /*
-         * Update grant_plan for new period.
+         * Make sure that pool informed obd of last SLV changes.
          */
-        ldlm_pool_recalc_grant_plan(pl);
+        ldlm_srv_pool_push_slv(pl);
 
 	pl->pl_recalc_time = ktime_get_real_seconds();
         lprocfs_counter_add(pl->pl_stats, LDLM_POOL_TIMING_STAT,
@@ -400,6 +492,22 @@ static int ldlm_srv_pool_shrink(struct ldlm_pool *pl,
 
 	spin_lock(&pl->pl_lock);
 
+	/*
+	 * Lower SLV in proportion of the granted locks to free, so that
+	 * clients really cancel about @nr locks, and let next recalc take
+	 * the request into account.
+	 */
+	if (pl->pl_policy == LDLM_POOL_POLICY_MEMORY) {
+		atomic_add(nr, &pl->pl_shrink_nr);
+		ldlm_pool_apply_pressure(pl, min_t(__u64,
+			div_u64((__u64)nr << LDLM_POOL_SLV_SHIFT,
+				ldlm_pool_granted(pl)),
+			1 << LDLM_POOL_SLV_SHIFT));
+		ldlm_srv_pool_push_slv(pl);
+		spin_unlock(&pl->pl_lock);
+		return 0;
+	}
+
         /*
          * We want shrinker to possibly cause cancellation of @nr locks from
          * clients or grant approximately @nr locks smaller next intervals.
@@ -469,6 +577,27 @@ static void ldlm_cli_pool_pop_slv(struct ldlm_pool *pl)
 	read_unlock(&obd->obd_pool_lock);
 }
 
+/**
+ * Returns true if the "memory" policy of client pool \a pl wants locks to be
+ * cancelled before the end of the recalc period, because the server lowered
+ * the SLV since the last recalc.
+ */
+static bool ldlm_cli_pool_slv_dropped(struct ldlm_pool *pl)
+{
+	struct obd_device *obd = ldlm_pl2ns(pl)->ns_obd;
+	bool dropped;
+
+	if (pl->pl_policy != LDLM_POOL_POLICY_MEMORY)
+		return false;
+
+	read_lock(&obd->obd_pool_lock);
+	dropped = obd->obd_pool_slv != 0 &&
+		  obd->obd_pool_slv < pl->pl_server_lock_volume;
+	read_unlock(&obd->obd_pool_lock);
+
+	return dropped;
+}
+
 /**
  * Recalculates client size pool \a pl according to current SLV and Limit.
  */
@@ -479,7 +608,8 @@ static int ldlm_cli_pool_recalc(struct ldlm_pool *pl)
         ENTRY;
 
 	recalc_interval_sec = ktime_get_real_seconds() - pl->pl_recalc_time;
-        if (recalc_interval_sec < pl->pl_recalc_period)
+	if (recalc_interval_sec < pl->pl_recalc_period &&
+	    !ldlm_cli_pool_slv_dropped(pl))
                 RETURN(0);
 
 	spin_lock(&pl->pl_lock);
@@ -487,7 +617,8 @@ static int ldlm_cli_pool_recalc(struct ldlm_pool *pl)
 	 * Check if we need to recalc lists now.
 	 */
 	recalc_interval_sec = ktime_get_real_seconds() - pl->pl_recalc_time;
-	if (recalc_interval_sec < pl->pl_recalc_period) {
+	if (recalc_interval_sec < pl->pl_recalc_period &&
+	    !ldlm_cli_pool_slv_dropped(pl)) {
 		spin_unlock(&pl->pl_lock);
                 RETURN(0);
         }
@@ -542,9 +673,7 @@ static int ldlm_cli_pool_shrink(struct ldlm_pool *pl,
          */
         ldlm_cli_pool_pop_slv(pl);
 
-	spin_lock(&ns->ns_lock);
-	unused = ns->ns_nr_unused;
-	spin_unlock(&ns->ns_lock);
+	unused = ldlm_ns_nr_unused(ns);
 
 	if (nr == 0)
 		return (unused / 100) * sysctl_vfs_cache_pressure;
@@ -610,6 +739,10 @@ time64_t ldlm_pool_recalc(struct ldlm_pool *pl)
 		recalc_interval_sec = 1;
 	}
 
+	/* react to memory pressure and SLV drops within a second */
+	if (pl->pl_policy == LDLM_POOL_POLICY_MEMORY)
+		recalc_interval_sec = min_t(time64_t, recalc_interval_sec, 1);
+
 	return recalc_interval_sec;
 }
 
@@ -733,6 +866,35 @@ LDLM_POOL_SYSFS_READER_NOLOCK_SHOW(lock_volume_factor, atomic);
 LDLM_POOL_SYSFS_WRITER_NOLOCK_STORE(lock_volume_factor, atomic);
 LUSTRE_RW_ATTR(lock_volume_factor);
 
+static ssize_t policy_show(struct kobject *kobj, struct attribute *attr,
+			   char *buf)
+{
+	struct ldlm_pool *pl = container_of(kobj, struct ldlm_pool,
+					    pl_kobj);
+
+	return sprintf(buf, "%s\n", ldlm_pool_policy_names[pl->pl_policy]);
+}
+
+static ssize_t policy_store(struct kobject *kobj, struct attribute *attr,
+			    const char *buffer, size_t count)
+{
+	struct ldlm_pool *pl = container_of(kobj, struct ldlm_pool,
+					    pl_kobj);
+	int policy;
+
+	policy = ldlm_pool_policy_lookup(buffer);
+	if (policy < 0)
+		return policy;
+
+	spin_lock(&pl->pl_lock);
+	pl->pl_policy = policy;
+	atomic_set(&pl->pl_shrink_nr, 0);
+	spin_unlock(&pl->pl_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(policy);
+
 /* These are for pools in /sys/fs/lustre/ldlm/namespaces/.../pool */
 static struct attribute *ldlm_pl_attrs[] = {
 	&lustre_attr_grant_speed.attr,
@@ -744,6 +906,7 @@ static struct attribute *ldlm_pl_attrs[] = {
 	&lustre_attr_cancel_rate.attr,
 	&lustre_attr_grant_rate.attr,
 	&lustre_attr_lock_volume_factor.attr,
+	&lustre_attr_policy.attr,
 	NULL,
 };
 
@@ -888,6 +1051,16 @@ int ldlm_pool_init(struct ldlm_pool *pl, struct ldlm_namespace *ns,
 	atomic_set(&pl->pl_cancel_rate, 0);
 	pl->pl_grant_plan = LDLM_POOL_GP(LDLM_POOL_HOST_L);
 
+	rc = ldlm_pool_policy_lookup(ldlm_pool_policy);
+	if (rc < 0) {
+		CWARN("%s: unknown pool policy '%s', using '%s'\n",
+		      ldlm_ns_name(ns), ldlm_pool_policy,
+		      ldlm_pool_policy_names[LDLM_POOL_POLICY_GRANT_PLAN]);
+		rc = LDLM_POOL_POLICY_GRANT_PLAN;
+	}
+	pl->pl_policy = rc;
+	atomic_set(&pl->pl_shrink_nr, 0);
+
 	snprintf(pl->pl_name, sizeof(pl->pl_name), "ldlm-pool-%s-%d",
 		 ldlm_ns_name(ns), idx);
 
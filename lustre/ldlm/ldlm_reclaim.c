@@ -48,6 +48,11 @@
  * ldlm_reclaim_threshold & ldlm_lock_limit is set to 20% & 30% of the
  * total memory by default. It is tunable via proc entry, when it's set
  * to 0, the feature is disabled.
+ *
+ * Locks are reclaimed by a work item, one batch at a time while the low
+ * watermark is exceeded, from the exports holding more than their share
+ * of the locks of a namespace first, so that the clients holding a few
+ * locks keep them.
  */
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -66,6 +71,9 @@ static atomic_t			ldlm_nr_reclaimer;
 static s64			ldlm_last_reclaim_age_ns;
 static ktime_t			ldlm_last_reclaim_time;
 
+static void ldlm_reclaim_work_fn(struct work_struct *work);
+static DECLARE_WORK(ldlm_reclaim_work, ldlm_reclaim_work_fn);
+
 struct ldlm_reclaim_cb_data {
 	struct list_head	 rcd_rpc_list;
 	int			 rcd_added;
@@ -74,6 +82,8 @@ struct ldlm_reclaim_cb_data {
 	int			 rcd_start;
 	bool			 rcd_skip;
 	s64			 rcd_age_ns;
+	/* spare exports holding less locks than this, if not 0 */
+	__u64			 rcd_share;
 	struct cfs_hash_bd	*rcd_prev_bd;
 };
 
@@ -148,6 +158,12 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 					      data->rcd_age_ns)))
 			continue;
 
+		if (data->rcd_share != 0 && lock->l_export != NULL &&
+		    lock->l_export->exp_lock_hash != NULL &&
+		    cfs_hash_size_get(lock->l_export->exp_lock_hash) <
+		    data->rcd_share)
+			continue;
+
 		if (!ldlm_is_ast_sent(lock)) {
 			ldlm_set_ast_sent(lock);
 			LASSERT(list_empty(&lock->l_rk_ast));
@@ -174,13 +190,16 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
  * \param[in] skip	scan from the first lock on resource if the
  *			'skip' is false, otherwise, continue scan
  *			from the last scanned position
+ * \param[in] fair	only revoke locks of the exports holding more
+ *			than their share of the granted locks
  * \param[out] count	count of lock still to be revoked
  */
 static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
-			     s64 age_ns, bool skip)
+			     s64 age_ns, bool skip, bool fair)
 {
 	struct ldlm_reclaim_cb_data	data;
 	int				idx, type, start;
+	int				nr_exports;
 	ENTRY;
 
 	LASSERT(*count != 0);
@@ -204,14 +223,19 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 	data.rcd_age_ns = age_ns;
 	data.rcd_skip = skip;
 	data.rcd_prev_bd = NULL;
+	data.rcd_share = 0;
+	nr_exports = ns->ns_obd ? ns->ns_obd->obd_num_exports : 0;
+	if (fair && nr_exports > 1)
+		data.rcd_share = atomic_read(&ns->ns_pool.pl_granted) /
+				 nr_exports;
 	start = ns->ns_reclaim_start % CFS_HASH_NBKT(ns->ns_rs_hash);
 
 	cfs_hash_for_each_nolock(ns->ns_rs_hash, ldlm_reclaim_lock_cb, &data,
 				 start);
 
 	CDEBUG(D_DLMTRACE, "NS(%s): %d locks to be reclaimed, found %d/%d "
-	       "locks.\n", ldlm_ns_name(ns), *count, data.rcd_added,
-	       data.rcd_total);
+	       "locks, share %llu.\n", ldlm_ns_name(ns), *count,
+	       data.rcd_added, data.rcd_total, data.rcd_share);
 
 	LASSERTF(*count >= data.rcd_added, "count:%d, added:%d\n", *count,
 		 data.rcd_added);
@@ -243,7 +267,8 @@ static inline s64 ldlm_reclaim_age(void)
 /**
  * Revoke certain amount of locks from all the server namespaces
  * in a roundrobin manner. Lock age is used to avoid reclaim on
- * the non-aged locks.
+ * the non-aged locks, and the locks of the exports holding less than
+ * their share are only revoked if not enough other locks are found.
  */
 static void ldlm_reclaim_ns(void)
 {
@@ -253,6 +278,7 @@ static void ldlm_reclaim_ns(void)
 	enum ldlm_side		 ns_cli = LDLM_NAMESPACE_SERVER;
 	s64 age_ns;
 	bool			 skip = true;
+	bool			 fair = true;
 	ENTRY;
 
 	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
@@ -276,7 +302,7 @@ again:
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age_ns, skip);
+		ldlm_reclaim_res(ns, &count, age_ns, skip, fair);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
@@ -289,6 +315,11 @@ again:
 		goto again;
 	}
 
+	if (count > 0 && fair) {
+		fair = false;
+		goto again;
+	}
+
 	ldlm_last_reclaim_age_ns = age_ns;
 	ldlm_last_reclaim_time = ktime_get();
 out:
@@ -296,6 +327,11 @@ out:
 	EXIT;
 }
 
+static void ldlm_reclaim_work_fn(struct work_struct *work)
+{
+	ldlm_reclaim_ns();
+}
+
 void ldlm_reclaim_add(struct ldlm_lock *lock)
 {
 	if (!ldlm_lock_reclaimable(lock))
@@ -314,7 +350,7 @@ void ldlm_reclaim_del(struct ldlm_lock *lock)
 /**
  * Check on the total granted locks: return true if it reaches the
  * high watermark (ldlm_lock_limit), otherwise return false; It also
- * triggers lock reclaim if the low watermark (ldlm_reclaim_threshold)
+ * schedules lock reclaim if the low watermark (ldlm_reclaim_threshold)
  * is reached.
  *
  * \retval true		high watermark reached.
@@ -330,7 +366,7 @@ bool ldlm_reclaim_full(void)
 
 	if (low != 0 &&
 	    percpu_counter_sum_positive(&ldlm_granted_total) > low)
-		ldlm_reclaim_ns();
+		schedule_work(&ldlm_reclaim_work);
 
 	if (high != 0 && OBD_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_HIGH))
 		high = cfs_fail_val;
@@ -381,6 +417,7 @@ int ldlm_reclaim_setup(void)
 
 void ldlm_reclaim_cleanup(void)
 {
+	cancel_work_sync(&ldlm_reclaim_work);
 	percpu_counter_destroy(&ldlm_granted_total);
 }
 
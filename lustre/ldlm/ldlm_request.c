@@ -820,7 +820,7 @@ int ldlm_prep_elc_req(struct obd_export *exp, struct ptlrpc_request *req,
 
 		/* If we have reached the limit, free +1 slot for the new one */
 		if (!ns_connect_lru_resize(ns) && opc == LDLM_ENQUEUE &&
-		    ns->ns_nr_unused >= ns->ns_max_unused)
+		    ldlm_ns_nr_unused(ns) >= ns->ns_max_unused)
 			to_free = 1;
 
 		/* Cancel LRU locks here _only_ if the server supports
@@ -1571,14 +1571,21 @@ static enum ldlm_policy_res ldlm_cancel_lrur_policy(struct ldlm_namespace *ns,
 	lvf = ldlm_pool_get_lvf(pl);
 	la = div_u64(ktime_to_ns(ktime_sub(cur, lock->l_last_used)),
 		     NSEC_PER_SEC);
-	lv = lvf * la * ns->ns_nr_unused;
+	lv = lvf * la * ldlm_ns_nr_unused(ns);
 
 	/* Inform pool about current CLV to see it via debugfs. */
 	ldlm_pool_set_clv(pl, lv);
 
 	/* Stop when SLV is not yet come from server or lv is smaller than
 	 * it is. */
-	if (slv == 0 || lv < slv)
+	if (slv == 0)
+		return LDLM_POLICY_KEEP_LOCK;
+
+	/* With the "memory" pool policy, the locks without cached data are
+	 * cheap to cancel and go when their lv reaches half of the SLV. */
+	if (lv < slv &&
+	    (pl->pl_policy != LDLM_POOL_POLICY_MEMORY || lv < slv / 2 ||
+	     ns->ns_cancel == NULL || ns->ns_cancel(lock) == 0))
 		return LDLM_POLICY_KEEP_LOCK;
 
 	return LDLM_POLICY_CANCEL_LOCK;
@@ -1653,6 +1660,73 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
 	}
 }
 
+/* Number of locks taken from an LRU before looking for the oldest again */
+#define LDLM_LRU_BATCH	32
+
+/**
+ * Return the first lock of \a lru not being canceled, from the position of
+ * the previous scans if \a no_wait is set, removing the locks being canceled
+ * found on the way from \a lru.
+ * Must be called with ll_lock of \a lru held.
+ */
+static struct ldlm_lock *ldlm_lru_first(struct ldlm_lru *lru, int no_wait)
+{
+	struct list_head *item, *next;
+	struct ldlm_lock *lock;
+
+	item = no_wait ? lru->ll_last_pos : &lru->ll_list;
+	for (item = item->next, next = item->next;
+	     item != &lru->ll_list;
+	     item = next, next = item->next) {
+		lock = list_entry(item, struct ldlm_lock, l_lru);
+
+		/* No locks which got blocking requests. */
+		LASSERT(!ldlm_is_bl_ast(lock));
+
+		if (!ldlm_is_canceling(lock))
+			return lock;
+
+		/* Somebody is already doing CANCEL. No need for this
+		 * lock in LRU, do not traverse it again. */
+		ldlm_lock_remove_from_lru_nolock(lock);
+	}
+	return NULL;
+}
+
+/**
+ * Return the LRU of \a ns whose first lock is the least recently used, or
+ * NULL if all of them are empty.
+ *
+ * Every LRU is sorted by last use, so the locks of the namespace are taken in
+ * global LRU order while the LRU is changed at each lock. It is changed only
+ * every LDLM_LRU_BATCH locks instead though, which is only approximately
+ * ordered but does not lock all the LRUs for each lock.
+ */
+static struct ldlm_lru *ldlm_lru_oldest(struct ldlm_namespace *ns, int no_wait)
+{
+	struct ldlm_lru *oldest = NULL;
+	struct ldlm_lock *lock;
+	struct ldlm_lru *lru;
+	ktime_t last_used = ktime_set(0, 0);
+	int i;
+
+	cfs_percpt_for_each(lru, i, ns->ns_lru) {
+		if (READ_ONCE(lru->ll_nr) == 0)
+			continue;
+
+		spin_lock(&lru->ll_lock);
+		lock = ldlm_lru_first(lru, no_wait);
+		if (lock != NULL &&
+		    (oldest == NULL || ktime_before(lock->l_last_used,
+						    last_used))) {
+			oldest = lru;
+			last_used = lock->l_last_used;
+		}
+		spin_unlock(&lru->ll_lock);
+	}
+	return oldest;
+}
+
 /**
  * - Free space in LRU for \a min new locks,
  *   redundant unused locks are canceled locally;
@@ -1686,7 +1760,9 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 				 enum ldlm_lru_flags lru_flags)
 {
 	ldlm_cancel_lru_policy_t pf;
+	struct ldlm_lru *lru = NULL;
 	int added = 0;
+	int batch = 0;
 	int no_wait = lru_flags & LDLM_LRU_FLAG_NO_WAIT;
 
 	ENTRY;
@@ -1694,44 +1770,39 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	LASSERT(ergo(max, min <= max));
 
 	if (!ns_connect_lru_resize(ns))
-		min = max_t(int, min, ns->ns_nr_unused - ns->ns_max_unused);
+		min = max_t(int, min, ldlm_ns_nr_unused(ns) - ns->ns_max_unused);
 
 	pf = ldlm_cancel_lru_policy(ns, lru_flags);
 	LASSERT(pf != NULL);
 
 	/* For any flags, stop scanning if @max is reached. */
-	while (!list_empty(&ns->ns_unused_list) && (max == 0 || added < max)) {
+	while (max == 0 || added < max) {
 		struct ldlm_lock *lock;
-		struct list_head *item, *next;
 		enum ldlm_policy_res result;
 		ktime_t last_use = ktime_set(0, 0);
 
-		spin_lock(&ns->ns_lock);
-		item = no_wait ? ns->ns_last_pos : &ns->ns_unused_list;
-		for (item = item->next, next = item->next;
-		     item != &ns->ns_unused_list;
-		     item = next, next = item->next) {
-			lock = list_entry(item, struct ldlm_lock, l_lru);
-
-			/* No locks which got blocking requests. */
-			LASSERT(!ldlm_is_bl_ast(lock));
-
-			if (!ldlm_is_canceling(lock))
+		/* Take up to LDLM_LRU_BATCH locks from the LRU holding the
+		 * least recently used lock, then look for it again. */
+		if (lru == NULL || batch == LDLM_LRU_BATCH) {
+			lru = ldlm_lru_oldest(ns, no_wait);
+			if (lru == NULL)
 				break;
-
-			/* Somebody is already doing CANCEL. No need for this
-			 * lock in LRU, do not traverse it again. */
-			ldlm_lock_remove_from_lru_nolock(lock);
+			batch = 0;
 		}
-		if (item == &ns->ns_unused_list) {
-			spin_unlock(&ns->ns_lock);
-			break;
+		batch++;
+
+		spin_lock(&lru->ll_lock);
+		lock = ldlm_lru_first(lru, no_wait);
+		if (lock == NULL) {
+			spin_unlock(&lru->ll_lock);
+			lru = NULL;
+			continue;
 		}
 
 		last_use = lock->l_last_used;
 
 		LDLM_LOCK_GET(lock);
-		spin_unlock(&ns->ns_lock);
+		spin_unlock(&lru->ll_lock);
 		lu_ref_add(&lock->l_reference, __FUNCTION__, current);
 
 		/* Pass the lock through the policy filter and see if it
@@ -1757,11 +1828,11 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		if (result == LDLM_POLICY_SKIP_LOCK) {
 			lu_ref_del(&lock->l_reference, __func__, current);
 			if (no_wait) {
-				spin_lock(&ns->ns_lock);
+				spin_lock(&lru->ll_lock);
 				if (!list_empty(&lock->l_lru) &&
-				    lock->l_lru.prev == ns->ns_last_pos)
-					ns->ns_last_pos = &lock->l_lru;
-				spin_unlock(&ns->ns_lock);
+				    lock->l_lru.prev == lru->ll_last_pos)
+					lru->ll_last_pos = &lock->l_lru;
+				spin_unlock(&lru->ll_lock);
 			}
 
 			LDLM_LOCK_RELEASE(lock);
@@ -2328,16 +2399,17 @@ static int replay_one_lock(struct obd_import *imp, struct ldlm_lock *lock)
 static void ldlm_cancel_unused_locks_for_replay(struct ldlm_namespace *ns)
 {
 	int canceled;
+	int nr_unused = ldlm_ns_nr_unused(ns);
 	struct list_head cancels = LIST_HEAD_INIT(cancels);
 
 	CDEBUG(D_DLMTRACE, "Dropping as many unused locks as possible before"
 			   "replay for namespace %s (%d)\n",
-			   ldlm_ns_name(ns), ns->ns_nr_unused);
+			   ldlm_ns_name(ns), nr_unused);
 
 	/* We don't need to care whether or not LRU resize is enabled
 	 * because the LDLM_LRU_FLAG_NO_WAIT policy doesn't use the
 	 * count parameter */
-	canceled = ldlm_cancel_lru_local(ns, &cancels, ns->ns_nr_unused, 0,
+	canceled = ldlm_cancel_lru_local(ns, &cancels, nr_unused, 0,
 					 LCF_LOCAL, LDLM_LRU_FLAG_NO_WAIT);
 
 	CDEBUG(D_DLMTRACE, "Canceled %d unused locks from namespace %s\n",
@@ -42,6 +42,9 @@
 #include "ldlm_internal.h"
 
 struct kmem_cache *ldlm_resource_slab, *ldlm_lock_slab;
+struct cfs_mag_cache *ldlm_lock_mag;
+struct cfs_mag_cache *ldlm_resource_mag;
+struct cfs_mag_cache *ldlm_interval_tree_mag;
 struct kmem_cache *ldlm_interval_tree_slab;
 struct kmem_cache *ldlm_inodebits_slab;
 
@@ -326,7 +329,7 @@ static ssize_t lock_unused_count_show(struct kobject *kobj,
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
 
-	return sprintf(buf, "%d\n", ns->ns_nr_unused);
+	return sprintf(buf, "%d\n", ldlm_ns_nr_unused(ns));
 }
 LUSTRE_RO_ATTR(lock_unused_count);
 
@@ -335,11 +338,11 @@ static ssize_t lru_size_show(struct kobject *kobj, struct attribute *attr,
 {
 	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
 						 ns_kobj);
-	__u32 *nr = &ns->ns_max_unused;
+	__u32 nr = ns->ns_max_unused;
 
 	if (ns_connect_lru_resize(ns))
-		nr = &ns->ns_nr_unused;
-	return sprintf(buf, "%u\n", *nr);
+		nr = ldlm_ns_nr_unused(ns);
+	return sprintf(buf, "%u\n", nr);
 }
 
 static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
@@ -349,13 +352,14 @@ static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
 						 ns_kobj);
 	unsigned long tmp;
 	int lru_resize;
+	int nr_unused;
 	int err;
 
 	if (strncmp(buffer, "clear", 5) == 0) {
                 CDEBUG(D_DLMTRACE,
                        "dropping all unused locks from namespace %s\n",
                        ldlm_ns_name(ns));
-		/* Try to cancel all @ns_nr_unused locks. */
+		/* Try to cancel all unused locks. */
 		ldlm_cancel_lru(ns, INT_MAX, 0, LDLM_LRU_FLAG_CLEANUP);
 		return count;
 	}
@@ -371,14 +375,14 @@ static ssize_t lru_size_store(struct kobject *kobj, struct attribute *attr,
 		if (!lru_resize)
 			ns->ns_max_unused = (unsigned int)tmp;
 
-		if (tmp > ns->ns_nr_unused)
-			tmp = ns->ns_nr_unused;
-		tmp = ns->ns_nr_unused - tmp;
+		nr_unused = ldlm_ns_nr_unused(ns);
+		if (tmp > nr_unused)
+			tmp = nr_unused;
+		tmp = nr_unused - tmp;
 
 		CDEBUG(D_DLMTRACE,
 		       "changing namespace %s unused locks from %u to %u\n",
-		       ldlm_ns_name(ns), ns->ns_nr_unused,
-		       (unsigned int)tmp);
+		       ldlm_ns_name(ns), nr_unused, (unsigned int)tmp);
 
 		if (!lru_resize) {
 			CDEBUG(D_DLMTRACE,
@@ -847,6 +851,9 @@ static struct cfs_hash_ops ldlm_ns_fid_hash_ops = {
         .hs_put         = ldlm_res_hop_put
 };
 
+/* most extra hash bucket bits of the server namespaces on larger nodes */
+#define LDLM_NS_CPT_BKT_BITS_MAX	2
+
 typedef struct ldlm_ns_hash_def {
 	enum ldlm_ns_type	nsd_type;
 	/** hash bucket bits */
@@ -912,6 +919,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	struct ldlm_ns_bucket *nsb;
 	struct ldlm_ns_hash_def *nsd;
 	struct cfs_hash_bd bd;
+	struct ldlm_lru *lru;
+	unsigned int bkt_bits;
 	int idx;
 	int rc;
 	ENTRY;
@@ -939,9 +948,17 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         if (!ns)
                 GOTO(out_ref, NULL);
 
+	/* Server namespaces are looked up by service threads of all the CPTs,
+	 * give them more bucket locks to share on nodes with more CPTs. */
+	bkt_bits = nsd->nsd_bkt_bits;
+	if (client == LDLM_NAMESPACE_SERVER)
+		bkt_bits += min_t(unsigned int, LDLM_NS_CPT_BKT_BITS_MAX,
+				  order_base_2(cfs_cpt_number(cfs_cpt_table)));
+	bkt_bits = min(bkt_bits, nsd->nsd_all_bits);
+
         ns->ns_rs_hash = cfs_hash_create(name,
                                          nsd->nsd_all_bits, nsd->nsd_all_bits,
-                                         nsd->nsd_bkt_bits, sizeof(*nsb),
+                                         bkt_bits, sizeof(*nsb),
                                          CFS_HASH_MIN_THETA,
                                          CFS_HASH_MAX_THETA,
                                          nsd->nsd_hops,
@@ -966,8 +983,18 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	if (!ns->ns_name)
 		goto out_hash;
 
+	ns->ns_lru = cfs_percpt_alloc(cfs_cpt_table, sizeof(*lru));
+	if (ns->ns_lru == NULL)
+		GOTO(out_hash, NULL);
+
+	cfs_percpt_for_each(lru, idx, ns->ns_lru) {
+		spin_lock_init(&lru->ll_lock);
+		INIT_LIST_HEAD(&lru->ll_list);
+		lru->ll_nr = 0;
+		lru->ll_last_pos = &lru->ll_list;
+	}
+
 	INIT_LIST_HEAD(&ns->ns_list_chain);
-	INIT_LIST_HEAD(&ns->ns_unused_list);
 	spin_lock_init(&ns->ns_lock);
 	atomic_set(&ns->ns_bref, 0);
 	init_waitqueue_head(&ns->ns_waitq);
@@ -977,7 +1004,6 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
 
         ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
-        ns->ns_nr_unused          = 0;
         ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
 	ns->ns_max_age            = ktime_set(LDLM_DEFAULT_MAX_ALIVE, 0);
         ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
@@ -987,12 +1013,11 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
         ns->ns_connect_flags      = 0;
         ns->ns_stopping           = 0;
 	ns->ns_reclaim_start	  = 0;
-	ns->ns_last_pos		  = &ns->ns_unused_list;
 
 	rc = ldlm_namespace_sysfs_register(ns);
 	if (rc) {
 		CERROR("Can't initialize ns sysfs, rc %d\n", rc);
-		GOTO(out_hash, rc);
+		GOTO(out_lru, rc);
 	}
 
 	rc = ldlm_namespace_debugfs_register(ns);
@@ -1015,6 +1040,8 @@ out_proc:
 out_sysfs:
 	ldlm_namespace_sysfs_unregister(ns);
 	ldlm_namespace_cleanup(ns, 0);
+out_lru:
+	cfs_percpt_free(ns->ns_lru);
 out_hash:
 	kfree(ns->ns_name);
 	cfs_hash_putref(ns->ns_rs_hash);
@@ -1282,6 +1309,7 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 	ldlm_namespace_debugfs_unregister(ns);
 	ldlm_namespace_sysfs_unregister(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
+	cfs_percpt_free(ns->ns_lru);
 	kfree(ns->ns_name);
 	/* Namespace \a ns should be not on list at this time, otherwise
 	 * this will cause issues related to using freed \a ns in poold
@@ -1395,8 +1423,8 @@ static bool ldlm_resource_extent_new(struct ldlm_resource *res)
 {
 	int idx;
 
-	OBD_SLAB_ALLOC(res->lr_itree, ldlm_interval_tree_slab,
-		       sizeof(*res->lr_itree) * LCK_MODE_NUM);
+	OBD_MAG_ALLOC(res->lr_itree, ldlm_interval_tree_mag,
+		      sizeof(*res->lr_itree) * LCK_MODE_NUM);
 	if (res->lr_itree == NULL)
 		return false;
 	/* Initialize interval trees for each lock mode. */
@@ -1426,12 +1454,13 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 	struct ldlm_resource *res;
 	bool rc;
 
-	OBD_SLAB_ALLOC_PTR_GFP(res, ldlm_resource_slab, GFP_NOFS);
+	OBD_MAG_ALLOC_PTR(res, ldlm_resource_mag);
 	if (res == NULL)
 		return NULL;
 
 	switch (ldlm_type) {
 	case LDLM_EXTENT:
+	case LDLM_FLOCK:
 		rc = ldlm_resource_extent_new(res);
 		break;
 	case LDLM_IBITS:
@@ -1442,7 +1471,7 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 		break;
 	}
 	if (!rc) {
-		OBD_SLAB_FREE_PTR(res, ldlm_resource_slab);
+		OBD_MAG_FREE_PTR(res, ldlm_resource_mag);
 		return NULL;
 	}
 
@@ -1463,16 +1492,16 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 
 static void ldlm_resource_free(struct ldlm_resource *res)
 {
-	if (res->lr_type == LDLM_EXTENT) {
+	if (res->lr_type == LDLM_EXTENT || res->lr_type == LDLM_FLOCK) {
 		if (res->lr_itree != NULL)
-			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
+			OBD_MAG_FREE(res->lr_itree, ldlm_interval_tree_mag,
+				     sizeof(*res->lr_itree) * LCK_MODE_NUM);
 	} else if (res->lr_type == LDLM_IBITS) {
 		if (res->lr_ibits_queues != NULL)
 			OBD_FREE_PTR(res->lr_ibits_queues);
 	}
 
-	OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+	OBD_MAG_FREE_PTR(res, ldlm_resource_mag);
 }
 
 /**
@@ -1676,6 +1705,9 @@ void ldlm_resource_unlink_lock(struct ldlm_lock *lock)
 	case LDLM_IBITS:
 		ldlm_inodebits_unlink_lock(lock);
 		break;
+	case LDLM_FLOCK:
+		ldlm_flock_unlink_lock(lock);
+		break;
 	}
 	list_del_init(&lock->l_res_link);
 }
@@ -428,6 +428,27 @@ static int lfsck_prep(const struct lu_env *env, struct lfsck_instance *lfsck,
 			pos = &com->lc_pos_start;
 	}
 
+	/* The incremental OIT scan skips the objects not changed since the
+	 * last complete LFSCK of every component in the first-stage scanning,
+	 * which is only done on the MDT. */
+	lfsck->li_time_since = 0;
+	if (lfsck->li_master) {
+		time64_t since = 0;
+
+		list_for_each_entry(com, &lfsck->li_list_scan, lc_link) {
+			if (com->lc_time_since == 0) {
+				since = 0;
+				break;
+			}
+
+			if (since == 0 || com->lc_time_since < since)
+				since = com->lc_time_since;
+		}
+
+		if (since > LFSCK_INCREMENTAL_SKEW)
+			lfsck->li_time_since = since - LFSCK_INCREMENTAL_SKEW;
+	}
+
 	/* Init otable-based iterator. */
 	if (pos == NULL) {
 		rc = iops->load(env, lfsck->li_di_oit, 0);
@@ -815,6 +836,7 @@ static int lfsck_master_oit_engine(const struct lu_env *env,
 	struct ptlrpc_thread	 *thread = &lfsck->li_thread;
 	struct seq_server_site	 *ss	= lfsck_dev_site(lfsck);
 	__u32			 idx	= lfsck_dev_idx(lfsck);
+	struct lu_seq_range	 last_range = { 0 };
 	int			 rc;
 	ENTRY;
 
@@ -921,13 +943,24 @@ static int lfsck_master_oit_engine(const struct lu_env *env,
 		} else {
 			struct lu_seq_range *range = &info->lti_range;
 
-			if (lfsck->li_master)
-				fld_range_set_mdt(range);
-			else
-				fld_range_set_ost(range);
-			rc = fld_local_lookup(env, ss->ss_server_fld,
-					      fid_seq(fid), range);
-			if (rc != 0 || range->lsr_index != idx) {
+			/* The objects next to each other in the OI mostly
+			 * have FIDs of the same sequence, so the FLDB is only
+			 * looked up out of the range found the last time. */
+			if (!lu_seq_range_within(&last_range, fid_seq(fid))) {
+				if (lfsck->li_master)
+					fld_range_set_mdt(range);
+				else
+					fld_range_set_ost(range);
+				rc = fld_local_lookup(env, ss->ss_server_fld,
+						      fid_seq(fid), range);
+				if (rc != 0) {
+					rc = 0;
+					goto checkpoint;
+				}
+				last_range = *range;
+			}
+
+			if (last_range.lsr_index != idx) {
 				/* Remote object will be handled by the LFSCK
 				 * instance on the MDT where the remote object
 				 * really resides on. */
@@ -953,8 +986,15 @@ static int lfsck_master_oit_engine(const struct lu_env *env,
 			struct lu_attr la = { .la_valid = 0 };
 
 			rc = dt_attr_get(env, target, &la);
-			if (likely(!rc && (!(la.la_valid & LA_FLAGS) ||
-					   !(la.la_flags & LUSTRE_ORPHAN_FL))))
+			if (!rc && lfsck->li_time_since != 0 &&
+			    la.la_valid & LA_CTIME &&
+			    la.la_ctime < lfsck->li_time_since)
+				/* Not changed since the last complete LFSCK,
+				 * skip it (and its name entries if it is a
+				 * directory) for the incremental LFSCK. */
+				rc = 0;
+			else if (likely(!rc && (!(la.la_valid & LA_FLAGS) ||
+					!(la.la_flags & LUSTRE_ORPHAN_FL))))
 				rc = lfsck_exec_oit(env, lfsck, target);
 			else
 				CDEBUG(D_INFO,
@@ -46,6 +46,11 @@
 
 #define LFSCK_CHECKPOINT_INTERVAL	60
 
+/* The incremental LFSCK checks the objects changed a bit earlier than the
+ * last complete LFSCK started, for the clock skew of the clients setting the
+ * ctime of the objects. */
+#define LFSCK_INCREMENTAL_SKEW		600
+
 enum lfsck_flags {
 	/* Finish the first cycle scanning. */
 	LF_SCANNED_ONCE		= 0x00000001ULL,
@@ -282,8 +287,13 @@ struct lfsck_namespace {
 	/* How many agent entries have been repaired. */
 	__u64	ln_agent_entries_repaired;
 
+	/* The ln_time_latest_reset of the last LFSCK completed without failure,
+	 * zero if unknown. The objects not changed since then are skipped by
+	 * the incremental LFSCK. */
+	time64_t ln_time_last_complete_reset;
+
 	/* For further using. 256-bytes aligned now. */
-	__u64   ln_reserved[11];
+	__u64   ln_reserved[10];
 };
 
 enum lfsck_layout_inconsistency_type {
@@ -364,8 +374,15 @@ struct lfsck_layout {
 	/* The latest object has been processed (failed) during double scan. */
 	struct lfsck_layout_dangling_key ll_lldk_latest_scanned_phase2;
 
+	/* Time for the latest LFSCK scan in seconds from the beginning. */
+	time64_t ll_time_latest_reset;
+
+	/* The ll_time_latest_reset of the last LFSCK completed without failure,
+	 * zero if unknown. */
+	time64_t ll_time_last_complete_reset;
+
 	/* For further using */
-	u64	ll_reserved_2[7];
+	u64	ll_reserved_2[5];
 
 	/* The OST targets bitmap to record the OSTs that contain
 	 * non-verified OST-objects. */
@@ -567,6 +584,10 @@ struct lfsck_component {
 	/* The time for next checkpoint, seconds */
 	time64_t		 lc_time_next_checkpoint;
 
+	/* The objects not changed since then need not be checked by the
+	 * incremental LFSCK, zero for the full scan. */
+	time64_t		 lc_time_since;
+
 	__u32			 lc_file_size;
 
 	/* How many objects have been checked since last checkpoint. */
@@ -683,6 +704,9 @@ struct lfsck_instance {
 	/* The time for next checkpoint, seconds */
 	time64_t		  li_time_next_checkpoint;
 
+	/* The OIT scan skips the objects with older ctime, zero for none. */
+	time64_t		  li_time_since;
+
 	lfsck_out_notify	  li_out_notify;
 	void			 *li_out_notify_data;
 	struct dt_device	 *li_next;
@@ -826,6 +826,9 @@ static void lfsck_layout_le_to_cpu(struct lfsck_layout *des,
 	des->ll_bitmap_size = le32_to_cpu(src->ll_bitmap_size);
 	lldk_le_to_cpu(&des->ll_lldk_latest_scanned_phase2,
 		       &src->ll_lldk_latest_scanned_phase2);
+	des->ll_time_latest_reset = le64_to_cpu(src->ll_time_latest_reset);
+	des->ll_time_last_complete_reset =
+				le64_to_cpu(src->ll_time_last_complete_reset);
 }
 
 static void lfsck_layout_cpu_to_le(struct lfsck_layout *des,
@@ -858,6 +861,9 @@ static void lfsck_layout_cpu_to_le(struct lfsck_layout *des,
 	des->ll_bitmap_size = cpu_to_le32(src->ll_bitmap_size);
 	lldk_cpu_to_le(&des->ll_lldk_latest_scanned_phase2,
 		       &src->ll_lldk_latest_scanned_phase2);
+	des->ll_time_latest_reset = cpu_to_le64(src->ll_time_latest_reset);
+	des->ll_time_last_complete_reset =
+				cpu_to_le64(src->ll_time_last_complete_reset);
 }
 
 /**
@@ -1075,6 +1081,7 @@ static int lfsck_layout_init(const struct lu_env *env,
 	memset(lo, 0, com->lc_file_size);
 	lo->ll_magic = LFSCK_LAYOUT_MAGIC;
 	lo->ll_status = LS_INIT;
+	lo->ll_time_latest_reset = ktime_get_real_seconds();
 	down_write(&com->lc_sem);
 	rc = lfsck_layout_store(env, com);
 	if (rc == 0 && com->lc_lfsck->li_master)
@@ -1479,6 +1486,14 @@ static int lfsck_layout_double_scan_result(const struct lu_env *env,
 		if (!(lfsck->li_bookmark_ram.lb_param & LPF_DRYRUN))
 			lo->ll_flags &= ~LF_INCONSISTENT;
 		lo->ll_time_last_complete = lo->ll_time_last_checkpoint;
+		if (lo->ll_status == LS_COMPLETED &&
+		    !(lo->ll_flags & LF_INCONSISTENT) &&
+		    lo->ll_objs_failed_phase1 == 0 &&
+		    lo->ll_objs_failed_phase2 == 0)
+			lo->ll_time_last_complete_reset =
+						lo->ll_time_latest_reset;
+		else
+			lo->ll_time_last_complete_reset = 0;
 		lo->ll_success_count++;
 	} else if (rc == 0) {
 		if (lfsck->li_status != 0)
@@ -5064,14 +5079,17 @@ static int lfsck_layout_reset(const struct lu_env *env,
 	} else {
 		__u32 count = lo->ll_success_count;
 		time64_t last_time = lo->ll_time_last_complete;
+		time64_t last_reset = lo->ll_time_last_complete_reset;
 
 		memset(lo, 0, com->lc_file_size);
 		lo->ll_success_count = count;
 		lo->ll_time_last_complete = last_time;
+		lo->ll_time_last_complete_reset = last_reset;
 	}
 
 	lo->ll_magic = LFSCK_LAYOUT_MAGIC;
 	lo->ll_status = LS_INIT;
+	lo->ll_time_latest_reset = ktime_get_real_seconds();
 
 	if (com->lc_lfsck->li_master) {
 		struct lfsck_assistant_data *lad = com->lc_data;
@@ -5205,6 +5223,13 @@ static int lfsck_layout_prep(const struct lu_env *env,
 
 	down_write(&com->lc_sem);
 	lo->ll_time_latest_start = ktime_get_real_seconds();
+	/* The orphan OST-objects can only be found by the full scan. */
+	if (start != NULL &&
+	    (start->ls_flags & (LPF_INCREMENTAL | LPF_OST_ORPHAN)) ==
+	    LPF_INCREMENTAL)
+		com->lc_time_since = lo->ll_time_last_complete_reset;
+	else
+		com->lc_time_since = 0;
 	spin_lock(&lfsck->li_lock);
 	if (lo->ll_flags & LF_SCANNED_ONCE) {
 		if (!lfsck->li_drop_dryrun ||
@@ -168,6 +168,8 @@ static void lfsck_namespace_le_to_cpu(struct lfsck_namespace *dst,
 				le64_to_cpu(src->ln_linkea_overflow_cleared);
 	dst->ln_agent_entries_repaired =
 				le64_to_cpu(src->ln_agent_entries_repaired);
+	dst->ln_time_last_complete_reset =
+				le64_to_cpu(src->ln_time_last_complete_reset);
 }
 
 static void lfsck_namespace_cpu_to_le(struct lfsck_namespace *dst,
@@ -242,6 +244,8 @@ static void lfsck_namespace_cpu_to_le(struct lfsck_namespace *dst,
 				cpu_to_le64(src->ln_linkea_overflow_cleared);
 	dst->ln_agent_entries_repaired =
 				cpu_to_le64(src->ln_agent_entries_repaired);
+	dst->ln_time_last_complete_reset =
+				cpu_to_le64(src->ln_time_last_complete_reset);
 }
 
 static void lfsck_namespace_record_failure(const struct lu_env *env,
@@ -4089,10 +4093,12 @@ static int lfsck_namespace_reset(const struct lu_env *env,
 	} else {
 		__u32 count = ns->ln_success_count;
 		time64_t last_time = ns->ln_time_last_complete;
+		time64_t last_reset = ns->ln_time_last_complete_reset;
 
 		memset(ns, 0, sizeof(*ns));
 		ns->ln_success_count = count;
 		ns->ln_time_last_complete = last_time;
+		ns->ln_time_last_complete_reset = last_reset;
 	}
 	ns->ln_magic = LFSCK_NAMESPACE_MAGIC;
 	ns->ln_status = LS_INIT;
@@ -4303,6 +4309,11 @@ static int lfsck_namespace_prep(const struct lu_env *env,
 
 	down_write(&com->lc_sem);
 	ns->ln_time_latest_start = ktime_get_real_seconds();
+	if (lsp->lsp_start != NULL &&
+	    lsp->lsp_start->ls_flags & LPF_INCREMENTAL)
+		com->lc_time_since = ns->ln_time_last_complete_reset;
+	else
+		com->lc_time_since = 0;
 	spin_lock(&lfsck->li_lock);
 
 	if (ns->ln_flags & LF_SCANNED_ONCE) {
@@ -6507,6 +6518,13 @@ static int lfsck_namespace_double_scan_result(const struct lu_env *env,
 		if (!(lfsck->li_bookmark_ram.lb_param & LPF_DRYRUN))
 			ns->ln_flags &= ~LF_INCONSISTENT;
 		ns->ln_time_last_complete = ns->ln_time_last_checkpoint;
+		if (ns->ln_status == LS_COMPLETED &&
+		    !(ns->ln_flags & LF_INCONSISTENT) &&
+		    ns->ln_items_failed == 0 && ns->ln_objs_failed_phase2 == 0)
+			ns->ln_time_last_complete_reset =
+						ns->ln_time_latest_reset;
+		else
+			ns->ln_time_last_complete_reset = 0;
 		ns->ln_success_count++;
 	} else if (rc == 0) {
 		if (lfsck->li_status != 0)
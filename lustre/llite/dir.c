@@ -34,9 +34,11 @@
  * Directory code for lustre client.
  */
 
+#include <linux/bsearch.h>
 #include <linux/fs.h>
 #include <linux/pagemap.h>
 #include <linux/mm.h>
+#include <linux/sort.h>
 #include <linux/version.h>
 #include <linux/security.h>
 #include <linux/user_namespace.h>
@@ -201,6 +203,187 @@ static u16 ll_dirent_type_get(struct lu_dirent *ent)
 	return type;
 }
 
+/*
+ * Index of the names of the dirents of a dir, filled by a readdir from the
+ * start to the end of the dir, so that the lookups of names which are not in
+ * the dir are answered without RPC while the UPDATE lock of the dir is held.
+ * Only the hashes of the names are kept: a name found in the index may still
+ * not exist, it is looked up on the MDT as usual.
+ */
+struct ll_dir_names {
+	/* readdir position the index is filled up to */
+	__u64		 ldn_pos;
+	/* lli_dir_names_gen when filling started */
+	unsigned int	 ldn_gen;
+	unsigned int	 ldn_count;
+	unsigned int	 ldn_size;
+	__u32		*ldn_hashes;
+};
+
+static int ll_dir_names_cmp(const void *a, const void *b)
+{
+	__u32 ha = *(const __u32 *)a;
+	__u32 hb = *(const __u32 *)b;
+
+	return ha < hb ? -1 : ha > hb;
+}
+
+static void ll_dir_names_free(struct ll_dir_names *names)
+{
+	if (names == NULL)
+		return;
+
+	if (names->ldn_hashes != NULL)
+		OBD_FREE_LARGE(names->ldn_hashes,
+			       names->ldn_size * sizeof(__u32));
+	OBD_FREE_PTR(names);
+}
+
+/* start to fill the name index of @dir if @pos is 0, or continue at @pos */
+static struct ll_dir_names *ll_dir_names_get(struct inode *dir, __u64 pos)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_dir_names *names;
+	unsigned int gen;
+
+	if (ll_i2sbi(dir)->ll_dir_names_max == 0 || lli->lli_lsm_md != NULL)
+		return NULL;
+
+	spin_lock(&lli->lli_dir_names_lock);
+	names = lli->lli_dir_names_fill;
+	if (names != NULL && names->ldn_pos == pos) {
+		lli->lli_dir_names_fill = NULL;
+		spin_unlock(&lli->lli_dir_names_lock);
+		return names;
+	}
+
+	if (pos != 0 || lli->lli_dir_names != NULL) {
+		spin_unlock(&lli->lli_dir_names_lock);
+		return NULL;
+	}
+	gen = lli->lli_dir_names_gen;
+	spin_unlock(&lli->lli_dir_names_lock);
+
+	OBD_ALLOC_PTR(names);
+	if (names != NULL)
+		names->ldn_gen = gen;
+
+	return names;
+}
+
+/* add @name to @names, which is freed if @dir has too many dirents */
+static struct ll_dir_names *ll_dir_names_add(struct inode *dir,
+					     struct ll_dir_names *names,
+					     const char *name, int len)
+{
+	unsigned int max = ll_i2sbi(dir)->ll_dir_names_max;
+
+	if (names->ldn_count == names->ldn_size) {
+		unsigned int size;
+		__u32 *hashes;
+
+		if (names->ldn_count >= max) {
+			ll_dir_names_free(names);
+			return NULL;
+		}
+
+		size = min(max(2 * names->ldn_size, 256U), max);
+		OBD_ALLOC_LARGE(hashes, size * sizeof(__u32));
+		if (hashes == NULL) {
+			ll_dir_names_free(names);
+			return NULL;
+		}
+
+		if (names->ldn_hashes != NULL) {
+			memcpy(hashes, names->ldn_hashes,
+			       names->ldn_count * sizeof(__u32));
+			OBD_FREE_LARGE(names->ldn_hashes,
+				       names->ldn_size * sizeof(__u32));
+		}
+		names->ldn_hashes = hashes;
+		names->ldn_size = size;
+	}
+
+	names->ldn_hashes[names->ldn_count++] =
+		ll_full_name_hash(NULL, name, len);
+
+	return names;
+}
+
+/* @names is filled up to @pos, which is MDS_DIR_END_OFF at the end of @dir */
+static void ll_dir_names_put(struct inode *dir, struct ll_dir_names *names,
+			     __u64 pos)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_dir_names *old;
+
+	names->ldn_pos = pos;
+	if (pos == MDS_DIR_END_OFF)
+		sort(names->ldn_hashes, names->ldn_count, sizeof(__u32),
+		     ll_dir_names_cmp, NULL);
+
+	spin_lock(&lli->lli_dir_names_lock);
+	if (names->ldn_gen != lli->lli_dir_names_gen) {
+		/* the UPDATE lock was lost, the dirents may have changed */
+		old = names;
+	} else if (pos == MDS_DIR_END_OFF) {
+		old = lli->lli_dir_names;
+		lli->lli_dir_names = names;
+	} else {
+		old = lli->lli_dir_names_fill;
+		lli->lli_dir_names_fill = names;
+	}
+	spin_unlock(&lli->lli_dir_names_lock);
+
+	ll_dir_names_free(old);
+}
+
+/* drop the name index of @dir, called when its UPDATE lock is cancelled */
+void ll_dir_names_invalidate(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_dir_names *names;
+	struct ll_dir_names *fill;
+
+	spin_lock(&lli->lli_dir_names_lock);
+	lli->lli_dir_names_gen++;
+	names = lli->lli_dir_names;
+	fill = lli->lli_dir_names_fill;
+	lli->lli_dir_names = NULL;
+	lli->lli_dir_names_fill = NULL;
+	spin_unlock(&lli->lli_dir_names_lock);
+
+	ll_dir_names_free(names);
+	ll_dir_names_free(fill);
+}
+
+/**
+ * Check whether \a qstr is not in \a dir according to its name index.
+ *
+ * \retval true if \a qstr surely does not exist
+ * \retval false if it may exist, or there is no name index
+ */
+bool ll_dir_name_absent(struct inode *dir, const struct qstr *qstr)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_dir_names *names;
+	bool absent = false;
+	__u32 hash;
+
+	if (lli->lli_dir_names == NULL)
+		return false;
+
+	hash = ll_full_name_hash(NULL, (const char *)qstr->name, qstr->len);
+	spin_lock(&lli->lli_dir_names_lock);
+	names = lli->lli_dir_names;
+	if (names != NULL)
+		absent = bsearch(&hash, names->ldn_hashes, names->ldn_count,
+				 sizeof(__u32), ll_dir_names_cmp) == NULL;
+	spin_unlock(&lli->lli_dir_names_lock);
+
+	return absent;
+}
+
 #ifdef HAVE_DIR_CONTEXT
 int ll_dir_read(struct inode *inode, __u64 *ppos, struct md_op_data *op_data,
 		struct dir_context *ctx)
@@ -216,12 +399,15 @@ int ll_dir_read(struct inode *inode, __u64 *ppos, struct md_op_data *op_data,
 	bool                  is_hash64 = sbi->ll_flags & LL_SBI_64BIT_HASH;
 	struct page          *page;
 	struct ll_dir_chain   chain;
+	struct ll_dir_names  *names;
 	bool                  done = false;
 	int                   rc = 0;
 	ENTRY;
 
 	ll_dir_chain_init(&chain);
 
+	names = ll_dir_names_get(inode, pos);
+
 	page = ll_get_dir_page(inode, op_data, pos, &chain);
 
 	while (rc == 0 && !done) {
@@ -271,6 +457,10 @@ int ll_dir_read(struct inode *inode, __u64 *ppos, struct md_op_data *op_data,
 			done = filldir(cookie, ent->lde_name, namelen, lhash,
 				       ino, type);
 #endif
+			if (!done && names != NULL)
+				names = ll_dir_names_add(inode, names,
+							 ent->lde_name,
+							 namelen);
 		}
 
 		if (done) {
@@ -300,6 +490,13 @@ int ll_dir_read(struct inode *inode, __u64 *ppos, struct md_op_data *op_data,
 					       &chain);
 		}
 	}
+
+	if (names != NULL) {
+		if (rc == 0)
+			ll_dir_names_put(inode, names, pos);
+		else
+			ll_dir_names_free(names);
+	}
 #ifdef HAVE_DIR_CONTEXT
 	ctx->pos = pos;
 #else
@@ -58,6 +58,11 @@ struct split_param {
 	__u16		sp_mirror_id;
 };
 
+struct pcc_param {
+	__u64		pa_data_version;
+	__u32		pa_archive_id;
+};
+
 static int
 ll_put_grouplock(struct inode *inode, struct file *file, unsigned long arg);
 
@@ -191,6 +196,13 @@ static int ll_close_inode_openhandle(struct inode *inode,
 		break;
 	}
 
+	case MDS_CLOSE_STRICT_SOM:
+		/* the size gathered by ll_close_sync_size() */
+		op_data->op_bias |= MDS_CLOSE_STRICT_SOM;
+		op_data->op_attr.ia_valid |= ATTR_SIZE;
+		op_data->op_xvalid |= OP_XVALID_BLOCKS;
+		break;
+
 	case MDS_HSM_RELEASE:
 		LASSERT(data != NULL);
 		op_data->op_bias |= MDS_HSM_RELEASE;
@@ -200,6 +212,19 @@ static int ll_close_inode_openhandle(struct inode *inode,
 		op_data->op_xvalid |= OP_XVALID_BLOCKS;
 		break;
 
+	case MDS_PCC_ATTACH: {
+		struct pcc_param *param = data;
+
+		LASSERT(data != NULL);
+		op_data->op_bias |= MDS_HSM_RELEASE | MDS_PCC_ATTACH;
+		op_data->op_data_version = param->pa_data_version;
+		op_data->op_archive_id = param->pa_archive_id;
+		op_data->op_lease_handle = och->och_lease_handle;
+		op_data->op_attr.ia_valid |= ATTR_SIZE;
+		op_data->op_xvalid |= OP_XVALID_BLOCKS;
+		break;
+	}
+
 	default:
 		LASSERT(data == NULL);
 		break;
@@ -235,7 +260,23 @@ out:
 	return rc;
 }
 
-int ll_md_real_close(struct inode *inode, fmode_t fmode)
+/*
+ * Flush the dirty pages of \a inode and gather its size from the OSTs, for
+ * the MDT to keep it as the strict SOM of the file once closed.
+ */
+static int ll_close_sync_size(struct inode *inode)
+{
+	int rc;
+
+	rc = filemap_write_and_wait(inode->i_mapping);
+	if (rc == 0)
+		rc = ll_glimpse_size(inode);
+
+	return rc;
+}
+
+static int ll_md_och_close(struct inode *inode, fmode_t fmode,
+			   enum mds_op_bias bias)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
 	struct obd_client_handle **och_p;
@@ -269,14 +310,24 @@ int ll_md_real_close(struct inode *inode, fmode_t fmode)
 	mutex_unlock(&lli->lli_och_mutex);
 
 	if (och != NULL) {
+		/* new writers open another handle, the size gathered here
+		 * is only trusted by the MDT if there are none
+		 */
+		if (bias == MDS_CLOSE_STRICT_SOM && ll_close_sync_size(inode))
+			bias = 0;
 		/* There might be a race and this handle may already
 		 * be closed. */
-		rc = ll_close_inode_openhandle(inode, och, 0, NULL);
+		rc = ll_close_inode_openhandle(inode, och, bias, NULL);
 	}
 
 	RETURN(rc);
 }
 
+int ll_md_real_close(struct inode *inode, fmode_t fmode)
+{
+	return ll_md_och_close(inode, fmode, 0);
+}
+
 static int ll_md_close(struct inode *inode, struct file *file)
 {
 	union ldlm_policy_data policy = {
@@ -287,6 +338,7 @@ static int ll_md_close(struct inode *inode, struct file *file)
 	struct ll_inode_info *lli = ll_i2info(inode);
 	struct lustre_handle lockh;
 	enum ldlm_mode lockmode;
+	bool strict_som;
 	int rc = 0;
 	ENTRY;
 
@@ -330,11 +382,18 @@ static int ll_md_close(struct inode *inode, struct file *file)
 	}
 	mutex_unlock(&lli->lli_och_mutex);
 
+	/* a cached write open lock keeps the file open for the MDT, which
+	 * then cannot make its size strict
+	 */
+	strict_som = lockmode == LCK_CW && S_ISREG(inode->i_mode) &&
+		     ll_sbi_has_strict_som(ll_i2sbi(inode));
+
 	/* LU-4398: do not cache write open lock if the file has exec bit */
-	if ((lockmode == LCK_CW && inode->i_mode & S_IXUGO) ||
+	if ((lockmode == LCK_CW && inode->i_mode & S_IXUGO) || strict_som ||
 	    !md_lock_match(ll_i2mdexp(inode), flags, ll_inode2fid(inode),
 			   LDLM_IBITS, &policy, lockmode, &lockh))
-		rc = ll_md_real_close(inode, fd->fd_omode);
+		rc = ll_md_och_close(inode, fd->fd_omode,
+				     strict_som ? MDS_CLOSE_STRICT_SOM : 0);
 
 out:
 	LUSTRE_FPRIVATE(file) = NULL;
@@ -446,9 +505,12 @@ void ll_dom_finish_open(struct inode *inode, struct ptlrpc_request *req)
 
 	/* Server returns whole file or just file tail if it fills in reply
 	 * buffer, in both cases total size should be equal to the file size.
+	 * It may also return whole pages of the file head to a reader.
 	 */
 	body = req_capsule_server_get(&req->rq_pill, &RMF_MDT_BODY);
-	if (rnb->rnb_offset + rnb->rnb_len != body->mbo_dom_size) {
+	if (rnb->rnb_offset + rnb->rnb_len != body->mbo_dom_size &&
+	    (rnb->rnb_offset != 0 || rnb->rnb_len % PAGE_SIZE ||
+	     rnb->rnb_len > body->mbo_dom_size)) {
 		CERROR("%s: server returns off/len %llu/%u but size %llu\n",
 		       ll_get_fsname(inode->i_sb, NULL, 0), rnb->rnb_offset,
 		       rnb->rnb_len, body->mbo_dom_size);
@@ -670,7 +732,7 @@ static int ll_local_open(struct file *file, struct lookup_intent *it,
 	}
 
 	LUSTRE_FPRIVATE(file) = fd;
-	ll_readahead_init(inode, &fd->fd_ras);
+	ll_ras_init(inode, fd);
 	fd->fd_omode = it->it_flags & (FMODE_READ | FMODE_WRITE | FMODE_EXEC);
 
 	/* ll_cl_context initialize */
@@ -680,6 +742,45 @@ static int ll_local_open(struct file *file, struct lookup_intent *it,
 	RETURN(0);
 }
 
+/*
+ * Count the opens of \a inode which follow each other closely.
+ * Called under lli_och_mutex after each successful open.
+ */
+static void ll_track_file_opens(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	ktime_t now = ktime_get();
+
+	if (ktime_ms_delta(now, lli->lli_open_last_time) > sbi->ll_oc_thrsh_ms)
+		lli->lli_open_thrsh_count = 1;
+	else if (lli->lli_open_thrsh_count < UINT_MAX)
+		lli->lli_open_thrsh_count++;
+	lli->lli_open_last_time = now;
+}
+
+/*
+ * A regular file opened for read often enough in a row is asked an open lock
+ * for. Its open handle then stays cached after the last close, so that the
+ * next opens and closes do not go to the MDT until the lock is cancelled.
+ * Opens for write do not ask for it, since a cached write open lock keeps
+ * the file open for the MDT.
+ */
+static bool ll_open_lock_wanted(struct inode *inode, __u64 open_flags)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+
+	if (!S_ISREG(inode->i_mode) || open_flags & FMODE_WRITE ||
+	    sbi->ll_oc_thrsh_count == 0)
+		return false;
+
+	/* unlocked, a race only delays or speeds up the open lock request */
+	return lli->lli_open_thrsh_count >= sbi->ll_oc_thrsh_count &&
+	       ktime_ms_delta(ktime_get(), lli->lli_open_last_time) <=
+	       sbi->ll_oc_thrsh_ms;
+}
+
 /* Open a file, and (for the very first open) create objects on the OSTs at
  * this time.  If opened with O_LOV_DELAY_CREATE, then we don't do the object
  * creation or open until ll_lov_setstripe() ioctl is called.
@@ -807,6 +908,8 @@ restart:
 			 *  Only fetch MDS_OPEN_LOCK if this is in NFS path,
 			 *  marked by a bit set in ll_iget_for_nfs. Clear the
 			 *  bit so that it's not confusing later callers.
+			 *  Also fetch it for a file opened often, see
+			 *  ll_open_lock_wanted().
 			 *
 			 *  NB; when ldd is NULL, it must have come via normal
 			 *  lookup path only, since ll_iget_for_nfs always calls
@@ -815,6 +918,8 @@ restart:
 			if (ldd && ldd->lld_nfs_dentry) {
 				ldd->lld_nfs_dentry = 0;
 				it->it_flags |= MDS_OPEN_LOCK;
+			} else if (ll_open_lock_wanted(inode, it->it_flags)) {
+				it->it_flags |= MDS_OPEN_LOCK;
 			}
 
 			 /*
@@ -852,6 +957,7 @@ restart:
 		if (rc)
 			GOTO(out_och_free, rc);
 	}
+	ll_track_file_opens(inode);
 	mutex_unlock(&lli->lli_och_mutex);
         fd = NULL;
 
@@ -862,6 +968,7 @@ restart:
                 GOTO(out_och_free, rc);
 
 	cl_lov_delay_create_clear(&file->f_flags);
+	pcc_inode_open(inode);
 	GOTO(out_och_free, rc);
 
 out_och_free:
@@ -1386,7 +1493,7 @@ static bool file_is_noatime(const struct file *file)
 	return false;
 }
 
-static void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot)
+void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot)
 {
 	struct inode *inode = file_inode(file);
 	struct ll_file_data *fd  = LUSTRE_FPRIVATE(file);
@@ -1409,6 +1516,7 @@ static void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot)
 		io->ci_lockreq = CILR_MANDATORY;
 	}
 	io->ci_noatime = file_is_noatime(file);
+	io->ci_dio = !!(file->f_flags & O_DIRECT);
 
 	/* FLR: only use non-delay I/O for read as there is only one
 	 * avaliable mirror for write. */
@@ -1426,6 +1534,7 @@ ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 	struct inode		*inode = file_inode(file);
 	struct ll_inode_info	*lli = ll_i2info(inode);
 	struct ll_file_data	*fd  = LUSTRE_FPRIVATE(file);
+	struct ll_dio_aio	*aio = NULL;
 	struct range_lock	range;
 	struct cl_io		*io;
 	ssize_t			result = 0;
@@ -1439,10 +1548,22 @@ ll_file_io_generic(const struct lu_env *env, struct vvp_io_args *args,
 		file_dentry(file)->d_name.name,
 		iot == CIT_READ ? "read" : "write", *ppos, count);
 
+	/* Direct IO of an asynchronous iocb completes it when the pages are
+	 * transferred instead of waiting for them. It is done lockless, the
+	 * OSTs locking the extents instead, as the DLM locks are released
+	 * before the transfer is done. */
+	if (args->via_io_subtype == IO_NORMAL && file->f_flags & O_DIRECT &&
+	    !is_sync_kiocb(args->u.normal.via_iocb) &&
+	    !(file->f_flags & O_APPEND) &&
+	    !(fd->fd_flags & LL_FILE_GROUP_LOCKED))
+		aio = ll_dio_aio_alloc(args->u.normal.via_iocb, iot);
+
 restart:
 	io = vvp_env_thread_io(env);
 	ll_io_init(io, file, iot);
 	io->ci_ndelay_tried = retried;
+	if (aio != NULL)
+		io->ci_lockreq = CILR_NEVER;
 
 	if (cl_io_rw_init(env, io, iot, *ppos, count) == 0) {
 		bool range_locked = false;
@@ -1454,11 +1575,13 @@ restart:
 
 		vio->vui_fd  = LUSTRE_FPRIVATE(file);
 		vio->vui_io_subtype = args->via_io_subtype;
+		vio->vui_aio = NULL;
 
 		switch (vio->vui_io_subtype) {
 		case IO_NORMAL:
 			vio->vui_iter = args->u.normal.via_iter;
 			vio->vui_iocb = args->u.normal.via_iocb;
+			vio->vui_aio = aio;
 			/* Direct IO reads must also take range lock,
 			 * or multiple reads will try to work on the same pages
 			 * See LU-6227 for details. */
@@ -1548,6 +1671,12 @@ out:
 
 	CDEBUG(D_VFSTRACE, "iot: %d, result: %zd\n", iot, result);
 
+	if (aio != NULL) {
+		result = ll_dio_aio_done(env, aio, result > 0 ? result : rc);
+		if (result <= 0)
+			rc = result;
+	}
+
 	RETURN(result > 0 ? result : rc);
 }
 
@@ -1625,10 +1754,15 @@ static ssize_t ll_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	ssize_t result;
 	ssize_t rc2;
 	__u16 refcheck;
+	bool cached;
 
 	if (!iov_iter_count(to))
 		return 0;
 
+	result = pcc_file_read_iter(iocb, to, &cached);
+	if (cached)
+		GOTO(out, result);
+
 	result = ll_do_fast_read(iocb, to);
 	if (result < 0 || iov_iter_count(to) == 0)
 		GOTO(out, result);
@@ -1726,12 +1860,17 @@ static ssize_t ll_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	ssize_t rc_tiny = 0, rc_normal;
 	struct file *file = iocb->ki_filp;
 	__u16 refcheck;
+	bool cached;
 
 	ENTRY;
 
 	if (!iov_iter_count(from))
 		GOTO(out, rc_normal = 0);
 
+	rc_normal = pcc_file_write_iter(iocb, from, &cached);
+	if (cached)
+		GOTO(out, rc_normal);
+
 	/* NB: we can't do direct IO for tiny writes because they use the page
 	 * cache, we can't do sync writes because tiny writes can't flush
 	 * pages, and we can't do append writes because we can't guarantee the
@@ -1918,6 +2057,42 @@ static ssize_t ll_file_write(struct file *file, const char __user *buf,
 }
 #endif /* !HAVE_FILE_OPERATIONS_READ_WRITE_ITER */
 
+/**
+ * Splice counterpart of ll_do_fast_read().
+ *
+ * Pages already in the page cache are covered by a DLM lock, so they can be
+ * handed to the pipe by reference without setting up a cl_io and enqueuing
+ * the lock again for every chunk, which matters for sendfile() users such as
+ * NFS and SMB gateways.  As soon as a page is missing, ll_readpage() fails
+ * with -ENODATA and the caller falls back to the normal splice read.
+ *
+ * \retval number of bytes spliced, 0 if the normal path must be taken, or
+ *	   error code
+ */
+static ssize_t ll_do_fast_splice_read(struct file *in_file, loff_t *ppos,
+				      struct pipe_inode_info *pipe,
+				      size_t count, unsigned int flags)
+{
+	struct inode *inode = file_inode(in_file);
+	ssize_t result;
+
+	if (!ll_sbi_has_fast_read(ll_i2sbi(inode)))
+		return 0;
+
+	if (in_file->f_flags & O_DIRECT)
+		return 0;
+
+	result = generic_file_splice_read(in_file, ppos, pipe, count, flags);
+	if (result == -ENODATA)
+		result = 0;
+
+	if (result > 0)
+		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_READ_BYTES,
+				   result);
+
+	return result;
+}
+
 /*
  * Send file content (through pagecache) somewhere with helper
  */
@@ -1931,6 +2106,11 @@ static ssize_t ll_file_splice_read(struct file *in_file, loff_t *ppos,
 	__u16               refcheck;
         ENTRY;
 
+	/* a short splice is fine, the caller comes back for the rest */
+	result = ll_do_fast_splice_read(in_file, ppos, pipe, count, flags);
+	if (result != 0)
+		GOTO(out, result);
+
         env = cl_env_get(&refcheck);
         if (IS_ERR(env))
                 RETURN(PTR_ERR(env));
@@ -1941,7 +2121,7 @@ static ssize_t ll_file_splice_read(struct file *in_file, loff_t *ppos,
 
         result = ll_file_io_generic(env, args, in_file, CIT_READ, ppos, count);
         cl_env_put(env, &refcheck);
-
+out:
 	if (result > 0)
 		ll_rw_stats_tally(ll_i2sbi(file_inode(in_file)), current->pid,
 				  LUSTRE_FPRIVATE(in_file), *ppos, result,
@@ -2533,6 +2713,102 @@ out:
 	return rc;
 }
 
+/*
+ * Attach a file to the persistent client cache, see pcc.h.
+ *
+ * The data of the file is copied to the cache under a write lease, and the
+ * file is released with its cache copy as its HSM archive \a id.
+ */
+static int ll_pcc_attach(struct inode *inode, struct file *file, __u32 id)
+{
+	struct obd_client_handle *och;
+	struct pcc_param param = { .pa_archive_id = id };
+	struct file *pcc_file;
+	struct lu_env *env;
+	__u64 data_version = 0;
+	bool lease_broken;
+	bool released = false;
+	__u16 refcheck;
+	int rc;
+	int rc2;
+	ENTRY;
+
+	if (!S_ISREG(inode->i_mode))
+		RETURN(-EINVAL);
+
+	if (!(file->f_mode & FMODE_READ) || !(file->f_mode & FMODE_WRITE))
+		RETURN(-EBADF);
+
+	CDEBUG(D_INODE, "%s: Attaching file "DFID" to cache %u.\n",
+	       ll_get_fsname(inode->i_sb, NULL, 0),
+	       PFID(&ll_i2info(inode)->lli_fid), id);
+
+	pcc_file = pcc_file_create(inode, id);
+	if (IS_ERR(pcc_file))
+		RETURN(PTR_ERR(pcc_file));
+
+	och = ll_lease_open(inode, file, FMODE_WRITE, 0);
+	if (IS_ERR(och))
+		GOTO(out, rc = PTR_ERR(och));
+
+	rc = ll_data_version(inode, &data_version, LL_DV_RD_FLUSH);
+	if (rc != 0)
+		GOTO(out_lease, rc);
+
+	rc = pcc_file_copy(file, pcc_file);
+	if (rc != 0)
+		GOTO(out_lease, rc);
+
+	/* Grab latest data_version and [am]time values */
+	rc = ll_data_version(inode, &param.pa_data_version, LL_DV_WR_FLUSH);
+	if (rc != 0)
+		GOTO(out_lease, rc);
+
+	/* written through another file descriptor during the copy */
+	if (param.pa_data_version != data_version)
+		GOTO(out_lease, rc = -EAGAIN);
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out_lease, rc = PTR_ERR(env));
+
+	rc = ll_merge_attr(env, inode);
+	cl_env_put(env, &refcheck);
+	if (rc != 0)
+		GOTO(out_lease, rc);
+
+	/* the cache copy is the archive of the data modified so far */
+	ll_file_clear_flag(ll_i2info(inode), LLIF_DATA_MODIFIED);
+
+	rc = ll_lease_close_intent(och, inode, &lease_broken, MDS_PCC_ATTACH,
+				   &param);
+	och = NULL;
+	if (rc == 0 && lease_broken)
+		rc = -EBUSY;
+	released = rc == 0;
+
+out_lease:
+	if (och != NULL)
+		ll_lease_close(och, inode, NULL);
+	rc2 = ll_lease_och_release(inode, file);
+	if (rc == 0)
+		rc = rc2;
+	if (rc == 0)
+		rc = pcc_inode_attach(inode, pcc_file);
+	if (rc == 0)
+		pcc_file = NULL;
+	EXIT;
+out:
+	if (pcc_file != NULL) {
+		/* restoring the released file needs the cache copy */
+		if (!released)
+			pcc_file_remove(inode, pcc_file);
+		fput(pcc_file);
+	}
+
+	return rc;
+}
+
 struct ll_swap_stack {
 	__u64			 dv1;
 	__u64			 dv2;
@@ -3585,6 +3861,20 @@ out:
 
 		RETURN(ll_lease_type_from_fmode(fmode));
 	}
+	case LL_IOC_PCC_ATTACH: {
+		struct lu_pcc_attach attach;
+
+		if (copy_from_user(&attach, (void __user *)arg,
+				   sizeof(attach)))
+			RETURN(-EFAULT);
+
+		RETURN(ll_pcc_attach(inode, file, attach.pcca_id));
+	}
+	case LL_IOC_PCC_DETACH:
+		if (!(file->f_mode & FMODE_WRITE))
+			RETURN(-EBADF);
+
+		RETURN(pcc_inode_detach(inode));
 	case LL_IOC_HSM_IMPORT: {
 		struct hsm_user_import *hui;
 
@@ -3792,7 +4082,7 @@ static loff_t ll_file_seek(struct file *file, loff_t offset, int origin)
 	ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_LLSEEK, 1);
 
 	if (origin == SEEK_END || origin == SEEK_HOLE || origin == SEEK_DATA) {
-		retval = ll_glimpse_size(inode);
+		retval = pcc_inode_getattr(inode) ? 0 : ll_glimpse_size(inode);
 		if (retval != 0)
 			RETURN(retval);
 		eof = i_size_read(inode);
@@ -3941,6 +4231,10 @@ int ll_fsync(struct file *file, struct dentry *dentry, int datasync)
 	if (S_ISREG(inode->i_mode)) {
 		struct ll_file_data *fd = LUSTRE_FPRIVATE(file);
 
+		err = pcc_fsync(inode, start, end, datasync);
+		if (rc == 0 && err < 0)
+			rc = err;
+
 		err = cl_sync_file_range(inode, start, end, CL_FSYNC_ALL, 0);
 		if (rc == 0 && err < 0)
 			rc = err;
@@ -4386,7 +4680,7 @@ static int ll_inode_revalidate_fini(struct inode *inode, int rc)
 	return rc;
 }
 
-static int ll_inode_revalidate(struct dentry *dentry, enum ldlm_intent_flags op)
+int ll_inode_revalidate(struct dentry *dentry, enum ldlm_intent_flags op)
 {
 	struct inode *parent;
 	struct inode *inode = dentry->d_inode;
@@ -4514,8 +4808,15 @@ int ll_getattr(struct vfsmount *mnt, struct dentry *de, struct kstat *stat)
 		 * Also to glimpse we need the layout, in case of a running
 		 * restore the MDT holds the layout lock so the glimpse will
 		 * block up to the end of restore (getattr will block)
+		 * The strict size the MDT keeps for a file without writers
+		 * is up-to-date too, and the data of a file attached to the
+		 * client cache is in its cache copy.
 		 */
-		if (!ll_file_test_flag(lli, LLIF_FILE_RESTORING)) {
+		if (!pcc_inode_getattr(inode) &&
+		    !ll_file_test_flag(lli, LLIF_FILE_RESTORING) &&
+		    !(ll_file_test_flag(lli, LLIF_SOM_STRICT) &&
+		      ll_sbi_has_strict_som(sbi) &&
+		      lli->lli_mds_write_och == NULL)) {
 			rc = ll_glimpse_size(inode);
 			if (rc < 0)
 				RETURN(rc);
@@ -4804,6 +5105,9 @@ struct file_operations ll_file_operations = {
 	.mmap		= ll_file_mmap,
 	.llseek		= ll_file_seek,
 	.splice_read	= ll_file_splice_read,
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	.splice_write	= iter_file_splice_write,
+#endif
 	.fsync		= ll_fsync,
 	.flush		= ll_flush
 };
@@ -4828,6 +5132,9 @@ struct file_operations ll_file_operations_flock = {
 	.mmap		= ll_file_mmap,
 	.llseek		= ll_file_seek,
 	.splice_read	= ll_file_splice_read,
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	.splice_write	= iter_file_splice_write,
+#endif
 	.fsync		= ll_fsync,
 	.flush		= ll_flush,
 	.flock		= ll_file_flock,
@@ -4855,6 +5162,9 @@ struct file_operations ll_file_operations_noflock = {
 	.mmap		= ll_file_mmap,
 	.llseek		= ll_file_seek,
 	.splice_read	= ll_file_splice_read,
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	.splice_write	= iter_file_splice_write,
+#endif
 	.fsync		= ll_fsync,
 	.flush		= ll_flush,
 	.flock		= ll_file_noflock,
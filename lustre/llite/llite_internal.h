@@ -48,6 +48,7 @@
 
 #include "vvp_internal.h"
 #include "range_lock.h"
+#include "pcc.h"
 
 #ifndef FMODE_EXEC
 #define FMODE_EXEC 0
@@ -124,6 +125,9 @@ struct ll_inode_info {
 	__u64				lli_open_fd_exec_count;
 	/* Protects access to och pointers and their usage counters */
 	struct mutex			lli_och_mutex;
+	/* opens in a row, each one following the previous one closely */
+	unsigned int			lli_open_thrsh_count;
+	ktime_t				lli_open_last_time;
 
 	struct inode			lli_vfs_inode;
 
@@ -165,6 +169,12 @@ struct ll_inode_info {
 			unsigned int			lli_sa_enabled:1;
 			/* generation for statahead */
 			unsigned int			lli_sa_generation;
+			/* stat-by-name pattern of the dir: hash of the name
+			 * without its number, last number stat'ed and count
+			 * of consecutive numbers, see ll_statahead_pattern() */
+			__u32				lli_sa_pattern_hash;
+			unsigned int			lli_sa_pattern_hits;
+			__u64				lli_sa_pattern_index;
 			/* rw lock protects lli_lsm_md */
 			struct rw_semaphore		lli_lsm_sem;
 			/* directory stripe information */
@@ -175,6 +185,24 @@ struct ll_inode_info {
 			 * "dmv" and gets the rest of the default layout itself
 			 * (count, hash, etc). */
 			__u32				lli_def_stripe_offset;
+			/* protect the names of the dirents below */
+			spinlock_t			lli_dir_names_lock;
+			/* names of all the dirents, valid as long as the
+			 * UPDATE lock of the dir held when they were read */
+			struct ll_dir_names	       *lli_dir_names;
+			/* names read so far by a readdir from the start */
+			struct ll_dir_names	       *lli_dir_names_fill;
+			/* bumped when the UPDATE lock of the dir is lost */
+			unsigned int			lli_dir_names_gen;
+			/* negative lookups without UPDATE lock of the dir,
+			 * see ll_negative_dentry_lock() */
+			unsigned int			lli_neg_lookups;
+			/* FID of the parent, valid as long as the LOOKUP lock
+			 * of the dir held when it was fetched, protected by
+			 * lli_lock, see ll_dir_get_parent() */
+			struct lu_fid			lli_parent_fid;
+			/* bumped when the LOOKUP lock of the dir is lost */
+			unsigned int			lli_parent_gen;
 		};
 
 		/* for non-directory */
@@ -208,6 +236,14 @@ struct ll_inode_info {
 			 * accurate if the file is shared by different jobs.
 			 */
 			char                    lli_jobid[LUSTRE_JOBID_SIZE];
+
+			/* copy of the file in the persistent client cache,
+			 * valid for the released layout of version
+			 * lli_pcc_gen, see pcc.h
+			 */
+			struct rw_semaphore	lli_pcc_rwsem;
+			struct file	       *lli_pcc_file;
+			__u32			lli_pcc_gen;
 		};
 	};
 
@@ -263,6 +299,8 @@ enum ll_file_flags {
 	LLIF_XATTR_CACHE	= 2,
 	/* Project inherit */
 	LLIF_PROJECT_INHERIT	= 3,
+	/* Size from the MDT is strict, the file has no writers */
+	LLIF_SOM_STRICT		= 4,
 };
 
 static inline void ll_file_set_flag(struct ll_inode_info *lli,
@@ -361,6 +399,11 @@ enum ra_stat {
         RA_STAT_MAX_IN_FLIGHT,
         RA_STAT_WRONG_GRAB_PAGE,
 	RA_STAT_FAILED_REACH_END,
+	RA_STAT_SEQUENTIAL,
+	RA_STAT_STRIDE,
+	RA_STAT_REVERSE,
+	RA_STAT_NEW_STREAM,
+	RA_STAT_ASYNC,
 	_NR_RA_STAT,
 };
 
@@ -369,6 +412,11 @@ struct ll_ra_info {
 	unsigned long	ra_max_pages;
 	unsigned long	ra_max_pages_per_file;
 	unsigned long	ra_max_read_ahead_whole_pages;
+	/* read-ahead streams tracked per open file */
+	unsigned int	ra_streams;
+	/* workers reading ahead the windows reached by cache hits */
+	struct workqueue_struct *ra_async_wq;
+	unsigned int	ra_async_max_active;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -457,6 +505,8 @@ enum stats_track_type {
 /*	LL_SBI_PIO	    0x1000000    parallel IO support, introduced in
 					 2.10, abandoned */
 #define LL_SBI_TINY_WRITE   0x2000000 /* tiny write support */
+#define LL_SBI_MD_CONVERT   0x4000000 /* convert all md locks on conflict */
+#define LL_SBI_STRICT_SOM   0x8000000 /* MDT keeps the size of closed files */
 
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
@@ -485,6 +535,8 @@ enum stats_track_type {
 	"file_secctx",	\
 	"pio",		\
 	"tiny_write",	\
+	"md_convert",	\
+	"strict_som",	\
 }
 
 /* This is embedded into llite super-blocks to keep track of connect
@@ -500,6 +552,10 @@ struct lustre_client_ocd {
 	struct obd_export	*lco_dt_exp;
 };
 
+/* defaults of the opens in a row which make a file worth an open lock */
+#define LL_OC_THRSH_COUNT_DEF	5
+#define LL_OC_THRSH_MS_DEF	100
+
 struct ll_sb_info {
 	/* this protects pglist and ra_info.  It isn't safe to
 	 * grab from interrupt contexts */
@@ -558,6 +614,14 @@ struct ll_sb_info {
 						  * count */
 	atomic_t		  ll_sa_wrong;   /* statahead thread stopped for
 						  * low hit ratio */
+	atomic_t		  ll_sa_by_name; /* statahead thread started
+						  * for stat-by-name pattern */
+	unsigned int		  ll_sa_pattern_min; /* consecutive names of
+						      * a pattern to start
+						      * statahead by name */
+	unsigned int		  ll_dir_names_max; /* max dirents of a dir
+						     * to index the names of,
+						     * 0 to disable */
 	atomic_t		  ll_sa_running; /* running statahead thread
 						  * count */
 	atomic_t		  ll_agl_total;  /* AGL thread started count */
@@ -566,6 +630,8 @@ struct ll_sb_info {
 						 * clustred nfs */
 	/* root squash */
 	struct root_squash_info	  ll_squash;
+	/* persistent client cache */
+	struct pcc_super	  ll_pcc_super;
 	struct path		  ll_mnt;
 
 	/* st_blksize returned by stat(2), when non-zero */
@@ -574,6 +640,11 @@ struct ll_sb_info {
 	/* maximum relative age of cached statfs results */
 	unsigned int		  ll_statfs_max_age;
 
+	/* opens of a file in a row to ask for an open lock, 0 to disable */
+	unsigned int		  ll_oc_thrsh_count;
+	/* maximum time between two opens in a row, in ms */
+	unsigned int		  ll_oc_thrsh_ms;
+
 	struct kset		  ll_kset;	/* sysfs object */
 	struct completion	  ll_kobj_unregister;
 };
@@ -661,12 +732,33 @@ struct ll_readahead_state {
          * stride read-ahead will be enable
          */
         unsigned long   ras_consecutive_stride_requests;
+	/*
+	 * First page of the last read request, and number of consecutive
+	 * requests starting before the previous one. After RAS_REVERSE_MIN
+	 * such requests, the stream is read ahead backward, the window
+	 * ending where the reader is.
+	 */
+	unsigned long	ras_request_start;
+	unsigned long	ras_reverse_requests;
+	/* last use of the stream in its file, 0 if never used */
+	unsigned long	ras_stamp;
 };
 
+#define RAS_REVERSE_MIN		2
+
+/*
+ * Maximum number of independent read-ahead streams of an open file, for
+ * the threads reading different regions of a shared file descriptor.
+ */
+#define LL_RA_STREAMS_MAX	4
+
 extern struct kmem_cache *ll_file_data_slab;
 struct lustre_handle;
 struct ll_file_data {
-	struct ll_readahead_state fd_ras;
+	struct ll_readahead_state fd_ras[LL_RA_STREAMS_MAX];
+	/* protects the choice of the stream and fd_ras_clock */
+	spinlock_t fd_ras_lock;
+	unsigned long fd_ras_clock;
 	struct ll_grouplock fd_grouplock;
 	__u64 lfd_pos;
 	__u32 fd_flags;
@@ -735,7 +827,13 @@ static inline bool ll_sbi_has_tiny_write(struct ll_sb_info *sbi)
 	return !!(sbi->ll_flags & LL_SBI_TINY_WRITE);
 }
 
-void ll_ras_enter(struct file *f);
+static inline bool ll_sbi_has_strict_som(struct ll_sb_info *sbi)
+{
+	return (sbi->ll_flags & LL_SBI_STRICT_SOM) &&
+	       (exp_connect_flags2(sbi->ll_md_exp) & OBD_CONNECT2_STRICT_SOM);
+}
+
+struct ll_readahead_state *ll_ras_enter(struct file *f, unsigned long index);
 
 /* llite/lcommon_misc.c */
 int cl_ocd_update(struct obd_device *host, struct obd_device *watched,
@@ -818,6 +916,8 @@ int ll_get_mdt_idx_by_fid(struct ll_sb_info *sbi, const struct lu_fid *fid);
 struct page *ll_get_dir_page(struct inode *dir, struct md_op_data *op_data,
 			     __u64 offset, struct ll_dir_chain *chain);
 void ll_release_page(struct inode *inode, struct page *page, bool remove);
+bool ll_dir_name_absent(struct inode *dir, const struct qstr *qstr);
+void ll_dir_names_invalidate(struct inode *dir);
 
 /* llite/namei.c */
 extern const struct inode_operations ll_special_inode_operations;
@@ -837,7 +937,9 @@ int ll_writepages(struct address_space *, struct writeback_control *wbc);
 int ll_readpage(struct file *file, struct page *page);
 int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 			   struct cl_page *page, struct file *file);
-void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras);
+void ll_ras_init(struct inode *inode, struct ll_file_data *fd);
+int ll_readahead_async_init(struct ll_sb_info *sbi);
+void ll_readahead_async_fini(struct ll_sb_info *sbi);
 int vvp_io_write_commit(const struct lu_env *env, struct cl_io *io);
 
 enum lcc_type;
@@ -848,6 +950,11 @@ struct ll_cl_context *ll_cl_find(struct file *file);
 
 extern const struct address_space_operations ll_aops;
 
+/* llite/rw26.c */
+struct ll_dio_aio *ll_dio_aio_alloc(struct kiocb *iocb, enum cl_io_type iot);
+ssize_t ll_dio_aio_done(const struct lu_env *env, struct ll_dio_aio *aio,
+			ssize_t result);
+
 /* llite/file.c */
 extern struct file_operations ll_file_operations;
 extern struct file_operations ll_file_operations_flock;
@@ -860,9 +967,11 @@ extern enum ldlm_mode ll_take_md_lock(struct inode *inode, __u64 bits,
 				      enum ldlm_mode mode);
 
 int ll_file_open(struct inode *inode, struct file *file);
+void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot);
 int ll_file_release(struct inode *inode, struct file *file);
 int ll_release_openhandle(struct dentry *, struct lookup_intent *);
 int ll_md_real_close(struct inode *inode, fmode_t fmode);
+int ll_inode_revalidate(struct dentry *dentry, enum ldlm_intent_flags op);
 extern void ll_rw_stats_tally(struct ll_sb_info *sbi, pid_t pid,
                               struct ll_file_data *file, loff_t pos,
                               size_t count, int rw);
@@ -1026,6 +1135,7 @@ __u32 get_uuid2int(const char *name, int len);
 struct inode *search_inode_for_lustre(struct super_block *sb,
 				      const struct lu_fid *fid);
 int ll_dir_get_parent_fid(struct inode *dir, struct lu_fid *parent_fid);
+void ll_dir_parent_invalidate(struct inode *dir);
 
 /* llite/symlink.c */
 extern struct inode_operations ll_fast_symlink_inode_operations;
@@ -1218,6 +1328,9 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_RUNNING_MAX	256
 #define LL_SA_RUNNING_DEF	16
 
+/* default consecutive stats of numbered names to start statahead by name */
+#define LL_SA_PATTERN_MIN_DEF	4
+
 #define LL_SA_CACHE_BIT         5
 #define LL_SA_CACHE_SIZE        (1 << LL_SA_CACHE_BIT)
 #define LL_SA_CACHE_MASK        (LL_SA_CACHE_SIZE - 1)
@@ -1251,7 +1364,19 @@ struct ll_statahead_info {
 	unsigned int            sai_ls_all:1,   /* "ls -al", do stat-ahead for
 						 * hidden entries */
 				sai_agl_valid:1,/* AGL is valid for the dir */
-				sai_in_readpage:1;/* statahead is in readdir()*/
+				sai_in_readpage:1,/* statahead is in readdir()*/
+				sai_by_name:1;  /* stat-ahead numbered names
+						 * instead of readdir */
+	unsigned int		sai_consecutive_enoent; /* consecutive names
+							 * which don't exist */
+	/* name template of statahead by name, the number of @sai_fname_width
+	 * digits at @sai_fname_start is replaced by @sai_fname_index */
+	char			sai_fname[NAME_MAX + 1];
+	int			sai_fname_len;
+	int			sai_fname_start;
+	int			sai_fname_width;
+	int			sai_fname_pad;	/* width of zero-padded number */
+	__u64			sai_fname_index;
 	wait_queue_head_t	sai_waitq;	/* stat-ahead wait queue */
 	struct ptlrpc_thread	sai_thread;	/* stat-ahead thread */
 	struct ptlrpc_thread	sai_agl_thread;	/* AGL thread */
@@ -1266,6 +1391,7 @@ struct ll_statahead_info {
 };
 
 int ll_statahead(struct inode *dir, struct dentry **dentry, bool unplug);
+bool ll_statahead_pattern(struct inode *dir, struct dentry *dentry);
 void ll_authorize_statahead(struct inode *dir, void *key);
 void ll_deauthorize_statahead(struct inode *dir, void *key);
 
@@ -1306,7 +1432,9 @@ static inline int ll_glimpse_size(struct inode *inode)
 }
 
 /* dentry may statahead when statahead is enabled and current process has opened
- * parent directory, and this dentry hasn't accessed statahead cache before */
+ * parent directory, or the dir is not opened and the process stats names which
+ * follow a numbered pattern, and this dentry hasn't accessed statahead cache
+ * before */
 static inline bool
 dentry_may_statahead(struct inode *dir, struct dentry *dentry)
 {
@@ -1321,13 +1449,13 @@ dentry_may_statahead(struct inode *dir, struct dentry *dentry)
 	/* statahead is not allowed for this dir, there may be three causes:
 	 * 1. dir is not opened.
 	 * 2. statahead hit ratio is too low.
-	 * 3. previous stat started statahead thread failed. */
-	if (!lli->lli_sa_enabled)
-		return false;
-
-	/* not the same process, don't statahead */
-	if (lli->lli_opendir_pid != current_pid())
-		return false;
+	 * 3. previous stat started statahead thread failed.
+	 * or it's not the same process, statahead by name only then. */
+	if (!lli->lli_sa_enabled || lli->lli_opendir_pid != current_pid()) {
+		if (lli->lli_opendir_key != NULL ||
+		    !ll_statahead_pattern(dir, dentry))
+			return false;
+	}
 
 	/*
 	 * When stating a dentry, kernel may trigger 'revalidate' or 'lookup'
@@ -89,6 +89,8 @@ static struct ll_sb_info *ll_init_sbi(void)
 	spin_lock_init(&sbi->ll_process_lock);
         sbi->ll_rw_stats_on = 0;
 	sbi->ll_statfs_max_age = OBD_STATFS_CACHE_SECONDS;
+	sbi->ll_oc_thrsh_count = LL_OC_THRSH_COUNT_DEF;
+	sbi->ll_oc_thrsh_ms = LL_OC_THRSH_MS_DEF;
 
         si_meminfo(&si);
         pages = si.totalram - si.totalhigh;
@@ -105,6 +107,12 @@ static struct ll_sb_info *ll_init_sbi(void)
 					   SBI_DEFAULT_READAHEAD_MAX);
 	sbi->ll_ra_info.ra_max_pages = sbi->ll_ra_info.ra_max_pages_per_file;
 	sbi->ll_ra_info.ra_max_read_ahead_whole_pages = -1;
+	sbi->ll_ra_info.ra_streams = LL_RA_STREAMS_MAX;
+	if (ll_readahead_async_init(sbi) != 0) {
+		cl_cache_decref(sbi->ll_cache);
+		OBD_FREE(sbi, sizeof(*sbi));
+		RETURN(NULL);
+	}
 
         ll_generate_random_uuid(uuid);
         class_uuid_unparse(uuid, &sbi->ll_sb_uuid);
@@ -135,11 +143,14 @@ static struct ll_sb_info *ll_init_sbi(void)
 	sbi->ll_sa_max = LL_SA_RPC_DEF;
 	atomic_set(&sbi->ll_sa_total, 0);
 	atomic_set(&sbi->ll_sa_wrong, 0);
+	atomic_set(&sbi->ll_sa_by_name, 0);
+	sbi->ll_sa_pattern_min = LL_SA_PATTERN_MIN_DEF;
 	atomic_set(&sbi->ll_sa_running, 0);
 	atomic_set(&sbi->ll_agl_total, 0);
 	sbi->ll_flags |= LL_SBI_AGL_ENABLED;
 	sbi->ll_flags |= LL_SBI_FAST_READ;
 	sbi->ll_flags |= LL_SBI_TINY_WRITE;
+	sbi->ll_flags |= LL_SBI_MD_CONVERT;
 
 	/* root squash */
 	sbi->ll_squash.rsi_uid = 0;
@@ -147,6 +158,8 @@ static struct ll_sb_info *ll_init_sbi(void)
 	INIT_LIST_HEAD(&sbi->ll_squash.rsi_nosquash_nids);
 	init_rwsem(&sbi->ll_squash.rsi_sem);
 
+	pcc_super_init(&sbi->ll_pcc_super);
+
 	RETURN(sbi);
 }
 
@@ -162,6 +175,8 @@ static void ll_free_sbi(struct super_block *sb)
 			cl_cache_decref(sbi->ll_cache);
 			sbi->ll_cache = NULL;
 		}
+		ll_readahead_async_fini(sbi);
+		pcc_super_fini(&sbi->ll_pcc_super);
 		OBD_FREE(sbi, sizeof(*sbi));
 	}
 	EXIT;
@@ -233,7 +248,13 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				   OBD_CONNECT2_ARCHIVE_ID_ARRAY |
 				   OBD_CONNECT2_LSOM |
 				   OBD_CONNECT2_ASYNC_DISCARD |
-				   OBD_CONNECT2_GETATTR_PFID;
+				   OBD_CONNECT2_GETATTR_PFID |
+				   OBD_CONNECT2_BATCH_RPC |
+				   OBD_CONNECT2_SHARED_PING |
+				   OBD_CONNECT2_BL_AST_BATCH |
+				   OBD_CONNECT2_STRICT_SOM |
+				   OBD_CONNECT2_DOM_READ_HEAD |
+				   OBD_CONNECT2_CONN_WINDOW;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -440,7 +461,13 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 	data->ocd_connect_flags |= OBD_CONNECT_LOCKAHEAD_OLD;
 #endif
 
-	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD;
+	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
+				   OBD_CONNECT2_SHARED_PING |
+				   OBD_CONNECT2_BL_AST_BATCH |
+				   OBD_CONNECT2_T10_GUARDS |
+				   OBD_CONNECT2_COMPRESS |
+				   OBD_CONNECT2_BATCH_RPC |
+				   OBD_CONNECT2_CONN_WINDOW;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -958,6 +985,8 @@ void ll_lli_init(struct ll_inode_info *lli)
         lli->lli_open_fd_write_count = 0;
         lli->lli_open_fd_exec_count = 0;
 	mutex_init(&lli->lli_och_mutex);
+	lli->lli_open_thrsh_count = 0;
+	lli->lli_open_last_time = ktime_set(0, 0);
 	spin_lock_init(&lli->lli_agl_lock);
 	spin_lock_init(&lli->lli_layout_lock);
 	ll_layout_version_set(lli, CL_LAYOUT_GEN_NONE);
@@ -974,8 +1003,18 @@ void ll_lli_init(struct ll_inode_info *lli)
 		spin_lock_init(&lli->lli_sa_lock);
 		lli->lli_opendir_pid = 0;
 		lli->lli_sa_enabled = 0;
+		lli->lli_sa_pattern_hash = 0;
+		lli->lli_sa_pattern_hits = 0;
+		lli->lli_sa_pattern_index = 0;
 		lli->lli_def_stripe_offset = -1;
 		init_rwsem(&lli->lli_lsm_sem);
+		spin_lock_init(&lli->lli_dir_names_lock);
+		lli->lli_dir_names = NULL;
+		lli->lli_dir_names_fill = NULL;
+		lli->lli_dir_names_gen = 0;
+		lli->lli_neg_lookups = 0;
+		fid_zero(&lli->lli_parent_fid);
+		lli->lli_parent_gen = 0;
 	} else {
 		mutex_init(&lli->lli_size_mutex);
 		lli->lli_symlink_name = NULL;
@@ -986,6 +1025,9 @@ void ll_lli_init(struct ll_inode_info *lli)
 		INIT_LIST_HEAD(&lli->lli_agl_list);
 		lli->lli_agl_index = 0;
 		lli->lli_async_rc = 0;
+		init_rwsem(&lli->lli_pcc_rwsem);
+		lli->lli_pcc_file = NULL;
+		lli->lli_pcc_gen = CL_LAYOUT_GEN_NONE;
 	}
 	mutex_init(&lli->lli_layout_mutex);
 	memset(lli->lli_jobid, 0, sizeof(lli->lli_jobid));
@@ -1524,10 +1566,13 @@ void ll_clear_inode(struct inode *inode)
 #endif
 	lli->lli_inode_magic = LLI_INODE_DEAD;
 
-	if (S_ISDIR(inode->i_mode))
+	if (S_ISDIR(inode->i_mode)) {
+		ll_dir_names_invalidate(inode);
 		ll_dir_clear_lsm_md(inode);
-	else if (S_ISREG(inode->i_mode) && !is_bad_inode(inode))
+	} else if (S_ISREG(inode->i_mode) && !is_bad_inode(inode)) {
 		LASSERT(list_empty(&lli->lli_agl_list));
+		pcc_inode_fini(inode);
+	}
 
 	/*
 	 * XXX This has to be done before lsm is freed below, because
@@ -2039,6 +2084,20 @@ int ll_update_inode(struct inode *inode, struct lustre_md *md)
 			inode->i_blocks = body->mbo_blocks;
 	}
 
+	/* the size the MDT returns for a regular file is authoritative, for
+	 * strict SOM, released files and files without OST objects, until
+	 * the UPDATE or LAYOUT lock of the file is lost
+	 */
+	if (S_ISREG(inode->i_mode)) {
+		if (body->mbo_valid & OBD_MD_FLSIZE &&
+		    body->mbo_valid & OBD_MD_FLBLOCKS &&
+		    exp_connect_flags2(sbi->ll_md_exp) &
+		    OBD_CONNECT2_STRICT_SOM)
+			ll_file_set_flag(lli, LLIF_SOM_STRICT);
+		else
+			ll_file_clear_flag(lli, LLIF_SOM_STRICT);
+	}
+
 	if (body->mbo_valid & OBD_MD_TSTATE) {
 		/* Set LLIF_FILE_RESTORING if restore ongoing and
 		 * clear it when done to ensure to start again
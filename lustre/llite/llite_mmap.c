@@ -462,6 +462,34 @@ static vm_fault_t ll_page_mkwrite(struct vm_area_struct *vma,
         return result;
 }
 
+#ifdef HAVE_VM_OPS_MAP_PAGES
+/**
+ * Lustre implementation of a vm_operations_struct::map_pages() method, called
+ * by VM on a read fault to map the cached pages around the faulting address.
+ *
+ * Like the fast fault in ll_fault0(), this relies on the uptodate pages in
+ * the page cache being covered by a DLM lock, since the cancellation of the
+ * lock removes them. It maps nothing when fast read is disabled, so that each
+ * page goes through ll_fault().
+ */
+#ifdef HAVE_MAP_PAGES_PGOFF_ARGS
+static void ll_map_pages(struct vm_fault *vmf, pgoff_t start_pgoff,
+			 pgoff_t end_pgoff)
+{
+	struct file *file = vmf->vma->vm_file;
+
+	if (ll_sbi_has_fast_read(ll_i2sbi(file_inode(file))))
+		filemap_map_pages(vmf, start_pgoff, end_pgoff);
+}
+#else
+static void ll_map_pages(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	if (ll_sbi_has_fast_read(ll_i2sbi(file_inode(vma->vm_file))))
+		filemap_map_pages(vma, vmf);
+}
+#endif
+#endif /* HAVE_VM_OPS_MAP_PAGES */
+
 /**
  *  To avoid cancel the locks covering mmapped region for lock cache pressure,
  *  we track the mapped vma count in vvp_object::vob_mmap_cnt.
@@ -510,6 +538,9 @@ int ll_teardown_mmaps(struct address_space *mapping, __u64 first, __u64 last)
 
 static const struct vm_operations_struct ll_file_vm_ops = {
 	.fault			= ll_fault,
+#ifdef HAVE_VM_OPS_MAP_PAGES
+	.map_pages		= ll_map_pages,
+#endif
 	.page_mkwrite		= ll_page_mkwrite,
 	.open			= ll_vm_open,
 	.close			= ll_vm_close,
@@ -299,13 +299,39 @@ static struct dentry *ll_fh_to_parent(struct super_block *sb, struct fid *fid,
         RETURN(ll_iget_for_nfs(sb, &nfs_fid->lnf_parent, NULL));
 }
 
-int ll_dir_get_parent_fid(struct inode *dir, struct lu_fid *parent_fid)
+/* forget the parent FID of @dir, called when its LOOKUP lock is cancelled */
+void ll_dir_parent_invalidate(struct inode *dir)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+
+	spin_lock(&lli->lli_lock);
+	lli->lli_parent_gen++;
+	fid_zero(&lli->lli_parent_fid);
+	spin_unlock(&lli->lli_lock);
+}
+
+/**
+ * Get the FID of the parent of \a dir and, if \a parent is not NULL, the
+ * parent inode as well.
+ *
+ * Renaming \a dir revokes its LOOKUP lock, so the parent FID is kept in
+ * lli_parent_fid for as long as the client holds that lock, and NFS
+ * reconnecting paths through a busy directory does not ask the MDT for ".."
+ * every time.  On a miss, the getattr_name("..") reply of a parent on the
+ * same MDT carries its attributes too, which is enough to set up its inode
+ * without another getattr.
+ */
+static int ll_dir_get_parent(struct inode *dir, struct lu_fid *parent_fid,
+			     struct inode **parent)
 {
 	struct ptlrpc_request	*req = NULL;
+	struct ll_inode_info	*lli;
 	struct ll_sb_info	*sbi;
 	struct mdt_body		*body;
 	static const char	dotdot[] = "..";
 	struct md_op_data	*op_data;
+	__u64			ibits = MDS_INODELOCK_LOOKUP;
+	unsigned int		gen;
 	int			rc;
 	int			lmmsize;
 	ENTRY;
@@ -313,6 +339,17 @@ int ll_dir_get_parent_fid(struct inode *dir, struct lu_fid *parent_fid)
 	LASSERT(dir && S_ISDIR(dir->i_mode));
 
 	sbi = ll_s2sbi(dir->i_sb);
+	lli = ll_i2info(dir);
+
+	spin_lock(&lli->lli_lock);
+	gen = lli->lli_parent_gen;
+	*parent_fid = lli->lli_parent_fid;
+	spin_unlock(&lli->lli_lock);
+	if (!fid_is_zero(parent_fid)) {
+		CDEBUG(D_INFO, "cached parent for "DFID" is "DFID"\n",
+		       PFID(ll_inode2fid(dir)), PFID(parent_fid));
+		RETURN(0);
+	}
 
 	CDEBUG(D_INFO, "%s: getting parent for ("DFID")\n",
 	       ll_get_fsname(dir->i_sb, NULL, 0),
@@ -346,24 +383,46 @@ int ll_dir_get_parent_fid(struct inode *dir, struct lu_fid *parent_fid)
 		CDEBUG(D_INFO, "parent for "DFID" is "DFID"\n",
 		       PFID(ll_inode2fid(dir)), PFID(&body->mbo_fid1));
 		*parent_fid = body->mbo_fid1;
+
+		if (ll_have_md_lock(dir, &ibits, LCK_MINMODE)) {
+			spin_lock(&lli->lli_lock);
+			if (lli->lli_parent_gen == gen)
+				lli->lli_parent_fid = *parent_fid;
+			spin_unlock(&lli->lli_lock);
+		}
+
+		/* a remote parent comes with its FID only */
+		if (parent != NULL && !(body->mbo_valid & OBD_MD_MDS) &&
+		    (body->mbo_valid & OBD_MD_FLTYPE) &&
+		    ll_prep_inode(parent, req, dir->i_sb, NULL) != 0)
+			*parent = NULL;
 	}
 
 	ptlrpc_req_finished(req);
 	RETURN(0);
 }
 
+int ll_dir_get_parent_fid(struct inode *dir, struct lu_fid *parent_fid)
+{
+	return ll_dir_get_parent(dir, parent_fid, NULL);
+}
+
 static struct dentry *ll_get_parent(struct dentry *dchild)
 {
 	struct lu_fid	parent_fid = { 0 };
+	struct inode	*parent = NULL;
 	int		rc;
 	struct dentry	*dentry;
 	ENTRY;
 
-	rc = ll_dir_get_parent_fid(dchild->d_inode, &parent_fid);
+	rc = ll_dir_get_parent(dchild->d_inode, &parent_fid, &parent);
 	if (rc != 0)
 		RETURN(ERR_PTR(rc));
 
+	/* holding @parent keeps it in the inode cache for the lookup below */
 	dentry = ll_iget_for_nfs(dchild->d_inode->i_sb, &parent_fid, NULL);
+	if (parent != NULL)
+		iput(parent);
 
 	RETURN(dentry);
 }
@@ -126,7 +126,8 @@ static ssize_t blocksize_show(struct kobject *kobj, struct attribute *attr,
 	struct obd_statfs osfs;
 	int rc;
 
-	rc = ll_statfs_internal(sbi, &osfs, OBD_STATFS_NODELAY);
+	rc = ll_statfs_internal(sbi, &osfs,
+				OBD_STATFS_NODELAY | OBD_STATFS_SUM);
 	if (rc)
 		return rc;
 
@@ -176,7 +177,8 @@ static ssize_t kbytestotal_show(struct kobject *kobj, struct attribute *attr,
 	u64 result;
 	int rc;
 
-	rc = ll_statfs_internal(sbi, &osfs, OBD_STATFS_NODELAY);
+	rc = ll_statfs_internal(sbi, &osfs,
+				OBD_STATFS_NODELAY | OBD_STATFS_SUM);
 	if (rc)
 		return rc;
 
@@ -200,7 +202,8 @@ static ssize_t kbytesfree_show(struct kobject *kobj, struct attribute *attr,
 	u64 result;
 	int rc;
 
-	rc = ll_statfs_internal(sbi, &osfs, OBD_STATFS_NODELAY);
+	rc = ll_statfs_internal(sbi, &osfs,
+				OBD_STATFS_NODELAY | OBD_STATFS_SUM);
 	if (rc)
 		return rc;
 
@@ -224,7 +227,8 @@ static ssize_t kbytesavail_show(struct kobject *kobj, struct attribute *attr,
 	u64 result;
 	int rc;
 
-	rc = ll_statfs_internal(sbi, &osfs, OBD_STATFS_NODELAY);
+	rc = ll_statfs_internal(sbi, &osfs,
+				OBD_STATFS_NODELAY | OBD_STATFS_SUM);
 	if (rc)
 		return rc;
 
@@ -246,7 +250,8 @@ static ssize_t filestotal_show(struct kobject *kobj, struct attribute *attr,
 	struct obd_statfs osfs;
 	int rc;
 
-	rc = ll_statfs_internal(sbi, &osfs, OBD_STATFS_NODELAY);
+	rc = ll_statfs_internal(sbi, &osfs,
+				OBD_STATFS_NODELAY | OBD_STATFS_SUM);
 	if (rc)
 		return rc;
 
@@ -262,7 +267,8 @@ static ssize_t filesfree_show(struct kobject *kobj, struct attribute *attr,
 	struct obd_statfs osfs;
 	int rc;
 
-	rc = ll_statfs_internal(sbi, &osfs, OBD_STATFS_NODELAY);
+	rc = ll_statfs_internal(sbi, &osfs,
+				OBD_STATFS_NODELAY | OBD_STATFS_SUM);
 	if (rc)
 		return rc;
 
@@ -451,6 +457,81 @@ ll_max_read_ahead_whole_mb_seq_write(struct file *file,
 
 LDEBUGFS_SEQ_FOPS(ll_max_read_ahead_whole_mb);
 
+static ssize_t read_ahead_streams_show(struct kobject *kobj,
+				       struct attribute *attr,
+				       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_ra_info.ra_streams);
+}
+
+static ssize_t read_ahead_streams_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer,
+					size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > LL_RA_STREAMS_MAX) {
+		CERROR("Bad read_ahead_streams value %u. Valid values are in the range [1, %d]\n",
+		       val, LL_RA_STREAMS_MAX);
+		return -ERANGE;
+	}
+
+	sbi->ll_ra_info.ra_streams = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_streams);
+
+static ssize_t read_ahead_async_max_active_show(struct kobject *kobj,
+						struct attribute *attr,
+						char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_ra_info.ra_async_max_active);
+}
+
+static ssize_t read_ahead_async_max_active_store(struct kobject *kobj,
+						 struct attribute *attr,
+						 const char *buffer,
+						 size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	/* 0 has the readers do their read-ahead themselves */
+	if (val > WQ_UNBOUND_MAX_ACTIVE) {
+		CERROR("Bad read_ahead_async_max_active value %u. Valid values are in the range [0, %d]\n",
+		       val, WQ_UNBOUND_MAX_ACTIVE);
+		return -ERANGE;
+	}
+
+	if (val > 0)
+		workqueue_set_max_active(sbi->ll_ra_info.ra_async_wq, val);
+	sbi->ll_ra_info.ra_async_max_active = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(read_ahead_async_max_active);
+
 static int ll_max_cached_mb_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block     *sb    = m->private;
@@ -460,7 +541,7 @@ static int ll_max_cached_mb_seq_show(struct seq_file *m, void *v)
 	long unused_mb;
 
 	max_cached_mb = PAGES_TO_MiB(cache->ccc_lru_max);
-	unused_mb = PAGES_TO_MiB(atomic_long_read(&cache->ccc_lru_left));
+	unused_mb = PAGES_TO_MiB(cl_cache_lru_left(cache));
 	seq_printf(m, "users: %d\n"
 		      "max_cached_mb: %ld\n"
 		      "used_mb: %ld\n"
@@ -533,7 +614,9 @@ static ssize_t ll_max_cached_mb_seq_write(struct file *file,
 	while (diff > 0) {
 		long tmp;
 
-		/* reduce LRU budget from free slots. */
+		/* reduce LRU budget from free slots, including the ones
+		 * kept by the CPTs. */
+		cl_cache_lru_drain(cache);
 		do {
 			long ov, nv;
 
@@ -778,6 +861,70 @@ static ssize_t statahead_max_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statahead_max);
 
+static ssize_t statahead_pattern_min_show(struct kobject *kobj,
+					  struct attribute *attr,
+					  char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_sa_pattern_min);
+}
+
+/* consecutive stats of numbered names to start statahead by name, 0 disables
+ * statahead by name */
+static ssize_t statahead_pattern_min_store(struct kobject *kobj,
+					   struct attribute *attr,
+					   const char *buffer,
+					   size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_sa_pattern_min = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(statahead_pattern_min);
+
+static ssize_t dir_names_max_show(struct kobject *kobj,
+				  struct attribute *attr,
+				  char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", sbi->ll_dir_names_max);
+}
+
+/* max dirents of a dir to index the names of after readdir, so that lookups
+ * of missing names need no RPC, 0 disables the name index */
+static ssize_t dir_names_max_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer,
+				   size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_dir_names_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(dir_names_max);
+
 static ssize_t statahead_agl_show(struct kobject *kobj,
 				  struct attribute *attr,
 				  char *buf)
@@ -818,9 +965,11 @@ static int ll_statahead_stats_seq_show(struct seq_file *m, void *v)
 
 	seq_printf(m, "statahead total: %u\n"
 		      "statahead wrong: %u\n"
+		      "statahead by name: %u\n"
 		      "agl total: %u\n",
 		   atomic_read(&sbi->ll_sa_total),
 		   atomic_read(&sbi->ll_sa_wrong),
+		   atomic_read(&sbi->ll_sa_by_name),
 		   atomic_read(&sbi->ll_agl_total));
 	return 0;
 }
@@ -890,6 +1039,66 @@ static ssize_t statfs_max_age_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(statfs_max_age);
 
+static ssize_t opencache_threshold_count_show(struct kobject *kobj,
+					      struct attribute *attr,
+					      char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_oc_thrsh_count);
+}
+
+static ssize_t opencache_threshold_count_store(struct kobject *kobj,
+					       struct attribute *attr,
+					       const char *buffer,
+					       size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_oc_thrsh_count = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(opencache_threshold_count);
+
+static ssize_t opencache_threshold_ms_show(struct kobject *kobj,
+					   struct attribute *attr,
+					   char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", sbi->ll_oc_thrsh_ms);
+}
+
+static ssize_t opencache_threshold_ms_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer,
+					    size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_oc_thrsh_ms = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(opencache_threshold_ms);
+
 static ssize_t max_easize_show(struct kobject *kobj,
 			       struct attribute *attr,
 			       char *buf)
@@ -1069,6 +1278,41 @@ static ssize_t tiny_write_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(tiny_write);
 
+static ssize_t md_lock_convert_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", !!(sbi->ll_flags & LL_SBI_MD_CONVERT));
+}
+
+static ssize_t md_lock_convert_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer,
+				     size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		sbi->ll_flags |= LL_SBI_MD_CONVERT;
+	else
+		sbi->ll_flags &= ~LL_SBI_MD_CONVERT;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(md_lock_convert);
+
 static ssize_t fast_read_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -1104,6 +1348,44 @@ static ssize_t fast_read_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(fast_read);
 
+static ssize_t strict_som_show(struct kobject *kobj,
+			       struct attribute *attr,
+			       char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return sprintf(buf, "%u\n", !!(sbi->ll_flags & LL_SBI_STRICT_SOM));
+}
+
+/* flush files at their last close for the MDT to keep their size, and
+ * trust that size instead of glimpsing the OSTs
+ */
+static ssize_t strict_som_store(struct kobject *kobj,
+				struct attribute *attr,
+				const char *buffer,
+				size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val)
+		sbi->ll_flags |= LL_SBI_STRICT_SOM;
+	else
+		sbi->ll_flags &= ~LL_SBI_STRICT_SOM;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(strict_som);
+
 static int ll_unstable_stats_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block	*sb    = m->private;
@@ -1225,6 +1507,42 @@ static ssize_t ll_nosquash_nids_seq_write(struct file *file,
 
 LDEBUGFS_SEQ_FOPS(ll_nosquash_nids);
 
+static int ll_pcc_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	return pcc_super_show(m, &sbi->ll_pcc_super);
+}
+
+static ssize_t ll_pcc_seq_write(struct file *file, const char __user *buffer,
+				size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+	char *kernbuf;
+	int rc;
+
+	if (count > PATH_MAX + 16)
+		return -E2BIG;
+
+	OBD_ALLOC(kernbuf, count + 1);
+	if (kernbuf == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out, rc = -EFAULT);
+
+	rc = pcc_super_set(&sbi->ll_pcc_super, kernbuf);
+out:
+	OBD_FREE(kernbuf, count + 1);
+
+	return rc < 0 ? rc : count;
+}
+
+LDEBUGFS_SEQ_FOPS(ll_pcc);
+
 struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	{ .name	=	"site",
 	  .fops	=	&ll_site_stats_fops			},
@@ -1246,6 +1564,8 @@ struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_root_squash_fops			},
 	{ .name	=	"nosquash_nids",
 	  .fops	=	&ll_nosquash_nids_fops			},
+	{ .name	=	"pcc",
+	  .fops	=	&ll_pcc_fops				},
 	{ NULL }
 };
 
@@ -1262,6 +1582,8 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_client_type.attr,
 	&lustre_attr_fstype.attr,
 	&lustre_attr_uuid.attr,
+	&lustre_attr_read_ahead_streams.attr,
+	&lustre_attr_read_ahead_async_max_active.attr,
 	&lustre_attr_checksums.attr,
 	&lustre_attr_checksum_pages.attr,
 	&lustre_attr_stats_track_pid.attr,
@@ -1269,14 +1591,20 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_stats_track_gid.attr,
 	&lustre_attr_statahead_running_max.attr,
 	&lustre_attr_statahead_max.attr,
+	&lustre_attr_statahead_pattern_min.attr,
+	&lustre_attr_dir_names_max.attr,
 	&lustre_attr_statahead_agl.attr,
 	&lustre_attr_lazystatfs.attr,
 	&lustre_attr_statfs_max_age.attr,
+	&lustre_attr_opencache_threshold_count.attr,
+	&lustre_attr_opencache_threshold_ms.attr,
 	&lustre_attr_max_easize.attr,
 	&lustre_attr_default_easize.attr,
 	&lustre_attr_xattr_cache.attr,
 	&lustre_attr_fast_read.attr,
+	&lustre_attr_strict_som.attr,
 	&lustre_attr_tiny_write.attr,
+	&lustre_attr_md_lock_convert.attr,
 	NULL,
 };
 
@@ -1375,7 +1703,12 @@ static const char *ra_stat_string[] = {
 	[RA_STAT_EOF] = "read-ahead to EOF",
 	[RA_STAT_MAX_IN_FLIGHT] = "hit max r-a issue",
 	[RA_STAT_WRONG_GRAB_PAGE] = "wrong page from grab_cache_page",
-	[RA_STAT_FAILED_REACH_END] = "failed to reach end"
+	[RA_STAT_FAILED_REACH_END] = "failed to reach end",
+	[RA_STAT_SEQUENTIAL] = "sequential read-ahead",
+	[RA_STAT_STRIDE] = "stride read-ahead",
+	[RA_STAT_REVERSE] = "reverse read-ahead",
+	[RA_STAT_NEW_STREAM] = "new read-ahead stream",
+	[RA_STAT_ASYNC] = "async read-ahead",
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
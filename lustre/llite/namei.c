@@ -296,6 +296,8 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock, __u64 to_cancel)
 			CDEBUG(D_INODE, "cannot invalidate layout of "
 			       DFID": rc = %d\n",
 			       PFID(ll_inode2fid(inode)), rc);
+
+		pcc_layout_invalidate(inode);
 	}
 
 	if (bits & MDS_INODELOCK_UPDATE) {
@@ -304,6 +306,12 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock, __u64 to_cancel)
 		lli->lli_update_atime = 1;
 	}
 
+	/* a writer opened the file or its layout changed, see
+	 * mdt_som_strict_break()
+	 */
+	if (bits & (MDS_INODELOCK_UPDATE | MDS_INODELOCK_LAYOUT))
+		ll_file_clear_flag(ll_i2info(inode), LLIF_SOM_STRICT);
+
 	if ((bits & MDS_INODELOCK_UPDATE) && S_ISDIR(inode->i_mode)) {
 		struct ll_inode_info *lli = ll_i2info(inode);
 
@@ -311,6 +319,7 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock, __u64 to_cancel)
 		       "pfid  = "DFID"\n", PFID(ll_inode2fid(inode)),
 		       lli, PFID(&lli->lli_pfid));
 		truncate_inode_pages(inode->i_mapping, 0);
+		ll_dir_names_invalidate(inode);
 
 		if (unlikely(!fid_is_zero(&lli->lli_pfid))) {
 			struct inode *master_inode = NULL;
@@ -365,6 +374,10 @@ static void ll_lock_cancel_bits(struct ldlm_lock *lock, __u64 to_cancel)
 	if (bits & (MDS_INODELOCK_LOOKUP | MDS_INODELOCK_PERM))
 		forget_all_cached_acls(inode);
 
+	/* the dir may have been renamed to another parent */
+	if ((bits & MDS_INODELOCK_LOOKUP) && S_ISDIR(inode->i_mode))
+		ll_dir_parent_invalidate(inode);
+
 	iput(inode);
 	RETURN_EXIT;
 }
@@ -386,9 +399,24 @@ int ll_md_need_convert(struct ldlm_lock *lock)
 	if (!wanted || !bits || ldlm_is_cancel(lock))
 		return 0;
 
-	/* do not convert locks other than DOM for now */
-	if (!((bits | wanted) & MDS_INODELOCK_DOM))
-		return 0;
+	/* DOM locks are always converted, the other ones only if this is
+	 * enabled for the mount, keeping e.g. the LOOKUP bit of a directory
+	 * when its UPDATE bit is wanted. Open locks are never converted.
+	 */
+	if (!((bits | wanted) & MDS_INODELOCK_DOM)) {
+		bool convert;
+
+		if ((bits | wanted) & MDS_INODELOCK_OPEN)
+			return 0;
+
+		inode = ll_inode_from_resource_lock(lock);
+		if (!inode)
+			return 0;
+		convert = ll_i2sbi(inode)->ll_flags & LL_SBI_MD_CONVERT;
+		iput(inode);
+		if (!convert)
+			return 0;
+	}
 
 	/* We may have already remaining bits in some other lock so
 	 * lock convert will leave us just extra lock for the same bit.
@@ -607,6 +635,70 @@ struct dentry *ll_splice_alias(struct inode *inode, struct dentry *de)
         return de;
 }
 
+/* after so many negative lookups in a dir without UPDATE lock, get this lock
+ * to keep the negative dentries of the next lookups valid */
+#define LL_NEG_LOOKUPS_LOCK	4
+
+/**
+ * Check whether the negative dentry of \a name in \a parent is protected by
+ * the UPDATE lock of \a parent, or of the stripe of \a name in a striped dir.
+ *
+ * \retval 1 if the lock is held
+ * \retval 0 if not
+ * \retval negative errno on error
+ */
+static int ll_parent_update_locked(struct inode *parent,
+				   const struct qstr *name)
+{
+	struct lookup_intent parent_it = { .it_op = IT_READDIR,
+					   .it_lock_handle = 0 };
+	struct lu_fid fid = ll_i2info(parent)->lli_fid;
+	int rc;
+
+	/* If it is striped directory, get the real stripe parent */
+	if (unlikely(ll_i2info(parent)->lli_lsm_md != NULL)) {
+		rc = md_get_fid_from_lsm(ll_i2mdexp(parent),
+					 ll_i2info(parent)->lli_lsm_md,
+					 (const char *)name->name, name->len,
+					 &fid);
+		if (rc != 0)
+			return rc;
+	}
+
+	if (!md_revalidate_lock(ll_i2mdexp(parent), &parent_it, &fid, NULL))
+		return 0;
+
+	ll_intent_release(&parent_it);
+	return 1;
+}
+
+/*
+ * The MDT doesn't return a lock for a negative lookup, so negative dentries
+ * are only valid when the client already holds the UPDATE lock of the parent,
+ * which is not the case for a dir that is only walked through. Once a dir gets
+ * LL_NEG_LOOKUPS_LOCK negative lookups, getattr it to get its UPDATE lock, so
+ * that the lookups of missing names which follow, like the probes of include
+ * or module search paths, are cached until another client changes the dir.
+ */
+static void ll_negative_dentry_lock(struct dentry *dentry)
+{
+	struct dentry *parent = dentry->d_parent;
+	struct ll_inode_info *lli = ll_i2info(parent->d_inode);
+	int rc;
+
+	/* the negative dentries of a striped dir are under its stripe locks */
+	if (lli->lli_lsm_md != NULL)
+		return;
+
+	if (++lli->lli_neg_lookups < LL_NEG_LOOKUPS_LOCK)
+		return;
+	lli->lli_neg_lookups = 0;
+
+	rc = ll_inode_revalidate(parent, IT_GETATTR);
+	CDEBUG(D_DENTRY, "lock dir "DFID" for negative dentries: rc = %d\n",
+	       PFID(&lli->lli_fid), rc);
+}
+
 static int ll_lookup_it_finish(struct ptlrpc_request *request,
 			       struct lookup_intent *it,
 			       struct inode *parent, struct dentry **de,
@@ -694,26 +786,16 @@ static int ll_lookup_it_finish(struct ptlrpc_request *request,
 		 * in ll_create_it if the lock allows for it.
 		 */
 		/* Check that parent has UPDATE lock. */
-		struct lookup_intent parent_it = {
-					.it_op = IT_GETATTR,
-					.it_lock_handle = 0 };
-		struct lu_fid	fid = ll_i2info(parent)->lli_fid;
-
-		/* If it is striped directory, get the real stripe parent */
-		if (unlikely(ll_i2info(parent)->lli_lsm_md != NULL)) {
-			rc = md_get_fid_from_lsm(ll_i2mdexp(parent),
-						 ll_i2info(parent)->lli_lsm_md,
-						 (*de)->d_name.name,
-						 (*de)->d_name.len, &fid);
-			if (rc != 0)
-				GOTO(out, rc);
-		}
+		rc = ll_parent_update_locked(parent, &(*de)->d_name);
+		if (rc < 0)
+			GOTO(out, rc);
 
-		if (md_revalidate_lock(ll_i2mdexp(parent), &parent_it, &fid,
-				       NULL)) {
+		/* The lock got after the lookup doesn't cover its result,
+		 * only the next ones. */
+		if (rc > 0)
 			d_lustre_revalidate(*de);
-			ll_intent_release(&parent_it);
-		}
+		else
+			ll_negative_dentry_lock(*de);
 	}
 
 	if (it_disposition(it, DISP_OPEN_CREATE)) {
@@ -766,6 +848,23 @@ static struct dentry *ll_lookup_it(struct inode *parent, struct dentry *dentry,
 			RETURN(dentry == save ? NULL : dentry);
 	}
 
+	/* the name is not in the dirents read under the UPDATE lock of the
+	 * parent, so it doesn't exist as long as this lock is held */
+	if ((it->it_op == IT_LOOKUP || it->it_op == IT_GETATTR) &&
+	    ll_dir_name_absent(parent, &dentry->d_name)) {
+		if (ll_parent_update_locked(parent, &dentry->d_name) > 0) {
+			retval = ll_splice_alias(NULL, dentry);
+			if (IS_ERR(retval))
+				RETURN(retval);
+
+			d_lustre_revalidate(retval);
+			CDEBUG(D_DENTRY, "%.*s not in dir "DFID"\n",
+			       dentry->d_name.len, dentry->d_name.name,
+			       PFID(ll_inode2fid(parent)));
+			RETURN(retval == save ? NULL : retval);
+		}
+	}
+
 	if (it->it_op & IT_OPEN && it->it_flags & FMODE_WRITE &&
 	    dentry->d_sb->s_flags & SB_RDONLY)
 		RETURN(ERR_PTR(-EROFS));
@@ -1706,8 +1805,11 @@ static int ll_rename(struct inode *src, struct dentry *src_dchild,
 	if (IS_ERR(op_data))
 		RETURN(PTR_ERR(op_data));
 
-	if (src_dchild->d_inode != NULL)
+	if (src_dchild->d_inode != NULL) {
 		op_data->op_fid3 = *ll_inode2fid(src_dchild->d_inode);
+		/* lets the MDT skip the exclusive rename lock for files */
+		op_data->op_mode = src_dchild->d_inode->i_mode;
+	}
 
 	if (tgt_dchild->d_inode != NULL)
 		op_data->op_fid4 = *ll_inode2fid(tgt_dchild->d_inode);
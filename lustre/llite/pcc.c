@@ -0,0 +1,721 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/llite/pcc.c
+ *
+ * Persistent Client Cache, see pcc.h
+ *
+ * The cache copy of a file is at the path lhsmtool_posix archives the file
+ * to, under the root of the cache, so that the copytool started on the
+ * client with
+ *   lhsmtool_posix --archive=<pccs_rwid> --hsm-root=<pccs_path> <mount point>
+ * restores the files of the cache.
+ */
+
+#define DEBUG_SUBSYSTEM S_LLITE
+
+#include <linux/file.h>
+#include <linux/mount.h>
+#include <linux/namei.h>
+#include <linux/splice.h>
+#include <linux/cred.h>
+
+#include "llite_internal.h"
+
+/* bytes copied to the cache between two checks of the signals */
+#define PCC_COPY_CHUNK	(4 << 20)
+
+void pcc_super_init(struct pcc_super *super)
+{
+	init_rwsem(&super->pccs_rw_sem);
+	super->pccs_path = NULL;
+	super->pccs_rwid = 0;
+	super->pccs_cred = NULL;
+}
+
+void pcc_super_fini(struct pcc_super *super)
+{
+	if (super->pccs_path != NULL)
+		OBD_FREE(super->pccs_path, strlen(super->pccs_path) + 1);
+	if (super->pccs_cred != NULL)
+		put_cred(super->pccs_cred);
+}
+
+int pcc_super_show(struct seq_file *m, struct pcc_super *super)
+{
+	down_read(&super->pccs_rw_sem);
+	if (super->pccs_path != NULL)
+		seq_printf(m, "%u %s\n", super->pccs_rwid, super->pccs_path);
+	else
+		seq_puts(m, "NONE\n");
+	up_read(&super->pccs_rw_sem);
+
+	return 0;
+}
+
+/**
+ * Set the cache from "<archive ID> <root path>", or unset it from "0".
+ *
+ * The cache copies are accessed with the credentials of the caller.
+ */
+int pcc_super_set(struct pcc_super *super, char *buffer)
+{
+	const struct cred *cred = NULL;
+	char *path = NULL;
+	char *id;
+	unsigned int rwid;
+	int len = 0;
+	int rc;
+
+	buffer = strim(buffer);
+	id = strsep(&buffer, " \t");
+	rc = kstrtouint(id, 0, &rwid);
+	if (rc != 0)
+		return rc;
+
+	if (rwid != 0) {
+		if (buffer == NULL)
+			return -EINVAL;
+
+		buffer = skip_spaces(buffer);
+		if (buffer[0] != '/')
+			return -EINVAL;
+
+		len = strlen(buffer) + 1;
+		if (len > PATH_MAX)
+			return -ENAMETOOLONG;
+
+		OBD_ALLOC(path, len);
+		if (path == NULL)
+			return -ENOMEM;
+		memcpy(path, buffer, len);
+		cred = get_current_cred();
+	} else if (buffer != NULL) {
+		return -EINVAL;
+	}
+
+	down_write(&super->pccs_rw_sem);
+	swap(super->pccs_path, path);
+	swap(super->pccs_cred, cred);
+	super->pccs_rwid = rwid;
+	up_write(&super->pccs_rw_sem);
+
+	if (path != NULL)
+		OBD_FREE(path, strlen(path) + 1);
+	if (cred != NULL)
+		put_cred(cred);
+
+	return 0;
+}
+
+/* The path lhsmtool_posix archives the file of FID \a fid to */
+static int pcc_fid2path(struct pcc_super *super, const struct lu_fid *fid,
+			char *buf, int size)
+{
+	int len;
+
+	len = snprintf(buf, size, "%s/%04x/%04x/%04x/%04x/%04x/%04x/"
+		       DFID_NOBRACE, super->pccs_path,
+		       fid->f_oid & 0xFFFF,
+		       fid->f_oid >> 16 & 0xFFFF,
+		       (unsigned int)(fid->f_seq & 0xFFFF),
+		       (unsigned int)(fid->f_seq >> 16 & 0xFFFF),
+		       (unsigned int)(fid->f_seq >> 32 & 0xFFFF),
+		       (unsigned int)(fid->f_seq >> 48 & 0xFFFF),
+		       PFID(fid));
+
+	return len < size ? 0 : -ENAMETOOLONG;
+}
+
+static int pcc_mkdir(const char *path)
+{
+	struct dentry *dentry;
+	struct path parent;
+	int rc;
+
+	dentry = kern_path_create(AT_FDCWD, path, &parent, LOOKUP_DIRECTORY);
+	if (IS_ERR(dentry))
+		return PTR_ERR(dentry);
+
+	rc = vfs_mkdir(parent.dentry->d_inode, dentry, 0700);
+	done_path_create(&parent, dentry);
+
+	return rc;
+}
+
+/* Create the directories of \a path after its first \a skip bytes */
+static int pcc_mkdir_parents(char *path, int skip)
+{
+	char *p = path + skip;
+	int rc;
+
+	while ((p = strchr(p + 1, '/')) != NULL) {
+		*p = '\0';
+		rc = pcc_mkdir(path);
+		*p = '/';
+		if (rc != 0 && rc != -EEXIST)
+			return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Open the cache copy of \a inode, of archive ID \a id, creating it empty if
+ * \a create is set.
+ */
+static struct file *pcc_file_open(struct inode *inode, __u32 id, bool create)
+{
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+	const struct cred *old_cred;
+	struct file *pcc_file;
+	char *path;
+	int flags = O_RDWR | O_LARGEFILE;
+	int rc;
+	ENTRY;
+
+	OBD_ALLOC(path, PATH_MAX);
+	if (path == NULL)
+		RETURN(ERR_PTR(-ENOMEM));
+
+	down_read(&super->pccs_rw_sem);
+	if (super->pccs_path == NULL || id == 0 || id != super->pccs_rwid)
+		GOTO(out_unlock, pcc_file = ERR_PTR(-EINVAL));
+
+	rc = pcc_fid2path(super, ll_inode2fid(inode), path, PATH_MAX);
+	if (rc != 0)
+		GOTO(out_unlock, pcc_file = ERR_PTR(rc));
+
+	old_cred = override_creds(super->pccs_cred);
+	if (create) {
+		flags |= O_CREAT | O_TRUNC;
+		rc = pcc_mkdir_parents(path, strlen(super->pccs_path));
+	}
+	pcc_file = rc == 0 ? filp_open(path, flags, 0600) : ERR_PTR(rc);
+	revert_creds(old_cred);
+
+	if (IS_ERR(pcc_file))
+		GOTO(out_unlock, pcc_file);
+
+	if (!S_ISREG(file_inode(pcc_file)->i_mode) ||
+	    pcc_file->f_op->read_iter == NULL ||
+	    pcc_file->f_op->write_iter == NULL) {
+		fput(pcc_file);
+		GOTO(out_unlock, pcc_file = ERR_PTR(-EOPNOTSUPP));
+	}
+
+	CDEBUG(D_INODE, "%s: cache copy of "DFID" at %s\n",
+	       ll_get_fsname(inode->i_sb, NULL, 0), PFID(ll_inode2fid(inode)),
+	       path);
+	EXIT;
+out_unlock:
+	up_read(&super->pccs_rw_sem);
+	OBD_FREE(path, PATH_MAX);
+
+	return pcc_file;
+}
+
+struct file *pcc_file_create(struct inode *inode, __u32 id)
+{
+	struct obd_export *exp = ll_i2mdexp(inode);
+
+	if (!exp_connect_archive_id_array(exp) &&
+	    id > LL_HSM_ORIGIN_MAX_ARCHIVE)
+		return ERR_PTR(-EINVAL);
+
+	return pcc_file_open(inode, id, true);
+}
+
+/* Copy the data of \a file to its cache copy \a pcc_file */
+int pcc_file_copy(struct file *file, struct file *pcc_file)
+{
+	loff_t pos = 0;
+	loff_t pcc_pos = 0;
+	long rc;
+
+	while ((rc = do_splice_direct(file, &pos, pcc_file, &pcc_pos,
+				      PCC_COPY_CHUNK, 0)) > 0) {
+		if (fatal_signal_pending(current))
+			return -EINTR;
+	}
+	if (rc < 0)
+		return rc;
+
+	return ll_vfs_fsync_range(pcc_file, 0, LLONG_MAX, 0);
+}
+
+/* Remove the cache copy \a pcc_file of \a inode */
+void pcc_file_remove(struct inode *inode, struct file *pcc_file)
+{
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+	struct dentry *dentry = pcc_file->f_path.dentry;
+	const struct cred *old_cred;
+	struct dentry *parent;
+	int rc;
+
+	down_read(&super->pccs_rw_sem);
+	if (super->pccs_cred == NULL)
+		GOTO(out_unlock, rc = -EINVAL);
+
+	rc = mnt_want_write(pcc_file->f_path.mnt);
+	if (rc != 0)
+		GOTO(out_unlock, rc);
+
+	old_cred = override_creds(super->pccs_cred);
+	parent = dget_parent(dentry);
+	inode_lock(parent->d_inode);
+	if (dentry->d_parent == parent && !d_unhashed(dentry))
+		rc = ll_vfs_unlink(parent->d_inode, dentry);
+	inode_unlock(parent->d_inode);
+	dput(parent);
+	revert_creds(old_cred);
+	mnt_drop_write(pcc_file->f_path.mnt);
+out_unlock:
+	up_read(&super->pccs_rw_sem);
+
+	if (rc != 0)
+		CDEBUG(D_INODE, "%s: cannot remove cache copy of "DFID
+		       ": rc = %d\n", ll_get_fsname(inode->i_sb, NULL, 0),
+		       PFID(ll_inode2fid(inode)), rc);
+}
+
+/*
+ * Refresh the layout of \a inode, returning 1 if the file is released with
+ * the layout of version \a gen.
+ */
+static int pcc_layout_released(struct inode *inode, __u32 *gen)
+{
+	struct cl_object *obj = ll_i2info(inode)->lli_clob;
+	struct cl_layout cl = {
+		.cl_is_released = false,
+	};
+	struct lu_env *env;
+	__u16 refcheck;
+	int rc;
+
+	if (obj == NULL)
+		return 0;
+
+	rc = ll_layout_refresh(inode, gen);
+	if (rc != 0)
+		return rc;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		return PTR_ERR(env);
+
+	rc = cl_object_layout_get(env, obj, &cl);
+	cl_env_put(env, &refcheck);
+	if (rc != 0)
+		return rc;
+
+	return cl.cl_is_released && cl.cl_layout_gen == *gen;
+}
+
+/* Set \a pcc_file as the cache copy of \a inode of layout version \a gen */
+static int pcc_inode_install(struct inode *inode, struct file *pcc_file,
+			     __u32 gen)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct file *old = NULL;
+	int rc = 0;
+
+	down_write(&lli->lli_pcc_rwsem);
+	if (ll_layout_version_get(lli) != gen) {
+		rc = -EAGAIN;
+	} else {
+		old = lli->lli_pcc_file;
+		lli->lli_pcc_file = pcc_file;
+		lli->lli_pcc_gen = gen;
+	}
+	up_write(&lli->lli_pcc_rwsem);
+
+	if (old != NULL)
+		fput(old);
+
+	return rc;
+}
+
+/* Drop the cache copy of \a inode, if its layout is not of version \a gen */
+static struct file *pcc_inode_uninstall(struct inode *inode, __u32 gen)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct file *pcc_file = NULL;
+
+	down_write(&lli->lli_pcc_rwsem);
+	if (lli->lli_pcc_gen != gen) {
+		pcc_file = lli->lli_pcc_file;
+		lli->lli_pcc_file = NULL;
+		lli->lli_pcc_gen = CL_LAYOUT_GEN_NONE;
+	}
+	up_write(&lli->lli_pcc_rwsem);
+
+	return pcc_file;
+}
+
+/**
+ * Make \a pcc_file the cache copy of \a inode, of which it is the archive
+ * the file has just been released with. The reference on \a pcc_file is
+ * passed on success.
+ */
+int pcc_inode_attach(struct inode *inode, struct file *pcc_file)
+{
+	__u32 gen;
+	int rc;
+
+	rc = pcc_layout_released(inode, &gen);
+	if (rc < 0)
+		return rc;
+	/* restored in the meantime */
+	if (rc == 0)
+		return -EAGAIN;
+
+	return pcc_inode_install(inode, pcc_file, gen);
+}
+
+static int pcc_hsm_state_get(struct inode *inode, struct hsm_user_state *hus)
+{
+	struct md_op_data *op_data;
+	int rc;
+
+	op_data = ll_prep_md_op_data(NULL, inode, NULL, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, hus);
+	if (IS_ERR(op_data))
+		return PTR_ERR(op_data);
+
+	rc = obd_iocontrol(LL_IOC_HSM_STATE_GET, ll_i2mdexp(inode),
+			   sizeof(*op_data), op_data, NULL);
+	ll_finish_md_op_data(op_data);
+
+	return rc;
+}
+
+/* Whether the cache copy of \a inode is its HSM archive */
+static bool pcc_inode_archived(struct inode *inode, __u32 id)
+{
+	struct hsm_user_state hus;
+
+	if (pcc_hsm_state_get(inode, &hus) != 0)
+		return false;
+
+	return hus.hus_states & HS_ARCHIVED && hus.hus_archive_id == id;
+}
+
+/**
+ * Find back the cache copy of \a inode at the open of the file, if it is a
+ * file released to the cache of the client.
+ */
+void pcc_inode_open(struct inode *inode)
+{
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct file *pcc_file;
+	__u32 rwid = super->pccs_rwid;
+	__u32 gen;
+
+	if (rwid == 0 || lli->lli_pcc_file != NULL)
+		return;
+
+	if (pcc_layout_released(inode, &gen) <= 0)
+		return;
+
+	if (!pcc_inode_archived(inode, rwid))
+		return;
+
+	pcc_file = pcc_file_open(inode, rwid, false);
+	if (IS_ERR(pcc_file)) {
+		CDEBUG(D_INODE, "%s: no cache copy of "DFID": rc = %ld\n",
+		       ll_get_fsname(inode->i_sb, NULL, 0),
+		       PFID(ll_inode2fid(inode)), PTR_ERR(pcc_file));
+		return;
+	}
+
+	if (pcc_inode_install(inode, pcc_file, gen) != 0)
+		fput(pcc_file);
+}
+
+/**
+ * Detach \a inode from the cache of the client, restoring the file from its
+ * cache copy, which is removed then.
+ */
+int pcc_inode_detach(struct inode *inode)
+{
+	struct pcc_super *super = &ll_i2sbi(inode)->ll_pcc_super;
+	struct hsm_state_set hss = {
+		.hss_valid = HSS_CLEARMASK,
+		.hss_clearmask = HS_EXISTS | HS_ARCHIVED | HS_DIRTY,
+	};
+	const struct cred *old_cred;
+	struct file *pcc_file;
+	__u32 rwid = super->pccs_rwid;
+	__u32 gen;
+	int rc;
+	ENTRY;
+
+	if (!S_ISREG(inode->i_mode) || rwid == 0)
+		RETURN(-EINVAL);
+
+	rc = pcc_layout_released(inode, &gen);
+	if (rc > 0) {
+		rc = ll_layout_restore(inode, 0, OBD_OBJECT_EOF);
+		if (rc != 0)
+			RETURN(rc);
+
+		/* block on the layout lock the MDT holds during the restore */
+		rc = pcc_layout_released(inode, &gen);
+		if (rc > 0)
+			rc = -EIO;
+	}
+	if (rc < 0)
+		RETURN(rc);
+
+	pcc_file = pcc_inode_uninstall(inode, gen);
+	if (!pcc_inode_archived(inode, rwid))
+		GOTO(out, rc = 0);
+
+	if (pcc_file == NULL) {
+		pcc_file = pcc_file_open(inode, rwid, false);
+		if (IS_ERR(pcc_file))
+			GOTO(out, rc = PTR_ERR(pcc_file));
+	}
+
+	/* the cache copy is no longer the archive of the file */
+	rc = -EINVAL;
+	down_read(&super->pccs_rw_sem);
+	if (super->pccs_cred != NULL) {
+		old_cred = override_creds(super->pccs_cred);
+		rc = ll_hsm_state_set(inode, &hss);
+		revert_creds(old_cred);
+	}
+	up_read(&super->pccs_rw_sem);
+
+	if (rc == 0)
+		pcc_file_remove(inode, pcc_file);
+	EXIT;
+out:
+	if (pcc_file != NULL && !IS_ERR(pcc_file))
+		fput(pcc_file);
+
+	return rc;
+}
+
+void pcc_inode_fini(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+
+	if (lli->lli_pcc_file != NULL) {
+		fput(lli->lli_pcc_file);
+		lli->lli_pcc_file = NULL;
+	}
+}
+
+/*
+ * Start an IO on the cache copy of \a inode, if it is valid for the current
+ * layout of the file, returning with lli_pcc_rwsem held for read then.
+ */
+static struct file *pcc_io_start(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct file *pcc_file;
+	__u32 gen;
+
+	if (lli->lli_pcc_file == NULL)
+		return NULL;
+
+	if (ll_layout_refresh(inode, &gen) != 0)
+		return NULL;
+
+	down_read(&lli->lli_pcc_rwsem);
+	if (lli->lli_pcc_file != NULL && lli->lli_pcc_gen == gen &&
+	    ll_layout_version_get(lli) == gen)
+		return lli->lli_pcc_file;
+	up_read(&lli->lli_pcc_rwsem);
+
+	/* the file was restored, its data is back on the OSTs */
+	pcc_file = pcc_inode_uninstall(inode, gen);
+	if (pcc_file != NULL)
+		fput(pcc_file);
+
+	return NULL;
+}
+
+static void pcc_io_end(struct inode *inode)
+{
+	up_read(&ll_i2info(inode)->lli_pcc_rwsem);
+}
+
+ssize_t pcc_file_read_iter(struct kiocb *iocb, struct iov_iter *iter,
+			   bool *cached)
+{
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct file *pcc_file;
+	struct kiocb kiocb;
+	ssize_t rc;
+
+	pcc_file = pcc_io_start(inode);
+	*cached = pcc_file != NULL;
+	if (!*cached)
+		return 0;
+
+	init_sync_kiocb(&kiocb, pcc_file);
+	kiocb.ki_pos = iocb->ki_pos;
+	rc = pcc_file->f_op->read_iter(&kiocb, iter);
+	if (rc > 0)
+		iocb->ki_pos = kiocb.ki_pos;
+	pcc_io_end(inode);
+
+	if (rc > 0)
+		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_READ_BYTES, rc);
+
+	return rc;
+#else
+	*cached = false;
+	return 0;
+#endif
+}
+
+ssize_t pcc_file_write_iter(struct kiocb *iocb, struct iov_iter *iter,
+			    bool *cached)
+{
+#ifdef HAVE_FILE_OPERATIONS_READ_WRITE_ITER
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct file *pcc_file;
+	struct kiocb kiocb;
+	ssize_t rc;
+	int rc2;
+
+	pcc_file = pcc_io_start(inode);
+	*cached = pcc_file != NULL;
+	if (!*cached)
+		return 0;
+
+	init_sync_kiocb(&kiocb, pcc_file);
+	kiocb.ki_pos = iocb->ki_pos;
+	if (file->f_flags & O_APPEND)
+#ifdef IOCB_APPEND
+		kiocb.ki_flags |= IOCB_APPEND;
+#else
+		kiocb.ki_pos = i_size_read(file_inode(pcc_file));
+#endif
+
+	file_start_write(pcc_file);
+	rc = pcc_file->f_op->write_iter(&kiocb, iter);
+	file_end_write(pcc_file);
+
+	if (rc > 0) {
+		iocb->ki_pos = kiocb.ki_pos;
+		if (file->f_flags & O_DSYNC || IS_SYNC(inode)) {
+			rc2 = ll_vfs_fsync_range(pcc_file, kiocb.ki_pos - rc,
+						 kiocb.ki_pos - 1,
+						 !(file->f_flags & __O_SYNC));
+			if (rc2 < 0)
+				rc = rc2;
+		}
+
+		ll_inode_size_lock(inode);
+		if (i_size_read(inode) < kiocb.ki_pos)
+			i_size_write(inode, kiocb.ki_pos);
+		ll_inode_size_unlock(inode);
+	}
+	pcc_io_end(inode);
+
+	if (rc > 0)
+		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_WRITE_BYTES, rc);
+
+	return rc;
+#else
+	*cached = false;
+	return 0;
+#endif
+}
+
+int pcc_fsync(struct inode *inode, loff_t start, loff_t end, int datasync)
+{
+	struct file *pcc_file;
+	int rc;
+
+	pcc_file = pcc_io_start(inode);
+	if (pcc_file == NULL)
+		return 0;
+
+	rc = ll_vfs_fsync_range(pcc_file, start, end, datasync);
+	pcc_io_end(inode);
+
+	return rc;
+}
+
+/**
+ * Take the size, blocks and times of the data of \a inode from its cache
+ * copy, returning whether it has one.
+ */
+bool pcc_inode_getattr(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct inode *pcc_inode;
+	bool cached = false;
+
+	if (lli->lli_pcc_file == NULL)
+		return false;
+
+	down_read(&lli->lli_pcc_rwsem);
+	if (lli->lli_pcc_file != NULL &&
+	    lli->lli_pcc_gen == ll_layout_version_get(lli)) {
+		pcc_inode = file_inode(lli->lli_pcc_file);
+
+		ll_inode_size_lock(inode);
+		i_size_write(inode, i_size_read(pcc_inode));
+		inode->i_blocks = pcc_inode->i_blocks;
+		ll_inode_size_unlock(inode);
+
+		if (inode->i_mtime.tv_sec < pcc_inode->i_mtime.tv_sec) {
+			inode->i_mtime = pcc_inode->i_mtime;
+			lli->lli_mtime = inode->i_mtime.tv_sec;
+		}
+		if (inode->i_ctime.tv_sec < pcc_inode->i_ctime.tv_sec) {
+			inode->i_ctime = pcc_inode->i_ctime;
+			lli->lli_ctime = inode->i_ctime.tv_sec;
+		}
+		cached = true;
+	}
+	up_read(&lli->lli_pcc_rwsem);
+
+	return cached;
+}
+
+/*
+ * The layout lock of \a inode is lost, wait for the IOs started on its cache
+ * copy, for the restore of the file to copy the data they wrote.
+ */
+void pcc_layout_invalidate(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+
+	if (!S_ISREG(inode->i_mode) || lli->lli_pcc_file == NULL)
+		return;
+
+	down_write(&lli->lli_pcc_rwsem);
+	up_write(&lli->lli_pcc_rwsem);
+}
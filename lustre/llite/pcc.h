@@ -0,0 +1,72 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * Persistent Client Cache
+ *
+ * A file attached to the cache of a client has a copy on a local file system
+ * of the client, which is its HSM archive of ID pccs_rwid. The file is
+ * released on the MDT and the reads and writes of the client go to the local
+ * copy, while the layout of the released file stays unchanged. Any access
+ * that needs the data on the OSTs restores the file from the local copy,
+ * with a copytool running on the client, which is what revokes the layout
+ * lock and detaches the local copy.
+ */
+#ifndef _PCC_H
+#define _PCC_H
+
+#include <linux/fs.h>
+#include <linux/seq_file.h>
+#include <linux/uio.h>
+
+struct pcc_super {
+	/* protects the fields below */
+	struct rw_semaphore	 pccs_rw_sem;
+	/* root of the cache copies, NULL when the cache is not set */
+	char			*pccs_path;
+	/* HSM archive ID of the cache copies */
+	__u32			 pccs_rwid;
+	/* credentials to access the cache copies with */
+	const struct cred	*pccs_cred;
+};
+
+void pcc_super_init(struct pcc_super *super);
+void pcc_super_fini(struct pcc_super *super);
+int pcc_super_show(struct seq_file *m, struct pcc_super *super);
+int pcc_super_set(struct pcc_super *super, char *buffer);
+
+struct file *pcc_file_create(struct inode *inode, __u32 id);
+int pcc_file_copy(struct file *file, struct file *pcc_file);
+void pcc_file_remove(struct inode *inode, struct file *pcc_file);
+int pcc_inode_attach(struct inode *inode, struct file *pcc_file);
+void pcc_inode_open(struct inode *inode);
+int pcc_inode_detach(struct inode *inode);
+void pcc_inode_fini(struct inode *inode);
+
+ssize_t pcc_file_read_iter(struct kiocb *iocb, struct iov_iter *iter,
+			   bool *cached);
+ssize_t pcc_file_write_iter(struct kiocb *iocb, struct iov_iter *iter,
+			    bool *cached);
+int pcc_fsync(struct inode *inode, loff_t start, loff_t end, int datasync);
+bool pcc_inode_getattr(struct inode *inode);
+void pcc_layout_invalidate(struct inode *inode);
+
+#endif /* _PCC_H */
@@ -49,9 +49,16 @@
  */
 void range_lock_tree_init(struct range_lock_tree *tree)
 {
+	int i;
+
 	tree->rlt_root = NULL;
-	tree->rlt_sequence = 0;
+	atomic64_set(&tree->rlt_sequence, 0);
 	spin_lock_init(&tree->rlt_lock);
+	for (i = 0; i < RL_SHARD_NR; i++) {
+		spin_lock_init(&tree->rlt_shards[i].rls_lock);
+		tree->rlt_shards[i].rls_root = NULL;
+		tree->rlt_shards[i].rls_wide = 0;
+	}
 }
 
 /**
@@ -88,6 +95,80 @@ static inline struct range_lock *next_lock(struct range_lock *lock)
 	return list_entry(lock->rl_next_lock.next, typeof(*lock), rl_next_lock);
 }
 
+/* Does @lock span several segments, and go to the tree of the whole file */
+static inline bool range_lock_is_wide(struct range_lock *lock)
+{
+	return (lock->rl_node.in_extent.start >> RL_SEG_SHIFT) !=
+	       (lock->rl_node.in_extent.end >> RL_SEG_SHIFT);
+}
+
+static inline struct range_lock_shard *
+range_lock_shard(struct range_lock_tree *tree, struct range_lock *lock)
+{
+	__u64 seg = lock->rl_node.in_extent.start >> RL_SEG_SHIFT;
+
+	return &tree->rlt_shards[seg & (RL_SHARD_NR - 1)];
+}
+
+/* Mask of the shards covered by a lock spanning several segments */
+static unsigned long range_lock_shard_mask(struct range_lock *lock)
+{
+	__u64 start = lock->rl_node.in_extent.start >> RL_SEG_SHIFT;
+	__u64 end = lock->rl_node.in_extent.end >> RL_SEG_SHIFT;
+	unsigned long mask = 0;
+
+	if (end - start >= RL_SHARD_NR - 1)
+		return (1UL << RL_SHARD_NR) - 1;
+
+	for (; start <= end; start++)
+		mask |= 1UL << (start & (RL_SHARD_NR - 1));
+
+	return mask;
+}
+
+/*
+ * Take the lock of the whole file, then the locks of the shards in @mask in
+ * ascending order. Callers holding one shard lock only never wait for
+ * rlt_lock, so this order cannot deadlock.
+ */
+static void range_lock_tree_lock(struct range_lock_tree *tree,
+				 unsigned long mask)
+{
+	int i;
+
+	spin_lock(&tree->rlt_lock);
+	for_each_set_bit(i, &mask, RL_SHARD_NR)
+		spin_lock_nested(&tree->rlt_shards[i].rls_lock, i);
+}
+
+static void range_lock_shards_unlock(struct range_lock_tree *tree,
+				     unsigned long mask)
+{
+	int i;
+
+	for_each_set_bit(i, &mask, RL_SHARD_NR)
+		spin_unlock(&tree->rlt_shards[i].rls_lock);
+}
+
+/*
+ * Take the lock of @shard, and the lock of the whole file before it if some
+ * lock of the whole file covers @shard.
+ *
+ * \retval true if the lock of the whole file is held
+ */
+static bool range_lock_shard_lock(struct range_lock_tree *tree,
+				  struct range_lock_shard *shard)
+{
+	spin_lock(&shard->rls_lock);
+	if (likely(shard->rls_wide == 0))
+		return false;
+
+	spin_unlock(&shard->rls_lock);
+	spin_lock(&tree->rlt_lock);
+	spin_lock(&shard->rls_lock);
+	return true;
+}
+
 /**
  * Helper function of range_unlock()
  *
@@ -120,21 +201,10 @@ static enum interval_iter range_unlock_cb(struct interval_node *node, void *arg)
 	RETURN(INTERVAL_ITER_CONT);
 }
 
-/**
- * Unlock a range lock, wake up locks blocked by this lock.
- *
- * \param tree [in]	range lock tree
- * \param lock [in]	range lock to be deleted
- *
- * If this lock has been granted, relase it; if not, just delete it from
- * the tree or the same region lock list. Wake up those locks only blocked
- * by this lock through range_unlock_cb().
- */
-void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
+/* Delete @lock from the tree @root or from the same region lock list */
+static void range_lock_erase(struct interval_node **root,
+			     struct range_lock *lock)
 {
-	ENTRY;
-
-	spin_lock(&tree->rlt_lock);
 	if (!list_empty(&lock->rl_next_lock)) {
 		struct range_lock *next;
 
@@ -142,8 +212,8 @@ void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
 			/* Insert the next same range lock into the tree */
 			next = next_lock(lock);
 			next->rl_lock_count = lock->rl_lock_count - 1;
-			interval_erase(&lock->rl_node, &tree->rlt_root);
-			interval_insert(&next->rl_node, &tree->rlt_root);
+			interval_erase(&lock->rl_node, root);
+			interval_insert(&next->rl_node, root);
 		} else {
 			/* find the first lock in tree */
 			list_for_each_entry(next, &lock->rl_next_lock,
@@ -159,12 +229,56 @@ void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
 		list_del_init(&lock->rl_next_lock);
 	} else {
 		LASSERT(interval_is_intree(&lock->rl_node));
-		interval_erase(&lock->rl_node, &tree->rlt_root);
+		interval_erase(&lock->rl_node, root);
+	}
+}
+
+/**
+ * Unlock a range lock, wake up locks blocked by this lock.
+ *
+ * \param tree [in]	range lock tree
+ * \param lock [in]	range lock to be deleted
+ *
+ * If this lock has been granted, relase it; if not, just delete it from
+ * the tree or the same region lock list. Wake up those locks only blocked
+ * by this lock through range_unlock_cb().
+ */
+void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
+{
+	struct interval_node_extent *ext = &lock->rl_node.in_extent;
+	struct range_lock_shard *shard;
+	unsigned long mask;
+	bool locked;
+	int i;
+	ENTRY;
+
+	if (range_lock_is_wide(lock)) {
+		mask = range_lock_shard_mask(lock);
+		range_lock_tree_lock(tree, mask);
+		range_lock_erase(&tree->rlt_root, lock);
+		interval_search(tree->rlt_root, ext, range_unlock_cb, lock);
+		for_each_set_bit(i, &mask, RL_SHARD_NR) {
+			shard = &tree->rlt_shards[i];
+			LASSERT(shard->rls_wide > 0);
+			shard->rls_wide--;
+			interval_search(shard->rls_root, ext, range_unlock_cb,
+					lock);
+		}
+		range_lock_shards_unlock(tree, mask);
+		spin_unlock(&tree->rlt_lock);
+		EXIT;
+		return;
 	}
 
-	interval_search(tree->rlt_root, &lock->rl_node.in_extent,
-			range_unlock_cb, lock);
-	spin_unlock(&tree->rlt_lock);
+	shard = range_lock_shard(tree, lock);
+	locked = range_lock_shard_lock(tree, shard);
+	range_lock_erase(&shard->rls_root, lock);
+	interval_search(shard->rls_root, ext, range_unlock_cb, lock);
+	if (locked) {
+		interval_search(tree->rlt_root, ext, range_unlock_cb, lock);
+		spin_unlock(&tree->rlt_lock);
+	}
+	spin_unlock(&shard->rls_lock);
 
 	EXIT;
 }
@@ -189,6 +303,24 @@ static enum interval_iter range_lock_cb(struct interval_node *node, void *arg)
 	RETURN(INTERVAL_ITER_CONT);
 }
 
+/*
+ * Insert @lock to the tree @root if it is unique, otherwise link it to the
+ * rl_next_lock of the lock which has the same range.
+ */
+static void range_lock_insert(struct interval_node **root,
+			      struct range_lock *lock)
+{
+	struct interval_node *node;
+
+	node = interval_insert(&lock->rl_node, root);
+	if (node != NULL) {
+		struct range_lock *tmp = node2rangelock(node);
+
+		list_add_tail(&lock->rl_next_lock, &tmp->rl_next_lock);
+		tmp->rl_lock_count++;
+	}
+}
+
 /**
  * Lock a region
  *
@@ -201,47 +333,65 @@ static enum interval_iter range_lock_cb(struct interval_node *node, void *arg)
  * If there exists overlapping range lock, the new lock will wait and
  * retry, if later it find that it is not the chosen one to wake up,
  * it wait again.
+ *
+ * The blocking count of a lock of a shard is protected by the lock of that
+ * shard, and the one of a lock of the whole file by rlt_lock: every lock
+ * overlapping it holds that lock to unlock.
  */
 int range_lock(struct range_lock_tree *tree, struct range_lock *lock)
 {
-	struct interval_node *node;
+	struct interval_node_extent *ext = &lock->rl_node.in_extent;
+	struct range_lock_shard *shard;
+	spinlock_t *wait_lock;
+	unsigned long mask;
 	int rc = 0;
+	int i;
 	ENTRY;
 
-	spin_lock(&tree->rlt_lock);
 	/*
 	 * We need to check for all conflicting intervals
-	 * already in the tree.
-	 */
-	interval_search(tree->rlt_root, &lock->rl_node.in_extent,
-			range_lock_cb, lock);
-	/*
-	 * Insert to the tree if I am unique, otherwise I've been linked to
-	 * the rl_next_lock of another lock which has the same range as mine
-	 * in range_lock_cb().
+	 * already in the tree and in the shards.
 	 */
-	node = interval_insert(&lock->rl_node, &tree->rlt_root);
-	if (node != NULL) {
-		struct range_lock *tmp = node2rangelock(node);
-
-		list_add_tail(&lock->rl_next_lock, &tmp->rl_next_lock);
-		tmp->rl_lock_count++;
+	if (range_lock_is_wide(lock)) {
+		mask = range_lock_shard_mask(lock);
+		range_lock_tree_lock(tree, mask);
+		interval_search(tree->rlt_root, ext, range_lock_cb, lock);
+		for_each_set_bit(i, &mask, RL_SHARD_NR) {
+			shard = &tree->rlt_shards[i];
+			interval_search(shard->rls_root, ext, range_lock_cb,
+					lock);
+			shard->rls_wide++;
+		}
+		range_lock_insert(&tree->rlt_root, lock);
+		lock->rl_sequence = atomic64_inc_return(&tree->rlt_sequence);
+		range_lock_shards_unlock(tree, mask);
+		wait_lock = &tree->rlt_lock;
+	} else {
+		shard = range_lock_shard(tree, lock);
+		if (range_lock_shard_lock(tree, shard)) {
+			interval_search(tree->rlt_root, ext, range_lock_cb,
+					lock);
+			spin_unlock(&tree->rlt_lock);
+		}
+		interval_search(shard->rls_root, ext, range_lock_cb, lock);
+		range_lock_insert(&shard->rls_root, lock);
+		lock->rl_sequence = atomic64_inc_return(&tree->rlt_sequence);
+		wait_lock = &shard->rls_lock;
 	}
-	lock->rl_sequence = ++tree->rlt_sequence;
 
 	while (lock->rl_blocking_ranges > 0) {
 		lock->rl_task = current;
 		__set_current_state(TASK_INTERRUPTIBLE);
-		spin_unlock(&tree->rlt_lock);
+		spin_unlock(wait_lock);
 		schedule();
 
 		if (signal_pending(current)) {
 			range_unlock(tree, lock);
 			GOTO(out, rc = -ERESTARTSYS);
 		}
-		spin_lock(&tree->rlt_lock);
+		spin_lock(wait_lock);
 	}
-	spin_unlock(&tree->rlt_lock);
+	spin_unlock(wait_lock);
 out:
 	RETURN(rc);
 }
@@ -74,10 +74,34 @@ static inline struct range_lock *node2rangelock(const struct interval_node *n)
 	return container_of(n, struct range_lock, rl_node);
 }
 
+/*
+ * The file is split into segments of RL_SEG_SHIFT pages, 4MiB with 4KiB
+ * pages. A lock within one segment only takes the lock of the shard of
+ * that segment, so that threads writing disjoint regions of a shared file
+ * do not contend on a single spinlock. A lock spanning several segments
+ * goes to the tree of the whole file, and takes the locks of all the shards
+ * it covers. RL_SHARD_NR is bounded by the lockdep subclasses.
+ */
+#define RL_SEG_SHIFT	10
+#define RL_SHARD_NR	8
+
+struct range_lock_shard {
+	spinlock_t		 rls_lock;
+	struct interval_node	*rls_root;
+	/**
+	 * Number of the locks of rlt_root covering this shard
+	 */
+	unsigned int		 rls_wide;
+};
+
 struct range_lock_tree {
+	/**
+	 * Locks spanning several segments, protected by rlt_lock
+	 */
 	struct interval_node	*rlt_root;
 	spinlock_t		 rlt_lock;
-	__u64			 rlt_sequence;
+	atomic64_t		 rlt_sequence;
+	struct range_lock_shard	 rlt_shards[RL_SHARD_NR];
 };
 
 void range_lock_tree_init(struct range_lock_tree *tree);
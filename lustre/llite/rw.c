@@ -152,16 +152,132 @@ static int index_in_window(unsigned long index, unsigned long point,
         return start <= index && index <= end;
 }
 
-void ll_ras_enter(struct file *f)
+static inline int stride_io_mode(struct ll_readahead_state *ras);
+static void ras_reset(struct inode *inode, struct ll_readahead_state *ras,
+		      unsigned long index);
+
+static inline bool ras_reverse_mode(struct ll_readahead_state *ras)
+{
+	return ras->ras_reverse_requests >= RAS_REVERSE_MIN;
+}
+
+/* Whether the stream \a ras expects a read of page \a index next */
+static bool ras_stream_match(struct ll_readahead_state *ras,
+			     unsigned long index)
+{
+	if (index_in_window(index, ras->ras_last_readpage, 8, 8))
+		return true;
+
+	if (ras->ras_window_len > 0 &&
+	    index_in_window(index, ras->ras_window_start, 0,
+			    ras->ras_window_len - 1))
+		return true;
+
+	if (stride_io_mode(ras) && index > ras->ras_last_readpage &&
+	    index - ras->ras_last_readpage <= ras->ras_stride_length)
+		return true;
+
+	if (ras_reverse_mode(ras) && index < ras->ras_request_start &&
+	    ras->ras_request_start - index <= ras->ras_window_len +
+					       ras->ras_rpc_size)
+		return true;
+
+	return false;
+}
+
+static unsigned long ras_distance(struct ll_readahead_state *ras,
+				  unsigned long index)
+{
+	return index > ras->ras_last_readpage ?
+	       index - ras->ras_last_readpage : ras->ras_last_readpage - index;
+}
+
+/**
+ * Find the read-ahead stream of \a fd reading page \a index.
+ *
+ * That is the most recently used stream expecting this read, if any.
+ * Otherwise the least recently used stream is recycled for a new one,
+ * starting as a copy of the stream nearest to \a index: the read could be
+ * a seek or a stride of that stream, whose detectors then see the jump as
+ * they would with a single stream, while the stream itself stays for the
+ * thread that may still be reading there.
+ */
+static struct ll_readahead_state *ll_ras_find(struct inode *inode,
+					      struct ll_file_data *fd,
+					      unsigned long index)
+{
+	unsigned int streams = ll_i2sbi(inode)->ll_ra_info.ra_streams;
+	struct ll_readahead_state *ras = NULL;
+	struct ll_readahead_state *lru = NULL;
+	struct ll_readahead_state *near = NULL;
+	struct ll_readahead_state copy;
+	int i;
+
+	if (streams <= 1)
+		return &fd->fd_ras[0];
+
+	spin_lock(&fd->fd_ras_lock);
+	for (i = 0; i < min_t(unsigned int, streams, LL_RA_STREAMS_MAX); i++) {
+		struct ll_readahead_state *cur = &fd->fd_ras[i];
+
+		/* NB: racy reads of the stream state, it doesn't matter */
+		if (cur->ras_stamp != 0 && ras_stream_match(cur, index) &&
+		    (ras == NULL || cur->ras_stamp > ras->ras_stamp))
+			ras = cur;
+		if (lru == NULL || cur->ras_stamp < lru->ras_stamp)
+			lru = cur;
+		if (cur->ras_stamp != 0 &&
+		    (near == NULL ||
+		     ras_distance(cur, index) < ras_distance(near, index)))
+			near = cur;
+	}
+
+	if (ras == NULL) {
+		ras = lru;
+		if (near != NULL && near != ras) {
+			/* the lock is the first member, not copied */
+			spin_lock(&near->ras_lock);
+			memcpy(&copy.ras_last_readpage, &near->ras_last_readpage,
+			       sizeof(copy) - offsetof(struct ll_readahead_state,
+						       ras_last_readpage));
+			spin_unlock(&near->ras_lock);
+
+			spin_lock(&ras->ras_lock);
+			memcpy(&ras->ras_last_readpage, &copy.ras_last_readpage,
+			       sizeof(copy) - offsetof(struct ll_readahead_state,
+						       ras_last_readpage));
+			spin_unlock(&ras->ras_lock);
+		} else if (near == NULL) {
+			spin_lock(&ras->ras_lock);
+			ras_reset(inode, ras, index);
+			spin_unlock(&ras->ras_lock);
+		}
+		ll_ra_stats_inc(inode, RA_STAT_NEW_STREAM);
+	}
+	ras->ras_stamp = ++fd->fd_ras_clock;
+	spin_unlock(&fd->fd_ras_lock);
+
+	return ras;
+}
+
+/**
+ * Account a read request starting at page \a index to the read-ahead
+ * stream it belongs to, which is returned.
+ */
+struct ll_readahead_state *ll_ras_enter(struct file *f, unsigned long index)
 {
 	struct ll_file_data *fd = LUSTRE_FPRIVATE(f);
-	struct ll_readahead_state *ras = &fd->fd_ras;
+	struct ll_readahead_state *ras;
+
+	ras = ll_ras_find(file_inode(f), fd, index);
 
 	spin_lock(&ras->ras_lock);
 	ras->ras_requests++;
 	ras->ras_request_index = 0;
 	ras->ras_consecutive_requests++;
 	spin_unlock(&ras->ras_lock);
+
+	return ras;
 }
 
 /**
@@ -437,6 +553,7 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	struct inode *inode;
 	struct ra_io_arg *ria = &lti->lti_ria;
 	struct cl_object *clob;
+	enum ra_stat pattern;
 	int ret = 0;
 	__u64 kms;
 	ENTRY;
@@ -498,6 +615,12 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
                 ria->ria_length = ras->ras_stride_length;
                 ria->ria_pages = ras->ras_stride_pages;
         }
+	if (stride_io_mode(ras))
+		pattern = RA_STAT_STRIDE;
+	else if (ras_reverse_mode(ras))
+		pattern = RA_STAT_REVERSE;
+	else
+		pattern = RA_STAT_SEQUENTIAL;
 	spin_unlock(&ras->ras_lock);
 
 	if (end == 0) {
@@ -541,6 +664,8 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	       ll_i2sbi(inode)->ll_ra_info.ra_max_pages);
 
 	ret = ll_read_ahead_pages(env, io, queue, ras, ria, &ra_end);
+	if (ret > 0)
+		ll_ra_stats_inc(inode, pattern);
 
 	if (ria->ria_reserved != 0)
 		ll_ra_count_put(ll_i2sbi(inode), ria->ria_reserved);
@@ -565,6 +690,206 @@ static int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	RETURN(ret);
 }
 
+/* read-ahead of a window queued to ra_async_wq */
+struct ll_readahead_work {
+	struct work_struct	 lrw_work;
+	struct file		*lrw_file;
+	struct ll_readahead_state *lrw_ras;
+	struct ra_io_arg	 lrw_ria;
+};
+
+static void ll_readahead_work_handler(struct work_struct *wq)
+{
+	struct ll_readahead_work *work = container_of(wq,
+						      struct ll_readahead_work,
+						      lrw_work);
+	struct ll_readahead_state *ras = work->lrw_ras;
+	struct file *file = work->lrw_file;
+	struct inode *inode = file_inode(file);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct cl_object *clob = ll_i2info(inode)->lli_clob;
+	struct ra_io_arg *ria;
+	struct cl_2queue *queue;
+	struct cl_attr *attr;
+	struct vvp_io *vio;
+	struct lu_env *env;
+	struct cl_io *io;
+	pgoff_t ra_end = 0;
+	unsigned long len;
+	__u16 refcheck;
+	int count = 0;
+	int rc;
+	ENTRY;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out_free, rc = PTR_ERR(env));
+
+	ria = &ll_env_info(env)->lti_ria;
+	*ria = work->lrw_ria;
+
+	attr = vvp_env_thread_attr(env);
+	cl_object_attr_lock(clob);
+	rc = cl_object_attr_get(env, clob, attr);
+	cl_object_attr_unlock(clob);
+	if (rc != 0 || attr->cat_kms == 0)
+		GOTO(out_env, rc);
+
+	/* Truncate RA window to end of file */
+	if (((attr->cat_kms - 1) >> PAGE_SHIFT) <= ria->ria_end) {
+		ria->ria_end = (attr->cat_kms - 1) >> PAGE_SHIFT;
+		ria->ria_eof = true;
+	}
+	if (ria->ria_end < ria->ria_start)
+		GOTO(out_env, rc = 0);
+
+	/* a read of the window, taking the DLM lock covering it and not
+	 * going to the page cache */
+	io = vvp_env_thread_io(env);
+	ll_io_init(io, file, CIT_READ);
+	rc = cl_io_rw_init(env, io, CIT_READ,
+			   (loff_t)ria->ria_start << PAGE_SHIFT,
+			   (size_t)(ria->ria_end - ria->ria_start + 1) <<
+			   PAGE_SHIFT);
+	if (rc != 0)
+		GOTO(out_io, rc);
+
+	vio = vvp_env_io(env);
+	vio->vui_fd = LUSTRE_FPRIVATE(file);
+	vio->vui_io_subtype = IO_NORMAL;
+	vio->vui_iter = NULL;
+	vio->vui_aio = NULL;
+
+	rc = cl_io_iter_init(env, io);
+	if (rc == 0)
+		rc = cl_io_lock(env, io);
+	if (rc != 0)
+		GOTO(out_iter, rc);
+
+	len = ria_page_count(ria);
+	ria->ria_reserved = ll_ra_count_get(sbi, ria, len, 0);
+	if (ria->ria_reserved < len)
+		ll_ra_stats_inc(inode, RA_STAT_MAX_IN_FLIGHT);
+
+	queue = &io->ci_queue;
+	cl_2queue_init(queue);
+	count = ll_read_ahead_pages(env, io, &queue->c2_qin, ras, ria,
+				    &ra_end);
+	if (ria->ria_reserved != 0)
+		ll_ra_count_put(sbi, ria->ria_reserved);
+
+	if (queue->c2_qin.pl_nr > 0) {
+		int nr = queue->c2_qin.pl_nr;
+
+		rc = cl_io_submit_rw(env, io, CRT_READ, queue);
+		if (rc == 0)
+			task_io_account_read(PAGE_SIZE * nr);
+	}
+	cl_page_list_discard(env, io, &queue->c2_qin);
+	cl_page_list_disown(env, io, &queue->c2_qin);
+	cl_2queue_fini(env, queue);
+
+	cl_io_unlock(env, io);
+	if (count > 0)
+		ll_ra_stats_inc(inode, RA_STAT_ASYNC);
+out_iter:
+	cl_io_iter_fini(env, io);
+out_io:
+	cl_io_fini(env, io);
+out_env:
+	/* give back to the readers what could not be read ahead here */
+	if (ra_end < work->lrw_ria.ria_end) {
+		spin_lock(&ras->ras_lock);
+		if (ras->ras_next_readahead > work->lrw_ria.ria_start)
+			ras->ras_next_readahead = max(work->lrw_ria.ria_start,
+						      ra_end + 1);
+		spin_unlock(&ras->ras_lock);
+	}
+	CDEBUG(D_READA, DFID": async read-ahead of %lu-%lu: %d pages, "
+	       "rc = %d\n", PFID(ll_inode2fid(inode)),
+	       work->lrw_ria.ria_start, work->lrw_ria.ria_end, count, rc);
+	cl_env_put(env, &refcheck);
+out_free:
+	fput(file);
+	OBD_FREE_PTR(work);
+	EXIT;
+}
+
+/**
+ * Have a worker read ahead the rest of the window of \a ras, reached by a
+ * cache hit of a reader of \a file, so that the reader does not build and
+ * send the RPCs itself.
+ *
+ * \retval true if the read-ahead is left to a worker
+ */
+static bool ll_readahead_async(struct file *file,
+			       struct ll_readahead_state *ras)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(file_inode(file));
+	struct ll_readahead_work *work;
+	struct ra_io_arg *ria;
+
+	if (sbi->ll_ra_info.ra_async_wq == NULL ||
+	    sbi->ll_ra_info.ra_async_max_active == 0)
+		return false;
+
+	OBD_ALLOC_PTR(work);
+	if (work == NULL)
+		return false;
+
+	ria = &work->lrw_ria;
+	spin_lock(&ras->ras_lock);
+	if (stride_io_mode(ras)) {
+		ria->ria_start = max(ras->ras_next_readahead,
+				     ras->ras_stride_offset);
+		ria->ria_stoff = ras->ras_stride_offset;
+		ria->ria_length = ras->ras_stride_length;
+		ria->ria_pages = ras->ras_stride_pages;
+	} else {
+		ria->ria_start = ras->ras_next_readahead;
+	}
+	ria->ria_end = ras->ras_window_start + ras->ras_window_len - 1;
+
+	/* less than an RPC left, read ahead with the next window */
+	if (ras->ras_window_len == 0 ||
+	    ria->ria_end + 1 < ria->ria_start + ras->ras_rpc_size) {
+		spin_unlock(&ras->ras_lock);
+		OBD_FREE_PTR(work);
+		return true;
+	}
+	/* the worker owns the window now */
+	ras->ras_next_readahead = ria->ria_end + 1;
+	spin_unlock(&ras->ras_lock);
+
+	INIT_WORK(&work->lrw_work, ll_readahead_work_handler);
+	work->lrw_file = get_file(file);
+	work->lrw_ras = ras;
+	queue_work(sbi->ll_ra_info.ra_async_wq, &work->lrw_work);
+
+	return true;
+}
+
+int ll_readahead_async_init(struct ll_sb_info *sbi)
+{
+	sbi->ll_ra_info.ra_async_max_active =
+		max_t(unsigned int, 1, num_online_cpus() / 2);
+	sbi->ll_ra_info.ra_async_wq =
+		alloc_workqueue("ll_readahead", WQ_UNBOUND,
+				sbi->ll_ra_info.ra_async_max_active);
+	if (sbi->ll_ra_info.ra_async_wq == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void ll_readahead_async_fini(struct ll_sb_info *sbi)
+{
+	if (sbi->ll_ra_info.ra_async_wq != NULL) {
+		destroy_workqueue(sbi->ll_ra_info.ra_async_wq);
+		sbi->ll_ra_info.ra_async_wq = NULL;
+	}
+}
+
 static void ras_set_start(struct inode *inode, struct ll_readahead_state *ras,
 			  unsigned long index)
 {
@@ -594,12 +919,26 @@ static void ras_stride_reset(struct ll_readahead_state *ras)
         RAS_CDEBUG(ras);
 }
 
-void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
+static void ll_readahead_init(struct inode *inode,
+			      struct ll_readahead_state *ras)
 {
 	spin_lock_init(&ras->ras_lock);
 	ras->ras_rpc_size = PTLRPC_MAX_BRW_PAGES;
 	ras_reset(inode, ras, 0);
 	ras->ras_requests = 0;
+	ras->ras_request_start = 0;
+	ras->ras_reverse_requests = 0;
+	ras->ras_stamp = 0;
+}
+
+void ll_ras_init(struct inode *inode, struct ll_file_data *fd)
+{
+	int i;
+
+	spin_lock_init(&fd->fd_ras_lock);
+	fd->fd_ras_clock = 0;
+	for (i = 0; i < LL_RA_STREAMS_MAX; i++)
+		ll_readahead_init(inode, &fd->fd_ras[i]);
 }
 
 /*
@@ -721,6 +1060,64 @@ static void ras_increase_window(struct inode *inode,
 	}
 }
 
+/*
+ * Detect the read requests going backward, from the first page \a index of
+ * a request, and read ahead the pages before them. Called with the ras_lock
+ * held.
+ *
+ * \retval true if the stream is read ahead backward
+ */
+static bool ras_reverse_update(struct inode *inode,
+			       struct ll_readahead_state *ras,
+			       struct ll_ra_info *ra, unsigned long index)
+{
+	unsigned long prev = ras->ras_request_start;
+	unsigned long start;
+	unsigned long end;
+	unsigned long len;
+
+	ras->ras_request_start = index;
+	if (index >= prev || prev - index > ra->ra_max_pages_per_file) {
+		/* back to a forward pattern, detected from scratch */
+		if (ras_reverse_mode(ras))
+			ras_reset(inode, ras, index);
+		ras->ras_reverse_requests = 0;
+		return false;
+	}
+
+	if (++ras->ras_reverse_requests < RAS_REVERSE_MIN)
+		return false;
+
+	/* drop the forward window when entering reverse mode */
+	if (ras->ras_reverse_requests == RAS_REVERSE_MIN) {
+		ras_stride_reset(ras);
+		ras->ras_window_len = 0;
+	}
+
+	ras->ras_last_readpage = index;
+	ras->ras_consecutive_pages = 1;
+
+	/* the pages before the reader are still being read ahead */
+	if (ras->ras_window_len > 0 &&
+	    index >= ras->ras_window_start + ras->ras_rpc_size)
+		return true;
+
+	/* the next window ends where the previous one started, growing by
+	 * an RPC each time */
+	end = ras->ras_window_len > 0 ? min(index, ras->ras_window_start) :
+					index;
+	len = min(ras->ras_window_len + ras->ras_rpc_size,
+		  ra->ra_max_pages_per_file);
+	start = end > len ? ras_align(ras, end - len, NULL) : 0;
+
+	ras->ras_window_start = start;
+	ras->ras_window_len = end - start;
+	ras->ras_next_readahead = start;
+	RAS_CDEBUG(ras);
+
+	return true;
+}
+
 static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		       struct ll_readahead_state *ras, unsigned long index,
 		       enum ras_update_flags flags)
@@ -737,6 +1134,16 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		       PFID(ll_inode2fid(inode)), index);
         ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
 
+	/* a request of a stream read backward, or the rest of it */
+	if (!(flags & LL_RAS_MMAP) && ras->ras_request_index == 0 &&
+	    ras_reverse_update(inode, ras, ra, index))
+		GOTO(out_unlock, 0);
+	if (ras_reverse_mode(ras)) {
+		ras->ras_consecutive_pages++;
+		ras->ras_last_readpage = index;
+		GOTO(out_unlock, 0);
+	}
+
         /* reset the read-ahead window in two cases.  First when the app seeks
          * or reads to some other part of the file.  Secondly if we get a
          * read-ahead miss that we think we've previously issued.  This can
@@ -1083,7 +1490,8 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 	struct inode              *inode  = vvp_object_inode(page->cp_obj);
 	struct ll_sb_info         *sbi    = ll_i2sbi(inode);
 	struct ll_file_data       *fd     = LUSTRE_FPRIVATE(file);
-	struct ll_readahead_state *ras    = &fd->fd_ras;
+	struct vvp_io		  *vio    = vvp_env_io(env);
+	struct ll_readahead_state *ras;
 	struct cl_2queue          *queue  = &io->ci_queue;
 	struct cl_sync_io	  *anchor = NULL;
 	struct vvp_page           *vpg;
@@ -1094,10 +1502,15 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 	vpg = cl2vvp_page(cl_object_page_slice(page->cp_obj, page));
 	uptodate = vpg->vpg_defer_uptodate;
 
+	/* the stream of the read(2), or of the page for mmap */
+	if (vio->vui_ra_valid && vio->vui_ras != NULL)
+		ras = vio->vui_ras;
+	else
+		ras = ll_ras_find(inode, fd, vvp_index(vpg));
+
 	if (sbi->ll_ra_info.ra_max_pages_per_file > 0 &&
 	    sbi->ll_ra_info.ra_max_pages > 0 &&
 	    !vpg->vpg_ra_updated) {
-		struct vvp_io *vio = vvp_env_io(env);
 		enum ras_update_flags flags = 0;
 
 		if (uptodate)
@@ -1120,8 +1533,11 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 		cl_2queue_add(queue, page);
 	}
 
+	/* a hit leaves the read-ahead to the workers, a miss gets the
+	 * read-ahead pages in the RPCs of the missed one */
 	if (sbi->ll_ra_info.ra_max_pages_per_file > 0 &&
-	    sbi->ll_ra_info.ra_max_pages > 0) {
+	    sbi->ll_ra_info.ra_max_pages > 0 &&
+	    !(uptodate && ll_readahead_async(file, ras))) {
 		int rc2;
 
 		rc2 = ll_readahead(env, io, &queue->c2_qin, ras,
@@ -1186,12 +1602,14 @@ int ll_readpage(struct file *file, struct page *vmpage)
 	if (io == NULL) { /* fast read */
 		struct inode *inode = file_inode(file);
 		struct ll_file_data *fd = LUSTRE_FPRIVATE(file);
-		struct ll_readahead_state *ras = &fd->fd_ras;
+		struct ll_readahead_state *ras;
 		struct lu_env  *local_env = NULL;
-		unsigned long fast_read_pages =
-			max(RA_REMAIN_WINDOW_MIN, ras->ras_rpc_size);
+		unsigned long fast_read_pages;
 		struct vvp_page *vpg;
 
+		ras = ll_ras_find(inode, fd, vmpage->index);
+		fast_read_pages = max(RA_REMAIN_WINDOW_MIN, ras->ras_rpc_size);
+
 		result = -ENODATA;
 
 		/* TODO: need to verify the layout version to make sure
@@ -1226,7 +1644,8 @@ int ll_readpage(struct file *file, struct page *vmpage)
 			 * the case, we can't do fast IO because we will need
 			 * a cl_io to issue the RPC. */
 			if (ras->ras_window_start + ras->ras_window_len <
-			    ras->ras_next_readahead + fast_read_pages) {
+			    ras->ras_next_readahead + fast_read_pages ||
+			    ll_readahead_async(file, ras)) {
 				/* export the page and skip io stack */
 				vpg->vpg_ra_used = 1;
 				cl_page_export(env, page, 1);
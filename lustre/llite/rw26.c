@@ -174,11 +174,118 @@ static int ll_releasepage(struct page *vmpage, RELEASEPAGE_ARG_TYPE gfp_mask)
 
 #define MAX_DIRECTIO_SIZE 2*1024*1024*1024UL
 
+static void ll_dio_aio_end(const struct lu_env *env, struct cl_sync_io *anchor)
+{
+	struct ll_dio_aio *aio = container_of(anchor, struct ll_dio_aio,
+					      lda_sync);
+	ssize_t rc = anchor->csi_sync_rc;
+	struct cl_page *page;
+
+	CDEBUG(D_VFSTRACE, "async direct IO of %zd bytes done: rc = %zd\n",
+	       aio->lda_bytes, rc);
+
+	/* Run by the thread noting the last page, likely a ptlrpcd one not
+	 * holding the inode lock, so the pages are unlinked by hand rather than
+	 * with cl_page_list_del(), asserting that. */
+	while (aio->lda_pages.pl_nr > 0) {
+		page = cl_page_list_first(&aio->lda_pages);
+
+		/* the user pages were dirtied before the data was in */
+		if (aio->lda_read && rc == 0)
+			set_page_dirty_lock(cl_page_vmpage(page));
+
+		list_del_init(&page->cp_batch);
+		aio->lda_pages.pl_nr--;
+		lu_ref_del_at(&page->cp_reference, &page->cp_queue_ref, "queue",
+			      &aio->lda_pages);
+		cl_page_delete(env, page);
+		cl_page_put(env, page);
+	}
+
+	ll_aio_complete(aio->lda_iocb, rc < 0 ? rc : aio->lda_bytes);
+	OBD_FREE_PTR(aio);
+}
+
+/**
+ * Prepare the asynchronous direct IO of \a iocb, or return NULL to have it
+ * done synchronously.
+ */
+struct ll_dio_aio *ll_dio_aio_alloc(struct kiocb *iocb, enum cl_io_type iot)
+{
+	struct ll_dio_aio *aio;
+
+	OBD_ALLOC_PTR(aio);
+	if (aio == NULL)
+		return NULL;
+
+	cl_sync_io_init(&aio->lda_sync, 1, ll_dio_aio_end);
+	cl_page_list_init(&aio->lda_pages);
+	aio->lda_iocb = iocb;
+	aio->lda_read = iot == CIT_READ;
+
+	return aio;
+}
+
+/**
+ * Called once all the pages of the asynchronous direct IO \a aio are
+ * submitted, \a result being the bytes submitted or an error.
+ *
+ * \retval -EIOCBQUEUED if pages are in transfer, ll_dio_aio_end() then
+ *			completes the iocb
+ * \retval \a result if nothing was sent
+ */
+ssize_t ll_dio_aio_done(const struct lu_env *env, struct ll_dio_aio *aio,
+			ssize_t result)
+{
+	if (aio->lda_pages.pl_nr == 0) {
+		OBD_FREE_PTR(aio);
+		return result;
+	}
+
+	aio->lda_bytes = result;
+	cl_sync_io_note(env, &aio->lda_sync, result < 0 ? result : 0);
+
+	return -EIOCBQUEUED;
+}
+
+/* Send the pages of \a queue for \a aio, without waiting for them */
+static int ll_dio_aio_submit(const struct lu_env *env, struct cl_io *io,
+			     struct ll_dio_aio *aio, enum cl_req_type crt,
+			     struct cl_2queue *queue)
+{
+	struct cl_sync_io *anchor = &aio->lda_sync;
+	struct cl_page *pg;
+	int rc;
+
+	cl_page_list_for_each(pg, &queue->c2_qin) {
+		LASSERT(pg->cp_sync_io == NULL);
+		pg->cp_sync_io = anchor;
+	}
+	atomic_add(queue->c2_qin.pl_nr, &anchor->csi_sync_nr);
+
+	rc = cl_io_submit_rw(env, io, crt, queue);
+
+	/* the pages left were not sent, on error or since they did not need
+	 * to be */
+	cl_page_list_for_each(pg, &queue->c2_qin) {
+		pg->cp_sync_io = NULL;
+		cl_sync_io_note(env, anchor, 1);
+	}
+
+	if (rc == 0)
+		cl_page_list_splice(&queue->c2_qout, &aio->lda_pages);
+	else
+		LASSERT(list_empty(&queue->c2_qout.pl_pages));
+
+	return rc;
+}
+
 static ssize_t
 ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 		 struct inode *inode, size_t size, loff_t file_offset,
 		 struct page **pages, int page_count)
 {
+	struct ll_dio_aio *aio = vvp_env_io(env)->vui_aio;
 	struct cl_page *clp;
 	struct cl_2queue *queue;
 	struct cl_object *obj = io->ci_obj;
@@ -220,6 +327,10 @@ ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 			void *src;
 			void *dst;
 
+			/* cached pages are released owned, so their transfer
+			 * is waited for */
+			aio = NULL;
+
 			src_page = (rw == WRITE) ? pages[i] : vmpage;
 			dst_page = (rw == WRITE) ? vmpage : pages[i];
 
@@ -264,9 +375,14 @@ ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 	}
 
 	if (rc == 0 && io_pages) {
-		rc = cl_io_submit_sync(env, io,
-				       rw == READ ? CRT_READ : CRT_WRITE,
-				       queue, 0);
+		if (aio != NULL)
+			rc = ll_dio_aio_submit(env, io, aio,
+					       rw == READ ? CRT_READ : CRT_WRITE,
+					       queue);
+		else
+			rc = cl_io_submit_sync(env, io,
+					       rw == READ ? CRT_READ : CRT_WRITE,
+					       queue, 0);
 	}
 	if (rc == 0)
 		rc = orig_size;
@@ -30,6 +30,7 @@
  * Lustre is a trademark of Sun Microsystems, Inc.
  */
 
+#include <linux/ctype.h>
 #include <linux/fs.h>
 #include <linux/sched.h>
 #include <linux/kthread.h>
@@ -44,6 +45,10 @@
 #include "llite_internal.h"
 
 #define SA_OMITTED_ENTRY_MAX 8ULL
+/* consecutive names which don't exist to stop statahead by name */
+#define SA_NAME_ENOENT_MAX 8
+/* seconds without stat of the scanner to stop statahead by name */
+#define SA_NAME_IDLE_TIMEOUT 1
 
 typedef enum {
 	/** negative values are for error cases */
@@ -326,6 +331,10 @@ __sa_make_ready(struct ll_statahead_info *sai, struct sa_entry *entry, int ret)
 	}
 	list_add(&entry->se_list, pos);
 	entry->se_state = ret < 0 ? SA_ENTRY_INVA : SA_ENTRY_SUCC;
+	if (ret == -ENOENT)
+		sai->sai_consecutive_enoent++;
+	else
+		sai->sai_consecutive_enoent = 0;
 
 	return (index == sai->sai_index_wait);
 }
@@ -458,6 +467,15 @@ static struct ll_statahead_info *ll_sai_alloc(struct dentry *dentry)
 	sai->sai_dentry = dget(dentry);
 	atomic_set(&sai->sai_refcount, 1);
 	sai->sai_max = LL_SA_RPC_MIN;
+	/* the stats of a striped dir are spread over its stripes, which are
+	 * served by several MDTs in parallel, so start with a larger window */
+	down_read(&lli->lli_lsm_sem);
+	if (lli->lli_lsm_md != NULL && lli->lli_lsm_md->lsm_md_stripe_count > 1)
+		sai->sai_max = max_t(unsigned int, sai->sai_max,
+				     min_t(unsigned int, LL_SA_RPC_MIN *
+					   lli->lli_lsm_md->lsm_md_stripe_count,
+					   ll_i2sbi(dentry->d_inode)->ll_sa_max));
+	up_read(&lli->lli_lsm_sem);
 	sai->sai_index = 1;
 	init_waitqueue_head(&sai->sai_waitq);
 	init_waitqueue_head(&sai->sai_thread.t_ctl_waitq);
@@ -642,6 +660,11 @@ static void sa_instantiate(struct ll_statahead_info *sai,
 	if (body == NULL)
 		GOTO(out, rc = -EFAULT);
 
+	/* statahead by name found a child on another MDT, which needs another
+	 * RPC to getattr, leave it to the scanner */
+	if (body->mbo_valid & OBD_MD_MDS)
+		GOTO(out, rc = -EREMOTE);
+
 	child = entry->se_inode;
 	if (child != NULL) {
 		/* revalidate; unlinked and re-created with the same name */
@@ -978,6 +1001,177 @@ static void ll_start_agl(struct dentry *parent, struct ll_statahead_info *sai)
 	EXIT;
 }
 
+/*
+ * wait for spare statahead window, meanwhile instantiate the entries which got
+ * reply, and trigger AGL for the inodes of the entries while the window is
+ * full.
+ *
+ * \retval 0		window available, or statahead thread is stopping
+ * \retval -ETIMEDOUT	window still full after \a timeout, 0 for no timeout
+ */
+static int sa_wait_window(struct ll_statahead_info *sai, long timeout)
+{
+	struct ll_inode_info *lli = ll_i2info(sai->sai_dentry->d_inode);
+	struct ptlrpc_thread *sa_thread = &sai->sai_thread;
+	struct l_wait_info lwi = LWI_TIMEOUT(timeout, NULL, NULL);
+	int rc;
+
+	do {
+		rc = l_wait_event(sa_thread->t_ctl_waitq,
+				  !sa_sent_full(sai) ||
+				  sa_has_callback(sai) ||
+				  !agl_list_empty(sai) ||
+				  !thread_is_running(sa_thread),
+				  &lwi);
+
+		sa_handle_callback(sai);
+
+		spin_lock(&lli->lli_agl_lock);
+		while (sa_sent_full(sai) && !agl_list_empty(sai)) {
+			struct ll_inode_info *clli;
+
+			clli = agl_first_entry(sai);
+			list_del_init(&clli->lli_agl_list);
+			spin_unlock(&lli->lli_agl_lock);
+
+			ll_agl_trigger(&clli->lli_vfs_inode, sai);
+			cond_resched();
+			spin_lock(&lli->lli_agl_lock);
+		}
+		spin_unlock(&lli->lli_agl_lock);
+	} while (rc == 0 && sa_sent_full(sai) && thread_is_running(sa_thread));
+
+	return rc;
+}
+
+/*
+ * find the number of @qstr for statahead by name, it is the last run of digits
+ * of a name which is not hidden, return its width, or 0 if there is none.
+ */
+static int sa_name_number(const struct qstr *qstr, int *start, __u64 *index)
+{
+	const unsigned char *name = qstr->name;
+	int len = qstr->len;
+	int end;
+	int i;
+
+	if (len == 0 || name[0] == '.')
+		return 0;
+
+	for (end = len; end > 0 && !isdigit(name[end - 1]); end--)
+		;
+	for (i = end; i > 0 && isdigit(name[i - 1]); i--)
+		;
+	/* leave room to increment the number */
+	if (i == end || end - i > 18)
+		return 0;
+
+	*start = i;
+	*index = 0;
+	for (; i < end; i++)
+		*index = *index * 10 + name[i] - '0';
+
+	return end - *start;
+}
+
+/* hash of @qstr without its number, the width counts if it's zero-padded */
+static __u32 sa_name_hash(const struct qstr *qstr, int start, int width)
+{
+	__u32 hash = qstr->name[start] == '0' ? width : 0;
+	int i;
+
+	for (i = 0; i < qstr->len; i++) {
+		if (i == start)
+			i += width;
+		if (i < qstr->len)
+			hash = hash * 31 + qstr->name[i];
+	}
+
+	return hash;
+}
+
+/* format the next name of statahead by name in @name, return its length */
+static int sa_name_next(struct ll_statahead_info *sai, char *name)
+{
+	int len;
+
+	len = snprintf(name, NAME_MAX + 1, "%.*s%0*llu%s",
+		       sai->sai_fname_start, sai->sai_fname,
+		       sai->sai_fname_pad, sai->sai_fname_index,
+		       sai->sai_fname + sai->sai_fname_start +
+		       sai->sai_fname_width);
+	if (len > NAME_MAX)
+		return 0;
+
+	sai->sai_fname_index++;
+	return len;
+}
+
+/*
+ * statahead by name: stat-ahead the names following the one which started
+ * statahead, by incrementing its number, until they don't exist or the hit
+ * ratio is too low. No dir close will stop it, so it stops by itself once the
+ * scanner doesn't access statahead cache for SA_NAME_IDLE_TIMEOUT.
+ */
+static void ll_statahead_by_name(struct dentry *parent,
+				 struct ll_statahead_info *sai)
+{
+	struct inode *dir = parent->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct ptlrpc_thread *sa_thread = &sai->sai_thread;
+	long timeout = cfs_time_seconds(SA_NAME_IDLE_TIMEOUT);
+	struct l_wait_info lwi;
+	char name[NAME_MAX + 1];
+	struct lu_fid fid;
+	__u64 used;
+	int len;
+	int rc;
+
+	atomic_inc(&sbi->ll_sa_by_name);
+	/* FID is unknown, the MDT will lookup the name */
+	fid_zero(&fid);
+	while (thread_is_running(sa_thread) && !sa_low_hit(sai) &&
+	       sai->sai_consecutive_enoent < SA_NAME_ENOENT_MAX) {
+		rc = sa_wait_window(sai, timeout);
+		if (rc != 0 || !thread_is_running(sa_thread))
+			break;
+
+		len = sa_name_next(sai, name);
+		if (len == 0)
+			break;
+
+		sa_statahead(parent, name, len, &fid);
+	}
+
+	if (sa_low_hit(sai)) {
+		atomic_inc(&sbi->ll_sa_wrong);
+		CDEBUG(D_READA, "Statahead by name for dir "DFID" hit ratio "
+		       "too low: hit/miss %llu/%llu, sent/replied %llu/%llu\n",
+		       PFID(&lli->lli_fid), sai->sai_hit, sai->sai_miss,
+		       sai->sai_sent, sai->sai_replied);
+	}
+
+	/* cache the entries until the scanner is idle */
+	do {
+		used = sai->sai_hit + sai->sai_miss;
+		lwi = LWI_TIMEOUT(timeout, NULL, NULL);
+		rc = l_wait_event(sa_thread->t_ctl_waitq,
+				  sa_has_callback(sai) ||
+				  !thread_is_running(sa_thread),
+				  &lwi);
+
+		sa_handle_callback(sai);
+	} while (thread_is_running(sa_thread) &&
+		 (rc == 0 || sai->sai_hit + sai->sai_miss != used));
+
+	/* the pattern has to be followed again to restart statahead by name */
+	spin_lock(&lli->lli_sa_lock);
+	thread_set_flags(sa_thread, SVC_STOPPING);
+	lli->lli_sa_pattern_hits = 0;
+	spin_unlock(&lli->lli_sa_lock);
+}
+
 /* statahead thread main function */
 static int ll_statahead_thread(void *arg)
 {
@@ -1021,6 +1215,12 @@ static int ll_statahead_thread(void *arg)
 	spin_unlock(&lli->lli_sa_lock);
 	wake_up(&sa_thread->t_ctl_waitq);
 
+	if (sai->sai_by_name) {
+		/* statahead by name doesn't read the dir */
+		ll_statahead_by_name(parent, sai);
+		pos = MDS_DIR_END_OFF;
+	}
+
 	ll_dir_chain_init(&chain);
 	while (pos != MDS_DIR_END_OFF && thread_is_running(sa_thread)) {
 		struct lu_dirpage *dp;
@@ -1100,33 +1300,7 @@ static int ll_statahead_thread(void *arg)
 			fid_le_to_cpu(&fid, &ent->lde_fid);
 
 			/* wait for spare statahead window */
-			do {
-				l_wait_event(sa_thread->t_ctl_waitq,
-					     !sa_sent_full(sai) ||
-					     sa_has_callback(sai) ||
-					     !agl_list_empty(sai) ||
-					     !thread_is_running(sa_thread),
-					     &lwi);
-
-				sa_handle_callback(sai);
-
-				spin_lock(&lli->lli_agl_lock);
-				while (sa_sent_full(sai) &&
-				       !agl_list_empty(sai)) {
-					struct ll_inode_info *clli;
-
-					clli = agl_first_entry(sai);
-					list_del_init(&clli->lli_agl_list);
-					spin_unlock(&lli->lli_agl_lock);
-
-					ll_agl_trigger(&clli->lli_vfs_inode,
-							sai);
-					cond_resched();
-					spin_lock(&lli->lli_agl_lock);
-				}
-				spin_unlock(&lli->lli_agl_lock);
-			} while (sa_sent_full(sai) &&
-				 thread_is_running(sa_thread));
+			sa_wait_window(sai, 0);
 
 			sa_statahead(parent, name, namelen, &fid);
 		}
@@ -1548,13 +1722,16 @@ out:
  * \param[in] dir	parent directory
  * \param[in] dentry	dentry that triggers statahead, normally the first
  *			dirent under @dir
+ * \param[in] by_name	statahead the names following @dentry instead of
+ *			the dirents, @dir isn't opened by current process
  * \retval		-EAGAIN on success, because when this function is
  *			called, it's already in lookup call, so client should
  *			do it itself instead of waiting for statahead thread
  *			to do it asynchronously.
  * \retval		negative number upon error
  */
-static int start_statahead_thread(struct inode *dir, struct dentry *dentry)
+static int start_statahead_thread(struct inode *dir, struct dentry *dentry,
+				  bool by_name)
 {
 	struct ll_inode_info *lli = ll_i2info(dir);
 	struct ll_statahead_info *sai = NULL;
@@ -1567,11 +1744,15 @@ static int start_statahead_thread(struct inode *dir, struct dentry *dentry)
 	int rc = 0;
 	ENTRY;
 
-	/* I am the "lli_opendir_pid" owner, only me can set "lli_sai". */
-	first = is_first_dirent(dir, dentry);
-	if (first == LS_NOT_FIRST_DE)
-		/* It is not "ls -{a}l" operation, no need statahead for it. */
-		GOTO(out, rc = -EFAULT);
+	if (!by_name) {
+		/* I am the "lli_opendir_pid" owner, only me can set
+		 * "lli_sai". */
+		first = is_first_dirent(dir, dentry);
+		if (first == LS_NOT_FIRST_DE)
+			/* It is not "ls -{a}l" operation, no need statahead
+			 * for it. */
+			GOTO(out, rc = -EFAULT);
+	}
 
 	if (unlikely(atomic_inc_return(&sbi->ll_sa_running) >
 				       sbi->ll_sa_running_max)) {
@@ -1587,24 +1768,45 @@ static int start_statahead_thread(struct inode *dir, struct dentry *dentry)
 
 	sai->sai_ls_all = (first == LS_FIRST_DOT_DE);
 
+	if (by_name) {
+		struct qstr *qstr = &dentry->d_name;
+
+		sai->sai_fname_width = sa_name_number(qstr,
+						      &sai->sai_fname_start,
+						      &sai->sai_fname_index);
+		if (sai->sai_fname_width == 0)
+			GOTO(out, rc = -EFAULT);
+
+		memcpy(sai->sai_fname, qstr->name, qstr->len);
+		sai->sai_fname_len = qstr->len;
+		if (qstr->name[sai->sai_fname_start] == '0')
+			sai->sai_fname_pad = sai->sai_fname_width;
+		/* @dentry itself is being looked up by the caller */
+		sai->sai_fname_index++;
+		sai->sai_by_name = 1;
+	}
+
 	/* if current lli_opendir_key was deauthorized, or dir re-opened by
 	 * another process, don't start statahead, otherwise the newly spawned
-	 * statahead thread won't be notified to quit. */
+	 * statahead thread won't be notified to quit. And statahead by name
+	 * is only for a dir which is not opened for statahead. */
 	spin_lock(&lli->lli_sa_lock);
 	if (unlikely(lli->lli_sai != NULL ||
-		     lli->lli_opendir_key == NULL ||
-		     lli->lli_opendir_pid != current->pid)) {
+		     (by_name ? lli->lli_opendir_key != NULL :
+		      (lli->lli_opendir_key == NULL ||
+		       lli->lli_opendir_pid != current->pid)))) {
 		spin_unlock(&lli->lli_sa_lock);
 		GOTO(out, rc = -EPERM);
 	}
 	lli->lli_sai = sai;
 	spin_unlock(&lli->lli_sa_lock);
 
-	CDEBUG(D_READA, "start statahead thread: [pid %d] [parent %.*s]\n",
-	       current_pid(), parent->d_name.len, parent->d_name.name);
+	CDEBUG(D_READA, "start statahead thread%s: [pid %d] [parent %.*s]\n",
+	       by_name ? " by name" : "", current_pid(), parent->d_name.len,
+	       parent->d_name.name);
 
 	task = kthread_run(ll_statahead_thread, parent, "ll_sa_%u",
-			   lli->lli_opendir_pid);
+			   current_pid());
 	thread = &sai->sai_thread;
 	if (IS_ERR(task)) {
 		spin_lock(&lli->lli_sa_lock);
@@ -1630,7 +1832,9 @@ out:
 	/* once we start statahead thread failed, disable statahead so that
 	 * subsequent stat won't waste time to try it. */
 	spin_lock(&lli->lli_sa_lock);
-	if (lli->lli_opendir_pid == current->pid)
+	if (by_name)
+		lli->lli_sa_pattern_hits = 0;
+	else if (lli->lli_opendir_pid == current->pid)
 		lli->lli_sa_enabled = 0;
 	spin_unlock(&lli->lli_sa_lock);
 
@@ -1642,10 +1846,61 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Track the stat-by-name pattern of @dir, that is names which only differ by a
+ * number incremented at each stat, like the files of a job named by rank that
+ * are stat'ed by find or rsync regardless of the dirents order. This is called
+ * when @dir is not opened for statahead by the current process.
+ *
+ * \param[in] dir	parent directory
+ * \param[in] dentry	dentry to getattr
+ * \retval		true if statahead by name is running for @dir, or the
+ *			pattern has been followed long enough to start it
+ */
+bool ll_statahead_pattern(struct inode *dir, struct dentry *dentry)
+{
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct qstr *qstr = &dentry->d_name;
+	__u64 index;
+	__u32 hash;
+	int start;
+	int width;
+	bool rc;
+
+	if (sbi->ll_sa_pattern_min == 0)
+		return false;
+
+	width = sa_name_number(qstr, &start, &index);
+	if (width == 0)
+		return false;
+
+	hash = sa_name_hash(qstr, start, width);
+
+	spin_lock(&lli->lli_sa_lock);
+	if (hash != lli->lli_sa_pattern_hash ||
+	    (index != lli->lli_sa_pattern_index &&
+	     index != lli->lli_sa_pattern_index + 1))
+		lli->lli_sa_pattern_hits = 1;
+	else if (index != lli->lli_sa_pattern_index &&
+		 lli->lli_sa_pattern_hits < sbi->ll_sa_pattern_min)
+		lli->lli_sa_pattern_hits++;
+	lli->lli_sa_pattern_hash = hash;
+	lli->lli_sa_pattern_index = index;
+
+	if (lli->lli_sai != NULL)
+		rc = lli->lli_sai->sai_by_name;
+	else
+		rc = lli->lli_sa_pattern_hits >= sbi->ll_sa_pattern_min;
+	spin_unlock(&lli->lli_sa_lock);
+
+	return rc;
+}
+
 /**
  * statahead entry function, this is called when client getattr on a file, it
- * will start statahead thread if this is the first dir entry, else revalidate
- * dentry from statahead cache.
+ * will start statahead thread if this is the first dir entry, or the dir is
+ * stat'ed by name, else revalidate dentry from statahead cache.
  *
  * \param[in]  dir	parent directory
  * \param[out] dentryp	dentry to getattr
@@ -1659,6 +1914,7 @@ out:
  */
 int ll_statahead(struct inode *dir, struct dentry **dentryp, bool unplug)
 {
+	struct ll_inode_info *lli = ll_i2info(dir);
 	struct ll_statahead_info *sai;
 
 	sai = ll_sai_get(dir);
@@ -1671,5 +1927,7 @@ int ll_statahead(struct inode *dir, struct dentry **dentryp, bool unplug)
 		ll_sai_put(sai);
 		return rc;
 	}
-	return start_statahead_thread(dir, *dentryp);
+	return start_statahead_thread(dir, *dentryp,
+				      !lli->lli_sa_enabled ||
+				      lli->lli_opendir_pid != current_pid());
 }
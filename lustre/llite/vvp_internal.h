@@ -118,14 +118,36 @@ struct vvp_io {
 	*/
 	struct ll_file_data	*vui_fd;
 	struct kiocb		*vui_iocb;
+	/** set if the direct IO of an asynchronous iocb is not waited for */
+	struct ll_dio_aio	*vui_aio;
 
 	/* Readahead state. */
 	pgoff_t	vui_ra_start;
 	pgoff_t	vui_ra_count;
+	/* read-ahead stream of the read, valid with vui_ra_valid */
+	struct ll_readahead_state *vui_ras;
 	/* Set when vui_ra_{start,count} have been initialized. */
 	bool		vui_ra_valid;
 };
 
+/**
+ * Asynchronous direct IO.
+ *
+ * The pages of all the iterations of the IO are transferred without waiting
+ * for them, and the iocb is completed by ll_dio_aio_end() once the last one
+ * is done.
+ */
+struct ll_dio_aio {
+	/** counts the pages in transfer, plus one until the IO is submitted */
+	struct cl_sync_io	lda_sync;
+	/** pages in transfer, released at completion */
+	struct cl_page_list	lda_pages;
+	struct kiocb		*lda_iocb;
+	/** bytes submitted */
+	ssize_t			lda_bytes;
+	bool			lda_read;
+};
+
 extern struct lu_device_type vvp_device_type;
 
 extern struct lu_context_key vvp_session_key;
@@ -812,7 +812,7 @@ static int vvp_io_read_start(const struct lu_env *env,
 		vio->vui_ra_valid = true;
 		vio->vui_ra_start = cl_index(obj, pos);
 		vio->vui_ra_count = cl_index(obj, tot + PAGE_SIZE - 1);
-		ll_ras_enter(file);
+		vio->vui_ras = ll_ras_enter(file, vio->vui_ra_start);
 	}
 
 	/* BUG: 5972 */
@@ -907,18 +907,22 @@ static int vvp_io_commit_sync(const struct lu_env *env, struct cl_io *io,
 }
 
 static void write_commit_callback(const struct lu_env *env, struct cl_io *io,
-				struct cl_page *page)
+				  struct cl_page_list *plist)
 {
-	struct page *vmpage = page->cp_vmpage;
+	struct cl_page *page;
+
+	cl_page_list_for_each(page, plist) {
+		struct page *vmpage = page->cp_vmpage;
 
-	SetPageUptodate(vmpage);
-	set_page_dirty(vmpage);
+		SetPageUptodate(vmpage);
+		set_page_dirty(vmpage);
 
-	cl_page_disown(env, io, page);
+		/* held in ll_cl_init(), @plist keeps a reference */
+		lu_ref_del(&page->cp_reference, "cl_io", cl_io_top(io));
+		cl_page_put(env, page);
+	}
 
-	/* held in ll_cl_init() */
-	lu_ref_del(&page->cp_reference, "cl_io", cl_io_top(io));
-	cl_page_put(env, page);
+	cl_page_list_disown(env, cl_io_top(io), plist);
 }
 
 /* make sure the page list is contiguous */
@@ -1225,9 +1229,14 @@ static int vvp_io_kernel_fault(struct vvp_fault_io *cfio)
 }
 
 static void mkwrite_commit_callback(const struct lu_env *env, struct cl_io *io,
-				    struct cl_page *page)
+				    struct cl_page_list *plist)
 {
-	set_page_dirty(page->cp_vmpage);
+	struct cl_page *page;
+
+	cl_page_list_for_each(page, plist)
+		set_page_dirty(page->cp_vmpage);
+
+	cl_page_list_fini(env, plist);
 }
 
 static int vvp_io_fault_start(const struct lu_env *env,
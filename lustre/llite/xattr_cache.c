@@ -33,12 +33,36 @@
 #define DEBUG_SUBSYSTEM S_LLITE
 
 #include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/jhash.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
 #include <obd_support.h>
 #include <lustre_dlm.h>
 #include "llite_internal.h"
 
+/* Values of the cached xattrs, shared by the inodes with identical values,
+ * which is common for the xattrs set by policy, like security labels or the
+ * default layouts and ACLs inherited from directories. The values are never
+ * changed, setxattr drops the cache of the inode.
+ */
+struct ll_xattr_value {
+	struct hlist_node	xv_hash;    /* protected with the lock of the
+					     * hash bucket */
+	unsigned int		xv_refcount;
+	__u32			xv_key;     /* jhash of the value */
+	unsigned		xv_len;
+	char			xv_data[0];
+};
+
+#define LL_XATTR_VALUE_HASH_BITS	8
+#define LL_XATTR_VALUE_HASH_SIZE	(1 << LL_XATTR_VALUE_HASH_BITS)
+
+static struct ll_xattr_value_bucket {
+	spinlock_t		xvb_lock;
+	struct hlist_head	xvb_head;
+} ll_xattr_values[LL_XATTR_VALUE_HASH_SIZE];
+
 /* If we ever have hundreds of extended attributes, we might want to consider
  * using a hash or a tree structure instead of list for faster lookups.
  */
@@ -46,7 +70,8 @@ struct ll_xattr_entry {
 	struct list_head	xe_list;    /* protected with
 					     * lli_xattrs_list_rwsem */
 	char			*xe_name;   /* xattr name, \0-terminated */
-	char			*xe_value;  /* xattr value */
+	char			*xe_value;  /* xattr value, in xe_shared */
+	struct ll_xattr_value	*xe_shared; /* shared xattr value */
 	unsigned		xe_namelen; /* strlen(xe_name) + 1 */
 	unsigned		xe_vallen;  /* xattr value length */
 };
@@ -65,14 +90,110 @@ static struct lu_kmem_descr xattr_caches[] = {
 
 int ll_xattr_init(void)
 {
+	int i;
+
+	for (i = 0; i < LL_XATTR_VALUE_HASH_SIZE; i++) {
+		spin_lock_init(&ll_xattr_values[i].xvb_lock);
+		INIT_HLIST_HEAD(&ll_xattr_values[i].xvb_head);
+	}
+
 	return lu_kmem_init(xattr_caches);
 }
 
 void ll_xattr_fini(void)
 {
+	int i;
+
+	for (i = 0; i < LL_XATTR_VALUE_HASH_SIZE; i++)
+		LASSERT(hlist_empty(&ll_xattr_values[i].xvb_head));
+
 	lu_kmem_fini(xattr_caches);
 }
 
+static struct ll_xattr_value *
+ll_xattr_value_find(struct ll_xattr_value_bucket *xvb, __u32 key,
+		    const char *val, unsigned len)
+{
+	struct ll_xattr_value *xv;
+	struct hlist_node __maybe_unused *pos;
+
+	cfs_hlist_for_each_entry(xv, pos, &xvb->xvb_head, xv_hash) {
+		if (xv->xv_key == key && xv->xv_len == len &&
+		    memcmp(xv->xv_data, val, len) == 0)
+			return xv;
+	}
+
+	return NULL;
+}
+
+/**
+ * Get a reference on the shared copy of xattr value \a val of \a len bytes,
+ * which is created if no other inode has the same value cached.
+ *
+ * \retval the shared value, NULL if no memory could be allocated for it
+ */
+static struct ll_xattr_value *ll_xattr_value_get(const char *val,
+						 unsigned len)
+{
+	__u32 key = jhash(val, len, 0);
+	struct ll_xattr_value_bucket *xvb;
+	struct ll_xattr_value *xv;
+	struct ll_xattr_value *new;
+
+	xvb = &ll_xattr_values[hash_32(key, LL_XATTR_VALUE_HASH_BITS)];
+
+	spin_lock(&xvb->xvb_lock);
+	xv = ll_xattr_value_find(xvb, key, val, len);
+	if (xv != NULL)
+		xv->xv_refcount++;
+	spin_unlock(&xvb->xvb_lock);
+	if (xv != NULL)
+		return xv;
+
+	OBD_ALLOC(new, offsetof(struct ll_xattr_value, xv_data[len]));
+	if (new == NULL)
+		return NULL;
+
+	new->xv_refcount = 1;
+	new->xv_key = key;
+	new->xv_len = len;
+	memcpy(new->xv_data, val, len);
+
+	/* race with another inode caching the same value */
+	spin_lock(&xvb->xvb_lock);
+	xv = ll_xattr_value_find(xvb, key, val, len);
+	if (xv != NULL)
+		xv->xv_refcount++;
+	else
+		hlist_add_head(&new->xv_hash, &xvb->xvb_head);
+	spin_unlock(&xvb->xvb_lock);
+
+	if (xv == NULL)
+		return new;
+
+	OBD_FREE(new, offsetof(struct ll_xattr_value, xv_data[len]));
+	return xv;
+}
+
+static void ll_xattr_value_put(struct ll_xattr_value *xv)
+{
+	struct ll_xattr_value_bucket *xvb;
+	bool last;
+
+	xvb = &ll_xattr_values[hash_32(xv->xv_key, LL_XATTR_VALUE_HASH_BITS)];
+
+	spin_lock(&xvb->xvb_lock);
+	LASSERT(xv->xv_refcount > 0);
+	last = --xv->xv_refcount == 0;
+	if (last)
+		hlist_del(&xv->xv_hash);
+	spin_unlock(&xvb->xvb_lock);
+
+	if (last)
+		OBD_FREE(xv, offsetof(struct ll_xattr_value,
+				      xv_data[xv->xv_len]));
+}
+
 /**
  * Initializes xattr cache for an inode.
  *
@@ -157,15 +278,15 @@ static int ll_xattr_cache_add(struct list_head *cache,
 		       xattr->xe_namelen);
 		goto err_name;
 	}
-	OBD_ALLOC(xattr->xe_value, xattr_val_len);
-	if (!xattr->xe_value) {
+	xattr->xe_shared = ll_xattr_value_get(xattr_val, xattr_val_len);
+	if (!xattr->xe_shared) {
 		CDEBUG(D_CACHE, "failed to alloc xattr value %d\n",
 		       xattr_val_len);
 		goto err_value;
 	}
 
 	memcpy(xattr->xe_name, xattr_name, xattr->xe_namelen);
-	memcpy(xattr->xe_value, xattr_val, xattr_val_len);
+	xattr->xe_value = xattr->xe_shared->xv_data;
 	xattr->xe_vallen = xattr_val_len;
 	list_add(&xattr->xe_list, cache);
 
@@ -201,7 +322,7 @@ static int ll_xattr_cache_del(struct list_head *cache,
 	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
 		list_del(&xattr->xe_list);
 		OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-		OBD_FREE(xattr->xe_value, xattr->xe_vallen);
+		ll_xattr_value_put(xattr->xe_shared);
 		OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
 
 		RETURN(0);
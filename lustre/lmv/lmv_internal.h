@@ -125,9 +125,45 @@ static inline int lmv_stripe_md_size(int stripe_count)
 	return sizeof(*lsm) + stripe_count * sizeof(lsm->lsm_md_oinfo[0]);
 }
 
+/*
+ * Stripe index of \a name in a LMV_HASH_TYPE_CRUSH directory: the stripe of
+ * each placement group is computed once, then kept in lsm_md_crush_table, so
+ * that the lookups in a directory with many stripes don't have to weigh all
+ * the stripes for every name.
+ */
+static inline int lsm_name_to_crush_index(struct lmv_stripe_md *lsm,
+					  const char *name, int namelen)
+{
+	unsigned int pg_id = lmv_crush_pg_id(name, namelen);
+	__u16 *table = READ_ONCE(lsm->lsm_md_crush_table);
+	unsigned int idx;
+
+	if (!table) {
+		OBD_ALLOC_LARGE(table, LMV_CRUSH_PG_COUNT * sizeof(*table));
+		if (!table)
+			return lmv_crush_pg_stripe(lsm->lsm_md_stripe_count,
+						   pg_id);
+
+		if (cmpxchg(&lsm->lsm_md_crush_table, NULL, table) != NULL) {
+			OBD_FREE_LARGE(table,
+				       LMV_CRUSH_PG_COUNT * sizeof(*table));
+			table = lsm->lsm_md_crush_table;
+		}
+	}
+
+	/* the table keeps stripe index + 1, 0 means not computed yet */
+	idx = READ_ONCE(table[pg_id]);
+	if (idx == 0) {
+		idx = lmv_crush_pg_stripe(lsm->lsm_md_stripe_count, pg_id) + 1;
+		WRITE_ONCE(table[pg_id], idx);
+	}
+
+	return idx - 1;
+}
+
 /* for file under migrating directory, return the target stripe info */
 static inline const struct lmv_oinfo *
-lsm_name_to_stripe_info(const struct lmv_stripe_md *lsm, const char *name,
+lsm_name_to_stripe_info(struct lmv_stripe_md *lsm, const char *name,
 			int namelen, bool post_migrate)
 {
 	__u32 hash_type = lsm->lsm_md_hash_type;
@@ -144,8 +180,12 @@ lsm_name_to_stripe_info(const struct lmv_stripe_md *lsm, const char *name,
 		}
 	}
 
-	stripe_index = lmv_name_to_stripe_index(hash_type, stripe_count,
-						name, namelen);
+	if ((hash_type & LMV_HASH_TYPE_MASK) == LMV_HASH_TYPE_CRUSH &&
+	    stripe_count > 1 && stripe_count == lsm->lsm_md_stripe_count)
+		stripe_index = lsm_name_to_crush_index(lsm, name, namelen);
+	else
+		stripe_index = lmv_name_to_stripe_index(hash_type, stripe_count,
+							name, namelen);
 	if (stripe_index < 0)
 		return ERR_PTR(stripe_index);
 
@@ -3126,6 +3126,10 @@ static int lmv_unpackmd(struct obd_export *exp, struct lmv_stripe_md **lsmp,
 			if (lsm->lsm_md_oinfo[i].lmo_root)
 				iput(lsm->lsm_md_oinfo[i].lmo_root);
 		}
+		if (lsm->lsm_md_crush_table)
+			OBD_FREE_LARGE(lsm->lsm_md_crush_table,
+				       LMV_CRUSH_PG_COUNT *
+				       sizeof(lsm->lsm_md_crush_table[0]));
 		lsm_size = lmv_stripe_md_size(lsm->lsm_md_stripe_count);
 		OBD_FREE(lsm, lsm_size);
 		*lsmp = NULL;
@@ -3344,13 +3348,18 @@ int lmv_intent_getattr_async(struct obd_export *exp,
 
 	ENTRY;
 
-	if (!fid_is_sane(&op_data->op_fid2))
+	if (!fid_is_sane(&op_data->op_fid2) && !fid_is_zero(&op_data->op_fid2))
 		RETURN(-EINVAL);
 
 	ptgt = lmv_locate_tgt(lmv, op_data, &op_data->op_fid1);
 	if (IS_ERR(ptgt))
 		RETURN(PTR_ERR(ptgt));
 
+	/* lookup by name only, the MDT of the parent tells whether the child
+	 * is remote in its reply */
+	if (fid_is_zero(&op_data->op_fid2))
+		RETURN(md_intent_getattr_async(ptgt->ltd_exp, minfo));
+
 	ctgt = lmv_find_target(lmv, &op_data->op_fid2);
 	if (IS_ERR(ctgt))
 		RETURN(PTR_ERR(ctgt));
@@ -3384,7 +3393,7 @@ int lmv_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
 }
 
 int lmv_get_fid_from_lsm(struct obd_export *exp,
-			 const struct lmv_stripe_md *lsm,
+			 struct lmv_stripe_md *lsm,
 			 const char *name, int namelen, struct lu_fid *fid)
 {
 	const struct lmv_oinfo *oinfo;
@@ -86,7 +86,13 @@ struct lod_qos {
 	__u32			 lq_active_oss_count;
 	unsigned int		 lq_prio_free;   /* priority for free space */
 	unsigned int		 lq_threshold_rr;/* priority for rr */
+	unsigned int		 lq_prio_load;	/* priority for load */
+	__u32			 lq_load_max;	/* max os_load of OSTs */
 	struct lod_qos_rr	 lq_rr;          /* round robin qos data */
+	/* running sum of the weights of the candidate OSTs of the pool
+	 * used by lod_alloc_qos(), protected by lq_rw_sem */
+	__u64			*lq_weight_sum;
+	unsigned int		 lq_weight_sum_count;
 	bool			 lq_dirty:1,     /* recalc qos data */
 				 lq_same_space:1,/* the ost's all have approx.
 						    the same space avail */
@@ -244,6 +250,9 @@ struct lod_device {
 #define ltd_mdt			ltd_tgt
 #define lod_mdt_desc		lod_tgt_desc
 
+/* most components a layout grown by an extension component can have */
+#define LOD_SEL_COMP_MAX	64
+
 struct lod_layout_component {
 	struct lu_extent	  llc_extent;
 	__u32			  llc_id;
@@ -255,6 +264,8 @@ struct lod_layout_component {
 	__u16			  llc_stripe_count;
 	__u16			  llc_stripes_allocated;
 	__u64			  llc_timestamp; /* snapshot time */
+	/* bytes added to the layout at a time, with LCME_FL_EXTENSION */
+	__u64			  llc_extension_size;
 	char			 *llc_pool;
 	/* ost list specified with LOV_USER_MAGIC_SPECIFIC lum */
 	struct ost_pool		  llc_ostlist;
@@ -270,7 +270,11 @@ int lod_add_device(const struct lu_env *env, struct lod_device *lod,
 					   OBD_CONNECT_VERSION |
 					   OBD_CONNECT_PINGLESS |
 					   OBD_CONNECT_LFSCK |
-					   OBD_CONNECT_BULK_MBITS;
+					   OBD_CONNECT_BULK_MBITS |
+					   OBD_CONNECT_FLAGS2;
+		/* the llog changes are sent to the OST in batches */
+		data->ocd_connect_flags2 = OBD_CONNECT2_BATCH_RPC |
+					   OBD_CONNECT2_BATCH_SYNC;
 
 		data->ocd_group = tgt_index;
 		ltd = &lod->lod_ost_descs;
@@ -990,6 +994,10 @@ int lod_generate_lovea(const struct lu_env *env, struct lod_object *lo,
 		if (lod_comp->llc_flags & LCME_FL_NOSYNC)
 			lcme->lcme_timestamp =
 				cpu_to_le64(lod_comp->llc_timestamp);
+		if (lod_comp->llc_flags & LCME_FL_EXTENSION)
+			lcme->lcme_extension_size =
+				cpu_to_le32(lod_comp->llc_extension_size /
+					    SEL_UNIT_SIZE);
 		lcme->lcme_extent.e_start =
 			cpu_to_le64(lod_comp->llc_extent.e_start);
 		lcme->lcme_extent.e_end =
@@ -1291,6 +1299,11 @@ int lod_parse_striping(const struct lu_env *env, struct lod_object *lo,
 			if (lod_comp->llc_flags & LCME_FL_NOSYNC)
 				lod_comp->llc_timestamp = le64_to_cpu(
 					comp_v1->lcm_entries[i].lcme_timestamp);
+			if (lod_comp->llc_flags & LCME_FL_EXTENSION)
+				lod_comp->llc_extension_size = (__u64)
+					le32_to_cpu(comp_v1->lcm_entries[i].
+						    lcme_extension_size) *
+					SEL_UNIT_SIZE;
 			lod_comp->llc_id =
 				le32_to_cpu(comp_v1->lcm_entries[i].lcme_id);
 			if (lod_comp->llc_id == LCME_ID_INVAL)
@@ -1954,6 +1967,40 @@ recheck:
 			}
 		}
 
+		if (le32_to_cpu(ent->lcme_flags) & LCME_FL_EXTENSION) {
+			__u64 ext_size;
+
+			/* the extension component ends a plain layout that
+			 * it does not start, see lod_sel_extend() */
+			if (le16_to_cpu(comp_v1->lcm_mirror_count) > 0 ||
+			    le64_to_cpu(ext->e_start) == 0 ||
+			    le64_to_cpu(ext->e_end) != LUSTRE_EOF ||
+			    le32_to_cpu(lum->lmm_magic) ==
+			    LOV_USER_MAGIC_SPECIFIC ||
+			    lov_pattern(le32_to_cpu(lum->lmm_pattern)) ==
+			    LOV_PATTERN_MDT) {
+				CDEBUG(D_LAYOUT, "invalid extension component "
+				       DEXT"\n", le64_to_cpu(ext->e_start),
+				       le64_to_cpu(ext->e_end));
+				RETURN(-EINVAL);
+			}
+
+			/* the components it adds end on a stripe boundary */
+			stripe_size = le32_to_cpu(lum->lmm_stripe_size);
+			if (stripe_size == 0)
+				stripe_size = desc->ld_default_stripe_size;
+			ext_size = le32_to_cpu(ent->lcme_extension_size);
+			ext_size *= SEL_UNIT_SIZE;
+			if (ext_size == 0 || stripe_size == 0 ||
+			    do_div(ext_size, stripe_size) != 0) {
+				CDEBUG(D_LAYOUT, "extension size %u is not a "
+				       "multiple of stripe size %u\n",
+				       le32_to_cpu(ent->lcme_extension_size),
+				       stripe_size);
+				RETURN(-EINVAL);
+			}
+		}
+
 		prev_end = le64_to_cpu(ext->e_end);
 
 		rc = lod_verify_v1v3(d, &tmp, is_from_disk);
@@ -2180,6 +2227,10 @@ int lod_pools_fini(struct lod_device *lod)
 	cfs_hash_putref(lod->lod_pools_hash_body);
 	lod_ost_pool_free(&(lod->lod_qos.lq_rr.lqr_pool));
 	lod_ost_pool_free(&lod->lod_pool_info);
+	if (lod->lod_qos.lq_weight_sum != NULL)
+		OBD_FREE_LARGE(lod->lod_qos.lq_weight_sum,
+			       lod->lod_qos.lq_weight_sum_count *
+			       sizeof(*lod->lod_qos.lq_weight_sum));
 
 	RETURN(0);
 }
@@ -2781,6 +2781,10 @@ static int lod_declare_layout_add(const struct lu_env *env,
 		lod_comp->llc_extent.e_end = ext->e_end;
 		lod_comp->llc_stripe_offset = v1->lmm_stripe_offset;
 		lod_comp->llc_flags = comp_v1->lcm_entries[i].lcme_flags;
+		if (lod_comp->llc_flags & LCME_FL_EXTENSION)
+			lod_comp->llc_extension_size = (__u64)
+				comp_v1->lcm_entries[i].lcme_extension_size *
+				SEL_UNIT_SIZE;
 
 		lod_comp->llc_stripe_count = v1->lmm_stripe_count;
 		lod_comp->llc_stripe_size = v1->lmm_stripe_size;
@@ -4645,6 +4649,11 @@ static int lod_get_default_lov_striping(const struct lu_env *env,
 			lod_comp->llc_flags =
 					comp_v1->lcm_entries[i].lcme_flags &
 					LCME_TEMPLATE_FLAGS;
+			if (lod_comp->llc_flags & LCME_FL_EXTENSION)
+				lod_comp->llc_extension_size = (__u64)
+					comp_v1->lcm_entries[i].
+						lcme_extension_size *
+					SEL_UNIT_SIZE;
 		}
 
 		if (v1->lmm_pattern != LOV_PATTERN_RAID0 &&
@@ -6029,6 +6038,97 @@ static int lod_declare_instantiate_components(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Grow a layout ending with an extension component to cover a write.
+ *
+ * The extension component (LCME_FL_EXTENSION) is a template at the end of
+ * the layout that is never instantiated. When a write reaches it, a new
+ * component with its striping is added in front of it, covering the write
+ * in multiples of llc_extension_size, and the extension component starts
+ * after it. The new component is then instantiated like the others, on OSTs
+ * chosen at this time. Once the layout has LOD_SEL_COMP_MAX components, the
+ * extension component becomes a plain component up to EOF instead.
+ *
+ * \param[in] env	execution environment
+ * \param[in] lo	object to grow, with its striping loaded
+ * \param[in] extent	write extent of the layout intent
+ *
+ * \retval 0		on success, or if the layout was not grown
+ * \retval negative	negated errno on error
+ */
+static int lod_sel_extend(const struct lu_env *env, struct lod_object *lo,
+			  const struct lu_extent *extent)
+{
+	struct lod_device *d = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	struct lod_layout_component *comp_array, *lod_comp, *ext_comp;
+	int cnt = lo->ldo_comp_cnt;
+	__u64 start, len;
+	int rc;
+	ENTRY;
+
+	ext_comp = &lo->ldo_comp_entries[cnt - 1];
+	if (!(ext_comp->llc_flags & LCME_FL_EXTENSION) ||
+	    extent->e_end <= ext_comp->llc_extent.e_start)
+		RETURN(0);
+
+	LASSERT(ext_comp->llc_extension_size != 0);
+	LASSERT(lo->ldo_mirror_count == 1);
+	start = ext_comp->llc_extent.e_start;
+
+	len = 0;
+	if (extent->e_end != OBD_OBJECT_EOF) {
+		len = extent->e_end - start + ext_comp->llc_extension_size - 1;
+		do_div(len, ext_comp->llc_extension_size);
+		len *= ext_comp->llc_extension_size;
+	}
+
+	if (len == 0 || len >= OBD_OBJECT_EOF - start ||
+	    cnt >= LOD_SEL_COMP_MAX) {
+		CDEBUG(D_LAYOUT, "%s: "DFID": extension component stops at "
+		       "%#llx\n", lod2obd(d)->obd_name,
+		       PFID(lod_object_fid(lo)), start);
+		ext_comp->llc_flags &= ~LCME_FL_EXTENSION;
+		ext_comp->llc_extension_size = 0;
+		RETURN(0);
+	}
+
+	OBD_ALLOC(comp_array, sizeof(*comp_array) * (cnt + 1));
+	if (comp_array == NULL)
+		RETURN(-ENOMEM);
+
+	memcpy(comp_array, lo->ldo_comp_entries, sizeof(*comp_array) * cnt);
+	comp_array[cnt] = comp_array[cnt - 1];
+
+	lod_comp = &comp_array[cnt - 1];
+	lod_comp->llc_id = LCME_ID_INVAL;
+	lod_comp->llc_flags &= ~LCME_FL_EXTENSION;
+	lod_comp->llc_extension_size = 0;
+	lod_comp->llc_extent.e_end = start + len;
+	memset(&lod_comp->llc_ostlist, 0, sizeof(lod_comp->llc_ostlist));
+	lod_comp->llc_pool = NULL;
+	if (comp_array[cnt].llc_pool != NULL) {
+		rc = lod_set_pool(&lod_comp->llc_pool,
+				  comp_array[cnt].llc_pool);
+		if (rc) {
+			OBD_FREE(comp_array, sizeof(*comp_array) * (cnt + 1));
+			RETURN(rc);
+		}
+	}
+
+	comp_array[cnt].llc_extent.e_start = start + len;
+
+	OBD_FREE(lo->ldo_comp_entries, sizeof(*comp_array) * cnt);
+	lo->ldo_comp_entries = comp_array;
+	lo->ldo_comp_cnt = cnt + 1;
+	lo->ldo_mirrors[0].lme_end = cnt;
+
+	CDEBUG(D_LAYOUT, "%s: "DFID": add component "DEXT" for the write "
+	       DEXT"\n", lod2obd(d)->obd_name, PFID(lod_object_fid(lo)),
+	       PEXT(&lod_comp->llc_extent), PEXT(extent));
+
+	RETURN(lod_layout_data_init(lod_env_info(env), lo->ldo_comp_cnt));
+}
+
 static int lod_declare_update_plain(const struct lu_env *env,
 		struct lod_object *lo, struct layout_intent *layout,
 		const struct lu_buf *buf, struct thandle *th)
@@ -6077,6 +6177,11 @@ static int lod_declare_update_plain(const struct lu_env *env,
 		rc = lod_striping_load(env, lo);
 		if (rc)
 			GOTO(out, rc);
+
+		/* the replayed layout has the grown components already */
+		rc = lod_sel_extend(env, lo, &layout->li_extent);
+		if (rc)
+			GOTO(out, rc);
 	}
 
 	/* Make sure defined layout covers the requested write range. */
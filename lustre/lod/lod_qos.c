@@ -275,6 +275,7 @@ void lod_qos_statfs_update(const struct lu_env *env, struct lod_device *lod)
 	time64_t max_age;
 	unsigned int i;
 	u64 avail;
+	__u32 load;
 	int idx;
 	ENTRY;
 
@@ -292,10 +293,13 @@ void lod_qos_statfs_update(const struct lu_env *env, struct lod_device *lod)
 	for (i = 0; i < osts->op_count; i++) {
 		idx = osts->op_array[i];
 		avail = OST_TGT(lod,idx)->ltd_statfs.os_bavail;
+		load = OST_TGT(lod, idx)->ltd_statfs.os_load;
 		if (lod_statfs_and_check(env, lod, idx,
 					 &OST_TGT(lod, idx)->ltd_statfs))
 			continue;
-		if (OST_TGT(lod,idx)->ltd_statfs.os_bavail != avail)
+		if (OST_TGT(lod,idx)->ltd_statfs.os_bavail != avail ||
+		    (lod->lod_qos.lq_prio_load &&
+		     OST_TGT(lod, idx)->ltd_statfs.os_load != load))
 			/* recalculate weigths */
 			lod->lod_qos.lq_dirty = 1;
 	}
@@ -326,6 +330,7 @@ static int lod_qos_calc_ppo(struct lod_device *lod)
 {
 	struct lod_qos_oss *oss;
 	__u64		    ba_max, ba_min, temp;
+	__u32		    load_max, load_min;
 	__u32		    num_active;
 	unsigned int	    i;
 	int		    rc, prio_wide;
@@ -353,6 +358,8 @@ static int lod_qos_calc_ppo(struct lod_device *lod)
 
 	ba_min = (__u64)(-1);
 	ba_max = 0;
+	load_min = (__u32)(-1);
+	load_max = 0;
 	now = ktime_get_real_seconds();
 	/* Calculate OST penalty per object
 	 * (lod ref taken in lod_qos_prep_create())
@@ -364,6 +371,8 @@ static int lod_qos_calc_ppo(struct lod_device *lod)
 			continue;
 		ba_min = min(temp, ba_min);
 		ba_max = max(temp, ba_max);
+		load_min = min(OST_TGT(lod, i)->ltd_statfs.os_load, load_min);
+		load_max = max(OST_TGT(lod, i)->ltd_statfs.os_load, load_max);
 
 		/* Count the number of usable OSS's */
 		if (OST_TGT(lod,i)->ltd_qos.ltq_oss->lqo_bavail == 0)
@@ -412,11 +421,15 @@ static int lod_qos_calc_ppo(struct lod_device *lod)
 
 	lod->lod_qos.lq_dirty = 0;
 	lod->lod_qos.lq_reset = 0;
+	lod->lod_qos.lq_load_max = lod->lod_qos.lq_prio_load ? load_max : 0;
 
-	/* If each ost has almost same free space,
+	/* If each ost has almost same free space and load,
 	 * do rr allocation for better creation performance */
 	lod->lod_qos.lq_same_space = 0;
-	if ((ba_max * (256 - lod->lod_qos.lq_threshold_rr)) >> 8 < ba_min) {
+	if ((ba_max * (256 - lod->lod_qos.lq_threshold_rr)) >> 8 < ba_min &&
+	    (lod->lod_qos.lq_load_max == 0 ||
+	     ((__u64)load_max * (256 - lod->lod_qos.lq_threshold_rr)) >> 8 <
+	     load_min)) {
 		lod->lod_qos.lq_same_space = 1;
 		/* Reset weights for the next time we enter qos mode */
 		lod->lod_qos.lq_reset = 1;
@@ -436,6 +449,8 @@ out:
  *
  * The final OST weight is the number of bytes available minus the OST and
  * OSS penalties.  See lod_qos_calc_ppo() for how penalties are calculated.
+ * When lq_prio_load is set, the weight is then reduced in proportion to the
+ * bulk I/O in progress on the OST compared to the most loaded OST.
  *
  * \param[in] lod	LOD device, where OST targets are listed
  * \param[in] i		OST target index
@@ -453,26 +468,46 @@ static int lod_qos_calc_weight(struct lod_device *lod, int i)
 		OST_TGT(lod,i)->ltd_qos.ltq_weight = 0;
 	else
 		OST_TGT(lod,i)->ltd_qos.ltq_weight = temp - temp2;
+
+	if (lod->lod_qos.lq_load_max != 0) {
+		__u32 load = min(OST_TGT(lod, i)->ltd_statfs.os_load,
+				 lod->lod_qos.lq_load_max);
+
+		/* 0-256, like the priorities */
+		load = lod->lod_qos.lq_prio_load * load /
+		       lod->lod_qos.lq_load_max;
+		temp = OST_TGT(lod, i)->ltd_qos.ltq_weight >> 8;
+		OST_TGT(lod, i)->ltd_qos.ltq_weight -= temp * load;
+	}
 	return 0;
 }
 
+static __u64 lod_qos_weight_sum(struct lod_object *lo,
+				struct lod_avoid_guide *lag, __u32 index,
+				__u64 sum);
+
 /**
  * Re-calculate weights.
  *
  * The function is called when some OST target was used for a new object. In
  * this case we should re-calculate all the weights to keep new allocations
- * balanced well.
+ * balanced well. The running sums of the weights of the pool are updated in
+ * the same walk.
  *
- * \param[in] lod	LOD device
+ * \param[in] lo	object being striped
+ * \param[in] lag	guidance to avoid the OSTs of other mirrors
  * \param[in] osts	OST pool where a new object was placed
  * \param[in] index	OST target where a new object was placed
  * \param[out] total_wt	new total weight for the pool
  *
  * \retval		0
  */
-static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
-			__u32 index, __u64 *total_wt)
+static int lod_qos_used(struct lod_object *lo, struct lod_avoid_guide *lag,
+			struct ost_pool *osts, __u32 index, __u64 *total_wt)
 {
+	struct lod_device *lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	__u64 *weight_sum = lod->lod_qos.lq_weight_sum;
+	__u64 sum = 0;
 	struct lod_tgt_desc *ost;
 	struct lod_qos_oss  *oss;
 	unsigned int j;
@@ -514,8 +549,10 @@ static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
 		int i;
 
 		i = osts->op_array[j];
-		if (!cfs_bitmap_check(lod->lod_ost_bitmap, i))
+		if (!cfs_bitmap_check(lod->lod_ost_bitmap, i)) {
+			weight_sum[j] = sum;
 			continue;
+		}
 
 		ost = OST_TGT(lod,i);
 		LASSERT(ost);
@@ -532,6 +569,8 @@ static int lod_qos_used(struct lod_device *lod, struct ost_pool *osts,
 		/* Recalc the total weight of usable osts */
 		if (ost->ltd_qos.ltq_usable)
 			*total_wt += ost->ltd_qos.ltq_weight;
+		sum = lod_qos_weight_sum(lo, lag, i, sum);
+		weight_sum[j] = sum;
 
 		QOS_DEBUG("recalc tgt %d usable=%d avail=%llu"
 			  " ostppo=%llu ostp=%llu ossppo=%llu"
@@ -937,6 +976,37 @@ static inline bool lod_should_avoid_ost(struct lod_object *lo,
 	return used;
 }
 
+/**
+ * Add the weight of an OST to the running sum of the weights of the pool.
+ *
+ * Only the OSTs that lod_alloc_qos() can pick are counted, so that the sum
+ * of the OSTs up to a place in the pool can be compared to the random value
+ * of the weighted allocation, without walking the OSTs before it.
+ *
+ * \param[in] lo	object being striped
+ * \param[in] lag	guidance to avoid the OSTs of other mirrors
+ * \param[in] index	OST target index
+ * \param[in] sum	sum of the weights of the OSTs before it in the pool
+ *
+ * \retval		sum including the OST
+ */
+static __u64 lod_qos_weight_sum(struct lod_object *lo,
+				struct lod_avoid_guide *lag, __u32 index,
+				__u64 sum)
+{
+	struct lod_device *lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	struct lod_tgt_desc *ost;
+
+	if (!cfs_bitmap_check(lod->lod_ost_bitmap, index))
+		return sum;
+
+	ost = OST_TGT(lod, index);
+	if (!ost->ltd_qos.ltq_usable || lod_should_avoid_ost(lo, lag, index))
+		return sum;
+
+	return sum + ost->ltd_qos.ltq_weight;
+}
+
 static int lod_check_and_reserve_ost(const struct lu_env *env,
 				     struct lod_object *lo,
 				     struct obd_statfs *sfs, __u32 ost_idx,
@@ -1526,6 +1596,7 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	struct lod_tgt_desc *ost;
 	struct dt_object *o;
 	__u64 total_weight = 0;
+	__u64 *weight_sum;
 	struct pool_desc *pool = NULL;
 	struct ost_pool *osts;
 	unsigned int i;
@@ -1569,6 +1640,20 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	if (rc)
 		GOTO(out, rc);
 
+	if (lod->lod_qos.lq_weight_sum_count < osts->op_count) {
+		if (lod->lod_qos.lq_weight_sum != NULL)
+			OBD_FREE_LARGE(lod->lod_qos.lq_weight_sum,
+				       lod->lod_qos.lq_weight_sum_count *
+				       sizeof(*weight_sum));
+		lod->lod_qos.lq_weight_sum_count = 0;
+		OBD_ALLOC_LARGE(lod->lod_qos.lq_weight_sum,
+				osts->op_count * sizeof(*weight_sum));
+		if (lod->lod_qos.lq_weight_sum == NULL)
+			GOTO(out, rc = -ENOMEM);
+		lod->lod_qos.lq_weight_sum_count = osts->op_count;
+	}
+	weight_sum = lod->lod_qos.lq_weight_sum;
+
 	rc = lod_qos_ost_in_use_clear(env, lod_comp->llc_stripe_count);
 	if (rc)
 		GOTO(out, rc);
@@ -1613,12 +1698,17 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 	if (good_osts < stripe_count)
 		stripe_count = good_osts;
 
+	weight_sum[0] = lod_qos_weight_sum(lo, lag, osts->op_array[0], 0);
+	for (i = 1; i < osts->op_count; i++)
+		weight_sum[i] = lod_qos_weight_sum(lo, lag, osts->op_array[i],
+						   weight_sum[i - 1]);
+
 	/* Find enough OSTs with weighted random allocation. */
 	nfound = 0;
 	while (nfound < stripe_count) {
-		__u64 rand, cur_weight;
+		unsigned int lo_idx, hi_idx;
+		__u64 rand;
 
-		cur_weight = 0;
 		rc = -ENOSPC;
 
 		if (total_weight) {
@@ -1647,10 +1737,23 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 		}
 
 		/* On average, this will hit larger-weighted OSTs more often.
-		 * 0-weight OSTs will always get used last (only when rand=0) */
-		for (i = 0; i < osts->op_count; i++) {
+		 * 0-weight OSTs will always get used last (only when rand=0).
+		 * Start at the first OST whose running sum reaches rand, the
+		 * ones after it are only tried if it cannot be used. */
+		lo_idx = 0;
+		hi_idx = osts->op_count;
+		while (lo_idx < hi_idx) {
+			unsigned int mid = lo_idx + (hi_idx - lo_idx) / 2;
+
+			if (weight_sum[mid] < rand)
+				lo_idx = mid + 1;
+			else
+				hi_idx = mid;
+		}
+
+		for (i = lo_idx; i < osts->op_count; i++) {
 			__u32 idx = osts->op_array[i];
-			struct lod_tgt_desc *ost = OST_TGT(lod, idx);
+			struct lod_tgt_desc *ost;
 
 			if (lod_should_avoid_ost(lo, lag, idx))
 				continue;
@@ -1660,15 +1763,11 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 			if (!ost->ltd_qos.ltq_usable)
 				continue;
 
-			cur_weight += ost->ltd_qos.ltq_weight;
-			QOS_DEBUG("stripe_count=%d nfound=%d cur_weight=%llu "
+			QOS_DEBUG("stripe_count=%d nfound=%d weight_sum=%llu "
 				  "rand=%llu total_weight=%llu\n",
-				  stripe_count, nfound, cur_weight, rand,
+				  stripe_count, nfound, weight_sum[i], rand,
 				  total_weight);
 
-			if (cur_weight < rand)
-				continue;
-
 			QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
 			/*
 			 * do not put >1 objects on a single OST
@@ -1688,7 +1787,7 @@ static int lod_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 			lod_qos_ost_in_use(env, nfound, idx);
 			stripe[nfound] = o;
 			ost_indices[nfound] = idx;
-			lod_qos_used(lod, osts, idx, &total_weight);
+			lod_qos_used(lo, lag, osts, idx, &total_weight);
 			nfound++;
 			rc = 0;
 			break;
@@ -1882,6 +1981,11 @@ int lod_use_defined_striping(const struct lu_env *env,
 			if (lod_comp->llc_flags & LCME_FL_NOSYNC)
 				lod_comp->llc_timestamp = le64_to_cpu(
 					comp_v1->lcm_entries[i].lcme_timestamp);
+			if (lod_comp->llc_flags & LCME_FL_EXTENSION)
+				lod_comp->llc_extension_size = (__u64)
+					le32_to_cpu(comp_v1->lcm_entries[i].
+						    lcme_extension_size) *
+					SEL_UNIT_SIZE;
 			lod_comp->llc_id =
 				le32_to_cpu(comp_v1->lcm_entries[i].lcme_id);
 			if (lod_comp->llc_id == LCME_ID_INVAL)
@@ -2060,7 +2164,12 @@ int lod_qos_parse_config(const struct lu_env *env, struct lod_object *lo,
 			lod_comp->llc_extent = *ext;
 			lod_comp->llc_flags =
 				comp_v1->lcm_entries[i].lcme_flags &
-					LCME_USER_FLAGS;
+					LCME_CREATE_FLAGS;
+			if (lod_comp->llc_flags & LCME_FL_EXTENSION)
+				lod_comp->llc_extension_size = (__u64)
+					comp_v1->lcm_entries[i].
+						lcme_extension_size *
+					SEL_UNIT_SIZE;
 		}
 
 		pool_name = NULL;
@@ -463,6 +463,52 @@ static ssize_t qos_prio_free_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(qos_prio_free);
 
+/**
+ * Show QoS load priority parameter.
+ *
+ * The printed value is a percentage value (0-100%) indicating how much the
+ * weight of an OST is reduced when it has the most bulk I/O in progress of
+ * all the OSTs, as reported by the OSTs in statfs. 0% means the load of the
+ * OSTs is not used to select them.
+ */
+static ssize_t qos_prio_load_show(struct kobject *kobj, struct attribute *attr,
+				  char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct lod_device *lod = dt2lod_dev(dt);
+
+	return sprintf(buf, "%d%%\n",
+		       (lod->lod_qos.lq_prio_load * 100 + 255) >> 8);
+}
+
+/**
+ * Set QoS load priority parameter.
+ *
+ * See qos_prio_load_show() for description of this parameter.
+ */
+static ssize_t qos_prio_load_store(struct kobject *kobj, struct attribute *attr,
+				   const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct lod_device *lod = dt2lod_dev(dt);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > 100)
+		return -EINVAL;
+	lod->lod_qos.lq_prio_load = (val << 8) / 100;
+	lod->lod_qos.lq_dirty = 1;
+
+	return count;
+}
+LUSTRE_RW_ATTR(qos_prio_load);
+
 /**
  * Show threshold for "same space on all OSTs" rule.
  *
@@ -795,6 +841,7 @@ static struct attribute *lod_attrs[] = {
 	&lustre_attr_numobd.attr,
 	&lustre_attr_qos_maxage.attr,
 	&lustre_attr_qos_prio_free.attr,
+	&lustre_attr_qos_prio_load.attr,
 	NULL,
 };
 
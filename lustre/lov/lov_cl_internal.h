@@ -503,6 +503,15 @@ struct lov_io_sub {
 	 */
 	__u16			sub_refcheck;
 	__u16			sub_reenter;
+	/**
+	 * Pages of this stripe submitted by a worker of lov_submit_wq, see
+	 * lov_io_submit().
+	 */
+	struct cl_2queue	sub_queue;
+	struct work_struct	sub_work;
+	struct list_head	sub_async;
+	enum cl_req_type	sub_crt;
+	int			sub_rc;
 };
 
 /**
@@ -110,20 +110,32 @@ static int lsm_lmm_verify_v1v3(struct lov_mds_md *lmm, size_t lmm_size,
 	return 0;
 }
 
+/*
+ * The lov_oinfo of the stripes of an entry are allocated right after its
+ * lsme_oinfo[] array, in one allocation with the entry rather than one
+ * allocation each. A Data-on-MDT entry has no stripe but carries the
+ * lov_oinfo of its MDT object, see lsme_dom_oinfo().
+ */
+static size_t lsme_size(u32 pattern, unsigned int stripe_count)
+{
+	unsigned int oinfo_count = stripe_count;
+
+	if (lov_pattern(pattern) == LOV_PATTERN_MDT)
+		oinfo_count = 1;
+
+	return offsetof(struct lov_stripe_md_entry, lsme_oinfo[stripe_count]) +
+	       oinfo_count * sizeof(struct lov_oinfo);
+}
+
 static void lsme_free(struct lov_stripe_md_entry *lsme)
 {
 	unsigned int stripe_count = lsme->lsme_stripe_count;
-	unsigned int i;
-	size_t lsme_size;
 
-	if (!lsme_inited(lsme) ||
+	if (!lsme_inited(lsme) || lsme_is_dom(lsme) ||
 	    lsme->lsme_pattern & LOV_PATTERN_F_RELEASED)
 		stripe_count = 0;
-	for (i = 0; i < stripe_count; i++)
-		OBD_SLAB_FREE_PTR(lsme->lsme_oinfo[i], lov_oinfo_slab);
 
-	lsme_size = offsetof(typeof(*lsme), lsme_oinfo[stripe_count]);
-	OBD_FREE_LARGE(lsme, lsme_size);
+	OBD_FREE_LARGE(lsme, lsme_size(lsme->lsme_pattern, stripe_count));
 }
 
 void lsm_free(struct lov_stripe_md *lsm)
@@ -150,7 +162,8 @@ lsme_unpack(struct lov_obd *lov, struct lov_mds_md *lmm, size_t buf_size,
 	    loff_t *maxbytes)
 {
 	struct lov_stripe_md_entry *lsme;
-	size_t lsme_size;
+	struct lov_oinfo *oinfo;
+	size_t size;
 	loff_t min_stripe_maxbytes = 0;
 	loff_t lov_bytes;
 	u32 magic;
@@ -164,7 +177,8 @@ lsme_unpack(struct lov_obd *lov, struct lov_mds_md *lmm, size_t buf_size,
 		RETURN(ERR_PTR(-EINVAL));
 
 	pattern = le32_to_cpu(lmm->lmm_pattern);
-	if (pattern & LOV_PATTERN_F_RELEASED || !inited)
+	if (pattern & LOV_PATTERN_F_RELEASED || !inited ||
+	    lov_pattern(pattern) == LOV_PATTERN_MDT)
 		stripe_count = 0;
 	else
 		stripe_count = le16_to_cpu(lmm->lmm_stripe_count);
@@ -183,11 +197,13 @@ lsme_unpack(struct lov_obd *lov, struct lov_mds_md *lmm, size_t buf_size,
 	if (rc < 0)
 		return ERR_PTR(rc);
 
-	lsme_size = offsetof(typeof(*lsme), lsme_oinfo[stripe_count]);
-	OBD_ALLOC_LARGE(lsme, lsme_size);
+	size = lsme_size(pattern, stripe_count);
+	OBD_ALLOC_LARGE(lsme, size);
 	if (!lsme)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	oinfo = (struct lov_oinfo *)&lsme->lsme_oinfo[stripe_count];
+
 	lsme->lsme_magic = magic;
 	lsme->lsme_pattern = pattern;
 	lsme->lsme_flags = 0;
@@ -216,13 +232,9 @@ lsme_unpack(struct lov_obd *lov, struct lov_mds_md *lmm, size_t buf_size,
 	}
 
 	for (i = 0; i < stripe_count; i++) {
-		struct lov_oinfo *loi;
+		struct lov_oinfo *loi = &oinfo[i];
 		struct lov_tgt_desc *ltd;
 
-		OBD_SLAB_ALLOC_PTR_GFP(loi, lov_oinfo_slab, GFP_NOFS);
-		if (!loi)
-			GOTO(out_lsme, rc = -ENOMEM);
-
 		lsme->lsme_oinfo[i] = loi;
 
 		ostid_le_to_cpu(&objects[i].l_ost_oi, &loi->loi_oi);
@@ -272,13 +284,7 @@ out_dom2:
 	return lsme;
 
 out_lsme:
-	for (i = 0; i < stripe_count; i++) {
-		struct lov_oinfo *loi = lsme->lsme_oinfo[i];
-
-		if (loi)
-			OBD_SLAB_FREE_PTR(lsme->lsme_oinfo[i], lov_oinfo_slab);
-	}
-	OBD_FREE_LARGE(lsme, lsme_size);
+	OBD_FREE_LARGE(lsme, size);
 
 	return ERR_PTR(rc);
 }
@@ -484,6 +490,9 @@ lsm_unpackmd_comp_md_v1(struct lov_obd *lov, void *buf, size_t buf_size)
 		if (lsme->lsme_flags & LCME_FL_NOSYNC)
 			lsme->lsme_timestamp =
 				le64_to_cpu(lcme->lcme_timestamp);
+		if (lsme->lsme_flags & LCME_FL_EXTENSION)
+			lsme->lsme_extension_size =
+				le32_to_cpu(lcme->lcme_extension_size);
 		lu_extent_le_to_cpu(&lsme->lsme_extent, &lcme->lcme_extent);
 
 		if (i == entry_count - 1) {
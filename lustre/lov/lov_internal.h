@@ -48,6 +48,7 @@ struct lov_stripe_md_entry {
 	u32			lsme_flags;
 	u32			lsme_pattern;
 	u64			lsme_timestamp;
+	u32			lsme_extension_size; /* in SEL_UNIT_SIZE */
 	u32			lsme_stripe_size;
 	u16			lsme_stripe_count;
 	u16			lsme_layout_gen;
@@ -60,6 +61,14 @@ static inline bool lsme_is_dom(struct lov_stripe_md_entry *lsme)
 	return (lov_pattern(lsme->lsme_pattern) == LOV_PATTERN_MDT);
 }
 
+/* lov_oinfo of the MDT object of a Data-on-MDT entry, which has no stripe */
+static inline struct lov_oinfo *
+lsme_dom_oinfo(struct lov_stripe_md_entry *lsme)
+{
+	LASSERT(lsme_is_dom(lsme) && lsme->lsme_stripe_count == 0);
+	return (struct lov_oinfo *)&lsme->lsme_oinfo[0];
+}
+
 static inline void copy_lsm_entry(struct lov_stripe_md_entry *dst,
 				  struct lov_stripe_md_entry *src)
 {
@@ -245,7 +254,12 @@ struct lov_request_set {
 	struct list_head	 set_list;
 };
 
-extern struct kmem_cache *lov_oinfo_slab;
+extern struct workqueue_struct *lov_submit_wq;
+
+/* default of lov_obd::lov_submit_async_pages */
+#define LOV_SUBMIT_ASYNC_PAGES_DEF	64
+/* default of lov_obd::lov_mirror_read_stride */
+#define LOV_MIRROR_READ_STRIDE_DEF	(4 << 20)
 
 extern struct lu_kmem_descr lov_caches[];
 
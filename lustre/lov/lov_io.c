@@ -308,6 +308,135 @@ static int lov_io_mirror_write_intent(struct lov_io *lio,
 	RETURN(0);
 }
 
+/* bias of one second of estimated latency over a read RPC in flight */
+#define LOV_MIRROR_COST_SEC	1024
+
+/**
+ * FLR: estimate how expensive a read of mirror \a lre at \a pos is from the
+ * state of the OSCs serving the component that covers \a pos. The slowest
+ * stripe decides: its network latency plus OST_IO service estimate dominate
+ * and the number of read RPCs in flight breaks ties between mirrors whose
+ * OSTs answer equally fast.
+ *
+ * \retval UINT_MAX if the mirror doesn't cover \a pos or one of its OSTs
+ *		    is inactive
+ */
+static unsigned int lov_io_mirror_cost(struct lov_object *obj,
+				       struct lov_mirror_entry *lre, loff_t pos)
+{
+	struct lov_obd *lov = lu2lov_dev(obj->lo_cl.co_lu.lo_dev)->ld_lov;
+	struct lu_extent ext = { .e_start = pos, .e_end = pos + 1 };
+	struct lov_layout_entry *lle;
+	unsigned int cost = 0;
+	int i;
+
+	if (!lre->lre_valid)
+		return UINT_MAX;
+
+	lov_foreach_mirror_layout_entry(obj, lle, lre) {
+		struct lov_stripe_md_entry *lsme = lle->lle_lsme;
+
+		if (!lle->lle_valid ||
+		    !lu_extent_is_overlapped(&ext, lle->lle_extent))
+			continue;
+
+		/* DoM component, there is no OSC to ask */
+		if (lsme_is_dom(lsme))
+			return 0;
+
+		for (i = 0; i < lsme->lsme_stripe_count; i++) {
+			int idx = lsme->lsme_oinfo[i]->loi_ost_idx;
+			struct lov_tgt_desc *tgt;
+			struct client_obd *cli;
+			struct obd_import *imp;
+			unsigned int c;
+
+			if (idx < 0 || idx >= lov->desc.ld_tgt_count)
+				return UINT_MAX;
+
+			tgt = lov->lov_tgts[idx];
+			if (!tgt || !tgt->ltd_active || !tgt->ltd_obd)
+				return UINT_MAX;
+
+			cli = &tgt->ltd_obd->u.cli;
+			imp = cli->cl_import;
+			if (!imp)
+				return UINT_MAX;
+
+			c = at_get(&imp->imp_at.iat_net_latency) +
+			    at_get(&imp->imp_at.iat_service_estimate[
+					import_at_get_index(imp, OST_IO_PORTAL)]);
+			c = c * LOV_MIRROR_COST_SEC +
+			    min_t(unsigned int, cli->cl_r_in_flight,
+				  LOV_MIRROR_COST_SEC - 1);
+			cost = max(cost, c);
+		}
+
+		return cost;
+	}
+
+	return UINT_MAX;
+}
+
+/**
+ * FLR: choose the mirror a read starts with. Mirrors whose OSTs look the
+ * fastest are candidates, and successive lov_obd::lov_mirror_read_stride
+ * ranges of the file are handed to them in turn, so that reads of different
+ * parts of a large file are served by the OSTs of all of them. The walk starts from
+ * lo_preferred_mirror, which is hashed per client, so that clients don't
+ * all start with the same mirror.
+ *
+ * A mirror flagged preferred by the administrator is always used, as is
+ * lo_preferred_mirror if the stride is 0.
+ */
+static int lov_io_mirror_read_select(struct lov_io *lio,
+				     struct lov_object *obj)
+{
+	struct lov_layout_composite *comp = &obj->u.composite;
+	struct lov_obd *lov = lu2lov_dev(obj->lo_cl.co_lu.lo_dev)->ld_lov;
+	unsigned int cost[LUSTRE_MIRROR_COUNT_MAX + 1];
+	unsigned int best = UINT_MAX;
+	unsigned int nbest = 0;
+	unsigned int pick;
+	u64 stride = lov->lov_mirror_read_stride;
+	u64 chunk;
+	int preferred = comp->lo_preferred_mirror;
+	int count = comp->lo_mirror_count;
+	int i;
+
+	if (stride == 0 || count < 2 || count > ARRAY_SIZE(cost) ||
+	    comp->lo_mirrors[preferred].lre_preferred)
+		return preferred;
+
+	for (i = 0; i < count; i++) {
+		int idx = (preferred + i) % count;
+
+		cost[i] = lov_io_mirror_cost(obj, &comp->lo_mirrors[idx],
+					     lio->lis_pos);
+		if (cost[i] < best) {
+			best = cost[i];
+			nbest = 1;
+		} else if (cost[i] == best) {
+			nbest++;
+		}
+	}
+
+	/* nothing covers this position, let the caller complain */
+	if (best == UINT_MAX)
+		return preferred;
+
+	chunk = div64_u64(lio->lis_pos, stride);
+	pick = do_div(chunk, nbest);
+	for (i = 0; i < count; i++) {
+		if (cost[i] != best)
+			continue;
+		if (pick-- == 0)
+			break;
+	}
+
+	return (preferred + i) % count;
+}
+
 static int lov_io_mirror_init(struct lov_io *lio, struct lov_object *obj,
 			       struct cl_io *io)
 {
@@ -397,7 +526,11 @@ static int lov_io_mirror_init(struct lov_io *lio, struct lov_object *obj,
 	    /* reset the mirror index if layout has changed */
 	    lio->lis_mirror_layout_gen != obj->lo_lsm->lsm_layout_gen) {
 		lio->lis_mirror_layout_gen = obj->lo_lsm->lsm_layout_gen;
-		index = lio->lis_mirror_index = comp->lo_preferred_mirror;
+		if (io->ci_type == CIT_READ)
+			index = lov_io_mirror_read_select(lio, obj);
+		else
+			index = comp->lo_preferred_mirror;
+		lio->lis_mirror_index = index;
 	} else {
 		index = lio->lis_mirror_index;
 		LASSERT(index >= 0);
@@ -855,7 +988,9 @@ static int lov_io_rw_iter_init(const struct lu_env *env,
 	lse = lov_lse(lio->lis_object, index);
 
 	next = MAX_LFS_FILESIZE;
-	if (lse->lsme_stripe_count > 1) {
+	/* direct IO is sent synchronously by each iteration, so cutting it
+	 * at stripe boundaries would send it to one OST at a time */
+	if (lse->lsme_stripe_count > 1 && !io->ci_dio) {
 		unsigned long ssize = lse->lsme_stripe_size;
 
 		lov_do_div64(start, ssize);
@@ -881,7 +1016,8 @@ static int lov_io_rw_iter_init(const struct lu_env *env,
 
 	/*
 	 * XXX The following call should be optimized: we know, that
-	 * [lio->lis_pos, lio->lis_endpos) intersects with exactly one stripe.
+	 * [lio->lis_pos, lio->lis_endpos) intersects with exactly one stripe,
+	 * unless this is direct IO.
 	 */
 	RETURN(lov_io_iter_init(env, ios));
 }
@@ -1101,6 +1237,23 @@ static int lov_io_read_ahead(const struct lu_env *env,
 	RETURN(0);
 }
 
+/* Lists of @queue, owned by the submitting thread in invariant checks */
+static void lov_2queue_own(struct cl_2queue *queue)
+{
+	queue->c2_qin.pl_owner = current;
+	queue->c2_qout.pl_owner = current;
+}
+
+static void lov_io_submit_work(struct work_struct *work)
+{
+	struct lov_io_sub *sub = container_of(work, struct lov_io_sub,
+					      sub_work);
+
+	lov_2queue_own(&sub->sub_queue);
+	sub->sub_rc = cl_io_submit_rw(sub->sub_env, &sub->sub_io,
+				      sub->sub_crt, &sub->sub_queue);
+}
+
 /**
  * lov implementation of cl_operations::cio_submit() method. It takes a list
  * of pages in \a queue, splits it into per-stripe sub-lists, invokes
@@ -1115,6 +1268,11 @@ static int lov_io_read_ahead(const struct lu_env *env,
  * not-memory cleansing context), and in case of memory shortage, these
  * pre-allocated resources are used by lov_io_submit() under
  * lov_device::ld_mutex mutex.
+ *
+ * A stripe with at least lov_obd::lov_submit_async_pages pages, but the last
+ * one, is submitted by a worker of lov_submit_wq, in the environment of its
+ * sub-io, so that the stripes of a wide striped file are prepared in
+ * parallel. This is not done in memory reclaim.
  */
 static int lov_io_submit(const struct lu_env *env,
 			 const struct cl_io_slice *ios,
@@ -1122,14 +1280,23 @@ static int lov_io_submit(const struct lu_env *env,
 {
 	struct cl_page_list	*qin = &queue->c2_qin;
 	struct lov_io		*lio = cl2lov_io(env, ios);
+	struct lov_object	*lov = lio->lis_object;
 	struct lov_io_sub	*sub;
+	struct lov_io_sub	*next;
 	struct cl_page_list	*plist = &lov_env_info(env)->lti_plist;
 	struct cl_page		*page;
 	struct cl_page		*tmp;
+	unsigned int async_pages = 0;
+	struct list_head async;
 	int index;
 	int rc = 0;
 	ENTRY;
 
+	if (lio->lis_nr_subios > 1 && !(current->flags & PF_MEMALLOC))
+		async_pages = lu2lov_dev(lov->lo_cl.co_lu.lo_dev)->ld_lov->
+							lov_submit_async_pages;
+
+	INIT_LIST_HEAD(&async);
 	cl_page_list_init(plist);
 	while (qin->pl_nr > 0) {
 		struct cl_2queue  *cl2q = &lov_env_info(env)->lti_cl2q;
@@ -1148,10 +1315,18 @@ static int lov_io_submit(const struct lu_env *env,
 			continue;
 		}
 
+		index = lov_page_index(page);
+		sub = lov_sub_get(env, lio, index);
+		if (IS_ERR(sub)) {
+			rc = PTR_ERR(sub);
+			break;
+		}
+
+		if (async_pages > 0)
+			cl2q = &sub->sub_queue;
 		cl_2queue_init(cl2q);
 		cl_page_list_move(&cl2q->c2_qin, qin, page);
 
-		index = lov_page_index(page);
 		cl_page_list_for_each_safe(page, tmp, qin) {
 			/* this page is not on this stripe */
 			if (index != lov_page_index(page))
@@ -1160,14 +1335,17 @@ static int lov_io_submit(const struct lu_env *env,
 			cl_page_list_move(&cl2q->c2_qin, qin, page);
 		}
 
-		sub = lov_sub_get(env, lio, index);
-		if (!IS_ERR(sub)) {
-			rc = cl_io_submit_rw(sub->sub_env, &sub->sub_io,
-					     crt, cl2q);
-		} else {
-			rc = PTR_ERR(sub);
+		if (async_pages > 0 && cl2q->c2_qin.pl_nr >= async_pages &&
+		    qin->pl_nr > 0) {
+			sub->sub_crt = crt;
+			INIT_WORK(&sub->sub_work, lov_io_submit_work);
+			list_add_tail(&sub->sub_async, &async);
+			queue_work(lov_submit_wq, &sub->sub_work);
+			continue;
 		}
 
+		rc = cl_io_submit_rw(sub->sub_env, &sub->sub_io, crt, cl2q);
+
 		cl_page_list_splice(&cl2q->c2_qin, plist);
 		cl_page_list_splice(&cl2q->c2_qout, &queue->c2_qout);
 		cl_2queue_fini(env, cl2q);
@@ -1176,6 +1354,21 @@ static int lov_io_submit(const struct lu_env *env,
 			break;
 	}
 
+	list_for_each_entry_safe(sub, next, &async, sub_async) {
+		struct cl_2queue *cl2q = &sub->sub_queue;
+
+		flush_work(&sub->sub_work);
+		list_del_init(&sub->sub_async);
+		lov_2queue_own(cl2q);
+
+		if (rc == 0)
+			rc = sub->sub_rc;
+
+		cl_page_list_splice(&cl2q->c2_qin, plist);
+		cl_page_list_splice(&cl2q->c2_qout, &queue->c2_qout);
+		cl_2queue_fini(env, cl2q);
+	}
+
 	cl_page_list_splice(plist, qin);
 	cl_page_list_fini(env, plist);
 
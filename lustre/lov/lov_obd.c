@@ -38,6 +38,7 @@
  */
 
 #define DEBUG_SUBSYSTEM S_LOV
+#include <linux/kthread.h>
 #include <libcfs/libcfs.h>
 
 #include <cl_object.h>
@@ -113,6 +114,10 @@ static int lov_set_osc_active(struct obd_device *obd, struct obd_uuid *uuid,
 static int lov_notify(struct obd_device *obd, struct obd_device *watched,
 		      enum obd_notify_event ev);
 
+static unsigned int lov_connect_threads = 8;
+module_param(lov_connect_threads, uint, 0644);
+MODULE_PARM_DESC(lov_connect_threads, "number of threads connecting the targets of a LOV at mount");
+
 int lov_connect_obd(struct obd_device *obd, u32 index, int activate,
 		    struct obd_connect_data *data)
 {
@@ -196,16 +201,102 @@ int lov_connect_obd(struct obd_device *obd, u32 index, int activate,
 	RETURN(0);
 }
 
+/* targets of a LOV connected by a pool of threads at the first connect */
+struct lov_connect_parallel {
+	struct obd_device	*lcp_obd;
+	/* protects the fields below */
+	spinlock_t		 lcp_lock;
+	/* next target index to connect */
+	int			 lcp_index;
+	/* threads running besides the connecting one */
+	int			 lcp_threads;
+	/* connect flags common to all the connected targets */
+	__u64			 lcp_flags;
+	__u64			 lcp_flags2;
+	wait_queue_head_t	 lcp_waitq;
+};
+
+static void lov_connect_tgts(struct lov_connect_parallel *lcp)
+{
+	struct obd_device *obd = lcp->lcp_obd;
+	struct lov_obd *lov = &obd->u.lov;
+	struct lov_tgt_desc *tgt;
+	struct obd_connect_data data;
+	int i, rc;
+
+	while (1) {
+		spin_lock(&lcp->lcp_lock);
+		i = lcp->lcp_index++;
+		spin_unlock(&lcp->lcp_lock);
+		if (i >= lov->desc.ld_tgt_count)
+			break;
+
+		tgt = lov->lov_tgts[i];
+		if (!tgt || obd_uuid_empty(&tgt->ltd_uuid))
+			continue;
+		/* each target gets its own index, the flags are merged */
+		data = lov->lov_ocd;
+		rc = lov_connect_obd(obd, i, tgt->ltd_activate, &data);
+		if (rc) {
+			CERROR("%s: lov connect tgt %d failed: %d\n",
+			       obd->obd_name, i, rc);
+			continue;
+		}
+		/* connect to administrative disabled ost */
+		if (!lov->lov_tgts[i]->ltd_exp)
+			continue;
+
+		/* Flags will be lowest common denominator */
+		spin_lock(&lcp->lcp_lock);
+		lcp->lcp_flags &= data.ocd_connect_flags;
+		lcp->lcp_flags2 &= data.ocd_connect_flags2;
+		spin_unlock(&lcp->lcp_lock);
+
+		rc = lov_notify(obd, lov->lov_tgts[i]->ltd_exp->exp_obd,
+				OBD_NOTIFY_CONNECT);
+		if (rc)
+			CERROR("%s error sending notify %d\n",
+			       obd->obd_name, rc);
+	}
+}
+
+static int lov_connect_thread(void *arg)
+{
+	struct lov_connect_parallel *lcp = arg;
+
+	lov_connect_tgts(lcp);
+
+	/* wake up under the lock, lcp is gone once the count is seen 0 */
+	spin_lock(&lcp->lcp_lock);
+	if (--lcp->lcp_threads == 0)
+		wake_up_all(&lcp->lcp_waitq);
+	spin_unlock(&lcp->lcp_lock);
+
+	return 0;
+}
+
+static bool lov_connect_done(struct lov_connect_parallel *lcp)
+{
+	bool done;
+
+	spin_lock(&lcp->lcp_lock);
+	done = lcp->lcp_threads == 0;
+	spin_unlock(&lcp->lcp_lock);
+
+	return done;
+}
+
 static int lov_connect(const struct lu_env *env,
                        struct obd_export **exp, struct obd_device *obd,
                        struct obd_uuid *cluuid, struct obd_connect_data *data,
                        void *localdata)
 {
-        struct lov_obd *lov = &obd->u.lov;
-        struct lov_tgt_desc *tgt;
-        struct lustre_handle conn;
-        int i, rc;
-        ENTRY;
+	struct lov_obd *lov = &obd->u.lov;
+	struct lov_connect_parallel lcp;
+	struct task_struct *task;
+	struct lustre_handle conn;
+	int i, nthreads, rc;
+	ENTRY;
 
         CDEBUG(D_CONFIG, "connect #%d\n", lov->lov_connects);
 
@@ -225,28 +316,38 @@ static int lov_connect(const struct lu_env *env,
 
 	lov_tgts_getref(obd);
 
-        for (i = 0; i < lov->desc.ld_tgt_count; i++) {
-                tgt = lov->lov_tgts[i];
-                if (!tgt || obd_uuid_empty(&tgt->ltd_uuid))
-                        continue;
-                /* Flags will be lowest common denominator */
-                rc = lov_connect_obd(obd, i, tgt->ltd_activate, &lov->lov_ocd);
-                if (rc) {
-                        CERROR("%s: lov connect tgt %d failed: %d\n",
-                               obd->obd_name, i, rc);
-                        continue;
-                }
-                /* connect to administrative disabled ost */
-                if (!lov->lov_tgts[i]->ltd_exp)
-                        continue;
+	/* The connect RPCs are sent asynchronously, but the setup of the
+	 * exports and imports of the targets is not cheap, so it is done
+	 * by up to lov_connect_threads threads in turn. */
+	memset(&lcp, 0, sizeof(lcp));
+	lcp.lcp_obd = obd;
+	spin_lock_init(&lcp.lcp_lock);
+	init_waitqueue_head(&lcp.lcp_waitq);
+	lcp.lcp_flags = lov->lov_ocd.ocd_connect_flags;
+	lcp.lcp_flags2 = lov->lov_ocd.ocd_connect_flags2;
+
+	nthreads = min_t(int, lov_connect_threads, lov->desc.ld_tgt_count);
+	for (i = 1; i < nthreads; i++) {
+		spin_lock(&lcp.lcp_lock);
+		lcp.lcp_threads++;
+		spin_unlock(&lcp.lcp_lock);
+
+		task = kthread_run(lov_connect_thread, &lcp, "lov_conn_%02d",
+				   i);
+		if (IS_ERR(task)) {
+			CDEBUG(D_CONFIG, "%s: cannot start connect thread: "
+			       "rc = %ld\n", obd->obd_name, PTR_ERR(task));
+			spin_lock(&lcp.lcp_lock);
+			lcp.lcp_threads--;
+			spin_unlock(&lcp.lcp_lock);
+			break;
+		}
+	}
+	lov_connect_tgts(&lcp);
+	wait_event(lcp.lcp_waitq, lov_connect_done(&lcp));
 
-		rc = lov_notify(obd, lov->lov_tgts[i]->ltd_exp->exp_obd,
-				OBD_NOTIFY_CONNECT);
-                if (rc) {
-                        CERROR("%s error sending notify %d\n",
-                               obd->obd_name, rc);
-                }
-        }
+	lov->lov_ocd.ocd_connect_flags = lcp.lcp_flags;
+	lov->lov_ocd.ocd_connect_flags2 = lcp.lcp_flags2;
 
 	lov_tgts_putref(obd);
 
@@ -768,6 +869,8 @@ int lov_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	mutex_init(&lov->lov_lock);
 	atomic_set(&lov->lov_refcount, 0);
 	lov->lov_sp_me = LUSTRE_SP_CLI;
+	lov->lov_submit_async_pages = LOV_SUBMIT_ASYNC_PAGES_DEF;
+	lov->lov_mirror_read_stride = LOV_MIRROR_READ_STRIDE_DEF;
 
 	init_rwsem(&lov->lov_notify_lock);
 
@@ -1362,7 +1465,7 @@ static struct obd_ops lov_obd_ops = {
 	.o_quotactl		= lov_quotactl,
 };
 
-struct kmem_cache *lov_oinfo_slab;
+struct workqueue_struct *lov_submit_wq;
 
 static int __init lov_init(void)
 {
@@ -1380,13 +1483,12 @@ static int __init lov_init(void)
         if (rc)
                 return rc;
 
-	lov_oinfo_slab = kmem_cache_create("lov_oinfo",
-					   sizeof(struct lov_oinfo), 0,
-					   SLAB_HWCACHE_ALIGN, NULL);
-        if (lov_oinfo_slab == NULL) {
-                lu_kmem_fini(lov_caches);
-                return -ENOMEM;
-        }
+	lov_submit_wq = alloc_workqueue("lov_submit",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (lov_submit_wq == NULL) {
+		lu_kmem_fini(lov_caches);
+		return -ENOMEM;
+	}
 
 	type = class_search_type(LUSTRE_LOD_NAME);
 	if (type != NULL && type->typ_procsym != NULL)
@@ -1396,7 +1498,7 @@ static int __init lov_init(void)
 				 LUSTRE_LOV_NAME, &lov_device_type);
 
         if (rc) {
-		kmem_cache_destroy(lov_oinfo_slab);
+		destroy_workqueue(lov_submit_wq);
                 lu_kmem_fini(lov_caches);
         }
 
@@ -1406,7 +1508,7 @@ static int __init lov_init(void)
 static void __exit lov_exit(void)
 {
 	class_unregister_type(LUSTRE_LOV_NAME);
-	kmem_cache_destroy(lov_oinfo_slab);
+	destroy_workqueue(lov_submit_wq);
 	lu_kmem_fini(lov_caches);
 }
 
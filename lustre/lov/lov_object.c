@@ -539,7 +539,7 @@ static int lov_init_dom(const struct lu_env *env, struct lov_device *dev,
 	struct lu_object *o = lov2lu(lov);
 	const struct lu_fid *fid = lu_object_fid(o);
 	struct cl_device *mdcdev;
-	struct lov_oinfo *loi = NULL;
+	struct lov_oinfo *loi;
 	struct cl_object_conf *sconf = &lti->lti_stripe_conf;
 
 	int rc;
@@ -567,24 +567,21 @@ static int lov_init_dom(const struct lu_env *env, struct lov_device *dev,
 
 	LASSERTF(mdcdev != NULL, "non-initialized mdc subdev\n");
 
-	/* DoM object has no oinfo in LSM entry, create it exclusively */
-	OBD_SLAB_ALLOC_PTR_GFP(loi, lov_oinfo_slab, GFP_NOFS);
-	if (loi == NULL)
-		RETURN(-ENOMEM);
-
+	/* DoM object has no stripe, its oinfo is kept along the LSM entry */
+	loi = lsme_dom_oinfo(lsme);
 	fid_to_ostid(lu_object_fid(lov2lu(lov)), &loi->loi_oi);
 
 	sconf->u.coc_oinfo = loi;
 again:
 	clo = lov_sub_find(env, mdcdev, fid, sconf);
 	if (IS_ERR(clo))
-		GOTO(out, rc = PTR_ERR(clo));
+		RETURN(PTR_ERR(clo));
 
 	rc = lov_init_sub(env, lov, clo, loi, lov_comp_index(index, 0));
 	if (rc == -EAGAIN) /* try again */
 		goto again;
 	else if (rc != 0)
-		GOTO(out, rc);
+		RETURN(rc);
 
 	lle->lle_dom.lo_dom = cl2lovsub(clo);
 	spin_lock_init(&lle->lle_dom.lo_dom_r0.lo_sub_lock);
@@ -594,11 +591,6 @@ again:
 
 	rc = lov_page_slice_fixup(lov, clo);
 	RETURN(rc);
-
-out:
-	if (loi != NULL)
-		OBD_SLAB_FREE_PTR(loi, lov_oinfo_slab);
-	return rc;
 }
 
 /**
@@ -615,8 +607,7 @@ static void lov_fini_dom(const struct lu_env *env,
 {
 	if (lle->lle_dom.lo_dom != NULL)
 		lle->lle_dom.lo_dom = NULL;
-	if (lle->lle_dom.lo_loi != NULL)
-		OBD_SLAB_FREE_PTR(lle->lle_dom.lo_loi, lov_oinfo_slab);
+	lle->lle_dom.lo_loi = NULL;
 }
 
 static struct lov_comp_layout_entry_ops dom_ops = {
@@ -2030,6 +2021,7 @@ static int lov_object_layout_get(const struct lu_env *env,
 	cl->cl_size = lov_comp_md_size(lsm);
 	cl->cl_layout_gen = lsm->lsm_layout_gen;
 	cl->cl_is_composite = lsm_is_composite(lsm->lsm_magic);
+	cl->cl_is_released = lsm->lsm_is_released;
 
 	rc = lov_lsm_pack(lsm, buf->lb_buf, buf->lb_len);
 	lov_lsm_put(lsm);
@@ -228,6 +228,9 @@ ssize_t lov_lsm_pack(const struct lov_stripe_md *lsm, void *buf,
 		if (lsme->lsme_flags & LCME_FL_NOSYNC)
 			lcme->lcme_timestamp =
 				cpu_to_le64(lsme->lsme_timestamp);
+		if (lsme->lsme_flags & LCME_FL_EXTENSION)
+			lcme->lcme_extension_size =
+				cpu_to_le32(lsme->lsme_extension_size);
 		lcme->lcme_extent.e_start =
 			cpu_to_le64(lsme->lsme_extent.e_start);
 		lcme->lcme_extent.e_end =
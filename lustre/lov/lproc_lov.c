@@ -202,6 +202,62 @@ static ssize_t desc_uuid_show(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RO_ATTR(desc_uuid);
 
+static ssize_t submit_async_pages_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct obd_device *dev = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", dev->u.lov.lov_submit_async_pages);
+}
+
+static ssize_t submit_async_pages_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct obd_device *dev = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	dev->u.lov.lov_submit_async_pages = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(submit_async_pages);
+
+static ssize_t mirror_read_stride_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct obd_device *dev = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", dev->u.lov.lov_mirror_read_stride);
+}
+
+static ssize_t mirror_read_stride_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct obd_device *dev = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	dev->u.lov.lov_mirror_read_stride = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(mirror_read_stride);
+
 #ifdef CONFIG_PROC_FS
 static void *lov_tgt_seq_start(struct seq_file *p, loff_t *pos)
 {
@@ -285,6 +341,8 @@ static struct attribute *lov_attrs[] = {
 	&lustre_attr_stripeoffset.attr,
 	&lustre_attr_stripetype.attr,
 	&lustre_attr_stripecount.attr,
+	&lustre_attr_submit_async_pages.attr,
+	&lustre_attr_mirror_read_stride.attr,
 	NULL,
 };
 
@@ -35,6 +35,8 @@
 #include <linux/poll.h>
 #include <linux/device.h>
 #include <linux/cdev.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 #include <lustre_log.h>
 #include <uapi/linux/lustre/lustre_ioctl.h>
@@ -97,6 +99,13 @@ struct chlg_reader_state {
 	unsigned int		    crs_last_catidx;
 	unsigned int		    crs_last_idx;
 	bool			    crs_poll;
+	/* Records to return, protected by crs_lock */
+	struct changelog_filter	    crs_filter;
+	/* Ring mapped by the reader, if any, protected by crs_lock */
+	struct changelog_ring	   *crs_ring;
+	/* Size of its data, and its head, which the reader could change */
+	__u32			    crs_ring_size;
+	__u64			    crs_ring_head;
 };
 
 struct chlg_rec_entry {
@@ -188,6 +197,147 @@ static inline void chlg_obd_put(struct chlg_registered_dev *dev,
 	class_decref(obd, "changelog", dev);
 }
 
+/**
+ * Check a record against the filter of a reader.
+ *
+ * @param[in]  cf   Filter, see OBD_IOC_CHLG_FILTER.
+ * @param[in]  rec  Changelog record.
+ * @return true if the reader wants the record.
+ */
+static bool chlg_filter_match(const struct changelog_filter *cf,
+			      const struct changelog_rec *rec)
+{
+	if (cf->cf_type_mask != 0 &&
+	    (rec->cr_type >= 64 ||
+	     !(cf->cf_type_mask & (1ULL << rec->cr_type))))
+		return false;
+
+	if (cf->cf_part_count > 1) {
+		__u64 hash = fid_flatten(&rec->cr_tfid);
+
+		if (do_div(hash, cf->cf_part_count) != cf->cf_part_index)
+			return false;
+	}
+
+	if (!fid_is_zero(&cf->cf_fid) &&
+	    !lu_fid_eq(&cf->cf_fid, &rec->cr_tfid) &&
+	    !lu_fid_eq(&cf->cf_fid, &rec->cr_pfid))
+		return false;
+
+	if (cf->cf_jobid[0] != '\0') {
+		struct changelog_ext_jobid *jid;
+
+		if (!(rec->cr_flags & CLF_JOBID))
+			return false;
+
+		jid = changelog_rec_jobid(rec);
+		if (strncmp(jid->cr_jobid, cf->cf_jobid,
+			    sizeof(jid->cr_jobid)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Remove record from the list it is attached to and free it.
+ */
+static void enq_record_delete(struct chlg_rec_entry *rec)
+{
+	list_del(&rec->enq_linkage);
+	OBD_FREE(rec, sizeof(*rec) + rec->enq_length);
+}
+
+/**
+ * Append a record to the ring mapped by the reader.
+ *
+ * @param[in,out]  crs  Internal reader state, crs_lock held.
+ * @param[in]      rec  Changelog record.
+ * @param[in]      len  Record length.
+ * @return 1 if the record was added, 0 if there is no space for it yet,
+ *         negated error code if the reader corrupted the ring.
+ */
+static int chlg_ring_put(struct chlg_reader_state *crs,
+			 const struct changelog_rec *rec, size_t len)
+{
+	struct changelog_ring *clr = crs->crs_ring;
+	struct changelog_ring_ent *ent;
+	char *data = (char *)clr + PAGE_SIZE;
+	__u64 head = crs->crs_ring_head;
+	__u64 tail = READ_ONCE(clr->clr_tail);
+	__u32 size = crs->crs_ring_size;
+	__u32 need = ALIGN(sizeof(*ent) + len, 8);
+	__u32 off = head & (size - 1);
+	__u32 wrap = off + need > size ? size - off : 0;
+
+	if (tail > head || head - tail > size)
+		return -EINVAL;
+
+	if (head + wrap + need - tail > size)
+		return 0;
+
+	if (wrap != 0) {
+		ent = (struct changelog_ring_ent *)(data + off);
+		ent->cre_len = wrap;
+		ent->cre_flags = CRE_WRAP;
+		off = 0;
+	}
+
+	ent = (struct changelog_ring_ent *)(data + off);
+	ent->cre_len = need;
+	ent->cre_flags = 0;
+	memcpy(ent->cre_rec, rec, len);
+	crs->crs_ring_head = head + wrap + need;
+
+	return 1;
+}
+
+/**
+ * Move the prefetched records to the ring mapped by the reader, as far as
+ * there is space for them, then publish them, and the end of the changelog
+ * once all were moved.
+ *
+ * @param[in,out]  crs  Internal reader state, crs_lock held.
+ */
+static void chlg_ring_fill(struct chlg_reader_state *crs)
+{
+	struct changelog_ring *clr = crs->crs_ring;
+	struct chlg_rec_entry *rec;
+	struct chlg_rec_entry *tmp;
+	__u64 head = crs->crs_ring_head;
+	int rc = 0;
+
+	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage) {
+		rc = chlg_ring_put(crs, rec->enq_record, rec->enq_length);
+		if (rc <= 0)
+			break;
+
+		crs->crs_rec_count--;
+		crs->crs_start_offset = rec->enq_record->cr_index + 1;
+		enq_record_delete(rec);
+	}
+
+	if (rc < 0 && crs->crs_err == 0) {
+		CERROR("%s: changelog ring corrupted by the reader: rc = %d\n",
+		       crs->crs_ced->ced_name, rc);
+		crs->crs_err = rc;
+	}
+
+	if (list_empty(&crs->crs_rec_queue)) {
+		if (crs->crs_err < 0)
+			clr->clr_error = crs->crs_err;
+		else if (crs->crs_eof)
+			clr->clr_flags |= CLR_EOF;
+	}
+
+	/* the entries and flags before the head that makes them visible */
+	smp_wmb();
+	WRITE_ONCE(clr->clr_head, crs->crs_ring_head);
+
+	if (crs->crs_ring_head != head)
+		wake_up_all(&crs->crs_waitq_prod);
+}
+
 /**
  * ChangeLog catalog processing callback invoked on each record.
  * If the current record is eligible to userland delivery, push
@@ -232,6 +382,12 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	if (rec->cr.cr_index < crs->crs_start_offset)
 		RETURN(0);
 
+	mutex_lock(&crs->crs_lock);
+	rc = chlg_filter_match(&crs->crs_filter, &rec->cr);
+	mutex_unlock(&crs->crs_lock);
+	if (!rc)
+		RETURN(0);
+
 	CDEBUG(D_HSM, "%llu %02d%-5s %llu 0x%x t="DFID" p="DFID" %.*s\n",
 	       rec->cr.cr_index, rec->cr.cr_type,
 	       changelog_type2str(rec->cr.cr_type), rec->cr.cr_time,
@@ -258,6 +414,8 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	mutex_lock(&crs->crs_lock);
 	list_add_tail(&enq->enq_linkage, &crs->crs_rec_queue);
 	crs->crs_rec_count++;
+	if (crs->crs_ring != NULL)
+		chlg_ring_fill(crs);
 	mutex_unlock(&crs->crs_lock);
 
 	wake_up_all(&crs->crs_waitq_cons);
@@ -265,15 +423,6 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	RETURN(0);
 }
 
-/**
- * Remove record from the list it is attached to and free it.
- */
-static void enq_record_delete(struct chlg_rec_entry *rec)
-{
-	list_del(&rec->enq_linkage);
-	OBD_FREE(rec, sizeof(*rec) + rec->enq_length);
-}
-
 /**
  * Record prefetch thread entry point. Opens the changelog catalog and starts
  * reading records.
@@ -349,6 +498,11 @@ err_out:
 	if (rc < 0)
 		crs->crs_err = rc;
 
+	mutex_lock(&crs->crs_lock);
+	if (crs->crs_ring != NULL)
+		chlg_ring_fill(crs);
+	mutex_unlock(&crs->crs_lock);
+
 	wake_up_all(&crs->crs_waitq_cons);
 
 	if (llh != NULL)
@@ -387,6 +541,10 @@ static ssize_t chlg_read(struct file *file, char __user *buff, size_t count,
 	LIST_HEAD(consumed);
 	ENTRY;
 
+	/* the records go to the ring once it is mapped */
+	if (crs->crs_ring != NULL)
+		RETURN(-EBUSY);
+
 	if (file->f_flags & O_NONBLOCK && crs->crs_rec_count == 0) {
 		if (crs->crs_err < 0)
 			RETURN(crs->crs_err);
@@ -652,12 +810,70 @@ static int chlg_release(struct inode *inode, struct file *file)
 	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage)
 		enq_record_delete(rec);
 
+	if (crs->crs_ring != NULL)
+		vfree(crs->crs_ring);
+
 	kref_put(&crs->crs_ced->ced_refs, chlg_dev_clear);
 	OBD_FREE_PTR(crs);
 
 	return rc;
 }
 
+/**
+ * Mmap handler, set up the ring of struct changelog_ring through which the
+ * records are returned from now on, instead of by read().
+ *
+ * @param[in]  file   Device file pointer.
+ * @param[in]  vma    Mapping of a header page then of the ring data.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct chlg_reader_state *crs = file->private_data;
+	struct changelog_ring *clr;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	unsigned long size = len - PAGE_SIZE;
+	int rc;
+
+	if (!(file->f_mode & FMODE_READ) || vma->vm_pgoff != 0 ||
+	    !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	if (len <= PAGE_SIZE || !is_power_of_2(size) ||
+	    size < CHANGELOG_RING_MIN || size > CHANGELOG_RING_MAX)
+		return -EINVAL;
+
+	clr = vmalloc_user(len);
+	if (clr == NULL)
+		return -ENOMEM;
+
+	clr->clr_magic = CHANGELOG_RING_MAGIC;
+	clr->clr_size = size;
+	clr->clr_data = PAGE_SIZE;
+
+	mutex_lock(&crs->crs_lock);
+	if (crs->crs_ring != NULL)
+		GOTO(out_unlock, rc = -EBUSY);
+
+	rc = remap_vmalloc_range(vma, clr, 0);
+	if (rc)
+		GOTO(out_unlock, rc);
+
+	crs->crs_ring = clr;
+	crs->crs_ring_size = size;
+	crs->crs_ring_head = 0;
+	/* the records already prefetched come first */
+	chlg_ring_fill(crs);
+	clr = NULL;
+out_unlock:
+	mutex_unlock(&crs->crs_lock);
+	if (clr != NULL)
+		vfree(clr);
+	wake_up_all(&crs->crs_waitq_cons);
+
+	return rc;
+}
+
 /**
  * Poll handler, indicates whether the device is readable (new records) and
  * writable (always).
@@ -673,8 +889,14 @@ static unsigned int chlg_poll(struct file *file, poll_table *wait)
 
 	mutex_lock(&crs->crs_lock);
 	poll_wait(file, &crs->crs_waitq_cons, wait);
-	if (crs->crs_rec_count > 0)
+	if (crs->crs_ring != NULL) {
+		/* the reader polls after freeing space in the ring */
+		chlg_ring_fill(crs);
+		if (crs->crs_ring_head != READ_ONCE(crs->crs_ring->clr_tail))
+			mask |= POLLIN | POLLRDNORM;
+	} else if (crs->crs_rec_count > 0) {
 		mask |= POLLIN | POLLRDNORM;
+	}
 	if (crs->crs_err)
 		mask |= POLLERR;
 	if (crs->crs_eof)
@@ -683,6 +905,43 @@ static unsigned int chlg_poll(struct file *file, poll_table *wait)
 	return mask;
 }
 
+/**
+ * Set the filter of a reader, and drop the prefetched records it does not
+ * want any more.
+ *
+ * @param[in,out]  crs   Internal reader state.
+ * @param[in]      arg   Userland struct changelog_filter.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_set_filter(struct chlg_reader_state *crs, unsigned long arg)
+{
+	struct changelog_filter cf;
+	struct chlg_rec_entry *rec;
+	struct chlg_rec_entry *tmp;
+
+	if (copy_from_user(&cf, (void __user *)arg, sizeof(cf)))
+		return -EFAULT;
+
+	if (cf.cf_part_count > 1 && cf.cf_part_index >= cf.cf_part_count)
+		return -EINVAL;
+
+	cf.cf_jobid[sizeof(cf.cf_jobid) - 1] = '\0';
+
+	mutex_lock(&crs->crs_lock);
+	crs->crs_filter = cf;
+	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage) {
+		if (chlg_filter_match(&cf, rec->enq_record))
+			continue;
+
+		crs->crs_rec_count--;
+		enq_record_delete(rec);
+	}
+	mutex_unlock(&crs->crs_lock);
+	wake_up_all(&crs->crs_waitq_prod);
+
+	return 0;
+}
+
 static long chlg_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	int rc;
@@ -693,6 +952,9 @@ static long chlg_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		crs->crs_poll = !!arg;
 		rc = 0;
 		break;
+	case OBD_IOC_CHLG_FILTER:
+		rc = chlg_set_filter(crs, arg);
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -708,6 +970,7 @@ static const struct file_operations chlg_fops = {
 	.open		= chlg_open,
 	.release	= chlg_release,
 	.poll		= chlg_poll,
+	.mmap		= chlg_mmap,
 	.unlocked_ioctl	= chlg_ioctl,
 };
 
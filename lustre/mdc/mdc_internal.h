@@ -183,4 +183,7 @@ int mdc_fill_lvb(struct ptlrpc_request *req, struct ost_lvb *lvb);
 #define MDC_DOM_DEF_INLINE_REPSIZE max(8192UL, PAGE_SIZE)
 #define MDC_DOM_MAX_INLINE_REPSIZE XATTR_SIZE_MAX
 
+/* default max # of getattr requests per MDS_BATCH RPC */
+#define MDC_BATCH_MAX_DEFAULT 16
+
 #endif
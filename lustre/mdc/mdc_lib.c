@@ -499,6 +499,8 @@ static void mdc_close_intent_pack(struct ptlrpc_request *req,
 
 	if (bias & MDS_CLOSE_LAYOUT_SPLIT) {
 		data->cd_mirror_id = op_data->op_mirror_id;
+	} else if (bias & MDS_PCC_ATTACH) {
+		data->cd_archive_id = op_data->op_archive_id;
 	} else if (bias & MDS_CLOSE_RESYNC_DONE) {
 		struct close_data_resync_done *sync = &data->cd_resync;
 
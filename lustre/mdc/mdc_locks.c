@@ -1419,7 +1419,7 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	ga->ga_minfo = minfo;
 
 	req->rq_interpret_reply = mdc_intent_getattr_async_interpret;
-	ptlrpcd_add_req(req);
+	ptlrpc_batch_add(exp, req);
 
 	RETURN(0);
 }
@@ -2762,6 +2762,9 @@ int mdc_setup(struct obd_device *obd, struct lustre_cfg *cfg)
 	if (rc < 0)
 		RETURN(rc);
 
+	obd->u.cli.cl_batch_max = MDC_BATCH_MAX_DEFAULT;
+	obd->u.cli.cl_batch_maxbuf = MDS_BATCH_MAXBUFSIZE;
+
 	rc = mdc_tunables_init(obd);
 	if (rc)
 		GOTO(err_osc_cleanup, rc);
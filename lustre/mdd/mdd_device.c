@@ -157,6 +157,11 @@ static int mdd_init0(const struct lu_env *env, struct mdd_device *mdd,
 	/* special default striping for files created with O_APPEND */
 	mdd->mdd_append_stripe_count = 1;
 	mdd->mdd_append_pool[0] = '\0';
+	mdd->mdd_orphan_threads = MDD_ORPHAN_THREADS_DEF;
+	atomic_set(&mdd->mdd_orphan_running, 0);
+	atomic_set(&mdd->mdd_orphan_scanned, 0);
+	atomic_set(&mdd->mdd_orphan_destroyed, 0);
+	atomic_set(&mdd->mdd_orphan_skipped, 0);
 
 	dt_conf_get(env, mdd->mdd_child, &mdd->mdd_dt_conf);
 
@@ -1126,7 +1131,7 @@ static int mdd_process_config(const struct lu_env *env,
                 break;
 	case LCFG_PRE_CLEANUP:
 		rc = next->ld_ops->ldo_process_config(env, next, cfg);
-		mdd_generic_thread_stop(&m->mdd_orphan_cleanup_thread);
+		mdd_orphan_cleanup_stop(m);
 		break;
 	case LCFG_CLEANUP:
 		rc = next->ld_ops->ldo_process_config(env, next, cfg);
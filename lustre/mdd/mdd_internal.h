@@ -130,6 +130,10 @@ struct mdd_generic_thread {
 	bool			mgt_init;
 };
 
+/* max # of threads cleaning the PENDING directory up after recovery */
+#define MDD_ORPHAN_THREADS_MAX	16
+#define MDD_ORPHAN_THREADS_DEF	4
+
 struct mdd_device {
         struct md_device                 mdd_md_dev;
 	struct obd_export               *mdd_child_exp;
@@ -153,7 +157,20 @@ struct mdd_device {
 	int				 mdd_append_stripe_count;
 	char				 mdd_append_pool[LOV_MAXPOOLNAME + 1];
 	struct local_oid_storage	*mdd_los;
-	struct mdd_generic_thread	 mdd_orphan_cleanup_thread;
+	struct mdd_generic_thread	 mdd_orphan_cleanup_threads[
+						MDD_ORPHAN_THREADS_MAX];
+	/* # of orphan cleanup threads to start after recovery */
+	unsigned int			 mdd_orphan_threads;
+	/* max # of orphans destroyed per second, 0 for no limit */
+	unsigned int			 mdd_orphan_rate;
+	/* # of orphan cleanup threads started, 0 before recovery ends */
+	unsigned int			 mdd_orphan_cleanup_nr;
+	/* # of orphan cleanup threads still running */
+	atomic_t			 mdd_orphan_running;
+	/* orphan cleanup progress */
+	atomic_t			 mdd_orphan_scanned;
+	atomic_t			 mdd_orphan_destroyed;
+	atomic_t			 mdd_orphan_skipped;
 	struct kobject			 mdd_kobj;
 	struct kobj_type		 mdd_ktype;
 	struct completion		 mdd_kobj_unregister;
@@ -297,6 +314,7 @@ const struct lu_buf *mdd_buf_get_const(const struct lu_env *env,
                                        const void *area, ssize_t len);
 
 int mdd_orphan_cleanup(const struct lu_env *env, struct mdd_device *d);
+void mdd_orphan_cleanup_stop(struct mdd_device *d);
 int mdd_orphan_insert(const struct lu_env *env, struct mdd_object *obj,
 		      struct thandle *thandle);
 int mdd_orphan_delete(const struct lu_env *env, struct mdd_object *obj,
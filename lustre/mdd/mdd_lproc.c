@@ -513,6 +513,94 @@ static ssize_t lfsck_async_windows_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(lfsck_async_windows);
 
+static ssize_t orphan_cleanup_threads_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+
+	return sprintf(buf, "%u\n", mdd->mdd_orphan_threads);
+}
+
+/* takes effect at the next recovery */
+static ssize_t orphan_cleanup_threads_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > MDD_ORPHAN_THREADS_MAX)
+		return -ERANGE;
+
+	mdd->mdd_orphan_threads = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(orphan_cleanup_threads);
+
+static ssize_t orphan_cleanup_rate_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+
+	return sprintf(buf, "%u\n", mdd->mdd_orphan_rate);
+}
+
+static ssize_t orphan_cleanup_rate_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	mdd->mdd_orphan_rate = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(orphan_cleanup_rate);
+
+static int mdd_orphan_cleanup_seq_show(struct seq_file *m, void *data)
+{
+	struct mdd_device *mdd = m->private;
+	const char *status;
+
+	LASSERT(mdd != NULL);
+
+	if (mdd->mdd_orphan_cleanup_nr == 0)
+		status = "init";
+	else if (atomic_read(&mdd->mdd_orphan_running) > 0)
+		status = "scanning";
+	else
+		status = "completed";
+
+	seq_printf(m, "status: %s\n"
+		   "threads: %u\n"
+		   "scanned: %d\n"
+		   "destroyed: %d\n"
+		   "still_open: %d\n",
+		   status, mdd->mdd_orphan_cleanup_nr,
+		   atomic_read(&mdd->mdd_orphan_scanned),
+		   atomic_read(&mdd->mdd_orphan_destroyed),
+		   atomic_read(&mdd->mdd_orphan_skipped));
+
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(mdd_orphan_cleanup);
+
 static int mdd_lfsck_namespace_seq_show(struct seq_file *m, void *data)
 {
 	struct mdd_device *mdd = m->private;
@@ -653,6 +741,8 @@ static struct lprocfs_vars lprocfs_mdd_obd_vars[] = {
 	  .fops =	&mdd_lfsck_namespace_fops	},
 	{ .name	=	"lfsck_layout",
 	  .fops	=	&mdd_lfsck_layout_fops		},
+	{ .name	=	"orphan_cleanup",
+	  .fops	=	&mdd_orphan_cleanup_fops	},
 	{ NULL }
 };
 
@@ -671,6 +761,8 @@ static struct attribute *mdd_attrs[] = {
 	&lustre_attr_sync_permission.attr,
 	&lustre_attr_append_stripe_count.attr,
 	&lustre_attr_append_pool.attr,
+	&lustre_attr_orphan_cleanup_threads.attr,
+	&lustre_attr_orphan_cleanup_rate.attr,
 	NULL,
 };
 
@@ -387,6 +387,39 @@ static int mdd_orphan_key_test_and_delete(const struct lu_env *env,
         return rc;
 }
 
+/**
+ * Limit the rate of the orphan cleanup to mdd_device::mdd_orphan_rate
+ *
+ * The rate is shared by the cleanup threads, each of them sleeps as needed
+ * for its part of the rate after destroying an orphan.
+ *
+ * \param thread  info about orphan cleanup thread
+ * \param count   orphans destroyed by \a thread since it last slept
+ */
+static void mdd_orphan_control_speed(struct mdd_generic_thread *thread,
+				     unsigned int *count)
+{
+	struct mdd_device *mdd = (struct mdd_device *)thread->mgt_data;
+	unsigned int rate = mdd->mdd_orphan_rate;
+	long timeout;
+
+	if (rate == 0)
+		return;
+
+	rate = max(rate / mdd->mdd_orphan_cleanup_nr, 1U);
+	if (rate >= HZ) {
+		if (++(*count) < rate / HZ)
+			return;
+		timeout = 1;
+	} else {
+		timeout = HZ / rate;
+	}
+	*count = 0;
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	schedule_timeout(timeout);
+}
+
 /**
  * delete unreferenced files and directories in the PENDING directory
  *
@@ -394,6 +427,10 @@ static int mdd_orphan_key_test_and_delete(const struct lu_env *env,
  * have to be referenced (opened) by some client during recovery, or they
  * will be deleted here (for clients that did not complete recovery).
  *
+ * Each of the cleanup threads scans the whole directory, but only handles
+ * the orphans whose FID hashes to its index, so that they never compete for
+ * the same orphans.
+ *
  * \param thread  info about orphan cleanup thread
  *
  * \retval 0   success
@@ -405,9 +442,12 @@ static int mdd_orphan_index_iterate(const struct lu_env *env,
 	struct mdd_device *mdd = (struct mdd_device *)thread->mgt_data;
 	struct dt_object *dor = mdd->mdd_orphans;
 	struct lu_dirent *ent = &mdd_env_info(env)->mti_ent;
+	unsigned int index = thread - mdd->mdd_orphan_cleanup_threads;
+	unsigned int count = 0;
 	const struct dt_it_ops *iops;
 	struct dt_it *it;
 	struct lu_fid fid;
+	__u64 cookie;
 	int key_sz = 0;
 	int rc;
 	ENTRY;
@@ -456,13 +496,32 @@ static int mdd_orphan_index_iterate(const struct lu_env *env,
 			goto next;
 		}
 
+		if (fid_flatten32(&fid) % mdd->mdd_orphan_cleanup_nr != index)
+			goto next;
+
+		atomic_inc(&mdd->mdd_orphan_scanned);
+
 		/* kill orphan object */
+		cookie = iops->store(env, it);
 		iops->put(env, it);
 		rc = mdd_orphan_key_test_and_delete(env, mdd, &fid,
 						(struct dt_key *)ent->lde_name);
-		/* after index delete reset iterator */
-		if (rc == 0)
-			rc = iops->get(env, it, (const void *)"");
+		if (rc == -EBUSY)
+			atomic_inc(&mdd->mdd_orphan_skipped);
+		/* after index delete reload iterator at the deleted entry, it
+		 * is at the next one then, instead of restarting the scan */
+		if (rc == 0) {
+			atomic_inc(&mdd->mdd_orphan_destroyed);
+			mdd_orphan_control_speed(thread, &count);
+
+			rc = iops->load(env, it, cookie);
+			if (rc > 0) {
+				rc = 0;
+				continue;
+			}
+			if (rc < 0)
+				break;
+		}
 next:
 		rc = iops->next(env, it);
 	} while (rc == 0);
@@ -535,6 +594,7 @@ void mdd_orphan_index_fini(const struct lu_env *env, struct mdd_device *mdd)
 static int mdd_orphan_cleanup_thread(void *args)
 {
 	struct mdd_generic_thread *thread = (struct mdd_generic_thread *)args;
+	struct mdd_device *mdd = (struct mdd_device *)thread->mgt_data;
 	struct lu_env *env = NULL;
 	int rc;
 	ENTRY;
@@ -556,16 +616,28 @@ static int mdd_orphan_cleanup_thread(void *args)
 out:
 	if (env)
 		OBD_FREE_PTR(env);
+	if (atomic_dec_and_test(&mdd->mdd_orphan_running))
+		CDEBUG(D_HA, "%s: orphan cleanup done, %d destroyed, "
+		       "%d still open\n", mdd2obd_dev(mdd)->obd_name,
+		       atomic_read(&mdd->mdd_orphan_destroyed),
+		       atomic_read(&mdd->mdd_orphan_skipped));
 	complete(&thread->mgt_finished);
 	return rc;
 }
 
 /**
  *  Iterate orphan index to cleanup orphan objects after recovery is done.
+ *
+ *  The orphans are destroyed by mdd_device::mdd_orphan_threads threads in
+ *  the background, the MDT is usable meanwhile.
+ *
  *  \param d   mdd device in recovery.
  */
 int mdd_orphan_cleanup(const struct lu_env *env, struct mdd_device *d)
 {
+	unsigned int nr = clamp(d->mdd_orphan_threads, 1U,
+				(unsigned int)MDD_ORPHAN_THREADS_MAX);
+	unsigned int i;
 	int rc = -ENOMEM;
 	char *name = NULL;
 
@@ -573,10 +645,22 @@ int mdd_orphan_cleanup(const struct lu_env *env, struct mdd_device *d)
 	if (name == NULL)
 		goto out;
 
-	snprintf(name, MTI_NAME_MAXLEN, "orph_%s", mdd2obd_dev(d)->obd_name);
+	d->mdd_orphan_cleanup_nr = nr;
+	atomic_set(&d->mdd_orphan_running, nr);
+	for (i = 0; i < nr; i++) {
+		snprintf(name, MTI_NAME_MAXLEN, "orph%02u_%s", i,
+			 mdd2obd_dev(d)->obd_name);
+
+		rc = mdd_generic_thread_start(&d->mdd_orphan_cleanup_threads[i],
+					      mdd_orphan_cleanup_thread, d,
+					      name);
+		if (rc)
+			break;
+	}
 
-	rc = mdd_generic_thread_start(&d->mdd_orphan_cleanup_thread,
-				      mdd_orphan_cleanup_thread, d, name);
+	/* the orphans of the threads not started are left to next mount */
+	if (rc)
+		atomic_sub(nr - i, &d->mdd_orphan_running);
 out:
 	if (rc)
 		CERROR("%s: start orphan cleanup thread failed: rc = %d\n",
@@ -586,3 +670,18 @@ out:
 
 	return rc;
 }
+
+/**
+ *  Stop the orphan cleanup threads.
+ *  \param d   mdd device being cleaned up.
+ */
+void mdd_orphan_cleanup_stop(struct mdd_device *d)
+{
+	int i;
+
+	for (i = 0; i < MDD_ORPHAN_THREADS_MAX; i++)
+		d->mdd_orphan_cleanup_threads[i].mgt_abort = true;
+
+	for (i = 0; i < MDD_ORPHAN_THREADS_MAX; i++)
+		mdd_generic_thread_stop(&d->mdd_orphan_cleanup_threads[i]);
+}
@@ -143,6 +143,11 @@ struct hsm_scan_data {
 	 */
 	bool			 hsd_housekeeping;
 	bool			 hsd_one_restore;
+	/* location of the first waiting record seen, -1 if none */
+	u32			 hsd_waiting_cat_idx;
+	u32			 hsd_waiting_rec_idx;
+	/* plain llog of the last record seen */
+	u32			 hsd_last_cat_idx;
 	int			 hsd_action_count;
 	int			 hsd_request_len; /* array alloc len */
 	int			 hsd_request_count; /* array used count */
@@ -162,6 +167,11 @@ static int mdt_cdt_waiting_cb(const struct lu_env *env,
 	u32 archive_id;
 	int i;
 
+	if (hsd->hsd_waiting_cat_idx == -1) {
+		hsd->hsd_waiting_cat_idx = llh->lgh_hdr->llh_cat_idx;
+		hsd->hsd_waiting_rec_idx = larr->arr_hdr.lrh_index - 1;
+	}
+
 	/* Are agents full? */
 	if (atomic_read(&cdt->cdt_request_count) >= cdt->cdt_max_requests)
 		RETURN(hsd->hsd_housekeeping ? 0 : LLOG_PROC_BREAK);
@@ -421,6 +431,7 @@ static int mdt_coordinator_cb(const struct lu_env *env,
 
 	larr = (struct llog_agent_req_rec *)hdr;
 	dump_llog_agent_req_rec("mdt_coordinator_cb(): ", larr);
+	hsd->hsd_last_cat_idx = llh->lgh_hdr->llh_cat_idx;
 	switch (larr->arr_status) {
 	case ARS_WAITING:
 		RETURN(mdt_cdt_waiting_cb(env, mdt, llh, larr, hsd));
@@ -624,6 +635,9 @@ static int mdt_coordinator(void *data)
 		int updates_sz;
 		int updates_cnt;
 		struct hsm_record_update *updates;
+		u32 start_cat_idx;
+		u32 start_rec_idx;
+		u64 waiting_gen;
 
 		/* Limit execution of the expensive requests traversal
 		 * to at most one second. This prevents repeatedly
@@ -693,12 +707,37 @@ static int mdt_coordinator(void *data)
 		hsd.hsd_action_count = 0;
 		hsd.hsd_request_count = 0;
 		hsd.hsd_one_restore = false;
+		hsd.hsd_waiting_cat_idx = -1;
+		hsd.hsd_waiting_rec_idx = -1;
+		hsd.hsd_last_cat_idx = 0;
+
+		/* Housekeeping goes through the whole log. A scan for new
+		 * work only needs to start at the first waiting record, the
+		 * records before it can be many started or done ones. */
+		cdt_waiting_get(cdt, &start_cat_idx, &start_rec_idx,
+				&waiting_gen);
+		if (hsd.hsd_housekeeping) {
+			start_cat_idx = 0;
+			start_rec_idx = 0;
+		}
 
 		rc = cdt_llog_process(mti->mti_env, mdt, mdt_coordinator_cb,
-				      &hsd, 0, 0, WRITE);
+				      &hsd, start_cat_idx, start_rec_idx,
+				      WRITE);
 		if (rc < 0)
 			goto clean_cb_alloc;
 
+		/* Without a waiting record, the next ones are appended to
+		 * the last plain llog seen or to a later one. */
+		if (hsd.hsd_waiting_cat_idx != -1)
+			cdt_waiting_set(cdt, hsd.hsd_waiting_cat_idx,
+					hsd.hsd_waiting_rec_idx, waiting_gen);
+		else if (hsd.hsd_last_cat_idx != 0)
+			cdt_waiting_set(cdt, hsd.hsd_last_cat_idx, 0,
+					waiting_gen);
+		else if (hsd.hsd_housekeeping)
+			cdt_waiting_set(cdt, 0, 0, waiting_gen);
+
 		CDEBUG(D_HSM, "found %d requests to send\n",
 		       hsd.hsd_request_count);
 
@@ -1011,6 +1050,7 @@ int mdt_hsm_cdt_init(struct mdt_device *mdt)
 
 	init_waitqueue_head(&cdt->cdt_waitq);
 	init_rwsem(&cdt->cdt_llog_lock);
+	spin_lock_init(&cdt->cdt_waiting_lock);
 	init_rwsem(&cdt->cdt_agent_lock);
 	init_rwsem(&cdt->cdt_request_lock);
 	mutex_init(&cdt->cdt_restore_lock);
@@ -1147,6 +1187,7 @@ static int mdt_hsm_cdt_start(struct mdt_device *mdt)
 	/* just need to be larger than previous one */
 	/* cdt_last_cookie is protected by cdt_llog_lock */
 	cdt->cdt_last_cookie = ktime_get_real_seconds();
+	cdt_waiting_lower(cdt, 0, 0);
 	atomic_set(&cdt->cdt_request_count, 0);
 	atomic_set(&cdt->cdt_archive_count, 0);
 	atomic_set(&cdt->cdt_restore_count, 0);
@@ -1370,6 +1411,8 @@ static int hsm_swap_layouts(struct mdt_thread_info *mti,
 				     SWAP_LAYOUTS_MDS_HSM);
 	if (rc == 0) {
 		rc = mdt_lsom_downgrade(mti, obj);
+		if (rc > 0)
+			rc = 0;
 		if (rc)
 			CDEBUG(D_INODE,
 			       "%s: File fid="DFID" SOM "
@@ -693,30 +693,6 @@ map:
 }
 #endif
 
-/* XXX Look into layout in MDT layer. */
-static inline bool mdt_hsm_is_released(struct lov_mds_md *lmm)
-{
-	struct lov_comp_md_v1	*comp_v1;
-	struct lov_mds_md	*v1;
-	int			 i;
-
-	if (lmm->lmm_magic == LOV_MAGIC_COMP_V1) {
-		comp_v1 = (struct lov_comp_md_v1 *)lmm;
-
-		for (i = 0; i < comp_v1->lcm_entry_count; i++) {
-			v1 = (struct lov_mds_md *)((char *)comp_v1 +
-				comp_v1->lcm_entries[i].lcme_offset);
-			/* We don't support partial release for now */
-			if (!(v1->lmm_pattern & LOV_PATTERN_F_RELEASED))
-				return false;
-		}
-		return true;
-	} else {
-		return (lmm->lmm_pattern & LOV_PATTERN_F_RELEASED) ?
-			true : false;
-	}
-}
-
 void mdt_pack_attr2body(struct mdt_thread_info *info, struct mdt_body *b,
                         const struct lu_attr *attr, const struct lu_fid *fid)
 {
@@ -1092,6 +1068,86 @@ int mdt_attr_get_pfid(struct mdt_thread_info *info, struct mdt_object *o,
 	RETURN(0);
 }
 
+/**
+ * Look up the SOM, HSM attributes or parent FID of \a o in the copy kept
+ * from the last read of its xattrs.
+ *
+ * The copy is valid as long as the object is not modified, which the dt
+ * layers note in lu_object_header::loh_attr_gen.  Remote objects are
+ * modified on another MDT and are never looked up.
+ *
+ * \param[in] o	object
+ * \param[in] bit	MA_SOM, MA_HSM or MA_PFID
+ * \param[out] ma	the attribute is copied to ma_som, ma_hsm or ma_pfid
+ * \param[out] rc	0 if the object has the attribute, -ENODATA if not
+ *
+ * \retval true	if the attribute was in the copy
+ * \retval false	if it has to be read
+ */
+bool mdt_xattr_cache_get(struct mdt_object *o, __u64 bit, struct md_attr *ma,
+			 int *rc)
+{
+	unsigned int seq;
+	bool found;
+
+	if (mdt_object_remote(o))
+		return false;
+
+	do {
+		seq = read_seqbegin(&o->mot_xattr_lock);
+		found = o->mot_xattr_gen == mdt_object_attr_gen(o) &&
+			(o->mot_xattr_looked & bit);
+		if (!found)
+			continue;
+
+		*rc = o->mot_xattr_valid & bit ? 0 : -ENODATA;
+		if (bit == MA_SOM)
+			ma->ma_som = o->mot_som;
+		else if (bit == MA_HSM)
+			ma->ma_hsm = o->mot_hsm;
+		else
+			ma->ma_pfid = o->mot_pfid;
+	} while (read_seqretry(&o->mot_xattr_lock, seq));
+
+	return found;
+}
+
+/**
+ * Keep the SOM, HSM attributes or parent FID of \a o just read.
+ *
+ * \param[in] o	object
+ * \param[in] gen	generation of the object sampled before the read
+ * \param[in] bit	MA_SOM, MA_HSM or MA_PFID
+ * \param[in] ma	attributes read
+ * \param[in] rc	result of the read, only 0 and -ENODATA are kept
+ */
+void mdt_xattr_cache_set(struct mdt_object *o, int gen, __u64 bit,
+			 const struct md_attr *ma, int rc)
+{
+	if (mdt_object_remote(o) || (rc != 0 && rc != -ENODATA))
+		return;
+
+	write_seqlock(&o->mot_xattr_lock);
+	if (o->mot_xattr_gen != gen) {
+		o->mot_xattr_gen = gen;
+		o->mot_xattr_looked = 0;
+		o->mot_xattr_valid = 0;
+	}
+	o->mot_xattr_looked |= bit;
+	if (rc == 0) {
+		o->mot_xattr_valid |= bit;
+		if (bit == MA_SOM)
+			o->mot_som = ma->ma_som;
+		else if (bit == MA_HSM)
+			o->mot_hsm = ma->ma_hsm;
+		else
+			o->mot_pfid = ma->ma_pfid;
+	} else {
+		o->mot_xattr_valid &= ~bit;
+	}
+	write_sequnlock(&o->mot_xattr_lock);
+}
+
 int mdt_attr_get_complex(struct mdt_thread_info *info,
 			 struct mdt_object *o, struct md_attr *ma)
 {
@@ -1100,6 +1156,7 @@ int mdt_attr_get_complex(struct mdt_thread_info *info,
 	struct lu_buf       *buf = &info->mti_buf;
 	int                  need = ma->ma_need;
 	int                  rc = 0, rc2;
+	int                  gen;
 	u32                  mode;
 	ENTRY;
 
@@ -1108,6 +1165,7 @@ int mdt_attr_get_complex(struct mdt_thread_info *info,
 	if (mdt_object_exists(o) == 0)
 		GOTO(out, rc = -ENOENT);
 	mode = lu_object_attr(&next->mo_lu);
+	gen = mdt_object_attr_gen(o);
 
 	if (need & MA_INODE) {
 		ma->ma_need = MA_INODE;
@@ -1121,7 +1179,10 @@ int mdt_attr_get_complex(struct mdt_thread_info *info,
 	}
 
 	if (need & MA_PFID) {
-		rc = mdt_attr_get_pfid(info, o, &ma->ma_pfid);
+		if (!mdt_xattr_cache_get(o, MA_PFID, ma, &rc)) {
+			rc = mdt_attr_get_pfid(info, o, &ma->ma_pfid);
+			mdt_xattr_cache_set(o, gen, MA_PFID, ma, rc);
+		}
 		if (rc == 0)
 			ma->ma_valid |= MA_PFID;
 		/* ignore this error, parent fid is not mandatory */
@@ -1156,12 +1217,17 @@ int mdt_attr_get_complex(struct mdt_thread_info *info,
 	}
 
 	if (need & MA_HSM && S_ISREG(mode)) {
-		buf->lb_buf = info->mti_xattr_buf;
-		buf->lb_len = sizeof(info->mti_xattr_buf);
-		CLASSERT(sizeof(struct hsm_attrs) <=
-			 sizeof(info->mti_xattr_buf));
-		rc2 = mo_xattr_get(info->mti_env, next, buf, XATTR_NAME_HSM);
-		rc2 = lustre_buf2hsm(info->mti_xattr_buf, rc2, &ma->ma_hsm);
+		if (!mdt_xattr_cache_get(o, MA_HSM, ma, &rc2)) {
+			buf->lb_buf = info->mti_xattr_buf;
+			buf->lb_len = sizeof(info->mti_xattr_buf);
+			CLASSERT(sizeof(struct hsm_attrs) <=
+				 sizeof(info->mti_xattr_buf));
+			rc2 = mo_xattr_get(info->mti_env, next, buf,
+					   XATTR_NAME_HSM);
+			rc2 = lustre_buf2hsm(info->mti_xattr_buf, rc2,
+					     &ma->ma_hsm);
+			mdt_xattr_cache_set(o, gen, MA_HSM, ma, rc2);
+		}
 		if (rc2 == 0)
 			ma->ma_valid |= MA_HSM;
 		else if (rc2 < 0 && rc2 != -ENODATA)
@@ -3008,7 +3074,11 @@ int mdt_blocking_ast(struct ldlm_lock *lock, struct ldlm_lock_desc *desc,
 
 	if (lock->l_req_mode & (LCK_PW | LCK_EX)) {
 		if (mdt_cos_is_enabled(mdt)) {
-			if (!arg->bl_desc->bl_same_client)
+			/* with COS dependency tracking only a lock taken for
+			 * a request that can be replayed makes us commit */
+			if (!arg->bl_desc->bl_same_client &&
+			    (!mdt->mdt_opts.mo_cos_dep ||
+			     arg->bl_desc->bl_cos_enabled))
 				mdt_set_lock_sync(lock);
 		} else if (mdt_slc_is_enabled(mdt) &&
 			   arg->bl_desc->bl_cos_incompat) {
@@ -3238,7 +3308,13 @@ int mdt_object_local_lock(struct mdt_thread_info *info, struct mdt_object *o,
 		LASSERT(lh->mlh_reg_mode == LCK_PW ||
 			lh->mlh_reg_mode == LCK_EX);
 		dlmflags |= LDLM_FL_COS_INCOMPAT;
-	} else if (mdt_cos_is_enabled(info->mti_mdt)) {
+	} else if (mdt_cos_is_enabled(info->mti_mdt) &&
+		   !(info->mti_mdt->mdt_opts.mo_cos_dep &&
+		     info->mti_cos_readonly)) {
+		/* a request that leaves nothing to replay on the client can
+		 * not depend on an uncommitted transaction of another one,
+		 * so it gets the lock like a local one does, see
+		 * ldlm_inodebits_compat_queue() */
 		dlmflags |= LDLM_FL_COS_ENABLED;
 	}
 
@@ -3729,6 +3805,7 @@ void mdt_thread_info_init(struct ptlrpc_request *req,
 	info->mti_big_lmm_used = 0;
 	info->mti_big_acl_used = 0;
 	info->mti_som_valid = 0;
+	info->mti_cos_readonly = 0;
 
         info->mti_spec.no_create = 0;
 	info->mti_spec.sp_rm_entry = 0;
@@ -4315,9 +4392,11 @@ static int mdt_intent_opc(enum ldlm_intent_flags it_opc,
 		it_format = &RQF_LDLM_INTENT_GETATTR;
 		it_handler = &mdt_intent_getattr;
 		it_handler_flags = HABEO_REFERO;
+		info->mti_cos_readonly = 1;
 		break;
 	case IT_GETXATTR:
 		check_mdt_object = true;
+		info->mti_cos_readonly = 1;
 		it_format = &RQF_LDLM_INTENT_GETXATTR;
 		it_handler = &mdt_intent_getxattr;
 		it_handler_flags = HABEO_CORPUS;
@@ -5178,6 +5257,7 @@ TGT_MDT_HDL(HABEO_CLAVIS | HABEO_CORPUS | HABEO_REFERO | MUTABOR,
 	    MDS_SWAP_LAYOUTS,
 	    mdt_swap_layouts),
 TGT_MDT_HDL(0,		MDS_RMFID,	mdt_rmfid),
+TGT_MDT_HDL(0,		MDS_BATCH,	tgt_batch),
 };
 
 static struct tgt_handler mdt_io_ops[] = {
@@ -5718,6 +5798,7 @@ static struct lu_object *mdt_object_alloc(const struct lu_env *env,
 		init_rwsem(&mo->mot_dom_sem);
 		init_rwsem(&mo->mot_open_sem);
 		atomic_set(&mo->mot_open_count, 0);
+		seqlock_init(&mo->mot_xattr_lock);
 		RETURN(o);
 	}
 	RETURN(NULL);
@@ -7004,15 +7085,21 @@ struct lu_ucred *mdt_ucred_check(const struct mdt_thread_info *info)
  *
  * Set/Clear the COS flag in mdt options.
  *
+ * With MDT_COS_DEPENDENCY only the requests which can be replayed wait for
+ * the commit of the uncommitted changes of another client that they share.
+ * Lookups and getattrs do not, since a replay can not depend on them.
+ *
  * \param mdt mdt device
- * \param val 0 disables COS, other values enable COS
+ * \param val 0 disables COS, MDT_COS_DEPENDENCY enables COS with dependency
+ *	      tracking, other values enable COS
  */
-void mdt_enable_cos(struct mdt_device *mdt, bool val)
+void mdt_enable_cos(struct mdt_device *mdt, int val)
 {
         struct lu_env env;
         int rc;
 
-	mdt->mdt_opts.mo_cos = val;
+	mdt->mdt_opts.mo_cos = val != 0;
+	mdt->mdt_opts.mo_cos_dep = val == MDT_COS_DEPENDENCY;
         rc = lu_env_init(&env, LCT_LOCAL);
 	if (unlikely(rc != 0)) {
 		CWARN("%s: lu_env initialization failed, cannot "
@@ -166,6 +166,58 @@ void cdt_agent_record_hash_del(struct coordinator *cdt, u64 cookie)
 	cfs_hash_del_key(cdt->cdt_agent_record_hash, &cookie);
 }
 
+/**
+ * Get the location in the agent request log to look for waiting records
+ * from, as start indexes of cdt_llog_process(), and the generation of it
+ * to pass to cdt_waiting_set().
+ */
+void cdt_waiting_get(struct coordinator *cdt, u32 *cat_idx, u32 *rec_idx,
+		     u64 *gen)
+{
+	spin_lock(&cdt->cdt_waiting_lock);
+	*cat_idx = cdt->cdt_waiting_cat_idx;
+	*rec_idx = cdt->cdt_waiting_rec_idx;
+	*gen = cdt->cdt_waiting_gen;
+	spin_unlock(&cdt->cdt_waiting_lock);
+}
+
+/**
+ * Set the location to look for waiting records from, found by a scan
+ * started when the location was of generation \a gen. The location is
+ * kept if a record was made waiting again since.
+ */
+void cdt_waiting_set(struct coordinator *cdt, u32 cat_idx, u32 rec_idx,
+		     u64 gen)
+{
+	spin_lock(&cdt->cdt_waiting_lock);
+	if (cdt->cdt_waiting_gen == gen) {
+		cdt->cdt_waiting_cat_idx = cat_idx;
+		cdt->cdt_waiting_rec_idx = rec_idx;
+	}
+	spin_unlock(&cdt->cdt_waiting_lock);
+}
+
+/**
+ * Make sure the scans for new work see the record at \a rec_idx of the
+ * plain llog at \a cat_idx in the catalog, which was made waiting again.
+ */
+void cdt_waiting_lower(struct coordinator *cdt, u32 cat_idx, u32 rec_idx)
+{
+	/* start indexes of cdt_llog_process() to process that record */
+	if (rec_idx != 0)
+		rec_idx -= 1;
+
+	spin_lock(&cdt->cdt_waiting_lock);
+	if (cat_idx < cdt->cdt_waiting_cat_idx ||
+	    (cat_idx == cdt->cdt_waiting_cat_idx &&
+	     rec_idx < cdt->cdt_waiting_rec_idx)) {
+		cdt->cdt_waiting_cat_idx = cat_idx;
+		cdt->cdt_waiting_rec_idx = rec_idx;
+	}
+	cdt->cdt_waiting_gen++;
+	spin_unlock(&cdt->cdt_waiting_lock);
+}
+
 void dump_llog_agent_req_rec(const char *prefix,
 			     const struct llog_agent_req_rec *larr)
 {
@@ -374,6 +426,10 @@ static int mdt_agent_record_update_cb(const struct lu_env *env,
 			larr->arr_req_change = ducb->change_time;
 			rc = llog_write(env, llh, hdr, hdr->lrh_index);
 			ducb->updates_done++;
+			if (update->status == ARS_WAITING)
+				cdt_waiting_lower(&ducb->mdt->mdt_coordinator,
+						  llh->lgh_hdr->llh_cat_idx,
+						  hdr->lrh_index);
 			break;
 		}
 	}
@@ -63,58 +63,80 @@ static void mdt_identity_entry_free(struct upcall_cache *cache,
 	}
 }
 
-static int mdt_identity_do_upcall(struct upcall_cache *cache,
-                                  struct upcall_cache_entry *entry)
+/*
+ * Run the identity upcall for the users of all the \a entries at once, it
+ * writes their identities back to identity_info in one go.
+ */
+static int mdt_identity_do_upcall_batch(struct upcall_cache *cache,
+					struct upcall_cache_entry **entries,
+					int nr)
 {
-        char keystr[16];
-        char *argv[] = {
-                  [0] = cache->uc_upcall,
-                  [1] = cache->uc_name,
-                  [2] = keystr,
-                  [3] = NULL
-        };
-        char *envp[] = {
-                  [0] = "HOME=/",
-                  [1] = "PATH=/sbin:/usr/sbin",
-                  [2] = NULL
-        };
+	char *envp[] = {
+		  [0] = "HOME=/",
+		  [1] = "PATH=/sbin:/usr/sbin",
+		  [2] = NULL
+	};
+	char **argv;
+	char *keystr;
 	ktime_t start, end;
-        int rc;
-        ENTRY;
+	int keylen = 16;
+	int rc;
+	int i;
+	ENTRY;
+
+	OBD_ALLOC(argv, (nr + 3) * sizeof(*argv));
+	OBD_ALLOC(keystr, nr * keylen);
+	if (argv == NULL || keystr == NULL)
+		GOTO(out_free, rc = -ENOMEM);
 
-        /* There is race condition:
-         * "uc_upcall" was changed just after "is_identity_get_disabled" check.
-         */
+	/* There is race condition:
+	 * "uc_upcall" was changed just after "is_identity_get_disabled" check.
+	 */
 	down_read(&cache->uc_upcall_rwsem);
-        CDEBUG(D_INFO, "The upcall is: '%s'\n", cache->uc_upcall);
+	CDEBUG(D_INFO, "The upcall is: '%s'\n", cache->uc_upcall);
 
-        if (unlikely(!strcmp(cache->uc_upcall, "NONE"))) {
-                CERROR("no upcall set\n");
-                GOTO(out, rc = -EREMCHG);
-        }
+	if (unlikely(!strcmp(cache->uc_upcall, "NONE"))) {
+		CERROR("no upcall set\n");
+		GOTO(out, rc = -EREMCHG);
+	}
 
 	argv[0] = cache->uc_upcall;
-	snprintf(keystr, sizeof(keystr), "%llu", entry->ue_key);
+	argv[1] = cache->uc_name;
+	for (i = 0; i < nr; i++) {
+		argv[i + 2] = keystr + i * keylen;
+		snprintf(argv[i + 2], keylen, "%llu", entries[i]->ue_key);
+	}
 
 	start = ktime_get();
 	rc = call_usermodehelper(argv[0], argv, envp, UMH_WAIT_EXEC);
 	end = ktime_get();
 	if (rc < 0) {
-		CERROR("%s: error invoking upcall %s %s %s: rc %d; check /proc/fs/lustre/mdt/%s/identity_upcall, time %ldus\n",
-		       cache->uc_name, argv[0], argv[1], argv[2], rc,
+		CERROR("%s: error invoking upcall %s %s %s (%d users): rc %d; check /proc/fs/lustre/mdt/%s/identity_upcall, time %ldus\n",
+		       cache->uc_name, argv[0], argv[1], argv[2], nr, rc,
 		       cache->uc_name, (long)ktime_us_delta(end, start));
 	} else {
-		CDEBUG(D_HA, "%s: invoked upcall %s %s %s, time %ldus\n",
-		       cache->uc_name, argv[0], argv[1], argv[2],
+		CDEBUG(D_HA, "%s: invoked upcall %s %s %s (%d users), time %ldus\n",
+		       cache->uc_name, argv[0], argv[1], argv[2], nr,
 		       (long)ktime_us_delta(end, start));
 		rc = 0;
 	}
 	EXIT;
 out:
 	up_read(&cache->uc_upcall_rwsem);
+out_free:
+	if (keystr != NULL)
+		OBD_FREE(keystr, nr * keylen);
+	if (argv != NULL)
+		OBD_FREE(argv, (nr + 3) * sizeof(*argv));
 	return rc;
 }
 
+static int mdt_identity_do_upcall(struct upcall_cache *cache,
+				  struct upcall_cache_entry *entry)
+{
+	return mdt_identity_do_upcall_batch(cache, &entry, 1);
+}
+
 static int mdt_identity_parse_downcall(struct upcall_cache *cache,
 				       struct upcall_cache_entry *entry,
 				       void *args)
@@ -200,6 +222,7 @@ struct upcall_cache_ops mdt_identity_upcall_cache_ops = {
         .init_entry     = mdt_identity_entry_init,
         .free_entry     = mdt_identity_entry_free,
         .do_upcall      = mdt_identity_do_upcall,
+        .do_upcall_batch = mdt_identity_do_upcall_batch,
         .parse_downcall = mdt_identity_parse_downcall,
 };
 
@@ -173,6 +173,14 @@ struct coordinator {
 	 * request log. */
 	struct cfs_hash		*cdt_agent_record_hash;
 
+	/* Where the scans for new work start in the agent request log: no
+	 * record before it is waiting. Bumping cdt_waiting_gen tells the
+	 * coordinator that the location it is computing may be too late. */
+	spinlock_t		 cdt_waiting_lock;
+	u32			 cdt_waiting_cat_idx;
+	u32			 cdt_waiting_rec_idx;
+	u64			 cdt_waiting_gen;
+
 	/* Bitmasks indexed by the HSMA_XXX constants. */
 	__u64			 cdt_user_request_mask;
 	__u64			 cdt_group_request_mask;
@@ -224,6 +232,7 @@ struct mdt_device {
 		unsigned int       mo_user_xattr:1,
 				   mo_acl:1,
 				   mo_cos:1,
+				   mo_cos_dep:1,
 				   mo_evict_tgt_nids:1,
 				   mo_dom_read_open:1,
 				   mo_migrate_hsm_allowed:1;
@@ -293,6 +302,8 @@ struct mdt_device {
 
 #define MDT_SERVICE_WATCHDOG_FACTOR	(2)
 #define MDT_COS_DEFAULT         (0)
+/* commit_on_sharing value to delay only the requests that can be replayed */
+#define MDT_COS_DEPENDENCY	(2)
 
 #define ENOENT_VERSION 1	/** 'virtual' version of non-existent object */
 
@@ -315,6 +326,17 @@ struct mdt_object {
 	struct rw_semaphore	mot_open_sem;
 	atomic_t		mot_lease_count;
 	atomic_t		mot_open_count;
+	/* SOM, HSM attributes and parent FID of a local object as read from
+	 * its xattrs, valid while mot_xattr_gen is the loh_attr_gen of the
+	 * object, see mdt_xattr_cache_get() */
+	seqlock_t		mot_xattr_lock;
+	int			mot_xattr_gen;
+	/* MA_* flags of the attributes looked up and of those found */
+	__u64			mot_xattr_looked;
+	__u64			mot_xattr_valid;
+	struct md_som		mot_som;
+	struct md_hsm		mot_hsm;
+	struct lu_fid		mot_pfid;
 };
 
 struct mdt_lock_handle {
@@ -436,7 +458,9 @@ struct mdt_thread_info {
 	/* big_lmm buffer was used and must be used in reply */
 				   mti_big_lmm_used:1,
 				   mti_big_acl_used:1,
-				   mti_som_valid:1;
+				   mti_som_valid:1,
+	/* request changes nothing a replay of another request can depend on */
+				   mti_cos_readonly:1;
 
         /* opdata for mdt_reint_open(), has the same as
          * ldlm_reply:lock_policy_res1.  mdt_update_last_rcvd() stores this
@@ -627,6 +651,11 @@ static inline int mdt_object_remote(const struct mdt_object *o)
 	return lu_object_remote(&o->mot_obj);
 }
 
+static inline int mdt_object_attr_gen(struct mdt_object *o)
+{
+	return atomic_read(&o->mot_header.loh_attr_gen);
+}
+
 static inline const struct lu_fid *mdt_object_fid(const struct mdt_object *o)
 {
 	return lu_object_fid(&o->mot_obj);
@@ -665,6 +694,30 @@ enum {
 	LMM_DOM_OST
 };
 
+/* XXX Look into layout in MDT layer. */
+static inline bool mdt_hsm_is_released(struct lov_mds_md *lmm)
+{
+	struct lov_comp_md_v1	*comp_v1;
+	struct lov_mds_md	*v1;
+	int			 i;
+
+	if (lmm->lmm_magic == LOV_MAGIC_COMP_V1) {
+		comp_v1 = (struct lov_comp_md_v1 *)lmm;
+
+		for (i = 0; i < comp_v1->lcm_entry_count; i++) {
+			v1 = (struct lov_mds_md *)((char *)comp_v1 +
+				comp_v1->lcm_entries[i].lcme_offset);
+			/* We don't support partial release for now */
+			if (!(v1->lmm_pattern & LOV_PATTERN_F_RELEASED))
+				return false;
+		}
+		return true;
+	} else {
+		return (lmm->lmm_pattern & LOV_PATTERN_F_RELEASED) ?
+			true : false;
+	}
+}
+
 /* XXX Look into layout in MDT layer. This must be done in LOD. */
 static inline int mdt_lmm_dom_entry(struct lov_mds_md *lmm)
 {
@@ -847,6 +900,10 @@ int mdt_stripe_get(struct mdt_thread_info *info, struct mdt_object *o,
 		   struct md_attr *ma, const char *name);
 int mdt_attr_get_pfid(struct mdt_thread_info *info, struct mdt_object *o,
 		      struct lu_fid *pfid);
+bool mdt_xattr_cache_get(struct mdt_object *o, __u64 bit, struct md_attr *ma,
+			 int *rc);
+void mdt_xattr_cache_set(struct mdt_object *o, int gen, __u64 bit,
+			 const struct md_attr *ma, int rc);
 int mdt_write_get(struct mdt_object *o);
 void mdt_write_put(struct mdt_object *o);
 int mdt_write_read(struct mdt_object *o);
@@ -978,6 +1035,11 @@ void cdt_agent_record_hash_add(struct coordinator *cdt, u64 cookie, u32 cat_idt,
 void cdt_agent_record_hash_lookup(struct coordinator *cdt, u64 cookie,
 				  u32 *cat_idt, u32 *rec_idx);
 void cdt_agent_record_hash_del(struct coordinator *cdt, u64 cookie);
+void cdt_waiting_get(struct coordinator *cdt, u32 *cat_idx, u32 *rec_idx,
+		     u64 *gen);
+void cdt_waiting_set(struct coordinator *cdt, u32 cat_idx, u32 rec_idx,
+		     u64 gen);
+void cdt_waiting_lower(struct coordinator *cdt, u32 cat_idx, u32 rec_idx);
 
 /* mdt/mdt_hsm_cdt_agent.c */
 extern const struct file_operations mdt_hsm_agent_fops;
@@ -1204,6 +1266,8 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 int mdt_get_som(struct mdt_thread_info *info, struct mdt_object *obj,
 		struct md_attr *ma);
 int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *obj);
+int mdt_som_strict_close(struct mdt_thread_info *info, struct mdt_object *o);
+int mdt_som_strict_break(struct mdt_thread_info *info, struct mdt_object *o);
 int mdt_lsom_update(struct mdt_thread_info *info, struct mdt_object *obj,
 		    bool truncate);
 
@@ -1213,7 +1277,7 @@ int mdt_dom_lvb_is_valid(struct ldlm_resource *res);
 int mdt_dom_lvbo_update(struct ldlm_resource *res, struct ldlm_lock *lock,
 			struct ptlrpc_request *req, bool increase_only);
 
-void mdt_enable_cos(struct mdt_device *dev, bool enable);
+void mdt_enable_cos(struct mdt_device *dev, int val);
 int mdt_cos_is_enabled(struct mdt_device *);
 
 /* lprocfs stuff */
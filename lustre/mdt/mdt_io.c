@@ -1478,7 +1478,9 @@ int mdt_dom_read_on_open(struct mdt_thread_info *mti, struct mdt_device *mdt,
 	 *
 	 * At the moment the following strategy is used:
 	 * 1) try to fit into the buffer we have
-	 * 2) return just file tail otherwise.
+	 * 2) return as much of the file head as fits for an open for read,
+	 *    if the client can take it
+	 * 3) return just file tail otherwise.
 	 */
 	if (mbo->mbo_dom_size <= len) {
 		/* can fit whole data */
@@ -1502,6 +1504,17 @@ int mdt_dom_read_on_open(struct mdt_thread_info *mti, struct mdt_device *mdt,
 		}
 		pgbits = max_t(int, PAGE_SHIFT,
 			       req->rq_export->exp_target_data.ted_pagebits);
+
+		/* a reader likely starts at the file head, the pages it
+		 * gets here save the first read RPC */
+		if (exp_connect_dom_read_head(req->rq_export) &&
+		    !(mti->mti_spec.sp_cr_flags & MDS_FMODE_WRITE) &&
+		    len >= (1 << pgbits)) {
+			len = round_down(len, 1 << pgbits);
+			offset = 0;
+			goto grow;
+		}
+
 		tail = mbo->mbo_dom_size % (1 << pgbits);
 
 		/* no partial tail or tail can't fit in reply */
@@ -1511,6 +1524,7 @@ int mdt_dom_read_on_open(struct mdt_thread_info *mti, struct mdt_device *mdt,
 		len = tail;
 		offset = mbo->mbo_dom_size - len;
 	}
+grow:
 	LASSERT((offset % PAGE_SIZE) == 0);
 	rc = req_capsule_server_grow(pill, &RMF_NIOBUF_INLINE,
 				     sizeof(*rnb) + len);
@@ -1121,7 +1121,8 @@ static int mdt_setattr_unpack_rec(struct mdt_thread_info *info)
 	ma->ma_valid = MA_INODE;
 
 	ma->ma_attr_flags |= rec->sa_bias & (MDS_CLOSE_INTENT |
-				MDS_DATA_MODIFIED | MDS_TRUNC_KEEP_LEASE);
+				MDS_DATA_MODIFIED | MDS_TRUNC_KEEP_LEASE |
+				MDS_CLOSE_STRICT_SOM | MDS_PCC_ATTACH);
 	RETURN(0);
 }
 
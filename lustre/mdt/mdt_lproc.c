@@ -269,6 +269,73 @@ mdt_identity_acquire_expire_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(mdt_identity_acquire_expire);
 
+static int mdt_identity_negative_expire_seq_show(struct seq_file *m,
+						 void *data)
+{
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	seq_printf(m, "%lld\n", mdt->mdt_identity_cache->uc_negative_expire);
+	return 0;
+}
+
+static ssize_t
+mdt_identity_negative_expire_seq_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *off)
+{
+	struct seq_file	  *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	time64_t val;
+	int rc;
+
+	rc = kstrtoll_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > INT_MAX)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_negative_expire = val;
+
+	return count;
+}
+LPROC_SEQ_FOPS(mdt_identity_negative_expire);
+
+static int mdt_identity_upcall_batch_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	seq_printf(m, "%d\n", mdt->mdt_identity_cache->uc_upcall_batch);
+	return 0;
+}
+
+static ssize_t
+mdt_identity_upcall_batch_seq_write(struct file *file,
+				    const char __user *buffer,
+				    size_t count, loff_t *off)
+{
+	struct seq_file	  *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	int val;
+	int rc;
+
+	rc = kstrtoint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > UC_CACHE_UPCALL_BATCH)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_upcall_batch = val;
+
+	return count;
+}
+LPROC_SEQ_FOPS(mdt_identity_upcall_batch);
+
 static int mdt_identity_upcall_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
@@ -346,13 +413,15 @@ lprocfs_identity_flush_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS_WR_ONLY(mdt, identity_flush);
 
-static ssize_t
-lprocfs_identity_info_seq_write(struct file *file, const char __user *buffer,
-				size_t count, void *data)
+/*
+ * Pass the identity_downcall_data record at \a buffer to the identity cache.
+ * Returns the size of the record, or a negative error if it is malformed.
+ * The result of the downcall itself is returned in \a result.
+ */
+static int mdt_identity_info_one(struct mdt_device *mdt,
+				 const char __user *buffer, size_t count,
+				 int *result)
 {
-	struct seq_file	  *m = file->private_data;
-	struct obd_device *obd = m->private;
-	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
 	struct identity_downcall_data *param;
 	int size = sizeof(*param), rc, checked = 0;
 
@@ -403,14 +472,54 @@ again:
 		}
 	}
 
-	rc = upcall_cache_downcall(mdt->mdt_identity_cache, param->idd_err,
-				   param->idd_uid, param);
-
+	*result = upcall_cache_downcall(mdt->mdt_identity_cache,
+					param->idd_err, param->idd_uid, param);
+	rc = size;
 out:
-	if (param != NULL)
-		OBD_FREE(param, size);
+	OBD_FREE(param, size);
+	return rc;
+}
+
+/*
+ * The identity upcall may write the identities of several users at once,
+ * as consecutive identity_downcall_data records.
+ */
+static ssize_t
+lprocfs_identity_info_seq_write(struct file *file, const char __user *buffer,
+				size_t count, void *data)
+{
+	struct seq_file	  *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	size_t done = 0;
+	int result = 0;
+	int rc;
+
+	while (done < count) {
+		int rc2 = 0;
+
+		/* older upcalls pad their only record, ignore the padding */
+		if (done > 0) {
+			__u32 magic;
+
+			if (count - done < sizeof(magic) ||
+			    copy_from_user(&magic, buffer + done,
+					   sizeof(magic)) ||
+			    magic != IDENTITY_DOWNCALL_MAGIC)
+				break;
+		}
+
+		rc = mdt_identity_info_one(mdt, buffer + done, count - done,
+					   &rc2);
+		if (rc < 0)
+			return rc;
+
+		done += rc;
+		if (rc2 != 0 && result == 0)
+			result = rc2;
+	}
 
-	return rc ? rc : count;
+	return result ? result : count;
 }
 LPROC_SEQ_FOPS_WR_ONLY(mdt, identity_info);
 
@@ -512,7 +621,10 @@ static int mdt_cos_seq_show(struct seq_file *m, void *data)
 	struct obd_device *obd = m->private;
 	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
 
-	seq_printf(m, "%u\n", mdt_cos_is_enabled(mdt));
+	if (mdt->mdt_opts.mo_cos_dep)
+		seq_printf(m, "%u\n", MDT_COS_DEPENDENCY);
+	else
+		seq_printf(m, "%u\n", mdt_cos_is_enabled(mdt));
 	return 0;
 }
 
@@ -523,12 +635,21 @@ mdt_cos_seq_write(struct file *file, const char __user *buffer,
 	struct seq_file   *m = file->private_data;
 	struct obd_device *obd = m->private;
 	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
-	bool val;
+	unsigned int val;
 	int rc;
 
-	rc = kstrtobool_from_user(buffer, count, &val);
-	if (rc)
-		return rc;
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc) {
+		bool enable;
+
+		rc = kstrtobool_from_user(buffer, count, &enable);
+		if (rc)
+			return rc;
+		val = enable;
+	}
+
+	if (val > MDT_COS_DEPENDENCY)
+		return -ERANGE;
 
 	mdt_enable_cos(mdt, val);
 	return count;
@@ -1049,6 +1170,8 @@ LPROC_SEQ_FOPS_RO_TYPE(mdt, hash);
 LPROC_SEQ_FOPS_WR_ONLY(mdt, mds_evict_client);
 LPROC_SEQ_FOPS_RW_TYPE(mdt, job_interval);
 LPROC_SEQ_FOPS_RW_TYPE(mdt, ir_factor);
+LPROC_SEQ_FOPS_RW_TYPE(mdt, conn_limit);
+LPROC_SEQ_FOPS_RW_TYPE(mdt, conn_window);
 LPROC_SEQ_FOPS_RW_TYPE(mdt, nid_stats_clear);
 LPROC_SEQ_FOPS(mdt_hsm_cdt_control);
 
@@ -1077,6 +1200,10 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
 	  .fops =	&mdt_identity_expire_fops		},
 	{ .name =	"identity_acquire_expire",
 	  .fops =	&mdt_identity_acquire_expire_fops	},
+	{ .name =	"identity_negative_expire",
+	  .fops =	&mdt_identity_negative_expire_fops	},
+	{ .name =	"identity_upcall_batch",
+	  .fops =	&mdt_identity_upcall_batch_fops		},
 	{ .name =	"identity_upcall",
 	  .fops =	&mdt_identity_upcall_fops		},
 	{ .name =	"identity_flush",
@@ -1101,6 +1228,10 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
 	  .fops =	&mdt_target_instance_fops		},
 	{ .name =	"ir_factor",
 	  .fops =	&mdt_ir_factor_fops			},
+	{ .name =	"connect_limit",
+	  .fops =	&mdt_conn_limit_fops			},
+	{ .name =	"connect_window",
+	  .fops =	&mdt_conn_window_fops			},
 	{ .name =	"job_cleanup_interval",
 	  .fops =	&mdt_job_interval_fops			},
 	{ .name =	"enable_remote_dir",
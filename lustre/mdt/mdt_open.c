@@ -393,6 +393,19 @@ static int mdt_mfd_open(struct mdt_thread_info *info, struct mdt_object *p,
 	if (rc)
 		RETURN(rc);
 
+	/* a released file only gets writers once restored */
+	if (isreg && open_flags & MDS_FMODE_WRITE &&
+	    !(ma->ma_valid & MA_LOV && mdt_hsm_is_released(ma->ma_lmm))) {
+		rc = mdt_som_strict_break(info, o);
+		if (rc < 0)
+			GOTO(err_out, rc);
+		/* the reply is packed, without the strict size now */
+		if (rc > 0 && ma->ma_valid & MA_LOV)
+			repbody->mbo_valid &= ~(OBD_MD_FLSIZE |
+						OBD_MD_FLBLOCKS);
+		rc = 0;
+	}
+
 	rc = mo_open(info->mti_env, mdt_object_child(o),
 		     created ? open_flags | MDS_OPEN_CREATED : open_flags);
 	if (rc != 0) {
@@ -1818,6 +1831,31 @@ static int mdt_hsm_release(struct mdt_thread_info *info, struct mdt_object *o,
 	if (rc != 0)
 		GOTO(out_unlock, rc);
 
+	if (ma->ma_attr_flags & MDS_PCC_ATTACH) {
+		/* The copy in the cache of the client becomes the archive of
+		 * the file, of the data version the client packed under the
+		 * lease.
+		 */
+		if (data->cd_archive_id == 0)
+			GOTO(out_unlock, rc = -EINVAL);
+
+		if (!(ma->ma_valid & MA_HSM)) {
+			memset(&ma->ma_hsm, 0, sizeof(ma->ma_hsm));
+			ma->ma_valid |= MA_HSM;
+		}
+
+		if (ma->ma_hsm.mh_flags & (HS_NORELEASE | HS_LOST))
+			GOTO(out_unlock, rc = -EPERM);
+
+		if (ma->ma_hsm.mh_flags & HS_RELEASED)
+			GOTO(out_unlock, rc = -EALREADY);
+
+		ma->ma_hsm.mh_flags &= ~HS_DIRTY;
+		ma->ma_hsm.mh_flags |= HS_EXISTS | HS_ARCHIVED;
+		ma->ma_hsm.mh_arch_id = data->cd_archive_id;
+		ma->ma_hsm.mh_arch_ver = data->cd_data_version;
+	}
+
 	if (!mdt_hsm_release_allow(ma))
 		GOTO(out_unlock, rc = -EPERM);
 
@@ -2264,11 +2302,13 @@ int mdt_mfd_close(struct mdt_thread_info *info, struct mdt_file_data *mfd)
 	int rc = 0;
 	u64 open_flags;
 	u64 intent;
+	bool lsom;
 
 	ENTRY;
 
 	open_flags = mfd->mfd_open_flags;
 	intent = ma->ma_attr_flags & MDS_CLOSE_INTENT;
+	lsom = ma->ma_attr.la_valid & (LA_LSIZE | LA_LBLOCKS);
 	*ofid = *mdt_object_fid(o);
 
 	CDEBUG(D_INODE, "%s: close file "DFID" with intent: %llx\n",
@@ -2307,7 +2347,24 @@ int mdt_mfd_close(struct mdt_thread_info *info, struct mdt_file_data *mfd)
 	}
 
 	if (S_ISREG(lu_object_attr(&o->mot_obj)) &&
-	    ma->ma_attr.la_valid & (LA_LSIZE | LA_LBLOCKS)) {
+	    open_flags & MDS_FMODE_WRITE &&
+	    ma->ma_attr_flags & MDS_CLOSE_STRICT_SOM &&
+	    ma->ma_attr.la_valid & LA_SIZE &&
+	    ma->ma_attr.la_valid & LA_BLOCKS) {
+		int rc2;
+
+		rc2 = mdt_som_strict_close(info, o);
+		if (rc2 < 0)
+			CDEBUG(D_INODE,
+			       "%s: File " DFID " strict SOM failed: rc = %d\n",
+			       mdt_obd_name(info->mti_mdt),
+			       PFID(ofid), rc2);
+		/* other writers have the file open, LSOM is updated */
+		if (rc2 == 0)
+			lsom = true;
+	}
+
+	if (S_ISREG(lu_object_attr(&o->mot_obj)) && lsom) {
 		int rc2;
 
 		rc2 = mdt_lsom_update(info, o, false);
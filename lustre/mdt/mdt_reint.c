@@ -1225,7 +1225,7 @@ static int mdt_pdir_hash_lock(struct mdt_thread_info *info,
  * Get BFL lock for rename or migrate process.
  **/
 static int mdt_rename_lock(struct mdt_thread_info *info,
-			   struct lustre_handle *lh)
+			   struct lustre_handle *lh, enum ldlm_mode mode)
 {
 	int	rc;
 	ENTRY;
@@ -1243,8 +1243,7 @@ static int mdt_rename_lock(struct mdt_thread_info *info,
 			RETURN(PTR_ERR(obj));
 
 		rc = mdt_remote_object_lock(info, obj,
-					    &LUSTRE_BFL_FID, lh,
-					    LCK_EX,
+					    &LUSTRE_BFL_FID, lh, mode,
 					    MDS_INODELOCK_UPDATE, false);
 		mdt_object_put(info->mti_env, obj);
 	} else {
@@ -1258,7 +1257,7 @@ static int mdt_rename_lock(struct mdt_thread_info *info,
 		policy->l_inodebits.bits = MDS_INODELOCK_UPDATE;
 		flags = LDLM_FL_LOCAL_ONLY | LDLM_FL_ATOMIC_CB;
 		rc = ldlm_cli_enqueue_local(info->mti_env, ns, res_id,
-					    LDLM_IBITS, policy, LCK_EX, &flags,
+					    LDLM_IBITS, policy, mode, &flags,
 					    ldlm_blocking_ast,
 					    ldlm_completion_ast, NULL, NULL, 0,
 					    LVB_T_NONE,
@@ -1269,12 +1268,13 @@ static int mdt_rename_lock(struct mdt_thread_info *info,
 	RETURN(rc);
 }
 
-static void mdt_rename_unlock(struct lustre_handle *lh)
+static void mdt_rename_unlock(struct lustre_handle *lh, enum ldlm_mode mode)
 {
 	ENTRY;
 	LASSERT(lustre_handle_is_used(lh));
 	/* Cancel the single rename lock right away */
-	ldlm_lock_decref_and_cancel(lh, LCK_EX);
+	ldlm_lock_decref_and_cancel(lh, mode);
+	lh->cookie = 0;
 	EXIT;
 }
 
@@ -1997,7 +1997,7 @@ static int mdt_reint_migrate(struct mdt_thread_info *info,
 	 * get rename lock, which will cause deadlock.
 	 */
 	if (!req_is_replay(req)) {
-		rc = mdt_rename_lock(info, &rename_lh);
+		rc = mdt_rename_lock(info, &rename_lh, LCK_EX);
 		if (rc != 0) {
 			CERROR("%s: can't lock FS for rename: rc = %d\n",
 			       mdt_obd_name(info->mti_mdt), rc);
@@ -2130,7 +2130,7 @@ put_parent:
 	mdt_object_put(env, pobj);
 unlock_rename:
 	if (lustre_handle_is_used(&rename_lh))
-		mdt_rename_unlock(&rename_lh);
+		mdt_rename_unlock(&rename_lh, LCK_EX);
 
 	if (!rc && do_sync)
 		mdt_device_sync(env, mdt);
@@ -2333,6 +2333,9 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
 	struct mdt_lock_handle *lh_newp = NULL;
 	struct lu_fid *old_fid = &info->mti_tmp_fid1;
 	struct lu_fid *new_fid = &info->mti_tmp_fid2;
+	/* mode of the source sent by the client, 0 if unknown */
+	umode_t src_mode = ma->ma_attr.la_mode;
+	enum ldlm_mode rename_mode = LCK_EX;
 	__u64 lock_ibits;
 	bool reverse = false, discard = false;
 	bool cos_incompat;
@@ -2385,14 +2388,28 @@ static int mdt_reint_rename(struct mdt_thread_info *info,
 		    mdt_object_remote(msrcdir))
 			GOTO(out_put_tgtdir, rc = -EXDEV);
 
-		rc = mdt_rename_lock(info, &rename_lh);
-		if (rc != 0) {
-			CERROR("%s: can't lock FS for rename: rc = %d\n",
-			       mdt_obd_name(mdt), rc);
-			GOTO(out_put_tgtdir, rc);
+		/*
+		 * A rename within a local directory can't make a loop in the
+		 * namespace, so it only takes the pdirops locks on its names.
+		 * A non-directory moved to another directory needs the tree
+		 * to stay as it is while the parents are ordered, but not to
+		 * be serialized with other such renames, and takes the rename
+		 * lock in PR.  The mode of the source comes from the client,
+		 * it is checked once the source is found.
+		 */
+		if (src_mode != 0 && !S_ISDIR(src_mode))
+			rename_mode = LCK_PR;
+		if (msrcdir != mtgtdir || mdt_object_remote(msrcdir)) {
+			rc = mdt_rename_lock(info, &rename_lh, rename_mode);
+			if (rc != 0) {
+				CERROR("%s: can't lock FS for rename: rc = %d\n",
+				       mdt_obd_name(mdt), rc);
+				GOTO(out_put_tgtdir, rc);
+			}
 		}
 	}
 
+lock_order:
 	rc = mdt_rename_determine_lock_order(info, msrcdir, mtgtdir);
 	if (rc < 0)
 		GOTO(out_unlock_rename, rc);
@@ -2486,6 +2503,28 @@ relock:
 	if (mdt_object_remote(mold) && !mdt->mdt_enable_remote_rename)
 		GOTO(out_put_old, rc = -EXDEV);
 
+	/* A directory moved to another directory and a remote source need
+	 * the rename lock in EX, retake it if the client guessed wrong. */
+	if (!req_is_replay(req) &&
+	    (mdt_object_remote(mold) ||
+	     (msrcdir != mtgtdir && S_ISDIR(lu_object_attr(&mold->mot_obj)))) &&
+	    !(lustre_handle_is_used(&rename_lh) && rename_mode == LCK_EX)) {
+		mdt_object_put(info->mti_env, mold);
+		mdt_object_unlock(info, mtgtdir, lh_tgtdirp, -EAGAIN);
+		mdt_object_unlock(info, msrcdir, lh_srcdirp, -EAGAIN);
+		if (lustre_handle_is_used(&rename_lh))
+			mdt_rename_unlock(&rename_lh, rename_mode);
+
+		rename_mode = LCK_EX;
+		rc = mdt_rename_lock(info, &rename_lh, rename_mode);
+		if (rc != 0) {
+			CERROR("%s: can't lock FS for rename: rc = %d\n",
+			       mdt_obd_name(mdt), rc);
+			GOTO(out_put_tgtdir, rc);
+		}
+		goto lock_order;
+	}
+
 	/* Check if @mtgtdir is subdir of @mold, before locking child
 	 * to avoid reverse locking. */
 	if (mtgtdir != msrcdir) {
@@ -2668,7 +2707,7 @@ out_unlock_parents:
 	mdt_object_unlock(info, msrcdir, lh_srcdirp, rc);
 out_unlock_rename:
 	if (lustre_handle_is_used(&rename_lh))
-		mdt_rename_unlock(&rename_lh);
+		mdt_rename_unlock(&rename_lh, rename_mode);
 out_put_tgtdir:
 	mdt_object_put(info->mti_env, mtgtdir);
 out_put_srcdir:
@@ -71,15 +71,19 @@ int mdt_get_som(struct mdt_thread_info *info, struct mdt_object *obj,
 {
 	struct lu_buf *buf = &info->mti_buf;
 	struct lu_attr *attr = &ma->ma_attr;
+	int gen = mdt_object_attr_gen(obj);
 	int rc;
 
-	buf->lb_buf = info->mti_xattr_buf;
-	buf->lb_len = sizeof(info->mti_xattr_buf);
-	CLASSERT(sizeof(struct lustre_som_attrs) <=
-		 sizeof(info->mti_xattr_buf));
-	rc = mo_xattr_get(info->mti_env, mdt_object_child(obj), buf,
-			  XATTR_NAME_SOM);
-	rc = lustre_buf2som(info->mti_xattr_buf, rc, &ma->ma_som);
+	if (!mdt_xattr_cache_get(obj, MA_SOM, ma, &rc)) {
+		buf->lb_buf = info->mti_xattr_buf;
+		buf->lb_len = sizeof(info->mti_xattr_buf);
+		CLASSERT(sizeof(struct lustre_som_attrs) <=
+			 sizeof(info->mti_xattr_buf));
+		rc = mo_xattr_get(info->mti_env, mdt_object_child(obj), buf,
+				  XATTR_NAME_SOM);
+		rc = lustre_buf2som(info->mti_xattr_buf, rc, &ma->ma_som);
+		mdt_xattr_cache_set(obj, gen, MA_SOM, ma, rc);
+	}
 	if (rc == 0) {
 		struct md_som *som = &ma->ma_som;
 
@@ -144,6 +148,8 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 
 /**
  * SOM state transition from STRICT to STALE,
+ *
+ * \retval 1 if SOM was strict
  */
 int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *o)
 {
@@ -166,15 +172,71 @@ int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *o)
 
 		info->mti_som_valid = 0;
 		/* The size and blocks info should be still correct. */
-		if (som->ms_valid & SOM_FL_STRICT)
+		if (som->ms_valid & SOM_FL_STRICT) {
 			rc = mdt_set_som(info, o, SOM_FL_STALE,
 					 som->ms_size, som->ms_blocks);
+			if (rc == 0)
+				rc = 1;
+		}
 	}
 out_lock:
 	mutex_unlock(&o->mot_som_mutex);
 	RETURN(rc);
 }
 
+/**
+ * Make SOM strict at the close of the last writer, the client flushed the
+ * file data and sent the size and blocks of the OST objects with the close.
+ *
+ * \retval 1 if SOM is strict
+ * \retval 0 if other writers have the file open
+ */
+int mdt_som_strict_close(struct mdt_thread_info *info, struct mdt_object *o)
+{
+	struct lu_attr *la = &info->mti_attr.ma_attr;
+	int rc = 0;
+
+	ENTRY;
+
+	/* the writer being closed is still counted, see
+	 * mdt_som_strict_break() for the writers being opened
+	 */
+	mutex_lock(&o->mot_som_mutex);
+	if (mdt_write_read(o) == 1) {
+		rc = mdt_set_som(info, o, SOM_FL_STRICT, la->la_size,
+				 la->la_blocks);
+		if (rc == 0)
+			rc = 1;
+	}
+	mutex_unlock(&o->mot_som_mutex);
+
+	RETURN(rc);
+}
+
+/**
+ * A writer opens the file, which is already counted by mdt_write_get(): SOM
+ * is not strict any longer, and the clients lose the size they cached with
+ * their UPDATE lock.
+ */
+int mdt_som_strict_break(struct mdt_thread_info *info, struct mdt_object *o)
+{
+	struct mdt_lock_handle *lh = &info->mti_lh[MDT_LH_NEW];
+	int rc;
+
+	ENTRY;
+
+	rc = mdt_lsom_downgrade(info, o);
+	if (rc <= 0)
+		RETURN(rc);
+
+	mdt_lock_reg_init(lh, LCK_EX);
+	rc = mdt_object_lock(info, o, lh, MDS_INODELOCK_UPDATE);
+	if (rc == 0)
+		mdt_object_unlock(info, o, lh, 1);
+
+	RETURN(rc < 0 ? rc : 1);
+}
+
 int mdt_lsom_update(struct mdt_thread_info *info,
 		    struct mdt_object *o, bool truncate)
 {
@@ -76,7 +76,7 @@ static int cl_io_invariant(const struct cl_io *io)
                  * still be in CIS_LOCKED state when top-io is in
                  * CIS_IO_GOING.
                  */
-                ergo(io->ci_owned_nr > 0, io->ci_state == CIS_IO_GOING ||
+                ergo(atomic_read(&io->ci_owned_nr) > 0, io->ci_state == CIS_IO_GOING ||
                      (io->ci_state == CIS_LOCKED && up != NULL));
 }
 
@@ -106,6 +106,101 @@ static void cs_pagestate_dec(const struct cl_object *obj,
 #endif
 }
 
+/*
+ * The slices live in the same buffer as the cl_page, at the offsets recorded
+ * in cl_page::cp_layer_offset[], so walking the stack is an array walk.
+ */
+static inline struct cl_page_slice *
+cl_page_slice_get(const struct cl_page *page, int index)
+{
+	if (index < 0 || index >= page->cp_layer_count)
+		return NULL;
+
+	return (struct cl_page_slice *)((char *)page +
+					page->cp_layer_offset[index]);
+}
+
+#define cl_page_slice_for_each(page, slice, i)				\
+	for (i = 0, slice = cl_page_slice_get(page, 0);			\
+	     i < (page)->cp_layer_count;				\
+	     slice = cl_page_slice_get(page, ++i))
+
+#define cl_page_slice_for_each_reverse(page, slice, i)			\
+	for (i = (page)->cp_layer_count - 1,				\
+	     slice = cl_page_slice_get(page, i); i >= 0;		\
+	     slice = cl_page_slice_get(page, --i))
+
+/*
+ * cl_pages are allocated from slab caches sized for their stack, instead of
+ * the next kmalloc size up. There are only a few different stacks (with and
+ * without lov, echo), so the caches are created on first use and looked up
+ * linearly.
+ */
+#define CP_KMEM_MAX	16
+static struct kmem_cache *cl_page_kmem_array[CP_KMEM_MAX];
+static unsigned short cl_page_kmem_size_array[CP_KMEM_MAX];
+static DEFINE_MUTEX(cl_page_kmem_mutex);
+
+static struct cl_page *cl_page_alloc0(struct cl_object *o)
+{
+	unsigned short bufsize = cl_object_header(o)->coh_page_bufsize;
+	struct cl_page *page = NULL;
+	int i;
+
+	for (i = 0; i < CP_KMEM_MAX; i++) {
+		unsigned short size = READ_ONCE(cl_page_kmem_size_array[i]);
+
+		if (size == bufsize) {
+			/* pairs with smp_wmb() when the cache is set up */
+			smp_rmb();
+			OBD_SLAB_ALLOC_GFP(page, cl_page_kmem_array[i],
+					   bufsize, GFP_NOFS);
+			if (page != NULL)
+				page->cp_kmem_index = i;
+			return page;
+		}
+		if (size != 0)
+			continue;
+
+		mutex_lock(&cl_page_kmem_mutex);
+		if (cl_page_kmem_size_array[i] == 0) {
+			char name[32];
+
+			snprintf(name, sizeof(name), "cl_page_kmem-%u",
+				 bufsize);
+			cl_page_kmem_array[i] = kmem_cache_create(name, bufsize,
+								  0, 0, NULL);
+			if (cl_page_kmem_array[i] == NULL) {
+				mutex_unlock(&cl_page_kmem_mutex);
+				break;
+			}
+			smp_wmb();
+			WRITE_ONCE(cl_page_kmem_size_array[i], bufsize);
+		}
+		mutex_unlock(&cl_page_kmem_mutex);
+		/* look at the slot again, it may be for another size */
+		i--;
+	}
+
+	OBD_ALLOC_GFP(page, bufsize, GFP_NOFS);
+	if (page != NULL)
+		page->cp_kmem_index = -1;
+	return page;
+}
+
+void cl_page_caches_fini(void)
+{
+	int i;
+
+	for (i = 0; i < CP_KMEM_MAX; i++) {
+		if (cl_page_kmem_array[i] == NULL)
+			break;
+		kmem_cache_destroy(cl_page_kmem_array[i]);
+		cl_page_kmem_array[i] = NULL;
+		cl_page_kmem_size_array[i] = 0;
+	}
+}
+
 /**
  * Internal version of cl_page_get().
  *
@@ -133,9 +228,10 @@ cl_page_at_trusted(const struct cl_page *page,
                    const struct lu_device_type *dtype)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	ENTRY;
 
-	list_for_each_entry(slice, &page->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(page, slice, i) {
 		if (slice->cpl_obj->co_lu.lo_dev->ld_type == dtype)
 			RETURN(slice);
 	}
@@ -147,27 +243,29 @@ static void cl_page_free(const struct lu_env *env, struct cl_page *page,
 {
 	struct cl_object *obj  = page->cp_obj;
 	int pagesize = cl_object_header(obj)->coh_page_bufsize;
+	const struct cl_page_slice *slice;
+	int i;
 
 	PASSERT(env, page, list_empty(&page->cp_batch));
 	PASSERT(env, page, page->cp_owner == NULL);
 	PASSERT(env, page, page->cp_state == CPS_FREEING);
 
 	ENTRY;
-	while (!list_empty(&page->cp_layers)) {
-		struct cl_page_slice *slice;
-
-		slice = list_entry(page->cp_layers.next,
-				   struct cl_page_slice, cpl_linkage);
-		list_del_init(page->cp_layers.next);
+	cl_page_slice_for_each(page, slice, i) {
 		if (unlikely(slice->cpl_ops->cpo_fini != NULL))
 			slice->cpl_ops->cpo_fini(env, slice, pvec);
 	}
+	page->cp_layer_count = 0;
 	cs_page_dec(obj, CS_total);
 	cs_pagestate_dec(obj, page->cp_state);
 	lu_object_ref_del_at(&obj->co_lu, &page->cp_obj_ref, "cl_page", page);
 	cl_object_put(env, obj);
 	lu_ref_fini(&page->cp_reference);
-	OBD_FREE(page, pagesize);
+	if (page->cp_kmem_index >= 0)
+		OBD_SLAB_FREE(page, cl_page_kmem_array[page->cp_kmem_index],
+			      cl_page_kmem_size_array[page->cp_kmem_index]);
+	else
+		OBD_FREE(page, pagesize);
 	EXIT;
 }
 
@@ -190,8 +288,7 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 	struct lu_object_header *head;
 
 	ENTRY;
-	OBD_ALLOC_GFP(page, cl_object_header(o)->coh_page_bufsize,
-			GFP_NOFS);
+	page = cl_page_alloc0(o);
 	if (page != NULL) {
 		int result = 0;
 		atomic_set(&page->cp_ref, 1);
@@ -202,7 +299,6 @@ struct cl_page *cl_page_alloc(const struct lu_env *env,
 		page->cp_vmpage = vmpage;
 		cl_page_state_set_trust(page, CPS_CACHED);
 		page->cp_type = type;
-		INIT_LIST_HEAD(&page->cp_layers);
 		INIT_LIST_HEAD(&page->cp_batch);
 		lu_ref_init(&page->cp_reference);
 		head = o->co_lu.lo_header;
@@ -454,8 +550,8 @@ static void cl_page_owner_clear(struct cl_page *page)
 {
 	ENTRY;
 	if (page->cp_owner != NULL) {
-		LASSERT(page->cp_owner->ci_owned_nr > 0);
-		page->cp_owner->ci_owned_nr--;
+		LASSERT(atomic_read(&page->cp_owner->ci_owned_nr) > 0);
+		atomic_dec(&page->cp_owner->ci_owned_nr);
 		page->cp_owner = NULL;
 	}
 	EXIT;
@@ -465,7 +561,7 @@ static void cl_page_owner_set(struct cl_page *page)
 {
 	ENTRY;
 	LASSERT(page->cp_owner != NULL);
-	page->cp_owner->ci_owned_nr++;
+	atomic_inc(&page->cp_owner->ci_owned_nr);
 	EXIT;
 }
 
@@ -473,6 +569,7 @@ void cl_page_disown0(const struct lu_env *env,
                      struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
         enum cl_page_state state;
 
         ENTRY;
@@ -488,7 +585,7 @@ void cl_page_disown0(const struct lu_env *env,
          * uppermost layer (llite), responsible for VFS/VM interaction runs
          * last and can release locks safely.
          */
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->cpo_disown != NULL)
 			(*slice->cpl_ops->cpo_disown)(env, slice, io);
 	}
@@ -533,6 +630,7 @@ static int cl_page_own0(const struct lu_env *env, struct cl_io *io,
 {
 	int result = 0;
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, !cl_page_is_owned(pg, io));
 
@@ -544,7 +642,7 @@ static int cl_page_own0(const struct lu_env *env, struct cl_io *io,
 		goto out;
 	}
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_own)
 			result = (*slice->cpl_ops->cpo_own)(env, slice,
 							    io, nonblock);
@@ -611,13 +709,14 @@ void cl_page_assume(const struct lu_env *env,
                     struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
 	PINVRNT(env, pg, cl_object_same(pg->cp_obj, io->ci_obj));
 
 	ENTRY;
 	io = cl_io_top(io);
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_assume != NULL)
 			(*slice->cpl_ops->cpo_assume)(env, slice, io);
 	}
@@ -645,6 +744,7 @@ void cl_page_unassume(const struct lu_env *env,
                       struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, cl_page_is_owned(pg, io));
         PINVRNT(env, pg, cl_page_invariant(pg));
@@ -654,7 +754,7 @@ void cl_page_unassume(const struct lu_env *env,
         cl_page_owner_clear(pg);
         cl_page_state_set(env, pg, CPS_CACHED);
 
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->cpo_unassume != NULL)
 			(*slice->cpl_ops->cpo_unassume)(env, slice, io);
 	}
@@ -701,11 +801,12 @@ void cl_page_discard(const struct lu_env *env,
                      struct cl_io *io, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
 	PINVRNT(env, pg, cl_page_is_owned(pg, io));
 	PINVRNT(env, pg, cl_page_invariant(pg));
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_discard != NULL)
 			(*slice->cpl_ops->cpo_discard)(env, slice, io);
 	}
@@ -720,6 +821,7 @@ EXPORT_SYMBOL(cl_page_discard);
 static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         ENTRY;
 
@@ -731,7 +833,7 @@ static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg)
         cl_page_owner_clear(pg);
         cl_page_state_set0(env, pg, CPS_FREEING);
 
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->cpo_delete != NULL)
 			(*slice->cpl_ops->cpo_delete)(env, slice);
 	}
@@ -784,10 +886,11 @@ EXPORT_SYMBOL(cl_page_delete);
 void cl_page_export(const struct lu_env *env, struct cl_page *pg, int uptodate)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, cl_page_invariant(pg));
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_export != NULL)
 			(*slice->cpl_ops->cpo_export)(env, slice, uptodate);
 	}
@@ -804,8 +907,7 @@ int cl_page_is_vmlocked(const struct lu_env *env, const struct cl_page *pg)
 	int result;
 
         ENTRY;
-        slice = container_of(pg->cp_layers.next,
-                             const struct cl_page_slice, cpl_linkage);
+	slice = cl_page_slice_get(pg, 0);
         PASSERT(env, pg, slice->cpl_ops->cpo_is_vmlocked != NULL);
         /*
          * Call ->cpo_is_vmlocked() directly instead of going through
@@ -822,10 +924,11 @@ void cl_page_touch(const struct lu_env *env, const struct cl_page *pg,
 		  size_t to)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
 	ENTRY;
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_page_touch != NULL)
 			(*slice->cpl_ops->cpo_page_touch)(env, slice, to);
 	}
@@ -863,6 +966,7 @@ int cl_page_prep(const struct lu_env *env, struct cl_io *io,
                  struct cl_page *pg, enum cl_req_type crt)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int result = 0;
 
         PINVRNT(env, pg, cl_page_is_owned(pg, io));
@@ -877,7 +981,7 @@ int cl_page_prep(const struct lu_env *env, struct cl_io *io,
 	if (crt >= CRT_NR)
 		return -EINVAL;
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_own)
 			result = (*slice->cpl_ops->io[crt].cpo_prep)(env,
 								     slice,
@@ -917,6 +1021,7 @@ void cl_page_completion(const struct lu_env *env,
                         struct cl_page *pg, enum cl_req_type crt, int ioret)
 {
 	const struct cl_page_slice *slice;
+	int i;
         struct cl_sync_io *anchor = pg->cp_sync_io;
 
         PASSERT(env, pg, crt < CRT_NR);
@@ -928,7 +1033,7 @@ void cl_page_completion(const struct lu_env *env,
 	if (crt >= CRT_NR)
 		return;
 
-	list_for_each_entry_reverse(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each_reverse(pg, slice, i) {
 		if (slice->cpl_ops->io[crt].cpo_completion != NULL)
 			(*slice->cpl_ops->io[crt].cpo_completion)(env, slice,
 								  ioret);
@@ -956,6 +1061,7 @@ int cl_page_make_ready(const struct lu_env *env, struct cl_page *pg,
                        enum cl_req_type crt)
 {
 	const struct cl_page_slice *sli;
+	int i;
 	int result = 0;
 
         PINVRNT(env, pg, crt < CRT_NR);
@@ -964,7 +1070,7 @@ int cl_page_make_ready(const struct lu_env *env, struct cl_page *pg,
 	if (crt >= CRT_NR)
 		RETURN(-EINVAL);
 
-	list_for_each_entry(sli, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, sli, i) {
 		if (sli->cpl_ops->io[crt].cpo_make_ready != NULL)
 			result = (*sli->cpl_ops->io[crt].cpo_make_ready)(env,
 									 sli);
@@ -994,6 +1100,7 @@ int cl_page_flush(const struct lu_env *env, struct cl_io *io,
 		  struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int result = 0;
 
 	PINVRNT(env, pg, cl_page_is_owned(pg, io));
@@ -1001,7 +1108,7 @@ int cl_page_flush(const struct lu_env *env, struct cl_io *io,
 
 	ENTRY;
 
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_flush != NULL)
 			result = (*slice->cpl_ops->cpo_flush)(env, slice, io);
 		if (result != 0)
@@ -1024,11 +1131,12 @@ void cl_page_clip(const struct lu_env *env, struct cl_page *pg,
                   int from, int to)
 {
 	const struct cl_page_slice *slice;
+	int i;
 
         PINVRNT(env, pg, cl_page_invariant(pg));
 
         CL_PAGE_HEADER(D_TRACE, env, pg, "%d %d\n", from, to);
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_clip != NULL)
 			(*slice->cpl_ops->cpo_clip)(env, slice, from, to);
 	}
@@ -1056,10 +1164,11 @@ void cl_page_print(const struct lu_env *env, void *cookie,
                    lu_printer_t printer, const struct cl_page *pg)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int result = 0;
 
 	cl_page_header_print(env, cookie, printer, pg);
-	list_for_each_entry(slice, &pg->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(pg, slice, i) {
 		if (slice->cpl_ops->cpo_print != NULL)
 			result = (*slice->cpl_ops->cpo_print)(env, slice,
 							     cookie, printer);
@@ -1076,9 +1185,10 @@ EXPORT_SYMBOL(cl_page_print);
 int cl_page_cancel(const struct lu_env *env, struct cl_page *page)
 {
 	const struct cl_page_slice *slice;
+	int i;
 	int			    result = 0;
 
-	list_for_each_entry(slice, &page->cp_layers, cpl_linkage) {
+	cl_page_slice_for_each(page, slice, i) {
 		if (slice->cpl_ops->cpo_cancel != NULL)
 			result = (*slice->cpl_ops->cpo_cancel)(env, slice);
 		if (result != 0)
@@ -1119,7 +1229,7 @@ EXPORT_SYMBOL(cl_page_size);
  *
  * This is called by cl_object_operations::coo_page_init() methods to add a
  * per-layer state to the page. New state is added at the end of
- * cl_page::cp_layers list, that is, it is at the bottom of the stack.
+ * cl_page::cp_layer_offset[], that is, it is at the bottom of the stack.
  *
  * \see cl_lock_slice_add(), cl_req_slice_add(), cl_io_slice_add()
  */
@@ -1128,7 +1238,10 @@ void cl_page_slice_add(struct cl_page *page, struct cl_page_slice *slice,
 		       const struct cl_page_operations *ops)
 {
 	ENTRY;
-	list_add_tail(&slice->cpl_linkage, &page->cp_layers);
+	LASSERT(page->cp_layer_count < CP_MAX_LAYER);
+	LASSERT((char *)slice - (char *)page < USHRT_MAX);
+	page->cp_layer_offset[page->cp_layer_count++] =
+		(char *)slice - (char *)page;
 	slice->cpl_obj  = obj;
 	slice->cpl_index = index;
 	slice->cpl_ops  = ops;
@@ -1143,12 +1256,22 @@ EXPORT_SYMBOL(cl_page_slice_add);
 struct cl_client_cache *cl_cache_init(unsigned long lru_page_max)
 {
 	struct cl_client_cache	*cache = NULL;
+	struct cl_cache_lru_pool *pool;
+	int i;
 
 	ENTRY;
 	OBD_ALLOC(cache, sizeof(*cache));
 	if (cache == NULL)
 		RETURN(NULL);
 
+	cache->ccc_lru_pools = cfs_percpt_alloc(cfs_cpt_table, sizeof(*pool));
+	if (cache->ccc_lru_pools == NULL) {
+		OBD_FREE(cache, sizeof(*cache));
+		RETURN(NULL);
+	}
+	cfs_percpt_for_each(pool, i, cache->ccc_lru_pools)
+		spin_lock_init(&pool->ccp_lock);
+
 	/* Initialize cache data */
 	atomic_set(&cache->ccc_users, 1);
 	cache->ccc_lru_max = lru_page_max;
@@ -1181,7 +1304,139 @@ EXPORT_SYMBOL(cl_cache_incref);
  */
 void cl_cache_decref(struct cl_client_cache *cache)
 {
-	if (atomic_dec_and_test(&cache->ccc_users))
+	if (atomic_dec_and_test(&cache->ccc_users)) {
+		cfs_percpt_free(cache->ccc_lru_pools);
 		OBD_FREE(cache, sizeof(*cache));
+	}
 }
 EXPORT_SYMBOL(cl_cache_decref);
+
+/* most LRU slots a CPT takes from ccc_lru_left at once */
+#define CCC_LRU_BATCH	256
+
+/*
+ * The slots kept by all the CPTs are at most 1/16 of the cache, so that the
+ * decisions taken on ccc_lru_left alone stay sensible.
+ */
+static long cl_cache_lru_batch(struct cl_client_cache *cache)
+{
+	return min_t(long, CCC_LRU_BATCH, cache->ccc_lru_max /
+		     (32 * cfs_cpt_number(cfs_cpt_table)));
+}
+
+static bool __cl_cache_lru_get(struct cl_client_cache *cache, long npages)
+{
+	struct cl_cache_lru_pool *pool;
+	long batch = cl_cache_lru_batch(cache);
+	bool got = false;
+
+	pool = cache->ccc_lru_pools[cfs_cpt_current(cfs_cpt_table, 0)];
+	spin_lock(&pool->ccp_lock);
+	if (pool->ccp_left < npages) {
+		long need = npages - pool->ccp_left;
+		long ov, nv;
+
+		/* take enough to keep a batch after this allocation */
+		for (;;) {
+			ov = atomic_long_read(&cache->ccc_lru_left);
+			if (ov < need)
+				break;
+			nv = ov - min(ov, need + batch);
+			if (atomic_long_cmpxchg(&cache->ccc_lru_left,
+						ov, nv) == ov) {
+				pool->ccp_left += ov - nv;
+				break;
+			}
+		}
+	}
+	if (pool->ccp_left >= npages) {
+		pool->ccp_left -= npages;
+		got = true;
+	}
+	spin_unlock(&pool->ccp_lock);
+
+	return got;
+}
+
+/**
+ * Allocate \a npages LRU slots of \a cache, all or none of them.
+ *
+ * The slots are taken from the ones kept by the current CPT, which takes a
+ * batch of them from ccc_lru_left when it has not enough. The slots kept by
+ * the other CPTs are given back to ccc_lru_left when it is short of them.
+ *
+ * \retval true if the slots were allocated
+ */
+bool cl_cache_lru_get(struct cl_client_cache *cache, long npages)
+{
+	if (__cl_cache_lru_get(cache, npages))
+		return true;
+
+	cl_cache_lru_drain(cache);
+	return __cl_cache_lru_get(cache, npages);
+}
+EXPORT_SYMBOL(cl_cache_lru_get);
+
+/**
+ * Free \a npages LRU slots of \a cache, kept by the current CPT up to two
+ * batches of them.
+ */
+void cl_cache_lru_put(struct cl_client_cache *cache, long npages)
+{
+	struct cl_cache_lru_pool *pool;
+	long batch = cl_cache_lru_batch(cache);
+	long excess = 0;
+
+	pool = cache->ccc_lru_pools[cfs_cpt_current(cfs_cpt_table, 0)];
+	spin_lock(&pool->ccp_lock);
+	pool->ccp_left += npages;
+	if (pool->ccp_left > 2 * batch) {
+		excess = pool->ccp_left - batch;
+		pool->ccp_left = batch;
+	}
+	spin_unlock(&pool->ccp_lock);
+
+	if (excess > 0)
+		atomic_long_add(excess, &cache->ccc_lru_left);
+}
+EXPORT_SYMBOL(cl_cache_lru_put);
+
+/**
+ * Return the # of LRU slots of \a cache available, including the ones kept
+ * by the CPTs.
+ */
+long cl_cache_lru_left(struct cl_client_cache *cache)
+{
+	struct cl_cache_lru_pool *pool;
+	long left = atomic_long_read(&cache->ccc_lru_left);
+	int i;
+
+	cfs_percpt_for_each(pool, i, cache->ccc_lru_pools)
+		left += READ_ONCE(pool->ccp_left);
+
+	return left;
+}
+EXPORT_SYMBOL(cl_cache_lru_left);
+
+/**
+ * Give the LRU slots kept by all the CPTs back to ccc_lru_left.
+ */
+void cl_cache_lru_drain(struct cl_client_cache *cache)
+{
+	struct cl_cache_lru_pool *pool;
+	long left;
+	int i;
+
+	cfs_percpt_for_each(pool, i, cache->ccc_lru_pools) {
+		if (READ_ONCE(pool->ccp_left) == 0)
+			continue;
+
+		spin_lock(&pool->ccp_lock);
+		left = pool->ccp_left;
+		pool->ccp_left = 0;
+		spin_unlock(&pool->ccp_lock);
+
+		atomic_long_add(left, &cache->ccc_lru_left);
+	}
+}
+EXPORT_SYMBOL(cl_cache_lru_drain);
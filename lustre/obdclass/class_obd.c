@@ -42,6 +42,8 @@
 
 #include <obd_support.h>
 #include <obd_class.h>
+#include <obd_cksum.h>
+#include <obd_compr.h>
 #include <uapi/linux/lnet/lnetctl.h>
 #include <lustre_debug.h>
 #include <lustre_kernelcomm.h>
@@ -646,10 +648,18 @@ static int __init obdclass_init(void)
 	if (err)
 		goto cleanup_obd_memory;
 
-	err = class_handle_init();
+	err = obd_cksum_init();
 	if (err)
 		goto cleanup_zombie_impexp;
 
+	err = obd_compr_init();
+	if (err)
+		goto cleanup_cksum;
+
+	err = class_handle_init();
+	if (err)
+		goto cleanup_compr;
+
 	err = misc_register(&obd_psdev);
 	if (err) {
 		CERROR("cannot register OBD miscdevice: err = %d\n", err);
@@ -743,6 +753,12 @@ cleanup_deregister:
 cleanup_class_handle:
 	class_handle_cleanup();
 
+cleanup_compr:
+	obd_compr_fini();
+
+cleanup_cksum:
+	obd_cksum_fini();
+
 cleanup_zombie_impexp:
 	obd_zombie_impexp_stop();
 
@@ -807,6 +823,8 @@ static void __exit obdclass_exit(void)
         class_handle_cleanup();
 	class_del_uuid(NULL); /* Delete all UUIDs. */
         obd_zombie_impexp_stop();
+	obd_compr_fini();
+	obd_cksum_fini();
 
 #ifdef CONFIG_PROC_FS
 	memory_leaked = obd_memory_sum();
@@ -503,6 +503,7 @@ int dt_record_write(const struct lu_env *env, struct dt_object *dt,
 	LASSERT(dt->do_body_ops->dbo_write);
 
 	size = dt->do_body_ops->dbo_write(env, dt, buf, pos, th);
+	dt_object_changed(dt);
 	if (size < 0)
 		return size;
 	return (size == (ssize_t)buf->lb_len) ? 0 : -EFAULT;
@@ -444,6 +444,7 @@ struct obd_device *class_newdev(const char *type_name, const char *name,
 	lu_ref_add(&newdev->obd_reference, "newdev", newdev);
 
 	newdev->obd_conn_inprogress = 0;
+	newdev->obd_conn_limit = OBD_CONN_LIMIT_DEFAULT;
 
 	strncpy(newdev->obd_uuid.uuid, uuid, UUID_MAX);
 
@@ -1305,6 +1306,7 @@ struct obd_import *class_new_import(struct obd_device *obd)
 
 	INIT_LIST_HEAD(&imp->imp_pinger_chain);
 	INIT_LIST_HEAD(&imp->imp_replay_list);
+	imp->imp_replay_tree = RB_ROOT;
 	INIT_LIST_HEAD(&imp->imp_sending_list);
 	INIT_LIST_HEAD(&imp->imp_delayed_list);
 	INIT_LIST_HEAD(&imp->imp_committed_list);
@@ -55,6 +55,10 @@ char obd_jobid_name[LUSTRE_JOBID_SIZE] = "%e.%u";
 
 /**
  * Structure to store a single PID->JobID mapping
+ *
+ * The PID is that of the thread group, since all threads of a process
+ * share its environment.  The environment only changes across an exec,
+ * so the mapping is refreshed as soon as the process has exec'd again.
  */
 struct jobid_pid_map {
 	struct hlist_node	jp_hash;
@@ -64,6 +68,8 @@ struct jobid_pid_map {
 	unsigned int		jp_joblen;
 	atomic_t		jp_refcount;
 	pid_t			jp_pid;
+	/* self_exec_id of the process when jp_jobid was read */
+	u64			jp_exec_id;
 };
 
 /*
@@ -189,7 +195,8 @@ static int jobid_get_from_cache(char *jobid, size_t joblen)
 {
 	static time64_t last_expire;
 	bool expire_cache = false;
-	pid_t pid = current_pid();
+	pid_t pid = current->tgid;
+	u64 exec_id = current->self_exec_id;
 	struct jobid_pid_map *pidmap = NULL;
 	time64_t now = ktime_get_real_seconds();
 	int rc = 0;
@@ -197,13 +204,16 @@ static int jobid_get_from_cache(char *jobid, size_t joblen)
 
 	LASSERT(jobid_hash != NULL);
 
-	/* scan hash periodically to remove old PID entries from cache */
-	spin_lock(&jobid_hash_lock);
-	if (unlikely(last_expire + DELETE_INTERVAL <= now)) {
-		expire_cache = true;
-		last_expire = now;
+	/* scan hash periodically to remove old PID entries from cache,
+	 * without taking the global lock on every call */
+	if (unlikely(READ_ONCE(last_expire) + DELETE_INTERVAL <= now)) {
+		spin_lock(&jobid_hash_lock);
+		if (last_expire + DELETE_INTERVAL <= now) {
+			expire_cache = true;
+			last_expire = now;
+		}
+		spin_unlock(&jobid_hash_lock);
 	}
-	spin_unlock(&jobid_hash_lock);
 
 	if (expire_cache)
 		cfs_hash_cond_del(jobid_hash, jobid_should_free_item,
@@ -246,16 +256,19 @@ static int jobid_get_from_cache(char *jobid, size_t joblen)
 	}
 
 	/*
-	 * If pidmap is old (this is always true for new entries) refresh it.
+	 * If pidmap is old (this is always true for new entries) or the
+	 * process has exec'd a new environment since, refresh it.
 	 * If obd_jobid_var is not found, cache empty entry and try again
 	 * later, to avoid repeat lookups for PID if obd_jobid_var missing.
 	 */
 	spin_lock(&pidmap->jp_lock);
-	if (pidmap->jp_time + RESCAN_INTERVAL <= now) {
+	if (pidmap->jp_time + RESCAN_INTERVAL <= now ||
+	    pidmap->jp_exec_id != exec_id) {
 		char env_jobid[LUSTRE_JOBID_SIZE] = "";
 		int env_len = sizeof(env_jobid);
 
 		pidmap->jp_time = now;
+		pidmap->jp_exec_id = exec_id;
 
 		spin_unlock(&pidmap->jp_lock);
 		rc = jobid_get_from_environ(obd_jobid_var, env_jobid, &env_len);
@@ -88,6 +88,8 @@ static void llog_free_handle(struct llog_handle *loghandle)
 		LASSERT(list_empty(&loghandle->u.chd.chd_head));
 	OBD_FREE_LARGE(loghandle->lgh_hdr, loghandle->lgh_hdr_size);
 out:
+	if (loghandle->lgh_bulk_buf != NULL)
+		OBD_FREE_LARGE(loghandle->lgh_bulk_buf, LLOG_BULK_SIZE);
 	OBD_FREE_PTR(loghandle);
 }
 
@@ -452,6 +454,8 @@ static int llog_process_thread(void *arg)
 	struct llog_log_hdr		*llh = loghandle->lgh_hdr;
 	struct llog_process_cat_data	*cd  = lpi->lpi_catdata;
 	struct llog_thread_info		*lti;
+	struct llog_read_ahead		 ra = { NULL };
+	struct llog_read_ahead		*saved_ra = NULL;
 	char				*buf;
 	size_t				 chunk_size;
 	__u64				 cur_offset;
@@ -477,6 +481,14 @@ static int llog_process_thread(void *arg)
 		RETURN(0);
 	}
 
+	/* read the chunks of a plain llog ahead, a catalog is rewritten in
+	 * place when it wraps */
+	if (lti != NULL) {
+		saved_ra = lti->lgi_ra;
+		ra.lra_handle = loghandle;
+		lti->lgi_ra = llh->llh_flags & LLOG_F_IS_CAT ? NULL : &ra;
+	}
+
 	if (cd != NULL) {
 		last_called_index = cd->lpcd_first_idx;
 		index = cd->lpcd_first_idx + 1;
@@ -593,6 +605,7 @@ repeat:
 				buf_offset = (char *)rec - (char *)buf;
 				cur_offset = chunk_offset;
 				repeated = true;
+				ra.lra_len = 0;
 				/* We need to be sure lgh_last_idx
 				 * record was saved to disk
 				 */
@@ -741,6 +754,10 @@ out:
 		}
 	}
 
+	if (lti != NULL)
+		lti->lgi_ra = saved_ra;
+	if (ra.lra_buf != NULL)
+		OBD_FREE_LARGE(ra.lra_buf, LLOG_READ_AHEAD_SIZE);
 	OBD_FREE_LARGE(buf, chunk_size);
 	lpi->lpi_rc = rc;
 	return 0;
@@ -44,6 +44,7 @@
 
 #define DEBUG_SUBSYSTEM S_LOG
 
+#include <linux/kthread.h>
 
 #include <obd_class.h>
 
@@ -827,6 +828,147 @@ static int llog_cat_process_common(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/* plain logs of a catalog processed by a pool of threads */
+struct llog_cat_parallel {
+	struct llog_handle	*lcp_cat;
+	llog_cb_t		 lcp_cb;
+	void			*lcp_data;
+	__u32			 lcp_tags;
+	/* protects the fields below */
+	spinlock_t		 lcp_lock;
+	/* plain logs waiting for a thread */
+	struct list_head	 lcp_queue;
+	int			 lcp_queued;
+	/* threads running */
+	int			 lcp_threads;
+	/* first error or LLOG_PROC_BREAK of a plain log processing */
+	int			 lcp_rc;
+	/* the catalog processing is over */
+	bool			 lcp_done;
+	wait_queue_head_t	 lcp_waitq;
+};
+
+struct llog_cat_parallel_item {
+	struct list_head	 lcpi_list;
+	struct llog_handle	*lcpi_llh;
+};
+
+static int llog_cat_parallel_queue(struct llog_cat_parallel *lcp,
+				   struct llog_handle *llh)
+{
+	struct llog_cat_parallel_item *item;
+	int rc;
+
+	OBD_ALLOC_PTR(item);
+	if (item == NULL)
+		return -ENOMEM;
+	item->lcpi_llh = llh;
+
+	/* keep at most one plain log per thread opened ahead */
+	spin_lock(&lcp->lcp_lock);
+	while (lcp->lcp_rc == 0 && lcp->lcp_queued >= lcp->lcp_threads) {
+		spin_unlock(&lcp->lcp_lock);
+		wait_event(lcp->lcp_waitq,
+			   lcp->lcp_rc != 0 ||
+			   lcp->lcp_queued < lcp->lcp_threads);
+		spin_lock(&lcp->lcp_lock);
+	}
+	rc = lcp->lcp_rc;
+	if (rc == 0) {
+		list_add_tail(&item->lcpi_list, &lcp->lcp_queue);
+		lcp->lcp_queued++;
+	}
+	spin_unlock(&lcp->lcp_lock);
+
+	if (rc != 0)
+		OBD_FREE_PTR(item);
+	else
+		wake_up_all(&lcp->lcp_waitq);
+
+	return rc;
+}
+
+static struct llog_handle *
+llog_cat_parallel_next(struct llog_cat_parallel *lcp)
+{
+	struct llog_cat_parallel_item *item;
+	struct llog_handle *llh = NULL;
+
+	spin_lock(&lcp->lcp_lock);
+	item = list_first_entry_or_null(&lcp->lcp_queue,
+					struct llog_cat_parallel_item,
+					lcpi_list);
+	if (item != NULL) {
+		list_del(&item->lcpi_list);
+		lcp->lcp_queued--;
+	}
+	spin_unlock(&lcp->lcp_lock);
+
+	if (item != NULL) {
+		llh = item->lcpi_llh;
+		OBD_FREE_PTR(item);
+		wake_up_all(&lcp->lcp_waitq);
+	}
+
+	return llh;
+}
+
+static void llog_cat_parallel_set_rc(struct llog_cat_parallel *lcp, int rc)
+{
+	spin_lock(&lcp->lcp_lock);
+	if (lcp->lcp_rc == 0)
+		lcp->lcp_rc = rc;
+	spin_unlock(&lcp->lcp_lock);
+	wake_up_all(&lcp->lcp_waitq);
+}
+
+static int llog_cat_parallel_thread(void *arg)
+{
+	struct llog_cat_parallel *lcp = arg;
+	struct llog_handle *llh;
+	struct lu_env env;
+	int rc;
+
+	rc = lu_env_init(&env, lcp->lcp_tags);
+	if (rc) {
+		llog_cat_parallel_set_rc(lcp, rc);
+		goto out;
+	}
+
+	while (1) {
+		wait_event(lcp->lcp_waitq,
+			   !list_empty(&lcp->lcp_queue) || lcp->lcp_done ||
+			   lcp->lcp_rc != 0);
+		llh = llog_cat_parallel_next(lcp);
+		if (llh == NULL) {
+			if (lcp->lcp_done || lcp->lcp_rc != 0)
+				break;
+			continue;
+		}
+
+		/* just release the plain logs left after an error */
+		rc = lcp->lcp_rc;
+		if (rc == 0)
+			rc = llog_process_or_fork(&env, llh, lcp->lcp_cb,
+						  lcp->lcp_data, NULL, false);
+		if (rc == LLOG_DEL_PLAIN) {
+			rc = llog_cat_cleanup(&env, lcp->lcp_cat, llh,
+					      llh->u.phd.phd_cookie.lgc_index);
+		} else if (rc != 0 && rc != lcp->lcp_rc) {
+			llog_cat_parallel_set_rc(lcp, rc);
+		}
+		llog_handle_put(&env, llh);
+	}
+	lu_env_fini(&env);
+out:
+	spin_lock(&lcp->lcp_lock);
+	lcp->lcp_threads--;
+	spin_unlock(&lcp->lcp_lock);
+	wake_up_all(&lcp->lcp_waitq);
+
+	return 0;
+}
+
 static int llog_cat_process_cb(const struct lu_env *env,
 			       struct llog_handle *cat_llh,
 			       struct llog_rec_hdr *rec, void *data)
@@ -843,6 +985,11 @@ static int llog_cat_process_cb(const struct lu_env *env,
 	if (rec->lrh_index < d->lpd_startcat) {
 		/* Skip processing of the logs until startcat */
 		rc = 0;
+	} else if (d->lpd_parallel != NULL) {
+		rc = llog_cat_parallel_queue(d->lpd_parallel, llh);
+		/* the thread processing the log puts the handle */
+		if (rc == 0)
+			llh = NULL;
 	} else if (d->lpd_startidx > 0) {
                 struct llog_process_cat_data cd;
 
@@ -873,22 +1020,17 @@ out:
 	RETURN(rc);
 }
 
-int llog_cat_process_or_fork(const struct lu_env *env,
-			     struct llog_handle *cat_llh, llog_cb_t cat_cb,
-			     llog_cb_t cb, void *data, int startcat,
-			     int startidx, bool fork)
+static int llog_cat_process_data(const struct lu_env *env,
+				 struct llog_handle *cat_llh,
+				 llog_cb_t cat_cb, struct llog_process_data *d,
+				 int startcat, bool fork)
 {
-	struct llog_process_data d;
 	struct llog_log_hdr *llh = cat_llh->lgh_hdr;
 	int rc;
 
 	ENTRY;
 
 	LASSERT(llh->llh_flags & LLOG_F_IS_CAT);
-	d.lpd_data = data;
-	d.lpd_cb = cb;
-	d.lpd_startcat = (startcat == LLOG_CAT_FIRST ? 0 : startcat);
-	d.lpd_startidx = startidx;
 
 	if (llh->llh_cat_idx >= cat_llh->lgh_last_idx &&
 	    llh->llh_count > 1) {
@@ -908,7 +1050,7 @@ int llog_cat_process_or_fork(const struct lu_env *env,
 			else
 				cd.lpcd_last_idx = 0;
 			rc = llog_process_or_fork(env, cat_llh, cat_cb,
-						  &d, &cd, fork);
+						  d, &cd, fork);
 			/* Reset the startcat becasue it has already reached
 			 * catalog bottom.
 			 */
@@ -925,14 +1067,31 @@ int llog_cat_process_or_fork(const struct lu_env *env,
 		 */
 		cd.lpcd_last_idx = cat_llh->lgh_last_idx;
 		rc = llog_process_or_fork(env, cat_llh, cat_cb,
-					  &d, &cd, fork);
+					  d, &cd, fork);
 	} else {
 		rc = llog_process_or_fork(env, cat_llh, cat_cb,
-					  &d, NULL, fork);
+					  d, NULL, fork);
 	}
 
 	RETURN(rc);
 }
+
+int llog_cat_process_or_fork(const struct lu_env *env,
+			     struct llog_handle *cat_llh, llog_cb_t cat_cb,
+			     llog_cb_t cb, void *data, int startcat,
+			     int startidx, bool fork)
+{
+	struct llog_process_data d;
+
+	d.lpd_data = data;
+	d.lpd_cb = cb;
+	d.lpd_startcat = (startcat == LLOG_CAT_FIRST ? 0 : startcat);
+	d.lpd_startidx = startidx;
+	d.lpd_parallel = NULL;
+
+	return llog_cat_process_data(env, cat_llh, cat_cb, &d, startcat,
+				     fork);
+}
 EXPORT_SYMBOL(llog_cat_process_or_fork);
 
 int llog_cat_process(const struct lu_env *env, struct llog_handle *cat_llh,
@@ -943,6 +1102,102 @@ int llog_cat_process(const struct lu_env *env, struct llog_handle *cat_llh,
 }
 EXPORT_SYMBOL(llog_cat_process);
 
+/**
+ * Process the plain logs of a catalog with \a nthreads threads.
+ *
+ * The catalog is scanned by the calling thread, which opens the plain logs
+ * and hands each of them to one of the threads.  The records of a plain log
+ * are processed in order by a single thread, but the plain logs are
+ * processed concurrently and in no particular order, so \a cb must be safe
+ * to call from several threads at once.  Consumers which depend on the
+ * order of the records across the plain logs use llog_cat_process().
+ *
+ * \param[in] env	execution environment
+ * \param[in] cat_llh	catalog handle
+ * \param[in] cb	callback called for each record of the plain logs
+ * \param[in] data	data passed to \a cb
+ * \param[in] startcat	catalog index to start the processing from
+ * \param[in] nthreads	number of threads processing the plain logs
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error, or LLOG_PROC_BREAK returned
+ *			by the processing of a plain log
+ */
+int llog_cat_process_parallel(const struct lu_env *env,
+			      struct llog_handle *cat_llh, llog_cb_t cb,
+			      void *data, int startcat, int nthreads)
+{
+	struct llog_cat_parallel *lcp;
+	struct llog_process_data d;
+	struct task_struct *task;
+	struct llog_handle *llh;
+	int rc, i;
+
+	ENTRY;
+
+	if (env == NULL || nthreads <= 1)
+		RETURN(llog_cat_process(env, cat_llh, cb, data, startcat, 0));
+
+	OBD_ALLOC_PTR(lcp);
+	if (lcp == NULL)
+		RETURN(-ENOMEM);
+	lcp->lcp_cat = cat_llh;
+	lcp->lcp_cb = cb;
+	lcp->lcp_data = data;
+	lcp->lcp_tags = env->le_ctx.lc_tags &
+			~(LCT_HAS_EXIT | LCT_REMEMBER | LCT_QUIESCENT);
+	spin_lock_init(&lcp->lcp_lock);
+	INIT_LIST_HEAD(&lcp->lcp_queue);
+	init_waitqueue_head(&lcp->lcp_waitq);
+
+	for (i = 0; i < nthreads; i++) {
+		spin_lock(&lcp->lcp_lock);
+		lcp->lcp_threads++;
+		spin_unlock(&lcp->lcp_lock);
+		task = kthread_run(llog_cat_parallel_thread, lcp,
+				   "llog_cat_%02d", i);
+		if (IS_ERR(task)) {
+			rc = PTR_ERR(task);
+			CERROR("%s: cannot start llog processing thread: "
+			       "rc = %d\n",
+			       cat_llh->lgh_ctxt->loc_obd->obd_name, rc);
+			spin_lock(&lcp->lcp_lock);
+			lcp->lcp_threads--;
+			spin_unlock(&lcp->lcp_lock);
+			break;
+		}
+	}
+
+	d.lpd_data = data;
+	d.lpd_cb = cb;
+	d.lpd_startcat = (startcat == LLOG_CAT_FIRST ? 0 : startcat);
+	d.lpd_startidx = 0;
+	d.lpd_parallel = lcp;
+
+	if (i > 0)
+		rc = llog_cat_process_data(env, cat_llh, llog_cat_process_cb,
+					   &d, startcat, false);
+	else
+		rc = llog_cat_process(env, cat_llh, cb, data, startcat, 0);
+
+	spin_lock(&lcp->lcp_lock);
+	lcp->lcp_done = true;
+	spin_unlock(&lcp->lcp_lock);
+	wake_up_all(&lcp->lcp_waitq);
+	wait_event(lcp->lcp_waitq, lcp->lcp_threads == 0);
+
+	/* all the threads failed to start their env */
+	while ((llh = llog_cat_parallel_next(lcp)) != NULL)
+		llog_handle_put(env, llh);
+
+	if (rc == 0)
+		rc = lcp->lcp_rc;
+	OBD_FREE_PTR(lcp);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(llog_cat_process_parallel);
+
 static int llog_cat_size_cb(const struct lu_env *env,
 			     struct llog_handle *cat_llh,
 			     struct llog_rec_hdr *rec, void *data)
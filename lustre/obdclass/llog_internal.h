@@ -46,6 +46,16 @@ struct llog_process_info {
 	struct task_struct      *lpi_reftask;
 };
 
+/* complete chunks read ahead by the sequential processing of a plain llog */
+struct llog_read_ahead {
+	struct llog_handle		*lra_handle;
+	char				*lra_buf;
+	__u64				 lra_offset;
+	int				 lra_len;
+};
+
+#define LLOG_READ_AHEAD_SIZE	(32 * LLOG_MIN_CHUNK_SIZE)
+
 struct llog_thread_info {
 	struct lu_attr			 lgi_attr;
 	struct lu_fid			 lgi_fid;
@@ -58,6 +68,7 @@ struct llog_thread_info {
 	struct llog_cookie		 lgi_cookie;
 	struct obd_statfs		 lgi_statfs;
 	char				 lgi_name[32];
+	struct llog_read_ahead		*lgi_ra;
 };
 
 extern struct lu_context_key llog_thread_key;
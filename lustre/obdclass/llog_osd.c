@@ -390,6 +390,7 @@ static int llog_osd_write_rec(const struct lu_env *env,
 	__u32			chunk_size;
 	size_t			 left;
 	__u32			orig_last_idx;
+	loff_t			 rec_off;
 	ENTRY;
 
 	llh = loghandle->lgh_hdr;
@@ -437,6 +438,11 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		/* llog can be empty only when first record is being written */
 		LASSERT(ergo(idx > 0, lgi->lgi_attr.la_size > 0));
 
+		/* the record might be in the chunks read ahead */
+		if (idx > 0 && lgi->lgi_ra != NULL &&
+		    lgi->lgi_ra->lra_handle == loghandle)
+			lgi->lgi_ra->lra_len = 0;
+
 		if (!ext2_test_bit(idx, LLOG_HDR_BITMAP(llh))) {
 			CERROR("%s: modify unset record %u\n",
 			       o->do_lu.lo_dev->ld_obd->obd_name, idx);
@@ -591,6 +597,9 @@ static int llog_osd_write_rec(const struct lu_env *env,
 			RETURN(-ENOSPC);
 	}
 
+	/* the record goes right after the pad, if any */
+	rec_off = lgi->lgi_off;
+
 	down_write(&loghandle->lgh_last_sem);
 	/* increment the last_idx along with llh_tail index, they should
 	 * be equal for a llog lifetime */
@@ -634,8 +643,10 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
 		if (rc != 0)
 			GOTO(out_unlock, rc);
+		rec_off = max_t(loff_t, rec_off, lgi->lgi_off);
 	} else {
 		__u32	*bitmap = LLOG_HDR_BITMAP(llh);
+		loff_t	 word_off;
 
 		/* Note: If this is not initialization (size == 0), then do not
 		 * write the whole header (8k bytes), only update header/tail
@@ -644,21 +655,33 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		 * updates into the update log(32KB limit) and also pack inside
 		 * the RPC (1MB limit), if we write 8K for each operation, which
 		 * will cost a lot space, and keep us adding more updates to one
-		 * update log.*/
+		 * update log.
+		 * For a local llog the bitmap word is written along with the
+		 * header when both are in the first page, which saves one of
+		 * the writes done under lgh_last_sem for each record. */
+		word_off = llh->llh_bitmap_offset +
+			   (index / (sizeof(*bitmap) * 8)) * sizeof(*bitmap);
 		lgi->lgi_off = 0;
-		lgi->lgi_buf.lb_len = llh->llh_bitmap_offset;
 		lgi->lgi_buf.lb_buf = &llh->llh_hdr;
+		if (!dt_object_remote(o) &&
+		    word_off + sizeof(*bitmap) <= PAGE_SIZE)
+			lgi->lgi_buf.lb_len = word_off + sizeof(*bitmap);
+		else
+			lgi->lgi_buf.lb_len = llh->llh_bitmap_offset;
 		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
 		if (rc != 0)
 			GOTO(out_unlock, rc);
 
-		lgi->lgi_off = llh->llh_bitmap_offset +
-			      (index / (sizeof(*bitmap) * 8)) * sizeof(*bitmap);
-		lgi->lgi_buf.lb_len = sizeof(*bitmap);
-		lgi->lgi_buf.lb_buf = &bitmap[index/(sizeof(*bitmap)*8)];
-		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
-		if (rc != 0)
-			GOTO(out_unlock, rc);
+		if (lgi->lgi_off <= word_off) {
+			lgi->lgi_off = word_off;
+			lgi->lgi_buf.lb_len = sizeof(*bitmap);
+			lgi->lgi_buf.lb_buf =
+				&bitmap[index / (sizeof(*bitmap) * 8)];
+			rc = dt_record_write(env, o, &lgi->lgi_buf,
+					     &lgi->lgi_off, th);
+			if (rc != 0)
+				GOTO(out_unlock, rc);
+		}
 
 		lgi->lgi_off =  (unsigned long)LLOG_HDR_TAIL(llh) -
 				(unsigned long)llh;
@@ -685,6 +708,10 @@ out_unlock:
 	 * records. This also allows to handle Catalog wrap around case */
 	if (llh->llh_flags & LLOG_F_IS_FIXSIZE) {
 		lgi->lgi_off = llh->llh_hdr.lrh_len + (index - 1) * reclen;
+	} else if (!dt_object_remote(o)) {
+		/* appends are exclusive, nobody could have changed the size
+		 * of a local llog since dt_attr_get() above */
+		lgi->lgi_off = rec_off;
 	} else {
 		rc = dt_attr_get(env, o, &lgi->lgi_attr);
 		if (rc)
@@ -856,6 +883,74 @@ static void changelog_block_trim_ext(struct llog_rec_hdr *hdr,
 	} while ((char *)hdr <= (char *)last_hdr);
 }
 
+/**
+ * Read a block of the llog for llog_osd_next_block().
+ *
+ * When the llog is processed sequentially (see llog_process_thread()) the
+ * complete chunks after the one wanted are read with it in one read of up
+ * to LLOG_READ_AHEAD_SIZE bytes, and the next blocks are copied from them.
+ * Only the chunks below the last one are read ahead: records are appended
+ * to the last chunk only, so the complete chunks can't change but by a
+ * modification through this handle, which drops the window.
+ *
+ * \param[in] env		execution environment
+ * \param[in] loghandle	llog handle of the current llog
+ * \param[in] lb		buffer to read the block into
+ * \param[in,out] off		offset of the block, moved past the read
+ * \param[in] size		size of the llog
+ *
+ * \retval			number of bytes read
+ * \retval			negative error if the read failed
+ */
+static int llog_osd_read_block(const struct lu_env *env,
+			       struct llog_handle *loghandle,
+			       struct lu_buf *lb, __u64 *off, __u64 size)
+{
+	struct llog_read_ahead *ra = llog_info(env)->lgi_ra;
+	struct dt_object *o = loghandle->lgh_obj;
+	__u32 chunk_size = loghandle->lgh_hdr->llh_hdr.lrh_len;
+	struct lu_buf rab;
+	loff_t pos;
+	__u64 end;
+	int rc;
+
+	if (ra == NULL || ra->lra_handle != loghandle ||
+	    dt_object_remote(o) || chunk_size * 2 > LLOG_READ_AHEAD_SIZE)
+		return dt_read(env, o, lb, off);
+
+	if (*off >= ra->lra_offset &&
+	    *off + lb->lb_len <= ra->lra_offset + ra->lra_len)
+		goto copy;
+
+	ra->lra_len = 0;
+	pos = *off & ~((__u64)chunk_size - 1);
+	end = min_t(__u64, pos + LLOG_READ_AHEAD_SIZE,
+		    size & ~((__u64)chunk_size - 1));
+	/* nothing to read ahead, the next chunk is not complete yet */
+	if (end <= pos + chunk_size)
+		return dt_read(env, o, lb, off);
+
+	if (ra->lra_buf == NULL) {
+		OBD_ALLOC_LARGE(ra->lra_buf, LLOG_READ_AHEAD_SIZE);
+		if (ra->lra_buf == NULL)
+			return dt_read(env, o, lb, off);
+	}
+
+	ra->lra_offset = pos;
+	rab.lb_buf = ra->lra_buf;
+	rab.lb_len = end - pos;
+	rc = dt_read(env, o, &rab, &pos);
+	if (rc < 0)
+		return dt_read(env, o, lb, off);
+	ra->lra_len = rc;
+	if (*off + lb->lb_len > ra->lra_offset + ra->lra_len)
+		return dt_read(env, o, lb, off);
+copy:
+	memcpy(lb->lb_buf, ra->lra_buf + (*off - ra->lra_offset), lb->lb_len);
+	*off += lb->lb_len;
+	return lb->lb_len;
+}
+
 /**
  * Implementation of the llog_operations::lop_next_block
  *
@@ -926,7 +1021,8 @@ static int llog_osd_next_block(const struct lu_env *env,
 				      (*cur_offset & (chunk_size - 1));
 		lgi->lgi_buf.lb_buf = buf;
 
-		rc = dt_read(env, o, &lgi->lgi_buf, cur_offset);
+		rc = llog_osd_read_block(env, loghandle, &lgi->lgi_buf,
+					 cur_offset, lgi->lgi_attr.la_size);
 		if (rc < 0) {
 			if (rc == -EBADR && !force_mini_rec)
 				goto retry;
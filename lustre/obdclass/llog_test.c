@@ -2096,6 +2096,179 @@ ctxt_release:
 	RETURN(rc);
 }
 
+static int llog_test_11_cb(const struct lu_env *env, struct llog_handle *llh,
+			   struct llog_rec_hdr *rec, void *data)
+{
+	int *count = data;
+
+	(*count)++;
+	RETURN(0);
+}
+
+/* Measure the rate of the sequential processing of a plain llog */
+static int llog_test_11(const struct lu_env *env, struct obd_device *obd)
+{
+	struct llog_handle *llh;
+	struct llog_ctxt *ctxt;
+	struct llog_rec_hdr *rec;
+	ktime_t start;
+	s64 usecs;
+	int rc, rc2, i, count = 0, num_recs = 0;
+	char *buf;
+
+	ENTRY;
+
+	ctxt = llog_get_context(obd, LLOG_TEST_ORIG_CTXT);
+	LASSERT(ctxt);
+
+	OBD_ALLOC(buf, 128);
+	if (buf == NULL)
+		GOTO(ctxt_release, rc = -ENOMEM);
+
+	CWARN("11a: create a plain log\n");
+	rc = llog_open_create(env, ctxt, &llh, NULL, NULL);
+	if (rc) {
+		CERROR("11a: create log failed: %d\n", rc);
+		GOTO(out_free, rc);
+	}
+	rc = llog_init_handle(env, llh, LLOG_F_IS_PLAIN, &uuid);
+	if (rc) {
+		CERROR("11a: can't init llog handle: %d\n", rc);
+		GOTO(out_close, rc);
+	}
+
+	CWARN("11b: write %d records of 128 bytes\n", llog_test_recnum);
+	rec = (struct llog_rec_hdr *)buf;
+	for (i = 0; i < llog_test_recnum; i++) {
+		rec->lrh_len = 128;
+		rec->lrh_type = OBD_CFG_REC;
+		rc = llog_write(env, llh, rec, LLOG_NEXT_IDX);
+		/* the llog is full */
+		if (rc == -ENOSPC && num_recs > 0)
+			break;
+		if (rc < 0) {
+			CERROR("11b: write records failed at #%d: %d\n",
+			       i + 1, rc);
+			GOTO(out_destroy, rc);
+		}
+		num_recs++;
+	}
+
+	CWARN("11c: process %d records\n", num_recs);
+	start = ktime_get();
+	rc = llog_process(env, llh, llog_test_11_cb, &count, NULL);
+	usecs = ktime_us_delta(ktime_get(), start);
+	if (rc) {
+		CERROR("11c: process failed: %d\n", rc);
+		GOTO(out_destroy, rc);
+	}
+	if (count != num_recs) {
+		CERROR("11c: processed %d records, expected %d\n",
+		       count, num_recs);
+		GOTO(out_destroy, rc = -ERANGE);
+	}
+	CWARN("11c: processed %d records in %lldus, %llu records/s\n",
+	      count, usecs, div64_u64((u64)count * USEC_PER_SEC,
+				      max_t(s64, usecs, 1)));
+
+out_destroy:
+	rc2 = llog_destroy(env, llh);
+	if (rc2) {
+		CERROR("11: destroy log failed: %d\n", rc2);
+		if (rc == 0)
+			rc = rc2;
+	}
+out_close:
+	llog_close(env, llh);
+out_free:
+	OBD_FREE(buf, 128);
+ctxt_release:
+	llog_ctxt_put(ctxt);
+	RETURN(rc);
+}
+
+static atomic_t llog_test_12_count;
+
+static int llog_test_12_cb(const struct lu_env *env, struct llog_handle *llh,
+			   struct llog_rec_hdr *rec, void *data)
+{
+	atomic_inc(&llog_test_12_count);
+	RETURN(LLOG_DEL_RECORD);
+}
+
+/* Test catalog processing by several threads */
+static int llog_test_12(const struct lu_env *env, struct obd_device *obd)
+{
+	struct llog_handle *cath;
+	struct llog_mini_rec lmr;
+	struct llog_ctxt *ctxt;
+	char name[10];
+	int rc, rc2, i, num_recs;
+
+	ENTRY;
+
+	ctxt = llog_get_context(obd, LLOG_TEST_ORIG_CTXT);
+	LASSERT(ctxt);
+
+	lmr.lmr_hdr.lrh_len = lmr.lmr_tail.lrt_len = LLOG_MIN_REC_SIZE;
+	lmr.lmr_hdr.lrh_type = 0xf00f00;
+
+	snprintf(name, sizeof(name), "%x", llog_test_rand + 3);
+	CWARN("12a: create a catalog log with name: %s\n", name);
+	rc = llog_open_create(env, ctxt, &cath, NULL, name);
+	if (rc) {
+		CERROR("12a: llog_create with name %s failed: %d\n", name, rc);
+		GOTO(ctxt_release, rc);
+	}
+	rc = llog_init_handle(env, cath, LLOG_F_IS_CAT, &uuid);
+	if (rc) {
+		CERROR("12a: can't init llog handle: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	num_recs = llog_test_recnum * 2;
+	CWARN("12b: write %d log records\n", num_recs);
+	for (i = 0; i < num_recs; i++) {
+		rc = llog_cat_add(env, cath, &lmr.lmr_hdr, NULL);
+		if (rc) {
+			CERROR("12b: write %d records failed at #%d: %d\n",
+			       num_recs, i + 1, rc);
+			GOTO(out, rc);
+		}
+	}
+
+	CWARN("12c: process and cancel the records with 4 threads\n");
+	atomic_set(&llog_test_12_count, 0);
+	rc = llog_cat_process_parallel(env, cath, llog_test_12_cb, NULL, 0, 4);
+	if (rc) {
+		CERROR("12c: process with 4 threads failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+	if (atomic_read(&llog_test_12_count) != num_recs) {
+		CERROR("12c: processed %d records, expected %d\n",
+		       atomic_read(&llog_test_12_count), num_recs);
+		GOTO(out, rc = -ERANGE);
+	}
+
+	/* the empty plain logs are destroyed, but the current one */
+	if (cath->lgh_hdr->llh_count > 2) {
+		CERROR("12c: %d plain logs left in the catalog\n",
+		       cath->lgh_hdr->llh_count - 1);
+		GOTO(out, rc = -ERANGE);
+	}
+out:
+	CWARN("12d: put newly-created catalog\n");
+	rc2 = llog_cat_close(env, cath);
+	if (rc2) {
+		CERROR("12: close log %s failed: %d\n", name, rc2);
+		if (rc == 0)
+			rc = rc2;
+	}
+ctxt_release:
+	llog_ctxt_put(ctxt);
+	RETURN(rc);
+}
+
 /*
  * -------------------------------------------------------------------------
  * Tests above, boring obd functions below
@@ -2154,6 +2327,14 @@ static int llog_run_tests(const struct lu_env *env, struct obd_device *obd)
 	if (rc)
 		GOTO(cleanup, rc);
 
+	rc = llog_test_11(env, obd);
+	if (rc)
+		GOTO(cleanup, rc);
+
+	rc = llog_test_12(env, obd);
+	if (rc)
+		GOTO(cleanup, rc);
+
 cleanup:
 	err = llog_destroy(env, llh);
 	if (err)
@@ -236,6 +236,15 @@ static void lprocfs_job_cleanup(struct obd_job_stats *stats, int before)
 	write_unlock(&stats->ojs_lock);
 }
 
+/* Expire the old jobstats out of the threads handling the requests. */
+static void lprocfs_job_cleanup_work(struct work_struct *work)
+{
+	struct obd_job_stats *stats;
+
+	stats = container_of(work, struct obd_job_stats, ojs_cleanup_work);
+	lprocfs_job_cleanup(stats, stats->ojs_cleanup_interval);
+}
+
 static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 {
 	struct job_stat *job;
@@ -288,7 +297,11 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 	if (job)
 		goto found;
 
-	lprocfs_job_cleanup(stats, stats->ojs_cleanup_interval);
+	/* walking all the jobs can take long, don't stall this request */
+	if (stats->ojs_cleanup_interval != 0 &&
+	    ktime_get_real_seconds() >= stats->ojs_last_cleanup +
+					stats->ojs_cleanup_interval / 2)
+		schedule_work(&stats->ojs_cleanup_work);
 
 	job = job_alloc(jobid, stats);
 	if (job == NULL)
@@ -329,6 +342,7 @@ void lprocfs_job_stats_fini(struct obd_device *obd)
 	if (stats->ojs_hash == NULL)
 		return;
 
+	cancel_work_sync(&stats->ojs_cleanup_work);
 	lprocfs_job_cleanup(stats, -99);
 	cfs_hash_putref(stats->ojs_hash);
 	stats->ojs_hash = NULL;
@@ -336,15 +350,36 @@ void lprocfs_job_stats_fini(struct obd_device *obd)
 }
 EXPORT_SYMBOL(lprocfs_job_stats_fini);
 
+/* state of an open job_stats file */
+struct jobstats_seq {
+	struct obd_job_stats	*jss_stats;
+	/* job the previous read stopped at, with a reference that keeps it
+	 * on ojs_list, and its position in the file */
+	struct job_stat		*jss_cursor;
+	loff_t			 jss_cursor_pos;
+	/* position of the last job returned by start() or next() */
+	loff_t			 jss_pos;
+	/* counters of the job being printed */
+	struct lprocfs_counter	 jss_cntr[0];
+};
+
 static void *lprocfs_jobstats_seq_start(struct seq_file *p, loff_t *pos)
 {
-	struct obd_job_stats *stats = p->private;
+	struct jobstats_seq *jss = p->private;
+	struct obd_job_stats *stats = jss->jss_stats;
 	loff_t off = *pos;
 	struct job_stat *job;
 
 	read_lock(&stats->ojs_lock);
+	jss->jss_pos = off;
 	if (off == 0)
 		return SEQ_START_TOKEN;
+
+	/* carry on from the previous read, instead of walking the list from
+	 * its start once per page of output */
+	if (jss->jss_cursor != NULL && jss->jss_cursor_pos == off)
+		return jss->jss_cursor;
+
 	off--;
 	list_for_each_entry(job, &stats->ojs_list, js_list) {
 		if (!off--)
@@ -355,18 +390,38 @@ static void *lprocfs_jobstats_seq_start(struct seq_file *p, loff_t *pos)
 
 static void lprocfs_jobstats_seq_stop(struct seq_file *p, void *v)
 {
-	struct obd_job_stats *stats = p->private;
-
+	struct jobstats_seq *jss = p->private;
+	struct obd_job_stats *stats = jss->jss_stats;
+	struct job_stat *old = jss->jss_cursor;
+	struct job_stat *job = v;
+
+	if (v == NULL || v == SEQ_START_TOKEN) {
+		jss->jss_cursor = NULL;
+	} else if (job == old) {
+		old = NULL;
+		jss->jss_cursor_pos = jss->jss_pos;
+	} else if (atomic_inc_not_zero(&job->js_refcount)) {
+		/* not when job_free() is waiting for ojs_lock */
+		jss->jss_cursor = job;
+		jss->jss_cursor_pos = jss->jss_pos;
+	} else {
+		jss->jss_cursor = NULL;
+	}
 	read_unlock(&stats->ojs_lock);
+
+	if (old != NULL)
+		job_putref(old);
 }
 
 static void *lprocfs_jobstats_seq_next(struct seq_file *p, void *v, loff_t *pos)
 {
-	struct obd_job_stats *stats = p->private;
+	struct jobstats_seq *jss = p->private;
+	struct obd_job_stats *stats = jss->jss_stats;
 	struct job_stat *job;
 	struct list_head *next;
 
 	++*pos;
+	jss->jss_pos = *pos;
 	if (v == SEQ_START_TOKEN) {
 		next = stats->ojs_list.next;
 	} else {
@@ -420,9 +475,10 @@ static int inline width(const char *str, int len)
 
 static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 {
+	struct jobstats_seq		*jss = p->private;
 	struct job_stat			*job = v;
 	struct lprocfs_stats		*s;
-	struct lprocfs_counter		ret;
+	struct lprocfs_counter		*ret;
 	struct lprocfs_counter_header	*cntr_header;
 	int				i;
 
@@ -445,27 +501,28 @@ static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 	seq_printf(p, "  %-16s %lld\n", "snapshot_time:", job->js_timestamp);
 
 	s = job->js_stats;
+	lprocfs_stats_collect_all(s, jss->jss_cntr);
 	for (i = 0; i < s->ls_num; i++) {
 		cntr_header = &s->ls_cnt_header[i];
-		lprocfs_stats_collect(s, i, &ret);
+		ret = &jss->jss_cntr[i];
 
 		seq_printf(p, "  %s:%.*s { samples: %11llu",
 			   cntr_header->lc_name,
 			   width(cntr_header->lc_name, 15), spaces,
-			   ret.lc_count);
+			   ret->lc_count);
 		if (cntr_header->lc_units[0] != '\0')
 			seq_printf(p, ", unit: %5s", cntr_header->lc_units);
 
 		if (cntr_header->lc_config & LPROCFS_CNTR_AVGMINMAX) {
 			seq_printf(p, ", min:%8llu, max:%8llu,"
 				   " sum:%16llu",
-				   ret.lc_count ? ret.lc_min : 0,
-				   ret.lc_count ? ret.lc_max : 0,
-				   ret.lc_count ? ret.lc_sum : 0);
+				   ret->lc_count ? ret->lc_min : 0,
+				   ret->lc_count ? ret->lc_max : 0,
+				   ret->lc_count ? ret->lc_sum : 0);
 		}
 		if (cntr_header->lc_config & LPROCFS_CNTR_STDDEV) {
 			seq_printf(p, ", sumsq: %18llu",
-				   ret.lc_count ? ret.lc_sumsquare : 0);
+				   ret->lc_count ? ret->lc_sumsquare : 0);
 		}
 
 		seq_printf(p, " }\n");
@@ -483,6 +540,8 @@ static const struct seq_operations lprocfs_jobstats_seq_sops = {
 
 static int lprocfs_jobstats_seq_open(struct inode *inode, struct file *file)
 {
+	struct obd_job_stats *stats = PDE_DATA(inode);
+	struct jobstats_seq *jss;
 	struct seq_file *seq;
 	int rc;
 
@@ -490,11 +549,19 @@ static int lprocfs_jobstats_seq_open(struct inode *inode, struct file *file)
 	if (rc < 0)
 		return rc;
 
+	OBD_ALLOC(jss, offsetof(typeof(*jss), jss_cntr[stats->ojs_cntr_num]));
+	if (jss == NULL)
+		return -ENOMEM;
+	jss->jss_stats = stats;
+
 	rc = seq_open(file, &lprocfs_jobstats_seq_sops);
-	if (rc)
+	if (rc) {
+		OBD_FREE(jss,
+			 offsetof(typeof(*jss), jss_cntr[stats->ojs_cntr_num]));
 		return rc;
+	}
 	seq = file->private_data;
-	seq->private = PDE_DATA(inode);
+	seq->private = jss;
 	return 0;
 }
 
@@ -503,7 +570,8 @@ static ssize_t lprocfs_jobstats_seq_write(struct file *file,
 					  size_t len, loff_t *off)
 {
 	struct seq_file *seq = file->private_data;
-	struct obd_job_stats *stats = seq->private;
+	struct jobstats_seq *jss = seq->private;
+	struct obd_job_stats *stats = jss->jss_stats;
 	char jobid[LUSTRE_JOBID_SIZE];
 	struct job_stat *job;
 
@@ -555,7 +623,12 @@ static ssize_t lprocfs_jobstats_seq_write(struct file *file,
 static int lprocfs_jobstats_seq_release(struct inode *inode, struct file *file)
 {
 	struct seq_file *seq = file->private_data;
-	struct obd_job_stats *stats = seq->private;
+	struct jobstats_seq *jss = seq->private;
+	struct obd_job_stats *stats = jss->jss_stats;
+
+	if (jss->jss_cursor != NULL)
+		job_putref(jss->jss_cursor);
+	OBD_FREE(jss, offsetof(typeof(*jss), jss_cntr[stats->ojs_cntr_num]));
 
 	lprocfs_job_cleanup(stats, stats->ojs_cleanup_interval);
 
@@ -614,6 +687,7 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 	stats->ojs_cntr_init_fn = init_fn;
 	stats->ojs_cleanup_interval = 600; /* 10 mins by default */
 	stats->ojs_last_cleanup = ktime_get_real_seconds();
+	INIT_WORK(&stats->ojs_cleanup_work, lprocfs_job_cleanup_work);
 
 	entry = lprocfs_add_simple(obd->obd_proc_entry, "job_stats", stats,
 				   &lprocfs_jobstats_seq_fops);
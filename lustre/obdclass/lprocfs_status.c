@@ -686,6 +686,48 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
 	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
 }
 
+/**
+ * Add up the per-cpu counters of all the \a stats->ls_num counters of
+ * \a stats into \a cnt, in one pass over the per-cpu areas, and with the
+ * lock of the stats without per-cpu areas taken only once.
+ */
+void lprocfs_stats_collect_all(struct lprocfs_stats *stats,
+			       struct lprocfs_counter *cnt)
+{
+	struct lprocfs_counter *percpu_cntr;
+	unsigned int num_entry;
+	unsigned long flags = 0;
+	int i;
+	int j;
+
+	for (j = 0; j < stats->ls_num; j++) {
+		memset(&cnt[j], 0, sizeof(cnt[j]));
+		cnt[j].lc_min = LC_MIN_INIT;
+	}
+
+	num_entry = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
+
+	for (i = 0; i < num_entry; i++) {
+		if (!stats->ls_percpu[i])
+			continue;
+
+		for (j = 0; j < stats->ls_num; j++) {
+			percpu_cntr = lprocfs_stats_counter_get(stats, i, j);
+
+			cnt[j].lc_count += percpu_cntr->lc_count;
+			cnt[j].lc_sum += percpu_cntr->lc_sum;
+			if (percpu_cntr->lc_min < cnt[j].lc_min)
+				cnt[j].lc_min = percpu_cntr->lc_min;
+			if (percpu_cntr->lc_max > cnt[j].lc_max)
+				cnt[j].lc_max = percpu_cntr->lc_max;
+			cnt[j].lc_sumsquare += percpu_cntr->lc_sumsquare;
+		}
+	}
+
+	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
+}
+EXPORT_SYMBOL(lprocfs_stats_collect_all);
+
 static void obd_import_flags2str(struct obd_import *imp, struct seq_file *m)
 {
 	bool first = true;
@@ -791,6 +833,19 @@ static const char *obd_connect_names[] = {
 	"client_encryption",	/* 0x8000 */
 	"fidmap",		/* 0x10000 */
 	"getattr_pfid",		/* 0x20000 */
+	"unknown",		/* 0x40000 */
+	"unknown",		/* 0x80000 */
+	"unknown",		/* 0x100000 */
+	"unknown",		/* 0x200000 */
+	"batch_rpc",		/* 0x400000 */
+	"shared_ping",		/* 0x800000 */
+	"bl_ast_batch",		/* 0x1000000 */
+	"t10_guards",		/* 0x2000000 */
+	"compress",		/* 0x4000000 */
+	"strict_som",		/* 0x8000000 */
+	"dom_read_head",	/* 0x10000000 */
+	"batch_sync",		/* 0x20000000 */
+	"conn_window",		/* 0x40000000 */
 	NULL
 };
 
@@ -922,6 +977,10 @@ obd_connect_data_seqprint(struct seq_file *m, struct obd_connect_data *ocd)
 	if (flags & OBD_CONNECT_MULTIMODRPCS)
 		seq_printf(m, "       max_mod_rpcs: %hu\n",
 			   ocd->ocd_maxmodrpcs);
+	if (flags & OBD_CONNECT_FLAGS2 &&
+	    ocd->ocd_connect_flags2 & OBD_CONNECT2_CONN_WINDOW)
+		seq_printf(m, "       conn_window: %u\n",
+			   ocd->ocd_conn_window);
 }
 
 int lprocfs_import_seq_show(struct seq_file *m, void *data)
@@ -1475,21 +1534,38 @@ void lprocfs_clear_stats(struct lprocfs_stats *stats)
 }
 EXPORT_SYMBOL(lprocfs_clear_stats);
 
+/*
+ * Counters of a stats file, added up once for the whole file when it is read
+ * from its start, so that the counters printed are from the same time, and
+ * the per-cpu areas are neither walked nor locked once per counter.
+ */
+struct lprocfs_stats_snapshot {
+	struct lprocfs_stats	*lss_stats;
+	struct timespec64	 lss_time;
+	struct lprocfs_counter	 lss_cntr[0];
+};
+
 static ssize_t lprocfs_stats_seq_write(struct file *file,
 				       const char __user *buf,
 				       size_t len, loff_t *off)
 {
 	struct seq_file *seq = file->private_data;
-	struct lprocfs_stats *stats = seq->private;
+	struct lprocfs_stats_snapshot *snap = seq->private;
 
-	lprocfs_clear_stats(stats);
+	lprocfs_clear_stats(snap->lss_stats);
 
 	return len;
 }
 
 static void *lprocfs_stats_seq_start(struct seq_file *p, loff_t *pos)
 {
-	struct lprocfs_stats *stats = p->private;
+	struct lprocfs_stats_snapshot *snap = p->private;
+	struct lprocfs_stats *stats = snap->lss_stats;
+
+	if (*pos == 0) {
+		ktime_get_real_ts64(&snap->lss_time);
+		lprocfs_stats_collect_all(stats, snap->lss_cntr);
+	}
 
 	return (*pos < stats->ls_num) ? pos : NULL;
 }
@@ -1508,33 +1584,31 @@ static void *lprocfs_stats_seq_next(struct seq_file *p, void *v, loff_t *pos)
 /* seq file export of one lprocfs counter */
 static int lprocfs_stats_seq_show(struct seq_file *p, void *v)
 {
-	struct lprocfs_stats *stats = p->private;
+	struct lprocfs_stats_snapshot *snap = p->private;
+	struct lprocfs_stats *stats = snap->lss_stats;
 	struct lprocfs_counter_header *hdr;
-	struct lprocfs_counter ctr;
+	struct lprocfs_counter *ctr;
 	int idx = *(loff_t *)v;
 
-	if (idx == 0) {
-		struct timespec64 now;
-
-		ktime_get_real_ts64(&now);
+	if (idx == 0)
 		seq_printf(p, "%-25s %llu.%09lu secs.nsecs\n",
-			   "snapshot_time", (s64)now.tv_sec, now.tv_nsec);
-	}
+			   "snapshot_time", (s64)snap->lss_time.tv_sec,
+			   snap->lss_time.tv_nsec);
 
 	hdr = &stats->ls_cnt_header[idx];
-	lprocfs_stats_collect(stats, idx, &ctr);
+	ctr = &snap->lss_cntr[idx];
 
-	if (ctr.lc_count == 0)
+	if (ctr->lc_count == 0)
 		return 0;
 
 	seq_printf(p, "%-25s %lld samples [%s]", hdr->lc_name,
-		   ctr.lc_count, hdr->lc_units);
+		   ctr->lc_count, hdr->lc_units);
 
-	if ((hdr->lc_config & LPROCFS_CNTR_AVGMINMAX) && ctr.lc_count > 0) {
+	if ((hdr->lc_config & LPROCFS_CNTR_AVGMINMAX) && ctr->lc_count > 0) {
 		seq_printf(p, " %lld %lld %lld",
-			   ctr.lc_min, ctr.lc_max, ctr.lc_sum);
+			   ctr->lc_min, ctr->lc_max, ctr->lc_sum);
 		if (hdr->lc_config & LPROCFS_CNTR_STDDEV)
-			seq_printf(p, " %llu", ctr.lc_sumsquare);
+			seq_printf(p, " %llu", ctr->lc_sumsquare);
 	}
 	seq_putc(p, '\n');
 	return 0;
@@ -1549,28 +1623,51 @@ static const struct seq_operations lprocfs_stats_seq_sops = {
 
 static int lprocfs_stats_seq_open(struct inode *inode, struct file *file)
 {
+	struct lprocfs_stats_snapshot *snap;
+	struct lprocfs_stats *stats;
 	struct seq_file *seq;
+	int size;
 	int rc;
 
 	rc = LPROCFS_ENTRY_CHECK(inode);
 	if (rc < 0)
 		return rc;
 
+	stats = inode->i_private ? inode->i_private : PDE_DATA(inode);
+	size = offsetof(typeof(*snap), lss_cntr[stats->ls_num]);
+	OBD_ALLOC_LARGE(snap, size);
+	if (!snap)
+		return -ENOMEM;
+	snap->lss_stats = stats;
+
 	rc = seq_open(file, &lprocfs_stats_seq_sops);
-	if (rc)
+	if (rc) {
+		OBD_FREE_LARGE(snap, size);
 		return rc;
+	}
 	seq = file->private_data;
-	seq->private = inode->i_private ? inode->i_private : PDE_DATA(inode);
+	seq->private = snap;
 	return 0;
 }
 
+static int lprocfs_stats_seq_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *seq = file->private_data;
+	struct lprocfs_stats_snapshot *snap = seq->private;
+
+	OBD_FREE_LARGE(snap, offsetof(typeof(*snap),
+				      lss_cntr[snap->lss_stats->ls_num]));
+
+	return lprocfs_seq_release(inode, file);
+}
+
 static const struct file_operations lprocfs_stats_seq_fops = {
 	.owner   = THIS_MODULE,
 	.open    = lprocfs_stats_seq_open,
 	.read    = seq_read,
 	.write   = lprocfs_stats_seq_write,
 	.llseek  = seq_lseek,
-	.release = lprocfs_seq_release,
+	.release = lprocfs_stats_seq_release,
 };
 
 int ldebugfs_register_stats(struct dentry *parent, const char *name,
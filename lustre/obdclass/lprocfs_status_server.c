@@ -397,6 +397,31 @@ int lprocfs_exp_replydata_seq_show(struct seq_file *m, void *data)
 }
 LPROC_SEQ_FOPS_RO(lprocfs_exp_replydata);
 
+static int
+lprocfs_exp_print_lock_count_seq(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				 struct hlist_node *hnode, void *cb_data)
+
+{
+	struct obd_export *exp = cfs_hash_object(hs, hnode);
+	struct seq_file *m = cb_data;
+
+	if (exp->exp_lock_hash != NULL)
+		seq_printf(m, "%s: %llu\n", obd_uuid2str(&exp->exp_client_uuid),
+			   cfs_hash_size_get(exp->exp_lock_hash));
+	return 0;
+}
+
+static int lprocfs_exp_lock_count_seq_show(struct seq_file *m, void *data)
+{
+	struct nid_stat *stats = m->private;
+	struct obd_device *obd = stats->nid_obd;
+
+	cfs_hash_for_each_key(obd->obd_nid_hash, &stats->nid,
+			      lprocfs_exp_print_lock_count_seq, m);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(lprocfs_exp_lock_count);
+
 int lprocfs_exp_print_fmd_count_seq(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 				    struct hlist_node *hnode, void *cb_data)
 
@@ -587,6 +612,15 @@ int lprocfs_exp_setup(struct obd_export *exp, lnet_nid_t *nid)
 		GOTO(destroy_new_ns, rc);
 	}
 
+	entry = lprocfs_add_simple(new_stat->nid_proc, "lock_count", new_stat,
+				   &lprocfs_exp_lock_count_fops);
+	if (IS_ERR(entry)) {
+		rc = PTR_ERR(entry);
+		CWARN("%s: error adding the lock_count file: rc = %d\n",
+		      obd->obd_name, rc);
+		GOTO(destroy_new_ns, rc);
+	}
+
 	entry = lprocfs_add_simple(new_stat->nid_proc, "fmd_count", new_stat,
 				   &lprocfs_exp_fmd_count_fops);
 	if (IS_ERR(entry)) {
@@ -810,6 +844,70 @@ lprocfs_ir_factor_seq_write(struct file *file, const char __user *buffer,
 }
 EXPORT_SYMBOL(lprocfs_ir_factor_seq_write);
 
+int lprocfs_conn_limit_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+
+	LASSERT(obd != NULL);
+	seq_printf(m, "%d\n", obd->obd_conn_limit);
+	return 0;
+}
+EXPORT_SYMBOL(lprocfs_conn_limit_seq_show);
+
+ssize_t
+lprocfs_conn_limit_seq_write(struct file *file, const char __user *buffer,
+			     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	unsigned int val;
+	int rc;
+
+	LASSERT(obd != NULL);
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	obd->obd_conn_limit = val;
+	return count;
+}
+EXPORT_SYMBOL(lprocfs_conn_limit_seq_write);
+
+int lprocfs_conn_window_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+
+	LASSERT(obd != NULL);
+	seq_printf(m, "%d\n", obd->obd_conn_window);
+	return 0;
+}
+EXPORT_SYMBOL(lprocfs_conn_window_seq_show);
+
+ssize_t
+lprocfs_conn_window_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	unsigned int val;
+	int rc;
+
+	LASSERT(obd != NULL);
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	obd->obd_conn_window = val;
+	return count;
+}
+EXPORT_SYMBOL(lprocfs_conn_window_seq_write);
+
 int lprocfs_checksum_dump_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
@@ -55,12 +55,16 @@
 
 struct lu_site_bkt_data {
 	/**
-	 * LRU list, updated on each access to object. Protected by
-	 * bucket lock of lu_site::ls_obj_hash.
+	 * LRU list, updated when the last reference on an object is dropped.
+	 * Protected by the write lock of the bucket of lu_site::ls_obj_hash.
 	 *
-	 * "Cold" end of LRU is lu_site::ls_lru.next. Accessed object are
+	 * "Cold" end of LRU is lu_site::ls_lru.next. Released object are
 	 * moved to the lu_site::ls_lru.prev (this is due to the non-existence
 	 * of list_for_each_entry_safe_reverse()).
+	 *
+	 * Lookups only hold the read lock of the bucket, and leave the objects
+	 * they find on the list, lu_site_purge_objects() takes the ones in use
+	 * off it.
 	 */
 	struct list_head		lsb_lru;
 	/**
@@ -190,9 +194,11 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 */
 	if (!lu_object_is_dying(top) &&
 	    (lu_object_exists(orig) || lu_object_is_cl(orig))) {
-		LASSERT(list_empty(&top->loh_lru));
-		list_add_tail(&top->loh_lru, &bkt->lsb_lru);
-		percpu_counter_inc(&site->ls_lru_len_counter);
+		/* still there if it was found in the cache, see
+		 * htable_lookup() */
+		if (list_empty(&top->loh_lru))
+			percpu_counter_inc(&site->ls_lru_len_counter);
+		list_move_tail(&top->loh_lru, &bkt->lsb_lru);
 		CDEBUG(D_INODE, "Add %p/%p to site lru. hash: %p, bkt: %p\n",
 		       orig, top, site->ls_obj_hash, bkt);
 		cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
@@ -210,6 +216,10 @@ void lu_object_put(const struct lu_env *env, struct lu_object *o)
 	 * and LRU lock, no race with concurrent object lookup is possible
 	 * and we can safely destroy object below.
 	 */
+	if (!list_empty(&top->loh_lru)) {
+		list_del_init(&top->loh_lru);
+		percpu_counter_dec(&site->ls_lru_len_counter);
+	}
 	if (!test_and_set_bit(LU_OBJECT_UNHASHED, &top->loh_flags))
 		cfs_hash_bd_del_locked(site->ls_obj_hash, &bd, &top->loh_hash);
 	cfs_hash_bd_unlock(site->ls_obj_hash, &bd, 1);
@@ -443,7 +453,17 @@ int lu_site_purge_objects(const struct lu_env *env, struct lu_site *s,
                 bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
 
 		list_for_each_entry_safe(h, temp, &bkt->lsb_lru, loh_lru) {
-			LASSERT(atomic_read(&h->loh_ref) == 0);
+			/*
+			 * Found by a lookup since it was released, it is put
+			 * back on the list by its last lu_object_put(). No
+			 * new reference can be taken on an unused object
+			 * without the bucket lock held here.
+			 */
+			if (atomic_read(&h->loh_ref) > 0) {
+				list_del_init(&h->loh_lru);
+				percpu_counter_dec(&s->ls_lru_len_counter);
+				continue;
+			}
 
                         cfs_hash_bd_get(s->ls_obj_hash, &h->loh_fid, &bd2);
                         LASSERT(bd.bd_bucket == bd2.bd_bucket);
@@ -659,12 +679,14 @@ static struct lu_object *htable_lookup(struct lu_site *s,
 	}
 
 	h = container_of0(hnode, struct lu_object_header, loh_hash);
+	/*
+	 * No LRU update, so that the lookups of the same objects by all the
+	 * service threads only need the read lock of the bucket. An unused
+	 * object stays on the LRU list when it is found, see
+	 * lu_site_purge_objects().
+	 */
 	cfs_hash_get(s->ls_obj_hash, hnode);
 	lprocfs_counter_incr(s->ls_stats, LU_SS_CACHE_HIT);
-	if (!list_empty(&h->loh_lru)) {
-		list_del_init(&h->loh_lru);
-		percpu_counter_dec(&s->ls_lru_len_counter);
-	}
 	return lu_object_top(h);
 }
 
@@ -682,11 +704,9 @@ struct lu_object *lu_object_find(const struct lu_env *env,
 EXPORT_SYMBOL(lu_object_find);
 
 /*
- * Limit the lu_object cache to a maximum of lu_cache_nr objects.  Because
- * the calculation for the number of objects to reclaim is not covered by
- * a lock the maximum number of objects is capped by LU_CACHE_MAX_ADJUST.
- * This ensures that many concurrent threads will not accidentally purge
- * the entire cache.
+ * Limit the lu_object cache to a maximum of lu_cache_nr objects.  The
+ * objects above the limit are purged by lu_site_purge_work(), so that the
+ * thread adding an object to the cache does not pay for it.
  */
 static void lu_object_limit(const struct lu_env *env,
 			    struct lu_device *dev)
@@ -701,8 +721,38 @@ static void lu_object_limit(const struct lu_env *env,
 	if (size <= nr)
 		return;
 
-	lu_site_purge_objects(env, dev->ld_site,
-			      MIN(size - nr, LU_CACHE_NR_MAX_ADJUST), 0);
+	schedule_work(&dev->ld_site->ls_purge_work);
+}
+
+/*
+ * Purge the objects above lu_cache_nr, at most LU_CACHE_NR_MAX_ADJUST at a
+ * time, so that the buckets are not locked for long, until the cache is
+ * back to its limit or its objects are all in use.
+ */
+static void lu_site_purge_work(struct work_struct *work)
+{
+	struct lu_site *s = container_of(work, struct lu_site, ls_purge_work);
+	struct lu_env env;
+	__u64 size, nr;
+	int count;
+
+	if (lu_env_init(&env, LCT_SHRINKER) != 0)
+		return;
+
+	while (lu_cache_nr != LU_CACHE_NR_UNLIMITED) {
+		size = cfs_hash_size_get(s->ls_obj_hash);
+		nr = (__u64)lu_cache_nr;
+		if (size <= nr)
+			break;
+
+		count = MIN(size - nr, LU_CACHE_NR_MAX_ADJUST);
+		if (lu_site_purge_objects(&env, s, count, 1) == count)
+			break;
+
+		cond_resched();
+	}
+
+	lu_env_fini(&env);
 }
 
 /**
@@ -763,9 +813,9 @@ struct lu_object *lu_object_find_at(const struct lu_env *env,
 	cfs_hash_bd_get(hs, f, &bd);
 	bkt = cfs_hash_bd_extra_get(s->ls_obj_hash, &bd);
 	if (!(conf && conf->loc_flags & LOC_F_NEW)) {
-		cfs_hash_bd_lock(hs, &bd, 1);
+		cfs_hash_bd_lock(hs, &bd, 0);
 		o = htable_lookup(s, &bd, f, &version);
-		cfs_hash_bd_unlock(hs, &bd, 1);
+		cfs_hash_bd_unlock(hs, &bd, 0);
 
 		if (!IS_ERR(o)) {
 			if (likely(lu_object_is_inited(o->lo_header)))
@@ -1099,6 +1149,7 @@ int lu_site_init(struct lu_site *s, struct lu_device *top)
 
 	memset(s, 0, sizeof *s);
 	mutex_init(&s->ls_purge_mutex);
+	INIT_WORK(&s->ls_purge_work, lu_site_purge_work);
 
 #ifdef HAVE_PERCPU_COUNTER_INIT_GFP_FLAG
 	rc = percpu_counter_init(&s->ls_lru_len_counter, 0, GFP_NOFS);
@@ -1115,7 +1166,7 @@ int lu_site_init(struct lu_site *s, struct lu_device *top)
 						 bits - LU_SITE_BKT_BITS,
 						 sizeof(*bkt), 0, 0,
 						 &lu_site_hash_ops,
-						 CFS_HASH_SPIN_BKTLOCK |
+						 CFS_HASH_RW_BKTLOCK |
 						 CFS_HASH_NO_ITEMREF |
 						 CFS_HASH_DEPTH |
 						 CFS_HASH_ASSERT_EMPTY |
@@ -1179,6 +1230,7 @@ void lu_site_fini(struct lu_site *s)
 	list_del_init(&s->ls_linkage);
 	up_write(&lu_sites_guard);
 
+	cancel_work_sync(&s->ls_purge_work);
 	percpu_counter_destroy(&s->ls_lru_len_counter);
 
         if (s->ls_obj_hash != NULL) {
@@ -1390,6 +1442,7 @@ void lu_stack_fini(const struct lu_env *env, struct lu_device *top)
         struct lu_device *scan;
         struct lu_device *next;
 
+	cancel_work_sync(&site->ls_purge_work);
         lu_site_purge(env, site, ~0);
         for (scan = top; scan != NULL; scan = next) {
                 next = scan->ld_type->ldt_ops->ldto_device_fini(env, scan);
@@ -1860,16 +1913,18 @@ EXPORT_SYMBOL(lu_context_exit);
  * Allocate for context all missing keys that were registered after context
  * creation. key_set_version is only changed in rare cases when modules
  * are loaded and removed.
+ *
+ * This is called for every cl_env_get() of a cached environment, so the
+ * version is checked without lu_keys_guard, which would otherwise bounce
+ * between all the CPUs doing IO. A change of the version racing with this
+ * check is caught by the next refill, as it was when the lock was dropped
+ * before keys_fill(); keys_fill() serializes with the key changes itself.
  */
 int lu_context_refill(struct lu_context *ctx)
 {
-	read_lock(&lu_keys_guard);
-	if (likely(ctx->lc_version == key_set_version)) {
-		read_unlock(&lu_keys_guard);
+	if (likely(ctx->lc_version == READ_ONCE(key_set_version)))
 		return 0;
-	}
 
-	read_unlock(&lu_keys_guard);
 	return keys_fill(ctx);
 }
 
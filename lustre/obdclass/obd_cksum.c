@@ -25,6 +25,7 @@
  *
  * Checksum functions
  */
+#include <linux/workqueue.h>
 #include <obd_class.h>
 #include <obd_cksum.h>
 
@@ -147,3 +148,251 @@ u32 obd_cksum_type_pack(const char *obd_name, enum cksum_types cksum_type)
 	return flag;
 }
 EXPORT_SYMBOL(obd_cksum_type_pack);
+
+/*
+ * Parallel checksums of bulk pages.
+ *
+ * The CRC32, CRC32C and Adler32 checksums of two buffers can be combined into
+ * the checksum of their concatenation, so large bulks are split into chunks
+ * checksummed by helper threads, and the checksums of the chunks are combined
+ * into the one of the bulk, which is the same as a sequential run would get.
+ */
+static unsigned int bulk_cksum_chunk = 256;
+module_param(bulk_cksum_chunk, uint, 0644);
+MODULE_PARM_DESC(bulk_cksum_chunk,
+		 "pages per parallel bulk checksum helper, 0 to disable");
+
+#define OBD_CKSUM_MAX_CHUNKS	16
+
+#define CRC32_POLY_LE		0xedb88320
+#define CRC32C_POLY_LE		0x82f63b78
+#define ADLER32_BASE		65521
+
+static struct workqueue_struct *obd_cksum_wq;
+
+/* x^(2^k) modulo the polynomials of CRC32 and CRC32C, for k = 0..31 */
+static u32 crc32_x2n[32];
+static u32 crc32c_x2n[32];
+
+struct obd_cksum_chunk {
+	struct work_struct	 occ_work;
+	obd_cksum_pages_fn	 occ_fn;
+	void			*occ_data;
+	int			 occ_start;
+	int			 occ_end;
+	/** bytes checksummed, or negative errno */
+	int			 occ_rc;
+	u32			 occ_cksum;
+	atomic_t		*occ_pending;
+	struct completion	*occ_done;
+};
+
+/* Multiply \a a and \a b modulo polynomial \a poly, all bit-reflected */
+static u32 crc_multmodp(u32 poly, u32 a, u32 b)
+{
+	u32 m = 1U << 31;
+	u32 p = 0;
+
+	for (;;) {
+		if (a & m) {
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ poly : b >> 1;
+	}
+	return p;
+}
+
+/* Return x^(8 * len) modulo polynomial \a poly, with x2n its powers table */
+static u32 crc_x8nmodp(u32 poly, const u32 *x2n, unsigned int len)
+{
+	u32 p = 1U << 31;	/* x^0 */
+	unsigned int k = 3;
+
+	while (len != 0) {
+		if (len & 1)
+			p = crc_multmodp(poly, x2n[k & 31], p);
+		len >>= 1;
+		k++;
+	}
+	return p;
+}
+
+static void crc_x2n_init(u32 poly, u32 *x2n)
+{
+	u32 p = 1U << 30;	/* x^1 */
+	int k;
+
+	x2n[0] = p;
+	for (k = 1; k < 32; k++)
+		x2n[k] = p = crc_multmodp(poly, p, p);
+}
+
+static u32 adler32_combine(u32 adler1, u32 adler2, unsigned int len2)
+{
+	unsigned int rem = len2 % ADLER32_BASE;
+	u32 sum1 = adler1 & 0xffff;
+	u32 sum2 = (u32)(((u64)rem * sum1) % ADLER32_BASE);
+
+	sum1 += (adler2 & 0xffff) + ADLER32_BASE - 1;
+	sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) +
+		ADLER32_BASE - rem;
+	if (sum1 >= ADLER32_BASE)
+		sum1 -= ADLER32_BASE;
+	if (sum1 >= ADLER32_BASE)
+		sum1 -= ADLER32_BASE;
+	if (sum2 >= ADLER32_BASE << 1)
+		sum2 -= ADLER32_BASE << 1;
+	if (sum2 >= ADLER32_BASE)
+		sum2 -= ADLER32_BASE;
+	return sum1 | (sum2 << 16);
+}
+
+static inline bool obd_cksum_combinable(enum cksum_types cksum_type)
+{
+	return cksum_type == OBD_CKSUM_CRC32 ||
+	       cksum_type == OBD_CKSUM_CRC32C ||
+	       cksum_type == OBD_CKSUM_ADLER;
+}
+
+/**
+ * Return the checksum of the concatenation of two buffers, from their
+ * checksums \a cksum1 and \a cksum2 of type \a cksum_type, as digests of
+ * the libcfs hashes, and the length \a len2 of the second one.
+ */
+u32 obd_cksum_combine(enum cksum_types cksum_type, u32 cksum1, u32 cksum2,
+		      unsigned int len2)
+{
+	u32 crc;
+
+	switch (cksum_type) {
+	case OBD_CKSUM_CRC32:
+		/* libcfs crc32 starts from ~0 without a final inversion */
+		crc = ~le32_to_cpu(cksum1);
+		crc = crc_multmodp(CRC32_POLY_LE,
+				   crc_x8nmodp(CRC32_POLY_LE, crc32_x2n, len2),
+				   crc);
+		return cpu_to_le32(crc ^ le32_to_cpu(cksum2));
+	case OBD_CKSUM_CRC32C:
+		crc = crc_multmodp(CRC32C_POLY_LE,
+				   crc_x8nmodp(CRC32C_POLY_LE, crc32c_x2n, len2),
+				   le32_to_cpu(cksum1));
+		return cpu_to_le32(crc ^ le32_to_cpu(cksum2));
+	case OBD_CKSUM_ADLER:
+		return adler32_combine(cksum1, cksum2, len2);
+	default:
+		LBUG();
+	}
+	return 0;
+}
+EXPORT_SYMBOL(obd_cksum_combine);
+
+static void obd_cksum_chunk_work(struct work_struct *work)
+{
+	struct obd_cksum_chunk *occ = container_of(work, struct obd_cksum_chunk,
+						   occ_work);
+
+	occ->occ_rc = occ->occ_fn(occ->occ_data, occ->occ_start, occ->occ_end,
+				  &occ->occ_cksum);
+	if (atomic_dec_and_test(occ->occ_pending))
+		complete(occ->occ_done);
+}
+
+/**
+ * Checksum the \a npages pages of a bulk with \a cksum_type into \a cksum.
+ *
+ * \a fn checksums the pages from \a start to \a end of the bulk described by
+ * \a data, and returns the number of bytes it went through, or a negative
+ * errno. Bulks of more than bulk_cksum_chunk pages are split across the
+ * helper threads, when the checksums of \a cksum_type can be combined.
+ *
+ * \retval	0 on success
+ * \retval	negative errno on failure
+ */
+int obd_cksum_pages(enum cksum_types cksum_type, int npages,
+		    obd_cksum_pages_fn fn, void *data, u32 *cksum)
+{
+	struct obd_cksum_chunk *chunks = NULL;
+	struct obd_cksum_chunk single;
+	struct completion done;
+	atomic_t pending;
+	unsigned int chunk = bulk_cksum_chunk;
+	int nchunks = 1;
+	int rc = 0;
+	int k;
+
+	if (chunk != 0 && npages > chunk && obd_cksum_wq != NULL &&
+	    obd_cksum_combinable(cksum_type)) {
+		chunk = max_t(unsigned int, chunk,
+			      DIV_ROUND_UP(npages, OBD_CKSUM_MAX_CHUNKS));
+		nchunks = DIV_ROUND_UP(npages, chunk);
+		OBD_ALLOC(chunks, nchunks * sizeof(*chunks));
+		if (chunks == NULL)
+			nchunks = 1;
+	}
+	if (chunks == NULL) {
+		chunks = &single;
+		chunk = npages;
+	}
+
+	init_completion(&done);
+	atomic_set(&pending, nchunks - 1);
+	for (k = 0; k < nchunks; k++) {
+		chunks[k].occ_fn = fn;
+		chunks[k].occ_data = data;
+		chunks[k].occ_start = k * chunk;
+		chunks[k].occ_end = min_t(int, npages, (k + 1) * chunk);
+		chunks[k].occ_rc = 0;
+		chunks[k].occ_pending = &pending;
+		chunks[k].occ_done = &done;
+	}
+
+	for (k = 1; k < nchunks; k++) {
+		INIT_WORK(&chunks[k].occ_work, obd_cksum_chunk_work);
+		queue_work(obd_cksum_wq, &chunks[k].occ_work);
+	}
+	chunks[0].occ_rc = fn(data, chunks[0].occ_start, chunks[0].occ_end,
+			      &chunks[0].occ_cksum);
+	if (nchunks > 1)
+		wait_for_completion(&done);
+
+	for (k = 0; k < nchunks && rc >= 0; k++)
+		rc = chunks[k].occ_rc;
+	if (rc >= 0) {
+		*cksum = chunks[0].occ_cksum;
+		for (k = 1; k < nchunks; k++)
+			*cksum = obd_cksum_combine(cksum_type, *cksum,
+						   chunks[k].occ_cksum,
+						   chunks[k].occ_rc);
+		rc = 0;
+	}
+
+	if (chunks != &single)
+		OBD_FREE(chunks, nchunks * sizeof(*chunks));
+
+	return rc;
+}
+EXPORT_SYMBOL(obd_cksum_pages);
+
+int obd_cksum_init(void)
+{
+	crc_x2n_init(CRC32_POLY_LE, crc32_x2n);
+	crc_x2n_init(CRC32C_POLY_LE, crc32c_x2n);
+
+	obd_cksum_wq = alloc_workqueue("obd_cksum",
+				       WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (obd_cksum_wq == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void obd_cksum_fini(void)
+{
+	if (obd_cksum_wq != NULL) {
+		destroy_workqueue(obd_cksum_wq);
+		obd_cksum_wq = NULL;
+	}
+}
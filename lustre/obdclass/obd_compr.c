@@ -0,0 +1,505 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/obdclass/obd_compr.c
+ *
+ * Compression of the bulk data of BRW RPCs.
+ *
+ * The data of a BRW is handled as a single stream of bytes, whatever the
+ * fragments it is made of, and compressed in chunks of OBD_COMPR_CHUNK_SIZE
+ * bytes with the compressors of the kernel crypto API. A chunk that does not
+ * get smaller is sent as is. The compressed chunks are sent one after the
+ * other, and struct ost_compr gives the size of each one.
+ *
+ * Compressors are not reentrant and need buffers, so each algorithm has a set
+ * of streams, allocated as needed up to one per online CPU.
+ */
+
+#define DEBUG_SUBSYSTEM S_CLASS
+
+#include <linux/crypto.h>
+#include <linux/highmem.h>
+#include <lustre_compat.h>
+#include <obd_support.h>
+#include <lustre_net.h>
+#include <obd_compr.h>
+
+struct obd_compr_stream {
+	struct list_head	 ocs_list;
+	struct crypto_comp	*ocs_tfm;
+	void			*ocs_in;
+	void			*ocs_out;
+};
+
+struct obd_compr_alg {
+	const char		*oca_name;
+	spinlock_t		 oca_lock;
+	/** streams not in use */
+	struct list_head	 oca_idle;
+	/** # of streams allocated */
+	int			 oca_count;
+	wait_queue_head_t	 oca_waitq;
+};
+
+static struct obd_compr_alg obd_compr_algs[] = {
+	[OBD_COMPR_NONE]	= { .oca_name = "none" },
+	[OBD_COMPR_LZ4]		= { .oca_name = "lz4" },
+	[OBD_COMPR_ZSTD]	= { .oca_name = "zstd" },
+	[OBD_COMPR_DEFLATE]	= { .oca_name = "deflate" },
+	[OBD_COMPR_LZO]		= { .oca_name = "lzo" },
+};
+
+const char *obd_compr_name(enum obd_compr_type type)
+{
+	if (type >= ARRAY_SIZE(obd_compr_algs))
+		return "unknown";
+
+	return obd_compr_algs[type].oca_name;
+}
+EXPORT_SYMBOL(obd_compr_name);
+
+/* Return the type of the algorithm called \a name, or -EINVAL */
+int obd_compr_parse(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(obd_compr_algs); i++) {
+		if (strcmp(name, obd_compr_algs[i].oca_name) == 0)
+			return i;
+	}
+
+	return -EINVAL;
+}
+EXPORT_SYMBOL(obd_compr_parse);
+
+static void obd_compr_stream_free(struct obd_compr_stream *stream)
+{
+	if (stream->ocs_tfm != NULL)
+		crypto_free_comp(stream->ocs_tfm);
+	if (stream->ocs_in != NULL)
+		OBD_FREE_LARGE(stream->ocs_in, OBD_COMPR_CHUNK_SIZE);
+	if (stream->ocs_out != NULL)
+		OBD_FREE_LARGE(stream->ocs_out, OBD_COMPR_CHUNK_SIZE);
+	OBD_FREE_PTR(stream);
+}
+
+static struct obd_compr_stream *
+obd_compr_stream_alloc(struct obd_compr_alg *alg)
+{
+	struct obd_compr_stream *stream;
+	struct crypto_comp *tfm;
+
+	OBD_ALLOC_PTR(stream);
+	if (stream == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	INIT_LIST_HEAD(&stream->ocs_list);
+	tfm = crypto_alloc_comp(alg->oca_name, 0, 0);
+	if (IS_ERR(tfm)) {
+		CDEBUG(D_INFO, "cannot load %s compressor: rc = %ld\n",
+		       alg->oca_name, PTR_ERR(tfm));
+		OBD_FREE_PTR(stream);
+		return ERR_PTR(PTR_ERR(tfm) == -ENOMEM ? -ENOMEM :
+			       -EOPNOTSUPP);
+	}
+	stream->ocs_tfm = tfm;
+
+	OBD_ALLOC_LARGE(stream->ocs_in, OBD_COMPR_CHUNK_SIZE);
+	OBD_ALLOC_LARGE(stream->ocs_out, OBD_COMPR_CHUNK_SIZE);
+	if (stream->ocs_in == NULL || stream->ocs_out == NULL) {
+		obd_compr_stream_free(stream);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	return stream;
+}
+
+static struct obd_compr_stream *obd_compr_stream_get(enum obd_compr_type type)
+{
+	struct obd_compr_alg *alg;
+	struct obd_compr_stream *stream;
+
+	if (type == OBD_COMPR_NONE || type >= ARRAY_SIZE(obd_compr_algs))
+		return ERR_PTR(-EOPNOTSUPP);
+
+	alg = &obd_compr_algs[type];
+	while (1) {
+		spin_lock(&alg->oca_lock);
+		if (!list_empty(&alg->oca_idle)) {
+			stream = list_entry(alg->oca_idle.next,
+					    struct obd_compr_stream, ocs_list);
+			list_del_init(&stream->ocs_list);
+			spin_unlock(&alg->oca_lock);
+			return stream;
+		}
+
+		if (alg->oca_count < num_online_cpus()) {
+			alg->oca_count++;
+			spin_unlock(&alg->oca_lock);
+
+			stream = obd_compr_stream_alloc(alg);
+			if (IS_ERR(stream)) {
+				spin_lock(&alg->oca_lock);
+				alg->oca_count--;
+				spin_unlock(&alg->oca_lock);
+				wake_up(&alg->oca_waitq);
+			}
+			return stream;
+		}
+		spin_unlock(&alg->oca_lock);
+
+		wait_event(alg->oca_waitq,
+			   !list_empty_careful(&alg->oca_idle));
+	}
+}
+
+static void obd_compr_stream_put(enum obd_compr_type type,
+				 struct obd_compr_stream *stream)
+{
+	struct obd_compr_alg *alg = &obd_compr_algs[type];
+
+	spin_lock(&alg->oca_lock);
+	list_add(&stream->ocs_list, &alg->oca_idle);
+	spin_unlock(&alg->oca_lock);
+	wake_up(&alg->oca_waitq);
+}
+
+/**
+ * Check that the algorithm \a type can be used, loading its module if needed.
+ * Returns -EOPNOTSUPP if the kernel has no such compressor.
+ */
+int obd_compr_prepare(enum obd_compr_type type)
+{
+	struct obd_compr_stream *stream;
+
+	stream = obd_compr_stream_get(type);
+	if (IS_ERR(stream))
+		return PTR_ERR(stream);
+
+	obd_compr_stream_put(type, stream);
+	return 0;
+}
+EXPORT_SYMBOL(obd_compr_prepare);
+
+void obd_compr_swab(struct ost_compr *oc, int size)
+{
+	int i;
+
+	if (size < sizeof(*oc))
+		return;
+
+	__swab32s(&oc->oc_type);
+	__swab32s(&oc->oc_raw);
+	__swab32s(&oc->oc_count);
+	for (i = 0; i < oc->oc_count &&
+		    sizeof(*oc) + (i + 1) * sizeof(oc->oc_lens[0]) <= size; i++)
+		__swab32s(&oc->oc_lens[i]);
+}
+EXPORT_SYMBOL(obd_compr_swab);
+
+/**
+ * Check the description \a oc, of \a size bytes, of compressed data.
+ * Returns the bytes of compressed data, or -EPROTO.
+ */
+int obd_compr_check(const struct ost_compr *oc, int size)
+{
+	unsigned int total = 0;
+	unsigned int len;
+	int i;
+
+	if (size < sizeof(*oc) || oc->oc_type == OBD_COMPR_NONE ||
+	    oc->oc_type >= ARRAY_SIZE(obd_compr_algs) ||
+	    oc->oc_raw > PTLRPC_MAX_BRW_SIZE ||
+	    oc->oc_count != DIV_ROUND_UP(oc->oc_raw, OBD_COMPR_CHUNK_SIZE) ||
+	    size < obd_compr_size(oc->oc_raw))
+		return -EPROTO;
+
+	for (i = 0; i < oc->oc_count; i++) {
+		len = min_t(unsigned int, OBD_COMPR_CHUNK_SIZE,
+			    oc->oc_raw - i * OBD_COMPR_CHUNK_SIZE);
+		if (oc->oc_lens[i] == 0 || oc->oc_lens[i] > len)
+			return -EPROTO;
+		total += oc->oc_lens[i];
+	}
+
+	return total;
+}
+EXPORT_SYMBOL(obd_compr_check);
+
+/* position in the stream of bytes of an array of kiov fragments */
+struct obd_compr_cursor {
+	lnet_kiov_t	*occ_kiov;
+	int		 occ_nr;
+	/** fragment the position is in */
+	int		 occ_idx;
+	/** offset of that fragment in the stream */
+	unsigned int	 occ_start;
+};
+
+static void occ_init(struct obd_compr_cursor *cur, lnet_kiov_t *kiov, int nr)
+{
+	cur->occ_kiov = kiov;
+	cur->occ_nr = nr;
+	cur->occ_idx = 0;
+	cur->occ_start = 0;
+}
+
+static void occ_seek(struct obd_compr_cursor *cur, unsigned int off)
+{
+	while (cur->occ_idx > 0 && off < cur->occ_start) {
+		cur->occ_idx--;
+		cur->occ_start -= cur->occ_kiov[cur->occ_idx].kiov_len;
+	}
+
+	while (cur->occ_idx < cur->occ_nr &&
+	       off >= cur->occ_start + cur->occ_kiov[cur->occ_idx].kiov_len) {
+		cur->occ_start += cur->occ_kiov[cur->occ_idx].kiov_len;
+		cur->occ_idx++;
+	}
+}
+
+/*
+ * Copy \a len bytes at offset \a off of the stream to \a buf, or from it if
+ * \a write is set. When writing, pages are allocated for the fragments that
+ * have none.
+ */
+static int occ_copy(struct obd_compr_cursor *cur, unsigned int off, void *buf,
+		    unsigned int len, bool write)
+{
+	while (len > 0) {
+		lnet_kiov_t *kiov;
+		unsigned int skip;
+		unsigned int count;
+		char *ptr;
+
+		occ_seek(cur, off);
+		if (cur->occ_idx >= cur->occ_nr)
+			return -EOVERFLOW;
+
+		kiov = &cur->occ_kiov[cur->occ_idx];
+		skip = off - cur->occ_start;
+		count = min(len, kiov->kiov_len - skip);
+
+		if (kiov->kiov_page == NULL) {
+			LASSERT(write);
+			kiov->kiov_page = alloc_page(GFP_NOFS);
+			if (kiov->kiov_page == NULL)
+				return -ENOMEM;
+		}
+
+		ptr = ll_kmap_atomic(kiov->kiov_page, KM_USER0);
+		if (write)
+			memcpy(ptr + kiov->kiov_offset + skip, buf, count);
+		else
+			memcpy(buf, ptr + kiov->kiov_offset + skip, count);
+		ll_kunmap_atomic(ptr, KM_USER0);
+
+		buf += count;
+		off += count;
+		len -= count;
+	}
+
+	return 0;
+}
+
+/**
+ * Compress the data of fragments \a src with algorithm \a type into
+ * fragments \a dst, which have their length and offset set but no pages, and
+ * describe the result in \a oc, sized with obd_compr_size().
+ *
+ * \retval	bytes of compressed data, written to the first fragments of
+ *		\a dst, whose pages must then be released by the caller with
+ *		obd_compr_release(), even on error
+ * \retval	negative error
+ */
+int obd_compress(enum obd_compr_type type, lnet_kiov_t *src, int nsrc,
+		 lnet_kiov_t *dst, int ndst, struct ost_compr *oc)
+{
+	struct obd_compr_stream *stream;
+	struct obd_compr_cursor in;
+	struct obd_compr_cursor out;
+	unsigned int total = 0;
+	unsigned int raw = 0;
+	unsigned int off;
+	int rc = 0;
+	int i;
+
+	for (i = 0; i < nsrc; i++)
+		raw += src[i].kiov_len;
+
+	stream = obd_compr_stream_get(type);
+	if (IS_ERR(stream))
+		return PTR_ERR(stream);
+
+	occ_init(&in, src, nsrc);
+	occ_init(&out, dst, ndst);
+	for (i = 0, off = 0; off < raw; i++, off += OBD_COMPR_CHUNK_SIZE) {
+		unsigned int len = min_t(unsigned int, OBD_COMPR_CHUNK_SIZE,
+					 raw - off);
+		unsigned int dlen = OBD_COMPR_CHUNK_SIZE;
+		void *buf = stream->ocs_out;
+
+		rc = occ_copy(&in, off, stream->ocs_in, len, false);
+		if (rc != 0)
+			break;
+
+		/* fails when the output does not fit */
+		if (crypto_comp_compress(stream->ocs_tfm, stream->ocs_in, len,
+					 stream->ocs_out, &dlen) != 0 ||
+		    dlen >= len) {
+			buf = stream->ocs_in;
+			dlen = len;
+		}
+
+		rc = occ_copy(&out, total, buf, dlen, true);
+		if (rc != 0)
+			break;
+
+		oc->oc_lens[i] = dlen;
+		total += dlen;
+	}
+	obd_compr_stream_put(type, stream);
+
+	if (rc != 0)
+		return rc;
+
+	oc->oc_type = type;
+	oc->oc_raw = raw;
+	oc->oc_count = i;
+	oc->oc_padding = 0;
+
+	return total;
+}
+EXPORT_SYMBOL(obd_compress);
+
+/**
+ * Decompress data described by \a oc, checked with obd_compr_check(), from
+ * fragments \a src into fragments \a dst. They can be the same fragments.
+ *
+ * \retval	bytes of data decompressed
+ * \retval	-EIO if the data is corrupted
+ * \retval	negative error
+ */
+int obd_decompress(const struct ost_compr *oc, lnet_kiov_t *src, int nsrc,
+		   lnet_kiov_t *dst, int ndst)
+{
+	struct obd_compr_stream *stream;
+	struct obd_compr_cursor in;
+	struct obd_compr_cursor out;
+	unsigned int total = 0;
+	int rc = 0;
+	int i;
+
+	for (i = 0; i < oc->oc_count; i++)
+		total += oc->oc_lens[i];
+
+	stream = obd_compr_stream_get(oc->oc_type);
+	if (IS_ERR(stream))
+		return PTR_ERR(stream);
+
+	occ_init(&in, src, nsrc);
+	occ_init(&out, dst, ndst);
+	/* the last chunks first, a compressed chunk never lies after the chunk
+	 * it decompresses to, so this works in place */
+	for (i = oc->oc_count - 1; i >= 0; i--) {
+		unsigned int off = i * OBD_COMPR_CHUNK_SIZE;
+		unsigned int len = min_t(unsigned int, OBD_COMPR_CHUNK_SIZE,
+					 oc->oc_raw - off);
+		unsigned int dlen = OBD_COMPR_CHUNK_SIZE;
+		void *buf = stream->ocs_out;
+
+		total -= oc->oc_lens[i];
+		rc = occ_copy(&in, total, stream->ocs_in, oc->oc_lens[i],
+			      false);
+		if (rc != 0)
+			break;
+
+		if (oc->oc_lens[i] == len) {
+			buf = stream->ocs_in;
+		} else if (crypto_comp_decompress(stream->ocs_tfm,
+						  stream->ocs_in,
+						  oc->oc_lens[i],
+						  stream->ocs_out, &dlen) != 0 ||
+			   dlen != len) {
+			CDEBUG(D_PAGE, "bad %s chunk %d of %u bytes\n",
+			       obd_compr_name(oc->oc_type), i, oc->oc_lens[i]);
+			rc = -EIO;
+			break;
+		}
+
+		rc = occ_copy(&out, off, buf, len, true);
+		if (rc != 0)
+			break;
+	}
+	obd_compr_stream_put(oc->oc_type, stream);
+
+	return rc != 0 ? rc : oc->oc_raw;
+}
+EXPORT_SYMBOL(obd_decompress);
+
+/* Release the pages obd_compress() allocated for fragments \a kiov */
+void obd_compr_release(lnet_kiov_t *kiov, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (kiov[i].kiov_page != NULL)
+			put_page(kiov[i].kiov_page);
+		kiov[i].kiov_page = NULL;
+	}
+}
+EXPORT_SYMBOL(obd_compr_release);
+
+int obd_compr_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(obd_compr_algs); i++) {
+		spin_lock_init(&obd_compr_algs[i].oca_lock);
+		INIT_LIST_HEAD(&obd_compr_algs[i].oca_idle);
+		init_waitqueue_head(&obd_compr_algs[i].oca_waitq);
+	}
+
+	return 0;
+}
+
+void obd_compr_fini(void)
+{
+	struct obd_compr_stream *stream;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(obd_compr_algs); i++) {
+		struct obd_compr_alg *alg = &obd_compr_algs[i];
+
+		while (!list_empty(&alg->oca_idle)) {
+			stream = list_entry(alg->oca_idle.next,
+					    struct obd_compr_stream, ocs_list);
+			list_del(&stream->ocs_list);
+			obd_compr_stream_free(stream);
+			alg->oca_count--;
+		}
+		LASSERTF(alg->oca_count == 0, "%s: %d streams in use\n",
+			 alg->oca_name, alg->oca_count);
+	}
+}
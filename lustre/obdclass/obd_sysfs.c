@@ -433,6 +433,24 @@ static const struct file_operations obd_device_list_fops = {
 	.release = seq_release,
 };
 
+static int obd_mag_caches_seq_show(struct seq_file *m, void *v)
+{
+	return cfs_mag_cache_seq_show(m);
+}
+
+static int obd_mag_caches_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, obd_mag_caches_seq_show, NULL);
+}
+
+static const struct file_operations obd_mag_caches_fops = {
+	.owner   = THIS_MODULE,
+	.open    = obd_mag_caches_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
 struct kset *lustre_kset;
 EXPORT_SYMBOL_GPL(lustre_kset);
 
@@ -501,6 +519,15 @@ int class_procfs_init(void)
 		goto out;
 	}
 
+	file = debugfs_create_file("mag_caches", 0444, debugfs_lustre_root,
+				   NULL, &obd_mag_caches_fops);
+	if (IS_ERR_OR_NULL(file)) {
+		rc = file ? PTR_ERR(file) : -ENOMEM;
+		debugfs_remove_recursive(debugfs_lustre_root);
+		kset_unregister(lustre_kset);
+		goto out;
+	}
+
 	entry = lprocfs_register("fs/lustre", NULL, NULL, NULL);
 	if (IS_ERR(entry)) {
 		rc = PTR_ERR(entry);
@@ -119,6 +119,10 @@ static int check_unlink_entry(struct upcall_cache *cache,
 	if (UC_CACHE_IS_VALID(entry) && now < entry->ue_expire)
 		return 0;
 
+	/* negative entry, see upcall_cache_downcall() */
+	if (entry->ue_flags == UC_CACHE_INVALID && now < entry->ue_expire)
+		return 0;
+
 	if (UC_CACHE_IS_ACQUIRING(entry)) {
 		if (entry->ue_acquire_expire == 0 ||
 		    now < entry->ue_acquire_expire)
@@ -136,39 +140,119 @@ static int check_unlink_entry(struct upcall_cache *cache,
 	return 1;
 }
 
-static inline int refresh_entry(struct upcall_cache *cache,
+/*
+ * Issue the upcall acquiring \a entry, along with the other entries still
+ * waiting for theirs when the cache can batch them. Nothing is left to do
+ * when the upcall of \a entry was part of the batch of another thread.
+ */
+static int refresh_entry(struct upcall_cache *cache,
 			 struct upcall_cache_entry *entry)
 {
+	struct upcall_cache_entry *batch[UC_CACHE_UPCALL_BATCH];
+	struct upcall_cache_entry *tmp;
+	int max = 1;
+	int nr = 0;
+	int rc;
+	int i;
+
 	LASSERT(cache->uc_ops->do_upcall);
-	return cache->uc_ops->do_upcall(cache, entry);
+
+	if (cache->uc_ops->do_upcall_batch != NULL)
+		max = clamp(cache->uc_upcall_batch, 1, UC_CACHE_UPCALL_BATCH);
+
+	spin_lock(&cache->uc_lock);
+	if (!UC_CACHE_IS_PENDING(entry)) {
+		spin_unlock(&cache->uc_lock);
+		return 0;
+	}
+	UC_CACHE_CLEAR_PENDING(entry);
+	batch[nr++] = entry;
+
+	for (i = 0; i < UC_CACHE_HASH_SIZE && nr < max; i++) {
+		list_for_each_entry(tmp, &cache->uc_hashtable[i], ue_hash) {
+			if (!UC_CACHE_IS_PENDING(tmp))
+				continue;
+
+			UC_CACHE_CLEAR_PENDING(tmp);
+			get_entry(tmp);
+			batch[nr++] = tmp;
+			if (nr == max)
+				break;
+		}
+	}
+	spin_unlock(&cache->uc_lock);
+
+	if (nr == 1)
+		return cache->uc_ops->do_upcall(cache, entry);
+
+	rc = cache->uc_ops->do_upcall_batch(cache, batch, nr);
+
+	/* the caller handles the failure of its own entry */
+	spin_lock(&cache->uc_lock);
+	for (i = 1; i < nr; i++) {
+		tmp = batch[i];
+		if (rc < 0 && UC_CACHE_IS_ACQUIRING(tmp)) {
+			UC_CACHE_CLEAR_ACQUIRING(tmp);
+			UC_CACHE_SET_INVALID(tmp);
+			wake_up_all(&tmp->ue_waitq);
+		}
+		put_entry(cache, tmp);
+	}
+	spin_unlock(&cache->uc_lock);
+
+	return rc;
+}
+
+/*
+ * Whether \a entry should be replaced by a fresh one acquired in the
+ * background, so that its users are not blocked by an upcall when it
+ * expires.
+ */
+static inline bool refresh_ahead(struct upcall_cache *cache,
+				 struct upcall_cache_entry *entry)
+{
+	return UC_CACHE_IS_VALID(entry) && cache->uc_entry_expire > 0 &&
+	       ktime_get_seconds() >= entry->ue_expire -
+				      cache->uc_entry_expire /
+				      UC_CACHE_REFRESH_AHEAD;
 }
 
 struct upcall_cache_entry *upcall_cache_get_entry(struct upcall_cache *cache,
 						  __u64 key, void *args)
 {
-	struct upcall_cache_entry *entry = NULL, *new = NULL, *next;
+	struct upcall_cache_entry *entry = NULL, *new = NULL, *next, *tmp;
+	struct upcall_cache_entry *ahead = NULL;
 	struct list_head *head;
 	wait_queue_entry_t wait;
-	int rc, found;
+	bool acquiring;
+	int rc;
 	ENTRY;
 
 	LASSERT(cache);
 
 	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
 find_again:
-	found = 0;
+	entry = NULL;
+	acquiring = false;
 	spin_lock(&cache->uc_lock);
-	list_for_each_entry_safe(entry, next, head, ue_hash) {
+	list_for_each_entry_safe(tmp, next, head, ue_hash) {
 		/* check invalid & expired items */
-		if (check_unlink_entry(cache, entry))
+		if (check_unlink_entry(cache, tmp))
 			continue;
-		if (upcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			break;
-		}
+		if (upcall_compare(cache, tmp, key, args) != 0)
+			continue;
+
+		/* a valid entry is used while its replacement is acquired */
+		if (UC_CACHE_IS_ACQUIRING(tmp))
+			acquiring = true;
+		if (entry == NULL ||
+		    (UC_CACHE_IS_VALID(tmp) &&
+		     (!UC_CACHE_IS_VALID(entry) ||
+		      tmp->ue_expire > entry->ue_expire)))
+			entry = tmp;
 	}
 
-	if (!found) {
+	if (entry == NULL || (!acquiring && refresh_ahead(cache, entry))) {
 		if (!new) {
 			spin_unlock(&cache->uc_lock);
 			new = alloc_entry(cache, key, args);
@@ -177,11 +261,22 @@ find_again:
 				RETURN(ERR_PTR(-ENOMEM));
 			}
 			goto find_again;
+		}
+
+		list_add(&new->ue_hash, head);
+		if (entry != NULL) {
+			/* acquired in the background, see refresh_ahead() */
+			UC_CACHE_SET_ACQUIRING(new);
+			UC_CACHE_SET_PENDING(new);
+			UC_CACHE_CLEAR_NEW(new);
+			get_entry(new);
+			ahead = new;
+			new = NULL;
 		} else {
-			list_add(&new->ue_hash, head);
 			entry = new;
 		}
-	} else {
+	}
+	if (entry != new) {
 		if (new) {
 			free_entry(cache, new);
 			new = NULL;
@@ -193,6 +288,7 @@ find_again:
 	/* acquire for new one */
 	if (UC_CACHE_IS_NEW(entry)) {
 		UC_CACHE_SET_ACQUIRING(entry);
+		UC_CACHE_SET_PENDING(entry);
 		UC_CACHE_CLEAR_NEW(entry);
 		spin_unlock(&cache->uc_lock);
 		rc = refresh_entry(cache, entry);
@@ -263,6 +359,21 @@ find_again:
 	/* Now we know it's good */
 out:
 	spin_unlock(&cache->uc_lock);
+
+	if (ahead != NULL) {
+		rc = refresh_entry(cache, ahead);
+		spin_lock(&cache->uc_lock);
+		ahead->ue_acquire_expire = ktime_get_seconds() +
+					   cache->uc_acquire_expire;
+		if (rc < 0) {
+			UC_CACHE_CLEAR_ACQUIRING(ahead);
+			UC_CACHE_SET_INVALID(ahead);
+			wake_up_all(&ahead->ue_waitq);
+		}
+		put_entry(cache, ahead);
+		spin_unlock(&cache->uc_lock);
+	}
+
 	RETURN(entry);
 }
 EXPORT_SYMBOL(upcall_cache_get_entry);
@@ -288,7 +399,7 @@ EXPORT_SYMBOL(upcall_cache_put_entry);
 int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 			  void *args)
 {
-	struct upcall_cache_entry *entry = NULL;
+	struct upcall_cache_entry *entry = NULL, *tmp;
 	struct list_head *head;
 	int found = 0, rc = 0;
 	ENTRY;
@@ -298,12 +409,15 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
 
 	spin_lock(&cache->uc_lock);
-	list_for_each_entry(entry, head, ue_hash) {
-		if (downcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			get_entry(entry);
+	list_for_each_entry(tmp, head, ue_hash) {
+		if (downcall_compare(cache, tmp, key, args) != 0)
+			continue;
+
+		/* the entry being refreshed rather than the one in use */
+		found = 1;
+		entry = tmp;
+		if (UC_CACHE_IS_ACQUIRING(tmp))
 			break;
-		}
 	}
 
 	if (!found) {
@@ -313,6 +427,7 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 		spin_unlock(&cache->uc_lock);
 		RETURN(-EINVAL);
 	}
+	get_entry(entry);
 
 	if (err) {
 		CDEBUG(D_OTHER, "%s: upcall for key %llu returned %d\n",
@@ -346,7 +461,12 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 out:
 	if (rc) {
 		UC_CACHE_SET_INVALID(entry);
-		list_del_init(&entry->ue_hash);
+		/* remember for a while that the key has no identity */
+		if (err && cache->uc_negative_expire > 0)
+			entry->ue_expire = ktime_get_seconds() +
+					   cache->uc_negative_expire;
+		else
+			list_del_init(&entry->ue_hash);
 	}
 	UC_CACHE_CLEAR_ACQUIRING(entry);
 	spin_unlock(&cache->uc_lock);
@@ -432,6 +552,8 @@ struct upcall_cache *upcall_cache_init(const char *name, const char *upcall,
 	strlcpy(cache->uc_upcall, upcall, sizeof(cache->uc_upcall));
 	cache->uc_entry_expire = 20 * 60;
 	cache->uc_acquire_expire = 30;
+	cache->uc_negative_expire = 60;
+	cache->uc_upcall_batch = 1;
 	cache->uc_ops = ops;
 
 	RETURN(cache);
@@ -233,6 +233,9 @@ struct echo_thread_info {
 	void			*eti_big_lmm; /* may be vmalloc'd */
 	int			eti_big_lmmsize;
 	char                    eti_name[ETI_NAME_LEN];
+	/* temporary name of the entries renamed by ECHO_MD_RENAME */
+	char			eti_name2[ETI_NAME_LEN + 4];
+	struct lu_name		eti_lname2;
 	struct lu_buf           eti_buf;
 	/* If we want to test large ACL, then need to enlarge the buffer. */
 	char                    eti_xattr_buf[LUSTRE_POSIX_ACL_MAX_SIZE_OLD];
@@ -1277,7 +1280,7 @@ static int cl_echo_cancel0(struct lu_env *env, struct echo_device *ed,
 }
 
 static void echo_commit_callback(const struct lu_env *env, struct cl_io *io,
-				struct cl_page *page)
+				 struct cl_page_list *plist)
 {
 	struct echo_thread_info *info;
 	struct cl_2queue        *queue;
@@ -1286,7 +1289,7 @@ static void echo_commit_callback(const struct lu_env *env, struct cl_io *io,
 	LASSERT(io == &info->eti_io);
 
 	queue = &info->eti_queue;
-	cl_page_list_add(&queue->c2_qout, page);
+	cl_page_list_splice(plist, &queue->c2_qout);
 }
 
 static int cl_echo_object_brw(struct echo_object *eco, int rw, u64 offset,
@@ -1612,25 +1615,33 @@ static int echo_set_lmm_size(const struct lu_env *env, struct lu_device *ld,
 	return 0;
 }
 
-static int
-echo_md_dir_stripe_choose(const struct lu_env *env, struct echo_device *ed,
-			  struct lu_object *obj, const char *name,
-			  unsigned int namelen, __u64 id,
-			  struct lu_object **new_parent)
+/*
+ * Stripe layout of the directory an echo md command works in. It is read
+ * once per command, so that each name can then be handled in the stripe
+ * it hashes to, as a client would do.
+ */
+struct echo_md_stripes {
+	__u32		 ems_count;	/* 0 if the directory is not striped */
+	__u32		 ems_hash_type;
+	struct lu_fid	*ems_fids;
+};
+
+static int echo_md_dir_stripes_get(const struct lu_env *env,
+				   struct echo_device *ed,
+				   struct lu_object *obj,
+				   struct echo_md_stripes *ems)
 {
-	struct echo_thread_info *info = echo_env_info(env);
+	struct echo_thread_info	*info = echo_env_info(env);
 	struct md_attr		*ma = &info->eti_ma;
 	struct lmv_mds_md_v1	*lmv;
-	struct lu_device        *ld = ed->ed_next;
-	unsigned int		idx;
-	struct lu_name		tmp_ln_name;
-	struct lu_fid		stripe_fid;
-	struct lu_object	*stripe_obj;
-	int			rc;
+	struct lu_device	*ld = ed->ed_next;
+	unsigned int		 i;
+	int			 rc;
 
 	LASSERT(obj != NULL);
 	LASSERT(S_ISDIR(obj->lo_header->loh_attr));
 
+	memset(ems, 0, sizeof(*ems));
 	memset(ma, 0, sizeof(*ma));
 	echo_set_lmm_size(env, ld, ma);
 	ma->ma_need = MA_LMV;
@@ -1641,10 +1652,8 @@ echo_md_dir_stripe_choose(const struct lu_env *env, struct echo_device *ed,
 		return rc;
 	}
 
-	if (!(ma->ma_valid & MA_LMV)) {
-		*new_parent = obj;
+	if (!(ma->ma_valid & MA_LMV))
 		return 0;
-	}
 
 	lmv = (struct lmv_mds_md_v1 *)ma->ma_lmm;
 	if (le32_to_cpu(lmv->lmv_magic) != LMV_MAGIC_V1) {
@@ -1655,37 +1664,82 @@ echo_md_dir_stripe_choose(const struct lu_env *env, struct echo_device *ed,
 		return rc;
 	}
 
-	if (name != NULL) {
-		tmp_ln_name.ln_name = name;
-		tmp_ln_name.ln_namelen = namelen;
-	} else {
-		LASSERT(id != -1);
-		echo_md_build_name(&tmp_ln_name, info->eti_name, id);
+	ems->ems_count = le32_to_cpu(lmv->lmv_stripe_count);
+	ems->ems_hash_type = le32_to_cpu(lmv->lmv_hash_type);
+	if (ems->ems_count == 0)
+		return 0;
+
+	OBD_ALLOC_LARGE(ems->ems_fids,
+			ems->ems_count * sizeof(*ems->ems_fids));
+	if (ems->ems_fids == NULL) {
+		ems->ems_count = 0;
+		return -ENOMEM;
 	}
 
-	idx = lmv_name_to_stripe_index(LMV_HASH_TYPE_FNV_1A_64,
-				le32_to_cpu(lmv->lmv_stripe_count),
-				tmp_ln_name.ln_name, tmp_ln_name.ln_namelen);
+	for (i = 0; i < ems->ems_count; i++)
+		fid_le_to_cpu(&ems->ems_fids[i], &lmv->lmv_stripe_fids[i]);
+
+	return 0;
+}
+
+static void echo_md_dir_stripes_put(struct echo_md_stripes *ems)
+{
+	if (ems->ems_fids != NULL)
+		OBD_FREE_LARGE(ems->ems_fids,
+			       ems->ems_count * sizeof(*ems->ems_fids));
+	ems->ems_fids = NULL;
+	ems->ems_count = 0;
+}
+
+/*
+ * Find the stripe of \a parent that \a lname belongs in. The result must
+ * be released with echo_md_dir_stripe_put().
+ */
+static int echo_md_dir_stripe_find(const struct lu_env *env,
+				   struct echo_device *ed,
+				   struct lu_object *parent,
+				   struct echo_md_stripes *ems,
+				   const struct lu_name *lname,
+				   struct lu_object **new_parent)
+{
+	struct lu_device	*ld = ed->ed_next;
+	struct lu_object	*stripe_obj;
+	unsigned int		 idx;
+	int			 rc;
+
+	if (ems->ems_count == 0) {
+		*new_parent = parent;
+		return 0;
+	}
 
-	LASSERT(idx < le32_to_cpu(lmv->lmv_stripe_count));
-	fid_le_to_cpu(&stripe_fid, &lmv->lmv_stripe_fids[idx]);
+	idx = lmv_name_to_stripe_index(ems->ems_hash_type, ems->ems_count,
+				       lname->ln_name, lname->ln_namelen);
+	LASSERT(idx < ems->ems_count);
 
-	stripe_obj = lu_object_find_at(env, &ed->ed_cl.cd_lu_dev, &stripe_fid,
-				       NULL);
+	stripe_obj = lu_object_find_at(env, &ed->ed_cl.cd_lu_dev,
+				       &ems->ems_fids[idx], NULL);
 	if (IS_ERR(stripe_obj)) {
 		rc = PTR_ERR(stripe_obj);
 		CERROR("Can not find the parent "DFID": rc = %d\n",
-		       PFID(&stripe_fid), rc);
+		       PFID(&ems->ems_fids[idx]), rc);
 		return rc;
 	}
 
 	*new_parent = lu_object_locate(stripe_obj->lo_header, ld->ld_type);
 	if (*new_parent == NULL) {
 		lu_object_put(env, stripe_obj);
-		RETURN(-ENXIO);
+		return -ENXIO;
 	}
 
-	return rc;
+	return 0;
+}
+
+static void echo_md_dir_stripe_put(const struct lu_env *env,
+				   struct lu_object *parent,
+				   struct lu_object *new_parent)
+{
+	if (new_parent != parent)
+		lu_object_put(env, new_parent);
 }
 
 static int echo_create_md_object(const struct lu_env *env,
@@ -1698,6 +1752,7 @@ static int echo_create_md_object(const struct lu_env *env,
 {
 	struct lu_object        *parent;
 	struct lu_object        *new_parent;
+	struct echo_md_stripes   ems;
 	struct echo_thread_info *info = echo_env_info(env);
 	struct lu_name          *lname = &info->eti_lname;
 	struct md_op_spec       *spec = &info->eti_spec;
@@ -1714,12 +1769,10 @@ static int echo_create_md_object(const struct lu_env *env,
 	if (parent == NULL)
 		RETURN(-ENXIO);
 
-	rc = echo_md_dir_stripe_choose(env, ed, parent, name, namelen,
-				       id, &new_parent);
+	rc = echo_md_dir_stripes_get(env, ed, parent, &ems);
 	if (rc != 0)
 		RETURN(rc);
 
-	LASSERT(new_parent != NULL);
 	memset(ma, 0, sizeof(*ma));
 	memset(spec, 0, sizeof(*spec));
 	echo_set_lmm_size(env, ld, ma);
@@ -1758,8 +1811,13 @@ static int echo_create_md_object(const struct lu_env *env,
 		lname->ln_name = name;
 		lname->ln_namelen = namelen;
 		/* If name is specified, only create one object by name */
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			GOTO(out_put, rc);
 		rc = echo_md_create_internal(env, ed, lu2md(new_parent), fid,
 					     lname, spec, ma);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 		GOTO(out_put, rc);
 	}
 
@@ -1769,8 +1827,13 @@ static int echo_create_md_object(const struct lu_env *env,
 
 		echo_md_build_name(lname, tmp_name, id);
 
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			break;
 		rc = echo_md_create_internal(env, ed, lu2md(new_parent),
 					     fid, lname, spec, ma);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 		if (rc) {
 			CERROR("Can not create child %s: rc = %d\n", tmp_name,
 				rc);
@@ -1781,8 +1844,7 @@ static int echo_create_md_object(const struct lu_env *env,
 	}
 
 out_put:
-	if (new_parent != parent)
-		lu_object_put(env, new_parent);
+	echo_md_dir_stripes_put(&ems);
 
 	RETURN(rc);
 }
@@ -1822,6 +1884,7 @@ static int echo_setattr_object(const struct lu_env *env,
 {
 	struct lu_object        *parent;
 	struct lu_object        *new_parent;
+	struct echo_md_stripes   ems;
 	struct echo_thread_info *info = echo_env_info(env);
 	struct lu_name          *lname = &info->eti_lname;
 	char                    *name = info->eti_name;
@@ -1838,8 +1901,7 @@ static int echo_setattr_object(const struct lu_env *env,
 	if (parent == NULL)
 		RETURN(-ENXIO);
 
-	rc = echo_md_dir_stripe_choose(env, ed, parent, NULL, 0, id,
-				       &new_parent);
+	rc = echo_md_dir_stripes_get(env, ed, parent, &ems);
 	if (rc != 0)
 		RETURN(rc);
 
@@ -1848,7 +1910,13 @@ static int echo_setattr_object(const struct lu_env *env,
 
                 echo_md_build_name(lname, name, id);
 
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			break;
+
 		ec_child = echo_md_lookup(env, ed, lu2md(new_parent), lname);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 		if (IS_ERR(ec_child)) {
 			rc = PTR_ERR(ec_child);
 			CERROR("Can't find child %s: rc = %d\n",
@@ -1885,8 +1953,7 @@ static int echo_setattr_object(const struct lu_env *env,
                 lu_object_put(env, ec_child);
         }
 
-	if (new_parent != parent)
-		lu_object_put(env, new_parent);
+	echo_md_dir_stripes_put(&ems);
 
 	RETURN(rc);
 }
@@ -1898,6 +1965,7 @@ static int echo_getattr_object(const struct lu_env *env,
 {
 	struct lu_object        *parent;
 	struct lu_object        *new_parent;
+	struct echo_md_stripes   ems;
 	struct echo_thread_info *info = echo_env_info(env);
 	struct lu_name          *lname = &info->eti_lname;
 	char                    *name = info->eti_name;
@@ -1914,8 +1982,7 @@ static int echo_getattr_object(const struct lu_env *env,
 	if (parent == NULL)
 		RETURN(-ENXIO);
 
-	rc = echo_md_dir_stripe_choose(env, ed, parent, NULL, 0, id,
-				       &new_parent);
+	rc = echo_md_dir_stripes_get(env, ed, parent, &ems);
 	if (rc != 0)
 		RETURN(rc);
 
@@ -1931,18 +1998,26 @@ static int echo_getattr_object(const struct lu_env *env,
                 echo_md_build_name(lname, name, id);
 		echo_set_lmm_size(env, ld, ma);
 
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			break;
+
 		ec_child = echo_md_lookup(env, ed, lu2md(new_parent), lname);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 		if (IS_ERR(ec_child)) {
-			CERROR("Can't find child %s: rc = %ld\n",
-			       lname->ln_name, PTR_ERR(ec_child));
-			RETURN(PTR_ERR(ec_child));
+			rc = PTR_ERR(ec_child);
+			CERROR("Can't find child %s: rc = %d\n",
+			       lname->ln_name, rc);
+			break;
 		}
 
                 child = lu_object_locate(ec_child->lo_header, ld->ld_type);
                 if (child == NULL) {
                         CERROR("Can not locate the child %s\n", lname->ln_name);
                         lu_object_put(env, ec_child);
-			RETURN(-EINVAL);
+			rc = -EINVAL;
+			break;
                 }
 
                 CDEBUG(D_RPCTRACE, "Start getattr object "DFID"\n",
@@ -1960,8 +2035,7 @@ static int echo_getattr_object(const struct lu_env *env,
                 lu_object_put(env, ec_child);
         }
 
-	if (new_parent != parent)
-		lu_object_put(env, new_parent);
+	echo_md_dir_stripes_put(&ems);
 
 	RETURN(rc);
 }
@@ -1973,6 +2047,7 @@ static int echo_lookup_object(const struct lu_env *env,
 {
 	struct lu_object        *parent;
 	struct lu_object        *new_parent;
+	struct echo_md_stripes   ems;
 	struct echo_thread_info *info = echo_env_info(env);
 	struct lu_name          *lname = &info->eti_lname;
 	char                    *name = info->eti_name;
@@ -1987,8 +2062,7 @@ static int echo_lookup_object(const struct lu_env *env,
 	if (parent == NULL)
 		return -ENXIO;
 
-	rc = echo_md_dir_stripe_choose(env, ed, parent, NULL, 0, id,
-				       &new_parent);
+	rc = echo_md_dir_stripes_get(env, ed, parent, &ems);
 	if (rc != 0)
 		RETURN(rc);
 
@@ -1996,6 +2070,11 @@ static int echo_lookup_object(const struct lu_env *env,
         for (i = 0; i < count; i++) {
 		echo_md_build_name(lname, name, id);
 
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			break;
+
 		CDEBUG(D_RPCTRACE, "Start lookup object "DFID" %s %p\n",
 		       PFID(lu_object_fid(new_parent)), lname->ln_name,
 		       new_parent);
@@ -2003,22 +2082,106 @@ static int echo_lookup_object(const struct lu_env *env,
 		rc = mdo_lookup(env, lu2md(new_parent), lname, fid, NULL);
 		if (rc) {
 			CERROR("Can not lookup child %s: rc = %d\n", name, rc);
+			echo_md_dir_stripe_put(env, parent, new_parent);
 			break;
 		}
 
 		CDEBUG(D_RPCTRACE, "End lookup object "DFID" %s %p\n",
 		       PFID(lu_object_fid(new_parent)), lname->ln_name,
 		       new_parent);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 
 		id++;
 	}
 
-	if (new_parent != parent)
-		lu_object_put(env, new_parent);
+	echo_md_dir_stripes_put(&ems);
 
 	return rc;
 }
 
+/*
+ * Rename each entry to a temporary name and back, so that the entries are
+ * still in place for the tests that run after this one. Both renames are
+ * done within the same directory, or the same stripe of a striped one.
+ */
+static int echo_rename_object(const struct lu_env *env,
+			      struct echo_device *ed,
+			      struct lu_object *ec_parent,
+			      __u64 id, int count)
+{
+	struct lu_object	*parent;
+	struct lu_object	*new_parent;
+	struct echo_md_stripes	 ems;
+	struct echo_thread_info	*info = echo_env_info(env);
+	struct lu_name		*lname = &info->eti_lname;
+	struct lu_name		*lname2 = &info->eti_lname2;
+	char			*name = info->eti_name;
+	char			*name2 = info->eti_name2;
+	struct lu_fid		*fid = &info->eti_fid;
+	struct md_attr		*ma = &info->eti_ma;
+	struct lu_device	*ld = ed->ed_next;
+	int			 rc = 0;
+	int			 i;
+
+	ENTRY;
+
+	if (ec_parent == NULL)
+		RETURN(-1);
+	parent = lu_object_locate(ec_parent->lo_header, ld->ld_type);
+	if (parent == NULL)
+		RETURN(-ENXIO);
+
+	rc = echo_md_dir_stripes_get(env, ed, parent, &ems);
+	if (rc != 0)
+		RETURN(rc);
+
+	memset(ma, 0, sizeof(*ma));
+	ma->ma_attr.la_valid = LA_CTIME;
+
+	for (i = 0; i < count; i++) {
+		echo_md_build_name(lname, name, id);
+		snprintf(name2, sizeof(info->eti_name2), "%s.rn", name);
+		lname2->ln_name = name2;
+		lname2->ln_namelen = strlen(name2);
+
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			break;
+
+		rc = mdo_lookup(env, lu2md(new_parent), lname, fid, NULL);
+		if (rc) {
+			CERROR("Can not lookup child %s: rc = %d\n", name, rc);
+			echo_md_dir_stripe_put(env, parent, new_parent);
+			break;
+		}
+
+		CDEBUG(D_RPCTRACE, "Start rename object "DFID" %s\n",
+		       PFID(fid), name);
+
+		ma->ma_attr.la_ctime = ktime_get_real_seconds();
+		rc = mdo_rename(env, lu2md(new_parent), lu2md(new_parent), fid,
+				lname, NULL, lname2, ma);
+		if (rc == 0)
+			rc = mdo_rename(env, lu2md(new_parent),
+					lu2md(new_parent), fid, lname2, NULL,
+					lname, ma);
+		echo_md_dir_stripe_put(env, parent, new_parent);
+		if (rc) {
+			CERROR("Can not rename child %s: rc = %d\n", name, rc);
+			break;
+		}
+
+		CDEBUG(D_RPCTRACE, "End rename object "DFID" %s\n",
+		       PFID(fid), name);
+		id++;
+	}
+
+	echo_md_dir_stripes_put(&ems);
+
+	RETURN(rc);
+}
+
 static int echo_md_destroy_internal(const struct lu_env *env,
                                     struct echo_device *ed,
                                     struct md_object *parent,
@@ -2079,6 +2242,7 @@ static int echo_destroy_object(const struct lu_env *env,
 	struct lu_device        *ld = ed->ed_next;
 	struct lu_object        *parent;
 	struct lu_object        *new_parent;
+	struct echo_md_stripes   ems;
 	int                      rc = 0;
 	int                      i;
 	ENTRY;
@@ -2087,8 +2251,7 @@ static int echo_destroy_object(const struct lu_env *env,
         if (parent == NULL)
                 RETURN(-EINVAL);
 
-	rc = echo_md_dir_stripe_choose(env, ed, parent, name, namelen,
-				       id, &new_parent);
+	rc = echo_md_dir_stripes_get(env, ed, parent, &ems);
 	if (rc != 0)
 		RETURN(rc);
 
@@ -2102,8 +2265,13 @@ static int echo_destroy_object(const struct lu_env *env,
         if (name != NULL) {
                 lname->ln_name = name;
                 lname->ln_namelen = namelen;
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			GOTO(out_put, rc);
 		rc = echo_md_destroy_internal(env, ed, lu2md(new_parent), lname,
 					      ma);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 		GOTO(out_put, rc);
 	}
 
@@ -2114,8 +2282,13 @@ static int echo_destroy_object(const struct lu_env *env,
 		ma->ma_valid = 0;
 		echo_md_build_name(lname, tmp_name, id);
 
+		rc = echo_md_dir_stripe_find(env, ed, parent, &ems, lname,
+					     &new_parent);
+		if (rc != 0)
+			break;
 		rc = echo_md_destroy_internal(env, ed, lu2md(new_parent), lname,
 					      ma);
+		echo_md_dir_stripe_put(env, parent, new_parent);
 		if (rc) {
 			CERROR("Can not unlink child %s: rc = %d\n", name, rc);
 			break;
@@ -2124,8 +2297,7 @@ static int echo_destroy_object(const struct lu_env *env,
 	}
 
 out_put:
-	if (new_parent != parent)
-		lu_object_put(env, new_parent);
+	echo_md_dir_stripes_put(&ems);
 
 	RETURN(rc);
 }
@@ -2324,6 +2496,9 @@ static int echo_md_handler(struct echo_device *ed, int command,
         case ECHO_MD_SETATTR:
                 rc = echo_setattr_object(env, ed, parent, id, count);
                 break;
+	case ECHO_MD_RENAME:
+		rc = echo_rename_object(env, ed, parent, id, count);
+		break;
         default:
                 CERROR("unknown command %d\n", command);
                 rc = -EINVAL;
@@ -2732,6 +2907,302 @@ static int echo_client_brw_ioctl(const struct lu_env *env, int rw,
 	RETURN(rc);
 }
 
+/* most I/Os one OBD_IOC_ECHO_LOAD run keeps in flight */
+#define ECHO_LOAD_DEPTH_MAX	1024
+
+/* state shared by the threads of one OBD_IOC_ECHO_LOAD run */
+struct echo_load {
+	struct echo_device	 *el_ed;
+	struct echo_load_param	 *el_param;
+	struct echo_object	**el_objs;
+	struct obdo		 *el_oas;
+	u64			 *el_offsets;	/* next offset per object */
+	spinlock_t		  el_lock;
+	u64			  el_issued;	/* I/Os handed out */
+	u64			  el_left;	/* bytes not yet handed out */
+	atomic_t		  el_running;
+	wait_queue_head_t	  el_waitq;
+	bool			  el_stop;
+	int			  el_rc;
+};
+
+/*
+ * Pick the next I/O to run: object, offset, size and direction.
+ * Objects are used round robin, each one written or read sequentially.
+ * Returns false once the whole run has been handed out.
+ */
+static bool echo_load_next(struct echo_load *el, int *idx, u64 *off,
+			   u64 *len, int *rw)
+{
+	struct echo_load_param *elp = el->el_param;
+	u64 size = elp->elp_io_min;
+
+	if (elp->elp_io_max > elp->elp_io_min)
+		size += round_down(cfs_rand() %
+				   (elp->elp_io_max - elp->elp_io_min + 1),
+				   PAGE_SIZE);
+	*rw = cfs_rand() % 100 < elp->elp_read_pct ? OBD_BRW_READ :
+						      OBD_BRW_WRITE;
+
+	spin_lock(&el->el_lock);
+	if (el->el_stop || el->el_left == 0) {
+		spin_unlock(&el->el_lock);
+		return false;
+	}
+	*idx = el->el_issued++ % elp->elp_objects;
+	*off = el->el_offsets[*idx];
+	*len = min(size, el->el_left);
+	el->el_offsets[*idx] += *len;
+	el->el_left -= *len;
+	spin_unlock(&el->el_lock);
+
+	return true;
+}
+
+static void echo_load_account(struct echo_load *el, int rw, u64 len,
+			      u64 usec, int rc)
+{
+	struct echo_load_param *elp = el->el_param;
+	int bucket = min(fls64(usec), ECHO_LOAD_LAT_BUCKETS - 1);
+
+	spin_lock(&el->el_lock);
+	if (rc != 0) {
+		if (el->el_rc == 0)
+			el->el_rc = rc;
+		el->el_stop = true;
+	} else {
+		elp->elp_ios++;
+		if (rw == OBD_BRW_READ)
+			elp->elp_bytes_read += len;
+		else
+			elp->elp_bytes_written += len;
+		elp->elp_lat[bucket]++;
+		if (usec > elp->elp_lat_max)
+			elp->elp_lat_max = usec;
+	}
+	spin_unlock(&el->el_lock);
+}
+
+/*
+ * One of elp_depth threads, each of which runs I/Os back to back, so the
+ * target always sees elp_depth requests outstanding without needing that
+ * many userspace processes.
+ */
+static int echo_load_thread(void *arg)
+{
+	struct echo_load *el = arg;
+	struct echo_device *ed = el->el_ed;
+	struct echo_client_obd *ec = ed->ed_ec;
+	struct lu_env *env;
+	struct obdo *oa;
+#ifdef HAVE_SERVER_SUPPORT
+	struct tgt_session_info *tsi;
+	struct lu_context *session;
+#endif
+	u64 off, len, batch;
+	ktime_t start;
+	int idx, rw;
+	int rc;
+
+	OBD_ALLOC_PTR(env);
+	OBD_ALLOC_PTR(oa);
+	if (env == NULL || oa == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	rc = lu_env_init(env, LCT_DT_THREAD);
+	if (rc)
+		GOTO(out_free, rc = -ENOMEM);
+	rc = lu_env_add(env);
+	if (rc)
+		GOTO(out_env_fini, rc);
+
+#ifdef HAVE_SERVER_SUPPORT
+	OBD_ALLOC_PTR(session);
+	if (session == NULL)
+		GOTO(out_env, rc = -ENOMEM);
+	env->le_ses = session;
+	rc = lu_context_init(env->le_ses, LCT_SERVER_SESSION | LCT_NOREF);
+	if (unlikely(rc < 0)) {
+		OBD_FREE_PTR(session);
+		GOTO(out_env, rc);
+	}
+	lu_context_enter(env->le_ses);
+
+	tsi = tgt_ses_info(env);
+	tsi->tsi_exp = ec->ec_exp;
+	tsi->tsi_jobid = NULL;
+#endif
+
+	batch = min_t(u64, el->el_param->elp_io_max, PTLRPC_MAX_BRW_SIZE);
+	while (echo_load_next(el, &idx, &off, &len, &rw)) {
+		*oa = el->el_oas[idx];
+
+		start = ktime_get();
+		if (ed->ed_next != NULL)
+			rc = echo_client_kbrw(ed, rw, oa, el->el_objs[idx],
+					      off, len, 0);
+		else
+			rc = echo_client_prep_commit(env, ec->ec_exp, rw, oa,
+						     el->el_objs[idx], off,
+						     len, batch, 1);
+		echo_load_account(el, rw, len,
+				  ktime_us_delta(ktime_get(), start), rc);
+	}
+	rc = 0;
+
+#ifdef HAVE_SERVER_SUPPORT
+	lu_context_exit(env->le_ses);
+	lu_context_fini(env->le_ses);
+	OBD_FREE_PTR(session);
+out_env:
+#endif
+	lu_env_remove(env);
+out_env_fini:
+	lu_env_fini(env);
+out_free:
+	if (oa != NULL)
+		OBD_FREE_PTR(oa);
+	if (env != NULL)
+		OBD_FREE_PTR(env);
+
+	if (rc != 0)
+		echo_load_account(el, 0, 0, 0, rc);
+	if (atomic_dec_and_test(&el->el_running))
+		wake_up(&el->el_waitq);
+
+	return rc;
+}
+
+/*
+ * Run a load test with elp_depth I/Os in flight against elp_objects
+ * objects entirely in the kernel, with I/O sizes spread evenly between
+ * elp_io_min and elp_io_max and elp_read_pct percent of them reads,
+ * and return throughput and a latency histogram to userspace.
+ */
+static int echo_client_load(struct echo_device *ed,
+			    struct obd_ioctl_data *data)
+{
+	struct echo_load_param *elp;
+	struct echo_load *el;
+	ktime_t start;
+	u32 i;
+	int rc;
+
+	ENTRY;
+
+	if (data->ioc_plen1 != sizeof(*elp))
+		RETURN(-EINVAL);
+
+	OBD_ALLOC_PTR(el);
+	OBD_ALLOC_PTR(elp);
+	if (el == NULL || elp == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	if (copy_from_user(elp, data->ioc_pbuf1, sizeof(*elp)))
+		GOTO(out_free, rc = -EFAULT);
+
+	if (elp->elp_objects == 0 || elp->elp_depth == 0 ||
+	    elp->elp_depth > ECHO_LOAD_DEPTH_MAX || elp->elp_read_pct > 100 ||
+	    elp->elp_io_min == 0 || elp->elp_io_min > elp->elp_io_max ||
+	    elp->elp_io_max > PTLRPC_MAX_BRW_SIZE ||
+	    (elp->elp_io_min | elp->elp_io_max | elp->elp_offset |
+	     elp->elp_count) & ~PAGE_MASK)
+		GOTO(out_free, rc = -EINVAL);
+
+	if (elp->elp_read_pct < 100 && !cfs_capable(CFS_CAP_SYS_ADMIN))
+		GOTO(out_free, rc = -EPERM);
+
+	elp->elp_ios = 0;
+	elp->elp_bytes_read = 0;
+	elp->elp_bytes_written = 0;
+	elp->elp_lat_max = 0;
+	memset(elp->elp_lat, 0, sizeof(elp->elp_lat));
+
+	el->el_ed = ed;
+	el->el_param = elp;
+	el->el_left = elp->elp_count * elp->elp_objects;
+	spin_lock_init(&el->el_lock);
+	init_waitqueue_head(&el->el_waitq);
+
+	OBD_ALLOC_LARGE(el->el_objs, elp->elp_objects * sizeof(*el->el_objs));
+	OBD_ALLOC_LARGE(el->el_oas, elp->elp_objects * sizeof(*el->el_oas));
+	OBD_ALLOC_LARGE(el->el_offsets,
+			elp->elp_objects * sizeof(*el->el_offsets));
+	if (el->el_objs == NULL || el->el_oas == NULL ||
+	    el->el_offsets == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	for (i = 0; i < elp->elp_objects; i++) {
+		struct obdo *oa = &el->el_oas[i];
+
+		*oa = data->ioc_obdo1;
+		oa->o_valid &= ~OBD_MD_FLHANDLE;
+		rc = ostid_set_id(&oa->o_oi, ostid_id(&oa->o_oi) + i);
+		if (rc == 0)
+			rc = echo_get_object(&el->el_objs[i], ed, oa);
+		if (rc != 0)
+			GOTO(out_put, rc);
+		el->el_offsets[i] = elp->elp_offset;
+	}
+
+	start = ktime_get();
+	atomic_set(&el->el_running, 1);
+	for (i = 0; i < elp->elp_depth; i++) {
+		struct task_struct *task;
+
+		atomic_inc(&el->el_running);
+		task = kthread_run(echo_load_thread, el, "echo_load_%02u", i);
+		if (IS_ERR(task)) {
+			atomic_dec(&el->el_running);
+			CERROR("%s: cannot start load thread: rc = %ld\n",
+			       ed->ed_ec->ec_exp->exp_obd->obd_name,
+			       PTR_ERR(task));
+			if (i == 0)
+				el->el_rc = PTR_ERR(task);
+			break;
+		}
+	}
+
+	if (!atomic_dec_and_test(&el->el_running) &&
+	    wait_event_interruptible(el->el_waitq,
+				     atomic_read(&el->el_running) == 0)) {
+		/* let the threads finish the I/O they have in flight */
+		spin_lock(&el->el_lock);
+		el->el_stop = true;
+		if (el->el_rc == 0)
+			el->el_rc = -EINTR;
+		spin_unlock(&el->el_lock);
+		wait_event(el->el_waitq, atomic_read(&el->el_running) == 0);
+	}
+	elp->elp_usec = ktime_us_delta(ktime_get(), start);
+
+	rc = el->el_rc;
+	if (copy_to_user(data->ioc_pbuf1, elp, sizeof(*elp)) && rc == 0)
+		rc = -EFAULT;
+
+	EXIT;
+out_put:
+	for (i = 0; i < elp->elp_objects && el->el_objs[i] != NULL; i++)
+		echo_put_object(el->el_objs[i]);
+out_free:
+	if (el != NULL) {
+		if (el->el_objs != NULL)
+			OBD_FREE_LARGE(el->el_objs, elp->elp_objects *
+				       sizeof(*el->el_objs));
+		if (el->el_oas != NULL)
+			OBD_FREE_LARGE(el->el_oas, elp->elp_objects *
+				       sizeof(*el->el_oas));
+		if (el->el_offsets != NULL)
+			OBD_FREE_LARGE(el->el_offsets, elp->elp_objects *
+				       sizeof(*el->el_offsets));
+		OBD_FREE_PTR(el);
+	}
+	if (elp != NULL)
+		OBD_FREE_PTR(elp);
+
+	return rc;
+}
+
 static int
 echo_client_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
 		      void *karg, void __user *uarg)
@@ -2904,6 +3375,10 @@ echo_client_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
 		rc = echo_client_brw_ioctl(env, rw, exp, data);
                 GOTO(out, rc);
 
+	case OBD_IOC_ECHO_LOAD:
+		rc = echo_client_load(ed, data);
+		GOTO(out, rc);
+
         default:
                 CERROR ("echo_ioctl(): unrecognised ioctl %#x\n", cmd);
                 GOTO (out, rc = -ENOTTY);
@@ -706,6 +706,8 @@ LPROC_SEQ_FOPS_WR_ONLY(ofd, evict_client);
 LPROC_SEQ_FOPS_RO_TYPE(ofd, num_exports);
 LPROC_SEQ_FOPS_RO_TYPE(ofd, target_instance);
 LPROC_SEQ_FOPS_RW_TYPE(ofd, ir_factor);
+LPROC_SEQ_FOPS_RW_TYPE(ofd, conn_limit);
+LPROC_SEQ_FOPS_RW_TYPE(ofd, conn_window);
 LPROC_SEQ_FOPS_RW_TYPE(ofd, checksum_dump);
 LPROC_SEQ_FOPS_RW_TYPE(ofd, job_interval);
 
@@ -739,6 +741,10 @@ struct lprocfs_vars lprocfs_ofd_obd_vars[] = {
 	  .fops =	&ofd_target_instance_fops	},
 	{ .name =	"ir_factor",
 	  .fops =	&ofd_ir_factor_fops		},
+	{ .name =	"connect_limit",
+	  .fops =	&ofd_conn_limit_fops		},
+	{ .name =	"connect_window",
+	  .fops =	&ofd_conn_window_fops		},
 	{ .name =	"checksum_dump",
 	  .fops =	&ofd_checksum_dump_fops		},
 	{ .name =	"grant_compat_disable",
@@ -1883,6 +1883,15 @@ static int ofd_sync_hdl(struct tgt_session_info *tsi)
 
 	repbody = req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
 
+	/* the client is short of memory for its unstable pages, start the
+	 * commit of its writes but do not keep a thread waiting for it */
+	if (body->oa.o_valid & OBD_MD_FLFLAGS &&
+	    body->oa.o_flags & OBD_FL_SOFT_SYNC) {
+		CDEBUG(D_INODE, "%s: soft sync from %s\n", ofd_name(ofd),
+		       obd_export_nid2str(tsi->tsi_exp));
+		RETURN(dt_commit_async(tsi->tsi_env, ofd->ofd_osd));
+	}
+
 	/* if no objid is specified, it means "sync whole filesystem" */
 	if (!fid_is_zero(&tsi->tsi_fid)) {
 		fo = ofd_object_find_exists(tsi->tsi_env, ofd, &tsi->tsi_fid);
@@ -2727,6 +2736,11 @@ TGT_OST_HDL(0		| HABEO_REFERO,	OST_QUOTACTL,	ofd_quotactl),
 TGT_OST_HDL(HABEO_CORPUS | HABEO_REFERO, OST_LADVISE,	ofd_ladvise_hdl),
 };
 
+/* batches of glimpses, the only MDS opcode the OFD accepts */
+static struct tgt_handler ofd_batch_handlers[] = {
+TGT_MDT_HDL(0,				MDS_BATCH,	tgt_batch),
+};
+
 static struct tgt_opc_slice ofd_common_slice[] = {
 	{
 		.tos_opc_start	= OST_FIRST_OPC,
@@ -2763,6 +2777,11 @@ static struct tgt_opc_slice ofd_common_slice[] = {
 		.tos_opc_end    = SEC_LAST_OPC,
 		.tos_hs         = tgt_sec_ctx_handlers
 	},
+	{
+		.tos_opc_start	= MDS_FIRST_OPC,
+		.tos_opc_end	= MDS_LAST_OPC,
+		.tos_hs		= ofd_batch_handlers
+	},
 	{
 		.tos_hs		= NULL
 	}
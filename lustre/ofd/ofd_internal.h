@@ -121,6 +121,9 @@ struct ofd_device {
 
 	/* preferred BRW size, decided by storage type and capability */
 	__u32			 ofd_brw_size;
+	/* bulk I/O between ofd_preprw() and ofd_commitrw(), reported to
+	 * the MDTs in os_load for their QoS allocator */
+	atomic_t		 ofd_brw_inflight;
 	/* checksum types supported on this node */
 	enum cksum_types	 ofd_cksum_types_supported;
 
@@ -840,6 +840,8 @@ int ofd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		       exp->exp_obd->obd_name, cmd);
 		rc = -EPROTO;
 	}
+	if (rc == 0)
+		atomic_inc(&ofd->ofd_brw_inflight);
 	RETURN(rc);
 }
 
@@ -1286,6 +1288,8 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 
 	LASSERT(npages > 0);
 
+	atomic_dec(&ofd->ofd_brw_inflight);
+
 	if (cmd == OBD_BRW_WRITE) {
 		struct lu_nodemap *nodemap;
 
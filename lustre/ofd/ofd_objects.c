@@ -257,6 +257,8 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 	struct dt_object	*next;
 	struct thandle		*th;
 	struct ofd_object	**batch;
+	struct dt_object	**creates;
+	int			*create_idx;
 	struct lu_fid		*fid = &info->fti_fid;
 	u64			tmp;
 	int			rc;
@@ -264,6 +266,7 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 	int			i;
 	int			objects = 0;
 	int			nr_saved = nr;
+	int			count;
 
 	ENTRY;
 
@@ -284,6 +287,11 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 	if (batch == NULL)
 		RETURN(-ENOMEM);
 
+	OBD_ALLOC(creates, nr_saved * sizeof(struct dt_object *));
+	OBD_ALLOC(create_idx, nr_saved * sizeof(int));
+	if (creates == NULL || create_idx == NULL)
+		GOTO(out, rc = -ENOMEM);
+
 	info->fti_attr.la_valid = LA_TYPE | LA_MODE;
 	info->fti_attr.la_mode = S_IFREG | S_ISUID | S_ISGID | S_ISVTX | 0666;
 	info->fti_dof.dof_type = dt_mode_to_dft(S_IFREG);
@@ -390,7 +398,10 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 			GOTO(trans_stop, rc);
 	}
 
-	for (i = 0; i < nr; i++) {
+	/* Create all the missing objects of the batch in one go, the OSD
+	 * allocates them together and updates its indices in its own order.
+	 */
+	for (i = 0, count = 0; i < nr; i++) {
 		fo = batch[i];
 		LASSERT(fo);
 
@@ -408,19 +419,26 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 			next = ofd_object_child(fo);
 			LASSERT(next != NULL);
 
-			rc = dt_create(env, next, &info->fti_attr, NULL,
-				       &info->fti_dof, th);
-			if (rc < 0) {
-				if (i == 0)
-					GOTO(trans_stop, rc);
-
-				rc = 0;
-				break;
-			}
-			LASSERT(ofd_object_exists(fo));
+			creates[count] = next;
+			create_idx[count] = i;
+			count++;
+		}
+	}
+
+	i = nr;
+	if (count > 0) {
+		rc = dt_create_batch(env, creates, count, &info->fti_attr,
+				     NULL, &info->fti_dof, th);
+		if (rc < count) {
+			/* the objects up to the first failed one are kept */
+			i = create_idx[rc > 0 ? rc : 0];
+			if (i == 0)
+				GOTO(trans_stop, rc);
 		}
-		ofd_seq_last_oid_set(oseq, id + i);
+		rc = 0;
 	}
+	if (i > 0)
+		ofd_seq_last_oid_set(oseq, id + i - 1);
 
 	objects = i;
 	/* NOT all the wanted objects have been created,
@@ -459,6 +477,10 @@ out:
 		}
 	}
 	OBD_FREE(batch, nr_saved * sizeof(struct ofd_object *));
+	if (creates != NULL)
+		OBD_FREE(creates, nr_saved * sizeof(struct dt_object *));
+	if (create_idx != NULL)
+		OBD_FREE(create_idx, nr_saved * sizeof(int));
 
 	CDEBUG((objects == 0 && rc == 0) ? D_ERROR : D_OTHER,
 	       "created %d/%d objects: %d\n", objects, nr_saved, rc);
@@ -35,6 +35,7 @@
 #include <asm/statfs.h>
 #include <obd_cksum.h>
 #include <obd_class.h>
+#include <obd_compr.h>
 #include <lprocfs_status.h>
 #include <linux/seq_file.h>
 #include <lustre_osc.h>
@@ -364,6 +365,36 @@ static ssize_t grant_shrink_interval_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(grant_shrink_interval);
 
+static ssize_t writeback_deadline_show(struct kobject *kobj,
+				       struct attribute *attr,
+				       char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_writeback_deadline);
+}
+
+static ssize_t writeback_deadline_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer,
+					size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	obd->u.cli.cl_writeback_deadline = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(writeback_deadline);
+
 static ssize_t checksums_show(struct kobject *kobj,
 			      struct attribute *attr,
 			      char *buf)
@@ -448,6 +479,59 @@ static ssize_t osc_checksum_type_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(osc_checksum_type);
 
+static ssize_t compress_type_show(struct kobject *kobj,
+				  struct attribute *attr,
+				  char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	enum obd_compr_type type;
+	ssize_t len = 0;
+
+	for (type = OBD_COMPR_NONE; type <= OBD_COMPR_LZO; type++)
+		len += sprintf(buf + len,
+			       obd->u.cli.cl_compr_type == type ?
+			       "[%s] " : "%s ", obd_compr_name(type));
+	len += sprintf(buf + len, "\n");
+
+	return len;
+}
+
+static ssize_t compress_type_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer,
+				   size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	char name[16];
+	int type;
+	int rc;
+
+	if (count >= sizeof(name))
+		return -EINVAL;
+	memcpy(name, buffer, count);
+	name[count] = '\0';
+	if (count > 0 && name[count - 1] == '\n')
+		name[count - 1] = '\0';
+
+	type = obd_compr_parse(name);
+	if (type < 0)
+		return type;
+
+	/* the compressor is needed to decompress the data read too */
+	if (type != OBD_COMPR_NONE) {
+		rc = obd_compr_prepare(type);
+		if (rc)
+			return rc;
+	}
+
+	obd->u.cli.cl_compr_type = type;
+
+	return count;
+}
+LUSTRE_RW_ATTR(compress_type);
+
 static ssize_t resend_count_show(struct kobject *kobj,
 				 struct attribute *attr,
 				 char *buf)
@@ -572,6 +656,37 @@ static ssize_t lockless_truncate_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(lockless_truncate);
 
+static ssize_t batch_max_show(struct kobject *kobj, struct attribute *attr,
+			      char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.cli.cl_batch_max);
+}
+
+/* max # of glimpse requests in a MDS_BATCH RPC, 1 disables batching */
+static ssize_t batch_max_store(struct kobject *kobj, struct attribute *attr,
+			       const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > MDS_BATCH_MAXCOUNT)
+		return -ERANGE;
+
+	obd->u.cli.cl_batch_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(batch_max);
+
 static ssize_t destroys_in_flight_show(struct kobject *kobj,
 				       struct attribute *attr,
 				       char *buf)
@@ -600,8 +715,11 @@ static int osc_unstable_stats_seq_show(struct seq_file *m, void *v)
 	mb    = (pages * PAGE_SIZE) >> 20;
 
 	seq_printf(m, "unstable_pages: %20ld\n"
-		   "unstable_mb:              %10d\n",
-		   pages, mb);
+		   "unstable_mb:              %10d\n"
+		   "commit_ms:                %10u\n"
+		   "soft_syncs:     %20llu\n",
+		   pages, mb, READ_ONCE(cli->cl_unstable_commit_ms),
+		   cli->cl_soft_sync_count);
 	return 0;
 }
 LPROC_SEQ_FOPS_RO(osc_unstable_stats);
@@ -787,6 +905,8 @@ static int osc_rpc_stats_seq_show(struct seq_file *seq, void *v)
 		   atomic_read(&cli->cl_pending_w_pages));
 	seq_printf(seq, "pending read pages:   %d\n",
 		   atomic_read(&cli->cl_pending_r_pages));
+	seq_printf(seq, "write RPCs expired:   %llu\n",
+		   cli->cl_w_expired);
 
 	seq_printf(seq, "\n\t\t\tread\t\t\twrite\n");
 	seq_printf(seq, "pages per rpc         rpcs   %% cum %% |");
@@ -812,6 +932,28 @@ static int osc_rpc_stats_seq_show(struct seq_file *seq, void *v)
 			break;
 	}
 
+	seq_printf(seq, "\n\t\t\tread\t\t\twrite\n");
+	seq_printf(seq, "rpc fullness          rpcs   %% cum %% |");
+	seq_printf(seq, "       rpcs   %% cum %%\n");
+
+	read_tot = lprocfs_oh_sum(&cli->cl_read_fullness_hist);
+	write_tot = lprocfs_oh_sum(&cli->cl_write_fullness_hist);
+
+	read_cum = 0;
+	write_cum = 0;
+	for (i = 0; i <= 10; i++) {
+		unsigned long r = cli->cl_read_fullness_hist.oh_buckets[i];
+		unsigned long w = cli->cl_write_fullness_hist.oh_buckets[i];
+
+		read_cum += r;
+		write_cum += w;
+		seq_printf(seq, "%d%%:\t\t%10lu %3u %3u   | %10lu %3u %3u\n",
+			   i * 10, r, pct(r, read_tot),
+			   pct(read_cum, read_tot), w,
+			   pct(w, write_tot),
+			   pct(write_cum, write_tot));
+	}
+
 	seq_printf(seq, "\n\t\t\tread\t\t\twrite\n");
 	seq_printf(seq, "rpcs in flight        rpcs   %% cum %% |");
 	seq_printf(seq, "       rpcs   %% cum %%\n");
@@ -876,6 +1018,9 @@ static ssize_t osc_rpc_stats_seq_write(struct file *file,
         lprocfs_oh_clear(&cli->cl_write_page_hist);
         lprocfs_oh_clear(&cli->cl_read_offset_hist);
         lprocfs_oh_clear(&cli->cl_write_offset_hist);
+	lprocfs_oh_clear(&cli->cl_read_fullness_hist);
+	lprocfs_oh_clear(&cli->cl_write_fullness_hist);
+	cli->cl_w_expired = 0;
 
         return len;
 }
@@ -930,7 +1075,9 @@ int lprocfs_osc_attach_seqstat(struct obd_device *dev)
 
 static struct attribute *osc_attrs[] = {
 	&lustre_attr_active.attr,
+	&lustre_attr_batch_max.attr,
 	&lustre_attr_checksums.attr,
+	&lustre_attr_compress_type.attr,
 	&lustre_attr_checksum_dump.attr,
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_cur_dirty_bytes.attr,
@@ -948,6 +1095,7 @@ static struct attribute *osc_attrs[] = {
 	&lustre_attr_idle_timeout.attr,
 	&lustre_attr_idle_connect.attr,
 	&lustre_attr_grant_shrink.attr,
+	&lustre_attr_writeback_deadline.attr,
 	NULL,
 };
 
@@ -39,6 +39,7 @@
 
 #include <lustre_osc.h>
 #include <lustre_dlm.h>
+#include <obd_class.h>
 
 #include "osc_internal.h"
 
@@ -322,7 +323,7 @@ static struct osc_extent *osc_extent_alloc(struct osc_object *obj)
 {
 	struct osc_extent *ext;
 
-	OBD_SLAB_ALLOC_PTR_GFP(ext, osc_extent_kmem, GFP_NOFS);
+	OBD_MAG_ALLOC_PTR(ext, osc_extent_mag);
 	if (ext == NULL)
 		return NULL;
 
@@ -342,7 +343,7 @@ static struct osc_extent *osc_extent_alloc(struct osc_object *obj)
 
 static void osc_extent_free(struct osc_extent *ext)
 {
-	OBD_SLAB_FREE_PTR(ext, osc_extent_kmem);
+	OBD_MAG_FREE_PTR(ext, osc_extent_mag);
 }
 
 static struct osc_extent *osc_extent_get(struct osc_extent *ext)
@@ -1552,6 +1553,157 @@ static int osc_enter_cache_try(struct client_obd *cli,
 	return 0;
 }
 
+/*
+ * A job whose writers had to wait for cache or grant on this OSC lately.
+ *
+ * The waiters are woken in order of the pages their job was let into the
+ * cache while it was contended, the oldest waiter first among equals, so
+ * that a job doing a few small writes does not queue behind the bulk
+ * writers of another job on the same client. The count halves every
+ * second; a job is forgotten once it has no waiters and its count is 0.
+ */
+struct osc_cache_job {
+	struct list_head	ocj_list;	/* on cl_cache_jobs */
+	char			ocj_jobid[LUSTRE_JOBID_SIZE];
+	unsigned long		ocj_pages;
+	time64_t		ocj_stamp;	/* last decay of ocj_pages */
+	int			ocj_waiters;
+};
+
+struct osc_cache_waiter {
+	struct list_head	ocw_entry;	/* on cl_cache_waiters */
+	wait_queue_head_t	ocw_waitq;
+	struct osc_cache_job	*ocw_job;
+	/* picked by osc_wake_cache_waiters() to try for the cache */
+	bool			ocw_woken;
+};
+
+static unsigned long osc_cache_job_pages(struct osc_cache_job *ocj,
+					 time64_t now)
+{
+	time64_t age = now - ocj->ocj_stamp;
+
+	if (age > 0) {
+		ocj->ocj_pages = age < BITS_PER_LONG ?
+				 ocj->ocj_pages >> age : 0;
+		ocj->ocj_stamp = now;
+	}
+
+	return ocj->ocj_pages;
+}
+
+/* The waiter to try for the cache next, called with cl_loi_list_lock held */
+static struct osc_cache_waiter *osc_cache_waiter_next(struct client_obd *cli)
+{
+	struct osc_cache_waiter *ocw;
+	struct osc_cache_waiter *next = NULL;
+	unsigned long min = 0;
+	time64_t now = ktime_get_seconds();
+
+	list_for_each_entry(ocw, &cli->cl_cache_waiters, ocw_entry) {
+		unsigned long pages = 0;
+
+		if (ocw->ocw_job != NULL)
+			pages = osc_cache_job_pages(ocw->ocw_job, now);
+		if (next == NULL || pages < min) {
+			next = ocw;
+			min = pages;
+			if (min == 0)
+				break;
+		}
+	}
+
+	return next;
+}
+
+/**
+ * Let the waiter for cache or grant whose job got the fewest pages into
+ * the cache lately try again. Called with cl_loi_list_lock held each time
+ * dirty pages or grant are released.
+ */
+void osc_wake_cache_waiters(struct client_obd *cli)
+{
+	struct osc_cache_waiter *ocw;
+
+	ocw = osc_cache_waiter_next(cli);
+	if (ocw != NULL) {
+		ocw->ocw_woken = true;
+		wake_up(&ocw->ocw_waitq);
+	}
+}
+EXPORT_SYMBOL(osc_wake_cache_waiters);
+
+/*
+ * Find the accounting of \a jobid, or add it from \a new, and forget the
+ * idle jobs on the way. Called with cl_loi_list_lock held.
+ */
+static struct osc_cache_job *osc_cache_job_get(struct client_obd *cli,
+					       const char *jobid,
+					       struct osc_cache_job **new)
+{
+	struct osc_cache_job *ocj;
+	struct osc_cache_job *tmp;
+	struct osc_cache_job *found = NULL;
+	time64_t now = ktime_get_seconds();
+
+	list_for_each_entry_safe(ocj, tmp, &cli->cl_cache_jobs, ocj_list) {
+		if (found == NULL && strcmp(ocj->ocj_jobid, jobid) == 0) {
+			found = ocj;
+			continue;
+		}
+		if (ocj->ocj_waiters == 0 &&
+		    osc_cache_job_pages(ocj, now) == 0) {
+			list_del(&ocj->ocj_list);
+			OBD_FREE_PTR(ocj);
+		}
+	}
+
+	if (found == NULL && *new != NULL) {
+		found = *new;
+		*new = NULL;
+		strlcpy(found->ocj_jobid, jobid, sizeof(found->ocj_jobid));
+		found->ocj_stamp = now;
+		list_add_tail(&found->ocj_list, &cli->cl_cache_jobs);
+	}
+	if (found != NULL)
+		found->ocj_waiters++;
+
+	return found;
+}
+
+void osc_cache_jobs_fini(struct client_obd *cli)
+{
+	struct osc_cache_job *ocj;
+	struct osc_cache_job *tmp;
+
+	LASSERT(list_empty(&cli->cl_cache_waiters));
+
+	list_for_each_entry_safe(ocj, tmp, &cli->cl_cache_jobs, ocj_list) {
+		list_del(&ocj->ocj_list);
+		OBD_FREE_PTR(ocj);
+	}
+}
+
+/*
+ * Wait condition of osc_enter_cache(): enter the cache once picked by
+ * osc_wake_cache_waiters(), or give up when nothing is left to write out to
+ * make room.
+ */
+static bool osc_cache_waiter_try(struct client_obd *cli,
+				 struct osc_cache_waiter *ocw,
+				 struct osc_async_page *oap, int bytes,
+				 bool *entered)
+{
+	if (ocw->ocw_woken) {
+		ocw->ocw_woken = false;
+		*entered = osc_enter_cache_try(cli, oap, bytes);
+		if (*entered)
+			return true;
+	}
+
+	return cli->cl_dirty_pages == 0 && cli->cl_w_in_flight == 0;
+}
+
 /* Following two inlines exist to pass code fragments
  * to wait_event_idle_exclusive_timeout_cmd().  Passing
  * code fragments as macro args can look confusing, so
@@ -1577,13 +1729,18 @@ static inline void cli_lock_after_unplug(struct client_obd *cli)
  * in this function will be freed in bulk in osc_free_grant() unless it fails
  * to add osc cache, in that case, it will be freed in osc_exit_cache().
  *
- * The process will be put into sleep if it's already run out of grant.
+ * The process will be put into sleep if it's already run out of grant. The
+ * sleepers are woken fairly between jobs, see struct osc_cache_job.
  */
 static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 			   struct osc_async_page *oap, int bytes)
 {
 	struct osc_object *osc = oap->oap_obj;
 	struct lov_oinfo *loi = osc->oo_oinfo;
+	struct osc_cache_waiter ocw;
+	struct osc_cache_waiter *tmp;
+	struct osc_cache_job *ocj = NULL;
+	char jobid[LUSTRE_JOBID_SIZE];
 	int rc = -EDQUOT;
 	int remain;
 	bool entered = false;
@@ -1613,6 +1770,26 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 		GOTO(out, rc = -EDQUOT);
 	}
 
+	if (list_empty(&cli->cl_cache_waiters) &&
+	    osc_enter_cache_try(cli, oap, bytes)) {
+		OSC_DUMP_GRANT(D_CACHE, cli, "granted from cache\n");
+		GOTO(out, rc = 0);
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	/* the cache is contended, queue up with the job of this process */
+	jobid[0] = '\0';
+	lustre_get_jobid(jobid, sizeof(jobid));
+	OBD_ALLOC_PTR(ocj);
+
+	INIT_LIST_HEAD(&ocw.ocw_entry);
+	init_waitqueue_head(&ocw.ocw_waitq);
+
+	spin_lock(&cli->cl_loi_list_lock);
+	ocw.ocw_job = osc_cache_job_get(cli, jobid, &ocj);
+	list_add_tail(&ocw.ocw_entry, &cli->cl_cache_waiters);
+	ocw.ocw_woken = osc_cache_waiter_next(cli) == &ocw;
+
 	/*
 	 * We can wait here for two reasons: too many dirty pages in cache, or
 	 * run out of grants. In both cases we should write dirty pages out.
@@ -1623,34 +1800,45 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	 * on the OST.
 	 */
 	remain = wait_event_idle_exclusive_timeout_cmd(
-		cli->cl_cache_waiters,
-		(entered = osc_enter_cache_try(cli, oap, bytes)) ||
-		(cli->cl_dirty_pages == 0 && cli->cl_w_in_flight == 0),
+		ocw.ocw_waitq,
+		osc_cache_waiter_try(cli, &ocw, oap, bytes, &entered),
 		timeout,
 		cli_unlock_and_unplug(env, cli, oap),
 		cli_lock_after_unplug(cli));
 
+	list_del(&ocw.ocw_entry);
+	if (ocw.ocw_job != NULL) {
+		ocw.ocw_job->ocj_waiters--;
+		if (entered)
+			ocw.ocw_job->ocj_pages +=
+				1 << (cli->cl_chunkbits - PAGE_SHIFT);
+	}
+
 	if (entered) {
-		if (remain == timeout)
-			OSC_DUMP_GRANT(D_CACHE, cli, "granted from cache\n");
-		else
-			OSC_DUMP_GRANT(D_CACHE, cli,
-				       "finally got grant space\n");
-		wake_up(&cli->cl_cache_waiters);
+		OSC_DUMP_GRANT(D_CACHE, cli, "finally got grant space\n");
+		/* there may be room left for the next waiter */
+		osc_wake_cache_waiters(cli);
 		rc = 0;
 	} else if (remain == 0) {
 		OSC_DUMP_GRANT(D_CACHE, cli,
 			       "timeout, fall back to sync i/o\n");
 		osc_extent_tree_dump(D_CACHE, osc);
+		/* pass on the wakeup this waiter may have been given */
+		osc_wake_cache_waiters(cli);
 		/* fall back to synchronous I/O */
 	} else {
 		OSC_DUMP_GRANT(D_CACHE, cli,
 			       "no grant space, fall back to sync i/o\n");
-		wake_up_all(&cli->cl_cache_waiters);
+		list_for_each_entry(tmp, &cli->cl_cache_waiters, ocw_entry) {
+			tmp->ocw_woken = true;
+			wake_up(&tmp->ocw_waitq);
+		}
 	}
 	EXIT;
 out:
 	spin_unlock(&cli->cl_loi_list_lock);
+	if (ocj != NULL)
+		OBD_FREE_PTR(ocj);
 	RETURN(rc);
 }
 
@@ -1660,6 +1848,21 @@ static int osc_max_rpc_in_flight(struct client_obd *cli, struct osc_object *osc)
 	return rpcs_in_flight(cli) >= cli->cl_max_rpcs_in_flight + hprpc;
 }
 
+/*
+ * Return true if @osc has been waiting with dirty pages for longer than the
+ * writeback deadline, since it was queued in cl_loi_write_list. Objects are
+ * queued again each time a write RPC is tried for them, so the list is in
+ * order of deadline.
+ */
+static inline bool osc_write_expired(struct client_obd *cli,
+				     struct osc_object *osc)
+{
+	unsigned int deadline = READ_ONCE(cli->cl_writeback_deadline);
+
+	return deadline != 0 &&
+	       ktime_get_seconds() >= osc->oo_write_queued + deadline;
+}
+
 /* This maintains the lists of pending pages to read/write for a given object
  * (lop).  This is used by osc_check_rpcs->osc_next_obj() and osc_list_maint()
  * to quickly find objects that are ready to send an RPC. */
@@ -1695,7 +1898,7 @@ static int osc_makes_rpc(struct client_obd *cli, struct osc_object *osc,
 		 * waiting for space.  as they're waiting, they're not going to
 		 * create more pages to coalesce with what's waiting..
 		 */
-		if (waitqueue_active(&cli->cl_cache_waiters)) {
+		if (!list_empty(&cli->cl_cache_waiters)) {
 			CDEBUG(D_CACHE, "cache waiters forcing RPC\n");
 			RETURN(1);
 		}
@@ -1703,6 +1906,10 @@ static int osc_makes_rpc(struct client_obd *cli, struct osc_object *osc,
 			CDEBUG(D_CACHE, "full extent ready, make an RPC\n");
 			RETURN(1);
 		}
+		if (osc_write_expired(cli, osc)) {
+			CDEBUG(D_CACHE, "writeback deadline forcing RPC\n");
+			RETURN(1);
+		}
 	} else {
 		if (atomic_read(&osc->oo_nr_reads) == 0)
 			RETURN(0);
@@ -1751,6 +1958,17 @@ static void on_list(struct list_head *item, struct list_head *list,
  * can find pages to build into rpcs quickly */
 static int __osc_list_maint(struct client_obd *cli, struct osc_object *osc)
 {
+	/* before the ready lists, which depend on oo_write_queued */
+	if (atomic_read(&osc->oo_nr_writes) > 0) {
+		if (list_empty(&osc->oo_write_item)) {
+			osc->oo_write_queued = ktime_get_seconds();
+			list_add_tail(&osc->oo_write_item,
+				      &cli->cl_loi_write_list);
+		}
+	} else {
+		list_del_init(&osc->oo_write_item);
+	}
+
 	if (osc_makes_hprpc(osc)) {
 		/* HP rpc */
 		on_list(&osc->oo_ready_item, &cli->cl_loi_ready_list, 0);
@@ -1762,9 +1980,6 @@ static int __osc_list_maint(struct client_obd *cli, struct osc_object *osc)
 			osc_makes_rpc(cli, osc, OBD_BRW_READ));
 	}
 
-	on_list(&osc->oo_write_item, &cli->cl_loi_write_list,
-		atomic_read(&osc->oo_nr_writes) > 0);
-
 	on_list(&osc->oo_read_item, &cli->cl_loi_read_list,
 		atomic_read(&osc->oo_nr_reads) > 0);
 
@@ -2172,6 +2387,22 @@ static struct osc_object *osc_next_obj(struct client_obd *cli)
 	 * then objects which have pages ready to be stuffed into RPCs */
 	if (!list_empty(&cli->cl_loi_hp_ready_list))
 		RETURN(list_to_obj(&cli->cl_loi_hp_ready_list, hp_ready_item));
+
+	/* then the object waiting for the longest time with dirty pages if
+	 * it is past its deadline, so that the objects always ready, like
+	 * the ones of a streaming writer, do not hold the others back */
+	if (!list_empty(&cli->cl_loi_write_list)) {
+		struct osc_object *osc;
+
+		osc = list_entry(cli->cl_loi_write_list.next,
+				 struct osc_object, oo_write_item);
+		if (osc_write_expired(cli, osc)) {
+			cli->cl_w_expired++;
+			RETURN(list_to_obj(&cli->cl_loi_write_list,
+					   write_item));
+		}
+	}
+
 	if (!list_empty(&cli->cl_loi_ready_list))
 		RETURN(list_to_obj(&cli->cl_loi_ready_list, ready_item));
 
@@ -2180,7 +2411,7 @@ static struct osc_object *osc_next_obj(struct client_obd *cli)
 	 * have filled up the cache and not been fired into rpcs because
 	 * they don't pass the nr_pending/object threshhold
 	 */
-	if (waitqueue_active(&cli->cl_cache_waiters) &&
+	if (!list_empty(&cli->cl_cache_waiters) &&
 	    !list_empty(&cli->cl_loi_write_list))
 		RETURN(list_to_obj(&cli->cl_loi_write_list, write_item));
 
@@ -2208,6 +2439,7 @@ __must_hold(&cli->cl_loi_list_lock)
 	while ((osc = osc_next_obj(cli)) != NULL) {
 		struct cl_object *obj = osc2cl(osc);
 		struct lu_ref_link link;
+		bool requeue = false;
 
 		OSC_IO_DEBUG(osc, "%lu in flight\n", rpcs_in_flight(cli));
 
@@ -2233,6 +2465,7 @@ __must_hold(&cli->cl_loi_list_lock)
 		 * do io on writes while there are cache waiters */
 		osc_object_lock(osc);
 		if (osc_makes_rpc(cli, osc, OBD_BRW_WRITE)) {
+			requeue = true;
 			rc = osc_send_write_rpc(env, cli, osc);
 			if (rc < 0) {
 				CERROR("Write request failed with %d\n", rc);
@@ -2263,7 +2496,13 @@ __must_hold(&cli->cl_loi_list_lock)
 		}
 		osc_object_unlock(osc);
 
-		osc_list_maint(cli, osc);
+		spin_lock(&cli->cl_loi_list_lock);
+		/* its writeback deadline starts over behind the others */
+		if (requeue)
+			list_del_init(&osc->oo_write_item);
+		__osc_list_maint(cli, osc);
+		spin_unlock(&cli->cl_loi_list_lock);
+
 		lu_object_ref_del_at(&obj->co_lu, &link, "check", current);
 		cl_object_put(env, obj);
 
@@ -2405,7 +2644,11 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 
 		/* it doesn't need any grant to dirty this page */
 		spin_lock(&cli->cl_loi_list_lock);
-		rc = osc_enter_cache_try(cli, oap, grants);
+		/* a new chunk goes to the cache waiters first */
+		if (grants > 0 && !list_empty(&cli->cl_cache_waiters))
+			rc = 0;
+		else
+			rc = osc_enter_cache_try(cli, oap, grants);
 		spin_unlock(&cli->cl_loi_list_lock);
 		if (rc == 0) { /* try failed */
 			grants = 0;
@@ -2438,6 +2681,10 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 	if (ext == NULL) {
 		tmp = (1 << cli->cl_chunkbits) + cli->cl_grant_extent_tax;
 
+		/* we may wait for the writeback of the pages committed by this
+		 * IO below, unlock them first */
+		osc_io_commit_flush(env, oio);
+
 		/* try to find new extent to cover this page */
 		LASSERT(oio->oi_active == NULL);
 		/* we may have allocated grant for this page if we failed
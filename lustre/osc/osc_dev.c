@@ -54,6 +54,7 @@ EXPORT_SYMBOL(osc_object_kmem);
 struct kmem_cache *osc_thread_kmem;
 struct kmem_cache *osc_session_kmem;
 struct kmem_cache *osc_extent_kmem;
+struct cfs_mag_cache *osc_extent_mag;
 struct kmem_cache *osc_quota_kmem;
 struct kmem_cache *osc_obdo_kmem;
 
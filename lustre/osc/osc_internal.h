@@ -53,6 +53,9 @@ int osc_lock_discard_pages(const struct lu_env *env, struct osc_object *osc,
 
 extern struct ptlrpc_request_set *PTLRPCD_SET;
 
+/* default max # of glimpse requests per MDS_BATCH RPC */
+#define OSC_BATCH_MAX_DEFAULT 16
+
 void osc_lock_lvb_update(const struct lu_env *env,
 			 struct osc_object *osc,
 			 struct ldlm_lock *dlmlock,
@@ -159,6 +162,7 @@ int osc_quotactl(struct obd_device *unused, struct obd_export *exp,
 void osc_inc_unstable_pages(struct ptlrpc_request *req);
 void osc_dec_unstable_pages(struct ptlrpc_request *req);
 bool osc_over_unstable_soft_limit(struct client_obd *cli);
+bool osc_over_unstable_budget(struct client_obd *cli);
 void osc_page_touch_at(const struct lu_env *env, struct cl_object *obj,
 		       pgoff_t idx, size_t to);
 
@@ -257,6 +257,35 @@ void osc_page_touch_at(const struct lu_env *env, struct cl_object *obj,
 	EXIT;
 }
 
+/**
+ * Hand the pages committed so far back to the upper layers, which unlock
+ * them. The attributes are updated once for the whole batch.
+ *
+ * This must be called before anything that can wait for the writeback of
+ * cached pages, since making those pages ready needs their locks.
+ */
+void osc_io_commit_flush(const struct lu_env *env, struct osc_io *oio)
+{
+	struct cl_page_list *batch = &oio->oi_commit_batch;
+	struct cl_object *obj = oio->oi_cl.cis_obj;
+	struct cl_page *page;
+	struct osc_page *opg;
+
+	if (oio->oi_commit_cb == NULL || batch->pl_nr == 0)
+		return;
+
+	page = cl_page_list_last(batch);
+	opg = osc_cl_page_osc(page, cl2osc(obj));
+	osc_page_touch_at(env, obj, osc_index(opg),
+			  page == oio->oi_commit_last ?
+			  oio->oi_commit_to : PAGE_SIZE);
+
+	(*oio->oi_commit_cb)(env, oio->oi_cl.cis_io, batch);
+	LASSERT(batch->pl_nr == 0);
+	/* Can't access these pages any more. They can be in transfer and
+	 * complete at any time. */
+}
+
 int osc_io_commit_async(const struct lu_env *env,
 			const struct cl_io_slice *ios,
 			struct cl_page_list *qin, int from, int to,
@@ -287,6 +316,12 @@ int osc_io_commit_async(const struct lu_env *env,
 		}
 	}
 
+	/* the pages are handed back in batches, see osc_io_commit_flush() */
+	cl_page_list_init(&oio->oi_commit_batch);
+	oio->oi_commit_cb = cb;
+	oio->oi_commit_last = last_page;
+	oio->oi_commit_to = to;
+
 	while (qin->pl_nr > 0) {
 		struct osc_async_page *oap;
 
@@ -311,16 +346,15 @@ int osc_io_commit_async(const struct lu_env *env,
 				break;
 		}
 
-		osc_page_touch_at(env, osc2cl(osc), osc_index(opg),
-				  page == last_page ? to : PAGE_SIZE);
-
-		cl_page_list_del(env, qin, page);
-
-		(*cb)(env, io, page);
-		/* Can't access page any more. Page can be in transfer and
-		 * complete at any time. */
+		cl_page_list_move(&oio->oi_commit_batch, qin, page);
+		if (oio->oi_commit_batch.pl_nr == PAGEVEC_SIZE)
+			osc_io_commit_flush(env, oio);
 	}
 
+	osc_io_commit_flush(env, oio);
+	oio->oi_commit_cb = NULL;
+	oio->oi_commit_last = NULL;
+
 	/* for sync write, kernel will wait for this page to be flushed before
 	 * osc_io_end() is called, so release it earlier.
 	 * for mkwrite(), it's known there is no further pages. */
@@ -159,7 +159,7 @@ static int osc_page_print(const struct lu_env *env,
                           cli->cl_r_in_flight, cli->cl_w_in_flight,
                           cli->cl_max_rpcs_in_flight,
                           cli->cl_avail_grant,
-			  waitqueue_active(&cli->cl_cache_waiters) ? '+' : '-',
+			  list_empty(&cli->cl_cache_waiters) ? '-' : '+',
                           osc_list(&cli->cl_loi_ready_list),
                           osc_list(&cli->cl_loi_hp_ready_list),
                           osc_list(&cli->cl_loi_write_list),
@@ -355,7 +355,7 @@ void osc_page_submit(const struct lu_env *env, struct osc_page *opg,
 /* OSC is a natural place to manage LRU pages as applications are specialized
  * to write OSC by OSC. Ideally, if one OSC is used more frequently it should
  * occupy more LRU slots. On the other hand, we should avoid using up all LRU
- * slots (client_obd::cl_lru_left) otherwise process has to be put into sleep
+ * slots (cl_client_cache::ccc_lru_left) otherwise process has to be put into sleep
  * for free LRU slots - this will be very bad so the algorithm requires each
  * OSC to free slots voluntarily to maintain a reasonable number of free slots
  * at any time.
@@ -446,10 +446,11 @@ void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 {
 	struct list_head lru = LIST_HEAD_INIT(lru);
 	struct osc_async_page *oap;
+	struct osc_page *opg;
 	long npages = 0;
 
 	list_for_each_entry(oap, plist, oap_pending_item) {
-		struct osc_page *opg = oap2osc_page(oap);
+		opg = oap2osc_page(oap);
 
 		if (!opg->ops_in_lru)
 			continue;
@@ -460,22 +461,40 @@ void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 	}
 
 	if (npages > 0) {
-		spin_lock(&cli->cl_lru_list_lock);
-		list_splice_tail(&lru, &cli->cl_lru_list);
+		int cpt = cfs_cpt_current(cfs_cpt_table, 0);
+		struct cl_lru_shard *shard = cli->cl_lru_shards[cpt];
+
+		list_for_each_entry(opg, &lru, ops_lru)
+			opg->ops_lru_cpt = cpt;
+
+		spin_lock(&shard->cls_lock);
+		list_splice_tail(&lru, &shard->cls_list);
+		shard->cls_count += npages;
+		spin_unlock(&shard->cls_lock);
+
 		atomic_long_sub(npages, &cli->cl_lru_busy);
 		atomic_long_add(npages, &cli->cl_lru_in_list);
 		cli->cl_lru_last_used = ktime_get_real_seconds();
-		spin_unlock(&cli->cl_lru_list_lock);
 
 		if (waitqueue_active(&osc_lru_waitq))
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
 	}
 }
 
-static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
+static inline struct cl_lru_shard *osc_lru_shard(struct client_obd *cli,
+						 struct osc_page *opg)
+{
+	return cli->cl_lru_shards[opg->ops_lru_cpt];
+}
+
+/* Must be called with the lock of the shard of @opg held */
+static void __osc_lru_del(struct client_obd *cli, struct cl_lru_shard *shard,
+			  struct osc_page *opg)
 {
 	LASSERT(atomic_long_read(&cli->cl_lru_in_list) > 0);
+	LASSERT(shard->cls_count > 0);
 	list_del_init(&opg->ops_lru);
+	shard->cls_count--;
 	atomic_long_dec(&cli->cl_lru_in_list);
 }
 
@@ -486,16 +505,18 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_shard *shard = osc_lru_shard(cli, opg);
+
+		spin_lock(&shard->cls_lock);
 		if (!list_empty(&opg->ops_lru)) {
-			__osc_lru_del(cli, opg);
+			__osc_lru_del(cli, shard, opg);
 		} else {
 			LASSERT(atomic_long_read(&cli->cl_lru_busy) > 0);
 			atomic_long_dec(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(&shard->cls_lock);
 
-		atomic_long_inc(cli->cl_lru_left);
+		cl_cache_lru_put(cli->cl_cache, 1);
 		/* this is a great place to release more LRU pages if
 		 * this osc occupies too many LRU pages and kernel is
 		 * stealing one of them. */
@@ -517,12 +538,14 @@ static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 	/* If page is being transferred for the first time,
 	 * ops_lru should be empty */
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_shard *shard = osc_lru_shard(cli, opg);
+
+		spin_lock(&shard->cls_lock);
 		if (!list_empty(&opg->ops_lru)) {
-			__osc_lru_del(cli, opg);
+			__osc_lru_del(cli, shard, opg);
 			atomic_long_inc(&cli->cl_lru_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(&shard->cls_lock);
 	}
 }
 
@@ -570,47 +593,28 @@ static inline bool lru_page_busy(struct client_obd *cli, struct cl_page *page)
 }
 
 /**
- * Drop @target of pages from LRU at most.
+ * Drop @target of pages from the LRU list of @shard at most.
  */
-long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
-		   long target, bool force)
+static long osc_lru_shrink_shard(const struct lu_env *env,
+				 struct client_obd *cli,
+				 struct cl_lru_shard *shard, long target,
+				 bool force, int *rcp)
 {
 	struct cl_io *io;
 	struct cl_object *clobj = NULL;
 	struct cl_page **pvec;
 	struct osc_page *opg;
 	long count = 0;
-	int maxscan = 0;
+	long maxscan = 0;
 	int index = 0;
 	int rc = 0;
-	ENTRY;
-
-	LASSERT(atomic_long_read(&cli->cl_lru_in_list) >= 0);
-	if (atomic_long_read(&cli->cl_lru_in_list) == 0 || target <= 0)
-		RETURN(0);
-
-	CDEBUG(D_CACHE, "%s: shrinkers: %d, force: %d\n",
-	       cli_name(cli), atomic_read(&cli->cl_lru_shrinkers), force);
-	if (!force) {
-		if (atomic_read(&cli->cl_lru_shrinkers) > 0)
-			RETURN(-EBUSY);
-
-		if (atomic_inc_return(&cli->cl_lru_shrinkers) > 1) {
-			atomic_dec(&cli->cl_lru_shrinkers);
-			RETURN(-EBUSY);
-		}
-	} else {
-		atomic_inc(&cli->cl_lru_shrinkers);
-	}
 
 	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
 	io = osc_env_thread_io(env);
 
-	spin_lock(&cli->cl_lru_list_lock);
-	if (force)
-		cli->cl_lru_reclaim++;
-	maxscan = min(target << 1, atomic_long_read(&cli->cl_lru_in_list));
-	while (!list_empty(&cli->cl_lru_list)) {
+	spin_lock(&shard->cls_lock);
+	maxscan = min(target << 1, shard->cls_count);
+	while (!list_empty(&shard->cls_list)) {
 		struct cl_page *page;
 		bool will_free = false;
 
@@ -620,11 +624,11 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		if (--maxscan < 0)
 			break;
 
-		opg = list_entry(cli->cl_lru_list.next, struct osc_page,
+		opg = list_entry(shard->cls_list.next, struct osc_page,
 				 ops_lru);
 		page = opg->ops_cl.cpl_page;
 		if (lru_page_busy(cli, page)) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			list_move_tail(&opg->ops_lru, &shard->cls_list);
 			continue;
 		}
 
@@ -633,7 +637,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			struct cl_object *tmp = page->cp_obj;
 
 			cl_object_get(tmp);
-			spin_unlock(&cli->cl_lru_list_lock);
+			spin_unlock(&shard->cls_lock);
 
 			if (clobj != NULL) {
 				discard_pagevec(env, io, pvec, index);
@@ -649,7 +653,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			io->ci_ignore_layout = 1;
 			rc = cl_io_init(env, io, CIT_MISC, clobj);
 
-			spin_lock(&cli->cl_lru_list_lock);
+			spin_lock(&shard->cls_lock);
 
 			if (rc != 0)
 				break;
@@ -662,7 +666,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			if (!lru_page_busy(cli, page)) {
 				/* remove it from lru list earlier to avoid
 				 * lock contention */
-				__osc_lru_del(cli, opg);
+				__osc_lru_del(cli, shard, opg);
 				opg->ops_in_lru = 0; /* will be discarded */
 
 				cl_page_get(page);
@@ -673,24 +677,24 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		}
 
 		if (!will_free) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			list_move_tail(&opg->ops_lru, &shard->cls_list);
 			continue;
 		}
 
-		/* Don't discard and free the page with cl_lru_list held */
+		/* Don't discard and free the page with cls_lock held */
 		pvec[index++] = page;
 		if (unlikely(index == OTI_PVEC_SIZE)) {
-			spin_unlock(&cli->cl_lru_list_lock);
+			spin_unlock(&shard->cls_lock);
 			discard_pagevec(env, io, pvec, index);
 			index = 0;
 
-			spin_lock(&cli->cl_lru_list_lock);
+			spin_lock(&shard->cls_lock);
 		}
 
 		if (++count >= target)
 			break;
 	}
-	spin_unlock(&cli->cl_lru_list_lock);
+	spin_unlock(&shard->cls_lock);
 
 	if (clobj != NULL) {
 		discard_pagevec(env, io, pvec, index);
@@ -699,9 +703,63 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		cl_object_put(env, clobj);
 	}
 
+	*rcp = rc;
+	return count;
+}
+
+/**
+ * Drop @target of pages from LRU at most, going through the LRU lists of
+ * all CPTs, from a different one at each call.
+ */
+long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
+		   long target, bool force)
+{
+	int ncpt = cfs_cpt_number(cfs_cpt_table);
+	long count = 0;
+	int start;
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	LASSERT(atomic_long_read(&cli->cl_lru_in_list) >= 0);
+	if (atomic_long_read(&cli->cl_lru_in_list) == 0 || target <= 0)
+		RETURN(0);
+
+	CDEBUG(D_CACHE, "%s: shrinkers: %d, force: %d\n",
+	       cli_name(cli), atomic_read(&cli->cl_lru_shrinkers), force);
+	if (!force) {
+		if (atomic_read(&cli->cl_lru_shrinkers) > 0)
+			RETURN(-EBUSY);
+
+		if (atomic_inc_return(&cli->cl_lru_shrinkers) > 1) {
+			atomic_dec(&cli->cl_lru_shrinkers);
+			RETURN(-EBUSY);
+		}
+	} else {
+		atomic_inc(&cli->cl_lru_shrinkers);
+		cli->cl_lru_reclaim++;
+	}
+
+	start = cli->cl_lru_shard_next++ % ncpt;
+	for (i = 0; i < ncpt && count < target; i++) {
+		struct cl_lru_shard *shard;
+
+		if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1)
+			break;
+
+		shard = cli->cl_lru_shards[(start + i) % ncpt];
+		if (READ_ONCE(shard->cls_count) == 0)
+			continue;
+
+		count += osc_lru_shrink_shard(env, cli, shard, target - count,
+					      force, &rc);
+		if (rc != 0)
+			break;
+	}
+
 	atomic_dec(&cli->cl_lru_shrinkers);
 	if (count > 0) {
-		atomic_long_add(count, cli->cl_lru_left);
+		cl_cache_lru_put(cli->cl_cache, count);
 		wake_up_all(&osc_lru_waitq);
 	}
 	RETURN(count > 0 ? count : rc);
@@ -810,8 +868,7 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 		goto out;
 	}
 
-	LASSERT(atomic_long_read(cli->cl_lru_left) >= 0);
-	while (!atomic_long_add_unless(cli->cl_lru_left, -1, 0)) {
+	while (!cl_cache_lru_get(cli->cl_cache, 1)) {
 		/* run out of LRU spaces, try to drop some by itself */
 		rc = osc_lru_reclaim(cli, 1);
 		if (rc < 0)
@@ -821,7 +878,7 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 
 		cond_resched();
 		rc = l_wait_event(osc_lru_waitq,
-				atomic_long_read(cli->cl_lru_left) > 0,
+				cl_cache_lru_left(cli->cl_cache) > 0,
 				&lwi);
 		if (rc < 0)
 			break;
@@ -840,14 +897,14 @@ out:
 /**
  * osc_lru_reserve() is called to reserve enough LRU slots for I/O.
  *
- * The benefit of doing this is to reduce contention against atomic counter
- * cl_lru_left by changing it from per-page access to per-IO access.
+ * The benefit of doing this is to reduce contention against the LRU slot
+ * counters by changing it from per-page access to per-IO access.
  */
 unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages)
 {
+	struct cl_client_cache *cache = cli->cl_cache;
 	unsigned long reserved = 0;
 	unsigned long max_pages;
-	unsigned long c;
 
 	/* reserve a full RPC window at most to avoid that a thread accidentally
 	 * consumes too many LRU slots */
@@ -855,16 +912,10 @@ unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages)
 	if (npages > max_pages)
 		npages = max_pages;
 
-	c = atomic_long_read(cli->cl_lru_left);
-	if (c < npages && osc_lru_reclaim(cli, npages) > 0)
-		c = atomic_long_read(cli->cl_lru_left);
-	while (c >= npages) {
-		if (c == atomic_long_cmpxchg(cli->cl_lru_left, c, c - npages)) {
-			reserved = npages;
-			break;
-		}
-		c = atomic_long_read(cli->cl_lru_left);
-	}
+	if (cl_cache_lru_get(cache, npages) ||
+	    (osc_lru_reclaim(cli, npages) > 0 &&
+	     cl_cache_lru_get(cache, npages)))
+		reserved = npages;
 	if (atomic_long_read(cli->cl_lru_left) < max_pages) {
 		/* If there aren't enough pages in the per-OSC LRU then
 		 * wake up the LRU thread to try and clear out space, so
@@ -887,7 +938,7 @@ unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages)
  */
 void osc_lru_unreserve(struct client_obd *cli, unsigned long npages)
 {
-	atomic_long_add(npages, cli->cl_lru_left);
+	cl_cache_lru_put(cli->cl_cache, npages);
 	wake_up_all(&osc_lru_waitq);
 }
 
@@ -1067,6 +1118,33 @@ bool osc_over_unstable_soft_limit(struct client_obd *cli)
 				    cli->cl_max_rpcs_in_flight;
 }
 
+/* OSTs committing writes slower than this get asked to commit sooner */
+#define OSC_UNSTABLE_COMMIT_MS	1000
+
+/**
+ * Check if this OSC has more unstable pages than it should wait for the
+ * OST to commit, so that it must send a soft sync RPC.
+ *
+ * The budget is one full RPC window of pages when the OST takes longer
+ * than OSC_UNSTABLE_COMMIT_MS to commit, and grows as the commits get
+ * faster since the pages are then released soon anyway. It is never more
+ * than a quarter of the LRU slots.
+ */
+bool osc_over_unstable_budget(struct client_obd *cli)
+{
+	unsigned int commit_ms = READ_ONCE(cli->cl_unstable_commit_ms);
+	long budget = cli->cl_max_pages_per_rpc * cli->cl_max_rpcs_in_flight;
+
+	if (cli->cl_cache == NULL || !cli->cl_cache->ccc_unstable_check)
+		return false;
+
+	if (commit_ms < OSC_UNSTABLE_COMMIT_MS)
+		budget *= OSC_UNSTABLE_COMMIT_MS / max(commit_ms, 1U);
+	budget = min_t(long, budget, cli->cl_cache->ccc_lru_max >> 2);
+
+	return atomic_long_read(&cli->cl_unstable_count) > budget;
+}
+
 /**
  * Return how many LRU pages in the cache of all OSC devices
  *
@@ -45,6 +45,7 @@
 #include <obd.h>
 #include <obd_cksum.h>
 #include <obd_class.h>
+#include <obd_compr.h>
 #include <lustre_osc.h>
 
 #include "osc_internal.h"
@@ -727,12 +728,18 @@ static void __osc_update_grant(struct client_obd *cli, u64 grant)
 	spin_unlock(&cli->cl_loi_list_lock);
 }
 
+static void osc_grant_recall(struct client_obd *cli);
+
 static void osc_update_grant(struct client_obd *cli, struct ost_body *body)
 {
         if (body->oa.o_valid & OBD_MD_FLGRANT) {
 		CDEBUG(D_CACHE, "got %llu extra grant\n", body->oa.o_grant);
                 __osc_update_grant(cli, body->oa.o_grant);
         }
+
+	if ((body->oa.o_valid & OBD_MD_FLFLAGS) &&
+	    (body->oa.o_flags & OBD_FL_GRANT_RECALL))
+		osc_grant_recall(cli);
 }
 
 /**
@@ -920,6 +927,19 @@ static void osc_grant_work_handler(struct work_struct *data)
 		schedule_work(&work.work);
 }
 
+/**
+ * The OST is short of space and asks for the grant this client does not use,
+ * shrink it now instead of waiting for grant_shrink_interval.
+ */
+static void osc_grant_recall(struct client_obd *cli)
+{
+	CDEBUG(D_CACHE, "%s: grant recalled by the OST\n", cli_name(cli));
+
+	cli->cl_next_shrink_grant = ktime_get_seconds();
+	if (client_gtd.gtd_stopped == 0)
+		mod_delayed_work(system_wq, &work, 0);
+}
+
 /**
  * Start grant thread for returing grant to server for idle clients.
  */
@@ -1122,8 +1142,8 @@ static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
 static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 				   size_t pg_count, struct brw_page **pga,
 				   int opc, obd_dif_csum_fn *fn,
-				   int sector_size,
-				   u32 *check_sum)
+				   int sector_size, __u16 *guards,
+				   int guards_nr, u32 *check_sum)
 {
 	struct ahash_request *req;
 	/* Used Adler as the default checksum type on top of DIF tags */
@@ -1184,6 +1204,14 @@ static int osc_checksum_bulk_t10pi(const char *obd_name, int nob,
 		if (rc)
 			break;
 
+		/* keep a copy of the guards to send them with the RPC */
+		if (guards != NULL && used <= guards_nr) {
+			memcpy(guards, guard_start + used_number,
+			       used * sizeof(*guards));
+			guards += used;
+			guards_nr -= used;
+		}
+
 		used_number += used;
 		if (used_number == guard_number) {
 			cfs_crypto_hash_update_page(req, __page, 0,
@@ -1219,21 +1247,31 @@ out:
 #else /* !CONFIG_CRC_T10DIF */
 #define obd_dif_ip_fn NULL
 #define obd_dif_crc_fn NULL
-#define osc_checksum_bulk_t10pi(name, nob, pgc, pga, opc, fn, ssize, csum)  \
+#define osc_checksum_bulk_t10pi(name, nob, pgc, pga, opc, fn, ssize, g, gnr, \
+				csum)					      \
 	-EOPNOTSUPP
 #endif /* CONFIG_CRC_T10DIF */
 
-static int osc_checksum_bulk(int nob, size_t pg_count,
-			     struct brw_page **pga, int opc,
-			     enum cksum_types cksum_type,
-			     u32 *cksum)
+struct osc_cksum_args {
+	struct brw_page	**oca_pga;
+	int		  oca_nob;
+	int		  oca_opc;
+	enum cksum_types  oca_type;
+};
+
+static int osc_checksum_pages(void *data, int start, int end, u32 *cksum)
 {
-	int				i = 0;
+	struct osc_cksum_args	       *args = data;
+	struct brw_page		      **pga = args->oca_pga;
 	struct ahash_request	       *req;
 	unsigned int			bufsize;
-	unsigned char			cfs_alg = cksum_obd2cfs(cksum_type);
+	unsigned char			cfs_alg = cksum_obd2cfs(args->oca_type);
+	int				nob = args->oca_nob;
+	int				done = 0;
+	int				i;
 
-	LASSERT(pg_count > 0);
+	for (i = 0; i < start; i++)
+		nob -= pga[i]->count;
 
 	req = cfs_crypto_hash_init(cfs_alg, NULL, 0);
 	if (IS_ERR(req)) {
@@ -1242,12 +1280,12 @@ static int osc_checksum_bulk(int nob, size_t pg_count,
 		return PTR_ERR(req);
 	}
 
-	while (nob > 0 && pg_count > 0) {
+	for (i = start; nob > 0 && i < end; i++) {
 		unsigned int count = pga[i]->count > nob ? nob : pga[i]->count;
 
 		/* corrupt the data before we compute the checksum, to
 		 * simulate an OST->client data error */
-		if (i == 0 && opc == OST_READ &&
+		if (i == 0 && args->oca_opc == OST_READ &&
 		    OBD_FAIL_CHECK(OBD_FAIL_OSC_CHECKSUM_RECEIVE)) {
 			unsigned char *ptr = kmap(pga[i]->pg);
 			int off = pga[i]->off & ~PAGE_MASK;
@@ -1262,13 +1300,35 @@ static int osc_checksum_bulk(int nob, size_t pg_count,
 			       (int)(pga[i]->off & ~PAGE_MASK));
 
 		nob -= pga[i]->count;
-		pg_count--;
-		i++;
+		done += count;
 	}
 
 	bufsize = sizeof(*cksum);
 	cfs_crypto_hash_final(req, (unsigned char *)cksum, &bufsize);
 
+	return done;
+}
+
+static int osc_checksum_bulk(int nob, size_t pg_count,
+			     struct brw_page **pga, int opc,
+			     enum cksum_types cksum_type,
+			     u32 *cksum)
+{
+	struct osc_cksum_args args = {
+		.oca_pga	= pga,
+		.oca_nob	= nob,
+		.oca_opc	= opc,
+		.oca_type	= cksum_type,
+	};
+	int rc;
+
+	LASSERT(pg_count > 0);
+
+	rc = obd_cksum_pages(cksum_type, pg_count, osc_checksum_pages, &args,
+			     cksum);
+	if (rc)
+		return rc;
+
 	/* For sending we only compute the wrong checksum instead
 	 * of corrupting the data so it is still correct on a redo */
 	if (opc == OST_WRITE && OBD_FAIL_CHECK(OBD_FAIL_OSC_CHECKSUM_SEND))
@@ -1281,6 +1341,7 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 				enum cksum_types cksum_type,
 				int nob, size_t pg_count,
 				struct brw_page **pga, int opc,
+				__u16 *guards, int guards_nr,
 				u32 *check_sum)
 {
 	obd_dif_csum_fn *fn = NULL;
@@ -1292,7 +1353,8 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 
 	if (fn)
 		rc = osc_checksum_bulk_t10pi(obd_name, nob, pg_count, pga,
-					     opc, fn, sector_size, check_sum);
+					     opc, fn, sector_size, guards,
+					     guards_nr, check_sum);
 	else
 		rc = osc_checksum_bulk(nob, pg_count, pga, opc, cksum_type,
 				       check_sum);
@@ -1300,6 +1362,175 @@ static int osc_checksum_bulk_rw(const char *obd_name,
 	RETURN(rc);
 }
 
+/*
+ * Size of the guards of the sectors of \a pga to send with a write RPC, for
+ * the OST to tell which pages are corrupted if the T10 checksum of the RPC
+ * does not match. They are not sent if they do not fit in the request buffers
+ * of the OST along with the \a used bytes of niobufs and short io data.
+ */
+static int osc_brw_guards_size(struct client_obd *cli, u32 page_count,
+			       struct brw_page **pga, int used)
+{
+	obd_dif_csum_fn *fn = NULL;
+	int sector_size = 0;
+	int count = 0;
+	u32 i;
+
+	if (!cli->cl_checksum || !imp_connect_t10_guards(cli->cl_import))
+		return 0;
+
+	obd_t10_cksum2dif(cli->cl_cksum_type, &fn, &sector_size);
+	if (fn == NULL)
+		return 0;
+
+	for (i = 0; i < page_count; i++)
+		count += obd_dif_guard_count(pga[i]->off & ~PAGE_MASK,
+					     pga[i]->count, sector_size);
+
+	if (count * sizeof(__u16) + used > OST_SHORT_IO_SPACE)
+		return 0;
+
+	return count * sizeof(__u16);
+}
+
+/*
+ * Size of the description of the compression of the data of \a pga, 0 if the
+ * data is not to be compressed. The description is not sent if it does not
+ * fit in the request buffers of the OST along with the \a used bytes of
+ * niobufs and guards.
+ */
+static int osc_brw_compr_size(struct client_obd *cli, enum obd_compr_type type,
+			      u32 page_count, struct brw_page **pga, int used)
+{
+	int nob = 0;
+	u32 i;
+
+	if (type == OBD_COMPR_NONE || !imp_connect_compress(cli->cl_import))
+		return 0;
+
+	for (i = 0; i < page_count; i++)
+		nob += pga[i]->count;
+
+	if (obd_compr_size(nob) + used > OST_SHORT_IO_SPACE)
+		return 0;
+
+	return obd_compr_size(nob);
+}
+
+/*
+ * Compress the \a nob bytes of data of write \a pga into pages attached to
+ * \a desc, or attach \a pga as is if compression does not save a page at
+ * least. Returns whether the data is compressed.
+ */
+static bool osc_brw_compress(struct ptlrpc_request *req,
+			     struct ptlrpc_bulk_desc *desc,
+			     enum obd_compr_type type, u32 page_count,
+			     struct brw_page **pga, int nob)
+{
+	struct req_capsule *pill = &req->rq_pill;
+	int ndst = DIV_ROUND_UP(nob, PAGE_SIZE);
+	lnet_kiov_t *src = NULL;
+	lnet_kiov_t *dst = NULL;
+	struct ost_compr *oc;
+	bool compressed = false;
+	int rc;
+	int i;
+
+	OBD_ALLOC_LARGE(src, page_count * sizeof(*src));
+	OBD_ALLOC_LARGE(dst, ndst * sizeof(*dst));
+	if (src == NULL || dst == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < page_count; i++) {
+		src[i].kiov_page = pga[i]->pg;
+		src[i].kiov_offset = pga[i]->off & ~PAGE_MASK;
+		src[i].kiov_len = pga[i]->count;
+	}
+	for (i = 0; i < ndst; i++)
+		dst[i].kiov_len = PAGE_SIZE;
+
+	oc = req_capsule_client_get(pill, &RMF_OST_COMPR);
+	rc = obd_compress(type, src, page_count, dst, ndst, oc);
+	if (rc < 0 || DIV_ROUND_UP(rc, PAGE_SIZE) >= ndst)
+		GOTO(out, rc);
+
+	CDEBUG(D_PAGE, "%s: %d bytes compressed to %d with %s\n",
+	       req->rq_import->imp_obd->obd_name, nob, rc,
+	       obd_compr_name(type));
+	/* the frag ops take a reference on the pages */
+	for (i = 0; rc > 0; i++, rc -= PAGE_SIZE)
+		desc->bd_frag_ops->add_kiov_frag(desc, dst[i].kiov_page, 0,
+						 min_t(int, rc, PAGE_SIZE));
+	compressed = true;
+out:
+	if (dst != NULL) {
+		obd_compr_release(dst, ndst);
+		OBD_FREE_LARGE(dst, ndst * sizeof(*dst));
+	}
+	if (src != NULL)
+		OBD_FREE_LARGE(src, page_count * sizeof(*src));
+
+	if (!compressed) {
+		if (rc < 0)
+			CDEBUG(D_PAGE, "%s: cannot compress with %s: rc = %d\n",
+			       req->rq_import->imp_obd->obd_name,
+			       obd_compr_name(type), rc);
+		for (i = 0; i < page_count; i++)
+			desc->bd_frag_ops->add_kiov_frag(desc, pga[i]->pg,
+						pga[i]->off & ~PAGE_MASK,
+						pga[i]->count);
+		req_capsule_shrink(pill, &RMF_OST_COMPR, 0, RCL_CLIENT);
+	}
+
+	return compressed;
+}
+
+/*
+ * Decompress in place the data of read \a req of which \a nob bytes were
+ * transferred, if the OST compressed it. Returns the bytes of data read.
+ */
+static int osc_brw_decompress(struct ptlrpc_request *req, int nob)
+{
+	struct osc_brw_async_args *aa = ptlrpc_req_async_args(req);
+	struct req_capsule *pill = &req->rq_pill;
+	struct ptlrpc_bulk_desc *desc = req->rq_bulk;
+	struct ost_compr *oc;
+	int size = 0;
+	int rc;
+
+	if (req_capsule_field_present(pill, &RMF_OST_COMPR, RCL_SERVER))
+		size = req_capsule_get_size(pill, &RMF_OST_COMPR, RCL_SERVER);
+	if (size == 0)
+		return nob;
+
+	oc = req_capsule_server_get(pill, &RMF_OST_COMPR);
+	if (oc == NULL)
+		return -EPROTO;
+	if (ptlrpc_rep_need_swab(req))
+		obd_compr_swab(oc, size);
+	if (oc->oc_type == OBD_COMPR_NONE)
+		return nob;
+
+	rc = obd_compr_check(oc, size);
+	if (rc >= 0 && (rc != nob || oc->oc_raw != req->rq_status ||
+			oc->oc_raw > aa->aa_requested_nob))
+		rc = -EPROTO;
+	if (rc >= 0)
+		rc = obd_decompress(oc, &BD_GET_KIOV(desc, 0),
+				    desc->bd_iov_count, &BD_GET_KIOV(desc, 0),
+				    desc->bd_iov_count);
+	if (rc < 0) {
+		DEBUG_REQ(D_ERROR, req, "bad %s data, %d bytes transferred: "
+			  "rc = %d", obd_compr_name(oc->oc_type), nob, rc);
+		return rc;
+	}
+
+	CDEBUG(D_PAGE, "%s: %d bytes decompressed to %d with %s\n",
+	       req->rq_import->imp_obd->obd_name, nob, rc,
+	       obd_compr_name(oc->oc_type));
+	return rc;
+}
+
 static int
 osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		     u32 page_count, struct brw_page **pga,
@@ -1311,6 +1542,9 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         struct obd_ioobj        *ioobj;
         struct niobuf_remote    *niobuf;
 	int niocount, i, requested_nob, opc, rc, short_io_size = 0;
+	int guards_size = 0;
+	enum obd_compr_type compr_type = READ_ONCE(cli->cl_compr_type);
+	int compr_size = 0;
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
@@ -1360,6 +1594,31 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
 		req_capsule_set_size(pill, &RMF_SHORT_IO, RCL_SERVER,
 				     short_io_size);
 
+	/* the OST replies its own guards if the checksum does not match */
+	if (opc == OST_WRITE) {
+		guards_size = osc_brw_guards_size(cli, page_count, pga,
+				niocount * sizeof(*niobuf) + short_io_size);
+		req_capsule_set_size(pill, &RMF_OST_GUARDS, RCL_SERVER,
+				     guards_size);
+	}
+	req_capsule_set_size(pill, &RMF_OST_GUARDS, RCL_CLIENT, guards_size);
+
+	/* the client sends the description of the data it compresses, and
+	 * the OST the one of the data it compresses with the chosen type */
+	if (short_io_size == 0)
+		compr_size = osc_brw_compr_size(cli, compr_type, page_count,
+				pga, niocount * sizeof(*niobuf) + guards_size);
+	if (opc == OST_READ) {
+		req_capsule_set_size(pill, &RMF_OST_COMPR, RCL_SERVER,
+				     compr_size);
+		req_capsule_set_size(pill, &RMF_OST_COMPR, RCL_CLIENT,
+				     compr_size != 0 ? sizeof(struct ost_compr) :
+				     0);
+	} else {
+		req_capsule_set_size(pill, &RMF_OST_COMPR, RCL_CLIENT,
+				     compr_size);
+	}
+
         rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, opc);
         if (rc) {
                 ptlrpc_request_free(req);
@@ -1367,6 +1626,22 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         }
 	osc_set_io_portal(req);
 
+	/* compressed data cannot be protected by the bulk flavors */
+	if (compr_size != 0 && sptlrpc_flavor_has_bulk(&req->rq_flvr)) {
+		req_capsule_shrink(pill, &RMF_OST_COMPR, 0, RCL_CLIENT);
+		if (opc == OST_READ)
+			req_capsule_set_size(pill, &RMF_OST_COMPR, RCL_SERVER,
+					     0);
+		compr_size = 0;
+	}
+	if (compr_size != 0 && opc == OST_READ) {
+		struct ost_compr *oc;
+
+		oc = req_capsule_client_get(pill, &RMF_OST_COMPR);
+		memset(oc, 0, sizeof(*oc));
+		oc->oc_type = compr_type;
+	}
+
 	ptlrpc_at_set_req_timeout(req);
 	/* ask ptlrpc not to resend on EINPROGRESS since BRWs have their own
 	 * retry logic */
@@ -1465,7 +1740,8 @@ no_bulk:
 			       ptr + poff,
 			       pg->count);
 			ll_kunmap_atomic(ptr, KM_USER0);
-		} else if (short_io_size == 0) {
+		} else if (short_io_size == 0 &&
+			   (compr_size == 0 || opc == OST_READ)) {
 			desc->bd_frag_ops->add_kiov_frag(desc, pg->pg, poff,
 							 pg->count);
 		}
@@ -1487,6 +1763,11 @@ no_bulk:
                 "want %p - real %p\n", req_capsule_client_get(&req->rq_pill,
                 &RMF_NIOBUF_REMOTE), (void *)(niobuf - niocount));
 
+	if (compr_size != 0 && opc == OST_WRITE &&
+	    !osc_brw_compress(req, desc, compr_type, page_count, pga,
+			      requested_nob))
+		compr_size = 0;
+
         osc_announce_cached(cli, &body->oa, opc == OST_WRITE ? requested_nob:0);
         if (resend) {
                 if ((body->oa.o_valid & OBD_MD_FLFLAGS) == 0) {
@@ -1506,6 +1787,7 @@ no_bulk:
                         /* store cl_cksum_type in a local variable since
                          * it can be changed via lprocfs */
 			enum cksum_types cksum_type = cli->cl_cksum_type;
+			__u16 *guards = NULL;
 
                         if ((body->oa.o_valid & OBD_MD_FLFLAGS) == 0)
                                 body->oa.o_flags = 0;
@@ -1514,9 +1796,13 @@ no_bulk:
 								cksum_type);
                         body->oa.o_valid |= OBD_MD_FLCKSUM | OBD_MD_FLFLAGS;
 
+			if (guards_size != 0)
+				guards = req_capsule_client_get(pill,
+							&RMF_OST_GUARDS);
 			rc = osc_checksum_bulk_rw(obd_name, cksum_type,
 						  requested_nob, page_count,
-						  pga, OST_WRITE,
+						  pga, OST_WRITE, guards,
+						  guards_size / sizeof(*guards),
 						  &body->oa.o_cksum);
 			if (rc < 0) {
 				CDEBUG(D_PAGE, "failed to checksum, rc = %d\n",
@@ -1534,6 +1820,12 @@ no_bulk:
                         /* clear out the checksum flag, in case this is a
                          * resend but cl_checksum is no longer set. b=11238 */
                         oa->o_valid &= ~OBD_MD_FLCKSUM;
+			if (guards_size != 0) {
+				req_capsule_shrink(pill, &RMF_OST_GUARDS, 0,
+						   RCL_CLIENT);
+				req_capsule_set_size(pill, &RMF_OST_GUARDS,
+						     RCL_SERVER, 0);
+			}
                 }
                 oa->o_cksum = body->oa.o_cksum;
                 /* 1 RC per niobuf */
@@ -1563,6 +1855,10 @@ no_bulk:
 	aa->aa_nio_count = niocount;
 	aa->aa_page_count = page_count;
 	aa->aa_resends = 0;
+	aa->aa_ppga_start = 0;
+	aa->aa_ppga_total = page_count;
+	aa->aa_redo_start = 0;
+	aa->aa_redo_count = 0;
 	aa->aa_ppga = pga;
 	aa->aa_cli = cli;
 	INIT_LIST_HEAD(&aa->aa_oaps);
@@ -1692,7 +1988,7 @@ check_write_checksum(struct obdo *oa, const struct lnet_process_id *peer,
 		rc = osc_checksum_bulk_t10pi(obd_name, aa->aa_requested_nob,
 					     aa->aa_page_count, aa->aa_ppga,
 					     OST_WRITE, fn, sector_size,
-					     &new_cksum);
+					     NULL, 0, &new_cksum);
 	else
 		rc = osc_checksum_bulk(aa->aa_requested_nob, aa->aa_page_count,
 				       aa->aa_ppga, OST_WRITE, cksum_type,
@@ -1729,6 +2025,70 @@ check_write_checksum(struct obdo *oa, const struct lnet_process_id *peer,
 	return 1;
 }
 
+/*
+ * Compare the guards of the sectors of a write with a bad checksum with the
+ * ones the OST computed, to resend only the pages between the first and the
+ * last ones with different guards.
+ */
+static void osc_brw_find_bad_pages(struct ptlrpc_request *req,
+				   struct osc_brw_async_args *aa)
+{
+	struct req_capsule *pill = &req->rq_pill;
+	obd_dif_csum_fn *fn = NULL;
+	int sector_size = 0;
+	__u16 *cli_guards;
+	__u16 *srv_guards;
+	int first = -1;
+	int last = -1;
+	int size;
+	int nr = 0;
+	int i;
+
+	aa->aa_redo_start = 0;
+	aa->aa_redo_count = 0;
+
+	size = req_capsule_get_size(pill, &RMF_OST_GUARDS, RCL_CLIENT);
+	if (size == 0 ||
+	    !req_capsule_field_present(pill, &RMF_OST_GUARDS, RCL_SERVER) ||
+	    req_capsule_get_size(pill, &RMF_OST_GUARDS, RCL_SERVER) != size)
+		return;
+
+	obd_t10_cksum2dif(obd_cksum_type_unpack(aa->aa_oa->o_flags), &fn,
+			  &sector_size);
+	if (fn == NULL)
+		return;
+
+	cli_guards = req_capsule_client_get(pill, &RMF_OST_GUARDS);
+	srv_guards = req_capsule_server_get(pill, &RMF_OST_GUARDS);
+	if (cli_guards == NULL || srv_guards == NULL)
+		return;
+
+	for (i = 0; i < aa->aa_page_count; i++) {
+		int used = obd_dif_guard_count(aa->aa_ppga[i]->off & ~PAGE_MASK,
+					       aa->aa_ppga[i]->count,
+					       sector_size);
+
+		if ((nr + used) * sizeof(*cli_guards) > size)
+			return;
+
+		if (memcmp(cli_guards + nr, srv_guards + nr,
+			   used * sizeof(*cli_guards)) != 0) {
+			if (first < 0)
+				first = i;
+			last = i;
+		}
+		nr += used;
+	}
+
+	if (nr * sizeof(*cli_guards) != size || first < 0)
+		return;
+
+	aa->aa_redo_start = first;
+	aa->aa_redo_count = last - first + 1;
+	DEBUG_REQ(D_PAGE, req, "bad guards in pages %d-%d of %u",
+		  first, last, aa->aa_page_count);
+}
+
 /* Note rc enters this function as number of bytes transferred */
 static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 {
@@ -1784,10 +2144,12 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 		    sptlrpc_cli_unwrap_bulk_write(req, req->rq_bulk))
                         RETURN(-EAGAIN);
 
-                if ((aa->aa_oa->o_valid & OBD_MD_FLCKSUM) && client_cksum &&
-                    check_write_checksum(&body->oa, peer, client_cksum,
-					 body->oa.o_cksum, aa))
-                        RETURN(-EAGAIN);
+		if ((aa->aa_oa->o_valid & OBD_MD_FLCKSUM) && client_cksum &&
+		    check_write_checksum(&body->oa, peer, client_cksum,
+					 body->oa.o_cksum, aa)) {
+			osc_brw_find_bad_pages(req, aa);
+			RETURN(-EAGAIN);
+		}
 
                 rc = check_write_rcs(req, aa->aa_requested_nob,aa->aa_nio_count,
                                      aa->aa_page_count, aa->aa_ppga);
@@ -1819,6 +2181,12 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                 return (-EPROTO);
         }
 
+	if (req->rq_bulk != NULL) {
+		rc = osc_brw_decompress(req, rc);
+		if (rc < 0)
+			GOTO(out, rc = -EAGAIN);
+	}
+
 	if (req->rq_bulk == NULL) {
 		/* short io */
 		int nob, pg_count, i = 0;
@@ -1863,7 +2231,7 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
 		cksum_type = obd_cksum_type_unpack(o_flags);
 		rc = osc_checksum_bulk_rw(obd_name, cksum_type, rc,
 					  aa->aa_page_count, aa->aa_ppga,
-					  OST_READ, &client_cksum);
+					  OST_READ, NULL, 0, &client_cksum);
 		if (rc < 0)
 			GOTO(out, rc);
 
@@ -1935,15 +2303,27 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
         struct ptlrpc_request *new_req;
         struct osc_brw_async_args *new_aa;
         struct osc_async_page *oap;
+	struct brw_page **pga = aa->aa_ppga;
+	u32 page_count = aa->aa_page_count;
+	int requested_nob;
+	int nio_count;
         ENTRY;
 
 	DEBUG_REQ(rc == -EINPROGRESS ? D_RPCTRACE : D_ERROR, request,
 		  "redo for recoverable error %d", rc);
 
+	/* the other pages were written fine, see osc_brw_find_bad_pages() */
+	if (rc == -EAGAIN && aa->aa_redo_count > 0) {
+		pga += aa->aa_redo_start;
+		page_count = aa->aa_redo_count;
+		DEBUG_REQ(D_RPCTRACE, request, "resend %u of %u pages",
+			  page_count, aa->aa_page_count);
+	}
+
 	rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
 				OST_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ,
-				  aa->aa_cli, aa->aa_oa, aa->aa_page_count,
-				  aa->aa_ppga, &new_req, 1);
+				  aa->aa_cli, aa->aa_oa, page_count, pga,
+				  &new_req, 1);
         if (rc)
                 RETURN(rc);
 
@@ -1961,6 +2341,9 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
         /* New request takes over pga and oaps from old request.
          * Note that copying a list_head doesn't work, need to move it... */
         aa->aa_resends++;
+	new_aa = ptlrpc_req_async_args(new_req);
+	requested_nob = new_aa->aa_requested_nob;
+	nio_count = new_aa->aa_nio_count;
         new_req->rq_interpret_reply = request->rq_interpret_reply;
         new_req->rq_async_args = request->rq_async_args;
 	new_req->rq_commit_cb = request->rq_commit_cb;
@@ -1973,7 +2356,13 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
         new_req->rq_generation_set = 1;
         new_req->rq_import_generation = request->rq_import_generation;
 
-        new_aa = ptlrpc_req_async_args(new_req);
+	new_aa->aa_requested_nob = requested_nob;
+	new_aa->aa_nio_count = nio_count;
+	new_aa->aa_ppga_start += pga - aa->aa_ppga;
+	new_aa->aa_page_count = page_count;
+	new_aa->aa_ppga = pga;
+	new_aa->aa_redo_start = 0;
+	new_aa->aa_redo_count = 0;
 
 	INIT_LIST_HEAD(&new_aa->aa_oaps);
 	list_splice_init(&aa->aa_oaps, &new_aa->aa_oaps);
@@ -2035,6 +2424,75 @@ static void osc_release_ppga(struct brw_page **ppga, size_t count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+static int osc_soft_sync_interpret(const struct lu_env *env,
+				   struct ptlrpc_request *req,
+				   void *arg, int rc)
+{
+	struct client_obd *cli = &req->rq_import->imp_obd->u.cli;
+
+	/* the OST did not get it, allow another one to be sent */
+	if (rc != 0)
+		atomic_set(&cli->cl_soft_sync_pending, 0);
+
+	return 0;
+}
+
+/**
+ * Ask the OST to start committing the write \a wreq now, without waiting
+ * for the commit, as this OSC has too many unstable pages.
+ *
+ * The OST_SYNC RPC sent covers the object and range of \a wreq, so that
+ * OSTs not supporting OBD_FL_SOFT_SYNC only sync that. A single one is
+ * sent until a write of this OSC gets committed.
+ */
+static void osc_soft_sync(struct ptlrpc_request *wreq)
+{
+	struct client_obd *cli = &wreq->rq_import->imp_obd->u.cli;
+	struct ptlrpc_request *req;
+	struct niobuf_remote *rnb;
+	struct ost_body *wbody;
+	struct ost_body *body;
+	int niocount;
+
+	if (atomic_cmpxchg(&cli->cl_soft_sync_pending, 0, 1) != 0)
+		return;
+
+	wbody = req_capsule_client_get(&wreq->rq_pill, &RMF_OST_BODY);
+	rnb = req_capsule_client_get(&wreq->rq_pill, &RMF_NIOBUF_REMOTE);
+	niocount = req_capsule_get_size(&wreq->rq_pill, &RMF_NIOBUF_REMOTE,
+					RCL_CLIENT) / sizeof(*rnb);
+	LASSERT(wbody != NULL && rnb != NULL && niocount > 0);
+
+	req = ptlrpc_request_alloc_pack(wreq->rq_import, &RQF_OST_SYNC,
+					LUSTRE_OST_VERSION, OST_SYNC);
+	if (req == NULL) {
+		atomic_set(&cli->cl_soft_sync_pending, 0);
+		return;
+	}
+
+	/* overload the size and blocks fields in the oa with start/end */
+	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
+	body->oa.o_oi = wbody->oa.o_oi;
+	body->oa.o_size = rnb[0].rnb_offset;
+	body->oa.o_blocks = rnb[niocount - 1].rnb_offset +
+			    rnb[niocount - 1].rnb_len - 1;
+	body->oa.o_flags = OBD_FL_SOFT_SYNC;
+	body->oa.o_valid = OBD_MD_FLID | OBD_MD_FLGROUP | OBD_MD_FLSIZE |
+			   OBD_MD_FLBLOCKS | OBD_MD_FLFLAGS;
+
+	ptlrpc_request_set_replen(req);
+	req->rq_no_delay = req->rq_no_resend = 1;
+	req->rq_interpret_reply = osc_soft_sync_interpret;
+
+	cli->cl_soft_sync_count++;
+	CDEBUG(D_CACHE, "%s: soft sync of "DOSTID" for %ld unstable pages, "
+	       "commit takes %ums\n", cli_name(cli), POSTID(&body->oa.o_oi),
+	       atomic_long_read(&cli->cl_unstable_count),
+	       cli->cl_unstable_commit_ms);
+
+	ptlrpcd_add_req(req);
+}
+
 static int brw_interpret(const struct lu_env *env,
                          struct ptlrpc_request *req, void *data, int rc)
 {
@@ -2047,6 +2505,19 @@ static int brw_interpret(const struct lu_env *env,
 
         rc = osc_brw_fini_request(req, rc);
         CDEBUG(D_INODE, "request %p aa %p rc %d\n", req, aa, rc);
+	/* the OST cannot decompress the data, send it as is */
+	if (rc == -EOPNOTSUPP &&
+	    lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE &&
+	    req_capsule_get_size(&req->rq_pill, &RMF_OST_COMPR,
+				 RCL_CLIENT) != 0) {
+		CWARN("%s: OST cannot decompress %s data, disable "
+		      "compression\n", req->rq_import->imp_obd->obd_name,
+		      obd_compr_name(cli->cl_compr_type));
+		cli->cl_compr_type = OBD_COMPR_NONE;
+		rc = osc_brw_redo_request(req, aa, rc);
+		if (rc == 0)
+			RETURN(0);
+	}
         /* When server return -EINPROGRESS, client should always retry
          * regardless of the number of times the bulk was resent already. */
 	if (osc_recoverable_error(rc) && !req->rq_no_delay) {
@@ -2079,7 +2550,8 @@ static int brw_interpret(const struct lu_env *env,
 		struct cl_object *obj;
 		struct osc_async_page *last;
 
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
+		last = brw_page2oap(aa->aa_ppga[aa->aa_ppga_total -
+						aa->aa_ppga_start - 1]);
 		obj = osc2cl(last->oap_obj);
 
 		cl_object_attr_lock(obj);
@@ -2126,8 +2598,11 @@ static int brw_interpret(const struct lu_env *env,
 	OBD_SLAB_FREE_PTR(aa->aa_oa, osc_obdo_kmem);
 	aa->aa_oa = NULL;
 
-	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE && rc == 0)
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE && rc == 0) {
 		osc_inc_unstable_pages(req);
+		if (osc_over_unstable_budget(cli))
+			osc_soft_sync(req);
+	}
 
 	list_for_each_entry_safe(ext, tmp, &aa->aa_exts, oe_link) {
 		list_del_init(&ext->oe_link);
@@ -2141,7 +2616,7 @@ static int brw_interpret(const struct lu_env *env,
 		       aa->aa_requested_nob :
 		       req->rq_bulk->bd_nob_transferred);
 
-	osc_release_ppga(aa->aa_ppga, aa->aa_page_count);
+	osc_release_ppga(aa->aa_ppga - aa->aa_ppga_start, aa->aa_ppga_total);
 	ptlrpc_lprocfs_brw(req, transferred);
 
 	spin_lock(&cli->cl_loi_list_lock);
@@ -2161,6 +2636,18 @@ static int brw_interpret(const struct lu_env *env,
 
 static void brw_commit(struct ptlrpc_request *req)
 {
+	struct client_obd *cli = &req->rq_import->imp_obd->u.cli;
+	unsigned int commit_ms;
+	s64 delta;
+
+	/* track how long the OST takes to commit the writes */
+	delta = ktime_ms_delta(ktime_get_real(), req->rq_sent_ns);
+	commit_ms = delta > 0 ? delta : 0;
+	if (cli->cl_unstable_commit_ms != 0)
+		commit_ms = (cli->cl_unstable_commit_ms * 7 + commit_ms) / 8;
+	WRITE_ONCE(cli->cl_unstable_commit_ms, max(commit_ms, 1U));
+	atomic_set(&cli->cl_soft_sync_pending, 0);
+
 	/* If osc_inc_unstable_pages (via osc_extent_finish) races with
 	 * this called via the rq_commit_cb, I need to ensure
 	 * osc_dec_unstable_pages is still called. Otherwise unstable
@@ -2328,12 +2815,16 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (cmd == OBD_BRW_READ) {
 		cli->cl_r_in_flight++;
 		lprocfs_oh_tally_log2(&cli->cl_read_page_hist, page_count);
+		lprocfs_oh_tally(&cli->cl_read_fullness_hist,
+				 page_count * 10 / cli->cl_max_pages_per_rpc);
 		lprocfs_oh_tally(&cli->cl_read_rpc_hist, cli->cl_r_in_flight);
 		lprocfs_oh_tally_log2(&cli->cl_read_offset_hist,
 				      starting_offset + 1);
 	} else {
 		cli->cl_w_in_flight++;
 		lprocfs_oh_tally_log2(&cli->cl_write_page_hist, page_count);
+		lprocfs_oh_tally(&cli->cl_write_fullness_hist,
+				 page_count * 10 / cli->cl_max_pages_per_rpc);
 		lprocfs_oh_tally(&cli->cl_write_rpc_hist, cli->cl_w_in_flight);
 		lprocfs_oh_tally_log2(&cli->cl_write_offset_hist,
 				      starting_offset + 1);
@@ -2622,7 +3113,10 @@ int osc_enqueue_base(struct obd_export *exp, struct ldlm_res_id *res_id,
 
 			req->rq_interpret_reply =
 				(ptlrpc_interpterer_t)osc_enqueue_interpret;
-			if (rqset == PTLRPCD_SET)
+			/* glimpses of many files go in batches */
+			if (rqset == PTLRPCD_SET && intent)
+				ptlrpc_batch_add(exp, req);
+			else if (rqset == PTLRPCD_SET)
 				ptlrpcd_add_req(req);
 			else
 				ptlrpc_set_add_req(rqset, req);
@@ -3190,8 +3684,10 @@ static int brw_queue_work(const struct lu_env *env, void *data)
 int osc_setup_common(struct obd_device *obd, struct lustre_cfg *lcfg)
 {
 	struct client_obd *cli = &obd->u.cli;
+	struct cl_lru_shard *shard;
 	void *handler;
 	int rc;
+	int i;
 
 	ENTRY;
 
@@ -3203,6 +3699,13 @@ int osc_setup_common(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc)
 		GOTO(out_ptlrpcd, rc);
 
+	cli->cl_lru_shards = cfs_percpt_alloc(cfs_cpt_table, sizeof(*shard));
+	if (cli->cl_lru_shards == NULL)
+		GOTO(out_ptlrpcd_work, rc = -ENOMEM);
+	cfs_percpt_for_each(shard, i, cli->cl_lru_shards) {
+		spin_lock_init(&shard->cls_lock);
+		INIT_LIST_HEAD(&shard->cls_list);
+	}
 
 	handler = ptlrpcd_alloc_work(cli->cl_import, brw_queue_work, cli);
 	if (IS_ERR(handler))
@@ -3232,6 +3735,10 @@ out_ptlrpcd_work:
 		ptlrpcd_destroy_work(cli->cl_lru_work);
 		cli->cl_lru_work = NULL;
 	}
+	if (cli->cl_lru_shards != NULL) {
+		cfs_percpt_free(cli->cl_lru_shards);
+		cli->cl_lru_shards = NULL;
+	}
 	client_obd_cleanup(obd);
 out_ptlrpcd:
 	ptlrpcd_decref();
@@ -3253,6 +3760,9 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc < 0)
 		RETURN(rc);
 
+	cli->cl_batch_max = OSC_BATCH_MAX_DEFAULT;
+	cli->cl_batch_maxbuf = OST_BATCH_MAXBUFSIZE;
+
 	rc = osc_tunables_init(obd);
 	if (rc)
 		RETURN(rc);
@@ -3348,6 +3858,13 @@ int osc_cleanup_common(struct obd_device *obd)
 	/* free memory of osc quota cache */
 	osc_quota_cleanup(obd);
 
+	osc_cache_jobs_fini(cli);
+
+	if (cli->cl_lru_shards != NULL) {
+		cfs_percpt_free(cli->cl_lru_shards);
+		cli->cl_lru_shards = NULL;
+	}
+
 	rc = client_obd_cleanup(obd);
 
 	ptlrpcd_decref();
@@ -3431,6 +3948,12 @@ static int __init osc_init(void)
 	if (rc)
 		RETURN(rc);
 
+	osc_extent_mag = cfs_mag_cache_create("osc_extent_kmem",
+					      osc_extent_kmem, cfs_cpt_table,
+					      sizeof(struct osc_extent));
+	if (osc_extent_mag == NULL)
+		GOTO(out_kmem, rc = -ENOMEM);
+
 	type = class_search_type(LUSTRE_OSP_NAME);
 	if (type != NULL && type->typ_procsym != NULL)
 		enable_proc = false;
@@ -3478,6 +4001,7 @@ out_req_pool:
 out_type:
 	class_unregister_type(LUSTRE_OSC_NAME);
 out_kmem:
+	cfs_mag_cache_destroy(osc_extent_mag);
 	lu_kmem_fini(osc_caches);
 
 	RETURN(rc);
@@ -3488,6 +4012,7 @@ static void __exit osc_exit(void)
 	osc_stop_grant_work();
 	remove_shrinker(osc_cache_shrinker);
 	class_unregister_type(LUSTRE_OSC_NAME);
+	cfs_mag_cache_destroy(osc_extent_mag);
 	lu_kmem_fini(osc_caches);
 	ptlrpc_free_rq_pool(osc_rq_pool);
 }
@@ -1104,6 +1104,30 @@ again:
 	RETURN(rc);
 }
 
+/**
+ * Which of the "O/<seq>/d*" directories the object \a fid is mapped in,
+ * so that the callers inserting many objects can group the insertions by
+ * directory.
+ *
+ * \retval		index of the directory in the sequence
+ * \retval negative	negated errno on error
+ */
+int osd_obj_map_dirn(struct osd_thread_info *info, struct osd_device *osd,
+		     const struct lu_fid *fid)
+{
+	struct osd_obj_seq *osd_seq;
+	struct ost_id *ostid = &info->oti_ostid;
+
+	LASSERT(osd->od_ost_map);
+
+	fid_to_ostid(fid, ostid);
+	osd_seq = osd_seq_load(info, osd, ostid_seq(ostid));
+	if (IS_ERR(osd_seq))
+		return PTR_ERR(osd_seq);
+
+	return ostid_id(ostid) & (osd_seq->oos_subdir_count - 1);
+}
+
 int osd_obj_map_delete(struct osd_thread_info *info, struct osd_device *osd,
 		       const struct lu_fid *fid, handle_t *th)
 {
@@ -25,11 +25,16 @@
  * one may request lock (exclusive or shared) for some value
  * in that lockspace
  *
+ * The locks of a lockspace are kept in a hash table keyed by their value,
+ * with a spinlock per bucket, so that lockers of different values (IAM
+ * blocks) neither contend on one lock nor walk all the locks held.
+ *
  */
 
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/hash.h>
 
 #include <libcfs/libcfs.h>
 
@@ -47,11 +52,64 @@
  * initialize lockspace
  *
  */
-void dynlock_init(struct dynlock *dl)
+int dynlock_init(struct dynlock *dl)
 {
-	spin_lock_init(&dl->dl_list_lock);
-	INIT_LIST_HEAD(&dl->dl_list);
+	int i;
+
+	OBD_ALLOC(dl->dl_buckets,
+		  sizeof(*dl->dl_buckets) * DYNLOCK_HASH_SIZE);
+	if (dl->dl_buckets == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < DYNLOCK_HASH_SIZE; i++) {
+		spin_lock_init(&dl->dl_buckets[i].db_lock);
+		INIT_HLIST_HEAD(&dl->dl_buckets[i].db_head);
+	}
 	dl->dl_magic = DYNLOCK_LIST_MAGIC;
+
+	return 0;
+}
+
+/*
+ * dynlock_fini
+ *
+ * release lockspace, no lock may be held in it
+ *
+ */
+void dynlock_fini(struct dynlock *dl)
+{
+	int i;
+
+	if (dl->dl_buckets == NULL)
+		return;
+
+	for (i = 0; i < DYNLOCK_HASH_SIZE; i++)
+		BUG_ON(!hlist_empty(&dl->dl_buckets[i].db_head));
+
+	OBD_FREE(dl->dl_buckets, sizeof(*dl->dl_buckets) * DYNLOCK_HASH_SIZE);
+	dl->dl_buckets = NULL;
+	dl->dl_magic = 0;
+}
+
+static inline struct dynlock_bucket *dynlock_bucket(struct dynlock *dl,
+						    unsigned long value)
+{
+	return &dl->dl_buckets[hash_long(value, DYNLOCK_HASH_BITS)];
+}
+
+/* find the lock for @value in @db, called with db_lock held */
+static struct dynlock_handle *dynlock_find(struct dynlock_bucket *db,
+					   unsigned long value)
+{
+	struct dynlock_handle *hl;
+
+	hlist_for_each_entry(hl, &db->db_head, dh_hash) {
+		BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
+		if (hl->dh_value == value)
+			return hl;
+	}
+
+	return NULL;
 }
 
 /*
@@ -67,43 +125,39 @@ void dynlock_init(struct dynlock *dl)
 struct dynlock_handle *dynlock_lock(struct dynlock *dl, unsigned long value,
 				    enum dynlock_type lt, gfp_t gfp)
 {
+	struct dynlock_bucket *db;
 	struct dynlock_handle *nhl = NULL;
 	struct dynlock_handle *hl;
 
 	BUG_ON(dl == NULL);
 	BUG_ON(dl->dl_magic != DYNLOCK_LIST_MAGIC);
 
+	db = dynlock_bucket(dl, value);
 repeat:
 	/* find requested lock in lockspace */
-	spin_lock(&dl->dl_list_lock);
-	BUG_ON(dl->dl_list.next == NULL);
-	BUG_ON(dl->dl_list.prev == NULL);
-	list_for_each_entry(hl, &dl->dl_list, dh_list) {
-		BUG_ON(hl->dh_list.next == NULL);
-		BUG_ON(hl->dh_list.prev == NULL);
-		BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
-		if (hl->dh_value == value) {
-			/* lock is found */
-			if (nhl) {
-				/* someone else just allocated
-				 * lock we didn't find and just created
-				 * so, we drop our lock
-				 */
-				OBD_SLAB_FREE(nhl, dynlock_cachep, sizeof(*nhl));
-			}
-			hl->dh_refcount++;
-			goto found;
+	spin_lock(&db->db_lock);
+	hl = dynlock_find(db, value);
+	if (hl != NULL) {
+		/* lock is found */
+		if (nhl) {
+			/* someone else just allocated
+			 * lock we didn't find and just created
+			 * so, we drop our lock
+			 */
+			OBD_SLAB_FREE(nhl, dynlock_cachep, sizeof(*nhl));
 		}
+		hl->dh_refcount++;
+		goto found;
 	}
 	/* lock not found */
 	if (nhl) {
 		/* we already have allocated lock. use it */
 		hl = nhl;
 		nhl = NULL;
-		list_add(&hl->dh_list, &dl->dl_list);
+		hlist_add_head(&hl->dh_hash, &db->db_head);
 		goto found;
 	}
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->db_lock);
 
 	/* lock not found and we haven't allocated lock yet. allocate it */
 	OBD_SLAB_ALLOC_GFP(nhl, dynlock_cachep, sizeof(*nhl), gfp);
@@ -128,23 +182,23 @@ found:
 		 * this functionaly is useful for rename operations */
 		while ((hl->dh_writers && hl->dh_pid != current->pid) ||
 				hl->dh_readers) {
-			spin_unlock(&dl->dl_list_lock);
+			spin_unlock(&db->db_lock);
 			wait_event(hl->dh_wait,
 				hl->dh_writers == 0 && hl->dh_readers == 0);
-			spin_lock(&dl->dl_list_lock);
+			spin_lock(&db->db_lock);
 		}
 		hl->dh_writers++;
 	} else {
 		/* shared lock: user do not want to share lock with writer */
 		while (hl->dh_writers) {
-			spin_unlock(&dl->dl_list_lock);
+			spin_unlock(&db->db_lock);
 			wait_event(hl->dh_wait, hl->dh_writers == 0);
-			spin_lock(&dl->dl_list_lock);
+			spin_lock(&db->db_lock);
 		}
 		hl->dh_readers++;
 	}
 	hl->dh_pid = current->pid;
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->db_lock);
 
 	return hl;
 }
@@ -158,6 +212,7 @@ found:
  */
 void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *hl)
 {
+	struct dynlock_bucket *db;
 	int wakeup = 0;
 
 	BUG_ON(dl == NULL);
@@ -170,7 +225,8 @@ void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *hl)
 	BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
 	BUG_ON(hl->dh_writers != 0 && current->pid != hl->dh_pid);
 
-	spin_lock(&dl->dl_list_lock);
+	db = dynlock_bucket(dl, hl->dh_value);
+	spin_lock(&db->db_lock);
 	if (hl->dh_writers) {
 		BUG_ON(hl->dh_readers != 0);
 		hl->dh_writers--;
@@ -189,31 +245,22 @@ void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *hl)
 	}
 	if (--(hl->dh_refcount) == 0) {
 		hl->dh_magic = DYNLOCK_HANDLE_DEAD;
-		list_del(&hl->dh_list);
+		hlist_del(&hl->dh_hash);
 		OBD_SLAB_FREE(hl, dynlock_cachep, sizeof(*hl));
 	}
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->db_lock);
 }
 
 int dynlock_is_locked(struct dynlock *dl, unsigned long value)
 {
+	struct dynlock_bucket *db = dynlock_bucket(dl, value);
 	struct dynlock_handle *hl;
-	int result = 0;
+	int result;
+
+	spin_lock(&db->db_lock);
+	hl = dynlock_find(db, value);
+	result = hl != NULL && hl->dh_pid == current->pid;
+	spin_unlock(&db->db_lock);
 
-	/* find requested lock in lockspace */
-	spin_lock(&dl->dl_list_lock);
-	BUG_ON(dl->dl_list.next == NULL);
-	BUG_ON(dl->dl_list.prev == NULL);
-	list_for_each_entry(hl, &dl->dl_list, dh_list) {
-		BUG_ON(hl->dh_list.next == NULL);
-		BUG_ON(hl->dh_list.prev == NULL);
-		BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
-		if (hl->dh_value == value && hl->dh_pid == current->pid) {
-			/* lock is found */
-			result = 1;
-			break;
-		}
-	}
-	spin_unlock(&dl->dl_list_lock);
 	return result;
 }
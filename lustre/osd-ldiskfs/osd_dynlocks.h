@@ -6,13 +6,20 @@
 
 /*
  * lock's namespace:
- *   - list of locks
- *   - lock to protect this list
+ *   - hash table of locks, keyed by the locked value (a block number)
+ *   - one lock per bucket to protect its chain
  */
+#define DYNLOCK_HASH_BITS	6
+#define DYNLOCK_HASH_SIZE	(1 << DYNLOCK_HASH_BITS)
+
+struct dynlock_bucket {
+	spinlock_t		db_lock;
+	struct hlist_head	db_head;
+};
+
 struct dynlock {
 	unsigned		dl_magic;
-	struct list_head	dl_list;
-	spinlock_t		dl_list_lock;
+	struct dynlock_bucket	*dl_buckets;
 };
 
 enum dynlock_type {
@@ -22,7 +29,7 @@ enum dynlock_type {
 
 struct dynlock_handle {
 	unsigned		dh_magic;
-	struct list_head	dh_list;
+	struct hlist_node	dh_hash;
 	unsigned long		dh_value;	/* lock value */
 	int			dh_refcount;	/* number of users */
 	int			dh_readers;
@@ -31,7 +38,8 @@ struct dynlock_handle {
 	wait_queue_head_t	dh_wait;
 };
 
-void dynlock_init(struct dynlock *dl);
+int dynlock_init(struct dynlock *dl);
+void dynlock_fini(struct dynlock *dl);
 struct dynlock_handle *dynlock_lock(struct dynlock *dl, unsigned long value,
 				    enum dynlock_type lt, gfp_t gfp);
 void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *lock);
@@ -52,6 +52,7 @@
 #include <linux/fs.h>
 /* XATTR_{REPLACE,CREATE} */
 #include <linux/xattr.h>
+#include <linux/sort.h>
 
 #include <ldiskfs/ldiskfs.h>
 #include <ldiskfs/xattr.h>
@@ -1531,6 +1532,17 @@ struct osd_xattr_entry {
 	char			oxe_buf[0];
 };
 
+/*
+ * The xattrs read often enough to be cached in the osd_object. The linkEA is
+ * read on every rename, link and unlink, and for each hop of fid2path.
+ */
+static inline bool osd_oxc_cached(const char *name)
+{
+	return strcmp(name, XATTR_NAME_LOV) == 0 ||
+	       strcmp(name, XATTR_NAME_DEFAULT_LMV) == 0 ||
+	       strcmp(name, XATTR_NAME_LINK) == 0;
+}
+
 static int osd_oxc_get(struct osd_object *obj, const char *name,
 		       struct lu_buf *buf)
 {
@@ -3129,6 +3141,7 @@ static int osd_attr_set(const struct lu_env *env,
 				(const struct iam_key *)fid1,
 				(const struct iam_rec *)id, ipd);
 		osd_ipd_put(env, bag, ipd);
+		osd_oi_cache_del(osd_dev(dt->do_lu.lo_dev), fid0);
 		return(rc > 0 ? 0 : rc);
 	}
 
@@ -4073,19 +4086,25 @@ static int osd_process_scheduled_agent_removals(const struct lu_env *env,
  * \retval   0, on success
  * \retval -ve, on error
  */
-static int osd_create(const struct lu_env *env, struct dt_object *dt,
-		      struct lu_attr *attr, struct dt_allocation_hint *hint,
-		      struct dt_object_format *dof, struct thandle *th)
+/*
+ * Create the inode of a new object and set its LMA, but do not insert the
+ * FID mapping yet. \a on_ost tells whether the object is an OST object.
+ */
+static int osd_create_inode(const struct lu_env *env, struct dt_object *dt,
+			    struct lu_attr *attr,
+			    struct dt_allocation_hint *hint,
+			    struct dt_object_format *dof, struct thandle *th,
+			    int *on_ost)
 {
 	const struct lu_fid *fid = lu_object_fid(&dt->do_lu);
 	struct osd_object *obj = osd_dt_obj(dt);
 	struct osd_thread_info *info = osd_oti_get(env);
-	int result, on_ost = 0;
+	int result;
 
-	ENTRY;
+	*on_ost = 0;
 
 	if (dt_object_exists(dt))
-		RETURN(-EEXIST);
+		return -EEXIST;
 
 	LINVRNT(osd_invariant(obj));
 	LASSERT(!dt_object_remote(dt));
@@ -4097,7 +4116,7 @@ static int osd_create(const struct lu_env *env, struct dt_object *dt,
 		 * Quota files can't be created from the kernel any more,
 		 * 'tune2fs -O quota' will take care of creating them
 		 */
-		RETURN(-EPERM);
+		return -EPERM;
 
 	result = __osd_create(info, obj, attr, hint, dof, th);
 	if (result == 0) {
@@ -4108,21 +4127,32 @@ static int osd_create(const struct lu_env *env, struct dt_object *dt,
 
 			fid_to_ostid(fid, oi);
 			ostid_to_fid(tfid, oi, 0);
-			on_ost = 1;
+			*on_ost = 1;
 			result = osd_ea_fid_set(info, obj->oo_inode, tfid,
 						LMAC_FID_ON_OST, 0);
 		} else {
-			on_ost = fid_is_on_ost(info, osd_obj2dev(obj),
-					       fid, OI_CHECK_FLD);
+			*on_ost = fid_is_on_ost(info, osd_obj2dev(obj),
+						fid, OI_CHECK_FLD);
 			result = osd_ea_fid_set(info, obj->oo_inode, fid,
-						on_ost ? LMAC_FID_ON_OST : 0,
+						*on_ost ? LMAC_FID_ON_OST : 0,
 						0);
 		}
 		if (obj->oo_dt.do_body_ops == &osd_body_ops_new)
 			obj->oo_dt.do_body_ops = &osd_body_ops;
 	}
 
-	if (!result && !CFS_FAIL_CHECK(OBD_FAIL_OSD_NO_OI_ENTRY))
+	return result;
+}
+
+/* Insert the FID mapping of an object created by osd_create_inode(). */
+static int osd_create_insert(const struct lu_env *env, struct dt_object *dt,
+			     struct thandle *th, int on_ost)
+{
+	const struct lu_fid *fid = lu_object_fid(&dt->do_lu);
+	struct osd_object *obj = osd_dt_obj(dt);
+	int result = 0;
+
+	if (!CFS_FAIL_CHECK(OBD_FAIL_OSD_NO_OI_ENTRY))
 		result = __osd_oi_insert(env, obj, fid, th);
 
 	/*
@@ -4140,9 +4170,112 @@ static int osd_create(const struct lu_env *env, struct dt_object *dt,
 	LASSERT(ergo(result == 0,
 		     dt_object_exists(dt) && !dt_object_remote(dt)));
 	LINVRNT(osd_invariant(obj));
+	return result;
+}
+
+static int osd_create(const struct lu_env *env, struct dt_object *dt,
+		      struct lu_attr *attr, struct dt_allocation_hint *hint,
+		      struct dt_object_format *dof, struct thandle *th)
+{
+	int result, on_ost;
+
+	ENTRY;
+
+	result = osd_create_inode(env, dt, attr, hint, dof, th, &on_ost);
+	if (result == 0)
+		result = osd_create_insert(env, dt, th, on_ost);
+
 	RETURN(result);
 }
 
+struct osd_create_slot {
+	const struct lu_fid	*ocs_fid;
+	int			 ocs_dirn;
+	int			 ocs_idx;
+	int			 ocs_on_ost;
+};
+
+static int osd_create_slot_cmp(const void *a, const void *b)
+{
+	const struct osd_create_slot *s1 = a;
+	const struct osd_create_slot *s2 = b;
+
+	if (s1->ocs_dirn != s2->ocs_dirn)
+		return s1->ocs_dirn < s2->ocs_dirn ? -1 : 1;
+
+	return lu_fid_cmp(s1->ocs_fid, s2->ocs_fid);
+}
+
+/*
+ * Create the inodes of all the objects back to back first, so that they
+ * are taken as a run of inode numbers from the same group, then insert
+ * their mappings sorted by "O/<seq>/d*" directory for OST objects, or by
+ * FID for the OI, so that each directory block and OI leaf is updated by
+ * a run of insertions instead of once every subdir_count objects.
+ */
+static int osd_create_batch(const struct lu_env *env, struct dt_object **dt,
+			    int nr, struct lu_attr *attr,
+			    struct dt_allocation_hint *hint,
+			    struct dt_object_format *dof, struct thandle *th)
+{
+	struct osd_thread_info *info = osd_oti_get(env);
+	struct osd_device *osd = osd_dev(dt[0]->do_lu.lo_dev);
+	struct osd_create_slot *slots;
+	int created;
+	int done;
+	int rc = 0;
+	int i;
+
+	ENTRY;
+
+	OBD_ALLOC_LARGE(slots, nr * sizeof(*slots));
+	if (slots == NULL)
+		RETURN(-ENOMEM);
+
+	for (created = 0; created < nr; created++) {
+		struct osd_create_slot *slot = &slots[created];
+
+		rc = osd_create_inode(env, dt[created], attr, hint, dof, th,
+				      &slot->ocs_on_ost);
+		if (rc != 0)
+			break;
+
+		slot->ocs_fid = lu_object_fid(&dt[created]->do_lu);
+		slot->ocs_idx = created;
+		slot->ocs_dirn = -1;
+		if (slot->ocs_on_ost && osd->od_ost_map != NULL) {
+			rc = osd_obj_map_dirn(info, osd, slot->ocs_fid);
+			if (rc >= 0)
+				slot->ocs_dirn = rc;
+			rc = 0;
+		}
+	}
+
+	sort(slots, created, sizeof(*slots), osd_create_slot_cmp, NULL);
+
+	/* the batch ends at the first object whose mapping failed */
+	done = created;
+	for (i = 0; i < created; i++) {
+		struct osd_create_slot *slot = &slots[i];
+		int rc2;
+
+		rc2 = osd_create_insert(env, dt[slot->ocs_idx], th,
+					slot->ocs_on_ost);
+		if (rc2 != 0 && slot->ocs_idx < done) {
+			done = slot->ocs_idx;
+			rc = rc2;
+		}
+	}
+
+	OBD_FREE_LARGE(slots, nr * sizeof(*slots));
+
+	CDEBUG(D_INODE, "%s: created %d/%d objects from "DFID": rc = %d\n",
+	       osd_name(osd), done, nr, PFID(lu_object_fid(&dt[0]->do_lu)),
+	       rc);
+
+	RETURN(done > 0 ? done : rc);
+}
+
 static int osd_declare_ref_add(const struct lu_env *env, struct dt_object *dt,
 			       struct thandle *handle)
 {
@@ -4339,10 +4472,7 @@ static int osd_xattr_get(const struct lu_env *env, struct dt_object *dt,
 	LASSERT(inode->i_op->getxattr != NULL);
 #endif
 
-	if (strcmp(name, XATTR_NAME_LOV) == 0 ||
-	    strcmp(name, XATTR_NAME_DEFAULT_LMV) == 0)
-		cache_xattr = true;
-
+	cache_xattr = osd_oxc_cached(name);
 	if (cache_xattr) {
 		rc = osd_oxc_get(obj, name, buf);
 		if (rc != -ENOENT)
@@ -4757,9 +4887,7 @@ static int osd_xattr_set(const struct lu_env *env, struct dt_object *dt,
 	rc = __osd_xattr_set(info, inode, name, buf->lb_buf, len, fs_flags);
 	osd_trans_exec_check(env, handle, OSD_OT_XATTR_SET);
 
-	if (rc == 0 &&
-	    (strcmp(name, XATTR_NAME_LOV) == 0 ||
-	     strcmp(name, XATTR_NAME_DEFAULT_LMV) == 0))
+	if (rc == 0 && osd_oxc_cached(name))
 		osd_oxc_add(obj, name, buf->lb_buf, buf->lb_len);
 
 	return rc;
@@ -4860,9 +4988,7 @@ static int osd_xattr_del(const struct lu_env *env, struct dt_object *dt,
 
 	osd_trans_exec_check(env, handle, OSD_OT_XATTR_SET);
 
-	if (rc == 0 &&
-	    (strcmp(name, XATTR_NAME_LOV) == 0 ||
-	     strcmp(name, XATTR_NAME_DEFAULT_LMV) == 0))
+	if (rc == 0 && osd_oxc_cached(name))
 		osd_oxc_del(obj, name);
 
 	return rc;
@@ -5070,6 +5196,7 @@ static const struct dt_object_operations osd_obj_ops = {
 	.do_ah_init		= osd_ah_init,
 	.do_declare_create	= osd_declare_create,
 	.do_create		= osd_create,
+	.do_create_batch	= osd_create_batch,
 	.do_declare_destroy	= osd_declare_destroy,
 	.do_destroy		= osd_destroy,
 	.do_index_try		= osd_index_try,
@@ -7890,6 +8017,7 @@ static int osd_device_init0(const struct lu_env *env,
 	o->od_read_cache = 1;
 	o->od_writethrough_cache = 1;
 	o->od_readcache_max_filesize = OSD_MAX_CACHE_SIZE;
+	o->od_stream_prealloc = OSD_STREAM_PREALLOC_DEF;
 
 	o->od_auto_scrub_interval = AS_DEFAULT;
 
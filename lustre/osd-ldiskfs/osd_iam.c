@@ -258,9 +258,8 @@ int iam_container_init(struct iam_container *c,
 	c->ic_descr = descr;
 	c->ic_object = inode;
 	init_rwsem(&c->ic_sem);
-	dynlock_init(&c->ic_tree_lock);
 	mutex_init(&c->ic_idle_mutex);
-	return 0;
+	return dynlock_init(&c->ic_tree_lock);
 }
 
 /*
@@ -280,6 +279,7 @@ void iam_container_fini(struct iam_container *c)
 	c->ic_idle_bh = NULL;
 	brelse(c->ic_root_bh);
 	c->ic_root_bh = NULL;
+	dynlock_fini(&c->ic_tree_lock);
 }
 
 void iam_path_init(struct iam_path *path, struct iam_container *c,
@@ -98,6 +98,15 @@ extern struct kmem_cache *dynlock_cachep;
 
 #define OBD_BRW_MAPPED	OBD_BRW_LOCAL1
 
+/* the uninitialized extents were renamed to unwritten in 3.16 */
+#ifndef LDISKFS_GET_BLOCKS_CREATE_UNWRIT_EXT
+#define LDISKFS_GET_BLOCKS_CREATE_UNWRIT_EXT \
+	LDISKFS_GET_BLOCKS_CREATE_UNINIT_EXT
+#endif
+#ifndef LDISKFS_MAP_UNWRITTEN
+#define LDISKFS_MAP_UNWRITTEN LDISKFS_MAP_UNINIT
+#endif
+
 struct osd_directory {
         struct iam_container od_container;
         struct iam_descr     od_descr;
@@ -116,6 +125,14 @@ struct osd_oi {
 
 extern const int osd_dto_credits_noquota[];
 
+/* size of the sketch of the read frequencies of the objects */
+#define OSD_READ_FREQ_BITS	12
+#define OSD_READ_FREQ_SIZE	(1 << OSD_READ_FREQ_BITS)
+
+/* default and max size of the reservations after streaming writes, in MB */
+#define OSD_STREAM_PREALLOC_DEF	16
+#define OSD_STREAM_PREALLOC_MAX	128
+
 struct osd_object {
 	struct dt_object        oo_dt;
 	/**
@@ -153,6 +170,8 @@ struct osd_object {
 
 	struct list_head	oo_xattr_list;
 	struct lu_object_header *oo_header;
+	/* end of the last write, to detect the streaming writes */
+	__u64			oo_write_end;
 };
 
 struct osd_obj_seq {
@@ -258,6 +277,10 @@ struct osd_device {
         struct osd_oi           **od_oi_table;
         /* total number of OI containers */
         int                       od_oi_count;
+	/* cache of the OI mappings, see osd_oi_cache_lookup() */
+	struct osd_oi_cache_entry *od_oi_cache;
+	unsigned int		  od_oi_cache_bits;
+	spinlock_t		  od_oi_cache_locks[OSD_OI_CACHE_LOCKS];
         /*
          * Fid Capability
          */
@@ -288,6 +311,16 @@ struct osd_device {
 	unsigned long long	od_readcache_max_filesize;
 	int			od_read_cache;
 	int			od_writethrough_cache;
+	/* # of recent reads of an object before its pages are kept in the
+	 * cache, 0 to cache all of them, see osd_read_cache_admit() */
+	unsigned int		od_read_cache_admit;
+	/* reads since the read frequencies were last aged */
+	atomic_t		od_read_freq_count;
+	/* count-min sketch of the read frequencies of the objects */
+	__u8			od_read_freq[OSD_READ_FREQ_SIZE];
+	/* MB of unwritten extents reserved after the streaming writes, 0 to
+	 * disable, see osd_stream_prealloc() */
+	unsigned int		od_stream_prealloc;
 
 	struct brw_stats	od_brw_stats;
 	atomic_t		od_r_in_flight;
@@ -405,7 +438,8 @@ struct osd_thandle {
 	uid_t			ot_id_array[OSD_MAX_UGID_CNT];
 	struct lquota_trans    *ot_quota_trans;
 
-	unsigned int		ot_remove_agents:1;
+	unsigned int		ot_remove_agents:1,
+				ot_stream_prealloc:1;
 #if OSD_THANDLE_STATS
         /** time when this handle was allocated */
 	ktime_t oth_alloced;
@@ -447,6 +481,9 @@ enum {
         LPROC_OSD_CACHE_ACCESS  = 4,
         LPROC_OSD_CACHE_HIT     = 5,
         LPROC_OSD_CACHE_MISS    = 6,
+	LPROC_OSD_CACHE_REJECT	= 7,
+	LPROC_OSD_OI_CACHE_HIT	= 8,
+	LPROC_OSD_OI_CACHE_MISS	= 9,
 
 #if OSD_THANDLE_STATS
         LPROC_OSD_THANDLE_STARTING,
@@ -753,6 +790,8 @@ int osd_obj_map_lookup(struct osd_thread_info *info, struct osd_device *osd,
 int osd_obj_map_insert(struct osd_thread_info *info, struct osd_device *osd,
 		       const struct lu_fid *fid, const struct osd_inode_id *id,
 		       handle_t *th);
+int osd_obj_map_dirn(struct osd_thread_info *info, struct osd_device *osd,
+		     const struct lu_fid *fid);
 int osd_obj_map_delete(struct osd_thread_info *info, struct osd_device *osd,
 			const struct lu_fid *fid, handle_t *th);
 int osd_obj_map_update(struct osd_thread_info *info, struct osd_device *osd,
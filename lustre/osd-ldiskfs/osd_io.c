@@ -42,6 +42,7 @@
 #include <linux/types.h>
 /* prerequisite for linux/xattr.h */
 #include <linux/fs.h>
+#include <linux/hash.h>
 #include <linux/mm.h>
 #include <linux/pagevec.h>
 
@@ -1216,6 +1217,19 @@ cleanup:
 	return rc;
 }
 
+static int osd_stream_prealloc_check(const struct lu_env *env,
+				     const struct osd_device *osd,
+				     struct osd_object *obj,
+				     struct niobuf_local *lnb, int npages)
+{
+	return 0;
+}
+
+static void osd_stream_prealloc(const struct osd_device *osd,
+				struct inode *inode, loff_t end)
+{
+}
+
 static int osd_ldiskfs_map_inode_pages(struct inode *inode, struct page **page,
 				       int pages, sector_t *blocks,
 				       int create)
@@ -1288,6 +1302,11 @@ cont_map:
 					*(blocks + total) = 0;
 					total++;
 					break;
+				} else if (!create && (map.m_flags &
+						       LDISKFS_MAP_UNWRITTEN)) {
+					/* reserved by osd_stream_prealloc(),
+					 * reads as a hole */
+					*(blocks + total) = 0;
 				} else {
 					*(blocks + total) = map.m_pblk + c;
 					/* unmap any possible underlying
@@ -1323,6 +1342,77 @@ cont_map:
 cleanup:
 	return rc;
 }
+
+/*
+ * Streaming writes.
+ *
+ * Each BRW allocates the blocks it needs only, so the blocks of an object
+ * written by a big sequential write get interleaved with the blocks of the
+ * other objects written at the same time, and the object ends up with many
+ * small extents. Once an object written sequentially has grown to
+ * od_stream_prealloc MB, the blocks after the end of each write are reserved
+ * as unwritten extents, od_stream_prealloc MB at a time, as a fallocate()
+ * with FALLOC_FL_KEEP_SIZE would do, and the next writes convert them.
+ *
+ * The reserved blocks are not reported to the quota slave, so nothing is
+ * reserved when the write is over quota already, nor when the free space is
+ * getting short. The blocks left after the end of the object are released
+ * by the truncates only, the reservations are a best effort anyway.
+ */
+static int osd_stream_prealloc_check(const struct lu_env *env,
+				     const struct osd_device *osd,
+				     struct osd_object *obj,
+				     struct niobuf_local *lnb, int npages)
+{
+	struct inode *inode = obj->oo_inode;
+	struct super_block *sb = osd_sb(osd);
+	struct kstatfs *ksfs = &osd_oti_get(env)->oti_ksfs;
+	struct ldiskfs_map_blocks map = { 0 };
+	__u64 window = (__u64)osd->od_stream_prealloc << 20;
+	__u64 start = lnb[0].lnb_file_offset;
+	__u64 end = lnb[npages - 1].lnb_file_offset + lnb[npages - 1].lnb_len;
+	__u64 last = obj->oo_write_end;
+
+	if (window == 0 || last == 0 || end < window ||
+	    end < i_size_read(inode) ||
+	    !(LDISKFS_I(inode)->i_flags & LDISKFS_EXTENTS_FL))
+		return 0;
+
+	/* the writes of a stream may be reordered by the RPCs in flight */
+	if (start > last + window || start + window < last)
+		return 0;
+
+	/* reserved by an earlier write already */
+	map.m_lblk = (end + sb->s_blocksize - 1) >> sb->s_blocksize_bits;
+	map.m_len = 1;
+	if (ldiskfs_map_blocks(NULL, inode, &map, 0) != 0)
+		return 0;
+
+	/* leave 4 times the space osd_statfs() keeps aside */
+	if (sb->s_op->statfs(sb->s_root, ksfs) != 0)
+		return 0;
+	if (ksfs->f_bavail < (window >> sb->s_blocksize_bits) +
+	    (ksfs->f_blocks >> (OSD_STATFS_RESERVED_SHIFT - 2)))
+		return 0;
+
+	return 1;
+}
+
+static void osd_stream_prealloc(const struct osd_device *osd,
+				struct inode *inode, loff_t end)
+{
+	struct ldiskfs_map_blocks map = { 0 };
+	int rc;
+
+	map.m_lblk = (end + inode->i_sb->s_blocksize - 1) >>
+		     inode->i_blkbits;
+	map.m_len = osd->od_stream_prealloc << (20 - inode->i_blkbits);
+	rc = ldiskfs_map_blocks(ldiskfs_journal_current_handle(), inode, &map,
+				LDISKFS_GET_BLOCKS_CREATE_UNWRIT_EXT);
+	CDEBUG(D_INODE, "inode %lu: reserved %u blocks from %u: rc = %d\n",
+	       inode->i_ino, map.m_flags & LDISKFS_MAP_NEW ? map.m_len : 0,
+	       map.m_lblk, rc);
+}
 #endif /* HAVE_LDISKFS_MAP_BLOCKS */
 
 static int osd_write_prep(const struct lu_env *env, struct dt_object *dt,
@@ -1552,6 +1642,13 @@ static int osd_declare_write_commit(const struct lu_env *env,
 	else
 		credits += newblocks;
 
+	oh->ot_stream_prealloc = osd_stream_prealloc_check(env, osd,
+							   osd_dt_obj(dt),
+							   lnb, npages);
+	/* one more extent, allocated from a single group */
+	if (oh->ot_stream_prealloc)
+		credits += depth * 2 + 2;
+
 	osd_trans_declare_op(env, oh, OSD_OT_WRITE, credits);
 
 	/* make sure the over quota flags were not set */
@@ -1570,6 +1667,8 @@ static int osd_declare_write_commit(const struct lu_env *env,
 		lnb[0].lnb_flags |= OBD_BRW_OVER_GRPQUOTA;
 	if (local_flags & QUOTA_FL_OVER_PRJQUOTA)
 		lnb[0].lnb_flags |= OBD_BRW_OVER_PRJQUOTA;
+	if (local_flags)
+		oh->ot_stream_prealloc = 0;
 
 	if (rc == 0)
 		rc = osd_trunc_lock(osd_dt_obj(dt), oh, true);
@@ -1586,6 +1685,8 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
         struct osd_iobuf *iobuf = &oti->oti_iobuf;
         struct inode *inode = osd_dt_obj(dt)->oo_inode;
         struct osd_device  *osd = osd_obj2dev(osd_dt_obj(dt));
+	struct osd_thandle *oh = container_of0(thandle, struct osd_thandle,
+					       ot_super);
         loff_t isize;
         int rc = 0, i;
 
@@ -1657,6 +1758,12 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 			spin_unlock(&inode->i_lock);
 		}
 
+		if (oh->ot_stream_prealloc)
+			osd_stream_prealloc(osd, inode, isize);
+		osd_dt_obj(dt)->oo_write_end =
+			lnb[npages - 1].lnb_file_offset +
+			lnb[npages - 1].lnb_len;
+
 		rc = osd_do_bio(osd, inode, iobuf);
 		/* we don't do stats here as in read path because
 		 * write is async: we'll do this in osd_put_bufs() */
@@ -1680,6 +1787,49 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 	RETURN(rc);
 }
 
+/*
+ * Frequency-aware admission to the read cache.
+ *
+ * The reads of the objects are counted in a count-min sketch, i.e. two
+ * counters chosen by two hashes of the inode, the frequency being the lower
+ * of them. All the counters are halved after every 8 * OSD_READ_FREQ_SIZE
+ * reads, so that the frequency reflects the recent reads only. The counters
+ * are updated without locking, a lost update only makes the estimate a bit
+ * lower.
+ *
+ * The pages read from disk are kept in the cache only if the object was read
+ * more than od_read_cache_admit times recently, so that the data read once,
+ * e.g. by a big sequential read, does not evict the data read repeatedly.
+ */
+static bool osd_read_cache_admit(struct osd_device *osd, struct inode *inode)
+{
+	unsigned int admit = osd->od_read_cache_admit;
+	__u8 *freq = osd->od_read_freq;
+	u32 h1;
+	u32 h2;
+	int i;
+
+	if (admit == 0)
+		return true;
+
+	h1 = hash_32((u32)inode->i_ino, OSD_READ_FREQ_BITS);
+	h2 = hash_32((u32)inode->i_ino ^ inode->i_generation,
+		     OSD_READ_FREQ_BITS);
+	if (freq[h1] < U8_MAX)
+		freq[h1]++;
+	if (freq[h2] < U8_MAX)
+		freq[h2]++;
+
+	if (atomic_inc_return(&osd->od_read_freq_count) >=
+	    8 * OSD_READ_FREQ_SIZE) {
+		atomic_set(&osd->od_read_freq_count, 0);
+		for (i = 0; i < OSD_READ_FREQ_SIZE; i++)
+			freq[i] >>= 1;
+	}
+
+	return min(freq[h1], freq[h2]) > admit;
+}
+
 static int osd_read_prep(const struct lu_env *env, struct dt_object *dt,
                          struct niobuf_local *lnb, int npages)
 {
@@ -1688,6 +1838,8 @@ static int osd_read_prep(const struct lu_env *env, struct dt_object *dt,
         struct inode *inode = osd_dt_obj(dt)->oo_inode;
         struct osd_device *osd = osd_obj2dev(osd_dt_obj(dt));
 	int rc = 0, i, cache = 0, cache_hits = 0, cache_misses = 0;
+	int cache_rejects = 0;
+	bool admit = true;
 	ktime_t start, end;
 	s64 timediff;
 	loff_t isize;
@@ -1704,6 +1856,8 @@ static int osd_read_prep(const struct lu_env *env, struct dt_object *dt,
 		cache = 1;
 	if (isize > osd->od_readcache_max_filesize)
 		cache = 0;
+	if (cache)
+		admit = osd_read_cache_admit(osd, inode);
 
 	start = ktime_get();
 	for (i = 0; i < npages; i++) {
@@ -1730,6 +1884,13 @@ static int osd_read_prep(const struct lu_env *env, struct dt_object *dt,
 			cache_hits++;
 			unlock_page(lnb[i].lnb_page);
 		} else {
+			/* do not keep the pages read from disk, but leave
+			 * the ones already cached */
+			if (!admit) {
+				generic_error_remove_page(inode->i_mapping,
+							  lnb[i].lnb_page);
+				cache_rejects++;
+			}
 			cache_misses++;
 			osd_iobuf_add_page(iobuf, &lnb[i]);
 		}
@@ -1753,6 +1914,9 @@ static int osd_read_prep(const struct lu_env *env, struct dt_object *dt,
 	if (cache_hits + cache_misses != 0)
 		lprocfs_counter_add(osd->od_stats, LPROC_OSD_CACHE_ACCESS,
 				    cache_hits + cache_misses);
+	if (cache_rejects != 0)
+		lprocfs_counter_add(osd->od_stats, LPROC_OSD_CACHE_REJECT,
+				    cache_rejects);
 
 	if (iobuf->dr_npages) {
 		rc = osd_ldiskfs_map_inode_pages(inode, iobuf->dr_pages,
@@ -211,6 +211,13 @@ static int osd_stats_init(struct osd_device *osd)
                 lprocfs_counter_init(osd->od_stats, LPROC_OSD_CACHE_MISS,
                                      LPROCFS_CNTR_AVGMINMAX,
                                      "cache_miss", "pages");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_CACHE_REJECT,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "cache_reject", "pages");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_OI_CACHE_HIT,
+				     0, "oi_cache_hit", "lookups");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_OI_CACHE_MISS,
+				     0, "oi_cache_miss", "lookups");
 #if OSD_THANDLE_STATS
                 lprocfs_counter_init(osd->od_stats, LPROC_OSD_THANDLE_STARTING,
                                      LPROCFS_CNTR_AVGMINMAX,
@@ -596,6 +603,82 @@ ldiskfs_osd_readcache_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(ldiskfs_osd_readcache);
 
+static int ldiskfs_osd_readcache_admit_seq_show(struct seq_file *m, void *data)
+{
+	struct osd_device *osd = osd_dt_dev((struct dt_device *)m->private);
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	seq_printf(m, "%u\n", osd->od_read_cache_admit);
+	return 0;
+}
+
+static ssize_t
+ldiskfs_osd_readcache_admit_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct dt_device *dt = m->private;
+	struct osd_device *osd = osd_dt_dev(dt);
+	unsigned int val;
+	int rc;
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+	if (val >= U8_MAX)
+		return -ERANGE;
+
+	osd->od_read_cache_admit = val;
+	return count;
+}
+LPROC_SEQ_FOPS(ldiskfs_osd_readcache_admit);
+
+static int ldiskfs_osd_stream_prealloc_seq_show(struct seq_file *m, void *data)
+{
+	struct osd_device *osd = osd_dt_dev((struct dt_device *)m->private);
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	seq_printf(m, "%u\n", osd->od_stream_prealloc);
+	return 0;
+}
+
+static ssize_t
+ldiskfs_osd_stream_prealloc_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct dt_device *dt = m->private;
+	struct osd_device *osd = osd_dt_dev(dt);
+	unsigned int val;
+	int rc;
+
+	LASSERT(osd != NULL);
+	if (unlikely(osd->od_mnt == NULL))
+		return -EINPROGRESS;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+	if (val > OSD_STREAM_PREALLOC_MAX)
+		return -ERANGE;
+
+	osd->od_stream_prealloc = val;
+	return count;
+}
+LPROC_SEQ_FOPS(ldiskfs_osd_stream_prealloc);
+
 #if LUSTRE_VERSION_CODE < OBD_OCD_VERSION(3, 0, 52, 0)
 static int ldiskfs_osd_index_in_idif_seq_show(struct seq_file *m, void *data)
 {
@@ -754,6 +837,10 @@ struct lprocfs_vars lprocfs_osd_obd_vars[] = {
 	  .fops	=	&ldiskfs_osd_nonrotational_fops	},
 	{ .name	=	"readcache_max_filesize",
 	  .fops	=	&ldiskfs_osd_readcache_fops	},
+	{ .name	=	"readcache_admit",
+	  .fops	=	&ldiskfs_osd_readcache_admit_fops	},
+	{ .name	=	"stream_prealloc_mb",
+	  .fops	=	&ldiskfs_osd_stream_prealloc_fops	},
 	{ .name	=	"index_backup",
 	  .fops	=	&ldiskfs_osd_index_backup_fops	},
 	{ NULL }
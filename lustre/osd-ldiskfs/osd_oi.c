@@ -60,6 +60,10 @@ unsigned int osd_oi_count = OSD_OI_FID_NR;
 module_param(osd_oi_count, int, 0444);
 MODULE_PARM_DESC(osd_oi_count, "Number of Object Index containers to be created, it's only valid for new filesystem.");
 
+unsigned int osd_oi_cache_size = 32;
+module_param(osd_oi_cache_size, uint, 0444);
+MODULE_PARM_DESC(osd_oi_cache_size, "MB of memory to cache the Object Index mappings of each MDT in, 0 to disable the cache.");
+
 static struct dt_index_features oi_feat = {
         .dif_flags       = DT_IND_UPDATE,
         .dif_recsize_min = sizeof(struct osd_inode_id),
@@ -383,6 +387,130 @@ static int osd_remove_ois(struct osd_thread_info *info, struct osd_device *osd)
 	return rc;
 }
 
+/*
+ * Cache of the OI mappings.
+ *
+ * The FIDs not found in the per-thread osd_idmap_cache are looked up in the
+ * IAM containers of the OI, which is disk bound for the random lookups of
+ * the big MDTs. The mappings found there are kept in a direct mapped cache
+ * shared by all the threads of the device, sized by osd_oi_cache_size, the
+ * last mapping looked up in an entry replacing the previous one.
+ *
+ * A mapping is dropped from the cache after it is changed in the OI. The
+ * version of the entry, bumped then, keeps a lookup that raced with the
+ * change from caching the old mapping.
+ */
+static void osd_oi_cache_init(struct osd_device *osd)
+{
+	unsigned long nr;
+	int bits;
+	int i;
+
+	if (osd->od_is_ost || osd_oi_cache_size == 0)
+		return;
+
+	nr = ((unsigned long)osd_oi_cache_size << 20) /
+	     sizeof(struct osd_oi_cache_entry);
+	bits = ilog2(nr);
+	if (bits < 10)
+		bits = 10;
+
+	OBD_ALLOC_LARGE(osd->od_oi_cache,
+			sizeof(struct osd_oi_cache_entry) << bits);
+	if (osd->od_oi_cache == NULL) {
+		CWARN("%s: cannot allocate %u MB for the OI cache\n",
+		      osd_dev2name(osd), osd_oi_cache_size);
+		return;
+	}
+
+	for (i = 0; i < OSD_OI_CACHE_LOCKS; i++)
+		spin_lock_init(&osd->od_oi_cache_locks[i]);
+	osd->od_oi_cache_bits = bits;
+}
+
+static void osd_oi_cache_fini(struct osd_device *osd)
+{
+	if (osd->od_oi_cache == NULL)
+		return;
+
+	OBD_FREE_LARGE(osd->od_oi_cache,
+		       sizeof(struct osd_oi_cache_entry) <<
+		       osd->od_oi_cache_bits);
+	osd->od_oi_cache = NULL;
+}
+
+static inline struct osd_oi_cache_entry *
+osd_oi_cache_find(struct osd_device *osd, const struct lu_fid *fid,
+		  spinlock_t **lock)
+{
+	__u32 idx = fid_hash(fid, osd->od_oi_cache_bits);
+
+	*lock = &osd->od_oi_cache_locks[idx & (OSD_OI_CACHE_LOCKS - 1)];
+	return &osd->od_oi_cache[idx];
+}
+
+/* return true if \a fid was found in the cache, otherwise the version of its
+ * entry in \a version, for osd_oi_cache_add() */
+static bool osd_oi_cache_lookup(struct osd_device *osd,
+				const struct lu_fid *fid,
+				struct osd_inode_id *id, __u32 *version)
+{
+	struct osd_oi_cache_entry *oce;
+	spinlock_t *lock;
+	bool found = false;
+
+	if (osd->od_oi_cache == NULL || fid_is_zero(fid))
+		return false;
+
+	oce = osd_oi_cache_find(osd, fid, &lock);
+	spin_lock(lock);
+	if (lu_fid_eq(&oce->oce_fid, fid)) {
+		*id = oce->oce_id;
+		found = true;
+	} else {
+		*version = oce->oce_version;
+	}
+	spin_unlock(lock);
+
+	lprocfs_counter_incr(osd->od_stats, found ? LPROC_OSD_OI_CACHE_HIT :
+						    LPROC_OSD_OI_CACHE_MISS);
+	return found;
+}
+
+static void osd_oi_cache_add(struct osd_device *osd, const struct lu_fid *fid,
+			     const struct osd_inode_id *id, __u32 version)
+{
+	struct osd_oi_cache_entry *oce;
+	spinlock_t *lock;
+
+	if (osd->od_oi_cache == NULL)
+		return;
+
+	oce = osd_oi_cache_find(osd, fid, &lock);
+	spin_lock(lock);
+	if (oce->oce_version == version) {
+		oce->oce_fid = *fid;
+		oce->oce_id = *id;
+	}
+	spin_unlock(lock);
+}
+
+void osd_oi_cache_del(struct osd_device *osd, const struct lu_fid *fid)
+{
+	struct osd_oi_cache_entry *oce;
+	spinlock_t *lock;
+
+	if (osd->od_oi_cache == NULL)
+		return;
+
+	oce = osd_oi_cache_find(osd, fid, &lock);
+	spin_lock(lock);
+	if (lu_fid_eq(&oce->oce_fid, fid))
+		fid_zero(&oce->oce_fid);
+	oce->oce_version++;
+	spin_unlock(lock);
+}
+
 int osd_oi_init(struct osd_thread_info *info, struct osd_device *osd,
 		bool restored)
 {
@@ -511,6 +639,8 @@ out:
 		} else {
 			rc = 0;
 		}
+		if (rc == 0)
+			osd_oi_cache_init(osd);
 	}
 
 	return rc;
@@ -522,6 +652,7 @@ void osd_oi_fini(struct osd_thread_info *info, struct osd_device *osd)
 		return;
 
 	osd_oi_table_put(info, osd->od_oi_table, osd->od_oi_count);
+	osd_oi_cache_fini(osd);
 
 	OBD_FREE(osd->od_oi_table,
 		 sizeof(*(osd->od_oi_table)) * OSD_OI_FID_NR_MAX);
@@ -618,13 +749,18 @@ static int __osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 			   const struct lu_fid *fid, struct osd_inode_id *id)
 {
 	struct lu_fid *oi_fid = &info->oti_fid2;
+	__u32	       version = 0;
 	int	       rc;
 
+	if (osd_oi_cache_lookup(osd, fid, id, &version))
+		return 0;
+
 	fid_cpu_to_be(oi_fid, fid);
 	rc = osd_oi_iam_lookup(info, osd_fid2oi(osd, fid), (struct dt_rec *)id,
 			       (const struct dt_key *)oi_fid);
 	if (rc > 0) {
 		osd_id_unpack(id, id);
+		osd_oi_cache_add(osd, fid, id, version);
 		rc = 0;
 	} else if (rc == 0) {
 		rc = -ENOENT;
@@ -718,6 +854,7 @@ int osd_oi_insert(struct osd_thread_info *info, struct osd_device *osd,
 	rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 			       (const struct dt_rec *)oi_id,
 			       (const struct dt_key *)oi_fid, th, true);
+	osd_oi_cache_del(osd, fid);
 	if (rc != 0) {
 		struct inode *inode;
 		struct lustre_mdt_attrs *lma = &info->oti_ost_attrs.loa_lma;
@@ -771,6 +908,7 @@ update:
 		rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 					(const struct dt_rec *)oi_id,
 					(const struct dt_key *)oi_fid, th, false);
+		osd_oi_cache_del(osd, fid);
 		if (rc != 0)
 			return rc;
 
@@ -814,6 +952,7 @@ int osd_oi_delete(struct osd_thread_info *info,
 		  handle_t *th, enum oi_check_flags flags)
 {
 	struct lu_fid *oi_fid = &info->oti_fid2;
+	int rc;
 
 	/* clear idmap cache */
 	if (lu_fid_eq(fid, &info->oti_cache.oic_fid))
@@ -826,8 +965,10 @@ int osd_oi_delete(struct osd_thread_info *info,
 		return osd_obj_map_delete(info, osd, fid, th);
 
 	fid_cpu_to_be(oi_fid, fid);
-	return osd_oi_iam_delete(info, osd_fid2oi(osd, fid),
-				 (const struct dt_key *)oi_fid, th);
+	rc = osd_oi_iam_delete(info, osd_fid2oi(osd, fid),
+			       (const struct dt_key *)oi_fid, th);
+	osd_oi_cache_del(osd, fid);
+	return rc;
 }
 
 int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
@@ -849,6 +990,7 @@ int osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
 	rc = osd_oi_iam_refresh(info, osd_fid2oi(osd, fid),
 			       (const struct dt_rec *)oi_id,
 			       (const struct dt_key *)oi_fid, th, false);
+	osd_oi_cache_del(osd, fid);
 	if (rc != 0)
 		return rc;
 
@@ -86,6 +86,17 @@ struct osd_idmap_cache {
 	__u16			oic_remote:1;	/* FID isn't local */
 };
 
+/* entry of the OI mappings cache shared by the threads of a device */
+struct osd_oi_cache_entry {
+	struct lu_fid		oce_fid;
+	struct osd_inode_id	oce_id;
+	/* bumped whenever a mapping of this entry is changed */
+	__u32			oce_version;
+};
+
+/* the entries share OSD_OI_CACHE_LOCKS locks */
+#define OSD_OI_CACHE_LOCKS	256
+
 static inline void osd_id_pack(struct osd_inode_id *tgt,
 			       const struct osd_inode_id *src)
 {
@@ -134,6 +145,7 @@ enum oi_check_flags {
 };
 
 extern unsigned int osd_oi_count;
+extern unsigned int osd_oi_cache_size;
 
 int osd_oi_mod_init(void);
 int osd_oi_init(struct osd_thread_info *info, struct osd_device *osd,
@@ -151,6 +163,7 @@ int  osd_oi_delete(struct osd_thread_info *info,
 int  osd_oi_update(struct osd_thread_info *info, struct osd_device *osd,
 		   const struct lu_fid *fid, const struct osd_inode_id *id,
 		   handle_t *th, enum oi_check_flags flags);
+void osd_oi_cache_del(struct osd_device *osd, const struct lu_fid *fid);
 
 int fid_is_on_ost(struct osd_thread_info *info, struct osd_device *osd,
 		  const struct lu_fid *fid, enum oi_check_flags flags);
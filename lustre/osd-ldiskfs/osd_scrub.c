@@ -38,6 +38,7 @@
 #define DEBUG_SUBSYSTEM S_LFSCK
 
 #include <linux/kthread.h>
+#include <linux/sort.h>
 #include <uapi/linux/lustre/lustre_idl.h>
 #include <lustre_disk.h>
 #include <dt_object.h>
@@ -248,6 +249,127 @@ stop:
 	return rc;
 }
 
+/*
+ * Batched OI rebuild.
+ *
+ * When the OI files are rebuilt, most of the inodes scanned by the OI scrub
+ * need their mapping inserted, one transaction each, into the OI leaves in
+ * the random order of the FIDs. The plain insertions are queued instead and
+ * inserted in one transaction, sorted by FID, so that the mappings going into
+ * the same leaf are inserted one after another while it is hot. The queue is
+ * flushed once full, before the position of the scrub is checkpointed, and
+ * when the scan ends.
+ *
+ * The queued inodes are held, so that the mappings of the objects unlinked
+ * meanwhile can be removed again, as osd_scrub_check_update() does.
+ */
+static int osd_scrub_batch_cmp(const void *a, const void *b)
+{
+	const struct osd_scrub_batch_item *i1 = a;
+	const struct osd_scrub_batch_item *i2 = b;
+
+	return lu_fid_cmp(&i1->osbi_fid, &i2->osbi_fid);
+}
+
+/* called with os_rwsem held */
+static void osd_scrub_batch_flush(struct osd_thread_info *info,
+				  struct osd_device *dev)
+{
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct scrub_file *sf = &oscrub->os_scrub.os_file;
+	struct osd_scrub_batch_item *item;
+	int nr = oscrub->os_batch_nr;
+	handle_t *th;
+	bool exist;
+	int rc = 0;
+	int i;
+
+	if (nr == 0)
+		return;
+
+	sort(oscrub->os_batch, nr, sizeof(*item), osd_scrub_batch_cmp, NULL);
+
+	th = osd_journal_start_sb(osd_sb(dev), LDISKFS_HT_MISC,
+			osd_dto_credits_noquota[DTO_INDEX_INSERT] * nr);
+	if (IS_ERR(th)) {
+		rc = PTR_ERR(th);
+		CDEBUG(D_LFSCK, "%s: fail to start trans for %d OI mappings: "
+		       "rc = %d\n", osd_name(dev), nr, rc);
+	}
+
+	for (i = 0; i < nr; i++) {
+		item = &oscrub->os_batch[i];
+		exist = false;
+		if (!IS_ERR(th)) {
+			rc = osd_oi_insert(info, dev, &item->osbi_fid,
+					   &item->osbi_id, th, 0, &exist);
+			/* see osd_scrub_refresh_mapping() */
+			if (unlikely(rc == -EEXIST))
+				rc = 1;
+		}
+
+		if (rc == 0) {
+			int idx = osd_oi_fid2idx(dev, &item->osbi_fid);
+
+			sf->sf_items_updated++;
+			if (exist)
+				continue;
+
+			sf->sf_flags |= SF_RECREATED;
+			if (unlikely(!ldiskfs_test_bit(idx, sf->sf_oi_bitmap)))
+				ldiskfs_set_bit(idx, sf->sf_oi_bitmap);
+		} else if (rc < 0) {
+			CDEBUG(D_LFSCK, "%s: fail to insert OI map "DFID
+			       " => %u/%u: rc = %d\n", osd_name(dev),
+			       PFID(&item->osbi_fid), item->osbi_id.oii_ino,
+			       item->osbi_id.oii_gen, rc);
+			sf->sf_items_failed++;
+			if (sf->sf_pos_first_inconsistent == 0 ||
+			    sf->sf_pos_first_inconsistent >
+			    item->osbi_id.oii_ino)
+				sf->sf_pos_first_inconsistent =
+					item->osbi_id.oii_ino;
+		}
+	}
+
+	if (!IS_ERR(th))
+		ldiskfs_journal_stop(th);
+
+	for (i = 0; i < nr; i++) {
+		item = &oscrub->os_batch[i];
+		if (unlikely(ldiskfs_test_inode_state(item->osbi_inode,
+					LDISKFS_STATE_LUSTRE_DESTROY)))
+			osd_scrub_refresh_mapping(info, dev, &item->osbi_fid,
+						  &item->osbi_id,
+						  DTO_INDEX_DELETE, false, 0,
+						  NULL);
+		iput(item->osbi_inode);
+	}
+	oscrub->os_batch_nr = 0;
+}
+
+/* called with os_rwsem held, takes over the reference on \a inode */
+static void osd_scrub_batch_add(struct osd_thread_info *info,
+				struct osd_device *dev,
+				const struct lu_fid *fid,
+				const struct osd_inode_id *id,
+				struct inode *inode)
+{
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct osd_scrub_batch_item *item;
+	int max;
+
+	item = &oscrub->os_batch[oscrub->os_batch_nr++];
+	item->osbi_fid = *fid;
+	item->osbi_id = *id;
+	item->osbi_inode = inode;
+
+	max = osd_transaction_size(dev) /
+	      osd_dto_credits_noquota[DTO_INDEX_INSERT];
+	if (oscrub->os_batch_nr >= clamp(max, 1, OSD_SCRUB_BATCH_MAX))
+		osd_scrub_batch_flush(info, dev);
+}
+
 static int
 osd_scrub_check_update(struct osd_thread_info *info, struct osd_device *dev,
 		       struct osd_idmap_cache *oic, int val)
@@ -387,6 +509,13 @@ iget:
 		dev->od_igif_inoi = 1;
 	}
 
+	if (ops == DTO_INDEX_INSERT && val == 0 && oii == NULL &&
+	    !(sf->sf_param & SP_DRYRUN)) {
+		osd_scrub_batch_add(info, dev, fid, lid, inode);
+		inode = NULL;
+		GOTO(out, rc = 0);
+	}
+
 	rc = osd_scrub_refresh_mapping(info, dev, fid, lid, ops, false,
 			(val == SCRUB_NEXT_OSTOBJ ||
 			 val == SCRUB_NEXT_OSTOBJ_OLD) ? OI_KNOWN_ON_OST : 0,
@@ -907,6 +1036,14 @@ static int osd_scrub_exec(struct osd_thread_info *info, struct osd_device *dev,
 		return rc;
 	}
 
+	/* the queued mappings go before the position passing them */
+	if (dev->od_scrub.os_batch_nr > 0 &&
+	    ktime_get_seconds() >= scrub->os_time_next_checkpoint) {
+		down_write(&scrub->os_rwsem);
+		osd_scrub_batch_flush(info, dev);
+		up_write(&scrub->os_rwsem);
+	}
+
 	rc = scrub_checkpoint(info->oti_env, scrub);
 	if (rc) {
 		CDEBUG(D_LFSCK, "%s: fail to checkpoint, pos = %llu: "
@@ -1032,6 +1169,61 @@ static void osd_scrub_join(const struct lu_env *env, struct osd_device *dev,
 	EXIT;
 }
 
+static ldiskfs_fsblk_t osd_scrub_desc_block(struct super_block *sb,
+					    __le32 lo, __le32 hi)
+{
+	ldiskfs_fsblk_t block = le32_to_cpu(lo);
+
+	if (LDISKFS_DESC_SIZE(sb) >= LDISKFS_MIN_DESC_SIZE_64BIT)
+		block |= (ldiskfs_fsblk_t)le32_to_cpu(hi) << 32;
+	return block;
+}
+
+/*
+ * Read ahead the inode bitmaps and the used part of the inode tables of the
+ * OSD_SCRUB_RA_GROUPS groups following the one being scanned. The scan
+ * stays single threaded, which keeps its position and checkpoints simple,
+ * but the reads of the next groups are in flight while the inodes of the
+ * current one are checked, instead of each inode block being read when
+ * its first inode is reached.
+ */
+static void osd_scrub_readahead(struct osd_iit_param *param)
+{
+	struct super_block *sb = param->sb;
+	struct ldiskfs_group_desc *desc;
+	ldiskfs_group_t end;
+	ldiskfs_fsblk_t block;
+	unsigned long used;
+	unsigned long nr;
+	unsigned long i;
+
+	end = min_t(ldiskfs_group_t, param->bg + OSD_SCRUB_RA_GROUPS + 1,
+		    LDISKFS_SB(sb)->s_groups_count);
+	/* the scan may have been restarted from an earlier position */
+	if (param->ra_bg <= param->bg || param->ra_bg > end)
+		param->ra_bg = param->bg + 1;
+
+	for (; param->ra_bg < end; param->ra_bg++) {
+		desc = ldiskfs_get_group_desc(sb, param->ra_bg, NULL);
+		if (!desc ||
+		    desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT))
+			continue;
+
+		sb_breadahead(sb, osd_scrub_desc_block(sb,
+					desc->bg_inode_bitmap_lo,
+					desc->bg_inode_bitmap_hi));
+
+		used = LDISKFS_INODES_PER_GROUP(sb) -
+		       ldiskfs_itable_unused_count(sb, desc);
+		nr = DIV_ROUND_UP(used * LDISKFS_INODE_SIZE(sb),
+				  sb->s_blocksize);
+		block = osd_scrub_desc_block(sb, desc->bg_inode_table_lo,
+					     desc->bg_inode_table_hi);
+		for (i = 0; i < nr; i++)
+			sb_breadahead(sb, block + i);
+	}
+}
+
 static int osd_inode_iteration(struct osd_thread_info *info,
 			       struct osd_device *dev, __u32 max, bool preload)
 {
@@ -1186,6 +1378,8 @@ full:
 			RETURN(-EIO);
 		}
 
+		osd_scrub_readahead(param);
+
 		do {
 			struct osd_idmap_cache *oic = NULL;
 
@@ -1307,6 +1501,9 @@ static int osd_scrub_main(void *args)
 	       scrub->os_pos_current);
 
 	rc = osd_inode_iteration(osd_oti_get(&env), dev, ~0U, false);
+	down_write(&scrub->os_rwsem);
+	osd_scrub_batch_flush(osd_oti_get(&env), dev);
+	up_write(&scrub->os_rwsem);
 	if (unlikely(rc == SCRUB_IT_CRASH)) {
 		spin_lock(&scrub->os_lock);
 		thread_set_flags(&scrub->os_thread, SVC_STOPPING);
@@ -1831,7 +2028,10 @@ static void osd_ios_index_register(const struct lu_env *env,
 	    (inode->i_size & (sb->s_blocksize - 1)) != 0)
 		RETURN_EXIT;
 
-	iam_container_init(bag, &iam->od_descr, inode);
+	rc = iam_container_init(bag, &iam->od_descr, inode);
+	if (rc)
+		RETURN_EXIT;
+
 	rc = iam_container_setup(bag);
 	if (rc)
 		GOTO(fini, rc = 1);
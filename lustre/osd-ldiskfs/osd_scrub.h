@@ -42,21 +42,39 @@ enum scrub_internal_flags {
 	SIF_NO_HANDLE_OLD_FID	= 0x0001,
 };
 
+/* groups after the scanned one whose inode tables are read ahead */
+#define OSD_SCRUB_RA_GROUPS	4
+
 struct osd_iit_param {
 	struct super_block *sb;
 	struct buffer_head *bitmap;
 	ldiskfs_group_t bg;
+	/* next group to read ahead, see osd_scrub_readahead() */
+	ldiskfs_group_t ra_bg;
 	__u32 gbase;
 	__u32 offset;
 	__u32 start;
 };
 
+/* max OI mappings the OI scrub inserts in one transaction */
+#define OSD_SCRUB_BATCH_MAX	64
+
+struct osd_scrub_batch_item {
+	struct lu_fid		 osbi_fid;
+	struct osd_inode_id	 osbi_id;
+	struct inode		*osbi_inode;
+};
+
 struct osd_scrub {
 	struct lustre_scrub	os_scrub;
 	struct lvfs_run_ctxt    os_ctxt;
 	struct osd_idmap_cache  os_oic;
 	struct osd_iit_param	os_iit_param;
 
+	/* OI mappings to insert, see osd_scrub_batch_flush() */
+	struct osd_scrub_batch_item os_batch[OSD_SCRUB_BATCH_MAX];
+	int			os_batch_nr;
+
 	/* statistics for /lost+found are in ram only, it will be reset
 	 * when each time the device remount. */
 
@@ -610,6 +610,7 @@ int osd_procfs_fini(struct osd_device *osd);
 
 /* osd_object.c */
 extern char *osd_obj_tag;
+extern unsigned int osd_zap_leaf_shift;
 int __osd_obj2dnode(objset_t *os, uint64_t oid, dnode_t **dnp);
 void osd_object_sa_dirty_rele(const struct lu_env *env, struct osd_thandle *oh);
 void osd_object_sa_dirty_add(struct osd_object *obj, struct osd_thandle *oh);
@@ -850,6 +851,7 @@ static inline void dsl_pool_config_exit(dsl_pool_t *dp, char *name)
 #define	osd_spa_maxblocksize(spa)	SPA_MAXBLOCKSIZE
 #define	osd_spa_maxblockshift(spa)	SPA_MAXBLOCKSHIFT
 #define	SPA_OLD_MAXBLOCKSIZE		SPA_MAXBLOCKSIZE
+#define	SPA_OLD_MAXBLOCKSHIFT		SPA_MAXBLOCKSHIFT
 #endif
 
 #ifdef HAVE_SA_SPILL_ALLOC
@@ -1038,6 +1040,12 @@ static inline int osd_zap_lookup(struct osd_device *osd, uint64_t zap,
 	return -zap_lookup(osd->od_os, zap, key, int_size, int_num, v);
 }
 
+/* block shift of the leaves of the new fat ZAPs, see osd_zap_leaf_shift */
+static inline int osd_zap_leaf_blockshift(void)
+{
+	return clamp_t(int, osd_zap_leaf_shift, 12, SPA_OLD_MAXBLOCKSHIFT);
+}
+
 static inline void osd_tx_hold_zap(dmu_tx_t *tx, uint64_t zap,
 				   dnode_t *dn, int add, const char *name)
 {
@@ -257,6 +257,8 @@ out:
  *      instead I use the lowest bit of the address so that:
  *        arc buffer:  .lnb_data = abuf          (arc we loan for write)
  *        dbuf buffer: .lnb_data = dbuf | 1      (dbuf we get for read)
+ *        part buffer: .lnb_data = abuf | 2      (arc we loan for a part
+ *                                                of a block's write)
  *        copy buffer: .lnb_page->mapping = obj (page we allocate for write)
  *
  *      bzzz, to blame
@@ -287,6 +289,17 @@ static int osd_bufs_put(const struct lu_env *env, struct dt_object *dt,
 				ptr &= ~1UL;
 				dmu_buf_rele((void *)ptr, osd_0copy_tag);
 				atomic_dec(&osd->od_zerocopy_pin);
+			} else if (ptr & 2UL) {
+				int j;
+
+				/* all the pages of the part share the buffer */
+				for (j = i + 1; j < npages &&
+				     lnb[j].lnb_data == lnb[i].lnb_data; j++) {
+					lnb[j].lnb_page = NULL;
+					lnb[j].lnb_data = NULL;
+				}
+				dmu_return_arcbuf((void *)(ptr & ~2UL));
+				atomic_dec(&osd->od_zerocopy_loan);
 			} else if (lnb[i].lnb_data != NULL) {
 				int j, apages, abufsz;
 				abufsz = arc_buf_size(lnb[i].lnb_data);
@@ -480,7 +493,10 @@ static int osd_bufs_get_write(const struct lu_env *env, struct osd_object *obj,
 
 	/*
 	 * currently only full blocks are subject to zerocopy approach:
-	 * so that we're sure nobody is trying to update the same block
+	 * so that we're sure nobody is trying to update the same block.
+	 * The data for most of a block is received into a loaned buffer
+	 * as well, but it is copied into the dbuf at commit with a single
+	 * dmu_write() instead of one per page.
 	 */
 	while (len > 0) {
 		if (unlikely(npages >= maxlnb))
@@ -490,14 +506,56 @@ static int osd_bufs_get_write(const struct lu_env *env, struct osd_object *obj,
 		sz_in_block = min_t(int, bs - off_in_block, len);
 
 		abuf = NULL;
-		if (sz_in_block == bs) {
+		if (sz_in_block == bs ||
+		    (bs >= PAGE_SIZE && is_power_of_2(bs) &&
+		     sz_in_block * 2 >= bs)) {
 			/* full block, try to use zerocopy */
 			abuf = osd_request_arcbuf(dn, bs);
 			if (unlikely(IS_ERR(abuf)))
 				GOTO(out_err, rc = PTR_ERR(abuf));
 		}
 
-		if (abuf != NULL) {
+		if (sz_in_block < bs && off_in_block == 0 &&
+		    off + len >= obj->oo_attr.la_size)
+			lprocfs_counter_add(osd->od_stats,
+					    LPROC_OSD_TAIL_IO, 1);
+
+		if (abuf != NULL && sz_in_block < bs) {
+			atomic_inc(&osd->od_zerocopy_loan);
+
+			/* the pages of the part of the arcbuf being written,
+			 * see osd_write_commit() */
+			poff = off & (PAGE_SIZE - 1);
+			while (sz_in_block > 0) {
+				plen = min_t(int, poff + sz_in_block,
+					     PAGE_SIZE);
+				plen -= poff;
+
+				if (unlikely(npages >= maxlnb))
+					GOTO(out_err, rc = -EOVERFLOW);
+
+				lnb[i].lnb_file_offset = off;
+				lnb[i].lnb_page_offset = poff;
+				lnb[i].lnb_len = plen;
+				lnb[i].lnb_rc = 0;
+				lnb[i].lnb_data =
+					(void *)((unsigned long)abuf | 2UL);
+				lnb[i].lnb_page = kmem_to_page(abuf->b_data +
+							off_in_block - poff);
+				LASSERT(lnb[i].lnb_page);
+				poff = 0;
+
+				lprocfs_counter_add(osd->od_stats,
+						LPROC_OSD_COPY_IO, 1);
+
+				sz_in_block -= plen;
+				len -= plen;
+				off += plen;
+				off_in_block += plen;
+				i++;
+				npages++;
+			}
+		} else if (abuf != NULL) {
 			atomic_inc(&osd->od_zerocopy_loan);
 
 			/* go over pages arcbuf contains, put them as
@@ -533,11 +591,6 @@ static int osd_bufs_get_write(const struct lu_env *env, struct osd_object *obj,
 				npages++;
 			}
 		} else {
-			if (off_in_block == 0 && len < bs &&
-					off + len >= obj->oo_attr.la_size)
-				lprocfs_counter_add(osd->od_stats,
-						LPROC_OSD_TAIL_IO, 1);
-
 			/* can't use zerocopy, allocate temp. buffers */
 			poff = off & (PAGE_SIZE - 1);
 			while (sz_in_block > 0) {
@@ -907,6 +960,30 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 			kunmap(lnb[i].lnb_page);
 			iosize += lnb[i].lnb_len;
 			abufsz = lnb[i].lnb_len; /* to drop cache below */
+		} else if ((unsigned long)lnb[i].lnb_data & 2UL) {
+			void *data = lnb[i].lnb_data;
+			arc_buf_t *abuf = (void *)((unsigned long)data & ~2UL);
+			uint64_t off = lnb[i].lnb_file_offset;
+
+			/* part of a block received into a loaned buffer,
+			 * copy its contiguous pages with one dmu_write() */
+			abufsz = lnb[i].lnb_len;
+			while (i + 1 < npages && lnb[i + 1].lnb_data == data &&
+			       lnb[i + 1].lnb_rc == 0) {
+				i++;
+				abufsz += lnb[i].lnb_len;
+			}
+			osd_dmu_write(osd, obj->oo_dn, off, abufsz,
+				      (char *)abuf->b_data +
+				      (off & (arc_buf_size(abuf) - 1)),
+				      oh->ot_tx);
+			if (new_size < off + abufsz)
+				new_size = off + abufsz;
+			iosize += abufsz;
+
+			if (drop_cache)
+				osd_evict_dbufs_after_write(obj, off, abufsz);
+			continue;
 		} else if (lnb[i].lnb_data) {
 			int j, apages;
 			LASSERT(((unsigned long)lnb[i].lnb_data & 1) == 0);
@@ -731,6 +731,12 @@ static unsigned long osd_sync_destroy_max_size =
 module_param(osd_sync_destroy_max_size, ulong, 0444);
 MODULE_PARM_DESC(osd_sync_destroy_max_size, "Maximum object size to use synchronous destroy.");
 
+/* Larger leaves split less often as a directory grows and keep more of its
+ * entries together for readdir, at the cost of writing more per update */
+unsigned int osd_zap_leaf_shift = 14; /* == ZFS fzap_default_blockshift */
+module_param(osd_zap_leaf_shift, uint, 0644);
+MODULE_PARM_DESC(osd_zap_leaf_shift, "Block shift (12-17) of the leaves of new directories and indexes.");
+
 static inline void
 osd_object_set_destroy_type(struct osd_object *obj)
 {
@@ -1752,7 +1758,7 @@ int __osd_zap_create(const struct lu_env *env, struct osd_device *osd,
 
 	oid = osd_zap_create_flags(osd->od_os, 0, flags | ZAP_FLAG_HASH64,
 				   DMU_OT_DIRECTORY_CONTENTS,
-				   14, /* == ZFS fzap_default_blockshift */
+				   osd_zap_leaf_blockshift(),
 				   DN_MAX_INDBLKSHIFT, /* indirect blockshift */
 				   dnsize, tx);
 
@@ -86,6 +86,14 @@ struct osp_precreate {
 	int				 osp_pre_create_slow;
 	/* cleaning up orphans or recreating missing objects */
 	int				 osp_pre_recovering;
+	/* how many ids were assigned since the last precreate RPC */
+	int				 osp_pre_consumed;
+	/* when the last precreate RPC was sent */
+	ktime_t				 osp_pre_send_time;
+	/* how long the last precreate RPC took, in usec */
+	s64				 osp_pre_rpc_usec;
+	/* sequence allocated ahead for the next rollover, 0 if none */
+	u64				 osp_pre_next_seq;
 };
 
 struct osp_update_request_sub {
@@ -117,11 +125,19 @@ struct osp_update_request {
 	spinlock_t			our_list_lock;
 	/* linked to the list(ou_list) in osp_updates */
 	struct list_head		our_list;
+	/* requests sent in the same OUT RPC as this one, by our_list, see
+	 * osp_batch_update_request() */
+	struct list_head		our_batch_list;
+	/* number of requests in our_batch_list */
+	int				our_batch_nr;
 	__u32				our_batchid;
 	__u32				our_req_ready:1;
 
 };
 
+/* max # of update requests sent to a MDT in one OUT RPC */
+#define OSP_UPDATE_BATCH_MAX	8
+
 struct osp_updates {
 	struct list_head	ou_list;
 	spinlock_t		ou_lock;
@@ -287,6 +303,10 @@ struct osp_device {
 #define opd_pre_max_create_count	opd_pre->osp_pre_max_create_count
 #define opd_pre_create_slow		opd_pre->osp_pre_create_slow
 #define opd_pre_recovering		opd_pre->osp_pre_recovering
+#define opd_pre_consumed		opd_pre->osp_pre_consumed
+#define opd_pre_send_time		opd_pre->osp_pre_send_time
+#define opd_pre_rpc_usec		opd_pre->osp_pre_rpc_usec
+#define opd_pre_next_seq		opd_pre->osp_pre_next_seq
 
 extern struct kmem_cache *osp_object_kmem;
 
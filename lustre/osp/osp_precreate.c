@@ -498,11 +498,18 @@ static int osp_precreate_rollover_new_seq(struct lu_env *env,
 	int		rc;
 	ENTRY;
 
-	rc = seq_client_get_seq(env, osp->opd_obd->u.cli.cl_seq, &fid->f_seq);
-	if (rc != 0) {
-		CERROR("%s: alloc fid error: rc = %d\n",
-		       osp->opd_obd->obd_name, rc);
-		RETURN(rc);
+	/* use the sequence allocated while the ids were running out */
+	if (osp->opd_pre_next_seq != 0) {
+		fid->f_seq = osp->opd_pre_next_seq;
+		osp->opd_pre_next_seq = 0;
+	} else {
+		rc = seq_client_get_seq(env, osp->opd_obd->u.cli.cl_seq,
+					&fid->f_seq);
+		if (rc != 0) {
+			CERROR("%s: alloc fid error: rc = %d\n",
+			       osp->opd_obd->obd_name, rc);
+			RETURN(rc);
+		}
 	}
 
 	fid->f_oid = 1;
@@ -533,6 +540,84 @@ static int osp_precreate_rollover_new_seq(struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Allocate the sequence for the next rollover ahead
+ *
+ * Once the last IDs of the current sequence are precreated, no more
+ * precreation can happen until the clients have used them all up and the
+ * sequence is rolled over (see osp_precreate_rollover_new_seq()). The
+ * new sequence is allocated from the controller at that point, which may
+ * take an RPC while the creates are waiting for objects. Allocate it as
+ * soon as the current sequence is fully precreated instead, so rollover
+ * only has to record it. An allocated sequence that is never used (e.g.
+ * after a restart) is just skipped, there are plenty of them.
+ *
+ * \param[in] env	LU environment provided by the caller
+ * \param[in] osp	OSP device
+ */
+static void osp_precreate_prefetch_seq(struct lu_env *env,
+				       struct osp_device *osp)
+{
+	u64 seq;
+	int rc;
+
+	if (osp->opd_pre_next_seq != 0)
+		return;
+
+	rc = seq_client_get_seq(env, osp->opd_obd->u.cli.cl_seq, &seq);
+	if (rc != 0) {
+		/* try again at rollover */
+		CDEBUG(D_HA, "%s: cannot allocate next sequence: rc = %d\n",
+		       osp->opd_obd->obd_name, rc);
+		return;
+	}
+
+	CDEBUG(D_HA, "%s: next sequence %#llx after %#llx\n",
+	       osp->opd_obd->obd_name, seq,
+	       fid_seq(&osp->opd_pre_last_created_fid));
+	osp->opd_pre_next_seq = seq;
+}
+
+/**
+ * Compute how many objects to precreate next time
+ *
+ * A new precreate RPC is sent when half of the objects precreated are
+ * left (see osp_precreate_near_empty_nolock()). For the creates not to
+ * wait, that half has to last as long as the RPC takes. The function
+ * estimates the rate at which the objects were used since the last
+ * precreate RPC, and grows opd_pre_create_count to twice the number of
+ * objects used at that rate during the last RPC. It shrinks the count
+ * when the objects are used much slower than that, so that fewer orphans
+ * are left to clean up on recovery. Notice this function relies on an
+ * external locking.
+ *
+ * \param[in] d		OSP device
+ * \param[in] now	time the new precreate RPC is sent
+ */
+static void osp_precreate_adapt_nolock(struct osp_device *d, ktime_t now)
+{
+	s64 elapsed = ktime_us_delta(now, d->opd_pre_send_time);
+	int min = max(d->opd_pre_min_create_count, OST_MIN_PRECREATE);
+	u64 depth;
+
+	if (ktime_to_ns(d->opd_pre_send_time) == 0 || elapsed <= 0 ||
+	    d->opd_pre_rpc_usec <= 0)
+		goto out;
+
+	depth = (u64)d->opd_pre_consumed * d->opd_pre_rpc_usec * 2;
+	do_div(depth, elapsed);
+
+	if (depth > d->opd_pre_create_count && !d->opd_pre_create_slow)
+		d->opd_pre_create_count = min_t(u64, depth,
+					d->opd_pre_max_create_count / 2);
+	else if (depth < d->opd_pre_create_count / 4)
+		d->opd_pre_create_count = max(d->opd_pre_create_count / 2,
+					      min);
+out:
+	d->opd_pre_consumed = 0;
+	d->opd_pre_send_time = now;
+}
+
 /**
  * Find IDs available in current sequence
  *
@@ -615,6 +700,7 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	struct ost_body		*body;
 	int			 rc, grow, diff;
 	struct lu_fid		*fid = &oti->osi_fid;
+	ktime_t			 start;
 	ENTRY;
 
 	/* don't precreate new objects till OST healthy and has free space */
@@ -644,7 +730,9 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 		RETURN(rc);
 	}
 
+	start = ktime_get();
 	spin_lock(&d->opd_pre_lock);
+	osp_precreate_adapt_nolock(d, start);
 	if (d->opd_pre_create_count > d->opd_pre_max_create_count / 2)
 		d->opd_pre_create_count = d->opd_pre_max_create_count / 2;
 	grow = d->opd_pre_create_count;
@@ -681,6 +769,7 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 		GOTO(out_req, rc);
 	}
 	LASSERT(req->rq_transno == 0);
+	d->opd_pre_rpc_usec = ktime_us_delta(ktime_get(), start);
 
 	body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
 	if (body == NULL)
@@ -1315,10 +1404,17 @@ static int osp_precreate_thread(void *_arg)
 
 			/* To avoid handling different seq in precreate/orphan
 			 * cleanup, it will hold precreate until current seq is
-			 * used up. */
+			 * used up. Get the next seq meanwhile. */
 			if (unlikely(osp_precreate_end_seq(&env, d) &&
-			    !osp_create_end_seq(&env, d)))
+			    !osp_create_end_seq(&env, d))) {
+				osp_precreate_prefetch_seq(&env, d);
+				l_wait_event(d->opd_pre_waitq,
+					     !osp_precreate_running(d) ||
+					     osp_create_end_seq(&env, d) ||
+					     osp_statfs_need_update(d) ||
+					     d->opd_got_disconnected, &lwi2);
 				continue;
+			}
 
 			if (unlikely(osp_precreate_end_seq(&env, d) &&
 				     osp_create_end_seq(&env, d))) {
@@ -1596,6 +1692,7 @@ int osp_precreate_get_fid(const struct lu_env *env, struct osp_device *d,
 	d->opd_pre_used_fid.f_oid++;
 	memcpy(fid, &d->opd_pre_used_fid, sizeof(*fid));
 	d->opd_pre_reserved--;
+	d->opd_pre_consumed++;
 	/*
 	 * last_used_id must be changed along with getting new id otherwise
 	 * we might miscalculate gap causing object loss or leak
@@ -1611,6 +1708,9 @@ int osp_precreate_get_fid(const struct lu_env *env, struct osp_device *d,
 	if (unlikely(d->opd_pre_reserved == 0 &&
 		     (d->opd_pre_recovering || d->opd_pre_status)))
 		wake_up(&d->opd_pre_waitq);
+	/* the last id of the sequence is used, time to roll over */
+	else if (unlikely(osp_fid_end_seq(env, fid)))
+		wake_up(&d->opd_pre_waitq);
 
 	return 0;
 }
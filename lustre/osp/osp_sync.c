@@ -74,7 +74,9 @@
  * too much memory -- how to deal with 1000th OSTs ? batching could help?
  *
  * opd_sync_rpcs_in_flight is a number of RPC in flight.
- * we control this with OSP_MAX_RPCS_IN_FLIGHT
+ * we control this with OSP_MAX_RPCS_IN_FLIGHT. if the OST supports
+ * OBD_CONNECT2_BATCH_SYNC, the changes are packed into MDS_BATCH RPCs of up
+ * to cl_batch_max changes each, and the limit is scaled by that.
  */
 
 /* XXX: do math to learn reasonable threshold
@@ -83,6 +85,8 @@
 #define OSP_SYNC_THRESHOLD		10
 #define OSP_MAX_RPCS_IN_FLIGHT		8
 #define OSP_MAX_RPCS_IN_PROGRESS	4096
+/* default max # of changes per MDS_BATCH RPC */
+#define OSP_SYNC_BATCH_MAX		32
 
 #define OSP_JOB_MAGIC		0x26112005
 
@@ -195,6 +199,32 @@ static inline int osp_sync_rpcs_in_progress_low(struct osp_device *d)
 		d->opd_sync_max_rpcs_in_progress;
 }
 
+static inline bool osp_sync_batched(struct osp_device *d)
+{
+	return d->opd_exp != NULL &&
+	       (exp_connect_flags2(d->opd_exp) & OBD_CONNECT2_BATCH_SYNC);
+}
+
+/**
+ * Max number of changes in flight
+ *
+ * The changes are sent to the OST in MDS_BATCH RPCs if it supports that, see
+ * ptlrpc_batch_add(). Then each of the RPCs in flight carries up to
+ * batch_max changes.
+ *
+ * \param[in] d		OSP device
+ *
+ * \retval		max number of changes in flight
+ */
+static inline int osp_sync_max_in_flight(struct osp_device *d)
+{
+	int max = d->opd_sync_max_rpcs_in_flight;
+
+	if (osp_sync_batched(d))
+		max *= max_t(__u32, d->opd_obd->u.cli.cl_batch_max, 1);
+	return max;
+}
+
 /**
  * Check for room in the network pipe to OST
  *
@@ -206,7 +236,7 @@ static inline int osp_sync_rpcs_in_progress_low(struct osp_device *d)
 static inline int osp_sync_rpcs_in_flight_low(struct osp_device *d)
 {
 	return atomic_read(&d->opd_sync_rpcs_in_flight) <
-		d->opd_sync_max_rpcs_in_flight;
+		osp_sync_max_in_flight(d);
 }
 
 /**
@@ -650,7 +680,7 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
 	struct osp_job_req_args *jra;
 
 	LASSERT(atomic_read(&d->opd_sync_rpcs_in_flight) <=
-		d->opd_sync_max_rpcs_in_flight);
+		osp_sync_max_in_flight(d));
 
 	jra = ptlrpc_req_async_args(req);
 	jra->jra_magic = OSP_JOB_MAGIC;
@@ -662,7 +692,10 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
 	list_add_tail(&jra->jra_in_flight_link, &d->opd_sync_in_flight_list);
 	spin_unlock(&d->opd_sync_lock);
 
-	ptlrpcd_add_req(req);
+	if (osp_sync_batched(d))
+		ptlrpc_batch_add(d->opd_exp, req);
+	else
+		ptlrpcd_add_req(req);
 }
 
 
@@ -1504,6 +1537,8 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 
 	d->opd_sync_max_rpcs_in_flight = OSP_MAX_RPCS_IN_FLIGHT;
 	d->opd_sync_max_rpcs_in_progress = OSP_MAX_RPCS_IN_PROGRESS;
+	d->opd_obd->u.cli.cl_batch_max = OSP_SYNC_BATCH_MAX;
+	d->opd_obd->u.cli.cl_batch_maxbuf = OST_BATCH_MAXBUFSIZE;
 	spin_lock_init(&d->opd_sync_lock);
 	init_waitqueue_head(&d->opd_sync_waitq);
 	init_waitqueue_head(&d->opd_sync_barrier_waitq);
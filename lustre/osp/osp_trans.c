@@ -189,6 +189,7 @@ struct osp_update_request *osp_update_request_create(struct dt_device *dt)
 	INIT_LIST_HEAD(&our->our_req_list);
 	INIT_LIST_HEAD(&our->our_cb_items);
 	INIT_LIST_HEAD(&our->our_list);
+	INIT_LIST_HEAD(&our->our_batch_list);
 	INIT_LIST_HEAD(&our->our_invalidate_cb_list);
 	spin_lock_init(&our->our_list_lock);
 
@@ -205,10 +206,18 @@ void osp_update_request_destroy(const struct lu_env *env,
 {
 	struct osp_update_request_sub *ours;
 	struct osp_update_request_sub *tmp;
+	struct osp_update_request *next;
+	struct osp_update_request *tmp2;
 
 	if (our == NULL)
 		return;
 
+	/* release the requests sent along with this one */
+	list_for_each_entry_safe(next, tmp2, &our->our_batch_list, our_list) {
+		list_del_init(&next->our_list);
+		osp_thandle_put(env, next->our_th);
+	}
+
 	list_for_each_entry_safe(ours, tmp, &our->our_req_list, ours_list) {
 		list_del(&ours->ours_list);
 		if (ours->ours_req != NULL)
@@ -587,11 +596,69 @@ static void osp_update_callback_fini(const struct lu_env *env,
 	OBD_FREE_PTR(ouc);
 }
 
+/**
+ * Call the interpreters of the updates of one update request.
+ *
+ * \param[in] env	pointer to the thread context
+ * \param[in] req	pointer to the RPC
+ * \param[in] reply	the update replies, NULL if there is none
+ * \param[in] count	number of updates in \a reply
+ * \param[in] our	the update request
+ * \param[in] index	index of the first update of \a our in \a reply
+ * \param[in] rc	the RPC return value
+ *
+ * \retval		the result of the last update
+ */
+static int osp_update_interpret_one(const struct lu_env *env,
+				    struct ptlrpc_request *req,
+				    struct object_update_reply *reply,
+				    int count, struct osp_update_request *our,
+				    int index, int rc)
+{
+	struct osp_update_callback	*ouc;
+	struct osp_update_callback	*next;
+	int				 rc1 = 0;
+
+	list_for_each_entry_safe(ouc, next, &our->our_cb_items, ouc_list) {
+		list_del_init(&ouc->ouc_list);
+
+		/* The peer may only have handled some requests (indicated
+		 * by the 'count') in the packaged OUT RPC, we can only get
+		 * results for the handled part. */
+		if (index < count && reply->ourp_lens[index] > 0 && rc >= 0) {
+			struct object_update_result *result;
+
+			result = object_update_result_get(reply, index, NULL);
+			if (result == NULL)
+				rc1 = rc = -EPROTO;
+			else
+				rc1 = rc = result->our_rc;
+		} else if (rc1 >= 0) {
+			/* The peer did not handle these request, let's return
+			 * -EINVAL to update interpret for now */
+			if (rc >= 0)
+				rc1 = -EINVAL;
+			else
+				rc1 = rc;
+		}
+
+		if (ouc->ouc_interpreter != NULL)
+			ouc->ouc_interpreter(env, reply, req, ouc->ouc_obj,
+					     ouc->ouc_data, index, rc1);
+
+		osp_update_callback_fini(env, ouc);
+		index++;
+	}
+
+	return rc;
+}
+
 /**
  * Interpret the packaged OUT RPC results.
  *
  * For every packaged sub-request, call its registered interpreter function.
- * Then destroy the sub-request.
+ * Then destroy the sub-request. The update requests sent along with \a our
+ * get their results the same way, and their transactions are stopped too.
  *
  * \param[in] env	pointer to the thread context
  * \param[in] req	pointer to the RPC
@@ -607,12 +674,11 @@ static int osp_update_interpret(const struct lu_env *env,
 	struct object_update_reply	*reply	= NULL;
 	struct osp_update_args		*oaua	= arg;
 	struct osp_update_request	*our = oaua->oaua_update;
+	struct osp_update_request	*batched;
 	struct osp_thandle		*oth;
-	struct osp_update_callback	*ouc;
-	struct osp_update_callback	*next;
 	int				 count	= 0;
-	int				 index  = 0;
-	int				 rc1	= 0;
+	int				 index;
+	int				 rc1;
 
 	ENTRY;
 
@@ -653,36 +719,19 @@ static int osp_update_interpret(const struct lu_env *env,
 		}
 	}
 
-	list_for_each_entry_safe(ouc, next, &our->our_cb_items, ouc_list) {
-		list_del_init(&ouc->ouc_list);
-
-		/* The peer may only have handled some requests (indicated
-		 * by the 'count') in the packaged OUT RPC, we can only get
-		 * results for the handled part. */
-		if (index < count && reply->ourp_lens[index] > 0 && rc >= 0) {
-			struct object_update_result *result;
-
-			result = object_update_result_get(reply, index, NULL);
-			if (result == NULL)
-				rc1 = rc = -EPROTO;
-			else
-				rc1 = rc = result->our_rc;
-		} else if (rc1 >= 0) {
-			/* The peer did not handle these request, let's return
-			 * -EINVAL to update interpret for now */
-			if (rc >= 0)
-				rc1 = -EINVAL;
-			else
-				rc1 = rc;
-		}
-
-		if (ouc->ouc_interpreter != NULL)
-			ouc->ouc_interpreter(env, reply, req, ouc->ouc_obj,
-					     ouc->ouc_data, index, rc1);
-
-		osp_update_callback_fini(env, ouc);
-		index++;
+	rc1 = osp_update_interpret_one(env, req, reply, count, our, 0, rc);
+
+	/* the updates of the batched requests follow the ones of \a our,
+	 * each of them is stopped with its own result */
+	index = our->our_update_nr;
+	list_for_each_entry(batched, &our->our_batch_list, our_list) {
+		osp_trans_stop_cb(env, batched->our_th,
+				  osp_update_interpret_one(env, req, reply,
+							   count, batched,
+							   index, rc));
+		index += batched->our_update_nr;
 	}
+	rc = rc1;
 
 	if (oaua->oaua_count != NULL && atomic_dec_and_test(oaua->oaua_count))
 		wake_up_all(oaua->oaua_waitq);
@@ -1046,6 +1095,13 @@ static void osp_request_commit_cb(struct ptlrpc_request *req)
 		result = 1;
 
 	osp_trans_commit_cb(oth, result);
+	if (oth->ot_our != NULL) {
+		struct osp_update_request *batched;
+
+		list_for_each_entry(batched, &oth->ot_our->our_batch_list,
+				    our_list)
+			osp_trans_commit_cb(batched->our_th, result);
+	}
 	req->rq_committed = 1;
 	osp_thandle_put(NULL, oth);
 	EXIT;
@@ -1084,6 +1140,28 @@ void osp_trans_callback(const struct lu_env *env,
 	osp_trans_commit_cb(oth, rc);
 }
 
+/**
+ * callback of the osp transactions batched with \a oth
+ *
+ * The same as osp_trans_callback() for the update requests sent in the
+ * same RPC as the one of \a oth, see osp_batch_update_request().
+ *
+ * \param [in] env	execution environment
+ * \param [in] oth	osp thandle
+ * \param [in] rc	result of the osp thandles
+ */
+static void osp_trans_batch_callback(const struct lu_env *env,
+				     struct osp_thandle *oth, int rc)
+{
+	struct osp_update_request *batched;
+
+	if (oth->ot_our == NULL)
+		return;
+
+	list_for_each_entry(batched, &oth->ot_our->our_batch_list, our_list)
+		osp_trans_callback(env, batched->our_th, rc);
+}
+
 /**
  * Send the request for remote updates.
  *
@@ -1115,6 +1193,7 @@ static int osp_send_update_req(const struct lu_env *env,
 				 our, &req);
 	if (rc != 0) {
 		osp_trans_callback(env, oth, rc);
+		osp_trans_batch_callback(env, oth, rc);
 		RETURN(rc);
 	}
 
@@ -1188,6 +1267,7 @@ static int osp_send_update_req(const struct lu_env *env,
 			req->rq_cb_data = NULL;
 			rc = rc == 0 ? req->rq_status : rc;
 			osp_trans_callback(env, oth, rc);
+			osp_trans_batch_callback(env, oth, rc);
 			osp_thandle_put(env, oth);
 			GOTO(out, rc);
 		}
@@ -1340,6 +1420,81 @@ osp_get_next_request(struct osp_updates *ou, struct osp_update_request **ourp)
 	return got_req;
 }
 
+/**
+ * Batch the update requests following \a our in the sending list
+ *
+ * The update requests ready to be sent right after \a our, by version
+ * number, are moved to our::our_batch_list and their updates are appended
+ * to the ones of \a our, so that they all go to the remote MDT in the same
+ * OUT RPC. They have the same batchid, so the remote MDT executes them in
+ * a single transaction and writes their update logs at once, instead of
+ * one RPC and one transaction for each of the distributed transactions.
+ *
+ * The reference the sending thread holds on each of the batched requests
+ * is put when \a our is destroyed.
+ *
+ * \param [in] ou	osp update structure.
+ * \param [in] our	the update request being sent.
+ *
+ * \retval		number of the update requests batched with \a our.
+ */
+static int osp_batch_update_request(struct osp_updates *ou,
+				    struct osp_update_request *our)
+{
+	struct osp_update_request	*next;
+	struct osp_update_request	*tmp;
+	struct osp_update_request_sub	*ours;
+	__u64				 version = our->our_version;
+	size_t				 size = 0;
+	size_t				 next_size;
+	int				 count = 0;
+
+	list_for_each_entry(ours, &our->our_req_list, ours_list) {
+		size += ours->ours_req_size;
+		count++;
+	}
+
+	spin_lock(&ou->ou_lock);
+	list_for_each_entry_safe(next, tmp, &ou->ou_list, our_list) {
+		if (our->our_batch_nr >= OSP_UPDATE_BATCH_MAX - 1)
+			break;
+
+		next_size = 0;
+		list_for_each_entry(ours, &next->our_req_list, ours_list) {
+			next_size += ours->ours_req_size;
+			count++;
+		}
+
+		/* the bulk of the OUT RPC is a single MD, see
+		 * osp_prep_update_req() */
+		if (size + next_size > MD_MAX_BRW_SIZE || count > LNET_MAX_IOV)
+			break;
+
+		spin_lock(&next->our_list_lock);
+		if (next->our_version != version + 1 || !next->our_req_ready ||
+		    next->our_generation != our->our_generation ||
+		    next->our_flags != our->our_flags ||
+		    next->our_th->ot_super.th_result != 0) {
+			spin_unlock(&next->our_list_lock);
+			break;
+		}
+		list_move_tail(&next->our_list, &our->our_batch_list);
+		spin_unlock(&next->our_list_lock);
+
+		list_splice_tail_init(&next->our_req_list, &our->our_req_list);
+		our->our_batch_nr++;
+		size += next_size;
+		version++;
+	}
+	spin_unlock(&ou->ou_lock);
+
+	if (our->our_batch_nr > 0)
+		CDEBUG(D_HA, "ou %p batch %d requests after version %llu\n",
+		       ou, our->our_batch_nr, our->our_version);
+
+	return our->our_batch_nr;
+}
+
 /**
  * Invalidate update request
  *
@@ -1421,6 +1576,8 @@ void osp_invalidate_request(struct osp_device *osp)
  * Create thread to send update request to other MDTs, this thread will pull
  * out update request from the list in OSP by version number, i.e. it will
  * make sure the update request with lower version number will be sent first.
+ * The requests ready to be sent after it are sent in the same RPC, see
+ * osp_batch_update_request().
  *
  * \param[in] arg	hold the OSP device.
  *
@@ -1436,6 +1593,7 @@ int osp_send_update_thread(void *arg)
 	struct osp_updates	*ou = osp->opd_update;
 	struct ptlrpc_thread	*thread = &osp->opd_update_thread;
 	struct osp_update_request *our = NULL;
+	int			batched;
 	int			rc;
 	ENTRY;
 
@@ -1464,6 +1622,7 @@ int osp_send_update_thread(void *arg)
 		}
 
 		LASSERT(our->our_th != NULL);
+		batched = 0;
 		if (our->our_th->ot_super.th_result != 0) {
 			osp_trans_callback(&env, our->our_th,
 				our->our_th->ot_super.th_result);
@@ -1473,13 +1632,14 @@ int osp_send_update_thread(void *arg)
 			rc = -EIO;
 			osp_trans_callback(&env, our->our_th, rc);
 		} else {
+			batched = osp_batch_update_request(ou, our);
 			rc = osp_send_update_req(&env, osp, our);
 		}
 
 		/* Update the rpc version */
 		spin_lock(&ou->ou_lock);
 		if (our->our_version == ou->ou_rpc_version)
-			ou->ou_rpc_version++;
+			ou->ou_rpc_version += batched + 1;
 		spin_unlock(&ou->ou_lock);
 
 		/* If one update request fails, let's fail all of the requests
@@ -0,0 +1,491 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/ptlrpc/batch.c
+ *
+ * Batched RPCs: several small requests to the same target packed into one
+ * MDS_BATCH RPC, handled by a single service thread and answered by a single
+ * reply.
+ *
+ * On the client, the requests only have to be packed as usual. They are given
+ * their own replies and interpreted as if they had been sent alone. On the
+ * server, a request is built for each sub-request so that it can be run
+ * through the regular handler of its opcode.
+ *
+ * ptlrpc_batch_add() sends a request at once when no batch is in flight to
+ * the target. Otherwise it waits for the batch in flight to complete, with
+ * the other requests issued in the meantime, unless there are enough of them
+ * to fill a batch. So a single request is never delayed, and a stream of
+ * requests gets batched as long as it is issued faster than the target
+ * replies.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lustre_req_layout.h>
+#include "ptlrpc_internal.h"
+
+struct ptlrpc_batch_args {
+	struct list_head	  ba_reqs;
+	int			  ba_count;
+	void			(*ba_done)(void *data);
+	void			 *ba_data;
+};
+
+/*
+ * Keep sub-request \a req for replay if it changed something which is not
+ * committed yet, or run its commit callback, as after_reply() does. Only the
+ * changes an MDT sends to an OST are batched, see tgt_batch_sub_allowed().
+ */
+static void ptlrpc_batch_sub_retain(struct ptlrpc_request *req)
+{
+	struct obd_import *imp = req->rq_import;
+
+	req->rq_transno = lustre_msg_get_transno(req->rq_repmsg);
+	lustre_msg_set_transno(req->rq_reqmsg, req->rq_transno);
+	if (!imp->imp_replayable)
+		return;
+
+	spin_lock(&imp->imp_lock);
+	list_del_init(&req->rq_unreplied_list);
+	if (req->rq_transno != 0 &&
+	    req->rq_transno > imp->imp_peer_committed_transno) {
+		ptlrpc_save_versions(req);
+		ptlrpc_retain_replayable_request(req, imp);
+	} else if (req->rq_commit_cb != NULL &&
+		   list_empty(&req->rq_replay_list)) {
+		spin_unlock(&imp->imp_lock);
+		req->rq_commit_cb(req);
+		return;
+	}
+	spin_unlock(&imp->imp_lock);
+}
+
+/* Interpret sub-request \a req as ptlrpc_check_set() would, and drop it. */
+static void ptlrpc_batch_sub_interpret(const struct lu_env *env,
+				       struct ptlrpc_request *req, int rc)
+{
+	struct ptlrpc_cli_req *cr = &req->rq_cli;
+
+	req->rq_status = rc;
+	if (cr->cr_reply_interp != NULL)
+		req->rq_status = cr->cr_reply_interp(env, req,
+						     &cr->cr_async_args, rc);
+	ptlrpc_req_finished(req);
+}
+
+/*
+ * Give \a req a copy of the reply found at \a *bufp in the \a *lenp bytes left
+ * in the batch reply, and move past it.
+ *
+ * \retval 0 or the status of the reply, which went to \a *statusp
+ * \retval negative if the batch reply is malformed and cannot be parsed further
+ */
+static int ptlrpc_batch_sub_unpack(struct ptlrpc_request *req, char **bufp,
+				   int *lenp, int *statusp)
+{
+	struct lustre_msg *msg = (struct lustre_msg *)*bufp;
+	int swabbed;
+	int size;
+	int rc;
+
+	swabbed = __lustre_unpack_msg(msg, *lenp);
+	if (swabbed < 0)
+		return swabbed;
+
+	size = lustre_packed_msg_size(msg);
+	if (size == 0 || size > *lenp)
+		return -EPROTO;
+	*bufp += cfs_size_round(size);
+	*lenp -= min_t(int, cfs_size_round(size), *lenp);
+
+	rc = sptlrpc_cli_alloc_repbuf(req, size);
+	if (rc) {
+		*statusp = rc;
+		return 0;
+	}
+
+	memcpy(req->rq_repbuf, msg, size);
+	req->rq_repdata = (struct lustre_msg *)req->rq_repbuf;
+	req->rq_repdata_len = size;
+	req->rq_repmsg = req->rq_repdata;
+	req->rq_replen = size;
+	req->rq_nob_received = size;
+	if (swabbed)
+		lustre_set_rep_swabbed(req, MSG_PTLRPC_HEADER_OFF);
+
+	rc = lustre_unpack_rep_ptlrpc_body(req, MSG_PTLRPC_BODY_OFF);
+	if (rc) {
+		*statusp = rc;
+		return 0;
+	}
+
+	/* same as ptlrpc_check_status(), without failing the import */
+	rc = lustre_msg_get_status(req->rq_repmsg);
+	if (lustre_msg_get_type(req->rq_repmsg) == PTL_RPC_MSG_ERR && rc >= 0)
+		rc = -EINVAL;
+	*statusp = rc;
+
+	ptlrpc_batch_sub_retain(req);
+	return 0;
+}
+
+static int ptlrpc_batch_interpret(const struct lu_env *env,
+				  struct ptlrpc_request *batch, void *args,
+				  int rc)
+{
+	struct ptlrpc_batch_args *ba = args;
+	struct ptlrpc_request *req;
+	struct batch_body *bb;
+	char *buf = NULL;
+	int count = 0;
+	int len = 0;
+	int status;
+	int err;
+	int i = 0;
+
+	if (rc == 0) {
+		bb = req_capsule_server_get(&batch->rq_pill, &RMF_BATCH_BODY);
+		buf = req_capsule_server_get(&batch->rq_pill, &RMF_BATCH_BUF);
+		len = req_capsule_get_size(&batch->rq_pill, &RMF_BATCH_BUF,
+					   RCL_SERVER);
+		if (bb == NULL || buf == NULL || bb->bb_magic != BATCH_MAGIC ||
+		    bb->bb_count > ba->ba_count) {
+			DEBUG_REQ(D_ERROR, batch, "malformed batch reply");
+			rc = -EPROTO;
+		} else {
+			count = bb->bb_count;
+		}
+	}
+
+	while (!list_empty(&ba->ba_reqs)) {
+		req = list_entry(ba->ba_reqs.next, struct ptlrpc_request,
+				 rq_cli.cr_set_chain);
+		list_del_init(&req->rq_cli.cr_set_chain);
+
+		if (i < count) {
+			err = ptlrpc_batch_sub_unpack(req, &buf, &len, &status);
+			if (err) {
+				/* the next ones were handled too, fail them */
+				DEBUG_REQ(D_ERROR, batch,
+					  "malformed reply %d in batch: rc = %d",
+					  i, err);
+				count = i;
+				rc = status = err;
+			}
+			ptlrpc_batch_sub_interpret(env, req, status);
+		} else if (rc == 0 || rc == -ENOTSUPP || rc == -EOPNOTSUPP) {
+			/* not handled by the server, send it alone instead */
+			ptlrpcd_add_req(req);
+		} else {
+			ptlrpc_batch_sub_interpret(env, req, rc);
+		}
+		i++;
+	}
+
+	if (ba->ba_done != NULL)
+		ba->ba_done(ba->ba_data);
+	return rc;
+}
+
+/**
+ * Pack the requests linked by their rq_set_chain on \a reqs into a new
+ * MDS_BATCH request to \a imp, which takes them over once it is sent.
+ *
+ * When the batch gets its reply, each request is given its own reply and
+ * interpreted as if it had been sent alone, then released. The requests the
+ * server did not get to are sent alone. \a done is called with \a data
+ * after that, if not NULL.
+ */
+struct ptlrpc_request *ptlrpc_batch_prep(struct obd_import *imp,
+					 struct list_head *reqs,
+					 void (*done)(void *), void *data)
+{
+	struct ptlrpc_batch_args *ba;
+	struct ptlrpc_request *batch;
+	struct ptlrpc_request *req;
+	struct batch_body *bb;
+	__u32 reqlen = 0;
+	__u32 replen = 0;
+	int count = 0;
+	char *buf;
+	int rc;
+	ENTRY;
+
+	list_for_each_entry(req, reqs, rq_cli.cr_set_chain) {
+		reqlen += cfs_size_round(req->rq_reqlen);
+		replen += cfs_size_round(req->rq_replen);
+		count++;
+	}
+	if (count == 0 || count > MDS_BATCH_MAXCOUNT ||
+	    reqlen > imp->imp_obd->u.cli.cl_batch_maxbuf)
+		RETURN(ERR_PTR(-EINVAL));
+
+	batch = ptlrpc_request_alloc(imp, &RQF_MDS_BATCH);
+	if (batch == NULL)
+		RETURN(ERR_PTR(-ENOMEM));
+
+	req_capsule_set_size(&batch->rq_pill, &RMF_BATCH_BUF, RCL_CLIENT,
+			     reqlen);
+	rc = ptlrpc_request_pack(batch, LUSTRE_MDS_VERSION, MDS_BATCH);
+	if (rc) {
+		ptlrpc_request_free(batch);
+		RETURN(ERR_PTR(rc));
+	}
+
+	bb = req_capsule_client_get(&batch->rq_pill, &RMF_BATCH_BODY);
+	bb->bb_magic = BATCH_MAGIC;
+	bb->bb_count = count;
+
+	buf = req_capsule_client_get(&batch->rq_pill, &RMF_BATCH_BUF);
+	list_for_each_entry(req, reqs, rq_cli.cr_set_chain) {
+		memcpy(buf, req->rq_reqmsg, req->rq_reqlen);
+		buf += cfs_size_round(req->rq_reqlen);
+	}
+
+	/* a larger reply gets the batch resent with a large enough buffer */
+	req_capsule_set_size(&batch->rq_pill, &RMF_BATCH_BUF, RCL_SERVER,
+			     min_t(__u32, replen,
+				   imp->imp_obd->u.cli.cl_batch_maxbuf));
+	ptlrpc_request_set_replen(batch);
+
+	CLASSERT(sizeof(*ba) <= sizeof(batch->rq_async_args));
+	ba = ptlrpc_req_async_args(batch);
+	INIT_LIST_HEAD(&ba->ba_reqs);
+	list_splice_init(reqs, &ba->ba_reqs);
+	ba->ba_count = count;
+	ba->ba_done = done;
+	ba->ba_data = data;
+	batch->rq_interpret_reply = ptlrpc_batch_interpret;
+
+	RETURN(batch);
+}
+EXPORT_SYMBOL(ptlrpc_batch_prep);
+
+/**
+ * Build the request to handle the sub-request \a msg of \a batch, which
+ * is at most \a len bytes, in the context of \a batch. The size of the
+ * sub-request is in rq_reqlen of the returned request.
+ */
+struct ptlrpc_request *ptlrpc_batch_sub_init(struct ptlrpc_request *batch,
+					     struct lustre_msg *msg, int len)
+{
+	struct ptlrpc_srv_req *bsr = &batch->rq_srv;
+	struct ptlrpc_request *req;
+	int rc;
+	ENTRY;
+
+	req = ptlrpc_request_cache_alloc(GFP_NOFS);
+	if (req == NULL)
+		RETURN(ERR_PTR(-ENOMEM));
+
+	ptlrpc_srv_req_init(req);
+	req->rq_reqmsg = msg;
+	rc = ptlrpc_unpack_req_msg(req, len);
+	if (rc == 0)
+		rc = lustre_unpack_req_ptlrpc_body(req, MSG_PTLRPC_BODY_OFF);
+	if (rc) {
+		ptlrpc_request_cache_free(req);
+		RETURN(ERR_PTR(rc));
+	}
+	req->rq_reqlen = lustre_packed_msg_size(msg);
+
+	/* the batch is resent as a whole, so are its sub-requests */
+	if (lustre_msg_get_flags(batch->rq_reqmsg) & MSG_RESENT)
+		lustre_msg_add_flags(msg, MSG_RESENT);
+
+	req->rq_export = class_export_get(batch->rq_export);
+	req->rq_xid = batch->rq_xid;
+	req->rq_peer = batch->rq_peer;
+	req->rq_self = batch->rq_self;
+	req->rq_source = batch->rq_source;
+	req->rq_phase = batch->rq_phase;
+	req->rq_timeout = batch->rq_timeout;
+	req->rq_deadline = batch->rq_deadline;
+
+	req->rq_srv.sr_svc_thread = bsr->sr_svc_thread;
+	req->rq_srv.sr_rqbd = bsr->sr_rqbd;
+	req->rq_srv.sr_arrival_time = bsr->sr_arrival_time;
+	req->rq_srv.sr_auth_uid = bsr->sr_auth_uid;
+	req->rq_srv.sr_auth_mapped_uid = bsr->sr_auth_mapped_uid;
+	req->rq_srv.sr_sp_from = bsr->sr_sp_from;
+	req->rq_srv.sr_user_desc = bsr->sr_user_desc;
+	req->rq_srv.sr_svc_ctx = bsr->sr_svc_ctx;
+	sptlrpc_svc_ctx_addref(req);
+
+	req->rq_flvr = batch->rq_flvr;
+	req->rq_auth_gss = batch->rq_auth_gss;
+	req->rq_auth_usr_root = batch->rq_auth_usr_root;
+	req->rq_auth_usr_mdt = batch->rq_auth_usr_mdt;
+	req->rq_auth_usr_ost = batch->rq_auth_usr_ost;
+	req->rq_pack_udesc = batch->rq_pack_udesc;
+
+	RETURN(req);
+}
+EXPORT_SYMBOL(ptlrpc_batch_sub_init);
+
+/**
+ * Complete the reply of sub-request \a req as target_send_reply() would, with
+ * an error reply for \a rc if not zero, packing a reply if the handler did not
+ * pack any. The reply message is then in rq_repmsg, and is rq_replen bytes.
+ */
+int ptlrpc_batch_sub_reply(struct ptlrpc_request *req, int rc)
+{
+	if (req->rq_reply_state == NULL) {
+		int rc2 = lustre_pack_reply(req, 1, NULL, NULL);
+
+		if (rc2)
+			return rc2;
+	}
+
+	if (rc) {
+		req->rq_status = rc;
+		ptlrpc_error_set_type(req);
+	}
+
+	if (req->rq_type != PTL_RPC_MSG_ERR)
+		req->rq_type = PTL_RPC_MSG_REPLY;
+
+	lustre_msg_set_type(req->rq_repmsg, req->rq_type);
+	lustre_msg_set_status(req->rq_repmsg,
+			      ptlrpc_status_hton(req->rq_status));
+	lustre_msg_set_opc(req->rq_repmsg, lustre_msg_get_opc(req->rq_reqmsg));
+	return 0;
+}
+EXPORT_SYMBOL(ptlrpc_batch_sub_reply);
+
+/**
+ * Release sub-request \a req, once its reply has been copied.
+ */
+void ptlrpc_batch_sub_fini(struct ptlrpc_request *req)
+{
+	if (req->rq_reply_state != NULL)
+		ptlrpc_req_drop_rs(req);
+	sptlrpc_svc_ctx_decref(req);
+	class_export_put(req->rq_export);
+	req->rq_export = NULL;
+	ptlrpc_request_cache_free(req);
+}
+EXPORT_SYMBOL(ptlrpc_batch_sub_fini);
+
+/* Must be called with cl_batch_lock held */
+static void ptlrpc_batch_take(struct client_obd *cli, struct list_head *reqs)
+{
+	list_splice_init(&cli->cl_batch_list, reqs);
+	cli->cl_batch_count = 0;
+	cli->cl_batch_reqlen = 0;
+	cli->cl_batch_replen = 0;
+	cli->cl_batch_inflight++;
+}
+
+static void ptlrpc_batch_send(struct client_obd *cli, struct list_head *reqs);
+
+static void ptlrpc_batch_done(void *data)
+{
+	struct client_obd *cli = data;
+	struct list_head reqs;
+
+	INIT_LIST_HEAD(&reqs);
+	spin_lock(&cli->cl_batch_lock);
+	LASSERT(cli->cl_batch_inflight > 0);
+	cli->cl_batch_inflight--;
+	if (cli->cl_batch_count > 0)
+		ptlrpc_batch_take(cli, &reqs);
+	spin_unlock(&cli->cl_batch_lock);
+
+	ptlrpc_batch_send(cli, &reqs);
+}
+
+static void ptlrpc_batch_send(struct client_obd *cli, struct list_head *reqs)
+{
+	struct ptlrpc_request *batch;
+	struct ptlrpc_request *req;
+	struct ptlrpc_request *tmp;
+
+	if (list_empty(reqs))
+		return;
+
+	batch = ptlrpc_batch_prep(cli->cl_import, reqs, ptlrpc_batch_done, cli);
+	if (!IS_ERR(batch)) {
+		ptlrpcd_add_req(batch);
+		return;
+	}
+
+	CDEBUG(D_RPCTRACE, "%s: cannot batch requests, send them alone: "
+	       "rc = %ld\n", cli->cl_import->imp_obd->obd_name,
+	       PTR_ERR(batch));
+	list_for_each_entry_safe(req, tmp, reqs, rq_cli.cr_set_chain) {
+		list_del_init(&req->rq_cli.cr_set_chain);
+		ptlrpcd_add_req(req);
+	}
+	ptlrpc_batch_done(cli);
+}
+
+/**
+ * Send request \a req to the target of \a exp, in a MDS_BATCH RPC with other
+ * requests if the target supports it. \a req must not modify anything on the
+ * target, only getattr and lookup intents and glimpses are handled in
+ * batches, see tgt_batch_sub_allowed(). The exception are the OSP changes to
+ * an OST with OBD_CONNECT2_BATCH_SYNC.
+ */
+void ptlrpc_batch_add(struct obd_export *exp, struct ptlrpc_request *req)
+{
+	struct client_obd *cli = &exp->exp_obd->u.cli;
+	__u32 reqlen = cfs_size_round(req->rq_reqlen);
+	__u32 replen = cfs_size_round(req->rq_replen);
+	struct list_head full;
+	struct list_head reqs;
+
+	if (!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_RPC) ||
+	    cli->cl_batch_max <= 1 || reqlen > cli->cl_batch_maxbuf) {
+		ptlrpcd_add_req(req);
+		return;
+	}
+
+	INIT_LIST_HEAD(&full);
+	INIT_LIST_HEAD(&reqs);
+	spin_lock(&cli->cl_batch_lock);
+	/* @req does not fit in the pending batch, send that one first */
+	if (cli->cl_batch_count > 0 &&
+	    (cli->cl_batch_reqlen + reqlen > cli->cl_batch_maxbuf ||
+	     cli->cl_batch_replen + replen > cli->cl_batch_maxbuf))
+		ptlrpc_batch_take(cli, &full);
+
+	list_add_tail(&req->rq_cli.cr_set_chain, &cli->cl_batch_list);
+	cli->cl_batch_count++;
+	cli->cl_batch_reqlen += reqlen;
+	cli->cl_batch_replen += replen;
+
+	if (cli->cl_batch_inflight == 0 ||
+	    cli->cl_batch_count >= cli->cl_batch_max)
+		ptlrpc_batch_take(cli, &reqs);
+	spin_unlock(&cli->cl_batch_lock);
+
+	ptlrpc_batch_send(cli, &full);
+	ptlrpc_batch_send(cli, &reqs);
+}
+EXPORT_SYMBOL(ptlrpc_batch_add);
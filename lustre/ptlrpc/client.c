@@ -485,6 +485,7 @@ __must_hold(&req->rq_lock)
 	 * sent time */
 	req->rq_deadline = req->rq_sent + req->rq_timeout +
 			   ptlrpc_at_get_net_latency(req);
+	ptlrpc_req_arm_timer(req, req->rq_deadline);
 
 	DEBUG_REQ(D_ADAPTTO, req,
 		  "Early reply #%d, new deadline in %llds (%llds)",
@@ -496,17 +497,29 @@ __must_hold(&req->rq_lock)
 }
 
 static struct kmem_cache *request_cache;
+static struct cfs_mag_cache *request_mag;
 
 int ptlrpc_request_cache_init(void)
 {
 	request_cache = kmem_cache_create("ptlrpc_cache",
 					  sizeof(struct ptlrpc_request),
 					  0, SLAB_HWCACHE_ALIGN, NULL);
-	return request_cache == NULL ? -ENOMEM : 0;
+	if (request_cache == NULL)
+		return -ENOMEM;
+
+	request_mag = cfs_mag_cache_create("ptlrpc_cache", request_cache,
+					   cfs_cpt_table,
+					   sizeof(struct ptlrpc_request));
+	if (request_mag == NULL) {
+		kmem_cache_destroy(request_cache);
+		return -ENOMEM;
+	}
+	return 0;
 }
 
 void ptlrpc_request_cache_fini(void)
 {
+	cfs_mag_cache_destroy(request_mag);
 	kmem_cache_destroy(request_cache);
 }
 
@@ -514,13 +527,13 @@ struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags)
 {
 	struct ptlrpc_request *req;
 
-	OBD_SLAB_ALLOC_PTR_GFP(req, request_cache, flags);
+	OBD_MAG_ALLOC_PTR_GFP(req, request_mag, flags);
 	return req;
 }
 
 void ptlrpc_request_cache_free(struct ptlrpc_request *req)
 {
-	OBD_SLAB_FREE_PTR(req, request_cache);
+	OBD_MAG_FREE_PTR(req, request_mag);
 }
 
 /**
@@ -1014,7 +1027,10 @@ struct ptlrpc_request_set *ptlrpc_prep_set(void)
 		RETURN(NULL);
 	atomic_set(&set->set_refcount, 1);
 	INIT_LIST_HEAD(&set->set_requests);
+	spin_lock_init(&set->set_ready_lock);
+	INIT_LIST_HEAD(&set->set_ready_requests);
 	init_waitqueue_head(&set->set_waitq);
+	atomic_set(&set->set_events, 0);
 	atomic_set(&set->set_new_count, 0);
 	atomic_set(&set->set_remaining, 0);
 	spin_lock_init(&set->set_new_req_lock);
@@ -1090,6 +1106,7 @@ void ptlrpc_set_destroy(struct ptlrpc_request_set *set)
 			list_entry(tmp, struct ptlrpc_request,
 				   rq_set_chain);
 		list_del_init(&req->rq_set_chain);
+		ptlrpc_set_unready(set, req);
 
 		LASSERT(req->rq_phase == expected_phase);
 
@@ -1166,6 +1183,8 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 	count = atomic_inc_return(&set->set_new_count);
 	spin_unlock(&set->set_new_req_lock);
 
+	ptlrpcd_wake_peer(pc, count - 1, count);
+
 	/* Only need to call wakeup once for the first entry. */
 	if (count == 1) {
 		wake_up(&set->set_waitq);
@@ -1330,7 +1349,7 @@ static int ptlrpc_check_status(struct ptlrpc_request *req)
  * Versions are obtained from server reply.
  * used for VBR.
  */
-static void ptlrpc_save_versions(struct ptlrpc_request *req)
+void ptlrpc_save_versions(struct ptlrpc_request *req)
 {
         struct lustre_msg *repmsg = req->rq_repmsg;
         struct lustre_msg *reqmsg = req->rq_reqmsg;
@@ -1467,6 +1486,12 @@ static int after_reply(struct ptlrpc_request *req)
 		ptlrpc_lprocfs_rpc_sent(req, timediff);
 	}
 
+	if (unlikely(ptlrpc_req_traced(req)))
+		DEBUG_REQ(D_RPCTRACE, req,
+			  "trace: reply after %lldus, service %us",
+			  timediff,
+			  lustre_msg_get_service_time(req->rq_repmsg));
+
         if (lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_REPLY &&
             lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_ERR) {
                 DEBUG_REQ(D_ERROR, req, "invalid packet received (type=%u)",
@@ -1710,18 +1735,117 @@ static inline int ptlrpc_set_producer(struct ptlrpc_request_set *set)
 	RETURN((atomic_read(&set->set_remaining) - remaining));
 }
 
+/* Let the set of \a req check it when its timer expires. */
+void ptlrpc_req_timer_fn(struct ptlrpc_timer *t)
+{
+	ptlrpc_client_wake_req(container_of(t, struct ptlrpc_request,
+					    rq_cli.cr_timer));
+}
+
 /**
- * this sends any unsent RPCs in \a set and returns 1 if all are sent
- * and no more replies are expected.
- * (it is possible to get less replies than requests sent e.g. due to timed out
- * requests or requests that we had trouble to send out)
- *
- * NOTE: This function contains a potential schedule point (cond_resched()).
+ * Arm the timer of \a req for \a deadline, in seconds. A deadline which has
+ * already passed is checked again one second later.
  */
-int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
+void ptlrpc_req_arm_timer(struct ptlrpc_request *req, time64_t deadline)
+{
+	s64 delay = deadline * NSEC_PER_SEC - ktime_to_ns(ktime_get_real());
+
+	if (delay <= 0)
+		delay = NSEC_PER_SEC;
+	ptlrpc_timer_arm(&req->rq_cli.cr_timer,
+			 jiffies + nsecs_to_jiffies(delay) + 1);
+}
+
+/* Return true if \a req is in flight and its deadline passed */
+static bool ptlrpc_req_expired(struct ptlrpc_request *req, time64_t now)
 {
-	struct list_head *tmp, *next;
+	/* don't expire request waiting for context */
+	if (req->rq_wait_ctx)
+		return false;
+
+	/* Request in-flight? */
+	if (!((req->rq_phase == RQ_PHASE_RPC &&
+	       !req->rq_waiting && !req->rq_resend) ||
+	      (req->rq_phase == RQ_PHASE_BULK)))
+		return false;
+
+	/* already dealt with, or not expired */
+	return !req->rq_timedout && req->rq_deadline <= now;
+}
+
+/*
+ * Expire \a req if its deadline passed, otherwise make sure its timer is
+ * armed for its next deadline, if it has one. That is either the time to
+ * send it for a delayed (re)send, or its deadline if it is in flight.
+ */
+static void ptlrpc_req_check_timer(struct ptlrpc_request *req, time64_t now)
+{
+	time64_t deadline;
+
+	if (ptlrpc_req_expired(req, now)) {
+		/* Deal with this guy. Do it asynchronously to not block
+		 * ptlrpcd thread. */
+		ptlrpc_expire_one_request(req, 1);
+		return;
+	}
+
+	if (ptlrpc_timer_armed(&req->rq_cli.cr_timer) ||
+	    req->rq_timedout || req->rq_wait_ctx)
+		return;
+
+	if (req->rq_phase == RQ_PHASE_NEW && req->rq_sent)
+		deadline = req->rq_sent;
+	else if (req->rq_phase == RQ_PHASE_RPC && !req->rq_waiting)
+		deadline = req->rq_resend ? req->rq_sent : req->rq_deadline;
+	else if (req->rq_phase == RQ_PHASE_BULK)
+		deadline = req->rq_deadline;
+	else
+		return;
+
+	ptlrpc_req_arm_timer(req, deadline);
+}
+
+/*
+ * Return the next request for __ptlrpc_check_set() to check: the next one of
+ * \a set after \a next for a full scan, the next one of \a ready otherwise.
+ */
+static struct ptlrpc_request *
+ptlrpc_check_set_next(struct ptlrpc_request_set *set, struct list_head *ready,
+		      struct list_head **next)
+{
+	struct ptlrpc_request *req = NULL;
+
+	if (ready == NULL) {
+		if (*next != &set->set_requests) {
+			req = list_entry(*next, struct ptlrpc_request,
+					 rq_set_chain);
+			*next = (*next)->next;
+		}
+		return req;
+	}
+
+	spin_lock_bh(&set->set_ready_lock);
+	if (!list_empty(ready)) {
+		req = list_entry(ready->next, struct ptlrpc_request,
+				 rq_cli.cr_ready_chain);
+		list_del_init(&req->rq_cli.cr_ready_chain);
+	}
+	spin_unlock_bh(&set->set_ready_lock);
+	return req;
+}
+
+/*
+ * Check the requests of \a set, all of them, or only the ones woken up since
+ * they were last checked if \a ready_only is set.
+ */
+static int __ptlrpc_check_set(const struct lu_env *env,
+			      struct ptlrpc_request_set *set, bool ready_only)
+{
+	struct ptlrpc_request *req;
+	struct list_head *next = set->set_requests.next;
 	struct list_head  comp_reqs;
+	struct list_head  ready;
+	time64_t now = ktime_get_real_seconds();
 	int force_timer_recalc = 0;
 	ENTRY;
 
@@ -1729,10 +1853,19 @@ int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
 		RETURN(1);
 
 	INIT_LIST_HEAD(&comp_reqs);
-	list_for_each_safe(tmp, next, &set->set_requests) {
-		struct ptlrpc_request *req =
-			list_entry(tmp, struct ptlrpc_request,
-				   rq_set_chain);
+	INIT_LIST_HEAD(&ready);
+
+	/* a full scan checks the ready requests as well, forget them */
+	spin_lock_bh(&set->set_ready_lock);
+	if (ready_only)
+		list_splice_init(&set->set_ready_requests, &ready);
+	else
+		while (!list_empty(&set->set_ready_requests))
+			list_del_init(set->set_ready_requests.next);
+	spin_unlock_bh(&set->set_ready_lock);
+
+	while ((req = ptlrpc_check_set_next(set, ready_only ? &ready : NULL,
+					    &next)) != NULL) {
 		struct obd_import *imp = req->rq_import;
 		int unregistered = 0;
 		int async = 1;
@@ -1743,6 +1876,8 @@ int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
 			continue;
 		}
 
+		ptlrpc_req_check_timer(req, now);
+
 		/* This schedule point is mainly for the ptlrpcd caller of this
 		 * function.  Most ptlrpc sets are not long-lived and unbounded
 		 * in length, but at the least the set used by the ptlrpcd is.
@@ -2118,6 +2253,7 @@ int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
 			/* free the request that has just been completed
 			 * in order not to pollute set->set_requests */
 			list_del_init(&req->rq_set_chain);
+			ptlrpc_set_unready(set, req);
 			spin_lock(&req->rq_lock);
 			req->rq_set = NULL;
 			req->rq_invalid_rqset = 0;
@@ -2139,8 +2275,33 @@ int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
 	/* If we hit an error, we want to recover promptly. */
 	RETURN(atomic_read(&set->set_remaining) == 0 || force_timer_recalc);
 }
+
+/**
+ * this sends any unsent RPCs in \a set and returns 1 if all are sent
+ * and no more replies are expected.
+ * (it is possible to get less replies than requests sent e.g. due to timed out
+ * requests or requests that we had trouble to send out)
+ *
+ * NOTE: This function contains a potential schedule point (cond_resched()).
+ */
+int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
+{
+	return __ptlrpc_check_set(env, set, false);
+}
 EXPORT_SYMBOL(ptlrpc_check_set);
 
+/**
+ * Same as ptlrpc_check_set(), but only for the requests woken up by
+ * ptlrpc_client_wake_req() since they were last checked. It is up to the
+ * caller to do a full check of the set when something else may have changed,
+ * typically new requests added or timeouts expired.
+ */
+int ptlrpc_check_set_ready(const struct lu_env *env,
+			   struct ptlrpc_request_set *set)
+{
+	return __ptlrpc_check_set(env, set, true);
+}
+
 /**
  * Time out request \a req. is \a async_unlink is set, that means do not wait
  * until LNet actually confirms network buffer unlinking.
@@ -2229,6 +2390,9 @@ int ptlrpc_expired_set(void *data)
 	ENTRY;
 	LASSERT(set != NULL);
 
+	/* let ptlrpcd rescan the set for delayed and expired requests */
+	atomic_inc(&set->set_events);
+
 	/*
 	 * A timeout expired. See which reqs it applies to...
 	 */
@@ -2237,24 +2401,13 @@ int ptlrpc_expired_set(void *data)
 			list_entry(tmp, struct ptlrpc_request,
 				   rq_set_chain);
 
-                /* don't expire request waiting for context */
-                if (req->rq_wait_ctx)
-                        continue;
-
-                /* Request in-flight? */
-                if (!((req->rq_phase == RQ_PHASE_RPC &&
-                       !req->rq_waiting && !req->rq_resend) ||
-                      (req->rq_phase == RQ_PHASE_BULK)))
-                        continue;
-
-                if (req->rq_timedout ||     /* already dealt with */
-                    req->rq_deadline > now) /* not expired */
-                        continue;
+		if (!ptlrpc_req_expired(req, now))
+			continue;
 
-                /* Deal with this guy. Do it asynchronously to not block
-                 * ptlrpcd thread. */
-                ptlrpc_expire_one_request(req, 1);
-        }
+		/* Deal with this guy. Do it asynchronously to not block
+		 * ptlrpcd thread. */
+		ptlrpc_expire_one_request(req, 1);
+	}
 
         /*
          * When waiting for a whole set, we always break out of the
@@ -2464,6 +2617,91 @@ int ptlrpc_set_wait(const struct lu_env *env, struct ptlrpc_request_set *set)
 }
 EXPORT_SYMBOL(ptlrpc_set_wait);
 
+/*
+ * Order of the requests on imp_replay_list.
+ * We may have duplicate transnos if we create and then open a file, or for
+ * closes retained if to match creating opens, so use rq_xid as a secondary
+ * key. (See bugs 684, 685, and 428.)
+ */
+static int ptlrpc_replay_cmp(struct ptlrpc_request *a,
+			     struct ptlrpc_request *b)
+{
+	if (a->rq_transno != b->rq_transno)
+		return a->rq_transno < b->rq_transno ? -1 : 1;
+
+	LASSERT(a->rq_xid != b->rq_xid);
+	return a->rq_xid < b->rq_xid ? -1 : 1;
+}
+
+/* Must be called with imp_lock held */
+static void ptlrpc_replay_tree_insert(struct obd_import *imp,
+				      struct ptlrpc_request *req)
+{
+	struct rb_node **node = &imp->imp_replay_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct rb_node *prev;
+
+	while (*node != NULL) {
+		parent = *node;
+		if (ptlrpc_replay_cmp(req, rb_entry(parent,
+						     struct ptlrpc_request,
+						     rq_replay_node)) < 0)
+			node = &parent->rb_left;
+		else
+			node = &parent->rb_right;
+	}
+	rb_link_node(&req->rq_replay_node, parent, node);
+	rb_insert_color(&req->rq_replay_node, &imp->imp_replay_tree);
+
+	/* keep imp_replay_list in the same order as the tree */
+	prev = rb_prev(&req->rq_replay_node);
+	if (prev != NULL)
+		list_add(&req->rq_replay_list,
+			 &rb_entry(prev, struct ptlrpc_request,
+				   rq_replay_node)->rq_replay_list);
+	else
+		list_add(&req->rq_replay_list, &imp->imp_replay_list);
+}
+
+/* Must be called with imp_lock held */
+static void ptlrpc_replay_tree_del(struct obd_import *imp,
+				   struct ptlrpc_request *req)
+{
+	if (RB_EMPTY_NODE(&req->rq_replay_node))
+		return;
+
+	rb_erase(&req->rq_replay_node, &imp->imp_replay_tree);
+	RB_CLEAR_NODE(&req->rq_replay_node);
+}
+
+/**
+ * Return the first request of imp_replay_list with a transno greater than
+ * \a transno, or NULL if there is none.
+ * Must be called with imp_lock held.
+ */
+struct ptlrpc_request *ptlrpc_replay_tree_next(struct obd_import *imp,
+					       __u64 transno)
+{
+	struct rb_node *node = imp->imp_replay_tree.rb_node;
+	struct ptlrpc_request *next = NULL;
+
+	assert_spin_locked(&imp->imp_lock);
+
+	while (node != NULL) {
+		struct ptlrpc_request *req = rb_entry(node,
+						      struct ptlrpc_request,
+						      rq_replay_node);
+
+		if (req->rq_transno > transno) {
+			next = req;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return next;
+}
+
 /**
  * Helper fuction for request freeing.
  * Called when request count reached zero and request needs to be freed.
@@ -2484,6 +2722,9 @@ static void __ptlrpc_free_req(struct ptlrpc_request *request, int locked)
 	LASSERTF(!request->rq_receiving_reply, "req %p\n", request);
 	LASSERTF(list_empty(&request->rq_list), "req %p\n", request);
 	LASSERTF(list_empty(&request->rq_set_chain), "req %p\n", request);
+	ptlrpc_timer_disarm(&request->rq_cli.cr_timer);
+	LASSERTF(list_empty(&request->rq_cli.cr_ready_chain), "req %p\n",
+		 request);
 	LASSERTF(!request->rq_replay, "req %p\n", request);
 
 	req_capsule_fini(&request->rq_pill);
@@ -2493,6 +2734,7 @@ static void __ptlrpc_free_req(struct ptlrpc_request *request, int locked)
 	if (request->rq_import != NULL) {
 		if (!locked)
 			spin_lock(&request->rq_import->imp_lock);
+		ptlrpc_replay_tree_del(request->rq_import, request);
 		list_del_init(&request->rq_replay_list);
 		list_del_init(&request->rq_unreplied_list);
 		if (!locked)
@@ -2702,6 +2944,7 @@ static void ptlrpc_free_request(struct ptlrpc_request *req)
 
 	if (req->rq_commit_cb != NULL)
 		req->rq_commit_cb(req);
+	ptlrpc_replay_tree_del(req->rq_import, req);
 	list_del_init(&req->rq_replay_list);
 
 	__ptlrpc_req_finished(req, 1);
@@ -2788,6 +3031,7 @@ void ptlrpc_free_committed(struct obd_import *imp)
 
 		if (req->rq_replay) {
 			DEBUG_REQ(D_RPCTRACE, req, "keeping (FL_REPLAY)");
+			ptlrpc_replay_tree_del(imp, req);
 			list_move_tail(&req->rq_replay_list,
 					   &imp->imp_committed_list);
 			continue;
@@ -2888,8 +3132,6 @@ EXPORT_SYMBOL(ptlrpc_request_addref);
 void ptlrpc_retain_replayable_request(struct ptlrpc_request *req,
                                       struct obd_import *imp)
 {
-	struct list_head *tmp;
-
 	assert_spin_locked(&imp->imp_lock);
 
         if (req->rq_transno == 0) {
@@ -2914,31 +3156,7 @@ void ptlrpc_retain_replayable_request(struct ptlrpc_request *req,
 	LASSERT(imp->imp_replayable);
 	/* Balanced in ptlrpc_free_committed, usually. */
 	ptlrpc_request_addref(req);
-	list_for_each_prev(tmp, &imp->imp_replay_list) {
-		struct ptlrpc_request *iter = list_entry(tmp,
-							 struct ptlrpc_request,
-							 rq_replay_list);
-
-                /* We may have duplicate transnos if we create and then
-                 * open a file, or for closes retained if to match creating
-                 * opens, so use req->rq_xid as a secondary key.
-                 * (See bugs 684, 685, and 428.)
-                 * XXX no longer needed, but all opens need transnos!
-                 */
-                if (iter->rq_transno > req->rq_transno)
-                        continue;
-
-                if (iter->rq_transno == req->rq_transno) {
-                        LASSERT(iter->rq_xid != req->rq_xid);
-                        if (iter->rq_xid > req->rq_xid)
-                                continue;
-                }
-
-		list_add(&req->rq_replay_list, &iter->rq_replay_list);
-		return;
-	}
-
-	list_add(&req->rq_replay_list, &imp->imp_replay_list);
+	ptlrpc_replay_tree_insert(imp, req);
 }
 
 /**
@@ -3432,6 +3650,7 @@ static int work_interpreter(const struct lu_env *env,
 	rc = arg->cb(env, arg->cbdata);
 
 	list_del_init(&req->rq_set_chain);
+	ptlrpc_set_unready(req->rq_set, req);
 	req->rq_set = NULL;
 
 	if (atomic_dec_return(&req->rq_refcount) > 1) {
@@ -168,6 +168,9 @@ void reply_in_callback(struct lnet_event *ev)
 
 	if (lustre_msg_get_opc(req->rq_reqmsg) != OBD_PING)
 		req->rq_import->imp_last_reply_time = ktime_get_real_seconds();
+	if (req->rq_import->imp_connection != NULL)
+		req->rq_import->imp_connection->c_last_alive =
+			ktime_get_real_seconds();
 
 out_wake:
 	/* NB don't unlock till after wakeup; req can disappear under us
@@ -287,6 +290,41 @@ static void ptlrpc_req_add_history(struct ptlrpc_service_part *svcpt,
 	list_add_tail(&req->rq_history_list, &svcpt->scp_hist_reqs);
 }
 
+/**
+ * Move the requests pushed on svcpt::scp_req_arrived by request_in_callback()
+ * to svcpt::scp_req_incoming, in their order of arrival, taking their refs on
+ * their request buffers and adding them to the history.
+ * Must be called with svcpt::scp_lock held.
+ */
+void ptlrpc_server_drain_arrived(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_request *req;
+	struct llist_node *node;
+	struct list_head list;
+
+	assert_spin_locked(&svcpt->scp_lock);
+
+	node = llist_del_all(&svcpt->scp_req_arrived);
+	if (node == NULL)
+		return;
+
+	/* the llist is LIFO */
+	INIT_LIST_HEAD(&list);
+	while (node != NULL) {
+		req = llist_entry(node, struct ptlrpc_request,
+				  rq_srv.sr_arrived);
+		node = node->next;
+		list_add(&req->rq_list, &list);
+	}
+
+	list_for_each_entry(req, &list, rq_list) {
+		ptlrpc_req_add_history(svcpt, req);
+		req->rq_rqbd->rqbd_refcount++;
+		svcpt->scp_nreqs_incoming++;
+	}
+	list_splice_tail(&list, &svcpt->scp_req_incoming);
+}
+
 /*
  * Server's incoming request callback
  */
@@ -355,29 +393,37 @@ void request_in_callback(struct lnet_event *ev)
 	CDEBUG(D_RPCTRACE, "peer: %s (source: %s)\n",
 		libcfs_id2str(req->rq_peer), libcfs_id2str(req->rq_source));
 
+	if (!ev->unlinked) {
+		/* req takes a ref on rqbd, and gets into the history, once
+		 * moved to scp_req_incoming by ptlrpc_server_drain_arrived().
+		 * rqbd and svcpt cannot disappear until the last request of
+		 * rqbd is handled, which is delivered after this one. */
+		llist_add(&req->rq_srv.sr_arrived, &svcpt->scp_req_arrived);
+		wake_up(&svcpt->scp_waitq);
+		EXIT;
+		return;
+	}
+
 	spin_lock(&svcpt->scp_lock);
 
+	/* keep the last request of rqbd behind the other ones, which take
+	 * their ref on rqbd before this one can release it */
+	ptlrpc_server_drain_arrived(svcpt);
 	ptlrpc_req_add_history(svcpt, req);
 
-	if (ev->unlinked) {
-		svcpt->scp_nrqbds_posted--;
-		CDEBUG(D_INFO, "Buffer complete: %d buffers still posted\n",
-		       svcpt->scp_nrqbds_posted);
-
-		/* Normally, don't complain about 0 buffers posted; LNET won't
-		 * drop incoming reqs since we set the portal lazy */
-		if (test_req_buffer_pressure &&
-		    ev->type != LNET_EVENT_UNLINK &&
-		    svcpt->scp_nrqbds_posted == 0)
-                        CWARN("All %s request buffers busy\n",
-                              service->srv_name);
-
-                /* req takes over the network's ref on rqbd */
-        } else {
-                /* req takes a ref on rqbd */
-                rqbd->rqbd_refcount++;
-        }
+	svcpt->scp_nrqbds_posted--;
+	CDEBUG(D_INFO, "Buffer complete: %d buffers still posted\n",
+	       svcpt->scp_nrqbds_posted);
+
+	/* Normally, don't complain about 0 buffers posted; LNET won't
+	 * drop incoming reqs since we set the portal lazy */
+	if (test_req_buffer_pressure &&
+	    ev->type != LNET_EVENT_UNLINK &&
+	    svcpt->scp_nrqbds_posted == 0)
+		CWARN("All %s request buffers busy\n",
+		      service->srv_name);
 
+	/* req takes over the network's ref on rqbd */
 	list_add_tail(&req->rq_list, &svcpt->scp_req_incoming);
 	svcpt->scp_nreqs_incoming++;
 
@@ -48,6 +48,8 @@
 
 #define DEBUG_SUBSYSTEM S_SEC
 
+#include <linux/highmem.h>
+#include <linux/workqueue.h>
 #include <libcfs/linux/linux-crypto.h>
 #include <obd.h>
 #include <obd_support.h>
@@ -462,3 +464,265 @@ int gss_crypt_rawobjs(struct crypto_sync_skcipher *tfm, __u8 *iv,
 	outobj->len = datalen;
 	RETURN(0);
 }
+
+/*
+ * Large bulks are encrypted or decrypted in chunks of pages run in parallel
+ * by the helpers of gss_crypt_wq, when the IV each chunk starts with can be
+ * known before the pages ahead of it are processed:
+ * - with CTR chaining the counter advances once per cipher block, so the IV
+ *   of a chunk is the IV of the bulk plus the blocks of the pages ahead;
+ * - with CBC decryption the IV of a block is the cipher text before it, so
+ *   the IV of a chunk is the last cipher block of the pages ahead.
+ * CBC encryption is sequential by nature, as is the wire format.
+ */
+static unsigned int bulk_crypt_chunk = 64;
+module_param(bulk_crypt_chunk, uint, 0644);
+MODULE_PARM_DESC(bulk_crypt_chunk,
+		 "pages per parallel bulk crypto helper, 0 to disable");
+
+#define GSS_CRYPT_MAX_CHUNKS	32
+#define GSS_CRYPT_MAX_IV	16
+
+static struct workqueue_struct *gss_crypt_wq;
+
+struct gss_crypt_chunk {
+	struct work_struct		 gcc_work;
+	struct crypto_sync_skcipher	*gcc_tfm;
+	struct ptlrpc_bulk_desc		*gcc_desc;
+	int				 gcc_decrypt;
+	int				 gcc_start;
+	int				 gcc_end;
+	int				 gcc_rc;
+	atomic_t			*gcc_pending;
+	struct completion		*gcc_done;
+	__u8				 gcc_iv[GSS_CRYPT_MAX_IV];
+};
+
+/*
+ * Set up the scatterlists of page \a i of \a desc. The cipher text is in the
+ * encryption pages, with the lengths and offsets of bd_enc_vec. Plain text
+ * not ending on a block boundary is decrypted in place, to be copied later
+ * by the caller.
+ */
+static void gss_crypt_bulk_page(struct crypto_sync_skcipher *tfm,
+				struct ptlrpc_bulk_desc *desc, int i,
+				int decrypt, struct scatterlist *src,
+				struct scatterlist *dst)
+{
+	lnet_kiov_t *piov = &BD_GET_KIOV(desc, i);
+	lnet_kiov_t *ciov = &BD_GET_ENC_KIOV(desc, i);
+	int blocksize = crypto_sync_skcipher_blocksize(tfm);
+
+	sg_init_table(src, 1);
+	sg_init_table(dst, 1);
+	if (decrypt) {
+		sg_set_page(src, ciov->kiov_page, ciov->kiov_len,
+			    ciov->kiov_offset);
+		*dst = *src;
+		if (piov->kiov_len % blocksize == 0)
+			sg_assign_page(dst, piov->kiov_page);
+	} else {
+		sg_set_page(src, piov->kiov_page, ciov->kiov_len,
+			    ciov->kiov_offset);
+		*dst = *src;
+		sg_assign_page(dst, ciov->kiov_page);
+	}
+}
+
+static int gss_crypt_chunk_run(struct gss_crypt_chunk *gcc)
+{
+	struct crypto_sync_skcipher *tfm = gcc->gcc_tfm;
+	struct scatterlist src;
+	struct scatterlist dst;
+	int rc = 0;
+	int i;
+	SYNC_SKCIPHER_REQUEST_ON_STACK(req, tfm);
+
+	skcipher_request_set_sync_tfm(req, tfm);
+	skcipher_request_set_callback(req, 0, NULL, NULL);
+
+	for (i = gcc->gcc_start; i < gcc->gcc_end; i++) {
+		gss_crypt_bulk_page(tfm, gcc->gcc_desc, i, gcc->gcc_decrypt,
+				    &src, &dst);
+		if (src.length == 0)
+			continue;
+
+		skcipher_request_set_crypt(req, &src, &dst, src.length,
+					   gcc->gcc_iv);
+		if (gcc->gcc_decrypt)
+			rc = crypto_skcipher_decrypt_iv(req, &dst, &src,
+							src.length);
+		else
+			rc = crypto_skcipher_encrypt_iv(req, &dst, &src,
+							src.length);
+		if (rc) {
+			CERROR("failed to %s page %d: rc = %d\n",
+			       gcc->gcc_decrypt ? "decrypt" : "encrypt", i, rc);
+			break;
+		}
+	}
+	skcipher_request_zero(req);
+
+	return rc;
+}
+
+static void gss_crypt_chunk_work(struct work_struct *work)
+{
+	struct gss_crypt_chunk *gcc = container_of(work, struct gss_crypt_chunk,
+						   gcc_work);
+
+	gcc->gcc_rc = gss_crypt_chunk_run(gcc);
+	if (atomic_dec_and_test(gcc->gcc_pending))
+		complete(gcc->gcc_done);
+}
+
+/* Add \a count to the big endian counter \a ctr of \a size bytes */
+static void gss_ctr_add(__u8 *ctr, int size, __u64 count)
+{
+	int i;
+
+	for (i = size - 1; i >= 0 && count != 0; i--) {
+		count += ctr[i];
+		ctr[i] = count & 0xff;
+		count >>= 8;
+	}
+}
+
+/* Copy the last \a size cipher bytes of \a sg to \a iv */
+static void gss_cbc_last_block(struct scatterlist *sg, __u8 *iv, int size)
+{
+	char *addr = kmap(sg_page(sg));
+
+	memcpy(iv, addr + sg->offset + sg->length - size, size);
+	kunmap(sg_page(sg));
+}
+
+/*
+ * Set the IV of each chunk but the first one, from the one of the bulk
+ * \a iv. This must be done before any chunk gets decrypted in place.
+ */
+static void gss_crypt_chunks_iv(struct gss_crypt_chunk *chunks, int nchunks,
+				__u8 *iv, int ivsize, int ctr)
+{
+	struct crypto_sync_skcipher *tfm = chunks[0].gcc_tfm;
+	struct ptlrpc_bulk_desc *desc = chunks[0].gcc_desc;
+	int decrypt = chunks[0].gcc_decrypt;
+	struct scatterlist src;
+	struct scatterlist dst;
+	__u8 cur[GSS_CRYPT_MAX_IV];
+	__u64 blocks = 0;
+	int k = 1;
+	int i;
+
+	memcpy(cur, iv, ivsize);
+	for (i = 0; k < nchunks; i++) {
+		if (i == chunks[k].gcc_start) {
+			if (ctr) {
+				gss_ctr_add(cur, ivsize, blocks);
+				blocks = 0;
+			}
+			memcpy(chunks[k++].gcc_iv, cur, ivsize);
+		}
+
+		gss_crypt_bulk_page(tfm, desc, i, decrypt, &src, &dst);
+		if (src.length == 0)
+			continue;
+
+		if (ctr)
+			blocks += DIV_ROUND_UP(src.length, ivsize);
+		else
+			gss_cbc_last_block(&src, cur, ivsize);
+	}
+}
+
+/**
+ * Encrypt or decrypt, following \a decrypt, the first \a count pages of bulk
+ * \a desc with \a tfm, which chains blocks in CTR mode if \a ctr is set, or
+ * in CBC mode otherwise. \a iv is the IV of the first page and gets updated
+ * with the one chained after the last page, as a sequential run would.
+ *
+ * Plain text is in bd_vec, and cipher text in bd_enc_vec, whose lengths and
+ * offsets must have been set up by the caller. Bulks of more than
+ * bulk_crypt_chunk pages are split across the helper threads, when the
+ * chaining mode allows that.
+ */
+int gss_crypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
+		   struct ptlrpc_bulk_desc *desc, int count, int decrypt,
+		   int ctr)
+{
+	struct gss_crypt_chunk *chunks = NULL;
+	struct gss_crypt_chunk single;
+	struct completion done;
+	atomic_t pending;
+	unsigned int chunk = bulk_crypt_chunk;
+	int ivsize = crypto_sync_skcipher_ivsize(tfm);
+	int nchunks = 1;
+	int rc = 0;
+	int k;
+
+	LASSERT(ivsize <= GSS_CRYPT_MAX_IV);
+
+	if (chunk != 0 && count > chunk && (ctr || decrypt) &&
+	    gss_crypt_wq != NULL) {
+		chunk = max_t(unsigned int, chunk,
+			      DIV_ROUND_UP(count, GSS_CRYPT_MAX_CHUNKS));
+		nchunks = DIV_ROUND_UP(count, chunk);
+		OBD_ALLOC(chunks, nchunks * sizeof(*chunks));
+		if (chunks == NULL)
+			nchunks = 1;
+	}
+	if (chunks == NULL) {
+		chunks = &single;
+		chunk = count;
+	}
+
+	init_completion(&done);
+	atomic_set(&pending, nchunks - 1);
+	for (k = 0; k < nchunks; k++) {
+		chunks[k].gcc_tfm = tfm;
+		chunks[k].gcc_desc = desc;
+		chunks[k].gcc_decrypt = decrypt;
+		chunks[k].gcc_start = k * chunk;
+		chunks[k].gcc_end = min_t(int, count, (k + 1) * chunk);
+		chunks[k].gcc_rc = 0;
+		chunks[k].gcc_pending = &pending;
+		chunks[k].gcc_done = &done;
+	}
+	memcpy(chunks[0].gcc_iv, iv, ivsize);
+	gss_crypt_chunks_iv(chunks, nchunks, iv, ivsize, ctr);
+
+	for (k = 1; k < nchunks; k++) {
+		INIT_WORK(&chunks[k].gcc_work, gss_crypt_chunk_work);
+		queue_work(gss_crypt_wq, &chunks[k].gcc_work);
+	}
+	chunks[0].gcc_rc = gss_crypt_chunk_run(&chunks[0]);
+	if (nchunks > 1)
+		wait_for_completion(&done);
+
+	for (k = 0; k < nchunks && rc == 0; k++)
+		rc = chunks[k].gcc_rc;
+	memcpy(iv, chunks[nchunks - 1].gcc_iv, ivsize);
+
+	if (chunks != &single)
+		OBD_FREE(chunks, nchunks * sizeof(*chunks));
+
+	return rc;
+}
+
+int __init gss_init_crypto(void)
+{
+	gss_crypt_wq = alloc_workqueue("gss_crypt",
+				       WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (gss_crypt_wq == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void gss_exit_crypto(void)
+{
+	if (gss_crypt_wq != NULL) {
+		destroy_workqueue(gss_crypt_wq);
+		gss_crypt_wq = NULL;
+	}
+}
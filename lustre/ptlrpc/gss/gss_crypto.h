@@ -95,5 +95,8 @@ int gss_add_padding(rawobj_t *msg, int msg_buflen, int blocksize);
 int gss_crypt_rawobjs(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		      int inobj_cnt, rawobj_t *inobjs, rawobj_t *outobj,
 		      int enc);
+int gss_crypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
+		   struct ptlrpc_bulk_desc *desc, int count, int decrypt,
+		   int ctr);
 
 #endif /* PTLRPC_GSS_CRYPTO_H */
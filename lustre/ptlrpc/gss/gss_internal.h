@@ -523,10 +523,15 @@ extern unsigned int krb5_allow_old_client_csum;
 /* lproc_gss.c */
 void gss_stat_oos_record_cli(int behind);
 void gss_stat_oos_record_svc(int phase, int replay);
+void gss_stat_hs_record(ktime_t start, bool failed);
 
 int  __init gss_init_lproc(void);
 void gss_exit_lproc(void);
 
+/* gss_crypto.c */
+int  __init gss_init_crypto(void);
+void gss_exit_crypto(void);
+
 /* gss_null_mech.c */
 int __init init_null_module(void);
 void cleanup_null_module(void);
@@ -808,7 +808,7 @@ int krb5_decrypt_bulk(struct crypto_sync_skcipher *tfm,
 	struct scatterlist src, dst;
 	struct sg_table sg_src, sg_dst;
 	int ct_nob = 0, pt_nob = 0;
-	int blocksize, i, rc;
+	int blocksize, count, i, rc;
 	SYNC_SKCIPHER_REQUEST_ON_STACK(req, tfm);
 
 	LASSERT(ptlrpc_is_bulk_desc_kiov(desc->bd_type));
@@ -885,36 +885,6 @@ int krb5_decrypt_bulk(struct crypto_sync_skcipher *tfm,
 				BD_GET_ENC_KIOV(desc, i).kiov_len);
 		}
 
-		if (BD_GET_ENC_KIOV(desc, i).kiov_len == 0)
-			continue;
-
-		sg_init_table(&src, 1);
-		sg_set_page(&src, BD_GET_ENC_KIOV(desc, i).kiov_page,
-			    BD_GET_ENC_KIOV(desc, i).kiov_len,
-			    BD_GET_ENC_KIOV(desc, i).kiov_offset);
-		dst = src;
-		if (BD_GET_KIOV(desc, i).kiov_len % blocksize == 0)
-			sg_assign_page(&dst,
-				       BD_GET_KIOV(desc, i).kiov_page);
-
-		skcipher_request_set_crypt(req, sg_src.sgl, sg_dst.sgl,
-					   src.length, local_iv);
-		rc = crypto_skcipher_decrypt_iv(req, &dst, &src, src.length);
-		if (rc) {
-			CERROR("error to decrypt page: %d\n", rc);
-			skcipher_request_zero(req);
-			return rc;
-		}
-
-		if (BD_GET_KIOV(desc, i).kiov_len % blocksize != 0) {
-			memcpy(page_address(BD_GET_KIOV(desc, i).kiov_page) +
-			       BD_GET_KIOV(desc, i).kiov_offset,
-			       page_address(BD_GET_ENC_KIOV(desc, i).
-					    kiov_page) +
-			       BD_GET_KIOV(desc, i).kiov_offset,
-			       BD_GET_KIOV(desc, i).kiov_len);
-		}
-
 		ct_nob += BD_GET_ENC_KIOV(desc, i).kiov_len;
 		pt_nob += BD_GET_KIOV(desc, i).kiov_len;
 	}
@@ -933,11 +903,33 @@ int krb5_decrypt_bulk(struct crypto_sync_skcipher *tfm,
 		return -EFAULT;
 	}
 
+	count = i;
+
 	/* if needed, clear up the rest unused iovs */
 	if (adj_nob)
 		while (i < desc->bd_iov_count)
 			BD_GET_KIOV(desc, i++).kiov_len = 0;
 
+	/* CBC decryption lets the pages be decrypted in parallel */
+	rc = gss_crypt_bulk(tfm, local_iv, desc, count, 1, 0);
+	if (rc) {
+		CERROR("error to decrypt pages: %d\n", rc);
+		skcipher_request_zero(req);
+		return rc;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (BD_GET_ENC_KIOV(desc, i).kiov_len == 0 ||
+		    BD_GET_KIOV(desc, i).kiov_len % blocksize == 0)
+			continue;
+
+		memcpy(page_address(BD_GET_KIOV(desc, i).kiov_page) +
+		       BD_GET_KIOV(desc, i).kiov_offset,
+		       page_address(BD_GET_ENC_KIOV(desc, i).kiov_page) +
+		       BD_GET_KIOV(desc, i).kiov_offset,
+		       BD_GET_KIOV(desc, i).kiov_len);
+	}
+
 	/* decrypt tail (krb5 header) */
 	rc = gss_setup_sgtable(&sg_src, &src, cipher->data + blocksize,
 			       sizeof(*khdr));
@@ -631,44 +631,27 @@ static __u32 sk_encrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
 			     int adj_nob)
 {
-	struct scatterlist ptxt;
-	struct scatterlist ctxt;
 	int blocksize;
 	int i;
 	int rc;
 	int nob = 0;
-	SYNC_SKCIPHER_REQUEST_ON_STACK(req, tfm);
 
 	blocksize = crypto_sync_skcipher_blocksize(tfm);
 
-	sg_init_table(&ptxt, 1);
-	sg_init_table(&ctxt, 1);
-
-	skcipher_request_set_sync_tfm(req, tfm);
-	skcipher_request_set_callback(req, 0, NULL, NULL);
-
 	for (i = 0; i < desc->bd_iov_count; i++) {
-		sg_set_page(&ptxt, BD_GET_KIOV(desc, i).kiov_page,
-			    sk_block_mask(BD_GET_KIOV(desc, i).kiov_len,
-					  blocksize),
-			    BD_GET_KIOV(desc, i).kiov_offset);
-		nob += ptxt.length;
-
-		sg_set_page(&ctxt, BD_GET_ENC_KIOV(desc, i).kiov_page,
-			    ptxt.length, ptxt.offset);
-
-		BD_GET_ENC_KIOV(desc, i).kiov_offset = ctxt.offset;
-		BD_GET_ENC_KIOV(desc, i).kiov_len = ctxt.length;
+		BD_GET_ENC_KIOV(desc, i).kiov_offset =
+			BD_GET_KIOV(desc, i).kiov_offset;
+		BD_GET_ENC_KIOV(desc, i).kiov_len =
+			sk_block_mask(BD_GET_KIOV(desc, i).kiov_len, blocksize);
+		nob += BD_GET_ENC_KIOV(desc, i).kiov_len;
+	}
 
-		skcipher_request_set_crypt(req, &ptxt, &ctxt, ptxt.length, iv);
-		rc = crypto_skcipher_encrypt_iv(req, &ctxt, &ptxt, ptxt.length);
-		if (rc) {
-			CERROR("failed to encrypt page: %d\n", rc);
-			skcipher_request_zero(req);
-			return rc;
-		}
+	/* CTR chaining lets the pages be encrypted in parallel */
+	rc = gss_crypt_bulk(tfm, iv, desc, desc->bd_iov_count, 0, 1);
+	if (rc) {
+		CERROR("failed to encrypt bulk: %d\n", rc);
+		return rc;
 	}
-	skcipher_request_zero(req);
 
 	if (adj_nob)
 		desc->bd_nob = nob;
@@ -680,17 +663,12 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
 			     int adj_nob)
 {
-	struct scatterlist ptxt;
-	struct scatterlist ctxt;
 	int blocksize;
+	int count;
 	int i;
 	int rc;
 	int pnob = 0;
 	int cnob = 0;
-	SYNC_SKCIPHER_REQUEST_ON_STACK(req, tfm);
-
-	sg_init_table(&ptxt, 1);
-	sg_init_table(&ctxt, 1);
 
 	blocksize = crypto_sync_skcipher_blocksize(tfm);
 	if (desc->bd_nob_transferred % blocksize != 0) {
@@ -699,9 +677,6 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		return GSS_S_DEFECTIVE_TOKEN;
 	}
 
-	skcipher_request_set_sync_tfm(req, tfm);
-	skcipher_request_set_callback(req, 0, NULL, NULL);
-
 	for (i = 0; i < desc->bd_iov_count && cnob < desc->bd_nob_transferred;
 	     i++) {
 		lnet_kiov_t *piov = &BD_GET_KIOV(desc, i);
@@ -710,7 +685,6 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		if (ciov->kiov_offset % blocksize != 0 ||
 		    ciov->kiov_len % blocksize != 0) {
 			CERROR("Invalid bulk descriptor vector\n");
-			skcipher_request_zero(req);
 			return GSS_S_DEFECTIVE_TOKEN;
 		}
 
@@ -734,45 +708,14 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 			if (ciov->kiov_len + cnob > desc->bd_nob_transferred ||
 			    piov->kiov_len > ciov->kiov_len) {
 				CERROR("Invalid decrypted length\n");
-				skcipher_request_zero(req);
 				return GSS_S_FAILURE;
 			}
 		}
 
-		if (ciov->kiov_len == 0)
-			continue;
-
-		sg_init_table(&ctxt, 1);
-		sg_set_page(&ctxt, ciov->kiov_page, ciov->kiov_len,
-			    ciov->kiov_offset);
-		ptxt = ctxt;
-
-		/* In the event the plain text size is not a multiple
-		 * of blocksize we decrypt in place and copy the result
-		 * after the decryption */
-		if (piov->kiov_len % blocksize == 0)
-			sg_assign_page(&ptxt, piov->kiov_page);
-
-		skcipher_request_set_crypt(req, &ctxt, &ptxt, ptxt.length, iv);
-		rc = crypto_skcipher_decrypt_iv(req, &ptxt, &ctxt, ptxt.length);
-		if (rc) {
-			CERROR("Decryption failed for page: %d\n", rc);
-			skcipher_request_zero(req);
-			return GSS_S_FAILURE;
-		}
-
-		if (piov->kiov_len % blocksize != 0) {
-			memcpy(page_address(piov->kiov_page) +
-			       piov->kiov_offset,
-			       page_address(ciov->kiov_page) +
-			       ciov->kiov_offset,
-			       piov->kiov_len);
-		}
-
 		cnob += ciov->kiov_len;
 		pnob += piov->kiov_len;
 	}
-	skcipher_request_zero(req);
+	count = i;
 
 	/* if needed, clear up the rest unused iovs */
 	if (adj_nob)
@@ -791,6 +734,26 @@ static __u32 sk_decrypt_bulk(struct crypto_sync_skcipher *tfm, __u8 *iv,
 		return GSS_S_FAILURE;
 	}
 
+	rc = gss_crypt_bulk(tfm, iv, desc, count, 1, 1);
+	if (rc) {
+		CERROR("Decryption failed for bulk: %d\n", rc);
+		return GSS_S_FAILURE;
+	}
+
+	/* In the event the plain text size is not a multiple of blocksize
+	 * the page was decrypted in place, copy the result */
+	for (i = 0; i < count; i++) {
+		lnet_kiov_t *piov = &BD_GET_KIOV(desc, i);
+		lnet_kiov_t *ciov = &BD_GET_ENC_KIOV(desc, i);
+
+		if (ciov->kiov_len == 0 || piov->kiov_len % blocksize == 0)
+			continue;
+
+		memcpy(page_address(piov->kiov_page) + piov->kiov_offset,
+		       page_address(ciov->kiov_page) + ciov->kiov_offset,
+		       piov->kiov_len);
+	}
+
 	return 0;
 }
 
@@ -881,6 +881,7 @@ int gss_svc_upcall_handle_init(struct ptlrpc_request *req,
 	struct rsc                *rsci = NULL;
 	struct rsi                *rsip = NULL, rsikey;
 	wait_queue_entry_t wait;
+	ktime_t			   start;
 	int                        replen = sizeof(struct ptlrpc_body);
 	struct gss_rep_header     *rephdr;
 	int                        first_check = 1;
@@ -920,6 +921,7 @@ int gss_svc_upcall_handle_init(struct ptlrpc_request *req,
                 GOTO(out, rc);
         }
 
+	start = ktime_get();
 	cache_get(&rsip->h); /* take an extra ref */
 	init_waitqueue_head(&rsip->waitq);
 	init_waitqueue_entry(&wait, current);
@@ -970,6 +972,7 @@ cache_check:
 
 	remove_wait_queue(&rsip->waitq, &wait);
 	cache_put(&rsip->h, &rsi_cache);
+	gss_stat_hs_record(start, rc != 0);
 
 	if (rc)
 		GOTO(out, rc = SECSVC_DROP);
@@ -89,6 +89,69 @@ void gss_stat_oos_record_svc(int phase, int replay)
 		atomic_inc(&gss_stat_oos.oos_svc_pass[phase]);
 }
 
+/*
+ * statistic of the context init handshakes of the server, the time is the
+ * one spent waiting for the upcall to lsvcgssd
+ */
+static struct {
+	spinlock_t	hs_lock;
+	__u64		hs_count;	/* upcalls done */
+	__u64		hs_failed;	/* upcalls failed or timed out */
+	__u64		hs_usec_total;
+	__u64		hs_usec_max;
+} gss_stat_hs;
+
+void gss_stat_hs_record(ktime_t start, bool failed)
+{
+	__u64 usec = ktime_us_delta(ktime_get(), start);
+
+	spin_lock(&gss_stat_hs.hs_lock);
+	gss_stat_hs.hs_count++;
+	if (failed)
+		gss_stat_hs.hs_failed++;
+	gss_stat_hs.hs_usec_total += usec;
+	if (usec > gss_stat_hs.hs_usec_max)
+		gss_stat_hs.hs_usec_max = usec;
+	spin_unlock(&gss_stat_hs.hs_lock);
+}
+
+static int gss_proc_hs_seq_show(struct seq_file *m, void *v)
+{
+	__u64 count;
+	__u64 failed;
+	__u64 total;
+	__u64 max;
+
+	spin_lock(&gss_stat_hs.hs_lock);
+	count = gss_stat_hs.hs_count;
+	failed = gss_stat_hs.hs_failed;
+	total = gss_stat_hs.hs_usec_total;
+	max = gss_stat_hs.hs_usec_max;
+	spin_unlock(&gss_stat_hs.hs_lock);
+
+	seq_printf(m, "upcalls:		%llu\n"
+		   "failed:		%llu\n"
+		   "avg_usec:		%llu\n"
+		   "max_usec:		%llu\n",
+		   count, failed, count ? div64_u64(total, count) : 0, max);
+	return 0;
+}
+
+static ssize_t gss_proc_hs_seq_write(struct file *file,
+				     const char __user *buffer,
+				     size_t count, loff_t *off)
+{
+	spin_lock(&gss_stat_hs.hs_lock);
+	gss_stat_hs.hs_count = 0;
+	gss_stat_hs.hs_failed = 0;
+	gss_stat_hs.hs_usec_total = 0;
+	gss_stat_hs.hs_usec_max = 0;
+	spin_unlock(&gss_stat_hs.hs_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(gss_proc_hs);
+
 static int gss_proc_oos_seq_show(struct seq_file *m, void *v)
 {
 	seq_printf(m, "seqwin:		   %u\n"
@@ -157,6 +220,8 @@ LPROC_SEQ_FOPS(sptlrpc_krb5_allow_old_client_csum);
 static struct lprocfs_vars gss_lprocfs_vars[] = {
 	{ .name	=	"replays",
 	  .fops	=	&gss_proc_oos_fops	},
+	{ .name	=	"handshakes",
+	  .fops	=	&gss_proc_hs_fops	},
 	{ .name	=	"init_channel",
 	  .fops	=	&gss_proc_secinit,
 	  .proc_mode =	0222			},
@@ -222,6 +287,7 @@ int gss_init_lproc(void)
 	int	rc;
 
 	spin_lock_init(&gss_stat_oos.oos_lock);
+	spin_lock_init(&gss_stat_hs.hs_lock);
 
 	gss_proc_root = lprocfs_register("gss", sptlrpc_proc_root,
 					 gss_lprocfs_vars, NULL);
@@ -2580,11 +2580,9 @@ int gss_svc_alloc_rs(struct ptlrpc_request *req, int msglen)
                 /* pre-allocated */
                 LASSERT(rs->rs_size >= rs_size);
         } else {
-                OBD_ALLOC_LARGE(rs, rs_size);
+		rs = lustre_get_pooled_rs(req->rq_rqbd->rqbd_svcpt, rs_size);
                 if (rs == NULL)
                         RETURN(-ENOMEM);
-
-                rs->rs_size = rs_size;
         }
 
         rs->rs_repbuf = (struct lustre_msg *) (rs + 1);
@@ -2770,7 +2768,7 @@ void gss_svc_free_rs(struct ptlrpc_reply_state *rs)
         rs->rs_svc_ctx = NULL;
 
         if (!rs->rs_prealloc)
-                OBD_FREE_LARGE(rs, rs->rs_size);
+                lustre_put_pooled_rs(rs);
 }
 
 void gss_svc_free_ctx(struct ptlrpc_svc_ctx *ctx)
@@ -2866,10 +2864,14 @@ static int __init sptlrpc_gss_init(void)
         if (rc)
                 goto out_cli_upcall;
 
-	rc = init_null_module();
+	rc = gss_init_crypto();
 	if (rc)
 		goto out_svc_upcall;
 
+	rc = init_null_module();
+	if (rc)
+		goto out_crypto;
+
 	rc = init_kerberos_module();
 	if (rc)
 		goto out_null;
@@ -2901,6 +2903,8 @@ out_kerberos:
 	cleanup_kerberos_module();
 out_null:
 	cleanup_null_module();
+out_crypto:
+	gss_exit_crypto();
 out_svc_upcall:
 	gss_exit_svc_upcall();
 out_cli_upcall:
@@ -2915,6 +2919,7 @@ static void __exit sptlrpc_gss_exit(void)
         gss_exit_keyring();
         gss_exit_pipefs();
         cleanup_kerberos_module();
+	gss_exit_crypto();
         gss_exit_svc_upcall();
         gss_exit_cli_upcall();
         gss_exit_lproc();
@@ -440,6 +440,21 @@ void ptlrpc_activate_import(struct obd_import *imp, bool set_state_full)
 }
 EXPORT_SYMBOL(ptlrpc_activate_import);
 
+/**
+ * Delay the next connect of \a imp by a random time of up to \a window
+ * seconds, so that the clients of a restarted or overloaded server do not
+ * all connect at once.  Called with imp_lock held.
+ */
+static void ptlrpc_import_conn_delay(struct obd_import *imp, __u32 window)
+{
+	if (window == 0)
+		return;
+
+	imp->imp_conn_next = ktime_get_seconds() + cfs_rand() % (window + 1);
+	CDEBUG(D_HA, "%s: delay connect by %llds\n", obd2cli_tgt(imp->imp_obd),
+	       imp->imp_conn_next - ktime_get_seconds());
+}
+
 void ptlrpc_pinger_force(struct obd_import *imp)
 {
 	CDEBUG(D_HA, "%s: waking up pinger s:%s\n", obd2cli_tgt(imp->imp_obd),
@@ -447,6 +462,9 @@ void ptlrpc_pinger_force(struct obd_import *imp)
 
 	spin_lock(&imp->imp_lock);
 	imp->imp_force_verify = 1;
+	/* the server may just have restarted, spread the reconnects */
+	if (imp->imp_state == LUSTRE_IMP_DISCON)
+		ptlrpc_import_conn_delay(imp, imp->imp_conn_window);
 	spin_unlock(&imp->imp_lock);
 
 	if (imp->imp_state != LUSTRE_IMP_CONNECTING)
@@ -942,6 +960,14 @@ static int ptlrpc_connect_set_flags(struct obd_import *imp,
 		ns->ns_orig_connect_flags = ocd->ocd_connect_flags;
 	}
 
+	spin_lock(&imp->imp_lock);
+	if (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2 &&
+	    ocd->ocd_connect_flags2 & OBD_CONNECT2_CONN_WINDOW)
+		imp->imp_conn_window = ocd->ocd_conn_window;
+	else
+		imp->imp_conn_window = 0;
+	spin_unlock(&imp->imp_lock);
+
 	if (ocd->ocd_connect_flags & OBD_CONNECT_AT)
 		/* We need a per-message support flag, because
 		 * a. we don't know if the incoming connect reply
@@ -1367,6 +1393,18 @@ out:
 				import_set_state_nolock(imp, LUSTRE_IMP_CLOSED);
 				inact = true;
 			}
+		} else if (ptlrpc_busy_reconnect(rc) &&
+			   request->rq_repmsg != NULL) {
+			struct obd_connect_data *ocd;
+
+			/* the server may ask to back off for a while */
+			ocd = req_capsule_server_get(&request->rq_pill,
+						     &RMF_CONNECT_DATA);
+			if (ocd != NULL &&
+			    ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2 &&
+			    ocd->ocd_connect_flags2 & OBD_CONNECT2_CONN_WINDOW)
+				ptlrpc_import_conn_delay(imp,
+							 ocd->ocd_conn_window);
 		} else if (rc == -ENODEV || rc == -ETIMEDOUT) {
 			/* ENODEV means there is no service, force reconnection
 			 * to a pair if attempt happen ptlrpc_next_reconnect
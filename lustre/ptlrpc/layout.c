@@ -352,6 +352,12 @@ static const struct req_msg_field *mds_rmfid_server[] = {
 	&RMF_RCS,
 };
 
+static const struct req_msg_field *mds_batch[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_BODY,
+	&RMF_BATCH_BUF,
+};
+
 static const struct req_msg_field *obd_connect_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_TGTUUID,
@@ -399,6 +405,12 @@ static const struct req_msg_field *ldlm_enqueue_server[] = {
         &RMF_DLM_REP
 };
 
+/* the handles of the locks the client does not have */
+static const struct req_msg_field *ldlm_bl_callback_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ
+};
+
 static const struct req_msg_field *ldlm_enqueue_lvb_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_DLM_REP,
@@ -637,19 +649,23 @@ static const struct req_msg_field *ost_brw_client[] = {
 	&RMF_OBD_IOOBJ,
 	&RMF_NIOBUF_REMOTE,
 	&RMF_CAPA1,
-	&RMF_SHORT_IO
+	&RMF_SHORT_IO,
+	&RMF_OST_GUARDS,
+	&RMF_OST_COMPR
 };
 
 static const struct req_msg_field *ost_brw_read_server[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_OST_BODY,
-	&RMF_SHORT_IO
+	&RMF_SHORT_IO,
+	&RMF_OST_COMPR
 };
 
 static const struct req_msg_field *ost_brw_write_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_OST_BODY,
-        &RMF_RCS
+        &RMF_RCS,
+        &RMF_OST_GUARDS
 };
 
 static const struct req_msg_field *ost_get_info_generic_server[] = {
@@ -799,6 +815,7 @@ static struct req_format *req_formats[] = {
 	&RQF_MDS_HSM_REQUEST,
 	&RQF_MDS_SWAP_LAYOUTS,
 	&RQF_MDS_RMFID,
+	&RQF_MDS_BATCH,
 	&RQF_OUT_UPDATE,
 	&RQF_OST_CONNECT,
 	&RQF_OST_DISCONNECT,
@@ -826,6 +843,7 @@ static struct req_format *req_formats[] = {
 	&RQF_LDLM_CALLBACK,
 	&RQF_LDLM_CP_CALLBACK,
 	&RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
 	&RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_CALLBACK_DESC,
 	&RQF_LDLM_INTENT,
@@ -1013,6 +1031,15 @@ struct req_msg_field RMF_FID_ARRAY =
 	DEFINE_MSGF("fid_array", 0, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_FID_ARRAY);
 
+struct req_msg_field RMF_BATCH_BODY =
+	DEFINE_MSGF("batch_body", 0, sizeof(struct batch_body),
+		    lustre_swab_batch_body, NULL);
+EXPORT_SYMBOL(RMF_BATCH_BODY);
+
+struct req_msg_field RMF_BATCH_BUF =
+	DEFINE_MSGF("batch_buf", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_BATCH_BUF);
+
 struct req_msg_field RMF_SYMTGT =
         DEFINE_MSGF("symtgt", RMF_F_STRING, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_SYMTGT);
@@ -1207,6 +1234,12 @@ EXPORT_SYMBOL(RMF_IDX_INFO);
 struct req_msg_field RMF_SHORT_IO =
 	DEFINE_MSGF("short_io", 0, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_SHORT_IO);
+struct req_msg_field RMF_OST_GUARDS =
+	DEFINE_MSGF("ost_guards", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_OST_GUARDS);
+struct req_msg_field RMF_OST_COMPR =
+	DEFINE_MSGF("ost_compr", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_OST_COMPR);
 struct req_msg_field RMF_HSM_USER_STATE =
 	DEFINE_MSGF("hsm_user_state", 0, sizeof(struct hsm_user_state),
 		    lustre_swab_hsm_user_state, NULL);
@@ -1541,6 +1574,11 @@ struct req_format RQF_LDLM_BL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK_BATCH", ldlm_enqueue_client,
+			ldlm_bl_callback_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
                         ldlm_gl_callback_server);
@@ -1641,6 +1679,10 @@ struct req_format RQF_MDS_RMFID =
 			mds_rmfid_server);
 EXPORT_SYMBOL(RQF_MDS_RMFID);
 
+struct req_format RQF_MDS_BATCH =
+	DEFINE_REQ_FMT0("MDS_BATCH", mds_batch, mds_batch);
+EXPORT_SYMBOL(RQF_MDS_BATCH);
+
 struct req_format RQF_LLOG_ORIGIN_HANDLE_CREATE =
         DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_CREATE",
                         llog_origin_handle_create_client, llogd_body_only);
@@ -1811,6 +1853,8 @@ void req_capsule_init_area(struct req_capsule *pill)
                 pill->rc_area[RCL_CLIENT][i] = -1;
                 pill->rc_area[RCL_SERVER][i] = -1;
         }
+	req_capsule_uncheck(pill, RCL_CLIENT);
+	req_capsule_uncheck(pill, RCL_SERVER);
 }
 EXPORT_SYMBOL(req_capsule_init_area);
 
@@ -1937,6 +1981,7 @@ int req_capsule_server_pack(struct req_capsule *pill)
         LASSERT(fmt != NULL);
 
         count = req_capsule_filled_sizes(pill, RCL_SERVER);
+	req_capsule_uncheck(pill, RCL_SERVER);
         rc = lustre_pack_reply(pill->rc_req, count,
                                pill->rc_area[RCL_SERVER], NULL);
         if (rc != 0) {
@@ -2052,6 +2097,10 @@ swabber_dumper_helper(struct req_capsule *pill,
  * calls to __req_capsule_get() with a non-NULL \a swabber; \a swabber will then
  * be removed.  Fields with the \a RMF_F_STRUCT_ARRAY flag set will have each
  * element of the array swabbed.
+ *
+ * A buffer is size checked and swabbed only the first time one of its fields
+ * is accessed, later accesses just look its address up while \a rc_checked
+ * says it is unchanged.
  */
 static void *__req_capsule_get(struct req_capsule *pill,
                                const struct req_msg_field *field,
@@ -2064,6 +2113,7 @@ static void *__req_capsule_get(struct req_capsule *pill,
         void                    *value;
 	__u32                    len;
 	__u32                    offset;
+	bool			 checked;
 
 	void *(*getter)(struct lustre_msg *m, __u32 n, __u32 minlen);
 
@@ -2084,16 +2134,26 @@ static void *__req_capsule_get(struct req_capsule *pill,
         msg = __req_msg(pill, loc);
         LASSERT(msg != NULL);
 
-        getter = (field->rmf_flags & RMF_F_STRING) ?
-                (typeof(getter))lustre_msg_string : lustre_msg_buf;
+	if (unlikely(pill->rc_checked_msg[loc] != msg)) {
+		pill->rc_checked_msg[loc] = msg;
+		req_capsule_uncheck(pill, loc);
+	}
+	checked = !dump && (pill->rc_checked[loc] & (1U << offset));
 
-	if (field->rmf_flags & (RMF_F_STRUCT_ARRAY|RMF_F_NO_SIZE_CHECK)) {
+	getter = (field->rmf_flags & RMF_F_STRING) && !checked ?
+		(typeof(getter))lustre_msg_string : lustre_msg_buf;
+
+	if (checked && (field->rmf_flags & RMF_F_STRING)) {
+		/* the string was checked to fit its buffer already */
+		len = 0;
+	} else if (field->rmf_flags &
+		   (RMF_F_STRUCT_ARRAY | RMF_F_NO_SIZE_CHECK)) {
 		/*
 		 * We've already asserted that field->rmf_size > 0 in
 		 * req_layout_init().
 		 */
 		len = lustre_msg_buflen(msg, offset);
-		if (!(field->rmf_flags & RMF_F_NO_SIZE_CHECK) &&
+		if (!checked && !(field->rmf_flags & RMF_F_NO_SIZE_CHECK) &&
 		    (len % field->rmf_size) != 0) {
 			CERROR("%s: array field size mismatch "
 				"%d modulo %u != 0 (%d)\n",
@@ -2114,10 +2174,11 @@ static void *__req_capsule_get(struct req_capsule *pill,
 			  field->rmf_name, offset, lustre_msg_bufcount(msg),
 			  fmt->rf_name, lustre_msg_buflen(msg, offset), len,
 			  rcl_names[loc]);
-        } else {
-                swabber_dumper_helper(pill, field, loc, offset, value, len,
-                                      dump, swabber);
-        }
+	} else if (!checked) {
+		swabber_dumper_helper(pill, field, loc, offset, value, len,
+				      dump, swabber);
+		pill->rc_checked[loc] |= 1U << offset;
+	}
 
         return value;
 }
@@ -2288,6 +2349,8 @@ void req_capsule_set_size(struct req_capsule *pill,
 			  const struct req_msg_field *field,
 			  enum req_location loc, __u32 size)
 {
+	__u32 offset;
+
 	LASSERT(loc == RCL_SERVER || loc == RCL_CLIENT);
 
 	if ((size != (__u32)field->rmf_size) &&
@@ -2309,7 +2372,11 @@ void req_capsule_set_size(struct req_capsule *pill,
 		}
 	}
 
-	pill->rc_area[loc][__req_capsule_offset(pill, field, loc)] = size;
+	offset = __req_capsule_offset(pill, field, loc);
+	if (pill->rc_area[loc][offset] != size) {
+		pill->rc_area[loc][offset] = size;
+		pill->rc_checked[loc] &= ~(1U << offset);
+	}
 }
 EXPORT_SYMBOL(req_capsule_set_size);
 
@@ -2433,6 +2500,9 @@ void req_capsule_extend(struct req_capsule *pill, const struct req_format *fmt)
         }
 
         pill->rc_fmt = fmt;
+	/* the fields of the new format are swabbed differently */
+	req_capsule_uncheck(pill, RCL_CLIENT);
+	req_capsule_uncheck(pill, RCL_SERVER);
 }
 EXPORT_SYMBOL(req_capsule_extend);
 
@@ -2495,6 +2565,7 @@ void req_capsule_shrink(struct req_capsule *pill,
 
         msg = __req_msg(pill, loc);
         len = lustre_msg_buflen(msg, offset);
+	req_capsule_uncheck(pill, loc);
 	LASSERTF(newlen <= len, "%s:%s, oldlen=%u, newlen=%u\n",
                                 fmt->rf_name, field->rmf_name, len, newlen);
 
@@ -136,6 +136,56 @@ out:
 	return rc;
 }
 
+/**
+ * Find the chunk with record \a next_idx starting from \a cur_offset in the
+ * chunks returned by the last bulk NEXT_BLOCK RPC, as llog_osd_next_block()
+ * does on the server.
+ *
+ * \retval	0 if the chunk is copied into \a buf
+ * \retval	-ENOENT if the RPC is needed
+ */
+static int llog_client_bulk_block(struct llog_handle *loghandle,
+				  int *cur_idx, int next_idx,
+				  __u64 *cur_offset, void *buf, int len)
+{
+	__u64 offset = *cur_offset;
+
+	if (loghandle->lgh_bulk_len == 0 || len != LLOG_MIN_CHUNK_SIZE ||
+	    offset < loghandle->lgh_bulk_offset)
+		return -ENOENT;
+
+	while (offset + len <=
+	       loghandle->lgh_bulk_offset + loghandle->lgh_bulk_len) {
+		char *chunk = loghandle->lgh_bulk_buf +
+			      (offset - loghandle->lgh_bulk_offset);
+		struct llog_rec_hdr *rec = (struct llog_rec_hdr *)chunk;
+		struct llog_rec_tail *tail;
+
+		/* leave the unusual cases to the server */
+		if (LLOG_REC_HDR_NEEDS_SWABBING(rec))
+			break;
+
+		tail = (struct llog_rec_tail *)(chunk + len - sizeof(*tail));
+		if (tail->lrt_index == 0 || tail->lrt_len > len)
+			break;
+
+		if (tail->lrt_index < next_idx) {
+			offset += len;
+			continue;
+		}
+
+		if (rec->lrh_index > next_idx)
+			break;
+
+		memcpy(buf, chunk, len);
+		*cur_idx = tail->lrt_index;
+		*cur_offset = offset + len;
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
 static int llog_client_next_block(const struct lu_env *env,
 				  struct llog_handle *loghandle,
 				  int *cur_idx, int next_idx,
@@ -145,9 +195,22 @@ static int llog_client_next_block(const struct lu_env *env,
         struct ptlrpc_request *req = NULL;
         struct llogd_body     *body;
         void                  *ptr;
+	int		       bulk = len;
+	int		       size;
         int                    rc;
         ENTRY;
 
+	if (llog_client_bulk_block(loghandle, cur_idx, next_idx, cur_offset,
+				   buf, len) == 0)
+		RETURN(0);
+
+	/* Ask for the following chunks of a plain llog too, such as a config
+	 * llog processed from the beginning to the end at mount. The old
+	 * servers only return one chunk. */
+	if (loghandle->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN &&
+	    len == LLOG_MIN_CHUNK_SIZE)
+		bulk = LLOG_BULK_SIZE;
+
         LLOG_CLIENT_ENTRY(loghandle->lgh_ctxt, imp);
         req = ptlrpc_request_alloc_pack(imp, &RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK,
                                         LUSTRE_LOG_VERSION,
@@ -161,10 +224,10 @@ static int llog_client_next_block(const struct lu_env *env,
         body->lgd_llh_flags = loghandle->lgh_hdr->llh_flags;
         body->lgd_index = next_idx;
         body->lgd_saved_index = *cur_idx;
-        body->lgd_len = len;
+	body->lgd_len = bulk;
         body->lgd_cur_offset = *cur_offset;
 
-        req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER, len);
+	req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER, bulk);
         ptlrpc_request_set_replen(req);
         rc = ptlrpc_queue_wait(req);
 	/* -EIO has a special meaning here. If llog_osd_next_block()
@@ -198,6 +261,21 @@ static int llog_client_next_block(const struct lu_env *env,
                 GOTO(out, rc =-EFAULT);
 
         memcpy(buf, ptr, len);
+
+	/* keep the following complete chunks for the next calls */
+	loghandle->lgh_bulk_len = 0;
+	size = req_capsule_get_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER);
+	size = min(size, bulk) - len;
+	if (size > 0 && !(size & (len - 1))) {
+		if (loghandle->lgh_bulk_buf == NULL)
+			OBD_ALLOC_LARGE(loghandle->lgh_bulk_buf,
+					LLOG_BULK_SIZE);
+		if (loghandle->lgh_bulk_buf != NULL) {
+			memcpy(loghandle->lgh_bulk_buf, ptr + len, size);
+			loghandle->lgh_bulk_offset = *cur_offset;
+			loghandle->lgh_bulk_len = size;
+		}
+	}
         EXIT;
 out:
         ptlrpc_req_finished(req);
@@ -111,6 +111,36 @@ out_ctxt:
 	return rc;
 }
 
+/**
+ * Read the complete chunks of a plain llog from \a offset for the bulk reply
+ * of LLOG_ORIGIN_HANDLE_NEXT_BLOCK. The chunk being written at the end of the
+ * llog is not returned, so the client can use the chunks without checking the
+ * llog size again.
+ *
+ * \retval	bytes of the chunks read into \a buf
+ */
+static int llog_origin_read_chunks(const struct lu_env *env,
+				   struct llog_handle *loghandle, __u64 offset,
+				   char *buf, int len)
+{
+	struct dt_object *o = loghandle->lgh_obj;
+	struct lu_buf lb = { .lb_buf = buf, .lb_len = len };
+	loff_t pos = offset;
+	int rc;
+
+	if (o == NULL || dt_object_remote(o) ||
+	    !(loghandle->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN) ||
+	    loghandle->lgh_hdr->llh_hdr.lrh_len != LLOG_MIN_CHUNK_SIZE ||
+	    offset & (LLOG_MIN_CHUNK_SIZE - 1))
+		return 0;
+
+	rc = dt_read(env, o, &lb, &pos);
+	if (rc <= 0)
+		return 0;
+
+	return rc & ~(LLOG_MIN_CHUNK_SIZE - 1);
+}
+
 int llog_origin_handle_next_block(struct ptlrpc_request *req)
 {
 	struct llog_handle	*loghandle;
@@ -119,6 +149,7 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
 	struct llog_ctxt	*ctxt;
 	__u32			 flags;
 	void			*ptr;
+	int			 bulk = 0;
 	int			 rc;
 
 	ENTRY;
@@ -127,8 +158,14 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
 	if (body == NULL)
 		RETURN(err_serious(-EFAULT));
 
+	/* the old clients ask for one chunk only */
+	if (body->lgd_len > LLOG_MIN_CHUNK_SIZE &&
+	    !(body->lgd_len & (LLOG_MIN_CHUNK_SIZE - 1)))
+		bulk = min_t(int, body->lgd_len, LLOG_BULK_SIZE) -
+		       LLOG_MIN_CHUNK_SIZE;
+
 	req_capsule_set_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER,
-			     LLOG_MIN_CHUNK_SIZE);
+			     LLOG_MIN_CHUNK_SIZE + bulk);
 	rc = req_capsule_server_pack(&req->rq_pill);
 	if (rc)
 		RETURN(err_serious(-ENOMEM));
@@ -162,6 +199,13 @@ int llog_origin_handle_next_block(struct ptlrpc_request *req)
 			     &repbody->lgd_saved_index, repbody->lgd_index,
 			     &repbody->lgd_cur_offset, ptr,
 			     LLOG_MIN_CHUNK_SIZE);
+	if (rc == 0 && bulk > 0)
+		bulk = llog_origin_read_chunks(req->rq_svc_thread->t_env,
+					       loghandle,
+					       repbody->lgd_cur_offset,
+					       ptr + LLOG_MIN_CHUNK_SIZE, bulk);
+	else
+		bulk = 0;
 	if (rc)
 		GOTO(out_close, rc);
 	EXIT;
@@ -169,6 +213,11 @@ out_close:
 	llog_origin_close(req->rq_svc_thread->t_env, loghandle);
 out_ctxt:
 	llog_ctxt_put(ctxt);
+	/* the client takes the size of the reply data as the bytes read */
+	if (req_capsule_get_size(&req->rq_pill, &RMF_EADATA, RCL_SERVER) >
+	    LLOG_MIN_CHUNK_SIZE + bulk)
+		req_capsule_shrink(&req->rq_pill, &RMF_EADATA,
+				   LLOG_MIN_CHUNK_SIZE + bulk, RCL_SERVER);
 	return rc;
 }
 
@@ -96,6 +96,7 @@ static struct ll_rpc_opcode {
 	{ MDS_HSM_CT_UNREGISTER, "mds_hsm_ct_unregister" },
 	{ MDS_SWAP_LAYOUTS,	"mds_swap_layouts" },
 	{ MDS_RMFID,		"mds_rmfid" },
+	{ MDS_BATCH,		"mds_batch" },
         { LDLM_ENQUEUE,     "ldlm_enqueue" },
         { LDLM_CONVERT,     "ldlm_convert" },
         { LDLM_CANCEL,      "ldlm_cancel" },
@@ -479,6 +480,37 @@ static ssize_t threads_max_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(threads_max);
 
+static ssize_t threads_wait_target_us_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+
+	return sprintf(buf, "%d\n", svc->srv_wait_target_us);
+}
+
+static ssize_t threads_wait_target_us_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct ptlrpc_service *svc = container_of(kobj, struct ptlrpc_service,
+						  srv_kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > INT_MAX)
+		return -ERANGE;
+
+	svc->srv_wait_target_us = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(threads_wait_target_us);
+
 /**
  * Translates \e ptlrpc_nrs_pol_state values to human-readable strings.
  *
@@ -1122,6 +1154,56 @@ static int ptlrpc_lprocfs_timeouts_seq_show(struct seq_file *m, void *n)
 
 LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_timeouts);
 
+static int ptlrpc_lprocfs_req_wait_hist_seq_show(struct seq_file *m, void *n)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	struct obd_histogram		*hist;
+	unsigned long			 tot;
+	unsigned long			 cum;
+	int				 i;
+	int				 j;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		hist = &svcpt->scp_req_wait_hist;
+		tot = lprocfs_oh_sum(hist);
+		cum = 0;
+
+		seq_printf(m, "cpt %d: threads %d avg %ld usec\n",
+			   svcpt->scp_cpt, svcpt->scp_nthrs_running,
+			   svcpt->scp_req_wait_avg);
+		seq_printf(m, "wait usec             reqs   %% cum %%\n");
+		for (j = 0; j < OBD_HIST_MAX && cum < tot; j++) {
+			unsigned long r = hist->oh_buckets[j];
+
+			cum += r;
+			seq_printf(m, "%u:\t\t%10lu %3u %3u\n", 1U << j, r,
+				   pct(r, tot), pct(cum, tot));
+		}
+		seq_printf(m, "\n");
+	}
+
+	return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_req_wait_hist_seq_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *off)
+{
+	struct seq_file			*m = file->private_data;
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	int				 i;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc)
+		lprocfs_oh_clear(&svcpt->scp_req_wait_hist);
+
+	return count;
+}
+
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_req_wait_hist);
+
 static ssize_t high_priority_ratio_show(struct kobject *kobj,
 					struct attribute *attr,
 					char *buf)
@@ -1158,6 +1240,7 @@ static struct attribute *ptlrpc_svc_attrs[] = {
 	&lustre_attr_threads_min.attr,
 	&lustre_attr_threads_started.attr,
 	&lustre_attr_threads_max.attr,
+	&lustre_attr_threads_wait_target_us.attr,
 	&lustre_attr_high_priority_ratio.attr,
 	NULL,
 };
@@ -1207,6 +1290,9 @@ void ptlrpc_ldebugfs_register_service(struct dentry *entry,
 		{ .name = "timeouts",
 		  .fops = &ptlrpc_lprocfs_timeouts_fops,
 		  .data = svc },
+		{ .name = "req_wait_hist",
+		  .fops = &ptlrpc_lprocfs_req_wait_hist_fops,
+		  .data = svc },
 		{ .name = "nrs_policies",
 		  .fops = &ptlrpc_lprocfs_nrs_fops,
 		  .data = svc },
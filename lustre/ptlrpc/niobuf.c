@@ -633,7 +633,8 @@ int ptlrpc_send_reply(struct ptlrpc_request *req, int flags)
         if (unlikely(rc))
                 goto out;
 
-	req->rq_sent = ktime_get_real_seconds();
+	req->rq_reply_sent = ktime_get_real();
+	req->rq_sent = ktime_to_timespec64(req->rq_reply_sent).tv_sec;
 
 	rc = ptl_send_buf(&rs->rs_md_h, rs->rs_repbuf, rs->rs_repdata_len,
 			  (rs->rs_difficult && !rs->rs_no_ack) ?
@@ -674,10 +675,7 @@ int ptlrpc_send_error(struct ptlrpc_request *req, int may_be_difficult)
                         RETURN(rc);
         }
 
-        if (req->rq_status != -ENOSPC && req->rq_status != -EACCES &&
-	    req->rq_status != -EPERM && req->rq_status != -ENOENT &&
-	    req->rq_status != -EINPROGRESS && req->rq_status != -EDQUOT)
-                req->rq_type = PTL_RPC_MSG_ERR;
+	ptlrpc_error_set_type(req);
 
         rc = ptlrpc_send_reply(req, may_be_difficult);
         RETURN(rc);
@@ -898,6 +896,7 @@ int ptl_send_rpc(struct ptlrpc_request *request, int noreply)
 	   add the network latency for our local timeout. */
         request->rq_deadline = request->rq_sent + request->rq_timeout +
                 ptlrpc_at_get_net_latency(request);
+	ptlrpc_req_arm_timer(request, request->rq_deadline);
 
 	DEBUG_REQ(D_INFO, request, "send flg=%x",
 		  lustre_msg_get_flags(request->rq_reqmsg));
@@ -497,6 +497,7 @@ int nodemap_add_idmap_helper(struct lu_nodemap *nodemap,
 out_insert:
 	if (rc)
 		OBD_FREE_PTR(idmap);
+	idmap_snap_build(nodemap);
 	up_write(&nodemap->nm_idmap_lock);
 	nm_member_revoke_locks(nodemap);
 
@@ -572,6 +573,7 @@ int nodemap_del_idmap(const char *name, enum nodemap_id_type id_type,
 	} else {
 		idmap_delete(id_type, idmap, nodemap);
 		rc = nodemap_idx_idmap_del(nodemap, id_type, map);
+		idmap_snap_build(nodemap);
 	}
 	up_write(&nodemap->nm_idmap_lock);
 
@@ -660,7 +662,9 @@ __u32 nodemap_map_id(struct lu_nodemap *nodemap,
 		     enum nodemap_tree_type tree_type, __u32 id)
 {
 	struct lu_idmap		*idmap = NULL;
+	struct lu_idmap_snap	*snap;
 	__u32			 found_id;
+	bool			 found;
 
 	ENTRY;
 
@@ -689,6 +693,18 @@ __u32 nodemap_map_id(struct lu_nodemap *nodemap,
 	if (is_default_nodemap(nodemap))
 		goto squash;
 
+	rcu_read_lock();
+	snap = rcu_dereference(nodemap->nm_idmap_snap);
+	if (snap != NULL) {
+		found = idmap_snap_search(snap, tree_type, id_type, id,
+					  &found_id);
+		rcu_read_unlock();
+		if (!found)
+			goto squash;
+		RETURN(found_id);
+	}
+	rcu_read_unlock();
+
 	down_read(&nodemap->nm_idmap_lock);
 	idmap = idmap_search(nodemap, tree_type, id_type, id);
 	if (idmap == NULL) {
@@ -1157,6 +1173,9 @@ struct lu_nodemap *nodemap_create(const char *name,
 	nodemap->nm_client_to_fs_uidmap = RB_ROOT;
 	nodemap->nm_fs_to_client_gidmap = RB_ROOT;
 	nodemap->nm_client_to_fs_gidmap = RB_ROOT;
+	down_write(&nodemap->nm_idmap_lock);
+	idmap_snap_build(nodemap);
+	up_write(&nodemap->nm_idmap_lock);
 
 	if (is_default) {
 		nodemap->nm_id = LUSTRE_NODEMAP_DEFAULT_ID;
@@ -1718,6 +1737,8 @@ void nodemap_mod_exit(void)
 {
 	nodemap_config_dealloc(active_config);
 	nodemap_procfs_exit();
+	/* wait for the idmap snapshots of the nodemaps to be freed */
+	rcu_barrier();
 }
 
 /**
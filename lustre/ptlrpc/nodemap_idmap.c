@@ -57,6 +57,147 @@ struct lu_idmap *idmap_create(__u32 client_id, __u32 fs_id)
 	return idmap;
 }
 
+static void idmap_snap_free(struct rcu_head *head)
+{
+	struct lu_idmap_snap *snap;
+
+	snap = container_of(head, struct lu_idmap_snap, is_rcu);
+	OBD_FREE_LARGE(snap, snap->is_size);
+}
+
+/*
+ * unpublish the snapshot of the idmaps before changing the trees, under
+ * the write lock.
+ */
+static void idmap_snap_drop(struct lu_nodemap *nodemap)
+{
+	struct lu_idmap_snap *snap;
+
+	snap = rcu_dereference_protected(nodemap->nm_idmap_snap, 1);
+	if (snap != NULL) {
+		RCU_INIT_POINTER(nodemap->nm_idmap_snap, NULL);
+		call_rcu(&snap->is_rcu, idmap_snap_free);
+	}
+}
+
+static int idmap_tree_count(struct rb_root *root)
+{
+	struct rb_node *node;
+	int count = 0;
+
+	for (node = rb_first(root); node != NULL; node = rb_next(node))
+		count++;
+
+	return count;
+}
+
+static void idmap_snap_fill(struct lu_idmap_pair *pairs, struct rb_root *root,
+			    enum nodemap_tree_type tree_type)
+{
+	struct rb_node *node;
+	struct lu_idmap *idmap;
+
+	for (node = rb_first(root); node != NULL; node = rb_next(node)) {
+		if (tree_type == NODEMAP_FS_TO_CLIENT) {
+			idmap = rb_entry(node, struct lu_idmap,
+					 id_fs_to_client);
+			pairs->ip_key = idmap->id_fs;
+			pairs->ip_id = idmap->id_client;
+		} else {
+			idmap = rb_entry(node, struct lu_idmap,
+					 id_client_to_fs);
+			pairs->ip_key = idmap->id_client;
+			pairs->ip_id = idmap->id_fs;
+		}
+		pairs++;
+	}
+}
+
+/**
+ * Publish a sorted copy of the idmap trees of \a nodemap
+ *
+ * Called with nm_idmap_lock held for write once the trees are changed.
+ * nodemap_map_id() searches the trees under the read lock as long as
+ * there is no copy, e.g. if it cannot be allocated.
+ *
+ * \param	nodemap		nodemap to copy the idmaps of
+ */
+void idmap_snap_build(struct lu_nodemap *nodemap)
+{
+	struct lu_idmap_snap *snap;
+	struct lu_idmap_pair *pairs;
+	int uids;
+	int gids;
+	int size;
+
+	idmap_snap_drop(nodemap);
+
+	uids = idmap_tree_count(&nodemap->nm_client_to_fs_uidmap);
+	gids = idmap_tree_count(&nodemap->nm_client_to_fs_gidmap);
+	size = offsetof(struct lu_idmap_snap, is_pairs[2 * (uids + gids)]);
+	OBD_ALLOC_LARGE(snap, size);
+	if (snap == NULL)
+		return;
+
+	snap->is_size = size;
+	snap->is_count[NODEMAP_UID] = uids;
+	snap->is_count[NODEMAP_GID] = gids;
+	pairs = snap->is_pairs;
+	snap->is_maps[NODEMAP_UID][NODEMAP_FS_TO_CLIENT] = pairs;
+	idmap_snap_fill(pairs, &nodemap->nm_fs_to_client_uidmap,
+			NODEMAP_FS_TO_CLIENT);
+	pairs += uids;
+	snap->is_maps[NODEMAP_UID][NODEMAP_CLIENT_TO_FS] = pairs;
+	idmap_snap_fill(pairs, &nodemap->nm_client_to_fs_uidmap,
+			NODEMAP_CLIENT_TO_FS);
+	pairs += uids;
+	snap->is_maps[NODEMAP_GID][NODEMAP_FS_TO_CLIENT] = pairs;
+	idmap_snap_fill(pairs, &nodemap->nm_fs_to_client_gidmap,
+			NODEMAP_FS_TO_CLIENT);
+	pairs += gids;
+	snap->is_maps[NODEMAP_GID][NODEMAP_CLIENT_TO_FS] = pairs;
+	idmap_snap_fill(pairs, &nodemap->nm_client_to_fs_gidmap,
+			NODEMAP_CLIENT_TO_FS);
+
+	rcu_assign_pointer(nodemap->nm_idmap_snap, snap);
+}
+
+/**
+ * Binary search of an id in a snapshot of the idmaps, under rcu_read_lock
+ *
+ * \param	snap		snapshot of the idmaps of a nodemap
+ * \param	tree_type	NODEMAP_FS_TO_CLIENT or NODEMAP_CLIENT_TO_FS
+ * \param	id_type		NODEMAP_UID or NODEMAP_GID
+ * \param	id		numeric id for which to search
+ * \param	mapped_id	id \a id is mapped to
+ *
+ * \retval	true if \a id is mapped
+ */
+bool idmap_snap_search(const struct lu_idmap_snap *snap,
+		       enum nodemap_tree_type tree_type,
+		       enum nodemap_id_type id_type, __u32 id,
+		       __u32 *mapped_id)
+{
+	const struct lu_idmap_pair *pairs = snap->is_maps[id_type][tree_type];
+	int lo = 0;
+	int hi = snap->is_count[id_type] - 1;
+	int mid;
+
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		if (id < pairs[mid].ip_key) {
+			hi = mid - 1;
+		} else if (id > pairs[mid].ip_key) {
+			lo = mid + 1;
+		} else {
+			*mapped_id = pairs[mid].ip_id;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static void idmap_destroy(struct lu_idmap *idmap)
 
 {
@@ -151,6 +292,7 @@ struct lu_idmap *idmap_insert(enum nodemap_id_type id_type,
 	if (!fwd_found && !bck_found) {
 		CDEBUG(D_INFO, "Insert a new idmap %d:%d\n",
 		       idmap->id_client, idmap->id_fs);
+		idmap_snap_drop(nodemap);
 		rb_link_node(&idmap->id_client_to_fs, fwd_parent, fwd_node);
 		rb_insert_color(&idmap->id_client_to_fs, fwd_root);
 		rb_link_node(&idmap->id_fs_to_client, bck_parent, bck_node);
@@ -184,6 +326,7 @@ void idmap_delete(enum nodemap_id_type id_type, struct lu_idmap *idmap,
 		bck_root = &nodemap->nm_fs_to_client_gidmap;
 	}
 
+	idmap_snap_drop(nodemap);
 	rb_erase(&idmap->id_client_to_fs, fwd_root);
 	rb_erase(&idmap->id_fs_to_client, bck_root);
 
@@ -265,6 +408,8 @@ void idmap_delete_tree(struct lu_nodemap *nodemap)
 	struct lu_idmap		*temp;
 	struct rb_root		root;
 
+	idmap_snap_drop(nodemap);
+
 	root = nodemap->nm_fs_to_client_uidmap;
 	nm_rbtree_postorder_for_each_entry_safe(idmap, temp, &root,
 						id_fs_to_client) {
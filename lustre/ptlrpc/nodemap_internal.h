@@ -78,6 +78,25 @@ struct lu_idmap {
 	struct rb_node	id_fs_to_client;
 };
 
+struct lu_idmap_pair {
+	/* id looked up */
+	__u32		ip_key;
+	/* id it is mapped to */
+	__u32		ip_id;
+};
+
+/* sorted copy of the idmap trees of a nodemap, for the per-request lookups
+ * done without taking nm_idmap_lock */
+struct lu_idmap_snap {
+	struct rcu_head		 is_rcu;
+	int			 is_size;
+	/* number of idmaps of each id type */
+	int			 is_count[2];
+	/* maps indexed by id type and tree type, in is_pairs */
+	struct lu_idmap_pair	*is_maps[2][2];
+	struct lu_idmap_pair	 is_pairs[0];
+};
+
 /* first 4 bits of the nodemap_id is the index type */
 struct nodemap_key {
 	__u32 nk_nodemap_id;
@@ -151,6 +170,11 @@ struct lu_idmap *idmap_search(struct lu_nodemap *nodemap,
 			      enum nodemap_tree_type,
 			      enum nodemap_id_type id_type,
 			      __u32 id);
+void idmap_snap_build(struct lu_nodemap *nodemap);
+bool idmap_snap_search(const struct lu_idmap_snap *snap,
+		       enum nodemap_tree_type tree_type,
+		       enum nodemap_id_type id_type, __u32 id,
+		       __u32 *mapped_id);
 int nm_member_add(struct lu_nodemap *nodemap, struct obd_export *exp);
 void nm_member_del(struct lu_nodemap *nodemap, struct obd_export *exp);
 void nm_member_delete_list(struct lu_nodemap *nodemap);
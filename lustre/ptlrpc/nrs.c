@@ -52,6 +52,11 @@
  */
 struct nrs_core nrs_core;
 
+int nrs_dary_heap = 1;
+module_param(nrs_dary_heap, int, 0644);
+MODULE_PARM_DESC(nrs_dary_heap,
+		 "use 4-ary instead of binary heaps for policies started later");
+
 static int nrs_policy_init(struct ptlrpc_nrs_policy *policy)
 {
 	return policy->pol_desc->pd_ops->op_policy_init != NULL ?
@@ -1817,6 +1822,10 @@ int ptlrpc_nrs_init(void)
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_delay);
 	if (rc != 0)
 		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_edf);
+	if (rc != 0)
+		GOTO(fail, rc);
 #endif /* HAVE_SERVER_SUPPORT */
 
 	RETURN(rc);
@@ -190,7 +190,7 @@ static int nrs_crrn_start(struct ptlrpc_nrs_policy *policy, char *arg)
 		RETURN(-ENOMEM);
 
 	net->cn_binheap = cfs_binheap_create(&nrs_crrn_heap_ops,
-					     CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					     nrs_heap_flags(), 4096, NULL,
 					     nrs_pol2cptab(policy),
 					     nrs_pol2cptid(policy));
 	if (net->cn_binheap == NULL)
@@ -118,7 +118,7 @@ static int nrs_delay_start(struct ptlrpc_nrs_policy *policy, char *arg)
 		RETURN(-ENOMEM);
 
 	delay_data->delay_binheap = cfs_binheap_create(&nrs_delay_heap_ops,
-						       CBH_FLAG_ATOMIC_GROW,
+						       nrs_heap_flags(),
 						       4096, NULL,
 						       nrs_pol2cptab(policy),
 						       nrs_pol2cptid(policy));
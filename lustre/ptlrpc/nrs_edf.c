@@ -0,0 +1,410 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_edf.c
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ * This policy handles first the request whose deadline comes first.
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <obd_support.h>
+#include <obd_class.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name edf
+ *
+ * The deadline of a request is the time by which its client expects a reply,
+ * computed at arrival from the timeout the client sends with the request, see
+ * ptlrpc_server_handle_req_in(). When a server falls behind, FIFO keeps
+ * handling requests in arrival order, so the requests of clients with short
+ * timeouts expire behind the ones of clients that can wait, and are resent,
+ * adding to the load. EDF handles the most urgent requests first instead.
+ *
+ * Requests whose deadline is close get early replies from the adaptive
+ * timeout code while they are queued, which pushes rq_deadline back. The
+ * heap is ordered by the deadline the request had when queued, so that such
+ * requests, which have been waiting the longest already, are not delayed
+ * further. Requests past their deadline come out of the heap first, and are
+ * dropped without being handled by ptlrpc_server_handle_request(), so that
+ * they do not hold the other ones up.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_EDF	"edf"
+
+/**
+ * Binary heap predicate.
+ *
+ * Elements are sorted by the deadline the requests had when queued, and by
+ * arrival order for requests with the same deadline.
+ *
+ * \retval 0 deadline(e1) > deadline(e2)
+ * \retval 1 deadline(e1) <= deadline(e2)
+ */
+static int edf_req_compare(struct cfs_binheap_node *e1,
+			   struct cfs_binheap_node *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (nrq1->nr_u.edf.er_deadline != nrq2->nr_u.edf.er_deadline)
+		return nrq1->nr_u.edf.er_deadline < nrq2->nr_u.edf.er_deadline;
+
+	return nrq1->nr_u.edf.er_sequence <= nrq2->nr_u.edf.er_sequence;
+}
+
+static struct cfs_binheap_ops nrs_edf_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= edf_req_compare,
+};
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes
+ * the EDF-specific private data structure.
+ *
+ * \param[in] policy The policy to start
+ * \param[in] Generic char buffer; unused in this policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_edf_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_edf_head *head;
+
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	head->eh_binheap = cfs_binheap_create(&nrs_edf_heap_ops,
+					      nrs_heap_flags(), 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->eh_binheap == NULL) {
+		OBD_FREE_PTR(head);
+		RETURN(-ENOMEM);
+	}
+
+	policy->pol_private = head;
+
+	RETURN(0);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the EDF-specific
+ * private data structure.
+ *
+ * \param[in] policy The policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_edf_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+
+	LASSERT(head != NULL);
+	LASSERT(head->eh_binheap != NULL);
+	LASSERT(cfs_binheap_is_empty(head->eh_binheap));
+
+	cfs_binheap_destroy(head->eh_binheap);
+
+	OBD_FREE_PTR(head);
+}
+
+/**
+ * Is called for obtaining an EDF policy resource.
+ *
+ * \param[in]  policy	  The policy on which the request is being asked for
+ * \param[in]  nrq	  The request for which resources are being taken
+ * \param[in]  parent	  Parent resource, unused in this policy
+ * \param[out] resp	  Resources references are placed in this array
+ * \param[in]  moving_req Signifies limited caller context; unused in this
+ *			  policy
+ *
+ * \retval 1 The EDF policy only has a one-level resource hierarchy
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_edf_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	*resp = &((struct nrs_edf_head *)policy->pol_private)->eh_res;
+	return 1;
+}
+
+/**
+ * Called when getting a request from the EDF policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Force the policy to return a request; unused in this
+ *		     policy
+ *
+ * \retval The request to be handled; this is the request with the earliest
+ *	   deadline
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_edf_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct cfs_binheap_node *node;
+	struct ptlrpc_nrs_request *nrq;
+	struct ptlrpc_request *req;
+
+	node = cfs_binheap_root(head->eh_binheap);
+	if (unlikely(node == NULL))
+		return NULL;
+
+	nrq = container_of(node, struct ptlrpc_nrs_request, nr_node);
+	if (likely(!peek)) {
+		cfs_binheap_remove(head->eh_binheap, &nrq->nr_node);
+
+		req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+		if (ktime_get_real_seconds() > req->rq_deadline)
+			head->eh_expired++;
+
+		CDEBUG(D_RPCTRACE, "NRS: starting to handle %s request from "
+		       "%s, deadline %lld:%lld\n", policy->pol_desc->pd_name,
+		       libcfs_id2str(req->rq_peer),
+		       (s64)(nrq->nr_u.edf.er_deadline -
+			     req->rq_srv.sr_arrival_time.tv_sec),
+		       (s64)(req->rq_deadline -
+			     req->rq_srv.sr_arrival_time.tv_sec));
+	}
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to an EDF \a policy instance's set of queued requests
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0 request added
+ * \retval != 0 error
+ */
+static int nrs_edf_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	nrq->nr_u.edf.er_deadline = req->rq_deadline;
+	nrq->nr_u.edf.er_sequence = head->eh_sequence++;
+
+	return cfs_binheap_insert(head->eh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Removes request \a nrq from \a policy's set of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_edf_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+
+	cfs_binheap_remove(head->eh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Prints a debug statement right before the request \a nrq stops being
+ * handled.
+ *
+ * \param[in] policy The policy handling the request
+ * \param[in] nrq    The request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_edf_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	CDEBUG(D_RPCTRACE, "NRS: finished handling %s request from %s, "
+	       "seq: %llu\n", policy->pol_desc->pd_name,
+	       libcfs_id2str(req->rq_peer), nrq->nr_u.edf.er_sequence);
+}
+
+/**
+ * Performs ctl functions specific to EDF policy instances; similar to ioctl
+ *
+ * \param[in]     policy the policy instance
+ * \param[in]     opc    the opcode
+ * \param[in,out] arg    used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_edf_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_edf)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_EDF_RD_EXPIRED:
+		*(__u64 *)arg = head->eh_expired;
+		break;
+	}
+	RETURN(0);
+}
+
+/**
+ * debugfs interface
+ */
+
+#define LPROCFS_NRS_EDF_EXPIRED_NAME_REG	"reg_expired:"
+#define LPROCFS_NRS_EDF_EXPIRED_NAME_HP		"hp_expired:"
+
+/**
+ * Retrieves the number of requests handled past their deadline by EDF policy
+ * instances on both the regular and high-priority NRS head of a service, as
+ * long as a policy instance is not in the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+ */
+static int
+ptlrpc_lprocfs_nrs_edf_expired_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	__u64 expired;
+	int rc;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_EXPIRED,
+				       true, &expired);
+	if (rc == 0)
+		seq_printf(m, LPROCFS_NRS_EDF_EXPIRED_NAME_REG"%llu\n",
+			   expired);
+		/**
+		 * Ignore -ENODEV as the regular NRS head's policy may be in
+		 * the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	else if (rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_EXPIRED,
+				       true, &expired);
+	if (rc == 0)
+		seq_printf(m, LPROCFS_NRS_EDF_EXPIRED_NAME_HP"%llu\n",
+			   expired);
+		/**
+		 * Ignore -ENODEV as the high priority NRS head's policy may be
+		 * in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	else if (rc == -ENODEV)
+		rc = 0;
+
+	return rc;
+}
+LDEBUGFS_SEQ_FOPS_RO(ptlrpc_lprocfs_nrs_edf_expired);
+
+static int nrs_edf_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_edf_lprocfs_vars[] = {
+		{ .name		= "nrs_edf_expired",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_expired_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (IS_ERR_OR_NULL(svc->srv_debugfs_entry))
+		return 0;
+
+	return ldebugfs_add_vars(svc->srv_debugfs_entry, nrs_edf_lprocfs_vars,
+				 NULL);
+}
+
+/**
+ * EDF policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_edf_ops = {
+	.op_policy_start	= nrs_edf_start,
+	.op_policy_stop		= nrs_edf_stop,
+	.op_policy_ctl		= nrs_edf_ctl,
+	.op_res_get		= nrs_edf_res_get,
+	.op_req_get		= nrs_edf_req_get,
+	.op_req_enqueue		= nrs_edf_req_add,
+	.op_req_dequeue		= nrs_edf_req_del,
+	.op_req_stop		= nrs_edf_req_stop,
+	.op_lprocfs_init	= nrs_edf_lprocfs_init,
+};
+
+/**
+ * EDF policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_edf = {
+	.nc_name		= NRS_POL_NAME_EDF,
+	.nc_ops			= &nrs_edf_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} edf */
+
+/** @} nrs */
@@ -633,7 +633,7 @@ static int nrs_orr_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	 * Binary heap instance for sorted incoming requests.
 	 */
 	orrd->od_binheap = cfs_binheap_create(&nrs_orr_heap_ops,
-					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_heap_flags(), 4096, NULL,
 					      nrs_pol2cptab(policy),
 					      nrs_pol2cptid(policy));
 	if (orrd->od_binheap == NULL)
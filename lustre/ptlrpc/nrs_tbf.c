@@ -82,13 +82,19 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 
 #define NRS_TBF_DEFAULT_RULE "default"
 
+static void nrs_tbf_rule_put(struct nrs_tbf_rule *rule);
+static void nrs_tbf_index_free(struct nrs_tbf_rule *rule);
+
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
 	LASSERT(list_empty(&rule->tr_cli_list));
 	LASSERT(list_empty(&rule->tr_linkage));
 
+	nrs_tbf_index_free(rule);
 	rule->tr_head->th_ops->o_rule_fini(rule);
+	if (rule->tr_parent != NULL)
+		nrs_tbf_rule_put(rule->tr_parent);
 	OBD_FREE_PTR(rule);
 }
 
@@ -168,7 +174,16 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, m);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, m);
+	if (rc)
+		return rc;
+
+	if (rule->tr_parent != NULL)
+		seq_printf(m, ", parent %s", rule->tr_parent->tr_name);
+	seq_printf(m, "\n");
+	return 0;
 }
 
 static int
@@ -223,23 +238,340 @@ nrs_tbf_rule_find(struct nrs_tbf_head *head,
 	return rule;
 }
 
+static unsigned int
+nrs_tbf_index_hash(enum nrs_tbf_field field, __u32 value, const char *jobid)
+{
+	if (jobid != NULL)
+		value = cfs_hash_djb2_hash(jobid, strlen(jobid), ~0U);
+
+	return hash_32(value ^ field, NRS_TBF_INDEX_BITS);
+}
+
+static struct nrs_tbf_index_node *
+nrs_tbf_index_node_add(struct nrs_tbf_rule *rule, enum nrs_tbf_field field)
+{
+	struct nrs_tbf_index_node *tin;
+
+	OBD_ALLOC_PTR(tin);
+	if (tin == NULL)
+		return NULL;
+
+	tin->tin_rule = rule;
+	tin->tin_field = field;
+	INIT_LIST_HEAD(&tin->tin_linkage);
+	INIT_LIST_HEAD(&tin->tin_same);
+	interval_init(&tin->tin_interval);
+	list_add_tail(&tin->tin_rule_linkage, &rule->tr_index);
+	return tin;
+}
+
+static void nrs_tbf_index_free(struct nrs_tbf_rule *rule)
+{
+	struct nrs_tbf_index_node *tin;
+
+	while (!list_empty(&rule->tr_index)) {
+		tin = list_entry(rule->tr_index.next, struct nrs_tbf_index_node,
+				 tin_rule_linkage);
+		LASSERT(list_empty(&tin->tin_linkage));
+		LASSERT(!interval_is_intree(&tin->tin_interval));
+		list_del(&tin->tin_rule_linkage);
+		OBD_FREE_PTR(tin);
+	}
+}
+
+/* Add an entry for @rule to the rules checked for every client. */
+static int nrs_tbf_index_all(struct nrs_tbf_rule *rule)
+{
+	if (nrs_tbf_index_node_add(rule, NRS_TBF_FIELD_MAX) == NULL)
+		return -ENOMEM;
+	return 0;
+}
+
+/*
+ * The following helpers add the entries of @rule for the values of a field
+ * it matches, or return -EINVAL without adding any if they cannot be indexed.
+ */
+static int nrs_tbf_index_nids(struct nrs_tbf_rule *rule,
+			      struct list_head *nids)
+{
+	struct nrs_tbf_index_node *tin;
+	char min_str[LNET_NIDSTR_SIZE];
+	char max_str[LNET_NIDSTR_SIZE];
+	lnet_nid_t min;
+	lnet_nid_t max;
+
+	if (list_empty(nids))
+		return 0;
+
+	/* only the lists of a single contiguous range of a net */
+	if (cfs_nidrange_find_min_max(nids, min_str, max_str,
+				      LNET_NIDSTR_SIZE) != 0)
+		return -EINVAL;
+
+	min = libcfs_str2nid(min_str);
+	max = libcfs_str2nid(max_str);
+	if (min == LNET_NID_ANY || max == LNET_NID_ANY || min > max)
+		return -EINVAL;
+
+	tin = nrs_tbf_index_node_add(rule, NRS_TBF_FIELD_NID);
+	if (tin == NULL)
+		return -ENOMEM;
+
+	interval_set(&tin->tin_interval, min, max);
+	return 0;
+}
+
+static int nrs_tbf_index_jobids(struct nrs_tbf_rule *rule,
+				struct list_head *jobids)
+{
+	struct nrs_tbf_index_node *tin;
+	struct nrs_tbf_jobid *jobid;
+
+	list_for_each_entry(jobid, jobids, tj_linkage) {
+		if (jobid->tj_match_flag != NRS_TBF_MATCH_FULL)
+			return -EINVAL;
+	}
+
+	list_for_each_entry(jobid, jobids, tj_linkage) {
+		tin = nrs_tbf_index_node_add(rule, NRS_TBF_FIELD_JOBID);
+		if (tin == NULL)
+			return -ENOMEM;
+		tin->tin_jobid = jobid->tj_id;
+	}
+	return 0;
+}
+
+static int nrs_tbf_index_opcodes(struct nrs_tbf_rule *rule,
+				 struct cfs_bitmap *opcodes)
+{
+	struct nrs_tbf_index_node *tin;
+	int count = 0;
+	int opc;
+
+	if (opcodes == NULL)
+		return 0;
+
+	cfs_foreach_bit(opcodes, opc) {
+		if (++count > NRS_TBF_INDEX_MAX_OPCODES)
+			return -EINVAL;
+	}
+
+	cfs_foreach_bit(opcodes, opc) {
+		tin = nrs_tbf_index_node_add(rule, NRS_TBF_FIELD_OPCODE);
+		if (tin == NULL)
+			return -ENOMEM;
+		tin->tin_value = opc;
+	}
+	return 0;
+}
+
+static int nrs_tbf_index_ids(struct nrs_tbf_rule *rule,
+			     struct list_head *ids)
+{
+	struct nrs_tbf_index_node *tin;
+	struct nrs_tbf_id *nti_id;
+
+	list_for_each_entry(nti_id, ids, nti_linkage) {
+		if (nti_id->nti_id.ti_type != NRS_TBF_FLAG_UID &&
+		    nti_id->nti_id.ti_type != NRS_TBF_FLAG_GID)
+			return -EINVAL;
+	}
+
+	list_for_each_entry(nti_id, ids, nti_linkage) {
+		if (nti_id->nti_id.ti_type == NRS_TBF_FLAG_UID) {
+			tin = nrs_tbf_index_node_add(rule, NRS_TBF_FIELD_UID);
+			if (tin == NULL)
+				return -ENOMEM;
+			tin->tin_value = nti_id->nti_id.ti_uid;
+		} else {
+			tin = nrs_tbf_index_node_add(rule, NRS_TBF_FIELD_GID);
+			if (tin == NULL)
+				return -ENOMEM;
+			tin->tin_value = nti_id->nti_id.ti_gid;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Build the entries of the index for @rule, falling back to an entry checked
+ * for every client when its conditions cannot be indexed.
+ */
+static int nrs_tbf_rule_index_init(struct nrs_tbf_rule *rule)
+{
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_index(rule);
+	if (rc == -EINVAL) {
+		nrs_tbf_index_free(rule);
+		rc = nrs_tbf_index_all(rule);
+	}
+	if (rc)
+		nrs_tbf_index_free(rule);
+	return rc;
+}
+
+/* Must be called with th_rule_lock held */
+static void nrs_tbf_index_insert(struct nrs_tbf_head *head,
+				 struct nrs_tbf_rule *rule)
+{
+	struct nrs_tbf_index_node *tin;
+	struct interval_node *found;
+	unsigned int idx;
+
+	list_for_each_entry(tin, &rule->tr_index, tin_rule_linkage) {
+		switch (tin->tin_field) {
+		case NRS_TBF_FIELD_NID:
+			found = interval_insert(&tin->tin_interval,
+						&head->th_nid_tree);
+			if (found != NULL)
+				list_add(&tin->tin_same,
+					 &container_of(found,
+						       struct nrs_tbf_index_node,
+						       tin_interval)->tin_same);
+			break;
+		case NRS_TBF_FIELD_MAX:
+			list_add_tail(&tin->tin_linkage, &head->th_index_all);
+			break;
+		default:
+			idx = nrs_tbf_index_hash(tin->tin_field, tin->tin_value,
+						 tin->tin_jobid);
+			list_add_tail(&tin->tin_linkage, &head->th_index[idx]);
+			break;
+		}
+	}
+}
+
+/* Must be called with th_rule_lock held */
+static void nrs_tbf_index_remove(struct nrs_tbf_head *head,
+				 struct nrs_tbf_rule *rule)
+{
+	struct nrs_tbf_index_node *tin;
+	struct nrs_tbf_index_node *next;
+
+	list_for_each_entry(tin, &rule->tr_index, tin_rule_linkage) {
+		if (tin->tin_field != NRS_TBF_FIELD_NID) {
+			list_del_init(&tin->tin_linkage);
+			continue;
+		}
+
+		if (!interval_is_intree(&tin->tin_interval)) {
+			list_del_init(&tin->tin_same);
+			continue;
+		}
+
+		/* another entry with the same range takes the place of @tin */
+		interval_erase(&tin->tin_interval, &head->th_nid_tree);
+		if (!list_empty(&tin->tin_same)) {
+			next = list_entry(tin->tin_same.next,
+					  struct nrs_tbf_index_node, tin_same);
+			list_del_init(&tin->tin_same);
+			interval_set(&next->tin_interval,
+				     interval_low(&next->tin_interval),
+				     interval_high(&next->tin_interval));
+			interval_insert(&next->tin_interval,
+					&head->th_nid_tree);
+		}
+	}
+}
+
+/* Must be called with th_rule_lock held, after any change of th_list */
+static void nrs_tbf_rules_rank(struct nrs_tbf_head *head)
+{
+	struct nrs_tbf_rule *rule;
+	int rank = 0;
+
+	list_for_each_entry(rule, &head->th_list, tr_linkage)
+		rule->tr_rank = rank++;
+}
+
+struct nrs_tbf_match {
+	struct nrs_tbf_head	*tm_head;
+	struct nrs_tbf_client	*tm_cli;
+	/** First rule of the list matched so far. */
+	struct nrs_tbf_rule	*tm_rule;
+};
+
+static void nrs_tbf_match_check(struct nrs_tbf_match *tm,
+				struct nrs_tbf_rule *rule)
+{
+	LASSERT((rule->tr_flags & NTRS_STOPPING) == 0);
+	if (tm->tm_rule != NULL && tm->tm_rule->tr_rank <= rule->tr_rank)
+		return;
+
+	if (tm->tm_head->th_ops->o_rule_match(rule, tm->tm_cli))
+		tm->tm_rule = rule;
+}
+
+static void nrs_tbf_match_value(struct nrs_tbf_match *tm,
+				enum nrs_tbf_field field, __u32 value,
+				const char *jobid)
+{
+	struct nrs_tbf_index_node *tin;
+	struct list_head *bucket;
+
+	bucket = &tm->tm_head->th_index[nrs_tbf_index_hash(field, value,
+							   jobid)];
+	list_for_each_entry(tin, bucket, tin_linkage) {
+		if (tin->tin_field != field)
+			continue;
+		if (jobid != NULL ? strcmp(tin->tin_jobid, jobid) != 0 :
+		    tin->tin_value != value)
+			continue;
+		nrs_tbf_match_check(tm, tin->tin_rule);
+	}
+}
+
+static enum interval_iter nrs_tbf_match_nid_cb(struct interval_node *node,
+					       void *args)
+{
+	struct nrs_tbf_index_node *tin;
+	struct nrs_tbf_index_node *same;
+
+	tin = container_of(node, struct nrs_tbf_index_node, tin_interval);
+	nrs_tbf_match_check(args, tin->tin_rule);
+	list_for_each_entry(same, &tin->tin_same, tin_same)
+		nrs_tbf_match_check(args, same->tin_rule);
+
+	return INTERVAL_ITER_CONT;
+}
+
 static struct nrs_tbf_rule *
 nrs_tbf_rule_match(struct nrs_tbf_head *head,
 		   struct nrs_tbf_client *cli)
 {
-	struct nrs_tbf_rule *rule = NULL;
-	struct nrs_tbf_rule *tmp_rule;
+	struct nrs_tbf_index_node *tin;
+	struct interval_node_extent ext;
+	struct nrs_tbf_match tm = {
+		.tm_head	= head,
+		.tm_cli		= cli,
+	};
+	struct nrs_tbf_rule *rule;
 
 	spin_lock(&head->th_rule_lock);
-	/* Match the newest rule in the list */
-	list_for_each_entry(tmp_rule, &head->th_list, tr_linkage) {
-		LASSERT((tmp_rule->tr_flags & NTRS_STOPPING) == 0);
-		if (head->th_ops->o_rule_match(tmp_rule, cli)) {
-			rule = tmp_rule;
-			break;
-		}
+	/*
+	 * Match the newest rule in the list, among the rules indexed on the
+	 * fields of @cli and the rules which are not indexed.
+	 */
+	list_for_each_entry(tin, &head->th_index_all, tin_linkage)
+		nrs_tbf_match_check(&tm, tin->tin_rule);
+
+	if (head->th_nid_tree != NULL) {
+		ext.start = cli->tc_nid;
+		ext.end = cli->tc_nid;
+		interval_search(head->th_nid_tree, &ext, nrs_tbf_match_nid_cb,
+				&tm);
 	}
-
+	nrs_tbf_match_value(&tm, NRS_TBF_FIELD_JOBID, 0, cli->tc_jobid);
+	nrs_tbf_match_value(&tm, NRS_TBF_FIELD_OPCODE, cli->tc_opcode, NULL);
+	if (cli->tc_id.ti_type & NRS_TBF_FLAG_UID)
+		nrs_tbf_match_value(&tm, NRS_TBF_FIELD_UID,
+				    cli->tc_id.ti_uid, NULL);
+	if (cli->tc_id.ti_type & NRS_TBF_FLAG_GID)
+		nrs_tbf_match_value(&tm, NRS_TBF_FIELD_GID,
+				    cli->tc_id.ti_gid, NULL);
+
+	rule = tm.tm_rule;
 	if (rule == NULL)
 		rule = head->th_rule;
 
@@ -285,10 +617,13 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 {
 	struct nrs_tbf_rule	*rule;
 	struct nrs_tbf_rule	*tmp_rule;
-	struct nrs_tbf_rule	*next_rule;
+	struct nrs_tbf_rule	*next_rule = NULL;
+	struct nrs_tbf_rule	*parent = NULL;
 	char			*next_name = start->u.tc_start.ts_next_name;
+	char			*parent_name;
 	int			 rc;
 
+	parent_name = start->u.tc_start.ts_parent_name;
 	rule = nrs_tbf_rule_find(head, start->tc_name);
 	if (rule) {
 		nrs_tbf_rule_put(rule);
@@ -305,10 +640,13 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_nsecs = NSEC_PER_SEC;
 	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
 	rule->tr_depth = tbf_depth;
+	rule->tr_ntoken = rule->tr_depth;
+	rule->tr_check_time = ktime_to_ns(ktime_get());
 	atomic_set(&rule->tr_ref, 1);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
 	INIT_LIST_HEAD(&rule->tr_linkage);
+	INIT_LIST_HEAD(&rule->tr_index);
 	spin_lock_init(&rule->tr_rule_lock);
 	rule->tr_head = head;
 
@@ -318,6 +656,13 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		return rc;
 	}
 
+	rc = nrs_tbf_rule_index_init(rule);
+	if (rc) {
+		head->th_ops->o_rule_fini(rule);
+		OBD_FREE_PTR(rule);
+		return rc;
+	}
+
 	/* Add as the newest rule */
 	spin_lock(&head->th_rule_lock);
 	tmp_rule = nrs_tbf_rule_find_nolock(head, start->tc_name);
@@ -335,13 +680,39 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 			nrs_tbf_rule_put(rule);
 			return -ENOENT;
 		}
+	}
+
+	if (parent_name) {
+		parent = nrs_tbf_rule_find_nolock(head, parent_name);
+		if (parent == NULL)
+			rc = -ENOENT;
+		else if (parent->tr_level + 1 >= NRS_TBF_MAX_LEVELS)
+			rc = -E2BIG;
+		if (rc) {
+			spin_unlock(&head->th_rule_lock);
+			if (parent)
+				nrs_tbf_rule_put(parent);
+			if (next_rule)
+				nrs_tbf_rule_put(next_rule);
+			nrs_tbf_rule_put(rule);
+			return rc;
+		}
+
+		/* The reference on @parent is held by @rule */
+		rule->tr_parent = parent;
+		rule->tr_level = parent->tr_level + 1;
+		parent->tr_nchildren++;
+	}
 
+	if (next_rule) {
 		list_add(&rule->tr_linkage, next_rule->tr_linkage.prev);
 		nrs_tbf_rule_put(next_rule);
 	} else {
 		/* Add on the top of the rule list */
 		list_add(&rule->tr_linkage, &head->th_list);
 	}
+	nrs_tbf_index_insert(head, rule);
+	nrs_tbf_rules_rank(head);
 	spin_unlock(&head->th_rule_lock);
 	atomic_inc(&head->th_rule_sequence);
 	if (start->u.tc_start.ts_rule_flags & NTRS_DEFAULT) {
@@ -394,6 +765,7 @@ nrs_tbf_rule_change_rank(struct ptlrpc_nrs_policy *policy,
 		GOTO(out_put, rc = -ENOENT);
 
 	list_move(&rule->tr_linkage, next_rule->tr_linkage.prev);
+	nrs_tbf_rules_rank(head);
 	nrs_tbf_rule_put(next_rule);
 out_put:
 	nrs_tbf_rule_put(rule);
@@ -467,7 +839,19 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 	if (rule == NULL)
 		return -ENOENT;
 
+	spin_lock(&head->th_rule_lock);
+	if (rule->tr_nchildren > 0) {
+		spin_unlock(&head->th_rule_lock);
+		nrs_tbf_rule_put(rule);
+		return -EBUSY;
+	}
+	if (rule->tr_parent != NULL)
+		rule->tr_parent->tr_nchildren--;
 	list_del_init(&rule->tr_linkage);
+	nrs_tbf_index_remove(head, rule);
+	nrs_tbf_rules_rank(head);
+	spin_unlock(&head->th_rule_lock);
+
 	rule->tr_flags |= NTRS_STOPPING;
 	nrs_tbf_rule_put(rule);
 	nrs_tbf_rule_put(rule);
@@ -1003,7 +1387,7 @@ static int nrs_tbf_jobid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_jobid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_jobids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -1016,6 +1400,11 @@ nrs_tbf_jobid_rule_match(struct nrs_tbf_rule *rule,
 	return nrs_tbf_jobid_list_match(&rule->tr_jobids, cli->tc_jobid);
 }
 
+static int nrs_tbf_jobid_rule_index(struct nrs_tbf_rule *rule)
+{
+	return nrs_tbf_index_jobids(rule, &rule->tr_jobids);
+}
+
 static void nrs_tbf_jobid_rule_fini(struct nrs_tbf_rule *rule)
 {
 	if (!list_empty(&rule->tr_jobids))
@@ -1035,6 +1424,7 @@ static struct nrs_tbf_ops nrs_tbf_jobid_ops = {
 	.o_rule_dump = nrs_tbf_jobid_rule_dump,
 	.o_rule_match = nrs_tbf_jobid_rule_match,
 	.o_rule_fini = nrs_tbf_jobid_rule_fini,
+	.o_rule_index = nrs_tbf_jobid_rule_index,
 };
 
 /**
@@ -1208,7 +1598,7 @@ static int nrs_tbf_nid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_nid_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_nids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -1221,6 +1611,11 @@ nrs_tbf_nid_rule_match(struct nrs_tbf_rule *rule,
 	return cfs_match_nid(cli->tc_nid, &rule->tr_nids);
 }
 
+static int nrs_tbf_nid_rule_index(struct nrs_tbf_rule *rule)
+{
+	return nrs_tbf_index_nids(rule, &rule->tr_nids);
+}
+
 static void nrs_tbf_nid_rule_fini(struct nrs_tbf_rule *rule)
 {
 	if (!list_empty(&rule->tr_nids))
@@ -1277,6 +1672,7 @@ static struct nrs_tbf_ops nrs_tbf_nid_ops = {
 	.o_rule_dump = nrs_tbf_nid_rule_dump,
 	.o_rule_match = nrs_tbf_nid_rule_match,
 	.o_rule_fini = nrs_tbf_nid_rule_fini,
+	.o_rule_index = nrs_tbf_nid_rule_index,
 };
 
 static unsigned nrs_tbf_hop_hash(struct cfs_hash *hs, const void *key,
@@ -2023,6 +2419,49 @@ nrs_tbf_cond_match(struct nrs_tbf_rule *rule, struct nrs_tbf_client *cli)
 	return 0;
 }
 
+static int
+nrs_tbf_expression_index(struct nrs_tbf_rule *rule,
+			 struct nrs_tbf_expression *expr)
+{
+	switch (expr->te_field) {
+	case NRS_TBF_FIELD_NID:
+		return nrs_tbf_index_nids(rule, &expr->te_cond);
+	case NRS_TBF_FIELD_JOBID:
+		return nrs_tbf_index_jobids(rule, &expr->te_cond);
+	case NRS_TBF_FIELD_OPCODE:
+		return nrs_tbf_index_opcodes(rule, expr->te_opcodes);
+	case NRS_TBF_FIELD_UID:
+	case NRS_TBF_FIELD_GID:
+		return nrs_tbf_index_ids(rule, &expr->te_cond);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int
+nrs_tbf_generic_rule_index(struct nrs_tbf_rule *rule)
+{
+	struct nrs_tbf_conjunction *conjunction;
+	struct nrs_tbf_expression *expr;
+	int rc;
+
+	/* A conjunction is indexed on the first expression that can be */
+	list_for_each_entry(conjunction, &rule->tr_conds, tc_linkage) {
+		rc = -EINVAL;
+		list_for_each_entry(expr, &conjunction->tc_expressions,
+				    te_linkage) {
+			rc = nrs_tbf_expression_index(rule, expr);
+			if (rc != -EINVAL)
+				break;
+		}
+		if (rc == -EINVAL)
+			rc = nrs_tbf_index_all(rule);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
 static void
 nrs_tbf_generic_rule_fini(struct nrs_tbf_rule *rule)
 {
@@ -2063,7 +2502,7 @@ nrs_tbf_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_generic_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s %s %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s %s %llu, ref %d", rule->tr_name,
 		   rule->tr_conds_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
@@ -2087,6 +2526,7 @@ static struct nrs_tbf_ops nrs_tbf_generic_ops = {
 	.o_rule_dump = nrs_tbf_generic_rule_dump,
 	.o_rule_match = nrs_tbf_generic_rule_match,
 	.o_rule_fini = nrs_tbf_generic_rule_fini,
+	.o_rule_index = nrs_tbf_generic_rule_index,
 };
 
 static void nrs_tbf_opcode_rule_fini(struct nrs_tbf_rule *rule)
@@ -2357,12 +2797,16 @@ static int nrs_tbf_opcode_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_opcode_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_opcodes_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
 }
 
+static int nrs_tbf_opcode_rule_index(struct nrs_tbf_rule *rule)
+{
+	return nrs_tbf_index_opcodes(rule, rule->tr_opcodes);
+}
 
 struct nrs_tbf_ops nrs_tbf_opcode_ops = {
 	.o_name = NRS_TBF_TYPE_OPCODE,
@@ -2375,6 +2819,7 @@ struct nrs_tbf_ops nrs_tbf_opcode_ops = {
 	.o_rule_dump = nrs_tbf_opcode_rule_dump,
 	.o_rule_match = nrs_tbf_opcode_rule_match,
 	.o_rule_fini = nrs_tbf_opcode_rule_fini,
+	.o_rule_index = nrs_tbf_opcode_rule_index,
 };
 
 static unsigned nrs_tbf_id_hop_hash(struct cfs_hash *hs, const void *key,
@@ -2672,12 +3117,17 @@ nrs_tbf_id_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_id_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+	seq_printf(m, "%s {%s} %llu, ref %d", rule->tr_name,
 		   rule->tr_ids_str, rule->tr_rpc_rate,
 		   atomic_read(&rule->tr_ref) - 1);
 	return 0;
 }
 
+static int nrs_tbf_id_rule_index(struct nrs_tbf_rule *rule)
+{
+	return nrs_tbf_index_ids(rule, &rule->tr_ids);
+}
+
 static void nrs_tbf_id_rule_fini(struct nrs_tbf_rule *rule)
 {
 	nrs_tbf_id_list_free(&rule->tr_ids);
@@ -2696,6 +3146,7 @@ struct nrs_tbf_ops nrs_tbf_uid_ops = {
 	.o_rule_dump = nrs_tbf_id_rule_dump,
 	.o_rule_match = nrs_tbf_id_rule_match,
 	.o_rule_fini = nrs_tbf_id_rule_fini,
+	.o_rule_index = nrs_tbf_id_rule_index,
 };
 
 struct nrs_tbf_ops nrs_tbf_gid_ops = {
@@ -2709,6 +3160,7 @@ struct nrs_tbf_ops nrs_tbf_gid_ops = {
 	.o_rule_dump = nrs_tbf_id_rule_dump,
 	.o_rule_match = nrs_tbf_id_rule_match,
 	.o_rule_fini = nrs_tbf_id_rule_fini,
+	.o_rule_index = nrs_tbf_id_rule_index,
 };
 
 static struct nrs_tbf_type nrs_tbf_types[] = {
@@ -2795,7 +3247,7 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	head->th_type_flag = type;
 
 	head->th_binheap = cfs_binheap_create(&nrs_tbf_heap_ops,
-					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_heap_flags(), 4096, NULL,
 					      nrs_pol2cptab(policy),
 					      nrs_pol2cptid(policy));
 	if (head->th_binheap == NULL)
@@ -2804,6 +3256,9 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	atomic_set(&head->th_rule_sequence, 0);
 	spin_lock_init(&head->th_rule_lock);
 	INIT_LIST_HEAD(&head->th_list);
+	for (i = 0; i < NRS_TBF_INDEX_SIZE; i++)
+		INIT_LIST_HEAD(&head->th_index[i]);
+	INIT_LIST_HEAD(&head->th_index_all);
 	hrtimer_init(&head->th_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
 	head->th_timer.function = nrs_tbf_timer_cb;
 	rc = head->th_ops->o_startup(policy, head);
@@ -2842,6 +3297,7 @@ static void nrs_tbf_stop(struct ptlrpc_nrs_policy *policy)
 	cfs_hash_putref(head->th_cli_hash);
 	list_for_each_entry_safe(rule, n, &head->th_list, tr_linkage) {
 		list_del_init(&rule->tr_linkage);
+		nrs_tbf_index_remove(head, rule);
 		nrs_tbf_rule_put(rule);
 	}
 	LASSERT(list_empty(&head->th_list));
@@ -3028,6 +3484,62 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
 	head->th_ops->o_cli_put(head, cli);
 }
 
+/**
+ * Refill the tokens shared by the child rules of \a rule, up to \a now.
+ */
+static void nrs_tbf_rule_refill(struct nrs_tbf_rule *rule, __u64 now)
+{
+	__u64 ntoken;
+
+	if (now <= rule->tr_check_time)
+		return;
+
+	ntoken = now - rule->tr_check_time;
+	do_div(ntoken, rule->tr_nsecs);
+	if (rule->tr_ntoken + ntoken >= rule->tr_depth) {
+		rule->tr_ntoken = rule->tr_depth;
+		rule->tr_check_time = now;
+	} else {
+		/* keep the remainder for the next token */
+		rule->tr_ntoken += ntoken;
+		rule->tr_check_time += ntoken * rule->tr_nsecs;
+	}
+}
+
+/**
+ * Check whether the ancestor rules of the rule of class \a cli all have a
+ * token left for one more request.
+ *
+ * \retval 0 the ancestors have tokens
+ * \retval the time in ns by which they will all have one
+ */
+static __u64 nrs_tbf_cli_ancestors_wait(struct nrs_tbf_client *cli, __u64 now)
+{
+	struct nrs_tbf_rule *rule;
+	__u64 wait = 0;
+
+	for (rule = cli->tc_rule->tr_parent; rule != NULL;
+	     rule = rule->tr_parent) {
+		nrs_tbf_rule_refill(rule, now);
+		if (rule->tr_ntoken == 0 &&
+		    rule->tr_check_time + rule->tr_nsecs > wait)
+			wait = rule->tr_check_time + rule->tr_nsecs;
+	}
+
+	return wait;
+}
+
+static void nrs_tbf_cli_ancestors_consume(struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_rule *rule;
+
+	for (rule = cli->tc_rule->tr_parent; rule != NULL;
+	     rule = rule->tr_parent) {
+		LASSERT(rule->tr_ntoken > 0);
+		rule->tr_ntoken--;
+	}
+}
+
 /**
  * Called when getting a request from the TBF policy for handling, or just
  * peeking; removes the request from the policy when it is to be handled.
@@ -3059,6 +3571,7 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 	if (!peek && policy->pol_nrs->nrs_throttling)
 		return NULL;
 
+again:
 	node = cfs_binheap_root(head->th_binheap);
 	if (unlikely(node == NULL))
 		return NULL;
@@ -3076,6 +3589,8 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		__u64 ntoken;
 		__u64 deadline;
 		__u64 old_resid = 0;
+		__u64 wait = 0;
+		bool borrow = false;
 
 		deadline = cli->tc_check_time +
 			  cli->tc_nsecs;
@@ -3096,7 +3611,16 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		} else if (ntoken > cli->tc_depth)
 			ntoken = cli->tc_depth;
 
-		if (ntoken > 0) {
+		if (rule->tr_parent != NULL) {
+			wait = nrs_tbf_cli_ancestors_wait(cli, now);
+			/* use the tokens the sibling classes left */
+			borrow = wait == 0 && ntoken == 0;
+			if ((wait != 0 || borrow) &&
+			    (rule->tr_flags & NTRS_REALTIME))
+				cli->tc_nsecs_resid = old_resid;
+		}
+
+		if (wait == 0 && (ntoken > 0 || borrow)) {
 			struct ptlrpc_request *req;
 			nrq = list_entry(cli->tc_list.next,
 					     struct ptlrpc_nrs_request,
@@ -3104,30 +3628,56 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			req = container_of(nrq,
 					   struct ptlrpc_request,
 					   rq_nrq);
-			ntoken--;
-			cli->tc_ntoken = ntoken;
-			cli->tc_check_time = now;
+			if (rule->tr_parent != NULL)
+				nrs_tbf_cli_ancestors_consume(cli);
+			if (borrow) {
+				/*
+				 * Leave the class bucket alone, and queue the
+				 * class behind the ones which have tokens of
+				 * their own, as if it had used one.
+				 */
+				cli->tc_deadline = max(cli->tc_deadline, now) +
+						   cli->tc_nsecs;
+			} else {
+				ntoken--;
+				cli->tc_ntoken = ntoken;
+				cli->tc_check_time = now;
+			}
 			list_del_init(&nrq->nr_u.tbf.tr_list);
 			if (list_empty(&cli->tc_list)) {
 				cfs_binheap_remove(head->th_binheap,
 						   &cli->tc_node);
 				cli->tc_in_heap = false;
 			} else {
-				if (!(rule->tr_flags & NTRS_REALTIME))
+				if (!borrow &&
+				    !(rule->tr_flags & NTRS_REALTIME))
 					cli->tc_deadline = now + cli->tc_nsecs;
 				cfs_binheap_relocate(head->th_binheap,
 						     &cli->tc_node);
 			}
 			CDEBUG(D_RPCTRACE,
 			       "TBF dequeues: class@%p rate %llu gen %llu "
-			       "token %llu, rule@%p rate %llu gen %llu\n",
+			       "token %llu%s, rule@%p rate %llu gen %llu\n",
 			       cli, cli->tc_rpc_rate,
 			       cli->tc_rule_generation, cli->tc_ntoken,
+			       borrow ? " borrowed" : "",
 			       cli->tc_rule, cli->tc_rule->tr_rpc_rate,
 			       cli->tc_rule->tr_generation);
+		} else if (wait != 0 && cli->tc_deadline < wait) {
+			/*
+			 * An ancestor rule is out of tokens, let the classes
+			 * of the other rules go first. Each class is moved at
+			 * most once, as its deadline is then at least @wait.
+			 */
+			cli->tc_deadline = wait;
+			cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+			goto again;
 		} else {
 			ktime_t time;
 
+			if (wait > deadline)
+				deadline = wait;
+
 			if (rule->tr_flags & NTRS_REALTIME) {
 				cli->tc_deadline = deadline;
 				cli->tc_nsecs_resid = old_resid;
@@ -3446,6 +3996,12 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 
 		if (realtime > 0)
 			cmd->u.tc_start.ts_rule_flags |= NTRS_REALTIME;
+	} else if (strcmp(key, "parent") == 0) {
+		if (!name_is_valid(val) ||
+		    cmd->tc_cmd != NRS_CTL_TBF_START_RULE)
+			return -EINVAL;
+
+		cmd->u.tc_start.ts_parent_name = val;
 	} else {
 		return -EINVAL;
 	}
@@ -331,6 +331,145 @@ void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs)
 	wake_up(&svcpt->scp_rep_waitq);
 }
 
+/* Return the pool of reply states of \a size bytes, or -1 if too large */
+static int lustre_rs_pool_class(int size)
+{
+	int shift = size > 1 ? fls(size - 1) : 0;
+
+	if (shift < PTLRPC_RS_POOL_MIN_SHIFT)
+		return 0;
+	shift -= PTLRPC_RS_POOL_MIN_SHIFT;
+	return shift < PTLRPC_RS_POOL_CLASSES ? shift : -1;
+}
+
+/**
+ * Get a zeroed reply state of at least \a size bytes, for a reply of
+ * \a svcpt. It comes from the pool of its size class if not empty, which
+ * avoids allocating and mapping large buffers again and again.
+ */
+struct ptlrpc_reply_state *
+lustre_get_pooled_rs(struct ptlrpc_service_part *svcpt, int size)
+{
+	struct ptlrpc_reply_state *rs = NULL;
+	struct ptlrpc_rs_pool *pool;
+	int class = lustre_rs_pool_class(size);
+
+	if (class < 0) {
+		OBD_CPT_ALLOC_LARGE(rs, svcpt->scp_service->srv_cptable,
+				    svcpt->scp_cpt, size);
+		if (rs != NULL)
+			rs->rs_size = size;
+		return rs;
+	}
+
+	pool = &svcpt->scp_rs_pools[class];
+	spin_lock(&pool->rsp_lock);
+	if (!list_empty(&pool->rsp_idle)) {
+		rs = list_entry(pool->rsp_idle.next,
+				struct ptlrpc_reply_state, rs_list);
+		list_del(&rs->rs_list);
+		pool->rsp_nidle--;
+		if (pool->rsp_nidle < pool->rsp_nidle_min)
+			pool->rsp_nidle_min = pool->rsp_nidle;
+	}
+	spin_unlock(&pool->rsp_lock);
+
+	if (rs != NULL) {
+		/* only the part to be used, the rest is never looked at */
+		memset(rs, 0, size);
+	} else {
+		OBD_CPT_ALLOC_LARGE(rs, svcpt->scp_service->srv_cptable,
+				    svcpt->scp_cpt,
+				    1 << (class + PTLRPC_RS_POOL_MIN_SHIFT));
+		if (rs == NULL)
+			return NULL;
+	}
+
+	rs->rs_size = 1 << (class + PTLRPC_RS_POOL_MIN_SHIFT);
+	rs->rs_svcpt = svcpt;
+	rs->rs_pooled = 1;
+	return rs;
+}
+EXPORT_SYMBOL(lustre_get_pooled_rs);
+
+/**
+ * Release reply state \a rs got from lustre_get_pooled_rs(). The pool keeps
+ * it, and the reply states not needed during the last trimming period are
+ * freed, so that the pool shrinks back once the load of large replies goes.
+ */
+void lustre_put_pooled_rs(struct ptlrpc_reply_state *rs)
+{
+	struct ptlrpc_service_part *svcpt = rs->rs_svcpt;
+	struct ptlrpc_reply_state *tmp;
+	struct ptlrpc_rs_pool *pool;
+	struct list_head trimmed;
+	time64_t now;
+
+	if (!rs->rs_pooled) {
+		OBD_FREE_LARGE(rs, rs->rs_size);
+		return;
+	}
+
+	pool = &svcpt->scp_rs_pools[lustre_rs_pool_class(rs->rs_size)];
+	now = ktime_get_seconds();
+	INIT_LIST_HEAD(&trimmed);
+
+	spin_lock(&pool->rsp_lock);
+	list_add(&rs->rs_list, &pool->rsp_idle);
+	pool->rsp_nidle++;
+	if (now >= pool->rsp_trim_time + PTLRPC_RS_POOL_TRIM_TIME) {
+		/* the least recently used ones are at the tail */
+		while (pool->rsp_nidle_min > 0) {
+			list_move(pool->rsp_idle.prev, &trimmed);
+			pool->rsp_nidle--;
+			pool->rsp_nidle_min--;
+		}
+		pool->rsp_nidle_min = pool->rsp_nidle;
+		pool->rsp_trim_time = now;
+	}
+	spin_unlock(&pool->rsp_lock);
+
+	list_for_each_entry_safe(rs, tmp, &trimmed, rs_list) {
+		list_del(&rs->rs_list);
+		OBD_FREE_LARGE(rs, rs->rs_size);
+	}
+}
+EXPORT_SYMBOL(lustre_put_pooled_rs);
+
+void lustre_rs_pools_init(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_rs_pool *pool;
+	int i;
+
+	for (i = 0; i < PTLRPC_RS_POOL_CLASSES; i++) {
+		pool = &svcpt->scp_rs_pools[i];
+		spin_lock_init(&pool->rsp_lock);
+		INIT_LIST_HEAD(&pool->rsp_idle);
+		pool->rsp_nidle = 0;
+		pool->rsp_nidle_min = 0;
+		pool->rsp_trim_time = ktime_get_seconds();
+	}
+}
+
+void lustre_rs_pools_fini(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_reply_state *rs;
+	struct ptlrpc_rs_pool *pool;
+	int i;
+
+	for (i = 0; i < PTLRPC_RS_POOL_CLASSES; i++) {
+		pool = &svcpt->scp_rs_pools[i];
+		while (!list_empty(&pool->rsp_idle)) {
+			rs = list_entry(pool->rsp_idle.next,
+					struct ptlrpc_reply_state, rs_list);
+			list_del(&rs->rs_list);
+			pool->rsp_nidle--;
+			OBD_FREE_LARGE(rs, rs->rs_size);
+		}
+		LASSERT(pool->rsp_nidle == 0);
+	}
+}
+
 int lustre_pack_reply_v2(struct ptlrpc_request *req, int count,
 			 __u32 *lens, char **bufs, int flags)
 {
@@ -663,6 +802,7 @@ static inline int lustre_unpack_ptlrpc_body_v2(struct ptlrpc_request *req,
 
 int lustre_unpack_req_ptlrpc_body(struct ptlrpc_request *req, int offset)
 {
+	req_capsule_uncheck(&req->rq_pill, RCL_CLIENT);
         switch (req->rq_reqmsg->lm_magic) {
         case LUSTRE_MSG_MAGIC_V2:
                 return lustre_unpack_ptlrpc_body_v2(req, 1, offset);
@@ -675,6 +815,8 @@ int lustre_unpack_req_ptlrpc_body(struct ptlrpc_request *req, int offset)
 
 int lustre_unpack_rep_ptlrpc_body(struct ptlrpc_request *req, int offset)
 {
+	/* a resent request may get its new reply in the same buffer */
+	req_capsule_uncheck(&req->rq_pill, RCL_SERVER);
         switch (req->rq_repmsg->lm_magic) {
         case LUSTRE_MSG_MAGIC_V2:
                 return lustre_unpack_ptlrpc_body_v2(req, 0, offset);
@@ -1702,9 +1844,11 @@ void lustre_swab_connect(struct obd_connect_data *ocd)
 	if (ocd->ocd_connect_flags & OBD_CONNECT_MULTIMODRPCS)
 		__swab16s(&ocd->ocd_maxmodrpcs);
 	CLASSERT(offsetof(typeof(*ocd), padding0) != 0);
-	CLASSERT(offsetof(typeof(*ocd), padding1) != 0);
 	if (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2)
 		__swab64s(&ocd->ocd_connect_flags2);
+	if (ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2 &&
+	    ocd->ocd_connect_flags2 & OBD_CONNECT2_CONN_WINDOW)
+		__swab32s(&ocd->ocd_conn_window);
         CLASSERT(offsetof(typeof(*ocd), padding3) != 0);
         CLASSERT(offsetof(typeof(*ocd), padding4) != 0);
         CLASSERT(offsetof(typeof(*ocd), padding5) != 0);
@@ -1779,7 +1923,7 @@ void lustre_swab_obd_statfs (struct obd_statfs *os)
 	__swab32s(&os->os_state);
 	__swab32s(&os->os_fprecreated);
 	__swab32s(&os->os_granted);
-	CLASSERT(offsetof(typeof(*os), os_spare3) != 0);
+	__swab32s(&os->os_load);
 	CLASSERT(offsetof(typeof(*os), os_spare4) != 0);
 	CLASSERT(offsetof(typeof(*os), os_spare5) != 0);
 	CLASSERT(offsetof(typeof(*os), os_spare6) != 0);
@@ -2255,6 +2399,9 @@ void lustre_print_user_md(unsigned int lvl, struct lov_user_md *lum,
 		if (ent->lcme_flags & LCME_FL_NOSYNC)
 			CDEBUG(lvl, "\tlcme_timestamp: %llu\n",
 					ent->lcme_timestamp);
+		if (ent->lcme_flags & LCME_FL_EXTENSION)
+			CDEBUG(lvl, "\tlcme_extension_size: %u\n",
+			       ent->lcme_extension_size);
 		CDEBUG(lvl, "\tlcme_extent.e_start: %llu\n",
 		       ent->lcme_extent.e_start);
 		CDEBUG(lvl, "\tlcme_extent.e_end: %llu\n",
@@ -2349,7 +2496,7 @@ void lustre_swab_lov_comp_md_v1(struct lov_comp_md_v1 *lum)
 		__swab32s(&ent->lcme_offset);
 		__swab32s(&ent->lcme_size);
 		__swab32s(&ent->lcme_layout_gen);
-		CLASSERT(offsetof(typeof(*ent), lcme_padding_1) != 0);
+		__swab32s(&ent->lcme_extension_size);
 
 		v1 = (struct lov_user_md_v1 *)((char *)lum + off);
 		stripe_count = v1->lmm_stripe_count;
@@ -2869,6 +3016,13 @@ void lustre_swab_swap_layouts(struct mdc_swap_layouts *msl)
 	__swab64s(&msl->msl_flags);
 }
 
+void lustre_swab_batch_body(struct batch_body *bb)
+{
+	__swab32s(&bb->bb_magic);
+	__swab32s(&bb->bb_count);
+	CLASSERT(offsetof(typeof(*bb), bb_padding) != 0);
+}
+
 void lustre_swab_close_data(struct close_data *cd)
 {
 	lustre_swab_lu_fid(&cd->cd_fid);
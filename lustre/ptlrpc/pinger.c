@@ -46,6 +46,11 @@ static int suppress_pings;
 module_param(suppress_pings, int, 0644);
 MODULE_PARM_DESC(suppress_pings, "Suppress pings");
 
+static int shared_pings;
+module_param(shared_pings, int, 0644);
+MODULE_PARM_DESC(shared_pings, "Ping each server node once for all its targets, "
+		 "and not after recent replies");
+
 struct mutex pinger_mutex;
 static struct list_head pinger_imports =
 		LIST_HEAD_INIT(pinger_imports);
@@ -213,6 +218,42 @@ void ptlrpc_pinger_ir_down(void)
 }
 EXPORT_SYMBOL(ptlrpc_pinger_ir_down);
 
+/*
+ * With shared pings, don't ping \a imp if its target got a request recently,
+ * or if the server node got one for any of its targets and refreshes all the
+ * exports of this client node on it. Otherwise the ping of \a imp covers the
+ * other imports to the same node for PING_INTERVAL.
+ *
+ * Must be called with pinger_mutex held.
+ */
+static bool ptlrpc_pinger_skip_ping(struct obd_import *imp)
+{
+	struct ptlrpc_connection *conn = imp->imp_connection;
+	time64_t now = ktime_get_real_seconds();
+	time64_t last;
+
+	if (!shared_pings || ptlrpc_check_import_is_idle(imp))
+		return false;
+
+	last = imp->imp_last_reply_time;
+	if (conn != NULL && imp->imp_connect_data.ocd_connect_flags2 &
+			    OBD_CONNECT2_SHARED_PING)
+		last = max3(last, conn->c_last_alive, conn->c_last_ping);
+
+	if (now - last >= PING_INTERVAL) {
+		if (conn != NULL)
+			conn->c_last_ping = now;
+		return false;
+	}
+
+	CDEBUG(D_INFO, "%s->%s: not pinging, %s heard of %lld seconds ago\n",
+	       imp->imp_obd->obd_uuid.uuid, obd2cli_tgt(imp->imp_obd),
+	       libcfs_nid2str(conn != NULL ? conn->c_peer.nid : LNET_NID_ANY),
+	       now - last);
+	imp->imp_next_ping = ktime_get_seconds() + PING_INTERVAL - (now - last);
+	return true;
+}
+
 static void ptlrpc_pinger_process_import(struct obd_import *imp,
 					 time64_t this_ping)
 {
@@ -246,7 +287,12 @@ static void ptlrpc_pinger_process_import(struct obd_import *imp,
 	       ptlrpc_import_state_name(level), level, force, force_next,
 	       imp->imp_deactive, imp->imp_pingable, suppress);
 
-        if (level == LUSTRE_IMP_DISCON && !imp_is_deactive(imp)) {
+	if (level == LUSTRE_IMP_DISCON && !imp_is_deactive(imp) &&
+	    imp->imp_conn_next > this_ping) {
+		/* connect delayed by ptlrpc_import_conn_delay() */
+		imp->imp_next_ping = imp->imp_conn_next;
+		spin_unlock(&imp->imp_lock);
+	} else if (level == LUSTRE_IMP_DISCON && !imp_is_deactive(imp)) {
                 /* wait for a while before trying recovery again */
                 imp->imp_next_ping = ptlrpc_next_reconnect(imp);
 		spin_unlock(&imp->imp_lock);
@@ -263,7 +309,8 @@ static void ptlrpc_pinger_process_import(struct obd_import *imp,
 		spin_unlock(&imp->imp_lock);
 	} else if ((imp->imp_pingable && !suppress) || force_next || force) {
 		spin_unlock(&imp->imp_lock);
-		ptlrpc_ping(imp);
+		if (force || force_next || !ptlrpc_pinger_skip_ping(imp))
+			ptlrpc_ping(imp);
 	} else {
 		spin_unlock(&imp->imp_lock);
 	}
@@ -501,7 +548,18 @@ static int ping_evictor_main(void *arg)
 			exp = list_entry(obd->obd_exports_timed.next,
 					 struct obd_export,
 					 exp_obd_chain_timed);
-			if (expire_time > exp->exp_last_request_time) {
+			if (expire_time > exp->exp_last_request_time &&
+			    (exp_connect_flags2(exp) &
+			     OBD_CONNECT2_SHARED_PING) &&
+			    exp->exp_connection != NULL &&
+			    exp->exp_connection->c_last_alive > expire_time) {
+				/* heard from the client node for another
+				 * target, when it pings once for all */
+				exp->exp_last_request_time =
+					exp->exp_connection->c_last_alive;
+				list_move_tail(&exp->exp_obd_chain_timed,
+					       &obd->obd_exports_timed);
+			} else if (expire_time > exp->exp_last_request_time) {
 				class_export_get(exp);
 				spin_unlock(&obd->obd_dev_lock);
 				LCONSOLE_WARN("%s: haven't heard from client %s"
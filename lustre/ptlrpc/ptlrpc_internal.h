@@ -42,6 +42,7 @@ struct obd_import;
 struct ldlm_res_id;
 struct ptlrpc_request_set;
 extern int test_req_buffer_pressure;
+extern unsigned int rpc_trace_sample;
 extern struct list_head ptlrpc_all_services;
 extern struct mutex ptlrpc_all_services_mutex;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_fifo;
@@ -52,6 +53,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_edf;
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -59,6 +61,15 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
  * @{
  */
 extern struct nrs_core nrs_core;
+extern int nrs_dary_heap;
+
+/**
+ * Flags for the heaps used by NRS policies to sort requests.
+ */
+static inline unsigned int nrs_heap_flags(void)
+{
+	return CBH_FLAG_ATOMIC_GROW | (nrs_dary_heap ? CBH_FLAG_DARY : 0);
+}
 
 extern struct mutex ptlrpcd_mutex;
 extern struct mutex pinger_mutex;
@@ -66,6 +77,7 @@ extern struct mutex pinger_mutex;
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
 /* ptlrpcd.c */
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
+void ptlrpcd_wake_peer(struct ptlrpcd_ctl *pc, int oldcount, int newcount);
 
 /* client.c */
 void ptlrpc_at_adj_net_latency(struct ptlrpc_request *req,
@@ -80,19 +92,40 @@ void ptlrpc_request_cache_fini(void);
 struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags);
 void ptlrpc_request_cache_free(struct ptlrpc_request *req);
 void ptlrpc_init_xid(void);
+void ptlrpc_save_versions(struct ptlrpc_request *req);
 void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 			    struct ptlrpc_request *req);
 int ptlrpc_expired_set(void *data);
 time64_t ptlrpc_set_next_timeout(struct ptlrpc_request_set *);
+int ptlrpc_check_set_ready(const struct lu_env *env,
+			   struct ptlrpc_request_set *set);
+void ptlrpc_req_timer_fn(struct ptlrpc_timer *t);
+void ptlrpc_req_arm_timer(struct ptlrpc_request *req, time64_t deadline);
 void ptlrpc_resend_req(struct ptlrpc_request *request);
 void ptlrpc_set_bulk_mbits(struct ptlrpc_request *req);
 void ptlrpc_assign_next_xid_nolock(struct ptlrpc_request *req);
 __u64 ptlrpc_known_replied_xid(struct obd_import *imp);
 void ptlrpc_add_unreplied(struct ptlrpc_request *req);
+struct ptlrpc_request *ptlrpc_replay_tree_next(struct obd_import *imp,
+					       __u64 transno);
+
+/* twheel.c */
+int ptlrpc_twheel_init(void);
+void ptlrpc_twheel_fini(void);
+void ptlrpc_timer_init(struct ptlrpc_timer *t,
+		       void (*func)(struct ptlrpc_timer *), int cpt);
+void ptlrpc_timer_arm(struct ptlrpc_timer *t, unsigned long expires);
+void ptlrpc_timer_disarm(struct ptlrpc_timer *t);
+
+static inline bool ptlrpc_timer_armed(struct ptlrpc_timer *t)
+{
+	return !list_empty(&t->pt_link);
+}
 
 /* events.c */
 int ptlrpc_init_portals(void);
 void ptlrpc_exit_portals(void);
+void ptlrpc_server_drain_arrived(struct ptlrpc_service_part *svcpt);
 
 void ptlrpc_request_handle_notconn(struct ptlrpc_request *);
 void lustre_assert_wire_constants(void);
@@ -269,6 +302,8 @@ void ptlrpc_fill_bulk_md(struct lnet_md *md, struct ptlrpc_bulk_desc *desc,
 struct ptlrpc_reply_state *
 lustre_get_emerg_rs(struct ptlrpc_service_part *svcpt);
 void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs);
+void lustre_rs_pools_init(struct ptlrpc_service_part *svcpt);
+void lustre_rs_pools_fini(struct ptlrpc_service_part *svcpt);
 
 /* pinger.c */
 int ptlrpc_start_pinger(void);
@@ -292,6 +327,13 @@ int  sptlrpc_enc_pool_init(void);
 void sptlrpc_enc_pool_fini(void);
 int sptlrpc_proc_enc_pool_seq_show(struct seq_file *m, void *v);
 
+/* sec_msgbuf.c */
+int  sptlrpc_msgbuf_pool_init(void);
+void sptlrpc_msgbuf_pool_fini(void);
+void *sptlrpc_msgbuf_alloc(int size);
+void sptlrpc_msgbuf_free(void *buf, int size);
+int sptlrpc_proc_msgbuf_pool_seq_show(struct seq_file *m, void *v);
+
 /* sec_lproc.c */
 int  sptlrpc_lproc_init(void);
 void sptlrpc_lproc_fini(void);
@@ -367,6 +409,19 @@ static inline void ptlrpc_req_comm_init(struct ptlrpc_request *req)
 }
 
 /** initialise client side ptlrpc request */
+/*
+ * Must be called before \a req leaves \a set, so that neither the timer of
+ * \a req nor a wakeup can queue it on \a set anymore.
+ */
+static inline void ptlrpc_set_unready(struct ptlrpc_request_set *set,
+				      struct ptlrpc_request *req)
+{
+	ptlrpc_timer_disarm(&req->rq_cli.cr_timer);
+	spin_lock_bh(&set->set_ready_lock);
+	list_del_init(&req->rq_cli.cr_ready_chain);
+	spin_unlock_bh(&set->set_ready_lock);
+}
+
 static inline void ptlrpc_cli_req_init(struct ptlrpc_request *req)
 {
 	struct ptlrpc_cli_req *cr = &req->rq_cli;
@@ -377,8 +432,11 @@ static inline void ptlrpc_cli_req_init(struct ptlrpc_request *req)
 	req->rq_req_unlinked = req->rq_reply_unlinked = 1;
 
 	INIT_LIST_HEAD(&cr->cr_set_chain);
+	INIT_LIST_HEAD(&cr->cr_ready_chain);
+	ptlrpc_timer_init(&cr->cr_timer, ptlrpc_req_timer_fn, -1);
 	INIT_LIST_HEAD(&cr->cr_ctx_chain);
 	INIT_LIST_HEAD(&cr->cr_unreplied_list);
+	RB_CLEAR_NODE(&cr->cr_replay_node);
 	init_waitqueue_head(&cr->cr_reply_waitq);
 	init_waitqueue_head(&cr->cr_set_waitq);
 }
@@ -395,6 +453,34 @@ static inline void ptlrpc_srv_req_init(struct ptlrpc_request *req)
 	INIT_LIST_HEAD(&sr->sr_hist_list);
 }
 
+/**
+ * Make the error reply to \a req a PTL_RPC_MSG_ERR one, unless its status is
+ * one of the errors expected by clients in regular replies.
+ */
+static inline void ptlrpc_error_set_type(struct ptlrpc_request *req)
+{
+	if (req->rq_status != -ENOSPC && req->rq_status != -EACCES &&
+	    req->rq_status != -EPERM && req->rq_status != -ENOENT &&
+	    req->rq_status != -EINPROGRESS && req->rq_status != -EDQUOT)
+		req->rq_type = PTL_RPC_MSG_ERR;
+}
+
+/*
+ * RPCs are sampled on their XID, so that the client and the server trace
+ * the same ones.
+ */
+static inline bool ptlrpc_req_traced(struct ptlrpc_request *req)
+{
+	unsigned int sample = READ_ONCE(rpc_trace_sample);
+	u32 rem;
+
+	if (likely(sample == 0))
+		return false;
+
+	div_u64_rem(req->rq_xid, sample, &rem);
+	return rem == 0;
+}
+
 static inline bool ptlrpc_req_is_connect(struct ptlrpc_request *req)
 {
 	if (lustre_msg_get_opc(req->rq_reqmsg) == MDS_CONNECT ||
@@ -65,10 +65,14 @@ static __init int ptlrpc_init(void)
 	if (rc)
 		RETURN(rc);
 
-	rc = tgt_mod_init();
+	rc = ptlrpc_twheel_init();
 	if (rc)
 		GOTO(err_layout, rc);
 
+	rc = tgt_mod_init();
+	if (rc)
+		GOTO(err_twheel, rc);
+
 	rc = ptlrpc_hr_init();
 	if (rc)
 		GOTO(err_tgt, rc);
@@ -126,6 +130,8 @@ err_hr:
 	ptlrpc_hr_fini();
 err_tgt:
 	tgt_mod_exit();
+err_twheel:
+	ptlrpc_twheel_fini();
 err_layout:
 	req_layout_fini();
 	return rc;
@@ -143,6 +149,7 @@ static void __exit ptlrpc_exit(void)
 	ptlrpc_hr_fini();
 	ptlrpc_connection_fini();
 	tgt_mod_exit();
+	ptlrpc_twheel_fini();
 	req_layout_fini();
 }
 
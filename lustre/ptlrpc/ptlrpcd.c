@@ -137,9 +137,25 @@ module_param(ptlrpcd_cpts, charp, 0644);
 MODULE_PARM_DESC(ptlrpcd_cpts,
 		 "CPU partitions ptlrpcd threads should run in");
 
+/*
+ * ptlrpcd_intake_max: The maximum number of queued RPCs a ptlrpcd thread
+ * moves into its set at once. The others stay queued, where idle threads
+ * of the same CPT can steal them. 0 means no limit.
+ */
+static int ptlrpcd_intake_max = 128;
+module_param(ptlrpcd_intake_max, int, 0644);
+MODULE_PARM_DESC(ptlrpcd_intake_max,
+		 "Max queued RPCs a ptlrpcd thread takes at once (0 = all).");
+
 /* ptlrpcds_cpt_idx maps cpt numbers to an index in the ptlrpcds array. */
 static int		*ptlrpcds_cpt_idx;
 
+/*
+ * ptlrpcds_cpu_idx maps cpu numbers to the index of a thread in the
+ * ptlrpcd of their CPT, so that each CPU queues its RPCs to its own thread.
+ */
+static int		*ptlrpcds_cpu_idx;
+
 /* ptlrpcds_num is the number of entries in the ptlrpcds array. */
 static int		ptlrpcds_num;
 static struct ptlrpcd	**ptlrpcds;
@@ -161,10 +177,29 @@ void ptlrpcd_wake(struct ptlrpc_request *req)
 	struct ptlrpc_request_set *set = req->rq_set;
 
 	LASSERT(set != NULL);
+	atomic_inc(&set->set_events);
 	wake_up(&set->set_waitq);
 }
 EXPORT_SYMBOL(ptlrpcd_wake);
 
+/**
+ * Wake up another thread of the CPT of \a pc each time the number of
+ * requests queued on \a pc passes a multiple of ptlrpcd_intake_max, so
+ * that it steals some of them.
+ */
+void ptlrpcd_wake_peer(struct ptlrpcd_ctl *pc, int oldcount, int newcount)
+{
+	struct ptlrpcd_ctl	*peer;
+	int			max = ptlrpcd_intake_max;
+
+	if (max <= 0 || pc->pc_npeers <= 1 || oldcount / max == newcount / max)
+		return;
+
+	peer = &pc->pc_peers[(pc->pc_index + newcount / max) % pc->pc_npeers];
+	if (peer != pc && peer->pc_set != NULL)
+		wake_up(&peer->pc_set->set_waitq);
+}
+
 static struct ptlrpcd_ctl *
 ptlrpcd_select_pc(struct ptlrpc_request *req)
 {
@@ -182,6 +217,13 @@ ptlrpcd_select_pc(struct ptlrpc_request *req)
 		idx = ptlrpcds_cpt_idx[cpt];
 	pd = ptlrpcds[idx];
 
+	if (ptlrpcds_cpu_idx != NULL) {
+		/* Imbalance is fixed by stealing, see ptlrpcd_check() */
+		idx = ptlrpcds_cpu_idx[raw_smp_processor_id()];
+		if (idx < pd->pd_nthreads)
+			return &pd->pd_threads[idx];
+	}
+
 	/* We do not care whether it is strict load balance. */
 	idx = pd->pd_cursor;
 	if (++idx == pd->pd_nthreads)
@@ -211,6 +253,7 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 				   rq_set_chain);
 
 		LASSERT(req->rq_phase == RQ_PHASE_NEW);
+		ptlrpc_set_unready(set, req);
 		req->rq_set = new;
 		req->rq_queued_time = ktime_get_seconds();
 	}
@@ -221,6 +264,8 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 	count = atomic_add_return(i, &new->set_new_count);
 	atomic_set(&set->set_remaining, 0);
 	spin_unlock(&new->set_new_req_lock);
+
+	ptlrpcd_wake_peer(pc, count - i, count);
 	if (count == i) {
 		wake_up(&new->set_waitq);
 
@@ -232,33 +277,115 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 	}
 }
 
+static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
+{
+	atomic_inc(&set->set_refcount);
+}
+
 /**
+ * Move the newest half of the requests queued on \a src to \a des, the
+ * owner of \a src is about to send the older ones.
+ *
  * Return transferred RPCs count.
  */
 static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
                                struct ptlrpc_request_set *src)
 {
-	struct list_head *tmp, *pos;
 	struct ptlrpc_request *req;
+	struct list_head stolen;
+	int count;
 	int rc = 0;
 
+	INIT_LIST_HEAD(&stolen);
+
 	spin_lock(&src->set_new_req_lock);
-	if (likely(!list_empty(&src->set_new_requests))) {
-		list_for_each_safe(pos, tmp, &src->set_new_requests) {
-			req = list_entry(pos, struct ptlrpc_request,
-					 rq_set_chain);
-			req->rq_set = des;
-		}
-		list_splice_init(&src->set_new_requests,
-				 &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
-		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+	count = (atomic_read(&src->set_new_count) + 1) / 2;
+	while (rc < count && !list_empty(&src->set_new_requests)) {
+		req = list_entry(src->set_new_requests.prev,
+				 struct ptlrpc_request, rq_set_chain);
+		ptlrpc_set_unready(src, req);
+		req->rq_set = des;
+		list_move(&req->rq_set_chain, &stolen);
+		rc++;
 	}
+	atomic_sub(rc, &src->set_new_count);
 	spin_unlock(&src->set_new_req_lock);
+
+	if (rc > 0) {
+		list_splice_tail(&stolen, &des->set_requests);
+		atomic_add(rc, &des->set_remaining);
+		atomic_inc(&des->set_events);
+	}
+	return rc;
+}
+
+/**
+ * Try to steal queued requests from the other threads of the CPT.
+ *
+ * Return transferred RPCs count.
+ */
+static int ptlrpcd_steal_peers(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpcd_ctl *peer;
+	struct ptlrpc_request_set *ps;
+	int rc = 0;
+	int i;
+
+	for (i = 1; i < pc->pc_npeers && rc == 0; i++) {
+		peer = &pc->pc_peers[(pc->pc_index + i) % pc->pc_npeers];
+
+		spin_lock(&peer->pc_lock);
+		ps = peer->pc_set;
+		if (ps == NULL) {
+			spin_unlock(&peer->pc_lock);
+			continue;
+		}
+		ptlrpc_reqset_get(ps);
+		spin_unlock(&peer->pc_lock);
+
+		if (atomic_read(&ps->set_new_count)) {
+			rc = ptlrpcd_steal_rqset(pc->pc_set, ps);
+			if (rc > 0)
+				CDEBUG(D_RPCTRACE, "steal %d async RPCs "
+				       "[%d->%d]\n", rc, peer->pc_index,
+				       pc->pc_index);
+		}
+		ptlrpc_reqset_put(ps);
+	}
 	return rc;
 }
 
+/**
+ * Move requests queued on the set of \a pc into the set, at most
+ * ptlrpcd_intake_max of them if other threads can steal the rest.
+ * Must be called with set_new_req_lock held.
+ */
+static void ptlrpcd_intake(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set *set = pc->pc_set;
+	struct list_head *pos;
+	struct list_head batch;
+	int count = atomic_read(&set->set_new_count);
+	int max = ptlrpcd_intake_max;
+	int i = 0;
+
+	if (max <= 0 || pc->pc_npeers <= 1 || count <= max) {
+		list_splice_init(&set->set_new_requests, &set->set_requests);
+		atomic_add(count, &set->set_remaining);
+		atomic_set(&set->set_new_count, 0);
+		return;
+	}
+
+	list_for_each(pos, &set->set_new_requests) {
+		if (++i == max)
+			break;
+	}
+	list_cut_position(&batch, &set->set_new_requests, pos);
+	list_splice_tail(&batch, &set->set_requests);
+	atomic_add(i, &set->set_remaining);
+	atomic_sub(i, &set->set_new_count);
+}
+
 /**
  * Requests that are added to the ptlrpcd queue are sent via
  * ptlrpcd_check->ptlrpc_check_set().
@@ -286,6 +413,7 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 
 		/* ptlrpc_check_set will decrease the count */
 		atomic_inc(&req->rq_set->set_remaining);
+		atomic_inc(&req->rq_set->set_events);
 		spin_unlock(&req->rq_lock);
 		wake_up(&req->rq_set->set_waitq);
 		return;
@@ -302,11 +430,6 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_add_req);
 
-static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
-{
-	atomic_inc(&set->set_refcount);
-}
-
 /**
  * Check if there is more work to do on ptlrpcd set.
  * Returns 1 if yes.
@@ -316,6 +439,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 	struct list_head *tmp, *pos;
         struct ptlrpc_request *req;
         struct ptlrpc_request_set *set = pc->pc_set;
+	int events;
         int rc = 0;
         int rc2;
         ENTRY;
@@ -323,11 +447,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 	if (atomic_read(&set->set_new_count)) {
 		spin_lock(&set->set_new_req_lock);
 		if (likely(!list_empty(&set->set_new_requests))) {
-			list_splice_init(&set->set_new_requests,
-					     &set->set_requests);
-			atomic_add(atomic_read(&set->set_new_count),
-				   &set->set_remaining);
-			atomic_set(&set->set_new_count, 0);
+			ptlrpcd_intake(pc);
 			/*
 			 * Need to calculate its timeout.
 			 */
@@ -355,8 +475,25 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 		RETURN(rc);
 	}
 
-	if (atomic_read(&set->set_remaining))
-		rc |= ptlrpc_check_set(env, set);
+	/*
+	 * Only scan the whole set for new or stolen requests and expired
+	 * timeouts, otherwise just check the requests which were woken up.
+	 * The counter is read first so that events racing with the scan cause
+	 * another one. Scan at least once a second regardless, in case some
+	 * request progressed without being woken up.
+	 */
+	events = atomic_read(&set->set_events);
+	if (atomic_read(&set->set_remaining)) {
+		if (rc || events != pc->pc_events ||
+		    time_after_eq(jiffies,
+				  pc->pc_scan_time + cfs_time_seconds(1))) {
+			pc->pc_events = events;
+			pc->pc_scan_time = jiffies;
+			rc |= ptlrpc_check_set(env, set);
+		} else if (!list_empty(&set->set_ready_requests)) {
+			rc |= ptlrpc_check_set_ready(env, set);
+		}
+	}
 
 	/* NB: ptlrpc_check_set has already moved complted request at the
 	 * head of seq::set_requests */
@@ -366,6 +503,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 			break;
 
 		list_del_init(&req->rq_set_chain);
+		ptlrpc_set_unready(set, req);
 		req->rq_set = NULL;
 		ptlrpc_req_finished(req);
 	}
@@ -411,6 +549,10 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 				ptlrpc_reqset_put(ps);
 			} while (rc == 0 && pc->pc_cursor != first);
 		}
+
+		/* Then from any thread of the CPT. */
+		if (rc == 0 && ptlrpcd_intake_max > 0)
+			rc = ptlrpcd_steal_peers(pc);
 	}
 
 	RETURN(rc || test_bit(LIOD_STOP, &pc->pc_flags));
@@ -478,9 +620,11 @@ static int ptlrpcd(void *arg)
                 struct l_wait_info lwi;
 		time64_t timeout;
 
-                timeout = ptlrpc_set_next_timeout(set);
-		lwi = LWI_TIMEOUT(cfs_time_seconds(timeout),
-				ptlrpc_expired_set, set);
+		/* Timeouts of the requests are tracked by their own timers,
+		 * which wake up the set. Still poll once a second while there
+		 * are requests, see ptlrpcd_check(). */
+		timeout = atomic_read(&set->set_remaining) ? 1 : 0;
+		lwi = LWI_TIMEOUT(cfs_time_seconds(timeout), NULL, NULL);
 
 		lu_context_enter(&env.le_ctx);
 		lu_context_enter(env.le_ses);
@@ -715,9 +859,46 @@ static void ptlrpcd_fini(void)
 		ptlrpcds_cpt_idx = NULL;
 	}
 
+	if (ptlrpcds_cpu_idx != NULL) {
+		OBD_FREE(ptlrpcds_cpu_idx,
+			 nr_cpu_ids * sizeof(ptlrpcds_cpu_idx[0]));
+		ptlrpcds_cpu_idx = NULL;
+	}
+
 	EXIT;
 }
 
+/*
+ * Give each CPU of a CPT its own thread among the ptlrpcd threads serving
+ * the CPT, in turn. If that fails, ptlrpcd_select_pc() still works with
+ * only the round robin cursor, so it is not an error.
+ */
+static void ptlrpcd_cpu_map(struct cfs_cpt_table *cptable)
+{
+	struct ptlrpcd	*pd;
+	int		*map;
+	int		ncpts = cfs_cpt_number(cptable);
+	int		cpt;
+	int		cpu;
+	int		n;
+
+	OBD_ALLOC(map, nr_cpu_ids * sizeof(map[0]));
+	if (map == NULL)
+		return;
+
+	for (cpt = 0; cpt < ncpts; cpt++) {
+		if (ptlrpcds_cpt_idx == NULL)
+			pd = ptlrpcds[cpt];
+		else
+			pd = ptlrpcds[ptlrpcds_cpt_idx[cpt]];
+
+		n = 0;
+		for_each_cpu(cpu, cfs_cpt_cpumask(cptable, cpt))
+			map[cpu] = n++ % pd->pd_nthreads;
+	}
+	ptlrpcds_cpu_idx = map;
+}
+
 static int ptlrpcd_init(void)
 {
 	int			nthreads;
@@ -901,6 +1082,8 @@ static int ptlrpcd_init(void)
 		 */
 		for (j = 0; j < nthreads; j++) {
 			ptlrpcd_ctl_init(&pd->pd_threads[j], j, cpt);
+			pd->pd_threads[j].pc_peers = pd->pd_threads;
+			pd->pd_threads[j].pc_npeers = nthreads;
 			rc = ptlrpcd_partners(pd, j);
 			if (rc < 0)
 				GOTO(out, rc);
@@ -931,6 +1114,8 @@ static int ptlrpcd_init(void)
 				GOTO(out, rc);
 		}
 	}
+
+	ptlrpcd_cpu_map(cptable);
 out:
 	if (rc != 0)
 		ptlrpcd_fini();
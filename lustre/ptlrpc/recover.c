@@ -68,7 +68,7 @@ void ptlrpc_initiate_recovery(struct obd_import *imp)
 int ptlrpc_replay_next(struct obd_import *imp, int *inflight)
 {
         int rc = 0;
-	struct list_head *tmp, *pos;
+	struct list_head *tmp;
         struct ptlrpc_request *req = NULL;
         __u64 last_transno;
         ENTRY;
@@ -122,16 +122,8 @@ int ptlrpc_replay_next(struct obd_import *imp, int *inflight)
 
 	/* All the requests in committed list have been replayed, let's replay
 	 * the imp_replay_list */
-	if (req == NULL) {
-		list_for_each_safe(tmp, pos, &imp->imp_replay_list) {
-			req = list_entry(tmp, struct ptlrpc_request,
-					     rq_replay_list);
-
-			if (req->rq_transno > last_transno)
-				break;
-			req = NULL;
-		}
-	}
+	if (req == NULL)
+		req = ptlrpc_replay_tree_next(imp, last_transno);
 
 	/* If need to resend the last sent transno (because a reconnect
 	 * has occurred), then stop on the matching req and send it again.
@@ -2689,9 +2689,13 @@ int sptlrpc_init(void)
         if (rc)
                 goto out_conf;
 
+	rc = sptlrpc_msgbuf_pool_init();
+	if (rc)
+		goto out_pool;
+
         rc = sptlrpc_null_init();
         if (rc)
-                goto out_pool;
+                goto out_msgbuf;
 
         rc = sptlrpc_plain_init();
         if (rc)
@@ -2707,6 +2711,8 @@ out_plain:
         sptlrpc_plain_fini();
 out_null:
         sptlrpc_null_fini();
+out_msgbuf:
+	sptlrpc_msgbuf_pool_fini();
 out_pool:
         sptlrpc_enc_pool_fini();
 out_conf:
@@ -2722,6 +2728,7 @@ void sptlrpc_fini(void)
         sptlrpc_lproc_fini();
         sptlrpc_plain_fini();
         sptlrpc_null_fini();
+	sptlrpc_msgbuf_pool_fini();
         sptlrpc_enc_pool_fini();
         sptlrpc_conf_fini();
         sptlrpc_gc_fini();
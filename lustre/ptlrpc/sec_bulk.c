@@ -68,12 +68,20 @@ MODULE_PARM_DESC(enc_pool_max_memory_mb,
 
 #define CACHE_QUIESCENT_PERIOD  (20)
 
-static struct ptlrpc_enc_page_pool {
-        /*
-         * constants
-         */
-        unsigned long    epp_max_pages;   /* maximum pages can hold, const */
-        unsigned int     epp_max_pools;   /* number of pools, const */
+/*
+ * There is one pool per CPT, with pages allocated from the memory of that CPT,
+ * so that the bulk encryption of the threads of different CPTs does not
+ * contend on a single lock. A thread gets pages from the pool of its CPT,
+ * and from the pool of another CPT when its own has reached its full
+ * capacity. The pages are always returned to the pool they come from.
+ */
+struct ptlrpc_enc_page_pool {
+	/*
+	 * constants
+	 */
+	unsigned long	 epp_max_pages;	  /* maximum pages can hold, const */
+	unsigned int	 epp_max_pools;	  /* number of pools, const */
+	int		 epp_cpt;	  /* CPT of the pool, const */
 
 	/*
 	 * wait queue in case of not enough free pages.
@@ -82,45 +90,49 @@ static struct ptlrpc_enc_page_pool {
 	unsigned int     epp_waitqlen;    /* wait queue length */
 	unsigned long    epp_pages_short; /* # of pages wanted of in-q users */
 	unsigned int     epp_growing:1;   /* during adding pages */
+	struct mutex	 epp_add_mutex;	  /* serialize adding pages */
 
-        /*
-         * indicating how idle the pools are, from 0 to MAX_IDLE_IDX
-         * this is counted based on each time when getting pages from
-         * the pools, not based on time. which means in case that system
-         * is idled for a while but the idle_idx might still be low if no
-         * activities happened in the pools.
-         */
-        unsigned long    epp_idle_idx;
+	/*
+	 * indicating how idle the pools are, from 0 to MAX_IDLE_IDX
+	 * this is counted based on each time when getting pages from
+	 * the pools, not based on time. which means in case that system
+	 * is idled for a while but the idle_idx might still be low if no
+	 * activities happened in the pools.
+	 */
+	unsigned long    epp_idle_idx;
 
-        /* last shrink time due to mem tight */
+	/* last shrink time due to mem tight */
 	time64_t	epp_last_shrink;
 	time64_t	epp_last_access;
 
-        /*
-         * in-pool pages bookkeeping
-         */
+	/*
+	 * in-pool pages bookkeeping
+	 */
 	spinlock_t	 epp_lock;	   /* protect following fields */
-        unsigned long    epp_total_pages; /* total pages in pools */
-        unsigned long    epp_free_pages;  /* current pages available */
-
-        /*
-         * statistics
-         */
-        unsigned long    epp_st_max_pages;      /* # of pages ever reached */
-        unsigned int     epp_st_grows;          /* # of grows */
-        unsigned int     epp_st_grow_fails;     /* # of add pages failures */
-        unsigned int     epp_st_shrinks;        /* # of shrinks */
-        unsigned long    epp_st_access;         /* # of access */
-        unsigned long    epp_st_missings;       /* # of cache missing */
-        unsigned long    epp_st_lowfree;        /* lowest free pages reached */
-        unsigned int     epp_st_max_wqlen;      /* highest waitqueue length */
+	unsigned long    epp_total_pages; /* total pages in pools */
+	unsigned long    epp_free_pages;  /* current pages available */
+
+	/*
+	 * statistics
+	 */
+	unsigned long    epp_st_max_pages;      /* # of pages ever reached */
+	unsigned int     epp_st_grows;          /* # of grows */
+	unsigned int     epp_st_grow_fails;     /* # of add pages failures */
+	unsigned int     epp_st_shrinks;        /* # of shrinks */
+	unsigned long    epp_st_access;         /* # of access */
+	unsigned long    epp_st_missings;       /* # of cache missing */
+	unsigned long    epp_st_lowfree;        /* lowest free pages reached */
+	unsigned int     epp_st_max_wqlen;      /* highest waitqueue length */
 	ktime_t		epp_st_max_wait;	/* in nanoseconds */
 	unsigned long	 epp_st_outofmem;	/* # of out of mem requests */
+	unsigned long	 epp_st_lent;		/* # of access of other CPTs */
 	/*
 	 * pointers to pools, may be vmalloc'd
 	 */
 	struct page    ***epp_pools;
-} page_pools;
+};
+
+static struct ptlrpc_enc_page_pool **page_pools;
 
 /*
  * memory shrinker
@@ -134,159 +146,186 @@ static struct shrinker *pools_shrinker;
  */
 int sptlrpc_proc_enc_pool_seq_show(struct seq_file *m, void *v)
 {
-	spin_lock(&page_pools.epp_lock);
+	struct ptlrpc_enc_page_pool *pool;
+	int i;
 
 	seq_printf(m, "physical pages:          %lu\n"
-		   "pages per pool:          %lu\n"
-		   "max pages:               %lu\n"
-		   "max pools:               %u\n"
-		   "total pages:             %lu\n"
-		   "total free:              %lu\n"
-		   "idle index:              %lu/100\n"
-		   "last shrink:             %llds\n"
-		   "last access:             %llds\n"
-		   "max pages reached:       %lu\n"
-		   "grows:                   %u\n"
-		   "grows failure:           %u\n"
-		   "shrinks:                 %u\n"
-		   "cache access:            %lu\n"
-		   "cache missing:           %lu\n"
-		   "low free mark:           %lu\n"
-		   "max waitqueue depth:     %u\n"
-		   "max wait time ms:        %lld\n"
-		   "out of mem:              %lu\n",
-		   cfs_totalram_pages(), PAGES_PER_POOL,
-		   page_pools.epp_max_pages,
-		   page_pools.epp_max_pools,
-		   page_pools.epp_total_pages,
-		   page_pools.epp_free_pages,
-		   page_pools.epp_idle_idx,
-		   ktime_get_seconds() - page_pools.epp_last_shrink,
-		   ktime_get_seconds() - page_pools.epp_last_access,
-		   page_pools.epp_st_max_pages,
-		   page_pools.epp_st_grows,
-		   page_pools.epp_st_grow_fails,
-		   page_pools.epp_st_shrinks,
-		   page_pools.epp_st_access,
-		   page_pools.epp_st_missings,
-		   page_pools.epp_st_lowfree,
-		   page_pools.epp_st_max_wqlen,
-		   ktime_to_ms(page_pools.epp_st_max_wait),
-		   page_pools.epp_st_outofmem);
-
-	spin_unlock(&page_pools.epp_lock);
+		   "pages per pool:          %lu\n",
+		   cfs_totalram_pages(), PAGES_PER_POOL);
+
+	cfs_percpt_for_each(pool, i, page_pools) {
+		spin_lock(&pool->epp_lock);
+		seq_printf(m, "cpt %d:\n"
+			   "  max pages:             %lu\n"
+			   "  max pools:             %u\n"
+			   "  total pages:           %lu\n"
+			   "  total free:            %lu\n"
+			   "  idle index:            %lu/100\n"
+			   "  last shrink:           %llds\n"
+			   "  last access:           %llds\n"
+			   "  max pages reached:     %lu\n"
+			   "  grows:                 %u\n"
+			   "  grows failure:         %u\n"
+			   "  shrinks:               %u\n"
+			   "  cache access:          %lu\n"
+			   "  cache missing:         %lu\n"
+			   "  low free mark:         %lu\n"
+			   "  max waitqueue depth:   %u\n"
+			   "  max wait time ms:      %lld\n"
+			   "  out of mem:            %lu\n"
+			   "  lent to other cpts:    %lu\n",
+			   i,
+			   pool->epp_max_pages,
+			   pool->epp_max_pools,
+			   pool->epp_total_pages,
+			   pool->epp_free_pages,
+			   pool->epp_idle_idx,
+			   ktime_get_seconds() - pool->epp_last_shrink,
+			   ktime_get_seconds() - pool->epp_last_access,
+			   pool->epp_st_max_pages,
+			   pool->epp_st_grows,
+			   pool->epp_st_grow_fails,
+			   pool->epp_st_shrinks,
+			   pool->epp_st_access,
+			   pool->epp_st_missings,
+			   pool->epp_st_lowfree,
+			   pool->epp_st_max_wqlen,
+			   ktime_to_ms(pool->epp_st_max_wait),
+			   pool->epp_st_outofmem,
+			   pool->epp_st_lent);
+		spin_unlock(&pool->epp_lock);
+	}
+
 	return 0;
 }
 
-static void enc_pools_release_free_pages(long npages)
+static void enc_pools_release_free_pages(struct ptlrpc_enc_page_pool *pool,
+					 long npages)
 {
-        int     p_idx, g_idx;
-        int     p_idx_max1, p_idx_max2;
+	int     p_idx, g_idx;
+	int     p_idx_max1, p_idx_max2;
 
-        LASSERT(npages > 0);
-        LASSERT(npages <= page_pools.epp_free_pages);
-        LASSERT(page_pools.epp_free_pages <= page_pools.epp_total_pages);
+	LASSERT(npages > 0);
+	LASSERT(npages <= pool->epp_free_pages);
+	LASSERT(pool->epp_free_pages <= pool->epp_total_pages);
 
-        /* max pool index before the release */
-        p_idx_max2 = (page_pools.epp_total_pages - 1) / PAGES_PER_POOL;
+	/* max pool index before the release */
+	p_idx_max2 = (pool->epp_total_pages - 1) / PAGES_PER_POOL;
 
-        page_pools.epp_free_pages -= npages;
-        page_pools.epp_total_pages -= npages;
+	pool->epp_free_pages -= npages;
+	pool->epp_total_pages -= npages;
 
-        /* max pool index after the release */
-        p_idx_max1 = page_pools.epp_total_pages == 0 ? -1 :
-                     ((page_pools.epp_total_pages - 1) / PAGES_PER_POOL);
+	/* max pool index after the release */
+	p_idx_max1 = pool->epp_total_pages == 0 ? -1 :
+		     ((pool->epp_total_pages - 1) / PAGES_PER_POOL);
 
-        p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
-        LASSERT(page_pools.epp_pools[p_idx]);
+	p_idx = pool->epp_free_pages / PAGES_PER_POOL;
+	g_idx = pool->epp_free_pages % PAGES_PER_POOL;
+	LASSERT(pool->epp_pools[p_idx]);
 
-        while (npages--) {
-                LASSERT(page_pools.epp_pools[p_idx]);
-                LASSERT(page_pools.epp_pools[p_idx][g_idx] != NULL);
+	while (npages--) {
+		LASSERT(pool->epp_pools[p_idx]);
+		LASSERT(pool->epp_pools[p_idx][g_idx] != NULL);
 
-		__free_page(page_pools.epp_pools[p_idx][g_idx]);
-                page_pools.epp_pools[p_idx][g_idx] = NULL;
+		__free_page(pool->epp_pools[p_idx][g_idx]);
+		pool->epp_pools[p_idx][g_idx] = NULL;
 
-                if (++g_idx == PAGES_PER_POOL) {
-                        p_idx++;
-                        g_idx = 0;
-                }
+		if (++g_idx == PAGES_PER_POOL) {
+			p_idx++;
+			g_idx = 0;
+		}
 	}
 
-        /* free unused pools */
-        while (p_idx_max1 < p_idx_max2) {
-                LASSERT(page_pools.epp_pools[p_idx_max2]);
-		OBD_FREE(page_pools.epp_pools[p_idx_max2], PAGE_SIZE);
-                page_pools.epp_pools[p_idx_max2] = NULL;
-                p_idx_max2--;
-        }
+	/* free unused pools */
+	while (p_idx_max1 < p_idx_max2) {
+		LASSERT(pool->epp_pools[p_idx_max2]);
+		OBD_FREE(pool->epp_pools[p_idx_max2], PAGE_SIZE);
+		pool->epp_pools[p_idx_max2] = NULL;
+		p_idx_max2--;
+	}
+}
+
+/*
+ * if no pool access for a long time, we consider it's fully idle.
+ * a little race here is fine.
+ */
+static void enc_pools_check_idle(struct ptlrpc_enc_page_pool *pool)
+{
+	if (unlikely(ktime_get_seconds() - pool->epp_last_access >
+		     CACHE_QUIESCENT_PERIOD)) {
+		spin_lock(&pool->epp_lock);
+		pool->epp_idle_idx = IDLE_IDX_MAX;
+		spin_unlock(&pool->epp_lock);
+	}
+
+	LASSERT(pool->epp_idle_idx <= IDLE_IDX_MAX);
 }
 
 /*
- * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in the pool.
+ * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in each pool.
  */
 static unsigned long enc_pools_shrink_count(struct shrinker *s,
 					    struct shrink_control *sc)
 {
-	/*
-	 * if no pool access for a long time, we consider it's fully idle.
-	 * a little race here is fine.
-	 */
-	if (unlikely(ktime_get_seconds() - page_pools.epp_last_access >
-		     CACHE_QUIESCENT_PERIOD)) {
-		spin_lock(&page_pools.epp_lock);
-		page_pools.epp_idle_idx = IDLE_IDX_MAX;
-		spin_unlock(&page_pools.epp_lock);
+	struct ptlrpc_enc_page_pool *pool;
+	unsigned long count = 0;
+	int i;
+
+	cfs_percpt_for_each(pool, i, page_pools) {
+		enc_pools_check_idle(pool);
+		if (pool->epp_free_pages <= PTLRPC_MAX_BRW_PAGES)
+			continue;
+		count += (pool->epp_free_pages - PTLRPC_MAX_BRW_PAGES) *
+			 (IDLE_IDX_MAX - pool->epp_idle_idx) / IDLE_IDX_MAX;
 	}
 
-	LASSERT(page_pools.epp_idle_idx <= IDLE_IDX_MAX);
-	return (page_pools.epp_free_pages <= PTLRPC_MAX_BRW_PAGES) ? 0 :
-		(page_pools.epp_free_pages - PTLRPC_MAX_BRW_PAGES) *
-		(IDLE_IDX_MAX - page_pools.epp_idle_idx) / IDLE_IDX_MAX;
+	return count;
 }
 
 /*
- * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in the pool.
+ * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in each pool.
  */
 static unsigned long enc_pools_shrink_scan(struct shrinker *s,
 					   struct shrink_control *sc)
 {
-	spin_lock(&page_pools.epp_lock);
-	if (page_pools.epp_free_pages <= PTLRPC_MAX_BRW_PAGES)
-		sc->nr_to_scan = 0;
-	else
-		sc->nr_to_scan = min_t(unsigned long, sc->nr_to_scan,
-			      page_pools.epp_free_pages - PTLRPC_MAX_BRW_PAGES);
-	if (sc->nr_to_scan > 0) {
-		enc_pools_release_free_pages(sc->nr_to_scan);
-		CDEBUG(D_SEC, "released %ld pages, %ld left\n",
-		       (long)sc->nr_to_scan, page_pools.epp_free_pages);
-
-		page_pools.epp_st_shrinks++;
-		page_pools.epp_last_shrink = ktime_get_seconds();
-	}
-	spin_unlock(&page_pools.epp_lock);
+	struct ptlrpc_enc_page_pool *pool;
+	unsigned long released = 0;
+	unsigned long npages;
+	int i;
 
-	/*
-	 * if no pool access for a long time, we consider it's fully idle.
-	 * a little race here is fine.
-	 */
-	if (unlikely(ktime_get_seconds() - page_pools.epp_last_access >
-		     CACHE_QUIESCENT_PERIOD)) {
-		spin_lock(&page_pools.epp_lock);
-		page_pools.epp_idle_idx = IDLE_IDX_MAX;
-		spin_unlock(&page_pools.epp_lock);
+	cfs_percpt_for_each(pool, i, page_pools) {
+		if (released >= sc->nr_to_scan)
+			break;
+
+		spin_lock(&pool->epp_lock);
+		if (pool->epp_free_pages <= PTLRPC_MAX_BRW_PAGES)
+			npages = 0;
+		else
+			npages = min_t(unsigned long, sc->nr_to_scan - released,
+				       pool->epp_free_pages -
+				       PTLRPC_MAX_BRW_PAGES);
+		if (npages > 0) {
+			enc_pools_release_free_pages(pool, npages);
+			CDEBUG(D_SEC, "cpt %d: released %ld pages, %ld left\n",
+			       i, (long)npages, pool->epp_free_pages);
+
+			pool->epp_st_shrinks++;
+			pool->epp_last_shrink = ktime_get_seconds();
+			released += npages;
+		}
+		spin_unlock(&pool->epp_lock);
+
+		enc_pools_check_idle(pool);
 	}
 
-	LASSERT(page_pools.epp_idle_idx <= IDLE_IDX_MAX);
-	return sc->nr_to_scan;
+	sc->nr_to_scan = released;
+	return released;
 }
 
 #ifndef HAVE_SHRINKER_COUNT
 /*
  * could be called frequently for query (@nr_to_scan == 0).
- * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in the pool.
+ * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in each pool.
  */
 static int enc_pools_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
 {
@@ -342,90 +381,90 @@ static unsigned long enc_pools_cleanup(struct page ***pools, int npools)
  * we have options to avoid most memory copy with some tricks. but we choose
  * the simplest way to avoid complexity. It's not frequently called.
  */
-static void enc_pools_insert(struct page ***pools, int npools, int npages)
+static void enc_pools_insert(struct ptlrpc_enc_page_pool *pool,
+			     struct page ***pools, int npools, int npages)
 {
-        int     freeslot;
-        int     op_idx, np_idx, og_idx, ng_idx;
-        int     cur_npools, end_npools;
-
-        LASSERT(npages > 0);
-        LASSERT(page_pools.epp_total_pages+npages <= page_pools.epp_max_pages);
-        LASSERT(npages_to_npools(npages) == npools);
-        LASSERT(page_pools.epp_growing);
-
-	spin_lock(&page_pools.epp_lock);
-
-        /*
-         * (1) fill all the free slots of current pools.
-         */
-        /* free slots are those left by rent pages, and the extra ones with
-         * index >= total_pages, locate at the tail of last pool. */
-        freeslot = page_pools.epp_total_pages % PAGES_PER_POOL;
-        if (freeslot != 0)
-                freeslot = PAGES_PER_POOL - freeslot;
-        freeslot += page_pools.epp_total_pages - page_pools.epp_free_pages;
-
-        op_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        og_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
-        np_idx = npools - 1;
-        ng_idx = (npages - 1) % PAGES_PER_POOL;
-
-        while (freeslot) {
-                LASSERT(page_pools.epp_pools[op_idx][og_idx] == NULL);
-                LASSERT(pools[np_idx][ng_idx] != NULL);
-
-                page_pools.epp_pools[op_idx][og_idx] = pools[np_idx][ng_idx];
-                pools[np_idx][ng_idx] = NULL;
-
-                freeslot--;
-
-                if (++og_idx == PAGES_PER_POOL) {
-                        op_idx++;
-                        og_idx = 0;
-                }
-                if (--ng_idx < 0) {
-                        if (np_idx == 0)
-                                break;
-                        np_idx--;
-                        ng_idx = PAGES_PER_POOL - 1;
-                }
-        }
+	int     freeslot;
+	int     op_idx, np_idx, og_idx, ng_idx;
+	int     cur_npools, end_npools;
 
-        /*
-         * (2) add pools if needed.
-         */
-        cur_npools = (page_pools.epp_total_pages + PAGES_PER_POOL - 1) /
-                     PAGES_PER_POOL;
-        end_npools = (page_pools.epp_total_pages + npages + PAGES_PER_POOL -1) /
-                     PAGES_PER_POOL;
-        LASSERT(end_npools <= page_pools.epp_max_pools);
-
-        np_idx = 0;
-        while (cur_npools < end_npools) {
-                LASSERT(page_pools.epp_pools[cur_npools] == NULL);
-                LASSERT(np_idx < npools);
-                LASSERT(pools[np_idx] != NULL);
-
-                page_pools.epp_pools[cur_npools++] = pools[np_idx];
-                pools[np_idx++] = NULL;
-        }
+	LASSERT(npages > 0);
+	LASSERT(pool->epp_total_pages + npages <= pool->epp_max_pages);
+	LASSERT(npages_to_npools(npages) == npools);
+	LASSERT(pool->epp_growing);
+
+	spin_lock(&pool->epp_lock);
+
+	/*
+	 * (1) fill all the free slots of current pools.
+	 */
+	/* free slots are those left by rent pages, and the extra ones with
+	 * index >= total_pages, locate at the tail of last pool. */
+	freeslot = pool->epp_total_pages % PAGES_PER_POOL;
+	if (freeslot != 0)
+		freeslot = PAGES_PER_POOL - freeslot;
+	freeslot += pool->epp_total_pages - pool->epp_free_pages;
+
+	op_idx = pool->epp_free_pages / PAGES_PER_POOL;
+	og_idx = pool->epp_free_pages % PAGES_PER_POOL;
+	np_idx = npools - 1;
+	ng_idx = (npages - 1) % PAGES_PER_POOL;
+
+	while (freeslot) {
+		LASSERT(pool->epp_pools[op_idx][og_idx] == NULL);
+		LASSERT(pools[np_idx][ng_idx] != NULL);
+
+		pool->epp_pools[op_idx][og_idx] = pools[np_idx][ng_idx];
+		pools[np_idx][ng_idx] = NULL;
+
+		freeslot--;
+
+		if (++og_idx == PAGES_PER_POOL) {
+			op_idx++;
+			og_idx = 0;
+		}
+		if (--ng_idx < 0) {
+			if (np_idx == 0)
+				break;
+			np_idx--;
+			ng_idx = PAGES_PER_POOL - 1;
+		}
+	}
+
+	/*
+	 * (2) add pools if needed.
+	 */
+	cur_npools = (pool->epp_total_pages + PAGES_PER_POOL - 1) /
+		     PAGES_PER_POOL;
+	end_npools = (pool->epp_total_pages + npages + PAGES_PER_POOL - 1) /
+		     PAGES_PER_POOL;
+	LASSERT(end_npools <= pool->epp_max_pools);
+
+	np_idx = 0;
+	while (cur_npools < end_npools) {
+		LASSERT(pool->epp_pools[cur_npools] == NULL);
+		LASSERT(np_idx < npools);
+		LASSERT(pools[np_idx] != NULL);
+
+		pool->epp_pools[cur_npools++] = pools[np_idx];
+		pools[np_idx++] = NULL;
+	}
 
-        page_pools.epp_total_pages += npages;
-        page_pools.epp_free_pages += npages;
-        page_pools.epp_st_lowfree = page_pools.epp_free_pages;
+	pool->epp_total_pages += npages;
+	pool->epp_free_pages += npages;
+	pool->epp_st_lowfree = pool->epp_free_pages;
 
-        if (page_pools.epp_total_pages > page_pools.epp_st_max_pages)
-                page_pools.epp_st_max_pages = page_pools.epp_total_pages;
+	if (pool->epp_total_pages > pool->epp_st_max_pages)
+		pool->epp_st_max_pages = pool->epp_total_pages;
 
-        CDEBUG(D_SEC, "add %d pages to total %lu\n", npages,
-               page_pools.epp_total_pages);
+	CDEBUG(D_SEC, "cpt %d: add %d pages to total %lu\n", pool->epp_cpt,
+	       npages, pool->epp_total_pages);
 
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 }
 
-static int enc_pools_add_pages(int npages)
+static int enc_pools_add_pages(struct ptlrpc_enc_page_pool *pool, int npages)
 {
-	static DEFINE_MUTEX(add_pages_mutex);
 	struct page   ***pools;
 	int             npools, alloced = 0;
 	int             i, j, rc = -ENOMEM;
@@ -433,27 +472,30 @@ static int enc_pools_add_pages(int npages)
 	if (npages < PTLRPC_MAX_BRW_PAGES)
 		npages = PTLRPC_MAX_BRW_PAGES;
 
-	mutex_lock(&add_pages_mutex);
+	mutex_lock(&pool->epp_add_mutex);
 
-        if (npages + page_pools.epp_total_pages > page_pools.epp_max_pages)
-                npages = page_pools.epp_max_pages - page_pools.epp_total_pages;
-        LASSERT(npages > 0);
+	if (npages + pool->epp_total_pages > pool->epp_max_pages)
+		npages = pool->epp_max_pages - pool->epp_total_pages;
+	LASSERT(npages > 0);
 
-        page_pools.epp_st_grows++;
+	pool->epp_st_grows++;
 
-        npools = npages_to_npools(npages);
-        OBD_ALLOC(pools, npools * sizeof(*pools));
-        if (pools == NULL)
-                goto out;
+	npools = npages_to_npools(npages);
+	OBD_ALLOC(pools, npools * sizeof(*pools));
+	if (pools == NULL)
+		goto out;
 
 	for (i = 0; i < npools; i++) {
-		OBD_ALLOC(pools[i], PAGE_SIZE);
+		OBD_CPT_ALLOC(pools[i], cfs_cpt_table, pool->epp_cpt,
+			      PAGE_SIZE);
 		if (pools[i] == NULL)
 			goto out_pools;
 
 		for (j = 0; j < PAGES_PER_POOL && alloced < npages; j++) {
-			pools[i][j] = alloc_page(GFP_NOFS |
-						 __GFP_HIGHMEM);
+			pools[i][j] = cfs_page_cpt_alloc(cfs_cpt_table,
+							 pool->epp_cpt,
+							 GFP_NOFS |
+							 __GFP_HIGHMEM);
 			if (pools[i][j] == NULL)
 				goto out_pools;
 
@@ -462,44 +504,45 @@ static int enc_pools_add_pages(int npages)
 	}
 	LASSERT(alloced == npages);
 
-        enc_pools_insert(pools, npools, npages);
-        CDEBUG(D_SEC, "added %d pages into pools\n", npages);
-        rc = 0;
+	enc_pools_insert(pool, pools, npools, npages);
+	CDEBUG(D_SEC, "added %d pages into pools\n", npages);
+	rc = 0;
 
 out_pools:
-        enc_pools_cleanup(pools, npools);
-        OBD_FREE(pools, npools * sizeof(*pools));
+	enc_pools_cleanup(pools, npools);
+	OBD_FREE(pools, npools * sizeof(*pools));
 out:
-        if (rc) {
-                page_pools.epp_st_grow_fails++;
-                CERROR("Failed to allocate %d enc pages\n", npages);
-        }
+	if (rc) {
+		pool->epp_st_grow_fails++;
+		CERROR("Failed to allocate %d enc pages\n", npages);
+	}
 
-	mutex_unlock(&add_pages_mutex);
-        return rc;
+	mutex_unlock(&pool->epp_add_mutex);
+	return rc;
 }
 
-static inline void enc_pools_wakeup(void)
+static inline void enc_pools_wakeup(struct ptlrpc_enc_page_pool *pool)
 {
-	assert_spin_locked(&page_pools.epp_lock);
+	assert_spin_locked(&pool->epp_lock);
 
-	if (unlikely(page_pools.epp_waitqlen)) {
-		LASSERT(waitqueue_active(&page_pools.epp_waitq));
-		wake_up_all(&page_pools.epp_waitq);
+	if (unlikely(pool->epp_waitqlen)) {
+		LASSERT(waitqueue_active(&pool->epp_waitq));
+		wake_up_all(&pool->epp_waitq);
 	}
 }
 
-static int enc_pools_should_grow(int page_needed, time64_t now)
+static int enc_pools_should_grow(struct ptlrpc_enc_page_pool *pool,
+				 int page_needed, time64_t now)
 {
 	/* don't grow if someone else is growing the pools right now,
 	 * or the pools has reached its full capacity
 	 */
-	if (page_pools.epp_growing ||
-	    page_pools.epp_total_pages == page_pools.epp_max_pages)
+	if (pool->epp_growing ||
+	    pool->epp_total_pages == pool->epp_max_pages)
 		return 0;
 
 	/* if total pages is not enough, we need to grow */
-	if (page_pools.epp_total_pages < page_needed)
+	if (pool->epp_total_pages < page_needed)
 		return 1;
 
 	/*
@@ -522,7 +565,14 @@ static int enc_pools_should_grow(int page_needed, time64_t now)
  */
 int get_free_pages_in_pool(void)
 {
-	return page_pools.epp_free_pages;
+	struct ptlrpc_enc_page_pool *pool;
+	unsigned long free = 0;
+	int i;
+
+	cfs_percpt_for_each(pool, i, page_pools)
+		free += pool->epp_free_pages;
+
+	return free;
 }
 EXPORT_SYMBOL(get_free_pages_in_pool);
 
@@ -531,84 +581,180 @@ EXPORT_SYMBOL(get_free_pages_in_pool);
  */
 int pool_is_at_full_capacity(void)
 {
-	return (page_pools.epp_total_pages == page_pools.epp_max_pages);
+	struct ptlrpc_enc_page_pool *pool;
+	int i;
+
+	cfs_percpt_for_each(pool, i, page_pools) {
+		if (pool->epp_total_pages != pool->epp_max_pages)
+			return 0;
+	}
+
+	return 1;
 }
 EXPORT_SYMBOL(pool_is_at_full_capacity);
 
+/*
+ * Take the pages for @desc from @pool, which must have enough free pages.
+ * Must be called with epp_lock held.
+ */
+static void enc_pools_take_pages(struct ptlrpc_enc_page_pool *pool,
+				 struct ptlrpc_bulk_desc *desc,
+				 unsigned long this_idle)
+{
+	int p_idx, g_idx;
+	int i;
+
+	assert_spin_locked(&pool->epp_lock);
+	LASSERT(pool->epp_free_pages >= desc->bd_iov_count);
+
+	pool->epp_free_pages -= desc->bd_iov_count;
+
+	p_idx = pool->epp_free_pages / PAGES_PER_POOL;
+	g_idx = pool->epp_free_pages % PAGES_PER_POOL;
+
+	for (i = 0; i < desc->bd_iov_count; i++) {
+		LASSERT(pool->epp_pools[p_idx][g_idx] != NULL);
+		BD_GET_ENC_KIOV(desc, i).kiov_page =
+		       pool->epp_pools[p_idx][g_idx];
+		pool->epp_pools[p_idx][g_idx] = NULL;
+
+		if (++g_idx == PAGES_PER_POOL) {
+			p_idx++;
+			g_idx = 0;
+		}
+	}
+	desc->bd_enc_cpt = pool->epp_cpt;
+
+	if (pool->epp_free_pages < pool->epp_st_lowfree)
+		pool->epp_st_lowfree = pool->epp_free_pages;
+
+	/*
+	 * new idle index = (old * weight + new) / (weight + 1)
+	 */
+	if (this_idle == -1) {
+		this_idle = pool->epp_free_pages * IDLE_IDX_MAX /
+			    pool->epp_total_pages;
+	}
+	pool->epp_idle_idx = (pool->epp_idle_idx * IDLE_IDX_WEIGHT +
+			      this_idle) /
+			     (IDLE_IDX_WEIGHT + 1);
+
+	pool->epp_last_access = ktime_get_seconds();
+}
+
+/*
+ * Take the pages for @desc from the pool of another CPT than @local, if one
+ * has enough free pages. Returns true if it is done.
+ */
+static bool enc_pools_borrow_pages(struct ptlrpc_enc_page_pool *local,
+				   struct ptlrpc_bulk_desc *desc)
+{
+	struct ptlrpc_enc_page_pool *pool;
+	int i;
+
+	cfs_percpt_for_each(pool, i, page_pools) {
+		/* a little race here is fine */
+		if (pool == local ||
+		    pool->epp_free_pages < desc->bd_iov_count)
+			continue;
+
+		spin_lock(&pool->epp_lock);
+		if (pool->epp_free_pages >= desc->bd_iov_count) {
+			pool->epp_st_access++;
+			pool->epp_st_lent++;
+			enc_pools_take_pages(pool, desc, -1);
+			spin_unlock(&pool->epp_lock);
+			return true;
+		}
+		spin_unlock(&pool->epp_lock);
+	}
+
+	return false;
+}
+
 /*
  * we allocate the requested pages atomically.
  */
 int sptlrpc_enc_pool_get_pages(struct ptlrpc_bulk_desc *desc)
 {
+	struct ptlrpc_enc_page_pool *pool;
 	wait_queue_entry_t waitlink;
 	unsigned long this_idle = -1;
 	u64 tick_ns = 0;
 	time64_t now;
-	int p_idx, g_idx;
-	int i;
 
 	LASSERT(ptlrpc_is_bulk_desc_kiov(desc->bd_type));
 	LASSERT(desc->bd_iov_count > 0);
-	LASSERT(desc->bd_iov_count <= page_pools.epp_max_pages);
 
 	/* resent bulk, enc iov might have been allocated previously */
 	if (GET_ENC_KIOV(desc) != NULL)
 		return 0;
 
+	pool = page_pools[cfs_cpt_current(cfs_cpt_table, 0)];
+	LASSERT(desc->bd_iov_count <= pool->epp_max_pages);
+
 	OBD_ALLOC_LARGE(GET_ENC_KIOV(desc),
 		  desc->bd_iov_count * sizeof(*GET_ENC_KIOV(desc)));
 	if (GET_ENC_KIOV(desc) == NULL)
 		return -ENOMEM;
 
-	spin_lock(&page_pools.epp_lock);
+	/*
+	 * the pool of this CPT cannot grow any more, rather than waiting for
+	 * pages to be returned to it, use the free pages of another CPT.
+	 * a little race here is fine.
+	 */
+	if (unlikely(pool->epp_free_pages < desc->bd_iov_count &&
+		     pool->epp_total_pages == pool->epp_max_pages) &&
+	    enc_pools_borrow_pages(pool, desc))
+		return 0;
 
-	page_pools.epp_st_access++;
+	spin_lock(&pool->epp_lock);
+
+	pool->epp_st_access++;
 again:
-	if (unlikely(page_pools.epp_free_pages < desc->bd_iov_count)) {
+	if (unlikely(pool->epp_free_pages < desc->bd_iov_count)) {
 		if (tick_ns == 0)
 			tick_ns = ktime_get_ns();
 
 		now = ktime_get_real_seconds();
 
-		page_pools.epp_st_missings++;
-		page_pools.epp_pages_short += desc->bd_iov_count;
+		pool->epp_st_missings++;
+		pool->epp_pages_short += desc->bd_iov_count;
 
-		if (enc_pools_should_grow(desc->bd_iov_count, now)) {
-			page_pools.epp_growing = 1;
+		if (enc_pools_should_grow(pool, desc->bd_iov_count, now)) {
+			pool->epp_growing = 1;
 
-			spin_unlock(&page_pools.epp_lock);
-			enc_pools_add_pages(page_pools.epp_pages_short / 2);
-			spin_lock(&page_pools.epp_lock);
+			spin_unlock(&pool->epp_lock);
+			enc_pools_add_pages(pool, pool->epp_pages_short / 2);
+			spin_lock(&pool->epp_lock);
 
-			page_pools.epp_growing = 0;
+			pool->epp_growing = 0;
 
-			enc_pools_wakeup();
+			enc_pools_wakeup(pool);
 		} else {
-			if (page_pools.epp_growing) {
-				if (++page_pools.epp_waitqlen >
-				    page_pools.epp_st_max_wqlen)
-					page_pools.epp_st_max_wqlen =
-							page_pools.epp_waitqlen;
+			if (pool->epp_growing) {
+				if (++pool->epp_waitqlen >
+				    pool->epp_st_max_wqlen)
+					pool->epp_st_max_wqlen =
+							pool->epp_waitqlen;
 
 				set_current_state(TASK_UNINTERRUPTIBLE);
 				init_waitqueue_entry(&waitlink, current);
-				add_wait_queue(&page_pools.epp_waitq,
-					       &waitlink);
+				add_wait_queue(&pool->epp_waitq, &waitlink);
 
-				spin_unlock(&page_pools.epp_lock);
+				spin_unlock(&pool->epp_lock);
 				schedule();
-				remove_wait_queue(&page_pools.epp_waitq,
-						  &waitlink);
-				LASSERT(page_pools.epp_waitqlen > 0);
-				spin_lock(&page_pools.epp_lock);
-				page_pools.epp_waitqlen--;
+				remove_wait_queue(&pool->epp_waitq, &waitlink);
+				LASSERT(pool->epp_waitqlen > 0);
+				spin_lock(&pool->epp_lock);
+				pool->epp_waitqlen--;
 			} else {
 				/* ptlrpcd thread should not sleep in that case,
 				 * or deadlock may occur!
 				 * Instead, return -ENOMEM so that upper layers
 				 * will put request back in queue. */
-				page_pools.epp_st_outofmem++;
-				spin_unlock(&page_pools.epp_lock);
+				pool->epp_st_outofmem++;
+				spin_unlock(&pool->epp_lock);
 				OBD_FREE_LARGE(GET_ENC_KIOV(desc),
 					       desc->bd_iov_count *
 						sizeof(*GET_ENC_KIOV(desc)));
@@ -617,8 +763,8 @@ again:
 			}
 		}
 
-		LASSERT(page_pools.epp_pages_short >= desc->bd_iov_count);
-		page_pools.epp_pages_short -= desc->bd_iov_count;
+		LASSERT(pool->epp_pages_short >= desc->bd_iov_count);
+		pool->epp_pages_short -= desc->bd_iov_count;
 
 		this_idle = 0;
 		goto again;
@@ -628,51 +774,21 @@ again:
 	if (unlikely(tick_ns)) {
 		ktime_t tick = ktime_sub_ns(ktime_get(), tick_ns);
 
-		if (ktime_after(tick, page_pools.epp_st_max_wait))
-			page_pools.epp_st_max_wait = tick;
-	}
-
-        /* proceed with rest of allocation */
-        page_pools.epp_free_pages -= desc->bd_iov_count;
-
-        p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
-
-	for (i = 0; i < desc->bd_iov_count; i++) {
-		LASSERT(page_pools.epp_pools[p_idx][g_idx] != NULL);
-		BD_GET_ENC_KIOV(desc, i).kiov_page =
-		       page_pools.epp_pools[p_idx][g_idx];
-		page_pools.epp_pools[p_idx][g_idx] = NULL;
-
-		if (++g_idx == PAGES_PER_POOL) {
-			p_idx++;
-			g_idx = 0;
-		}
+		if (ktime_after(tick, pool->epp_st_max_wait))
+			pool->epp_st_max_wait = tick;
 	}
 
-        if (page_pools.epp_free_pages < page_pools.epp_st_lowfree)
-                page_pools.epp_st_lowfree = page_pools.epp_free_pages;
-
-        /*
-         * new idle index = (old * weight + new) / (weight + 1)
-         */
-        if (this_idle == -1) {
-                this_idle = page_pools.epp_free_pages * IDLE_IDX_MAX /
-                            page_pools.epp_total_pages;
-        }
-        page_pools.epp_idle_idx = (page_pools.epp_idle_idx * IDLE_IDX_WEIGHT +
-                                   this_idle) /
-                                  (IDLE_IDX_WEIGHT + 1);
+	/* proceed with rest of allocation */
+	enc_pools_take_pages(pool, desc, this_idle);
 
-	page_pools.epp_last_access = ktime_get_seconds();
-
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 	return 0;
 }
 EXPORT_SYMBOL(sptlrpc_enc_pool_get_pages);
 
 void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 {
+	struct ptlrpc_enc_page_pool *pool;
 	int     p_idx, g_idx;
 	int     i;
 
@@ -683,21 +799,23 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 
 	LASSERT(desc->bd_iov_count > 0);
 
-	spin_lock(&page_pools.epp_lock);
+	/* the pages go back to the pool they have been taken from */
+	pool = page_pools[desc->bd_enc_cpt];
+	spin_lock(&pool->epp_lock);
 
-	p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-	g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
+	p_idx = pool->epp_free_pages / PAGES_PER_POOL;
+	g_idx = pool->epp_free_pages % PAGES_PER_POOL;
 
-	LASSERT(page_pools.epp_free_pages + desc->bd_iov_count <=
-		page_pools.epp_total_pages);
-	LASSERT(page_pools.epp_pools[p_idx]);
+	LASSERT(pool->epp_free_pages + desc->bd_iov_count <=
+		pool->epp_total_pages);
+	LASSERT(pool->epp_pools[p_idx]);
 
 	for (i = 0; i < desc->bd_iov_count; i++) {
 		LASSERT(BD_GET_ENC_KIOV(desc, i).kiov_page != NULL);
-		LASSERT(g_idx != 0 || page_pools.epp_pools[p_idx]);
-		LASSERT(page_pools.epp_pools[p_idx][g_idx] == NULL);
+		LASSERT(g_idx != 0 || pool->epp_pools[p_idx]);
+		LASSERT(pool->epp_pools[p_idx][g_idx] == NULL);
 
-		page_pools.epp_pools[p_idx][g_idx] =
+		pool->epp_pools[p_idx][g_idx] =
 			BD_GET_ENC_KIOV(desc, i).kiov_page;
 
 		if (++g_idx == PAGES_PER_POOL) {
@@ -706,11 +824,11 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 		}
 	}
 
-	page_pools.epp_free_pages += desc->bd_iov_count;
+	pool->epp_free_pages += desc->bd_iov_count;
 
-	enc_pools_wakeup();
+	enc_pools_wakeup(pool);
 
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 
 	OBD_FREE_LARGE(GET_ENC_KIOV(desc),
 		 desc->bd_iov_count * sizeof(*GET_ENC_KIOV(desc)));
@@ -719,28 +837,30 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 
 /*
  * we don't do much stuff for add_user/del_user anymore, except adding some
- * initial pages in add_user() if current pools are empty, rest would be
- * handled by the pools's self-adaption.
+ * initial pages in add_user() if the pool of the current CPT is empty, rest
+ * would be handled by the pools's self-adaption.
  */
 int sptlrpc_enc_pool_add_user(void)
 {
+	struct ptlrpc_enc_page_pool *pool;
 	int     need_grow = 0;
 
-	spin_lock(&page_pools.epp_lock);
-	if (page_pools.epp_growing == 0 && page_pools.epp_total_pages == 0) {
-		page_pools.epp_growing = 1;
+	pool = page_pools[cfs_cpt_current(cfs_cpt_table, 0)];
+	spin_lock(&pool->epp_lock);
+	if (pool->epp_growing == 0 && pool->epp_total_pages == 0) {
+		pool->epp_growing = 1;
 		need_grow = 1;
 	}
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 
 	if (need_grow) {
-		enc_pools_add_pages(PTLRPC_MAX_BRW_PAGES +
-				    PTLRPC_MAX_BRW_PAGES);
+		enc_pools_add_pages(pool, PTLRPC_MAX_BRW_PAGES +
+					  PTLRPC_MAX_BRW_PAGES);
 
-		spin_lock(&page_pools.epp_lock);
-		page_pools.epp_growing = 0;
-		enc_pools_wakeup();
-		spin_unlock(&page_pools.epp_lock);
+		spin_lock(&pool->epp_lock);
+		pool->epp_growing = 0;
+		enc_pools_wakeup(pool);
+		spin_unlock(&pool->epp_lock);
 	}
 	return 0;
 }
@@ -752,100 +872,99 @@ int sptlrpc_enc_pool_del_user(void)
 }
 EXPORT_SYMBOL(sptlrpc_enc_pool_del_user);
 
-static inline void enc_pools_alloc(void)
+static void enc_pools_fini(void)
 {
-	LASSERT(page_pools.epp_max_pools);
-	OBD_ALLOC_LARGE(page_pools.epp_pools,
-			page_pools.epp_max_pools *
-			sizeof(*page_pools.epp_pools));
-}
+	struct ptlrpc_enc_page_pool *pool;
+	unsigned long cleaned, npools;
+	int i;
 
-static inline void enc_pools_free(void)
-{
-	LASSERT(page_pools.epp_max_pools);
-	LASSERT(page_pools.epp_pools);
+	cfs_percpt_for_each(pool, i, page_pools) {
+		if (pool->epp_pools == NULL)
+			continue;
+
+		LASSERT(pool->epp_total_pages == pool->epp_free_pages);
+		npools = npages_to_npools(pool->epp_total_pages);
+		cleaned = enc_pools_cleanup(pool->epp_pools, npools);
+		LASSERT(cleaned == pool->epp_total_pages);
+
+		OBD_FREE_LARGE(pool->epp_pools,
+			       pool->epp_max_pools * sizeof(*pool->epp_pools));
+
+		if (pool->epp_st_access > 0) {
+			CDEBUG(D_SEC,
+			       "cpt %d: max pages %lu, grows %u, grow fails %u, shrinks %u, access %lu, missing %lu, max qlen %u, max wait ms %lld, out of mem %lu, lent %lu\n",
+			       i, pool->epp_st_max_pages, pool->epp_st_grows,
+			       pool->epp_st_grow_fails,
+			       pool->epp_st_shrinks, pool->epp_st_access,
+			       pool->epp_st_missings, pool->epp_st_max_wqlen,
+			       ktime_to_ms(pool->epp_st_max_wait),
+			       pool->epp_st_outofmem, pool->epp_st_lent);
+		}
+	}
 
-	OBD_FREE_LARGE(page_pools.epp_pools,
-		       page_pools.epp_max_pools *
-		       sizeof(*page_pools.epp_pools));
+	cfs_percpt_free(page_pools);
+	page_pools = NULL;
 }
 
 int sptlrpc_enc_pool_init(void)
 {
 	DEF_SHRINKER_VAR(shvar, enc_pools_shrink,
 			 enc_pools_shrink_count, enc_pools_shrink_scan);
+	struct ptlrpc_enc_page_pool *pool;
+	unsigned long max_pages;
+	int i;
 
-	page_pools.epp_max_pages = cfs_totalram_pages() / 8;
+	max_pages = cfs_totalram_pages() / 8;
 	if (enc_pool_max_memory_mb > 0 &&
 	    enc_pool_max_memory_mb <= (cfs_totalram_pages() >> mult))
-		page_pools.epp_max_pages = enc_pool_max_memory_mb << mult;
-
-	page_pools.epp_max_pools = npages_to_npools(page_pools.epp_max_pages);
-
-	init_waitqueue_head(&page_pools.epp_waitq);
-	page_pools.epp_waitqlen = 0;
-	page_pools.epp_pages_short = 0;
+		max_pages = enc_pool_max_memory_mb << mult;
 
-        page_pools.epp_growing = 0;
+	/* the memory is shared by the pools of all CPTs */
+	max_pages /= cfs_cpt_number(cfs_cpt_table);
+	if (max_pages < PTLRPC_MAX_BRW_PAGES)
+		max_pages = PTLRPC_MAX_BRW_PAGES;
 
-        page_pools.epp_idle_idx = 0;
-	page_pools.epp_last_shrink = ktime_get_seconds();
-	page_pools.epp_last_access = ktime_get_seconds();
-
-	spin_lock_init(&page_pools.epp_lock);
-        page_pools.epp_total_pages = 0;
-        page_pools.epp_free_pages = 0;
-
-        page_pools.epp_st_max_pages = 0;
-        page_pools.epp_st_grows = 0;
-        page_pools.epp_st_grow_fails = 0;
-        page_pools.epp_st_shrinks = 0;
-        page_pools.epp_st_access = 0;
-        page_pools.epp_st_missings = 0;
-        page_pools.epp_st_lowfree = 0;
-        page_pools.epp_st_max_wqlen = 0;
-	page_pools.epp_st_max_wait = ktime_set(0, 0);
-	page_pools.epp_st_outofmem = 0;
+	page_pools = cfs_percpt_alloc(cfs_cpt_table, sizeof(*pool));
+	if (page_pools == NULL)
+		return -ENOMEM;
 
-        enc_pools_alloc();
-        if (page_pools.epp_pools == NULL)
-                return -ENOMEM;
+	cfs_percpt_for_each(pool, i, page_pools) {
+		pool->epp_max_pages = max_pages;
+		pool->epp_max_pools = npages_to_npools(max_pages);
+		pool->epp_cpt = i;
+
+		init_waitqueue_head(&pool->epp_waitq);
+		mutex_init(&pool->epp_add_mutex);
+		pool->epp_last_shrink = ktime_get_seconds();
+		pool->epp_last_access = ktime_get_seconds();
+		spin_lock_init(&pool->epp_lock);
+		pool->epp_st_max_wait = ktime_set(0, 0);
+
+		OBD_CPT_ALLOC_LARGE(pool->epp_pools, cfs_cpt_table, i,
+				    pool->epp_max_pools *
+				    sizeof(*pool->epp_pools));
+		if (pool->epp_pools == NULL) {
+			enc_pools_fini();
+			return -ENOMEM;
+		}
+	}
 
 	pools_shrinker = set_shrinker(pools_shrinker_seeks, &shvar);
-        if (pools_shrinker == NULL) {
-                enc_pools_free();
-                return -ENOMEM;
-        }
+	if (pools_shrinker == NULL) {
+		enc_pools_fini();
+		return -ENOMEM;
+	}
 
-        return 0;
+	return 0;
 }
 
 void sptlrpc_enc_pool_fini(void)
 {
-        unsigned long cleaned, npools;
-
-        LASSERT(pools_shrinker);
-        LASSERT(page_pools.epp_pools);
-        LASSERT(page_pools.epp_total_pages == page_pools.epp_free_pages);
+	LASSERT(pools_shrinker);
+	LASSERT(page_pools);
 
 	remove_shrinker(pools_shrinker);
-
-        npools = npages_to_npools(page_pools.epp_total_pages);
-        cleaned = enc_pools_cleanup(page_pools.epp_pools, npools);
-        LASSERT(cleaned == page_pools.epp_total_pages);
-
-        enc_pools_free();
-
-	if (page_pools.epp_st_access > 0) {
-		CDEBUG(D_SEC,
-		       "max pages %lu, grows %u, grow fails %u, shrinks %u, access %lu, missing %lu, max qlen %u, max wait ms %lld, out of mem %lu\n",
-		       page_pools.epp_st_max_pages, page_pools.epp_st_grows,
-		       page_pools.epp_st_grow_fails,
-		       page_pools.epp_st_shrinks, page_pools.epp_st_access,
-		       page_pools.epp_st_missings, page_pools.epp_st_max_wqlen,
-		       ktime_to_ms(page_pools.epp_st_max_wait),
-		       page_pools.epp_st_outofmem);
-	}
+	enc_pools_fini();
 }
 
 
@@ -0,0 +1,318 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/ptlrpc/sec_msgbuf.c
+ *
+ * Pools of request and reply message buffers of the client.
+ *
+ * The null and plain flavors allocate message buffers with sizes rounded up
+ * to a power of two. The buffers of each size, from MSGBUF_MIN_SIZE to
+ * MSGBUF_MAX_SIZE, that are freed are kept in a pool of the CPT of their
+ * memory, up to msgbuf_pool_max of them, so that most RPCs reuse buffers
+ * instead of going through kmalloc(), or vmalloc() for the large ones. The
+ * shrinker releases the buffers kept when memory is tight.
+ */
+
+#define DEBUG_SUBSYSTEM S_SEC
+
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <libcfs/libcfs.h>
+#include <obd_support.h>
+#include <lustre_net.h>
+#include <lustre_sec.h>
+
+#include "ptlrpc_internal.h"
+
+static unsigned int msgbuf_pool_max = 32;
+module_param(msgbuf_pool_max, uint, 0644);
+MODULE_PARM_DESC(msgbuf_pool_max,
+		 "maximum free message buffers kept per size and CPT (0 to disable)");
+
+#define MSGBUF_MIN_SHIFT	10
+#define MSGBUF_MAX_SHIFT	16
+#define MSGBUF_MIN_SIZE		(1 << MSGBUF_MIN_SHIFT)
+#define MSGBUF_MAX_SIZE		(1 << MSGBUF_MAX_SHIFT)
+#define MSGBUF_NR_CLASSES	(MSGBUF_MAX_SHIFT - MSGBUF_MIN_SHIFT + 1)
+
+struct ptlrpc_msgbuf_pool {
+	spinlock_t		 mbp_lock;
+	/** free buffers of each size, linked through their first bytes */
+	struct list_head	 mbp_free[MSGBUF_NR_CLASSES];
+	unsigned int		 mbp_nfree[MSGBUF_NR_CLASSES];
+	/** statistics */
+	unsigned long		 mbp_st_hits[MSGBUF_NR_CLASSES];
+	unsigned long		 mbp_st_misses[MSGBUF_NR_CLASSES];
+};
+
+static struct ptlrpc_msgbuf_pool **msgbuf_pools;
+static struct shrinker *msgbuf_shrinker;
+
+static inline int msgbuf_class(int size)
+{
+	if (size <= MSGBUF_MIN_SIZE)
+		return 0;
+	return fls(size - 1) - MSGBUF_MIN_SHIFT;
+}
+
+static inline int msgbuf_class_size(int idx)
+{
+	return MSGBUF_MIN_SIZE << idx;
+}
+
+/* CPT of the memory of buffer @buf */
+static int msgbuf_cpt(void *buf)
+{
+	struct page *page;
+
+	if (is_vmalloc_addr(buf))
+		page = vmalloc_to_page(buf);
+	else
+		page = virt_to_page(buf);
+
+	return cfs_cpt_of_node(cfs_cpt_table, page_to_nid(page));
+}
+
+/**
+ * Allocate a zeroed message buffer of \a size bytes, from the pool of the
+ * current CPT if it has one.
+ */
+void *sptlrpc_msgbuf_alloc(int size)
+{
+	struct ptlrpc_msgbuf_pool *pool;
+	struct list_head *buf = NULL;
+	int cpt;
+	int idx;
+
+	if (size > MSGBUF_MAX_SIZE) {
+		OBD_ALLOC_LARGE(buf, size);
+		return buf;
+	}
+
+	idx = msgbuf_class(size);
+	cpt = cfs_cpt_current(cfs_cpt_table, 0);
+	pool = msgbuf_pools[cpt];
+
+	spin_lock(&pool->mbp_lock);
+	if (!list_empty(&pool->mbp_free[idx])) {
+		buf = pool->mbp_free[idx].next;
+		list_del(buf);
+		pool->mbp_nfree[idx]--;
+		pool->mbp_st_hits[idx]++;
+	} else {
+		pool->mbp_st_misses[idx]++;
+	}
+	spin_unlock(&pool->mbp_lock);
+
+	if (buf != NULL) {
+		memset(buf, 0, size);
+		return buf;
+	}
+
+	OBD_CPT_ALLOC_LARGE(buf, cfs_cpt_table, cpt, msgbuf_class_size(idx));
+	return buf;
+}
+
+/**
+ * Free message buffer \a buf of \a size bytes, allocated by
+ * sptlrpc_msgbuf_alloc(), keeping it in the pool of its CPT if that one
+ * is not full.
+ */
+void sptlrpc_msgbuf_free(void *buf, int size)
+{
+	struct ptlrpc_msgbuf_pool *pool;
+	int idx;
+
+	if (size > MSGBUF_MAX_SIZE) {
+		OBD_FREE_LARGE(buf, size);
+		return;
+	}
+
+	idx = msgbuf_class(size);
+	pool = msgbuf_pools[msgbuf_cpt(buf)];
+
+	spin_lock(&pool->mbp_lock);
+	if (pool->mbp_nfree[idx] < msgbuf_pool_max) {
+		list_add(buf, &pool->mbp_free[idx]);
+		pool->mbp_nfree[idx]++;
+		buf = NULL;
+	}
+	spin_unlock(&pool->mbp_lock);
+
+	if (buf != NULL)
+		OBD_FREE_LARGE(buf, msgbuf_class_size(idx));
+}
+
+/* Release up to @count free buffers of @pool, the largest first */
+static unsigned long msgbuf_pool_release(struct ptlrpc_msgbuf_pool *pool,
+					 unsigned long count)
+{
+	struct list_head *buf;
+	struct list_head list;
+	unsigned long released = 0;
+	int idx;
+
+	for (idx = MSGBUF_NR_CLASSES - 1; idx >= 0; idx--) {
+		INIT_LIST_HEAD(&list);
+		spin_lock(&pool->mbp_lock);
+		while (released < count && !list_empty(&pool->mbp_free[idx])) {
+			list_move(pool->mbp_free[idx].next, &list);
+			pool->mbp_nfree[idx]--;
+			released++;
+		}
+		spin_unlock(&pool->mbp_lock);
+
+		while (!list_empty(&list)) {
+			buf = list.next;
+			list_del(buf);
+			OBD_FREE_LARGE(buf, msgbuf_class_size(idx));
+		}
+	}
+
+	return released;
+}
+
+static unsigned long msgbuf_shrink_count(struct shrinker *s,
+					 struct shrink_control *sc)
+{
+	struct ptlrpc_msgbuf_pool *pool;
+	unsigned long count = 0;
+	int idx;
+	int i;
+
+	cfs_percpt_for_each(pool, i, msgbuf_pools) {
+		for (idx = 0; idx < MSGBUF_NR_CLASSES; idx++)
+			count += pool->mbp_nfree[idx];
+	}
+
+	return count;
+}
+
+static unsigned long msgbuf_shrink_scan(struct shrinker *s,
+					struct shrink_control *sc)
+{
+	struct ptlrpc_msgbuf_pool *pool;
+	unsigned long released = 0;
+	int i;
+
+	cfs_percpt_for_each(pool, i, msgbuf_pools) {
+		if (released >= sc->nr_to_scan)
+			break;
+		released += msgbuf_pool_release(pool,
+						sc->nr_to_scan - released);
+	}
+
+	sc->nr_to_scan = released;
+	return released;
+}
+
+#ifndef HAVE_SHRINKER_COUNT
+static int msgbuf_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	struct shrink_control scv = {
+		.nr_to_scan = shrink_param(sc, nr_to_scan),
+		.gfp_mask   = shrink_param(sc, gfp_mask)
+	};
+#if !defined(HAVE_SHRINKER_WANT_SHRINK_PTR) && !defined(HAVE_SHRINK_CONTROL)
+	struct shrinker *shrinker = NULL;
+#endif
+
+	msgbuf_shrink_scan(shrinker, &scv);
+
+	return msgbuf_shrink_count(shrinker, &scv);
+}
+#endif /* HAVE_SHRINKER_COUNT */
+
+/*
+ * /sys/kernel/debug/lustre/sptlrpc/msgbuf_pools
+ */
+int sptlrpc_proc_msgbuf_pool_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_msgbuf_pool *pool;
+	int idx;
+	int i;
+
+	seq_printf(m, "%-6s %8s %8s %12s %12s\n",
+		   "cpt", "size", "free", "hits", "misses");
+
+	cfs_percpt_for_each(pool, i, msgbuf_pools) {
+		spin_lock(&pool->mbp_lock);
+		for (idx = 0; idx < MSGBUF_NR_CLASSES; idx++)
+			seq_printf(m, "%-6d %8d %8u %12lu %12lu\n", i,
+				   msgbuf_class_size(idx), pool->mbp_nfree[idx],
+				   pool->mbp_st_hits[idx],
+				   pool->mbp_st_misses[idx]);
+		spin_unlock(&pool->mbp_lock);
+	}
+
+	return 0;
+}
+
+static void msgbuf_pools_fini(void)
+{
+	struct ptlrpc_msgbuf_pool *pool;
+	int i;
+
+	cfs_percpt_for_each(pool, i, msgbuf_pools)
+		msgbuf_pool_release(pool, ULONG_MAX);
+
+	cfs_percpt_free(msgbuf_pools);
+	msgbuf_pools = NULL;
+}
+
+int sptlrpc_msgbuf_pool_init(void)
+{
+	DEF_SHRINKER_VAR(shvar, msgbuf_shrink,
+			 msgbuf_shrink_count, msgbuf_shrink_scan);
+	struct ptlrpc_msgbuf_pool *pool;
+	int idx;
+	int i;
+
+	msgbuf_pools = cfs_percpt_alloc(cfs_cpt_table, sizeof(*pool));
+	if (msgbuf_pools == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(pool, i, msgbuf_pools) {
+		spin_lock_init(&pool->mbp_lock);
+		for (idx = 0; idx < MSGBUF_NR_CLASSES; idx++)
+			INIT_LIST_HEAD(&pool->mbp_free[idx]);
+	}
+
+	msgbuf_shrinker = set_shrinker(DEFAULT_SEEKS, &shvar);
+	if (msgbuf_shrinker == NULL) {
+		msgbuf_pools_fini();
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void sptlrpc_msgbuf_pool_fini(void)
+{
+	LASSERT(msgbuf_shrinker);
+	LASSERT(msgbuf_pools);
+
+	remove_shrinker(msgbuf_shrinker);
+	msgbuf_pools_fini();
+}
@@ -55,11 +55,17 @@ module_param(at_early_margin, int, 0644);
 MODULE_PARM_DESC(at_early_margin, "How soon before an RPC deadline to send an early reply");
 module_param(at_extra, int, 0644);
 MODULE_PARM_DESC(at_extra, "How much extra time to give with each early reply");
+unsigned int rpc_trace_sample;
+module_param(rpc_trace_sample, uint, 0644);
+MODULE_PARM_DESC(rpc_trace_sample,
+		 "Log the latency breakdown of one RPC in this many to the rpctrace debug log (0 to disable)");
 
 /* forward ref */
 static int ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt);
 static void ptlrpc_server_hpreq_fini(struct ptlrpc_request *req);
 static void ptlrpc_at_remove_timed(struct ptlrpc_request *req);
+static void ptlrpc_server_trace_req(struct ptlrpc_request *req,
+				    ktime_t work_end);
 
 /** Holds a list of all PTLRPC services */
 struct list_head ptlrpc_all_services;
@@ -475,11 +481,11 @@ ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt)
 	return -1;
 }
 
-static void ptlrpc_at_timer(cfs_timer_cb_arg_t data)
+static void ptlrpc_at_timer(struct ptlrpc_timer *t)
 {
 	struct ptlrpc_service_part *svcpt;
 
-	svcpt = cfs_from_timer(svcpt, data, scp_at_timer);
+	svcpt = container_of(t, struct ptlrpc_service_part, scp_at_timer);
 
 	svcpt->scp_at_check = 1;
 	svcpt->scp_at_checktime = ktime_get();
@@ -602,6 +608,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 
 	svcpt->scp_cpt = cpt;
 	INIT_LIST_HEAD(&svcpt->scp_threads);
+	spin_lock_init(&svcpt->scp_req_wait_hist.oh_lock);
 
 	/* rqbd and incoming request queue */
 	spin_lock_init(&svcpt->scp_lock);
@@ -609,6 +616,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_idle);
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
 	INIT_LIST_HEAD(&svcpt->scp_req_incoming);
+	init_llist_head(&svcpt->scp_req_arrived);
 	init_waitqueue_head(&svcpt->scp_waitq);
 	/* history request & rqbd list */
 	INIT_LIST_HEAD(&svcpt->scp_hist_reqs);
@@ -623,6 +631,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	INIT_LIST_HEAD(&svcpt->scp_rep_idle);
 	init_waitqueue_head(&svcpt->scp_rep_waitq);
 	atomic_set(&svcpt->scp_nreps_difficult, 0);
+	lustre_rs_pools_init(svcpt);
 
 	/* adaptive timeout */
 	spin_lock_init(&svcpt->scp_at_lock);
@@ -647,8 +656,8 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	if (array->paa_reqs_count == NULL)
 		goto failed;
 
-	cfs_timer_setup(&svcpt->scp_at_timer, ptlrpc_at_timer,
-			(unsigned long)svcpt, 0);
+	ptlrpc_timer_init(&svcpt->scp_at_timer, ptlrpc_at_timer,
+			  svc->srv_cptable == cfs_cpt_table ? cpt : -1);
 
 	/* At SOW, service time should be quick; 10s seems generous. If client
 	 * timeout is less than this, we'll be sending an early reply. */
@@ -1073,6 +1082,11 @@ void ptlrpc_update_export_timer(struct obd_export *exp, time64_t extra_delay)
 
         LASSERT(exp);
 
+	/* the exports of this client node sharing pings are alive too */
+	if (exp->exp_connection != NULL &&
+	    exp->exp_connection->c_last_alive != ktime_get_real_seconds())
+		exp->exp_connection->c_last_alive = ktime_get_real_seconds();
+
         /* Compensate for slow machines, etc, by faking our request time
            into the future.  Although this can break the strict time-ordering
            of the list, we can be really lazy here - we don't have to evict
@@ -1194,7 +1208,7 @@ static void ptlrpc_at_set_timer(struct ptlrpc_service_part *svcpt)
 	time64_t next;
 
 	if (array->paa_count == 0) {
-		del_timer(&svcpt->scp_at_timer);
+		ptlrpc_timer_disarm(&svcpt->scp_at_timer);
 		return;
 	}
 
@@ -1202,10 +1216,10 @@ static void ptlrpc_at_set_timer(struct ptlrpc_service_part *svcpt)
 	next = array->paa_deadline - ktime_get_real_seconds() -
 	       at_early_margin;
 	if (next <= 0) {
-		ptlrpc_at_timer(cfs_timer_cb_arg(svcpt, scp_at_timer));
+		ptlrpc_at_timer(&svcpt->scp_at_timer);
 	} else {
-		mod_timer(&svcpt->scp_at_timer,
-			  jiffies + nsecs_to_jiffies(next * NSEC_PER_SEC));
+		ptlrpc_timer_arm(&svcpt->scp_at_timer,
+				 jiffies + nsecs_to_jiffies(next * NSEC_PER_SEC));
 		CDEBUG(D_INFO, "armed %s at %+llds\n",
 		       svcpt->scp_service->srv_name, next);
 	}
@@ -1909,6 +1923,8 @@ ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
 	ENTRY;
 
 	spin_lock(&svcpt->scp_lock);
+	if (list_empty(&svcpt->scp_req_incoming))
+		ptlrpc_server_drain_arrived(svcpt);
 	if (list_empty(&svcpt->scp_req_incoming)) {
 		spin_unlock(&svcpt->scp_lock);
 		RETURN(0);
@@ -2097,8 +2113,13 @@ ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 		libcfs_debug_dumplog();
 
 	work_start = ktime_get_real();
+	request->rq_handle_start = work_start;
 	arrived = timespec64_to_ktime(request->rq_arrival_time);
 	timediff_usecs = ktime_us_delta(work_start, arrived);
+	lprocfs_oh_tally_log2(&svcpt->scp_req_wait_hist,
+			      max_t(s64, timediff_usecs, 0));
+	svcpt->scp_req_wait_avg += (timediff_usecs -
+				    svcpt->scp_req_wait_avg) / 8;
 	if (likely(svc->srv_stats != NULL)) {
                 lprocfs_counter_add(svc->srv_stats, PTLRPC_REQWAIT_CNTR,
 				    timediff_usecs);
@@ -2204,12 +2225,37 @@ put_conn:
 			  request->rq_early_count,
 			  div_u64(arrived_usecs, USEC_PER_SEC));
 	}
+	if (unlikely(ptlrpc_req_traced(request)))
+		ptlrpc_server_trace_req(request, work_end);
 
 	ptlrpc_server_finish_active_request(svcpt, request);
 
 	RETURN(1);
 }
 
+/**
+ * Log where the time went for a request sampled by rpc_trace_sample: waiting
+ * in the NRS queue, in the handler, on bulk transfers, and after the reply
+ * was sent.
+ */
+static void ptlrpc_server_trace_req(struct ptlrpc_request *req,
+				    ktime_t work_end)
+{
+	ktime_t arrived = timespec64_to_ktime(req->rq_arrival_time);
+	ktime_t sent = req->rq_reply_sent;
+
+	if (ktime_to_ns(sent) == 0)
+		sent = work_end;
+
+	DEBUG_REQ(D_RPCTRACE, req,
+		  "trace: queue %lldus handler %lldus bulk %lldus after reply %lldus total %lldus",
+		  ktime_us_delta(req->rq_handle_start, arrived),
+		  ktime_us_delta(sent, req->rq_handle_start),
+		  ktime_to_us(req->rq_bulk_time),
+		  ktime_us_delta(work_end, sent),
+		  ktime_us_delta(work_end, arrived));
+}
+
 /**
  * An internal function to process a single reply state object.
  */
@@ -2417,15 +2463,43 @@ ptlrpc_threads_increasable(struct ptlrpc_service_part *svcpt)
 }
 
 /**
- * too many requests and allowed to create more threads
+ * requests wait longer than the target of the autoscaler
+ */
+static inline bool
+ptlrpc_threads_too_slow(struct ptlrpc_service_part *svcpt)
+{
+	int target = svcpt->scp_service->srv_wait_target_us;
+
+	return target != 0 && svcpt->scp_req_wait_avg > target;
+}
+
+/**
+ * too many requests, or requests waiting too long, and allowed to create
+ * more threads
  */
 static inline int
 ptlrpc_threads_need_create(struct ptlrpc_service_part *svcpt)
 {
-	return !ptlrpc_threads_enough(svcpt) &&
+	return (!ptlrpc_threads_enough(svcpt) ||
+		ptlrpc_threads_too_slow(svcpt)) &&
 		ptlrpc_threads_increasable(svcpt);
 }
 
+/**
+ * the autoscaler is enabled and there are more threads than the minimum
+ * user can call it w/o any lock but need to hold
+ * ptlrpc_service_part::scp_lock to get reliable result
+ */
+static inline bool
+ptlrpc_threads_shrinkable(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service *svc = svcpt->scp_service;
+
+	return svc->srv_wait_target_us != 0 &&
+	       svcpt->scp_nthrs_running - svcpt->scp_nthrs_stopping >
+	       svc->srv_nthrs_cpt_init;
+}
+
 static inline int
 ptlrpc_thread_stopping(struct ptlrpc_thread *thread)
 {
@@ -2454,9 +2528,44 @@ ptlrpc_at_check(struct ptlrpc_service_part *svcpt)
 static inline int
 ptlrpc_server_request_incoming(struct ptlrpc_service_part *svcpt)
 {
-	return !list_empty(&svcpt->scp_req_incoming);
+	return !list_empty(&svcpt->scp_req_incoming) ||
+	       !llist_empty(&svcpt->scp_req_arrived);
 }
 
+/**
+ * Called when \a thread has been idle for PTLRPC_THR_IDLE_TIME, returns true
+ * if it should exit to shrink the pool of threads. The idle time counts as a
+ * request which did not wait for the autoscaler.
+ */
+static bool
+ptlrpc_thread_idle_exit(struct ptlrpc_service_part *svcpt,
+			struct ptlrpc_thread *thread)
+{
+	int target = svcpt->scp_service->srv_wait_target_us;
+	bool exit = false;
+
+	svcpt->scp_req_wait_avg -= svcpt->scp_req_wait_avg / 8;
+
+	spin_lock(&svcpt->scp_lock);
+	if (ptlrpc_threads_shrinkable(svcpt) &&
+	    svcpt->scp_req_wait_avg < target / 2 &&
+	    !ptlrpc_server_request_incoming(svcpt)) {
+		svcpt->scp_nthrs_stopping++;
+		exit = true;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	if (exit)
+		CDEBUG(D_RPCTRACE, "%s: idle thread %s exiting, %d running\n",
+		       svcpt->scp_service->srv_name, thread->t_name,
+		       svcpt->scp_nthrs_running);
+	return exit;
+}
+
+/**
+ * Wait for something to do, returns -EINTR if \a thread has to stop, and
+ * -ETIMEDOUT if it has to exit because it is idle.
+ */
 static __attribute__((__noinline__)) int
 ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 		  struct ptlrpc_thread *thread)
@@ -2464,12 +2573,20 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	/* Don't exit while there are replies to be handled */
 	struct l_wait_info lwi = LWI_TIMEOUT(svcpt->scp_rqbd_timeout,
 					     ptlrpc_retry_rqbds, svcpt);
+	bool idle = false;
+	int rc;
+
+	if (svcpt->scp_rqbd_timeout == 0 && ptlrpc_threads_shrinkable(svcpt)) {
+		lwi = LWI_TIMEOUT(cfs_time_seconds(PTLRPC_THR_IDLE_TIME),
+				  NULL, NULL);
+		idle = true;
+	}
 
 	lc_watchdog_disable(thread->t_watchdog);
 
 	cond_resched();
 
-	l_wait_event_exclusive_head(svcpt->scp_waitq,
+	rc = l_wait_event_exclusive_head(svcpt->scp_waitq,
 				ptlrpc_thread_stopping(thread) ||
 				ptlrpc_server_request_incoming(svcpt) ||
 				ptlrpc_server_request_pending(svcpt, false) ||
@@ -2479,6 +2596,9 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	if (ptlrpc_thread_stopping(thread))
 		return -EINTR;
 
+	if (idle && rc == -ETIMEDOUT && ptlrpc_thread_idle_exit(svcpt, thread))
+		return -ETIMEDOUT;
+
 	lc_watchdog_touch(thread->t_watchdog,
 			  ptlrpc_server_get_timeout(svcpt));
 	return 0;
@@ -2498,6 +2618,7 @@ static int ptlrpc_main(void *arg)
 	struct ptlrpc_reply_state	*rs;
 	struct group_info *ginfo = NULL;
 	struct lu_env *env;
+	bool idle_exit = false;
 	int counter = 0, rc = 0;
 	ENTRY;
 
@@ -2589,8 +2710,12 @@ static int ptlrpc_main(void *arg)
 
 	/* XXX maintain a list of all managed devices: insert here */
 	while (!ptlrpc_thread_stopping(thread)) {
-		if (ptlrpc_wait_event(svcpt, thread))
+		rc = ptlrpc_wait_event(svcpt, thread);
+		if (rc) {
+			idle_exit = rc == -ETIMEDOUT;
+			rc = 0;
 			break;
+		}
 
 		ptlrpc_check_rqbd_pool(svcpt);
 
@@ -2664,6 +2789,17 @@ out:
 		svcpt->scp_nthrs_running--;
 	}
 
+	if (idle_exit) {
+		svcpt->scp_nthrs_stopping--;
+		/* nobody waits for us, unless the service is being stopped */
+		if (!thread_is_stopping(thread)) {
+			list_del(&thread->t_link);
+			spin_unlock(&svcpt->scp_lock);
+			OBD_FREE_PTR(thread);
+			return rc;
+		}
+	}
+
 	thread->t_id = rc;
 	thread_add_flags(thread, SVC_STOPPED);
 
@@ -3131,7 +3267,7 @@ ptlrpc_service_del_atimer(struct ptlrpc_service *svc)
 	/* early disarm AT timer... */
 	ptlrpc_service_for_each_part(svcpt, i, svc) {
 		if (svcpt->scp_service != NULL)
-			del_timer(&svcpt->scp_at_timer);
+			ptlrpc_timer_disarm(&svcpt->scp_at_timer);
 	}
 }
 
@@ -3218,6 +3354,9 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 		/* purge the request queue.  NB No new replies (rqbds
 		 * all unlinked) and no service threads, so I'm the only
 		 * thread noodling the request queue now */
+		spin_lock(&svcpt->scp_lock);
+		ptlrpc_server_drain_arrived(svcpt);
+		spin_unlock(&svcpt->scp_lock);
 		while (!list_empty(&svcpt->scp_req_incoming)) {
 			req = list_entry(svcpt->scp_req_incoming.next,
 					     struct ptlrpc_request, rq_list);
@@ -3257,6 +3396,7 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 			list_del(&rs->rs_list);
 			OBD_FREE_LARGE(rs, svc->srv_max_reply_size);
 		}
+		lustre_rs_pools_fini(svcpt);
 	}
 }
 
@@ -3272,7 +3412,7 @@ ptlrpc_service_free(struct ptlrpc_service *svc)
 			break;
 
 		/* In case somebody rearmed this in the meantime */
-		del_timer(&svcpt->scp_at_timer);
+		ptlrpc_timer_disarm(&svcpt->scp_at_timer);
 		array = &svcpt->scp_at_array;
 
 		if (array->paa_reqs_array != NULL) {
@@ -0,0 +1,331 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/ptlrpc/twheel.c
+ *
+ * Timer wheels shared by the ptlrpc client request timeouts and the server
+ * adaptive timeout early replies.
+ *
+ * There is one hierarchical wheel per CPT, with a resolution of one jiffy.
+ * Arming and disarming a timer is O(1), and each wheel needs just one kernel
+ * timer, armed for the next slot that holds timers so that an idle wheel does
+ * not wake up at all. Timers further than the range of the wheel are kept in
+ * its last slot and cascaded down again until they expire.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <linux/timer.h>
+#include <obd_support.h>
+#include <lustre_net.h>
+#include "ptlrpc_internal.h"
+
+#define PTW_BITS	6
+#define PTW_SIZE	(1 << PTW_BITS)
+#define PTW_MASK	(PTW_SIZE - 1)
+#define PTW_LEVELS	4
+#define PTW_RANGE	(1UL << (PTW_BITS * PTW_LEVELS))
+
+struct ptlrpc_twheel {
+	spinlock_t		 tw_lock;
+	/** next tick, in jiffies, the wheel has to process */
+	unsigned long		 tw_tick;
+	/** # of armed timers */
+	unsigned long		 tw_count;
+	/** timer being run, see ptlrpc_timer_disarm() */
+	struct ptlrpc_timer	*tw_running;
+	/** slots holding timers, one bit per slot and level */
+	__u64			 tw_pending[PTW_LEVELS];
+	struct timer_list	 tw_timer;
+	struct list_head	 tw_slots[PTW_LEVELS][PTW_SIZE];
+};
+
+static struct ptlrpc_twheel **ptlrpc_twheels;
+
+/* Must be called with tw_lock held */
+static void ptw_insert(struct ptlrpc_twheel *tw, struct ptlrpc_timer *t)
+{
+	unsigned long expires = t->pt_expires;
+	unsigned long delta;
+	unsigned int idx;
+	int level;
+
+	if (time_before(expires, tw->tw_tick))
+		expires = tw->tw_tick;
+	delta = expires - tw->tw_tick;
+	if (delta >= PTW_RANGE)
+		expires = tw->tw_tick + PTW_RANGE - 1;
+
+	for (level = 0; level < PTW_LEVELS - 1; level++) {
+		if (delta < 1UL << ((level + 1) * PTW_BITS))
+			break;
+	}
+
+	idx = (expires >> (level * PTW_BITS)) & PTW_MASK;
+	list_add_tail(&t->pt_link, &tw->tw_slots[level][idx]);
+	tw->tw_pending[level] |= 1ULL << idx;
+}
+
+/* Must be called with tw_lock held */
+static void ptw_remove(struct ptlrpc_twheel *tw, struct ptlrpc_timer *t)
+{
+	struct list_head *next = t->pt_link.next;
+
+	list_del_init(&t->pt_link);
+	tw->tw_count--;
+
+	/* if @t was the last one of its slot, @next is the slot itself */
+	if (list_empty(next)) {
+		int level;
+
+		for (level = 0; level < PTW_LEVELS; level++) {
+			struct list_head *slots = tw->tw_slots[level];
+
+			if (next < slots || next >= slots + PTW_SIZE)
+				continue;
+			tw->tw_pending[level] &= ~(1ULL << (next - slots));
+			break;
+		}
+	}
+}
+
+/*
+ * Return the next tick the wheel has something to do at, either running the
+ * timers of a slot of the first level, or cascading the timers of the upper
+ * levels into the lower ones.
+ */
+static unsigned long ptw_next_tick(struct ptlrpc_twheel *tw)
+{
+	unsigned long tick = tw->tw_tick;
+	unsigned long boundary = (tick | PTW_MASK) + 1;
+	__u64 pending = tw->tw_pending[0] >> (tick & PTW_MASK);
+	bool upper = false;
+	int level;
+
+	for (level = 1; level < PTW_LEVELS; level++) {
+		if (tw->tw_pending[level] != 0)
+			upper = true;
+	}
+
+	/* cascade first when starting a round of the first level */
+	if (upper && (tick & PTW_MASK) == 0)
+		return tick;
+
+	/* slots up to the end of the current round of the first level */
+	if (pending != 0)
+		return tick + __ffs64(pending);
+
+	if (upper)
+		return boundary;
+
+	/* slots of the next round */
+	return boundary + __ffs64(tw->tw_pending[0]);
+}
+
+/* Move the timers of the upper levels due at tw_tick into the lower ones. */
+static void ptw_cascade(struct ptlrpc_twheel *tw)
+{
+	struct ptlrpc_timer *t;
+	struct list_head *slot;
+	struct list_head list;
+	unsigned int idx;
+	int level;
+
+	for (level = 1; level < PTW_LEVELS; level++) {
+		idx = (tw->tw_tick >> (level * PTW_BITS)) & PTW_MASK;
+		slot = &tw->tw_slots[level][idx];
+
+		INIT_LIST_HEAD(&list);
+		list_splice_init(slot, &list);
+		tw->tw_pending[level] &= ~(1ULL << idx);
+
+		while (!list_empty(&list)) {
+			t = list_entry(list.next, struct ptlrpc_timer, pt_link);
+			list_del(&t->pt_link);
+			ptw_insert(tw, t);
+		}
+
+		if (idx != 0)
+			break;
+	}
+}
+
+static void ptw_run(cfs_timer_cb_arg_t data)
+{
+	struct ptlrpc_twheel *tw = cfs_from_timer(tw, data, tw_timer);
+	unsigned long now = jiffies;
+	struct ptlrpc_timer *t;
+	struct list_head list;
+	unsigned int idx;
+
+	spin_lock(&tw->tw_lock);
+	while (!time_after(tw->tw_tick, now)) {
+		unsigned long next;
+
+		if (tw->tw_count == 0) {
+			tw->tw_tick = now + 1;
+			break;
+		}
+
+		next = ptw_next_tick(tw);
+		if (time_after(next, now)) {
+			tw->tw_tick = now + 1;
+			break;
+		}
+
+		tw->tw_tick = next;
+		if ((next & PTW_MASK) == 0)
+			ptw_cascade(tw);
+
+		idx = next & PTW_MASK;
+		INIT_LIST_HEAD(&list);
+		list_splice_init(&tw->tw_slots[0][idx], &list);
+		tw->tw_pending[0] &= ~(1ULL << idx);
+		tw->tw_tick = next + 1;
+
+		while (!list_empty(&list)) {
+			t = list_entry(list.next, struct ptlrpc_timer, pt_link);
+			list_del_init(&t->pt_link);
+			tw->tw_count--;
+			tw->tw_running = t;
+			spin_unlock(&tw->tw_lock);
+
+			t->pt_func(t);
+
+			spin_lock(&tw->tw_lock);
+			tw->tw_running = NULL;
+		}
+	}
+
+	if (tw->tw_count != 0)
+		mod_timer(&tw->tw_timer, ptw_next_tick(tw));
+	spin_unlock(&tw->tw_lock);
+}
+
+/**
+ * Initialize timer \a t to call \a func when it expires, in softirq context.
+ * The timer is run by the wheel of \a cpt, or the one of the current CPT if
+ * \a cpt is negative.
+ */
+void ptlrpc_timer_init(struct ptlrpc_timer *t,
+		       void (*func)(struct ptlrpc_timer *), int cpt)
+{
+	if (cpt < 0 || cpt >= cfs_cpt_number(cfs_cpt_table))
+		cpt = cfs_cpt_current(cfs_cpt_table, 0);
+
+	INIT_LIST_HEAD(&t->pt_link);
+	t->pt_expires = 0;
+	t->pt_wheel = ptlrpc_twheels[cpt];
+	t->pt_func = func;
+}
+
+/**
+ * Arm or rearm timer \a t to expire at \a expires, in jiffies.
+ */
+void ptlrpc_timer_arm(struct ptlrpc_timer *t, unsigned long expires)
+{
+	struct ptlrpc_twheel *tw = t->pt_wheel;
+
+	spin_lock_bh(&tw->tw_lock);
+	if (!list_empty(&t->pt_link))
+		ptw_remove(tw, t);
+
+	/* nothing armed, the wheel has not been following jiffies */
+	if (tw->tw_count == 0 && time_before(tw->tw_tick, jiffies))
+		tw->tw_tick = jiffies;
+
+	t->pt_expires = expires;
+	ptw_insert(tw, t);
+	tw->tw_count++;
+
+	/* ptw_run() sets the kernel timer again after running timers */
+	if (tw->tw_running == NULL) {
+		unsigned long next = ptw_next_tick(tw);
+
+		if (!timer_pending(&tw->tw_timer) ||
+		    time_before(next, tw->tw_timer.expires))
+			mod_timer(&tw->tw_timer, next);
+	}
+	spin_unlock_bh(&tw->tw_lock);
+}
+
+/**
+ * Disarm timer \a t, and wait for its function to complete if it is running,
+ * so \a t can be freed on return. Must not be called from the function of
+ * \a t, nor with locks it takes.
+ */
+void ptlrpc_timer_disarm(struct ptlrpc_timer *t)
+{
+	struct ptlrpc_twheel *tw = t->pt_wheel;
+
+	spin_lock_bh(&tw->tw_lock);
+	if (!list_empty(&t->pt_link))
+		ptw_remove(tw, t);
+	while (tw->tw_running == t) {
+		spin_unlock_bh(&tw->tw_lock);
+		cpu_relax();
+		spin_lock_bh(&tw->tw_lock);
+	}
+	spin_unlock_bh(&tw->tw_lock);
+}
+
+int ptlrpc_twheel_init(void)
+{
+	struct ptlrpc_twheel *tw;
+	int level;
+	int i;
+	int j;
+
+	ptlrpc_twheels = cfs_percpt_alloc(cfs_cpt_table, sizeof(*tw));
+	if (ptlrpc_twheels == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(tw, i, ptlrpc_twheels) {
+		spin_lock_init(&tw->tw_lock);
+		tw->tw_tick = jiffies;
+		for (level = 0; level < PTW_LEVELS; level++) {
+			for (j = 0; j < PTW_SIZE; j++)
+				INIT_LIST_HEAD(&tw->tw_slots[level][j]);
+		}
+		cfs_timer_setup(&tw->tw_timer, ptw_run, (unsigned long)tw, 0);
+	}
+	return 0;
+}
+
+void ptlrpc_twheel_fini(void)
+{
+	struct ptlrpc_twheel *tw;
+	int i;
+
+	if (ptlrpc_twheels == NULL)
+		return;
+
+	cfs_percpt_for_each(tw, i, ptlrpc_twheels) {
+		LASSERTF(tw->tw_count == 0, "%lu timers armed on CPT %d\n",
+			 tw->tw_count, i);
+		del_timer_sync(&tw->tw_timer);
+	}
+	cfs_percpt_free(ptlrpc_twheels);
+	ptlrpc_twheels = NULL;
+}
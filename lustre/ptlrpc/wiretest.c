@@ -177,7 +177,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)MDS_SWAP_LAYOUTS);
 	LASSERTF(MDS_RMFID == 62, "found %lld\n",
 		 (long long)MDS_RMFID);
-	LASSERTF(MDS_LAST_OPC == 63, "found %lld\n",
+	LASSERTF(MDS_BATCH == 63, "found %lld\n",
+		 (long long)MDS_BATCH);
+	LASSERTF(MDS_LAST_OPC == 64, "found %lld\n",
 		 (long long)MDS_LAST_OPC);
 	LASSERTF(REINT_SETATTR == 1, "found %lld\n",
 		 (long long)REINT_SETATTR);
@@ -1141,10 +1143,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct obd_connect_data, padding0));
 	LASSERTF((int)sizeof(((struct obd_connect_data *)0)->padding0) == 2, "found %lld\n",
 		 (long long)(int)sizeof(((struct obd_connect_data *)0)->padding0));
-	LASSERTF((int)offsetof(struct obd_connect_data, padding1) == 76, "found %lld\n",
-		 (long long)(int)offsetof(struct obd_connect_data, padding1));
-	LASSERTF((int)sizeof(((struct obd_connect_data *)0)->padding1) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct obd_connect_data *)0)->padding1));
+	LASSERTF((int)offsetof(struct obd_connect_data, ocd_conn_window) == 76, "found %lld\n",
+		 (long long)(int)offsetof(struct obd_connect_data, ocd_conn_window));
+	LASSERTF((int)sizeof(((struct obd_connect_data *)0)->ocd_conn_window) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct obd_connect_data *)0)->ocd_conn_window));
 	LASSERTF((int)offsetof(struct obd_connect_data, ocd_connect_flags2) == 80, "found %lld\n",
 		 (long long)(int)offsetof(struct obd_connect_data, ocd_connect_flags2));
 	LASSERTF((int)sizeof(((struct obd_connect_data *)0)->ocd_connect_flags2) == 8, "found %lld\n",
@@ -1351,6 +1353,24 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_FIDMAP);
 	LASSERTF(OBD_CONNECT2_GETATTR_PFID== 0x20000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_GETATTR_PFID);
+	LASSERTF(OBD_CONNECT2_BATCH_RPC == 0x400000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_RPC);
+	LASSERTF(OBD_CONNECT2_SHARED_PING == 0x800000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_SHARED_PING);
+	LASSERTF(OBD_CONNECT2_BL_AST_BATCH == 0x1000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BL_AST_BATCH);
+	LASSERTF(OBD_CONNECT2_T10_GUARDS == 0x2000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_T10_GUARDS);
+	LASSERTF(OBD_CONNECT2_COMPRESS == 0x4000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_COMPRESS);
+	LASSERTF(OBD_CONNECT2_STRICT_SOM == 0x8000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_STRICT_SOM);
+	LASSERTF(OBD_CONNECT2_DOM_READ_HEAD == 0x10000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_DOM_READ_HEAD);
+	LASSERTF(OBD_CONNECT2_BATCH_SYNC == 0x20000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_SYNC);
+	LASSERTF(OBD_CONNECT2_CONN_WINDOW == 0x40000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_CONN_WINDOW);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -1622,6 +1642,8 @@ void lustre_assert_wire_constants(void)
 	CLASSERT(OBD_FL_NOSPC_BLK == 0x00100000);
 	CLASSERT(OBD_FL_FLUSH == 0x00200000);
 	CLASSERT(OBD_FL_SHORT_IO == 0x00400000);
+	CLASSERT(OBD_FL_GRANT_RECALL == 0x00800000);
+	CLASSERT(OBD_FL_SOFT_SYNC == 0x01000000);
 
 	/* Checks for struct lov_ost_data_v1 */
 	LASSERTF((int)sizeof(struct lov_ost_data_v1) == 24, "found %lld\n",
@@ -1749,10 +1771,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_timestamp));
 	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_timestamp) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_timestamp));
-	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_padding_1) == 44, "found %lld\n",
-		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_padding_1));
-	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_padding_1) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_padding_1));
+	LASSERTF((int)offsetof(struct lov_comp_md_entry_v1, lcme_extension_size) == 44, "found %lld\n",
+		 (long long)(int)offsetof(struct lov_comp_md_entry_v1, lcme_extension_size));
+	LASSERTF((int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_extension_size) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct lov_comp_md_entry_v1 *)0)->lcme_extension_size));
 	LASSERTF(LCME_FL_INIT == 0x00000010UL, "found 0x%.8xUL\n",
 		(unsigned)LCME_FL_INIT);
 	LASSERTF(LCME_FL_NEG == 0x80000000UL, "found 0x%.8xUL\n",
@@ -1917,10 +1939,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct obd_statfs, os_granted));
 	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_granted) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_granted));
-	LASSERTF((int)offsetof(struct obd_statfs, os_spare3) == 116, "found %lld\n",
-		 (long long)(int)offsetof(struct obd_statfs, os_spare3));
-	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_spare3) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_spare3));
+	LASSERTF((int)offsetof(struct obd_statfs, os_load) == 116, "found %lld\n",
+		 (long long)(int)offsetof(struct obd_statfs, os_load));
+	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_load) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_load));
 	LASSERTF((int)offsetof(struct obd_statfs, os_spare4) == 120, "found %lld\n",
 		 (long long)(int)offsetof(struct obd_statfs, os_spare4));
 	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_spare4) == 4, "found %lld\n",
@@ -2273,6 +2295,42 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ost_body *)0)->oa) == 208, "found %lld\n",
 		 (long long)(int)sizeof(((struct ost_body *)0)->oa));
 
+	/* Checks for struct ost_compr */
+	LASSERTF((int)sizeof(struct ost_compr) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct ost_compr));
+	LASSERTF((int)offsetof(struct ost_compr, oc_type) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compr, oc_type));
+	LASSERTF((int)sizeof(((struct ost_compr *)0)->oc_type) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compr *)0)->oc_type));
+	LASSERTF((int)offsetof(struct ost_compr, oc_raw) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compr, oc_raw));
+	LASSERTF((int)sizeof(((struct ost_compr *)0)->oc_raw) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compr *)0)->oc_raw));
+	LASSERTF((int)offsetof(struct ost_compr, oc_count) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compr, oc_count));
+	LASSERTF((int)sizeof(((struct ost_compr *)0)->oc_count) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compr *)0)->oc_count));
+	LASSERTF((int)offsetof(struct ost_compr, oc_padding) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compr, oc_padding));
+	LASSERTF((int)sizeof(((struct ost_compr *)0)->oc_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compr *)0)->oc_padding));
+	LASSERTF((int)offsetof(struct ost_compr, oc_lens[0]) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compr, oc_lens[0]));
+	LASSERTF((int)sizeof(((struct ost_compr *)0)->oc_lens[0]) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compr *)0)->oc_lens[0]));
+	LASSERTF(OBD_COMPR_NONE == 0, "found %lld\n",
+		 (long long)OBD_COMPR_NONE);
+	LASSERTF(OBD_COMPR_LZ4 == 1, "found %lld\n",
+		 (long long)OBD_COMPR_LZ4);
+	LASSERTF(OBD_COMPR_ZSTD == 2, "found %lld\n",
+		 (long long)OBD_COMPR_ZSTD);
+	LASSERTF(OBD_COMPR_DEFLATE == 3, "found %lld\n",
+		 (long long)OBD_COMPR_DEFLATE);
+	LASSERTF(OBD_COMPR_LZO == 4, "found %lld\n",
+		 (long long)OBD_COMPR_LZO);
+	LASSERTF(OBD_COMPR_CHUNK_SIZE == 65536, "found %lld\n",
+		 (long long)OBD_COMPR_CHUNK_SIZE);
+
 	/* Checks for struct ll_fid */
 	LASSERTF((int)sizeof(struct ll_fid) == 16, "found %lld\n",
 		 (long long)(int)sizeof(struct ll_fid));
@@ -2550,6 +2608,23 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct mdt_ioepoch *)0)->mio_padding) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct mdt_ioepoch *)0)->mio_padding));
 
+	/* Checks for struct batch_body */
+	LASSERTF((int)sizeof(struct batch_body) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct batch_body));
+	LASSERTF((int)offsetof(struct batch_body, bb_magic) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_body, bb_magic));
+	LASSERTF((int)sizeof(((struct batch_body *)0)->bb_magic) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_body *)0)->bb_magic));
+	LASSERTF((int)offsetof(struct batch_body, bb_count) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_body, bb_count));
+	LASSERTF((int)sizeof(((struct batch_body *)0)->bb_count) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_body *)0)->bb_count));
+	LASSERTF((int)offsetof(struct batch_body, bb_padding) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_body, bb_padding));
+	LASSERTF((int)sizeof(((struct batch_body *)0)->bb_padding) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_body *)0)->bb_padding));
+	CLASSERT(BATCH_MAGIC == 0xBADC0001);
+
 	/* Checks for struct mdt_rec_setattr */
 	LASSERTF((int)sizeof(struct mdt_rec_setattr) == 136, "found %lld\n",
 		 (long long)(int)sizeof(struct mdt_rec_setattr));
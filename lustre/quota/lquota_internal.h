@@ -147,6 +147,12 @@ struct lquota_slv_entry {
 
 	/* when latest edquot set */
 	time64_t		lse_edquot_time;
+
+	/* consumption rate, in inodes or kbytes per second, and usage and
+	 * time it was last sampled at, see qsd_update_rate() */
+	__u64			lse_rate;
+	__u64			lse_rate_usage;
+	time64_t		lse_rate_time;
 };
 
 /* In-memory entry for each enforced quota id
@@ -228,6 +234,9 @@ struct lquota_site {
 #define lqe_acq_rc		u.se.lse_acq_rc
 #define lqe_acq_time		u.se.lse_acq_time
 #define lqe_edquot_time		u.se.lse_edquot_time
+#define lqe_rate		u.se.lse_rate
+#define lqe_rate_usage		u.se.lse_rate_usage
+#define lqe_rate_time		u.se.lse_rate_time
 
 #define LQUOTA_BUMP_VER 0x1
 #define LQUOTA_SET_VER  0x2
@@ -465,6 +465,24 @@ int qmt_dqacq0(const struct lu_env *env, struct lquota_entry *lqe,
 	memcpy(&repbody->qb_slv_fid, lu_object_fid(&slv_obj->do_lu),
 	       sizeof(struct lu_fid));
 
+	if (req_is_acq(qb_flags) && qb_count == 0) {
+		/* slave just wants to acquire per-ID lock, which is done on
+		 * every enqueue of it and doesn't write anything, so don't
+		 * start a transaction for it */
+		lqe_write_lock(lqe);
+		if (!lqe->lqe_enforced) {
+			rc = -ESRCH;
+		} else {
+			/* recompute qunit in case it was never initialized */
+			qmt_revalidate(env, lqe);
+			rc = 0;
+		}
+		LQUOTA_DEBUG(lqe, "dqacq of per-ID lock uuid:%s rc:%d",
+			     obd_uuid2str(uuid), rc);
+		lqe_write_unlock(lqe);
+		GOTO(out, rc);
+	}
+
 	/* allocate & start transaction with enough credits to update
 	 * global & slave indexes */
 	th = qmt_trans_start_with_slv(env, lqe, slv_obj, &qti->qti_restore);
@@ -485,10 +503,6 @@ int qmt_dqacq0(const struct lu_env *env, struct lquota_entry *lqe,
 	/* recompute qunit in case it was never initialized */
 	qmt_revalidate(env, lqe);
 
-	/* slave just wants to acquire per-ID lock */
-	if (req_is_acq(qb_flags) && qb_count == 0)
-		GOTO(out_locked, rc = 0);
-
 	/* fetch how much quota space is already granted to this slave */
 	rc = qmt_slv_read(env, lqe, slv_obj, &slv_granted);
 	if (rc) {
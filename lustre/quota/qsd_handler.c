@@ -142,6 +142,46 @@ static int qsd_ready(struct lquota_entry *lqe, struct lustre_handle *lockh)
 	RETURN(0);
 }
 
+/* seconds of consumption that the pre-acquired space of an ID should cover,
+ * so that the master has time to grant more before writes have to wait */
+#define QSD_PREACQ_LEAD	2
+
+/**
+ * Sample the usage of an ID to follow how fast it consumes quota space.
+ * Must be called with the lqe write lock held.
+ */
+static void qsd_update_rate(struct lquota_entry *lqe)
+{
+	time64_t now = ktime_get_seconds();
+	time64_t elapsed = now - lqe->lqe_rate_time;
+
+	if (elapsed <= 0)
+		return;
+
+	if (lqe->lqe_rate_time != 0 && lqe->lqe_usage >= lqe->lqe_rate_usage)
+		/* average with the previous rate to smooth bursts */
+		lqe->lqe_rate = (lqe->lqe_rate +
+				 div64_u64(lqe->lqe_usage - lqe->lqe_rate_usage,
+					   elapsed)) / 2;
+	else
+		lqe->lqe_rate = 0;
+
+	lqe->lqe_rate_usage = lqe->lqe_usage;
+	lqe->lqe_rate_time = now;
+}
+
+/**
+ * How much spare quota space makes a slave pre-acquire more: qtune, or
+ * what the ID consumes in QSD_PREACQ_LEAD seconds if it is busier, but
+ * never more than half a qunit since spare space above a qunit is released.
+ */
+static inline __u64 qsd_preacq_tune(struct lquota_entry *lqe)
+{
+	__u64 tune = min(lqe->lqe_rate * QSD_PREACQ_LEAD, lqe->lqe_qunit >> 1);
+
+	return max(tune, lqe->lqe_qtune);
+}
+
 /**
  * Check whether any quota space adjustment (pre-acquire/release/report) is
  * needed for a given quota ID. If a non-null \a qbody is passed, then the
@@ -265,7 +305,7 @@ static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 
 	/* 3. Time to pre-acquire? */
 	if (!lqe->lqe_edquot && !lqe->lqe_nopreacq && usage > 0 &&
-	    lqe->lqe_qunit != 0 && granted < usage + lqe->lqe_qtune) {
+	    lqe->lqe_qunit != 0 && granted < usage + qsd_preacq_tune(lqe)) {
 		/* To pre-acquire quota space, we report how much spare quota
 		 * space the slave currently owns, then the master will grant us
 		 * back how much we can pretend given the current state of
@@ -1050,10 +1090,12 @@ static void qsd_op_end0(const struct lu_env *env, struct qsd_qtype_info *qqi,
 	lqe_write_lock(lqe);
 	if (qid->lqi_space > 0)
 		lqe->lqe_pending_write -= qid->lqi_space;
-	if (env != NULL)
+	if (env != NULL) {
+		qsd_update_rate(lqe);
 		adjust = qsd_adjust_needed(lqe);
-	else
+	} else {
 		adjust = true;
+	}
 	lqe_write_unlock(lqe);
 
 	if (adjust) {
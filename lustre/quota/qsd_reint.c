@@ -74,6 +74,7 @@ static int qsd_reint_qid(const struct lu_env *env, struct qsd_qtype_info *qqi,
 			 bool global, union lquota_id *qid, void *rec)
 {
 	struct lquota_entry	*lqe;
+	union lquota_rec	 cur;
 	int			 rc;
 	ENTRY;
 
@@ -87,6 +88,15 @@ static int qsd_reint_qid(const struct lu_env *env, struct qsd_qtype_info *qqi,
 	if (rc)
 		GOTO(out, rc);
 
+	/* the whole index is transferred once its version changed, while
+	 * most of its records usually did not, so only spend a transaction
+	 * on the records differing from the local copy */
+	if (lquota_disk_read(env, global ? qqi->qqi_glb_obj : qqi->qqi_slv_obj,
+			     qid, (struct dt_rec *)&cur) == 0 &&
+	    memcmp(&cur, rec, global ? sizeof(struct lquota_glb_rec) :
+				       sizeof(struct lquota_slv_rec)) == 0)
+		GOTO(out, rc = 0);
+
 	rc = qsd_update_index(env, qqi, qid, global, 0, rec);
 out:
 
@@ -39,7 +39,8 @@
  *
  * FMD is organized as per-client list and identified by FID of object. Each
  * FMD stores FID of object and the highest received XID of modification
- * request for this object.
+ * request for this object. The list is in LRU order, and the FMDs are also
+ * hashed by FID so that they are found without walking it.
  *
  * FMD can expire if there are no updates for a long time to keep the list
  * reasonably small.
@@ -55,6 +56,12 @@
 
 #include "tgt_internal.h"
 
+static inline struct hlist_head *tgt_fmd_bucket(struct tg_export_data *ted,
+						const struct lu_fid *fid)
+{
+	return &ted->ted_fmd_hash[fid_hash(fid, TED_FMD_HASH_BITS)];
+}
+
 /**
  * Drop FMD reference and free it if reference drops to zero.
  *
@@ -76,6 +83,22 @@ static inline void tgt_fmd_put_nolock(struct obd_export *exp,
 	}
 }
 
+/**
+ * Remove FMD from the list and drop the list reference.
+ *
+ * Must be called with ted_fmd_lock held.
+ *
+ * \param[in] exp	OBD export
+ * \param[in] fmd	FMD to remove
+ */
+static void tgt_fmd_unlink_nolock(struct obd_export *exp,
+				  struct tgt_fmd_data *fmd)
+{
+	list_del_init(&fmd->fmd_list);
+	hlist_del_init(&fmd->fmd_hash);
+	tgt_fmd_put_nolock(exp, fmd); /* list reference */
+}
+
 /**
  * Wrapper to drop FMD reference with ted_fmd_lock held.
  *
@@ -122,8 +145,7 @@ static void tgt_fmd_expire_nolock(struct obd_export *exp,
 		    ted->ted_fmd_count < lut->lut_fmd_max_num)
 			break;
 
-		list_del_init(&fmd->fmd_list);
-		tgt_fmd_put_nolock(exp, fmd); /* list reference */
+		tgt_fmd_unlink_nolock(exp, fmd);
 	}
 }
 
@@ -146,7 +168,7 @@ void tgt_fmd_expire(struct obd_export *exp)
 /**
  * Find FMD by specified FID.
  *
- * Function finds FMD entry by FID in the tg_export_data::ted_fmd_list.
+ * Function finds FMD entry by FID in the tg_export_data::ted_fmd_hash.
  *
  * Caller must hold tg_export_data::ted_fmd_lock and take FMD reference.
  *
@@ -166,7 +188,7 @@ static struct tgt_fmd_data *tgt_fmd_find_nolock(struct obd_export *exp,
 
 	assert_spin_locked(&ted->ted_fmd_lock);
 
-	list_for_each_entry_reverse(fmd, &ted->ted_fmd_list, fmd_list) {
+	hlist_for_each_entry(fmd, tgt_fmd_bucket(ted, fid), fmd_hash) {
 		if (lu_fid_eq(&fmd->fmd_fid, fid)) {
 			found = fmd;
 			list_move_tail(&fmd->fmd_list, &ted->ted_fmd_list);
@@ -234,6 +256,8 @@ struct tgt_fmd_data *tgt_fmd_get(struct obd_export *exp,
 		if (!found) {
 			list_add_tail(&fmd_new->fmd_list, &ted->ted_fmd_list);
 			fmd_new->fmd_fid = *fid;
+			hlist_add_head(&fmd_new->fmd_hash,
+				       tgt_fmd_bucket(ted, fid));
 			fmd_new->fmd_refcount++;   /* list reference */
 			found = fmd_new;
 			ted->ted_fmd_count++;
@@ -278,10 +302,8 @@ void tgt_fmd_drop(struct obd_export *exp, const struct lu_fid *fid)
 
 	spin_lock(&ted->ted_fmd_lock);
 	fmd = tgt_fmd_find_nolock(exp, fid);
-	if (fmd) {
-		list_del_init(&fmd->fmd_list);
-		tgt_fmd_put_nolock(exp, fmd);
-	}
+	if (fmd)
+		tgt_fmd_unlink_nolock(exp, fmd);
 	spin_unlock(&ted->ted_fmd_lock);
 }
 EXPORT_SYMBOL(tgt_fmd_drop);
@@ -301,13 +323,12 @@ void tgt_fmd_cleanup(struct obd_export *exp)
 
 	spin_lock(&ted->ted_fmd_lock);
 	list_for_each_entry_safe(fmd, tmp, &ted->ted_fmd_list, fmd_list) {
-		list_del_init(&fmd->fmd_list);
 		if (fmd->fmd_refcount > 1) {
 			CDEBUG(D_INFO,
 			       "fmd %p still referenced (refcount = %d)\n",
 			       fmd, fmd->fmd_refcount);
 		}
-		tgt_fmd_put_nolock(exp, fmd);
+		tgt_fmd_unlink_nolock(exp, fmd);
 	}
 	spin_unlock(&ted->ted_fmd_lock);
 	LASSERT(list_empty(&exp->exp_target_data.ted_fmd_list));
@@ -81,6 +81,10 @@
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define TGT_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Seconds of writes at its current rate a client can keep grant for, when
+ * the target is short of space */
+#define TGT_GRANT_RATE_SPAN		4
+
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
 static inline u64 tgt_grant_inflate(struct tg_grants_data *tgd, u64 val)
@@ -625,6 +629,84 @@ static void tgt_grant_shrink(struct obd_export *exp, struct obdo *oa,
 	oa->o_grant = 0;
 }
 
+/**
+ * Account \a bytes just written by the client of \a exp in its write rate.
+ *
+ * The rate is the average of the bytes written each second, where the weight
+ * of a second is halved each second after it. Caller must hold
+ * tgd_grant_lock.
+ *
+ * \param[in] exp	export of the client which sent the write request
+ * \param[in] bytes	bytes to be written by the request
+ */
+static void tgt_grant_rate_update(struct obd_export *exp, u64 bytes)
+{
+	struct tg_export_data	*ted = &exp->exp_target_data;
+	time64_t		 now = ktime_get_seconds();
+	time64_t		 elapsed = now - ted->ted_write_stamp;
+
+	if (elapsed > 0) {
+		u64 rate = (ted->ted_write_rate + ted->ted_write_bytes) >> 1;
+
+		/* seconds without any write */
+		if (elapsed > 1)
+			rate >>= min_t(time64_t, elapsed - 1, 63);
+		ted->ted_write_rate = rate;
+		ted->ted_write_bytes = 0;
+		ted->ted_write_stamp = now;
+	}
+	ted->ted_write_bytes += bytes;
+}
+
+/**
+ * Ask the client of \a exp to give some grant back, if the target is short
+ * of space and the client keeps more grant than it writes in
+ * TGT_GRANT_RATE_SPAN seconds, so that the grant goes to the clients writing
+ * the most. The client is asked with OBD_FL_GRANT_RECALL in the reply \a oa.
+ *
+ * Caller must hold tgd_grant_lock.
+ *
+ * \param[in] exp	export of the client which sent the write request
+ * \param[in,out] oa	obdo of the reply
+ * \param[in] left	remaining free space with granted space taken out
+ * \param[in] chunk	grant allocation unit of the client
+ *
+ * \retval		true if the grant of the client is recalled
+ */
+static bool tgt_grant_recall(struct obd_export *exp, struct obdo *oa,
+			     u64 left, long chunk)
+{
+	struct obd_device	*obd = exp->exp_obd;
+	struct tg_grants_data	*tgd = &obd->u.obt.obt_lut->lut_tgd;
+	struct tg_export_data	*ted = &exp->exp_target_data;
+	u64			 need;
+
+	assert_spin_locked(&tgd->tgd_grant_lock);
+	if (!(exp_connect_flags(exp) & OBD_CONNECT_GRANT_SHRINK) ||
+	    obd->obd_recovering)
+		return false;
+
+	if (left >= tgd->tgd_tot_granted_clients *
+		    TGT_GRANT_SHRINK_LIMIT(exp))
+		return false;
+
+	need = max_t(u64, ted->ted_write_rate * TGT_GRANT_RATE_SPAN,
+		     2 * chunk);
+	if (ted->ted_grant <= need)
+		return false;
+
+	if (!(oa->o_valid & OBD_MD_FLFLAGS)) {
+		oa->o_valid |= OBD_MD_FLFLAGS;
+		oa->o_flags = 0;
+	}
+	oa->o_flags |= OBD_FL_GRANT_RECALL;
+
+	CDEBUG(D_CACHE, "%s: cli %s/%p grant %ld > %llu needed at %llu B/s, "
+	       "left %llu: recall\n", obd->obd_name, exp->exp_client_uuid.uuid,
+	       exp, ted->ted_grant, need, ted->ted_write_rate, left);
+	return true;
+}
+
 /**
  * Calculate how much space is required to write a given network buffer
  *
@@ -1222,9 +1304,11 @@ void tgt_grant_prepare_write(const struct lu_env *env,
 	struct lu_target	*lut = obd->u.obt.obt_lut;
 	struct tg_grants_data	*tgd = &lut->lut_tgd;
 	u64			 left;
+	u64			 bytes = 0;
 	int			 from_cache;
 	int			 force = 0; /* can use cached data intially */
 	long			 chunk = tgt_grant_chunk(exp, lut, NULL);
+	int			 i;
 
 	ENTRY;
 
@@ -1252,7 +1336,6 @@ refresh:
 	 * much space as possible. */
 	if (!obd->obd_recovering && force != 2 && left < chunk) {
 		bool from_grant = true;
-		int  i;
 
 		/* That said, it is worth running a sync only if some pages did
 		 * not consume grant space on the client and could thus fail
@@ -1279,6 +1362,10 @@ refresh:
 	/* check limit */
 	tgt_grant_check(env, exp, oa, rnb, niocount, &left);
 
+	for (i = 0; i < niocount; i++)
+		bytes += rnb[i].rnb_len;
+	tgt_grant_rate_update(exp, bytes);
+
 	if (!(oa->o_valid & OBD_MD_FLGRANT)) {
 		spin_unlock(&tgd->tgd_grant_lock);
 		RETURN_EXIT;
@@ -1289,6 +1376,9 @@ refresh:
 	if ((oa->o_valid & OBD_MD_FLFLAGS) &&
 	    (oa->o_flags & OBD_FL_SHRINK_GRANT))
 		tgt_grant_shrink(exp, oa, left);
+	else if (tgt_grant_recall(exp, oa, left, chunk))
+		/* keep the space left for the clients writing faster */
+		oa->o_grant = 0;
 	else
 		/* grant more space back to the client if possible */
 		oa->o_grant = tgt_grant_alloc(exp, oa->o_grant, oa->o_undirty,
@@ -42,6 +42,7 @@
 #include <obd.h>
 #include <obd_class.h>
 #include <obd_cksum.h>
+#include <obd_compr.h>
 #include <lustre_lfsck.h>
 #include <lustre_nodemap.h>
 #include <lustre_acl.h>
@@ -370,52 +371,62 @@ static int tgt_request_preprocess(struct tgt_session_info *tsi,
 }
 
 /*
- * Invoke handler for this request opc. Also do necessary preprocessing
- * (according to handler ->th_flags), and post-processing (setting of
- * ->last_{xid,committed}).
+ * Size of the description of the compressed data to reply to read \a tsi,
+ * 0 if the client does not ask for compression.
  */
-static int tgt_handle_request0(struct tgt_session_info *tsi,
+static int tgt_brw_compr_size(struct tgt_session_info *tsi)
+{
+	struct req_capsule *pill = tsi->tsi_pill;
+	struct ost_body *body = tsi->tsi_ost_body;
+	struct niobuf_remote *rnb;
+	struct obd_ioobj *ioo;
+	struct ost_compr *oc;
+	__u64 nob = 0;
+	int size;
+	int i;
+
+	if (!(exp_connect_flags2(tsi->tsi_exp) & OBD_CONNECT2_COMPRESS) ||
+	    !req_capsule_field_present(pill, &RMF_OST_COMPR, RCL_CLIENT))
+		return 0;
+
+	if (body->oa.o_valid & OBD_MD_FLFLAGS &&
+	    body->oa.o_flags & OBD_FL_SHORT_IO)
+		return 0;
+
+	size = req_capsule_get_size(pill, &RMF_OST_COMPR, RCL_CLIENT);
+	if (size < sizeof(*oc))
+		return 0;
+
+	oc = req_capsule_client_get(pill, &RMF_OST_COMPR);
+	if (ptlrpc_req_need_swab(tgt_ses_req(tsi)))
+		obd_compr_swab(oc, size);
+	if (oc->oc_type == OBD_COMPR_NONE)
+		return 0;
+
+	ioo = req_capsule_client_get(pill, &RMF_OBD_IOOBJ);
+	rnb = req_capsule_client_get(pill, &RMF_NIOBUF_REMOTE);
+	for (i = 0; i < ioo->ioo_bufcnt; i++)
+		nob += rnb[i].rnb_len;
+
+	if (nob > PTLRPC_MAX_BRW_SIZE)
+		return 0;
+
+	return obd_compr_size(nob);
+}
+
+/*
+ * Preprocess the request and invoke its handler. The result of the operation
+ * is set in req->rq_status, only serious errors are returned.
+ */
+static int tgt_handle_request1(struct tgt_session_info *tsi,
 			       struct tgt_handler *h,
 			       struct ptlrpc_request *req)
 {
 	int	 serious = 0;
 	int	 rc;
-	__u32    opc = lustre_msg_get_opc(req->rq_reqmsg);
 
 	ENTRY;
 
-
-	/* When dealing with sec context requests, no export is associated yet,
-	 * because these requests are sent before *_CONNECT requests.
-	 * A NULL req->rq_export means the normal *_common_slice handlers will
-	 * not be called, because there is no reference to the target.
-	 * So deal with them by hand and jump directly to target_send_reply().
-	 */
-	switch (opc) {
-	case SEC_CTX_INIT:
-	case SEC_CTX_INIT_CONT:
-	case SEC_CTX_FINI:
-		CFS_FAIL_TIMEOUT(OBD_FAIL_SEC_CTX_HDL_PAUSE, cfs_fail_val);
-		GOTO(out, rc = 0);
-	}
-
-	/*
-	 * Checking for various OBD_FAIL_$PREF_$OPC_NET codes. _Do_ not try
-	 * to put same checks into handlers like mdt_close(), mdt_reint(),
-	 * etc., without talking to mdt authors first. Checking same thing
-	 * there again is useless and returning 0 error without packing reply
-	 * is buggy! Handlers either pack reply or return error.
-	 *
-	 * We return 0 here and do not send any reply in order to emulate
-	 * network failure. Do not send any reply in case any of NET related
-	 * fail_id has occured.
-	 */
-	if (OBD_FAIL_CHECK_ORSET(h->th_fail_id, OBD_FAIL_ONCE))
-		RETURN(0);
-	if (unlikely(lustre_msg_get_opc(req->rq_reqmsg) == MDS_REINT &&
-		     OBD_FAIL_CHECK(OBD_FAIL_MDS_REINT_MULTI_NET)))
-		RETURN(0);
-
 	rc = tgt_request_preprocess(tsi, h, req);
 	/* pack reply if reply format is fixed */
 	if (rc == 0 && h->th_flags & HABEO_REFERO) {
@@ -447,6 +458,11 @@ static int tgt_handle_request0(struct tgt_session_info *tsi,
 					  body->oa.o_flags & OBD_FL_SHORT_IO) ?
 					 remote_nb[0].rnb_len : 0);
 		}
+		if (req_capsule_has_field(tsi->tsi_pill, &RMF_OST_COMPR,
+					  RCL_SERVER))
+			req_capsule_set_size(tsi->tsi_pill, &RMF_OST_COMPR,
+					     RCL_SERVER,
+					     tgt_brw_compr_size(tsi));
 
 		rc = req_capsule_server_pack(tsi->tsi_pill);
 	}
@@ -482,6 +498,57 @@ static int tgt_handle_request0(struct tgt_session_info *tsi,
 	if (rc > 0 || !serious)
 		rc = 0;
 
+	RETURN(rc);
+}
+
+/*
+ * Invoke handler for this request opc. Also do necessary preprocessing
+ * (according to handler ->th_flags), and post-processing (setting of
+ * ->last_{xid,committed}).
+ */
+static int tgt_handle_request0(struct tgt_session_info *tsi,
+			       struct tgt_handler *h,
+			       struct ptlrpc_request *req)
+{
+	int	 rc;
+	__u32    opc = lustre_msg_get_opc(req->rq_reqmsg);
+
+	ENTRY;
+
+
+	/* When dealing with sec context requests, no export is associated yet,
+	 * because these requests are sent before *_CONNECT requests.
+	 * A NULL req->rq_export means the normal *_common_slice handlers will
+	 * not be called, because there is no reference to the target.
+	 * So deal with them by hand and jump directly to target_send_reply().
+	 */
+	switch (opc) {
+	case SEC_CTX_INIT:
+	case SEC_CTX_INIT_CONT:
+	case SEC_CTX_FINI:
+		CFS_FAIL_TIMEOUT(OBD_FAIL_SEC_CTX_HDL_PAUSE, cfs_fail_val);
+		GOTO(out, rc = 0);
+	}
+
+	/*
+	 * Checking for various OBD_FAIL_$PREF_$OPC_NET codes. _Do_ not try
+	 * to put same checks into handlers like mdt_close(), mdt_reint(),
+	 * etc., without talking to mdt authors first. Checking same thing
+	 * there again is useless and returning 0 error without packing reply
+	 * is buggy! Handlers either pack reply or return error.
+	 *
+	 * We return 0 here and do not send any reply in order to emulate
+	 * network failure. Do not send any reply in case any of NET related
+	 * fail_id has occured.
+	 */
+	if (OBD_FAIL_CHECK_ORSET(h->th_fail_id, OBD_FAIL_ONCE))
+		RETURN(0);
+	if (unlikely(lustre_msg_get_opc(req->rq_reqmsg) == MDS_REINT &&
+		     OBD_FAIL_CHECK(OBD_FAIL_MDS_REINT_MULTI_NET)))
+		RETURN(0);
+
+	rc = tgt_handle_request1(tsi, h, req);
+
 	LASSERT(current->journal_info == NULL);
 
 	if (likely(rc == 0 && req->rq_export))
@@ -780,8 +847,7 @@ int tgt_request_handle(struct ptlrpc_request *req)
 	if (is_connect) {
 		/* reset the exp_last_xid on each connection. */
 		req->rq_export->exp_last_xid = 0;
-	} else if (obd->obd_recovery_data.trd_processing_task !=
-		   current_pid()) {
+	} else if (!trd_is_recovery_task(&obd->obd_recovery_data)) {
 		rc = process_req_last_xid(req);
 		if (rc) {
 			req->rq_status = rc;
@@ -1062,6 +1128,218 @@ int tgt_obd_log_cancel(struct tgt_session_info *tsi)
 	return err_serious(-EOPNOTSUPP);
 }
 
+/*
+ * Only the sub-requests which do not modify anything can be batched, they
+ * need neither transaction nor reply reconstruction. Lock enqueues are
+ * allowed for getattr and lookup intents, as statahead sends, and for the
+ * glimpses of extent locks the OSC sends to an OST.
+ *
+ * The exception are the object destroys and setattrs an MDT sends to an OST
+ * to apply its llog changes. Each of them runs in a transaction of its own
+ * and gets its own transno, but they need no reply reconstruction, as they
+ * can be applied again, and the MDT replays them from its llog anyway.
+ */
+static bool tgt_batch_sub_allowed(struct tgt_session_info *tsi,
+				  struct tgt_handler *h)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct ptlrpc_request	*req = pill->rc_req;
+	struct ldlm_request	*dlm_req;
+	struct ldlm_intent	*it;
+	bool			 allowed = false;
+
+	if (h->th_opc == OST_DESTROY || h->th_opc == OST_SETATTR)
+		return (exp_connect_flags(tsi->tsi_exp) & OBD_CONNECT_MDS) &&
+		       (exp_connect_flags2(tsi->tsi_exp) &
+			OBD_CONNECT2_BATCH_SYNC);
+
+	if (h->th_flags & MUTABOR)
+		return false;
+
+	switch (h->th_opc) {
+	case MDS_GETATTR:
+	case MDS_GETATTR_NAME:
+		return true;
+	case LDLM_ENQUEUE:
+		break;
+	default:
+		return false;
+	}
+
+	req_capsule_set(pill, &RQF_LDLM_INTENT_BASIC);
+	if (req_capsule_field_present(pill, &RMF_LDLM_INTENT, RCL_CLIENT)) {
+		it = req_capsule_client_get(pill, &RMF_LDLM_INTENT);
+		allowed = it != NULL && it->opc != 0 &&
+			  (it->opc & ~(IT_GETATTR | IT_LOOKUP)) == 0;
+	} else {
+		dlm_req = req_capsule_client_get(pill, &RMF_DLM_REQ);
+		allowed = dlm_req != NULL &&
+			  dlm_req->lock_flags & LDLM_FL_HAS_INTENT &&
+			  dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT;
+	}
+
+	/* the handler sets the format of its own */
+	req_capsule_fini(pill);
+	req->rq_pill_init = 0;
+	req_capsule_init(pill, req, RCL_SERVER);
+	return allowed;
+}
+
+/* Handle one sub-request of a batch, pack its reply even on error. */
+static void tgt_batch_sub_handle(struct tgt_session_info *tsi,
+				 struct ptlrpc_request *req)
+{
+	struct tgt_handler	*h;
+	int			 rc;
+
+	ENTRY;
+
+	h = tgt_handler_find_check(req);
+	if (IS_ERR(h))
+		GOTO(out, rc = PTR_ERR(h));
+
+	rc = lustre_msg_check_version(req->rq_reqmsg, h->th_version);
+	if (unlikely(rc)) {
+		DEBUG_REQ(D_ERROR, req, "%s: drop mal-formed sub-request, "
+			  "version %08x, expecting %08x\n",
+			  tgt_name(tsi->tsi_tgt),
+			  lustre_msg_get_version(req->rq_reqmsg),
+			  h->th_version);
+		GOTO(out, rc = -EINVAL);
+	}
+
+	if (!tgt_batch_sub_allowed(tsi, h)) {
+		DEBUG_REQ(D_RPCTRACE, req, "%s: %s cannot be batched",
+			  tgt_name(tsi->tsi_tgt), h->th_name);
+		GOTO(out, rc = -EOPNOTSUPP);
+	}
+
+	rc = tgt_handle_request1(tsi, h, req);
+	LASSERT(current->journal_info == NULL);
+	EXIT;
+out:
+	rc = ptlrpc_batch_sub_reply(req, rc);
+	if (rc)
+		DEBUG_REQ(D_ERROR, req, "cannot pack sub-reply: rc = %d", rc);
+}
+
+/**
+ * Handle a MDS_BATCH request: execute its sub-requests one after the other in
+ * this service thread, and return their replies in one reply. The handling
+ * stops once the replies could overflow the reply, the client sends the
+ * remaining sub-requests alone.
+ */
+int tgt_batch(struct tgt_session_info *tsi)
+{
+	struct tgt_thread_info	 *tti = tgt_th_info(tsi->tsi_env);
+	struct ptlrpc_request	 *req = tgt_ses_req(tsi);
+	struct tgt_session_info	 *saved;
+	struct ptlrpc_request	**subs;
+	struct ptlrpc_request	 *sub;
+	struct batch_body	 *bb;
+	__u32			  replen = 0;
+	__u32			  nr;
+	char			 *buf;
+	int			  len;
+	int			  count = 0;
+	int			  rc = 0;
+	int			  i;
+
+	ENTRY;
+
+	bb = req_capsule_client_get(tsi->tsi_pill, &RMF_BATCH_BODY);
+	if (bb == NULL || bb->bb_magic != BATCH_MAGIC ||
+	    bb->bb_count == 0 || bb->bb_count > MDS_BATCH_MAXCOUNT)
+		RETURN(err_serious(-EPROTO));
+
+	nr = bb->bb_count;
+
+	buf = req_capsule_client_get(tsi->tsi_pill, &RMF_BATCH_BUF);
+	len = req_capsule_get_size(tsi->tsi_pill, &RMF_BATCH_BUF, RCL_CLIENT);
+	if (buf == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	OBD_ALLOC_PTR(saved);
+	if (saved == NULL)
+		RETURN(err_serious(-ENOMEM));
+	OBD_ALLOC(subs, nr * sizeof(*subs));
+	if (subs == NULL)
+		GOTO(out_saved, rc = err_serious(-ENOMEM));
+
+	/* the session is per sub-request, restore the batch one after each */
+	*saved = *tsi;
+	while (count < nr &&
+	       replen + MDS_MAXREPSIZE <= MDS_BATCH_MAXBUFSIZE) {
+		sub = ptlrpc_batch_sub_init(req, (struct lustre_msg *)buf, len);
+		if (IS_ERR(sub)) {
+			rc = PTR_ERR(sub);
+			DEBUG_REQ(D_ERROR, req, "bad sub-request %d: rc = %d",
+				  count, rc);
+			break;
+		}
+		buf += cfs_size_round(sub->rq_reqlen);
+		len -= cfs_size_round(sub->rq_reqlen);
+
+		memset(tsi, 0, sizeof(*tsi));
+		req_capsule_init(&sub->rq_pill, sub, RCL_SERVER);
+		tsi->tsi_pill = &sub->rq_pill;
+		tsi->tsi_env = saved->tsi_env;
+		tsi->tsi_tgt = saved->tsi_tgt;
+		tsi->tsi_exp = sub->rq_export;
+		tsi->tsi_reply_fail_id = saved->tsi_reply_fail_id;
+		if (exp_connect_flags(sub->rq_export) & OBD_CONNECT_JOBSTATS)
+			tsi->tsi_jobid = lustre_msg_get_jobid(sub->rq_reqmsg);
+		/* a transno for each of the sub-requests */
+		tti->tti_has_trans = 0;
+		tti->tti_mult_trans = 0;
+
+		tgt_batch_sub_handle(tsi, sub);
+
+		req_capsule_fini(tsi->tsi_pill);
+		if (tsi->tsi_corpus != NULL)
+			lu_object_put(tsi->tsi_env, tsi->tsi_corpus);
+		*tsi = *saved;
+
+		if (sub->rq_repmsg == NULL) {
+			ptlrpc_batch_sub_fini(sub);
+			rc = -ENOMEM;
+			break;
+		}
+		subs[count++] = sub;
+		replen += cfs_size_round(sub->rq_replen);
+	}
+	/* the client sends alone the sub-requests not handled here */
+	if (count == 0)
+		GOTO(out_subs, rc = err_serious(rc ?: -EPROTO));
+
+	req_capsule_set_size(tsi->tsi_pill, &RMF_BATCH_BUF, RCL_SERVER, replen);
+	rc = req_capsule_server_pack(tsi->tsi_pill);
+	if (rc)
+		GOTO(out_subs, rc = err_serious(rc));
+
+	bb = req_capsule_server_get(tsi->tsi_pill, &RMF_BATCH_BODY);
+	bb->bb_magic = BATCH_MAGIC;
+	bb->bb_count = count;
+
+	buf = req_capsule_server_get(tsi->tsi_pill, &RMF_BATCH_BUF);
+	for (i = 0; i < count; i++) {
+		memcpy(buf, subs[i]->rq_repmsg, subs[i]->rq_replen);
+		buf += cfs_size_round(subs[i]->rq_replen);
+	}
+	CDEBUG(D_RPCTRACE, "%s: handled %d of %u batched sub-requests\n",
+	       tgt_name(tsi->tsi_tgt), count, nr);
+	rc = 0;
+	EXIT;
+out_subs:
+	for (i = 0; i < count; i++)
+		ptlrpc_batch_sub_fini(subs[i]);
+	OBD_FREE(subs, nr * sizeof(*subs));
+out_saved:
+	OBD_FREE_PTR(saved);
+	return rc;
+}
+EXPORT_SYMBOL(tgt_batch);
+
 int tgt_send_buffer(struct tgt_session_info *tsi, struct lu_rdbuf *rdbuf)
 {
 	struct tgt_thread_info	*tti = tgt_th_info(tsi->tsi_env);
@@ -1737,15 +2015,24 @@ static void tgt_brw_unlock(struct obd_ioobj *obj, struct niobuf_remote *niob,
 		tgt_extent_unlock(lh, mode);
 	EXIT;
 }
-static int tgt_checksum_niobuf(struct lu_target *tgt,
-				 struct niobuf_local *local_nb, int npages,
-				 int opc, enum cksum_types cksum_type,
-				 __u32 *cksum)
+struct tgt_cksum_args {
+	struct lu_target	*tca_tgt;
+	struct niobuf_local	*tca_local_nb;
+	int			 tca_opc;
+	enum cksum_types	 tca_type;
+};
+
+static int tgt_checksum_pages(void *data, int start, int end, __u32 *cksum)
 {
+	struct tgt_cksum_args	       *args = data;
+	struct lu_target	       *tgt = args->tca_tgt;
+	struct niobuf_local	       *local_nb = args->tca_local_nb;
+	int				opc = args->tca_opc;
 	struct ahash_request	       *req;
 	unsigned int			bufsize;
 	int				i, err;
-	unsigned char			cfs_alg = cksum_obd2cfs(cksum_type);
+	int				done = 0;
+	unsigned char			cfs_alg = cksum_obd2cfs(args->tca_type);
 
 	req = cfs_crypto_hash_init(cfs_alg, NULL, 0);
 	if (IS_ERR(req)) {
@@ -1755,7 +2042,9 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 	}
 
 	CDEBUG(D_INFO, "Checksum for algo %s\n", cfs_crypto_hash_name(cfs_alg));
-	for (i = 0; i < npages; i++) {
+	for (i = start; i < end; i++) {
+		done += local_nb[i].lnb_len;
+
 		/* corrupt the data before we compute the checksum, to
 		 * simulate a client->OST data error */
 		if (i == 0 && opc == OST_WRITE &&
@@ -1823,7 +2112,23 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 	bufsize = sizeof(*cksum);
 	err = cfs_crypto_hash_final(req, (unsigned char *)cksum, &bufsize);
 
-	return 0;
+	return done;
+}
+
+static int tgt_checksum_niobuf(struct lu_target *tgt,
+				 struct niobuf_local *local_nb, int npages,
+				 int opc, enum cksum_types cksum_type,
+				 __u32 *cksum)
+{
+	struct tgt_cksum_args args = {
+		.tca_tgt	= tgt,
+		.tca_local_nb	= local_nb,
+		.tca_opc	= opc,
+		.tca_type	= cksum_type,
+	};
+
+	return obd_cksum_pages(cksum_type, npages, tgt_checksum_pages, &args,
+			       cksum);
 }
 
 char dbgcksum_file_name[PATH_MAX];
@@ -1967,8 +2272,8 @@ static int tgt_checksum_niobuf_t10pi(struct lu_target *tgt,
 				     struct niobuf_local *local_nb,
 				     int npages, int opc,
 				     obd_dif_csum_fn *fn,
-				     int sector_size,
-				     u32 *check_sum)
+				     int sector_size, __u16 *guards,
+				     int guards_nr, u32 *check_sum)
 {
 	enum cksum_types t10_cksum_type = tgt->lut_dt_conf.ddp_t10_cksum_type;
 	unsigned char cfs_alg = cksum_obd2cfs(OBD_CKSUM_T10_TOP);
@@ -2000,6 +2305,8 @@ static int tgt_checksum_niobuf_t10pi(struct lu_target *tgt,
 	guard_start = (__u16 *)buffer;
 	guard_number = PAGE_SIZE / sizeof(*guard_start);
 	for (i = 0; i < npages; i++) {
+		struct page *page = local_nb[i].lnb_page;
+
 		/* corrupt the data before we compute the checksum, to
 		 * simulate a client->OST data error */
 		if (i == 0 && opc == OST_WRITE &&
@@ -2021,9 +2328,9 @@ static int tgt_checksum_niobuf_t10pi(struct lu_target *tgt,
 				 * display in dump_all_bulk_pages() */
 				np->index = i;
 
-				cfs_crypto_hash_update_page(req, np, off,
-							    len);
-				continue;
+				/* the guards of the corrupted copy go in the
+				 * checksum and the reply, not to the disk */
+				page = np;
 			} else {
 				CERROR("%s: can't alloc page for corruption\n",
 				       tgt_name(tgt));
@@ -2045,8 +2352,7 @@ static int tgt_checksum_niobuf_t10pi(struct lu_target *tgt,
 			       local_nb[i].lnb_guards,
 			       used * sizeof(*local_nb[i].lnb_guards));
 		} else {
-			rc = obd_page_dif_generate_buffer(obd_name,
-				local_nb[i].lnb_page,
+			rc = obd_page_dif_generate_buffer(obd_name, page,
 				local_nb[i].lnb_page_offset & ~PAGE_MASK,
 				local_nb[i].lnb_len, guard_start + used_number,
 				guard_number - used_number, &used, sector_size,
@@ -2067,13 +2373,22 @@ static int tgt_checksum_niobuf_t10pi(struct lu_target *tgt,
 		 * of checksum calculation.
 		 */
 		if (t10_cksum_type && opc == OST_WRITE &&
-		    local_nb[i].lnb_len == PAGE_SIZE) {
+		    local_nb[i].lnb_len == PAGE_SIZE &&
+		    page == local_nb[i].lnb_page) {
 			local_nb[i].lnb_guard_rpc = 1;
 			memcpy(local_nb[i].lnb_guards,
 			       guard_start + used_number,
 			       used * sizeof(*local_nb[i].lnb_guards));
 		}
 
+		/* to be replied if the checksum of the client is wrong */
+		if (guards != NULL && used <= guards_nr) {
+			memcpy(guards, guard_start + used_number,
+			       used * sizeof(*guards));
+			guards += used;
+			guards_nr -= used;
+		}
+
 		used_number += used;
 		if (used_number == guard_number) {
 			cfs_crypto_hash_update_page(req, __page, 0,
@@ -2132,7 +2447,8 @@ out:
 static int tgt_checksum_niobuf_rw(struct lu_target *tgt,
 				  enum cksum_types cksum_type,
 				  struct niobuf_local *local_nb,
-				  int npages, int opc, u32 *check_sum)
+				  int npages, int opc, __u16 *guards,
+				  int guards_nr, u32 *check_sum)
 {
 	obd_dif_csum_fn *fn = NULL;
 	int sector_size = 0;
@@ -2143,14 +2459,83 @@ static int tgt_checksum_niobuf_rw(struct lu_target *tgt,
 
 	if (fn)
 		rc = tgt_checksum_niobuf_t10pi(tgt, local_nb, npages,
-					       opc, fn, sector_size,
-					       check_sum);
+					       opc, fn, sector_size, guards,
+					       guards_nr, check_sum);
 	else
 		rc = tgt_checksum_niobuf(tgt, local_nb, npages, opc,
 					 cksum_type, check_sum);
 	RETURN(rc);
 }
 
+/*
+ * Compress the \a npages pages of data \a lnb read with algorithm \a type
+ * into pages attached to \a desc, or attach \a lnb as is if compression does
+ * not save a page at least. The compressed data has the layout of \a lnb,
+ * for each bulk MD to fit in the one of the client.
+ */
+static void tgt_brw_compress(struct ptlrpc_request *req,
+			     struct ptlrpc_bulk_desc *desc,
+			     enum obd_compr_type type,
+			     struct niobuf_local *lnb, int npages)
+{
+	struct ost_compr *oc;
+	lnet_kiov_t *src = NULL;
+	lnet_kiov_t *dst = NULL;
+	bool compressed = false;
+	int nob = 0;
+	int rc;
+	int i;
+
+	OBD_ALLOC_LARGE(src, npages * sizeof(*src));
+	OBD_ALLOC_LARGE(dst, npages * sizeof(*dst));
+	if (src == NULL || dst == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < npages; i++) {
+		src[i].kiov_page = lnb[i].lnb_page;
+		src[i].kiov_offset = lnb[i].lnb_page_offset & ~PAGE_MASK;
+		src[i].kiov_len = lnb[i].lnb_len;
+		dst[i].kiov_offset = src[i].kiov_offset;
+		dst[i].kiov_len = src[i].kiov_len;
+		nob += lnb[i].lnb_len;
+	}
+
+	oc = req_capsule_server_get(&req->rq_pill, &RMF_OST_COMPR);
+	rc = obd_compress(type, src, npages, dst, npages, oc);
+	if (rc < 0 || DIV_ROUND_UP(rc, PAGE_SIZE) >= DIV_ROUND_UP(nob, PAGE_SIZE))
+		GOTO(out, rc);
+
+	/* the frag ops take a reference on the pages */
+	for (i = 0; rc > 0; rc -= dst[i].kiov_len, i++)
+		desc->bd_frag_ops->add_kiov_frag(desc, dst[i].kiov_page,
+						 dst[i].kiov_offset,
+						 min_t(int, rc,
+						       dst[i].kiov_len));
+	req_capsule_shrink(&req->rq_pill, &RMF_OST_COMPR,
+			   obd_compr_size(oc->oc_raw), RCL_SERVER);
+	compressed = true;
+out:
+	if (dst != NULL) {
+		obd_compr_release(dst, npages);
+		OBD_FREE_LARGE(dst, npages * sizeof(*dst));
+	}
+	if (src != NULL)
+		OBD_FREE_LARGE(src, npages * sizeof(*src));
+
+	if (!compressed) {
+		if (rc < 0)
+			CDEBUG(D_PAGE, "cannot compress with %s: rc = %d\n",
+			       obd_compr_name(type), rc);
+		for (i = 0; i < npages; i++)
+			desc->bd_frag_ops->add_kiov_frag(desc,
+					lnb[i].lnb_page,
+					lnb[i].lnb_page_offset & ~PAGE_MASK,
+					lnb[i].lnb_len);
+		req_capsule_shrink(&req->rq_pill, &RMF_OST_COMPR, 0,
+				   RCL_SERVER);
+	}
+}
+
 int tgt_brw_read(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -2166,6 +2551,7 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 				 npages_read;
 	struct tgt_thread_big_cache *tbc = req->rq_svc_thread->t_data;
 	const char *obd_name = exp->exp_obd->obd_name;
+	enum obd_compr_type	 compr_type = OBD_COMPR_NONE;
 
 	ENTRY;
 
@@ -2241,14 +2627,31 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 	if (rc != 0)
 		GOTO(out_lock, rc);
 
+	/* room was made in the reply if the client asked for compression, see
+	 * tgt_brw_compr_size() */
+	if (req_capsule_get_size(&req->rq_pill, &RMF_OST_COMPR,
+				 RCL_SERVER) != 0) {
+		struct ost_compr *oc;
+
+		oc = req_capsule_client_get(&req->rq_pill, &RMF_OST_COMPR);
+		if (obd_compr_prepare(oc->oc_type) == 0)
+			compr_type = oc->oc_type;
+		else
+			req_capsule_shrink(&req->rq_pill, &RMF_OST_COMPR, 0,
+					   RCL_SERVER);
+	}
+
 	if (body->oa.o_valid & OBD_MD_FLFLAGS &&
 	    body->oa.o_flags & OBD_FL_SHORT_IO) {
 		desc = NULL;
 	} else {
+		/* the pages of compressed data belong to the bulk */
 		desc = ptlrpc_prep_bulk_exp(req, npages, ioobj_max_brw_get(ioo),
 					    PTLRPC_BULK_PUT_SOURCE |
 						PTLRPC_BULK_BUF_KIOV,
 					    OST_BULK_PORTAL,
+					    compr_type != OBD_COMPR_NONE ?
+					    &ptlrpc_bulk_kiov_pin_ops :
 					    &ptlrpc_bulk_kiov_nopin_ops);
 		if (desc == NULL)
 			GOTO(out_commitrw, rc = -ENOMEM);
@@ -2266,7 +2669,8 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 		}
 
 		nob += page_rc;
-		if (page_rc != 0 && desc != NULL) { /* some data! */
+		if (page_rc != 0 && desc != NULL &&
+		    compr_type == OBD_COMPR_NONE) { /* some data! */
 			LASSERT(local_nb[i].lnb_page != NULL);
 			desc->bd_frag_ops->add_kiov_frag
 			  (desc, local_nb[i].lnb_page,
@@ -2298,7 +2702,7 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 
 		rc = tgt_checksum_niobuf_rw(tsi->tsi_tgt, cksum_type,
 					    local_nb, npages_read, OST_READ,
-					    &repbody->oa.o_cksum);
+					    NULL, 0, &repbody->oa.o_cksum);
 		if (rc < 0)
 			GOTO(out_commitrw, rc);
 		CDEBUG(D_PAGE, "checksum at read origin: %x\n",
@@ -2318,6 +2722,9 @@ int tgt_brw_read(struct tgt_session_info *tsi)
 	}
 	/* We're finishing using body->oa as an input variable */
 
+	if (rc == 0 && compr_type != OBD_COMPR_NONE && desc != NULL)
+		tgt_brw_compress(req, desc, compr_type, local_nb, npages_read);
+
 	/* Check if client was evicted while we were doing i/o before touching
 	 * network */
 	if (rc == 0) {
@@ -2467,6 +2874,86 @@ static void tgt_warn_on_cksum(struct ptlrpc_request *req,
 			   client_cksum, server_cksum);
 }
 
+/*
+ * Check the description of the compressed data of write \a req, of \a npages
+ * pages \a lnb. Returns the bytes of compressed data to get, 0 if the data is
+ * not compressed.
+ */
+static int tgt_brw_compr_nob(struct ptlrpc_request *req,
+			     struct niobuf_local *lnb, int npages)
+{
+	struct ost_compr *oc;
+	int size = 0;
+	int nob = 0;
+	int rc;
+	int i;
+
+	if (req_capsule_field_present(&req->rq_pill, &RMF_OST_COMPR,
+				      RCL_CLIENT))
+		size = req_capsule_get_size(&req->rq_pill, &RMF_OST_COMPR,
+					    RCL_CLIENT);
+	if (size == 0)
+		return 0;
+
+	oc = req_capsule_client_get(&req->rq_pill, &RMF_OST_COMPR);
+	if (oc == NULL)
+		return -EPROTO;
+	if (ptlrpc_req_need_swab(req))
+		obd_compr_swab(oc, size);
+
+	for (i = 0; i < npages; i++)
+		nob += lnb[i].lnb_len;
+
+	rc = obd_compr_check(oc, size);
+	if (rc >= 0 &&
+	    (oc->oc_raw != nob || DIV_ROUND_UP(rc, PAGE_SIZE) > npages))
+		rc = -EPROTO;
+	if (rc < 0) {
+		DEBUG_REQ(D_ERROR, req, "bad compressed data description: "
+			  "rc = %d", rc);
+		return rc;
+	}
+
+	/* the client sends the data uncompressed after this error */
+	if (obd_compr_prepare(oc->oc_type) != 0)
+		return -EOPNOTSUPP;
+
+	return rc;
+}
+
+/* Decompress the data of write \a req got in \a desc into pages \a lnb */
+static int tgt_brw_decompress(struct ptlrpc_request *req,
+			      struct ptlrpc_bulk_desc *desc,
+			      struct niobuf_local *lnb, int npages)
+{
+	struct ost_compr *oc;
+	lnet_kiov_t *dst;
+	int rc;
+	int i;
+
+	oc = req_capsule_client_get(&req->rq_pill, &RMF_OST_COMPR);
+	OBD_ALLOC_LARGE(dst, npages * sizeof(*dst));
+	if (dst == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < npages; i++) {
+		dst[i].kiov_page = lnb[i].lnb_page;
+		dst[i].kiov_offset = lnb[i].lnb_page_offset & ~PAGE_MASK;
+		dst[i].kiov_len = lnb[i].lnb_len;
+	}
+
+	rc = obd_decompress(oc, &BD_GET_KIOV(desc, 0), desc->bd_iov_count,
+			    dst, npages);
+	OBD_FREE_LARGE(dst, npages * sizeof(*dst));
+	if (rc < 0) {
+		DEBUG_REQ(D_ERROR, req, "bad %s data: rc = %d",
+			  obd_compr_name(oc->oc_type), rc);
+		return rc;
+	}
+
+	return 0;
+}
+
 int tgt_brw_write(struct tgt_session_info *tsi)
 {
 	struct ptlrpc_request	*req = tgt_ses_req(tsi);
@@ -2479,6 +2966,9 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
+	__u16			*guards = NULL;
+	int			 guards_size = 0;
+	int			 compr_nob = 0;
 	int			 objcount, niocount, npages;
 	int			 rc, i, j;
 	enum cksum_types cksum_type = OBD_CKSUM_CRC32;
@@ -2548,12 +3038,24 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 
 	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
 			     niocount * sizeof(*rcs));
+	/* room to reply our guards of the sectors if the client sent its own
+	 * and the checksum does not match, see osc_brw_find_bad_pages() */
+	if (req_capsule_field_present(&req->rq_pill, &RMF_OST_GUARDS,
+				      RCL_CLIENT))
+		guards_size = req_capsule_get_size(&req->rq_pill,
+						   &RMF_OST_GUARDS,
+						   RCL_CLIENT);
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_GUARDS, RCL_SERVER,
+			     guards_size);
 	rc = req_capsule_server_pack(&req->rq_pill);
 	if (rc != 0)
 		GOTO(out, rc = err_serious(rc));
 
 	CFS_FAIL_TIMEOUT(OBD_FAIL_OST_BRW_PAUSE_PACK, cfs_fail_val);
 	rcs = req_capsule_server_get(&req->rq_pill, &RMF_RCS);
+	if (guards_size != 0)
+		guards = req_capsule_server_get(&req->rq_pill,
+						&RMF_OST_GUARDS);
 
 	local_nb = tbc->local;
 
@@ -2613,16 +3115,35 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 				       short_io_size);
 		desc = NULL;
 	} else {
+		compr_nob = tgt_brw_compr_nob(req, local_nb, npages);
+		if (compr_nob < 0)
+			GOTO(skip_transfer, rc = compr_nob);
+
+		/* the pages of compressed data belong to the bulk */
 		desc = ptlrpc_prep_bulk_exp(req, npages, ioobj_max_brw_get(ioo),
 					    PTLRPC_BULK_GET_SINK |
 					    PTLRPC_BULK_BUF_KIOV,
 					    OST_BULK_PORTAL,
+					    compr_nob != 0 ?
+					    &ptlrpc_bulk_kiov_pin_ops :
 					    &ptlrpc_bulk_kiov_nopin_ops);
 		if (desc == NULL)
 			GOTO(skip_transfer, rc = -ENOMEM);
 
+		/* the client sends compressed data in whole pages */
+		for (i = 0; i * PAGE_SIZE < compr_nob; i++) {
+			struct page *page = alloc_page(GFP_NOFS);
+
+			if (page == NULL)
+				GOTO(skip_transfer, rc = -ENOMEM);
+			desc->bd_frag_ops->add_kiov_frag(desc, page, 0,
+				min_t(int, compr_nob - i * PAGE_SIZE,
+				      PAGE_SIZE));
+			put_page(page);
+		}
+
 		/* NB Having prepped, we must commit... */
-		for (i = 0; i < npages; i++)
+		for (i = 0; compr_nob == 0 && i < npages; i++)
 			desc->bd_frag_ops->add_kiov_frag(desc,
 					local_nb[i].lnb_page,
 					local_nb[i].lnb_page_offset & ~PAGE_MASK,
@@ -2637,6 +3158,9 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 
 	no_reply = rc != 0;
 
+	if (rc == 0 && compr_nob != 0)
+		rc = tgt_brw_decompress(req, desc, local_nb, npages);
+
 skip_transfer:
 	if (body->oa.o_valid & OBD_MD_FLCKSUM && rc == 0) {
 		static int cksum_counter;
@@ -2651,12 +3175,21 @@ skip_transfer:
 
 		rc = tgt_checksum_niobuf_rw(tsi->tsi_tgt, cksum_type,
 					    local_nb, npages, OST_WRITE,
+					    guards,
+					    guards_size / sizeof(__u16),
 					    &repbody->oa.o_cksum);
 		if (rc < 0)
 			GOTO(out_commitrw, rc);
 
 		cksum_counter++;
 
+		if (guards_size != 0 &&
+		    body->oa.o_cksum == repbody->oa.o_cksum) {
+			req_capsule_shrink(&req->rq_pill, &RMF_OST_GUARDS, 0,
+					   RCL_SERVER);
+			guards_size = 0;
+		}
+
 		if (unlikely(body->oa.o_cksum != repbody->oa.o_cksum)) {
 			mmap = (body->oa.o_valid & OBD_MD_FLFLAGS &&
 				body->oa.o_flags & OBD_FL_MMAP);
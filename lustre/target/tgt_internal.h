@@ -291,6 +291,7 @@ void barrier_fini(void);
 /* FMD tracking data */
 struct tgt_fmd_data {
 	struct list_head fmd_list;	  /* linked to tgt_fmd_list */
+	struct hlist_node fmd_hash;	  /* linked to ted_fmd_hash */
 	struct lu_fid	 fmd_fid;	  /* FID being written to */
 	__u64		 fmd_mactime_xid; /* xid highest {m,a,c}time setattr */
 	time64_t	 fmd_expire;	  /* time when the fmd should expire */
@@ -70,19 +70,34 @@ static int tgt_bitmap_chunk_alloc(struct lu_target *lut, int chunk)
 	return 0;
 }
 
-/* Look for an available reply data slot in the bitmap
- * of the target @lut
+/* Raise the reply slot high watermark of the target @lut above @idx */
+static void tgt_reply_slot_high_update(struct lu_target *lut, int idx)
+{
+	int high;
+
+	do {
+		high = atomic_read(&lut->lut_reply_slot_high);
+		if (idx < high)
+			return;
+	} while (atomic_cmpxchg(&lut->lut_reply_slot_high, high,
+				idx + 1) != high);
+}
+
+/* Take the first available reply data slot in [@start, @end)
  * Allocate bitmap chunk when first used
- * XXX algo could be improved if this routine limits performance
  */
-static int tgt_find_free_reply_slot(struct lu_target *lut)
+static int tgt_find_reply_slot_range(struct lu_target *lut, int start,
+				     int end)
 {
 	unsigned long *bmp;
-	int chunk = 0;
+	int chunk;
+	int base;
+	int size;
 	int rc;
 	int b;
 
-	for (chunk = 0; chunk < LUT_REPLY_SLOTS_MAX_CHUNKS; chunk++) {
+	for (chunk = start / LUT_REPLY_SLOTS_PER_CHUNK;
+	     start < end && chunk < LUT_REPLY_SLOTS_MAX_CHUNKS; chunk++) {
 		/* allocate the bitmap chunk if necessary */
 		if (unlikely(lut->lut_reply_bitmap[chunk] == NULL)) {
 			rc = tgt_bitmap_chunk_alloc(lut, chunk);
@@ -90,22 +105,63 @@ static int tgt_find_free_reply_slot(struct lu_target *lut)
 				return rc;
 		}
 		bmp = lut->lut_reply_bitmap[chunk];
+		base = chunk * LUT_REPLY_SLOTS_PER_CHUNK;
+		size = min(end - base, LUT_REPLY_SLOTS_PER_CHUNK);
 
 		/* look for an available slot in this chunk */
+		b = start - base;
 		do {
-			b = find_first_zero_bit(bmp, LUT_REPLY_SLOTS_PER_CHUNK);
-			if (b >= LUT_REPLY_SLOTS_PER_CHUNK)
+			b = find_next_zero_bit(bmp, size, b);
+			if (b >= size)
 				break;
 
 			/* found one */
 			if (test_and_set_bit(b, bmp) == 0)
-				return chunk * LUT_REPLY_SLOTS_PER_CHUNK + b;
+				return base + b;
 		} while (true);
+		start = base + LUT_REPLY_SLOTS_PER_CHUNK;
 	}
 
 	return -ENOSPC;
 }
 
+/* Look for an available reply data slot in the bitmap
+ * of the target @lut
+ *
+ * Each CPT goes on from the slot it took last, so that the threads do not
+ * all scan the bitmap from its start and fight for the same words. The
+ * slots above the ones used so far are only taken when all these are in
+ * use, to keep the reply_data file as small as it was.
+ */
+static int tgt_find_free_reply_slot(struct lu_target *lut)
+{
+	int *hint;
+	int high;
+	int idx;
+
+	hint = &lut->lut_reply_slot_hint[cfs_cpt_current(cfs_cpt_table, 0) %
+					 LUT_REPLY_SLOT_HINTS];
+	high = atomic_read(&lut->lut_reply_slot_high);
+	idx = READ_ONCE(*hint);
+	if (idx >= high)
+		idx = 0;
+
+	idx = tgt_find_reply_slot_range(lut, idx, high);
+	if (idx == -ENOSPC)
+		idx = tgt_find_reply_slot_range(lut, 0, high);
+	if (idx == -ENOSPC)
+		idx = tgt_find_reply_slot_range(lut, high,
+						LUT_REPLY_SLOTS_PER_CHUNK *
+						LUT_REPLY_SLOTS_MAX_CHUNKS);
+	if (idx < 0)
+		return idx;
+
+	tgt_reply_slot_high_update(lut, idx);
+	WRITE_ONCE(*hint, idx + 1);
+
+	return idx;
+}
+
 /* Mark the reply data slot @idx 'used' in the corresponding bitmap chunk
  * of the target @lut
  * Allocate the bitmap chunk if necessary
@@ -135,6 +191,7 @@ static int tgt_set_reply_slot(struct lu_target *lut, int idx)
 		       tgt_name(lut), idx);
 		return -EALREADY;
 	}
+	tgt_reply_slot_high_update(lut, idx);
 
 	return 0;
 }
@@ -390,6 +447,7 @@ static inline struct lu_buf *tti_buf_lcd(struct tgt_thread_info *tti)
  */
 int tgt_client_alloc(struct obd_export *exp)
 {
+	int i;
 	ENTRY;
 	LASSERT(exp != exp->exp_obd->obd_self_export);
 
@@ -397,6 +455,8 @@ int tgt_client_alloc(struct obd_export *exp)
 	INIT_LIST_HEAD(&exp->exp_target_data.ted_nodemap_member);
 	spin_lock_init(&exp->exp_target_data.ted_fmd_lock);
 	INIT_LIST_HEAD(&exp->exp_target_data.ted_fmd_list);
+	for (i = 0; i < ARRAY_SIZE(exp->exp_target_data.ted_fmd_hash); i++)
+		INIT_HLIST_HEAD(&exp->exp_target_data.ted_fmd_hash[i]);
 
 	OBD_ALLOC_PTR(exp->exp_target_data.ted_lcd);
 	if (exp->exp_target_data.ted_lcd == NULL)
@@ -405,6 +405,8 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	atomic_set(&lut->lut_client_generation, 0);
 	lut->lut_reply_data = NULL;
 	lut->lut_reply_bitmap = NULL;
+	atomic_set(&lut->lut_reply_slot_high, 0);
+	memset(lut->lut_reply_slot_hint, 0, sizeof(lut->lut_reply_slot_hint));
 	obd->u.obt.obt_lut = lut;
 	obd->u.obt.obt_magic = OBT_MAGIC;
 
@@ -0,0 +1,602 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/* Time a fixed set of hot paths, each one @nops times, @repeat times over,
+ * and print the fastest run of every benchmark as "<name> <n> ns/op" to
+ * the console, so that tests/kbench.sh can compare the numbers between
+ * builds.  The benchmarks needing a Lustre device only run when the name
+ * of one is given: @client for a client obd with an import, @server for
+ * a local MDT. */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+
+#include <libcfs/libcfs.h>
+#include <lnet/api.h>
+#include <obd_class.h>
+#include <lustre_dlm.h>
+#include <lustre_fid.h>
+#include <lustre_net.h>
+#include <lustre_req_layout.h>
+#include <cl_object.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int nops = 100000;
+module_param(nops, int, 0644);
+MODULE_PARM_DESC(nops, "number of operations timed in each run");
+
+static int repeat = 3;
+module_param(repeat, int, 0644);
+MODULE_PARM_DESC(repeat, "number of runs of each benchmark");
+
+static char *bench;
+module_param(bench, charp, 0444);
+MODULE_PARM_DESC(bench, "comma separated benchmarks to run, default all");
+
+static char *client;
+module_param(client, charp, 0444);
+MODULE_PARM_DESC(client, "client obd device for ptlrpc_req_alloc");
+
+static char *server;
+module_param(server, charp, 0444);
+MODULE_PARM_DESC(server, "MDT device for lu_object_find and ldlm_enqueue");
+
+#define PREFIX "lustre_kbench_%u:"
+
+#define KB_HASH_ITEMS	4096
+
+/* "kbench", used as LNet match bits and as DLM resource name */
+#define KB_MAGIC	0x6b62656e6368ULL
+
+/* a portal used by neither Lustre nor lnet selftest */
+#define KB_LNET_PORTAL	53
+#define KB_LNET_SIZE	64
+
+/* what a benchmark needs besides the module itself */
+enum {
+	KB_NEED_CLIENT	= 1 << 0,
+	KB_NEED_SERVER	= 1 << 1,
+	KB_NEED_LNET	= 1 << 2,
+};
+
+struct kb_obj {
+	__u64			ko_key;
+	struct hlist_node	ko_hnode;
+};
+
+struct kb_ctx {
+	unsigned int		 kc_have;
+	__u64			 kc_seed;
+	/* cfs_hash */
+	struct cfs_hash		*kc_hs;
+	struct kb_obj		*kc_objs;
+	struct kb_obj		 kc_spare;
+	/* lu_object_find and ldlm_enqueue */
+	struct lu_env		 kc_env;
+	struct obd_device	*kc_server;
+	/* ptlrpc_req_alloc */
+	struct obd_import	*kc_imp;
+	/* lnet_lo_put */
+	struct lnet_handle_eq	 kc_eq;
+	struct lnet_handle_md	 kc_sink;
+	atomic_t		 kc_received;
+	atomic_t		 kc_unlinked;
+	int			 kc_bound;
+	wait_queue_head_t	 kc_waitq;
+	char			 kc_buf[KB_LNET_SIZE];
+};
+
+struct kb_bench {
+	const char	*kb_name;
+	unsigned int	 kb_needs;
+	int		(*kb_run)(struct kb_ctx *kc, int count);
+};
+
+static __u64 kb_rand(__u64 *seed)
+{
+	/* xorshift, cheap enough to not be measured */
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+static unsigned kb_hash(struct cfs_hash *hs, const void *key, unsigned mask)
+{
+	return cfs_hash_u64_hash(*(__u64 *)key, mask);
+}
+
+static void *kb_key(struct hlist_node *hnode)
+{
+	return &hlist_entry(hnode, struct kb_obj, ko_hnode)->ko_key;
+}
+
+static int kb_keycmp(const void *key, struct hlist_node *hnode)
+{
+	return *(__u64 *)key ==
+	       hlist_entry(hnode, struct kb_obj, ko_hnode)->ko_key;
+}
+
+static void *kb_object(struct hlist_node *hnode)
+{
+	return hlist_entry(hnode, struct kb_obj, ko_hnode);
+}
+
+/* the objects belong to kb_ctx::kc_objs, the hash holds no reference */
+static void kb_get(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+}
+
+static void kb_put(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+}
+
+static struct cfs_hash_ops kb_hash_ops = {
+	.hs_hash	= kb_hash,
+	.hs_key		= kb_key,
+	.hs_keycmp	= kb_keycmp,
+	.hs_object	= kb_object,
+	.hs_get		= kb_get,
+	.hs_put		= kb_put,
+	.hs_put_locked	= kb_put,
+};
+
+static int kb_hash_lookup(struct kb_ctx *kc, int count)
+{
+	struct kb_obj *obj;
+	__u64 key;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		key = (__u32)kb_rand(&kc->kc_seed) % KB_HASH_ITEMS;
+		obj = cfs_hash_lookup(kc->kc_hs, &key);
+		if (obj == NULL)
+			return -ENOENT;
+		cfs_hash_put(kc->kc_hs, &obj->ko_hnode);
+	}
+	return 0;
+}
+
+static int kb_hash_add_del(struct kb_ctx *kc, int count)
+{
+	struct kb_obj *obj = &kc->kc_spare;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		cfs_hash_add(kc->kc_hs, &obj->ko_key, &obj->ko_hnode);
+		if (cfs_hash_del(kc->kc_hs, &obj->ko_key,
+				 &obj->ko_hnode) != obj)
+			return -ENOENT;
+	}
+	return 0;
+}
+
+static int kb_lu_env_init(struct kb_ctx *kc, int count)
+{
+	struct lu_env env;
+	int rc;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		rc = lu_env_init(&env, LCT_CL_THREAD);
+		if (rc)
+			return rc;
+		lu_env_fini(&env);
+	}
+	return 0;
+}
+
+static int kb_cl_env_get(struct kb_ctx *kc, int count)
+{
+	struct lu_env *env;
+	__u16 refcheck;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		env = cl_env_get(&refcheck);
+		if (IS_ERR(env))
+			return PTR_ERR(env);
+		cl_env_put(env, &refcheck);
+	}
+	return 0;
+}
+
+static int kb_lu_object_find(struct kb_ctx *kc, int count)
+{
+	struct lu_device *dev = kc->kc_server->obd_lu_dev;
+	struct lu_object *obj;
+	struct lu_fid fid;
+	int i;
+
+	/* always cached, this is the lookup of an object in use */
+	lu_root_fid(&fid);
+	for (i = 0; i < count; i++) {
+		obj = lu_object_find_at(&kc->kc_env, dev, &fid, NULL);
+		if (IS_ERR(obj))
+			return PTR_ERR(obj);
+		lu_object_put(&kc->kc_env, obj);
+	}
+	return 0;
+}
+
+static int kb_ldlm_enqueue(struct kb_ctx *kc, int count)
+{
+	struct ldlm_namespace *ns = kc->kc_server->obd_namespace;
+	/* not a FID, no client can ever lock it */
+	struct ldlm_res_id res_id = { .name = { KB_MAGIC } };
+	struct lustre_handle lockh;
+	__u64 flags;
+	int rc;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		flags = LDLM_FL_ATOMIC_CB;
+		rc = ldlm_cli_enqueue_local(&kc->kc_env, ns, &res_id,
+					    LDLM_PLAIN, NULL, LCK_EX, &flags,
+					    ldlm_blocking_ast,
+					    ldlm_completion_ast, NULL, NULL,
+					    0, LVB_T_NONE, NULL, &lockh);
+		if (rc != ELDLM_OK)
+			return rc < 0 ? rc : -EIO;
+		ldlm_lock_decref_and_cancel(&lockh, LCK_EX);
+	}
+	return 0;
+}
+
+static int kb_ptlrpc_req_alloc(struct kb_ctx *kc, int count)
+{
+	struct ptlrpc_request *req;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		req = ptlrpc_request_alloc_pack(kc->kc_imp, &RQF_OBD_PING,
+						LUSTRE_OBD_VERSION, OBD_PING);
+		if (req == NULL)
+			return -ENOMEM;
+		ptlrpc_req_finished(req);
+	}
+	return 0;
+}
+
+static void kb_lnet_handler(struct lnet_event *ev)
+{
+	struct kb_ctx *kc = ev->md.user_ptr;
+
+	if (ev->type == LNET_EVENT_PUT)
+		atomic_inc(&kc->kc_received);
+	else if (ev->unlinked)
+		atomic_inc(&kc->kc_unlinked);
+	wake_up(&kc->kc_waitq);
+}
+
+static int kb_lnet_lo_put(struct kb_ctx *kc, int count)
+{
+	struct lnet_process_id target = {
+		.nid = LNET_NID_LO_0,
+		.pid = LNET_PID_LUSTRE,
+	};
+	struct lnet_md md = {
+		.start		= kc->kc_buf,
+		.length		= KB_LNET_SIZE,
+		.threshold	= 1,
+		.user_ptr	= kc,
+		.eq_handle	= kc->kc_eq,
+	};
+	struct lnet_handle_md mdh;
+	int received = atomic_read(&kc->kc_received);
+	int rc = 0;
+	int i;
+
+	/* every PUT waits for its delivery to the sink before the next */
+	for (i = 0; i < count; i++) {
+		rc = LNetMDBind(md, LNET_UNLINK, &mdh);
+		if (rc)
+			break;
+		kc->kc_bound++;
+		rc = LNetPut(LNET_NID_ANY, mdh, LNET_NOACK_REQ, target,
+			     KB_LNET_PORTAL, KB_MAGIC, 0, 0);
+		if (rc) {
+			LNetMDUnlink(mdh);
+			break;
+		}
+		received++;
+		wait_event(kc->kc_waitq,
+			   atomic_read(&kc->kc_received) >= received);
+	}
+	wait_event(kc->kc_waitq, atomic_read(&kc->kc_unlinked) >= kc->kc_bound);
+	return rc;
+}
+
+static struct kb_bench kb_benches[] = {
+	{ "cfs_hash_lookup",	0,		kb_hash_lookup },
+	{ "cfs_hash_add_del",	0,		kb_hash_add_del },
+	{ "lu_env_init",	0,		kb_lu_env_init },
+	{ "cl_env_get",		0,		kb_cl_env_get },
+	{ "lu_object_find",	KB_NEED_SERVER,	kb_lu_object_find },
+	{ "ldlm_enqueue",	KB_NEED_SERVER,	kb_ldlm_enqueue },
+	{ "ptlrpc_req_alloc",	KB_NEED_CLIENT,	kb_ptlrpc_req_alloc },
+	{ "lnet_lo_put",	KB_NEED_LNET,	kb_lnet_lo_put },
+};
+
+static int kb_hash_init(struct kb_ctx *kc)
+{
+	int i;
+
+	kc->kc_objs = kcalloc(KB_HASH_ITEMS, sizeof(*kc->kc_objs),
+			      GFP_KERNEL);
+	if (kc->kc_objs == NULL)
+		return -ENOMEM;
+
+	kc->kc_hs = cfs_hash_create("kbench", 10, 16, 4, 0,
+				    CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
+				    &kb_hash_ops, CFS_HASH_DEFAULT);
+	if (kc->kc_hs == NULL) {
+		kfree(kc->kc_objs);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < KB_HASH_ITEMS; i++) {
+		kc->kc_objs[i].ko_key = i;
+		cfs_hash_add(kc->kc_hs, &kc->kc_objs[i].ko_key,
+			     &kc->kc_objs[i].ko_hnode);
+	}
+	kc->kc_spare.ko_key = KB_HASH_ITEMS;
+	return 0;
+}
+
+static void kb_hash_fini(struct kb_ctx *kc)
+{
+	int i;
+
+	for (i = 0; i < KB_HASH_ITEMS; i++)
+		cfs_hash_del(kc->kc_hs, &kc->kc_objs[i].ko_key,
+			     &kc->kc_objs[i].ko_hnode);
+	cfs_hash_putref(kc->kc_hs);
+	kfree(kc->kc_objs);
+}
+
+static int kb_lnet_init(struct kb_ctx *kc)
+{
+	struct lnet_process_id any = {
+		.nid = LNET_NID_ANY,
+		.pid = LNET_PID_ANY,
+	};
+	struct lnet_md md = {
+		.start		= kc->kc_buf,
+		.length		= KB_LNET_SIZE,
+		.threshold	= LNET_MD_THRESH_INF,
+		.options	= LNET_MD_OP_PUT | LNET_MD_MANAGE_REMOTE |
+				  LNET_MD_TRUNCATE,
+		.user_ptr	= kc,
+	};
+	struct lnet_handle_me meh;
+	int rc;
+
+	rc = LNetNIInit(LNET_PID_LUSTRE);
+	if (rc < 0)
+		return rc;
+
+	rc = LNetEQAlloc(0, kb_lnet_handler, &kc->kc_eq);
+	if (rc)
+		goto out_ni;
+
+	rc = LNetMEAttach(KB_LNET_PORTAL, any, KB_MAGIC, 0, LNET_UNLINK,
+			  LNET_INS_AFTER, &meh);
+	if (rc)
+		goto out_eq;
+
+	md.eq_handle = kc->kc_eq;
+	rc = LNetMDAttach(meh, md, LNET_RETAIN, &kc->kc_sink);
+	if (rc) {
+		LNetMEUnlink(meh);
+		goto out_eq;
+	}
+	return 0;
+
+out_eq:
+	LNetEQFree(kc->kc_eq);
+out_ni:
+	LNetNIFini();
+	return rc;
+}
+
+static void kb_lnet_fini(struct kb_ctx *kc)
+{
+	LNetMDUnlink(kc->kc_sink);
+	/* the sink is unlinked after all the source MDs */
+	wait_event(kc->kc_waitq,
+		   atomic_read(&kc->kc_unlinked) > kc->kc_bound);
+	LNetEQFree(kc->kc_eq);
+	LNetNIFini();
+}
+
+static void kb_devices_init(struct kb_ctx *kc)
+{
+	struct obd_device *obd;
+	int rc;
+
+	if (client != NULL) {
+		obd = class_name2obd(client);
+		if (obd == NULL || obd->u.cli.cl_import == NULL) {
+			pr_err(PREFIX " %s is not a client device\n",
+			       run_id, client);
+		} else {
+			kc->kc_imp = class_import_get(obd->u.cli.cl_import);
+			kc->kc_have |= KB_NEED_CLIENT;
+		}
+	}
+
+	if (server != NULL) {
+		obd = class_name2obd(server);
+		if (obd == NULL || obd->obd_lu_dev == NULL ||
+		    obd->obd_namespace == NULL ||
+		    ns_is_client(obd->obd_namespace)) {
+			pr_err(PREFIX " %s is not a server device\n",
+			       run_id, server);
+		} else {
+			rc = lu_env_init(&kc->kc_env,
+					 LCT_MD_THREAD | LCT_DT_THREAD);
+			if (rc) {
+				pr_err(PREFIX " cannot init env: %d\n",
+				       run_id, rc);
+			} else {
+				kc->kc_server = obd;
+				kc->kc_have |= KB_NEED_SERVER;
+			}
+		}
+	}
+
+	rc = kb_lnet_init(kc);
+	if (rc)
+		pr_err(PREFIX " cannot setup LNet: %d\n", run_id, rc);
+	else
+		kc->kc_have |= KB_NEED_LNET;
+}
+
+static void kb_devices_fini(struct kb_ctx *kc)
+{
+	if (kc->kc_have & KB_NEED_LNET)
+		kb_lnet_fini(kc);
+	if (kc->kc_have & KB_NEED_SERVER)
+		lu_env_fini(&kc->kc_env);
+	if (kc->kc_have & KB_NEED_CLIENT)
+		class_import_put(kc->kc_imp);
+}
+
+static bool kb_selected(const char *name)
+{
+	const char *p = bench;
+	size_t len = strlen(name);
+
+	if (p == NULL || *p == '\0')
+		return true;
+
+	while (p != NULL) {
+		if (strncmp(p, name, len) == 0 &&
+		    (p[len] == ',' || p[len] == '\0'))
+			return true;
+		p = strchr(p, ',');
+		if (p != NULL)
+			p++;
+	}
+	return false;
+}
+
+static int kb_time(struct kb_ctx *kc, struct kb_bench *kb)
+{
+	ktime_t start;
+	__u64 best = ~0ULL;
+	__u64 ns;
+	int rc;
+	int i;
+
+	/* warm the caches and the slabs up */
+	rc = kb->kb_run(kc, min(nops, 1000));
+	for (i = 0; rc == 0 && i < repeat; i++) {
+		start = ktime_get();
+		rc = kb->kb_run(kc, nops);
+		ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (ns < best)
+			best = ns;
+		cond_resched();
+	}
+	if (rc) {
+		pr_err(PREFIX " %s failed: %d\n", run_id, kb->kb_name, rc);
+		return rc;
+	}
+
+	do_div(best, nops);
+	pr_err(PREFIX " %s %llu ns/op\n", run_id, kb->kb_name, best);
+	return 0;
+}
+
+static int __init kbench_init(void)
+{
+	struct kb_ctx *kc;
+	int rc;
+	int i;
+
+	if (nops < 1 || repeat < 1) {
+		pr_err(PREFIX " invalid parameters\n", run_id);
+		goto out;
+	}
+
+	kc = kzalloc(sizeof(*kc), GFP_KERNEL);
+	if (kc == NULL) {
+		pr_err(PREFIX " cannot allocate context\n", run_id);
+		goto out;
+	}
+	kc->kc_seed = 0x9E3779B97F4A7C15ULL;
+	init_waitqueue_head(&kc->kc_waitq);
+
+	rc = kb_hash_init(kc);
+	if (rc) {
+		pr_err(PREFIX " cannot create hash: %d\n", run_id, rc);
+		goto out_kc;
+	}
+	kb_devices_init(kc);
+
+	for (i = 0; rc == 0 && i < ARRAY_SIZE(kb_benches); i++) {
+		struct kb_bench *kb = &kb_benches[i];
+
+		if (!kb_selected(kb->kb_name))
+			continue;
+		if ((kb->kb_needs & kc->kc_have) != kb->kb_needs) {
+			pr_err(PREFIX " %s skipped\n", run_id, kb->kb_name);
+			continue;
+		}
+		rc = kb_time(kc, kb);
+	}
+
+	kb_devices_fini(kc);
+	kb_hash_fini(kc);
+	if (rc)
+		pr_err(PREFIX " failed: %d\n", run_id, rc);
+	else
+		pr_err(PREFIX " done\n", run_id);
+out_kc:
+	kfree(kc);
+out:
+	/* Don't load. */
+	return -EINVAL;
+}
+
+static void __exit kbench_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre hot path benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kbench_init);
+module_exit(kbench_exit);
@@ -0,0 +1,284 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/* Measure cfs_hash lookup throughput from several kthreads, for a
+ * hash with rw bucket locks and for the same hash with CFS_HASH_RCU,
+ * while a writer keeps adding and deleting items so that the hash is
+ * rehashed under the readers.  Results are printed to the console. */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/completion.h>
+#include <linux/kthread.h>
+#include <linux/slab.h>
+#include <linux/rcupdate.h>
+
+#include <libcfs/libcfs.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int nthreads = 1;
+module_param(nthreads, int, 0644);
+MODULE_PARM_DESC(nthreads, "number of lookup threads");
+
+static int nitems = 65536;
+module_param(nitems, int, 0644);
+MODULE_PARM_DESC(nitems, "number of items in the hash");
+
+static int seconds = 5;
+module_param(seconds, int, 0644);
+MODULE_PARM_DESC(seconds, "seconds to run each mode");
+
+#define PREFIX "lustre_kcfshash_%u:"
+
+struct kch_obj {
+	__u64			ko_key;
+	struct hlist_node	ko_hnode;
+	atomic_t		ko_ref;
+	struct rcu_head		ko_rcu;
+};
+
+struct kch_thread {
+	struct cfs_hash		*kt_hs;
+	struct completion	*kt_go;
+	unsigned long		 kt_deadline;
+	__u64			 kt_seed;
+	__u64			 kt_lookups;
+	struct task_struct	*kt_task;
+};
+
+static unsigned kch_hash(struct cfs_hash *hs, const void *key, unsigned mask)
+{
+	return cfs_hash_u64_hash(*(__u64 *)key, mask);
+}
+
+static void *kch_key(struct hlist_node *hnode)
+{
+	return &hlist_entry(hnode, struct kch_obj, ko_hnode)->ko_key;
+}
+
+static int kch_keycmp(const void *key, struct hlist_node *hnode)
+{
+	return *(__u64 *)key ==
+	       hlist_entry(hnode, struct kch_obj, ko_hnode)->ko_key;
+}
+
+static void *kch_object(struct hlist_node *hnode)
+{
+	return hlist_entry(hnode, struct kch_obj, ko_hnode);
+}
+
+static void kch_get(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	atomic_inc(&hlist_entry(hnode, struct kch_obj, ko_hnode)->ko_ref);
+}
+
+static bool kch_get_rcu(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	return atomic_inc_not_zero(&hlist_entry(hnode, struct kch_obj,
+						ko_hnode)->ko_ref);
+}
+
+static void kch_put(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct kch_obj *obj = hlist_entry(hnode, struct kch_obj, ko_hnode);
+
+	if (atomic_dec_and_test(&obj->ko_ref))
+		kfree_rcu(obj, ko_rcu);
+}
+
+static struct cfs_hash_ops kch_ops = {
+	.hs_hash	= kch_hash,
+	.hs_key		= kch_key,
+	.hs_keycmp	= kch_keycmp,
+	.hs_object	= kch_object,
+	.hs_get		= kch_get,
+	.hs_get_rcu	= kch_get_rcu,
+	.hs_put		= kch_put,
+	.hs_put_locked	= kch_put,
+	.hs_exit	= kch_put,
+};
+
+static __u64 kch_rand(__u64 *seed)
+{
+	/* xorshift, cheap enough to not be measured */
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+static int kch_add(struct cfs_hash *hs, __u64 key)
+{
+	struct kch_obj *obj;
+
+	obj = kzalloc(sizeof(*obj), GFP_KERNEL);
+	if (obj == NULL)
+		return -ENOMEM;
+
+	obj->ko_key = key;
+	atomic_set(&obj->ko_ref, 1); /* the hash's reference */
+	cfs_hash_add(hs, &obj->ko_key, &obj->ko_hnode);
+	return 0;
+}
+
+static int kch_lookup_thread(void *data)
+{
+	struct kch_thread *kt = data;
+	struct kch_obj *obj;
+	__u64 key;
+
+	wait_for_completion(kt->kt_go);
+	while (time_before(jiffies, kt->kt_deadline)) {
+		key = (__u32)kch_rand(&kt->kt_seed) % nitems;
+		obj = cfs_hash_lookup(kt->kt_hs, &key);
+		if (obj != NULL)
+			cfs_hash_put(kt->kt_hs, &obj->ko_hnode);
+		if ((++kt->kt_lookups & 1023) == 0)
+			cond_resched();
+	}
+
+	/* Wait for call to kthread_stop. */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static int kch_run(const char *mode, unsigned flags)
+{
+	struct completion go;
+	struct kch_thread *kts;
+	struct cfs_hash *hs;
+	unsigned long deadline;
+	__u64 total = 0;
+	__u64 key;
+	int started = 0;
+	int rc = 0;
+	int i;
+
+	/* start small so that filling and churning rehash the hash */
+	hs = cfs_hash_create("kcfshash", 5, 20, 4, 0, CFS_HASH_MIN_THETA,
+			     CFS_HASH_MAX_THETA, &kch_ops, flags);
+	if (hs == NULL)
+		return -ENOMEM;
+
+	kts = kcalloc(nthreads, sizeof(*kts), GFP_KERNEL);
+	if (kts == NULL) {
+		rc = -ENOMEM;
+		goto out_hash;
+	}
+
+	for (key = 0; key < nitems; key++) {
+		rc = kch_add(hs, key);
+		if (rc)
+			goto out_kts;
+	}
+
+	init_completion(&go);
+	deadline = jiffies + cfs_time_seconds(seconds);
+	for (i = 0; i < nthreads; i++) {
+		kts[i].kt_hs = hs;
+		kts[i].kt_go = &go;
+		kts[i].kt_deadline = deadline;
+		kts[i].kt_seed = (__u64)(i + 1) * 0x9E3779B97F4A7C15ULL;
+		kts[i].kt_task = kthread_run(kch_lookup_thread, &kts[i],
+					     "kcfshash_%d", i);
+		if (IS_ERR(kts[i].kt_task)) {
+			rc = PTR_ERR(kts[i].kt_task);
+			pr_err(PREFIX " cannot create kthread: %d\n",
+			       run_id, rc);
+			break;
+		}
+		started++;
+	}
+	complete_all(&go);
+
+	/* churn the keys above @nitems, the readers never look for them */
+	key = nitems;
+	while (rc == 0 && time_before(jiffies, deadline)) {
+		rc = kch_add(hs, key);
+		if (rc == 0 && key - nitems >= nitems / 4) {
+			__u64 old = key - nitems / 4;
+
+			cfs_hash_del_key(hs, &old);
+		}
+		key++;
+		cond_resched();
+	}
+
+	for (i = 0; i < started; i++) {
+		kthread_stop(kts[i].kt_task);
+		total += kts[i].kt_lookups;
+	}
+	if (rc == 0) {
+		do_div(total, seconds);
+		pr_err(PREFIX " %s: %d threads %llu lookups/sec %u rehashes\n",
+		       run_id, mode, nthreads, total, hs->hs_rehash_count);
+	}
+out_kts:
+	kfree(kts);
+out_hash:
+	cfs_hash_putref(hs);
+	return rc;
+}
+
+static int __init kcfshash_init(void)
+{
+	int rc;
+
+	if (nthreads < 1 || nitems < 1 || seconds < 1) {
+		pr_err(PREFIX " invalid parameters\n", run_id);
+		goto out;
+	}
+
+	rc = kch_run("locked", CFS_HASH_DEFAULT);
+	if (rc == 0)
+		rc = kch_run("rcu", CFS_HASH_DEFAULT | CFS_HASH_RCU);
+	if (rc)
+		pr_err(PREFIX " failed: %d\n", run_id, rc);
+	else
+		pr_err(PREFIX " done\n", run_id);
+out:
+	/* Don't load. */
+	return -EINVAL;
+}
+
+static void __exit kcfshash_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre cfs_hash lookup scaling test module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kcfshash_init);
+module_exit(kcfshash_exit);
@@ -0,0 +1,179 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/* Compare binary and 4-ary cfs_binheap: fill a heap with @nitems nodes,
+ * then repeatedly take the root and put it back with a later key, the way
+ * NRS policies consume their heaps, and finally drain it while checking
+ * the order.  Results are printed to the console. */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
+
+#include <libcfs/libcfs.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int nitems = 262144;
+module_param(nitems, int, 0644);
+MODULE_PARM_DESC(nitems, "number of nodes in the heap");
+
+static int nloops = 4;
+module_param(nloops, int, 0644);
+MODULE_PARM_DESC(nloops, "number of times the whole heap is cycled");
+
+#define PREFIX "lustre_kcfsheap_%u:"
+
+struct kchp_node {
+	__u64			kn_key;
+	struct cfs_binheap_node	kn_node;
+};
+
+static int kchp_compare(struct cfs_binheap_node *a, struct cfs_binheap_node *b)
+{
+	return container_of(a, struct kchp_node, kn_node)->kn_key <
+	       container_of(b, struct kchp_node, kn_node)->kn_key;
+}
+
+static struct cfs_binheap_ops kchp_ops = {
+	.hop_compare	= kchp_compare,
+};
+
+static __u64 kchp_rand(__u64 *seed)
+{
+	/* xorshift, cheap enough to not be measured */
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+static int kchp_run(const char *mode, unsigned int flags,
+		    struct kchp_node *nodes)
+{
+	struct cfs_binheap *h;
+	struct cfs_binheap_node *e;
+	struct kchp_node *kn;
+	__u64 seed = 0x9E3779B97F4A7C15ULL;
+	__u64 prev = 0;
+	ktime_t start;
+	__u64 ns;
+	__u64 nops;
+	int rc = 0;
+	int i;
+
+	h = cfs_binheap_create(&kchp_ops, flags, nitems, NULL, NULL, 0);
+	if (h == NULL)
+		return -ENOMEM;
+
+	start = ktime_get();
+	for (i = 0; i < nitems; i++) {
+		nodes[i].kn_key = (__u32)kchp_rand(&seed);
+		rc = cfs_binheap_insert(h, &nodes[i].kn_node);
+		if (rc)
+			goto out;
+	}
+
+	/* a consumed node comes back behind most of the others */
+	for (i = 0; i < nitems * nloops; i++) {
+		e = cfs_binheap_remove_root(h);
+		kn = container_of(e, struct kchp_node, kn_node);
+		kn->kn_key += (__u32)kchp_rand(&seed);
+		rc = cfs_binheap_insert(h, e);
+		if (rc)
+			goto out;
+	}
+
+	for (i = 0; i < nitems; i++) {
+		e = cfs_binheap_remove_root(h);
+		kn = container_of(e, struct kchp_node, kn_node);
+		if (kn->kn_key < prev) {
+			pr_err(PREFIX " %s: out of order %llu < %llu\n",
+			       run_id, mode, kn->kn_key, prev);
+			rc = -EINVAL;
+			goto out;
+		}
+		prev = kn->kn_key;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (!cfs_binheap_is_empty(h)) {
+		pr_err(PREFIX " %s: %d nodes left\n", run_id, mode,
+		       cfs_binheap_size(h));
+		rc = -EINVAL;
+		goto out;
+	}
+
+	/* one insert per node, then one remove and insert per cycle */
+	nops = (__u64)nitems * (2 + 2 * nloops);
+	do_div(ns, nops);
+	pr_err(PREFIX " %s: %d nodes %llu ns/op\n", run_id, mode, nitems, ns);
+out:
+	cfs_binheap_destroy(h);
+	return rc;
+}
+
+static int __init kcfsheap_init(void)
+{
+	struct kchp_node *nodes;
+	int rc;
+
+	if (nitems < 1 || nloops < 1) {
+		pr_err(PREFIX " invalid parameters\n", run_id);
+		goto out;
+	}
+
+	nodes = vmalloc(sizeof(*nodes) * nitems);
+	if (nodes == NULL) {
+		pr_err(PREFIX " cannot allocate %d nodes\n", run_id, nitems);
+		goto out;
+	}
+
+	rc = kchp_run("binary", 0, nodes);
+	if (rc == 0)
+		rc = kchp_run("4-ary", CBH_FLAG_DARY, nodes);
+	if (rc)
+		pr_err(PREFIX " failed: %d\n", run_id, rc);
+	else
+		pr_err(PREFIX " done\n", run_id);
+	vfree(nodes);
+out:
+	/* Don't load. */
+	return -EINVAL;
+}
+
+static void __exit kcfsheap_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre cfs_binheap benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kcfsheap_init);
+module_exit(kcfsheap_exit);
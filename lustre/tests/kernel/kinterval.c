@@ -0,0 +1,190 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/* Time the interval tree the way the extent lock code uses it: a tree of
+ * @nitems granted non-overlapping extents goes through cycles of a lock
+ * being cancelled and enqueued again, a conflict check with
+ * interval_is_overlapped() then an insert, and of counting the locks
+ * overlapping a range.  Results are printed to the console. */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/vmalloc.h>
+
+#include <libcfs/libcfs.h>
+#include <interval_tree.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int nitems = 262144;
+module_param(nitems, int, 0644);
+MODULE_PARM_DESC(nitems, "largest number of extents in the tree");
+
+static int nloops = 4;
+module_param(nloops, int, 0644);
+MODULE_PARM_DESC(nloops, "number of times the whole tree is cycled");
+
+#define PREFIX "lustre_kinterval_%u:"
+
+/* every extent is followed by a hole of the same size */
+#define KIT_EXTENT_SIZE	4096
+
+static __u64 kit_rand(__u64 *seed)
+{
+	/* xorshift, cheap enough to not be measured */
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+static int kit_run(struct interval_node *nodes, int count)
+{
+	struct interval_node *root = NULL;
+	struct interval_node_extent ext;
+	struct interval_node *n;
+	__u64 seed = 0x9E3779B97F4A7C15ULL;
+	ktime_t start;
+	__u64 ns_enq;
+	__u64 ns_cnt;
+	__u64 nops = (__u64)count * nloops;
+	__u64 i;
+	int rc = 0;
+	int j;
+
+	for (j = 0; j < count; j++) {
+		interval_init(&nodes[j]);
+		interval_set(&nodes[j], 2ULL * j * KIT_EXTENT_SIZE,
+			     (2ULL * j + 1) * KIT_EXTENT_SIZE - 1);
+		if (interval_insert(&nodes[j], &root) != NULL) {
+			pr_err(PREFIX " duplicate extent %d\n", run_id, j);
+			return -EINVAL;
+		}
+	}
+
+	start = ktime_get();
+	for (i = 0; i < nops; i++) {
+		n = &nodes[(__u32)kit_rand(&seed) % count];
+		interval_erase(n, &root);
+		ext = n->in_extent;
+		if (interval_is_overlapped(root, &ext)) {
+			pr_err(PREFIX " %d extents: [%llu, %llu] overlapped\n",
+			       run_id, count, ext.start, ext.end);
+			rc = -EINVAL;
+			goto out;
+		}
+		/* the hole after the extent is always free */
+		ext.start = ext.end + 1;
+		ext.end += KIT_EXTENT_SIZE;
+		if (interval_is_overlapped(root, &ext)) {
+			pr_err(PREFIX " %d extents: hole [%llu, %llu] "
+			       "overlapped\n", run_id, count, ext.start,
+			       ext.end);
+			rc = -EINVAL;
+			goto out;
+		}
+		interval_insert(n, &root);
+	}
+	ns_enq = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	start = ktime_get();
+	for (i = 0; i < nops; i++) {
+		j = (__u32)kit_rand(&seed) % count;
+		/* from the middle of extent j to the middle of extent j + 3 */
+		ext.start = 2ULL * j * KIT_EXTENT_SIZE + KIT_EXTENT_SIZE / 2;
+		ext.end = ext.start + 6 * KIT_EXTENT_SIZE;
+		if (interval_count(root, &ext, 16) !=
+		    (unsigned long)min(4, count - j)) {
+			pr_err(PREFIX " %d extents: bad count at %d\n",
+			       run_id, count, j);
+			rc = -EINVAL;
+			goto out;
+		}
+	}
+	ns_cnt = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	do_div(ns_enq, nops);
+	do_div(ns_cnt, nops);
+	pr_err(PREFIX " %d extents: enqueue %llu ns/op, count %llu ns/op\n",
+	       run_id, count, ns_enq, ns_cnt);
+out:
+	for (j = 0; j < count; j++) {
+		if (interval_is_intree(&nodes[j]))
+			interval_erase(&nodes[j], &root);
+	}
+	if (rc == 0 && root != NULL) {
+		pr_err(PREFIX " %d extents: tree not empty\n", run_id, count);
+		rc = -EINVAL;
+	}
+	return rc;
+}
+
+static int __init kinterval_init(void)
+{
+	struct interval_node *nodes;
+	int count;
+	int rc = 0;
+
+	if (nitems < 1 || nloops < 1) {
+		pr_err(PREFIX " invalid parameters\n", run_id);
+		goto out;
+	}
+
+	nodes = vmalloc(sizeof(*nodes) * nitems);
+	if (nodes == NULL) {
+		pr_err(PREFIX " cannot allocate %d nodes\n", run_id, nitems);
+		goto out;
+	}
+
+	for (count = min(64, nitems); rc == 0; count *= 8) {
+		if (count > nitems)
+			count = nitems;
+		rc = kit_run(nodes, count);
+		if (count == nitems)
+			break;
+	}
+	if (rc)
+		pr_err(PREFIX " failed: %d\n", run_id, rc);
+	else
+		pr_err(PREFIX " done\n", run_id);
+	vfree(nodes);
+out:
+	/* Don't load. */
+	return -EINVAL;
+}
+
+static void __exit kinterval_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre interval tree benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kinterval_init);
+module_exit(kinterval_exit);
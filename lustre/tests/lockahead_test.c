@@ -1194,6 +1194,55 @@ static int test23(void)
 	return 0;
 }
 
+/* Lock a strided set of extents, as a rank of a collective write would */
+static int test24(void)
+{
+	const int count = 16;
+	size_t write_size = 1024 * 1024;
+	size_t stride = 4 * write_size;
+	char buf[write_size];
+	int fd;
+	int rc;
+	int i;
+
+	fd = open(mainpath, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	ASSERTF(fd >= 0, "open failed for '%s': %s",
+		mainpath, strerror(errno));
+
+	rc = llapi_lockahead_strided(fd, MODE_WRITE_USER, 0, write_size,
+				     stride, count);
+	ASSERTF(rc >= 0,
+		"cannot lockahead '%s': %s", mainpath, strerror(errno));
+
+	/* Ask again until we get all the locks. */
+	for (i = 1; i < 100 && rc < count; i++) {
+		usleep(100000); /* 0.1 second */
+		rc = llapi_lockahead_strided(fd, MODE_WRITE_USER, 0,
+					     write_size, stride, count);
+		ASSERTF(rc >= 0, "cannot lockahead '%s': %s",
+			mainpath, strerror(errno));
+	}
+	ASSERTF(rc == count, "only %d of %d locks granted", rc, count);
+
+	/* Overlapping extents are refused */
+	rc = llapi_lockahead_strided(fd, MODE_WRITE_USER, 0, write_size,
+				     write_size / 2, count);
+	ASSERTF(rc < 0 && errno == EINVAL,
+		"overlapping lockahead extents accepted: %d", rc);
+
+	memset(buf, 0xaa, write_size);
+	for (i = 0; i < count; i++) {
+		rc = pwrite(fd, buf, write_size, i * stride);
+		ASSERTF(rc == sizeof(buf), "write failed for '%s': %s",
+			mainpath, strerror(errno));
+	}
+
+	close(fd);
+
+	/* The writes must have used the locks requested */
+	return count;
+}
+
 static void usage(char *prog)
 {
 	fprintf(stderr,
@@ -1290,6 +1339,7 @@ int main(int argc, char *argv[])
 		PERFORM(test20);
 		PERFORM(test21);
 		PERFORM(test22);
+		PERFORM(test24);
 		/* Some tests require a second mount point */
 		if (lustre_dir2)
 			PERFORM(test23);
@@ -1343,6 +1393,9 @@ int main(int argc, char *argv[])
 			"must provide second mount point for test 23");
 		PERFORM(test23);
 		break;
+	case 24:
+		PERFORM(test24);
+		break;
 	default:
 		fprintf(stderr, "impossible value of single_test %d\n",
 			single_test);
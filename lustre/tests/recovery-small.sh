@@ -2881,6 +2881,34 @@ test_143() {
 }
 run_test 143 "orphan cleanup thread shouldn't be blocked even delete failed"
 
+test_144() {
+	local param=mdt.$FSNAME-MDT0000.connect_window
+	local window
+	local limit
+
+	window=$(do_facet mds1 $LCTL get_param -n $param 2>/dev/null) ||
+		skip "MDS does not support connect_window"
+	do_facet mds1 $LCTL set_param $param=2
+	stack_trap "do_facet mds1 $LCTL set_param $param=$window" EXIT
+
+	# the client is given the window to spread its reconnects over
+	umount_client $MOUNT || error "umount failed"
+	mount_client $MOUNT || error "mount failed"
+	$LCTL get_param mdc.$FSNAME-MDT0000-mdc-*.import |
+		grep "conn_window: 2" ||
+		error "connect window not given to the client"
+
+	# connects refused over the limit are retried after the backoff
+	param=mdt.$FSNAME-MDT0000.connect_limit
+	limit=$(do_facet mds1 $LCTL get_param -n $param)
+	do_facet mds1 $LCTL set_param $param=1
+	stack_trap "do_facet mds1 $LCTL set_param $param=$limit" EXIT
+	umount_client $MOUNT || error "umount failed"
+	mount_client $MOUNT || error "mount with connect_limit=1 failed"
+	$LFS df $MOUNT > /dev/null || error "lfs df failed"
+}
+run_test 144 "connects are throttled and spread over the connect window"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
@@ -1028,6 +1028,35 @@ test_28() {
 }
 run_test 28 "lock replay should be ordered: waiting after granted"
 
+test_29() {
+	local param=/sys/module/ptlrpc/parameters/recovery_replay_threads
+	local threads
+	local i
+
+	threads=$(do_facet $SINGLEMDS "cat $param" 2>/dev/null) ||
+		skip "MDS does not replay in parallel"
+	stack_trap "do_facet $SINGLEMDS 'echo $threads > $param'" EXIT
+	do_facet $SINGLEMDS "echo 4 > $param"
+
+	mkdir $MOUNT1/$tdir-1 $MOUNT2/$tdir-2 || error "mkdir failed"
+	replay_barrier $SINGLEMDS
+	# interleave the transnos of both clients, on disjoint objects
+	createmany -o $MOUNT1/$tdir-1/f 100 &
+	createmany -o $MOUNT2/$tdir-2/f 100 ||
+		error "create on $MOUNT2 failed"
+	wait $! || error "create on $MOUNT1 failed"
+
+	fail $SINGLEMDS
+	for i in 1 2; do
+		local count=$(ls $MOUNT1/$tdir-$i | wc -l)
+
+		[ $count -eq 100 ] || error "$count files in $tdir-$i"
+	done
+	unlinkmany $MOUNT1/$tdir-1/f 100 || error "unlink on $MOUNT1 failed"
+	unlinkmany $MOUNT2/$tdir-2/f 100 || error "unlink on $MOUNT2 failed"
+}
+run_test 29 "parallel replay of disjoint requests from several clients"
+
 complete $SECONDS
 SLEEP=$((SECONDS - $NOW))
 [ $SLEEP -lt $TIMEOUT ] && sleep $SLEEP
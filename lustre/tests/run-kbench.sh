@@ -0,0 +1,104 @@
+#!/bin/bash
+#
+# Run the kbench hot path benchmarks of tests/kernel/kbench.ko on this node
+# and print one "<benchmark> <ns/op>" line per benchmark.  With -b, compare
+# them against the output of an earlier run, e.g. of the previous release,
+# and fail if any benchmark got slower by more than the threshold.
+#
+
+LUSTRE=${LUSTRE:-$(cd $(dirname $0)/..; echo $PWD)}
+LCTL=${LCTL:-$LUSTRE/utils/lctl}
+[ -x $LCTL ] || LCTL=lctl
+MODULE=${MODULE:-$LUSTRE/tests/kernel/kbench.ko}
+[ -f $MODULE ] || MODULE=/usr/lib64/lustre/tests/kernel/kbench.ko
+
+usage() {
+	cat <<-EOF
+	usage: $0 [-b baseline] [-t percent] [-o output] [-n nops] [-r repeat]
+	          [-B bench[,bench...]] [-c client_dev] [-s server_dev]
+	  -b  results of an earlier run to compare with
+	  -t  slowdown in percent reported as a regression, default 10
+	  -o  file to save the results to, for use as a later baseline
+	  -n  operations timed in each run, default 100000
+	  -r  runs of each benchmark, the fastest one is kept, default 3
+	  -B  benchmarks to run, default all
+	  -c  client device for ptlrpc_req_alloc, default the first OSC
+	  -s  MDT device for lu_object_find and ldlm_enqueue, default the
+	      first local MDT
+	EOF
+	exit 1
+}
+
+baseline=
+threshold=10
+output=
+nops=100000
+repeat=3
+bench=
+client=
+server=
+
+while getopts "b:t:o:n:r:B:c:s:h" opt; do
+	case $opt in
+	b) baseline=$OPTARG ;;
+	t) threshold=$OPTARG ;;
+	o) output=$OPTARG ;;
+	n) nops=$OPTARG ;;
+	r) repeat=$OPTARG ;;
+	B) bench=$OPTARG ;;
+	c) client=$OPTARG ;;
+	s) server=$OPTARG ;;
+	*) usage ;;
+	esac
+done
+
+[ -f $MODULE ] || { echo "$0: no kbench module $MODULE" >&2; exit 1; }
+[ -z "$baseline" -o -f "$baseline" ] ||
+	{ echo "$0: no baseline $baseline" >&2; exit 1; }
+
+[ -n "$client" ] ||
+	client=$($LCTL dl 2>/dev/null | awk '$3 == "osc" { print $4; exit }')
+[ -n "$server" ] ||
+	server=$($LCTL dl 2>/dev/null | awk '$3 == "mdt" { print $4; exit }')
+
+run_id=$RANDOM
+args="run_id=$run_id nops=$nops repeat=$repeat"
+[ -n "$bench" ] && args="$args bench=$bench"
+[ -n "$client" ] && args="$args client=$client"
+[ -n "$server" ] && args="$args server=$server"
+
+# This will always fail as the module is designed to not be inserted.
+insmod $MODULE $args &> /dev/null
+
+log=$(dmesg | sed -n "s/.*lustre_kbench_$run_id: //p")
+echo "$log" | grep -q "^done$" || {
+	echo "$0: kbench failed:" >&2
+	echo "$log" >&2
+	exit 1
+}
+
+results=$(echo "$log" | awk '$3 == "ns/op" { print $1, $2 }')
+[ -n "$output" ] && echo "$results" > $output
+
+if [ -z "$baseline" ]; then
+	echo "$log" | awk '$2 == "skipped" { print $1, "-" }'
+	echo "$results"
+	exit 0
+fi
+
+# benchmarks missing from either run are listed but not compared
+echo "$results" | awk -v threshold=$threshold '
+	NR == FNR { base[$1] = $2; next }
+	{
+		if (!($1 in base) || base[$1] == 0) {
+			printf "%-20s %10s %10d\n", $1, "-", $2
+			next
+		}
+		pct = ($2 - base[$1]) * 100 / base[$1]
+		flag = pct > threshold ? "  REGRESSION" : ""
+		if (flag != "")
+			bad++
+		printf "%-20s %10d %10d %+7.1f%%%s\n", $1, base[$1], $2, pct,
+		       flag
+	}
+	END { exit bad > 0 }' $baseline -
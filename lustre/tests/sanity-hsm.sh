@@ -5719,6 +5719,42 @@ test_606() {
 }
 run_test 606 "llog_reader groks changelog fields"
 
+test_610() {
+	# the client of the cache runs the copytool restoring its files
+	copytool setup
+
+	local mntpt=${MOUNT2:-$MOUNT}
+	local f=$DIR/$tdir/$tfile
+	local pcc_f=$mntpt/$tdir/$tfile
+
+	mkdir -p $DIR/$tdir
+	dd if=/dev/urandom of=$f bs=1M count=1 || error "write $f failed"
+
+	do_facet $SINGLEAGT "$LCTL set_param \
+		llite.*.pcc='$HSM_ARCHIVE_NUMBER $(hsm_root)'" ||
+		error "set the client cache failed"
+	stack_trap "do_facet $SINGLEAGT $LCTL set_param llite.*.pcc=0" EXIT
+
+	do_facet $SINGLEAGT $LFS pcc_attach -i $HSM_ARCHIVE_NUMBER $pcc_f ||
+		error "attach $pcc_f failed"
+	echo "Verifying released state: "
+	check_hsm_flags $f "0x0000000d"
+
+	do_facet $SINGLEAGT "echo pcc >> $pcc_f" || error "append failed"
+	echo "Verifying the write went to the cache: "
+	check_hsm_flags $f "0x0000000d"
+	local sum=$(do_facet $SINGLEAGT md5sum $pcc_f | awk '{print $1}')
+
+	do_facet $SINGLEAGT $LFS pcc_detach $pcc_f ||
+		error "detach $pcc_f failed"
+	echo "Verifying file state after detach: "
+	check_hsm_flags $f "0x00000000"
+
+	[[ $(md5sum $f | awk '{print $1}') == $sum ]] ||
+		error "restored file differs from its cache copy"
+}
+run_test 610 "Attach a file to the client cache, detach restores it"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
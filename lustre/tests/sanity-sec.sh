@@ -2549,6 +2549,44 @@ test_33() {
 }
 run_test 33 "correct srpc flags for MGS connection"
 
+test_34() {
+	local batch=mdt.$MDT.identity_upcall_batch
+	local neg=mdt.$MDT.identity_negative_expire
+	local old_batch
+	local old_neg
+	local nr
+
+	[ "$L_GETIDENTITY" != "NONE" ] || skip "no l_getidentity"
+	old_batch=$(do_facet $SINGLEMDS \
+		    $LCTL get_param -n $batch 2>/dev/null) ||
+		skip "MDS does not support identity_upcall_batch"
+	old_neg=$(do_facet $SINGLEMDS $LCTL get_param -n $neg)
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param $batch=$old_batch \
+		    $neg=$old_neg $IDENTITY_FLUSH=-1" EXIT
+
+	# one run of the upcall resolves several users
+	nr=$(do_facet $SINGLEMDS "$L_GETIDENTITY -d 0 $ID0 $ID1" |
+		grep -c "^uid=")
+	(( nr == 3 )) || error "l_getidentity resolved $nr users, not 3"
+
+	# the identities of concurrent users are fetched in batches
+	do_facet $SINGLEMDS $LCTL set_param $batch=8 $IDENTITY_FLUSH=-1
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	chmod 0777 $DIR/$tdir
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f0 & local pid0=$!
+	$RUNAS_CMD -u $ID1 touch $DIR/$tdir/f1 & local pid1=$!
+	wait $pid0 || error "create as $ID0 failed"
+	wait $pid1 || error "create as $ID1 failed"
+
+	# an unknown user is remembered, and is forgotten on flush
+	do_facet $SINGLEMDS $LCTL set_param $neg=60
+	$RUNAS_CMD -u 65533 ls $DIR/$tdir
+	$RUNAS_CMD -u 65533 ls $DIR/$tdir
+	do_facet $SINGLEMDS $LCTL set_param $IDENTITY_FLUSH=-1
+	$RUNAS_CMD -u $ID0 ls $DIR/$tdir || error "ls as $ID0 failed"
+}
+run_test 34 "identity upcall batches and negative cache"
+
 cleanup_55() {
 	# unmount client
 	if is_mounted $MOUNT; then
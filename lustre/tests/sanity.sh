@@ -1383,6 +1383,36 @@ test_24C() {
 }
 run_test 24C "check .. in striped dir"
 
+test_24D() {
+	local max=$($LCTL get_param -n llite.*.dir_names_max | head -n1)
+	local enq
+	local i
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/f- 100 || error "createmany failed"
+
+	stack_trap "$LCTL set_param -n llite.*.dir_names_max=$max" EXIT
+	$LCTL set_param -n llite.*.dir_names_max=1000
+
+	cancel_lru_locks mdc
+	ls $DIR/$tdir > /dev/null || error "ls failed"
+	$LCTL set_param -n mdc.*.stats=clear
+
+	for i in $(seq 0 9); do
+		stat $DIR/$tdir/missing-$i &> /dev/null &&
+			error "missing-$i exists"
+	done
+	enq=$(calc_stats mdc.*.stats ldlm_ibits_enqueue)
+	echo "enqueues for missing names: $enq"
+	(( enq == 0 )) || error "$enq lookups sent for missing names"
+
+	# a name created after readdir must be found
+	touch $DIR/$tdir/missing-0 || error "touch failed"
+	stat $DIR/$tdir/missing-0 > /dev/null || error "new file not found"
+	stat $DIR/$tdir/f-10 > /dev/null || error "f-10 not found"
+}
+run_test 24D "lookup of missing names after readdir needs no RPC"
+
 test_24E() {
 	[[ $MDSCOUNT -lt 4 ]] && skip_env "needs >= 4 MDTs"
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -1435,6 +1465,38 @@ test_24F () {
 }
 run_test 24F "hash order vs readdir (LU-11330)"
 
+test_24G() {
+	local enq
+	local i
+	local n
+
+	test_mkdir $DIR/$tdir
+	cancel_lru_locks mdc
+
+	# the dir lock is got after a few misses, from which on the
+	# negative dentries are kept
+	for n in 1 2; do
+		for i in $(seq 0 9); do
+			stat $DIR/$tdir/missing-$i &> /dev/null &&
+				error "missing-$i exists"
+		done
+	done
+
+	$LCTL set_param -n mdc.*.stats=clear
+	for i in $(seq 0 9); do
+		stat $DIR/$tdir/missing-$i &> /dev/null &&
+			error "missing-$i exists"
+	done
+	enq=$(calc_stats mdc.*.stats ldlm_ibits_enqueue)
+	echo "enqueues for cached missing names: $enq"
+	(( enq == 0 )) || error "$enq lookups sent for cached missing names"
+
+	# a name created afterward must be found
+	touch $DIR/$tdir/missing-0 || error "touch failed"
+	stat $DIR/$tdir/missing-0 > /dev/null || error "new file not found"
+}
+run_test 24G "negative dentries cached under the UPDATE lock of the dir"
+
 test_25a() {
 	echo '== symlink sanity ============================================='
 
@@ -6546,6 +6608,72 @@ test_56ca() {
 }
 run_test 56ca "check lfs find --mirror-count|-N and --mirror-state"
 
+test_56cb() {
+	local dir=$DIR/$tdir
+	local expected
+	local found
+	local i
+
+	test_mkdir $dir
+	for ((i = 0; i < 8; i++)); do
+		$LFS mkdir -i $((i % MDSCOUNT)) $dir/d$i ||
+			error "mkdir d$i failed"
+		test_mkdir $dir/d$i/sub
+		createmany -o $dir/d$i/f 20 > /dev/null ||
+			error "create in d$i failed"
+		createmany -o $dir/d$i/sub/f 5 > /dev/null ||
+			error "create in d$i/sub failed"
+	done
+	touch $dir/top || error "touch top failed"
+
+	expected=$($LFS find $dir | sort)
+	found=$($LFS find --threads 4 $dir | sort)
+	[ "$found" == "$expected" ] ||
+		error "parallel find differs: $(diff <(echo "$expected") \
+			<(echo "$found"))"
+
+	found=$($LFS find --threads 4 $dir -type f -name "f1*" | wc -l)
+	(( found == 8 * 12 )) || error "found $found files, expected 96"
+}
+run_test 56cb "check lfs find --threads"
+
+test_56cc() {
+	local dir=$DIR/$tdir
+	local expected
+	local found
+	local i
+
+	test_mkdir $dir
+	for ((i = 0; i < 8; i++)); do
+		$LFS mkdir -i $((i % MDSCOUNT)) $dir/d$i ||
+			error "mkdir d$i failed"
+		test_mkdir $dir/d$i/sub
+		createmany -o $dir/d$i/f 10 > /dev/null ||
+			error "create in d$i failed"
+		createmany -o $dir/d$i/sub/f 5 > /dev/null ||
+			error "create in d$i/sub failed"
+	done
+
+	expected=$($LFS find $dir)
+	found=$($LFS find --threads 4 --ordered $dir)
+	[ "$found" == "$expected" ] ||
+		error "ordered find differs: $(diff <(echo "$expected") \
+			<(echo "$found"))"
+
+	expected=$($LFS getstripe -r $dir)
+	found=$($LFS getstripe -r --threads 4 --ordered $dir)
+	[ "$found" == "$expected" ] ||
+		error "ordered getstripe differs: $(diff <(echo "$expected") \
+			<(echo "$found"))"
+
+	expected=$($LFS getstripe -r -F $dir | sort)
+	found=$($LFS getstripe -r --threads 4 -F $dir | sort)
+	[ "$found" == "$expected" ] ||
+		error "parallel getstripe differs: $(diff <(echo "$expected") \
+			<(echo "$found"))"
+}
+run_test 56cc "check lfs find and getstripe --threads --ordered"
+
 test_57a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	# note test will not do anything if MDS is not local
@@ -8031,6 +8159,118 @@ test_77k() { # LU-10906
 }
 run_test 77k "enable/disable checksum correctly"
 
+test_77l() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$GSS && skip_env "could not run with gss"
+
+	local param=/sys/module/obdclass/parameters/bulk_cksum_chunk
+	[ -f $param ] || skip "no parallel bulk checksums"
+
+	local chunk=$(cat $param)
+	local ost_chunk=$(do_facet ost1 cat $param)
+
+	[ ! -f $F77_TMP ] && setup_f77
+	stack_trap "echo $chunk > $param" EXIT
+	stack_trap "do_facet ost1 'echo $ost_chunk > $param'" EXIT
+	echo 1 > $param
+	do_facet ost1 "echo 1 > $param"
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile
+	set_checksums 1
+	for algo in $CKSUM_TYPES; do
+		set_checksum_type $algo
+		dd if=$F77_TMP of=$DIR/$tfile bs=4M count=$((F77SZ / 4)) \
+			oflag=direct || error "dd with $algo error: $?"
+		cancel_lru_locks osc
+		cmp $F77_TMP $DIR/$tfile || error "file compare with $algo failed"
+	done
+	set_checksums 0
+	set_checksum_type $ORIG_CSUM_TYPE
+	rm -f $DIR/$tfile
+}
+run_test 77l "parallel bulk checksums match sequential ones"
+
+test_77m() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$GSS && skip_env "could not run with gss"
+	remote_ost_nodsh && skip "remote OST with nodsh"
+
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.import |
+		grep -q t10_guards || skip "OST does not take sector guards"
+
+	local algos=$(echo $CKSUM_TYPES | tr ' ' '\n' | grep t10)
+	local old_debug=$($LCTL get_param -n debug)
+	local algo
+
+	[ -n "$algos" ] || skip "no T10 checksum types"
+	[ ! -f $F77_TMP ] && setup_f77
+	stack_trap "$LCTL set_param -n debug='$old_debug'" EXIT
+	$LCTL set_param debug=+rpctrace
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile
+	set_checksums 1
+	for algo in $algos; do
+		set_checksum_type $algo
+		$LCTL clear
+		#define OBD_FAIL_OST_CHECKSUM_RECEIVE       0x21a
+		do_facet ost1 $LCTL set_param fail_loc=0x8000021a
+		dd if=$F77_TMP of=$DIR/$tfile bs=4M count=1 oflag=direct ||
+			error "dd with $algo error: $?"
+		do_facet ost1 $LCTL set_param fail_loc=0
+		$LCTL dk | grep -q "resend 1 of" ||
+			error "$algo: whole RPC resent for one bad page"
+		cancel_lru_locks osc
+		cmp -n 4M $F77_TMP $DIR/$tfile ||
+			error "file compare with $algo failed"
+	done
+	set_checksums 0
+	set_checksum_type $ORIG_CSUM_TYPE
+	rm -f $DIR/$tfile
+}
+run_test 77m "only the pages with bad guards are resent"
+
+test_77n() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$GSS && skip_env "could not run with gss"
+
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.import |
+		grep -q compress || skip "OST does not take compressed data"
+
+	local osc=$FSNAME-OST0000-osc-[^mM]*
+	local old_type=$($LCTL get_param -n osc.$osc.compress_type |
+			 sed -e 's/.*\[\(.*\)\].*/\1/')
+	local old_debug=$($LCTL get_param -n debug)
+	local algo
+	local tried=0
+
+	stack_trap "$LCTL set_param -n debug='$old_debug'" EXIT
+	stack_trap "$LCTL set_param osc.$osc.compress_type=$old_type" EXIT
+	$LCTL set_param debug=+page
+
+	# half compressible data, half random
+	yes "compressible data" | dd of=$TMP/$tfile bs=1M count=4 iflag=fullblock
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=4 seek=4 conv=notrunc
+	stack_trap "rm -f $TMP/$tfile" EXIT
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile
+	for algo in lz4 zstd deflate lzo; do
+		$LCTL set_param osc.$osc.compress_type=$algo 2>/dev/null ||
+			continue
+		tried=$((tried + 1))
+		$LCTL clear
+		dd if=$TMP/$tfile of=$DIR/$tfile bs=8M count=1 oflag=direct ||
+			error "dd with $algo error: $?"
+		$LCTL dk | grep -q "compressed to .* with $algo" ||
+			error "data not compressed with $algo"
+		cancel_lru_locks osc
+		cmp $TMP/$tfile $DIR/$tfile ||
+			error "file compare with $algo failed"
+	done
+	[ $tried -gt 0 ] || skip "no compressor in the kernel"
+	rm -f $DIR/$tfile
+}
+run_test 77n "compressed BRW data is written and read back intact"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -8654,6 +8894,79 @@ test_101g() {
 }
 run_test 101g "Big bulk(4/16 MiB) readahead"
 
+test_101h() {
+	local file=$DIR/$tfile
+	local streams=$($LCTL get_param -n llite.*.read_ahead_streams |
+			head -n 1)
+	local cmd
+	local val
+	local i
+
+	[ -n "$streams" ] || skip "no read_ahead_streams support"
+
+	dd if=/dev/zero of=$file bs=1M count=64 || error "dd failed"
+
+	# read the file backward by 1MiB chunks, from a single descriptor
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	cmd="o"
+	for ((i = 63; i >= 0; i--)); do
+		cmd+="z$((i * 1048576))r1048576"
+	done
+	$MULTIOP $file ${cmd}c || error "backward read failed"
+	$LCTL get_param llite.*.read_ahead_stats
+	val=$($LCTL get_param -n llite.*.read_ahead_stats |
+	      get_named_value 'reverse read-ahead' | cut -d" " -f1 | calc_total)
+	[ $val -gt 0 ] || error "no reverse read-ahead"
+
+	# two sequential streams interleaved on a single descriptor
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	cmd="o"
+	for ((i = 0; i < 32; i++)); do
+		cmd+="z$((i * 1048576))r1048576"
+		cmd+="z$(((i + 32) * 1048576))r1048576"
+	done
+	$MULTIOP $file ${cmd}c || error "interleaved read failed"
+	$LCTL get_param llite.*.read_ahead_stats
+	val=$($LCTL get_param -n llite.*.read_ahead_stats |
+	      get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	# 16384 pages read, a single stream misses about every other chunk
+	(( $streams == 1 || $val < 4096 )) ||
+		error "too many misses ($val) for interleaved streams"
+
+	rm -f $file
+}
+run_test 101h "read-ahead of backward and interleaved streams"
+
+test_101i() {
+	local file=$DIR/$tfile
+	local active=$($LCTL get_param -n llite.*.read_ahead_async_max_active |
+		       head -n 1)
+	local val
+
+	[ -n "$active" ] || skip "no async read-ahead support"
+	[ $active -gt 0 ] || skip "async read-ahead disabled"
+
+	$LFS setstripe -c 1 -i 0 $file || error "setstripe failed"
+	dd if=/dev/urandom of=$file bs=1M count=256 || error "dd failed"
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+
+	# the read-ahead of the windows reached by hits is left to workers
+	md5sum $file > $TMP/$tfile.md5 || error "first read failed"
+	$LCTL get_param llite.*.read_ahead_stats
+	val=$($LCTL get_param -n llite.*.read_ahead_stats |
+	      get_named_value 'async read-ahead' | cut -d" " -f1 | calc_total)
+	[ $val -gt 0 ] || error "no async read-ahead"
+
+	cancel_lru_locks osc
+	md5sum -c $TMP/$tfile.md5 || error "data differs"
+
+	rm -f $file $TMP/$tfile.md5
+}
+run_test 101i "async read-ahead workers"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -9231,6 +9544,34 @@ test_102t() {
 }
 run_test 102t "zero length xattr values handled correctly"
 
+test_102u() {
+	local i
+
+	test_mkdir $DIR/$tdir
+	for i in $(seq 1 10); do
+		touch $DIR/$tdir/f$i || error "touch f$i failed"
+		setfattr -n user.shared -v same-value $DIR/$tdir/f$i ||
+			error "setfattr f$i failed"
+	done
+
+	# fill the xattr cache, with values shared by the files
+	for i in $(seq 1 10); do
+		getfattr -n user.shared $DIR/$tdir/f$i | grep -q same-value ||
+			error "wrong value of f$i"
+	done
+
+	# a change of one file must not be seen by the others
+	setfattr -n user.shared -v other-value $DIR/$tdir/f1 ||
+		error "setfattr f1 failed"
+	getfattr -n user.shared $DIR/$tdir/f1 | grep -q other-value ||
+		error "wrong value of f1"
+	for i in $(seq 2 10); do
+		getfattr -n user.shared $DIR/$tdir/f$i | grep -q same-value ||
+			error "value of f$i changed"
+	done
+}
+run_test 102u "identical xattr values shared in the xattr cache"
+
 run_acl_subtest()
 {
     $LUSTRE/tests/acl/run $LUSTRE/tests/acl/$1.test
@@ -9373,6 +9714,8 @@ test_104a() {
 	lfs df -i $DIR || error "lfs df -i $DIR failed"
 	lfs df $DIR/$tfile || error "lfs df $DIR/$tfile failed"
 	lfs df -ih $DIR/$tfile || error "lfs df -ih $DIR/$tfile failed"
+	lfs df -s $DIR || error "lfs df -s $DIR failed"
+	lfs df -is $DIR || error "lfs df -is $DIR failed"
 
 	local OSC=$(lctl dl | grep OST0000-osc-[^M] | awk '{ print $4 }')
 	lctl --device %$OSC deactivate
@@ -10291,6 +10634,49 @@ test_119d() # bug 15950
 }
 run_test 119d "The DIO path should try to send a new rpc once one is completed"
 
+test_119e()
+{
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs"
+
+	local stripes=$((OSTCOUNT < 4 ? OSTCOUNT : 4))
+
+	$LFS setstripe -c $stripes -S 1M $DIR/$tfile ||
+		error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=16 ||
+		error "dd urandom failed"
+
+	# a single direct write and read covering several stripe rounds
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=16M count=1 oflag=direct ||
+		error "direct write failed"
+	cancel_lru_locks osc
+	cmp $TMP/$tfile $DIR/$tfile || error "data differs after direct write"
+
+	dd if=$DIR/$tfile of=$TMP/$tfile.2 bs=16M count=1 iflag=direct ||
+		error "direct read failed"
+	cmp $TMP/$tfile $TMP/$tfile.2 || error "data differs after direct read"
+
+	rm -f $DIR/$tfile $TMP/$tfile $TMP/$tfile.2
+}
+run_test 119e "direct IO spanning several stripes"
+
+test_119f()
+{
+	which fio > /dev/null 2>&1 || skip_env "no fio installed"
+
+	local stripes=$((OSTCOUNT < 4 ? OSTCOUNT : 4))
+
+	$LFS setstripe -c $stripes -S 1M $DIR/$tfile ||
+		error "setstripe failed"
+
+	# many asynchronous direct IOs in flight, then read back and verified
+	fio --name=$tfile --filename=$DIR/$tfile --ioengine=libaio \
+		--direct=1 --rw=write --bs=1M --size=64M --iodepth=16 \
+		--verify=crc32c --do_verify=1 || error "fio failed"
+
+	rm -f $DIR/$tfile
+}
+run_test 119f "asynchronous direct IO"
+
 test_120a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_mds_nodsh && skip "remote MDS with nodsh"
@@ -10687,6 +11073,30 @@ test_123c() {
 }
 run_test 123c "Can not initialize inode warning on DNE statahead"
 
+test_123d() {
+	local before
+	local after
+	local i
+
+	test_mkdir $DIR/$tdir
+	createmany -o $DIR/$tdir/f- 100 || error "createmany failed"
+
+	cancel_lru_locks mdc
+	before=$($LCTL get_param -n llite.*.statahead_stats |
+		 awk '/statahead by name:/ { print $4 }')
+
+	# stat by name, the dir is never opened
+	for i in $(seq 0 99); do
+		stat $DIR/$tdir/f-$i > /dev/null || error "stat f-$i failed"
+	done
+
+	after=$($LCTL get_param -n llite.*.statahead_stats |
+		awk '/statahead by name:/ { print $4 }')
+	$LCTL get_param -n llite.*.statahead_stats
+	(( after > before )) || error "statahead by name not started"
+}
+run_test 123d "statahead by name for numbered names"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	$LCTL get_param -n mdc.*.connect_flags | grep -q lru_resize ||
@@ -12130,6 +12540,29 @@ test_134b() {
 }
 run_test 134b "Server rejects lock request when reaching lock_limit_mb"
 
+test_134c() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	mkdir -p $DIR/$tdir || error "failed to create $DIR/$tdir"
+	cancel_lru_locks mdc
+
+	local nr=100
+	local uuid=$($LCTL get_param -n llite.*.uuid | head -n1)
+	local count
+
+	createmany -o $DIR/$tdir/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir"
+	count=$(do_facet mds1 $LCTL get_param -n \
+		mdt.$FSNAME-MDT0000.exports.*.lock_count |
+		awk -v uuid=$uuid '$1 == uuid":" { print $2 }')
+	echo "$uuid holds ${count:-0} locks"
+	[ ${count:-0} -ge $nr ] ||
+		error "only ${count:-0} locks of $uuid counted, expected $nr"
+
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 134c "Report the lock count of each export"
+
 test_140() { #bug-17379
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -13819,6 +14252,42 @@ test_160j() {
 }
 run_test 160j "client can be umounted  while its chanangelog is being used"
 
+test_160l() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local mdt=$(facet_svc $SINGLEMDS)
+	local fid
+	local total
+	local sum=0
+	local i
+
+	changelog_register || error "changelog_register failed"
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 50 || error "createmany failed"
+	mkdir $DIR/$tdir/d || error "mkdir failed"
+	fid=$($LFS path2fid $DIR/$tdir/d)
+	touch $DIR/$tdir/d/f || error "touch failed"
+
+	$LFS changelog --type=mkdir $mdt | grep -v "MKDIR" &&
+		error "other records than MKDIR with --type=mkdir"
+	$LFS changelog --type=mkdir $mdt | grep -q "MKDIR" ||
+		error "no MKDIR record with --type=mkdir"
+	$LFS changelog --fid=$fid $mdt | grep -q "CREAT" ||
+		error "no CREAT record for the children of $fid"
+
+	# the partitions split the records, without losing any
+	total=$($LFS changelog $mdt | wc -l)
+	for ((i = 0; i < 4; i++)); do
+		sum=$((sum + $($LFS changelog --partition=$i/4 $mdt | wc -l)))
+	done
+	(( sum == total )) || error "$sum records in partitions, $total total"
+
+	rm -rf $DIR/$tdir
+	changelog_deregister
+}
+run_test 160l "changelog filtering by type, FID and partition"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -14216,6 +14685,27 @@ test_170() {
 }
 run_test 170 "test lctl df to handle corrupted log ====================="
 
+test_172() {
+	local log=$TMP/$tfile.log
+	local deferred=$($LCTL get_param -n debug_deferred 2> /dev/null)
+
+	[ -n "$deferred" ] || skip "no deferred debug formatting"
+
+	debugsave
+	$LCTL set_param debug=+rpctrace debug_deferred=1
+	$LCTL clear
+	touch $DIR/$tfile
+	$LCTL dk $log > /dev/null
+	$LCTL set_param debug_deferred=$deferred
+	debugrestore
+
+	# arguments stored raw must be formatted when the log is dumped
+	grep -q "Sending RPC pname:cluuid:pid:xid:nid:opc touch:" $log ||
+		error "no formatted RPC trace in $log"
+	rm -f $log $DIR/$tfile
+}
+run_test 172 "debug log with deferred formatting"
+
 test_171() { # bug20592
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -17833,7 +18323,7 @@ test_255c() {
 		      "${rc}, actual ${difference}"
 	fi
 
-	for i in $(seq 12 21); do
+	for i in $(seq 12 21) 24; do
 		# If we do not do this, we run the risk of having too many
 		# locks and starting lock cancellation while we are checking
 		# lock counts.
@@ -18526,6 +19016,44 @@ test_271d() {
 }
 run_test 271d "DoM: read on open (1K file in reply buffer)"
 
+test_271e() {
+	$LCTL get_param -n mdc.*-MDT0000-mdc-*.import |
+		grep -q dom_read_head || skip "MDT does not return DoM file head"
+
+	local dom=$DIR/$tdir/dom
+	local tmp=$TMP/$tfile
+	trap "cleanup_271def_tests $tmp" EXIT
+
+	mkdir -p $DIR/$tdir
+
+	$LFS setstripe -E 1024K -L mdt $DIR/$tdir
+
+	local mdtidx=$($LFS getstripe --mdt-index $DIR/$tdir)
+
+	dd if=/dev/urandom of=$tmp bs=200000 count=1
+	dd if=$tmp of=$dom bs=200000 count=1
+	cancel_lru_locks mdc
+	lctl set_param -n mdc.*.stats=clear
+
+	echo "Open and read file head"
+	dd if=$dom of=$tmp.head bs=4096 count=1 || error "read head failed"
+	local num=$(get_mdc_stats $mdtidx ost_read)
+	local ra=$(get_mdc_stats $mdtidx req_active)
+	local rw=$(get_mdc_stats $mdtidx req_waittime)
+
+	[ -z $num ] || error "$num READ RPC occured"
+	[ $ra == $rw ] || error "$((ra - rw)) resend occured"
+	echo "... DONE"
+
+	# compare content
+	cmp -n 4096 $tmp $tmp.head || error "file head miscompare"
+	rm -f $tmp.head
+	cmp $tmp $dom || error "file miscompare"
+
+	return 0
+}
+run_test 271e "DoM: read on open (200K file and read head)"
+
 test_271f() {
 	[ $MDS1_VERSION -lt $(version_code 2.10.57) ] &&
 		skip "Need MDS version at least 2.10.57"
@@ -20947,6 +21475,29 @@ test_421g() {
 }
 run_test 421g "rmfid to return errors properly"
 
+test_422() {
+	local module=$LUSTRE/tests/kernel/kcfshash.ko
+	local run_id=$RANDOM
+	local ncpus=$(nproc)
+	local n
+
+	[ -f $module ] || skip "no $module"
+
+	# lookups/sec should grow with the thread count for the rcu hash
+	for ((n = 1; n <= ncpus; n *= 2)); do
+		# This will always fail as the module is designed to not
+		# be inserted.
+		insmod $module run_id=$run_id nthreads=$n seconds=2 \
+		    &> /dev/null
+		dmesg | grep -q "lustre_kcfshash_$run_id: done" ||
+			error "kcfshash failed with $n threads"
+		dmesg | grep "lustre_kcfshash_$run_id: .*lookups/sec" |
+			tail -n 2
+		run_id=$((run_id + 1))
+	done
+}
+run_test 422 "cfs_hash lookup scaling with CFS_HASH_RCU"
+
 stat_test() {
     df -h $MOUNT &
     df -h $MOUNT &
@@ -20968,6 +21519,367 @@ test_423() {
 }
 run_test 423 "statfs should return a right data"
 
+test_424() {
+	local param=/sys/module/libcfs/parameters/mag_cache_size
+	local hits
+
+	[ -f $param ] || skip "no magazine support"
+	[ $(cat $param) -gt 0 ] || skip "magazines are disabled"
+
+	dd if=/dev/zero of=$DIR/$tfile bs=4k count=256 oflag=sync ||
+		error "dd failed"
+	rm -f $DIR/$tfile
+
+	$LCTL get_param mag_caches
+	# with one magazine per CPT, requests must have been recycled
+	hits=$($LCTL get_param -n mag_caches |
+	       awk '$1 == "ptlrpc_cache" { n += $4 } END { print n+0 }')
+	[ $hits -gt 0 ] || error "no ptlrpc requests reused from magazines"
+}
+run_test 424 "per-CPT magazines recycle hot objects"
+
+test_425() {
+	local module=$LUSTRE/tests/kernel/kcfsheap.ko
+	local run_id=$RANDOM
+
+	[ -f $module ] || skip "no $module"
+
+	# This will always fail as the module is designed to not be inserted.
+	insmod $module run_id=$run_id &> /dev/null
+	dmesg | grep "lustre_kcfsheap_$run_id: .*ns/op"
+	dmesg | grep -q "lustre_kcfsheap_$run_id: done" ||
+		error "kcfsheap failed"
+}
+run_test 425 "binary and 4-ary cfs_binheap ordering and speed"
+
+test_426() {
+	local param=/sys/module/ptlrpc/parameters/shared_pings
+	local interval=$(($($LCTL get_param -n timeout) / 4))
+	local nodes
+	local pings
+
+	[ -f $param ] || skip "no shared pings support"
+	$LCTL get_param osc.*.import | grep -q shared_ping ||
+		skip "OSTs do not support shared pings"
+	nodes=$($LCTL get_param -n osc.*.import |
+		awk '/current_connection:/ { print $2 }' | sort -u | wc -l)
+	[ $OSTCOUNT -gt $nodes ] || skip "needs several OSTs on an OSS"
+
+	stack_trap "echo $(cat $param) > $param" EXIT
+	echo 1 > $param
+	$LCTL set_param osc.*.stats=clear
+	sleep $((interval * 3))
+
+	pings=$($LCTL get_param osc.*.stats |
+		awk '/^obd_ping/ { sum += $2 } END { print sum + 0 }')
+	echo "$pings pings to $OSTCOUNT OSTs on $nodes OSS"
+	(( pings <= nodes * 4 )) || error "$pings pings to $nodes OSS"
+}
+run_test 426 "one shared ping per OSS for all its OSTs"
+
+test_427() {
+	local module=$LUSTRE/tests/kernel/kinterval.ko
+	local run_id=$RANDOM
+	[ -f $module ] || skip "no $module"
+	# This will always fail as the module is designed to not be inserted.
+	insmod $module run_id=$run_id &> /dev/null
+	dmesg | grep "lustre_kinterval_$run_id: .*ns/op"
+	dmesg | grep -q "lustre_kinterval_$run_id: done" ||
+		error "kinterval failed"
+}
+run_test 427 "interval tree conflict check and count speed"
+
+test_428() {
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs"
+
+	local param=lov.$FSNAME-clilov-*.submit_async_pages
+	local saved=$($LCTL get_param -n $param 2>/dev/null | head -n 1)
+
+	[ -n "$saved" ] || skip "no parallel stripe submission support"
+
+	stack_trap "$LCTL set_param -n $param=$saved" EXIT
+	$LCTL set_param -n $param=1
+
+	$LFS setstripe -c $OSTCOUNT -S 1M $DIR/$tfile ||
+		error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=$((OSTCOUNT * 4)) ||
+		error "dd to $TMP/$tfile failed"
+
+	# each direct IO covers all the stripes, all but one are submitted
+	# by workers
+	dd if=$TMP/$tfile of=$DIR/$tfile bs=$((OSTCOUNT * 2))M oflag=direct ||
+		error "direct write failed"
+	cmp $TMP/$tfile $DIR/$tfile || error "data differs after write"
+	cancel_lru_locks osc
+	dd if=$DIR/$tfile of=$TMP/$tfile.2 bs=$((OSTCOUNT * 2))M iflag=direct ||
+		error "direct read failed"
+	cmp $TMP/$tfile $TMP/$tfile.2 || error "data differs after read"
+
+	rm -f $DIR/$tfile $TMP/$tfile $TMP/$tfile.2
+}
+run_test 428 "stripes of one IO submitted in parallel"
+
+test_429() {
+	local fast_read_sav=$($LCTL get_param -n llite.*.fast_read 2>/dev/null |
+			      head -n 1)
+	local pages=1024
+	local faults
+
+	[ -n "$fast_read_sav" ] || skip "no fast read support"
+	[ $LINUX_VERSION_CODE -ge $(version_code 3.15.0) ] ||
+		skip "no fault-around before 3.15 kernels"
+
+	stack_trap "$LCTL set_param -n llite.*.fast_read=$fast_read_sav" EXIT
+	$LCTL set_param -n llite.*.fast_read=1
+
+	dd if=/dev/zero of=$DIR/$tfile bs=$PAGE_SIZE count=$pages ||
+		error "dd failed"
+	cancel_lru_locks osc
+	cat $DIR/$tfile > /dev/null || error "read failed"
+
+	# the cached pages are mapped by fault-around, not one per fault
+	$LCTL set_param llite.*.stats=0
+	$MULTIOP $DIR/$tfile oO_RDWR:SMRUc || error "mmap read failed"
+	faults=$($LCTL get_param -n llite.*.stats |
+		 awk '/^page_fault/ { sum += $2 } END { print sum + 0 }')
+	echo "$faults page faults for $pages pages"
+	(( faults < pages / 2 )) || error "$faults faults for $pages pages"
+
+	rm -f $DIR/$tfile
+}
+run_test 429 "map cached pages around a read fault"
+
+test_430() {
+	local batch_max=$($LCTL get_param -n osc.*OST0000-osc-[^M]*.batch_max \
+			  2>/dev/null)
+	local batches
+
+	[ -n "$batch_max" ] || skip "no glimpse batching support"
+	$LCTL get_param -n osc.*OST0000-osc-[^M]*.import |
+		grep -q batch_rpc || skip "OST does not support batches"
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	createmany -o $DIR/$tdir/f 256 || error "createmany failed"
+	for f in $DIR/$tdir/f*; do echo data > $f; done
+	cancel_lru_locks osc
+
+	$LCTL set_param osc.*OST0000-osc-[^M]*.stats=clear
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	batches=$($LCTL get_param -n osc.*OST0000-osc-[^M]*.stats |
+		  awk '/^mds_batch/ { print $2 }')
+	echo "${batches:-0} glimpse batches sent"
+	(( ${batches:-0} > 0 )) || error "glimpses were not sent in batches"
+
+	# no batches with batch_max=1, one glimpse per RPC
+	$LCTL set_param osc.*OST0000-osc-[^M]*.batch_max=1
+	stack_trap "$LCTL set_param osc.*.batch_max=$batch_max" EXIT
+	cancel_lru_locks osc
+	$LCTL set_param osc.*OST0000-osc-[^M]*.stats=clear
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	batches=$($LCTL get_param -n osc.*OST0000-osc-[^M]*.stats |
+		  awk '/^mds_batch/ { print $2 }')
+	[ -z "$batches" ] || error "$batches batches sent with batch_max=1"
+
+	unlinkmany $DIR/$tdir/f 256 || error "unlinkmany failed"
+}
+run_test 430 "glimpses of many files are sent in batches"
+
+test_431() {
+	local strict_som=$($LCTL get_param -n llite.*.strict_som 2>/dev/null |
+			   head -n 1)
+	local enqueues
+	local size
+
+	[ -n "$strict_som" ] || skip "no strict SOM support"
+	$LCTL get_param -n mdc.*-MDT0000-mdc-*.import |
+		grep -q strict_som || skip "MDT does not support strict SOM"
+
+	stack_trap "$LCTL set_param -n llite.*.strict_som=$strict_som" EXIT
+	$LCTL set_param -n llite.*.strict_som=1
+
+	$LFS setstripe -c $OSTCOUNT -i 0 $DIR/$tfile
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 || error "dd failed"
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+
+	# the size of the closed file comes from the MDT alone
+	$LCTL set_param osc.*.stats=clear
+	size=$(stat -c %s $DIR/$tfile)
+	(( size == 4194304 )) || error "size $size != 4194304"
+	enqueues=$($LCTL get_param -n osc.*.stats |
+		   awk '/^ldlm_enqueue/ { sum += $2 } END { print sum + 0 }')
+	(( enqueues == 0 )) || error "$enqueues glimpses for a closed file"
+
+	# a writer makes it stale, the last close makes it strict again
+	echo -n a >> $DIR/$tfile || error "append failed"
+	size=$(stat -c %s $DIR/$tfile)
+	(( size == 4194305 )) || error "size $size != 4194305"
+	$MULTIOP $DIR/$tfile oO_WRONLY:T4096c || error "truncate failed"
+	cancel_lru_locks osc
+	size=$(stat -c %s $DIR/$tfile)
+	(( size == 4096 )) || error "size $size != 4096"
+
+	rm -f $DIR/$tfile
+}
+run_test 431 "stat closed files with the strict size kept on the MDT"
+
+test_432() {
+	[ $MDSCOUNT -lt 2 ] && skip_env "needs >= 2 MDTs"
+
+	local hash
+	local mdt
+	local i
+
+	$LFS mkdir -i 0 -c $MDSCOUNT -H crush $DIR/$tdir ||
+		error "mkdir crush striped dir failed"
+	hash=$($LFS getdirstripe -H $DIR/$tdir)
+	[ "$hash" == "crush" ] || error "hash type $hash != crush"
+
+	createmany -o $DIR/$tdir/f 200 || error "createmany failed"
+	cancel_lru_locks mdc
+	for ((i = 0; i < 200; i++)); do
+		stat $DIR/$tdir/f$i > /dev/null || error "stat f$i failed"
+	done
+
+	# every stripe gets its share of the names
+	for ((mdt = 0; mdt < MDSCOUNT; mdt++)); do
+		$LFS find -m $mdt $DIR/$tdir/ -type f | grep -q . ||
+			error "no file on MDT$mdt"
+	done
+
+	unlinkmany $DIR/$tdir/f 200 || error "unlinkmany failed"
+	rmdir $DIR/$tdir || error "rmdir failed"
+}
+run_test 432 "striped directory with the crush hash type"
+
+test_433() {
+	local param=/sys/module/ptlrpc/parameters/rpc_trace_sample
+	local sample
+
+	sample=$(cat $param 2>/dev/null) || skip "no RPC latency tracing"
+	stack_trap "echo $sample > $param; do_facet ost1 'echo 0 > $param'" EXIT
+	echo 1 > $param
+	do_facet ost1 "echo 1 > $param"
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+
+	$LCTL set_param debug=+rpctrace
+	do_facet ost1 $LCTL set_param debug=+rpctrace
+	$LCTL clear
+	do_facet ost1 $LCTL clear
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd failed"
+
+	$LCTL dk | grep -q "trace: reply after" ||
+		error "no traced RPC on the client"
+	do_facet ost1 $LCTL dk | grep "trace: queue" | grep -q "bulk" ||
+		error "no traced RPC on ost1"
+}
+run_test 433 "sampled RPC latency breakdown"
+
+test_434() {
+	local count=$($LCTL get_param -n llite.*.opencache_threshold_count |
+		      head -n1)
+	[ -n "$count" ] || skip "no heat counted opens"
+	local ms=$($LCTL get_param -n llite.*.opencache_threshold_ms | head -n1)
+	local nrpcs
+
+	stack_trap "$LCTL set_param -n llite.*.opencache_threshold_ms=$ms" EXIT
+	stack_trap \
+		"$LCTL set_param -n llite.*.opencache_threshold_count=$count" \
+		EXIT
+	$LCTL set_param -n llite.*.opencache_threshold_count=3
+	$LCTL set_param -n llite.*.opencache_threshold_ms=1000
+
+	echo data > $DIR/$tfile || error "write $tfile failed"
+	cancel_lru_locks $MDC
+	stat $DIR/$tfile > /dev/null || error "stat $tfile failed"
+
+	do_facet $SINGLEMDS "$LCTL set_param mdt.*.md_stats=clear > /dev/null"
+	for i in {1..10}; do
+		cat $DIR/$tfile > /dev/null || error "read $tfile failed"
+	done
+	nrpcs=$(do_facet $SINGLEMDS "$LCTL get_param -n mdt.*.md_stats" |
+		awk '/^open/ {sum += $2} END {print sum}')
+	echo "$nrpcs opens sent for 10 reads"
+	(( ${nrpcs:-0} < 10 )) || error "open handle of $tfile was not cached"
+}
+run_test 434 "often opened file keeps its open handle cached"
+
+test_435() {
+	[ "$ost1_FSTYPE" != ldiskfs ] && skip_env "ldiskfs only test"
+
+	local prealloc=$(do_facet ost1 $LCTL get_param -n \
+			 osd-ldiskfs.$FSNAME-OST0000.stream_prealloc_mb)
+	[ -n "$prealloc" ] || skip "no stream_prealloc_mb on ost1"
+	local tmp=$TMP/$tfile
+
+	stack_trap "rm -f $tmp" EXIT
+	stack_trap "do_facet ost1 $LCTL set_param -n \
+		osd-ldiskfs.$FSNAME-OST0000.stream_prealloc_mb=$prealloc" EXIT
+	do_facet ost1 $LCTL set_param -n \
+		osd-ldiskfs.$FSNAME-OST0000.stream_prealloc_mb=4
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$tmp bs=1M count=16 || error "dd $tmp failed"
+	dd if=$tmp of=$DIR/$tfile bs=1M oflag=direct ||
+		error "write $tfile failed"
+	# the blocks reserved after 16MB must read as zeroes
+	dd if=$tmp of=$DIR/$tfile bs=1M count=1 seek=32 oflag=direct \
+		conv=notrunc || error "write $tfile at 32MB failed"
+	dd if=/dev/zero of=$tmp bs=1M count=16 seek=16 conv=notrunc ||
+		error "zero $tmp failed"
+	dd if=$tmp of=$tmp bs=1M count=1 seek=32 conv=notrunc ||
+		error "copy $tmp failed"
+
+	cancel_lru_locks osc
+	cmp $tmp $DIR/$tfile || error "$tfile differs"
+}
+run_test 435 "streaming writes reserve the blocks after them"
+
+test_436() {
+	local module=$LUSTRE/tests/kernel/kbench.ko
+
+	[ -f $module ] || skip "no $module"
+
+	MODULE=$module $LUSTRE/tests/run-kbench.sh -n 10000 -r 1 ||
+		error "kbench failed"
+}
+run_test 436 "hot path micro-benchmarks"
+
+test_437() {
+	local fast_read_sav=$($LCTL get_param -n llite.*.fast_read 2>/dev/null |
+			      head -n 1)
+	local enqueues
+
+	[ -n "$fast_read_sav" ] || skip "no fast read support"
+
+	stack_trap "$LCTL set_param -n llite.*.fast_read=$fast_read_sav" EXIT
+	$LCTL set_param -n llite.*.fast_read=1
+
+	$LFS setstripe -c $OSTCOUNT -S 1M $DIR/$tfile
+	dd if=/dev/urandom of=$TMP/$tfile bs=1M count=8 || error "dd failed"
+	cp $TMP/$tfile $DIR/$tfile || error "cp failed"
+	cancel_lru_locks osc
+	cat $DIR/$tfile > /dev/null || error "read failed"
+
+	# cached pages are spliced without taking the locks again
+	$LCTL set_param osc.*.stats=clear
+	sendfile $DIR/$tfile $TMP/$tfile.2 || error "sendfile failed"
+	enqueues=$($LCTL get_param -n osc.*.stats |
+		   awk '/^ldlm_enqueue/ { sum += $2 } END { print sum + 0 }')
+	cmp $TMP/$tfile $TMP/$tfile.2 || error "data differs after sendfile"
+	(( enqueues == 0 )) || error "$enqueues enqueues for cached pages"
+
+	# and the uncached ones the normal way
+	cancel_lru_locks osc
+	sendfile $DIR/$tfile $TMP/$tfile.2 || error "sendfile failed"
+	cmp $TMP/$tfile $TMP/$tfile.2 || error "data differs after sendfile"
+
+	rm -f $DIR/$tfile $TMP/$tfile $TMP/$tfile.2
+}
+run_test 437 "sendfile from cached pages"
+
 prep_801() {
 	[[ $(lustre_version_code mds1) -lt $(version_code 2.9.55) ]] ||
 	[[ $OST1_VERSION -lt $(version_code 2.9.55) ]] &&
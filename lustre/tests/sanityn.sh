@@ -1155,6 +1155,44 @@ test_33e() {
 }
 run_test 33e "DNE local operation shouldn't trigger COS"
 
+test_33f() {
+	[ $(lustre_version_code $SINGLEMDS) -lt $(version_code 2.12.7) ] &&
+		skip "Need MDS version at least 2.12.7" && return
+
+	local param_file=$TMP/$tfile-params
+	local nodes=$(comma_list $(mdts_nodes))
+	local commit_nr
+
+	save_lustre_params $(get_facets MDS) "mdt.*.commit_on_sharing" \
+		> $param_file
+	do_nodes $nodes "lctl set_param -n mdt.*.commit_on_sharing=2"
+	stack_trap "restore_lustre_params < $param_file; rm -f $param_file" \
+		EXIT
+
+	mkdir -p $DIR1/$tdir
+	sync_all_data
+
+	do_nodes $nodes "lctl set_param -n mdt.*.async_commit_count=0"
+	touch $DIR1/$tdir/$tfile
+	stat $DIR2/$tdir/$tfile > /dev/null || error "stat $tfile failed"
+	commit_nr=$(do_nodes $nodes \
+		"lctl get_param -n mdt.*.async_commit_count" | calc_sum)
+	echo "CoS count after stat $commit_nr"
+	[ $commit_nr -eq 0 ] || error "stat of another client triggered CoS"
+
+	# the rename depends on the create, try twice in case the create is
+	# committed before the rename comes
+	for i in 1 2; do
+		touch $DIR1/$tdir/$tfile.$i
+		mv $DIR2/$tdir/$tfile.$i $DIR2/$tdir/$tfile.$i.new
+	done
+	commit_nr=$(do_nodes $nodes \
+		"lctl get_param -n mdt.*.async_commit_count" | calc_sum)
+	echo "CoS count after rename $commit_nr"
+	[ $commit_nr -gt 0 ] || error "rename didn't trigger CoS"
+}
+run_test 33f "COS with dependency tracking only commits for replayable ops"
+
 # End commit on sharing tests
 
 get_ost_lock_timeouts() {
@@ -4079,6 +4117,88 @@ test_77n() { #LU-10802
 }
 run_test 77n "check wildcard support for TBF JobID NRS policy"
 
+test_77o() {
+	[ $(lustre_version_code ost1) -lt $(version_code 2.12.7) ] &&
+		skip "Need OST version at least 2.12.7" && return
+
+	local rc
+
+	oss=$(comma_list $(osts_nodes))
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="edf" ||
+		rc=$?
+	[[ $rc -eq 3 ]] && skip "no NRS exists" && return
+	[[ $rc -ne 0 ]] && error "failed to set edf policy"
+
+	nrs_write_read
+
+	do_nodes $oss lctl get_param ost.OSS.ost_io.nrs_edf_expired ||
+		error "failed to get nrs_edf_expired"
+
+	# cleanup
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo" ||
+		error "failed to set policy back to fifo"
+	return 0
+}
+run_test 77o "check EDF NRS policy"
+
+test_77p() {
+	[[ $(lustre_version_code ost1) -ge $(version_code 2.12.7) ]] ||
+		{ skip "Need OST version at least 2.12.7"; return 0; }
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	# the parent rule caps the rate of both child rules together
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="tbf" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_u\ uid={500}\ rate=10" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_uw\ uid={500}\&opcode={ost_write}\ rate=40\ parent=ext_u" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_ur\ uid={500}\&opcode={ost_read}\ rate=40\ parent=ext_u" ||
+		error "failed to start hierarchical TBF rules"
+	trap "cleanup_77k \"ext_uw ext_ur ext_u\" \"fifo\"" EXIT
+
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		grep -q "ext_uw.*parent ext_u" ||
+		error "parent of ext_uw not shown"
+
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ ext_u" &&
+		error "parent rule stopped while it has child rules"
+
+	nrs_write_read "runas -u 500"
+	tbf_verify 10 10 "runas -u 500"
+
+	cleanup_77k "ext_uw ext_ur ext_u" "fifo"
+}
+run_test 77p "check hierarchical TBF rules"
+
+test_77q() {
+	[[ $(lustre_version_code ost1) -ge $(version_code 2.12.7) ]] ||
+		{ skip "Need OST version at least 2.12.7"; return 0; }
+
+	local address=$(comma_list "$(host_nids_address $CLIENTS $NETTYPE)")
+	local client_nids=$(nids_list $address "\\")
+	local nodes=$(comma_list $(osts_nodes))
+
+	# ext_n spans two nets so it is not indexed, unlike ext_u on the uid
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies="tbf" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_u\ uid={500}\ rate=20" \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_n\ nid={0@lo\ $client_nids}\ rate=10" ||
+		error "failed to start TBF rules"
+	trap "cleanup_77k \"ext_u ext_n ext_v\" \"fifo\"" EXIT
+
+	# the newest rule matching is used, indexed or not
+	nrs_write_read "runas -u 500"
+	tbf_verify 10 10 "runas -u 500"
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="start\ ext_v\ uid={500}\ rate=5" ||
+		error "failed to start TBF rule ext_v"
+	nrs_write_read "runas -u 500"
+	tbf_verify 5 5 "runas -u 500"
+
+	cleanup_77k "ext_u ext_n ext_v" "fifo"
+}
+run_test 77q "check TBF rule matching with indexed rules"
+
 test_78() { #LU-6673
 	local rc
 
@@ -4975,6 +5095,36 @@ test_104() {
 }
 run_test 104 "Verify that MDS stores atime/mtime/ctime during close"
 
+test_105() {
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep lock_convert)" ] &&
+		skip "MDS does not support lock convert"
+
+	local md_convert=$(lctl get_param -n llite.*.md_lock_convert | head -n1)
+	local converts
+	local i
+
+	stack_trap "lctl set_param -n llite.*.md_lock_convert=$md_convert" EXIT
+	lctl set_param -n llite.*.md_lock_convert=1
+
+	test_mkdir $DIR1/$tdir
+	touch $DIR1/$tdir/$tfile-0
+	lctl set_param -n mdc.*.stats=clear
+
+	# creates from the second mount only want the UPDATE bit of the
+	# directory, the first one should keep its LOOKUP bit
+	for i in $(seq 1 5); do
+		ls -l $DIR1/$tdir > /dev/null || error "ls $DIR1/$tdir failed"
+		touch $DIR2/$tdir/$tfile-$i || error "touch $tfile-$i failed"
+	done
+	ls $DIR1/$tdir | grep -q $tfile-5 || error "$tfile-5 not seen"
+
+	converts=$(lctl get_param -n mdc.*.stats |
+		   awk '/ldlm_convert/ { sum += $2 } END { print sum + 0 }')
+	echo "$converts lock converts"
+	[ $converts -gt 0 ] || error "no directory lock converted"
+}
+run_test 105 "Convert directory lock instead of cancelling it"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
@@ -184,7 +184,7 @@ sig_hup(int signal)
 static void
 usage(FILE *fp, char *progname)
 {
-	fprintf(fp, "usage: %s [ -fnvmogk ]\n",
+	fprintf(fp, "usage: %s [ -fnvmogk ] [ -t workers ]\n",
 		progname);
 	fprintf(stderr, "-f      - Run in foreground\n");
 	fprintf(stderr, "-n      - Don't establish kerberos credentials\n");
@@ -197,6 +197,8 @@ usage(FILE *fp, char *progname)
 	fprintf(stderr, "-s      - Enable shared secret key support\n");
 #endif
 	fprintf(stderr, "-z      - Enable gssnull support\n");
+	fprintf(stderr, "-t N    - Handle the requests with N worker "
+		"processes\n");
 
 	exit(fp == stderr);
 }
@@ -207,11 +209,12 @@ main(int argc, char *argv[])
 	int get_creds = 1;
 	int fg = 0;
 	int verbosity = 0;
+	int nworkers = 1;
 	int opt;
 	int must_srv_mds = 0, must_srv_oss = 0, must_srv_mgs = 0;
 	char *progname;
 
-	while ((opt = getopt(argc, argv, "fnvmogksz")) != -1) {
+	while ((opt = getopt(argc, argv, "fnvmogkst:z")) != -1) {
 		switch (opt) {
 		case 'f':
 			fg = 1;
@@ -249,6 +252,14 @@ main(int argc, char *argv[])
 			usage(stderr, argv[0]);
 #endif
 			break;
+		case 't':
+			nworkers = atoi(optarg);
+			if (nworkers < 1) {
+				fprintf(stderr, "error: invalid number of "
+					"workers '%s'\n", optarg);
+				usage(stderr, argv[0]);
+			}
+			break;
 		case 'z':
 			null_enabled = 1;
 			break;
@@ -315,7 +326,7 @@ main(int argc, char *argv[])
 
 	gssd_init_unique(GSSD_SVC);
 
-	svcgssd_run();
+	svcgssd_run(nworkers);
 	cleanup_mapping();
 	printerr(0, "gssd_run returned!\n");
 	abort();
@@ -33,12 +33,18 @@
 
 #include <sys/types.h>
 #include <sys/queue.h>
+#include <stdint.h>
 #include <gssapi/gssapi.h>
 
 int krb_enabled;
 
+/* longest request of the init channel passed to a worker */
+#define SVCGSSD_REQUEST_MAX	(32 * 1024)
+
 int handle_channel_request(FILE *f);
-void svcgssd_run(void);
+int handle_request(char *lbuf, uint64_t *cont_handle);
+uint64_t request_cont_handle(char *lbuf);
+void svcgssd_run(int nworkers);
 int gssd_prepare_creds(int must_srv_mgs, int must_srv_mds, int must_srv_oss);
 gss_cred_id_t gssd_select_svc_cred(int lustre_svc);
 const char *gss_OID_mech_name(gss_OID mech);
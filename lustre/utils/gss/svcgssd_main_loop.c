@@ -33,6 +33,7 @@
 #include <sys/poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <netinet/in.h>
 
 #include <stdio.h>
@@ -47,9 +48,222 @@
 
 #include "svcgssd.h"
 #include "err_util.h"
+#include "cacheio.h"
 
 #define GSS_RPC_FILE "/proc/net/rpc/auth.sptlrpc.init/channel"
 
+/* requests read from the init channel in a row before serving the workers */
+#define SVCGSSD_BATCH		64
+/* handshakes remembered waiting for the next request of the client */
+#define SVCGSSD_CONT_MAX	256
+
+/*
+ * With several workers, the main process reads the requests of the init
+ * channel and passes them to the least busy worker process, which does the
+ * GSS work and writes the response to the kernel itself, so a slow handshake
+ * does not delay the other ones. A worker sends back the handle of the
+ * context it keeps when the handshake needs another request, which is then
+ * passed to the same worker.
+ */
+struct svcgssd_worker {
+	pid_t		sw_pid;
+	/* main process end of the socket pair with the worker */
+	int		sw_fd;
+	/* requests passed to the worker and not handled yet */
+	int		sw_pending;
+};
+
+struct svcgssd_cont {
+	uint64_t	sc_handle;
+	int		sc_worker;
+};
+
+static struct svcgssd_worker	*workers;
+static int			 nr_workers;
+static struct svcgssd_cont	 conts[SVCGSSD_CONT_MAX];
+static int			 next_cont;
+
+static void svcgssd_worker_run(int fd)
+{
+	uint64_t cont_handle;
+	ssize_t len;
+	char *buf;
+
+	buf = malloc(SVCGSSD_REQUEST_MAX + 1);
+	if (buf == NULL) {
+		printerr(0, "worker: cannot allocate request buffer\n");
+		exit(1);
+	}
+
+	while (1) {
+		len = recv(fd, buf, SVCGSSD_REQUEST_MAX, 0);
+		if (len < 0 && errno == EINTR)
+			continue;
+		/* the main process is gone */
+		if (len <= 0)
+			exit(len < 0);
+
+		buf[len] = '\0';
+		printerr(2, "handling request\n");
+		handle_request(buf, &cont_handle);
+		if (send(fd, &cont_handle, sizeof(cont_handle),
+			 MSG_NOSIGNAL) < 0) {
+			printerr(0, "worker: failed to send reply: %s\n",
+				 strerror(errno));
+			exit(1);
+		}
+	}
+}
+
+static int svcgssd_worker_start(int idx, int channel_fd)
+{
+	pid_t pid;
+	int sv[2];
+	int i;
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+		printerr(0, "cannot create socket of worker %d: %s\n", idx,
+			 strerror(errno));
+		return -1;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		printerr(0, "cannot fork worker %d: %s\n", idx,
+			 strerror(errno));
+		close(sv[0]);
+		close(sv[1]);
+		return -1;
+	}
+
+	if (pid == 0) {
+		close(sv[0]);
+		if (channel_fd >= 0)
+			close(channel_fd);
+		for (i = 0; i < nr_workers; i++)
+			if (workers[i].sw_fd >= 0)
+				close(workers[i].sw_fd);
+		svcgssd_worker_run(sv[1]);
+	}
+
+	close(sv[1]);
+	workers[idx].sw_pid = pid;
+	workers[idx].sw_fd = sv[0];
+	workers[idx].sw_pending = 0;
+	printerr(1, "started worker %d, pid %d\n", idx, pid);
+
+	return 0;
+}
+
+static void svcgssd_worker_stop(int idx)
+{
+	int i;
+
+	close(workers[idx].sw_fd);
+	waitpid(workers[idx].sw_pid, NULL, 0);
+	printerr(0, "worker %d, pid %d exited, %d requests lost\n", idx,
+		 workers[idx].sw_pid, workers[idx].sw_pending);
+	workers[idx].sw_fd = -1;
+	workers[idx].sw_pending = 0;
+
+	/* the contexts it kept are gone with it */
+	for (i = 0; i < SVCGSSD_CONT_MAX; i++)
+		if (conts[i].sc_worker == idx)
+			conts[i].sc_handle = 0;
+}
+
+/* a worker is done with a request */
+static void svcgssd_worker_done(int idx)
+{
+	uint64_t cont_handle;
+	ssize_t len;
+
+	len = recv(workers[idx].sw_fd, &cont_handle, sizeof(cont_handle),
+		   MSG_DONTWAIT);
+	if (len < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if (len != sizeof(cont_handle)) {
+		svcgssd_worker_stop(idx);
+		return;
+	}
+
+	if (workers[idx].sw_pending > 0)
+		workers[idx].sw_pending--;
+	if (cont_handle != 0) {
+		conts[next_cont].sc_handle = cont_handle;
+		conts[next_cont].sc_worker = idx;
+		next_cont = (next_cont + 1) % SVCGSSD_CONT_MAX;
+	}
+}
+
+static void svcgssd_dispatch(char *lbuf)
+{
+	uint64_t handle;
+	size_t len;
+	int idx = -1;
+	int i;
+
+	len = strlen(lbuf);
+	if (len > SVCGSSD_REQUEST_MAX) {
+		printerr(0, "WARNING: request of %zu bytes too long\n", len);
+		return;
+	}
+
+	handle = request_cont_handle(lbuf);
+	for (i = 0; handle != 0 && i < SVCGSSD_CONT_MAX; i++) {
+		if (conts[i].sc_handle == handle) {
+			conts[i].sc_handle = 0;
+			idx = conts[i].sc_worker;
+			break;
+		}
+	}
+
+	if (idx < 0 || workers[idx].sw_fd < 0) {
+		idx = -1;
+		for (i = 0; i < nr_workers; i++) {
+			if (workers[i].sw_fd < 0)
+				continue;
+			if (idx < 0 ||
+			    workers[i].sw_pending < workers[idx].sw_pending)
+				idx = i;
+		}
+	}
+	if (idx < 0) {
+		printerr(0, "WARNING: no worker to handle request\n");
+		return;
+	}
+
+	if (send(workers[idx].sw_fd, lbuf, len, MSG_NOSIGNAL) < 0) {
+		printerr(0, "WARNING: failed to pass request to worker %d: "
+			 "%s\n", idx, strerror(errno));
+		return;
+	}
+	workers[idx].sw_pending++;
+}
+
+/* pass the requests waiting in the init channel to the workers */
+static int svcgssd_read_requests(FILE *f)
+{
+	static char	*lbuf;
+	static int	 lbuflen;
+	struct pollfd	 pollfd = { .fd = fileno(f), .events = POLLIN };
+	int		 i;
+
+	for (i = 0; i < SVCGSSD_BATCH; i++) {
+		if (readline(fileno(f), &lbuf, &lbuflen) != 1) {
+			printerr(0, "WARNING: failed reading request\n");
+			return -1;
+		}
+		svcgssd_dispatch(lbuf);
+
+		pollfd.revents = 0;
+		if (poll(&pollfd, 1, 0) != 1 || !(pollfd.revents & POLLIN))
+			break;
+	}
+
+	return 0;
+}
+
 /*
  * nfs4 in-kernel cache implementation make upcall failed directly
  * if there's no listener detected. so here we should keep the init
@@ -60,15 +274,32 @@
  * it's the only oppotunity we can close the file and startover.
  */
 void
-svcgssd_run()
+svcgssd_run(int nworkers)
 {
 	static const char gss_rpc_channel_path[] =
 		"/proc/net/rpc/auth.sptlrpc.init/channel";
 	int			ret;
+	int			i;
 	FILE			*f = NULL;
-	struct pollfd		pollfd;
+	struct pollfd		*pollfds;
 	struct timespec		halfsec = { .tv_sec = 0, .tv_nsec = 500000000 };
 
+	if (nworkers > 1) {
+		workers = calloc(nworkers, sizeof(*workers));
+		if (workers == NULL) {
+			printerr(0, "cannot allocate %d workers\n", nworkers);
+			exit(1);
+		}
+		nr_workers = nworkers;
+		for (i = 0; i < nr_workers; i++)
+			workers[i].sw_fd = -1;
+	}
+	pollfds = calloc(nr_workers + 1, sizeof(*pollfds));
+	if (pollfds == NULL) {
+		printerr(0, "cannot allocate poll array\n");
+		exit(1);
+	}
+
 	while (1) {
 		int save_err;
 
@@ -84,11 +315,19 @@ svcgssd_run()
 				break;
 			}
 		}
-		pollfd.fd = fileno(f);
-		pollfd.events = POLLIN;
+		pollfds[0].fd = fileno(f);
+		pollfds[0].events = POLLIN;
+		pollfds[0].revents = 0;
+		for (i = 0; i < nr_workers; i++) {
+			if (workers[i].sw_fd < 0)
+				svcgssd_worker_start(i, fileno(f));
+			/* poll ignores the negative fds */
+			pollfds[i + 1].fd = workers[i].sw_fd;
+			pollfds[i + 1].events = POLLIN;
+			pollfds[i + 1].revents = 0;
+		}
 
-		pollfd.revents = 0;
-		ret = poll(&pollfd, 1, 1000);
+		ret = poll(pollfds, nr_workers + 1, 1000);
 		save_err = errno;
 
 		if (ret < 0) {
@@ -99,13 +338,16 @@ svcgssd_run()
 		} else if (ret == 0) {
 			printerr(4, "poll timeout\n");
 		} else {
-			if (ret != 1) {
-				printerr(0, "bug: unexpected poll return %d\n",
-						ret);
-				exit(1);
-			}
-			if (pollfd.revents & POLLIN) {
-				if (handle_channel_request(f) < 0) {
+			for (i = 0; i < nr_workers; i++)
+				if (pollfds[i + 1].revents != 0)
+					svcgssd_worker_done(i);
+
+			if (pollfds[0].revents & POLLIN) {
+				if (nr_workers > 0)
+					ret = svcgssd_read_requests(f);
+				else
+					ret = handle_channel_request(f);
+				if (ret < 0) {
 					fclose(f);
 					f = NULL;
 				}
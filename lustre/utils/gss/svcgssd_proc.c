@@ -139,7 +139,7 @@ struct gss_verifier {
 #define RPCSEC_GSS_SEQ_WIN	5
 
 static int
-send_response(FILE *f, gss_buffer_desc *in_handle, gss_buffer_desc *in_token,
+send_response(gss_buffer_desc *in_handle, gss_buffer_desc *in_token,
 	      u_int32_t maj_stat, u_int32_t min_stat,
 	      gss_buffer_desc *out_handle, gss_buffer_desc *out_token)
 {
@@ -701,7 +701,39 @@ out_err:
  * return -1 only if we detect error during reading from upcall channel,
  * all other cases return 0.
  */
-int handle_channel_request(FILE *f)
+/*
+ * Handle of the context a request of the init channel continues, 0 for the
+ * first request of a handshake. Used by the main loop to pass the request
+ * to the worker which holds the context.
+ */
+uint64_t request_cont_handle(char *lbuf)
+{
+	char		in_handle_buf[15];
+	char		nm_name[LUSTRE_NODEMAP_NAME_LENGTH + 1];
+	uint32_t	lustre_svc;
+	lnet_nid_t	nid;
+	uint64_t	handle_seq;
+	uint64_t	handle = 0;
+	char		*cp = lbuf;
+
+	/* see rsi_request() for the format of data being input here */
+	qword_get(&cp, (char *)&lustre_svc, sizeof(lustre_svc));
+	qword_get(&cp, (char *)&nid, sizeof(nid));
+	qword_get(&cp, (char *)&handle_seq, sizeof(handle_seq));
+	qword_get(&cp, nm_name, sizeof(nm_name));
+	if (qword_get(&cp, in_handle_buf, sizeof(in_handle_buf)) ==
+	    sizeof(handle))
+		memcpy(&handle, in_handle_buf, sizeof(handle));
+
+	return handle;
+}
+
+/*
+ * Handle a request \a lbuf read from the init channel. If the handshake
+ * needs another request, \a cont_handle is set to the handle of the
+ * context it is sent with, to 0 otherwise.
+ */
+int handle_request(char *lbuf, uint64_t *cont_handle)
 {
 	char			in_tok_buf[TOKEN_BUF_SIZE];
 	char			in_handle_buf[15];
@@ -709,9 +741,7 @@ int handle_channel_request(FILE *f)
 	gss_buffer_desc		ctx_token      = {.value = NULL},
 				null_token     = {.value = NULL};
 	uint32_t		lustre_mech;
-	static char		*lbuf;
-	static int		lbuflen;
-	static char		*cp;
+	char			*cp;
 	int			get_len;
 	int			rc = 1;
 	u_int32_t		ignore_min_stat;
@@ -723,12 +753,7 @@ int handle_channel_request(FILE *f)
 		.ctx			= GSS_C_NO_CONTEXT,
 	};
 
-	printerr(2, "handling request\n");
-	if (readline(fileno(f), &lbuf, &lbuflen) != 1) {
-		printerr(0, "WARNING: failed reading request\n");
-		return -1;
-	}
-
+	*cont_handle = 0;
 	cp = lbuf;
 
 	/* see rsi_request() for the format of data being input here */
@@ -842,12 +867,17 @@ int handle_channel_request(FILE *f)
 out_err:
 	/* Failures send a null token */
 	if (rc == 0)
-		send_response(f, &snd.in_handle, &snd.in_tok, snd.maj_stat,
+		send_response(&snd.in_handle, &snd.in_tok, snd.maj_stat,
 			      snd.min_stat, &snd.out_handle, &snd.out_tok);
 	else
-		send_response(f, &snd.in_handle, &snd.in_tok, snd.maj_stat,
+		send_response(&snd.in_handle, &snd.in_tok, snd.maj_stat,
 			      snd.min_stat, &null_token, &null_token);
 
+	if (rc == 0 && snd.maj_stat == GSS_S_CONTINUE_NEEDED &&
+	    snd.out_handle.length == sizeof(*cont_handle))
+		memcpy(cont_handle, snd.out_handle.value,
+		       sizeof(*cont_handle));
+
 	/* cleanup buffers */
 	if (snd.ctx_token.value != NULL)
 		free(ctx_token.value);
@@ -858,3 +888,18 @@ out_err:
 ignore:
 	return 0;
 }
+
+int handle_channel_request(FILE *f)
+{
+	static char	*lbuf;
+	static int	 lbuflen;
+	uint64_t	 cont_handle;
+
+	printerr(2, "handling request\n");
+	if (readline(fileno(f), &lbuf, &lbuflen) != 1) {
+		printerr(0, "WARNING: failed reading request\n");
+		return -1;
+	}
+
+	return handle_request(lbuf, &cont_handle);
+}
@@ -72,10 +72,12 @@ static char *progname;
 static void usage(void)
 {
 	fprintf(stderr,
-		"\nusage: %s {-d|mdtname} {uid}\n"
+		"\nusage: %s {-d|mdtname} {uid} [uid ...]\n"
 		"Normally invoked as an upcall from Lustre, set via:\n"
 		"lctl set_param mdt.${mdtname}.identity_upcall={path to upcall}\n"
-		"\t-d: debug, print values to stdout instead of Lustre\n",
+		"\t-d: debug, print values to stdout instead of Lustre\n"
+		"Several uids are given when identity_upcall_batch > 1, their\n"
+		"identities are written back to Lustre at once.\n",
 		progname);
 }
 
@@ -403,54 +405,78 @@ int main(int argc, char **argv)
 {
 	char *end;
 	struct identity_downcall_data *data = NULL;
+	char *buf = NULL;
+	size_t buflen = 0;
 	glob_t path;
 	unsigned long uid;
-	int fd, rc = -EINVAL, size, maxgroups;
+	int fd, rc = -EINVAL, size, maxgroups, i;
+	bool debug;
 
-        progname = basename(argv[0]);
-        if (argc != 3) {
-                usage();
-                goto out;
-        }
-
-        uid = strtoul(argv[2], &end, 0);
-        if (*end) {
-                errlog("%s: invalid uid '%s'\n", progname, argv[2]);
-                goto out;
-        }
+	progname = basename(argv[0]);
+	if (argc < 3) {
+		usage();
+		goto out;
+	}
 
-        maxgroups = sysconf(_SC_NGROUPS_MAX);
-        if (maxgroups > NGROUPS_MAX)
-                maxgroups = NGROUPS_MAX;
+	maxgroups = sysconf(_SC_NGROUPS_MAX);
+	if (maxgroups > NGROUPS_MAX)
+		maxgroups = NGROUPS_MAX;
 	if (maxgroups == -1) {
 		rc = -EINVAL;
 		goto out;
 	}
 
-        size = offsetof(struct identity_downcall_data, idd_groups[maxgroups]);
-        data = malloc(size);
-        if (!data) {
-                errlog("malloc identity downcall data(%d) failed!\n", size);
-                rc = -ENOMEM;
-                goto out;
-        }
+	size = offsetof(struct identity_downcall_data, idd_groups[maxgroups]);
+	data = malloc(size);
+	if (!data) {
+		errlog("malloc identity downcall data(%d) failed!\n", size);
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	debug = strcmp(argv[1], "-d") == 0 || getenv("L_GETIDENTITY_TEST");
+
+	for (i = 2; i < argc; i++) {
+		size_t len;
+		char *tmp;
+
+		uid = strtoul(argv[i], &end, 0);
+		if (*end) {
+			errlog("%s: invalid uid '%s'\n", progname, argv[i]);
+			rc = -EINVAL;
+			goto out;
+		}
+
+		memset(data, 0, size);
+		data->idd_magic = IDENTITY_DOWNCALL_MAGIC;
+		data->idd_uid = uid;
+		/* get groups for uid */
+		rc = get_groups_local(data, maxgroups);
+		if (!rc)
+			/* read permission database */
+			rc = get_perms(data);
+
+		if (debug) {
+			show_result(data);
+			continue;
+		}
+
+		/* the records are sent back to back in a single write */
+		len = offsetof(struct identity_downcall_data,
+			       idd_groups[data->idd_ngroups]);
+		tmp = realloc(buf, buflen + len);
+		if (!tmp) {
+			errlog("realloc identity downcall data(%zu) failed!\n",
+			       buflen + len);
+			rc = -ENOMEM;
+			goto out;
+		}
+		buf = tmp;
+		memcpy(buf + buflen, data, len);
+		buflen += len;
+	}
 
-        memset(data, 0, size);
-        data->idd_magic = IDENTITY_DOWNCALL_MAGIC;
-        data->idd_uid = uid;
-        /* get groups for uid */
-        rc = get_groups_local(data, maxgroups);
-        if (rc)
-                goto downcall;
-
-        size = offsetof(struct identity_downcall_data,
-                        idd_groups[data->idd_ngroups]);
-        /* read permission database */
-        rc = get_perms(data);
-
-downcall:
-	if (strcmp(argv[1], "-d") == 0 || getenv("L_GETIDENTITY_TEST")) {
-		show_result(data);
+	if (debug) {
 		rc = 0;
 		goto out;
 	}
@@ -469,9 +495,9 @@ downcall:
 		goto out_params;
 	}
 
-	rc = write(fd, data, size);
+	rc = write(fd, buf, buflen);
 	close(fd);
-	if (rc != size) {
+	if (rc != buflen) {
 		errlog("partial write ret %d: %s\n", rc, strerror(errno));
 		rc = -1;
 	} else {
@@ -481,6 +507,7 @@ downcall:
 out_params:
 	cfs_free_param_data(&path);
 out:
+	free(buf);
 	if (data != NULL)
 		free(data);
 	return rc;
@@ -437,6 +437,10 @@ command_t cmdlist[] = {
 	 "getattr files on MDT by echo client\n"
 	 "usage: test_md_getattr [-d parent_basedir] <-D parent_count>"
 	 "[-b child_base_id] [-n count] <-t time>\n"},
+	{"test_rename", jt_obd_test_rename, 0,
+	 "rename files on MDT away and back by echo client\n"
+	 "usage: test_rename [-d parent_basedir] <-D parent_count>"
+	 "[-b child_base_id] [-n count] <-t time>\n"},
 	{"getattr", jt_obd_getattr, 0,
 	 "get attribute for OST object <objid>\n"
 	 "usage: getattr <objid>"},
@@ -458,6 +462,13 @@ command_t cmdlist[] = {
 	{"test_brw", jt_obd_test_brw, 0,
 	 "do <num> bulk read/writes (<npages> per I/O, on OST object <objid>)\n"
 	 "usage: test_brw [t]<num> [write [verbose [npages [[t]objid]]]]"},
+	{"test_load", jt_obd_test_load, 0,
+	 "keep <depth> bulk I/Os in flight in the kernel over <nobj> OST\n"
+	 "objects starting at <objid>, and report latency percentiles\n"
+	 "usage: test_load --objid|-o <objid> --size|-s <KiB per object>\n"
+	 "		 [--objects|-n <nobj>] [--depth|-q <depth>]\n"
+	 "		 [--pages|-p <npages>[-<max_npages>]]\n"
+	 "		 [--read|-r <percent>] [--noverify|-x]"},
 	{"getobjversion", jt_get_obj_version, 0,
 	 "get the version of an object on servers\n"
 	 "usage: getobjversion <fid>\n"
@@ -59,6 +59,7 @@
 #include <sys/stat.h>
 #include <sys/param.h>
 #include <sys/xattr.h>
+#include <sys/vfs.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <time.h>
@@ -66,6 +67,7 @@
 #include <syslog.h>
 #include <sys/utsname.h>
 #include <zlib.h>
+#include <pthread.h>
 #include <libgen.h>
 #include <asm/byteorder.h>
 #include "lfs_project.h"
@@ -116,6 +118,8 @@ static int lfs_hsm_restore(int argc, char **argv);
 static int lfs_hsm_release(int argc, char **argv);
 static int lfs_hsm_remove(int argc, char **argv);
 static int lfs_hsm_cancel(int argc, char **argv);
+static int lfs_pcc_attach(int argc, char **argv);
+static int lfs_pcc_detach(int argc, char **argv);
 static int lfs_swap_layouts(int argc, char **argv);
 static int lfs_mv(int argc, char **argv);
 static int lfs_ladvise(int argc, char **argv);
@@ -171,6 +175,7 @@ static inline int lfs_mirror_split(int argc, char **argv)
 	"                 [--pool|-p <pool_name>]\n"			\
 	"                 [--ost|-o <ost_indices>]\n"			\
 	"                 [--yaml|-y <yaml_template_file>]\n"		\
+	"                 [--extension-size|-z <ext_size>]\n"		\
 	"                 [--copy=<lustre_src>]\n"
 
 #define SSM_HELP_COMMON \
@@ -180,6 +185,8 @@ static inline int lfs_mirror_split(int argc, char **argv)
 	"\t              Can be specified with K, M or G (for KB, MB, GB\n" \
 	"\t              respectively)\n"				\
 	"\tpool_name:    Name of OST pool to use (default none)\n"	\
+	"\text_size:     Size the last component grows by on each write\n"\
+	"\t              past its start, must be a multiple of 64KB\n"	\
 	"\tlayout:       stripe pattern type: raid0, mdt (default raid0)\n"\
 	"\tost_indices:  List of OST indices, can be repeated multiple times\n"\
 	"\t              Indices be specified in a format of:\n"	\
@@ -239,12 +246,14 @@ static inline int lfs_mirror_split(int argc, char **argv)
 	"                 [--block|-b]\n"				\
 	"                 [--non-block|-n]\n"				\
 	"                 [--non-direct|-D]\n"				\
+	"                 [--threads <n>]\n"				\
 	"                 <filename>\n"					\
 	SSM_HELP_COMMON							\
 	"\n"								\
 	"\tblock:        Block file access during data migration (default)\n" \
 	"\tnon-block:    Abort migrations if concurrent access is detected\n" \
 	"\tnon-direct:   Do not use direct I/O to copy file contents\n" \
+	"\tthreads:      Number of streams copying the data of each file\n" \
 
 #define SETDIRSTRIPE_USAGE						\
 	"		[--mdt-count|-c stripe_count>\n"		\
@@ -256,6 +265,7 @@ static inline int lfs_mirror_split(int argc, char **argv)
 	"\tmdt_hash:  hash type of the striped directory. mdt types:\n"	\
 	"	fnv_1a_64 FNV-1a hash algorithm (default)\n"		\
 	"	all_char  sum of characters % MDT_COUNT (not recommended)\n" \
+	"	crush     consistent hash, moves few names on restriping\n" \
 	"\tdefault_stripe: set default dirstripe of the directory\n"	\
 	"\tmode: the file access permission of the directory (octal)\n"
 
@@ -295,7 +305,9 @@ command_t mirror_cmdlist[] = {
 	{ .pc_name = "write", .pc_func = lfs_mirror_write,
 	  .pc_help = "Write to a specified mirror of a file.\n"
 		"usage: lfs mirror write <--mirror-id|-N <mirror_id> "
-		"[--inputfile|-i <input_file>] <mirrored_file>\n" },
+		"[--inputfile|-i <input_file>] <mirrored_file>\n"
+		"\tmirror_id:   -1 writes all mirrors in parallel, leaving\n"
+		"\t             the file in sync without a resync.\n" },
 	{ .pc_name = "copy", .pc_func = lfs_mirror_copy,
 	  .pc_help = "Copy a specified mirror to other mirror(s) of a file.\n"
 		"usage: lfs mirror copy <--read-mirror|-i <id0>> "
@@ -352,12 +364,13 @@ command_t cmdlist[] = {
 	 "		   [--mdt-index|-m] [--recursive|-r] [--raw|-R]\n"
 	 "		   [--layout|-L] [--generation|-g] [--yaml|-y]\n"
 	 "		   [--component-id[=comp_id]|-I[comp_id]]\n"
-	 "		   [--component-flags {init,stale,prefer,offline,nosync}]\n"
+	 "		   [--component-flags {init,stale,prefer,offline,nosync,extension}]\n"
 	 "		   [--component-count]\n"
 	 "		   [--component-start [+-]N[kMGTPE]]\n"
 	 "		   [--component-end|-E [+-]N[kMGTPE]]\n"
 	 "		   [[!] --mirror-index=[+-]<index> |\n"
 	 "		    [!] --mirror-id=[+-]<id>]\n"
+	 "		   [--threads <n> [--ordered]]\n"
 	 "		   <directory|filename> ..."},
 	{"setdirstripe", lfs_setdirstripe, 0,
 	 "To create a striped directory on a specified MDT. This can only\n"
@@ -395,6 +408,7 @@ command_t cmdlist[] = {
 	 "     [[!] --stripe-count|-c [+-]<stripes>]\n"
 	 "     [[!] --stripe-index|-i <index,...>]\n"
 	 "     [[!] --stripe-size|-S [+-]N[kMGT]] [[!] --type|-t <filetype>]\n"
+	 "     [--threads <n> [--ordered]]\n"
 	 "     [[!] --gid|-g|--group|-G <gid>|<gname>]\n"
 	 "     [[!] --uid|-u|--user|-U <uid>|<uname>] [[!] --pool <pool>]\n"
 	 "     [[!] --projid <projid>]\n"
@@ -413,7 +427,8 @@ command_t cmdlist[] = {
          "\t +: used before a value indicates more than requested value\n"
 	 "\thashtype:	hash type of the striped directory.\n"
 	 "\t		fnv_1a_64 FNV-1a hash algorithm\n"
-	 "\t		all_char  sum of characters % MDT_COUNT\n"},
+	 "\t		all_char  sum of characters % MDT_COUNT\n"
+	 "\t		crush     consistent hash over the stripes\n"},
         {"check", lfs_check, 0,
          "Display the status of MDS or OSTs (as specified in the command)\n"
          "or all the servers (MDS and OSTs).\n"
@@ -426,7 +441,7 @@ command_t cmdlist[] = {
          "report filesystem disk space usage or inodes usage"
          "of each MDS and all OSDs or a batch belonging to a specific pool .\n"
          "Usage: df [--inodes|-i] [--human-readable|-h] [--lazy|-l]\n"
-	 "          [--pool|-p <fsname>[.<pool>]] [path]"},
+	 "          [--pool|-p <fsname>[.<pool>]] [--summary|-s] [path]"},
         {"getname", lfs_getname, 0, "list instances and specified mount points "
          "[for specified path only]\n"
          "Usage: getname [-h]|[path ...] "},
@@ -488,7 +503,9 @@ command_t cmdlist[] = {
          "usage: flushctx [-k] [mountpoint...]"},
         {"changelog", lfs_changelog, 0,
          "Show the metadata changes on an MDT."
-         "\nusage: changelog <mdtname> [startrec [endrec]]"},
+	 "\nusage: changelog [--follow] [--type TYPE[,...]] [--fid FID]\n"
+	 "                 [--jobid JOBID] [--partition INDEX/COUNT]\n"
+	 "                 <mdtname> [startrec [endrec]]"},
         {"changelog_clear", lfs_changelog_clear, 0,
          "Indicate that old changelog records up to <endrec> are no longer of "
          "interest to consumer <id>, allowing the system to free up space.\n"
@@ -541,6 +558,12 @@ command_t cmdlist[] = {
 	{"hsm_cancel", lfs_hsm_cancel, 0,
 	 "Cancel requests related to specified files.\n"
 	 "usage: hsm_cancel [--filelist FILELIST] [--data DATA] <file> ..."},
+	{"pcc_attach", lfs_pcc_attach, 0,
+	 "Attach files to the persistent cache of the client.\n"
+	 "usage: pcc_attach --id ID <file> ..."},
+	{"pcc_detach", lfs_pcc_detach, 0,
+	 "Detach files from the persistent cache of the client.\n"
+	 "usage: pcc_detach <file> ..."},
 	{"swap_layouts", lfs_swap_layouts, 0, "Swap layouts between 2 files.\n"
 	 "usage: swap_layouts <path1> <path2>"},
 	{"migrate", lfs_setstripe_migrate, 0,
@@ -548,7 +571,7 @@ command_t cmdlist[] = {
 	 "usage: migrate [--mdt-count|-c] <stripe_count>\n"
 	 "		 [--mdt-hash|-H] <hash_type>\n"
 	 "               [--mdt-index|-m] <start_mdt_index>\n"
-	 "		 [--verbose|-v]\n"
+	 "		 [--verbose|-v] [--threads <n>]\n"
 	 "		 <directory>\n"
 	 "\tmdt:	MDTs to stripe over, if only one MDT is specified\n"
 	 "			it's the MDT index of first stripe\n"
@@ -556,6 +579,7 @@ command_t cmdlist[] = {
 	 "\tmdt_hash:	hash type of the striped directory. mdt types:\n"
 	 "			fnv_1a_64 FNV-1a hash algorithm (default)\n"
 	 "			all_char  sum of characters % MDT_COUNT\n"
+	 "			crush     consistent hash over the stripes\n"
 	 "\n"
 	 "migrate file objects from one OST "
 	 "layout\nto another (may be not safe with concurent writes).\n"
@@ -568,6 +592,7 @@ command_t cmdlist[] = {
 	 "		[--block|-b]\n"
 	 "		[--non-block|-n]\n"
 	 "		[--non-direct|-D]\n"
+	 "		[--threads <n>]\n"
 	 "		<file|directory>\n"
 	 "\tstripe_count:     number of OSTs to stripe a file over\n"
 	 "\tstripe_ost_index: index of the first OST to stripe a file over\n"
@@ -576,7 +601,8 @@ command_t cmdlist[] = {
 	 "\tost_indices:      OSTs to stripe over, in order\n"
 	 "\tblock:            wait for the operation to return before continuing\n"
 	 "\tnon-block:        do not wait for the operation to return\n"
-	 "\tnon-direct:       do not use direct I/O to copy file contents.\n"},
+	 "\tnon-direct:       do not use direct I/O to copy file contents.\n"
+	 "\tthreads:          number of streams copying the data of each file\n"},
 	{"mv", lfs_mv, 0,
 	 "To move directories between MDTs. This command is deprecated, "
 	 "use \"migrate\" instead.\n"
@@ -770,29 +796,200 @@ out:
 	return rc;
 }
 
-static int migrate_copy_data(int fd_src, int fd_dst, int (*check_file)(int))
+static size_t migrate_copy_bufsize(int fd_src)
 {
 	struct llapi_layout *layout;
-	size_t	 buf_size = 4 * 1024 * 1024;
-	void	*buf = NULL;
-	ssize_t	 rsize = -1;
-	ssize_t	 wsize = 0;
-	size_t	 rpos = 0;
-	size_t	 wpos = 0;
-	off_t	 bufoff = 0;
-	int	 rc;
+	size_t buf_size = 4 * 1024 * 1024;
 
 	layout = llapi_layout_get_by_fd(fd_src, 0);
 	if (layout != NULL) {
 		uint64_t stripe_size;
 
-		rc = llapi_layout_stripe_size_get(layout, &stripe_size);
-		if (rc == 0)
+		if (llapi_layout_stripe_size_get(layout, &stripe_size) == 0)
 			buf_size = stripe_size;
 
 		llapi_layout_free(layout);
 	}
 
+	return buf_size;
+}
+
+struct migrate_copy_args {
+	int		  mca_fd_src;
+	int		  mca_fd_dst;
+	int		(*mca_check_file)(int);
+	size_t		  mca_chunk;	/* bytes copied per pread/pwrite */
+	off_t		  mca_size;	/* source size when the copy started */
+	pthread_mutex_t	  mca_lock;	/* protects mca_next and mca_rc */
+	off_t		  mca_next;	/* offset of the next chunk to copy */
+	int		  mca_rc;	/* first error seen by any stream */
+};
+
+/* Copy the chunk at \a off. The read always asks for a full chunk so that
+ * the request stays aligned for O_DIRECT, only the tail of the file ends
+ * up short. */
+static int migrate_copy_chunk(struct migrate_copy_args *mca, void *buf,
+			      off_t off)
+{
+	size_t want = mca->mca_size - off;
+	size_t rpos = 0;
+	size_t wpos = 0;
+	ssize_t rc;
+
+	if (want > mca->mca_chunk)
+		want = mca->mca_chunk;
+
+	while (rpos < want) {
+		rc = pread(mca->mca_fd_src, buf + rpos, mca->mca_chunk - rpos,
+			   off + rpos);
+		if (rc < 0)
+			return -errno;
+		if (rc == 0)
+			break;
+		rpos += rc;
+	}
+
+	while (wpos < rpos) {
+		rc = pwrite(mca->mca_fd_dst, buf + wpos, rpos - wpos,
+			    off + wpos);
+		if (rc < 0)
+			return -errno;
+		wpos += rc;
+	}
+
+	return 0;
+}
+
+static void *migrate_copy_thread(void *arg)
+{
+	struct migrate_copy_args *mca = arg;
+	void *buf = NULL;
+	off_t off;
+	int rc;
+
+	rc = posix_memalign(&buf, getpagesize(), mca->mca_chunk);
+	if (rc != 0) {
+		rc = -rc;
+		goto out;
+	}
+
+	while (1) {
+		pthread_mutex_lock(&mca->mca_lock);
+		if (mca->mca_rc != 0 || mca->mca_next >= mca->mca_size) {
+			pthread_mutex_unlock(&mca->mca_lock);
+			break;
+		}
+		off = mca->mca_next;
+		mca->mca_next += mca->mca_chunk;
+		pthread_mutex_unlock(&mca->mca_lock);
+
+		if (mca->mca_check_file) {
+			rc = mca->mca_check_file(mca->mca_fd_src);
+			if (rc < 0)
+				break;
+		}
+
+		rc = migrate_copy_chunk(mca, buf, off);
+		if (rc < 0)
+			break;
+	}
+
+	free(buf);
+out:
+	if (rc < 0) {
+		pthread_mutex_lock(&mca->mca_lock);
+		if (mca->mca_rc == 0)
+			mca->mca_rc = rc;
+		pthread_mutex_unlock(&mca->mca_lock);
+	}
+
+	return NULL;
+}
+
+/* Copy the file with \a nthreads streams, each one handling whole chunks
+ * of the source so that several OST objects are read and written at once.
+ * The source cannot change under us: it is either group locked or covered
+ * by a lease that is checked before each chunk. */
+static int migrate_copy_data_parallel(int fd_src, int fd_dst,
+				      int (*check_file)(int), int nthreads)
+{
+	struct migrate_copy_args mca = {
+		.mca_fd_src = fd_src,
+		.mca_fd_dst = fd_dst,
+		.mca_check_file = check_file,
+	};
+	pthread_t *threads;
+	struct stat st;
+	off_t nchunks;
+	int started;
+	int rc;
+	int i;
+
+	if (fstat(fd_src, &st) < 0)
+		return -errno;
+
+	mca.mca_size = st.st_size;
+	/* small stripes would mean one RPC per pread, keep chunks large */
+	mca.mca_chunk = migrate_copy_bufsize(fd_src);
+	if (mca.mca_chunk < 4 * 1024 * 1024)
+		mca.mca_chunk = 4 * 1024 * 1024;
+
+	nchunks = (mca.mca_size + mca.mca_chunk - 1) / mca.mca_chunk;
+	if (nthreads > nchunks)
+		nthreads = nchunks ?: 1;
+
+	threads = calloc(nthreads, sizeof(*threads));
+	if (threads == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_init(&mca.mca_lock, NULL);
+
+	for (started = 0; started < nthreads; started++) {
+		rc = pthread_create(&threads[started], NULL,
+				    migrate_copy_thread, &mca);
+		if (rc != 0) {
+			pthread_mutex_lock(&mca.mca_lock);
+			if (mca.mca_rc == 0)
+				mca.mca_rc = -rc;
+			pthread_mutex_unlock(&mca.mca_lock);
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&mca.mca_lock);
+	free(threads);
+
+	rc = mca.mca_rc;
+	if (rc == 0) {
+		rc = fsync(fd_dst);
+		if (rc < 0)
+			rc = -errno;
+	}
+
+	return rc;
+}
+
+static int migrate_copy_data(int fd_src, int fd_dst, int (*check_file)(int),
+			     int nthreads)
+{
+	size_t	 buf_size;
+	void	*buf = NULL;
+	ssize_t	 rsize = -1;
+	ssize_t	 wsize = 0;
+	size_t	 rpos = 0;
+	size_t	 wpos = 0;
+	off_t	 bufoff = 0;
+	int	 rc;
+
+	if (nthreads > 1)
+		return migrate_copy_data_parallel(fd_src, fd_dst, check_file,
+						  nthreads);
+
+	buf_size = migrate_copy_bufsize(fd_src);
+
 	/* Use a page-aligned buffer for direct I/O */
 	rc = posix_memalign(&buf, getpagesize(), buf_size);
 	if (rc != 0)
@@ -855,7 +1052,7 @@ static int migrate_copy_timestamps(int fd, int fdv)
 	return -errno;
 }
 
-static int migrate_block(int fd, int fdv)
+static int migrate_block(int fd, int fdv, int nthreads)
 {
 	__u64	dv1;
 	int	gid;
@@ -881,7 +1078,7 @@ static int migrate_block(int fd, int fdv)
 		return rc;
 	}
 
-	rc = migrate_copy_data(fd, fdv, NULL);
+	rc = migrate_copy_data(fd, fdv, NULL, nthreads);
 	if (rc < 0) {
 		error_loc = "data copy failed";
 		goto out_unlock;
@@ -939,7 +1136,7 @@ static int check_lease(int fd)
 	return -EBUSY;
 }
 
-static int migrate_nonblock(int fd, int fdv)
+static int migrate_nonblock(int fd, int fdv, int nthreads)
 {
 	__u64	dv1;
 	__u64	dv2;
@@ -951,7 +1148,7 @@ static int migrate_nonblock(int fd, int fdv)
 		return rc;
 	}
 
-	rc = migrate_copy_data(fd, fdv, check_lease);
+	rc = migrate_copy_data(fd, fdv, check_lease, nthreads);
 	if (rc < 0) {
 		error_loc = "data copy failed";
 		return rc;
@@ -1091,7 +1288,7 @@ static int lfs_component_create(char *fname, int open_flags, mode_t open_mode,
 
 static int lfs_migrate(char *name, __u64 migration_flags,
 		       struct llapi_stripe_param *param,
-		       struct llapi_layout *layout)
+		       struct llapi_layout *layout, int nthreads)
 {
 	int fd = -1;
 	int fdv = -1;
@@ -1107,7 +1304,7 @@ static int lfs_migrate(char *name, __u64 migration_flags,
 		 * It is also the default mode, since we cannot distinguish
 		 * between a broken lease and a server that does not support
 		 * atomic swap/close (LU-6785) */
-		rc = migrate_block(fd, fdv);
+		rc = migrate_block(fd, fdv, nthreads);
 		goto out;
 	}
 
@@ -1117,7 +1314,7 @@ static int lfs_migrate(char *name, __u64 migration_flags,
 		goto out;
 	}
 
-	rc = migrate_nonblock(fd, fdv);
+	rc = migrate_nonblock(fd, fdv, nthreads);
 	if (rc < 0) {
 		llapi_lease_release(fd);
 		goto out;
@@ -1656,7 +1853,7 @@ static int mirror_extend_layout(char *name, struct llapi_layout *layout)
 		goto out;
 	}
 
-	rc = migrate_nonblock(fd, fdv);
+	rc = migrate_nonblock(fd, fdv, 1);
 	if (rc < 0) {
 		llapi_lease_release(fd);
 		goto out;
@@ -2143,6 +2340,7 @@ static void log_to_syslog(const char *in_path)
 struct lfs_setstripe_args {
 	unsigned long long	 lsa_comp_end;
 	unsigned long long	 lsa_stripe_size;
+	unsigned long long	 lsa_extension_size;
 	long long		 lsa_stripe_count;
 	long long		 lsa_stripe_off;
 	__u32			 lsa_comp_flags;
@@ -2338,6 +2536,16 @@ static int comp_args_to_layout(struct llapi_layout **composite,
 		return rc;
 	}
 
+	if (lsa->lsa_extension_size != 0) {
+		rc = llapi_layout_extension_size_set(layout,
+						     lsa->lsa_extension_size);
+		if (rc) {
+			fprintf(stderr, "Set extension size %llu failed: %s\n",
+				lsa->lsa_extension_size, strerror(errno));
+			return rc;
+		}
+	}
+
 	if (lsa->lsa_pool_name != NULL) {
 		rc = llapi_layout_pool_name_set(layout, lsa->lsa_pool_name);
 		if (rc) {
@@ -2477,6 +2685,10 @@ static int build_layout_from_yaml_node(struct cYAML *node,
 					lsa->lsa_stripe_count = node->cy_valueint;
 				} else if (!strcmp(string, "stripe_size")) {
 					lsa->lsa_stripe_size = node->cy_valueint;
+				} else if (!strcmp(string,
+						   "lcme_extension_size")) {
+					lsa->lsa_extension_size =
+						node->cy_valueint;
 				} else if (!strcmp(string, "stripe_offset")) {
 					lsa->lsa_stripe_off = node->cy_valueint;
 				} else if (!strcmp(string, "l_ost_idx")) {
@@ -2705,6 +2917,8 @@ enum {
 	LFS_MIRROR_STATE_OPT,
 	LFS_LAYOUT_COPY,
 	LFS_MIRROR_INDEX_OPT,
+	LFS_FIND_THREADS_OPT,
+	LFS_ORDERED_OPT,
 };
 
 /* functions */
@@ -2820,12 +3034,17 @@ static int lfs_setstripe_internal(int argc, char **argv,
 	{ .val = 'S',	.name = "stripe-size",	.has_arg = required_argument },
 	{ .val = 'S',	.name = "stripe_size",	.has_arg = required_argument },
 /* find	{ .val = 't',	.name = "type",		.has_arg = required_argument }*/
+	/* --threads is only valid in migrate mode */
+	{ .val = LFS_FIND_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument },
 /* dirstripe { .val = 'T', .name = "mdt-count", .has_arg = required_argument }*/
 /* find	{ .val = 'u',	.name = "uid",		.has_arg = required_argument }*/
 /* find	{ .val = 'U',	.name = "user",		.has_arg = required_argument }*/
 	/* --verbose is only valid in migrate mode */
 	{ .val = 'v',	.name = "verbose",	.has_arg = no_argument},
 	{ .val = 'y',	.name = "yaml",		.has_arg = required_argument },
+	{ .val = 'z',	.name = "extension-size",
+						.has_arg = required_argument },
 	{ .name = NULL } };
 
 	setstripe_args_init(&lsa);
@@ -2836,7 +3055,7 @@ static int lfs_setstripe_internal(int argc, char **argv,
 	snprintf(cmd, sizeof(cmd), "%s %s", progname, argv[0]);
 	progname = cmd;
 	while ((c = getopt_long(argc, argv,
-				"bc:dDE:f:H:i:I:m:N::no:p:L:s:S:vy:", long_opts,
+				"bc:dDE:f:H:i:I:m:N::no:p:L:s:S:vy:z:", long_opts,
 				NULL)) >= 0) {
 		size_units = 1;
 		switch (c) {
@@ -3198,10 +3417,35 @@ static int lfs_setstripe_internal(int argc, char **argv,
 			}
 			migrate_mdt_param.fp_verbose = VERBOSE_DETAIL;
 			break;
+		case LFS_FIND_THREADS_OPT:
+			if (!migrate_mode) {
+				fprintf(stderr,
+					"%s %s: --threads valid only for migrate command\n",
+					progname, argv[0]);
+				goto usage_error;
+			}
+			migrate_mdt_param.fp_threads = strtoul(optarg, &end, 0);
+			if (*end != '\0' || migrate_mdt_param.fp_threads == 0) {
+				fprintf(stderr, "%s %s: bad threads '%s'\n",
+					progname, argv[0], optarg);
+				goto usage_error;
+			}
+			break;
 		case 'y':
 			from_yaml = true;
 			template = optarg;
 			break;
+		case 'z':
+			result = llapi_parse_size(optarg,
+						  &lsa.lsa_extension_size,
+						  &size_units, 0);
+			if (result || lsa.lsa_extension_size == 0) {
+				fprintf(stderr,
+					"%s %s: invalid extension size '%s'\n",
+					progname, argv[0], optarg);
+				goto usage_error;
+			}
+			break;
 		default:
 			fprintf(stderr, "%s %s: unrecognized option '%s'\n",
 				progname, argv[0], argv[optind - 1]);
@@ -3489,7 +3733,8 @@ static int lfs_setstripe_internal(int argc, char **argv,
 			result = llapi_migrate_mdt(fname, &migrate_mdt_param);
 		} else if (migrate_mode) {
 			result = lfs_migrate(fname, migration_flags, param,
-					     layout);
+					     layout,
+					     migrate_mdt_param.fp_threads);
 		} else if (comp_set != 0) {
 			result = lfs_component_set(fname, comp_id,
 						   lsa.lsa_comp_flags,
@@ -3746,6 +3991,10 @@ static int lfs_find(int argc, char **argv)
 	{ .val = 'S',	.name = "stripe-size",	.has_arg = required_argument },
 	{ .val = 'S',	.name = "stripe_size",	.has_arg = required_argument },
 	{ .val = 't',	.name = "type",		.has_arg = required_argument },
+	{ .val = LFS_FIND_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument },
+	{ .val = LFS_ORDERED_OPT,
+			.name = "ordered",	.has_arg = no_argument },
 	{ .val = 'T',	.name = "mdt-count",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "uid",		.has_arg = required_argument },
 	{ .val = 'U',	.name = "user",		.has_arg = required_argument },
@@ -4144,6 +4393,18 @@ err_free:
 			break;
 		case 'P': /* we always print, this option is a no-op */
 			break;
+		case LFS_FIND_THREADS_OPT:
+			param.fp_threads = strtoul(optarg, &endptr, 0);
+			if (*endptr != '\0' || param.fp_threads == 0) {
+				fprintf(stderr, "error: bad threads '%s'\n",
+					optarg);
+				ret = -1;
+				goto err;
+			}
+			break;
+		case LFS_ORDERED_OPT:
+			param.fp_ordered = 1;
+			break;
 		case LFS_PROJID_OPT:
 			rc = name2projid(&param.fp_projid, optarg);
 			if (rc) {
@@ -4304,6 +4565,10 @@ static int lfs_getstripe_internal(int argc, char **argv,
 		.name = "mirror-index",		.has_arg = required_argument },
 	{ .val = LFS_MIRROR_ID_OPT,
 		.name = "mirror-id",		.has_arg = required_argument },
+	{ .val = LFS_FIND_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument },
+	{ .val = LFS_ORDERED_OPT,
+			.name = "ordered",	.has_arg = no_argument },
 	{ .val = 'c',	.name = "stripe-count",	.has_arg = no_argument },
 	{ .val = 'c',	.name = "stripe_count",	.has_arg = no_argument },
 /* find	{ .val = 'C',	.name = "ctime",	.has_arg = required_argument }*/
@@ -4595,6 +4860,17 @@ static int lfs_getstripe_internal(int argc, char **argv,
 		case 'r':
 			param->fp_recursive = 1;
 			break;
+		case LFS_FIND_THREADS_OPT:
+			param->fp_threads = strtoul(optarg, &end, 0);
+			if (*end != '\0' || param->fp_threads == 0) {
+				fprintf(stderr, "error: bad threads '%s'\n",
+					optarg);
+				return CMD_HELP;
+			}
+			break;
+		case LFS_ORDERED_OPT:
+			param->fp_ordered = 1;
+			break;
 		case 'R':
 			param->fp_raw = 1;
 			break;
@@ -4780,6 +5056,7 @@ enum mntdf_flags {
 	MNTDF_LAZY	= 0x0004,
 	MNTDF_VERBOSE	= 0x0008,
 	MNTDF_SHOW	= 0x0010,
+	MNTDF_SUMMARY	= 0x0020,
 };
 
 #define COOK(value)						\
@@ -5002,6 +5279,28 @@ static int mntdf(char *mntdir, char *fsname, char *pool, enum mntdf_flags flags,
 			       "Used", "Available", "Use%", "Mounted on");
 	}
 
+	/* A single statfs(), which the client sends to one MDT only when
+	 * the MDTs aggregate the usage of all the targets, instead of one
+	 * request per target. */
+	if (flags & MNTDF_SUMMARY) {
+		struct statfs sfs;
+
+		if (fstatfs(fd, &sfs) < 0) {
+			rc = -errno;
+			fprintf(stderr, "%s: cannot statfs '%s': %s\n",
+				progname, mntdir, strerror(errno));
+			close(fd);
+			return rc;
+		}
+
+		sum.os_blocks = (__u64)sfs.f_blocks * sfs.f_bsize;
+		sum.os_bfree = (__u64)sfs.f_bfree * sfs.f_bsize;
+		sum.os_bavail = (__u64)sfs.f_bavail * sfs.f_bsize;
+		sum.os_files = sfs.f_files;
+		sum.os_ffree = sfs.f_ffree;
+		ops = 0;
+	}
+
 	for (tp = types; tp->st_name != NULL; tp++) {
 		bool have_ost = false;
 
@@ -5558,10 +5857,11 @@ static int lfs_df(int argc, char **argv)
 	{ .val = 'i',	.name = "inodes",	.has_arg = no_argument },
 	{ .val = 'l',	.name = "lazy",		.has_arg = no_argument },
 	{ .val = 'p',	.name = "pool",		.has_arg = required_argument },
+	{ .val = 's',	.name = "summary",	.has_arg = no_argument },
 	{ .val = 'v',	.name = "verbose",	.has_arg = no_argument },
 	{ .name = NULL} };
 
-	while ((c = getopt_long(argc, argv, "hilp:v", long_opts, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hilp:sv", long_opts, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			flags |= MNTDF_COOKED;
@@ -5575,6 +5875,9 @@ static int lfs_df(int argc, char **argv)
 		case 'p':
 			pool_name = optarg;
 			break;
+		case 's':
+			flags |= MNTDF_SUMMARY;
+			break;
 		case 'v':
 			flags |= MNTDF_VERBOSE;
 			break;
@@ -5582,6 +5885,11 @@ static int lfs_df(int argc, char **argv)
 			return CMD_HELP;
 		}
 	}
+	if ((flags & MNTDF_SUMMARY) && pool_name != NULL) {
+		fprintf(stderr, "%s df: --summary cannot be used with --pool\n",
+			progname);
+		return CMD_HELP;
+	}
 	if (optind < argc && !realpath(argv[optind], path)) {
 		rc = -errno;
 		fprintf(stderr, "error: invalid path '%s': %s\n",
@@ -6876,16 +7184,44 @@ static int lfs_flushctx(int argc, char **argv)
         return rc;
 }
 
+/* parse a comma separated list of changelog record types into a mask */
+static int lfs_changelog_type_mask(char *list, __u64 *mask)
+{
+	char *name;
+	int type;
+
+	*mask = 0;
+	while ((name = strsep(&list, ",")) != NULL) {
+		for (type = 0; type < CL_LAST; type++) {
+			if (strcasecmp(name, changelog_type2str(type)) == 0)
+				break;
+		}
+		if (type == CL_LAST)
+			return -EINVAL;
+		*mask |= 1ULL << type;
+	}
+
+	return 0;
+}
+
 static int lfs_changelog(int argc, char **argv)
 {
 	void *changelog_priv;
 	struct changelog_rec *rec;
+	struct changelog_filter filter = { 0 };
+	bool filtered = false;
 	long long startrec = 0, endrec = 0;
 	char *mdd;
+	char *end;
 	struct option long_opts[] = {
+		{ .val = 'F', .name = "fid", .has_arg = required_argument },
 		{ .val = 'f', .name = "follow", .has_arg = no_argument },
+		{ .val = 'j', .name = "jobid", .has_arg = required_argument },
+		{ .val = 'p', .name = "partition",
+						.has_arg = required_argument },
+		{ .val = 't', .name = "type", .has_arg = required_argument },
 		{ .name = NULL } };
-	char short_opts[] = "f";
+	char short_opts[] = "F:fj:p:t:";
 	int rc, follow = 0;
 
 	while ((rc = getopt_long(argc, argv, short_opts,
@@ -6894,6 +7230,54 @@ static int lfs_changelog(int argc, char **argv)
                 case 'f':
                         follow++;
                         break;
+		case 'F':
+			while (*optarg == '[')
+				optarg++;
+			if (sscanf(optarg, SFID, RFID(&filter.cf_fid)) != 3) {
+				fprintf(stderr,
+					"%s changelog: invalid FID '%s'\n",
+					progname, optarg);
+				return CMD_HELP;
+			}
+			filtered = true;
+			break;
+		case 'j':
+			if (strlen(optarg) >= sizeof(filter.cf_jobid)) {
+				fprintf(stderr,
+					"%s changelog: jobid '%s' too long\n",
+					progname, optarg);
+				return CMD_HELP;
+			}
+			strncpy(filter.cf_jobid, optarg,
+				sizeof(filter.cf_jobid) - 1);
+			filtered = true;
+			break;
+		case 'p':
+			errno = 0;
+			filter.cf_part_index = strtoul(optarg, &end, 0);
+			if (errno == 0 && *end == '/')
+				filter.cf_part_count = strtoul(end + 1, &end,
+							       0);
+			if (errno != 0 || *end != '\0' ||
+			    filter.cf_part_count == 0 ||
+			    filter.cf_part_index >= filter.cf_part_count) {
+				fprintf(stderr,
+					"%s changelog: invalid partition '%s', must be INDEX/COUNT\n",
+					progname, optarg);
+				return CMD_HELP;
+			}
+			filtered = true;
+			break;
+		case 't':
+			if (lfs_changelog_type_mask(optarg,
+						    &filter.cf_type_mask)) {
+				fprintf(stderr,
+					"%s changelog: invalid record type in '%s'\n",
+					progname, optarg);
+				return CMD_HELP;
+			}
+			filtered = true;
+			break;
                 default:
 			fprintf(stderr,
 				"%s changelog: unrecognized option '%s'\n",
@@ -6937,6 +7321,17 @@ static int lfs_changelog(int argc, char **argv)
 		return rc;
 	}
 
+	if (filtered) {
+		rc = llapi_changelog_set_filter(changelog_priv, &filter);
+		if (rc < 0) {
+			fprintf(stderr,
+				"%s changelog: cannot set filter: %s\n",
+				progname, strerror(errno = -rc));
+			llapi_changelog_fini(&changelog_priv);
+			return rc;
+		}
+	}
+
 	while ((rc = llapi_changelog_recv(changelog_priv, &rec)) == 0) {
 		time_t secs;
 		struct tm ts;
@@ -7913,6 +8308,74 @@ static int lfs_hsm_cancel(int argc, char **argv)
 	return lfs_hsm_request(argc, argv, HUA_CANCEL);
 }
 
+static int lfs_pcc_attach(int argc, char **argv)
+{
+	struct option long_opts[] = {
+	{ .val = 'i',	.name = "id",		.has_arg = required_argument },
+	{ .name = NULL } };
+	unsigned long id = 0;
+	char *end;
+	int rc = 0;
+	int rc2;
+	int c;
+
+	optind = 0;
+	while ((c = getopt_long(argc, argv, "i:", long_opts, NULL)) != -1) {
+		switch (c) {
+		case 'i':
+			errno = 0;
+			id = strtoul(optarg, &end, 0);
+			if (errno != 0 || *end != '\0' || id == 0 ||
+			    id > UINT32_MAX) {
+				fprintf(stderr, "%s: invalid archive ID '%s'\n",
+					argv[0], optarg);
+				return CMD_HELP;
+			}
+			break;
+		default:
+			return CMD_HELP;
+		}
+	}
+
+	if (id == 0 || optind >= argc)
+		return CMD_HELP;
+
+	for (; optind < argc; optind++) {
+		rc2 = llapi_pcc_attach(argv[optind], id);
+		if (rc2 < 0) {
+			fprintf(stderr, "%s: cannot attach '%s' to cache %lu: "
+				"%s\n", argv[0], argv[optind], id,
+				strerror(-rc2));
+			if (rc == 0)
+				rc = rc2;
+		}
+	}
+
+	return rc;
+}
+
+static int lfs_pcc_detach(int argc, char **argv)
+{
+	int rc = 0;
+	int rc2;
+	int i;
+
+	if (argc < 2)
+		return CMD_HELP;
+
+	for (i = 1; i < argc; i++) {
+		rc2 = llapi_pcc_detach(argv[i]);
+		if (rc2 < 0) {
+			fprintf(stderr, "%s: cannot detach '%s': %s\n",
+				argv[0], argv[i], strerror(-rc2));
+			if (rc == 0)
+				rc = rc2;
+		}
+	}
+
+	return rc;
+}
+
 static int lfs_swap_layouts(int argc, char **argv)
 {
 	if (argc != 3)
@@ -8829,20 +9292,83 @@ close_fd:
 	return rc;
 }
 
+struct mirror_write_args {
+	int		 mwa_fd;	/* own open file, see mirror_write_all() */
+	__u16		 mwa_id;
+	const void	*mwa_buf;
+	size_t		 mwa_count;
+	off_t		 mwa_pos;
+	ssize_t		 mwa_written;
+};
+
+static void *mirror_write_thread(void *arg)
+{
+	struct mirror_write_args *mwa = arg;
+
+	mwa->mwa_written = llapi_mirror_write(mwa->mwa_fd, mwa->mwa_id,
+					      mwa->mwa_buf, mwa->mwa_count,
+					      mwa->mwa_pos);
+	return NULL;
+}
+
+/*
+ * Write the same @count bytes at @pos to the @nr mirrors of @mwa at the
+ * same time, one thread per mirror. Each mirror has its own open file as
+ * the designated mirror is a setting of the open file.
+ */
+static int mirror_write_all(struct mirror_write_args *mwa, pthread_t *threads,
+			    int nr, const void *buf, size_t count, off_t pos)
+{
+	int started;
+	int rc = 0;
+	int i;
+
+	for (started = 0; started < nr; started++) {
+		mwa[started].mwa_buf = buf;
+		mwa[started].mwa_count = count;
+		mwa[started].mwa_pos = pos;
+		mwa[started].mwa_written = 0;
+
+		rc = pthread_create(&threads[started], NULL,
+				    mirror_write_thread, &mwa[started]);
+		if (rc) {
+			rc = -rc;
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+		if (mwa[i].mwa_written < 0 && rc == 0)
+			rc = mwa[i].mwa_written;
+	}
+
+	return rc;
+}
+
 static inline int lfs_mirror_write(int argc, char **argv)
 {
 	int rc = CMD_HELP;
 	__u16 mirror_id = 0;
+	__u16 ids[128] = { 0 };
+	int count = 1;
+	bool write_all = false;
+	struct llapi_resync_comp comp_array[1024] = { { 0 } };
+	int comp_size = 0;
+	struct mirror_write_args *mwa = NULL;
+	pthread_t *threads = NULL;
 	const char *inputfile = NULL;
 	char *fname;
 	int fd = 0;
 	int inputfd;
 	int c;
-	void *buf;
+	int i;
+	void *buf = NULL;
 	const size_t buflen = 4 << 20;
 	off_t pos;
 	size_t page_size = sysconf(_SC_PAGESIZE);
-	struct ll_ioc_lease_id ioc;
+	struct ll_ioc_lease *ioc = NULL;
+	struct ll_ioc_lease_id *resync_ioc;
 
 	struct option long_opts[] = {
 	{ .val = 'N',	.name = "mirror-id",	.has_arg = required_argument },
@@ -8854,6 +9380,11 @@ static inline int lfs_mirror_write(int argc, char **argv)
 
 		switch (c) {
 		case 'N':
+			if (!strcmp(optarg, "-1")) {
+				/* write all mirrors at once */
+				write_all = true;
+				break;
+			}
 			mirror_id = strtoul(optarg, &end, 0);
 			if (*end != '\0' || mirror_id == 0) {
 				fprintf(stderr,
@@ -8881,7 +9412,7 @@ static inline int lfs_mirror_write(int argc, char **argv)
 		return rc;
 	}
 
-	if (mirror_id == 0) {
+	if (mirror_id == 0 && !write_all) {
 		fprintf(stderr, "%s %s: no valid mirror ID is provided\n",
 			progname, argv[0]);
 		return rc;
@@ -8909,13 +9440,45 @@ static inline int lfs_mirror_write(int argc, char **argv)
 		return rc;
 	}
 
-	/* verify mirror id */
-	rc = verify_mirror_id_by_fd(fd, mirror_id);
-	if (rc) {
-		fprintf(stderr,
-			"%s %s: cannot find mirror with ID %u in '%s'\n",
-			progname, argv[0], mirror_id, fname);
-		goto close_fd;
+	if (write_all) {
+		struct collect_ids_data cid = { .cid_ids = ids,
+						.cid_count = 0,
+						.cid_exclude = 0, };
+		struct llapi_layout *layout;
+
+		layout = llapi_layout_get_by_fd(fd, 0);
+		if (layout == NULL) {
+			fprintf(stderr,
+				"%s %s: failed to get layout of '%s': %s\n",
+				progname, argv[0], fname, strerror(errno));
+			rc = -errno;
+			goto close_fd;
+		}
+
+		rc = llapi_layout_comp_iterate(layout, collect_mirror_id, &cid);
+		/* every mirror is rewritten, so all stale ones get in sync */
+		if (rc >= 0)
+			comp_size = llapi_mirror_find_stale(layout, comp_array,
+						ARRAY_SIZE(comp_array), NULL, 0);
+		llapi_layout_free(layout);
+		if (rc < 0 || comp_size < 0 || cid.cid_count == 0) {
+			fprintf(stderr,
+				"%s %s: failed to get mirrors of '%s'\n",
+				progname, argv[0], fname);
+			rc = rc < 0 ? rc : comp_size < 0 ? comp_size : -EINVAL;
+			goto close_fd;
+		}
+		count = cid.cid_count;
+	} else {
+		/* verify mirror id */
+		rc = verify_mirror_id_by_fd(fd, mirror_id);
+		if (rc) {
+			fprintf(stderr,
+				"%s %s: cannot find mirror with ID %u in '%s'\n",
+				progname, argv[0], mirror_id, fname);
+			goto close_fd;
+		}
+		ids[0] = mirror_id;
 	}
 
 	/* open input file */
@@ -8939,11 +9502,22 @@ static inline int lfs_mirror_write(int argc, char **argv)
 		goto close_inputfd;
 	}
 
-	/* prepare target mirror components instantiation */
-	ioc.lil_mode = LL_LEASE_WRLCK;
-	ioc.lil_flags = LL_LEASE_RESYNC;
-	ioc.lil_mirror_id = mirror_id;
-	rc = llapi_lease_set(fd, (struct ll_ioc_lease *)&ioc);
+	ioc = calloc(sizeof(*ioc) + sizeof(__u32) * 4096, 1);
+	if (ioc == NULL) {
+		fprintf(stderr,
+			"%s %s: cannot alloc comp id array for ioc: %s\n",
+			progname, argv[0], strerror(errno));
+		rc = -errno;
+		goto free_buf;
+	}
+
+	/* prepare target mirror components instantiation, or those of all
+	 * mirrors if they are all written */
+	resync_ioc = (struct ll_ioc_lease_id *)ioc;
+	resync_ioc->lil_mode = LL_LEASE_WRLCK;
+	resync_ioc->lil_flags = LL_LEASE_RESYNC;
+	resync_ioc->lil_mirror_id = mirror_id;
+	rc = llapi_lease_set(fd, ioc);
 	if (rc < 0) {
 		fprintf(stderr,
 			"%s %s: '%s' llapi_lease_get_ext failed: %s\n",
@@ -8951,6 +9525,31 @@ static inline int lfs_mirror_write(int argc, char **argv)
 		goto free_buf;
 	}
 
+	if (write_all) {
+		mwa = calloc(count, sizeof(*mwa));
+		threads = calloc(count, sizeof(*threads));
+		if (mwa == NULL || threads == NULL) {
+			rc = -ENOMEM;
+			goto free_buf;
+		}
+
+		for (i = 0; i < count; i++)
+			mwa[i].mwa_fd = -1;
+
+		for (i = 0; i < count; i++) {
+			mwa[i].mwa_id = ids[i];
+			mwa[i].mwa_fd = open(fname, O_DIRECT | O_WRONLY);
+			if (mwa[i].mwa_fd < 0) {
+				fprintf(stderr,
+					"%s %s: cannot open '%s': %s\n",
+					progname, argv[0], fname,
+					strerror(errno));
+				rc = -errno;
+				goto free_buf;
+			}
+		}
+	}
+
 	pos = 0;
 	while (1) {
 		ssize_t bytes_read;
@@ -8982,6 +9581,20 @@ static inline int lfs_mirror_write(int argc, char **argv)
 		/* round up to page align to make direct IO happy. */
 		to_write = (bytes_read + page_size - 1) & ~(page_size - 1);
 
+		if (write_all) {
+			rc = mirror_write_all(mwa, threads, count, buf,
+					      to_write, pos);
+			if (rc < 0) {
+				fprintf(stderr,
+					"%s %s: fail to write to mirrors: %s\n",
+					progname, argv[0], strerror(-rc));
+				goto free_buf;
+			}
+
+			pos += bytes_read;
+			continue;
+		}
+
 		written = llapi_mirror_write(fd, mirror_id, buf, to_write,
 					     pos);
 		if (written < 0) {
@@ -8996,16 +9609,23 @@ static inline int lfs_mirror_write(int argc, char **argv)
 		pos += bytes_read;
 	}
 
-	if (pos & (page_size - 1)) {
-		rc = llapi_mirror_truncate(fd, mirror_id, pos);
+	/* the mirrors only hold the same data if they end at the same place */
+	for (i = 0; i < count; i++) {
+		if (!write_all && !(pos & (page_size - 1)))
+			break;
+
+		rc = llapi_mirror_truncate(fd, ids[i], pos);
 		if (rc < 0)
 			goto free_buf;
 	}
 
-	ioc.lil_mode = LL_LEASE_UNLCK;
-	ioc.lil_flags = LL_LEASE_RESYNC_DONE;
-	ioc.lil_count = 0;
-	rc = llapi_lease_set(fd, (struct ll_ioc_lease *)&ioc);
+	ioc->lil_mode = LL_LEASE_UNLCK;
+	ioc->lil_flags = LL_LEASE_RESYNC_DONE;
+	ioc->lil_count = 0;
+	for (i = 0; i < comp_size; i++)
+		ioc->lil_ids[ioc->lil_count++] = comp_array[i].lrc_id;
+
+	rc = llapi_lease_set(fd, ioc);
 	if (rc <= 0) {
 		if (rc == 0)
 			rc = -EBUSY;
@@ -9018,6 +9638,15 @@ static inline int lfs_mirror_write(int argc, char **argv)
 	rc = 0;
 
 free_buf:
+	if (mwa != NULL) {
+		for (i = 0; i < count; i++) {
+			if (mwa[i].mwa_fd >= 0)
+				close(mwa[i].mwa_fd);
+		}
+		free(mwa);
+	}
+	free(threads);
+	free(ioc);
 	free(buf);
 close_inputfd:
 	if (inputfile)
@@ -93,6 +93,8 @@ struct options {
 	int			 o_report_int;
 	unsigned long long	 o_bandwidth;
 	size_t			 o_chunk_size;
+	int			 o_copy_threads;
+	int			 o_io_max;
 	enum ct_action		 o_action;
 	char			*o_event_fifo;
 	char			*o_mnt;
@@ -110,6 +112,7 @@ struct options opt = {
 	.o_copy_xattrs = 1,
 	.o_report_int = REPORT_INTERVAL_DEFAULT,
 	.o_chunk_size = ONE_MB,
+	.o_copy_threads = 1,
 };
 
 /* hsm_copytool_private will hold an open FD on the lustre mount point
@@ -127,6 +130,11 @@ static char fs_name[MAX_OBD_NAME + 1];
 
 static struct hsm_copytool_private *ctdata;
 
+/* number of chunks being copied by all the actions, see ct_io_get() */
+static pthread_mutex_t ct_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ct_io_cond = PTHREAD_COND_INITIALIZER;
+static int ct_io_count;
+
 static inline double ct_now(void)
 {
 	struct timeval tv;
@@ -198,8 +206,13 @@ static void usage(const char *name, int rc)
 	"   -c, --chunk-size <sz>     I/O size used during data copy\n"
 	"                             (unit can be used, default is MB)\n"
 	"   -f, --event-fifo <path>   Write events stream to fifo\n"
+	"   -I, --max-io <n>          Maximum number of chunks copied at the\n"
+	"                             same time by all the actions\n"
+	"                             (default is 0, no limit)\n"
 	"   -p, --hsm-root <path>     Target HSM mount point\n"
 	"   -q, --quiet               Produce less verbose output\n"
+	"   -t, --copy-threads <n>    Number of threads copying the data of\n"
+	"                             a file (default is 1)\n"
 	"   -u, --update-interval <s> Interval between progress reports sent\n"
 	"                             to Coordinator\n"
 	"   -v, --verbose             Produce more verbose output\n",
@@ -227,6 +240,7 @@ static int ct_parseopts(int argc, char * const *argv)
 	  .flag = &opt.o_dry_run },
 	{ .val = 'h',	.name = "help",		.has_arg = no_argument },
 	{ .val = 'i',	.name = "import",	.has_arg = no_argument },
+	{ .val = 'I',	.name = "max-io",	.has_arg = required_argument },
 	{ .val = 'M',	.name = "max-sequence",	.has_arg = no_argument },
 	{ .val = 'M',	.name = "max_sequence",	.has_arg = no_argument },
 	{ .val = 0,	.name = "no-attr",	.has_arg = no_argument,
@@ -245,6 +259,7 @@ static int ct_parseopts(int argc, char * const *argv)
 	{ .val = 'p',	.name = "hsm_root",	.has_arg = required_argument },
 	{ .val = 'q',	.name = "quiet",	.has_arg = no_argument },
 	{ .val = 'r',	.name = "rebind",	.has_arg = no_argument },
+	{ .val = 't',	.name = "copy-threads",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "update-interval",
 						.has_arg = required_argument },
 	{ .val = 'u',	.name = "update_interval",
@@ -265,7 +280,7 @@ static int ct_parseopts(int argc, char * const *argv)
 	if (opt.o_archive_id == NULL)
 		return -ENOMEM;
 repeat:
-	while ((c = getopt_long(argc, argv, "A:b:c:f:hiMp:qru:v",
+	while ((c = getopt_long(argc, argv, "A:b:c:f:hI:iMp:qrt:u:v",
 				long_opts, NULL)) != -1) {
 		switch (c) {
 		case 'A': {
@@ -334,6 +349,15 @@ repeat:
 			break;
 		case 'h':
 			usage(argv[0], 0);
+		case 'I':
+			opt.o_io_max = atoi(optarg);
+			if (opt.o_io_max < 0) {
+				rc = -EINVAL;
+				CT_ERROR(rc, "bad value for -%c '%s'", c,
+					 optarg);
+				return rc;
+			}
+			break;
 		case 'i':
 			opt.o_action = CA_IMPORT;
 			break;
@@ -349,6 +373,15 @@ repeat:
 		case 'r':
 			opt.o_action = CA_REBIND;
 			break;
+		case 't':
+			opt.o_copy_threads = atoi(optarg);
+			if (opt.o_copy_threads < 1) {
+				rc = -EINVAL;
+				CT_ERROR(rc, "bad value for -%c '%s'", c,
+					 optarg);
+				return rc;
+			}
+			break;
 		case 'u':
 			opt.o_report_int = atoi(optarg);
 			if (opt.o_report_int < 0) {
@@ -571,6 +604,331 @@ static int ct_restore_stripe(const char *src, const char *dst, int dst_fd,
 	return rc;
 }
 
+/* wait until a chunk can be copied without going over opt.o_io_max, which
+ * limits the I/O of all the actions and of all their copy threads */
+static void ct_io_get(void)
+{
+	if (opt.o_io_max == 0)
+		return;
+
+	pthread_mutex_lock(&ct_io_lock);
+	while (ct_io_count >= opt.o_io_max)
+		pthread_cond_wait(&ct_io_cond, &ct_io_lock);
+	ct_io_count++;
+	pthread_mutex_unlock(&ct_io_lock);
+}
+
+/* the copy of a chunk is over, errno is kept for the caller */
+static void ct_io_put(void)
+{
+	int err = errno;
+
+	if (opt.o_io_max == 0)
+		return;
+
+	pthread_mutex_lock(&ct_io_lock);
+	ct_io_count--;
+	pthread_cond_signal(&ct_io_cond);
+	pthread_mutex_unlock(&ct_io_lock);
+	errno = err;
+}
+
+/* sleep if needed, to honor bandwidth limits */
+static void ct_bandwidth_sleep(time_t start_time, __u64 write_total,
+			       time_t *last_bw_print)
+{
+	unsigned long long	write_theory;
+	unsigned long long	excess;
+	struct timespec		delay;
+	time_t			now;
+	int			rc;
+
+	if (opt.o_bandwidth == 0)
+		return;
+
+	now = time(NULL);
+	write_theory = (now - start_time) * opt.o_bandwidth;
+	if (write_theory >= write_total)
+		return;
+
+	excess = write_total - write_theory;
+
+	delay.tv_sec = excess / opt.o_bandwidth;
+	delay.tv_nsec = (excess % opt.o_bandwidth) *
+		NSEC_PER_SEC / opt.o_bandwidth;
+
+	if (now >= *last_bw_print + opt.o_report_int) {
+		CT_TRACE("bandwith control: %lluB/s "
+			 "excess=%llu sleep for "
+			 "%lld.%09lds",
+			 (unsigned long long)opt.o_bandwidth,
+			 (unsigned long long)excess,
+			 (long long)delay.tv_sec,
+			 delay.tv_nsec);
+		*last_bw_print = now;
+	}
+
+	do {
+		rc = nanosleep(&delay, &delay);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0)
+		CT_ERROR(errno, "delay for bandwidth "
+			 "control failed to sleep: "
+			 "residual=%lld.%09lds",
+			 (long long)delay.tv_sec,
+			 delay.tv_nsec);
+}
+
+/* copy of the data of a file shared by the threads of ct_copy_streams() */
+struct ct_copy {
+	const char	*cc_src;
+	const char	*cc_dst;
+	int		 cc_src_fd;
+	int		 cc_dst_fd;
+	time_t		 cc_start_time;
+	/* protects the fields below and the ccs_done of the streams */
+	pthread_mutex_t	 cc_lock;
+	/* signaled when a stream is over */
+	pthread_cond_t	 cc_cond;
+	/* bytes copied by all the streams, for bandwidth control */
+	__u64		 cc_total;
+	/* streams still copying */
+	int		 cc_running;
+	/* an error happened or the action was canceled, stop copying */
+	bool		 cc_abort;
+};
+
+/* one thread copying a range of the file, sequentially */
+struct ct_copy_stream {
+	struct ct_copy	*ccs_copy;
+	pthread_t	 ccs_thread;
+	__u64		 ccs_offset;
+	__u64		 ccs_length;
+	/* bytes copied from ccs_offset */
+	__u64		 ccs_done;
+	/* bytes from ccs_offset already sent as progress to the MDT */
+	__u64		 ccs_reported;
+	int		 ccs_rc;
+};
+
+static void *ct_copy_stream_thread(void *data)
+{
+	struct ct_copy_stream	*ccs = data;
+	struct ct_copy		*cc = ccs->ccs_copy;
+	time_t			 last_bw_print = cc->cc_start_time;
+	__u64			 done = 0;
+	__u64			 total;
+	bool			 abort = false;
+	char			*buf;
+	int			 rc = 0;
+
+	buf = malloc(opt.o_chunk_size);
+	if (buf == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	while (done < ccs->ccs_length && !abort) {
+		__u64	offset = ccs->ccs_offset + done;
+		ssize_t	rsize;
+		ssize_t	wsize;
+		int	chunk = (ccs->ccs_length - done > opt.o_chunk_size) ?
+				 opt.o_chunk_size : ccs->ccs_length - done;
+
+		ct_io_get();
+		rsize = pread(cc->cc_src_fd, buf, chunk, offset);
+		if (rsize <= 0) {
+			ct_io_put();
+			if (rsize == 0)
+				/* EOF */
+				break;
+
+			rc = -errno;
+			CT_ERROR(rc, "cannot read from '%s'", cc->cc_src);
+			break;
+		}
+
+		wsize = pwrite(cc->cc_dst_fd, buf, rsize, offset);
+		ct_io_put();
+		if (wsize < 0) {
+			rc = -errno;
+			CT_ERROR(rc, "cannot write to '%s'", cc->cc_dst);
+			break;
+		}
+
+		done += wsize;
+
+		pthread_mutex_lock(&cc->cc_lock);
+		ccs->ccs_done = done;
+		cc->cc_total += wsize;
+		total = cc->cc_total;
+		abort = cc->cc_abort;
+		pthread_mutex_unlock(&cc->cc_lock);
+
+		ct_bandwidth_sleep(cc->cc_start_time, total, &last_bw_print);
+	}
+
+	free(buf);
+out:
+	pthread_mutex_lock(&cc->cc_lock);
+	ccs->ccs_rc = rc;
+	if (rc < 0)
+		cc->cc_abort = true;
+	cc->cc_running--;
+	pthread_cond_signal(&cc->cc_cond);
+	pthread_mutex_unlock(&cc->cc_lock);
+
+	return NULL;
+}
+
+/* send the progress of the streams since their last report */
+static int ct_copy_streams_report(struct hsm_copyaction_private *hcp,
+				  struct ct_copy *cc,
+				  struct ct_copy_stream *streams, int nr,
+				  __u64 length)
+{
+	struct hsm_extent	he;
+	__u64			total;
+	int			rc;
+	int			i;
+
+	pthread_mutex_lock(&cc->cc_lock);
+	total = cc->cc_total;
+	pthread_mutex_unlock(&cc->cc_lock);
+	CT_TRACE("%%%ju ", (uintmax_t)(100 * total / length));
+
+	for (i = 0; i < nr; i++) {
+		struct ct_copy_stream *ccs = &streams[i];
+		__u64 done;
+
+		pthread_mutex_lock(&cc->cc_lock);
+		done = ccs->ccs_done;
+		pthread_mutex_unlock(&cc->cc_lock);
+
+		if (done == ccs->ccs_reported)
+			continue;
+
+		/* the extents of the streams are merged by the MDT */
+		he.offset = ccs->ccs_offset + ccs->ccs_reported;
+		he.length = done - ccs->ccs_reported;
+		rc = llapi_hsm_action_progress(hcp, &he, length, 0);
+		if (rc < 0)
+			return rc;
+		ccs->ccs_reported = done;
+	}
+
+	return 0;
+}
+
+/* copy \a length bytes from \a offset with opt.o_copy_threads threads, each
+ * one copying its own range so that it can be reported as a single extent */
+static int ct_copy_streams(struct hsm_copyaction_private *hcp,
+			   const char *src, const char *dst, int src_fd,
+			   int dst_fd, __u64 offset, __u64 length,
+			   time_t start_time)
+{
+	struct ct_copy		 cc = {
+		.cc_src		= src,
+		.cc_dst		= dst,
+		.cc_src_fd	= src_fd,
+		.cc_dst_fd	= dst_fd,
+		.cc_start_time	= start_time,
+	};
+	struct ct_copy_stream	*streams;
+	time_t			 last_report_time = start_time;
+	__u64			 range;
+	int			 nr = opt.o_copy_threads;
+	int			 started;
+	int			 rc = 0;
+	int			 i;
+
+	/* ranges are made of whole chunks */
+	range = (length + nr - 1) / nr;
+	range = (range + opt.o_chunk_size - 1) / opt.o_chunk_size *
+		opt.o_chunk_size;
+	nr = (length + range - 1) / range;
+
+	streams = calloc(nr, sizeof(*streams));
+	if (streams == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_init(&cc.cc_lock, NULL);
+	pthread_cond_init(&cc.cc_cond, NULL);
+
+	CT_TRACE("start copy of %ju bytes from '%s' to '%s' with %d threads",
+		 (uintmax_t)length, src, dst, nr);
+
+	for (started = 0; started < nr; started++) {
+		struct ct_copy_stream *ccs = &streams[started];
+
+		ccs->ccs_copy = &cc;
+		ccs->ccs_offset = offset + started * range;
+		ccs->ccs_length = started * range + range > length ?
+				  length - started * range : range;
+
+		pthread_mutex_lock(&cc.cc_lock);
+		cc.cc_running++;
+		pthread_mutex_unlock(&cc.cc_lock);
+
+		rc = pthread_create(&ccs->ccs_thread, NULL,
+				    ct_copy_stream_thread, ccs);
+		if (rc != 0) {
+			rc = -rc;
+			CT_ERROR(rc, "cannot create copy thread for '%s'",
+				 src);
+			pthread_mutex_lock(&cc.cc_lock);
+			cc.cc_running--;
+			cc.cc_abort = true;
+			pthread_mutex_unlock(&cc.cc_lock);
+			break;
+		}
+	}
+
+	pthread_mutex_lock(&cc.cc_lock);
+	while (cc.cc_running > 0) {
+		struct timespec	deadline;
+		time_t		now = time(NULL);
+
+		deadline.tv_sec = (opt.o_report_int > 0 ?
+				   last_report_time + opt.o_report_int :
+				   now + 1);
+		deadline.tv_nsec = 0;
+		pthread_cond_timedwait(&cc.cc_cond, &cc.cc_lock, &deadline);
+		if (cc.cc_running == 0 || cc.cc_abort)
+			continue;
+
+		now = time(NULL);
+		if (now < last_report_time + opt.o_report_int)
+			continue;
+		last_report_time = now;
+
+		pthread_mutex_unlock(&cc.cc_lock);
+		rc = ct_copy_streams_report(hcp, &cc, streams, started,
+					    length);
+		pthread_mutex_lock(&cc.cc_lock);
+		if (rc < 0) {
+			/* Action has been canceled or something wrong
+			 * is happening. Stop copying data. */
+			CT_ERROR(rc, "progress ioctl for copy"
+				 " '%s'->'%s' failed", src, dst);
+			cc.cc_abort = true;
+		}
+	}
+	pthread_mutex_unlock(&cc.cc_lock);
+
+	for (i = 0; i < started; i++) {
+		pthread_join(streams[i].ccs_thread, NULL);
+		if (rc == 0)
+			rc = streams[i].ccs_rc;
+	}
+
+	pthread_cond_destroy(&cc.cc_cond);
+	pthread_mutex_destroy(&cc.cc_lock);
+	free(streams);
+
+	return rc;
+}
+
 static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 			const char *dst, int src_fd, int dst_fd,
 			const struct hsm_action_item *hai, long hal_flags)
@@ -640,6 +998,12 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 		goto out;
 	}
 
+	if (opt.o_copy_threads > 1 && length > opt.o_chunk_size) {
+		rc = ct_copy_streams(hcp, src, dst, src_fd, dst_fd, offset,
+				     length, start_time);
+		goto out;
+	}
+
 	errno = 0;
 
 	buf = malloc(opt.o_chunk_size);
@@ -657,18 +1021,21 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 		int	chunk = (length - write_total > opt.o_chunk_size) ?
 				 opt.o_chunk_size : length - write_total;
 
+		ct_io_get();
 		rsize = pread(src_fd, buf, chunk, offset);
-		if (rsize == 0)
-			/* EOF */
-			break;
+		if (rsize <= 0) {
+			ct_io_put();
+			if (rsize == 0)
+				/* EOF */
+				break;
 
-		if (rsize < 0) {
 			rc = -errno;
 			CT_ERROR(rc, "cannot read from '%s'", src);
 			break;
 		}
 
 		wsize = pwrite(dst_fd, buf, rsize, offset);
+		ct_io_put();
 		if (wsize < 0) {
 			rc = -errno;
 			CT_ERROR(rc, "cannot write to '%s'", dst);
@@ -678,47 +1045,7 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 		write_total += wsize;
 		offset += wsize;
 
-		now = time(NULL);
-		/* sleep if needed, to honor bandwidth limits */
-		if (opt.o_bandwidth != 0) {
-			unsigned long long write_theory;
-
-			write_theory = (now - start_time) * opt.o_bandwidth;
-
-			if (write_theory < write_total) {
-				unsigned long long	excess;
-				struct timespec		delay;
-
-				excess = write_total - write_theory;
-
-				delay.tv_sec = excess / opt.o_bandwidth;
-				delay.tv_nsec = (excess % opt.o_bandwidth) *
-					NSEC_PER_SEC / opt.o_bandwidth;
-
-				if (now >= last_bw_print + opt.o_report_int) {
-					CT_TRACE("bandwith control: %lluB/s "
-						 "excess=%llu sleep for "
-						 "%lld.%09lds",
-						 (unsigned long long)opt.o_bandwidth,
-						 (unsigned long long)excess,
-						 (long long)delay.tv_sec,
-						 delay.tv_nsec);
-					last_bw_print = now;
-				}
-
-				do {
-					rc = nanosleep(&delay, &delay);
-				} while (rc < 0 && errno == EINTR);
-				if (rc < 0) {
-					CT_ERROR(errno, "delay for bandwidth "
-						 "control failed to sleep: "
-						 "residual=%lld.%09lds",
-						 (long long)delay.tv_sec,
-						 delay.tv_nsec);
-					rc = 0;
-				}
-			}
-		}
+		ct_bandwidth_sleep(start_time, write_total, &last_bw_print);
 
 		now = time(NULL);
 		if (now >= last_report_time + opt.o_report_int) {
@@ -58,6 +58,8 @@
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <sys/xattr.h>
 #include <sys/sysmacros.h>
 #include <time.h>
@@ -86,7 +88,8 @@ const char *liblustreapi_cmd;
 
 char *mdt_hash_name[] = { "none",
 			  LMV_HASH_NAME_ALL_CHARS,
-			  LMV_HASH_NAME_FNV_1A_64 };
+			  LMV_HASH_NAME_FNV_1A_64,
+			  LMV_HASH_NAME_CRUSH };
 
 void llapi_msg_set_level(int level)
 {
@@ -1971,13 +1974,270 @@ static int get_lmd_info(char *path, DIR *parent, DIR *dir, void *lmdbuf,
 	return get_lmd_info_fd(path, parent_fd, dir_fd, lmdbuf, lmdlen, type);
 }
 
+static int llapi_semantic_traverse(char *path, int size, DIR *parent,
+				   semantic_func_t sem_init,
+				   semantic_func_t sem_fini, void *data,
+				   struct dirent64 *de);
+
+/* processes a parallel traversal may still start, shared by all of them */
+static int *trav_slots;
+/* output segments of this process in ordered parallel traversal, in the order
+ * they are printed, the last one is on stdout */
+static int *trav_segs;
+static int trav_nsegs;
+static int trav_segs_size;
+
+/* children started by one directory of a parallel traversal */
+struct trav_children {
+	pid_t	*tc_pids;
+	int	 tc_count;
+	int	 tc_size;
+};
+
+static int semantic_traverse_start(struct find_param *param)
+{
+	void *slots;
+
+	if (param->fp_threads <= 1 || trav_slots != NULL)
+		return 0;
+
+	slots = mmap(NULL, sizeof(*trav_slots), PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (slots == MAP_FAILED)
+		return -errno;
+
+	trav_slots = slots;
+	*trav_slots = param->fp_threads - 1;
+
+	/* print the entries a whole at a time, see semantic_traverse_flush() */
+	fflush(stdout);
+	setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+
+	return 1;
+}
+
+static void semantic_traverse_stop(void)
+{
+	munmap(trav_slots, sizeof(*trav_slots));
+	trav_slots = NULL;
+}
+
+/* Keep the output of an entry from being mixed with another process. */
+static void semantic_traverse_flush(struct find_param *param)
+{
+	if (trav_slots != NULL && !param->fp_ordered)
+		fflush(stdout);
+}
+
+static int semantic_traverse_seg_reserve(int count)
+{
+	int *segs;
+
+	if (trav_nsegs + count <= trav_segs_size)
+		return 0;
+
+	segs = realloc(trav_segs, (trav_nsegs + count + 16) * sizeof(*segs));
+	if (segs == NULL)
+		return -ENOMEM;
+
+	trav_segs = segs;
+	trav_segs_size = trav_nsegs + count + 16;
+
+	return 0;
+}
+
+static int semantic_traverse_seg_open(void)
+{
+	FILE *seg;
+	int fd;
+
+	seg = tmpfile();
+	if (seg == NULL)
+		return -errno;
+
+	fd = dup(fileno(seg));
+	fclose(seg);
+
+	return fd < 0 ? -errno : fd;
+}
+
+/*
+ * Append the segments printed from segment \a first on to it, once the
+ * children printing them have exited, and print on it again. All the output
+ * is back on stdout when \a first is the first segment.
+ */
+static void semantic_traverse_merge(int first)
+{
+	char buf[8192];
+	ssize_t rd, wr;
+	int i;
+
+	if (trav_nsegs == 0)
+		return;
+
+	fflush(stdout);
+	for (i = first + 1; i < trav_nsegs; i++) {
+		lseek(trav_segs[i], 0, SEEK_SET);
+		while ((rd = read(trav_segs[i], buf, sizeof(buf))) > 0) {
+			char *ptr = buf;
+
+			while (rd > 0 &&
+			       (wr = write(trav_segs[first], ptr, rd)) > 0) {
+				ptr += wr;
+				rd -= wr;
+			}
+		}
+		close(trav_segs[i]);
+	}
+	trav_nsegs = first + 1;
+	dup2(trav_segs[first], STDOUT_FILENO);
+
+	if (first == 0) {
+		close(trav_segs[0]);
+		trav_nsegs = 0;
+	}
+}
+
+/*
+ * Wait for the children searching the subdirectories of a directory, return
+ * the first of their errors if any.
+ */
+static int semantic_traverse_wait(struct trav_children *tc)
+{
+	int status;
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < tc->tc_count; i++) {
+		int rc;
+
+		if (waitpid(tc->tc_pids[i], &status, 0) < 0)
+			rc = -errno;
+		else if (!WIFEXITED(status))
+			rc = -EINTR;
+		else
+			rc = -WEXITSTATUS(status);
+
+		if (rc != 0 && ret == 0)
+			ret = rc;
+	}
+
+	free(tc->tc_pids);
+	tc->tc_pids = NULL;
+	tc->tc_count = 0;
+	tc->tc_size = 0;
+
+	return ret;
+}
+
+/*
+ * Search subdirectory \a path in a child process, if less than
+ * param->fp_threads processes are walking the tree, or from here otherwise.
+ * Any process at any depth hands off its subdirectories as soon as another
+ * one has finished, so the processes get the work from each other until the
+ * whole tree is searched. They share nothing but the output, so the
+ * directories are looked up and their entries stat'ed in parallel, possibly
+ * from several MDTs. With param->fp_ordered, the output of a child goes to
+ * a temporary file and is printed in the order of a serial search, once the
+ * child exits.
+ */
+static int semantic_traverse_fork(char *path, int size, DIR *parent,
+				  semantic_func_t sem_init,
+				  semantic_func_t sem_fini, void *data,
+				  struct dirent64 *de, struct trav_children *tc)
+{
+	struct find_param *param = (struct find_param *)data;
+	int child_fd = -1;
+	int own_fd = -1;
+	pid_t pid;
+	int rc;
+
+	if (__sync_sub_and_fetch(trav_slots, 1) < 0)
+		goto release;
+
+	if (tc->tc_count == tc->tc_size) {
+		pid_t *pids;
+
+		pids = realloc(tc->tc_pids, (tc->tc_size + 8) * sizeof(*pids));
+		if (pids == NULL)
+			goto release;
+		tc->tc_pids = pids;
+		tc->tc_size += 8;
+	}
+
+	if (param->fp_ordered) {
+		if (semantic_traverse_seg_reserve(3) < 0)
+			goto release;
+
+		if (trav_nsegs == 0) {
+			trav_segs[0] = dup(STDOUT_FILENO);
+			if (trav_segs[0] < 0)
+				goto release;
+			trav_nsegs = 1;
+		}
+
+		child_fd = semantic_traverse_seg_open();
+		own_fd = semantic_traverse_seg_open();
+		if (child_fd < 0 || own_fd < 0)
+			goto release;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0)
+		goto release;
+
+	if (pid == 0) {
+		int i;
+
+		if (param->fp_ordered) {
+			for (i = 0; i < trav_nsegs; i++)
+				close(trav_segs[i]);
+			close(own_fd);
+			trav_segs[0] = child_fd;
+			trav_nsegs = 1;
+			dup2(child_fd, STDOUT_FILENO);
+		}
+
+		rc = llapi_semantic_traverse(path, size, parent, sem_init,
+					     sem_fini, data, de);
+		fflush(stdout);
+		fflush(stderr);
+		__sync_add_and_fetch(trav_slots, 1);
+		_exit(rc >= 0 ? 0 : rc < -255 ? 255 : -rc);
+	}
+
+	tc->tc_pids[tc->tc_count++] = pid;
+	if (param->fp_ordered) {
+		trav_segs[trav_nsegs++] = child_fd;
+		trav_segs[trav_nsegs++] = own_fd;
+		dup2(own_fd, STDOUT_FILENO);
+	}
+
+	return 0;
+
+release:
+	if (child_fd >= 0)
+		close(child_fd);
+	if (own_fd >= 0)
+		close(own_fd);
+	__sync_add_and_fetch(trav_slots, 1);
+
+	/* search it from here */
+	return llapi_semantic_traverse(path, size, parent, sem_init, sem_fini,
+				       data, de);
+}
+
 static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 				   semantic_func_t sem_init,
 				   semantic_func_t sem_fini, void *data,
 				   struct dirent64 *de)
 {
 	struct find_param *param = (struct find_param *)data;
+	struct trav_children children = { NULL };
 	struct dirent64 *dent;
+	int first_seg = trav_nsegs > 0 ? trav_nsegs - 1 : 0;
 	int len, ret;
 	DIR *d, *p = NULL;
 
@@ -2002,6 +2262,7 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 	if (sem_init && (ret = sem_init(path, parent ?: p, &d, data, de)))
 		goto err;
 
+	semantic_traverse_flush(param);
 	if (d == NULL)
 		goto out;
 
@@ -2041,8 +2302,15 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
                                           __func__, dent->d_name, dent->d_type);
                         break;
 		case DT_DIR:
-			rc = llapi_semantic_traverse(path, size, d, sem_init,
-						      sem_fini, data, dent);
+			if (trav_slots != NULL)
+				rc = semantic_traverse_fork(path, size, d,
+							    sem_init, sem_fini,
+							    data, dent,
+							    &children);
+			else
+				rc = llapi_semantic_traverse(path, size, d,
+							     sem_init, sem_fini,
+							     data, dent);
 			if (rc != 0 && ret == 0)
 				ret = rc;
 			break;
@@ -2057,14 +2325,25 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 			}
 			if (sem_fini && rc == 0)
 				sem_fini(path, d, NULL, data, dent);
+			semantic_traverse_flush(param);
                 }
         }
 
 out:
         path[len] = 0;
 
+	if (children.tc_count > 0) {
+		int rc = semantic_traverse_wait(&children);
+
+		if (rc != 0 && ret == 0)
+			ret = rc;
+	}
+	if (param->fp_ordered)
+		semantic_traverse_merge(first_seg);
+
 	if (sem_fini)
 		sem_fini(path, parent, &d, data, de);
+	semantic_traverse_flush(param);
 err:
         if (d)
                 closedir(d);
@@ -2077,6 +2356,7 @@ static int param_callback(char *path, semantic_func_t sem_init,
                           semantic_func_t sem_fini, struct find_param *param)
 {
         int ret, len = strlen(path);
+	int started;
         char *buf;
 
         if (len > PATH_MAX) {
@@ -2097,8 +2377,16 @@ static int param_callback(char *path, semantic_func_t sem_init,
 
 	param->fp_depth = 0;
 
+	started = semantic_traverse_start(param);
+	if (started < 0) {
+		ret = started;
+		goto out;
+	}
+
         ret = llapi_semantic_traverse(buf, PATH_MAX + 1, NULL, sem_init,
                                       sem_fini, param, NULL);
+	if (started)
+		semantic_traverse_stop();
 out:
         find_param_fini(param);
         free(buf);
@@ -3161,6 +3449,18 @@ static void lov_dump_comp_v1_entry(struct find_param *param,
 
 		separator = "\n";
 	}
+	/* print the growth step of an extension comp */
+	if ((verbose & VERBOSE_COMP_FLAGS) &&
+	    (entry->lcme_flags & LCME_FL_EXTENSION)) {
+		llapi_printf(LLAPI_MSG_NORMAL, "%s", separator);
+		if (verbose & ~VERBOSE_COMP_FLAGS)
+			llapi_printf(LLAPI_MSG_NORMAL,
+				     "%4slcme_extension_size: ", " ");
+		llapi_printf(LLAPI_MSG_NORMAL, "%llu",
+			     (unsigned long long)entry->lcme_extension_size *
+			     SEL_UNIT_SIZE);
+		separator = "\n";
+	}
 
 	if (verbose & VERBOSE_COMP_START) {
 		llapi_printf(LLAPI_MSG_NORMAL, "%s", separator);
@@ -37,6 +37,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 
 #include <lustre/lustreapi.h>
 #include <linux/lustre/lustre_ioctl.h>
@@ -58,10 +59,13 @@ static int chlg_dev_path(char *path, size_t path_len, const char *device)
 
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
 #define CHANGELOG_BUFFER_SZ  4096
+#define CHANGELOG_RING_SZ    (1 << 20)
 
 /**
  * Record state for efficient changelog consumption.
- * Read chunks of CHANGELOG_BUFFER_SZ bytes.
+ * Records are taken from a ring of CHANGELOG_RING_SZ bytes shared with the
+ * kernel, or read in chunks of CHANGELOG_BUFFER_SZ bytes when the kernel
+ * cannot map one.
  */
 struct changelog_private {
 	/* Ensure that the structure is valid and initialized */
@@ -72,6 +76,14 @@ struct changelog_private {
 	enum changelog_send_flag	 clp_send_flags;
 	/* Changelog extra flags */
 	enum changelog_send_extra_flag	 clp_send_extra_flags;
+	/* Ring shared with the kernel, see struct changelog_ring */
+	struct changelog_ring		*clp_ring;
+	size_t				 clp_ring_len;
+	/* Position of the next entry, and as last told to the kernel */
+	__u64				 clp_tail;
+	__u64				 clp_tail_shown;
+	/* Whether the ring was mapped, on the first record received */
+	bool				 clp_ring_tried;
 	/* Available bytes in buffer */
 	size_t				 clp_buf_len;
 	/* Current position in buffer */
@@ -113,8 +125,10 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 	cp->clp_buf_len = 0;
 	cp->clp_buf_pos = cp->clp_buf;
 
-	/* Set up the receiver */
-	cp->clp_fd = open(cdev_path, O_RDONLY);
+	/* Set up the receiver, writable to share a ring with the kernel */
+	cp->clp_fd = open(cdev_path, O_RDWR);
+	if (cp->clp_fd < 0)
+		cp->clp_fd = open(cdev_path, O_RDONLY);
 	if (cp->clp_fd < 0) {
 		rc = -errno;
 		goto out_free_cp;
@@ -176,12 +190,120 @@ int llapi_changelog_fini(void **priv)
 	if (!cp || (cp->clp_magic != CHANGELOG_PRIV_MAGIC))
 		return -EINVAL;
 
+	if (cp->clp_ring != NULL)
+		munmap(cp->clp_ring, cp->clp_ring_len);
 	close(cp->clp_fd);
 	free(cp);
 	*priv = NULL;
 	return 0;
 }
 
+/**
+ * Map the ring through which the kernel hands the records over in bulk.
+ * This is done on the first record received rather than on start, so that
+ * the filter set after start applies to all records. The records are read()
+ * instead if the kernel does not support it.
+ */
+static void chlg_ring_map(struct changelog_private *cp)
+{
+	size_t len = sysconf(_SC_PAGESIZE) + CHANGELOG_RING_SZ;
+	struct changelog_ring *clr;
+
+	cp->clp_ring_tried = true;
+
+	clr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   cp->clp_fd, 0);
+	if (clr == MAP_FAILED)
+		return;
+
+	if (clr->clr_magic != CHANGELOG_RING_MAGIC ||
+	    clr->clr_size != CHANGELOG_RING_SZ) {
+		munmap(clr, len);
+		return;
+	}
+
+	cp->clp_ring = clr;
+	cp->clp_ring_len = len;
+}
+
+/**
+ * Tell the kernel that the entries up to clp_tail were consumed, and have
+ * it refill the ring.
+ */
+static int chlg_ring_release(struct changelog_private *cp, int timeout)
+{
+	struct pollfd pfd = { .fd = cp->clp_fd, .events = POLLIN };
+
+	__atomic_store_n(&cp->clp_ring->clr_tail, cp->clp_tail,
+			 __ATOMIC_RELEASE);
+	cp->clp_tail_shown = cp->clp_tail;
+
+	if (poll(&pfd, 1, timeout) < 0 && errno != EINTR)
+		return -errno;
+
+	return 0;
+}
+
+/**
+ * Get the next record from the ring, waiting for one if it is empty.
+ * The entry of the previous record is only released on the next call,
+ * once that record was copied.
+ *
+ * @return 0 and the record in the ring, 1 at the end of the changelog,
+ *	   negated error code on failure.
+ */
+static int chlg_ring_next(struct changelog_private *cp,
+			  struct changelog_rec **rec)
+{
+	struct changelog_ring *clr = cp->clp_ring;
+	struct changelog_ring_ent *ent;
+	char *data = (char *)clr + clr->clr_data;
+	__u32 size = clr->clr_size;
+	__u32 flags;
+	__s32 error;
+	__u64 head;
+	int rc;
+
+	/* let the kernel refill a quarter of the ring at once */
+	if (cp->clp_tail - cp->clp_tail_shown >= size / 4) {
+		rc = chlg_ring_release(cp, 0);
+		if (rc < 0)
+			return rc;
+	}
+
+	while (1) {
+		/* the end is flagged once all the entries are in the ring */
+		flags = __atomic_load_n(&clr->clr_flags, __ATOMIC_ACQUIRE);
+		error = __atomic_load_n(&clr->clr_error, __ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&clr->clr_head, __ATOMIC_ACQUIRE);
+
+		if (cp->clp_tail == head) {
+			if (error < 0)
+				return error;
+			if (flags & CLR_EOF)
+				return 1;
+
+			rc = chlg_ring_release(cp, -1);
+			if (rc < 0)
+				return rc;
+			continue;
+		}
+
+		ent = (struct changelog_ring_ent *)
+			(data + (cp->clp_tail & (size - 1)));
+		if (ent->cre_len < sizeof(*ent) ||
+		    ent->cre_len > head - cp->clp_tail)
+			return -EPROTO;
+
+		cp->clp_tail += ent->cre_len;
+		if (!(ent->cre_flags & CRE_WRAP))
+			break;
+	}
+
+	*rec = ent->cre_rec;
+	return 0;
+}
+
 static ssize_t chlg_read_bulk(struct changelog_private *cp)
 {
 	ssize_t rd_bytes;
@@ -256,27 +378,35 @@ int llapi_changelog_recv(void *priv, struct changelog_rec **rech)
 			rec_extra_fmt |= CLFE_XATTR;
 	}
 
-	if (cp->clp_buf + cp->clp_buf_len <= cp->clp_buf_pos) {
-		ssize_t refresh;
+	if (!cp->clp_ring_tried)
+		chlg_ring_map(cp);
 
-		refresh = chlg_read_bulk(cp);
-		if (refresh == 0) {
-			/* EOF, CHANGELOG_FLAG_FOLLOW ignored for now LU-7659 */
-			rc = 1;
-			goto out_free;
-		} else if (refresh < 0) {
-			rc = refresh;
+	if (cp->clp_ring != NULL) {
+		rc = chlg_ring_next(cp, &tmp);
+		if (rc != 0)
 			goto out_free;
+	} else {
+		if (cp->clp_buf + cp->clp_buf_len <= cp->clp_buf_pos) {
+			ssize_t refresh;
+
+			refresh = chlg_read_bulk(cp);
+			if (refresh == 0) {
+				/* EOF, CHANGELOG_FLAG_FOLLOW ignored for now
+				 * LU-7659 */
+				rc = 1;
+				goto out_free;
+			} else if (refresh < 0) {
+				rc = refresh;
+				goto out_free;
+			}
 		}
-	}
-
-	/* TODO check changelog_rec_size */
-	tmp = (struct changelog_rec *)cp->clp_buf_pos;
 
-	memcpy(*rech, cp->clp_buf_pos,
-	       changelog_rec_size(tmp) + tmp->cr_namelen);
+		/* TODO check changelog_rec_size */
+		tmp = (struct changelog_rec *)cp->clp_buf_pos;
+		cp->clp_buf_pos += changelog_rec_size(tmp) + tmp->cr_namelen;
+	}
 
-	cp->clp_buf_pos += changelog_rec_size(tmp) + tmp->cr_namelen;
+	memcpy(*rech, tmp, changelog_rec_size(tmp) + tmp->cr_namelen);
 	changelog_remap_rec(*rech, rec_fmt, rec_extra_fmt);
 
 	return 0;
@@ -298,6 +428,12 @@ int llapi_changelog_free(struct changelog_rec **rech)
 int llapi_changelog_in_buf(void *priv)
 {
 	struct changelog_private *cp = priv;
+
+	if (cp->clp_ring != NULL)
+		return cp->clp_tail !=
+		       __atomic_load_n(&cp->clp_ring->clr_head,
+				       __ATOMIC_ACQUIRE);
+
 	if (cp->clp_buf + cp->clp_buf_len > cp->clp_buf_pos)
 		return 1;
 	return 0;
@@ -380,3 +516,33 @@ int llapi_changelog_set_xflags(void *priv,
 
 	return 0;
 }
+
+/**
+ * Only receive the changelog records matching a filter
+ *
+ * @param priv		Opaque private control structure
+ * @param filter	Record types, FID partition, FID and jobid to return
+ *
+ * The records are filtered by the changelog device, before they are copied
+ * to this process. Several readers can consume the records of one changelog
+ * user in parallel, with the same cf_part_count and a different
+ * cf_part_index each. They must then only clear the records processed by
+ * all of them.
+ *
+ * Just call this function right after llapi_changelog_start().
+ */
+int llapi_changelog_set_filter(void *priv,
+			       const struct changelog_filter *filter)
+{
+	struct changelog_private *cp = priv;
+	int rc;
+
+	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC)
+		return -EINVAL;
+
+	rc = ioctl(cp->clp_fd, OBD_IOC_CHLG_FILTER, filter);
+	if (rc < 0)
+		return -errno;
+
+	return 0;
+}
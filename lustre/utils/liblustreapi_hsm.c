@@ -1509,6 +1509,58 @@ int llapi_hsm_state_set(const char *path, __u64 setmask, __u64 clearmask,
 	return rc;
 }
 
+/**
+ * Attach the file pointed by \a path to the persistent cache of the client,
+ * set with the "pcc" llite parameter.
+ *
+ * The file is released, its copy in the cache being its HSM archive \a id,
+ * and its reads and writes on the client go to the cache copy. The copytool
+ * restoring it must run on the client, with the root of the cache as the
+ * root of archive \a id.
+ *
+ * \retval 0 on success.
+ * \retval -errno on error.
+ */
+int llapi_pcc_attach(const char *path, __u32 id)
+{
+	struct lu_pcc_attach attach = { .pcca_id = id };
+	int fd;
+	int rc;
+
+	fd = open(path, O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+		return -errno;
+
+	rc = ioctl(fd, LL_IOC_PCC_ATTACH, &attach);
+	rc = rc ? -errno : 0;
+
+	close(fd);
+	return rc;
+}
+
+/**
+ * Detach the file pointed by \a path from the persistent cache of the
+ * client, restoring it from its cache copy, which is removed then.
+ *
+ * \retval 0 on success.
+ * \retval -errno on error.
+ */
+int llapi_pcc_detach(const char *path)
+{
+	int fd;
+	int rc;
+
+	fd = open(path, O_WRONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -errno;
+
+	rc = ioctl(fd, LL_IOC_PCC_DETACH);
+	rc = rc ? -errno : 0;
+
+	close(fd);
+	return rc;
+}
+
 /**
  * Return the current HSM request related to file pointed by \a path.
  *
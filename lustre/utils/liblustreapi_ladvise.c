@@ -36,6 +36,7 @@
 #include <sys/syscall.h>
 #include <sys/ioctl.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <lustre/lustreapi.h>
 #include "lustreapi_internal.h"
@@ -95,3 +96,77 @@ int llapi_ladvise(int fd, unsigned long long flags, int num_advise,
 	return 0;
 }
 
+
+/*
+ * Request extent locks on a strided set of extents of a file
+ *
+ * Asks for non-expanding locks of \a mode on the \a count extents of
+ * \a length bytes starting every \a stride bytes from \a start, the way the
+ * ranks of a collective strided write to a shared file need them. The locks
+ * are requested asynchronously, the function returns as soon as the
+ * requests are sent. It can be called again until all the locks are held.
+ *
+ * \param fd       File to request the locks on.
+ * \param mode     MODE_READ_USER or MODE_WRITE_USER.
+ * \param start    Offset of the first extent.
+ * \param length   Length of every extent.
+ * \param stride   Distance between the starts of two consecutive extents.
+ * \param count    Number of extents.
+ *
+ * \retval number of extents already covered by a lock of exactly that extent.
+ * \retval -1 on failure, errno set
+ */
+int llapi_lockahead_strided(int fd, enum lock_mode_user mode,
+			    unsigned long long start, unsigned long long length,
+			    unsigned long long stride, int count)
+{
+	struct llapi_lu_ladvise *ladvise;
+	int batch = count < LAH_COUNT_MAX ? count : LAH_COUNT_MAX - 1;
+	int granted = 0;
+	int done;
+	int rc = 0;
+	int i;
+
+	if (mode <= 0 || mode >= MODE_MAX_USER || length == 0 ||
+	    stride < length || count < 1 || start + length - 1 < start ||
+	    count - 1 > (ULLONG_MAX - (start + length - 1)) / stride) {
+		errno = EINVAL;
+		llapi_error(LLAPI_MSG_ERROR, -EINVAL,
+			    "bad lockahead extents %llu+%llu/%llu x %d",
+			    start, length, stride, count);
+		return -1;
+	}
+
+	ladvise = calloc(batch, sizeof(*ladvise));
+	if (ladvise == NULL) {
+		errno = ENOMEM;
+		llapi_error(LLAPI_MSG_ERROR, -ENOMEM, "not enough memory");
+		return -1;
+	}
+
+	for (done = 0; done < count; done += batch) {
+		int n = count - done < batch ? count - done : batch;
+
+		memset(ladvise, 0, sizeof(*ladvise) * n);
+		for (i = 0; i < n; i++) {
+			ladvise[i].lla_advice = LU_LADVISE_LOCKAHEAD;
+			ladvise[i].lla_lockahead_mode = mode;
+			ladvise[i].lla_peradvice_flags = LF_ASYNC;
+			ladvise[i].lla_start = start + (done + i) * stride;
+			ladvise[i].lla_end = ladvise[i].lla_start + length - 1;
+		}
+
+		rc = llapi_ladvise(fd, 0, n, ladvise);
+		if (rc < 0)
+			break;
+
+		for (i = 0; i < n; i++) {
+			if (ladvise[i].lla_lockahead_result == LLA_RESULT_SAME)
+				granted++;
+		}
+	}
+
+	free(ladvise);
+
+	return rc < 0 ? rc : granted;
+}
@@ -61,6 +61,7 @@ struct llapi_layout_comp {
 	uint32_t		llc_id;		/* unique ID of component */
 	uint32_t		llc_flags;	/* LCME_FL_* flags */
 	uint64_t		llc_timestamp;	/* snapshot timestamp */
+	uint64_t		llc_extension_size; /* LCME_FL_EXTENSION */
 	struct list_head	llc_list;	/* linked to the llapi_layout
 						   components list */
 };
@@ -154,6 +155,7 @@ llapi_layout_swab_lov_user_md(struct lov_user_md *lum, int lum_size)
 			__swab64s(&ent->lcme_extent.e_end);
 			__swab32s(&ent->lcme_offset);
 			__swab32s(&ent->lcme_size);
+			__swab32s(&ent->lcme_extension_size);
 
 			lum = (struct lov_user_md *)((char *)comp_v1 +
 					ent->lcme_offset);
@@ -536,6 +538,10 @@ struct llapi_layout *llapi_layout_get_by_xattr(void *lov_xattr,
 			comp->llc_flags = ent->lcme_flags;
 			if (comp->llc_flags & LCME_FL_NOSYNC)
 				comp->llc_timestamp = ent->lcme_timestamp;
+			if (comp->llc_flags & LCME_FL_EXTENSION)
+				comp->llc_extension_size =
+					(uint64_t)ent->lcme_extension_size *
+					SEL_UNIT_SIZE;
 		} else {
 			comp->llc_extent.e_start = 0;
 			comp->llc_extent.e_end = LUSTRE_EOF;
@@ -748,6 +754,10 @@ llapi_layout_to_lum(const struct llapi_layout *layout)
 			ent->lcme_flags = comp->llc_flags;
 			if (ent->lcme_flags & LCME_FL_NOSYNC)
 				ent->lcme_timestamp = comp->llc_timestamp;
+			if (ent->lcme_flags & LCME_FL_EXTENSION)
+				ent->lcme_extension_size =
+					comp->llc_extension_size /
+					SEL_UNIT_SIZE;
 			ent->lcme_extent.e_start = comp->llc_extent.e_start;
 			ent->lcme_extent.e_end = comp->llc_extent.e_end;
 			ent->lcme_size = blob_size;
@@ -1227,6 +1237,73 @@ int llapi_layout_stripe_size_set(struct llapi_layout *layout,
 	return 0;
 }
 
+/**
+ * Get the extension size of the current component of \a layout.
+ *
+ * \param[in] layout	layout to get extension size from
+ * \param[out] size	integer to store extension size in, 0 if the
+ *			component is not an extension component
+ *
+ * \retval	0 on success
+ * \retval	-1 if arguments are invalid
+ */
+int llapi_layout_extension_size_get(const struct llapi_layout *layout,
+				    uint64_t *size)
+{
+	struct llapi_layout_comp *comp;
+
+	comp = __llapi_layout_cur_comp(layout);
+	if (comp == NULL)
+		return -1;
+
+	if (size == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*size = comp->llc_flags & LCME_FL_EXTENSION ?
+		comp->llc_extension_size : 0;
+
+	return 0;
+}
+
+/**
+ * Make the current component of \a layout an extension component.
+ *
+ * The component is never instantiated: when a write reaches it, the MDT adds
+ * a component with its striping in front of it, covering the write in
+ * multiples of \a size. A size of 0 makes it a plain component again.
+ *
+ * \param[in] layout	layout to set extension size in
+ * \param[in] size	extension size, a multiple of SEL_UNIT_SIZE
+ *
+ * \retval	0 on success
+ * \retval	-1 if arguments are invalid
+ */
+int llapi_layout_extension_size_set(struct llapi_layout *layout,
+				    uint64_t size)
+{
+	struct llapi_layout_comp *comp;
+
+	comp = __llapi_layout_cur_comp(layout);
+	if (comp == NULL)
+		return -1;
+
+	if (size % SEL_UNIT_SIZE != 0 ||
+	    size / SEL_UNIT_SIZE > UINT32_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	comp->llc_extension_size = size;
+	if (size != 0)
+		comp->llc_flags |= LCME_FL_EXTENSION;
+	else
+		comp->llc_flags &= ~LCME_FL_EXTENSION;
+
+	return 0;
+}
+
 /**
  * Get the RAID pattern of \a layout.
  *
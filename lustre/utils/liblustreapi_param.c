@@ -26,9 +26,11 @@
  */
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -423,3 +425,216 @@ void llapi_param_paths_free(glob_t *paths)
 {
 	cfs_free_param_data(paths);
 }
+
+/*
+ * A parameter set keeps every file matched by one or more patterns open,
+ * so that a caller sampling the same parameters repeatedly (a monitoring
+ * agent, say) only pays for the glob and open once. Each sample then
+ * costs one pread() per file into a single buffer shared by the set.
+ */
+struct llapi_param_file {
+	char	*lpf_path;
+	int	 lpf_fd;
+};
+
+struct llapi_param_set {
+	struct llapi_param_file	*lps_files;
+	unsigned int		 lps_count;
+	unsigned int		 lps_alloc;
+	char			*lps_buf;
+	size_t			 lps_buflen;
+};
+
+#define LLAPI_PARAM_SET_BUF_MIN	4096
+
+/**
+ * Add all parameter files matching \a pattern to the set \a *set,
+ * allocating the set first if \a *set is NULL.
+ *
+ * \param set[in,out]	set to add to, or pointer to NULL for a new set
+ * \param pattern[in]	parameter name or glob as for llapi_param_get_paths()
+ *
+ * Files which cannot be opened for reading (write-only tunables) are
+ * skipped.
+ *
+ * Returns 0 on success, negative errno value on failure. On failure
+ * the set is left as it was before the call.
+ */
+int llapi_param_set_add(struct llapi_param_set **set, const char *pattern)
+{
+	struct llapi_param_set *lps;
+	glob_t paths;
+	unsigned int start;
+	bool allocated = false;
+	size_t i;
+	int rc;
+
+	if (set == NULL || pattern == NULL)
+		return -EINVAL;
+
+	rc = llapi_param_get_paths(pattern, &paths);
+	if (rc != 0)
+		return -errno;
+
+	lps = *set;
+	if (lps == NULL) {
+		lps = calloc(1, sizeof(*lps));
+		if (lps == NULL) {
+			rc = -ENOMEM;
+			goto out_paths;
+		}
+		allocated = true;
+	}
+	start = lps->lps_count;
+
+	if (lps->lps_count + paths.gl_pathc > lps->lps_alloc) {
+		struct llapi_param_file *files;
+		unsigned int count = lps->lps_count + paths.gl_pathc;
+
+		files = realloc(lps->lps_files, count * sizeof(*files));
+		if (files == NULL) {
+			rc = -ENOMEM;
+			goto out_set;
+		}
+		lps->lps_files = files;
+		lps->lps_alloc = count;
+	}
+
+	for (i = 0; i < paths.gl_pathc; i++) {
+		struct llapi_param_file *lpf = &lps->lps_files[lps->lps_count];
+		int fd;
+
+		fd = open(paths.gl_pathv[i], O_RDONLY);
+		if (fd < 0)
+			continue;
+
+		lpf->lpf_path = strdup(paths.gl_pathv[i]);
+		if (lpf->lpf_path == NULL) {
+			close(fd);
+			rc = -ENOMEM;
+			goto out_files;
+		}
+		lpf->lpf_fd = fd;
+		lps->lps_count++;
+	}
+
+	*set = lps;
+	goto out_paths;
+
+out_files:
+	while (lps->lps_count > start) {
+		struct llapi_param_file *lpf = &lps->lps_files[--lps->lps_count];
+
+		close(lpf->lpf_fd);
+		free(lpf->lpf_path);
+	}
+out_set:
+	if (allocated)
+		llapi_param_set_free(lps);
+out_paths:
+	llapi_param_paths_free(&paths);
+
+	return rc;
+}
+
+/* read one open parameter file from the start into the set buffer */
+static int param_set_read_one(struct llapi_param_set *lps,
+			      struct llapi_param_file *lpf, size_t *len)
+{
+	ssize_t count;
+
+	for (;;) {
+		char *buf;
+
+		count = pread(lpf->lpf_fd, lps->lps_buf, lps->lps_buflen, 0);
+		if (count < 0)
+			return -errno;
+
+		/* leave room for the NUL byte, so a full buffer means the
+		 * value may have been truncated and must be read again
+		 */
+		if ((size_t)count < lps->lps_buflen) {
+			lps->lps_buf[count] = '\0';
+			*len = count;
+			return 0;
+		}
+
+		buf = realloc(lps->lps_buf, lps->lps_buflen * 2);
+		if (buf == NULL)
+			return -ENOMEM;
+		lps->lps_buf = buf;
+		lps->lps_buflen *= 2;
+	}
+}
+
+/**
+ * Read every parameter in \a set and pass each value to \a cb.
+ *
+ * \param set[in]	parameter set built by llapi_param_set_add()
+ * \param cb[in]	called once per parameter with its path, the
+ *			NUL-terminated value and the value length. The
+ *			value is only valid until \a cb returns.
+ * \param data[in]	opaque pointer passed through to \a cb
+ *
+ * A parameter which fails to read is skipped and the first such error is
+ * returned after all the others have been read. A non-zero return from
+ * \a cb stops the walk and is returned.
+ *
+ * Returns 0 on success, negative errno value on failure.
+ */
+int llapi_param_set_read(struct llapi_param_set *set, llapi_param_cb_t cb,
+			 void *data)
+{
+	unsigned int i;
+	int rc = 0;
+
+	if (set == NULL || cb == NULL)
+		return -EINVAL;
+
+	if (set->lps_buf == NULL) {
+		set->lps_buf = malloc(LLAPI_PARAM_SET_BUF_MIN);
+		if (set->lps_buf == NULL)
+			return -ENOMEM;
+		set->lps_buflen = LLAPI_PARAM_SET_BUF_MIN;
+	}
+
+	for (i = 0; i < set->lps_count; i++) {
+		struct llapi_param_file *lpf = &set->lps_files[i];
+		size_t len;
+		int rc2;
+
+		rc2 = param_set_read_one(set, lpf, &len);
+		if (rc2 == -ENOMEM)
+			return rc2;
+		if (rc2 != 0) {
+			if (rc == 0)
+				rc = rc2;
+			continue;
+		}
+
+		rc2 = cb(lpf->lpf_path, set->lps_buf, len, data);
+		if (rc2 != 0)
+			return rc2;
+	}
+
+	return rc;
+}
+
+/**
+ * Close all the parameter files in \a set and free it.
+ */
+void llapi_param_set_free(struct llapi_param_set *set)
+{
+	unsigned int i;
+
+	if (set == NULL)
+		return;
+
+	for (i = 0; i < set->lps_count; i++) {
+		close(set->lps_files[i].lpf_fd);
+		free(set->lps_files[i].lpf_path);
+	}
+	free(set->lps_files);
+	free(set->lps_buf);
+	free(set);
+}
@@ -37,6 +37,7 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <assert.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -68,6 +69,7 @@ struct options {
 	int		 o_verbose;
 	int		 o_intv;
 	int		 o_min_age;
+	int		 o_threads;
 	unsigned long	 o_cached_fid_hiwm; /* high watermark */
 	unsigned long	 o_batch_sync_cnt;
 };
@@ -101,6 +103,15 @@ struct lsom_head {
 	unsigned long		 lh_cached_count;
 } head;
 
+/* records being synced by lsom_start_update() */
+struct lsom_batch {
+	pthread_mutex_t	  lb_lock;	/* protects lb_next */
+	struct fid_rec	**lb_recs;
+	int		 *lb_rcs;
+	int		  lb_count;
+	int		  lb_next;	/* next record to sync */
+};
+
 static void usage(char *prog)
 {
 	printf("\nUsage: %s [options] -u <userid> -m <mdtdev> <mntpt>\n"
@@ -110,6 +121,7 @@ static void usage(char *prog)
 	       "\t-a, --min-age, min age before a record is processed.\n"
 	       "\t-c, --max-cache, percentage of the memroy used for cache.\n"
 	       "\t-s, --sync, data sync when update LSOM xattr\n"
+	       "\t-t, --threads, number of threads updating LSOM xattr\n"
 	       "\t-v, --verbose, produce more verbose ouput\n",
 	       prog);
 	exit(0);
@@ -237,7 +249,7 @@ static int lsom_update_one(struct fid_rec *f)
 		 * changelog record and ignore this error.
 		 */
 		if (rc == -ENOENT)
-			goto clean_up;
+			return 0;
 
 		llapi_error(LLAPI_MSG_ERROR, rc,
 			    "llapi_open_by_fid for " DFID " failed",
@@ -259,8 +271,10 @@ static int lsom_update_one(struct fid_rec *f)
 
 	rc = fstat(fd, &st);
 	if (rc < 0) {
+		rc = -errno;
 		llapi_error(LLAPI_MSG_ERROR, rc, "failed to stat FID: " DFID,
 			    PFID(&f->fr_fid));
+		close(fd);
 		return rc;
 	}
 
@@ -277,50 +291,121 @@ static int lsom_update_one(struct fid_rec *f)
 		     (unsigned long long)f->fr_index,
 		     PFID(&f->fr_fid), st.st_size, st.st_blocks);
 
-clean_up:
-	rc = llapi_changelog_clear(opt.o_mdtname,
-				   opt.o_chlg_user, f->fr_index);
-	if (rc)
-		llapi_error(LLAPI_MSG_ERROR, rc,
-			    "failed to clear changelog record: %s:%llu",
-			    opt.o_chlg_user, (unsigned long long)f->fr_index);
-	return rc;
+	return 0;
 }
 
+static void *lsom_update_thread(void *arg)
+{
+	struct lsom_batch *lb = arg;
+	int i;
+
+	while (1) {
+		pthread_mutex_lock(&lb->lb_lock);
+		i = lb->lb_next++;
+		pthread_mutex_unlock(&lb->lb_lock);
+		if (i >= lb->lb_count)
+			break;
+
+		lb->lb_rcs[i] = lsom_update_one(lb->lb_recs[i]);
+	}
+
+	return NULL;
+}
+
+/*
+ * Sync the first @count records of the list with o_threads threads, then
+ * clear the changelog once for all of them. The list is ordered by record
+ * index and every other cached FID has a later record, so clearing up to
+ * the last synced record drops nothing that is still needed.
+ */
 static int lsom_start_update(int count)
 {
+	struct lsom_batch lb = { .lb_count = 0 };
+	pthread_t *threads = NULL;
+	struct fid_rec *f;
+	__u64 last = 0;
+	int started = 0;
 	int rc = 0;
-	int i = 0;
+	int i;
+
+	if (count > head.lh_cached_count)
+		count = head.lh_cached_count;
+	if (count <= 0)
+		return 0;
 
 	llapi_printf(LLAPI_MSG_INFO, "Start to sync %d records.\n", count);
 
-	while (i < count) {
-		struct fid_rec *f;
+	lb.lb_recs = calloc(count, sizeof(*lb.lb_recs));
+	lb.lb_rcs = calloc(count, sizeof(*lb.lb_rcs));
+	if (lb.lb_recs == NULL || lb.lb_rcs == NULL) {
+		rc = -ENOMEM;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "failed to alloc memory for %d records", count);
+		goto out;
+	}
 
-		f = list_entry(head.lh_list.next, struct fid_rec, fr_link);
-		rc = lsom_update_one(f);
-		if (rc == 0) {
-			list_del_init(&f->fr_link);
-			fid_hash_del(f);
-			free(f);
-			head.lh_cached_count--;
-			i++;
-		} else {
-			goto out;
+	list_for_each_entry(f, &head.lh_list, fr_link) {
+		if (lb.lb_count == count)
+			break;
+		lb.lb_recs[lb.lb_count++] = f;
+	}
+	pthread_mutex_init(&lb.lb_lock, NULL);
+
+	if (opt.o_threads > 1 && lb.lb_count > 1) {
+		threads = calloc(opt.o_threads - 1, sizeof(*threads));
+		for (; threads != NULL && started < opt.o_threads - 1 &&
+		       started < lb.lb_count - 1; started++) {
+			if (pthread_create(&threads[started], NULL,
+					   lsom_update_thread, &lb) != 0)
+				break;
+		}
+	}
+
+	/* this thread takes its share, and all of it if none started */
+	lsom_update_thread(&lb);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&lb.lb_lock);
+
+	for (i = 0; i < lb.lb_count; i++) {
+		f = lb.lb_recs[i];
+		if (lb.lb_rcs[i] != 0) {
+			rc = lb.lb_rcs[i];
+			break;
+		}
+
+		last = f->fr_index;
+		list_del_init(&f->fr_link);
+		fid_hash_del(f);
+		free(f);
+		head.lh_cached_count--;
+	}
+
+	if (last != 0) {
+		int rc2;
+
+		rc2 = llapi_changelog_clear(opt.o_mdtname, opt.o_chlg_user,
+					    last);
+		if (rc2) {
+			llapi_error(LLAPI_MSG_ERROR, rc2,
+				    "failed to clear changelog record: %s:%llu",
+				    opt.o_chlg_user, (unsigned long long)last);
+			if (rc == 0)
+				rc = rc2;
 		}
 	}
 
 out:
+	free(threads);
+	free(lb.lb_rcs);
+	free(lb.lb_recs);
 	return rc;
 }
 
 static int lsom_check_sync(void)
 {
-	int rc = 0;
-	int count;
+	int count = 0;
 
-repeated:
-	count = 0;
 	if (list_empty(&head.lh_list))
 		return 0;
 
@@ -330,23 +415,23 @@ repeated:
 		struct fid_rec *f;
 		time_t now;
 
-		/* When the first record in the list was not being
+		/* When the first records in the list were not being
 		 * processed for a long time (more than o_min_age),
-		 * pop the record, start to handle it immediately.
+		 * pop them, start to handle them immediately.
 		 */
 		now = time(NULL);
-		f = list_entry(head.lh_list.next, struct fid_rec, fr_link);
-		if (now > ((f->fr_time >> 30) + opt.o_min_age))
-			count = 1;
+		list_for_each_entry(f, &head.lh_list, fr_link) {
+			if (now <= ((f->fr_time >> 30) + opt.o_min_age) ||
+			    count >= opt.o_batch_sync_cnt)
+				break;
+			count++;
+		}
 	}
 
 	if (count > 0)
-		rc = lsom_start_update(count);
-
-	if (rc == 0 && count == 1)
-		goto repeated;
+		return lsom_start_update(count);
 
-	return rc;
+	return 0;
 }
 
 static void lsom_sort_record_list(struct fid_rec *f)
@@ -457,6 +542,7 @@ int main(int argc, char **argv)
 		{ "max-cache", required_argument, NULL, 'c'},
 		{ "verbose", no_argument, NULL, 'v'},
 		{ "sync", no_argument, NULL, 's'},
+		{ "threads", required_argument, NULL, 't'},
 		{ "help", no_argument, NULL, 'h' },
 		{ NULL }
 	};
@@ -466,8 +552,9 @@ int main(int argc, char **argv)
 	opt.o_verbose = LLAPI_MSG_INFO;
 	opt.o_intv = CHLG_POLL_INTV;
 	opt.o_min_age = REC_MIN_AGE;
+	opt.o_threads = 1;
 
-	while ((c = getopt_long(argc, argv, "u:hm:dsi:a:c:v", options, NULL))
+	while ((c = getopt_long(argc, argv, "u:hm:dsi:a:c:t:v", options, NULL))
 	       != EOF) {
 		switch (c) {
 		default:
@@ -529,6 +616,15 @@ int main(int argc, char **argv)
 		case 's':
 			opt.o_data_sync = true;
 			break;
+		case 't':
+			opt.o_threads = atoi(optarg);
+			if (opt.o_threads < 1) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -t %s", optarg);
+				return rc;
+			}
+			break;
 		}
 	}
 
@@ -0,0 +1,609 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/utils/llstatd.c
+ *
+ * Sample Lustre statistics (stats, brw_stats, rpc_stats, job_stats...)
+ * at a fixed interval and write them as a delta-encoded time series.
+ *
+ * Each parameter file is kept open between samples, and only the
+ * counters that changed since the previous sample are written, so the
+ * collector is cheap enough to leave running on production nodes.
+ *
+ * Output format, one record per line:
+ *   V <version> <interval>	header, written when the output is opened
+ *   T <secs.usecs>		start of a sample
+ *   P <id> <path>		defines <id> as the parameter at <path>
+ *   D <id> <key> <delta>...	change of each number in the line <key>
+ *				since the previous sample of <id>
+ *   X <id> <key>		the line <key> has gone from <id>
+ * Adding up the D records of a key from its first appearance gives the
+ * absolute values of every number on that line.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <lustre/lustreapi.h>
+
+#define LSD_VERSION		1
+#define LSD_INTERVAL_DEF	10
+#define LSD_RESCAN_DEF		300
+#define LSD_KEY_MAX		128
+#define LSD_VALS_MAX		16
+
+static const char * const lsd_default_params[] = {
+	"llite.*.stats",
+	"osc.*.stats",
+	"osc.*.rpc_stats",
+	"mdc.*.stats",
+	"mdc.*.rpc_stats",
+	"obdfilter.*.stats",
+	"obdfilter.*.brw_stats",
+	"obdfilter.*.job_stats",
+	"mdt.*.md_stats",
+	"mdt.*.job_stats",
+	NULL
+};
+
+/* lines that change at every sample without carrying any counter */
+static const char * const lsd_skip_labels[] = {
+	"snapshot_time",
+	"start_time",
+	"elapsed_time",
+	NULL
+};
+
+/* one line of a parameter file, identified by its section and label */
+struct lsd_entry {
+	char		le_key[LSD_KEY_MAX];
+	int		le_nvals;
+	bool		le_seen;
+	long long	le_vals[LSD_VALS_MAX];
+};
+
+/* everything known about one parameter file from its previous sample */
+struct lsd_param {
+	char			*lp_path;
+	unsigned int		 lp_id;
+	bool			 lp_defined;	/* "P" record written */
+	struct lsd_entry	*lp_entries;
+	int			 lp_count;
+	int			 lp_alloc;
+};
+
+struct options {
+	const char	 *o_output;
+	const char	**o_params;
+	int		  o_nparams;
+	int		  o_interval;
+	int		  o_rescan;
+	long		  o_samples;
+	bool		  o_daemonize;
+};
+
+static struct options opt = {
+	.o_interval = LSD_INTERVAL_DEF,
+	.o_rescan = LSD_RESCAN_DEF,
+};
+
+static struct lsd_param	*params;
+static int		 params_count;
+static unsigned int	 params_next_id;
+static struct lsd_entry	*scratch;	/* entries of the sample being parsed */
+static int		 scratch_alloc;
+static FILE		*out;
+static volatile sig_atomic_t lsd_stop;
+static volatile sig_atomic_t lsd_reopen;
+
+static void usage(const char *prog)
+{
+	printf("\nUsage: %s [options]\n"
+	       "options:\n"
+	       "\t-d, --daemonize\n"
+	       "\t-i, --interval <seconds> between samples (default %d)\n"
+	       "\t-n, --samples <count> to take, then exit "
+	       "(default unlimited)\n"
+	       "\t-o, --output <file> to append to (default stdout), "
+	       "reopened on SIGHUP\n"
+	       "\t-p, --param <pattern> to sample, may be repeated "
+	       "(default: a set of stats, rpc_stats, brw_stats and job_stats)\n"
+	       "\t-r, --rescan <seconds> between looking for new devices "
+	       "(default %d)\n"
+	       "\t-h, --help\n",
+	       prog, LSD_INTERVAL_DEF, LSD_RESCAN_DEF);
+}
+
+static void lsd_signal(int signo)
+{
+	if (signo == SIGHUP)
+		lsd_reopen = 1;
+	else
+		lsd_stop = 1;
+}
+
+static int lsd_open_output(void)
+{
+	int i;
+
+	if (out != NULL && out != stdout)
+		fclose(out);
+
+	if (opt.o_output == NULL) {
+		out = stdout;
+	} else {
+		out = fopen(opt.o_output, "a");
+		if (out == NULL) {
+			int rc = -errno;
+
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot open '%s'",
+				    opt.o_output);
+			return rc;
+		}
+	}
+
+	/* a new file needs the parameter ids defined again */
+	for (i = 0; i < params_count; i++)
+		params[i].lp_defined = false;
+
+	fprintf(out, "V %d %d\n", LSD_VERSION, opt.o_interval);
+
+	return 0;
+}
+
+static struct lsd_param *lsd_param_find(const char *path, int *hint)
+{
+	struct lsd_param *lp;
+	int i;
+
+	if (*hint < params_count && strcmp(params[*hint].lp_path, path) == 0)
+		return &params[(*hint)++];
+
+	for (i = 0; i < params_count; i++) {
+		if (strcmp(params[i].lp_path, path) == 0) {
+			*hint = i + 1;
+			return &params[i];
+		}
+	}
+
+	lp = realloc(params, (params_count + 1) * sizeof(*params));
+	if (lp == NULL)
+		return NULL;
+	params = lp;
+
+	lp = &params[params_count];
+	memset(lp, 0, sizeof(*lp));
+	lp->lp_path = strdup(path);
+	if (lp->lp_path == NULL)
+		return NULL;
+	lp->lp_id = params_next_id++;
+	*hint = ++params_count;
+
+	return lp;
+}
+
+static bool lsd_is_number(const char *tok, long long *val)
+{
+	char *end;
+
+	if (!(*tok >= '0' && *tok <= '9') &&
+	    !(*tok == '-' && tok[1] >= '0' && tok[1] <= '9'))
+		return false;
+
+	errno = 0;
+	*val = strtoll(tok, &end, 10);
+
+	return *end == '\0' && errno == 0;
+}
+
+/* append \a word to \a key, separated by '_' and without a trailing ':' */
+static void lsd_key_append(char *key, const char *word)
+{
+	size_t len = strlen(key);
+	size_t wlen = strlen(word);
+
+	if (wlen > 0 && word[wlen - 1] == ':')
+		wlen--;
+	if (wlen == 0)
+		return;
+
+	if (len > 0 && len < LSD_KEY_MAX - 1)
+		key[len++] = '_';
+	if (len + wlen >= LSD_KEY_MAX)
+		wlen = LSD_KEY_MAX - 1 - len;
+	memcpy(key + len, word, wlen);
+	key[len + wlen] = '\0';
+}
+
+/*
+ * Split a parameter value into entries. The words before the first
+ * integer on a line are its label, and every integer on the line is a
+ * value. A line with no integer, or a YAML list item such as
+ * "- job_id: ...", starts a new section, and the key of each entry is
+ * its section and label so that lines with the same label in different
+ * sections, as in brw_stats, stay apart.
+ */
+static int lsd_parse(char *value, int *count)
+{
+	char section[LSD_KEY_MAX] = "";
+	char *line, *next;
+	int n = 0;
+
+	for (line = value; line != NULL && *line != '\0'; line = next) {
+		char label[LSD_KEY_MAX] = "";
+		long long vals[LSD_VALS_MAX];
+		char *tok, *save;
+		bool is_section;
+		int nvals = 0;
+		int i;
+
+		next = strchr(line, '\n');
+		if (next != NULL)
+			*next++ = '\0';
+
+		while (*line == ' ' || *line == '\t')
+			line++;
+		is_section = strncmp(line, "- ", 2) == 0;
+
+		for (tok = strtok_r(line, " \t,{}|", &save); tok != NULL;
+		     tok = strtok_r(NULL, " \t,{}|", &save)) {
+			long long val;
+
+			if (!is_section && lsd_is_number(tok, &val)) {
+				if (nvals < LSD_VALS_MAX)
+					vals[nvals++] = val;
+			} else if (nvals == 0) {
+				lsd_key_append(label, tok);
+			}
+		}
+
+		if (label[0] == '\0' && nvals == 0)
+			continue;
+
+		for (i = 0; lsd_skip_labels[i] != NULL; i++)
+			if (strncmp(label, lsd_skip_labels[i],
+				    strlen(lsd_skip_labels[i])) == 0)
+				break;
+		if (lsd_skip_labels[i] != NULL)
+			continue;
+
+		if (nvals == 0) {
+			snprintf(section, sizeof(section), "%s", label);
+			continue;
+		}
+
+		if (n == scratch_alloc) {
+			struct lsd_entry *tmp;
+			int alloc = scratch_alloc ? scratch_alloc * 2 : 64;
+
+			tmp = realloc(scratch, alloc * sizeof(*scratch));
+			if (tmp == NULL)
+				return -ENOMEM;
+			scratch = tmp;
+			scratch_alloc = alloc;
+		}
+
+		if (section[0] != '\0')
+			snprintf(scratch[n].le_key, LSD_KEY_MAX, "%s/%s",
+				 section, label[0] != '\0' ? label : "-");
+		else
+			snprintf(scratch[n].le_key, LSD_KEY_MAX, "%s",
+				 label[0] != '\0' ? label : "-");
+		scratch[n].le_nvals = nvals;
+		scratch[n].le_seen = false;
+		memcpy(scratch[n].le_vals, vals, nvals * sizeof(vals[0]));
+		n++;
+	}
+
+	*count = n;
+
+	return 0;
+}
+
+static struct lsd_entry *lsd_entry_find(struct lsd_param *lp,
+					const char *key, int *hint)
+{
+	int i;
+
+	if (*hint < lp->lp_count &&
+	    strcmp(lp->lp_entries[*hint].le_key, key) == 0)
+		return &lp->lp_entries[(*hint)++];
+
+	for (i = 0; i < lp->lp_count; i++) {
+		if (strcmp(lp->lp_entries[i].le_key, key) == 0) {
+			*hint = i + 1;
+			return &lp->lp_entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* write the changes since the previous sample and remember this one */
+static int lsd_param_cb(const char *path, const char *value, size_t len,
+			void *data)
+{
+	int *param_hint = data;
+	struct lsd_param *lp;
+	char *copy;
+	int hint = 0;
+	int count;
+	int rc;
+	int i;
+
+	lp = lsd_param_find(path, param_hint);
+	if (lp == NULL)
+		return -ENOMEM;
+
+	copy = strndup(value, len);
+	if (copy == NULL)
+		return -ENOMEM;
+	rc = lsd_parse(copy, &count);
+	free(copy);
+	if (rc < 0)
+		return rc;
+
+	for (i = 0; i < lp->lp_count; i++)
+		lp->lp_entries[i].le_seen = false;
+
+	for (i = 0; i < count; i++) {
+		struct lsd_entry *new = &scratch[i];
+		struct lsd_entry *old;
+		bool changed = false;
+		int j;
+
+		old = lsd_entry_find(lp, new->le_key, &hint);
+		if (old != NULL) {
+			old->le_seen = true;
+			changed = old->le_nvals != new->le_nvals;
+			for (j = 0; j < new->le_nvals && !changed; j++)
+				changed = old->le_vals[j] != new->le_vals[j];
+		} else {
+			changed = true;
+		}
+		if (!changed)
+			continue;
+
+		if (!lp->lp_defined) {
+			fprintf(out, "P %u %s\n", lp->lp_id, lp->lp_path);
+			lp->lp_defined = true;
+		}
+		fprintf(out, "D %u %s", lp->lp_id, new->le_key);
+		for (j = 0; j < new->le_nvals; j++) {
+			long long prev = 0;
+
+			if (old != NULL && j < old->le_nvals)
+				prev = old->le_vals[j];
+			fprintf(out, " %lld", new->le_vals[j] - prev);
+		}
+		fputc('\n', out);
+	}
+
+	for (i = 0; i < lp->lp_count; i++) {
+		if (lp->lp_entries[i].le_seen)
+			continue;
+		if (!lp->lp_defined) {
+			fprintf(out, "P %u %s\n", lp->lp_id, lp->lp_path);
+			lp->lp_defined = true;
+		}
+		fprintf(out, "X %u %s\n", lp->lp_id, lp->lp_entries[i].le_key);
+	}
+
+	if (count > lp->lp_alloc) {
+		struct lsd_entry *tmp;
+
+		tmp = realloc(lp->lp_entries, count * sizeof(*tmp));
+		if (tmp == NULL) {
+			lp->lp_count = 0;
+			return -ENOMEM;
+		}
+		lp->lp_entries = tmp;
+		lp->lp_alloc = count;
+	}
+	memcpy(lp->lp_entries, scratch, count * sizeof(*scratch));
+	lp->lp_count = count;
+
+	return 0;
+}
+
+static int lsd_build_set(struct llapi_param_set **set)
+{
+	int found = 0;
+	int i;
+
+	llapi_param_set_free(*set);
+	*set = NULL;
+
+	for (i = 0; i < opt.o_nparams; i++) {
+		/* a pattern matching nothing yet may match after a rescan */
+		if (llapi_param_set_add(set, opt.o_params[i]) == 0)
+			found++;
+	}
+
+	return found > 0 ? 0 : -ENOENT;
+}
+
+int main(int argc, char **argv)
+{
+	struct option long_opts[] = {
+	{ .val = 'd',	.name = "daemonize",	.has_arg = no_argument },
+	{ .val = 'h',	.name = "help",		.has_arg = no_argument },
+	{ .val = 'i',	.name = "interval",	.has_arg = required_argument },
+	{ .val = 'n',	.name = "samples",	.has_arg = required_argument },
+	{ .val = 'o',	.name = "output",	.has_arg = required_argument },
+	{ .val = 'p',	.name = "param",	.has_arg = required_argument },
+	{ .val = 'r',	.name = "rescan",	.has_arg = required_argument },
+	{ .name = NULL } };
+	struct llapi_param_set *set = NULL;
+	struct sigaction sa = { .sa_handler = lsd_signal };
+	time_t last_scan = 0;
+	long taken = 0;
+	char *end;
+	int rc = 0;
+	int c;
+
+	opt.o_params = calloc(argc, sizeof(*opt.o_params));
+	if (opt.o_params == NULL)
+		return ENOMEM;
+
+	while ((c = getopt_long(argc, argv, "dhi:n:o:p:r:", long_opts,
+				NULL)) != EOF) {
+		switch (c) {
+		case 'd':
+			opt.o_daemonize = true;
+			break;
+		case 'i':
+			opt.o_interval = strtol(optarg, &end, 0);
+			if (*end != '\0' || opt.o_interval <= 0) {
+				fprintf(stderr, "%s: bad interval '%s'\n",
+					argv[0], optarg);
+				return EINVAL;
+			}
+			break;
+		case 'n':
+			opt.o_samples = strtol(optarg, &end, 0);
+			if (*end != '\0' || opt.o_samples <= 0) {
+				fprintf(stderr, "%s: bad sample count '%s'\n",
+					argv[0], optarg);
+				return EINVAL;
+			}
+			break;
+		case 'o':
+			opt.o_output = optarg;
+			break;
+		case 'p':
+			opt.o_params[opt.o_nparams++] = optarg;
+			break;
+		case 'r':
+			opt.o_rescan = strtol(optarg, &end, 0);
+			if (*end != '\0' || opt.o_rescan < 0) {
+				fprintf(stderr,
+					"%s: bad rescan interval '%s'\n",
+					argv[0], optarg);
+				return EINVAL;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return EINVAL;
+		}
+	}
+
+	if (optind != argc) {
+		usage(argv[0]);
+		return EINVAL;
+	}
+
+	if (opt.o_nparams == 0) {
+		free(opt.o_params);
+		opt.o_params = (const char **)lsd_default_params;
+		while (lsd_default_params[opt.o_nparams] != NULL)
+			opt.o_nparams++;
+	}
+
+	if (opt.o_daemonize) {
+		if (opt.o_output == NULL) {
+			fprintf(stderr, "%s: --daemonize needs --output\n",
+				argv[0]);
+			return EINVAL;
+		}
+		if (daemon(1, 1) < 0) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot daemonize");
+			return -rc;
+		}
+		setbuf(stdout, NULL);
+	}
+
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+
+	rc = lsd_open_output();
+	if (rc < 0)
+		return -rc;
+
+	while (!lsd_stop) {
+		struct timespec ts;
+		struct timeval now;
+		long long wait;
+		int hint = 0;
+
+		gettimeofday(&now, NULL);
+
+		if (lsd_reopen) {
+			lsd_reopen = 0;
+			rc = lsd_open_output();
+			if (rc < 0)
+				break;
+		}
+
+		if (set == NULL || (opt.o_rescan > 0 &&
+				    now.tv_sec - last_scan >= opt.o_rescan)) {
+			rc = lsd_build_set(&set);
+			if (rc < 0 && taken == 0) {
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "no parameters to sample");
+				break;
+			}
+			last_scan = now.tv_sec;
+		}
+
+		fprintf(out, "T %ld.%06ld\n", (long)now.tv_sec,
+			(long)now.tv_usec);
+		rc = llapi_param_set_read(set, lsd_param_cb, &hint);
+		if (rc == -ENOMEM) {
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot sample");
+			break;
+		}
+		fflush(out);
+		rc = 0;
+
+		if (++taken == opt.o_samples)
+			break;
+
+		/* keep to the interval however long the sample took */
+		gettimeofday(&now, NULL);
+		wait = opt.o_interval * 1000000LL -
+		       ((now.tv_sec % opt.o_interval) * 1000000LL +
+			now.tv_usec);
+		ts.tv_sec = wait / 1000000;
+		ts.tv_nsec = (wait % 1000000) * 1000;
+		nanosleep(&ts, NULL);
+	}
+
+	llapi_param_set_free(set);
+	if (out != stdout)
+		fclose(out);
+
+	return -rc;
+}
@@ -59,6 +59,7 @@ static struct option long_opt_start[] = {
 { .val = 'd',	.name = "delay-create-ostobj",	.has_arg = optional_argument },
 { .val = 'e',	.name = "error",		.has_arg = required_argument },
 { .val = 'h',	.name = "help",			.has_arg = no_argument },
+{ .val = 'I',	.name = "incremental",		.has_arg = no_argument },
 { .val = 'M',	.name = "device",		.has_arg = required_argument },
 { .val = 'n',	.name = "dryrun",		.has_arg = optional_argument },
 { .val = 'o',	.name = "orphan",		.has_arg = no_argument },
@@ -129,6 +130,7 @@ static void usage_start(void)
 		"	     [-C | --create_mdtobj [on | off]]\n"
 		"	     [-d | --delay_create_ostobj [on | off]]\n"
 		"	     [-e | --error {continue | abort}] [-h | --help]\n"
+		"	     [-I | --incremental]\n"
 		"	     [-n | --dryrun [on | off]] [-o | --orphan]\n"
 		"            [-r | --reset] [-s | --speed ops_per_sec_limit]\n"
 		"            [-t | --type check_type[,check_type...]]\n"
@@ -145,6 +147,8 @@ static void usage_start(void)
 		    "until orphan OST-objects handled (default 'off', or 'on')\n"
 		"-e: error handle mode (default 'continue', or 'abort')\n"
 		"-h: this help message\n"
+		"-I: only check the objects changed since the last complete "
+		    "LFSCK\n"
 		"-n: check with no modification (default 'off', or 'on')\n"
 		"-o: repair orphan OST-objects\n"
 		"-r: reset scanning to the start of the device\n"
@@ -293,7 +297,7 @@ int jt_lfsck_start(int argc, char **argv)
 	char rawbuf[MAX_IOC_BUFLEN], *buf = rawbuf;
 	char device[MAX_OBD_NAME];
 	struct lfsck_start start;
-	char *short_opts = "Ac::C::d::e:hM:n::ors:t:w:";
+	char *short_opts = "Ac::C::d::e:hIM:n::ors:t:w:";
 	int opt, index, rc, val, i;
 
 	memset(&data, 0, sizeof(data));
@@ -364,6 +368,9 @@ int jt_lfsck_start(int argc, char **argv)
 		case 'h':
 			usage_start();
 			return 0;
+		case 'I':
+			start.ls_flags |= LPF_INCREMENTAL;
+			break;
 		case 'M':
 			rc = lfsck_pack_dev(&data, device, optarg);
 			if (rc != 0)
@@ -116,6 +116,7 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <utime.h>
 #include <time.h>
 #include <sys/xattr.h>
@@ -129,6 +130,7 @@
 #define REPLICATE_STATUS_VER 1
 #define CLEAR_INTERVAL 100
 #define DEFAULT_RSYNC_THRESHOLD 0xA00000 /* 10 MB */
+#define LR_JOBS_PER_THREAD 1024 /* queued data syncs before blocking */
 
 #define TYPE_STR_LEN 16
 
@@ -176,6 +178,16 @@ struct lr_parent_child_list {
         struct lr_parent_child_list *pc_next;
 };
 
+/* A file whose data and attributes are to be synced by a worker thread.
+   Jobs are kept in changelog order, so the head of the list holds the
+   oldest record that is not fully replicated yet. */
+struct lr_job {
+	struct lr_job *lj_next;
+	long long lj_recno;
+	int lj_running;
+	char lj_tfid[LR_FID_STR_LEN];
+};
+
 struct lustre_rsync_status *status;
 char *statuslog;  /* Name of the status log file */
 int logbackedup;
@@ -191,6 +203,14 @@ long long rsync_threshold = DEFAULT_RSYNC_THRESHOLD;
 int quit;       /* Flag to stop processing the changelog; set on the
                    receipt of a signal */
 int abort_on_err = 0;
+int nthreads = 1; /* Number of threads syncing file data */
+
+pthread_mutex_t lr_job_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t lr_job_queued = PTHREAD_COND_INITIALIZER;
+pthread_cond_t lr_job_done = PTHREAD_COND_INITIALIZER;
+struct lr_job *lr_jobs;
+int lr_jobs_nr;
+int lr_jobs_stop;
 
 char rsync[PATH_MAX + 128];
 char rsync_ver[PATH_MAX * 2];
@@ -215,6 +235,7 @@ struct option long_opts[] = {
 	{ .val = 'D',	.name = "debuglog",	.has_arg = required_argument },
 	{ .val = 'n',	.name = "start-recno",	.has_arg = required_argument },
 	{ .val = 'r',	.name = "use-rsync",	.has_arg = no_argument },
+	{ .val = 'T',	.name = "threads",	.has_arg = required_argument },
 	{ .val = 'y',	.name = "rsync-threshold",
 						.has_arg = required_argument },
 	{ .name = NULL } };
@@ -230,6 +251,7 @@ void lr_usage()
                 "options:\n"
                 "\t--xattr <yes|no> replicate EAs\n"
                 "\t--abort-on-err   abort at first err\n"
+                "\t--threads <n>    sync file data with n threads\n"
                 "\t--verbose\n"
                 "\t--dry-run        don't write anything\n");
 }
@@ -1418,14 +1440,143 @@ int lr_read_log()
         return rc;
 }
 
+void lr_print_failure(struct lr_info *info, int rc)
+{
+        fprintf(stderr, "Replication of operation failed(%d):"
+                " %lld %s (%d) %s %s %s\n", rc, info->recno,
+                changelog_type2str(info->type), info->type, info->tfid,
+                info->pfid, info->name);
+}
+
+/* Worker thread: sync the data and attributes of queued files. */
+void *lr_sync_worker(void *arg)
+{
+	struct lr_info *info;
+	struct lr_job **pos;
+	struct lr_job *job;
+	int rc;
+
+	info = calloc(1, sizeof(*info));
+	if (info == NULL)
+		return NULL;
+	info->type = CL_SETATTR;
+
+	pthread_mutex_lock(&lr_job_lock);
+	while (1) {
+		for (job = lr_jobs; job != NULL; job = job->lj_next)
+			if (!job->lj_running)
+				break;
+		if (job == NULL) {
+			if (lr_jobs_stop)
+				break;
+			pthread_cond_wait(&lr_job_queued, &lr_job_lock);
+			continue;
+		}
+		job->lj_running = 1;
+		pthread_mutex_unlock(&lr_job_lock);
+
+		info->recno = job->lj_recno;
+		snprintf(info->tfid, sizeof(info->tfid), "%s", job->lj_tfid);
+		info->name[0] = '\0';
+		info->pfid[0] = '\0';
+
+		rc = lr_setattr(info);
+
+		pthread_mutex_lock(&lr_job_lock);
+		if (rc && rc != -ENOENT) {
+			lr_print_failure(info, rc);
+			errors++;
+			if (abort_on_err)
+				quit = 1;
+		}
+		for (pos = &lr_jobs; *pos != job; pos = &(*pos)->lj_next)
+			;
+		*pos = job->lj_next;
+		lr_jobs_nr--;
+		free(job);
+		pthread_cond_broadcast(&lr_job_done);
+	}
+	pthread_mutex_unlock(&lr_job_lock);
+
+	free(info->buf);
+	free(info);
+	return NULL;
+}
+
+/* Hand the data sync of info->tfid to the worker threads. Records for a
+   file which is already waiting are dropped, as the worker copies the
+   state of the file at the time it gets to it. */
+int lr_queue_sync(struct lr_info *info)
+{
+	struct lr_job **pos;
+	struct lr_job *job;
+
+	pthread_mutex_lock(&lr_job_lock);
+	for (pos = &lr_jobs; *pos != NULL; pos = &(*pos)->lj_next) {
+		job = *pos;
+		if (!job->lj_running && strcmp(job->lj_tfid, info->tfid) == 0) {
+			pthread_mutex_unlock(&lr_job_lock);
+			lr_debug(DTRACE, "coalesced %lld with %lld %s\n",
+				 info->recno, job->lj_recno, info->tfid);
+			return 0;
+		}
+	}
+
+	job = calloc(1, sizeof(*job));
+	if (job == NULL) {
+		pthread_mutex_unlock(&lr_job_lock);
+		return -ENOMEM;
+	}
+	job->lj_recno = info->recno;
+	snprintf(job->lj_tfid, sizeof(job->lj_tfid), "%s", info->tfid);
+
+	while (lr_jobs_nr >= nthreads * LR_JOBS_PER_THREAD)
+		pthread_cond_wait(&lr_job_done, &lr_job_lock);
+
+	/* the list may have changed while waiting */
+	for (pos = &lr_jobs; *pos != NULL; pos = &(*pos)->lj_next)
+		;
+	*pos = job;
+	lr_jobs_nr++;
+	pthread_cond_signal(&lr_job_queued);
+	pthread_mutex_unlock(&lr_job_lock);
+
+	return 0;
+}
+
+/* Wait for the worker threads to sync all queued files. Operations that
+   move or remove names on the target must not race with a data sync
+   resolving the same file. */
+void lr_drain_sync(void)
+{
+	pthread_mutex_lock(&lr_job_lock);
+	while (lr_jobs != NULL)
+		pthread_cond_wait(&lr_job_done, &lr_job_lock);
+	pthread_mutex_unlock(&lr_job_lock);
+}
+
+/* Changelog index up to which everything has been replicated. */
+long long lr_replicated_recno(struct lr_info *info)
+{
+	long long recno = info->recno;
+
+	pthread_mutex_lock(&lr_job_lock);
+	if (lr_jobs != NULL)
+		recno = lr_jobs->lj_recno - 1;
+	pthread_mutex_unlock(&lr_job_lock);
+
+	return recno;
+}
+
 /* Clear changelogs every CLEAR_INTERVAL records or at the end of
    processing. */
 int lr_clear_cl(struct lr_info *info, int force)
 {
 	char		mdt_device[LR_NAME_MAXLEN + 1];
+	long long	recno = lr_replicated_recno(info);
 	int		rc = 0;
 
-        if (force || info->recno > status->ls_last_recno + CLEAR_INTERVAL) {
+        if (force || recno > status->ls_last_recno + CLEAR_INTERVAL) {
                 if (!noclear && !dryrun) {
                         /* llapi_changelog_clear modifies the mdt
                          * device name so make a copy of it until this
@@ -1435,16 +1586,16 @@ int lr_clear_cl(struct lr_info *info, int force)
 				 status->ls_mdt_device);
                         rc = llapi_changelog_clear(mdt_device,
                                                    status->ls_registration,
-						   info->recno);
+						   recno);
                         if (rc)
 				printf("Changelog clear (%s, %s, %lld) "
 				       "returned %d\n", status->ls_mdt_device,
-				       status->ls_registration, info->recno,
+				       status->ls_registration, recno,
 				       rc);
 		}
 
 		if (!rc && !dryrun) {
-			status->ls_last_recno = info->recno;
+			status->ls_last_recno = recno;
 			lr_write_log();
 		}
 	}
@@ -1520,20 +1671,14 @@ void lr_print_status(struct lr_info *info)
                 printf("Using rsync: %s (%s)\n", rsync, rsync_ver);
 }
 
-void lr_print_failure(struct lr_info *info, int rc)
-{
-        fprintf(stderr, "Replication of operation failed(%d):"
-                " %lld %s (%d) %s %s %s\n", rc, info->recno,
-                changelog_type2str(info->type), info->type, info->tfid,
-                info->pfid, info->name);
-}
-
 /* Replicate filesystem operations from src_path to target_path */
 int lr_replicate()
 {
         void *changelog_priv;
         struct lr_info *info;
 	struct lr_info *ext = NULL;
+	pthread_t *workers = NULL;
+	int nworkers = 0;
         time_t start;
         int xattr_not_supp;
         int i;
@@ -1616,6 +1761,26 @@ int lr_replicate()
 		goto out;
 	}
 
+	if (nthreads > 1) {
+		workers = calloc(nthreads, sizeof(*workers));
+		if (workers == NULL) {
+			rc = -ENOMEM;
+			goto out;
+		}
+		for (nworkers = 0; nworkers < nthreads; nworkers++) {
+			rc = pthread_create(&workers[nworkers], NULL,
+					    lr_sync_worker, NULL);
+			if (rc) {
+				fprintf(stderr, "Error starting thread: %s\n",
+					strerror(rc));
+				break;
+			}
+		}
+		/* fall back to what could be started */
+		if (nworkers == 0)
+			nthreads = 1;
+	}
+
         while (!quit && lr_parse_line(changelog_priv, info) == 0) {
                 rc = 0;
 		if (info->type == CL_RENAME && !info->is_extended) {
@@ -1653,17 +1818,23 @@ int lr_replicate()
                         break;
                 case CL_RMDIR:
                 case CL_UNLINK:
+			lr_drain_sync();
                         rc = lr_remove(info);
                         break;
                 case CL_RENAME:
+			lr_drain_sync();
 			rc = lr_move(info);
                         break;
                 case CL_HARDLINK:
+			lr_drain_sync();
                         rc = lr_link(info);
                         break;
                 case CL_TRUNC:
                 case CL_SETATTR:
-                        rc = lr_setattr(info);
+			if (nworkers > 0)
+				rc = lr_queue_sync(info);
+			else
+				rc = lr_setattr(info);
                         break;
 		case CL_SETXATTR:
                         rc = lr_setxattr(info);
@@ -1687,7 +1858,9 @@ int lr_replicate()
 
                 if (rc && rc != -ENOENT) {
                         lr_print_failure(info, rc);
+			pthread_mutex_lock(&lr_job_lock);
                         errors++;
+			pthread_mutex_unlock(&lr_job_lock);
                         if (abort_on_err)
                                 break;
                 }
@@ -1696,6 +1869,15 @@ int lr_replicate()
 
         llapi_changelog_fini(&changelog_priv);
 
+	if (nworkers > 0) {
+		pthread_mutex_lock(&lr_job_lock);
+		lr_jobs_stop = 1;
+		pthread_cond_broadcast(&lr_job_queued);
+		pthread_mutex_unlock(&lr_job_lock);
+		for (i = 0; i < nworkers; i++)
+			pthread_join(workers[i], NULL);
+	}
+
         if (errors || verbose)
                 printf("Errors: %d\n", errors);
 
@@ -1714,6 +1896,7 @@ out:
 		free(info);
 	if (ext != NULL)
 		free(ext);
+	free(workers);
 
 	return rc;
 }
@@ -1735,7 +1918,7 @@ int main(int argc, char *argv[])
         if ((rc = lr_init_status()) != 0)
                 return rc;
 
-	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:",
+	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:T:",
 				 long_opts, NULL)) >= 0) {
                 switch (rc) {
                 case 'a':
@@ -1819,6 +2002,14 @@ int main(int argc, char *argv[])
                         /* Undocumented option rsync-threshold */
                         rsync_threshold = atol(optarg);
                         break;
+		case 'T':
+			nthreads = atoi(optarg);
+			if (nthreads < 1) {
+				printf("Invalid number of threads %s\n",
+				       optarg);
+				return -1;
+			}
+			break;
                 case 'n':
                         /* Undocumented option start-recno */
                         status->ls_last_recno = atol(optarg);
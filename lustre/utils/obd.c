@@ -1454,6 +1454,11 @@ int jt_obd_test_md_getattr(int argc, char **argv)
         return jt_obd_md_common(argc, argv, ECHO_MD_GETATTR);
 }
 
+int jt_obd_test_rename(int argc, char **argv)
+{
+	return jt_obd_md_common(argc, argv, ECHO_MD_RENAME);
+}
+
 int jt_obd_create(int argc, char **argv)
 {
 	char rawbuf[MAX_IOC_BUFLEN], *buf = rawbuf;
@@ -2195,6 +2200,169 @@ int jt_obd_test_brw(int argc, char **argv)
         return rc;
 }
 
+/* print the latency below which \a pct percent of the I/Os completed */
+static void test_load_print_pct(struct echo_load_param *elp, double pct)
+{
+	__u64 want = (__u64)(elp->elp_ios * pct / 100.0 + 0.5);
+	__u64 seen = 0;
+	int i;
+
+	for (i = 0; i < ECHO_LOAD_LAT_BUCKETS; i++) {
+		seen += elp->elp_lat[i];
+		if (seen >= want && seen != 0)
+			break;
+	}
+	/* buckets only give an upper bound, which the max may tighten */
+	if (i >= ECHO_LOAD_LAT_BUCKETS - 1 || (1ULL << i) > elp->elp_lat_max)
+		printf(" p%g %llu", pct, (unsigned long long)elp->elp_lat_max);
+	else
+		printf(" p%g %llu", pct, 1ULL << i);
+}
+
+int jt_obd_test_load(int argc, char **argv)
+{
+	struct obd_ioctl_data data;
+	struct echo_load_param elp = {
+		.elp_objects = 1,
+		.elp_depth = 1,
+	};
+	char rawbuf[MAX_IOC_BUFLEN], *buf = rawbuf;
+	unsigned long pages_min = 1, pages_max = 1;
+	unsigned long long objid = 0, size = 0;
+	double secs;
+	int verify = 1;
+	char *end;
+	int rc, c;
+	struct option long_opts[] = {
+	{ .val = 'n',	.name = "objects",	.has_arg = required_argument },
+	{ .val = 'o',	.name = "objid",	.has_arg = required_argument },
+	{ .val = 'p',	.name = "pages",	.has_arg = required_argument },
+	{ .val = 'q',	.name = "depth",	.has_arg = required_argument },
+	{ .val = 'r',	.name = "read",		.has_arg = required_argument },
+	{ .val = 's',	.name = "size",		.has_arg = required_argument },
+	{ .val = 'x',	.name = "noverify",	.has_arg = no_argument },
+	{ .name = NULL } };
+
+	while ((c = getopt_long(argc, argv, "n:o:p:q:r:s:x",
+				long_opts, NULL)) >= 0) {
+		switch (c) {
+		case 'n':
+			elp.elp_objects = strtoul(optarg, &end, 0);
+			if (*end || elp.elp_objects == 0) {
+				fprintf(stderr, "error: %s: bad object count '%s'\n",
+					jt_cmdname(argv[0]), optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 'o':
+			objid = strtoull(optarg, &end, 0);
+			if (*end || objid == 0 || objid >= OBIF_MAX_OID) {
+				fprintf(stderr, "error: %s: bad objid '%s'\n",
+					jt_cmdname(argv[0]), optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 'p':
+			pages_min = pages_max = strtoul(optarg, &end, 0);
+			if (*end == '-')
+				pages_max = strtoul(end + 1, &end, 0);
+			if (*end || pages_min == 0 || pages_max < pages_min) {
+				fprintf(stderr, "error: %s: bad npages '%s'\n",
+					jt_cmdname(argv[0]), optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 'q':
+			elp.elp_depth = strtoul(optarg, &end, 0);
+			if (*end || elp.elp_depth == 0) {
+				fprintf(stderr, "error: %s: bad queue depth '%s'\n",
+					jt_cmdname(argv[0]), optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 'r':
+			elp.elp_read_pct = strtoul(optarg, &end, 0);
+			if (*end || elp.elp_read_pct > 100) {
+				fprintf(stderr, "error: %s: bad read percentage '%s'\n",
+					jt_cmdname(argv[0]), optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 's':
+			size = strtoull(optarg, &end, 0);
+			if (*end || size == 0) {
+				fprintf(stderr, "error: %s: bad size '%s'\n",
+					jt_cmdname(argv[0]), optarg);
+				return CMD_HELP;
+			}
+			break;
+		case 'x':
+			verify = 0;
+			break;
+		default:
+			return CMD_HELP;
+		}
+	}
+
+	if (objid == 0 || size == 0 || optind != argc)
+		return CMD_HELP;
+
+	/* size is given in KiB per object, rounded down to whole pages */
+	elp.elp_count = size * 1024 / getpagesize() * getpagesize();
+	elp.elp_io_min = pages_min * getpagesize();
+	elp.elp_io_max = pages_max * getpagesize();
+
+	memset(&data, 0, sizeof(data));
+	data.ioc_dev = cur_device;
+	data.ioc_pbuf1 = (char *)&elp;
+	data.ioc_plen1 = sizeof(elp);
+
+	ostid_set_seq_echo(&data.ioc_obdo1.o_oi);
+	data.ioc_obdo1.o_oi.oi_fid.f_oid = objid;
+	data.ioc_obdo1.o_mode = S_IFREG;
+	data.ioc_obdo1.o_valid = OBD_MD_FLID | OBD_MD_FLTYPE | OBD_MD_FLMODE |
+				 OBD_MD_FLFLAGS | OBD_MD_FLGROUP;
+	data.ioc_obdo1.o_flags = (verify ? OBD_FL_DEBUG_CHECK : 0);
+
+	memset(buf, 0, sizeof(rawbuf));
+	rc = llapi_ioctl_pack(&data, &buf, sizeof(rawbuf));
+	if (rc) {
+		fprintf(stderr, "error: %s: invalid ioctl\n",
+			jt_cmdname(argv[0]));
+		return rc;
+	}
+	rc = l2_ioctl(OBD_DEV_ID, OBD_IOC_ECHO_LOAD, buf);
+	if (rc) {
+		rc = -errno;
+		fprintf(stderr, "error: %s: load run failed: %s\n",
+			jt_cmdname(argv[0]), strerror(-rc));
+		if (elp.elp_ios == 0)
+			return rc;
+	}
+
+	secs = elp.elp_usec / 1000000.0;
+	if (secs == 0)
+		secs = 0.000001;
+	printf("%s: %llu IOs, read %.2f MB, wrote %.2f MB in %.3fs "
+	       "(%.2f MB/s, %.2f IOs/s) depth %u\n",
+	       jt_cmdname(argv[0]), (unsigned long long)elp.elp_ios,
+	       elp.elp_bytes_read / 1048576.0,
+	       elp.elp_bytes_written / 1048576.0, secs,
+	       (elp.elp_bytes_read + elp.elp_bytes_written) /
+	       (secs * 1048576.0), elp.elp_ios / secs, elp.elp_depth);
+
+	if (elp.elp_ios != 0) {
+		printf("%s: latency usec:", jt_cmdname(argv[0]));
+		test_load_print_pct(&elp, 50);
+		test_load_print_pct(&elp, 90);
+		test_load_print_pct(&elp, 99);
+		test_load_print_pct(&elp, 99.9);
+		printf(" max %llu\n", (unsigned long long)elp.elp_lat_max);
+	}
+
+	return rc;
+}
+
 int jt_obd_lov_getconfig(int argc, char **argv)
 {
         struct obd_ioctl_data data;
@@ -110,6 +110,7 @@ int jt_obd_test_rmdir(int argc, char **argv);
 int jt_obd_test_lookup(int argc, char **argv);
 int jt_obd_test_setxattr(int argc, char **argv);
 int jt_obd_test_md_getattr(int argc, char **argv);
+int jt_obd_test_rename(int argc, char **argv);
 
 int jt_obd_setattr(int argc, char **argv);
 int jt_obd_test_setattr(int argc, char **argv);
@@ -117,6 +118,7 @@ int jt_obd_destroy(int argc, char **argv);
 int jt_obd_getattr(int argc, char **argv);
 int jt_obd_test_getattr(int argc, char **argv);
 int jt_obd_test_brw(int argc, char **argv);
+int jt_obd_test_load(int argc, char **argv);
 int jt_obd_lov_getconfig(int argc, char **argv);
 int jt_obd_test_ldlm(int argc, char **argv);
 int jt_obd_ldlm_regress_start(int argc, char **argv);
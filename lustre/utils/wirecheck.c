@@ -520,7 +520,7 @@ check_obd_connect_data(void)
 	CHECK_MEMBER(obd_connect_data, ocd_maxbytes);
 	CHECK_MEMBER(obd_connect_data, ocd_maxmodrpcs);
 	CHECK_MEMBER(obd_connect_data, padding0);
-	CHECK_MEMBER(obd_connect_data, padding1);
+	CHECK_MEMBER(obd_connect_data, ocd_conn_window);
 	CHECK_MEMBER(obd_connect_data, ocd_connect_flags2);
 	CHECK_MEMBER(obd_connect_data, padding3);
 	CHECK_MEMBER(obd_connect_data, padding4);
@@ -611,6 +611,15 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FIDMAP);
 	CHECK_DEFINE_64X(OBD_CONNECT2_GETATTR_PFID);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_RPC);
+	CHECK_DEFINE_64X(OBD_CONNECT2_SHARED_PING);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BL_AST_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_T10_GUARDS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_COMPRESS);
+	CHECK_DEFINE_64X(OBD_CONNECT2_STRICT_SOM);
+	CHECK_DEFINE_64X(OBD_CONNECT2_DOM_READ_HEAD);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_SYNC);
+	CHECK_DEFINE_64X(OBD_CONNECT2_CONN_WINDOW);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -737,6 +746,8 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_NOSPC_BLK);
 	CHECK_CVALUE_X(OBD_FL_FLUSH);
 	CHECK_CVALUE_X(OBD_FL_SHORT_IO);
+	CHECK_CVALUE_X(OBD_FL_GRANT_RECALL);
+	CHECK_CVALUE_X(OBD_FL_SOFT_SYNC);
 }
 
 static void
@@ -800,7 +811,7 @@ check_lov_comp_md_entry_v1(void)
 	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_size);
 	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_layout_gen);
 	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_timestamp);
-	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_padding_1);
+	CHECK_MEMBER(lov_comp_md_entry_v1, lcme_extension_size);
 
 	CHECK_VALUE_X(LCME_FL_INIT);
 	CHECK_VALUE_X(LCME_FL_NEG);
@@ -873,7 +884,7 @@ check_obd_statfs(void)
 	CHECK_MEMBER(obd_statfs, os_state);
 	CHECK_MEMBER(obd_statfs, os_fprecreated);
 	CHECK_MEMBER(obd_statfs, os_granted);
-	CHECK_MEMBER(obd_statfs, os_spare3);
+	CHECK_MEMBER(obd_statfs, os_load);
 	CHECK_MEMBER(obd_statfs, os_spare4);
 	CHECK_MEMBER(obd_statfs, os_spare5);
 	CHECK_MEMBER(obd_statfs, os_spare6);
@@ -1027,6 +1038,25 @@ check_ost_body(void)
 	CHECK_MEMBER(ost_body, oa);
 }
 
+static void
+check_ost_compr(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ost_compr);
+	CHECK_MEMBER(ost_compr, oc_type);
+	CHECK_MEMBER(ost_compr, oc_raw);
+	CHECK_MEMBER(ost_compr, oc_count);
+	CHECK_MEMBER(ost_compr, oc_padding);
+	CHECK_MEMBER(ost_compr, oc_lens[0]);
+
+	CHECK_VALUE(OBD_COMPR_NONE);
+	CHECK_VALUE(OBD_COMPR_LZ4);
+	CHECK_VALUE(OBD_COMPR_ZSTD);
+	CHECK_VALUE(OBD_COMPR_DEFLATE);
+	CHECK_VALUE(OBD_COMPR_LZO);
+	CHECK_VALUE(OBD_COMPR_CHUNK_SIZE);
+}
+
 static void
 check_ll_fid(void)
 {
@@ -1151,6 +1181,17 @@ check_mdt_ioepoch(void)
 	CHECK_MEMBER(mdt_ioepoch, mio_padding);
 }
 
+static void
+check_batch_body(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(batch_body);
+	CHECK_MEMBER(batch_body, bb_magic);
+	CHECK_MEMBER(batch_body, bb_count);
+	CHECK_MEMBER(batch_body, bb_padding);
+	CHECK_CDEFINE(BATCH_MAGIC);
+}
+
 static void
 check_mdt_rec_setattr(void)
 {
@@ -2681,6 +2722,8 @@ main(int argc, char **argv)
 	CHECK_VALUE(MDS_HSM_CT_REGISTER);
 	CHECK_VALUE(MDS_HSM_CT_UNREGISTER);
 	CHECK_VALUE(MDS_SWAP_LAYOUTS);
+	CHECK_VALUE(MDS_RMFID);
+	CHECK_VALUE(MDS_BATCH);
 	CHECK_VALUE(MDS_LAST_OPC);
 
 	CHECK_VALUE(REINT_SETATTR);
@@ -2863,10 +2906,12 @@ main(int argc, char **argv)
 	check_obd_idx_read();
 	check_niobuf_remote();
 	check_ost_body();
+	check_ost_compr();
 	check_ll_fid();
 	check_mds_op_bias();
 	check_mdt_body();
 	check_mdt_ioepoch();
+	check_batch_body();
 	check_mdt_rec_setattr();
 	check_mdt_rec_create();
 	check_mdt_rec_link();